@@ -127,6 +127,7 @@ uint8_t  usbd_cdc_SOF         (void *pdev);
    CDC specific management functions
  *********************************************/
 static void Handle_USBAsynchXfer  (void *pdev);
+static uint32_t CDC_Queued_Bytes  (void);
 static uint8_t  *USBD_cdc_GetCfgDesc (uint8_t speed, uint16_t *length);
 #ifdef USE_USB_OTG_HS  
 static uint8_t  *USBD_cdc_GetOtherCfgDesc (uint8_t speed, uint16_t *length);
@@ -627,6 +628,13 @@ uint8_t  usbd_cdc_DataIn (void *pdev, uint8_t epnum)
     if (APP_Rx_length == 0) 
     {
       USB_Tx_State = USB_CDC_IDLE;
+
+      /* Keep streaming without waiting for the next SOF when a full packet is already queued, shorter tails are
+         left for the SOF so that they get a chance to fill up */
+      if (CDC_Queued_Bytes() >= CDC_DATA_IN_PACKET_SIZE)
+      {
+        Handle_USBAsynchXfer(pdev);
+      }
     }
     else 
     {
@@ -662,13 +670,22 @@ uint8_t  usbd_cdc_DataIn (void *pdev, uint8_t epnum)
   /* Avoid any asynchronous transfer during ZLP */
   if (USB_Tx_State == USB_CDC_ZLP)
   {
+    if (CDC_Queued_Bytes() > 0)
+    {
+      /* More data is already waiting, it continues the transfer and ends it instead of the ZLP */
+      USB_Tx_State = USB_CDC_IDLE;
+      Handle_USBAsynchXfer(pdev);
+      return USBD_OK;
+    }
+
     /*Send ZLP to indicate the end of the current transfer */
     DCD_EP_Tx (pdev,
                CDC_IN_EP,
                NULL,
                0);
     
-    USB_Tx_State = USB_CDC_IDLE;
+    /* Stay busy until the ZLP itself has gone out, so that no new transfer is started on top of it */
+    USB_Tx_State = USB_CDC_BUSY;
   }
   return USBD_OK;
 }
@@ -723,6 +740,18 @@ uint8_t  usbd_cdc_SOF (void *pdev)
   return USBD_OK;
 }
 
+/**
+  * @brief  CDC_Queued_Bytes
+  *         Number of bytes waiting in the IN buffer
+  * @param  None
+  * @retval number of bytes
+  */
+static uint32_t CDC_Queued_Bytes (void)
+{
+  /* APP_Rx_ptr_out can be left at APP_RX_DATA_SIZE until the next transfer wraps it */
+  return (APP_Rx_ptr_in + APP_RX_DATA_SIZE - APP_Rx_ptr_out) % APP_RX_DATA_SIZE;
+}
+
 /**
   * @brief  Handle_USBAsynchXfer
   *         Send data to USB
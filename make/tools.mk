@@ -289,6 +289,8 @@ zip_clean:
 GCC_VERSION=$(shell arm-none-eabi-gcc -dumpversion)
 ifeq ($(shell [ -d "$(ARM_SDK_DIR)" ] && echo "exists"), exists)
   ARM_SDK_PREFIX := $(ARM_SDK_DIR)/bin/arm-none-eabi-
+else ifeq ($(TARGET),SITL)
+  # built with the host compiler
 else ifeq (,$(findstring _install,$(MAKECMDGOALS)))
   ifeq ($(GCC_VERSION),)
     $(error **ERROR** arm-none-eabi-gcc not in the PATH. Run 'make arm_sdk_install' to install automatically in the tools folder of this repo)
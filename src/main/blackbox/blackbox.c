@@ -25,6 +25,7 @@
 #ifdef BLACKBOX
 
 #include "build/debug.h"
+#include "build/profile.h"
 #include "build/version.h"
 
 #include "common/axis.h"
@@ -32,6 +33,7 @@
 #include "common/utils.h"
 
 #include "blackbox.h"
+#include "blackbox_capture.h"
 #include "blackbox_io.h"
 
 #include "drivers/sensor.h"
@@ -142,22 +144,22 @@ static const blackboxDeltaFieldDefinition_t blackboxMainFields[] = {
     {"loopIteration",-1, UNSIGNED, .Ipredict = PREDICT(0),     .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(INC),           .Pencode = FLIGHT_LOG_FIELD_ENCODING_NULL, CONDITION(ALWAYS)},
     /* Time advances pretty steadily so the P-frame prediction is a straight line */
     {"time",       -1, UNSIGNED, .Ipredict = PREDICT(0),       .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(STRAIGHT_LINE), .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"axisP",       0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"axisP",       1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"axisP",       2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
+    {"axisP",       0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_PID)},
+    {"axisP",       1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_PID)},
+    {"axisP",       2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_PID)},
     /* I terms get special packed encoding in P frames: */
-    {"axisI",       0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG2_3S32), CONDITION(ALWAYS)},
-    {"axisI",       1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG2_3S32), CONDITION(ALWAYS)},
-    {"axisI",       2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG2_3S32), CONDITION(ALWAYS)},
+    {"axisI",       0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG2_3S32), CONDITION(LOG_PID)},
+    {"axisI",       1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG2_3S32), CONDITION(LOG_PID)},
+    {"axisI",       2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG2_3S32), CONDITION(LOG_PID)},
     {"axisD",       0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(NONZERO_PID_D_0)},
     {"axisD",       1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(NONZERO_PID_D_1)},
     {"axisD",       2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(NONZERO_PID_D_2)},
     /* rcCommands are encoded together as a group in P-frames: */
-    {"rcCommand",   0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_4S16), CONDITION(ALWAYS)},
-    {"rcCommand",   1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_4S16), CONDITION(ALWAYS)},
-    {"rcCommand",   2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_4S16), CONDITION(ALWAYS)},
+    {"rcCommand",   0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_4S16), CONDITION(LOG_RC_COMMANDS)},
+    {"rcCommand",   1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_4S16), CONDITION(LOG_RC_COMMANDS)},
+    {"rcCommand",   2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_4S16), CONDITION(LOG_RC_COMMANDS)},
     /* Throttle is always in the range [minthrottle..maxthrottle]: */
-    {"rcCommand",   3, UNSIGNED, .Ipredict = PREDICT(MINTHROTTLE), .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(PREVIOUS),  .Pencode = ENCODING(TAG8_4S16), CONDITION(ALWAYS)},
+    {"rcCommand",   3, UNSIGNED, .Ipredict = PREDICT(MINTHROTTLE), .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(PREVIOUS),  .Pencode = ENCODING(TAG8_4S16), CONDITION(LOG_RC_COMMANDS)},
 
     {"vbatLatest",    -1, UNSIGNED, .Ipredict = PREDICT(VBATREF),  .Iencode = ENCODING(NEG_14BIT),   .Ppredict = PREDICT(PREVIOUS),  .Pencode = ENCODING(TAG8_8SVB), FLIGHT_LOG_FIELD_CONDITION_VBAT},
     {"amperageLatest",-1, UNSIGNED, .Ipredict = PREDICT(0),        .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(PREVIOUS),  .Pencode = ENCODING(TAG8_8SVB), FLIGHT_LOG_FIELD_CONDITION_AMPERAGE_ADC},
@@ -176,16 +178,20 @@ static const blackboxDeltaFieldDefinition_t blackboxMainFields[] = {
     {"rssi",       -1, UNSIGNED, .Ipredict = PREDICT(0),       .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_8SVB), FLIGHT_LOG_FIELD_CONDITION_RSSI},
 
     /* Gyros and accelerometers base their P-predictions on the average of the previous 2 frames to reduce noise impact */
-    {"gyroADC",   0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"gyroADC",   1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"gyroADC",   2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"accSmooth",  0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"accSmooth",  1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"accSmooth",  2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"debug",    0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"debug",    1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"debug",    2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"debug",    3, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
+    {"gyroADC",   0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_GYRO)},
+    {"gyroADC",   1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_GYRO)},
+    {"gyroADC",   2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_GYRO)},
+    {"accSmooth",  0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_ACC)},
+    {"accSmooth",  1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_ACC)},
+    {"accSmooth",  2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_ACC)},
+    {"debug",    0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
+    {"debug",    1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
+    {"debug",    2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
+    {"debug",    3, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
+    {"debug",    4, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
+    {"debug",    5, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
+    {"debug",    6, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
+    {"debug",    7, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(LOG_DEBUG)},
     /* Motors only rarely drops under minthrottle (when stick falls below mincommand), so predict minthrottle for it and use *unsigned* encoding (which is large for negative numbers but more compact for positive ones): */
     {"motor",      0, UNSIGNED, .Ipredict = PREDICT(MINMOTOR), .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(AVERAGE_2), .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_1)},
     /* Subsequent motors base their I-frame values on the first one, P-frame values on the average of last two frames: */
@@ -220,6 +226,26 @@ static const blackboxSimpleFieldDefinition_t blackboxGpsHFields[] = {
 };
 #endif
 
+/*
+ * Gyro and motors logged on the loop iterations that don't get a main frame, so their spectrum can be studied at the
+ * full loop rate while the rest of the state is decimated. The predictors use their own history, which is advanced
+ * by every main and fast frame, so "previous" here means the previous loop iteration that was logged at all.
+ */
+static const blackboxConditionalFieldDefinition_t blackboxFastFields[] = {
+    {"time",      -1, UNSIGNED, PREDICT(STRAIGHT_LINE), ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
+    {"gyroADC",    0, SIGNED,   PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(LOG_GYRO)},
+    {"gyroADC",    1, SIGNED,   PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(LOG_GYRO)},
+    {"gyroADC",    2, SIGNED,   PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(LOG_GYRO)},
+    {"motor",      0, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_1)},
+    {"motor",      1, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_2)},
+    {"motor",      2, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_3)},
+    {"motor",      3, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_4)},
+    {"motor",      4, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_5)},
+    {"motor",      5, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_6)},
+    {"motor",      6, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_7)},
+    {"motor",      7, UNSIGNED, PREDICT(AVERAGE_2),     ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_8)}
+};
+
 // Rarely-updated fields
 static const blackboxSimpleFieldDefinition_t blackboxSlowFields[] = {
     {"flightModeFlags",       -1, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)},
@@ -227,7 +253,8 @@ static const blackboxSimpleFieldDefinition_t blackboxSlowFields[] = {
 
     {"failsafePhase",         -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)},
     {"rxSignalReceived",      -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)},
-    {"rxFlightChannelsValid", -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)}
+    {"rxFlightChannelsValid", -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)},
+    {"gyroOverflowCount",     -1, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)}
 };
 
 typedef enum BlackboxState {
@@ -239,10 +266,13 @@ typedef enum BlackboxState {
     BLACKBOX_STATE_SEND_GPS_H_HEADER,
     BLACKBOX_STATE_SEND_GPS_G_HEADER,
     BLACKBOX_STATE_SEND_SLOW_HEADER,
+    BLACKBOX_STATE_SEND_FAST_HEADER,
     BLACKBOX_STATE_SEND_SYSINFO,
     BLACKBOX_STATE_PAUSED,
     BLACKBOX_STATE_RUNNING,
-    BLACKBOX_STATE_SHUTTING_DOWN
+    BLACKBOX_STATE_SHUTTING_DOWN,
+    BLACKBOX_STATE_PREPARE_CAPTURE,
+    BLACKBOX_STATE_SEND_CAPTURE
 } BlackboxState;
 
 #define BLACKBOX_FIRST_HEADER_SENDING_STATE BLACKBOX_STATE_SEND_HEADER
@@ -256,7 +286,7 @@ typedef struct blackboxMainState_s {
     int16_t rcCommand[4];
     int16_t gyroADC[XYZ_AXIS_COUNT];
     int16_t accSmooth[XYZ_AXIS_COUNT];
-    int16_t debug[4];
+    int16_t debug[DEBUG16_VALUE_COUNT];
     int16_t motor[MAX_SUPPORTED_MOTORS];
     int16_t servo[MAX_SUPPORTED_SERVOS];
 
@@ -275,6 +305,12 @@ typedef struct blackboxMainState_s {
     uint16_t rssi;
 } blackboxMainState_t;
 
+typedef struct blackboxFastState_s {
+    uint32_t time;
+    int16_t gyroADC[XYZ_AXIS_COUNT];
+    int16_t motor[MAX_SUPPORTED_MOTORS];
+} blackboxFastState_t;
+
 typedef struct blackboxGpsState_s {
     int32_t GPS_home[2], GPS_coord[2];
     uint8_t GPS_numSat;
@@ -287,6 +323,7 @@ typedef struct blackboxSlowState_s {
     uint8_t failsafePhase;
     bool rxSignalReceived;
     bool rxFlightChannelsValid;
+    uint32_t gyroOverflowCount;
 } __attribute__((__packed__)) blackboxSlowState_t; // We pack this struct so that padding doesn't interfere with memcmp()
 
 //From mixer.c:
@@ -339,6 +376,10 @@ static blackboxMainState_t blackboxHistoryRing[3];
 // These point into blackboxHistoryRing, use them to know where to store history of a given age (0, 1 or 2 generations old)
 static blackboxMainState_t* blackboxHistory[3];
 
+// The same again for the fast frames, which carry a subset of the main state
+static blackboxFastState_t blackboxFastHistoryRing[3];
+static blackboxFastState_t* blackboxFastHistory[3];
+
 static bool blackboxModeActivationConditionPresent = false;
 
 /**
@@ -353,6 +394,11 @@ static bool blackboxIsOnlyLoggingIntraframes() {
     return blackboxConfig()->rate_num == 1 && blackboxConfig()->rate_denom == 32;
 }
 
+static bool blackboxIsFieldGroupEnabled(blackboxFieldGroup_e group)
+{
+    return (blackboxConfig()->fields_disabled_mask & (1 << group)) == 0;
+}
+
 static bool testBlackboxConditionUncached(FlightLogFieldCondition condition)
 {
     switch (condition) {
@@ -367,7 +413,8 @@ static bool testBlackboxConditionUncached(FlightLogFieldCondition condition)
         case FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_6:
         case FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_7:
         case FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_8:
-            return getMotorCount() >= condition - FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_1 + 1;
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_MOTOR)
+                && getMotorCount() >= condition - FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_1 + 1;
 
         case FLIGHT_LOG_FIELD_CONDITION_TRICOPTER:
             return mixerConfig()->mixerMode == MIXER_TRI || mixerConfig()->mixerMode == MIXER_CUSTOM_TRI;
@@ -375,37 +422,55 @@ static bool testBlackboxConditionUncached(FlightLogFieldCondition condition)
         case FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_0:
         case FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_1:
         case FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_2:
-            return currentProfile->pidProfile.D8[condition - FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_0] != 0;
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_PID)
+                && currentProfile->pidProfile.D8[condition - FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_0] != 0;
+
+        case FLIGHT_LOG_FIELD_CONDITION_LOG_PID:
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_PID);
+
+        case FLIGHT_LOG_FIELD_CONDITION_LOG_RC_COMMANDS:
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_RC_COMMANDS);
+
+        case FLIGHT_LOG_FIELD_CONDITION_LOG_GYRO:
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_GYRO);
+
+        case FLIGHT_LOG_FIELD_CONDITION_LOG_ACC:
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_ACC);
+
+        case FLIGHT_LOG_FIELD_CONDITION_LOG_DEBUG:
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_DEBUG);
 
         case FLIGHT_LOG_FIELD_CONDITION_MAG:
 #ifdef MAG
-            return sensors(SENSOR_MAG);
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_MAG) && sensors(SENSOR_MAG);
 #else
             return false;
 #endif
 
         case FLIGHT_LOG_FIELD_CONDITION_BARO:
 #ifdef BARO
-            return sensors(SENSOR_BARO);
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_ALTITUDE) && sensors(SENSOR_BARO);
 #else
             return false;
 #endif
 
         case FLIGHT_LOG_FIELD_CONDITION_VBAT:
-            return feature(FEATURE_VBAT);
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_BATTERY) && feature(FEATURE_VBAT);
 
         case FLIGHT_LOG_FIELD_CONDITION_AMPERAGE_ADC:
-            return feature(FEATURE_CURRENT_METER) && batteryConfig()->currentMeterType == CURRENT_SENSOR_ADC;
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_BATTERY)
+                && feature(FEATURE_CURRENT_METER) && batteryConfig()->currentMeterType == CURRENT_SENSOR_ADC;
 
         case FLIGHT_LOG_FIELD_CONDITION_SONAR:
 #ifdef SONAR
-            return feature(FEATURE_SONAR);
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_ALTITUDE) && feature(FEATURE_SONAR);
 #else
             return false;
 #endif
 
         case FLIGHT_LOG_FIELD_CONDITION_RSSI:
-            return rxConfig()->rssi_channel > 0 || feature(FEATURE_RSSI_ADC);
+            return blackboxIsFieldGroupEnabled(BLACKBOX_FIELD_GROUP_RSSI)
+                && (rxConfig()->rssi_channel > 0 || feature(FEATURE_RSSI_ADC));
 
         case FLIGHT_LOG_FIELD_CONDITION_NOT_LOGGING_EVERY_FRAME:
             return blackboxConfig()->rate_num < blackboxConfig()->rate_denom;
@@ -451,6 +516,7 @@ static void blackboxSetState(BlackboxState newState)
         case BLACKBOX_STATE_SEND_GPS_G_HEADER:
         case BLACKBOX_STATE_SEND_GPS_H_HEADER:
         case BLACKBOX_STATE_SEND_SLOW_HEADER:
+        case BLACKBOX_STATE_SEND_FAST_HEADER:
             xmitState.headerIndex = 0;
             xmitState.u.fieldIndex = -1;
         break;
@@ -463,6 +529,9 @@ static void blackboxSetState(BlackboxState newState)
         case BLACKBOX_STATE_SHUTTING_DOWN:
             xmitState.u.startTime = millis();
         break;
+        case BLACKBOX_STATE_SEND_CAPTURE:
+            blackboxHeaderBudget = 0;
+        break;
         default:
             ;
     }
@@ -478,8 +547,10 @@ static void writeIntraframe(void)
     blackboxWriteUnsignedVB(blackboxIteration);
     blackboxWriteUnsignedVB(blackboxCurrent->time);
 
-    blackboxWriteSignedVBArray(blackboxCurrent->axisPID_P, XYZ_AXIS_COUNT);
-    blackboxWriteSignedVBArray(blackboxCurrent->axisPID_I, XYZ_AXIS_COUNT);
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_PID)) {
+        blackboxWriteSignedVBArray(blackboxCurrent->axisPID_P, XYZ_AXIS_COUNT);
+        blackboxWriteSignedVBArray(blackboxCurrent->axisPID_I, XYZ_AXIS_COUNT);
+    }
 
     // Don't bother writing the current D term if the corresponding PID setting is zero
     for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
@@ -488,14 +559,16 @@ static void writeIntraframe(void)
         }
     }
 
-    // Write roll, pitch and yaw first:
-    blackboxWriteSigned16VBArray(blackboxCurrent->rcCommand, 3);
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_RC_COMMANDS)) {
+        // Write roll, pitch and yaw first:
+        blackboxWriteSigned16VBArray(blackboxCurrent->rcCommand, 3);
 
-    /*
-     * Write the throttle separately from the rest of the RC data so we can apply a predictor to it.
-     * Throttle lies in range [minthrottle..maxthrottle]:
-     */
-    blackboxWriteUnsignedVB(blackboxCurrent->rcCommand[THROTTLE] - motorConfig()->minthrottle);
+        /*
+         * Write the throttle separately from the rest of the RC data so we can apply a predictor to it.
+         * Throttle lies in range [minthrottle..maxthrottle]:
+         */
+        blackboxWriteUnsignedVB(blackboxCurrent->rcCommand[THROTTLE] - motorConfig()->minthrottle);
+    }
 
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_VBAT)) {
         /*
@@ -534,17 +607,25 @@ static void writeIntraframe(void)
         blackboxWriteUnsignedVB(blackboxCurrent->rssi);
     }
 
-    blackboxWriteSigned16VBArray(blackboxCurrent->gyroADC, XYZ_AXIS_COUNT);
-    blackboxWriteSigned16VBArray(blackboxCurrent->accSmooth, XYZ_AXIS_COUNT);
-    blackboxWriteSigned16VBArray(blackboxCurrent->debug, 4);
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_GYRO)) {
+        blackboxWriteSigned16VBArray(blackboxCurrent->gyroADC, XYZ_AXIS_COUNT);
+    }
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_ACC)) {
+        blackboxWriteSigned16VBArray(blackboxCurrent->accSmooth, XYZ_AXIS_COUNT);
+    }
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_DEBUG)) {
+        blackboxWriteSigned16VBArray(blackboxCurrent->debug, DEBUG16_VALUE_COUNT);
+    }
 
-    //Motors can be below minimum output when disarmed, but that doesn't happen much
-    blackboxWriteUnsignedVB(blackboxCurrent->motor[0] - motorOutputLow);
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_1)) {
+        //Motors can be below minimum output when disarmed, but that doesn't happen much
+        blackboxWriteUnsignedVB(blackboxCurrent->motor[0] - motorOutputLow);
 
-    //Motors tend to be similar to each other so use the first motor's value as a predictor of the others
-    const int motorCount = getMotorCount();
-    for (int x = 1; x < motorCount; x++) {
-        blackboxWriteSignedVB(blackboxCurrent->motor[x] - blackboxCurrent->motor[0]);
+        //Motors tend to be similar to each other so use the first motor's value as a predictor of the others
+        const int motorCount = getMotorCount();
+        for (int x = 1; x < motorCount; x++) {
+            blackboxWriteSignedVB(blackboxCurrent->motor[x] - blackboxCurrent->motor[0]);
+        }
     }
 
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_TRICOPTER)) {
@@ -596,15 +677,17 @@ static void writeInterframe(void)
      */
     blackboxWriteSignedVB((int32_t) (blackboxHistory[0]->time - 2 * blackboxHistory[1]->time + blackboxHistory[2]->time));
 
-    arraySubInt32(deltas, blackboxCurrent->axisPID_P, blackboxLast->axisPID_P, XYZ_AXIS_COUNT);
-    blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_PID)) {
+        arraySubInt32(deltas, blackboxCurrent->axisPID_P, blackboxLast->axisPID_P, XYZ_AXIS_COUNT);
+        blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
 
-    /*
-     * The PID I field changes very slowly, most of the time +-2, so use an encoding
-     * that can pack all three fields into one byte in that situation.
-     */
-    arraySubInt32(deltas, blackboxCurrent->axisPID_I, blackboxLast->axisPID_I, XYZ_AXIS_COUNT);
-    blackboxWriteTag2_3S32(deltas);
+        /*
+         * The PID I field changes very slowly, most of the time +-2, so use an encoding
+         * that can pack all three fields into one byte in that situation.
+         */
+        arraySubInt32(deltas, blackboxCurrent->axisPID_I, blackboxLast->axisPID_I, XYZ_AXIS_COUNT);
+        blackboxWriteTag2_3S32(deltas);
+    }
 
     /*
      * The PID D term is frequently set to zero for yaw, which makes the result from the calculation
@@ -620,11 +703,13 @@ static void writeInterframe(void)
      * RC tends to stay the same or fairly small for many frames at a time, so use an encoding that
      * can pack multiple values per byte:
      */
-    for (x = 0; x < 4; x++) {
-        deltas[x] = blackboxCurrent->rcCommand[x] - blackboxLast->rcCommand[x];
-    }
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_RC_COMMANDS)) {
+        for (x = 0; x < 4; x++) {
+            deltas[x] = blackboxCurrent->rcCommand[x] - blackboxLast->rcCommand[x];
+        }
 
-    blackboxWriteTag8_4S16(deltas);
+        blackboxWriteTag8_4S16(deltas);
+    }
 
     //Check for sensors that are updated periodically (so deltas are normally zero)
     int optionalFieldCount = 0;
@@ -664,10 +749,18 @@ static void writeInterframe(void)
     blackboxWriteTag8_8SVB(deltas, optionalFieldCount);
 
     //Since gyros, accs and motors are noisy, base their predictions on the average of the history:
-    blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, gyroADC),   XYZ_AXIS_COUNT);
-    blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, accSmooth), XYZ_AXIS_COUNT);
-    blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, debug), 4);
-    blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, motor),     getMotorCount());
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_GYRO)) {
+        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, gyroADC),   XYZ_AXIS_COUNT);
+    }
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_ACC)) {
+        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, accSmooth), XYZ_AXIS_COUNT);
+    }
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_DEBUG)) {
+        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, debug), DEBUG16_VALUE_COUNT);
+    }
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_1)) {
+        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, motor),     getMotorCount());
+    }
 
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_TRICOPTER)) {
         blackboxWriteSignedVB(blackboxCurrent->servo[5] - blackboxLast->servo[5]);
@@ -681,6 +774,64 @@ static void writeInterframe(void)
     blackboxLoggedAnyFrames = true;
 }
 
+static void loadFastState(timeUs_t currentTimeUs)
+{
+    blackboxFastState_t *fastCurrent = blackboxFastHistory[0];
+
+    fastCurrent->time = currentTimeUs;
+
+    for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+        fastCurrent->gyroADC[i] = lrintf(gyro.gyroADCf[i]);
+    }
+
+    const int motorCount = getMotorCount();
+    for (int i = 0; i < motorCount; i++) {
+        fastCurrent->motor[i] = motor[i];
+    }
+}
+
+/*
+ * Advance the fast frame history after any frame has been logged. An I frame restarts it, like the main history, so
+ * a decoder that resynchronises on an I frame can carry on with the next fast frame.
+ */
+static void advanceFastHistory(bool restart)
+{
+    if (restart) {
+        blackboxFastHistory[1] = blackboxFastHistory[0];
+        blackboxFastHistory[2] = blackboxFastHistory[0];
+    } else {
+        blackboxFastHistory[2] = blackboxFastHistory[1];
+        blackboxFastHistory[1] = blackboxFastHistory[0];
+    }
+    blackboxFastHistory[0] = ((blackboxFastHistory[0] - blackboxFastHistoryRing + 1) % 3) + blackboxFastHistoryRing;
+}
+
+static void writeFastFrame(void)
+{
+    const blackboxFastState_t *fastCurrent = blackboxFastHistory[0];
+    const blackboxFastState_t *fastLast = blackboxFastHistory[1];
+    const blackboxFastState_t *fastBeforeLast = blackboxFastHistory[2];
+
+    blackboxWrite('F');
+
+    blackboxWriteSignedVB((int32_t) (fastCurrent->time - 2 * fastLast->time + fastBeforeLast->time));
+
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_LOG_GYRO)) {
+        for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+            blackboxWriteSignedVB(fastCurrent->gyroADC[i] - (fastLast->gyroADC[i] + fastBeforeLast->gyroADC[i]) / 2);
+        }
+    }
+
+    if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_AT_LEAST_MOTORS_1)) {
+        const int motorCount = getMotorCount();
+        for (int i = 0; i < motorCount; i++) {
+            blackboxWriteSignedVB(fastCurrent->motor[i] - (fastLast->motor[i] + fastBeforeLast->motor[i]) / 2);
+        }
+    }
+
+    blackboxLoggedAnyFrames = true;
+}
+
 /* Write the contents of the global "slowHistory" to the log as an "S" frame. Because this data is logged so
  * infrequently, delta updates are not reasonable, so we log independent frames. */
 static void writeSlowFrame(void)
@@ -700,6 +851,8 @@ static void writeSlowFrame(void)
     values[2] = slowHistory.rxFlightChannelsValid ? 1 : 0;
     blackboxWriteTag2_3S32(values);
 
+    blackboxWriteUnsignedVB(slowHistory.gyroOverflowCount);
+
     blackboxSlowFrameIterationTimer = 0;
 }
 
@@ -713,6 +866,7 @@ static void loadSlowState(blackboxSlowState_t *slow)
     slow->failsafePhase = failsafePhase();
     slow->rxSignalReceived = rxIsReceivingSignal();
     slow->rxFlightChannelsValid = rxAreFlightChannelsValid();
+    slow->gyroOverflowCount = gyro.overflowCount;
 }
 
 /**
@@ -790,11 +944,21 @@ static void validateBlackboxConfig()
     }
 }
 
+#ifdef USE_BLACKBOX_CAPTURE
+static bool blackboxStartAfterCapture;  // armed while a crash capture was being written, the log starts behind it
+#endif
+
 /**
  * Start Blackbox logging if it is not already running. Intended to be called upon arming.
  */
 void startBlackbox(void)
 {
+#ifdef USE_BLACKBOX_CAPTURE
+    if (blackboxState == BLACKBOX_STATE_PREPARE_CAPTURE || blackboxState == BLACKBOX_STATE_SEND_CAPTURE) {
+        blackboxStartAfterCapture = true;
+        return;
+    }
+#endif
     if (blackboxState == BLACKBOX_STATE_STOPPED) {
         validateBlackboxConfig();
 
@@ -809,6 +973,10 @@ void startBlackbox(void)
         blackboxHistory[1] = &blackboxHistoryRing[1];
         blackboxHistory[2] = &blackboxHistoryRing[2];
 
+        blackboxFastHistory[0] = &blackboxFastHistoryRing[0];
+        blackboxFastHistory[1] = &blackboxFastHistoryRing[1];
+        blackboxFastHistory[2] = &blackboxFastHistoryRing[2];
+
         vbatReference = vbatLatest;
 
         //No need to clear the content of blackboxHistoryRing since our first frame will be an intra which overwrites it
@@ -843,6 +1011,10 @@ void startBlackbox(void)
  */
 void finishBlackbox(void)
 {
+#ifdef USE_BLACKBOX_CAPTURE
+    blackboxStartAfterCapture = false;
+#endif
+
     switch (blackboxState) {
         case BLACKBOX_STATE_DISABLED:
         case BLACKBOX_STATE_STOPPED:
@@ -850,6 +1022,11 @@ void finishBlackbox(void)
             // We're already stopped/shutting down
         break;
 
+        case BLACKBOX_STATE_PREPARE_CAPTURE:
+        case BLACKBOX_STATE_SEND_CAPTURE:
+            // no flight log is running, the crash capture is written out in full
+        break;
+
         case BLACKBOX_STATE_RUNNING:
         case BLACKBOX_STATE_PAUSED:
             blackboxLogEvent(FLIGHT_LOG_EVENT_LOG_END, NULL);
@@ -998,7 +1175,7 @@ static void loadMainState(timeUs_t currentTimeUs)
         blackboxCurrent->accSmooth[i] = acc.accSmooth[i];
     }
 
-    for (i = 0; i < 4; i++) {
+    for (i = 0; i < DEBUG16_VALUE_COUNT; i++) {
         blackboxCurrent->debug[i] = debug[i];
     }
 
@@ -1177,6 +1354,10 @@ static bool blackboxWriteSysinfo()
         BLACKBOX_PRINT_HEADER_LINE("Firmware date:%s %s",                 buildDate, buildTime);
         BLACKBOX_PRINT_HEADER_LINE("Craft name:%s",                       masterConfig.name);
         BLACKBOX_PRINT_HEADER_LINE("P interval:%d/%d",                    blackboxConfig()->rate_num, blackboxConfig()->rate_denom);
+        BLACKBOX_PRINT_HEADER_LINE("fields_disabled_mask:%d",             blackboxConfig()->fields_disabled_mask);
+#ifdef USE_BLACKBOX_COMPRESSION
+        BLACKBOX_PRINT_HEADER_LINE("compression:%d",                      blackboxConfig()->compression);
+#endif
         BLACKBOX_PRINT_HEADER_LINE("minthrottle:%d",                      motorConfig()->minthrottle);
         BLACKBOX_PRINT_HEADER_LINE("maxthrottle:%d",                      motorConfig()->maxthrottle);
         BLACKBOX_PRINT_HEADER_LINE("gyro_scale:0x%x",                     castFloatBytesToInt(1.0f));
@@ -1247,11 +1428,14 @@ static bool blackboxWriteSysinfo()
                                                                           currentProfile->pidProfile.D8[PIDVEL]);
         BLACKBOX_PRINT_HEADER_LINE("dterm_filter_type:%d",                currentProfile->pidProfile.dterm_filter_type);
         BLACKBOX_PRINT_HEADER_LINE("dterm_lpf_hz:%d",                     currentProfile->pidProfile.dterm_lpf_hz);
+        BLACKBOX_PRINT_HEADER_LINE("dterm_lpf_max_hz:%d",                 currentProfile->pidProfile.dterm_lpf_max_hz);
         BLACKBOX_PRINT_HEADER_LINE("yaw_lpf_hz:%d",                       currentProfile->pidProfile.yaw_lpf_hz);
         BLACKBOX_PRINT_HEADER_LINE("dterm_notch_hz:%d",                   currentProfile->pidProfile.dterm_notch_hz);
         BLACKBOX_PRINT_HEADER_LINE("dterm_notch_cutoff:%d",               currentProfile->pidProfile.dterm_notch_cutoff);
         BLACKBOX_PRINT_HEADER_LINE("rollPitchItermIgnoreRate:%d",         currentProfile->pidProfile.rollPitchItermIgnoreRate);
         BLACKBOX_PRINT_HEADER_LINE("yawItermIgnoreRate:%d",               currentProfile->pidProfile.yawItermIgnoreRate);
+        BLACKBOX_PRINT_HEADER_LINE("itermRelax:%d",                       currentProfile->pidProfile.itermRelax);
+        BLACKBOX_PRINT_HEADER_LINE("itermRelaxCutoff:%d",                 currentProfile->pidProfile.itermRelaxCutoff);
         BLACKBOX_PRINT_HEADER_LINE("yaw_p_limit:%d",                      currentProfile->pidProfile.yaw_p_limit);
         BLACKBOX_PRINT_HEADER_LINE("dterm_average_count:%d",              currentProfile->pidProfile.dterm_average_count);
         BLACKBOX_PRINT_HEADER_LINE("vbat_pid_compensation:%d",            currentProfile->pidProfile.vbatPidCompensation);
@@ -1261,6 +1445,8 @@ static bool blackboxWriteSysinfo()
         BLACKBOX_PRINT_HEADER_LINE("itermThrottleThreshold:%d",           currentProfile->pidProfile.itermThrottleThreshold);
         BLACKBOX_PRINT_HEADER_LINE("setpointRelaxRatio:%d",               currentProfile->pidProfile.setpointRelaxRatio);
         BLACKBOX_PRINT_HEADER_LINE("dtermSetpointWeight:%d",              currentProfile->pidProfile.dtermSetpointWeight);
+        BLACKBOX_PRINT_HEADER_LINE("feedForwardWeight:%d",                currentProfile->pidProfile.feedForwardWeight);
+        BLACKBOX_PRINT_HEADER_LINE("feedForwardLpfHz:%d",                 currentProfile->pidProfile.feedForwardLpfHz);
         BLACKBOX_PRINT_HEADER_LINE("yawRateAccelLimit:%d",                castFloatBytesToInt(currentProfile->pidProfile.yawRateAccelLimit));
         BLACKBOX_PRINT_HEADER_LINE("rateAccelLimit:%d",                   castFloatBytesToInt(currentProfile->pidProfile.rateAccelLimit));
         // End of Betaflight controller parameters
@@ -1334,6 +1520,11 @@ void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data)
             blackboxWriteUnsignedVB(data->loggingResume.logIteration);
             blackboxWriteUnsignedVB(data->loggingResume.currentTime);
         break;
+        case FLIGHT_LOG_EVENT_TASK_RATE_CHANGE:
+            blackboxWrite(data->taskRateChange.taskId);
+            blackboxWriteUnsignedVB(data->taskRateChange.newPeriod);
+            blackboxWriteUnsignedVB(data->taskRateChange.systemLoadPercent);
+        break;
         case FLIGHT_LOG_EVENT_LOG_END:
             blackboxPrint("End of log");
             blackboxWrite(0);
@@ -1413,6 +1604,11 @@ static void blackboxLogIteration(timeUs_t currentTimeUs)
 
         loadMainState(currentTimeUs);
         writeIntraframe();
+
+        if (blackboxConfig()->fast_stream) {
+            loadFastState(currentTimeUs);
+            advanceFastHistory(true);
+        }
     } else {
         blackboxCheckAndLogArmingBeep();
         blackboxCheckAndLogFlightMode(); // Check for FlightMode status change event
@@ -1426,6 +1622,15 @@ static void blackboxLogIteration(timeUs_t currentTimeUs)
 
             loadMainState(currentTimeUs);
             writeInterframe();
+
+            if (blackboxConfig()->fast_stream) {
+                loadFastState(currentTimeUs);
+                advanceFastHistory(false);
+            }
+        } else if (blackboxConfig()->fast_stream) {
+            loadFastState(currentTimeUs);
+            writeFastFrame();
+            advanceFastHistory(false);
         }
 #ifdef GPS
         if (feature(FEATURE_GPS)) {
@@ -1461,11 +1666,39 @@ void handleBlackbox(timeUs_t currentTimeUs)
 {
     int i;
 
-    if (blackboxState >= BLACKBOX_FIRST_HEADER_SENDING_STATE && blackboxState <= BLACKBOX_LAST_HEADER_SENDING_STATE) {
+    if ((blackboxState >= BLACKBOX_FIRST_HEADER_SENDING_STATE && blackboxState <= BLACKBOX_LAST_HEADER_SENDING_STATE)
+        || blackboxState == BLACKBOX_STATE_SEND_CAPTURE) {
         blackboxReplenishHeaderBudget();
     }
 
     switch (blackboxState) {
+        case BLACKBOX_STATE_STOPPED:
+            blackboxDevicePrepareLog();
+#ifdef USE_BLACKBOX_CAPTURE
+            // a frozen crash capture is written once the flight log is closed, as a log of its own
+            if (blackboxCaptureIsPending()) {
+                validateBlackboxConfig();
+                if (blackboxDeviceOpen()) {
+                    blackboxSetState(BLACKBOX_STATE_PREPARE_CAPTURE);
+                }
+            }
+#endif
+        break;
+#ifdef USE_BLACKBOX_CAPTURE
+        case BLACKBOX_STATE_PREPARE_CAPTURE:
+            if (blackboxDeviceBeginLog()) {
+                blackboxCaptureBeginWrite();
+                blackboxSetState(BLACKBOX_STATE_SEND_CAPTURE);
+            }
+        break;
+        case BLACKBOX_STATE_SEND_CAPTURE:
+            // the capture goes out within the header budget, like a log header
+            if (blackboxCaptureWrite()) {
+                blackboxLoggedAnyFrames = true;
+                blackboxSetState(BLACKBOX_STATE_SHUTTING_DOWN);
+            }
+        break;
+#endif
         case BLACKBOX_STATE_PREPARE_LOG_FILE:
             if (blackboxDeviceBeginLog()) {
                 blackboxSetState(BLACKBOX_STATE_SEND_HEADER);
@@ -1523,6 +1756,13 @@ void handleBlackbox(timeUs_t currentTimeUs)
             //On entry of this state, xmitState.headerIndex is 0 and xmitState.u.fieldIndex is -1
             if (!sendFieldDefinition('S', 0, blackboxSlowFields, blackboxSlowFields + 1, ARRAY_LENGTH(blackboxSlowFields),
                     NULL, NULL)) {
+                blackboxSetState(blackboxConfig()->fast_stream ? BLACKBOX_STATE_SEND_FAST_HEADER : BLACKBOX_STATE_SEND_SYSINFO);
+            }
+        break;
+        case BLACKBOX_STATE_SEND_FAST_HEADER:
+            //On entry of this state, xmitState.headerIndex is 0 and xmitState.u.fieldIndex is -1
+            if (!sendFieldDefinition('F', 0, blackboxFastFields, blackboxFastFields + 1, ARRAY_LENGTH(blackboxFastFields),
+                    &blackboxFastFields[0].condition, &blackboxFastFields[1].condition)) {
                 blackboxSetState(BLACKBOX_STATE_SEND_SYSINFO);
             }
         break;
@@ -1538,6 +1778,10 @@ void handleBlackbox(timeUs_t currentTimeUs)
                  * could wipe out the end of the header if we weren't careful)
                  */
                 if (blackboxDeviceFlushForce()) {
+#ifdef USE_BLACKBOX_COMPRESSION
+                    // Everything after the header is compressed, the ring is empty here so the switch is clean
+                    blackboxDeviceSetCompression(blackboxConfig()->compression);
+#endif
                     blackboxSetState(BLACKBOX_STATE_RUNNING);
                 }
             }
@@ -1554,7 +1798,9 @@ void handleBlackbox(timeUs_t currentTimeUs)
                 blackboxLogEvent(FLIGHT_LOG_EVENT_LOGGING_RESUME, (flightLogEventData_t *) &resume);
                 blackboxSetState(BLACKBOX_STATE_RUNNING);
 
+                PROFILE_BEGIN(PROFILE_BLACKBOX);
                 blackboxLogIteration(currentTimeUs);
+                PROFILE_END(PROFILE_BLACKBOX);
             }
 
             // Keep the logging timers ticking so our log iteration continues to advance
@@ -1566,7 +1812,9 @@ void handleBlackbox(timeUs_t currentTimeUs)
             if (blackboxModeActivationConditionPresent && !IS_RC_MODE_ACTIVE(BOXBLACKBOX) && !startedLoggingInTestMode) {
                 blackboxSetState(BLACKBOX_STATE_PAUSED);
             } else {
+                PROFILE_BEGIN(PROFILE_BLACKBOX);
                 blackboxLogIteration(currentTimeUs);
+                PROFILE_END(PROFILE_BLACKBOX);
             }
 
             blackboxAdvanceIterationTimers();
@@ -1583,6 +1831,12 @@ void handleBlackbox(timeUs_t currentTimeUs)
             if (blackboxDeviceEndLog(blackboxLoggedAnyFrames) && (millis() > xmitState.u.startTime + BLACKBOX_SHUTDOWN_TIMEOUT_MILLIS || blackboxDeviceFlushForce())) {
                 blackboxDeviceClose();
                 blackboxSetState(BLACKBOX_STATE_STOPPED);
+#ifdef USE_BLACKBOX_CAPTURE
+                if (blackboxStartAfterCapture) {
+                    blackboxStartAfterCapture = false;
+                    startBlackbox();
+                }
+#endif
             }
         break;
         default:
@@ -1592,6 +1846,9 @@ void handleBlackbox(timeUs_t currentTimeUs)
     // Did we run out of room on the device? Stop!
     if (isBlackboxDeviceFull()) {
         blackboxSetState(BLACKBOX_STATE_STOPPED);
+#ifdef USE_BLACKBOX_CAPTURE
+        blackboxCaptureDiscard();
+#endif
         // ensure we reset the test mode flag if we stop due to full memory card
         if (startedLoggingInTestMode) startedLoggingInTestMode = false;
     } else { // Only log in test mode if there is room!
@@ -1624,5 +1881,8 @@ void initBlackbox(void)
     } else {
         blackboxSetState(BLACKBOX_STATE_DISABLED);
     }
+#ifdef USE_BLACKBOX_CAPTURE
+    blackboxCaptureInit();
+#endif
 }
 #endif
@@ -21,11 +21,35 @@
 
 #include "common/time.h"
 
+// Groups of main frame fields that can be left out of the log, bit positions in blackboxConfig_t.fields_disabled_mask
+typedef enum {
+    BLACKBOX_FIELD_GROUP_PID = 0,
+    BLACKBOX_FIELD_GROUP_RC_COMMANDS,
+    BLACKBOX_FIELD_GROUP_BATTERY,
+    BLACKBOX_FIELD_GROUP_MAG,
+    BLACKBOX_FIELD_GROUP_ALTITUDE,
+    BLACKBOX_FIELD_GROUP_RSSI,
+    BLACKBOX_FIELD_GROUP_GYRO,
+    BLACKBOX_FIELD_GROUP_ACC,
+    BLACKBOX_FIELD_GROUP_DEBUG,
+    BLACKBOX_FIELD_GROUP_MOTOR,
+    BLACKBOX_FIELD_GROUP_COUNT
+} blackboxFieldGroup_e;
+
+#define BLACKBOX_FIELD_GROUP_ALL_MASK ((1 << BLACKBOX_FIELD_GROUP_COUNT) - 1)
+
 typedef struct blackboxConfig_s {
     uint8_t rate_num;
     uint8_t rate_denom;
     uint8_t device;
     uint8_t on_motor_test;
+    uint16_t fields_disabled_mask; // 1 << blackboxFieldGroup_e for each group to leave out, 0 logs everything
+    uint8_t fast_stream;           // log gyro and motors in F frames on the loop iterations that skip the main frame
+    uint8_t compression;           // Huffman code the frame data in blocks, see blackbox_compress.h
+    uint8_t flash_ring;            // wrap around to overwrite the oldest flash data instead of stopping when full
+    uint8_t capture;               // keep the last PID updates in RAM and log them when a crash, failsafe or switch triggers
+    uint16_t capture_crash_rate;   // deg/s of gyro rate, while armed, taken as a crash, 0 leaves only failsafe and the switch
+    uint8_t serial_flow_control;   // a serial logger paces the log with the CTS line, so it needn't be slowed down for it
 } blackboxConfig_t;
 
 void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data);
@@ -0,0 +1,296 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Crash capture: the gyro, setpoints, PID sums and motor outputs of every PID update are kept in a RAM ring, one
+ * int16 array per value. When triggered the ring records a quarter of its length more and is then frozen, and once
+ * the blackbox has stopped logging it is written to the blackbox device as a log of its own, I frames only, which
+ * the usual tools decode. Recording resumes when the write completes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "platform.h"
+
+#ifdef USE_BLACKBOX_CAPTURE
+
+#include "blackbox/blackbox.h"
+#include "blackbox/blackbox_capture.h"
+#include "blackbox/blackbox_fielddefs.h"
+#include "blackbox/blackbox_io.h"
+
+#include "build/build_config.h"
+
+#include "common/axis.h"
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/system.h"
+
+#include "fc/fc_main.h"
+#include "fc/rc_controls.h"
+#include "fc/runtime_config.h"
+
+#include "flight/mixer.h"
+#include "flight/pid.h"
+
+#include "sensors/gyro.h"
+
+#include "config/config_master.h"
+#include "config/feature.h"
+
+#define CAPTURE_MOTOR_COUNT         4
+#define CAPTURE_POST_TRIGGER        (BLACKBOX_CAPTURE_SAMPLES / 4)
+#define CAPTURE_FRAME_MAX_BYTES     (1 + 2 * 5 + (3 * XYZ_AXIS_COUNT + CAPTURE_MOTOR_COUNT) * 3)
+#define CAPTURE_HEADER_LINE_MAX     192     // the field name line is the longest
+
+typedef enum {
+    CAPTURE_DISABLED = 0,
+    CAPTURE_RECORDING,
+    CAPTURE_POST_TRIGGER_RECORDING,
+    CAPTURE_PENDING,                        // frozen until the blackbox device is free
+    CAPTURE_WRITING
+} captureState_e;
+
+typedef struct captureRing_s {
+    uint16_t time[BLACKBOX_CAPTURE_SAMPLES];    // low 16 bits of micros()
+    int16_t gyro[XYZ_AXIS_COUNT][BLACKBOX_CAPTURE_SAMPLES];
+    int16_t setpoint[XYZ_AXIS_COUNT][BLACKBOX_CAPTURE_SAMPLES];
+    int16_t pidSum[XYZ_AXIS_COUNT][BLACKBOX_CAPTURE_SAMPLES];
+    int16_t motor[CAPTURE_MOTOR_COUNT][BLACKBOX_CAPTURE_SAMPLES];
+} captureRing_t;
+
+extern uint16_t motorOutputHigh, motorOutputLow;
+
+static captureRing_t captureRing;
+static volatile captureState_e captureState;
+static volatile blackboxCaptureTrigger_e captureTrigger;
+static uint16_t captureHead;                // next sample to be written
+static uint16_t captureCount;
+static uint16_t capturePostTriggerRemaining;
+static timeUs_t captureLatestTimeUs;
+static bool captureSwitchWasOn;
+
+// position of the write that follows the freeze, through the header lines and then the samples
+static struct {
+    uint8_t headerIndex;
+    uint16_t sampleIndex;
+    timeUs_t timeUs;
+} captureXmit;
+
+static const char * const captureHeaderLines[] = {
+    "Product:Blackbox flight data recorder by Nicholas Sherlock",
+    "Data version:2",
+    "I interval:1",
+    "P interval:1/1",
+    "Firmware type:Cleanflight",
+    "Field I name:loopIteration,time,gyroADC[0],gyroADC[1],gyroADC[2],setpoint[0],setpoint[1],setpoint[2],"
+        "axisSum[0],axisSum[1],axisSum[2],motor[0],motor[1],motor[2],motor[3]",
+    "Field I signed:0,0,1,1,1,1,1,1,1,1,1,1,1,1,1",
+    "Field I predictor:0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+    "Field I encoding:1,1,0,0,0,0,0,0,0,0,0,0,0,0,0",
+    "Field P predictor:0,0,0,0,0,0,0,0,0,0,0,0,0,0,0",
+    "Field P encoding:1,1,0,0,0,0,0,0,0,0,0,0,0,0,0",
+    "gyro_scale:0x3f800000",
+};
+
+// header lines that follow the fixed ones, numbered on from them
+typedef enum {
+    CAPTURE_HEADER_LOOPTIME = ARRAYLEN(captureHeaderLines),
+    CAPTURE_HEADER_MOTOR_OUTPUT,
+    CAPTURE_HEADER_TRIGGER,
+    CAPTURE_HEADER_COUNT
+} captureHeaderLine_e;
+
+static int16_t captureInt16(float value)
+{
+    return constrain(lrintf(value), INT16_MIN, INT16_MAX);
+}
+
+void blackboxCaptureInit(void)
+{
+    captureState = feature(FEATURE_BLACKBOX) && blackboxConfig()->capture ? CAPTURE_RECORDING : CAPTURE_DISABLED;
+}
+
+void blackboxCaptureTrigger(blackboxCaptureTrigger_e trigger)
+{
+    if (captureState == CAPTURE_RECORDING) {
+        captureTrigger = trigger;
+        capturePostTriggerRemaining = CAPTURE_POST_TRIGGER;
+        captureState = CAPTURE_POST_TRIGGER_RECORDING;
+    }
+}
+
+// Called after each PID update, once its motor outputs are written
+void blackboxCaptureSample(void)
+{
+    if (captureState != CAPTURE_RECORDING && captureState != CAPTURE_POST_TRIGGER_RECORDING) {
+        return;
+    }
+
+    const unsigned i = captureHead;
+    captureLatestTimeUs = micros();
+    captureRing.time[i] = captureLatestTimeUs;
+
+    bool crashed = false;
+    const uint16_t crashRate = blackboxConfig()->capture_crash_rate;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        captureRing.gyro[axis][i] = captureInt16(gyro.gyroADCf[axis]);
+        captureRing.setpoint[axis][i] = captureInt16(getSetpointRate(axis));
+        captureRing.pidSum[axis][i] = captureInt16(axisPIDf[axis]);
+        if (crashRate && ABS(captureRing.gyro[axis][i]) > crashRate) {
+            crashed = true;
+        }
+    }
+    for (int motorIndex = 0; motorIndex < CAPTURE_MOTOR_COUNT; motorIndex++) {
+        captureRing.motor[motorIndex][i] = motor[motorIndex];
+    }
+
+    captureHead = (i + 1) % BLACKBOX_CAPTURE_SAMPLES;
+    if (captureCount < BLACKBOX_CAPTURE_SAMPLES) {
+        captureCount++;
+    }
+
+    if (captureState == CAPTURE_POST_TRIGGER_RECORDING) {
+        if (--capturePostTriggerRemaining == 0) {
+            captureState = CAPTURE_PENDING;
+        }
+        return;
+    }
+
+    const bool switchOn = IS_RC_MODE_ACTIVE(BOXCAPTURE);
+    if (switchOn && !captureSwitchWasOn) {
+        blackboxCaptureTrigger(BLACKBOX_CAPTURE_TRIGGER_SWITCH);
+    } else if (crashed && ARMING_FLAG(ARMED)) {
+        blackboxCaptureTrigger(BLACKBOX_CAPTURE_TRIGGER_CRASH);
+    }
+    captureSwitchWasOn = switchOn;
+}
+
+bool blackboxCaptureIsPending(void)
+{
+    return captureState == CAPTURE_PENDING;
+}
+
+// Starts the write of the frozen ring, the blackbox device holds a log opened for it
+void blackboxCaptureBeginWrite(void)
+{
+    captureState = CAPTURE_WRITING;
+    captureXmit.headerIndex = 0;
+    captureXmit.sampleIndex = 0;
+
+    // the samples only hold the low bits of the time, the oldest one is found back from the latest
+    const unsigned oldest = (captureHead + BLACKBOX_CAPTURE_SAMPLES - captureCount) % BLACKBOX_CAPTURE_SAMPLES;
+    uint32_t span = 0;
+    for (unsigned n = 1; n < captureCount; n++) {
+        const unsigned i = (oldest + n) % BLACKBOX_CAPTURE_SAMPLES;
+        span += (uint16_t)(captureRing.time[i] - captureRing.time[(i + BLACKBOX_CAPTURE_SAMPLES - 1) % BLACKBOX_CAPTURE_SAMPLES]);
+    }
+    captureXmit.timeUs = captureLatestTimeUs - span;
+}
+
+static void captureWriteHeaderLine(int index)
+{
+    switch (index) {
+    case CAPTURE_HEADER_LOOPTIME:
+        blackboxPrintfHeaderLine("looptime:%d", gyro.targetLooptime);
+        break;
+    case CAPTURE_HEADER_MOTOR_OUTPUT:
+        blackboxPrintfHeaderLine("motorOutput:%d,%d", motorOutputLow, motorOutputHigh);
+        break;
+    case CAPTURE_HEADER_TRIGGER:
+        blackboxPrintfHeaderLine("capture_trigger:%d", captureTrigger);
+        break;
+    default:
+        blackboxPrintfHeaderLine("%s", captureHeaderLines[index]);
+        break;
+    }
+}
+
+static void captureWriteFrame(unsigned sampleIndex)
+{
+    const unsigned oldest = (captureHead + BLACKBOX_CAPTURE_SAMPLES - captureCount) % BLACKBOX_CAPTURE_SAMPLES;
+    const unsigned i = (oldest + sampleIndex) % BLACKBOX_CAPTURE_SAMPLES;
+
+    if (sampleIndex) {
+        captureXmit.timeUs += (uint16_t)(captureRing.time[i] - captureRing.time[(i + BLACKBOX_CAPTURE_SAMPLES - 1) % BLACKBOX_CAPTURE_SAMPLES]);
+    }
+
+    blackboxWrite('I');
+    blackboxWriteUnsignedVB(sampleIndex);
+    blackboxWriteUnsignedVB(captureXmit.timeUs);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        blackboxWriteSignedVB(captureRing.gyro[axis][i]);
+    }
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        blackboxWriteSignedVB(captureRing.setpoint[axis][i]);
+    }
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        blackboxWriteSignedVB(captureRing.pidSum[axis][i]);
+    }
+    for (int motorIndex = 0; motorIndex < CAPTURE_MOTOR_COUNT; motorIndex++) {
+        blackboxWriteSignedVB(captureRing.motor[motorIndex][i]);
+    }
+}
+
+/*
+ * Writes the next part of the capture within the header budget, so it trickles out like a log header does. Returns
+ * true once all of it, and the log end event, has been written, the ring then starts recording again.
+ */
+bool blackboxCaptureWrite(void)
+{
+    while (captureXmit.headerIndex < CAPTURE_HEADER_COUNT) {
+        if (blackboxDeviceReserveBufferSpace(CAPTURE_HEADER_LINE_MAX) != BLACKBOX_RESERVE_SUCCESS) {
+            return false;
+        }
+        captureWriteHeaderLine(captureXmit.headerIndex++);
+    }
+
+    while (captureXmit.sampleIndex < captureCount) {
+        if (blackboxDeviceReserveBufferSpace(CAPTURE_FRAME_MAX_BYTES) != BLACKBOX_RESERVE_SUCCESS) {
+            return false;
+        }
+        captureWriteFrame(captureXmit.sampleIndex++);
+        blackboxHeaderBudget -= CAPTURE_FRAME_MAX_BYTES;
+    }
+
+    if (blackboxDeviceReserveBufferSpace(16) != BLACKBOX_RESERVE_SUCCESS) {
+        return false;
+    }
+    blackboxWrite('E');
+    blackboxWrite(FLIGHT_LOG_EVENT_LOG_END);
+    blackboxPrint("End of log");
+    blackboxWrite(0);
+
+    blackboxCaptureDiscard();
+    return true;
+}
+
+// Drops a frozen capture, written or not, and records afresh
+void blackboxCaptureDiscard(void)
+{
+    if (captureState == CAPTURE_PENDING || captureState == CAPTURE_WRITING) {
+        captureCount = 0;
+        captureHead = 0;
+        captureTrigger = BLACKBOX_CAPTURE_TRIGGER_NONE;
+        captureState = CAPTURE_RECORDING;
+    }
+}
+
+#endif
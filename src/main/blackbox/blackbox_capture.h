@@ -0,0 +1,34 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+typedef enum {
+    BLACKBOX_CAPTURE_TRIGGER_NONE = 0,
+    BLACKBOX_CAPTURE_TRIGGER_SWITCH,        // the CRASH CAPTURE mode was switched on
+    BLACKBOX_CAPTURE_TRIGGER_CRASH,         // a gyro rate above blackbox_capture_crash_rate while armed
+    BLACKBOX_CAPTURE_TRIGGER_FAILSAFE       // failsafe disarmed the craft
+} blackboxCaptureTrigger_e;
+
+void blackboxCaptureInit(void);
+void blackboxCaptureSample(void);
+void blackboxCaptureTrigger(blackboxCaptureTrigger_e trigger);
+
+bool blackboxCaptureIsPending(void);
+void blackboxCaptureBeginWrite(void);
+bool blackboxCaptureWrite(void);
+void blackboxCaptureDiscard(void);
@@ -0,0 +1,319 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "blackbox_compress.h"
+
+#define SYMBOL_COUNT    256
+#define BITMAP_SIZE     (SYMBOL_COUNT / 8)
+
+// Scratch space for building the code, kept off the stack since the compression task's stack is small
+static uint32_t nodeFreq[2 * SYMBOL_COUNT - 1];
+static uint16_t nodeParent[2 * SYMBOL_COUNT - 1];
+static uint8_t nodeDepth[2 * SYMBOL_COUNT - 1];
+static uint8_t sortedSymbols[SYMBOL_COUNT];
+
+/*
+ * Build Huffman code lengths for the symbols with a non-zero frequency, using the two queue method over the leaves
+ * sorted by frequency. If a code would be longer than the 4 bits we store a length in can describe, the frequencies
+ * are flattened and the code rebuilt. Returns the number of symbols present.
+ */
+static int buildCodeLengths(const uint32_t *freq, uint8_t *lengths)
+{
+    int symbolCount = 0;
+
+    memset(lengths, 0, SYMBOL_COUNT);
+
+    // Insertion sort of the present symbols by frequency, ties keep byte value order
+    for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        if (freq[symbol] == 0) {
+            continue;
+        }
+        int i = symbolCount++;
+        while (i > 0 && freq[sortedSymbols[i - 1]] > freq[symbol]) {
+            sortedSymbols[i] = sortedSymbols[i - 1];
+            i--;
+        }
+        sortedSymbols[i] = symbol;
+    }
+
+    if (symbolCount == 1) {
+        lengths[sortedSymbols[0]] = 1;
+        return symbolCount;
+    }
+
+    for (int i = 0; i < symbolCount; i++) {
+        nodeFreq[i] = freq[sortedSymbols[i]];
+    }
+
+    for (;;) {
+        // Internal nodes are created in non-decreasing frequency order, so they form the second queue
+        int leaf = 0;
+        int internal = symbolCount;
+        const int rootNode = 2 * symbolCount - 2;
+
+        for (int node = symbolCount; node <= rootNode; node++) {
+            int child[2];
+
+            for (int c = 0; c < 2; c++) {
+                if (leaf < symbolCount && (internal >= node || nodeFreq[leaf] <= nodeFreq[internal])) {
+                    child[c] = leaf++;
+                } else {
+                    child[c] = internal++;
+                }
+            }
+            nodeFreq[node] = nodeFreq[child[0]] + nodeFreq[child[1]];
+            nodeParent[child[0]] = node;
+            nodeParent[child[1]] = node;
+        }
+
+        // Parents always have higher indices than their children
+        int maxDepth = 0;
+        nodeDepth[rootNode] = 0;
+        for (int node = rootNode - 1; node >= 0; node--) {
+            nodeDepth[node] = nodeDepth[nodeParent[node]] + 1;
+            if (node < symbolCount && nodeDepth[node] > maxDepth) {
+                maxDepth = nodeDepth[node];
+            }
+        }
+
+        if (maxDepth <= BLACKBOX_COMPRESS_MAX_CODE_LENGTH) {
+            break;
+        }
+
+        // Halving the frequencies keeps their order, so the leaves stay sorted
+        for (int i = 0; i < symbolCount; i++) {
+            nodeFreq[i] = (nodeFreq[i] >> 1) | 1;
+        }
+    }
+
+    for (int i = 0; i < symbolCount; i++) {
+        lengths[sortedSymbols[i]] = nodeDepth[i];
+    }
+
+    return symbolCount;
+}
+
+static void writeU16(uint8_t *dst, uint16_t value)
+{
+    dst[0] = value;
+    dst[1] = value >> 8;
+}
+
+static uint16_t readU16(const uint8_t *src)
+{
+    return src[0] | (src[1] << 8);
+}
+
+/*
+ * Compress `len` bytes (1..BLACKBOX_COMPRESS_BLOCK_SIZE) from `src` into `dst`, which must have room for
+ * BLACKBOX_COMPRESSED_BLOCK_MAX_SIZE(len) bytes. Returns the size of the block written.
+ */
+int blackboxCompressBlock(const uint8_t *src, int len, uint8_t *dst)
+{
+    uint32_t freq[SYMBOL_COUNT];
+    uint8_t lengths[SYMBOL_COUNT];
+    uint16_t codes[SYMBOL_COUNT];
+
+    memset(freq, 0, sizeof(freq));
+    for (int i = 0; i < len; i++) {
+        freq[src[i]]++;
+    }
+
+    const int symbolCount = buildCodeLengths(freq, lengths);
+
+    uint32_t codedBits = 0;
+    for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        codedBits += freq[symbol] * lengths[symbol];
+    }
+
+    const int tableSize = BITMAP_SIZE + (symbolCount + 1) / 2;
+    const int payloadSize = tableSize + (codedBits + 7) / 8;
+
+    writeU16(dst, len);
+
+    if (payloadSize >= len) {
+        writeU16(dst + 2, len | BLACKBOX_COMPRESS_STORED);
+        memcpy(dst + BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE, src, len);
+        return BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE + len;
+    }
+
+    writeU16(dst + 2, payloadSize);
+
+    uint8_t *out = dst + BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE;
+
+    // Bitmap and code lengths
+    memset(out, 0, tableSize);
+    uint8_t *lengthOut = out + BITMAP_SIZE;
+    int lengthIndex = 0;
+    for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        if (lengths[symbol]) {
+            out[symbol / 8] |= 1 << (symbol % 8);
+            lengthOut[lengthIndex / 2] |= lengths[symbol] << ((lengthIndex % 2) * 4);
+            lengthIndex++;
+        }
+    }
+    out += tableSize;
+
+    // Canonical code assignment
+    uint16_t lengthCount[BLACKBOX_COMPRESS_MAX_CODE_LENGTH + 1];
+    uint16_t nextCode[BLACKBOX_COMPRESS_MAX_CODE_LENGTH + 1];
+
+    memset(lengthCount, 0, sizeof(lengthCount));
+    for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        lengthCount[lengths[symbol]]++;
+    }
+    lengthCount[0] = 0;
+
+    uint16_t code = 0;
+    for (int bits = 1; bits <= BLACKBOX_COMPRESS_MAX_CODE_LENGTH; bits++) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+    for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        if (lengths[symbol]) {
+            codes[symbol] = nextCode[lengths[symbol]]++;
+        }
+    }
+
+    // At most 7 bits are left over between symbols, so a 15 bit code never overflows the accumulator
+    uint32_t accumulator = 0;
+    int accumulatorBits = 0;
+
+    for (int i = 0; i < len; i++) {
+        const uint8_t symbol = src[i];
+
+        accumulator = (accumulator << lengths[symbol]) | codes[symbol];
+        accumulatorBits += lengths[symbol];
+
+        while (accumulatorBits >= 8) {
+            accumulatorBits -= 8;
+            *out++ = accumulator >> accumulatorBits;
+        }
+    }
+    if (accumulatorBits) {
+        *out++ = accumulator << (8 - accumulatorBits);
+    }
+
+    return BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE + payloadSize;
+}
+
+/*
+ * Decode one block from `src` into `dst`. Sets `consumed` to the size of the block in `src` and returns the number
+ * of bytes decoded, or -1 if the block is truncated, corrupt, or doesn't fit in `dstSize`.
+ */
+int blackboxDecompressBlock(const uint8_t *src, int srcLen, uint8_t *dst, int dstSize, int *consumed)
+{
+    if (srcLen < BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE) {
+        return -1;
+    }
+
+    const int len = readU16(src);
+    const uint16_t payloadField = readU16(src + 2);
+    const int payloadSize = payloadField & ~BLACKBOX_COMPRESS_STORED;
+
+    if (len == 0 || len > dstSize || BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE + payloadSize > srcLen) {
+        return -1;
+    }
+
+    const uint8_t *in = src + BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE;
+    const uint8_t *end = in + payloadSize;
+
+    *consumed = BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE + payloadSize;
+
+    if (payloadField & BLACKBOX_COMPRESS_STORED) {
+        if (payloadSize != len) {
+            return -1;
+        }
+        memcpy(dst, in, len);
+        return len;
+    }
+
+    if (payloadSize < BITMAP_SIZE) {
+        return -1;
+    }
+
+    uint8_t symbols[SYMBOL_COUNT];
+    uint8_t lengths[SYMBOL_COUNT];
+    int symbolCount = 0;
+
+    for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++) {
+        if (in[symbol / 8] & (1 << (symbol % 8))) {
+            symbols[symbolCount++] = symbol;
+        }
+    }
+
+    const uint8_t *lengthIn = in + BITMAP_SIZE;
+    in = lengthIn + (symbolCount + 1) / 2;
+    if (symbolCount == 0 || in > end) {
+        return -1;
+    }
+
+    // Symbols ordered by code length then value, with the number of codes of each length
+    uint16_t lengthCount[BLACKBOX_COMPRESS_MAX_CODE_LENGTH + 1];
+    uint8_t canonicalSymbols[SYMBOL_COUNT];
+    int canonicalCount = 0;
+
+    memset(lengthCount, 0, sizeof(lengthCount));
+    for (int i = 0; i < symbolCount; i++) {
+        lengths[i] = (lengthIn[i / 2] >> ((i % 2) * 4)) & 0x0F;
+        if (lengths[i] == 0) {
+            return -1;
+        }
+        lengthCount[lengths[i]]++;
+    }
+    for (int bits = 1; bits <= BLACKBOX_COMPRESS_MAX_CODE_LENGTH; bits++) {
+        for (int i = 0; i < symbolCount; i++) {
+            if (lengths[i] == bits) {
+                canonicalSymbols[canonicalCount++] = symbols[i];
+            }
+        }
+    }
+
+    int bitPos = 0;
+    for (int decoded = 0; decoded < len; decoded++) {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        int bits;
+
+        for (bits = 1; bits <= BLACKBOX_COMPRESS_MAX_CODE_LENGTH; bits++) {
+            if (in + bitPos / 8 >= end) {
+                return -1;
+            }
+            code |= (in[bitPos / 8] >> (7 - bitPos % 8)) & 1;
+            bitPos++;
+
+            const int count = lengthCount[bits];
+            if (code - first < count) {
+                dst[decoded] = canonicalSymbols[index + code - first];
+                break;
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+
+        if (bits > BLACKBOX_COMPRESS_MAX_CODE_LENGTH) {
+            return -1;
+        }
+    }
+
+    return len;
+}
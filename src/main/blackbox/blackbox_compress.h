@@ -0,0 +1,45 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Block compression of the encoded blackbox frame stream.
+ *
+ * Each block is coded with its own canonical Huffman code over byte values, so the code follows whatever the fields
+ * in that stretch of the log look like (mostly small zig-zagged deltas in flight, long runs of repeats on the bench).
+ * A block is laid out as:
+ *
+ *   uint16 LE  decoded length, 1..BLACKBOX_COMPRESS_BLOCK_SIZE
+ *   uint16 LE  payload length, with BLACKBOX_COMPRESS_STORED set if the payload is the block stored verbatim
+ *   payload    32 byte bitmap of the byte values present (bit n % 8 of byte n / 8), then a 4 bit code length for each
+ *              present value in order, low nibble first, then the codes MSB first, zero padded to a whole byte
+ *
+ * Codes are assigned canonically: shorter codes first, ties broken by byte value.
+ */
+#define BLACKBOX_COMPRESS_BLOCK_SIZE        2048
+#define BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE 4
+#define BLACKBOX_COMPRESS_STORED            0x8000
+#define BLACKBOX_COMPRESS_MAX_CODE_LENGTH   15
+
+// Space needed to compress a block of the given length, a block that doesn't compress is stored as it is
+#define BLACKBOX_COMPRESSED_BLOCK_MAX_SIZE(len) (BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE + (len))
+
+int blackboxCompressBlock(const uint8_t *src, int len, uint8_t *dst);
+int blackboxDecompressBlock(const uint8_t *src, int srcLen, uint8_t *dst, int dstSize, int *consumed);
@@ -0,0 +1,209 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+
+#include "blackbox_encoding.h"
+
+#include "common/encoding.h"
+
+/*
+ * The encoders below produce exactly the same bytes as the original one-byte-at-a-time writers, they just build
+ * their output in registers and store it straight into the destination buffer rather than going through a
+ * per-byte put with its own bounds check.
+ */
+
+uint8_t *blackboxEncodeUnsignedVB(uint8_t *dst, uint32_t value)
+{
+    //While this isn't the final byte (we can only write 7 bits at a time)
+    while (value > 127) {
+        *dst++ = (uint8_t)(value | 0x80); // Set the high bit to mean "more bytes follow"
+        value >>= 7;
+    }
+    *dst++ = value;
+
+    return dst;
+}
+
+uint8_t *blackboxEncodeSignedVB(uint8_t *dst, int32_t value)
+{
+    //ZigZag encode to make the value always positive
+    return blackboxEncodeUnsignedVB(dst, zigzagEncode(value));
+}
+
+/*
+ * Number of bits above the sign bit that a value needs, as a mask: a value fits in a signed n-bit field exactly when
+ * the result is below 2^(n-1). Masks of several values can be ORed together to test them all at once.
+ */
+static inline uint32_t signedMagnitude(int32_t value)
+{
+    return (uint32_t)(value ^ (value >> 31));
+}
+
+/**
+ * Encode a 2 bit tag followed by 3 signed fields of 2, 4, 6 or 32 bits
+ *
+ * Selector possibilities
+ *
+ * 2 bits per field  ss11 2233,
+ * 4 bits per field  ss00 1111 2222 3333
+ * 6 bits per field  ss11 1111 0022 2222 0033 3333
+ * 32 bits per field sstt tttt followed by fields of various byte counts
+ */
+uint8_t *blackboxEncodeTag2_3S32(uint8_t *dst, const int32_t *values)
+{
+    enum {
+        BITS_2  = 0,
+        BITS_4  = 1,
+        BITS_6  = 2,
+        BITS_32 = 3
+    };
+
+    const uint32_t magnitude = signedMagnitude(values[0]) | signedMagnitude(values[1]) | signedMagnitude(values[2]);
+
+    if (magnitude < 2) {
+        *dst++ = (BITS_2 << 6) | ((values[0] & 0x03) << 4) | ((values[1] & 0x03) << 2) | (values[2] & 0x03);
+    } else if (magnitude < 8) {
+        *dst++ = (BITS_4 << 6) | (values[0] & 0x0F);
+        *dst++ = (values[1] << 4) | (values[2] & 0x0F);
+    } else if (magnitude < 32) {
+        *dst++ = (BITS_6 << 6) | (values[0] & 0x3F);
+        *dst++ = (uint8_t)values[1];
+        *dst++ = (uint8_t)values[2];
+    } else {
+        /*
+         * Pick a byte count for each field, 1 to 4 bytes, the first field's selector goes in the low bits.
+         * Each field is stored as a full little-endian word and the pointer only advanced by its byte count, which
+         * keeps the loop free of branches; the worst case buffer size leaves room for the overhang of the last one.
+         */
+        uint8_t *selectorByte = dst++;
+        uint8_t selector2 = 0;
+
+        for (int x = 0; x < 3; x++) {
+            const uint32_t fieldMagnitude = signedMagnitude(values[x]);
+            const int byteCount = 1 + (fieldMagnitude >= 0x80) + (fieldMagnitude >= 0x8000) + (fieldMagnitude >= 0x800000);
+            const uint32_t value = values[x];
+
+            dst[0] = value;
+            dst[1] = value >> 8;
+            dst[2] = value >> 16;
+            dst[3] = value >> 24;
+            dst += byteCount;
+
+            selector2 |= (byteCount - 1) << (x * 2);
+        }
+
+        *selectorByte = (BITS_32 << 6) | selector2;
+    }
+
+    return dst;
+}
+
+/**
+ * Encode an 8-bit selector followed by four signed fields of size 0, 4, 8 or 16 bits.
+ *
+ * The fields form a stream of nibbles, high nibble first, padded to a whole byte at the end.
+ */
+uint8_t *blackboxEncodeTag8_4S16(uint8_t *dst, const int32_t *values)
+{
+    enum {
+        FIELD_ZERO  = 0,
+        FIELD_4BIT  = 1,
+        FIELD_8BIT  = 2,
+        FIELD_16BIT = 3
+    };
+
+    uint8_t fieldBits[4];
+    uint8_t selector = 0;
+
+    for (int x = 0; x < 4; x++) {
+        const uint32_t magnitude = signedMagnitude(values[x]);
+        int field;
+
+        if (values[x] == 0) {
+            field = FIELD_ZERO;
+        } else if (magnitude < 8) {
+            field = FIELD_4BIT;
+        } else if (magnitude < 128) {
+            field = FIELD_8BIT;
+        } else {
+            field = FIELD_16BIT;
+        }
+
+        // 0, 4, 8 or 16 bits of payload
+        fieldBits[x] = (1 << field) >> 1 << 2;
+        selector |= field << (x * 2);
+    }
+
+    *dst++ = selector;
+
+    // At most 7 bits are left over between fields, so a 16 bit field never overflows the accumulator
+    uint32_t accumulator = 0;
+    int accumulatorBits = 0;
+
+    for (int x = 0; x < 4; x++) {
+        const int bits = fieldBits[x];
+
+        accumulator = (accumulator << bits) | ((uint32_t)values[x] & ((1 << bits) - 1));
+        accumulatorBits += bits;
+
+        while (accumulatorBits >= 8) {
+            accumulatorBits -= 8;
+            *dst++ = accumulator >> accumulatorBits;
+        }
+    }
+
+    //Anything left over to write?
+    if (accumulatorBits) {
+        *dst++ = accumulator << (8 - accumulatorBits);
+    }
+
+    return dst;
+}
+
+/**
+ * Encode `valueCount` fields from `values` using signed variable byte encoding. A 1-byte header is written first
+ * which specifies which fields are non-zero (so this encoding is compact when most fields are zero).
+ *
+ * valueCount must be 8 or less.
+ */
+uint8_t *blackboxEncodeTag8_8SVB(uint8_t *dst, const int32_t *values, int valueCount)
+{
+    if (valueCount <= 0) {
+        return dst;
+    }
+
+    //If we're only writing one field then we can skip the header
+    if (valueCount == 1) {
+        return blackboxEncodeSignedVB(dst, values[0]);
+    }
+
+    uint8_t *header = dst++;
+    uint8_t nonZero = 0;
+
+    // First field should be in low bits of header
+    for (int i = 0; i < valueCount; i++) {
+        if (values[i] != 0) {
+            nonZero |= 1 << i;
+            dst = blackboxEncodeSignedVB(dst, values[i]);
+        }
+    }
+
+    *header = nonZero;
+
+    return dst;
+}
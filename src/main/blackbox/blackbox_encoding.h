@@ -0,0 +1,35 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Encoders for the blackbox field formats. Each one writes into a caller-supplied buffer, which must have room for
+ * the worst case size given below, and returns a pointer just past the last byte written.
+ */
+#define BLACKBOX_VB_MAX_BYTES           5
+#define BLACKBOX_TAG2_3S32_MAX_BYTES    13
+#define BLACKBOX_TAG8_4S16_MAX_BYTES    9
+#define BLACKBOX_TAG8_8SVB_MAX_BYTES    (1 + 8 * BLACKBOX_VB_MAX_BYTES)
+
+uint8_t *blackboxEncodeUnsignedVB(uint8_t *dst, uint32_t value);
+uint8_t *blackboxEncodeSignedVB(uint8_t *dst, int32_t value);
+uint8_t *blackboxEncodeTag2_3S32(uint8_t *dst, const int32_t *values);
+uint8_t *blackboxEncodeTag8_4S16(uint8_t *dst, const int32_t *values);
+uint8_t *blackboxEncodeTag8_8SVB(uint8_t *dst, const int32_t *values, int valueCount);
@@ -40,6 +40,12 @@ typedef enum FlightLogFieldCondition {
     FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_1,
     FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_2,
 
+    FLIGHT_LOG_FIELD_CONDITION_LOG_PID,
+    FLIGHT_LOG_FIELD_CONDITION_LOG_RC_COMMANDS,
+    FLIGHT_LOG_FIELD_CONDITION_LOG_GYRO,
+    FLIGHT_LOG_FIELD_CONDITION_LOG_ACC,
+    FLIGHT_LOG_FIELD_CONDITION_LOG_DEBUG,
+
     FLIGHT_LOG_FIELD_CONDITION_NOT_LOGGING_EVERY_FRAME,
 
     FLIGHT_LOG_FIELD_CONDITION_NEVER,
@@ -107,6 +113,7 @@ typedef enum FlightLogEvent {
     FLIGHT_LOG_EVENT_INFLIGHT_ADJUSTMENT = 13,
     FLIGHT_LOG_EVENT_LOGGING_RESUME = 14,
     FLIGHT_LOG_EVENT_FLIGHTMODE = 30, // Add new event type for flight mode status.
+    FLIGHT_LOG_EVENT_TASK_RATE_CHANGE = 31,
     FLIGHT_LOG_EVENT_LOG_END = 255
 } FlightLogEvent;
 
@@ -131,6 +138,12 @@ typedef struct flightLogEvent_loggingResume_s {
     uint32_t currentTime;
 } flightLogEvent_loggingResume_t;
 
+typedef struct flightLogEvent_taskRateChange_s {
+    uint8_t taskId;
+    uint32_t newPeriod;                     // microseconds
+    uint16_t systemLoadPercent;
+} flightLogEvent_taskRateChange_t;
+
 #define FLIGHT_LOG_EVENT_INFLIGHT_ADJUSTMENT_FUNCTION_FLOAT_VALUE_FLAG 128
 
 typedef struct flightLogEvent_gtuneCycleResult_s {
@@ -144,6 +157,7 @@ typedef union flightLogEventData_u {
     flightLogEvent_flightMode_t flightMode; // New event data
     flightLogEvent_inflightAdjustment_t inflightAdjustment;
     flightLogEvent_loggingResume_t loggingResume;
+    flightLogEvent_taskRateChange_t taskRateChange;
     flightLogEvent_gtuneCycleResult_t gtuneCycleResult;
 } flightLogEventData_t;
 
@@ -9,6 +9,8 @@
 #ifdef BLACKBOX
 
 #include "blackbox_io.h"
+#include "blackbox_compress.h"
+#include "blackbox_encoding.h"
 
 #include "build/version.h"
 #include "build/build_config.h"
@@ -16,6 +18,8 @@
 #include "common/encoding.h"
 #include "common/printf.h"
 
+#include "drivers/system.h"
+
 #include "fc/config.h"
 #include "fc/rc_controls.h"
 
@@ -63,35 +67,268 @@ static struct {
 
 #endif
 
+/*
+ * Frames are encoded into this ring and drained to the device in contiguous chunks by blackboxDeviceFlush(), so the
+ * encoder pays for a store per byte rather than a device call, and a device that stalls for a while (SD card write
+ * latency, a busy flash chip) backs up into RAM instead of dropping data. Must be a power of 2.
+ */
+#ifndef BLACKBOX_BUFFER_SIZE
+#if defined(STM32F4) || defined(STM32F7)
+#define BLACKBOX_BUFFER_SIZE 4096
+#elif defined(STM32F3)
+#define BLACKBOX_BUFFER_SIZE 1024
+#else
+#define BLACKBOX_BUFFER_SIZE 256
+#endif
+#endif
+
+static uint8_t blackboxBuffer[BLACKBOX_BUFFER_SIZE];
+static uint16_t blackboxBufferHead;
+static uint16_t blackboxBufferTail;
+
+#ifdef USE_SDCARD
+/*
+ * While the ring is empty, uncompressed SD card logs are encoded straight into the log file's cache sector through
+ * afatfs_fwriteReserve() instead of being copied there from the ring. This is the remaining window of that sector,
+ * it's handed to the file by blackboxDirectCommit() and writes go back to the ring once it is full.
+ */
+static uint8_t *blackboxDirectStart;
+static uint8_t *blackboxDirectHead;
+static uint8_t *blackboxDirectEnd;
+#endif
+
+static int32_t blackboxBufferFreeSpace(void)
+{
+    // One byte is kept free to tell a full ring from an empty one
+    return (blackboxBufferTail - blackboxBufferHead - 1) & (BLACKBOX_BUFFER_SIZE - 1);
+}
+
 void blackboxWrite(uint8_t value)
+{
+#ifdef USE_SDCARD
+    if (blackboxDirectHead != blackboxDirectEnd) {
+        *blackboxDirectHead++ = value;
+        return;
+    }
+#endif
+
+    const uint16_t nextHead = (blackboxBufferHead + 1) & (BLACKBOX_BUFFER_SIZE - 1);
+
+    // If the device has fallen behind by a whole buffer the byte is lost, as it would have been in the device buffer
+    if (nextHead != blackboxBufferTail) {
+        blackboxBuffer[blackboxBufferHead] = value;
+        blackboxBufferHead = nextHead;
+    }
+}
+
+/*
+ * Copy an encoded field into the ring with a single space check. A field that doesn't fit is dropped whole rather
+ * than being cut short.
+ */
+static void blackboxWriteBuf(const uint8_t *data, int len)
+{
+#ifdef USE_SDCARD
+    const int directLen = MIN(len, blackboxDirectEnd - blackboxDirectHead);
+
+    if (len - directLen > blackboxBufferFreeSpace()) {
+        return;
+    }
+
+    memcpy(blackboxDirectHead, data, directLen);
+    blackboxDirectHead += directLen;
+    data += directLen;
+    len -= directLen;
+#else
+    if (len > blackboxBufferFreeSpace()) {
+        return;
+    }
+#endif
+
+    const int firstChunk = MIN(len, BLACKBOX_BUFFER_SIZE - blackboxBufferHead);
+
+    memcpy(&blackboxBuffer[blackboxBufferHead], data, firstChunk);
+    memcpy(blackboxBuffer, data + firstChunk, len - firstChunk);
+    blackboxBufferHead = (blackboxBufferHead + len) & (BLACKBOX_BUFFER_SIZE - 1);
+}
+
+// Hands a chunk to the device, returns how many bytes it accepted
+static uint32_t blackboxDeviceWrite(const uint8_t *data, uint32_t len)
 {
     switch (blackboxConfig()->device) {
 #ifdef USE_FLASHFS
         case BLACKBOX_DEVICE_FLASH:
-            flashfsWriteByte(value); // Write byte asynchronously
-        break;
+            len = MIN(len, flashfsGetWriteBufferFreeSpace());
+            flashfsWrite(data, len, false); // Write asynchronously
+            return len;
 #endif
 #ifdef USE_SDCARD
         case BLACKBOX_DEVICE_SDCARD:
-            afatfs_fputc(blackboxSDCard.logFile, value);
-        break;
+            return afatfs_fwrite(blackboxSDCard.logFile, data, len);
 #endif
         case BLACKBOX_DEVICE_SERIAL:
         default:
-            serialWrite(blackboxPort, value);
-        break;
+            len = MIN(len, serialTxBytesFree(blackboxPort));
+            serialWriteBuf(blackboxPort, data, len);
+            return len;
+    }
+}
+
+/*
+ * Hand whatever was encoded into the SD card sector window to the log file and close the window. Must happen before
+ * anything else touches the file, so the window's bytes stay ahead of anything written after them.
+ */
+static void blackboxDirectCommit(void)
+{
+#ifdef USE_SDCARD
+    if (blackboxDirectStart) {
+        afatfs_fwriteCommit(blackboxSDCard.logFile, blackboxDirectHead - blackboxDirectStart);
+        blackboxDirectStart = blackboxDirectHead = blackboxDirectEnd = NULL;
+    }
+#endif
+}
+
+/*
+ * Moves as much of the ring as the device will take. Returns true once the ring is empty.
+ */
+static bool blackboxDrainBuffer(void)
+{
+    while (blackboxBufferTail != blackboxBufferHead) {
+        // The used part of the ring is at most two contiguous chunks, write the one starting at the tail
+        const uint16_t chunkEnd = blackboxBufferHead > blackboxBufferTail ? blackboxBufferHead : BLACKBOX_BUFFER_SIZE;
+        const uint32_t written = blackboxDeviceWrite(&blackboxBuffer[blackboxBufferTail], chunkEnd - blackboxBufferTail);
+
+        if (written == 0) {
+            return false;
+        }
+        blackboxBufferTail = (blackboxBufferTail + written) & (BLACKBOX_BUFFER_SIZE - 1);
+    }
+
+    return true;
+}
+
+#ifdef USE_BLACKBOX_COMPRESSION
+/*
+ * With compression on, the compression task cuts the ring into blocks and codes them, and blackboxDeviceFlush() only
+ * moves finished blocks to the device. The ring keeps taking frames while a block is being written out.
+ */
+static bool blackboxCompressing;
+static uint8_t blackboxCompressInput[BLACKBOX_COMPRESS_BLOCK_SIZE];
+static uint8_t blackboxCompressOutput[BLACKBOX_COMPRESSED_BLOCK_MAX_SIZE(BLACKBOX_COMPRESS_BLOCK_SIZE)];
+static uint16_t blackboxCompressOutputPos;
+static uint16_t blackboxCompressOutputLen;
+
+static int32_t blackboxBufferUsed(void)
+{
+    return (blackboxBufferHead - blackboxBufferTail) & (BLACKBOX_BUFFER_SIZE - 1);
+}
+
+// Moves `len` bytes from the ring into a compressed block, which must only be called once the last block is written
+static void blackboxCompressFromBuffer(int len)
+{
+    const int firstChunk = MIN(len, BLACKBOX_BUFFER_SIZE - blackboxBufferTail);
+
+    memcpy(blackboxCompressInput, &blackboxBuffer[blackboxBufferTail], firstChunk);
+    memcpy(blackboxCompressInput + firstChunk, blackboxBuffer, len - firstChunk);
+    blackboxBufferTail = (blackboxBufferTail + len) & (BLACKBOX_BUFFER_SIZE - 1);
+
+    blackboxCompressOutputLen = blackboxCompressBlock(blackboxCompressInput, len, blackboxCompressOutput);
+    blackboxCompressOutputPos = 0;
+}
+
+// Returns true once the current compressed block has been written to the device
+static bool blackboxDrainCompressed(void)
+{
+    while (blackboxCompressOutputPos < blackboxCompressOutputLen) {
+        const uint32_t written = blackboxDeviceWrite(&blackboxCompressOutput[blackboxCompressOutputPos], blackboxCompressOutputLen - blackboxCompressOutputPos);
+
+        if (written == 0) {
+            return false;
+        }
+        blackboxCompressOutputPos += written;
+    }
+
+    return true;
+}
+
+/*
+ * Start or stop compressing the data that follows. Must be called with the ring empty, so that the log switches
+ * over cleanly between the plain text header and the compressed frames.
+ */
+void blackboxDeviceSetCompression(bool enabled)
+{
+    blackboxDirectCommit();
+
+    blackboxCompressing = enabled;
+    blackboxCompressOutputPos = 0;
+    blackboxCompressOutputLen = 0;
+}
+
+/*
+ * Called from the compression task: codes a full block once one is waiting in the ring and the last one has gone out.
+ */
+void blackboxCompressPending(void)
+{
+    if (blackboxCompressing && blackboxCompressOutputPos == blackboxCompressOutputLen
+            && blackboxBufferUsed() >= BLACKBOX_COMPRESS_BLOCK_SIZE) {
+        blackboxCompressFromBuffer(BLACKBOX_COMPRESS_BLOCK_SIZE);
+        blackboxDrainCompressed();
     }
 }
+#endif
 
-static void _putc(void *p, char c)
+// Open a new sector window if frames can go straight to the SD card
+static void blackboxDirectReserve(void)
+{
+#ifdef USE_SDCARD
+    if (blackboxConfig()->device == BLACKBOX_DEVICE_SDCARD && blackboxSDCard.logFile
+#ifdef USE_BLACKBOX_COMPRESSION
+            && !blackboxCompressing
+#endif
+            && blackboxBufferHead == blackboxBufferTail) {
+        uint8_t *window;
+        const uint32_t windowLen = afatfs_fwriteReserve(blackboxSDCard.logFile, &window);
+
+        if (windowLen > 0) {
+            blackboxDirectStart = blackboxDirectHead = window;
+            blackboxDirectEnd = window + windowLen;
+        }
+    }
+#endif
+}
+
+/*
+ * Write out everything that has been logged, compressing any partial block that is left. Returns true once done.
+ */
+static bool blackboxDrainAll(void)
+{
+    blackboxDirectCommit();
+
+#ifdef USE_BLACKBOX_COMPRESSION
+    if (blackboxCompressing) {
+        while (blackboxDrainCompressed()) {
+            const int32_t used = blackboxBufferUsed();
+
+            if (used == 0) {
+                return true;
+            }
+            blackboxCompressFromBuffer(MIN(used, BLACKBOX_COMPRESS_BLOCK_SIZE));
+        }
+        return false;
+    }
+#endif
+
+    return blackboxDrainBuffer();
+}
+
+static void blackboxWriteFormatted(void *p, const char *data, int len)
 {
     (void)p;
-    blackboxWrite(c);
+    blackboxWriteBuf((const uint8_t *)data, len);
 }
 
 static int blackboxPrintfv(const char *fmt, va_list va)
 {
-    return tfp_format(NULL, _putc, fmt, va);
+    return tfp_format_buffered(NULL, blackboxWriteFormatted, fmt, va);
 }
 
 
@@ -149,6 +386,7 @@ int blackboxPrint(const char *s)
 #ifdef USE_SDCARD
         case BLACKBOX_DEVICE_SDCARD:
             length = strlen(s);
+            blackboxDirectCommit();
             afatfs_fwrite(blackboxSDCard.logFile, (const uint8_t*) s, length); // Ignore failures due to buffers filling up
         break;
 #endif
@@ -173,12 +411,9 @@ int blackboxPrint(const char *s)
  */
 void blackboxWriteUnsignedVB(uint32_t value)
 {
-    //While this isn't the final byte (we can only write 7 bits at a time)
-    while (value > 127) {
-        blackboxWrite((uint8_t) (value | 0x80)); // Set the high bit to mean "more bytes follow"
-        value >>= 7;
-    }
-    blackboxWrite(value);
+    uint8_t buf[BLACKBOX_VB_MAX_BYTES];
+
+    blackboxWriteBuf(buf, blackboxEncodeUnsignedVB(buf, value) - buf);
 }
 
 /**
@@ -186,236 +421,72 @@ void blackboxWriteUnsignedVB(uint32_t value)
  */
 void blackboxWriteSignedVB(int32_t value)
 {
-    //ZigZag encode to make the value always positive
-    blackboxWriteUnsignedVB(zigzagEncode(value));
+    uint8_t buf[BLACKBOX_VB_MAX_BYTES];
+
+    blackboxWriteBuf(buf, blackboxEncodeSignedVB(buf, value) - buf);
 }
 
 void blackboxWriteSignedVBArray(int32_t *array, int count)
 {
-    for (int i = 0; i < count; i++) {
-        blackboxWriteSignedVB(array[i]);
+    uint8_t buf[8 * BLACKBOX_VB_MAX_BYTES];
+
+    while (count > 0) {
+        const int chunk = MIN(count, 8);
+        uint8_t *end = buf;
+
+        for (int i = 0; i < chunk; i++) {
+            end = blackboxEncodeSignedVB(end, array[i]);
+        }
+        blackboxWriteBuf(buf, end - buf);
+
+        array += chunk;
+        count -= chunk;
     }
 }
 
 void blackboxWriteSigned16VBArray(int16_t *array, int count)
 {
-    for (int i = 0; i < count; i++) {
-        blackboxWriteSignedVB(array[i]);
+    uint8_t buf[8 * BLACKBOX_VB_MAX_BYTES];
+
+    while (count > 0) {
+        const int chunk = MIN(count, 8);
+        uint8_t *end = buf;
+
+        for (int i = 0; i < chunk; i++) {
+            end = blackboxEncodeSignedVB(end, array[i]);
+        }
+        blackboxWriteBuf(buf, end - buf);
+
+        array += chunk;
+        count -= chunk;
     }
 }
 
 void blackboxWriteS16(int16_t value)
 {
-    blackboxWrite(value & 0xFF);
-    blackboxWrite((value >> 8) & 0xFF);
+    const uint8_t buf[2] = { value & 0xFF, (value >> 8) & 0xFF };
+
+    blackboxWriteBuf(buf, sizeof(buf));
 }
 
 /**
  * Write a 2 bit tag followed by 3 signed fields of 2, 4, 6 or 32 bits
  */
-void blackboxWriteTag2_3S32(int32_t *values) {
-    static const int NUM_FIELDS = 3;
-
-    //Need to be enums rather than const ints if we want to switch on them (due to being C)
-    enum {
-        BITS_2  = 0,
-        BITS_4  = 1,
-        BITS_6  = 2,
-        BITS_32 = 3
-    };
-
-    enum {
-        BYTES_1  = 0,
-        BYTES_2  = 1,
-        BYTES_3  = 2,
-        BYTES_4  = 3
-    };
-
-    int x;
-    int selector = BITS_2, selector2;
-
-    /*
-     * Find out how many bits the largest value requires to encode, and use it to choose one of the packing schemes
-     * below:
-     *
-     * Selector possibilities
-     *
-     * 2 bits per field  ss11 2233,
-     * 4 bits per field  ss00 1111 2222 3333
-     * 6 bits per field  ss11 1111 0022 2222 0033 3333
-     * 32 bits per field sstt tttt followed by fields of various byte counts
-     */
-    for (x = 0; x < NUM_FIELDS; x++) {
-        //Require more than 6 bits?
-        if (values[x] >= 32 || values[x] < -32) {
-            selector = BITS_32;
-            break;
-        }
-
-        //Require more than 4 bits?
-        if (values[x] >= 8 || values[x] < -8) {
-             if (selector < BITS_6) {
-                 selector = BITS_6;
-             }
-        } else if (values[x] >= 2 || values[x] < -2) { //Require more than 2 bits?
-            if (selector < BITS_4) {
-                selector = BITS_4;
-            }
-        }
-    }
-
-    switch (selector) {
-        case BITS_2:
-            blackboxWrite((selector << 6) | ((values[0] & 0x03) << 4) | ((values[1] & 0x03) << 2) | (values[2] & 0x03));
-        break;
-        case BITS_4:
-            blackboxWrite((selector << 6) | (values[0] & 0x0F));
-            blackboxWrite((values[1] << 4) | (values[2] & 0x0F));
-        break;
-        case BITS_6:
-            blackboxWrite((selector << 6) | (values[0] & 0x3F));
-            blackboxWrite((uint8_t)values[1]);
-            blackboxWrite((uint8_t)values[2]);
-        break;
-        case BITS_32:
-            /*
-             * Do another round to compute a selector for each field, assuming that they are at least 8 bits each
-             *
-             * Selector2 field possibilities
-             * 0 - 8 bits
-             * 1 - 16 bits
-             * 2 - 24 bits
-             * 3 - 32 bits
-             */
-            selector2 = 0;
-
-            //Encode in reverse order so the first field is in the low bits:
-            for (x = NUM_FIELDS - 1; x >= 0; x--) {
-                selector2 <<= 2;
-
-                if (values[x] < 128 && values[x] >= -128) {
-                    selector2 |= BYTES_1;
-                } else if (values[x] < 32768 && values[x] >= -32768) {
-                    selector2 |= BYTES_2;
-                } else if (values[x] < 8388608 && values[x] >= -8388608) {
-                    selector2 |= BYTES_3;
-                } else {
-                    selector2 |= BYTES_4;
-                }
-            }
+void blackboxWriteTag2_3S32(int32_t *values)
+{
+    uint8_t buf[BLACKBOX_TAG2_3S32_MAX_BYTES];
 
-            //Write the selectors
-            blackboxWrite((selector << 6) | selector2);
-
-            //And now the values according to the selectors we picked for them
-            for (x = 0; x < NUM_FIELDS; x++, selector2 >>= 2) {
-                switch (selector2 & 0x03) {
-                    case BYTES_1:
-                        blackboxWrite(values[x]);
-                    break;
-                    case BYTES_2:
-                        blackboxWrite(values[x]);
-                        blackboxWrite(values[x] >> 8);
-                    break;
-                    case BYTES_3:
-                        blackboxWrite(values[x]);
-                        blackboxWrite(values[x] >> 8);
-                        blackboxWrite(values[x] >> 16);
-                    break;
-                    case BYTES_4:
-                        blackboxWrite(values[x]);
-                        blackboxWrite(values[x] >> 8);
-                        blackboxWrite(values[x] >> 16);
-                        blackboxWrite(values[x] >> 24);
-                    break;
-                }
-            }
-        break;
-    }
+    blackboxWriteBuf(buf, blackboxEncodeTag2_3S32(buf, values) - buf);
 }
 
 /**
  * Write an 8-bit selector followed by four signed fields of size 0, 4, 8 or 16 bits.
  */
-void blackboxWriteTag8_4S16(int32_t *values) {
-
-    //Need to be enums rather than const ints if we want to switch on them (due to being C)
-    enum {
-        FIELD_ZERO  = 0,
-        FIELD_4BIT  = 1,
-        FIELD_8BIT  = 2,
-        FIELD_16BIT = 3
-    };
-
-    uint8_t selector, buffer;
-    int nibbleIndex;
-    int x;
-
-    selector = 0;
-    //Encode in reverse order so the first field is in the low bits:
-    for (x = 3; x >= 0; x--) {
-        selector <<= 2;
-
-        if (values[x] == 0) {
-            selector |= FIELD_ZERO;
-        } else if (values[x] < 8 && values[x] >= -8) {
-            selector |= FIELD_4BIT;
-        } else if (values[x] < 128 && values[x] >= -128) {
-            selector |= FIELD_8BIT;
-        } else {
-            selector |= FIELD_16BIT;
-        }
-    }
-
-    blackboxWrite(selector);
+void blackboxWriteTag8_4S16(int32_t *values)
+{
+    uint8_t buf[BLACKBOX_TAG8_4S16_MAX_BYTES];
 
-    nibbleIndex = 0;
-    buffer = 0;
-    for (x = 0; x < 4; x++, selector >>= 2) {
-        switch (selector & 0x03) {
-            case FIELD_ZERO:
-                //No-op
-            break;
-            case FIELD_4BIT:
-                if (nibbleIndex == 0) {
-                    //We fill high-bits first
-                    buffer = values[x] << 4;
-                    nibbleIndex = 1;
-                } else {
-                    blackboxWrite(buffer | (values[x] & 0x0F));
-                    nibbleIndex = 0;
-                }
-            break;
-            case FIELD_8BIT:
-                if (nibbleIndex == 0) {
-                    blackboxWrite(values[x]);
-                } else {
-                    //Write the high bits of the value first (mask to avoid sign extension)
-                    blackboxWrite(buffer | ((values[x] >> 4) & 0x0F));
-                    //Now put the leftover low bits into the top of the next buffer entry
-                    buffer = values[x] << 4;
-                }
-            break;
-            case FIELD_16BIT:
-                if (nibbleIndex == 0) {
-                    //Write high byte first
-                    blackboxWrite(values[x] >> 8);
-                    blackboxWrite(values[x]);
-                } else {
-                    //First write the highest 4 bits
-                    blackboxWrite(buffer | ((values[x] >> 12) & 0x0F));
-                    // Then the middle 8
-                    blackboxWrite(values[x] >> 4);
-                    //Only the smallest 4 bits are still left to write
-                    buffer = values[x] << 4;
-                }
-            break;
-        }
-    }
-    //Anything left over to write?
-    if (nibbleIndex == 1) {
-        blackboxWrite(buffer);
-    }
+    blackboxWriteBuf(buf, blackboxEncodeTag8_4S16(buf, values) - buf);
 }
 
 /**
@@ -426,44 +497,17 @@ void blackboxWriteTag8_4S16(int32_t *values) {
  */
 void blackboxWriteTag8_8SVB(int32_t *values, int valueCount)
 {
-    uint8_t header;
-    int i;
-
-    if (valueCount > 0) {
-        //If we're only writing one field then we can skip the header
-        if (valueCount == 1) {
-            blackboxWriteSignedVB(values[0]);
-        } else {
-            //First write a one-byte header that marks which fields are non-zero
-            header = 0;
-
-            // First field should be in low bits of header
-            for (i = valueCount - 1; i >= 0; i--) {
-                header <<= 1;
-
-                if (values[i] != 0) {
-                    header |= 0x01;
-                }
-            }
-
-            blackboxWrite(header);
+    uint8_t buf[BLACKBOX_TAG8_8SVB_MAX_BYTES];
 
-            for (i = 0; i < valueCount; i++) {
-                if (values[i] != 0) {
-                    blackboxWriteSignedVB(values[i]);
-                }
-            }
-        }
-    }
+    blackboxWriteBuf(buf, blackboxEncodeTag8_8SVB(buf, values, valueCount) - buf);
 }
 
 /** Write unsigned integer **/
 void blackboxWriteU32(int32_t value)
 {
-    blackboxWrite(value & 0xFF);
-    blackboxWrite((value >> 8) & 0xFF);
-    blackboxWrite((value >> 16) & 0xFF);
-    blackboxWrite((value >> 24) & 0xFF);
+    const uint8_t buf[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF };
+
+    blackboxWriteBuf(buf, sizeof(buf));
 }
 
 /** Write float value in the integer form **/
@@ -479,20 +523,23 @@ void blackboxWriteFloat(float value)
  */
 void blackboxDeviceFlush(void)
 {
-    switch (blackboxConfig()->device) {
-#ifdef USE_FLASHFS
-        /*
-         * This is our only output device which requires us to call flush() in order for it to write anything. The other
-         * devices will progressively write in the background without Blackbox calling anything.
-         */
-        case BLACKBOX_DEVICE_FLASH:
-            flashfsFlushAsync();
-        break;
-#endif
+    blackboxDirectCommit();
 
-        default:
-            ;
+#ifdef USE_BLACKBOX_COMPRESSION
+    if (blackboxCompressing) {
+        blackboxDrainCompressed();
+    } else
+#endif
+    {
+        blackboxDrainBuffer();
     }
+
+    blackboxDirectReserve();
+
+    /*
+     * The devices progressively write in the background without Blackbox calling anything. Flash pages are programmed
+     * by the flashfs task once they are full, so a partial page is never written while logging.
+     */
 }
 
 /**
@@ -502,6 +549,10 @@ void blackboxDeviceFlush(void)
  */
 bool blackboxDeviceFlushForce(void)
 {
+    if (!blackboxDrainAll()) {
+        return false;
+    }
+
     switch (blackboxConfig()->device) {
         case BLACKBOX_DEVICE_SERIAL:
             // Nothing to speed up flushing on serial, as serial is continuously being drained out of its buffer
@@ -530,6 +581,15 @@ bool blackboxDeviceFlushForce(void)
  */
 bool blackboxDeviceOpen(void)
 {
+    blackboxBufferHead = 0;
+    blackboxBufferTail = 0;
+#ifdef USE_SDCARD
+    blackboxDirectStart = blackboxDirectHead = blackboxDirectEnd = NULL;
+#endif
+#ifdef USE_BLACKBOX_COMPRESSION
+    blackboxDeviceSetCompression(false);
+#endif
+
     switch (blackboxConfig()->device) {
         case BLACKBOX_DEVICE_SERIAL:
             {
@@ -554,9 +614,20 @@ bool blackboxDeviceOpen(void)
                     portOptions |= SERIAL_STOPBITS_1;
                 }
 
+                if (blackboxConfig()->serial_flow_control) {
+                    portOptions |= SERIAL_FLOW_CTS;
+                }
+
                 blackboxPort = openSerialPort(portConfig->identifier, FUNCTION_BLACKBOX, NULL, baudRates[baudRateIndex],
                     BLACKBOX_SERIAL_PORT_MODE, portOptions);
 
+                // A logger that holds off the port with CTS while its card is busy doesn't need the header throttled
+                if (blackboxConfig()->serial_flow_control) {
+                    blackboxMaxHeaderBytesPerIteration = BLACKBOX_TARGET_HEADER_BUDGET_PER_ITERATION;
+
+                    return blackboxPort != NULL;
+                }
+
                 /*
                  * The slowest MicroSD cards have a write latency approaching 150ms. The OpenLog's buffer is about 900
                  * bytes. In order for its buffer to be able to absorb this latency we must write slower than 6000 B/s.
@@ -574,6 +645,8 @@ bool blackboxDeviceOpen(void)
             break;
 #ifdef USE_FLASHFS
         case BLACKBOX_DEVICE_FLASH:
+            flashfsSetRingMode(blackboxConfig()->flash_ring);
+
             if (flashfsGetSize() == 0 || isBlackboxDeviceFull()) {
                 return false;
             }
@@ -666,15 +739,17 @@ static void blackboxCreateLogFile()
 
     blackboxSDCard.state = BLACKBOX_SDCARD_WAITING;
 
-    afatfs_fopen(filename, "as", blackboxLogFileCreated);
+    // The directory has been enumerated, so the name is known to be free and the directory needn't be searched again
+    afatfs_fopen(filename, "asn", blackboxLogFileCreated);
 }
 
 /**
- * Begin a new log on the SDCard.
+ * Begin a new log on the SDCard. The log directory is found and enumerated first, unless that has already been done
+ * by blackboxDevicePrepareLog(). Pass false for `createLog` to stop once the directory is ready.
  *
  * Keep calling until the function returns true (open is complete).
  */
-static bool blackboxSDCardBeginLog()
+static bool blackboxSDCardBeginLog(bool createLog)
 {
     fatDirectoryEntry_t *directoryEntry;
 
@@ -728,7 +803,9 @@ static bool blackboxSDCardBeginLog()
             break;
 
         case BLACKBOX_SDCARD_READY_TO_CREATE_LOG:
-            blackboxCreateLogFile();
+            if (createLog) {
+                blackboxCreateLogFile();
+            }
             break;
 
         case BLACKBOX_SDCARD_READY_TO_LOG:
@@ -741,6 +818,19 @@ static bool blackboxSDCardBeginLog()
 
 #endif
 
+/**
+ * Get ready for the next log while logging is stopped, so that it can begin without delay. This enumerates the log
+ * directory of the SD card to find the next log number, which takes a while once the card holds a lot of logs.
+ */
+void blackboxDevicePrepareLog(void)
+{
+#ifdef USE_SDCARD
+    if (blackboxConfig()->device == BLACKBOX_DEVICE_SDCARD && blackboxSDCard.state != BLACKBOX_SDCARD_READY_TO_CREATE_LOG) {
+        blackboxSDCardBeginLog(false);
+    }
+#endif
+}
+
 /**
  * Begin a new log (for devices which support separations between the logs of multiple flights).
  *
@@ -751,7 +841,12 @@ bool blackboxDeviceBeginLog(void)
     switch (blackboxConfig()->device) {
 #ifdef USE_SDCARD
         case BLACKBOX_DEVICE_SDCARD:
-            return blackboxSDCardBeginLog();
+            return blackboxSDCardBeginLog(true);
+#endif
+#ifdef USE_FLASHFS
+        case BLACKBOX_DEVICE_FLASH:
+            flashfsLogBegin(millis());
+            return true;
 #endif
         default:
             return true;
@@ -775,6 +870,14 @@ bool blackboxDeviceEndLog(bool retainLog)
     switch (blackboxConfig()->device) {
 #ifdef USE_SDCARD
         case BLACKBOX_DEVICE_SDCARD:
+            // A discarded log can still have a sector window open, which has to be closed before the file goes away
+            blackboxDirectCommit();
+
+            // The end of the log may still be in our buffer, it has to reach the file before it is closed
+            if (retainLog && !blackboxDrainAll()) {
+                return false;
+            }
+
             // Keep retrying until the close operation queues
             if (
                 (retainLog && afatfs_fclose(blackboxSDCard.logFile, NULL))
@@ -786,6 +889,15 @@ bool blackboxDeviceEndLog(bool retainLog)
                 return true;
             }
             return false;
+#endif
+#ifdef USE_FLASHFS
+        case BLACKBOX_DEVICE_FLASH:
+            // The log index records where the log ends, which is after everything still in our buffer
+            if (!blackboxDrainAll()) {
+                return false;
+            }
+            flashfsLogEnd();
+            return true;
 #endif
         default:
             return true;
@@ -819,25 +931,8 @@ bool isBlackboxDeviceFull(void)
  */
 void blackboxReplenishHeaderBudget()
 {
-    int32_t freeSpace;
-
-    switch (blackboxConfig()->device) {
-        case BLACKBOX_DEVICE_SERIAL:
-            freeSpace = serialTxBytesFree(blackboxPort);
-        break;
-#ifdef USE_FLASHFS
-        case BLACKBOX_DEVICE_FLASH:
-            freeSpace = flashfsGetWriteBufferFreeSpace();
-        break;
-#endif
-#ifdef USE_SDCARD
-        case BLACKBOX_DEVICE_SDCARD:
-            freeSpace = afatfs_getFreeBufferSpace();
-        break;
-#endif
-        default:
-            freeSpace = 0;
-    }
+    // Header bytes go into our buffer like everything else, the device only sees them as it drains
+    const int32_t freeSpace = blackboxBufferFreeSpace();
 
     blackboxHeaderBudget = MIN(MIN(freeSpace, blackboxHeaderBudget + blackboxMaxHeaderBytesPerIteration), BLACKBOX_MAX_ACCUMULATED_HEADER_BUDGET);
 }
@@ -848,12 +943,10 @@ void blackboxReplenishHeaderBudget()
  * reservation function doesn't decrease blackboxHeaderBudget, so you must manually decrement that variable by the
  * number of bytes you actually wrote.
  *
- * When the Blackbox device is FlashFS, a successful return code guarantees that no data will be lost if you write that
- * many bytes to the device (i.e. FlashFS's buffers won't overflow).
- *
- * When the device is a serial port, a successful return code guarantees that Cleanflight's serial Tx buffer will not
- * overflow, and the outgoing bandwidth is likely to be small enough to give the OpenLog time to absorb MicroSD card
- * latency. However the OpenLog could still end up silently dropping data.
+ * A successful return code guarantees that the bytes fit in the Blackbox buffer, from where they are drained to the
+ * device as it accepts them. When the device is a serial port the header budget also keeps the outgoing bandwidth
+ * small enough to give the OpenLog time to absorb MicroSD card latency. However the OpenLog could still end up
+ * silently dropping data.
  *
  * Returns:
  *  BLACKBOX_RESERVE_SUCCESS - Upon success
@@ -867,45 +960,17 @@ blackboxBufferReserveStatus_e blackboxDeviceReserveBufferSpace(int32_t bytes)
     }
 
     // Handle failure:
-    switch (blackboxConfig()->device) {
-        case BLACKBOX_DEVICE_SERIAL:
-            /*
-             * One byte of the tx buffer isn't available for user data (due to its circular list implementation),
-             * hence the -1. Note that the USB VCP implementation doesn't use a buffer and has txBufferSize set to zero.
-             */
-            if (blackboxPort->txBufferSize && bytes > (int32_t) blackboxPort->txBufferSize - 1) {
-                return BLACKBOX_RESERVE_PERMANENT_FAILURE;
-            }
-
-            return BLACKBOX_RESERVE_TEMPORARY_FAILURE;
-
-#ifdef USE_FLASHFS
-        case BLACKBOX_DEVICE_FLASH:
-            if (bytes > (int32_t) flashfsGetWriteBufferSize()) {
-                return BLACKBOX_RESERVE_PERMANENT_FAILURE;
-            }
-
-            if (bytes > (int32_t) flashfsGetWriteBufferFreeSpace()) {
-                /*
-                 * The write doesn't currently fit in the buffer, so try to make room for it. Our flushing here means
-                 * that the Blackbox header writing code doesn't have to guess about the best time to ask flashfs to
-                 * flush, and doesn't stall waiting for a flush that would otherwise not automatically be called.
-                 */
-                flashfsFlushAsync();
-            }
-
-            return BLACKBOX_RESERVE_TEMPORARY_FAILURE;
-#endif
+    if (bytes > BLACKBOX_BUFFER_SIZE - 1) {
+        return BLACKBOX_RESERVE_PERMANENT_FAILURE;
+    }
 
-#ifdef USE_SDCARD
-        case BLACKBOX_DEVICE_SDCARD:
-            // Assume that all writes will fit in the SDCard's buffers
-            return BLACKBOX_RESERVE_TEMPORARY_FAILURE;
-#endif
+    /*
+     * The write doesn't currently fit in the buffer, so try to make room for it. Our flushing here means that the
+     * Blackbox header writing code doesn't have to guess about the best time to flush.
+     */
+    blackboxDeviceFlush();
 
-        default:
-            return BLACKBOX_RESERVE_PERMANENT_FAILURE;
-    }
+    return BLACKBOX_RESERVE_TEMPORARY_FAILURE;
 }
 
 #endif
@@ -66,11 +66,17 @@ void blackboxWriteTag8_8SVB(int32_t *values, int valueCount);
 void blackboxWriteU32(int32_t value);
 void blackboxWriteFloat(float value);
 
+#ifdef USE_BLACKBOX_COMPRESSION
+void blackboxDeviceSetCompression(bool enabled);
+void blackboxCompressPending(void);
+#endif
+
 void blackboxDeviceFlush(void);
 bool blackboxDeviceFlushForce(void);
 bool blackboxDeviceOpen(void);
 void blackboxDeviceClose(void);
 
+void blackboxDevicePrepareLog(void);
 bool blackboxDeviceBeginLog(void);
 bool blackboxDeviceEndLog(bool retainLog);
 
@@ -17,6 +17,14 @@
 
 #pragma once
 
+#if defined(SIMULATOR_BUILD)
+// the simulator runs the firmware on a single host thread, so there is no interrupt priority to raise
+static inline uint32_t __get_BASEPRI(void) { return 0; }
+static inline void __set_BASEPRI(uint32_t basePri) { (void)basePri; }
+static inline void __set_BASEPRI_MAX(uint32_t basePri) { (void)basePri; }
+static inline void __set_BASEPRI_nb(uint32_t basePri) { (void)basePri; }
+static inline void __set_BASEPRI_MAX_nb(uint32_t basePri) { (void)basePri; }
+#else
 // only set_BASEPRI is implemented in device library. It does always create memory barrirer
 // missing versions are implemented here
 
@@ -37,6 +45,7 @@ __attribute__( ( always_inline ) ) static inline void __set_BASEPRI_MAX(uint32_t
     __ASM volatile ("\tMSR basepri_max, %0\n" : : "r" (basePri) : "memory" );
 }
 #endif
+#endif // SIMULATOR_BUILD
 
 // cleanup BASEPRI restore function, with global memory barrier
 static inline void __basepriRestoreMem(uint8_t *val)
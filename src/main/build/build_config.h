@@ -32,6 +32,39 @@
 #define UNIT_TESTED
 #endif
 
+#ifdef UNIT_TEST
+#define FAST_CODE
+#define FAST_CODE_ITCM
+#define FAST_RAM
+#define FAST_RAM_ZERO_INIT
+#define PERSISTENT
+#else
+// hot code copied out of flash at boot, to the CCM on F3 and the ITCM on F7, F1 and F4 run it from flash
+#if defined(STM32F303xC) || defined(STM32F745xx) || defined(STM32F746xx)
+#define FAST_CODE __attribute__ ((section(".fastcode"), aligned(4)))
+#else
+#define FAST_CODE
+#endif
+// larger hot code that only fits in the F7's ITCM
+#if defined(STM32F745xx) || defined(STM32F746xx)
+#define FAST_CODE_ITCM FAST_CODE
+#else
+#define FAST_CODE_ITCM
+#endif
+// statics in CCM on F3 and F4 and in DTCM on F7, the F3 and F4 CCM can't be reached by DMA, use DMA_RAM for DMA buffers
+#define FAST_RAM __attribute__ ((section(".fastram_data"), aligned(4)))
+#define FAST_RAM_ZERO_INIT __attribute__ ((section(".fastram_bss"), aligned(4)))
+// statics in RAM that a reset leaves alone, they hold garbage after power up so check them before use
+#define PERSISTENT __attribute__ ((section(".persistent_bss"), aligned(4)))
+#endif
+
+// zeroed DMA buffers, in the uncached DTCM on F7 so they need no cache maintenance, ordinary RAM elsewhere
+#if defined(STM32F745xx) || defined(STM32F746xx)
+#define DMA_RAM __attribute__ ((section(".dmaram_bss"), aligned(32)))
+#else
+#define DMA_RAM
+#endif
+
 //#define SOFT_I2C // enable to test software i2c
 
 #ifndef __CC_ARM
@@ -15,13 +15,17 @@
  * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "stdint.h"
+#include <stdint.h>
+
+#include "platform.h"
 
 
 #include "debug.h"
 
 int16_t debug[DEBUG16_VALUE_COUNT];
+#ifdef USE_DEBUG_MODES
 uint8_t debugMode;
+#endif
 
 #ifdef DEBUG_SECTION_TIMES
 uint32_t sectionTimes[2][4];
@@ -17,11 +17,19 @@
 
 #pragma once
 
-#define DEBUG16_VALUE_COUNT 4
+#define DEBUG16_VALUE_COUNT 8
 extern int16_t debug[DEBUG16_VALUE_COUNT];
+
+#ifdef USE_DEBUG_MODES
 extern uint8_t debugMode;
 
 #define DEBUG_SET(mode, index, value) {if (debugMode == (mode)) {debug[(index)] = (value);}}
+#else
+// debug_mode is fixed to DEBUG_NONE, the compiler drops every debugMode check and the instrumentation behind it
+#define debugMode ((uint8_t)DEBUG_NONE)
+
+#define DEBUG_SET(mode, index, value) {}
+#endif
 
 #define DEBUG_SECTION_TIMES
 
@@ -62,5 +70,12 @@ typedef enum {
     DEBUG_ESC_SENSOR,
     DEBUG_SCHEDULER,
     DEBUG_STACK,
+    DEBUG_FFT,
+    DEBUG_LOOP_JITTER,
+    DEBUG_LOOP_LATENCY,
+    DEBUG_DSHOT_RPM,
+    DEBUG_RPM_FILTER,
+    DEBUG_DUAL_GYRO,
+    DEBUG_GYRO_PHASE,
     DEBUG_COUNT
 } debugType_e;
@@ -0,0 +1,73 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_PROFILER
+
+#include "build/atomic.h"
+#include "build/profile.h"
+
+#include "drivers/nvic.h"
+
+uint32_t profileStartedAt[PROFILE_COUNT];
+profileStats_t profileStats[PROFILE_COUNT];
+
+static const char * const profileNames[PROFILE_COUNT] = {
+    [PROFILE_GYRO_UPDATE] = "GYRO",
+    [PROFILE_PID_CONTROLLER] = "PID",
+    [PROFILE_MIX_TABLE] = "MIXER",
+    [PROFILE_WRITE_MOTORS] = "MOTORS",
+    [PROFILE_BLACKBOX] = "BLACKBOX",
+    [PROFILE_OSD] = "OSD",
+    [PROFILE_RX] = "RX",
+    [PROFILE_ATTITUDE] = "ATTITUDE",
+};
+
+const char *profileGetName(profileProbe_e probe)
+{
+    return profileNames[probe];
+}
+
+const profileStats_t *profileGetStats(profileProbe_e probe)
+{
+    return &profileStats[probe];
+}
+
+uint32_t profileGetAverageCycles(profileProbe_e probe)
+{
+    const profileStats_t *stats = &profileStats[probe];
+    return stats->count ? stats->totalCycles / stats->count : 0;
+}
+
+uint32_t profileGetCyclesPerMicrosecond(void)
+{
+    return SystemCoreClock / 1000000;
+}
+
+void profileReset(void)
+{
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        memset(profileStats, 0, sizeof(profileStats));
+    }
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Cycle counting probes for the flight loop, micros() is too coarse to time the individual
+ * functions at 8kHz and above. Wrap a call in PROFILE_BEGIN(probe) and PROFILE_END(probe),
+ * each probe must only be used from one execution context.
+ */
+
+typedef enum {
+    PROFILE_GYRO_UPDATE = 0,
+    PROFILE_PID_CONTROLLER,
+    PROFILE_MIX_TABLE,
+    PROFILE_WRITE_MOTORS,
+    PROFILE_BLACKBOX,
+    PROFILE_OSD,
+    PROFILE_RX,
+    PROFILE_ATTITUDE,
+    PROFILE_COUNT
+} profileProbe_e;
+
+typedef struct profileStats_s {
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+} profileStats_t;
+
+#ifdef USE_PROFILER
+
+extern uint32_t profileStartedAt[PROFILE_COUNT];
+extern profileStats_t profileStats[PROFILE_COUNT];
+
+static inline void profileRecord(profileProbe_e probe, uint32_t cycles)
+{
+    profileStats_t *stats = &profileStats[probe];
+    stats->count++;
+    stats->totalCycles += cycles;
+    if (cycles < stats->minCycles || stats->count == 1) {
+        stats->minCycles = cycles;
+    }
+    if (cycles > stats->maxCycles) {
+        stats->maxCycles = cycles;
+    }
+}
+
+#define PROFILE_BEGIN(probe) do { profileStartedAt[(probe)] = DWT->CYCCNT; } while (0)
+#define PROFILE_END(probe) profileRecord((probe), DWT->CYCCNT - profileStartedAt[(probe)])
+
+const char *profileGetName(profileProbe_e probe);
+const profileStats_t *profileGetStats(profileProbe_e probe);
+uint32_t profileGetAverageCycles(profileProbe_e probe);
+uint32_t profileGetCyclesPerMicrosecond(void);
+void profileReset(void);
+
+#else
+
+#define PROFILE_BEGIN(probe) do {} while (0)
+#define PROFILE_END(probe) do {} while (0)
+
+#endif
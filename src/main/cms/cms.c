@@ -218,6 +218,44 @@ static void cmsPadToSize(char *buf, int size)
     buf[size] = 0;
 }
 
+// Last value text drawn on each row of the current page. Polled entries are formatted on every
+// poll, but only written out when the text has changed.
+#define CMS_VALUE_CACHE_ROWS    16
+#define CMS_VALUE_CACHE_LEN     12
+
+typedef struct cmsValueCache_s {
+    bool valid;
+    uint8_t col;
+    char text[CMS_VALUE_CACHE_LEN];
+} cmsValueCache_t;
+
+static cmsValueCache_t cmsValueCache[CMS_VALUE_CACHE_ROWS];
+
+static void cmsInvalidateValueCache(void)
+{
+    memset(cmsValueCache, 0, sizeof(cmsValueCache));
+}
+
+static int cmsDrawValue(displayPort_t *pDisplay, uint8_t col, uint8_t row, const char *text)
+{
+    cmsValueCache_t *cached = (row < CMS_VALUE_CACHE_ROWS) ? &cmsValueCache[row] : NULL;
+    const bool cacheable = cached && strlen(text) < CMS_VALUE_CACHE_LEN;
+
+    if (cacheable && cached->valid && cached->col == col && strcmp(cached->text, text) == 0) {
+        return 0;
+    }
+
+    if (cached) {
+        cached->valid = cacheable;
+        if (cacheable) {
+            cached->col = col;
+            strcpy(cached->text, text);
+        }
+    }
+
+    return displayWrite(pDisplay, col, row, text);
+}
+
 static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
 {
     char buff[10];
@@ -226,7 +264,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
     switch (p->type) {
     case OME_String:
         if (IS_PRINTVALUE(p) && p->data) {
-            cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, p->data);
+            cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, p->data);
             CLR_PRINTVALUE(p);
         }
         break;
@@ -242,12 +280,22 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
                 // Special case of sub menu entry with optional value display.
 
                 char *str = ((CMSMenuOptFuncPtr)p->func)();
-                cnt = displayWrite(pDisplay, colPos, row, str);
+                char optBuff[CMS_VALUE_CACHE_LEN];
+
+                if (strlen(str) + 1 < sizeof(optBuff)) {
+                    strcpy(optBuff, str);
+                    strcat(optBuff, ">");
+                    cnt = cmsDrawValue(pDisplay, colPos, row, optBuff);
+                    CLR_PRINTVALUE(p);
+                    break;
+                }
+                cnt = cmsDrawValue(pDisplay, colPos, row, str);
                 colPos += strlen(str);
+                cnt += displayWrite(pDisplay, colPos, row, ">");
+            } else {
+                cnt = cmsDrawValue(pDisplay, colPos, row, ">");
             }
 
-            cnt += displayWrite(pDisplay, colPos, row, ">");
-
             CLR_PRINTVALUE(p);
         }
         break;
@@ -255,9 +303,9 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
     case OME_Bool:
         if (IS_PRINTVALUE(p) && p->data) {
             if (*((uint8_t *)(p->data))) {
-                cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "YES");
+                cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "YES");
             } else {
-                cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "NO ");
+                cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "NO ");
             }
             CLR_PRINTVALUE(p);
         }
@@ -267,7 +315,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
         if (IS_PRINTVALUE(p)) {
             OSD_TAB_t *ptr = p->data;
             //cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay) - 5, row, (char *)ptr->names[*ptr->val]);
-            cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, (char *)ptr->names[*ptr->val]);
+            cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, (char *)ptr->names[*ptr->val]);
             CLR_PRINTVALUE(p);
         }
         break;
@@ -281,9 +329,9 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
             val = (uint16_t *)address;
 
             if (VISIBLE(*val)) {
-                cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "YES");
+                cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "YES");
             } else {
-                cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "NO ");
+                cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "NO ");
             }
             CLR_PRINTVALUE(p);
         }
@@ -295,7 +343,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
             OSD_UINT8_t *ptr = p->data;
             itoa(*ptr->val, buff, 10);
             cmsPadToSize(buff, 5);
-            cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
+            cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
             CLR_PRINTVALUE(p);
         }
         break;
@@ -305,7 +353,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
             OSD_INT8_t *ptr = p->data;
             itoa(*ptr->val, buff, 10);
             cmsPadToSize(buff, 5);
-            cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
+            cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
             CLR_PRINTVALUE(p);
         }
         break;
@@ -315,7 +363,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
             OSD_UINT16_t *ptr = p->data;
             itoa(*ptr->val, buff, 10);
             cmsPadToSize(buff, 5);
-            cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
+            cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
             CLR_PRINTVALUE(p);
         }
         break;
@@ -325,7 +373,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
             OSD_UINT16_t *ptr = p->data;
             itoa(*ptr->val, buff, 10);
             cmsPadToSize(buff, 5);
-            cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
+            cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, buff);
             CLR_PRINTVALUE(p);
         }
         break;
@@ -335,7 +383,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
             OSD_FLOAT_t *ptr = p->data;
             cmsFormatFloat(*ptr->val * ptr->multipler, buff);
             cmsPadToSize(buff, 5);
-            cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay) - 1, row, buff); // XXX One char left ???
+            cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay) - 1, row, buff); // XXX One char left ???
             CLR_PRINTVALUE(p);
         }
         break;
@@ -343,7 +391,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
     case OME_Label:
         if (IS_PRINTVALUE(p) && p->data) {
             // A label with optional string, immediately following text
-            cnt = displayWrite(pDisplay, LEFT_MENU_COLUMN + 2 + strlen(p->text), row, p->data);
+            cnt = cmsDrawValue(pDisplay, LEFT_MENU_COLUMN + 2 + strlen(p->text), row, p->data);
             CLR_PRINTVALUE(p);
         }
         break;
@@ -358,7 +406,7 @@ static int cmsDrawMenuEntry(displayPort_t *pDisplay, OSD_Entry *p, uint8_t row)
     default:
 #ifdef CMS_MENU_DEBUG
         // Shouldn't happen. Notify creator of this menu content.
-        cnt = displayWrite(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "BADENT");
+        cnt = cmsDrawValue(pDisplay, RIGHT_MENU_COLUMN(pDisplay), row, "BADENT");
 #endif
         break;
     }
@@ -388,6 +436,7 @@ static void cmsDrawMenu(displayPort_t *pDisplay, uint32_t currentTimeUs)
     uint32_t room = displayTxBytesFree(pDisplay);
 
     if (pDisplay->cleared) {
+        cmsInvalidateValueCache();
         for (p = pageTop, i= 0; p->type != OME_END; p++, i++) {
             SET_PRINTLABEL(p);
             SET_PRINTVALUE(p);
@@ -936,6 +985,7 @@ static void cmsUpdate(uint32_t currentTimeUs)
         }
 
         cmsDrawMenu(pCurrentDisplay, currentTimeUs);
+        displayDrawScreen(pCurrentDisplay);
 
         if (currentTimeMs > lastCmsHeartBeatMs + 500) {
             // Heart beat for external CMS display device @ 500msec
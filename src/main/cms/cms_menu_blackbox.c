@@ -28,7 +28,7 @@
 
 #include "build/version.h"
 
-#ifdef CMS
+#if defined(CMS) && defined(BLACKBOX)
 
 #include "drivers/system.h"
 
@@ -55,6 +55,7 @@ static long cmsx_EraseFlash(displayPort_t *pDisplay, const void *ptr)
 
     flashfsEraseCompletely();
     while (!flashfsIsReady()) {
+        flashfsUpdate();
         delay(100);
     }
 
@@ -81,6 +81,14 @@ OSD_Entry menuOsdActiveElemsEntries[] =
 #endif // GPS
     {"ALTITUDE", OME_VISIBLE, NULL, &osdProfile()->item_pos[OSD_ALTITUDE], 0},
     {"POWER", OME_VISIBLE, NULL, &osdProfile()->item_pos[OSD_POWER], 0},
+#ifdef USE_ESC_SENSOR
+    {"ESC TEMP", OME_VISIBLE, NULL, &osdProfile()->item_pos[OSD_ESC_TMP], 0},
+    {"ESC RPM", OME_VISIBLE, NULL, &osdProfile()->item_pos[OSD_ESC_RPM], 0},
+#endif
+#ifdef USE_SDCARD
+    {"SD CARD", OME_VISIBLE, NULL, &osdProfile()->item_pos[OSD_SDCARD], 0},
+#endif
+    {"LOOP RATE", OME_VISIBLE, NULL, &osdProfile()->item_pos[OSD_LOOP_RATE], 0},
     {"BACK", OME_Back, NULL, NULL, 0},
     {NULL, OME_END, NULL, NULL, 0}
 };
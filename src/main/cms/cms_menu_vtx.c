@@ -33,6 +33,8 @@
 #include "config/config_master.h"
 #include "config/feature.h"
 
+#include "drivers/vtx_soft_spi_rtc6705.h"
+
 #ifdef CMS
 
 #if defined(VTX) || defined(USE_RTC6705)
@@ -93,6 +95,13 @@ static void cmsx_Vtx_ConfigWriteback(void)
 
 #ifdef USE_RTC6705
     masterConfig.vtx_channel = cmsx_vtxBand * 8 + cmsx_vtxChannel - 1;
+
+    // only queued here, the VTX task sends the register writes without holding up the menu or the PID loop
+    if (current_vtx_channel != masterConfig.vtx_channel) {
+        current_vtx_channel = masterConfig.vtx_channel;
+        rtc6705_soft_spi_set_channel(vtx_freq[current_vtx_channel]);
+    }
+    rtc6705_soft_spi_set_rf_power(masterConfig.vtx_power);
 #endif // USE_RTC6705
 }
 
@@ -29,3 +29,24 @@ uint32_t zigzagEncode(int32_t value)
 {
     return (uint32_t)((value << 1) ^ (value >> 31));
 }
+
+/**
+ * Unpacks `count` little endian 11 bit values, as used for the RC channels of SBUS and CRSF, from
+ * `src` into `dst`. Bytes are shifted into an accumulator and a value is taken off the bottom
+ * whenever 11 bits are available, which is much cheaper than reading through packed bitfields.
+ */
+void unpack11BitValues(uint32_t *dst, const uint8_t *src, int count)
+{
+    uint32_t bits = 0;
+    int bitCount = 0;
+
+    while (count--) {
+        while (bitCount < 11) {
+            bits |= (uint32_t)*src++ << bitCount;
+            bitCount += 8;
+        }
+        *dst++ = bits & 0x7FF;
+        bits >>= 11;
+        bitCount -= 11;
+    }
+}
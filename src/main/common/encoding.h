@@ -21,3 +21,4 @@
 
 uint32_t castFloatBytesToInt(float f);
 uint32_t zigzagEncode(int32_t value);
+void unpack11BitValues(uint32_t *dst, const uint8_t *src, int count);
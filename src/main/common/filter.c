@@ -20,6 +20,8 @@
 #include <string.h>
 #include <math.h>
 
+#include "build/build_config.h"
+
 #include "common/filter.h"
 #include "common/maths.h"
 #include "common/utils.h"
@@ -39,6 +41,12 @@ float nullFilterApply(void *filter, float input)
     return input;
 }
 
+void nullFilter3Apply(void *filter, float *data)
+{
+    UNUSED(filter);
+    UNUSED(data);
+}
+
 
 // PT1 Low Pass filter
 
@@ -49,12 +57,28 @@ void pt1FilterInit(pt1Filter_t *filter, uint8_t f_cut, float dT)
     filter->k = filter->dT / (filter->RC + filter->dT);
 }
 
-float pt1FilterApply(pt1Filter_t *filter, float input)
+FAST_CODE float pt1FilterApply(pt1Filter_t *filter, float input)
 {
     filter->state = filter->state + filter->k * (input - filter->state);
     return filter->state;
 }
 
+void pt1Filter3Init(pt1Filter3_t *filter, uint8_t f_cut, float dT)
+{
+    const float RC = 1.0f / ( 2.0f * M_PI_FLOAT * f_cut );
+    filter->k = dT / (RC + dT);
+    memset(filter->state, 0, sizeof(filter->state));
+}
+
+FAST_CODE void pt1Filter3Apply(pt1Filter3_t *filter, float *data)
+{
+    const float k = filter->k;
+    for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+        filter->state[i] = filter->state[i] + k * (data[i] - filter->state[i]);
+        data[i] = filter->state[i];
+    }
+}
+
 float pt1FilterApply4(pt1Filter_t *filter, float input, uint8_t f_cut, float dT)
 {
     // Pre calculate and store RC
@@ -74,18 +98,36 @@ float filterGetNotchQ(uint16_t centerFreq, uint16_t cutoff) {
     return sqrtf(powf(2, octaves)) / (powf(2, octaves) - 1);
 }
 
-/* sets up a biquad Filter */
-void biquadFilterInitLPF(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate)
+// quarter sine wave, sin(i * pi / 2 / BIQUAD_SIN_TABLE_SIZE)
+#define BIQUAD_SIN_TABLE_SIZE 64
+static const float biquadSinTable[BIQUAD_SIN_TABLE_SIZE + 1] = {
+    0.00000000f, 0.02454123f, 0.04906767f, 0.07356456f, 0.09801714f, 0.12241068f, 0.14673047f, 0.17096189f,
+    0.19509032f, 0.21910124f, 0.24298018f, 0.26671276f, 0.29028468f, 0.31368174f, 0.33688985f, 0.35989504f,
+    0.38268343f, 0.40524131f, 0.42755509f, 0.44961133f, 0.47139674f, 0.49289819f, 0.51410274f, 0.53499762f,
+    0.55557023f, 0.57580819f, 0.59569930f, 0.61523159f, 0.63439328f, 0.65317284f, 0.67155895f, 0.68954054f,
+    0.70710678f, 0.72424708f, 0.74095113f, 0.75720885f, 0.77301045f, 0.78834643f, 0.80320753f, 0.81758481f,
+    0.83146961f, 0.84485357f, 0.85772861f, 0.87008699f, 0.88192126f, 0.89322430f, 0.90398929f, 0.91420976f,
+    0.92387953f, 0.93299280f, 0.94154407f, 0.94952818f, 0.95694034f, 0.96377607f, 0.97003125f, 0.97570213f,
+    0.98078528f, 0.98527764f, 0.98917651f, 0.99247953f, 0.99518473f, 0.99729046f, 0.99879546f, 0.99969882f,
+    1.00000000f
+};
+
+// linearly interpolated table sine, valid for -pi <= x <= pi, error below 1e-4
+static float biquadSin(float x)
 {
-    biquadFilterInit(filter, filterFreq, refreshRate, BIQUAD_Q, FILTER_LPF);
+    const float sign = (x < 0) ? -1.0f : 1.0f;
+    x = fabsf(x);
+    if (x > M_PI_FLOAT / 2) {
+        x = M_PI_FLOAT - x;
+    }
+    const float index = x * (BIQUAD_SIN_TABLE_SIZE * 2 / M_PI_FLOAT);
+    const int i = MIN((int)index, BIQUAD_SIN_TABLE_SIZE - 1);
+    const float fraction = index - i;
+    return sign * (biquadSinTable[i] + fraction * (biquadSinTable[i + 1] - biquadSinTable[i]));
 }
-void biquadFilterInit(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType)
+
+static void biquadFilterSetCoefficients(biquadFilter_t *filter, float sn, float cs, float Q, biquadFilterType_e filterType)
 {
-    // setup variables
-    const float sampleRate = 1 / ((float)refreshRate * 0.000001f);
-    const float omega = 2 * M_PI_FLOAT * filterFreq / sampleRate;
-    const float sn = sinf(omega);
-    const float cs = cosf(omega);
     const float alpha = sn / (2 * Q);
 
     float b0 = 0, b1 = 0, b2 = 0, a0 = 0, a1 = 0, a2 = 0;
@@ -110,18 +152,47 @@ void biquadFilterInit(biquadFilter_t *filter, float filterFreq, uint32_t refresh
     }
 
     // precompute the coefficients
-    filter->b0 = b0 / a0;
-    filter->b1 = b1 / a0;
-    filter->b2 = b2 / a0;
-    filter->a1 = a1 / a0;
-    filter->a2 = a2 / a0;
+    const float a0Reciprocal = 1.0f / a0;
+    filter->b0 = b0 * a0Reciprocal;
+    filter->b1 = b1 * a0Reciprocal;
+    filter->b2 = b2 * a0Reciprocal;
+    filter->a1 = a1 * a0Reciprocal;
+    filter->a2 = a2 * a0Reciprocal;
+}
+
+/* sets up a biquad Filter */
+void biquadFilterInitLPF(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate)
+{
+    biquadFilterInit(filter, filterFreq, refreshRate, BIQUAD_Q, FILTER_LPF);
+}
+void biquadFilterInit(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType)
+{
+    // setup variables
+    const float sampleRate = 1 / ((float)refreshRate * 0.000001f);
+    const float omega = 2 * M_PI_FLOAT * filterFreq / sampleRate;
+
+    biquadFilterSetCoefficients(filter, sinf(omega), cosf(omega), Q, filterType);
 
     // zero initial samples
     filter->d1 = filter->d2 = 0;
 }
 
+/*
+ * Recomputes the coefficients for a new centre or cutoff frequency, keeping the filter state.
+ * Cheap enough to be called every cycle: sin and cos come from a lookup table and there is no
+ * sample rate division, so adaptive filters can retune at loop rate.
+ */
+void biquadFilterUpdate(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType)
+{
+    const float omega = 2 * M_PI_FLOAT * filterFreq * (float)refreshRate * 0.000001f;
+    // cos from the half angle sine keeps the relative error small at low frequencies, where cos is close to 1
+    const float halfSn = biquadSin(omega / 2);
+
+    biquadFilterSetCoefficients(filter, biquadSin(omega), 1 - 2 * halfSn * halfSn, Q, filterType);
+}
+
 /* Computes a biquadFilter_t filter on a sample */
-float biquadFilterApply(biquadFilter_t *filter, float input)
+FAST_CODE float biquadFilterApply(biquadFilter_t *filter, float input)
 {
     const float result = filter->b0 * input + filter->d1;
     filter->d1 = filter->b1 * input - filter->a1 * result + filter->d2;
@@ -129,6 +200,162 @@ float biquadFilterApply(biquadFilter_t *filter, float input)
     return result;
 }
 
+void biquadFilter3InitLPF(biquadFilter3_t *filter, float filterFreq, uint32_t refreshRate)
+{
+    biquadFilter3Init(filter, filterFreq, refreshRate, BIQUAD_Q, FILTER_LPF);
+}
+
+static void biquadFilter3SetCoefficients(biquadFilter3_t *filter, const biquadFilter_t *coefficients)
+{
+    filter->b0 = coefficients->b0;
+    filter->b1 = coefficients->b1;
+    filter->b2 = coefficients->b2;
+    filter->a1 = coefficients->a1;
+    filter->a2 = coefficients->a2;
+}
+
+void biquadFilter3Init(biquadFilter3_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType)
+{
+    biquadFilter_t single;
+    biquadFilterInit(&single, filterFreq, refreshRate, Q, filterType);
+    biquadFilter3SetCoefficients(filter, &single);
+
+    memset(filter->d1, 0, sizeof(filter->d1));
+    memset(filter->d2, 0, sizeof(filter->d2));
+}
+
+/* recomputes the coefficients of a running filter through biquadFilterUpdate, the state is kept so the output does not jump */
+void biquadFilter3Update(biquadFilter3_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType)
+{
+    biquadFilter_t single;
+    biquadFilterUpdate(&single, filterFreq, refreshRate, Q, filterType);
+    biquadFilter3SetCoefficients(filter, &single);
+}
+
+/* sets up a biquadFilter3_t that outputs its input unchanged, for fixed filter chains with a stage turned off */
+void biquadFilter3InitPassThrough(biquadFilter3_t *filter)
+{
+    filter->b0 = 1.0f;
+    filter->b1 = filter->b2 = filter->a1 = filter->a2 = 0.0f;
+
+    memset(filter->d1, 0, sizeof(filter->d1));
+    memset(filter->d2, 0, sizeof(filter->d2));
+}
+
+/*
+ * Computes a biquadFilter3_t filter on one sample of each axis.
+ * The coefficients are loaded once and the axes are independent, so the loop unrolls into
+ * interleaved FPU operations without pipeline stalls between the dependent steps of each axis.
+ */
+FAST_CODE void biquadFilter3Apply(biquadFilter3_t *filter, float *data)
+{
+    const float b0 = filter->b0;
+    const float b1 = filter->b1;
+    const float b2 = filter->b2;
+    const float a1 = filter->a1;
+    const float a2 = filter->a2;
+
+    for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+        const float input = data[i];
+        const float result = b0 * input + filter->d1[i];
+        filter->d1[i] = b1 * input - a1 * result + filter->d2[i];
+        filter->d2[i] = b2 * input - a2 * result;
+        data[i] = result;
+    }
+}
+
+/* sets up a fixed point filter with the coefficients of an initialised float filter */
+void biquadFilter3IntInit(biquadFilter3Int_t *filter, const biquadFilter3_t *source)
+{
+    const float scale = 1 << BIQUAD_INT_COEFFICIENT_BITS;
+    filter->b0 = lrintf(source->b0 * scale);
+    filter->b1 = lrintf(source->b1 * scale);
+    filter->b2 = lrintf(source->b2 * scale);
+    filter->a1 = lrintf(source->a1 * scale);
+    filter->a2 = lrintf(source->a2 * scale);
+
+    memset(filter->d1, 0, sizeof(filter->d1));
+    memset(filter->d2, 0, sizeof(filter->d2));
+}
+
+/*
+ * Computes a biquadFilter3Int_t filter on one sample of each axis, in the same form as biquadFilterApply.
+ * Products are 64 bit (single SMULL/SMLAL instructions), so |data| must stay below 2^24 to leave
+ * headroom for the filter state.
+ */
+FAST_CODE void biquadFilter3IntApply(biquadFilter3Int_t *filter, int32_t *data)
+{
+    for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+        const int32_t input = data[i];
+        const int32_t result = (int32_t)(((int64_t)filter->b0 * input) >> BIQUAD_INT_COEFFICIENT_BITS) + filter->d1[i];
+        filter->d1[i] = (int32_t)(((int64_t)filter->b1 * input - (int64_t)filter->a1 * result) >> BIQUAD_INT_COEFFICIENT_BITS) + filter->d2[i];
+        filter->d2[i] = (int32_t)(((int64_t)filter->b2 * input - (int64_t)filter->a2 * result) >> BIQUAD_INT_COEFFICIENT_BITS);
+        data[i] = result;
+    }
+}
+
+/* sets up stageCount notches at filterFreq, with the state cleared */
+void notchFilterBankInit(notchFilterBank_t *bank, uint8_t stageCount, float filterFreq, uint32_t refreshRate, float Q)
+{
+    bank->stageCount = MIN(stageCount, NOTCH_BANK_MAX_STAGES);
+    for (int stage = 0; stage < bank->stageCount; stage++) {
+        notchFilterBankUpdate(bank, stage, filterFreq, refreshRate, Q);
+    }
+
+    memset(bank->d1, 0, sizeof(bank->d1));
+    memset(bank->d2, 0, sizeof(bank->d2));
+}
+
+/* retunes one stage through the table sine of biquadFilterUpdate, the state is kept */
+void notchFilterBankUpdate(notchFilterBank_t *bank, uint8_t stage, float filterFreq, uint32_t refreshRate, float Q)
+{
+    const float omega = 2 * M_PI_FLOAT * filterFreq * (float)refreshRate * 0.000001f;
+    const float halfSn = biquadSin(omega / 2);
+    const float cs = 1 - 2 * halfSn * halfSn;
+    const float alpha = biquadSin(omega) / (2 * Q);
+    const float a0Reciprocal = 1.0f / (1 + alpha);
+
+    bank->b0[stage] = a0Reciprocal;
+    bank->b1[stage] = -2 * cs * a0Reciprocal;
+    bank->a2[stage] = (1 - alpha) * a0Reciprocal;
+}
+
+/*
+ * Runs one sample of each axis through all stages in turn.
+ * Each stage is biquadFilter3Apply with b2 = b0 and a1 = b1 folded in, three multiplies per axis instead of five.
+ */
+FAST_CODE void notchFilterBankApply(notchFilterBank_t *bank, float *data)
+{
+    float x0 = data[0];
+    float x1 = data[1];
+    float x2 = data[2];
+
+    for (int stage = 0; stage < bank->stageCount; stage++) {
+        const float b0 = bank->b0[stage];
+        const float b1 = bank->b1[stage];
+        const float a2 = bank->a2[stage];
+        float *d1 = bank->d1[stage];
+        float *d2 = bank->d2[stage];
+
+        const float y0 = b0 * x0 + d1[0];
+        const float y1 = b0 * x1 + d1[1];
+        const float y2 = b0 * x2 + d1[2];
+        d1[0] = b1 * (x0 - y0) + d2[0];
+        d1[1] = b1 * (x1 - y1) + d2[1];
+        d1[2] = b1 * (x2 - y2) + d2[2];
+        d2[0] = b0 * x0 - a2 * y0;
+        d2[1] = b0 * x1 - a2 * y1;
+        d2[2] = b0 * x2 - a2 * y2;
+        x0 = y0;
+        x1 = y1;
+        x2 = y2;
+    }
+
+    data[0] = x0;
+    data[1] = x1;
+    data[2] = x2;
+}
+
 /*
  * FIR filter
  */
@@ -232,7 +459,7 @@ void firFilterDenoiseInit(firFilterDenoise_t *filter, uint8_t gyroSoftLpfHz, uin
 }
 
 // prototype function for denoising of signal by dynamic moving average. Mainly for test purposes
-float firFilterDenoiseUpdate(firFilterDenoise_t *filter, float input)
+FAST_CODE float firFilterDenoiseUpdate(firFilterDenoise_t *filter, float input)
 {
     filter->state[filter->index] = input;
     filter->movingSum += filter->state[filter->index++];
@@ -246,3 +473,10 @@ float firFilterDenoiseUpdate(firFilterDenoise_t *filter, float input)
         return filter->movingSum / ++filter->filledCount + 1;
 }
 
+// filter is an array of FILTER3_AXIS_COUNT denoise filters, one per axis
+FAST_CODE void firFilterDenoise3Apply(firFilterDenoise_t *filter, float *data)
+{
+    for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+        data[i] = firFilterDenoiseUpdate(&filter[i], data[i]);
+    }
+}
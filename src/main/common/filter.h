@@ -36,6 +36,43 @@ typedef struct biquadFilter_s {
     float d1, d2;
 } biquadFilter_t;
 
+#define FILTER3_AXIS_COUNT 3
+
+typedef struct pt1Filter3_s {
+    float state[FILTER3_AXIS_COUNT];
+    float k;
+} pt1Filter3_t;
+
+/* three axes sharing one set of coefficients, state is held per axis */
+typedef struct biquadFilter3_s {
+    float b0, b1, b2, a1, a2;
+    float d1[FILTER3_AXIS_COUNT];
+    float d2[FILTER3_AXIS_COUNT];
+} biquadFilter3_t;
+
+/* fixed point version of biquadFilter3_t for targets without FPU, coefficients are Q29 */
+#define BIQUAD_INT_COEFFICIENT_BITS 29
+typedef struct biquadFilter3Int_s {
+    int32_t b0, b1, b2, a1, a2;
+    int32_t d1[FILTER3_AXIS_COUNT];
+    int32_t d2[FILTER3_AXIS_COUNT];
+} biquadFilter3Int_t;
+
+/*
+ * cascade of notches run on three axes, for many notches retuned every cycle.
+ * A notch has b2 == b0 and a1 == b1, so a stage is three coefficients; they are held
+ * in arrays by stage and shared by the axes, whose state is interleaved per stage.
+ */
+#define NOTCH_BANK_MAX_STAGES 12
+typedef struct notchFilterBank_s {
+    uint8_t stageCount;
+    float b0[NOTCH_BANK_MAX_STAGES];
+    float b1[NOTCH_BANK_MAX_STAGES];
+    float a2[NOTCH_BANK_MAX_STAGES];
+    float d1[NOTCH_BANK_MAX_STAGES][FILTER3_AXIS_COUNT];
+    float d2[NOTCH_BANK_MAX_STAGES][FILTER3_AXIS_COUNT];
+} notchFilterBank_t;
+
 typedef struct firFilterDenoise_s{
     int filledCount;
     int targetCount;
@@ -66,18 +103,37 @@ typedef struct firFilter_s {
 } firFilter_t;
 
 typedef float (*filterApplyFnPtr)(void *filter, float input);
+typedef void (*filter3ApplyFnPtr)(void *filter, float *data);   // filters FILTER3_AXIS_COUNT values in place
 
 float nullFilterApply(void *filter, float input);
+void nullFilter3Apply(void *filter, float *data);
 
 void biquadFilterInitLPF(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate);
 void biquadFilterInit(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType);
+void biquadFilterUpdate(biquadFilter_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType);
 float biquadFilterApply(biquadFilter_t *filter, float input);
 float filterGetNotchQ(uint16_t centerFreq, uint16_t cutoff);
 
+void biquadFilter3InitLPF(biquadFilter3_t *filter, float filterFreq, uint32_t refreshRate);
+void biquadFilter3Init(biquadFilter3_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType);
+void biquadFilter3InitPassThrough(biquadFilter3_t *filter);
+void biquadFilter3Update(biquadFilter3_t *filter, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType);
+
+void biquadFilter3IntInit(biquadFilter3Int_t *filter, const biquadFilter3_t *source);
+void biquadFilter3IntApply(biquadFilter3Int_t *filter, int32_t *data);
+void biquadFilter3Apply(biquadFilter3_t *filter, float *data);
+
+void notchFilterBankInit(notchFilterBank_t *bank, uint8_t stageCount, float filterFreq, uint32_t refreshRate, float Q);
+void notchFilterBankUpdate(notchFilterBank_t *bank, uint8_t stage, float filterFreq, uint32_t refreshRate, float Q);
+void notchFilterBankApply(notchFilterBank_t *bank, float *data);
+
 void pt1FilterInit(pt1Filter_t *filter, uint8_t f_cut, float dT);
 float pt1FilterApply(pt1Filter_t *filter, float input);
 float pt1FilterApply4(pt1Filter_t *filter, float input, uint8_t f_cut, float dT);
 
+void pt1Filter3Init(pt1Filter3_t *filter, uint8_t f_cut, float dT);
+void pt1Filter3Apply(pt1Filter3_t *filter, float *data);
+
 void firFilterInit(firFilter_t *filter, float *buf, uint8_t bufLength, const float *coeffs);
 void firFilterInit2(firFilter_t *filter, float *buf, uint8_t bufLength, const float *coeffs, uint8_t coeffsLength);
 void firFilterUpdate(firFilter_t *filter, float input);
@@ -90,4 +146,5 @@ float firFilterLastInput(const firFilter_t *filter);
 
 void firFilterDenoiseInit(firFilterDenoise_t *filter, uint8_t gyroSoftLpfHz, uint16_t targetLooptime);
 float firFilterDenoiseUpdate(firFilterDenoise_t *filter, float input);
+void firFilterDenoise3Apply(firFilterDenoise_t *filter, float *data);
 
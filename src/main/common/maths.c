@@ -15,9 +15,15 @@
  * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
+#include "platform.h"
+
+#include "build/build_config.h"
+
 #include "axis.h"
 #include "maths.h"
 
@@ -99,6 +105,131 @@ float acos_approx(float x)
 }
 #endif
 
+#ifdef USE_TRIG_LUT
+/*
+ * Table sine and arctangent with linear interpolation, cheaper than the polynomials and accurate to about 2e-5.
+ * The tables are built at boot from the polynomials and kept in the fastest RAM, flash wait states would
+ * otherwise eat most of the saving. acos_approx() is already cheaper than an acos taken from the arctangent
+ * table, and acos itself is too steep near +-1 for an evenly spaced table.
+ */
+#define SIN_LUT_SIZE 128    // steps over a quarter turn, a power of two
+#define ATAN_LUT_SIZE 128   // steps over tangents of 0..1
+
+static FAST_RAM_ZERO_INIT float sinLut[SIN_LUT_SIZE + 1];
+static FAST_RAM_ZERO_INIT float atanLut[ATAN_LUT_SIZE + 1];
+
+void trigLutInit(void)
+{
+    for (int i = 0; i <= SIN_LUT_SIZE; i++) {
+        sinLut[i] = sin_approx(i * (0.5f * M_PIf) / SIN_LUT_SIZE);
+    }
+    for (int i = 0; i <= ATAN_LUT_SIZE; i++) {
+        atanLut[i] = atan2_approx(i, ATAN_LUT_SIZE);
+    }
+    atanLut[0] = 0.0f;  // the polynomial is 3e-7 out at 0, keep atan2 of 0 exact
+}
+
+// sin_lut maximum absolute error = 1.9e-05
+float sin_lut(float x)
+{
+    int32_t xint = x;
+    if (xint < -32 || xint > 32) return 0.0f;                               // Stop here on error input (5 * 360 Deg)
+
+    const float position = x * (SIN_LUT_SIZE / (0.5f * M_PIf));
+    int32_t step = position;
+    if (position < step) {
+        step--;                                                             // round towards minus infinity
+    }
+    const float fraction = position - step;
+
+    // two's complement wraps negative angles onto the same four quadrants
+    const uint32_t phase = (uint32_t)step & (4 * SIN_LUT_SIZE - 1);
+    const uint32_t index = phase & (SIN_LUT_SIZE - 1);
+    float low, high;
+    if (phase & SIN_LUT_SIZE) {
+        // second and fourth quadrants read the table backwards
+        low = sinLut[SIN_LUT_SIZE - index];
+        high = sinLut[SIN_LUT_SIZE - index - 1];
+    } else {
+        low = sinLut[index];
+        high = sinLut[index + 1];
+    }
+    const float result = low + fraction * (high - low);
+    return (phase & (2 * SIN_LUT_SIZE)) ? -result : result;
+}
+
+float cos_lut(float x)
+{
+    return sin_lut(x + (0.5f * M_PIf));
+}
+
+// atan2_lut maximum absolute error = 5e-06 rads
+float atan2_lut(float y, float x)
+{
+    const float absX = fabsf(x);
+    const float absY = fabsf(y);
+    float res = MAX(absX, absY);
+    if (res) res = MIN(absX, absY) / res;
+    else res = 0.0f;
+
+    const float position = res * ATAN_LUT_SIZE;
+    const int index = MIN((int)position, ATAN_LUT_SIZE - 1);
+    res = atanLut[index] + (position - index) * (atanLut[index + 1] - atanLut[index]);
+
+    if (absY > absX) res = (M_PIf / 2.0f) - res;
+    if (x < 0) res = M_PIf - res;
+    if (y < 0) res = -res;
+    return res;
+}
+#endif
+
+// Integer atan2 for the navigation code, in centidegrees (-18000..18000)
+// atan(z) ~ pi/4 * z + z * (1 - z) * (0.2447 + 0.0663 * z), maximum absolute error below 0.1 degree
+int32_t atan2_approx_int(int32_t y, int32_t x)
+{
+    uint32_t absX = ABS((int64_t)x);
+    uint32_t absY = ABS((int64_t)y);
+    uint32_t hi = MAX(absX, absY);
+    uint32_t lo = MIN(absX, absY);
+
+    if (!hi) {
+        return 0;
+    }
+    // keep lo << 15 inside 32 bits, the ratio only needs 15 bits
+    while (hi >= (1 << 16)) {
+        hi >>= 1;
+        lo >>= 1;
+    }
+    const int32_t z = (lo << 15) / hi;     // Q15, 0..1
+    int32_t res = (4500 * z + ((z * (32768 - z)) >> 15) * (1402 + ((380 * z) >> 15)) + (1 << 14)) >> 15;
+
+    if (absY > absX) res = 9000 - res;
+    if (x < 0) res = 18000 - res;
+    if (y < 0) res = -res;
+    return res;
+}
+
+// bitwise integer square root, rounded down
+uint32_t sqrt_int64(uint64_t x)
+{
+    uint64_t res = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
 float powerf(float base, int exp) {
     float result = base;
     for (int count = 1; count < exp; count++) result *= base;
@@ -318,6 +449,86 @@ float quickMedianFilter9f(float * v)
     return p[4];
 }
 
+void slidingWindowInit(slidingWindow_t *window, uint8_t size)
+{
+    window->size = constrain(size, 1, SLIDING_WINDOW_SIZE_MAX);
+    window->count = 0;
+    window->index = 0;
+    window->sum = 0;
+    window->sumSq = 0;
+}
+
+// position of the first sorted sample that is not below value
+static int slidingWindowSearch(const slidingWindow_t *window, int32_t value)
+{
+    int low = 0;
+    int high = window->count;
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (window->sorted[mid] < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void slidingWindowPush(slidingWindow_t *window, int32_t sample)
+{
+    if (window->count == window->size) {
+        const int32_t oldest = window->samples[window->index];
+        const int pos = slidingWindowSearch(window, oldest);
+        window->count--;
+        memmove(&window->sorted[pos], &window->sorted[pos + 1], (window->count - pos) * sizeof(window->sorted[0]));
+        window->sum -= oldest;
+        window->sumSq -= (int64_t)oldest * oldest;
+    }
+
+    const int pos = slidingWindowSearch(window, sample);
+    memmove(&window->sorted[pos + 1], &window->sorted[pos], (window->count - pos) * sizeof(window->sorted[0]));
+    window->sorted[pos] = sample;
+    window->count++;
+    window->sum += sample;
+    window->sumSq += (int64_t)sample * sample;
+
+    window->samples[window->index] = sample;
+    if (++window->index >= window->size) {
+        window->index = 0;
+    }
+}
+
+bool slidingWindowIsFull(const slidingWindow_t *window)
+{
+    return window->count == window->size;
+}
+
+// the middle sample, or the mean of the middle two while the count is even
+int32_t slidingWindowMedian(const slidingWindow_t *window)
+{
+    if (!window->count) {
+        return 0;
+    }
+    const int32_t low = window->sorted[(window->count - 1) / 2];
+    const int32_t high = window->sorted[window->count / 2];
+    return low + (high - low) / 2;
+}
+
+int32_t slidingWindowMean(const slidingWindow_t *window)
+{
+    return window->count ? window->sum / window->count : 0;
+}
+
+// sample variance, the sums are exact so there is no loss from subtracting them
+float slidingWindowVariance(const slidingWindow_t *window)
+{
+    if (window->count < 2) {
+        return 0.0f;
+    }
+    const int64_t n = window->count;
+    return (float)(n * window->sumSq - window->sum * window->sum) / (float)(n * (n - 1));
+}
+
 void arraySubInt32(int32_t *dest, int32_t *array1, int32_t *array2, int count)
 {
     for (int i = 0; i < count; i++) {
@@ -337,25 +548,124 @@ fix12_t  qConstruct(int16_t num, int16_t den) {
     return (num << 12) / den;
 }
 
+// CRC of the top nibble shifted out, for polynomial 0x1021. A nibble table is 32 bytes, small enough for every target.
+static const uint16_t crc16CcittNibbleTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
 uint16_t crc16_ccitt(uint16_t crc, unsigned char a)
 {
-    crc ^= (uint16_t)a << 8;
-    for (int ii = 0; ii < 8; ++ii) {
-        if (crc & 0x8000) {
-            crc = (crc << 1) ^ 0x1021;
-        } else {
-            crc = crc << 1;
-        }
+    crc = (crc << 4) ^ crc16CcittNibbleTable[(crc >> 12) ^ (a >> 4)];
+    crc = (crc << 4) ^ crc16CcittNibbleTable[(crc >> 12) ^ (a & 0x0f)];
+    return crc;
+}
+
+uint16_t crc16_ccitt_buf(uint16_t crc, const void *data, uint32_t length)
+{
+    const uint8_t *p = data;
+    while (length--) {
+        crc = crc16_ccitt(crc, *p++);
     }
     return crc;
 }
 
+#ifdef USE_CRC8_TABLE
+// CRC of every byte value for polynomial 0xD5 (DVB-S2), one lookup per byte instead of eight shifts
+static const uint8_t crc8DvbS2Table[256] = {
+    0x00, 0xd5, 0x7f, 0xaa, 0xfe, 0x2b, 0x81, 0x54, 0x29, 0xfc, 0x56, 0x83, 0xd7, 0x02, 0xa8, 0x7d,
+    0x52, 0x87, 0x2d, 0xf8, 0xac, 0x79, 0xd3, 0x06, 0x7b, 0xae, 0x04, 0xd1, 0x85, 0x50, 0xfa, 0x2f,
+    0xa4, 0x71, 0xdb, 0x0e, 0x5a, 0x8f, 0x25, 0xf0, 0x8d, 0x58, 0xf2, 0x27, 0x73, 0xa6, 0x0c, 0xd9,
+    0xf6, 0x23, 0x89, 0x5c, 0x08, 0xdd, 0x77, 0xa2, 0xdf, 0x0a, 0xa0, 0x75, 0x21, 0xf4, 0x5e, 0x8b,
+    0x9d, 0x48, 0xe2, 0x37, 0x63, 0xb6, 0x1c, 0xc9, 0xb4, 0x61, 0xcb, 0x1e, 0x4a, 0x9f, 0x35, 0xe0,
+    0xcf, 0x1a, 0xb0, 0x65, 0x31, 0xe4, 0x4e, 0x9b, 0xe6, 0x33, 0x99, 0x4c, 0x18, 0xcd, 0x67, 0xb2,
+    0x39, 0xec, 0x46, 0x93, 0xc7, 0x12, 0xb8, 0x6d, 0x10, 0xc5, 0x6f, 0xba, 0xee, 0x3b, 0x91, 0x44,
+    0x6b, 0xbe, 0x14, 0xc1, 0x95, 0x40, 0xea, 0x3f, 0x42, 0x97, 0x3d, 0xe8, 0xbc, 0x69, 0xc3, 0x16,
+    0xef, 0x3a, 0x90, 0x45, 0x11, 0xc4, 0x6e, 0xbb, 0xc6, 0x13, 0xb9, 0x6c, 0x38, 0xed, 0x47, 0x92,
+    0xbd, 0x68, 0xc2, 0x17, 0x43, 0x96, 0x3c, 0xe9, 0x94, 0x41, 0xeb, 0x3e, 0x6a, 0xbf, 0x15, 0xc0,
+    0x4b, 0x9e, 0x34, 0xe1, 0xb5, 0x60, 0xca, 0x1f, 0x62, 0xb7, 0x1d, 0xc8, 0x9c, 0x49, 0xe3, 0x36,
+    0x19, 0xcc, 0x66, 0xb3, 0xe7, 0x32, 0x98, 0x4d, 0x30, 0xe5, 0x4f, 0x9a, 0xce, 0x1b, 0xb1, 0x64,
+    0x72, 0xa7, 0x0d, 0xd8, 0x8c, 0x59, 0xf3, 0x26, 0x5b, 0x8e, 0x24, 0xf1, 0xa5, 0x70, 0xda, 0x0f,
+    0x20, 0xf5, 0x5f, 0x8a, 0xde, 0x0b, 0xa1, 0x74, 0x09, 0xdc, 0x76, 0xa3, 0xf7, 0x22, 0x88, 0x5d,
+    0xd6, 0x03, 0xa9, 0x7c, 0x28, 0xfd, 0x57, 0x82, 0xff, 0x2a, 0x80, 0x55, 0x01, 0xd4, 0x7e, 0xab,
+    0x84, 0x51, 0xfb, 0x2e, 0x7a, 0xaf, 0x05, 0xd0, 0xad, 0x78, 0xd2, 0x07, 0x53, 0x86, 0x2c, 0xf9
+};
+
+// CRC of every byte value for polynomial 0x07
+static const uint8_t crc8Poly07Table[256] = {
+    0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
+    0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65, 0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
+    0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5, 0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
+    0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85, 0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
+    0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2, 0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
+    0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2, 0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
+    0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32, 0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
+    0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42, 0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
+    0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c, 0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
+    0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec, 0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
+    0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c, 0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
+    0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c, 0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
+    0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b, 0x76, 0x71, 0x78, 0x7f, 0x6a, 0x6d, 0x64, 0x63,
+    0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b, 0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
+    0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb, 0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8d, 0x84, 0x83,
+    0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
+};
+
 uint8_t crc8_dvb_s2(uint8_t crc, unsigned char a)
+{
+    return crc8DvbS2Table[crc ^ a];
+}
+
+uint8_t crc8_poly_0x07(uint8_t crc, unsigned char a)
+{
+    return crc8Poly07Table[crc ^ a];
+}
+#else
+// the first 16 entries of the byte table, two lookups per byte for 16 bytes of flash
+static const uint8_t crc8DvbS2NibbleTable[16] = {
+    0x00, 0xd5, 0x7f, 0xaa, 0xfe, 0x2b, 0x81, 0x54, 0x29, 0xfc, 0x56, 0x83, 0xd7, 0x02, 0xa8, 0x7d
+};
+
+uint8_t crc8_dvb_s2(uint8_t crc, unsigned char a)
+{
+    crc ^= a;
+    crc = (crc << 4) ^ crc8DvbS2NibbleTable[crc >> 4];
+    crc = (crc << 4) ^ crc8DvbS2NibbleTable[crc >> 4];
+    return crc;
+}
+
+uint8_t crc8_poly_0x07(uint8_t crc, unsigned char a)
+{
+    // the low three bits of the polynomial make the eight shifts collapse into a few xors
+    crc ^= a;
+    return crc ^ (crc << 1) ^ (crc << 2) ^ (0x0e090700 >> ((crc >> 3) & 0x18));
+}
+#endif
+
+uint8_t crc8_dvb_s2_buf(uint8_t crc, const void *data, uint32_t length)
+{
+    const uint8_t *p = data;
+    while (length--) {
+        crc = crc8_dvb_s2(crc, *p++);
+    }
+    return crc;
+}
+
+uint8_t crc8_poly_0x07_buf(uint8_t crc, const void *data, uint32_t length)
+{
+    const uint8_t *p = data;
+    while (length--) {
+        crc = crc8_poly_0x07(crc, *p++);
+    }
+    return crc;
+}
+
+uint8_t crc8_poly_0xba(uint8_t crc, unsigned char a)
 {
     crc ^= a;
     for (int ii = 0; ii < 8; ++ii) {
         if (crc & 0x80) {
-            crc = (crc << 1) ^ 0xD5;
+            crc = (crc << 1) ^ 0xBA;
         } else {
             crc = crc << 1;
         }
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifndef sq
 #define sq(x) ((x)*(x))
 #endif
@@ -45,6 +48,22 @@ typedef struct stdev_s
     int m_n;
 } stdev_t;
 
+#define SLIDING_WINDOW_SIZE_MAX 16
+
+/*
+ * The last size samples, kept in arrival order and in sorted order with running sums. A new sample is placed with
+ * a binary search and a short shift instead of sorting the window again, the median, mean and variance are lookups.
+ */
+typedef struct slidingWindow_s {
+    int32_t samples[SLIDING_WINDOW_SIZE_MAX];   // ring in arrival order
+    int32_t sorted[SLIDING_WINDOW_SIZE_MAX];
+    int64_t sum;
+    int64_t sumSq;
+    uint8_t size;
+    uint8_t count;
+    uint8_t index;                              // next slot in samples, holds the oldest sample once full
+} slidingWindow_t;
+
 // Floating point 3 vector.
 typedef struct fp_vector {
     float X;
@@ -96,6 +115,13 @@ float quickMedianFilter5f(float * v);
 float quickMedianFilter7f(float * v);
 float quickMedianFilter9f(float * v);
 
+void slidingWindowInit(slidingWindow_t *window, uint8_t size);
+void slidingWindowPush(slidingWindow_t *window, int32_t sample);
+bool slidingWindowIsFull(const slidingWindow_t *window);
+int32_t slidingWindowMedian(const slidingWindow_t *window);
+int32_t slidingWindowMean(const slidingWindow_t *window);
+float slidingWindowVariance(const slidingWindow_t *window);
+
 #if defined(FAST_MATH) || defined(VERY_FAST_MATH)
 float sin_approx(float x);
 float cos_approx(float x);
@@ -110,6 +136,22 @@ float acos_approx(float x);
 #define tan_approx(x)       tanf(x)
 #endif
 
+// table versions for the flight loop, less accurate than the _approx functions but cheaper, see maths.c
+#ifdef USE_TRIG_LUT
+void trigLutInit(void);
+float sin_lut(float x);
+float cos_lut(float x);
+float atan2_lut(float y, float x);
+#else
+#define trigLutInit()       do {} while (0)
+#define sin_lut(x)          sin_approx(x)
+#define cos_lut(x)          cos_approx(x)
+#define atan2_lut(y,x)      atan2_approx(y,x)
+#endif
+
+int32_t atan2_approx_int(int32_t y, int32_t x);
+uint32_t sqrt_int64(uint64_t x);
+
 void arraySubInt32(int32_t *dest, int32_t *array1, int32_t *array2, int count);
 
 int16_t qPercent(fix12_t q);
@@ -136,5 +178,10 @@ static inline float constrainf(float amt, float low, float high)
         return amt;
 }
 uint16_t crc16_ccitt(uint16_t crc, unsigned char a);
+uint16_t crc16_ccitt_buf(uint16_t crc, const void *data, uint32_t length);
 uint8_t crc8_dvb_s2(uint8_t crc, unsigned char a);
+uint8_t crc8_dvb_s2_buf(uint8_t crc, const void *data, uint32_t length);
+uint8_t crc8_poly_0x07(uint8_t crc, unsigned char a);
+uint8_t crc8_poly_0x07_buf(uint8_t crc, const void *data, uint32_t length);
+uint8_t crc8_poly_0xba(uint8_t crc, unsigned char a);
 
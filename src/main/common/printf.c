@@ -33,11 +33,13 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "platform.h"
 
 #include "build/build_config.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 
 #include "drivers/serial.h"
@@ -57,41 +59,103 @@ typedef void (*putcf) (void *, char);
 static putcf stdout_putf;
 static void *stdout_putp;
 
+// characters gathered on the stack before each call to the sink
+#define PRINTF_CHUNK_SIZE 64
+// digits after the point %f is limited to, the fraction is worked out in a uint32_t
+#define PRINTF_FLOAT_MAX_PRECISION 6
+
+typedef struct printfOutput_s {
+    tfpWrite_t write;
+    void *arg;
+    int used;
+    int written;
+    char buf[PRINTF_CHUNK_SIZE];
+} printfOutput_t;
+
+static void outFlush(printfOutput_t *out)
+{
+    if (out->used) {
+        out->write(out->arg, out->buf, out->used);
+        out->used = 0;
+    }
+}
+
+static void outChar(printfOutput_t *out, char ch)
+{
+    if (out->used == PRINTF_CHUNK_SIZE) {
+        outFlush(out);
+    }
+    out->buf[out->used++] = ch;
+    out->written++;
+}
+
 // print bf, padded from left to at least n characters.
 // padding is zero ('0') if z!=0, space (' ') otherwise
-static int putchw(void *putp, putcf putf, int n, char z, char *bf)
+static void outPadded(printfOutput_t *out, int n, char z, const char *bf)
 {
-    int written = 0;
-    char fc = z ? '0' : ' ';
-    char ch;
-    char *p = bf;
+    const char fc = z ? '0' : ' ';
+    const char *p = bf;
     while (*p++ && n > 0)
         n--;
     while (n-- > 0) {
-        putf(putp, fc); written++;
+        outChar(out, fc);
     }
-    while ((ch = *bf++)) {
-        putf(putp, ch); written++;
+    while (*bf) {
+        outChar(out, *bf++);
+    }
+}
+
+// fixed point conversion, bf must hold 20 characters. Magnitudes past the uint32_t range print as "ovf"
+static void f2a(float num, int precision, char *bf)
+{
+    static const uint32_t scales[PRINTF_FLOAT_MAX_PRECISION + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+    const uint32_t scale = scales[precision];
+
+    if (num != num) {
+        strcpy(bf, "nan");
+        return;
+    }
+    if (num < 0) {
+        *bf++ = '-';
+        num = -num;
+    }
+    num += 0.5f / scale;    // round at the last digit printed
+    if (num >= 4294967040.0f) {
+        strcpy(bf, "ovf");
+        return;
+    }
+
+    const uint32_t integer = (uint32_t)num;
+    const uint32_t fraction = MIN((uint32_t)((num - integer) * scale), scale - 1);
+
+    ui2a(integer, 10, 0, bf);
+    if (precision) {
+        bf += strlen(bf);
+        *bf++ = '.';
+        for (uint32_t digit = scale / 10; digit; digit /= 10) {
+            *bf++ = '0' + (fraction / digit) % 10;
+        }
+        *bf = '\0';
     }
-    return written;
 }
 
 // retrun number of bytes written
-int tfp_format(void *putp, putcf putf, const char *fmt, va_list va)
+int tfp_format_buffered(void *arg, tfpWrite_t write, const char *fmt, va_list va)
 {
-    char bf[12];
-    int written = 0;
+    printfOutput_t out = { .write = write, .arg = arg };
+    char bf[20];
     char ch;
 
     while ((ch = *(fmt++))) {
         if (ch != '%') {
-            putf(putp, ch); written++;
+            outChar(&out, ch);
         } else {
             char lz = 0;
 #ifdef  REQUIRE_PRINTF_LONG_SUPPORT
             char lng = 0;
 #endif
             int w = 0;
+            int precision = -1;
             ch = *(fmt++);
             if (ch == '0') {
                 ch = *(fmt++);
@@ -100,6 +164,13 @@ int tfp_format(void *putp, putcf putf, const char *fmt, va_list va)
             if (ch >= '0' && ch <= '9') {
                 ch = a2i(ch, &fmt, 10, &w);
             }
+            if (ch == '.') {
+                precision = 0;
+                ch = *(fmt++);
+                if (ch >= '0' && ch <= '9') {
+                    ch = a2i(ch, &fmt, 10, &precision);
+                }
+            }
 #ifdef  REQUIRE_PRINTF_LONG_SUPPORT
             if (ch == 'l') {
                 ch = *(fmt++);
@@ -116,7 +187,7 @@ int tfp_format(void *putp, putcf putf, const char *fmt, va_list va)
                     else
 #endif
                         ui2a(va_arg(va, unsigned int), 10, 0, bf);
-                    written += putchw(putp, putf, w, lz, bf);
+                    outPadded(&out, w, lz, bf);
                     break;
                 }
             case 'd':{
@@ -126,7 +197,7 @@ int tfp_format(void *putp, putcf putf, const char *fmt, va_list va)
                     else
 #endif
                         i2a(va_arg(va, int), bf);
-                    written += putchw(putp, putf, w, lz, bf);
+                    outPadded(&out, w, lz, bf);
                     break;
                 }
             case 'x':
@@ -137,19 +208,24 @@ int tfp_format(void *putp, putcf putf, const char *fmt, va_list va)
                 else
 #endif
                     ui2a(va_arg(va, unsigned int), 16, (ch == 'X'), bf);
-                written += putchw(putp, putf, w, lz, bf);
+                outPadded(&out, w, lz, bf);
+                break;
+            case 'f':
+                // floats arrive as doubles, they're narrowed straight away so no double arithmetic is done
+                f2a((float)va_arg(va, double), precision < 0 ? PRINTF_FLOAT_MAX_PRECISION : MIN(precision, PRINTF_FLOAT_MAX_PRECISION), bf);
+                outPadded(&out, w, lz, bf);
                 break;
             case 'c':
-                putf(putp, (char) (va_arg(va, int))); written++;
+                outChar(&out, (char) (va_arg(va, int)));
                 break;
             case 's':
-                written += putchw(putp, putf, w, 0, va_arg(va, char *));
+                outPadded(&out, w, 0, va_arg(va, char *));
                 break;
             case '%':
-                putf(putp, ch); written++;
+                outChar(&out, ch);
                 break;
             case 'n':
-                *va_arg(va, int*) = written;
+                *va_arg(va, int*) = out.written;
                 break;
             default:
                 break;
@@ -157,7 +233,27 @@ int tfp_format(void *putp, putcf putf, const char *fmt, va_list va)
         }
     }
 abort:
-    return written;
+    outFlush(&out);
+    return out.written;
+}
+
+typedef struct putcfSink_s {
+    putcf putf;
+    void *putp;
+} putcfSink_t;
+
+static void putcfWrite(void *arg, const char *data, int len)
+{
+    const putcfSink_t *sink = arg;
+    while (len--) {
+        sink->putf(sink->putp, *data++);
+    }
+}
+
+int tfp_format(void *putp, putcf putf, const char *fmt, va_list va)
+{
+    putcfSink_t sink = { .putf = putf, .putp = putp };
+    return tfp_format_buffered(&sink, putcfWrite, fmt, va);
 }
 
 void init_printf(void *putp, void (*putf) (void *, char))
@@ -176,9 +272,11 @@ int tfp_printf(const char *fmt, ...)
     return written;
 }
 
-static void putcp(void *p, char c)
+static void sprintfWrite(void *arg, const char *data, int len)
 {
-    *(*((char **) p))++ = c;
+    char **s = arg;
+    memcpy(*s, data, len);
+    *s += len;
 }
 
 int tfp_sprintf(char *s, const char *fmt, ...)
@@ -186,8 +284,8 @@ int tfp_sprintf(char *s, const char *fmt, ...)
     va_list va;
 
     va_start(va, fmt);
-    int written = tfp_format(&s, putcp, fmt, va);
-    putcp(&s, 0);
+    int written = tfp_format_buffered(&s, sprintfWrite, fmt, va);
+    *s = 0;
     va_end(va);
     return written;
 }
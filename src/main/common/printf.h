@@ -45,7 +45,8 @@ into your project.
 
 Two printf variants are provided: printf and sprintf.
 
-The formats supported by this implementation are: 'd' 'u' 'c' 's' 'x' 'X'.
+The formats supported by this implementation are: 'd' 'u' 'c' 's' 'x' 'X' 'f'.
+'f' takes a precision of up to 6 digits, 6 by default, and needs the float cast to double.
 
 Zero padding and field width are also supported.
 
@@ -113,6 +114,10 @@ int tfp_sprintf(char *s, const char *fmt, ...);
 
 int tfp_format(void *putp, void (*putf) (void *, char), const char *fmt, va_list va);
 
+// formats into a chunk on the stack and passes it to write(), one call per chunk rather than per character
+typedef void (*tfpWrite_t)(void *arg, const char *data, int len);
+int tfp_format_buffered(void *arg, tfpWrite_t write, const char *fmt, va_list va);
+
 #define printf tfp_printf
 #define sprintf tfp_sprintf
 
@@ -18,6 +18,8 @@
 #include <string.h>
 #include <stdint.h>
 
+#include "common/maths.h"
+
 #include "streambuf.h"
 
 void sbufWriteU8(sbuf_t *dst, uint8_t val)
@@ -104,3 +106,117 @@ void sbufSwitchToReader(sbuf_t *buf, uint8_t *base)
     buf->end = buf->ptr;
     buf->ptr = base;
 }
+
+// moves on to the part at the start of the ring once the part up to the end of the ring is used up
+static void sbufRingWrap(sbufRing_t *buf)
+{
+    if (buf->seg.ptr == buf->seg.end && buf->wrapLen) {
+        buf->seg.ptr = buf->ring;
+        buf->seg.end = buf->ring + buf->wrapLen;
+        buf->wrapLen = 0;
+    }
+}
+
+// views len bytes of a ring of ringSize bytes, starting at offset start
+void sbufRingInit(sbufRing_t *buf, uint8_t *ring, uint32_t ringSize, uint32_t start, uint32_t len)
+{
+    const uint32_t firstLen = MIN(len, ringSize - start);
+
+    buf->seg.ptr = ring + start;
+    buf->seg.end = buf->seg.ptr + firstLen;
+    buf->ring = ring;
+    buf->wrapLen = len - firstLen;
+    buf->length = len;
+    sbufRingWrap(buf);
+}
+
+void sbufRingWriteU8(sbufRing_t *dst, uint8_t val)
+{
+    *dst->seg.ptr++ = val;
+    sbufRingWrap(dst);
+}
+
+void sbufRingWriteU16(sbufRing_t *dst, uint16_t val)
+{
+    sbufRingWriteU8(dst, val >> 0);
+    sbufRingWriteU8(dst, val >> 8);
+}
+
+void sbufRingWriteU32(sbufRing_t *dst, uint32_t val)
+{
+    sbufRingWriteU8(dst, val >> 0);
+    sbufRingWriteU8(dst, val >> 8);
+    sbufRingWriteU8(dst, val >> 16);
+    sbufRingWriteU8(dst, val >> 24);
+}
+
+void sbufRingWriteData(sbufRing_t *dst, const void *data, int len)
+{
+    const uint8_t *p = data;
+    while (len > 0 && sbufBytesRemaining(&dst->seg)) {
+        const int chunk = MIN(len, sbufBytesRemaining(&dst->seg));
+        sbufWriteData(&dst->seg, p, chunk);
+        sbufRingWrap(dst);
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+uint8_t sbufRingReadU8(sbufRing_t *src)
+{
+    const uint8_t ret = *src->seg.ptr++;
+    sbufRingWrap(src);
+    return ret;
+}
+
+uint16_t sbufRingReadU16(sbufRing_t *src)
+{
+    uint16_t ret;
+    ret = sbufRingReadU8(src);
+    ret |= sbufRingReadU8(src) << 8;
+    return ret;
+}
+
+uint32_t sbufRingReadU32(sbufRing_t *src)
+{
+    uint32_t ret;
+    ret = sbufRingReadU8(src);
+    ret |= sbufRingReadU8(src) <<  8;
+    ret |= sbufRingReadU8(src) << 16;
+    ret |= sbufRingReadU8(src) << 24;
+    return ret;
+}
+
+// unlike sbufReadData() this advances past the data read
+void sbufRingReadData(sbufRing_t *src, void *data, int len)
+{
+    uint8_t *p = data;
+    while (len > 0 && sbufBytesRemaining(&src->seg)) {
+        const int chunk = MIN(len, sbufBytesRemaining(&src->seg));
+        memcpy(p, src->seg.ptr, chunk);
+        sbufRingAdvance(src, chunk);
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+int sbufRingBytesRemaining(const sbufRing_t *buf)
+{
+    return buf->seg.end - buf->seg.ptr + buf->wrapLen;
+}
+
+// bytes read or written since the view was taken, what to consume or commit
+int sbufRingBytesUsed(const sbufRing_t *buf)
+{
+    return buf->length - sbufRingBytesRemaining(buf);
+}
+
+void sbufRingAdvance(sbufRing_t *buf, int size)
+{
+    while (size > 0 && sbufBytesRemaining(&buf->seg)) {
+        const int chunk = MIN(size, sbufBytesRemaining(&buf->seg));
+        buf->seg.ptr += chunk;
+        sbufRingWrap(buf);
+        size -= chunk;
+    }
+}
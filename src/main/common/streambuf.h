@@ -43,3 +43,27 @@ uint8_t* sbufPtr(sbuf_t *buf);
 void sbufAdvance(sbuf_t *buf, int size);
 
 void sbufSwitchToReader(sbuf_t *buf, uint8_t * base);
+
+// a segment of a ring buffer, such as a serial port's RX or TX ring, that wraps past the end of the ring to its start
+typedef struct sbufRing_s {
+    sbuf_t seg;             // contiguous part of the segment still to be read or written
+    uint8_t *ring;          // start of the ring, where the segment continues
+    uint32_t wrapLen;       // length of the segment at the start of the ring, 0 once seg has wrapped
+    uint32_t length;
+} sbufRing_t;
+
+void sbufRingInit(sbufRing_t *buf, uint8_t *ring, uint32_t ringSize, uint32_t start, uint32_t len);
+
+void sbufRingWriteU8(sbufRing_t *dst, uint8_t val);
+void sbufRingWriteU16(sbufRing_t *dst, uint16_t val);
+void sbufRingWriteU32(sbufRing_t *dst, uint32_t val);
+void sbufRingWriteData(sbufRing_t *dst, const void *data, int len);
+
+uint8_t sbufRingReadU8(sbufRing_t *src);
+uint16_t sbufRingReadU16(sbufRing_t *src);
+uint32_t sbufRingReadU32(sbufRing_t *src);
+void sbufRingReadData(sbufRing_t *src, void *data, int len);
+
+int sbufRingBytesRemaining(const sbufRing_t *buf);
+int sbufRingBytesUsed(const sbufRing_t *buf);
+void sbufRingAdvance(sbufRing_t *buf, int size);
@@ -21,6 +21,8 @@
 
 #include "platform.h"
 
+#include "common/maths.h"
+
 #include "drivers/system.h"
 
 #include "config/config_master.h"
@@ -119,6 +121,240 @@ void initEEPROM(void)
 {
 }
 
+/*
+ * The config area holds a full image of master_t followed by a log of the changes saved since. Each save
+ * appends the byte ranges that differ from the stored config as records, closed by a commit record, so a
+ * save only programs what changed. The area is erased and a fresh image written only once the log fills,
+ * or when the stored image is no longer valid. On targets where the config owns a whole flash sector the
+ * log gets the rest of the sector.
+ */
+#if defined(STM32F40_41xxx) || defined(STM32F411xE) || defined(STM32F7)
+#define CONFIG_AREA_SIZE                FLASH_PAGE_SIZE
+#else
+#define CONFIG_AREA_SIZE                FLASH_TO_RESERVE_FOR_CONFIG
+#endif
+
+#define CONFIG_LOG_START                ((CONFIG_START_FLASH_ADDRESS + sizeof(master_t) + 3) & ~3)
+#define CONFIG_LOG_END                  (CONFIG_START_FLASH_ADDRESS + CONFIG_AREA_SIZE)
+#define CONFIG_LOG_MAX_RECORD_LENGTH    255
+#define CONFIG_LOG_MERGE_GAP            4       // unchanged bytes between two changes cheaper to rewrite than a new header
+#define CONFIG_LOG_COMMIT_OFFSET        0xFFFE
+#define CONFIG_LOG_CHUNK_SIZE           32
+
+typedef struct configLogRecord_s {
+    uint16_t offset;    // into master_t, or CONFIG_LOG_COMMIT_OFFSET for the record that closes a save
+    uint8_t length;
+    uint8_t crc;        // over the offset, the length and the data
+} configLogRecord_t;
+
+typedef struct configLogState_s {
+    uintptr_t committedEnd; // records past this belong to a save that never completed
+    uintptr_t end;          // first word that is not a valid record
+} configLogState_t;
+
+#define CONFIG_LOG_RECORD_SIZE(length) (sizeof(configLogRecord_t) + (((length) + 3) & ~3))
+
+static uint8_t configLogRecordCrc(uint16_t offset, uint8_t length, const uint8_t *data)
+{
+    const uint8_t header[] = { offset & 0xFF, offset >> 8, length };
+    const uint8_t crc = crc8_dvb_s2_buf(0, header, sizeof(header));
+    return crc8_dvb_s2_buf(crc, data, length);
+}
+
+static bool configLogRecordValid(uintptr_t address)
+{
+    if (address + sizeof(configLogRecord_t) > CONFIG_LOG_END) {
+        return false;
+    }
+    const configLogRecord_t *record = (const configLogRecord_t *)address;
+    if (record->offset == CONFIG_LOG_COMMIT_OFFSET) {
+        return record->length == 0 && record->crc == configLogRecordCrc(record->offset, 0, NULL);
+    }
+    return record->offset + record->length <= sizeof(master_t)
+        && address + CONFIG_LOG_RECORD_SIZE(record->length) <= CONFIG_LOG_END
+        && record->crc == configLogRecordCrc(record->offset, record->length, (const uint8_t *)(record + 1));
+}
+
+static configLogState_t configLogScan(void)
+{
+    configLogState_t state = { .committedEnd = CONFIG_LOG_START, .end = CONFIG_LOG_START };
+
+    while (configLogRecordValid(state.end)) {
+        const configLogRecord_t *record = (const configLogRecord_t *)state.end;
+        state.end += CONFIG_LOG_RECORD_SIZE(record->length);
+        if (record->offset == CONFIG_LOG_COMMIT_OFFSET) {
+            state.committedEnd = state.end;
+        }
+    }
+    return state;
+}
+
+// copies a range of the stored config, with the committed log replayed over the image
+static void configLogRead(uint8_t *dest, uint16_t offset, uint16_t length, uintptr_t committedEnd)
+{
+    memcpy(dest, (const uint8_t *)CONFIG_START_FLASH_ADDRESS + offset, length);
+
+    for (uintptr_t address = CONFIG_LOG_START; address < committedEnd; ) {
+        const configLogRecord_t *record = (const configLogRecord_t *)address;
+        const uint16_t start = MAX(record->offset, offset);
+        const uint16_t end = MIN(record->offset + record->length, offset + length);
+        if (record->offset != CONFIG_LOG_COMMIT_OFFSET && start < end) {
+            memcpy(dest + start - offset, (const uint8_t *)(record + 1) + start - record->offset, end - start);
+        }
+        address += CONFIG_LOG_RECORD_SIZE(record->length);
+    }
+}
+
+static bool configLogErased(uintptr_t address, uint32_t size)
+{
+    for (uint32_t offset = 0; offset < size; offset += 4) {
+        if (*(const uint32_t *)(address + offset) != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(STM32F7)
+static void configFlashUnlock(void)
+{
+    HAL_FLASH_Unlock();
+}
+
+static void configFlashLock(void)
+{
+    HAL_FLASH_Lock();
+}
+
+// FIXME: HAL for now this will only work for F4/F7 as flash layout is different
+static bool configFlashErase(void)
+{
+    FLASH_EraseInitTypeDef EraseInitStruct = {0};
+    EraseInitStruct.TypeErase     = FLASH_TYPEERASE_SECTORS;
+    EraseInitStruct.VoltageRange  = FLASH_VOLTAGE_RANGE_3; // 2.7-3.6V
+    EraseInitStruct.Sector        = (FLASH_SECTOR_TOTAL-1);
+    EraseInitStruct.NbSectors     = 1;
+    uint32_t SECTORError;
+    return HAL_FLASHEx_Erase(&EraseInitStruct, &SECTORError) == HAL_OK;
+}
+
+static bool configFlashProgramWord(uintptr_t address, uint32_t value)
+{
+    return HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address, value) == HAL_OK;
+}
+#else
+static void configFlashUnlock(void)
+{
+    FLASH_Unlock();
+#if defined(STM32F4)
+    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+#elif defined(STM32F303)
+    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPERR);
+#elif defined(STM32F10X)
+    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+#endif
+}
+
+static void configFlashLock(void)
+{
+    FLASH_Lock();
+}
+
+static bool configFlashErase(void)
+{
+#if defined(STM32F40_41xxx)
+    return FLASH_EraseSector(FLASH_Sector_8, VoltageRange_3) == FLASH_COMPLETE; //0x08080000 to 0x080A0000
+#elif defined (STM32F411xE)
+    return FLASH_EraseSector(FLASH_Sector_7, VoltageRange_3) == FLASH_COMPLETE; //0x08060000 to 0x08080000
+#else
+    for (uint32_t offset = 0; offset < CONFIG_AREA_SIZE; offset += FLASH_PAGE_SIZE) {
+        if (FLASH_ErasePage(CONFIG_START_FLASH_ADDRESS + offset) != FLASH_COMPLETE) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+static bool configFlashProgramWord(uintptr_t address, uint32_t value)
+{
+    return FLASH_ProgramWord(address, value) == FLASH_COMPLETE;
+}
+#endif
+
+typedef union configLogRecordBuffer_u {
+    configLogRecord_t record;
+    uint32_t words[CONFIG_LOG_RECORD_SIZE(CONFIG_LOG_MAX_RECORD_LENGTH) / 4];
+} configLogRecordBuffer_t;
+
+// returns the words the record takes
+static int configLogBuildRecord(configLogRecordBuffer_t *buffer, uint16_t offset, uint8_t length, const uint8_t *data)
+{
+    memset(buffer, 0xFF, sizeof(*buffer));
+    buffer->record.offset = offset;
+    buffer->record.length = length;
+    buffer->record.crc = configLogRecordCrc(offset, length, data);
+    if (length) {
+        memcpy(&buffer->record + 1, data, length);
+    }
+    return CONFIG_LOG_RECORD_SIZE(length) / 4;
+}
+
+// the header goes last, so a record cut short by a reset never reads back as valid
+static bool configLogProgramRecord(uintptr_t address, uint16_t offset, uint8_t length, const uint8_t *data)
+{
+    configLogRecordBuffer_t buffer;
+    const int wordCount = configLogBuildRecord(&buffer, offset, length, data);
+
+    for (int i = 1; i < wordCount; i++) {
+        if (!configFlashProgramWord(address + i * 4, buffer.words[i])) {
+            return false;
+        }
+    }
+    return configFlashProgramWord(address, buffer.words[0]);
+}
+
+/*
+ * Walks the bytes of masterConfig that differ from the stored config as records, programming them from
+ * address onwards when program is set. Returns the bytes the records take, or -1 if programming failed.
+ */
+static int configLogAppendChanges(uintptr_t address, uintptr_t committedEnd, bool program)
+{
+    const uint8_t *current = (const uint8_t *)&masterConfig;
+    uint8_t stored[CONFIG_LOG_CHUNK_SIZE];
+    int size = 0;
+    int changeStart = -1;
+    int changeEnd = 0;
+
+    for (int i = 0; i <= (int)sizeof(master_t); i++) {
+        bool changed = false;
+        if (i < (int)sizeof(master_t)) {
+            if (i % CONFIG_LOG_CHUNK_SIZE == 0) {
+                configLogRead(stored, i, MIN(CONFIG_LOG_CHUNK_SIZE, sizeof(master_t) - i), committedEnd);
+            }
+            changed = current[i] != stored[i % CONFIG_LOG_CHUNK_SIZE];
+            if (!changed) {
+                continue;
+            }
+            if (changeStart >= 0 && i - changeEnd < CONFIG_LOG_MERGE_GAP && i - changeStart < CONFIG_LOG_MAX_RECORD_LENGTH) {
+                changeEnd = i + 1;
+                continue;
+            }
+        }
+        if (changeStart >= 0) {
+            const uint8_t length = changeEnd - changeStart;
+            if (program && !configLogProgramRecord(address + size, changeStart, length, current + changeStart)) {
+                return -1;
+            }
+            size += CONFIG_LOG_RECORD_SIZE(length);
+        }
+        changeStart = i;
+        changeEnd = i + 1;
+    }
+
+    return size;
+}
+
 static uint8_t calculateChecksum(const uint8_t *data, uint32_t length)
 {
     uint8_t checksum = 0;
@@ -151,133 +387,313 @@ bool isEEPROMContentValid(void)
     return true;
 }
 
-#if defined(STM32F7)
+// appends the changes since the last save to the log, false if they don't fit or the flash write failed
+static bool writeEEPROMChanges(void)
+{
+    if (!isEEPROMContentValid()) {
+        return false;
+    }
 
-// FIXME: HAL for now this will only work for F4/F7 as flash layout is different
-void writeEEPROM(void)
+    const configLogState_t log = configLogScan();
+    if (log.end != log.committedEnd) {
+        return false;
+    }
+
+    // the image checksum only covers the image, the records carry their own
+    masterConfig.chk = ((const master_t *) CONFIG_START_FLASH_ADDRESS)->chk;
+
+    const int size = configLogAppendChanges(log.end, log.committedEnd, false);
+    if (size == 0) {
+        return true;
+    }
+
+    const uintptr_t commitAddress = log.end + size;
+    if (commitAddress + sizeof(configLogRecord_t) > CONFIG_LOG_END
+        || !configLogErased(log.end, size + sizeof(configLogRecord_t))) {
+        return false;
+    }
+
+    configFlashUnlock();
+    bool ok = configLogAppendChanges(log.end, log.committedEnd, true) == size
+        && configLogProgramRecord(commitAddress, CONFIG_LOG_COMMIT_OFFSET, 0, NULL);
+    configFlashLock();
+
+    if (ok) {
+        const configLogState_t written = configLogScan();
+        ok = written.committedEnd == commitAddress + sizeof(configLogRecord_t)
+            && configLogAppendChanges(written.end, written.committedEnd, false) == 0;
+    }
+    return ok;
+}
+
+static bool writeEEPROMImage(void)
 {
-    // Generate compile time error if the config does not fit in the reserved area of flash.
-    BUILD_BUG_ON(sizeof(master_t) > FLASH_TO_RESERVE_FOR_CONFIG);
+    masterConfig.chk = 0; // erase checksum before recalculating
+    masterConfig.chk = calculateChecksum((const uint8_t *) &masterConfig, sizeof(master_t));
 
-    HAL_StatusTypeDef status;
-    uint32_t wordOffset;
+    bool ok = false;
     int8_t attemptsRemaining = 3;
 
-    suspendRxSignal();
+    configFlashUnlock();
+    while (!ok && attemptsRemaining--) {
+        ok = configFlashErase();
+        for (uint32_t wordOffset = 0; ok && wordOffset < sizeof(master_t); wordOffset += 4) {
+            ok = configFlashProgramWord(CONFIG_START_FLASH_ADDRESS + wordOffset, *(uint32_t *) ((char *) &masterConfig + wordOffset));
+        }
+    }
+    configFlashLock();
 
+    return ok && isEEPROMContentValid();
+}
+
+static void prepareEEPROMHeader(void)
+{
     // prepare checksum/version constants
     masterConfig.version = EEPROM_CONF_VERSION;
     masterConfig.size = sizeof(master_t);
     masterConfig.magic_be = 0xBE;
     masterConfig.magic_ef = 0xEF;
-    masterConfig.chk = 0; // erase checksum before recalculating
-    masterConfig.chk = calculateChecksum((const uint8_t *) &masterConfig, sizeof(master_t));
+}
 
-    // write it
-    /* Unlock the Flash to enable the flash control register access *************/
-    HAL_FLASH_Unlock();
-    while (attemptsRemaining--)
-    {
-        /* Fill EraseInit structure*/
-        FLASH_EraseInitTypeDef EraseInitStruct = {0};
-        EraseInitStruct.TypeErase     = FLASH_TYPEERASE_SECTORS;
-        EraseInitStruct.VoltageRange  = FLASH_VOLTAGE_RANGE_3; // 2.7-3.6V
-        EraseInitStruct.Sector        = (FLASH_SECTOR_TOTAL-1);
-        EraseInitStruct.NbSectors     = 1;
-        uint32_t SECTORError;
-        status = HAL_FLASHEx_Erase(&EraseInitStruct, &SECTORError);
-        if (status != HAL_OK)
-        {
-            continue;
-        }
-        else
-        {
-            for (wordOffset = 0; wordOffset < sizeof(master_t); wordOffset += 4)
-            {
-                status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, CONFIG_START_FLASH_ADDRESS + wordOffset, *(uint32_t *) ((char *) &masterConfig + wordOffset));
-                if(status != HAL_OK)
-                {
-                    break;
-                }
-            }
-        }
-        if (status == HAL_OK) {
-            break;
-        }
-    }
-    HAL_FLASH_Lock();
+typedef enum {
+    DEFERRED_WRITE_IDLE = 0,
+    DEFERRED_WRITE_START,
+    DEFERRED_WRITE_COMPARE,
+    DEFERRED_WRITE_PROGRAM,
+    DEFERRED_WRITE_ERASE
+} deferredWritePhase_e;
+
+typedef struct deferredWrite_s {
+    deferredWritePhase_e phase;
+    eepromWriteStatus_e result;     // of the last save, reported once when it is complete
+    bool requested;                 // asked for again while in progress, the save starts over once done
+    bool appended;
+    bool committing;
+    uint16_t cursor;                // next byte of master_t to compare
+    int16_t changeStart;            // first byte of the change being collected, or -1
+    uint16_t changeEnd;
+    uintptr_t address;              // of the record being programmed
+    uintptr_t committedEnd;
+    uint8_t wordIndex;              // next word of the record to program, the header word goes last
+    uint8_t wordCount;
+    configLogRecordBuffer_t buffer;
+} deferredWrite_t;
+
+static deferredWrite_t deferredWrite;
+
+void writeEEPROM(void)
+{
+    // Generate compile time error if the config does not fit in the reserved area of flash.
+    BUILD_BUG_ON(sizeof(master_t) > FLASH_TO_RESERVE_FOR_CONFIG);
+
+    suspendRxSignal();
+
+    prepareEEPROMHeader();
 
     // Flash write failed - just die now
-    if (status != HAL_OK || !isEEPROMContentValid()) {
+    if (!writeEEPROMChanges() && !writeEEPROMImage()) {
         failureMode(FAILURE_FLASH_WRITE_FAILED);
     }
 
+    // this covers a deferred save in progress, whose uncommitted records are left to the next compaction
+    if (deferredWrite.phase != DEFERRED_WRITE_IDLE) {
+        deferredWrite.phase = DEFERRED_WRITE_IDLE;
+        deferredWrite.requested = false;
+        deferredWrite.result = EEPROM_WRITE_COMPLETE;
+    }
+
     resumeRxSignal();
 }
-#else
-void writeEEPROM(void)
+
+/*
+ * Queues a save that processDeferredEEPROMWrite() carries out a step at a time. A step compares one chunk of
+ * the config or programs one flash word, which stalls the core for well under the PID loop time. The config
+ * area is only erased, which stalls it for up to seconds on sector flash, when the caller allows it.
+ */
+void writeEEPROMDeferred(void)
 {
-    // Generate compile time error if the config does not fit in the reserved area of flash.
-    BUILD_BUG_ON(sizeof(master_t) > FLASH_TO_RESERVE_FOR_CONFIG);
+    if (deferredWrite.phase == DEFERRED_WRITE_IDLE) {
+        deferredWrite.phase = DEFERRED_WRITE_START;
+        deferredWrite.result = EEPROM_WRITE_IDLE;
+    } else {
+        deferredWrite.requested = true;
+    }
+}
 
-    FLASH_Status status = 0;
-    uint32_t wordOffset;
-    int8_t attemptsRemaining = 3;
+static void deferredWriteStart(void)
+{
+    prepareEEPROMHeader();
 
-    suspendRxSignal();
+    if (!isEEPROMContentValid()) {
+        deferredWrite.phase = DEFERRED_WRITE_ERASE;
+        return;
+    }
 
-    // prepare checksum/version constants
-    masterConfig.version = EEPROM_CONF_VERSION;
-    masterConfig.size = sizeof(master_t);
-    masterConfig.magic_be = 0xBE;
-    masterConfig.magic_ef = 0xEF;
-    masterConfig.chk = 0; // erase checksum before recalculating
-    masterConfig.chk = calculateChecksum((const uint8_t *) &masterConfig, sizeof(master_t));
+    const configLogState_t log = configLogScan();
+    if (log.end != log.committedEnd) {
+        deferredWrite.phase = DEFERRED_WRITE_ERASE;
+        return;
+    }
 
-    // write it
-    FLASH_Unlock();
-    while (attemptsRemaining--) {
-#if defined(STM32F4)
-        FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
-#elif defined(STM32F303)
-        FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPERR);
-#elif defined(STM32F10X)
-        FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
-#endif
-        for (wordOffset = 0; wordOffset < sizeof(master_t); wordOffset += 4) {
-            if (wordOffset % FLASH_PAGE_SIZE == 0) {
-#if defined(STM32F40_41xxx)
-                status = FLASH_EraseSector(FLASH_Sector_8, VoltageRange_3); //0x08080000 to 0x080A0000
-#elif defined (STM32F411xE)
-                status = FLASH_EraseSector(FLASH_Sector_7, VoltageRange_3); //0x08060000 to 0x08080000
-#else
-                status = FLASH_ErasePage(CONFIG_START_FLASH_ADDRESS + wordOffset);
-#endif
-                if (status != FLASH_COMPLETE) {
-                    break;
-                }
-            }
+    masterConfig.chk = ((const master_t *) CONFIG_START_FLASH_ADDRESS)->chk;
+
+    deferredWrite.address = log.end;
+    deferredWrite.committedEnd = log.committedEnd;
+    deferredWrite.cursor = 0;
+    deferredWrite.changeStart = -1;
+    deferredWrite.appended = false;
+    deferredWrite.committing = false;
+    deferredWrite.phase = DEFERRED_WRITE_COMPARE;
+}
+
+static void deferredWriteQueueRecord(uint16_t offset, uint8_t length, const uint8_t *data)
+{
+    const uint32_t size = CONFIG_LOG_RECORD_SIZE(length);
+    const uint32_t reserve = offset == CONFIG_LOG_COMMIT_OFFSET ? 0 : sizeof(configLogRecord_t);
+
+    if (deferredWrite.address + size + reserve > CONFIG_LOG_END || !configLogErased(deferredWrite.address, size + reserve)) {
+        deferredWrite.phase = DEFERRED_WRITE_ERASE;
+        return;
+    }
+
+    deferredWrite.wordCount = configLogBuildRecord(&deferredWrite.buffer, offset, length, data);
+    deferredWrite.wordIndex = deferredWrite.wordCount > 1 ? 1 : 0;
+    deferredWrite.phase = DEFERRED_WRITE_PROGRAM;
+}
 
-            status = FLASH_ProgramWord(CONFIG_START_FLASH_ADDRESS + wordOffset,
-                    *(uint32_t *) ((char *) &masterConfig + wordOffset));
-            if (status != FLASH_COMPLETE) {
-                break;
+static void deferredWriteCompare(void)
+{
+    const uint8_t *current = (const uint8_t *)&masterConfig;
+    uint8_t stored[CONFIG_LOG_CHUNK_SIZE];
+    const uint16_t start = deferredWrite.cursor;
+    const uint16_t length = MIN(CONFIG_LOG_CHUNK_SIZE, sizeof(master_t) - start);
+
+    configLogRead(stored, start, length, deferredWrite.committedEnd);
+
+    for (int i = start; i < start + length; i++) {
+        if (current[i] == stored[i - start]) {
+            continue;
+        }
+        if (deferredWrite.changeStart >= 0) {
+            if (i - deferredWrite.changeEnd < CONFIG_LOG_MERGE_GAP && i - deferredWrite.changeStart < CONFIG_LOG_MAX_RECORD_LENGTH) {
+                deferredWrite.changeEnd = i + 1;
+                continue;
             }
+            // this byte starts the next change, once the record before it is programmed
+            deferredWrite.cursor = i;
+            const uint16_t offset = deferredWrite.changeStart;
+            deferredWrite.changeStart = -1;
+            deferredWriteQueueRecord(offset, deferredWrite.changeEnd - offset, current + offset);
+            return;
         }
-        if (status == FLASH_COMPLETE) {
-            break;
+        deferredWrite.changeStart = i;
+        deferredWrite.changeEnd = i + 1;
+    }
+    deferredWrite.cursor = start + length;
+
+    if (deferredWrite.cursor < sizeof(master_t)) {
+        return;
+    }
+    if (deferredWrite.changeStart >= 0) {
+        const uint16_t offset = deferredWrite.changeStart;
+        deferredWrite.changeStart = -1;
+        deferredWriteQueueRecord(offset, deferredWrite.changeEnd - offset, current + offset);
+    } else if (deferredWrite.appended) {
+        deferredWrite.committing = true;
+        deferredWriteQueueRecord(CONFIG_LOG_COMMIT_OFFSET, 0, NULL);
+    } else {
+        deferredWrite.phase = DEFERRED_WRITE_IDLE;
+        deferredWrite.result = EEPROM_WRITE_COMPLETE;
+    }
+}
+
+static void deferredWriteProgram(void)
+{
+    const uintptr_t address = deferredWrite.address + deferredWrite.wordIndex * 4;
+    const uint32_t value = deferredWrite.buffer.words[deferredWrite.wordIndex];
+
+    configFlashUnlock();
+    const bool ok = configFlashProgramWord(address, value);
+    configFlashLock();
+
+    if (!ok || *(const uint32_t *)address != value) {
+        // a failed word can't be programmed again, the save falls back to writing a fresh image
+        deferredWrite.phase = DEFERRED_WRITE_ERASE;
+        return;
+    }
+
+    if (deferredWrite.wordIndex != 0) {
+        deferredWrite.wordIndex = deferredWrite.wordIndex + 1 < deferredWrite.wordCount ? deferredWrite.wordIndex + 1 : 0;
+        return;
+    }
+
+    deferredWrite.address += deferredWrite.wordCount * 4;
+    deferredWrite.appended = true;
+    if (deferredWrite.committing) {
+        deferredWrite.phase = DEFERRED_WRITE_IDLE;
+        deferredWrite.result = EEPROM_WRITE_COMPLETE;
+    } else {
+        deferredWrite.phase = DEFERRED_WRITE_COMPARE;
+    }
+}
+
+/*
+ * Runs one step of a queued save. Returns EEPROM_WRITE_COMPLETE once, from the step that finished it, and
+ * EEPROM_WRITE_FAILED if the config couldn't be written, rather than stopping in failureMode().
+ */
+eepromWriteStatus_e processDeferredEEPROMWrite(bool eraseAllowed)
+{
+    switch (deferredWrite.phase) {
+    case DEFERRED_WRITE_IDLE:
+        break;
+    case DEFERRED_WRITE_START:
+        deferredWriteStart();
+        break;
+    case DEFERRED_WRITE_COMPARE:
+        deferredWriteCompare();
+        break;
+    case DEFERRED_WRITE_PROGRAM:
+        deferredWriteProgram();
+        break;
+    case DEFERRED_WRITE_ERASE:
+        if (!eraseAllowed) {
+            return EEPROM_WRITE_WAITING_FOR_ERASE;
         }
+        suspendRxSignal();
+        prepareEEPROMHeader();
+        deferredWrite.phase = DEFERRED_WRITE_IDLE;
+        deferredWrite.result = writeEEPROMImage() ? EEPROM_WRITE_COMPLETE : EEPROM_WRITE_FAILED;
+        resumeRxSignal();
+        break;
     }
-    FLASH_Lock();
 
-    // Flash write failed - just die now
-    if (status != FLASH_COMPLETE || !isEEPROMContentValid()) {
-        failureMode(FAILURE_FLASH_WRITE_FAILED);
+    if (deferredWrite.phase != DEFERRED_WRITE_IDLE) {
+        return EEPROM_WRITE_PENDING;
+    }
+    if (deferredWrite.requested) {
+        deferredWrite.requested = false;
+        deferredWrite.phase = DEFERRED_WRITE_START;
+        return EEPROM_WRITE_PENDING;
     }
 
-    resumeRxSignal();
+    const eepromWriteStatus_e result = deferredWrite.result;
+    if (result == EEPROM_WRITE_COMPLETE) {
+        deferredWrite.result = EEPROM_WRITE_IDLE;
+    }
+    return result;
+}
+
+eepromWriteStatus_e deferredEEPROMWriteStatus(void)
+{
+    switch (deferredWrite.phase) {
+    case DEFERRED_WRITE_IDLE:
+        return deferredWrite.result;
+    case DEFERRED_WRITE_ERASE:
+        return EEPROM_WRITE_WAITING_FOR_ERASE;
+    default:
+        return EEPROM_WRITE_PENDING;
+    }
 }
-#endif
 
 void readEEPROM(void)
 {
@@ -288,7 +704,7 @@ void readEEPROM(void)
     suspendRxSignal();
 
     // Read flash
-    memcpy(&masterConfig, (char *) CONFIG_START_FLASH_ADDRESS, sizeof(master_t));
+    configLogRead((uint8_t *) &masterConfig, 0, sizeof(master_t), configLogScan().committedEnd);
 
     if (masterConfig.current_profile_index > MAX_PROFILE_COUNT - 1) // sanity check
         masterConfig.current_profile_index = 0;
@@ -19,8 +19,20 @@
 
 #define EEPROM_CONF_VERSION 147
 
+typedef enum {
+    EEPROM_WRITE_IDLE = 0,
+    EEPROM_WRITE_PENDING,
+    EEPROM_WRITE_WAITING_FOR_ERASE,     // the log is full, the config area is erased once that is allowed
+    EEPROM_WRITE_COMPLETE,
+    EEPROM_WRITE_FAILED
+} eepromWriteStatus_e;
+
 void initEEPROM(void);
 void writeEEPROM();
 void readEEPROM(void);
 bool isEEPROMContentValid(void);
 
+void writeEEPROMDeferred(void);
+eepromWriteStatus_e processDeferredEEPROMWrite(bool eraseAllowed);
+eepromWriteStatus_e deferredEEPROMWriteStatus(void);
+
@@ -34,6 +34,7 @@
 #include "drivers/light_led.h"
 #include "drivers/flash.h"
 
+#include "fc/fc_tasks.h"
 #include "fc/rc_controls.h"
 
 #include "flight/failsafe.h"
@@ -99,6 +100,7 @@
 #define blackboxConfig(x) (&masterConfig.blackboxConfig)
 #define flashConfig(x) (&masterConfig.flashConfig)
 #define pidConfig(x) (&masterConfig.pidConfig)
+#define taskSheddingConfig(x) (&masterConfig.taskSheddingConfig)
 #define adjustmentProfile(x) (&masterConfig.adjustmentProfile)
 #define modeActivationProfile(x) (&masterConfig.modeActivationProfile)
 #define servoProfile(x) (&masterConfig.servoProfile)
@@ -135,8 +137,12 @@ typedef struct master_s {
 
     pidConfig_t pidConfig;
 
+    taskSheddingConfig_t taskSheddingConfig;
+
     uint8_t debug_mode;                     // Processing denominator for PID controller vs gyro sampling rate
 
+    uint8_t idle_sleep;                     // wait for an interrupt when no task is due
+
     gyroConfig_t gyroConfig;
     compassConfig_t compassConfig;
 
@@ -211,6 +217,10 @@ typedef struct master_s {
     vcdProfile_t vcdProfile;
 #endif
 
+#ifdef USE_MSP_DISPLAYPORT
+    uint8_t displayport_msp_batch;  // coalesce displayport writes into batch packets, the external OSD must support them
+#endif
+
 #ifdef USE_SDCARD
     sdcardConfig_t sdcardConfig;
 #endif
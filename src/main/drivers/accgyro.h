@@ -35,6 +35,8 @@
 #define GYRO_LPF_5HZ        6
 #define GYRO_LPF_NONE       7
 
+#define GYRO_FIFO_MAX_SAMPLES 10                            // enough for gyro_sync_denom 8 plus some scheduling jitter
+
 typedef struct gyroDev_s {
     sensorGyroInitFuncPtr init;                             // initialize function
     sensorGyroReadFuncPtr read;                             // read 3 axis data function
@@ -45,6 +47,15 @@ typedef struct gyroDev_s {
     int16_t gyroADCRaw[XYZ_AXIS_COUNT];
     uint16_t lpf;
     volatile bool dataReady;
+    volatile uint32_t dataReadyAt;                          // micros() at the data ready interrupt, only kept with USE_LOOP_LATENCY
+    bool useDma;                                            // read samples using a DMA burst started from the data ready interrupt
+    bool dmaEnabled;                                        // set by the driver when the DMA read path is active
+    sensorGyroDataReadyCallbackFuncPtr dataReadyCallback;   // called from interrupt context when a DMA sample has completed
+    sensorGyroDataReadyCallbackFuncPtr sampleCallback;      // called from the data ready interrupt, as the sensor takes each sample
+    bool useFifo;                                           // drain all samples since the last read from the sensor FIFO
+    bool fifoEnabled;                                       // set by the driver when the FIFO read path is active
+    uint8_t fifoSampleCount;                                // number of samples in gyroADCFifo, oldest first, the last one matches gyroADCRaw
+    int16_t gyroADCFifo[GYRO_FIFO_MAX_SAMPLES][XYZ_AXIS_COUNT];
     sensor_align_e gyroAlign;
     mpuDetectionResult_t mpuDetectionResult;
     const extiConfig_t *mpuIntExtiConfig;
@@ -17,23 +17,30 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "platform.h"
 
+#include "build/atomic.h"
 #include "build/build_config.h"
 #include "build/debug.h"
 
 #include "common/maths.h"
 #include "common/utils.h"
 
+#include "scheduler/scheduler_trace.h"
+
 #include "nvic.h"
 
 #include "system.h"
 #include "io.h"
 #include "exti.h"
 #include "bus_i2c.h"
+#include "bus_spi.h"
+#include "dma.h"
+#include "gyro_sync.h"
 
 #include "sensor.h"
 #include "accgyro.h"
@@ -50,6 +57,55 @@
 
 mpuResetFuncPtr mpuReset;
 
+#define MPU_BURST_ACCEL_OFFSET      0   // in the data read from MPU_RA_ACCEL_XOUT_H
+#define MPU_BURST_GYRO_OFFSET       8
+#define MPU_BURST_LENGTH            14  // EXT_SENS_DATA follows when a slave is read
+#define MPU_ACC_BURST_MAX_SAMPLES   64  // restart the average if the accelerometer task falls this far behind
+
+/*
+ * Accelerometer samples that came with the gyro bursts, summed until the accelerometer task takes their
+ * average, so the accelerometer needs no transfer of its own.
+ */
+static bool accBurstActive;
+static bool accBurstRequested;
+static int32_t accBurstSum[XYZ_AXIS_COUNT];
+static uint16_t accBurstCount;
+
+/*
+ * Bytes that a slave of the MPU's I2C master reads into EXT_SENS_DATA on every sample. They are fetched at
+ * the end of the gyro burst and kept until the slave's driver takes them.
+ */
+static uint8_t extSensDataLen;
+static uint8_t extSensData[MPU_EXT_SENS_DATA_MAX];
+static bool extSensDataFresh;
+static bool gyroFifoActive;
+// the gyro whose bursts carry the above, the first initialised, a second gyro is read for its rates only
+static const gyroDev_t *burstGyro;
+
+static void mpuExtSensDataStore(const volatile uint8_t *data)
+{
+    for (int i = 0; i < extSensDataLen; i++) {
+        extSensData[i] = data[i];
+    }
+    extSensDataFresh = true;
+}
+
+static void mpuAccBurstAccumulate(const volatile uint8_t *data)
+{
+    if (!accBurstRequested) {
+        return;
+    }
+    if (accBurstCount >= MPU_ACC_BURST_MAX_SAMPLES) {
+        memset(accBurstSum, 0, sizeof(accBurstSum));
+        accBurstCount = 0;
+    }
+    accBurstActive = true;
+    accBurstSum[X] += (int16_t)((data[0] << 8) | data[1]);
+    accBurstSum[Y] += (int16_t)((data[2] << 8) | data[3]);
+    accBurstSum[Z] += (int16_t)((data[4] << 8) | data[5]);
+    accBurstCount++;
+}
+
 static bool mpuReadRegisterI2C(uint8_t reg, uint8_t length, uint8_t* data);
 static bool mpuWriteRegisterI2C(uint8_t reg, uint8_t data);
 
@@ -124,43 +180,56 @@ mpuDetectionResult_t *mpuDetect(gyroDev_t *gyro)
 }
 
 #ifdef USE_SPI
+// each SPI driver serves the one sensor on its chip select, so a driver that has found its sensor is not asked again
+static uint8_t spiSensorsDetected;
+
+#define SPI_SENSOR_UNCLAIMED(sensor) (!(spiSensorsDetected & (1 << (sensor))))
+
 static bool detectSPISensorsAndUpdateDetectionResult(gyroDev_t *gyro)
 {
 #ifdef USE_GYRO_SPI_MPU6500
-    if (mpu6500SpiDetect()) {
+    if (SPI_SENSOR_UNCLAIMED(MPU_65xx_SPI) && mpu6500SpiDetect()) {
+        spiSensorsDetected |= 1 << MPU_65xx_SPI;
         gyro->mpuDetectionResult.sensor = MPU_65xx_SPI;
         gyro->mpuConfiguration.gyroReadXRegister = MPU_RA_GYRO_XOUT_H;
         gyro->mpuConfiguration.read = mpu6500ReadRegister;
+        gyro->mpuConfiguration.burstRead = true;
         gyro->mpuConfiguration.write = mpu6500WriteRegister;
         return true;
     }
 #endif
 
 #ifdef USE_GYRO_SPI_ICM20689
-    if (icm20689SpiDetect()) {
+    if (SPI_SENSOR_UNCLAIMED(ICM_20689_SPI) && icm20689SpiDetect()) {
+        spiSensorsDetected |= 1 << ICM_20689_SPI;
         gyro->mpuDetectionResult.sensor = ICM_20689_SPI;
         gyro->mpuConfiguration.gyroReadXRegister = MPU_RA_GYRO_XOUT_H;
         gyro->mpuConfiguration.read = icm20689ReadRegister;
+        gyro->mpuConfiguration.burstRead = true;
         gyro->mpuConfiguration.write = icm20689WriteRegister;
         return true;
     }
 #endif
 
 #ifdef USE_GYRO_SPI_MPU6000
-    if (mpu6000SpiDetect()) {
+    if (SPI_SENSOR_UNCLAIMED(MPU_60x0_SPI) && mpu6000SpiDetect()) {
+        spiSensorsDetected |= 1 << MPU_60x0_SPI;
         gyro->mpuDetectionResult.sensor = MPU_60x0_SPI;
         gyro->mpuConfiguration.gyroReadXRegister = MPU_RA_GYRO_XOUT_H;
         gyro->mpuConfiguration.read = mpu6000ReadRegister;
+        gyro->mpuConfiguration.burstRead = true;
         gyro->mpuConfiguration.write = mpu6000WriteRegister;
         return true;
     }
 #endif
 
 #ifdef  USE_GYRO_SPI_MPU9250
-    if (mpu9250SpiDetect()) {
+    if (SPI_SENSOR_UNCLAIMED(MPU_9250_SPI) && mpu9250SpiDetect()) {
+        spiSensorsDetected |= 1 << MPU_9250_SPI;
         gyro->mpuDetectionResult.sensor = MPU_9250_SPI;
         gyro->mpuConfiguration.gyroReadXRegister = MPU_RA_GYRO_XOUT_H;
         gyro->mpuConfiguration.read = mpu9250ReadRegister;
+        gyro->mpuConfiguration.burstRead = true;
         gyro->mpuConfiguration.slowread = mpu9250SlowReadRegister;
         gyro->mpuConfiguration.verifywrite = verifympu9250WriteRegister;
         gyro->mpuConfiguration.write = mpu9250WriteRegister;
@@ -170,10 +239,20 @@ static bool detectSPISensorsAndUpdateDetectionResult(gyroDev_t *gyro)
 #endif
 
     UNUSED(gyro);
+    UNUSED(spiSensorsDetected);
     return false;
 }
 #endif
 
+#ifdef USE_DUAL_GYRO
+// the second IMU of a dual gyro board, found among the SPI drivers that did not find the first
+mpuDetectionResult_t *mpuDetectSecondary(gyroDev_t *gyro)
+{
+    detectSPISensorsAndUpdateDetectionResult(gyro);
+    return &gyro->mpuDetectionResult;
+}
+#endif
+
 static void mpu6050FindRevision(gyroDev_t *gyro)
 {
     bool ack;
@@ -213,14 +292,302 @@ static void mpu6050FindRevision(gyroDev_t *gyro)
     }
 }
 
+#ifdef USE_GYRO_DMA
+/*
+ * DMA gyro acquisition.
+ *
+ * The data ready interrupt starts a single SPI burst read of the accel, temperature and gyro
+ * registers. The burst completes into one half of a double buffer, so the PID loop only ever
+ * copies out the last completed sample and never waits on the bus.
+ */
+#define MPU_DMA_BURST_LENGTH        15  // register address byte + 14 data bytes
+#define MPU_DMA_ACCEL_OFFSET        1
+#define MPU_DMA_GYRO_OFFSET         9
+
+#if defined(STM32F4)
+typedef DMA_Stream_TypeDef mpuDmaChannel_t;
+#else
+typedef DMA_Channel_TypeDef mpuDmaChannel_t;
+#endif
+
+// the first context is the gyro that carries the accelerometer and EXT_SENS_DATA, the second the other IMU of a dual gyro board
+#ifdef USE_DUAL_GYRO
+#define MPU_DMA_CONTEXT_COUNT       2
+#else
+#define MPU_DMA_CONTEXT_COUNT       1
+#endif
+
+typedef struct mpuDmaContext_s {
+    gyroDev_t *gyro;
+    SPI_TypeDef *spiInstance;
+    mpuDmaChannel_t *rxChannel;
+    mpuDmaChannel_t *txChannel;
+    DMA_InitTypeDef rxInit;
+    DMA_InitTypeDef txInit;
+    uint8_t txBuffer[MPU_DMA_BURST_LENGTH + MPU_EXT_SENS_DATA_MAX];
+    volatile uint8_t rxBuffer[2][MPU_DMA_BURST_LENGTH + MPU_EXT_SENS_DATA_MAX];
+    volatile uint8_t rxWriteIndex;
+    volatile uint8_t rxReadIndex;
+    volatile bool sampleAvailable;
+    // the burst is queued on the bus arbiter at gyro priority, so it goes out at the next segment boundary of a shared bus
+    spiBusTransaction_t transaction;
+} mpuDmaContext_t;
+
+static mpuDmaContext_t mpuDmaContexts[MPU_DMA_CONTEXT_COUNT];
+
+#define dmaGyro (mpuDmaContexts[0].gyro)
+
+static mpuDmaContext_t *mpuDmaContextOf(const gyroDev_t *gyro)
+{
+    for (int i = 0; i < MPU_DMA_CONTEXT_COUNT; i++) {
+        if (mpuDmaContexts[i].gyro == gyro) {
+            return &mpuDmaContexts[i];
+        }
+    }
+    return NULL;
+}
+
+static void mpuDmaStartSegment(spiBusTransaction_t *transaction, const uint8_t *data, uint16_t len)
+{
+    UNUSED(data);
+
+    mpuDmaContext_t *context = container_of(transaction, mpuDmaContext_t, transaction);
+
+    DMA_DeInit(context->rxChannel);
+    DMA_DeInit(context->txChannel);
+
+    context->rxInit.DMA_BufferSize = len;
+    context->txInit.DMA_BufferSize = len;
+
+#ifdef STM32F4
+    context->rxInit.DMA_Memory0BaseAddr = (uint32_t)context->rxBuffer[context->rxWriteIndex];
+#else
+    context->rxInit.DMA_MemoryBaseAddr = (uint32_t)context->rxBuffer[context->rxWriteIndex];
+#endif
+    DMA_Init(context->rxChannel, &context->rxInit);
+    DMA_Init(context->txChannel, &context->txInit);
+
+    DMA_ITConfig(context->rxChannel, DMA_IT_TC, ENABLE);
+
+    DMA_Cmd(context->rxChannel, ENABLE);
+    DMA_Cmd(context->txChannel, ENABLE);
+
+    SPI_I2S_DMACmd(context->spiInstance, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+}
+
+static void mpuDmaStartBurstRead(mpuDmaContext_t *context)
+{
+    // fails while the previous burst is still queued or on the bus, which drops this sample
+    spiBusSubmit(&context->transaction);
+}
+
+static void mpuDmaIrqHandler(dmaChannelDescriptor_t *descriptor)
+{
+    SCHEDULER_TRACE(SCHEDULER_TRACE_ISR_ENTER, SCHEDULER_TRACE_ISR_GYRO_DMA);
+    mpuDmaContext_t *context = (mpuDmaContext_t *)descriptor->userParam;
+
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
+        // the last byte has been clocked in when RX completes, so the bus is already idle
+        DMA_Cmd(context->rxChannel, DISABLE);
+        DMA_Cmd(context->txChannel, DISABLE);
+        SPI_I2S_DMACmd(context->spiInstance, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+
+        // publish the completed buffer and fill the other one next time
+        context->rxReadIndex = context->rxWriteIndex;
+        context->rxWriteIndex ^= 1;
+        context->sampleAvailable = true;
+        spiBusSegmentComplete(&context->transaction);
+        context->gyro->dataReady = true;
+        if (context->gyro->dataReadyCallback) {
+            context->gyro->dataReadyCallback();
+        }
+    }
+
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_HTIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_HTIF);
+    }
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TEIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TEIF);
+        spiBusSegmentComplete(&context->transaction);
+    }
+    SCHEDULER_TRACE(SCHEDULER_TRACE_ISR_EXIT, SCHEDULER_TRACE_ISR_GYRO_DMA);
+}
+
+static void mpuDmaInitStructures(mpuDmaContext_t *context, uint32_t channel)
+{
+    DMA_InitTypeDef *rxInit = &context->rxInit;
+    DMA_InitTypeDef *txInit = &context->txInit;
+
+    DMA_StructInit(rxInit);
+    rxInit->DMA_PeripheralBaseAddr = (uint32_t)(&(context->spiInstance->DR));
+    rxInit->DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    rxInit->DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    rxInit->DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    rxInit->DMA_MemoryInc = DMA_MemoryInc_Enable;
+    rxInit->DMA_BufferSize = MPU_DMA_BURST_LENGTH;
+    rxInit->DMA_Mode = DMA_Mode_Normal;
+    rxInit->DMA_Priority = DMA_Priority_VeryHigh;
+
+    *txInit = *rxInit;
+
+#ifdef STM32F4
+    rxInit->DMA_Channel = channel;
+    rxInit->DMA_DIR = DMA_DIR_PeripheralToMemory;
+    txInit->DMA_Channel = channel;
+    txInit->DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    txInit->DMA_Memory0BaseAddr = (uint32_t)context->txBuffer;
+#else
+    UNUSED(channel);
+    rxInit->DMA_DIR = DMA_DIR_PeripheralSRC;
+    txInit->DMA_DIR = DMA_DIR_PeripheralDST;
+    txInit->DMA_MemoryBaseAddr = (uint32_t)context->txBuffer;
+#endif
+}
+
+/*
+ * The streams of a gyro's burst. The first gyro uses the GYRO_DMA_* streams of the target, the second
+ * gyro of a dual gyro board uses any free pair serving its SPI bus, which only the F4 request map can find.
+ */
+static bool mpuDmaAllocate(mpuDmaContext_t *context, uint8_t resourceIndex, uint32_t *channel)
+{
+    if (resourceIndex == 0) {
+        if (!dmaAllocate(GYRO_DMA_IRQ_HANDLER_ID, OWNER_MPU_DMA, 0)) {
+            return false;
+        }
+        if (!dmaAllocate(dmaGetIdentifier(GYRO_DMA_CHANNEL_TX), OWNER_MPU_DMA, 0)) {
+            // the gyro is read without DMA, leave the RX stream to others
+            dmaRelease(GYRO_DMA_IRQ_HANDLER_ID);
+            return false;
+        }
+        context->rxChannel = GYRO_DMA_CHANNEL_RX;
+        context->txChannel = GYRO_DMA_CHANNEL_TX;
+#ifdef STM32F4
+        *channel = GYRO_DMA_CHANNEL;
+#else
+        *channel = 0;
+#endif
+        return true;
+    }
+#if defined(USE_DUAL_GYRO) && defined(STM32F4)
+    dmaStreamOption_t rx = { .peripheral = context->spiInstance, .request = DMA_REQUEST_RX };
+    dmaStreamOption_t tx = { .peripheral = context->spiInstance, .request = DMA_REQUEST_TX };
+    // the request map serves each SPI direction on a single channel, so the pair shares it
+    if (!dmaAllocateRequest(&rx, OWNER_MPU_DMA, resourceIndex)) {
+        return false;
+    }
+    if (!dmaAllocateRequest(&tx, OWNER_MPU_DMA, resourceIndex)) {
+        dmaRelease(dmaGetIdentifier(rx.stream));
+        return false;
+    }
+    context->rxChannel = rx.stream;
+    context->txChannel = tx.stream;
+    *channel = rx.channel;
+    return true;
+#else
+    UNUSED(channel);
+    return false;
+#endif
+}
+
+/*
+ * Switch the gyro over to DMA reads. Must be called once the sensor is fully configured,
+ * as from then on the data ready interrupt owns the SPI bus.
+ */
+bool mpuGyroDmaInit(gyroDev_t *gyro, const spiBusDevice_t *busDevice)
+{
+    if (!gyro->useDma || gyro->fifoEnabled || !gyro->mpuIntExtiConfig) {
+        return false;
+    }
+
+    uint8_t resourceIndex = 0;
+    while (resourceIndex < MPU_DMA_CONTEXT_COUNT && mpuDmaContexts[resourceIndex].gyro) {
+        resourceIndex++;
+    }
+    if (resourceIndex == MPU_DMA_CONTEXT_COUNT) {
+        return false;
+    }
+    mpuDmaContext_t *context = &mpuDmaContexts[resourceIndex];
+
+    context->spiInstance = busDevice->instance;
+
+    // the gyro stays on polled reads if another driver holds either stream
+    uint32_t channel;
+    if (!mpuDmaAllocate(context, resourceIndex, &channel)) {
+        return false;
+    }
+
+    context->transaction.device = busDevice;
+    context->transaction.startSegment = mpuDmaStartSegment;
+    context->transaction.len = MPU_DMA_BURST_LENGTH;
+
+    memset(context->txBuffer, 0xFF, sizeof(context->txBuffer));
+    context->txBuffer[0] = MPU_RA_ACCEL_XOUT_H | 0x80; // read transaction
+
+    mpuDmaInitStructures(context, channel);
+
+    dmaSetHandler(dmaGetIdentifier(context->rxChannel), mpuDmaIrqHandler, NVIC_PRIO_MPU_DMA, (uint32_t)context);
+
+    gyro->read = mpuGyroDmaRead;
+    gyro->dmaEnabled = true;
+    context->gyro = gyro;
+
+    return true;
+}
+
+bool mpuGyroDmaRead(gyroDev_t *gyro)
+{
+    mpuDmaContext_t *context = mpuDmaContextOf(gyro);
+
+    if (!context->sampleAvailable) {
+        return false;
+    }
+    context->sampleAvailable = false;
+
+    const volatile uint8_t *buffer = context->rxBuffer[context->rxReadIndex];
+    if (context == &mpuDmaContexts[0]) {
+        mpuAccBurstAccumulate(&buffer[MPU_DMA_ACCEL_OFFSET]);
+        if (extSensDataLen) {
+            mpuExtSensDataStore(&buffer[MPU_DMA_BURST_LENGTH]);
+        }
+    }
+
+    const volatile uint8_t *data = &buffer[MPU_DMA_GYRO_OFFSET];
+
+    gyro->gyroADCRaw[X] = (int16_t)((data[0] << 8) | data[1]);
+    gyro->gyroADCRaw[Y] = (int16_t)((data[2] << 8) | data[3]);
+    gyro->gyroADCRaw[Z] = (int16_t)((data[4] << 8) | data[5]);
+
+    return true;
+}
+#endif
+
 /*
  * Gyro interrupt service routine
  */
 #if defined(MPU_INT_EXTI)
 static void mpuIntExtiHandler(extiCallbackRec_t *cb)
 {
+    SCHEDULER_TRACE(SCHEDULER_TRACE_ISR_ENTER, SCHEDULER_TRACE_ISR_GYRO_EXTI);
     gyroDev_t *gyro = container_of(cb, gyroDev_t, exti);
+#ifdef USE_LOOP_LATENCY
+    gyro->dataReadyAt = cb->triggeredAt;
+#endif
+    if (gyro->sampleCallback) {
+        gyro->sampleCallback();
+    }
+#ifdef USE_GYRO_DMA
+    mpuDmaContext_t *context = gyro->dmaEnabled ? mpuDmaContextOf(gyro) : NULL;
+    if (context) {
+        // dataReady is raised by the DMA completion handler once the sample is in memory
+        mpuDmaStartBurstRead(context);
+    } else {
+        gyro->dataReady = true;
+    }
+#else
     gyro->dataReady = true;
+#endif
 
 #ifdef DEBUG_MPU_DATA_READY_INTERRUPT
     static uint32_t lastCalledAt = 0;
@@ -229,6 +596,7 @@ static void mpuIntExtiHandler(extiCallbackRec_t *cb)
     debug[0] = callDelta;
     lastCalledAt = now;
 #endif
+    SCHEDULER_TRACE(SCHEDULER_TRACE_ISR_EXIT, SCHEDULER_TRACE_ISR_GYRO_EXTI);
 }
 #endif
 
@@ -281,6 +649,36 @@ static bool mpuWriteRegisterI2C(uint8_t reg, uint8_t data)
 
 bool mpuAccRead(accDev_t *acc)
 {
+    if (accBurstActive) {
+        int32_t sum[XYZ_AXIS_COUNT];
+        uint16_t count = 0;
+
+        // the gyro can be read from an interrupt
+        ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+            memcpy(sum, accBurstSum, sizeof(sum));
+            count = accBurstCount;
+            memset(accBurstSum, 0, sizeof(accBurstSum));
+            accBurstCount = 0;
+        }
+        if (!count) {
+            return false;
+        }
+        acc->ADCRaw[X] = sum[X] / count;
+        acc->ADCRaw[Y] = sum[Y] / count;
+        acc->ADCRaw[Z] = sum[Z] / count;
+
+        return true;
+    }
+    // the gyro reads the accelerometer along with it from the next sample on
+#ifdef USE_GYRO_DMA
+    if (dmaGyro) {
+        // the SPI bus belongs to the gyro burst, which already carries the accelerometer
+        accBurstRequested = true;
+        return false;
+    }
+#endif
+    accBurstRequested = acc->mpuConfiguration.burstRead;
+
     uint8_t data[6];
 
     bool ack = acc->mpuConfiguration.read(MPU_RA_ACCEL_XOUT_H, 6, data);
@@ -297,6 +695,24 @@ bool mpuAccRead(accDev_t *acc)
 
 bool mpuGyroRead(gyroDev_t *gyro)
 {
+    if (gyro == burstGyro && (accBurstRequested || extSensDataLen)) {
+        uint8_t data[MPU_BURST_LENGTH + MPU_EXT_SENS_DATA_MAX];
+
+        if (!gyro->mpuConfiguration.read(MPU_RA_ACCEL_XOUT_H, MPU_BURST_LENGTH + extSensDataLen, data)) {
+            return false;
+        }
+        mpuAccBurstAccumulate(&data[MPU_BURST_ACCEL_OFFSET]);
+        if (extSensDataLen) {
+            mpuExtSensDataStore(&data[MPU_BURST_LENGTH]);
+        }
+
+        gyro->gyroADCRaw[X] = (int16_t)((data[MPU_BURST_GYRO_OFFSET + 0] << 8) | data[MPU_BURST_GYRO_OFFSET + 1]);
+        gyro->gyroADCRaw[Y] = (int16_t)((data[MPU_BURST_GYRO_OFFSET + 2] << 8) | data[MPU_BURST_GYRO_OFFSET + 3]);
+        gyro->gyroADCRaw[Z] = (int16_t)((data[MPU_BURST_GYRO_OFFSET + 4] << 8) | data[MPU_BURST_GYRO_OFFSET + 5]);
+
+        return true;
+    }
+
     uint8_t data[6];
 
     const bool ack = gyro->mpuConfiguration.read(gyro->mpuConfiguration.gyroReadXRegister, 6, data);
@@ -311,8 +727,137 @@ bool mpuGyroRead(gyroDev_t *gyro)
     return true;
 }
 
+/*
+ * Has the gyro burst fetch len bytes of EXT_SENS_DATA, for an I2C slave the driver has set up to be read on
+ * every sample. Only the SPI register and DMA reads can carry them, not the FIFO.
+ */
+bool mpuExtSensDataInit(uint8_t len)
+{
+    if (gyroFifoActive || len > MPU_EXT_SENS_DATA_MAX) {
+        return false;
+    }
+#ifdef USE_GYRO_DMA
+    if (dmaGyro) {
+        bool updated = false;
+        // a burst in flight keeps the length it was started with
+        while (!updated) {
+            ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+                if (!mpuDmaContexts[0].transaction.busy) {
+                    mpuDmaContexts[0].transaction.len = MPU_DMA_BURST_LENGTH + len;
+                    extSensDataLen = len;
+                    updated = true;
+                }
+            }
+        }
+        return true;
+    }
+#endif
+    extSensDataLen = len;
+    return true;
+}
+
+// copies the bytes of the latest gyro burst, false when no burst has brought new ones since the last call
+bool mpuExtSensDataRead(uint8_t *buf)
+{
+    bool fresh = false;
+
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        fresh = extSensDataFresh;
+        if (fresh) {
+            memcpy(buf, extSensData, extSensDataLen);
+            extSensDataFresh = false;
+        }
+    }
+    return fresh;
+}
+
+#ifdef USE_GYRO_FIFO
+#define MPU_FIFO_SAMPLE_SIZE 6      // gyro X, Y, Z only
+
+static uint8_t fifoUserCtrl;
+
+static void mpuGyroFifoReset(gyroDev_t *gyro)
+{
+    gyro->mpuConfiguration.write(MPU_RA_USER_CTRL, fifoUserCtrl | MPU_RF_USER_CTRL_FIFO_RST);
+    gyro->mpuConfiguration.write(MPU_RA_USER_CTRL, fifoUserCtrl | MPU_RF_USER_CTRL_FIFO_EN);
+}
+
+/*
+ * Switch the gyro over to FIFO reads. The sensor then samples at its full internal rate and
+ * each read drains every sample taken since the previous one, rather than just the latest.
+ * The data ready interrupt is turned off, it would fire on every one of those samples, and the
+ * FIFO is drained on the PID loop schedule instead.
+ * userCtrl holds the USER_CTRL bits the driver needs preserved (e.g. I2C_IF_DIS).
+ */
+bool mpuGyroFifoInit(gyroDev_t *gyro, uint8_t userCtrl)
+{
+    if (!gyro->useFifo) {
+        return false;
+    }
+
+    fifoUserCtrl = userCtrl;
+
+    gyro->mpuConfiguration.write(MPU_RA_INT_ENABLE, 0);
+    gyro->mpuConfiguration.write(MPU_RA_FIFO_EN, 0);
+    gyro->mpuConfiguration.write(MPU_RA_SMPLRT_DIV, 0); // gyro_sync_denom is applied by the loop draining the FIFO
+    delay(15);
+    mpuGyroFifoReset(gyro);
+    gyro->mpuConfiguration.write(MPU_RA_FIFO_EN, MPU_RF_FIFO_EN_GYRO);
+    delay(15);
+
+    gyro->read = mpuGyroFifoRead;
+    gyro->fifoEnabled = true;
+    gyroFifoActive = true;
+
+    return true;
+}
+
+bool mpuGyroFifoRead(gyroDev_t *gyro)
+{
+    uint8_t data[GYRO_FIFO_MAX_SAMPLES * MPU_FIFO_SAMPLE_SIZE];
+
+    gyro->fifoSampleCount = 0;
+
+    if (!gyro->mpuConfiguration.read(MPU_RA_FIFO_COUNTH, 2, data)) {
+        return false;
+    }
+    const uint16_t fifoCount = ((data[0] & 0x1F) << 8) | data[1];
+    const uint8_t sampleCount = fifoCount / MPU_FIFO_SAMPLE_SIZE;
+
+    if (sampleCount == 0) {
+        return false;
+    }
+    if (fifoCount > GYRO_FIFO_MAX_SAMPLES * MPU_FIFO_SAMPLE_SIZE) {
+        // fallen behind, possibly overflowed, so the FIFO contents are stale or misaligned
+        mpuGyroFifoReset(gyro);
+        return mpuGyroRead(gyro);
+    }
+
+    if (!gyro->mpuConfiguration.read(MPU_RA_FIFO_R_W, sampleCount * MPU_FIFO_SAMPLE_SIZE, data)) {
+        return false;
+    }
+
+    for (int i = 0; i < sampleCount; i++) {
+        const uint8_t *sample = &data[i * MPU_FIFO_SAMPLE_SIZE];
+        gyro->gyroADCFifo[i][X] = (int16_t)((sample[0] << 8) | sample[1]);
+        gyro->gyroADCFifo[i][Y] = (int16_t)((sample[2] << 8) | sample[3]);
+        gyro->gyroADCFifo[i][Z] = (int16_t)((sample[4] << 8) | sample[5]);
+    }
+    gyro->fifoSampleCount = sampleCount;
+
+    gyro->gyroADCRaw[X] = gyro->gyroADCFifo[sampleCount - 1][X];
+    gyro->gyroADCRaw[Y] = gyro->gyroADCFifo[sampleCount - 1][Y];
+    gyro->gyroADCRaw[Z] = gyro->gyroADCFifo[sampleCount - 1][Z];
+
+    return true;
+}
+#endif
+
 void mpuGyroInit(gyroDev_t *gyro)
 {
+    if (!burstGyro) {
+        burstGyro = gyro;
+    }
     mpuIntExtiInit(gyro);
 }
 
@@ -327,3 +872,40 @@ bool mpuCheckDataReady(gyroDev_t* gyro)
     }
     return ret;
 }
+
+/*
+ * Programs the sample rate divider of a running sensor for the current gyro_sync_denom, the FIFO
+ * keeps the full internal rate. The MPU3050 always runs undivided.
+ */
+void mpuGyroSetSampleRateDivider(gyroDev_t *gyro)
+{
+    if (!gyro->mpuConfiguration.write || gyro->mpuDetectionResult.sensor == MPU_NONE || gyro->mpuDetectionResult.sensor == MPU_3050) {
+        return;
+    }
+    gyro->mpuConfiguration.write(MPU_RA_SMPLRT_DIV, gyro->fifoEnabled ? 0 : gyroMPU6xxxGetDividerDrops());
+}
+
+// whole degrees C, the sensitivity and offset of the die temperature differ between the MPU generations
+bool mpuGyroReadTemperature(gyroDev_t *gyro, int16_t *tempData)
+{
+    uint8_t data[2];
+    if (!gyro->mpuConfiguration.read(MPU_RA_TEMP_OUT_H, 2, data)) {
+        return false;
+    }
+
+    const int16_t raw = (int16_t)((data[0] << 8) | data[1]);
+    switch (gyro->mpuDetectionResult.sensor) {
+    case MPU_60x0:
+    case MPU_60x0_SPI:
+        *tempData = lrintf(raw / 340.0f + 36.53f);
+        break;
+    case ICM_20689_SPI:
+        *tempData = lrintf(raw / 326.8f + 25.0f);
+        break;
+    default:
+        *tempData = lrintf(raw / 333.87f + 21.0f);
+        break;
+    }
+
+    return true;
+}
@@ -117,6 +117,10 @@
 // RF = Register Flag
 #define MPU_RF_DATA_RDY_EN (1 << 0)
 
+#define MPU_RF_FIFO_EN_GYRO     0x70    // XG_FIFO_EN | YG_FIFO_EN | ZG_FIFO_EN
+#define MPU_RF_USER_CTRL_FIFO_EN   (1 << 6)
+#define MPU_RF_USER_CTRL_FIFO_RST  (1 << 2)
+
 typedef bool (*mpuReadRegisterFunc)(uint8_t reg, uint8_t length, uint8_t* data);
 typedef bool (*mpuWriteRegisterFunc)(uint8_t reg, uint8_t data);
 typedef void(*mpuResetFuncPtr)(void);
@@ -130,6 +134,7 @@ typedef struct mpuConfiguration_s {
     mpuWriteRegisterFunc verifywrite;
     mpuResetFuncPtr reset;
     uint8_t gyroReadXRegister; // Y and Z must registers follow this, 2 words each
+    bool burstRead;             // accel, temperature and gyro can be read in one transfer ahead of the gyro registers
 } mpuConfiguration_t;
 
 enum gyro_fsr_e {
@@ -187,4 +192,19 @@ struct accDev_s;
 bool mpuAccRead(struct accDev_s *acc);
 bool mpuGyroRead(struct gyroDev_s *gyro);
 mpuDetectionResult_t *mpuDetect(struct gyroDev_s *gyro);
+mpuDetectionResult_t *mpuDetectSecondary(struct gyroDev_s *gyro);
 bool mpuCheckDataReady(struct gyroDev_s *gyro);
+bool mpuGyroReadTemperature(struct gyroDev_s *gyro, int16_t *tempData);
+void mpuGyroSetSampleRateDivider(struct gyroDev_s *gyro);
+#define MPU_EXT_SENS_DATA_MAX 8
+bool mpuExtSensDataInit(uint8_t len);
+bool mpuExtSensDataRead(uint8_t *buf);
+#ifdef USE_GYRO_FIFO
+bool mpuGyroFifoInit(struct gyroDev_s *gyro, uint8_t userCtrl);
+bool mpuGyroFifoRead(struct gyroDev_s *gyro);
+#endif
+#ifdef USE_GYRO_DMA
+struct spiBusDevice_s;
+bool mpuGyroDmaInit(struct gyroDev_s *gyro, const struct spiBusDevice_s *busDevice);
+bool mpuGyroDmaRead(struct gyroDev_s *gyro);
+#endif
@@ -107,6 +107,7 @@ bool mpu6050GyroDetect(gyroDev_t *gyro)
     gyro->init = mpu6050GyroInit;
     gyro->read = mpuGyroRead;
     gyro->intStatus = mpuCheckDataReady;
+    gyro->temperature = mpuGyroReadTemperature;
 
     // 16.4 dps/lsb scalefactor
     gyro->scale = 1.0f / 16.4f;
@@ -95,6 +95,7 @@ bool mpu6500GyroDetect(gyroDev_t *gyro)
     gyro->init = mpu6500GyroInit;
     gyro->read = mpuGyroRead;
     gyro->intStatus = mpuCheckDataReady;
+    gyro->temperature = mpuGyroReadTemperature;
 
     // 16.4 dps/lsb scalefactor
     gyro->scale = 1.0f / 16.4f;
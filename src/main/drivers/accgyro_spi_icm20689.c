@@ -36,10 +36,11 @@
 #include "accgyro_mpu.h"
 #include "accgyro_spi_icm20689.h"
 
-#define DISABLE_ICM20689       IOHi(icmSpi20689CsPin)
-#define ENABLE_ICM20689        IOLo(icmSpi20689CsPin)
+#define DISABLE_ICM20689       spiBusRelease(&icmSpi20689BusDevice)
+#define ENABLE_ICM20689        spiBusAcquire(&icmSpi20689BusDevice)
 
 static IO_t icmSpi20689CsPin = IO_NONE;
+static spiBusDevice_t icmSpi20689BusDevice;
 
 bool icm20689WriteRegister(uint8_t reg, uint8_t data)
 {
@@ -72,8 +73,7 @@ static void icm20689SpiInit(void)
     icmSpi20689CsPin = IOGetByTag(IO_TAG(ICM20689_CS_PIN));
     IOInit(icmSpi20689CsPin, OWNER_MPU_CS, 0);
     IOConfigGPIO(icmSpi20689CsPin, SPI_IO_CS_CFG);
-
-    spiSetDivisor(ICM20689_SPI_INSTANCE, SPI_CLOCK_STANDARD);
+    spiBusDeviceInit(&icmSpi20689BusDevice, ICM20689_SPI_INSTANCE, icmSpi20689CsPin, SPI_CLOCK_STANDARD, SPI_BUS_PRIORITY_GYRO);
 
     hardwareInitialised = true;
 }
@@ -85,7 +85,7 @@ bool icm20689SpiDetect(void)
 
     icm20689SpiInit();
 
-    spiSetDivisor(ICM20689_SPI_INSTANCE, SPI_CLOCK_INITIALIZATON); //low speed
+    spiBusSetDivisor(&icmSpi20689BusDevice, SPI_CLOCK_INITIALIZATON); //low speed
 
     icm20689WriteRegister(MPU_RA_PWR_MGMT_1, ICM20689_BIT_RESET);
 
@@ -101,7 +101,7 @@ bool icm20689SpiDetect(void)
         }
     } while (attemptsRemaining--);
 
-    spiSetDivisor(ICM20689_SPI_INSTANCE, SPI_CLOCK_STANDARD);
+    spiBusSetDivisor(&icmSpi20689BusDevice, SPI_CLOCK_STANDARD);
 
     return true;
 
@@ -128,7 +128,7 @@ void icm20689GyroInit(gyroDev_t *gyro)
 {
     mpuGyroInit(gyro);
 
-    spiSetDivisor(ICM20689_SPI_INSTANCE, SPI_CLOCK_INITIALIZATON);
+    spiBusSetDivisor(&icmSpi20689BusDevice, SPI_CLOCK_INITIALIZATON);
 
     gyro->mpuConfiguration.write(MPU_RA_PWR_MGMT_1, ICM20689_BIT_RESET);
     delay(100);
@@ -157,7 +157,11 @@ void icm20689GyroInit(gyroDev_t *gyro)
     gyro->mpuConfiguration.write(MPU_RA_INT_ENABLE, 0x01); // RAW_RDY_EN interrupt enable
 #endif
 
-    spiSetDivisor(ICM20689_SPI_INSTANCE, SPI_CLOCK_STANDARD);
+#ifdef USE_GYRO_FIFO
+    mpuGyroFifoInit(gyro, 0);
+#endif
+
+    spiBusSetDivisor(&icmSpi20689BusDevice, SPI_CLOCK_STANDARD);
 }
 
 bool icm20689SpiGyroDetect(gyroDev_t *gyro)
@@ -169,6 +173,7 @@ bool icm20689SpiGyroDetect(gyroDev_t *gyro)
     gyro->init = icm20689GyroInit;
     gyro->read = mpuGyroRead;
     gyro->intStatus = mpuCheckDataReady;
+    gyro->temperature = mpuGyroReadTemperature;
 
     // 16.4 dps/lsb scalefactor
     gyro->scale = 1.0f / 16.4f;
@@ -99,10 +99,11 @@ static bool mpuSpi6000InitDone = false;
 #define MPU6000_REV_D9 0x59
 #define MPU6000_REV_D10 0x5A
 
-#define DISABLE_MPU6000       IOHi(mpuSpi6000CsPin)
-#define ENABLE_MPU6000        IOLo(mpuSpi6000CsPin)
+#define DISABLE_MPU6000       spiBusRelease(&mpuSpi6000BusDevice)
+#define ENABLE_MPU6000        spiBusAcquire(&mpuSpi6000BusDevice)
 
 static IO_t mpuSpi6000CsPin = IO_NONE;
+static spiBusDevice_t mpuSpi6000BusDevice;
 
 bool mpu6000WriteRegister(uint8_t reg, uint8_t data)
 {
@@ -130,19 +131,23 @@ void mpu6000SpiGyroInit(gyroDev_t *gyro)
 
     mpu6000AccAndGyroInit();
 
-    spiSetDivisor(MPU6000_SPI_INSTANCE, SPI_CLOCK_INITIALIZATON);
+    spiBusSetDivisor(&mpuSpi6000BusDevice, SPI_CLOCK_INITIALIZATON);
 
     // Accel and Gyro DLPF Setting
     mpu6000WriteRegister(MPU6000_CONFIG, gyro->lpf);
     delayMicroseconds(1);
 
-    spiSetDivisor(MPU6000_SPI_INSTANCE, SPI_CLOCK_FAST);  // 18 MHz SPI clock
+    spiBusSetDivisor(&mpuSpi6000BusDevice, SPI_CLOCK_FAST);  // 18 MHz SPI clock
 
     mpuGyroRead(gyro);
 
     if (((int8_t)gyro->gyroADCRaw[1]) == -1 && ((int8_t)gyro->gyroADCRaw[0]) == -1) {
         failureMode(FAILURE_GYRO_INIT_FAILED);
     }
+
+#ifdef USE_GYRO_DMA
+    mpuGyroDmaInit(gyro, &mpuSpi6000BusDevice);
+#endif
 }
 
 void mpu6000SpiAccInit(accDev_t *acc)
@@ -160,8 +165,9 @@ bool mpu6000SpiDetect(void)
 #endif
     IOInit(mpuSpi6000CsPin, OWNER_MPU_CS, 0);
     IOConfigGPIO(mpuSpi6000CsPin, SPI_IO_CS_CFG);
+    spiBusDeviceInit(&mpuSpi6000BusDevice, MPU6000_SPI_INSTANCE, mpuSpi6000CsPin, SPI_CLOCK_INITIALIZATON, SPI_BUS_PRIORITY_GYRO);
 
-    spiSetDivisor(MPU6000_SPI_INSTANCE, SPI_CLOCK_INITIALIZATON);
+    spiBusSetDivisor(&mpuSpi6000BusDevice, SPI_CLOCK_INITIALIZATON);
 
     mpu6000WriteRegister(MPU_RA_PWR_MGMT_1, BIT_H_RESET);
 
@@ -207,7 +213,7 @@ static void mpu6000AccAndGyroInit(void)
         return;
     }
 
-    spiSetDivisor(MPU6000_SPI_INSTANCE, SPI_CLOCK_INITIALIZATON);
+    spiBusSetDivisor(&mpuSpi6000BusDevice, SPI_CLOCK_INITIALIZATON);
 
     // Device Reset
     mpu6000WriteRegister(MPU_RA_PWR_MGMT_1, BIT_H_RESET);
@@ -248,7 +254,7 @@ static void mpu6000AccAndGyroInit(void)
     delayMicroseconds(15);
 #endif
 
-    spiSetDivisor(MPU6000_SPI_INSTANCE, SPI_CLOCK_FAST);
+    spiBusSetDivisor(&mpuSpi6000BusDevice, SPI_CLOCK_FAST);
     delayMicroseconds(1);
 
     mpuSpi6000InitDone = true;
@@ -275,6 +281,7 @@ bool mpu6000SpiGyroDetect(gyroDev_t *gyro)
     gyro->init = mpu6000SpiGyroInit;
     gyro->read = mpuGyroRead;
     gyro->intStatus = mpuCheckDataReady;
+    gyro->temperature = mpuGyroReadTemperature;
     // 16.4 dps/lsb scalefactor
     gyro->scale = 1.0f / 16.4f;
 
@@ -34,10 +34,11 @@
 #include "accgyro_mpu6500.h"
 #include "accgyro_spi_mpu6500.h"
 
-#define DISABLE_MPU6500       IOHi(mpuSpi6500CsPin)
-#define ENABLE_MPU6500        IOLo(mpuSpi6500CsPin)
+#define DISABLE_MPU6500       spiBusRelease(&mpuSpi6500BusDevice)
+#define ENABLE_MPU6500        spiBusAcquire(&mpuSpi6500BusDevice)
 
 static IO_t mpuSpi6500CsPin = IO_NONE;
+static spiBusDevice_t mpuSpi6500BusDevice;
 
 bool mpu6500WriteRegister(uint8_t reg, uint8_t data)
 {
@@ -70,8 +71,7 @@ static void mpu6500SpiInit(void)
     mpuSpi6500CsPin = IOGetByTag(IO_TAG(MPU6500_CS_PIN));
     IOInit(mpuSpi6500CsPin, OWNER_MPU_CS, 0);
     IOConfigGPIO(mpuSpi6500CsPin, SPI_IO_CS_CFG);
-
-    spiSetDivisor(MPU6500_SPI_INSTANCE, SPI_CLOCK_FAST);
+    spiBusDeviceInit(&mpuSpi6500BusDevice, MPU6500_SPI_INSTANCE, mpuSpi6500CsPin, SPI_CLOCK_FAST, SPI_BUS_PRIORITY_GYRO);
 
     hardwareInitialised = true;
 }
@@ -101,7 +101,7 @@ void mpu6500SpiAccInit(accDev_t *acc)
 
 void mpu6500SpiGyroInit(gyroDev_t *gyro)
 {
-    spiSetDivisor(MPU6500_SPI_INSTANCE, SPI_CLOCK_SLOW);
+    spiBusSetDivisor(&mpuSpi6500BusDevice, SPI_CLOCK_SLOW);
     delayMicroseconds(1);
 
     mpu6500GyroInit(gyro);
@@ -110,8 +110,16 @@ void mpu6500SpiGyroInit(gyroDev_t *gyro)
     mpu6500WriteRegister(MPU_RA_USER_CTRL, MPU6500_BIT_I2C_IF_DIS);
     delay(100);
 
-    spiSetDivisor(MPU6500_SPI_INSTANCE, SPI_CLOCK_FAST);
+#ifdef USE_GYRO_FIFO
+    mpuGyroFifoInit(gyro, MPU6500_BIT_I2C_IF_DIS);
+#endif
+
+    spiBusSetDivisor(&mpuSpi6500BusDevice, SPI_CLOCK_FAST);
     delayMicroseconds(1);
+
+#ifdef USE_GYRO_DMA
+    mpuGyroDmaInit(gyro, &mpuSpi6500BusDevice);
+#endif
 }
 
 bool mpu6500SpiAccDetect(accDev_t *acc)
@@ -135,6 +143,7 @@ bool mpu6500SpiGyroDetect(gyroDev_t *gyro)
     gyro->init = mpu6500SpiGyroInit;
     gyro->read = mpuGyroRead;
     gyro->intStatus = mpuCheckDataReady;
+    gyro->temperature = mpuGyroReadTemperature;
 
     // 16.4 dps/lsb scalefactor
     gyro->scale = 1.0f / 16.4f;
@@ -230,6 +230,7 @@ bool mpu9250SpiGyroDetect(gyroDev_t *gyro)
     gyro->init = mpu9250SpiGyroInit;
     gyro->read = mpuGyroRead;
     gyro->intStatus = mpuCheckDataReady;
+    gyro->temperature = mpuGyroReadTemperature;
 
     // 16.4 dps/lsb scalefactor
     gyro->scale = 1.0f / 16.4f;
@@ -34,7 +34,8 @@
 
 #ifdef USE_ADC
 adcOperatingConfig_t adcOperatingConfig[ADC_CHANNEL_COUNT];
-volatile uint16_t adcValues[ADC_CHANNEL_COUNT];
+DMA_RAM volatile uint16_t adcValues[ADC_CHANNEL_COUNT * ADC_OVERSAMPLE_SCANS];
+uint8_t adcConfiguredChannelCount;
 
 uint8_t adcChannelByTag(ioTag_t ioTag)
 {
@@ -45,23 +46,31 @@ uint8_t adcChannelByTag(ioTag_t ioTag)
     return 0;
 }
 
-uint16_t adcGetChannel(uint8_t channel)
+/*
+ * Averages every conversion of the channel held in the DMA buffer, the hardware keeps overwriting the oldest
+ * scan so this is a running mean over the last ADC_OVERSAMPLE_SCANS of them, with no interrupt load.
+ */
+static uint16_t adcAverageChannel(const adcOperatingConfig_t *config)
 {
-#ifdef DEBUG_ADC_CHANNELS
-    if (adcOperatingConfig[0].enabled) {
-        debug[0] = adcValues[adcOperatingConfig[0].dmaIndex];
-    }
-    if (adcOperatingConfig[1].enabled) {
-        debug[1] = adcValues[adcOperatingConfig[1].dmaIndex];
+    if (!config->enabled) {
+        return 0;
     }
-    if (adcOperatingConfig[2].enabled) {
-        debug[2] = adcValues[adcOperatingConfig[2].dmaIndex];
+
+    uint32_t sum = 0;
+    for (int i = config->dmaIndex; i < adcConfiguredChannelCount * ADC_OVERSAMPLE_SCANS; i += adcConfiguredChannelCount) {
+        sum += adcValues[i];
     }
-    if (adcOperatingConfig[3].enabled) {
-        debug[3] = adcValues[adcOperatingConfig[3].dmaIndex];
+    return (sum + ADC_OVERSAMPLE_SCANS / 2) / ADC_OVERSAMPLE_SCANS;
+}
+
+uint16_t adcGetChannel(uint8_t channel)
+{
+#ifdef DEBUG_ADC_CHANNELS
+    for (int i = 0; i < 4; i++) {
+        debug[i] = adcAverageChannel(&adcOperatingConfig[i]);
     }
 #endif
-    return adcValues[adcOperatingConfig[channel].dmaIndex];
+    return adcAverageChannel(&adcOperatingConfig[channel]);
 }
 
 #else
@@ -56,6 +56,10 @@ typedef struct adcDevice_s {
 extern const adcDevice_t adcHardware[];
 extern const adcTagMap_t adcTagMap[ADC_TAG_MAP_COUNT];
 extern adcOperatingConfig_t adcOperatingConfig[ADC_CHANNEL_COUNT];
-extern volatile uint16_t adcValues[ADC_CHANNEL_COUNT];
+// the DMA fills the buffer with this many scans in turn, readings are the mean over all of them
+#define ADC_OVERSAMPLE_SCANS 32
+
+extern volatile uint16_t adcValues[ADC_CHANNEL_COUNT * ADC_OVERSAMPLE_SCANS];
+extern uint8_t adcConfiguredChannelCount;
 
 uint8_t adcChannelByTag(ioTag_t ioTag);
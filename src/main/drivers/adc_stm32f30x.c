@@ -31,6 +31,7 @@
 #include "io.h"
 #include "rcc.h"
 #include "dma.h"
+#include "memory_report.h"
 
 #include "common/utils.h"
 
@@ -155,18 +156,20 @@ void adcInit(adcConfig_t *config)
     if (!adcActive) {
         return;
     }
+    adcConfiguredChannelCount = adcChannelCount;
 
     if ((device == ADCDEV_1) || (device == ADCDEV_2)) {
         // enable clock for ADC1+2
-        RCC_ADCCLKConfig(RCC_ADC12PLLCLK_Div256);  // 72 MHz divided by 256 = 281.25 kHz
+        RCC_ADCCLKConfig(RCC_ADC12PLLCLK_Div16);  // 72 MHz divided by 16 = 4.5 MHz, a scan of four channels every 0.55ms
     } else {
         // enable clock for ADC3+4
-        RCC_ADCCLKConfig(RCC_ADC34PLLCLK_Div256);  // 72 MHz divided by 256 = 281.25 kHz
+        RCC_ADCCLKConfig(RCC_ADC34PLLCLK_Div16);  // 72 MHz divided by 16 = 4.5 MHz
     }
 
     RCC_ClockCmd(adc.rccADC, ENABLE);
 
     dmaInit(dmaGetIdentifier(adc.DMAy_Channelx), OWNER_ADC, 0);
+    memoryReportDmaBuffer(OWNER_ADC, adcValues, sizeof(adcValues));
 
     DMA_DeInit(adc.DMAy_Channelx);
 
@@ -174,9 +177,9 @@ void adcInit(adcConfig_t *config)
     DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&adc.ADCx->DR;
     DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)adcValues;
     DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
-    DMA_InitStructure.DMA_BufferSize = adcChannelCount;
+    DMA_InitStructure.DMA_BufferSize = adcChannelCount * ADC_OVERSAMPLE_SCANS;
     DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
-    DMA_InitStructure.DMA_MemoryInc = adcChannelCount > 1 ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
     DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
     DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
     DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
@@ -26,6 +26,7 @@
 #include "io_impl.h"
 #include "rcc.h"
 #include "dma.h"
+#include "memory_report.h"
 
 #include "sensor.h"
 #include "accgyro.h"
@@ -136,10 +137,12 @@ void adcInit(adcConfig_t *config)
     if (!adcActive) {
         return;
     }
+    adcConfiguredChannelCount = configuredAdcChannels;
 
     RCC_ClockCmd(adc.rccADC, ENABLE);
 
     dmaInit(dmaGetIdentifier(adc.DMAy_Streamx), OWNER_ADC, 0);
+    memoryReportDmaBuffer(OWNER_ADC, adcValues, sizeof(adcValues));
 
     DMA_DeInit(adc.DMAy_Streamx);
 
@@ -148,9 +151,9 @@ void adcInit(adcConfig_t *config)
     DMA_InitStructure.DMA_Channel = adc.channel;
     DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)adcValues;
     DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
-    DMA_InitStructure.DMA_BufferSize = configuredAdcChannels;
+    DMA_InitStructure.DMA_BufferSize = configuredAdcChannels * ADC_OVERSAMPLE_SCANS;
     DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
-    DMA_InitStructure.DMA_MemoryInc = configuredAdcChannels > 1 ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
     DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
     DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
     DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
@@ -26,6 +26,7 @@
 #include "io_impl.h"
 #include "rcc.h"
 #include "dma.h"
+#include "memory_report.h"
 
 #include "sensor.h"
 #include "accgyro.h"
@@ -132,9 +133,11 @@ void adcInit(adcConfig_t *config)
     if (!adcActive) {
         return;
     }
+    adcConfiguredChannelCount = configuredAdcChannels;
 
     RCC_ClockCmd(adc.rccADC, ENABLE);
     dmaInit(dmaGetIdentifier(adc.DMAy_Streamx), OWNER_ADC, 0);
+    memoryReportDmaBuffer(OWNER_ADC, (const void *)adcValues, sizeof(adcValues));
 
     ADCHandle.Init.ClockPrescaler        = ADC_CLOCK_SYNC_PCLK_DIV8;
     ADCHandle.Init.ContinuousConvMode    = ENABLE;
@@ -159,7 +162,7 @@ void adcInit(adcConfig_t *config)
     DmaHandle.Init.Channel = adc.channel;
     DmaHandle.Init.Direction = DMA_PERIPH_TO_MEMORY;
     DmaHandle.Init.PeriphInc = DMA_PINC_DISABLE;
-    DmaHandle.Init.MemInc = configuredAdcChannels > 1 ? DMA_MINC_ENABLE : DMA_MINC_DISABLE;
+    DmaHandle.Init.MemInc = DMA_MINC_ENABLE;
     DmaHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
     DmaHandle.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
     DmaHandle.Init.Mode = DMA_CIRCULAR;
@@ -197,7 +200,7 @@ void adcInit(adcConfig_t *config)
     }
 
     /*##-4- Start the conversion process #######################################*/
-    if(HAL_ADC_Start_DMA(&ADCHandle, (uint32_t*)&adcValues, configuredAdcChannels) != HAL_OK)
+    if(HAL_ADC_Start_DMA(&ADCHandle, (uint32_t*)&adcValues, configuredAdcChannels * ADC_OVERSAMPLE_SCANS) != HAL_OK)
     {
         /* Start Conversation Error */
     }
@@ -219,6 +219,15 @@ bool bmp085Detect(const bmp085Config_t *config, baroDev_t *baro)
     return false;
 }
 
+// the temperature and the temperature terms of the pressure, redone only when the raw temperature changes
+static struct {
+    bool valid;
+    uint16_t ut;
+    int32_t temperature;
+    int32_t b3;
+    uint32_t b4;
+} bmp085_comp;
+
 static int32_t bmp085_get_temperature(uint32_t ut)
 {
     int32_t temperature;
@@ -232,10 +241,9 @@ static int32_t bmp085_get_temperature(uint32_t ut)
     return temperature;
 }
 
-static int32_t bmp085_get_pressure(uint32_t up)
+static void bmp085_get_pressure_terms(void)
 {
-    int32_t pressure, x1, x2, x3, b3, b6;
-    uint32_t b4, b7;
+    int32_t x1, x2, x3, b6;
 
     b6 = bmp085.param_b5 - 4000;
     // *****calculate B3************
@@ -248,19 +256,25 @@ static int32_t bmp085_get_pressure(uint32_t up)
 
     x3 = x1 + x2;
 
-    b3 = (((((int32_t) bmp085.cal_param.ac1) * 4 + x3) << bmp085.oversampling_setting) + 2) >> 2;
+    bmp085_comp.b3 = (((((int32_t) bmp085.cal_param.ac1) * 4 + x3) << bmp085.oversampling_setting) + 2) >> 2;
 
     // *****calculate B4************
     x1 = (bmp085.cal_param.ac3 * b6) >> 13;
     x2 = (bmp085.cal_param.b1 * ((b6 * b6) >> 12)) >> 16;
     x3 = ((x1 + x2) + 2) >> 2;
-    b4 = (bmp085.cal_param.ac4 * (uint32_t)(x3 + 32768)) >> 15;
+    bmp085_comp.b4 = (bmp085.cal_param.ac4 * (uint32_t)(x3 + 32768)) >> 15;
+}
+
+static int32_t bmp085_get_pressure(uint32_t up)
+{
+    int32_t pressure, x1, x2;
+    uint32_t b7;
 
-    b7 = ((uint32_t)(up - b3) * (50000 >> bmp085.oversampling_setting));
+    b7 = ((uint32_t)(up - bmp085_comp.b3) * (50000 >> bmp085.oversampling_setting));
     if (b7 < 0x80000000) {
-        pressure = (b7 << 1) / b4;
+        pressure = (b7 << 1) / bmp085_comp.b4;
     } else {
-        pressure = (b7 / b4) << 1;
+        pressure = (b7 / bmp085_comp.b4) << 1;
     }
 
     x1 = pressure >> 8;
@@ -272,40 +286,83 @@ static int32_t bmp085_get_pressure(uint32_t up)
     return pressure;
 }
 
-static void bmp085_start_ut(void)
+/*
+ * The conversion commands and ADC reads are queued on the bus instead of waited for. A result lands in
+ * bmp085_ut/bmp085_up from the I2C interrupt, so bmp085_calculate() works on the previous reading.
+ */
+static uint8_t bmp085_ctrl_data;
+static uint8_t bmp085_adc_data[3];
+
+static i2cJob_t bmp085_ctrl_job = {
+    .device = BARO_I2C_INSTANCE,
+    .addr = BMP085_I2C_ADDR,
+    .reg = BMP085_CTRL_MEAS_REG,
+    .len = 1,
+    .buf = &bmp085_ctrl_data,
+};
+
+static void bmp085_read_done(i2cJob_t *job)
 {
+    if (job->error) {
+        return;
+    }
+    if (job->len == 2) {
+        bmp085_ut = (bmp085_adc_data[0] << 8) | bmp085_adc_data[1];
+    } else {
+        bmp085_up = (((uint32_t) bmp085_adc_data[0] << 16) | ((uint32_t) bmp085_adc_data[1] << 8) | (uint32_t) bmp085_adc_data[2])
+                >> (8 - bmp085.oversampling_setting);
+    }
+}
+
+static i2cJob_t bmp085_read_job = {
+    .device = BARO_I2C_INSTANCE,
+    .addr = BMP085_I2C_ADDR,
+    .reg = BMP085_ADC_OUT_MSB_REG,
+    .read = true,
+    .buf = bmp085_adc_data,
+    .callback = bmp085_read_done,
+};
+
+static void bmp085_start_conversion(uint8_t ctrl_reg_data)
+{
+    if (bmp085_ctrl_job.busy) {
+        return;
+    }
 #if defined(BARO_EOC_GPIO)
     isConversionComplete = false;
 #endif
-    i2cWrite(BARO_I2C_INSTANCE, BMP085_I2C_ADDR, BMP085_CTRL_MEAS_REG, BMP085_T_MEASURE);
+    bmp085_ctrl_data = ctrl_reg_data;
+    i2cSubmit(&bmp085_ctrl_job);
 }
 
-static void bmp085_get_ut(void)
+static void bmp085_read_adc(uint8_t len)
 {
-    uint8_t data[2];
-
 #if defined(BARO_EOC_GPIO)
     // return old baro value if conversion time exceeds datasheet max when EOC is connected
     if ((isEOCConnected) && (!isConversionComplete)) {
         return;
     }
 #endif
-
-    i2cRead(BARO_I2C_INSTANCE, BMP085_I2C_ADDR, BMP085_ADC_OUT_MSB_REG, 2, data);
-    bmp085_ut = (data[0] << 8) | data[1];
+    // a read still queued from the last cycle keeps its length, this cycle's value is skipped
+    if (!bmp085_read_job.busy) {
+        bmp085_read_job.len = len;
+        i2cSubmit(&bmp085_read_job);
+    }
 }
 
-static void bmp085_start_up(void)
+static void bmp085_start_ut(void)
 {
-    uint8_t ctrl_reg_data;
-
-    ctrl_reg_data = BMP085_P_MEASURE + (bmp085.oversampling_setting << 6);
+    bmp085_start_conversion(BMP085_T_MEASURE);
+}
 
-#if defined(BARO_EOC_GPIO)
-    isConversionComplete = false;
-#endif
+static void bmp085_get_ut(void)
+{
+    bmp085_read_adc(2);
+}
 
-    i2cWrite(BARO_I2C_INSTANCE, BMP085_I2C_ADDR, BMP085_CTRL_MEAS_REG, ctrl_reg_data);
+static void bmp085_start_up(void)
+{
+    bmp085_start_conversion(BMP085_P_MEASURE + (bmp085.oversampling_setting << 6));
 }
 
 /** read out up for pressure conversion
@@ -314,30 +371,22 @@ static void bmp085_start_up(void)
  */
 static void bmp085_get_up(void)
 {
-    uint8_t data[3];
-
-#if defined(BARO_EOC_GPIO)
-    // return old baro value if conversion time exceeds datasheet max when EOC is connected
-    if ((isEOCConnected) && (!isConversionComplete)) {
-        return;
-    }
-#endif
-
-    i2cRead(BARO_I2C_INSTANCE, BMP085_I2C_ADDR, BMP085_ADC_OUT_MSB_REG, 3, data);
-    bmp085_up = (((uint32_t) data[0] << 16) | ((uint32_t) data[1] << 8) | (uint32_t) data[2])
-            >> (8 - bmp085.oversampling_setting);
+    bmp085_read_adc(3);
 }
 
 STATIC_UNIT_TESTED void bmp085_calculate(int32_t *pressure, int32_t *temperature)
 {
-    int32_t temp, press;
-
-    temp = bmp085_get_temperature(bmp085_ut);
-    press = bmp085_get_pressure(bmp085_up);
+    if (!bmp085_comp.valid || bmp085_comp.ut != bmp085_ut) {
+        bmp085_comp.temperature = bmp085_get_temperature(bmp085_ut);
+        bmp085_get_pressure_terms();
+        bmp085_comp.ut = bmp085_ut;
+        bmp085_comp.valid = true;
+    }
+    const int32_t press = bmp085_get_pressure(bmp085_up);
     if (pressure)
         *pressure = press;
     if (temperature)
-        *temperature = temp;
+        *temperature = bmp085_comp.temperature;
 }
 
 static void bmp085_get_cal_param(void)
@@ -125,24 +125,59 @@ static void bmp280_get_ut(void)
 }
 
 #ifndef USE_BARO_SPI_BMP280
+// the trigger and the data read are queued on the bus, the read lands in bmp280_up/bmp280_ut from the I2C interrupt
+static uint8_t bmp280_mode = BMP280_MODE;
+static uint8_t bmp280_data[BMP280_DATA_FRAME_SIZE];
+
+static i2cJob_t bmp280_start_job = {
+    .device = BARO_I2C_INSTANCE,
+    .addr = BMP280_I2C_ADDR,
+    .reg = BMP280_CTRL_MEAS_REG,
+    .len = 1,
+    .buf = &bmp280_mode,
+};
+
+static void bmp280_read_done(i2cJob_t *job)
+{
+    if (!job->error) {
+        bmp280_up = (int32_t)((((uint32_t)(bmp280_data[0])) << 12) | (((uint32_t)(bmp280_data[1])) << 4) | ((uint32_t)bmp280_data[2] >> 4));
+        bmp280_ut = (int32_t)((((uint32_t)(bmp280_data[3])) << 12) | (((uint32_t)(bmp280_data[4])) << 4) | ((uint32_t)bmp280_data[5] >> 4));
+    }
+}
+
+static i2cJob_t bmp280_read_job = {
+    .device = BARO_I2C_INSTANCE,
+    .addr = BMP280_I2C_ADDR,
+    .reg = BMP280_PRESSURE_MSB_REG,
+    .len = BMP280_DATA_FRAME_SIZE,
+    .read = true,
+    .buf = bmp280_data,
+    .callback = bmp280_read_done,
+};
+
 static void bmp280_start_up(void)
 {
     // start measurement
     // set oversampling + power mode (forced), and start sampling
-    i2cWrite(BARO_I2C_INSTANCE, BMP280_I2C_ADDR, BMP280_CTRL_MEAS_REG, BMP280_MODE);
+    i2cSubmit(&bmp280_start_job);
 }
 
 static void bmp280_get_up(void)
 {
-    uint8_t data[BMP280_DATA_FRAME_SIZE];
-
-    // read data from sensor
-    i2cRead(BARO_I2C_INSTANCE, BMP280_I2C_ADDR, BMP280_PRESSURE_MSB_REG, BMP280_DATA_FRAME_SIZE, data);
-    bmp280_up = (int32_t)((((uint32_t)(data[0])) << 12) | (((uint32_t)(data[1])) << 4) | ((uint32_t)data[2] >> 4));
-    bmp280_ut = (int32_t)((((uint32_t)(data[3])) << 12) | (((uint32_t)(data[4])) << 4) | ((uint32_t)data[5] >> 4));
+    // read data from sensor, bmp280_calculate() uses the previous frame until this one completes
+    i2cSubmit(&bmp280_read_job);
 }
 #endif
 
+// the temperature and the temperature terms of the pressure compensation, redone only when the raw temperature changes
+static struct {
+    bool valid;
+    int32_t adc_T;
+    int32_t T;
+    int64_t pVar1;
+    int64_t pVar2;
+} bmp280_comp;
+
 // Returns temperature in DegC, resolution is 0.01 DegC. Output value of "5123" equals 51.23 DegC
 // t_fine carries fine temperature as global value
 static int32_t bmp280_compensate_T(int32_t adc_T)
@@ -157,21 +192,28 @@ static int32_t bmp280_compensate_T(int32_t adc_T)
     return T;
 }
 
-// Returns pressure in Pa as unsigned 32 bit integer in Q24.8 format (24 integer bits and 8 fractional bits).
-// Output value of "24674867" represents 24674867/256 = 96386.2 Pa = 963.862 hPa
-static uint32_t bmp280_compensate_P(int32_t adc_P)
+static void bmp280_compensate_P_terms(void)
 {
-    int64_t var1, var2, p;
+    int64_t var1, var2;
     var1 = ((int64_t)bmp280_cal.t_fine) - 128000;
     var2 = var1 * var1 * (int64_t)bmp280_cal.dig_P6;
     var2 = var2 + ((var1*(int64_t)bmp280_cal.dig_P5) << 17);
     var2 = var2 + (((int64_t)bmp280_cal.dig_P4) << 35);
     var1 = ((var1 * var1 * (int64_t)bmp280_cal.dig_P3) >> 8) + ((var1 * (int64_t)bmp280_cal.dig_P2) << 12);
     var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)bmp280_cal.dig_P1) >> 33;
-    if (var1 == 0)
+    bmp280_comp.pVar1 = var1;
+    bmp280_comp.pVar2 = var2;
+}
+
+// Returns pressure in Pa as unsigned 32 bit integer in Q24.8 format (24 integer bits and 8 fractional bits).
+// Output value of "24674867" represents 24674867/256 = 96386.2 Pa = 963.862 hPa
+static uint32_t bmp280_compensate_P(int32_t adc_P)
+{
+    int64_t var1, var2, p;
+    if (bmp280_comp.pVar1 == 0)
         return 0;
     p = 1048576 - adc_P;
-    p = (((p << 31) - var2) * 3125) / var1;
+    p = (((p << 31) - bmp280_comp.pVar2) * 3125) / bmp280_comp.pVar1;
     var1 = (((int64_t)bmp280_cal.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
     var2 = (((int64_t)bmp280_cal.dig_P8) * p) >> 19;
     p = ((p + var1 + var2) >> 8) + (((int64_t)bmp280_cal.dig_P7) << 4);
@@ -181,15 +223,19 @@ static uint32_t bmp280_compensate_P(int32_t adc_P)
 STATIC_UNIT_TESTED void bmp280_calculate(int32_t *pressure, int32_t *temperature)
 {
     // calculate
-    int32_t t;
     uint32_t p;
-    t = bmp280_compensate_T(bmp280_ut);
+    if (!bmp280_comp.valid || bmp280_comp.adc_T != bmp280_ut) {
+        bmp280_comp.T = bmp280_compensate_T(bmp280_ut);
+        bmp280_compensate_P_terms();
+        bmp280_comp.adc_T = bmp280_ut;
+        bmp280_comp.valid = true;
+    }
     p = bmp280_compensate_P(bmp280_up);
 
     if (pressure)
         *pressure = (int32_t)(p / 256);
     if (temperature)
-        *temperature = t;
+        *temperature = bmp280_comp.T;
 }
 
 #endif
@@ -47,7 +47,6 @@
 static void ms5611_reset(void);
 static uint16_t ms5611_prom(int8_t coef_num);
 STATIC_UNIT_TESTED int8_t ms5611_crc(uint16_t *prom);
-static uint32_t ms5611_read_adc(void);
 static void ms5611_start_ut(void);
 static void ms5611_get_ut(void);
 static void ms5611_start_up(void);
@@ -132,42 +131,91 @@ STATIC_UNIT_TESTED int8_t ms5611_crc(uint16_t *prom)
     return -1;
 }
 
-static uint32_t ms5611_read_adc(void)
+/*
+ * The conversion commands and ADC reads are queued on the bus instead of waited for. A result lands in
+ * ms5611_ut/ms5611_up from the I2C interrupt, so ms5611_calculate() works on the previous reading.
+ */
+static uint8_t ms5611_adc_buf[3];
+static uint32_t *ms5611_adc_target;
+static uint8_t ms5611_conv_data = 1;
+
+static void ms5611_read_adc_done(i2cJob_t *job)
+{
+    if (!job->error) {
+        *ms5611_adc_target = (ms5611_adc_buf[0] << 16) | (ms5611_adc_buf[1] << 8) | ms5611_adc_buf[2];
+    }
+}
+
+static i2cJob_t ms5611_read_job = {
+    .device = BARO_I2C_INSTANCE,
+    .addr = MS5611_ADDR,
+    .reg = CMD_ADC_READ,
+    .len = sizeof(ms5611_adc_buf),
+    .read = true,
+    .buf = ms5611_adc_buf,
+    .callback = ms5611_read_adc_done,
+};
+
+static i2cJob_t ms5611_conv_job = {
+    .device = BARO_I2C_INSTANCE,
+    .addr = MS5611_ADDR,
+    .len = 1,
+    .buf = &ms5611_conv_data,
+};
+
+static void ms5611_read_adc(uint32_t *target)
 {
-    uint8_t rxbuf[3];
-    i2cRead(BARO_I2C_INSTANCE, MS5611_ADDR, CMD_ADC_READ, 3, rxbuf); // read ADC
-    return (rxbuf[0] << 16) | (rxbuf[1] << 8) | rxbuf[2];
+    // a read still queued from the last cycle keeps its target, this cycle's value is skipped
+    if (!ms5611_read_job.busy) {
+        ms5611_adc_target = target;
+        i2cSubmit(&ms5611_read_job); // read ADC
+    }
+}
+
+static void ms5611_start_conversion(uint8_t cmd)
+{
+    if (!ms5611_conv_job.busy) {
+        ms5611_conv_job.reg = cmd;
+        i2cSubmit(&ms5611_conv_job);
+    }
 }
 
 static void ms5611_start_ut(void)
 {
-    i2cWrite(BARO_I2C_INSTANCE, MS5611_ADDR, CMD_ADC_CONV + CMD_ADC_D2 + ms5611_osr, 1); // D2 (temperature) conversion start!
+    ms5611_start_conversion(CMD_ADC_CONV + CMD_ADC_D2 + ms5611_osr); // D2 (temperature) conversion start!
 }
 
 static void ms5611_get_ut(void)
 {
-    ms5611_ut = ms5611_read_adc();
+    ms5611_read_adc(&ms5611_ut);
 }
 
 static void ms5611_start_up(void)
 {
-    i2cWrite(BARO_I2C_INSTANCE, MS5611_ADDR, CMD_ADC_CONV + CMD_ADC_D1 + ms5611_osr, 1); // D1 (pressure) conversion start!
+    ms5611_start_conversion(CMD_ADC_CONV + CMD_ADC_D1 + ms5611_osr); // D1 (pressure) conversion start!
 }
 
 static void ms5611_get_up(void)
 {
-    ms5611_up = ms5611_read_adc();
+    ms5611_read_adc(&ms5611_up);
 }
 
-STATIC_UNIT_TESTED void ms5611_calculate(int32_t *pressure, int32_t *temperature)
+// the temperature and the temperature terms of the pressure, redone only when the raw temperature changes
+static struct {
+    bool valid;
+    uint32_t ut;
+    int32_t temp;
+    int64_t off;
+    int64_t sens;
+} ms5611_comp;
+
+static void ms5611_calculate_temperature(void)
 {
-    uint32_t press;
-    int64_t temp;
     int64_t delt;
     int64_t dT = (int64_t)ms5611_ut - ((uint64_t)ms5611_c[5] * 256);
     int64_t off = ((int64_t)ms5611_c[2] << 16) + (((int64_t)ms5611_c[4] * dT) >> 7);
     int64_t sens = ((int64_t)ms5611_c[1] << 15) + (((int64_t)ms5611_c[3] * dT) >> 8);
-    temp = 2000 + ((dT * (int64_t)ms5611_c[6]) >> 23);
+    int64_t temp = 2000 + ((dT * (int64_t)ms5611_c[6]) >> 23);
 
     if (temp < 2000) { // temperature lower than 20degC
         delt = temp - 2000;
@@ -180,13 +228,25 @@ STATIC_UNIT_TESTED void ms5611_calculate(int32_t *pressure, int32_t *temperature
             off -= 7 * delt;
             sens -= (11 * delt) >> 1;
         }
-    temp -= ((dT * dT) >> 31);
+        temp -= ((dT * dT) >> 31);
     }
-    press = ((((int64_t)ms5611_up * sens) >> 21) - off) >> 15;
 
+    ms5611_comp.ut = ms5611_ut;
+    ms5611_comp.temp = temp;
+    ms5611_comp.off = off;
+    ms5611_comp.sens = sens;
+    ms5611_comp.valid = true;
+}
+
+STATIC_UNIT_TESTED void ms5611_calculate(int32_t *pressure, int32_t *temperature)
+{
+    if (!ms5611_comp.valid || ms5611_comp.ut != ms5611_ut) {
+        ms5611_calculate_temperature();
+    }
+    uint32_t press = ((((int64_t)ms5611_up * ms5611_comp.sens) >> 21) - ms5611_comp.off) >> 15;
 
     if (pressure)
         *pressure = press;
     if (temperature)
-        *temperature = temp;
+        *temperature = ms5611_comp.temp;
 }
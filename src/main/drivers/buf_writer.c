@@ -16,6 +16,9 @@
  */
 
 #include <stdint.h>
+#include <string.h>
+
+#include "common/maths.h"
 
 #include "buf_writer.h"
 
@@ -38,6 +41,20 @@ void bufWriterAppend(bufWriter_t *b, uint8_t ch)
     }
 }
 
+void bufWriterAppendBuf(bufWriter_t *b, const uint8_t *data, int len)
+{
+    while (len > 0) {
+        const int chunk = MIN(len, b->capacity - b->at);
+        memcpy(&b->data[b->at], data, chunk);
+        b->at += chunk;
+        data += chunk;
+        len -= chunk;
+        if (b->at >= b->capacity) {
+            bufWriterFlush(b);
+        }
+    }
+}
+
 void bufWriterFlush(bufWriter_t *b)
 {
     if (b->at != 0) {
@@ -64,9 +64,32 @@ typedef struct i2cState_s {
     volatile uint8_t* read_p;
 } i2cState_t;
 
+typedef struct i2cJob_s i2cJob_t;
+
+// called from the I2C interrupt once the transfer has finished or failed
+typedef void i2cJobCallbackFn(i2cJob_t *job);
+
+struct i2cJob_s {
+    I2CDevice device;
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t len;
+    bool read;
+    uint8_t *buf;
+    i2cJobCallbackFn *callback;
+    volatile bool busy;
+    volatile bool error;
+    i2cJob_t *next;
+};
+
 void i2cInit(I2CDevice device);
 bool i2cWriteBuffer(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data);
 bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t data);
 bool i2cRead(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t len, uint8_t* buf);
+// drivers without interrupt driven transfers complete the write before returning
+bool i2cWriteBufferAsync(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data);
+bool i2cBusy(I2CDevice device, bool *error);
+// queues the job behind any others on its device, returns false if the job is still queued from an earlier submit
+bool i2cSubmit(i2cJob_t *job);
 
 uint16_t i2cGetErrorCounter(void);
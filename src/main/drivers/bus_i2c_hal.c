@@ -159,6 +159,39 @@ bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t data)
     return i2cWriteBuffer(device, addr_, reg_, 1, &data);
 }
 
+bool i2cWriteBufferAsync(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data)
+{
+    return i2cWriteBuffer(device, addr_, reg_, len_, data);
+}
+
+bool i2cBusy(I2CDevice device, bool *error)
+{
+    UNUSED(device);
+    if (error) {
+        *error = false;
+    }
+    return false;
+}
+
+// transfers are polled, so the job is complete before this returns
+bool i2cSubmit(i2cJob_t *job)
+{
+    if (job->busy)
+        return false;
+
+    job->busy = true;
+    if (job->read) {
+        job->error = !i2cRead(job->device, job->addr, job->reg, job->len, job->buf);
+    } else {
+        job->error = !i2cWriteBuffer(job->device, job->addr, job->reg, job->len, job->buf);
+    }
+    job->busy = false;
+    if (job->callback) {
+        job->callback(job);
+    }
+    return true;
+}
+
 bool i2cRead(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len, uint8_t* buf)
 {
     HAL_StatusTypeDef status;
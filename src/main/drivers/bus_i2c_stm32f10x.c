@@ -125,20 +125,19 @@ void I2C3_EV_IRQHandler(void) {
 }
 #endif
 
-static bool i2cHandleHardwareFailure(I2CDevice device)
-{
-    i2cErrorCount++;
-    // reinit peripheral + clock out garbage
-    i2cInit(device);
-    return false;
-}
+typedef struct i2cJobQueue_s {
+    i2cJob_t *head;
+    i2cJob_t *tail;
+    volatile bool running;
+} i2cJobQueue_t;
 
-bool i2cWriteBuffer(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data)
-{
+static i2cJobQueue_t i2cJobQueue[I2CDEV_COUNT];
 
-    if (device == I2CINVALID)
-        return false;
+// backs i2cWriteBufferAsync()/i2cBusy()
+static i2cJob_t i2cAsyncWriteJob[I2CDEV_COUNT];
 
+static bool i2cStartTransfer(I2CDevice device, i2cJob_t *job)
+{
     uint32_t timeout = I2C_DEFAULT_TIMEOUT;
 
     I2C_TypeDef *I2Cx;
@@ -147,13 +146,13 @@ bool i2cWriteBuffer(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_,
     i2cState_t *state;
     state = &(i2cState[device]);
 
-    state->addr = addr_ << 1;
-    state->reg = reg_;
-    state->writing = 1;
-    state->reading = 0;
-    state->write_p = data;
-    state->read_p = data;
-    state->bytes = len_;
+    state->addr = job->addr << 1;
+    state->reg = job->reg;
+    state->writing = !job->read;
+    state->reading = job->read;
+    state->write_p = job->buf;
+    state->read_p = job->buf;
+    state->bytes = job->len;
     state->busy = 1;
     state->error = false;
 
@@ -161,64 +160,192 @@ bool i2cWriteBuffer(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_,
         if (!(I2Cx->CR1 & I2C_CR1_START)) {                             // ensure sending a start
             while (I2Cx->CR1 & I2C_CR1_STOP && --timeout > 0) {; }     // wait for any stop to finish sending
             if (timeout == 0)
-                return i2cHandleHardwareFailure(device);
+                return false;
             I2C_GenerateSTART(I2Cx, ENABLE);                            // send the start for the new job
         }
         I2C_ITConfig(I2Cx, I2C_IT_EVT | I2C_IT_ERR, ENABLE);            // allow the interrupts to fire off again
     }
+    return true;
+}
 
-    timeout = I2C_DEFAULT_TIMEOUT;
-    while (state->busy && --timeout > 0) {; }
-    if (timeout == 0)
-        return i2cHandleHardwareFailure(device);
+// takes the job at the head of the queue off it, the queue stays marked running until the next one is started
+static void i2cFinishJob(I2CDevice device, bool error)
+{
+    i2cJobQueue_t *queue = &i2cJobQueue[device];
+    i2cJob_t *job = queue->head;
 
-    return !(state->error);
+    queue->head = job->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    job->next = NULL;
+    job->error = error;
+    job->busy = false;
+    if (job->callback) {
+        job->callback(job);
+    }
 }
 
-bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t data)
+static void i2cStartNextJob(I2CDevice device)
 {
-    return i2cWriteBuffer(device, addr_, reg_, 1, &data);
+    i2cJobQueue_t *queue = &i2cJobQueue[device];
+
+    while (queue->head) {
+        if (i2cStartTransfer(device, queue->head)) {
+            return;
+        }
+        i2cErrorCount++;
+        i2cFinishJob(device, true);
+    }
+    queue->running = false;
 }
 
-bool i2cRead(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len, uint8_t* buf)
+// called from the interrupt handlers when the hardware is done with the current transfer
+static void i2cJobComplete(I2CDevice device)
 {
-    if (device == I2CINVALID)
+    i2cState_t *state = &(i2cState[device]);
+
+    state->busy = 0;
+    if (!i2cJobQueue[device].running) {
+        return;
+    }
+    i2cFinishJob(device, state->error);
+    i2cStartNextJob(device);
+}
+
+static void i2cHandleHardwareFailure(I2CDevice device)
+{
+    i2cErrorCount++;
+    // reinit peripheral + clock out garbage, this also leaves the interrupts off until the next transfer starts
+    i2cInit(device);
+
+    // abandon the transfer that hung and carry on with the rest of the queue
+    i2cState[device].busy = 0;
+    if (i2cJobQueue[device].running) {
+        i2cFinishJob(device, true);
+        i2cStartNextJob(device);
+    }
+}
+
+bool i2cSubmit(i2cJob_t *job)
+{
+    const I2CDevice device = job->device;
+
+    if (device == I2CINVALID || job->busy)
         return false;
 
-    uint32_t timeout = I2C_DEFAULT_TIMEOUT;
+    job->busy = true;
+    job->error = false;
+    job->next = NULL;
 
-    I2C_TypeDef *I2Cx;
-    I2Cx = i2cHardwareMap[device].dev;
+    // the transfer interrupts run above any BASEPRI mask, so keep them out while the queue is changed
+    NVIC_DisableIRQ(i2cHardwareMap[device].ev_irq);
+    NVIC_DisableIRQ(i2cHardwareMap[device].er_irq);
 
-    i2cState_t *state;
-    state = &(i2cState[device]);
+    i2cJobQueue_t *queue = &i2cJobQueue[device];
+    if (queue->tail) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
 
-    state->addr = addr_ << 1;
-    state->reg = reg_;
-    state->writing = 0;
-    state->reading = 1;
-    state->read_p = buf;
-    state->write_p = buf;
-    state->bytes = len;
-    state->busy = 1;
-    state->error = false;
+    const bool startNow = !queue->running;
+    queue->running = true;
 
-    if (!(I2Cx->CR2 & I2C_IT_EVT)) {                                    // if we are restarting the driver
-        if (!(I2Cx->CR1 & I2C_CR1_START)) {                             // ensure sending a start
-            while (I2Cx->CR1 & I2C_CR1_STOP && --timeout > 0) {; }     // wait for any stop to finish sending
-            if (timeout == 0)
-                return i2cHandleHardwareFailure(device);
-            I2C_GenerateSTART(I2Cx, ENABLE);                            // send the start for the new job
+    NVIC_EnableIRQ(i2cHardwareMap[device].er_irq);
+    NVIC_EnableIRQ(i2cHardwareMap[device].ev_irq);
+
+    if (startNow) {
+        i2cStartNextJob(device);
+    }
+    return true;
+}
+
+// a queued job waits for the ones ahead of it, each of which can take a few ms at up to 255 bytes
+#define I2C_JOB_TIMEOUT_US    10000
+
+static bool i2cWaitForJob(i2cJob_t *job)
+{
+    uint32_t startUs = micros();
+    while (job->busy) {
+        if (micros() - startUs > I2C_JOB_TIMEOUT_US) {
+            // fails the transfer at the head of the queue, which is this job or one ahead of it
+            i2cHandleHardwareFailure(job->device);
+            startUs = micros();
         }
-        I2C_ITConfig(I2Cx, I2C_IT_EVT | I2C_IT_ERR, ENABLE);            // allow the interrupts to fire off again
     }
+    return !job->error;
+}
+
+static bool i2cTransfer(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *buf, bool read)
+{
+    if (device == I2CINVALID)
+        return false;
+
+    i2cJob_t job = {
+        .device = device,
+        .addr = addr_,
+        .reg = reg_,
+        .len = len_,
+        .read = read,
+        .buf = buf,
+    };
+
+    if (!i2cSubmit(&job))
+        return false;
 
-    timeout = I2C_DEFAULT_TIMEOUT;
-    while (state->busy && --timeout > 0) {; }
-    if (timeout == 0)
-        return i2cHandleHardwareFailure(device);
+    return i2cWaitForJob(&job);
+}
 
-    return !(state->error);
+bool i2cWriteBuffer(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data)
+{
+    return i2cTransfer(device, addr_, reg_, len_, data, false);
+}
+
+/*
+ * Queues the write and returns, the interrupt handlers carry it out. data must stay unchanged until i2cBusy()
+ * returns false. Transfers queued after it wait for it to finish.
+ */
+bool i2cWriteBufferAsync(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data)
+{
+    if (device == I2CINVALID)
+        return false;
+
+    i2cJob_t *job = &i2cAsyncWriteJob[device];
+    if (job->busy && !i2cWaitForJob(job))
+        return false;
+
+    job->device = device;
+    job->addr = addr_;
+    job->reg = reg_;
+    job->len = len_;
+    job->read = false;
+    job->buf = data;
+    job->callback = NULL;
+
+    return i2cSubmit(job);
+}
+
+bool i2cBusy(I2CDevice device, bool *error)
+{
+    if (device == I2CINVALID)
+        return false;
+
+    if (error) {
+        *error = i2cAsyncWriteJob[device].error;
+    }
+    return i2cAsyncWriteJob[device].busy;
+}
+
+bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t data)
+{
+    return i2cWriteBuffer(device, addr_, reg_, 1, &data);
+}
+
+bool i2cRead(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len, uint8_t* buf)
+{
+    return i2cTransfer(device, addr_, reg_, len, buf, true);
 }
 
 static void i2c_er_handler(I2CDevice device) {
@@ -253,7 +380,7 @@ static void i2c_er_handler(I2CDevice device) {
         }
     }
     I2Cx->SR1 &= ~0x0F00;                                                       // reset all the error bits to clear the interrupt
-    state->busy = 0;
+    i2cJobComplete(device);
 }
 
 void i2c_ev_handler(I2CDevice device) {
@@ -369,7 +496,7 @@ void i2c_ev_handler(I2CDevice device) {
         subaddress_sent = 0;                                            // reset this here
         if (final_stop)                                                 // If there is a final stop and no more jobs, bus is inactive, disable interrupts to prevent BTF
             I2C_ITConfig(I2Cx, I2C_IT_EVT | I2C_IT_ERR, DISABLE);       // Disable EVT and ERR interrupts while bus inactive
-        state->busy = 0;
+        i2cJobComplete(device);                                         // hand the result back and start the next queued job
     }
 }
 
@@ -118,7 +118,7 @@ uint16_t i2cGetErrorCounter(void)
     return i2cErrorCount;
 }
 
-bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t data)
+bool i2cWriteBuffer(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t len, uint8_t *data)
 {
     addr_ <<= 1;
 
@@ -157,18 +157,20 @@ bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t data)
     }
 
     /* Configure slave address, nbytes, reload, end mode and start or stop generation */
-    I2C_TransferHandling(I2Cx, addr_, 1, I2C_AutoEnd_Mode, I2C_No_StartStop);
+    I2C_TransferHandling(I2Cx, addr_, len, I2C_AutoEnd_Mode, I2C_No_StartStop);
 
-    /* Wait until TXIS flag is set */
-    i2cTimeout = I2C_LONG_TIMEOUT;
-    while (I2C_GetFlagStatus(I2Cx, I2C_ISR_TXIS) == RESET) {
-        if ((i2cTimeout--) == 0) {
-            return i2cTimeoutUserCallback();
+    for (int i = 0; i < len; i++) {
+        /* Wait until TXIS flag is set */
+        i2cTimeout = I2C_LONG_TIMEOUT;
+        while (I2C_GetFlagStatus(I2Cx, I2C_ISR_TXIS) == RESET) {
+            if ((i2cTimeout--) == 0) {
+                return i2cTimeoutUserCallback();
+            }
         }
-    }
 
-    /* Write data to TXDR */
-    I2C_SendData(I2Cx, data);
+        /* Write data to TXDR */
+        I2C_SendData(I2Cx, data[i]);
+    }
 
     /* Wait until STOPF flag is set */
     i2cTimeout = I2C_LONG_TIMEOUT;
@@ -184,6 +186,44 @@ bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t data)
     return true;
 }
 
+bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t data)
+{
+    return i2cWriteBuffer(device, addr_, reg, 1, &data);
+}
+
+bool i2cWriteBufferAsync(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t len, uint8_t *data)
+{
+    return i2cWriteBuffer(device, addr_, reg, len, data);
+}
+
+bool i2cBusy(I2CDevice device, bool *error)
+{
+    UNUSED(device);
+    if (error) {
+        *error = false;
+    }
+    return false;
+}
+
+// transfers are polled, so the job is complete before this returns
+bool i2cSubmit(i2cJob_t *job)
+{
+    if (job->busy)
+        return false;
+
+    job->busy = true;
+    if (job->read) {
+        job->error = !i2cRead(job->device, job->addr, job->reg, job->len, job->buf);
+    } else {
+        job->error = !i2cWriteBuffer(job->device, job->addr, job->reg, job->len, job->buf);
+    }
+    job->busy = false;
+    if (job->callback) {
+        job->callback(job);
+    }
+    return true;
+}
+
 bool i2cRead(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t len, uint8_t* buf)
 {
     addr_ <<= 1;
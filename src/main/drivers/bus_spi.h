@@ -96,6 +96,48 @@ uint16_t spiGetErrorCounter(SPI_TypeDef *instance);
 void spiResetErrorCounter(SPI_TypeDef *instance);
 SPIDevice spiDeviceByInstance(SPI_TypeDef *instance);
 
+/*
+ * Bus arbiter for devices sharing an SPI bus. Each device has a descriptor with its chip select, clock divisor
+ * and priority. Blocking transfers from task context sit between spiBusAcquire() and spiBusRelease(). Transfers
+ * driven by DMA are queued as transactions, which are sent a segment at a time so that a higher priority device
+ * only ever waits for the segment in flight.
+ */
+typedef enum {
+    SPI_BUS_PRIORITY_LOW = 0,   // OSD, flash
+    SPI_BUS_PRIORITY_GYRO,
+} spiBusPriority_e;
+
+typedef struct spiBusDevice_s {
+    SPI_TypeDef *instance;
+    SPIDevice bus;
+    IO_t cs;
+    uint16_t divisor;           // 0 leaves the clock as the previous user set it
+    spiBusPriority_e priority;
+} spiBusDevice_t;
+
+typedef struct spiBusTransaction_s spiBusTransaction_t;
+
+// starts the DMA for one segment with the chip select already asserted, the DMA interrupt then calls spiBusSegmentComplete()
+typedef void spiBusSegmentStartFn(spiBusTransaction_t *transaction, const uint8_t *data, uint16_t len);
+
+struct spiBusTransaction_s {
+    const spiBusDevice_t *device;
+    spiBusSegmentStartFn *startSegment;
+    const uint8_t *data;
+    uint16_t len;
+    uint16_t segmentLen;        // the chip select is released between segments, so they must end on a command boundary
+    volatile uint16_t offset;
+    volatile bool busy;
+    spiBusTransaction_t *next;
+};
+
+void spiBusDeviceInit(spiBusDevice_t *device, SPI_TypeDef *instance, IO_t cs, uint16_t divisor, spiBusPriority_e priority);
+void spiBusSetDivisor(spiBusDevice_t *device, uint16_t divisor);
+void spiBusAcquire(const spiBusDevice_t *device);
+void spiBusRelease(const spiBusDevice_t *device);
+bool spiBusSubmit(spiBusTransaction_t *transaction);
+void spiBusSegmentComplete(spiBusTransaction_t *transaction);
+
 #if defined(USE_HAL_DRIVER)
 SPI_HandleTypeDef* spiHandleByInstance(SPI_TypeDef *instance);
 DMA_HandleTypeDef* spiSetDMATransmit(DMA_Stream_TypeDef *Stream, uint32_t Channel, SPI_TypeDef *Instance, uint8_t *pData, uint16_t Size);
@@ -0,0 +1,170 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <platform.h>
+
+#include "build/atomic.h"
+
+#include "common/maths.h"
+
+#include "bus_spi.h"
+#include "io.h"
+#include "nvic.h"
+
+typedef struct spiBusState_s {
+    spiBusTransaction_t *queue;         // highest priority first, the head is sent next
+    volatile uint8_t holders;           // blocking users between spiBusAcquire() and spiBusRelease()
+    volatile bool segmentActive;
+    uint16_t segmentLen;
+} spiBusState_t;
+
+static spiBusState_t spiBusState[SPIDEV_4 + 1];
+
+void spiBusDeviceInit(spiBusDevice_t *device, SPI_TypeDef *instance, IO_t cs, uint16_t divisor, spiBusPriority_e priority)
+{
+    device->instance = instance;
+    device->bus = spiDeviceByInstance(instance);
+    device->cs = cs;
+    device->divisor = divisor;
+    device->priority = priority;
+}
+
+// takes effect the next time the device is selected
+void spiBusSetDivisor(spiBusDevice_t *device, uint16_t divisor)
+{
+    device->divisor = divisor;
+}
+
+// drivers that still program the clock themselves can share the bus, so the divisor is set on every select
+static void spiBusSelect(const spiBusDevice_t *device)
+{
+    if (device->divisor) {
+        spiSetDivisor(device->instance, device->divisor);
+    }
+    IOLo(device->cs);
+}
+
+// must be called with the interrupts that submit or complete transactions masked
+static void spiBusStartNext(spiBusState_t *bus)
+{
+    spiBusTransaction_t *transaction = bus->queue;
+
+    if (!transaction || bus->holders || bus->segmentActive) {
+        return;
+    }
+
+    const uint16_t remaining = transaction->len - transaction->offset;
+    const uint16_t len = transaction->segmentLen ? MIN(transaction->segmentLen, remaining) : remaining;
+
+    spiBusSelect(transaction->device);
+    bus->segmentActive = true;
+    bus->segmentLen = len;
+    transaction->startSegment(transaction, transaction->data ? transaction->data + transaction->offset : NULL, len);
+}
+
+/*
+ * Queues a DMA transaction behind any of the same or higher priority. Returns false while the transaction is
+ * still queued from an earlier submit. Can be called from interrupt handlers.
+ */
+bool spiBusSubmit(spiBusTransaction_t *transaction)
+{
+    spiBusState_t *bus = &spiBusState[transaction->device->bus];
+    bool queued = false;
+
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        if (!transaction->busy) {
+            transaction->busy = true;
+            transaction->offset = 0;
+
+            spiBusTransaction_t **link = &bus->queue;
+            while (*link && (*link)->device->priority >= transaction->device->priority) {
+                link = &(*link)->next;
+            }
+            transaction->next = *link;
+            *link = transaction;
+
+            spiBusStartNext(bus);
+            queued = true;
+        }
+    }
+    return queued;
+}
+
+// called by the device's DMA interrupt handler once the segment has been clocked out and the DMA requests are off
+void spiBusSegmentComplete(spiBusTransaction_t *transaction)
+{
+    spiBusState_t *bus = &spiBusState[transaction->device->bus];
+
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        IOHi(transaction->device->cs);
+        bus->segmentActive = false;
+
+        transaction->offset += bus->segmentLen;
+        if (transaction->offset >= transaction->len) {
+            spiBusTransaction_t **link = &bus->queue;
+            while (*link && *link != transaction) {
+                link = &(*link)->next;
+            }
+            if (*link) {
+                *link = transaction->next;
+            }
+            transaction->next = NULL;
+            transaction->busy = false;
+        }
+
+        // a transaction queued at a higher priority during the segment goes next
+        spiBusStartNext(bus);
+    }
+}
+
+/*
+ * Claims the bus for a blocking transfer and asserts the device's chip select. Waits for queued transactions
+ * that outrank the device, and for the segment in flight, but no longer.
+ */
+void spiBusAcquire(const spiBusDevice_t *device)
+{
+    spiBusState_t *bus = &spiBusState[device->bus];
+    bool claimed = false;
+
+    while (!claimed) {
+        ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+            if (bus->holders || !bus->queue || bus->queue->device->priority <= device->priority) {
+                bus->holders++;
+                claimed = true;
+            }
+        }
+    }
+
+    while (bus->segmentActive);
+
+    spiBusSelect(device);
+}
+
+void spiBusRelease(const spiBusDevice_t *device)
+{
+    spiBusState_t *bus = &spiBusState[device->bus];
+
+    IOHi(device->cs);
+
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        bus->holders--;
+        spiBusStartNext(bus);
+    }
+}
@@ -80,6 +80,8 @@
 #define CNTL_MODE_SELF_TEST             0x08
 #define CNTL_MODE_FUSE_ROM              0x0F
 
+#define AK8963_AUTO_READ_LEN            8   // STATUS1 to STATUS2
+
 static float magGain[3] = { 1.0f, 1.0f, 1.0f };
 
 // FIXME pretend we have real MPU9250 support
@@ -176,6 +178,18 @@ static bool ak8963SensorCompleteRead(uint8_t *buf)
     mpu9250ReadRegister(MPU_RA_EXT_SENS_DATA_00, queuedRead.len, buf);               // read I2C buffer
     return true;
 }
+
+// set once the MPU reads STATUS1 to STATUS2 on every sample, and the gyro burst brings them in
+static bool ak8963AutoRead = false;
+
+static void ak8963SensorStartAutoRead(void)
+{
+    verifympu9250WriteRegister(MPU_RA_I2C_SLV0_ADDR, AK8963_MAG_I2C_ADDRESS | READ_FLAG);
+    verifympu9250WriteRegister(MPU_RA_I2C_SLV0_REG, AK8963_MAG_REG_STATUS1);
+    verifympu9250WriteRegister(MPU_RA_I2C_SLV0_CTRL, AK8963_AUTO_READ_LEN | 0x80);
+
+    ak8963AutoRead = mpuExtSensDataInit(AK8963_AUTO_READ_LEN);
+}
 #else
 static bool ak8963SensorRead(uint8_t addr_, uint8_t reg_, uint8_t len, uint8_t* buf)
 {
@@ -186,8 +200,55 @@ static bool ak8963SensorWrite(uint8_t addr_, uint8_t reg_, uint8_t data)
 {
     return i2cWrite(MAG_I2C_INSTANCE, addr_, reg_, data);
 }
+
+/*
+ * Once running, the STATUS1 to STATUS2 read and the next single measurement trigger are queued on the bus.
+ * Each call returns the sample read by the previous one.
+ */
+static uint8_t ak8963QueuedBuf[AK8963_AUTO_READ_LEN];
+static volatile bool ak8963QueuedReady = false;
+static uint8_t ak8963ModeOnce = CNTL_MODE_ONCE;
+
+static void ak8963QueuedReadDone(i2cJob_t *job)
+{
+    ak8963QueuedReady = !job->error;
+}
+
+static i2cJob_t ak8963ReadJob = {
+    .device = MAG_I2C_INSTANCE,
+    .addr = AK8963_MAG_I2C_ADDRESS,
+    .reg = AK8963_MAG_REG_STATUS1,
+    .len = sizeof(ak8963QueuedBuf),
+    .read = true,
+    .buf = ak8963QueuedBuf,
+    .callback = ak8963QueuedReadDone,
+};
+
+static i2cJob_t ak8963TriggerJob = {
+    .device = MAG_I2C_INSTANCE,
+    .addr = AK8963_MAG_I2C_ADDRESS,
+    .reg = AK8963_MAG_REG_CNTL,
+    .len = 1,
+    .buf = &ak8963ModeOnce,
+};
 #endif
 
+// STATUS1, 6 data bytes and STATUS2, which must be read to release the data registers
+static bool ak8963DecodeSample(const uint8_t *buf, int16_t *magData)
+{
+    const uint8_t status2 = buf[7];
+
+    if ((buf[0] & STATUS1_DATA_READY) == 0 || (status2 & STATUS2_DATA_ERROR) || (status2 & STATUS2_MAG_SENSOR_OVERFLOW)) {
+        return false;
+    }
+
+    magData[X] = -(int16_t)(buf[2] << 8 | buf[1]) * magGain[X];
+    magData[Y] = -(int16_t)(buf[4] << 8 | buf[3]) * magGain[Y];
+    magData[Z] = -(int16_t)(buf[6] << 8 | buf[5]) * magGain[Z];
+
+    return true;
+}
+
 static bool ak8963Init()
 {
     uint8_t calibration[3];
@@ -216,6 +277,8 @@ static bool ak8963Init()
     // Trigger first measurement
 #if defined(USE_SPI) && defined(MPU9250_SPI_INSTANCE)
     ak8963SensorWrite(AK8963_MAG_I2C_ADDRESS, AK8963_MAG_REG_CNTL, CNTL_MODE_CONT1);
+    delay(10);
+    ak8963SensorStartAutoRead();
 #else
     ak8963SensorWrite(AK8963_MAG_I2C_ADDRESS, AK8963_MAG_REG_CNTL, CNTL_MODE_ONCE);
 #endif
@@ -224,16 +287,18 @@ static bool ak8963Init()
 
 static bool ak8963Read(int16_t *magData)
 {
-    bool ack = false;
-    uint8_t buf[7];
+    uint8_t buf[AK8963_AUTO_READ_LEN];
 
 #if defined(USE_SPI) && defined(MPU9250_SPI_INSTANCE)
+    if (ak8963AutoRead) {
+        return mpuExtSensDataRead(buf) && ak8963DecodeSample(buf, magData);
+    }
 
-    // we currently need a different approach for the MPU9250 connected via SPI.
-    // we cannot use the ak8963SensorRead() method for SPI, it is to slow and blocks for far too long.
-
+    // without the gyro burst, the MPU9250 I2C master is driven over SPI a step per call,
+    // ak8963SensorRead() is too slow and blocks for far too long.
     static ak8963ReadState_e state = CHECK_STATUS;
 
+    bool ack = false;
     bool retry = true;
 
 restart:
@@ -263,9 +328,8 @@ restart:
                 return false;
             }
 
-
             // read the 6 bytes of data and the status2 register
-            ak8963SensorStartRead(AK8963_MAG_I2C_ADDRESS, AK8963_MAG_REG_HXL, 7);
+            ak8963SensorStartRead(AK8963_MAG_I2C_ADDRESS, AK8963_MAG_REG_STATUS1, AK8963_AUTO_READ_LEN);
 
             state++;
 
@@ -281,31 +345,26 @@ restart:
             ack = ak8963SensorCompleteRead(&buf[0]);
         }
     }
-#else
-    ack = ak8963SensorRead(AK8963_MAG_I2C_ADDRESS, AK8963_MAG_REG_STATUS1, 1, &buf[0]);
 
-    uint8_t status = buf[0];
+    state = CHECK_STATUS;
+    return ack && ak8963DecodeSample(buf, magData);
+#else
+    UNUSED(buf);
 
-    if (!ack || (status & STATUS1_DATA_READY) == 0) {
+    if (ak8963ReadJob.busy || ak8963TriggerJob.busy) {
         return false;
     }
 
-    ack = ak8963SensorRead(AK8963_MAG_I2C_ADDRESS, AK8963_MAG_REG_HXL, 7, &buf[0]);
-#endif
-    uint8_t status2 = buf[6];
-    if (!ack || (status2 & STATUS2_DATA_ERROR) || (status2 & STATUS2_MAG_SENSOR_OVERFLOW)) {
-        return false;
+    bool ready = false;
+    if (ak8963QueuedReady) {
+        ready = ak8963DecodeSample(ak8963QueuedBuf, magData);
+        ak8963QueuedReady = false;
     }
 
-    magData[X] = -(int16_t)(buf[1] << 8 | buf[0]) * magGain[X];
-    magData[Y] = -(int16_t)(buf[3] << 8 | buf[2]) * magGain[Y];
-    magData[Z] = -(int16_t)(buf[5] << 8 | buf[4]) * magGain[Z];
-
-#if defined(USE_SPI) && defined(MPU9250_SPI_INSTANCE)
-    state = CHECK_STATUS;
-    return true;
-#else
-    return ak8963SensorWrite(AK8963_MAG_I2C_ADDRESS, AK8963_MAG_REG_CNTL, CNTL_MODE_ONCE); // start reading again
+    // the read takes the measurement triggered by the previous call, then the next one starts
+    i2cSubmit(&ak8963ReadJob);
+    i2cSubmit(&ak8963TriggerJob);
+    return ready;
 #endif
 }
 
@@ -92,39 +92,61 @@ static bool ak8975Init()
 #define BIT_STATUS2_REG_DATA_ERROR              (1 << 2)
 #define BIT_STATUS2_REG_MAG_SENSOR_OVERFLOW     (1 << 3)
 
-static bool ak8975Read(int16_t *magData)
-{
-    bool ack;
-    uint8_t status;
-    uint8_t buf[6];
-
-    ack = i2cRead(MAG_I2C_INSTANCE, AK8975_MAG_I2C_ADDRESS, AK8975_MAG_REG_STATUS1, 1, &status);
-    if (!ack || (status & BIT_STATUS1_REG_DATA_READY) == 0) {
-        return false;
-    }
+/*
+ * Once running, the STATUS1 to STATUS2 read and the next single measurement trigger are queued on the bus.
+ * Each call returns the sample read by the previous one.
+ */
+static uint8_t ak8975QueuedBuf[8];  // STATUS1, HXL to HZH, STATUS2
+static volatile bool ak8975QueuedReady = false;
+static uint8_t ak8975ModeOnce = 0x01;
 
-    i2cRead(MAG_I2C_INSTANCE, AK8975_MAG_I2C_ADDRESS, AK8975_MAG_REG_HXL, 6, buf); // read from AK8975_MAG_REG_HXL to AK8975_MAG_REG_HZH
+static void ak8975QueuedReadDone(i2cJob_t *job)
+{
+    ak8975QueuedReady = !job->error;
+}
 
-    ack = i2cRead(MAG_I2C_INSTANCE, AK8975_MAG_I2C_ADDRESS, AK8975_MAG_REG_STATUS2, 1, &status);
-    if (!ack) {
-        return false;
-    }
+static i2cJob_t ak8975ReadJob = {
+    .device = MAG_I2C_INSTANCE,
+    .addr = AK8975_MAG_I2C_ADDRESS,
+    .reg = AK8975_MAG_REG_STATUS1,
+    .len = sizeof(ak8975QueuedBuf),
+    .read = true,
+    .buf = ak8975QueuedBuf,
+    .callback = ak8975QueuedReadDone,
+};
+
+static i2cJob_t ak8975TriggerJob = {
+    .device = MAG_I2C_INSTANCE,
+    .addr = AK8975_MAG_I2C_ADDRESS,
+    .reg = AK8975_MAG_REG_CNTL,
+    .len = 1,
+    .buf = &ak8975ModeOnce,
+};
 
-    if (status & BIT_STATUS2_REG_DATA_ERROR) {
+static bool ak8975Read(int16_t *magData)
+{
+    if (ak8975ReadJob.busy || ak8975TriggerJob.busy) {
         return false;
     }
 
-    if (status & BIT_STATUS2_REG_MAG_SENSOR_OVERFLOW) {
-        return false;
+    bool ready = false;
+    if (ak8975QueuedReady) {
+        const uint8_t *buf = ak8975QueuedBuf;
+        const uint8_t status2 = buf[7];
+        ak8975QueuedReady = false;
+
+        if ((buf[0] & BIT_STATUS1_REG_DATA_READY) && !(status2 & BIT_STATUS2_REG_DATA_ERROR) && !(status2 & BIT_STATUS2_REG_MAG_SENSOR_OVERFLOW)) {
+            magData[X] = -(int16_t)(buf[2] << 8 | buf[1]) * 4;
+            magData[Y] = -(int16_t)(buf[4] << 8 | buf[3]) * 4;
+            magData[Z] = -(int16_t)(buf[6] << 8 | buf[5]) * 4;
+            ready = true;
+        }
     }
 
-    magData[X] = -(int16_t)(buf[1] << 8 | buf[0]) * 4;
-    magData[Y] = -(int16_t)(buf[3] << 8 | buf[2]) * 4;
-    magData[Z] = -(int16_t)(buf[5] << 8 | buf[4]) * 4;
-
-
-    i2cWrite(MAG_I2C_INSTANCE, AK8975_MAG_I2C_ADDRESS, AK8975_MAG_REG_CNTL, 0x01); // start reading again
-    return true;
+    // the read takes the measurement triggered by the previous call, then the next one starts
+    i2cSubmit(&ak8975ReadJob);
+    i2cSubmit(&ak8975TriggerJob);
+    return ready;
 }
 
 bool ak8975Detect(magDev_t *mag)
@@ -184,6 +184,44 @@ static bool hmc5883lRead(int16_t *magData)
     return true;
 }
 
+static uint8_t hmc5883lQueuedBuf[6];
+static volatile bool hmc5883lQueuedReady = false;
+
+static void hmc5883lQueuedReadDone(i2cJob_t *job)
+{
+    hmc5883lQueuedReady = !job->error;
+}
+
+static i2cJob_t hmc5883lReadJob = {
+    .device = MAG_I2C_INSTANCE,
+    .addr = MAG_ADDRESS,
+    .reg = MAG_DATA_REGISTER,
+    .len = sizeof(hmc5883lQueuedBuf),
+    .read = true,
+    .buf = hmc5883lQueuedBuf,
+    .callback = hmc5883lQueuedReadDone,
+};
+
+// used once the sensor is running: returns the sample read by the previous call and queues the next read
+static bool hmc5883lReadQueued(int16_t *magData)
+{
+    if (hmc5883lReadJob.busy) {
+        return false;
+    }
+
+    const bool ready = hmc5883lQueuedReady;
+    if (ready) {
+        const uint8_t *buf = hmc5883lQueuedBuf;
+        magData[X] = (int16_t)(buf[0] << 8 | buf[1]) * magGain[X];
+        magData[Z] = (int16_t)(buf[2] << 8 | buf[3]) * magGain[Z];
+        magData[Y] = (int16_t)(buf[4] << 8 | buf[5]) * magGain[Y];
+        hmc5883lQueuedReady = false;
+    }
+
+    i2cSubmit(&hmc5883lReadJob);
+    return ready;
+}
+
 static bool hmc5883lInit(void)
 {
     int16_t magADC[3];
@@ -268,7 +306,7 @@ bool hmc5883lDetect(magDev_t* mag, const hmc5883Config_t *hmc5883ConfigToUse)
         return false;
 
     mag->init = hmc5883lInit;
-    mag->read = hmc5883lRead;
+    mag->read = hmc5883lReadQueued;
 
     return true;
 }
@@ -17,9 +17,12 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "platform.h"
 
+#include "common/utils.h"
+
 #include "bus_i2c.h"
 #include "system.h"
 
@@ -178,9 +181,36 @@ static bool i2c_OLED_send_cmd(uint8_t command)
     return i2cWrite(OLED_I2C_INSTANCE, OLED_address, 0x80, command);
 }
 
-static bool i2c_OLED_send_byte(uint8_t val)
+/*
+ * Writes go into a character framebuffer. i2c_OLED_flush() sends one changed page (character row) per call as a
+ * single interrupt driven I2C write, comparing against what was last sent so unchanged rows are skipped.
+ */
+#define OLED_PAGE_HEADER_LENGTH 5
+
+static uint8_t oledChars[SCREEN_CHARACTER_ROW_COUNT][SCREEN_CHARACTER_COLUMN_COUNT];
+static uint32_t oledInverse[SCREEN_CHARACTER_ROW_COUNT];   // bit per column
+static uint8_t oledSentChars[SCREEN_CHARACTER_ROW_COUNT][SCREEN_CHARACTER_COLUMN_COUNT];
+static uint32_t oledSentInverse[SCREEN_CHARACTER_ROW_COUNT];
+static uint8_t oledCursorCol;
+static uint8_t oledCursorRow;
+
+// page address, low and high column address in control byte pairs, then the data control byte and one page
+static uint8_t oledPageBuffer[OLED_PAGE_HEADER_LENGTH + 1 + SCREEN_WIDTH];
+static int8_t oledPageInFlight = -1;
+
+static void i2c_OLED_invalidate_row(uint8_t row)
+{
+    // no character uses 0xFF, so the row is different to anything written and is sent again
+    memset(oledSentChars[row], 0xFF, SCREEN_CHARACTER_COLUMN_COUNT);
+}
+
+static void i2c_OLED_clear_buffer(void)
 {
-    return i2cWrite(OLED_I2C_INSTANCE, OLED_address, 0x40, val);
+    memset(oledChars, ' ', sizeof(oledChars));
+    memset(oledInverse, 0, sizeof(oledInverse));
+    for (int row = 0; row < SCREEN_CHARACTER_ROW_COUNT; row++) {
+        i2c_OLED_invalidate_row(row);
+    }
 }
 
 void i2c_OLED_clear_display(void)
@@ -193,49 +223,42 @@ void i2c_OLED_clear_display(void)
     i2c_OLED_send_cmd(0x40);              // Display start line register to 0
     i2c_OLED_send_cmd(0);                 // Set low col address to 0
     i2c_OLED_send_cmd(0x10);              // Set high col address to 0
-    for(uint16_t i = 0; i < 1024; i++) {  // fill the display's RAM with graphic... 128*64 pixel picture
-        i2c_OLED_send_byte(0x00);  // clear
-    }
     i2c_OLED_send_cmd(0x81);              // Setup CONTRAST CONTROL, following byte is the contrast Value... always a 2 byte instruction
     i2c_OLED_send_cmd(200);               // Here you can set the brightness 1 = dull, 255 is very bright
     i2c_OLED_send_cmd(0xaf);              // display on
+    // the display RAM is filled by i2c_OLED_flush()
+    i2c_OLED_clear_buffer();
 }
 
 void i2c_OLED_clear_display_quick(void)
 {
-    i2c_OLED_send_cmd(0xb0);              // set page address to 0
-    i2c_OLED_send_cmd(0x40);              // Display start line register to 0
-    i2c_OLED_send_cmd(0);                 // Set low col address to 0
-    i2c_OLED_send_cmd(0x10);              // Set high col address to 0
-    for(uint16_t i = 0; i < 1024; i++) {      // fill the display's RAM with graphic... 128*64 pixel picture
-        i2c_OLED_send_byte(0x00);  // clear
-    }
+    memset(oledChars, ' ', sizeof(oledChars));
+    memset(oledInverse, 0, sizeof(oledInverse));
 }
 
 void i2c_OLED_set_xy(uint8_t col, uint8_t row)
 {
-    i2c_OLED_send_cmd(0xb0 + row);                      //set page address
-    i2c_OLED_send_cmd(0x00 + ((CHARACTER_WIDTH_TOTAL * col) & 0x0f));         //set low col address
-    i2c_OLED_send_cmd(0x10 + (((CHARACTER_WIDTH_TOTAL * col) >> 4) & 0x0f));  //set high col address
+    oledCursorCol = col;
+    oledCursorRow = row;
 }
 
 void i2c_OLED_set_line(uint8_t row)
 {
-    i2c_OLED_send_cmd(0xb0 + row); //set page address
-    i2c_OLED_send_cmd(0);          //set low col address
-    i2c_OLED_send_cmd(0x10);       //set high col address
+    oledCursorCol = 0;
+    oledCursorRow = row;
 }
 
 void i2c_OLED_send_char(unsigned char ascii)
 {
-    unsigned char i;
-    uint8_t buffer;
-    for (i = 0; i < 5; i++) {
-        buffer = multiWiiFont[ascii - 32][i];
-        buffer ^= CHAR_FORMAT;  // apply
-        i2c_OLED_send_byte(buffer);
+    if (oledCursorRow < SCREEN_CHARACTER_ROW_COUNT && oledCursorCol < SCREEN_CHARACTER_COLUMN_COUNT) {
+        oledChars[oledCursorRow][oledCursorCol] = ascii;
+        if (CHAR_FORMAT == INVERSE_CHAR_FORMAT) {
+            oledInverse[oledCursorRow] |= 1 << oledCursorCol;
+        } else {
+            oledInverse[oledCursorRow] &= ~(1 << oledCursorCol);
+        }
     }
-    i2c_OLED_send_byte(CHAR_FORMAT);    // the gap
+    oledCursorCol++;
 }
 
 void i2c_OLED_send_string(const char *string)
@@ -247,6 +270,61 @@ void i2c_OLED_send_string(const char *string)
     }
 }
 
+static void i2c_OLED_render_page(uint8_t row)
+{
+    uint8_t *p = oledPageBuffer;
+
+    *p++ = 0xb0 + row;  // set page address
+    *p++ = 0x80;
+    *p++ = 0;           // set low col address
+    *p++ = 0x80;
+    *p++ = 0x10;        // set high col address
+    *p++ = 0x40;        // the rest is data
+
+    for (int col = 0; col < SCREEN_CHARACTER_COLUMN_COUNT; col++) {
+        const uint8_t format = (oledInverse[row] & (1 << col)) ? INVERSE_CHAR_FORMAT : NORMAL_CHAR_FORMAT;
+        for (int i = 0; i < FONT_WIDTH; i++) {
+            *p++ = multiWiiFont[oledChars[row][col] - 32][i] ^ format;
+        }
+        *p++ = format;   // the gap
+    }
+    while (p < ARRAYEND(oledPageBuffer)) {
+        *p++ = 0;
+    }
+}
+
+/*
+ * Sends the next changed page if the previous transfer has completed, returns true when the display is up to date.
+ */
+bool i2c_OLED_flush(void)
+{
+    bool error;
+    if (i2cBusy(OLED_I2C_INSTANCE, &error)) {
+        return false;
+    }
+    if (oledPageInFlight >= 0 && error) {
+        i2c_OLED_invalidate_row(oledPageInFlight);
+    }
+    oledPageInFlight = -1;
+
+    for (int row = 0; row < SCREEN_CHARACTER_ROW_COUNT; row++) {
+        if (oledSentInverse[row] == oledInverse[row] && memcmp(oledSentChars[row], oledChars[row], SCREEN_CHARACTER_COLUMN_COUNT) == 0) {
+            continue;
+        }
+        i2c_OLED_render_page(row);
+        memcpy(oledSentChars[row], oledChars[row], SCREEN_CHARACTER_COLUMN_COUNT);
+        oledSentInverse[row] = oledInverse[row];
+        oledPageInFlight = row;
+        // the first control byte goes in the register address
+        if (!i2cWriteBufferAsync(OLED_I2C_INSTANCE, OLED_address, 0x80, sizeof(oledPageBuffer), oledPageBuffer)) {
+            i2c_OLED_invalidate_row(row);
+            oledPageInFlight = -1;
+        }
+        return false;
+    }
+    return true;
+}
+
 /**
 * according to http://www.adafruit.com/datasheets/UG-2864HSWEG01.pdf Chapter 4.4 Page 15
 */
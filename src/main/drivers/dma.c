@@ -63,11 +63,44 @@ DEFINE_DMA_IRQ_HANDLER(2, 4, DMA2_CH4_HANDLER)
 DEFINE_DMA_IRQ_HANDLER(2, 5, DMA2_CH5_HANDLER)
 #endif
 
-void dmaInit(dmaIdentifier_e identifier, resourceOwner_e owner, uint8_t resourceIndex)
+static dmaConflict_t dmaConflicts[DMA_MAX_CONFLICTS];
+static uint8_t dmaConflictCount;
+
+/*
+ * Claims the stream for the resource, unless another resource already owns it, in which
+ * case the claim is recorded as a conflict for the CLI and false is returned.
+ */
+bool dmaAllocate(dmaIdentifier_e identifier, resourceOwner_e owner, uint8_t resourceIndex)
 {
+    dmaChannelDescriptor_t *descriptor = &dmaDescriptors[identifier];
+
+    if (descriptor->owner != OWNER_FREE && (descriptor->owner != owner || descriptor->resourceIndex != resourceIndex)) {
+        if (dmaConflictCount < DMA_MAX_CONFLICTS) {
+            dmaConflicts[dmaConflictCount].identifier = identifier;
+            dmaConflicts[dmaConflictCount].owner = owner;
+            dmaConflicts[dmaConflictCount].resourceIndex = resourceIndex;
+            dmaConflictCount++;
+        }
+        return false;
+    }
+
     RCC_AHBPeriphClockCmd(dmaDescriptors[identifier].rcc, ENABLE);
-    dmaDescriptors[identifier].owner = owner;
-    dmaDescriptors[identifier].resourceIndex = resourceIndex;
+    descriptor->owner = owner;
+    descriptor->resourceIndex = resourceIndex;
+    return true;
+}
+
+// Gives up a claim made with dmaAllocate(), for a driver that can't use the stream after all
+void dmaRelease(dmaIdentifier_e identifier)
+{
+    dmaDescriptors[identifier].owner = OWNER_FREE;
+    dmaDescriptors[identifier].resourceIndex = 0;
+}
+
+// For the drivers with a fixed stream, which use it whether or not the claim succeeds
+void dmaInit(dmaIdentifier_e identifier, resourceOwner_e owner, uint8_t resourceIndex)
+{
+    dmaAllocate(identifier, owner, resourceIndex);
 }
 
 void dmaSetHandler(dmaIdentifier_e identifier, dmaCallbackHandlerFuncPtr callback, uint32_t priority, uint32_t userParam)
@@ -96,6 +129,16 @@ uint8_t dmaGetResourceIndex(dmaIdentifier_e identifier)
     return dmaDescriptors[identifier].resourceIndex;
 }
 
+uint8_t dmaGetConflictCount(void)
+{
+    return dmaConflictCount;
+}
+
+const dmaConflict_t *dmaGetConflict(uint8_t index)
+{
+    return index < dmaConflictCount ? &dmaConflicts[index] : NULL;
+}
+
 dmaIdentifier_e dmaGetIdentifier(const DMA_Channel_TypeDef* channel)
 {
     for (int i = 0; i < DMA_MAX_DESCRIPTORS; i++) {
@@ -40,6 +40,7 @@ typedef struct dmaChannelDescriptor_s {
 
 #if defined(STM32F4) || defined(STM32F7)
 
+// only needed for buffers the caller owns, buffers declared DMA_RAM are outside the D-cache on F7
 #define HAL_CLEANINVALIDATECACHE(addr, size) (SCB_CleanInvalidateDCache_by_Addr((uint32_t*)((uint32_t)addr & ~0x1f), ((uint32_t)(addr + size + 0x1f) & ~0x1f) - ((uint32_t)addr & ~0x1f)))
 #define HAL_CLEANCACHE(addr, size) (SCB_CleanDCache_by_Addr((uint32_t*)((uint32_t)addr & ~0x1f), ((uint32_t)(addr + size + 0x1f) & ~0x1f) - ((uint32_t)addr & ~0x1f)))
 
@@ -88,6 +89,27 @@ typedef enum {
 
 dmaIdentifier_e dmaGetIdentifier(const DMA_Stream_TypeDef* stream);
 
+// The peripheral requests a stream can serve, each on one channel of the stream
+typedef enum {
+    DMA_REQUEST_RX = 0,
+    DMA_REQUEST_TX,
+    DMA_REQUEST_TIM_CH1,
+    DMA_REQUEST_TIM_CH2,
+    DMA_REQUEST_TIM_CH3,
+    DMA_REQUEST_TIM_CH4,
+    DMA_REQUEST_TIM_UP,
+} dmaRequest_e;
+
+typedef struct dmaStreamOption_s {
+    const void *peripheral;
+    dmaRequest_e request;
+    DMA_Stream_TypeDef *stream;
+    uint32_t channel;
+} dmaStreamOption_t;
+
+bool dmaFindRequest(dmaStreamOption_t *option, resourceOwner_e owner, uint8_t resourceIndex);
+bool dmaAllocateRequest(dmaStreamOption_t *option, resourceOwner_e owner, uint8_t resourceIndex);
+
 #else
 
 typedef enum {
@@ -130,8 +152,21 @@ dmaIdentifier_e dmaGetIdentifier(const DMA_Channel_TypeDef* channel);
 
 #endif
 
+// Claims made for a stream or channel that another resource already owns, as reported by the CLI
+#define DMA_MAX_CONFLICTS   4
+
+typedef struct dmaConflict_s {
+    dmaIdentifier_e identifier;
+    resourceOwner_e owner;
+    uint8_t resourceIndex;
+} dmaConflict_t;
+
 void dmaInit(dmaIdentifier_e identifier, resourceOwner_e owner, uint8_t resourceIndex);
+bool dmaAllocate(dmaIdentifier_e identifier, resourceOwner_e owner, uint8_t resourceIndex);
+void dmaRelease(dmaIdentifier_e identifier);
 void dmaSetHandler(dmaIdentifier_e identifier, dmaCallbackHandlerFuncPtr callback, uint32_t priority, uint32_t userParam);
 
 resourceOwner_e dmaGetOwner(dmaIdentifier_e identifier);
 uint8_t dmaGetResourceIndex(dmaIdentifier_e identifier);
+uint8_t dmaGetConflictCount(void);
+const dmaConflict_t *dmaGetConflict(uint8_t index);
@@ -0,0 +1,166 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <platform.h>
+
+#include "common/utils.h"
+
+#include "drivers/dma.h"
+#include "drivers/resource.h"
+
+#ifdef USE_HAL_DRIVER
+#define DMA_CH(n) DMA_CHANNEL_ ## n
+#else
+#define DMA_CH(n) DMA_Channel_ ## n
+#endif
+
+#define DMA_OPTION(p, r, s, c) { .peripheral = (const void *)(p), .request = (r), .stream = (s), .channel = DMA_CH(c) }
+
+/*
+ * The streams and channels that serve each request, from the DMA request mapping tables of
+ * the F4 and F7 reference manuals, which agree for these peripherals.
+ */
+static const dmaStreamOption_t dmaStreamOptions[] = {
+    DMA_OPTION(USART1, DMA_REQUEST_RX,      DMA2_Stream5, 4),
+    DMA_OPTION(USART1, DMA_REQUEST_RX,      DMA2_Stream2, 4),
+    DMA_OPTION(USART1, DMA_REQUEST_TX,      DMA2_Stream7, 4),
+    DMA_OPTION(USART2, DMA_REQUEST_RX,      DMA1_Stream5, 4),
+    DMA_OPTION(USART2, DMA_REQUEST_TX,      DMA1_Stream6, 4),
+    DMA_OPTION(USART3, DMA_REQUEST_RX,      DMA1_Stream1, 4),
+    DMA_OPTION(USART3, DMA_REQUEST_TX,      DMA1_Stream3, 4),
+    DMA_OPTION(USART3, DMA_REQUEST_TX,      DMA1_Stream4, 7),
+    DMA_OPTION(UART4,  DMA_REQUEST_RX,      DMA1_Stream2, 4),
+    DMA_OPTION(UART4,  DMA_REQUEST_TX,      DMA1_Stream4, 4),
+    DMA_OPTION(UART5,  DMA_REQUEST_RX,      DMA1_Stream0, 4),
+    DMA_OPTION(UART5,  DMA_REQUEST_TX,      DMA1_Stream7, 4),
+    DMA_OPTION(USART6, DMA_REQUEST_RX,      DMA2_Stream1, 5),
+    DMA_OPTION(USART6, DMA_REQUEST_RX,      DMA2_Stream2, 5),
+    DMA_OPTION(USART6, DMA_REQUEST_TX,      DMA2_Stream6, 5),
+    DMA_OPTION(USART6, DMA_REQUEST_TX,      DMA2_Stream7, 5),
+    DMA_OPTION(UART7,  DMA_REQUEST_RX,      DMA1_Stream3, 5),
+    DMA_OPTION(UART7,  DMA_REQUEST_TX,      DMA1_Stream1, 5),
+    DMA_OPTION(UART8,  DMA_REQUEST_RX,      DMA1_Stream6, 5),
+    DMA_OPTION(UART8,  DMA_REQUEST_TX,      DMA1_Stream0, 5),
+
+    DMA_OPTION(SPI1,   DMA_REQUEST_RX,      DMA2_Stream0, 3),
+    DMA_OPTION(SPI1,   DMA_REQUEST_RX,      DMA2_Stream2, 3),
+    DMA_OPTION(SPI1,   DMA_REQUEST_TX,      DMA2_Stream3, 3),
+    DMA_OPTION(SPI1,   DMA_REQUEST_TX,      DMA2_Stream5, 3),
+    DMA_OPTION(SPI2,   DMA_REQUEST_RX,      DMA1_Stream3, 0),
+    DMA_OPTION(SPI2,   DMA_REQUEST_TX,      DMA1_Stream4, 0),
+    DMA_OPTION(SPI3,   DMA_REQUEST_RX,      DMA1_Stream0, 0),
+    DMA_OPTION(SPI3,   DMA_REQUEST_RX,      DMA1_Stream2, 0),
+    DMA_OPTION(SPI3,   DMA_REQUEST_TX,      DMA1_Stream5, 0),
+    DMA_OPTION(SPI3,   DMA_REQUEST_TX,      DMA1_Stream7, 0),
+
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH1, DMA2_Stream1, 6),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH1, DMA2_Stream3, 6),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH1, DMA2_Stream6, 0),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH2, DMA2_Stream2, 6),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH2, DMA2_Stream6, 0),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH3, DMA2_Stream6, 6),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH3, DMA2_Stream6, 0),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_CH4, DMA2_Stream4, 6),
+    DMA_OPTION(TIM1,   DMA_REQUEST_TIM_UP,  DMA2_Stream5, 6),
+
+    DMA_OPTION(TIM2,   DMA_REQUEST_TIM_CH1, DMA1_Stream5, 3),
+    DMA_OPTION(TIM2,   DMA_REQUEST_TIM_CH2, DMA1_Stream6, 3),
+    DMA_OPTION(TIM2,   DMA_REQUEST_TIM_CH3, DMA1_Stream1, 3),
+    DMA_OPTION(TIM2,   DMA_REQUEST_TIM_CH4, DMA1_Stream6, 3),
+    DMA_OPTION(TIM2,   DMA_REQUEST_TIM_CH4, DMA1_Stream7, 3),
+    DMA_OPTION(TIM2,   DMA_REQUEST_TIM_UP,  DMA1_Stream1, 3),
+    DMA_OPTION(TIM2,   DMA_REQUEST_TIM_UP,  DMA1_Stream7, 3),
+
+    DMA_OPTION(TIM3,   DMA_REQUEST_TIM_CH1, DMA1_Stream4, 5),
+    DMA_OPTION(TIM3,   DMA_REQUEST_TIM_CH2, DMA1_Stream5, 5),
+    DMA_OPTION(TIM3,   DMA_REQUEST_TIM_CH3, DMA1_Stream7, 5),
+    DMA_OPTION(TIM3,   DMA_REQUEST_TIM_CH4, DMA1_Stream2, 5),
+    DMA_OPTION(TIM3,   DMA_REQUEST_TIM_UP,  DMA1_Stream2, 5),
+
+    DMA_OPTION(TIM4,   DMA_REQUEST_TIM_CH1, DMA1_Stream0, 2),
+    DMA_OPTION(TIM4,   DMA_REQUEST_TIM_CH2, DMA1_Stream3, 2),
+    DMA_OPTION(TIM4,   DMA_REQUEST_TIM_CH3, DMA1_Stream7, 2),
+    DMA_OPTION(TIM4,   DMA_REQUEST_TIM_UP,  DMA1_Stream6, 2),
+
+    DMA_OPTION(TIM5,   DMA_REQUEST_TIM_CH1, DMA1_Stream2, 6),
+    DMA_OPTION(TIM5,   DMA_REQUEST_TIM_CH2, DMA1_Stream4, 6),
+    DMA_OPTION(TIM5,   DMA_REQUEST_TIM_CH3, DMA1_Stream0, 6),
+    DMA_OPTION(TIM5,   DMA_REQUEST_TIM_CH4, DMA1_Stream1, 6),
+    DMA_OPTION(TIM5,   DMA_REQUEST_TIM_CH4, DMA1_Stream3, 6),
+    DMA_OPTION(TIM5,   DMA_REQUEST_TIM_UP,  DMA1_Stream0, 6),
+    DMA_OPTION(TIM5,   DMA_REQUEST_TIM_UP,  DMA1_Stream6, 6),
+
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_CH1, DMA2_Stream2, 7),
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_CH1, DMA2_Stream2, 0),
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_CH2, DMA2_Stream3, 7),
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_CH2, DMA2_Stream2, 0),
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_CH3, DMA2_Stream4, 7),
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_CH3, DMA2_Stream2, 0),
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_CH4, DMA2_Stream7, 7),
+    DMA_OPTION(TIM8,   DMA_REQUEST_TIM_UP,  DMA2_Stream1, 7),
+};
+
+static bool dmaStreamAvailable(const DMA_Stream_TypeDef *stream, resourceOwner_e owner, uint8_t resourceIndex)
+{
+    const dmaIdentifier_e identifier = dmaGetIdentifier(stream);
+    const resourceOwner_e streamOwner = dmaGetOwner(identifier);
+
+    return streamOwner == OWNER_FREE || (streamOwner == owner && dmaGetResourceIndex(identifier) == resourceIndex);
+}
+
+/*
+ * Finds a stream for the request of the option without claiming it, the stream and channel the
+ * option holds if that stream is free, otherwise the first free alternative, which is written
+ * back to the option.
+ */
+bool dmaFindRequest(dmaStreamOption_t *option, resourceOwner_e owner, uint8_t resourceIndex)
+{
+    if (option->stream && dmaStreamAvailable(option->stream, owner, resourceIndex)) {
+        return true;
+    }
+
+    for (unsigned i = 0; i < ARRAYLEN(dmaStreamOptions); i++) {
+        const dmaStreamOption_t *alternative = &dmaStreamOptions[i];
+        if (alternative->peripheral == option->peripheral && alternative->request == option->request
+            && dmaStreamAvailable(alternative->stream, owner, resourceIndex)) {
+            option->stream = alternative->stream;
+            option->channel = alternative->channel;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * As dmaFindRequest(), and claims the stream found. Returns false, with the conflict recorded
+ * against the stream the option held, if every stream serving the request is taken.
+ */
+bool dmaAllocateRequest(dmaStreamOption_t *option, resourceOwner_e owner, uint8_t resourceIndex)
+{
+    DMA_Stream_TypeDef *requested = option->stream;
+
+    if (dmaFindRequest(option, owner, resourceIndex)) {
+        return dmaAllocate(dmaGetIdentifier(option->stream), owner, resourceIndex);
+    }
+    if (requested) {
+        dmaAllocate(dmaGetIdentifier(requested), owner, resourceIndex);
+    }
+    return false;
+}
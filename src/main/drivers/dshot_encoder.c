@@ -0,0 +1,76 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The DSHOT frame encoder shared by the pwmWriteDigital() of each MCU family. It only
+ * touches the DMA buffer, so it also builds for the host and the cycle count tests.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#include "build/build_config.h"
+
+#include "pwm_output.h"
+
+#ifdef USE_DSHOT
+static uint32_t dshotNibbleCompare[16][4];
+
+/* sets the compare values of the four bits of each nibble, so frames are written a nibble at a time */
+void dshotEncoderInit(uint32_t bit0Compare, uint32_t bit1Compare)
+{
+    for (int nibble = 0; nibble < 16; nibble++) {
+        for (int bit = 0; bit < 4; bit++) {
+            dshotNibbleCompare[nibble][bit] = (nibble & (0x8 >> bit)) ? bit1Compare : bit0Compare;
+        }
+    }
+}
+
+/*
+ * Writes the frame for value to every stride'th word of buffer, MSB first.
+ * DMA only reads the buffer, so when the value and telemetry request are those of the
+ * frame already there it is sent again as it is.
+ */
+FAST_CODE void dshotEncodeFrame(motorDmaOutput_t *motor, uint32_t *buffer, int stride, uint16_t value, bool invertChecksum)
+{
+    const uint16_t packet = (value << 1) | (motor->requestTelemetry ? 1 : 0);
+    motor->requestTelemetry = false;    // reset telemetry request to make sure it's triggered only once in a row
+
+    if (packet == motor->encodedPacket) {
+        return;
+    }
+    motor->encodedPacket = packet;
+
+    // checksum is the xor of the three nibbles
+    uint16_t csum = packet ^ (packet >> 4) ^ (packet >> 8);
+    if (invertChecksum) {
+        csum = ~csum;
+    }
+    const uint16_t frame = (packet << 4) | (csum & 0xf);
+
+    for (int nibble = 0; nibble < 4; nibble++) {
+        const uint32_t *compare = dshotNibbleCompare[(frame >> (12 - nibble * 4)) & 0xf];
+        uint32_t *dst = &buffer[nibble * 4 * stride];
+        dst[0] = compare[0];
+        dst[stride] = compare[1];
+        dst[2 * stride] = compare[2];
+        dst[3 * stride] = compare[3];
+    }
+}
+#endif
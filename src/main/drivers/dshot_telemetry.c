@@ -0,0 +1,89 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#include "drivers/dshot_telemetry.h"
+
+/*
+ * Bidirectional DSHOT replies are 21 bits sent at 5/4 of the output bit rate, a transition
+ * marks a one. After the transition that starts the reply come 20 bits of GCR, four 5 bit
+ * groups each coding a nibble of eee mmmmmmmmm cccc: the eRPM period in us is m << e and
+ * the nibbles xor to 0xf. Edges are capture timer values at DSHOT_TELEMETRY_TICKS_PER_BIT.
+ *
+ * Returns eRPM / 100, 0 when the motor is stopped or DSHOT_TELEMETRY_INVALID.
+ */
+uint16_t dshotDecodeTelemetryPacket(const uint32_t *edges, int count)
+{
+    static const uint8_t gcrDecode[32] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 9, 10, 11, 0, 13, 14, 15,
+        0, 0, 2, 3, 0, 5, 6, 7, 0, 0, 8, 1, 0, 4, 12, 0
+    };
+
+    if (count < 1) {
+        return DSHOT_TELEMETRY_INVALID;
+    }
+
+    uint32_t value = 0;
+    int bits = 0;
+    for (int i = 1; i <= count && bits < 21; i++) {
+        int length;
+        if (i < count) {
+            const uint16_t ticks = edges[i] - edges[i - 1];  // captures are taken from a 16 bit counter
+            length = (ticks + DSHOT_TELEMETRY_TICKS_PER_BIT / 2) / DSHOT_TELEMETRY_TICKS_PER_BIT;
+        } else {
+            // the line stays put after the last transition
+            length = 21 - bits;
+        }
+        if (length < 1) {
+            return DSHOT_TELEMETRY_INVALID;
+        }
+        value <<= length;
+        value |= 1 << (length - 1);
+        bits += length;
+    }
+    if (bits != 21) {
+        return DSHOT_TELEMETRY_INVALID;
+    }
+
+    uint32_t decoded = 0;
+    for (int group = 3; group >= 0; group--) {
+        decoded = (decoded << 4) | gcrDecode[(value >> (group * 5)) & 0x1f];
+    }
+
+    uint32_t csum = decoded;
+    csum = csum ^ (csum >> 8);
+    csum = csum ^ (csum >> 4);
+    if ((csum & 0xf) != 0xf) {
+        return DSHOT_TELEMETRY_INVALID;
+    }
+
+    decoded >>= 4;
+    if (decoded == 0x0fff) {
+        return 0;
+    }
+    const uint32_t periodUs = (decoded & 0x01ff) << (decoded >> 9);
+    if (!periodUs) {
+        return DSHOT_TELEMETRY_INVALID;
+    }
+    // eRPM = 60e6 / period, rounded
+    const uint32_t erpm100 = (60000000 / 100 + periodUs / 2) / periodUs;
+    return erpm100 < DSHOT_TELEMETRY_INVALID ? erpm100 : DSHOT_TELEMETRY_INVALID - 1;
+}
@@ -0,0 +1,24 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define DSHOT_TELEMETRY_INPUT_LEN 32        // edges captured for one reply, at most 21 are expected
+#define DSHOT_TELEMETRY_INVALID 0xffff
+#define DSHOT_TELEMETRY_TICKS_PER_BIT 16    // reply bits are 5/4 of the output bit rate, timer ticks are 20 per output bit
+
+uint16_t dshotDecodeTelemetryPacket(const uint32_t *edges, int count);
@@ -7,6 +7,7 @@
 #include "nvic.h"
 #include "io_impl.h"
 #include "exti.h"
+#include "system.h"
 
 #ifdef USE_EXTI
 
@@ -15,6 +16,8 @@ typedef struct {
 } extiChannelRec_t;
 
 extiChannelRec_t extiChannelRecs[16];
+// lines of the NVIC_PRIO_EXTI_GYRO class, dispatched ahead of the lines they share an IRQ with
+static uint32_t extiTimestampedLines;
 
 // IRQ gouping, same on 103 and 303
 #define EXTI_IRQ_GROUPS 7
@@ -65,6 +68,16 @@ void EXTIInit(void)
 #endif
     memset(extiChannelRecs, 0, sizeof(extiChannelRecs));
     memset(extiGroupPriority, 0xff, sizeof(extiGroupPriority));
+    extiTimestampedLines = 0;
+}
+
+static void extiSetClass(int chIdx, int irqPriority)
+{
+    if (irqPriority <= NVIC_PRIO_EXTI_GYRO) {
+        extiTimestampedLines |= 1 << chIdx;
+    } else {
+        extiTimestampedLines &= ~(1 << chIdx);
+    }
 }
 
 void EXTIHandlerInit(extiCallbackRec_t *self, extiHandlerCallback *fn)
@@ -92,6 +105,7 @@ void EXTIConfig(IO_t io, extiCallbackRec_t *cb, int irqPriority, ioConfig_t conf
     HAL_GPIO_Init(IO_GPIO(io), &init);
 
     rec->handler = cb;
+    extiSetClass(chIdx, irqPriority);
     //uint32_t extiLine = IO_EXTI_Line(io);
 
     //EXTI_ClearITPendingBit(extiLine);
@@ -114,6 +128,7 @@ void EXTIConfig(IO_t io, extiCallbackRec_t *cb, int irqPriority, EXTITrigger_Typ
     int group = extiGroups[chIdx];
 
     rec->handler = cb;
+    extiSetClass(chIdx, irqPriority);
 #if defined(STM32F10X)
     GPIO_EXTILineConfig(IO_GPIO_PortSource(io), IO_GPIO_PinSource(io));
 #elif defined(STM32F303xC)
@@ -158,6 +173,7 @@ void EXTIRelease(IO_t io)
         return;
     extiChannelRec_t *rec = &extiChannelRecs[chIdx];
     rec->handler = NULL;
+    extiTimestampedLines &= ~(1 << chIdx);
 }
 
 void EXTIEnable(IO_t io, bool enable)
@@ -184,10 +200,8 @@ void EXTIEnable(IO_t io, bool enable)
 #endif
 }
 
-void EXTI_IRQHandler(void)
+static void extiDispatch(uint32_t exti_active)
 {
-    uint32_t exti_active = EXTI->IMR & EXTI->PR;
-
     while(exti_active) {
         unsigned idx = 31 - __builtin_clz(exti_active);
         uint32_t mask = 1 << idx;
@@ -197,6 +211,22 @@ void EXTI_IRQHandler(void)
     }
 }
 
+void EXTI_IRQHandler(void)
+{
+    uint32_t exti_active = EXTI->IMR & EXTI->PR;
+
+    // the gyro class goes first, stamped before any handler has run
+    const uint32_t timestamped = exti_active & extiTimestampedLines;
+    if (timestamped) {
+        const uint32_t now = microsISR();
+        for (uint32_t lines = timestamped; lines; lines &= lines - 1) {
+            extiChannelRecs[__builtin_ctz(lines)].handler->triggeredAt = now;
+        }
+        extiDispatch(timestamped);
+    }
+    extiDispatch(exti_active & ~timestamped);
+}
+
 #define _EXTI_IRQ_HANDLER(name)                 \
     void name(void) {                           \
         EXTI_IRQHandler();                      \
@@ -30,6 +30,7 @@ typedef void extiHandlerCallback(extiCallbackRec_t *self);
 
 struct extiCallbackRec_s {
     extiHandlerCallback *fn;
+    uint32_t triggeredAt;           // microsISR() at the interrupt entry, only kept for the NVIC_PRIO_EXTI_GYRO class
 };
 
 void EXTIInit(void);
@@ -26,6 +26,7 @@
 #include "flash_m25p16.h"
 #include "io.h"
 #include "bus_spi.h"
+#include "dma.h"
 #include "system.h"
 
 #define M25P16_INSTRUCTION_RDID             0x9F
@@ -51,8 +52,8 @@
 #define JEDEC_ID_WINBOND_W25Q128       0xEF4018
 #define JEDEC_ID_MACRONIX_MX25L25635E  0xC22019
 
-#define DISABLE_M25P16       IOHi(m25p16CsPin); __NOP()
-#define ENABLE_M25P16        __NOP(); IOLo(m25p16CsPin)
+#define DISABLE_M25P16       spiBusRelease(&m25p16BusDevice); __NOP()
+#define ENABLE_M25P16        __NOP(); spiBusAcquire(&m25p16BusDevice)
 
 // The timeout we expect between being able to issue page program instructions
 #define DEFAULT_TIMEOUT_MILLIS       6
@@ -64,6 +65,7 @@
 static flashGeometry_t geometry = {.pageSize = M25P16_PAGESIZE};
 
 static IO_t m25p16CsPin = IO_NONE;
+static spiBusDevice_t m25p16BusDevice;
 
 /*
  * Whether we've performed an action that could have made the device busy for writes.
@@ -72,6 +74,13 @@ static IO_t m25p16CsPin = IO_NONE;
  */
 static bool couldBeBusy = false;
 
+#ifdef M25P16_DMA_CHANNEL_TX
+// Page programs are only sent by DMA once the stream has been claimed, they are polled if another resource has it
+static bool dmaEnabled = false;
+// A page program whose payload is still being clocked out by DMA, the chip stays selected until it finishes
+static bool dmaTransferInFlight = false;
+#endif
+
 /**
  * Send the given command byte to the device.
  */
@@ -112,6 +121,11 @@ static uint8_t m25p16_readStatus()
 
 bool m25p16_isReady()
 {
+    // The bus belongs to the page program until its payload has been sent
+    if (!m25p16_isTransferComplete()) {
+        return false;
+    }
+
     // If couldBeBusy is false, don't bother to poll the flash chip for its status
     couldBeBusy = couldBeBusy && ((m25p16_readStatus() & M25P16_STATUS_FLAG_WRITE_IN_PROGRESS) != 0);
 
@@ -225,15 +239,24 @@ bool m25p16_init(flashConfig_t *flashConfig)
 
     IOInit(m25p16CsPin, OWNER_FLASH_CS, 0);
     IOConfigGPIO(m25p16CsPin, SPI_IO_CS_CFG);
+    IOHi(m25p16CsPin);
 
-    DISABLE_M25P16;
-
-#ifndef M25P16_SPI_SHARED
+#ifdef M25P16_SPI_SHARED
+    spiBusDeviceInit(&m25p16BusDevice, M25P16_SPI_INSTANCE, m25p16CsPin, 0, SPI_BUS_PRIORITY_LOW);
+#else
     //Maximum speed for standard READ command is 20mHz, other commands tolerate 25mHz
-    spiSetDivisor(M25P16_SPI_INSTANCE, SPI_CLOCK_FAST);
+    spiBusDeviceInit(&m25p16BusDevice, M25P16_SPI_INSTANCE, m25p16CsPin, SPI_CLOCK_FAST, SPI_BUS_PRIORITY_LOW);
+#endif
+
+    if (!m25p16_readIdentification()) {
+        return false;
+    }
+
+#ifdef M25P16_DMA_CHANNEL_TX
+    dmaEnabled = dmaAllocate(dmaGetIdentifier(M25P16_DMA_CHANNEL_TX), OWNER_FLASH, 0);
 #endif
 
-    return m25p16_readIdentification();
+    return true;
 }
 
 /**
@@ -286,6 +309,118 @@ void m25p16_pageProgramFinish()
     DISABLE_M25P16;
 }
 
+/**
+ * Begin programming up to one page from `data` without waiting for the flash. Address must not cross a page boundary.
+ *
+ * Returns false without doing anything if the flash is still busy. Otherwise the payload is sent by DMA if the target
+ * provides a channel for it and m25p16_init() could claim it, in which case `data` must stay untouched until
+ * m25p16_isTransferComplete() returns true. Without DMA the payload is sent before this returns.
+ */
+bool m25p16_pageProgramStart(uint32_t address, const uint8_t *data, int length)
+{
+    if (!m25p16_isReady()) {
+        return false;
+    }
+
+#ifdef M25P16_DMA_CHANNEL_TX
+    if (!dmaEnabled) {
+        m25p16_pageProgram(address, data, length);
+        return true;
+    }
+
+    uint8_t command[] = { M25P16_INSTRUCTION_PAGE_PROGRAM, (address >> 16) & 0xFF, (address >> 8) & 0xFF, address & 0xFF};
+
+    m25p16_writeEnable();
+
+    ENABLE_M25P16;
+
+    spiTransfer(M25P16_SPI_INSTANCE, NULL, command, sizeof(command));
+
+#ifdef M25P16_DMA_CLK
+    RCC_AHB1PeriphClockCmd(M25P16_DMA_CLK, ENABLE);
+#endif
+    DMA_InitTypeDef DMA_InitStructure;
+
+    DMA_StructInit(&DMA_InitStructure);
+#ifdef M25P16_DMA_CHANNEL
+    DMA_InitStructure.DMA_Channel = M25P16_DMA_CHANNEL;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t) data;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+#else
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t) data;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+#endif
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t) &M25P16_SPI_INSTANCE->DR;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+
+    DMA_InitStructure.DMA_BufferSize = length;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+
+    DMA_DeInit(M25P16_DMA_CHANNEL_TX);
+    DMA_Init(M25P16_DMA_CHANNEL_TX, &DMA_InitStructure);
+
+    DMA_Cmd(M25P16_DMA_CHANNEL_TX, ENABLE);
+
+    SPI_I2S_DMACmd(M25P16_SPI_INSTANCE, SPI_I2S_DMAReq_Tx, ENABLE);
+
+    dmaTransferInFlight = true;
+#else
+    m25p16_pageProgram(address, data, length);
+#endif
+
+    return true;
+}
+
+/**
+ * Returns true once the payload of the last m25p16_pageProgramStart() has left the MCU and the chip has been
+ * deselected so that it starts programming. The flash remains busy for some time after this (see m25p16_isReady()).
+ */
+bool m25p16_isTransferComplete(void)
+{
+#ifdef M25P16_DMA_CHANNEL_TX
+    if (!dmaTransferInFlight) {
+        return true;
+    }
+
+#ifdef M25P16_DMA_CHANNEL
+    if (DMA_GetFlagStatus(M25P16_DMA_CHANNEL_TX, M25P16_DMA_CHANNEL_TX_COMPLETE_FLAG) != SET) {
+        return false;
+    }
+    DMA_ClearFlag(M25P16_DMA_CHANNEL_TX, M25P16_DMA_CHANNEL_TX_COMPLETE_FLAG);
+#else
+    if (DMA_GetFlagStatus(M25P16_DMA_CHANNEL_TX_COMPLETE_FLAG) != SET) {
+        return false;
+    }
+    DMA_ClearFlag(M25P16_DMA_CHANNEL_TX_COMPLETE_FLAG);
+#endif
+
+    DMA_Cmd(M25P16_DMA_CHANNEL_TX, DISABLE);
+
+    // Drain anything left in the Rx FIFO (we didn't read it during the write)
+    while (SPI_I2S_GetFlagStatus(M25P16_SPI_INSTANCE, SPI_I2S_FLAG_RXNE) == SET) {
+        M25P16_SPI_INSTANCE->DR;
+    }
+
+    // Wait for the final bit to be transmitted
+    while (spiIsBusBusy(M25P16_SPI_INSTANCE)) {
+    }
+
+    SPI_I2S_DMACmd(M25P16_SPI_INSTANCE, SPI_I2S_DMAReq_Tx, DISABLE);
+
+    m25p16_pageProgramFinish();
+
+    dmaTransferInFlight = false;
+#endif
+
+    return true;
+}
+
 /**
  * Write bytes to a flash page. Address must not cross a page boundary.
  *
@@ -33,6 +33,9 @@ void m25p16_pageProgramBegin(uint32_t address);
 void m25p16_pageProgramContinue(const uint8_t *data, int length);
 void m25p16_pageProgramFinish();
 
+bool m25p16_pageProgramStart(uint32_t address, const uint8_t *data, int length);
+bool m25p16_isTransferComplete(void);
+
 int m25p16_readBytes(uint32_t address, uint8_t *buffer, int length);
 
 bool m25p16_isReady();
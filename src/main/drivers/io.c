@@ -143,7 +143,7 @@ uint32_t IO_EXTI_Line(IO_t io)
     return IO_GPIOPinIdx(io);
 #elif defined(STM32F4)
     return 1 << IO_GPIOPinIdx(io);
-#elif defined(STM32F7)
+#elif defined(STM32F7) || defined(SIMULATOR_BUILD)
     return 1 << IO_GPIOPinIdx(io);
 #else
 # error "Unknown target type"
@@ -343,6 +343,14 @@ void IOConfigGPIOAF(IO_t io, ioConfig_t cfg, uint8_t af)
     };
     GPIO_Init(IO_GPIO(io), &init);
 }
+#elif defined(SIMULATOR_BUILD)
+
+// the simulated pins keep their owner and state, they have no modes to configure
+void IOConfigGPIO(IO_t io, ioConfig_t cfg)
+{
+    UNUSED(io);
+    UNUSED(cfg);
+}
 #endif
 
 static const uint16_t ioDefUsedMask[DEFIO_PORT_USED_COUNT] = { DEFIO_PORT_USED_LIST };
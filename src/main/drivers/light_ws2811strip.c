@@ -36,22 +36,55 @@
 
 #include "common/color.h"
 #include "common/colorconversion.h"
+#include "common/utils.h"
 #include "dma.h"
+#include "memory_report.h"
 #include "io.h"
 #include "light_ws2811strip.h"
+#include "system.h"
 
 #if defined(STM32F1) || defined(STM32F3)
-uint8_t ledStripDMABuffer[WS2811_DMA_BUFFER_SIZE];
+DMA_RAM uint8_t ledStripDMABuffer[WS2811_DMA_BUFFER_SIZE];
 #else
-uint32_t ledStripDMABuffer[WS2811_DMA_BUFFER_SIZE];
+DMA_RAM uint32_t ledStripDMABuffer[WS2811_DMA_BUFFER_SIZE];
 #endif
 volatile uint8_t ws2811LedDataTransferInProgress = 0;
 
 static hsvColor_t ledColorBuffer[WS2811_LED_STRIP_LENGTH];
+#ifdef USE_WS2811_CIRCULAR_DMA
+static rgbColor24bpp_t ledStripRgb[WS2811_LED_STRIP_LENGTH];
+#endif
+
+// LEDs whose colour changed since they were last encoded into the DMA buffer
+static uint32_t ledDirty[(WS2811_LED_STRIP_LENGTH + 31) / 32];
+
+// an unchanged strip is still resent this often, for LEDs powered up after the board
+#define WS2811_REFRESH_INTERVAL_MS 1000
+
+static uint32_t lastTransferAtMs;
+
+static void markLedDirty(uint16_t index)
+{
+    ledDirty[index / 32] |= 1U << (index % 32);
+}
+
+static bool isStripDirty(void)
+{
+    for (unsigned i = 0; i < ARRAYLEN(ledDirty); i++) {
+        if (ledDirty[i]) {
+            return true;
+        }
+    }
+    return false;
+}
 
 void setLedHsv(uint16_t index, const hsvColor_t *color)
 {
-    ledColorBuffer[index] = *color;
+    hsvColor_t *led = &ledColorBuffer[index];
+    if (led->h != color->h || led->s != color->s || led->v != color->v) {
+        *led = *color;
+        markLedDirty(index);
+    }
 }
 
 void getLedHsv(uint16_t index, hsvColor_t *color)
@@ -61,12 +94,15 @@ void getLedHsv(uint16_t index, hsvColor_t *color)
 
 void setLedValue(uint16_t index, const uint8_t value)
 {
-    ledColorBuffer[index].v = value;
+    if (ledColorBuffer[index].v != value) {
+        ledColorBuffer[index].v = value;
+        markLedDirty(index);
+    }
 }
 
 void scaleLedValue(uint16_t index, const uint8_t scalePercent)
 {
-    ledColorBuffer[index].v = ((uint16_t)ledColorBuffer[index].v * scalePercent / 100);
+    setLedValue(index, (uint16_t)ledColorBuffer[index].v * scalePercent / 100);
 }
 
 void setStripColor(const hsvColor_t *color)
@@ -88,8 +124,12 @@ void setStripColors(const hsvColor_t *colors)
 void ws2811LedStripInit(ioTag_t ioTag)
 {
     memset(&ledStripDMABuffer, 0, WS2811_DMA_BUFFER_SIZE);
+    memoryReportDmaBuffer(OWNER_LED_STRIP, ledStripDMABuffer, sizeof(ledStripDMABuffer));
     ws2811LedStripHardwareInit(ioTag);
 
+    // nothing is encoded yet
+    memset(ledDirty, 0xff, sizeof(ledDirty));
+
     const hsvColor_t hsv_white = {  0, 255, 255};
     setStripColor(&hsv_white);
     ws2811UpdateStrip();
@@ -103,10 +143,36 @@ bool isWS2811LedStripReady(void)
 STATIC_UNIT_TESTED uint16_t dmaBufferOffset;
 static int16_t ledIndex;
 
+/*
+ * Strips mostly show a handful of colours, so the last conversions are kept in a small direct mapped cache.
+ * Keys are the packed HSV value with the top bit set, an all zero entry is empty.
+ */
+#define WS2811_COLOR_CACHE_SIZE 8
+#define WS2811_COLOR_CACHE_VALID (1U << 31)
+
+typedef struct ws2811ColorCacheEntry_s {
+    uint32_t hsv;
+    rgbColor24bpp_t rgb;
+} ws2811ColorCacheEntry_t;
+
+static ws2811ColorCacheEntry_t colorCache[WS2811_COLOR_CACHE_SIZE];
+
+static const rgbColor24bpp_t *ws2811HsvToRgb24(const hsvColor_t *color)
+{
+    const uint32_t key = WS2811_COLOR_CACHE_VALID | (color->h << 16) | (color->s << 8) | color->v;
+    ws2811ColorCacheEntry_t *entry = &colorCache[(key ^ (key >> 8) ^ (key >> 16)) % WS2811_COLOR_CACHE_SIZE];
+
+    if (entry->hsv != key) {
+        entry->rgb = *hsvToRgb24(color);
+        entry->hsv = key;
+    }
+    return &entry->rgb;
+}
+
 #define USE_FAST_DMA_BUFFER_IMPL
 #ifdef USE_FAST_DMA_BUFFER_IMPL
 
-STATIC_UNIT_TESTED void fastUpdateLEDDMABuffer(rgbColor24bpp_t *color)
+STATIC_UNIT_TESTED void fastUpdateLEDDMABuffer(const rgbColor24bpp_t *color)
 {
     uint32_t grb = (color->rgb.g << 16) | (color->rgb.r << 8) | (color->rgb.b);
 
@@ -134,27 +200,81 @@ STATIC_UNIT_TESTED void updateLEDDMABuffer(uint8_t componentValue)
 }
 #endif
 
+#ifdef USE_WS2811_CIRCULAR_DMA
+#define WS2811_DATA_CHUNK_COUNT ((WS2811_LED_STRIP_LENGTH + WS2811_LEDS_PER_HALF_BUFFER - 1) / WS2811_LEDS_PER_HALF_BUFFER)
+
+static volatile uint8_t chunksSent;
+
+// a chunk is the WS2811_LEDS_PER_HALF_BUFFER LEDs that fit in one half of the ring, past the strip it's all zeros
+static void ws2811FillHalfBuffer(uint8_t half, uint8_t chunk)
+{
+    dmaBufferOffset = half * WS2811_HALF_BUFFER_SIZE;
+    for (int i = 0; i < WS2811_LEDS_PER_HALF_BUFFER; i++) {
+        const int index = chunk * WS2811_LEDS_PER_HALF_BUFFER + i;
+        if (index >= WS2811_LED_STRIP_LENGTH) {
+            memset(&ledStripDMABuffer[dmaBufferOffset], 0, (WS2811_LEDS_PER_HALF_BUFFER - i) * WS2811_BITS_PER_LED * sizeof(ledStripDMABuffer[0]));
+            break;
+        }
+#ifdef USE_FAST_DMA_BUFFER_IMPL
+        fastUpdateLEDDMABuffer(&ledStripRgb[index]);
+#else
+        updateLEDDMABuffer(ledStripRgb[index].rgb.g);
+        updateLEDDMABuffer(ledStripRgb[index].rgb.r);
+        updateLEDDMABuffer(ledStripRgb[index].rgb.b);
+#endif
+    }
+}
+
+/*
+ * Called from the DMA interrupt once a half of the ring has been sent, the DMA is sending the other half by now.
+ * Returns false once the strip and the trailing half of zeros are out and the DMA can be stopped.
+ */
+bool ws2811LedStripHalfTransferred(uint8_t half)
+{
+    chunksSent++;
+    if (chunksSent > WS2811_DATA_CHUNK_COUNT) {
+        return false;
+    }
+    ws2811FillHalfBuffer(half, chunksSent + 1);
+    return true;
+}
+#endif
+
 /*
  * This method is non-blocking unless an existing LED update is in progress.
  * it does not wait until all the LEDs have been updated, that happens in the background.
+ *
+ * Only LEDs that changed are converted again, the others keep their encoding. The LEDs hold their colour, so an
+ * unchanged strip is only resent every WS2811_REFRESH_INTERVAL_MS.
  */
 void ws2811UpdateStrip(void)
 {
-    static rgbColor24bpp_t *rgb24;
+    const rgbColor24bpp_t *rgb24;
 
     // don't wait - risk of infinite block, just get an update next time round
     if (ws2811LedDataTransferInProgress) {
         return;
     }
 
-    dmaBufferOffset = 0;                // reset buffer memory index
-    ledIndex = 0;                       // reset led index
+    const uint32_t now = millis();
+    if (!isStripDirty() && now - lastTransferAtMs < WS2811_REFRESH_INTERVAL_MS) {
+        return;
+    }
+    lastTransferAtMs = now;
 
     // fill transmit buffer with correct compare values to achieve
     // correct pulse widths according to color values
-    while (ledIndex < WS2811_LED_STRIP_LENGTH)
+    for (ledIndex = 0; ledIndex < WS2811_LED_STRIP_LENGTH; ledIndex++)
     {
-        rgb24 = hsvToRgb24(&ledColorBuffer[ledIndex]);
+        if (!(ledDirty[ledIndex / 32] & (1U << (ledIndex % 32)))) {
+            continue;
+        }
+        rgb24 = ws2811HsvToRgb24(&ledColorBuffer[ledIndex]);
+
+#ifdef USE_WS2811_CIRCULAR_DMA
+        ledStripRgb[ledIndex] = *rgb24;
+#else
+        dmaBufferOffset = ledIndex * WS2811_BITS_PER_LED;
 
 #ifdef USE_FAST_DMA_BUFFER_IMPL
         fastUpdateLEDDMABuffer(rgb24);
@@ -163,9 +283,15 @@ void ws2811UpdateStrip(void)
         updateLEDDMABuffer(rgb24->rgb.r);
         updateLEDDMABuffer(rgb24->rgb.b);
 #endif
-
-        ledIndex++;
+#endif
     }
+    memset(ledDirty, 0, sizeof(ledDirty));
+
+#ifdef USE_WS2811_CIRCULAR_DMA
+    chunksSent = 0;
+    ws2811FillHalfBuffer(0, 0);
+    ws2811FillHalfBuffer(1, 1);
+#endif
 
     ws2811LedDataTransferInProgress = 1;
     ws2811LedStripDMAEnable();
@@ -25,8 +25,21 @@
 #define WS2811_DELAY_BUFFER_LENGTH 42
 
 #define WS2811_DATA_BUFFER_SIZE (WS2811_BITS_PER_LED * WS2811_LED_STRIP_LENGTH)
+
+#if !defined(STM32F7)
+/*
+ * The colours are kept packed, 3 bytes per LED, and the DMA buffer is a ring of two halves of a few LEDs each. It runs
+ * in circular mode and the half sent last is refilled from the half and full transfer interrupts, so the buffer size
+ * doesn't grow with the strip length. A half of zeros ends the strip, longer than the 50us reset time.
+ */
+#define USE_WS2811_CIRCULAR_DMA
+#define WS2811_LEDS_PER_HALF_BUFFER 4
+#define WS2811_HALF_BUFFER_SIZE (WS2811_BITS_PER_LED * WS2811_LEDS_PER_HALF_BUFFER)
+#define WS2811_DMA_BUFFER_SIZE  (2 * WS2811_HALF_BUFFER_SIZE)
+#else
 // number of bytes needed is #LEDs * 24 bytes + 42 trailing bytes)
 #define WS2811_DMA_BUFFER_SIZE  (WS2811_DATA_BUFFER_SIZE + WS2811_DELAY_BUFFER_LENGTH)
+#endif
 
 #if defined(STM32F40_41xxx)
 #define WS2811_TIMER_HZ        84000000
@@ -55,6 +68,9 @@ void ws2811LedStripHardwareInit(ioTag_t ioTag);
 void ws2811LedStripDMAEnable(void);
 
 void ws2811UpdateStrip(void);
+#ifdef USE_WS2811_CIRCULAR_DMA
+bool ws2811LedStripHalfTransferred(uint8_t half);
+#endif
 
 void setLedHsv(uint16_t index, const hsvColor_t *color);
 void getLedHsv(uint16_t index, hsvColor_t *color);
@@ -35,12 +35,23 @@ bool ws2811Initialised = false;
 static DMA_Channel_TypeDef *dmaChannel = NULL;
 static TIM_TypeDef *timer = NULL;
 
+static void ws2811HalfTransferred(dmaChannelDescriptor_t *descriptor, uint8_t half)
+{
+    if (ws2811LedDataTransferInProgress && !ws2811LedStripHalfTransferred(half)) {
+        DMA_Cmd(descriptor->channel, DISABLE);
+        ws2811LedDataTransferInProgress = 0;
+    }
+}
+
 static void WS2811_DMA_IRQHandler(dmaChannelDescriptor_t *descriptor)
 {
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_HTIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_HTIF);
+        ws2811HalfTransferred(descriptor, 0);
+    }
     if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
-        ws2811LedDataTransferInProgress = 0;
-        DMA_Cmd(descriptor->channel, DISABLE);
         DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+        ws2811HalfTransferred(descriptor, 1);
     }
 }
 
@@ -104,7 +115,7 @@ void ws2811LedStripHardwareInit(ioTag_t ioTag)
     DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
     DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
     DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
-    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
     DMA_InitStructure.DMA_Priority = DMA_Priority_High;
     DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
 
@@ -113,7 +124,7 @@ void ws2811LedStripHardwareInit(ioTag_t ioTag)
     /* TIM3 CC1 DMA Request enable */
     TIM_DMACmd(timer, timerDmaSource(timerHardware->channel), ENABLE);
 
-    DMA_ITConfig(dmaChannel, DMA_IT_TC, ENABLE);
+    DMA_ITConfig(dmaChannel, DMA_IT_HT | DMA_IT_TC, ENABLE);
 
     ws2811Initialised = true;
 }
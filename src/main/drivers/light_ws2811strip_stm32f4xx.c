@@ -38,12 +38,23 @@ bool ws2811Initialised = false;
 static DMA_Stream_TypeDef *stream = NULL;
 static TIM_TypeDef *timer = NULL;
 
+static void ws2811HalfTransferred(dmaChannelDescriptor_t *descriptor, uint8_t half)
+{
+    if (ws2811LedDataTransferInProgress && !ws2811LedStripHalfTransferred(half)) {
+        DMA_Cmd(descriptor->stream, DISABLE);
+        ws2811LedDataTransferInProgress = 0;
+    }
+}
+
 static void WS2811_DMA_IRQHandler(dmaChannelDescriptor_t *descriptor)
 {
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_HTIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_HTIF);
+        ws2811HalfTransferred(descriptor, 0);
+    }
     if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
-        ws2811LedDataTransferInProgress = 0;
-        DMA_Cmd(descriptor->stream, DISABLE);
         DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+        ws2811HalfTransferred(descriptor, 1);
     }
 }
 
@@ -124,13 +135,13 @@ void ws2811LedStripHardwareInit(ioTag_t ioTag)
     DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
     DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
     DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
-    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
     DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
 
     DMA_Init(stream, &DMA_InitStructure);
     TIM_DMACmd(timer, timerDmaSource(timerHardware->channel), ENABLE);
 
-    DMA_ITConfig(stream, DMA_IT_TC, ENABLE);
+    DMA_ITConfig(stream, DMA_IT_HT | DMA_IT_TC, ENABLE);
     DMA_ClearITPendingBit(stream, dmaFlag_IT_TCIF(stream));
 
     ws2811Initialised = true;
@@ -33,6 +33,7 @@
 #include "drivers/system.h"
 #include "drivers/nvic.h"
 #include "drivers/dma.h"
+#include "drivers/exti.h"
 #include "drivers/vcd.h"
 #include "max7456.h"
 #include "max7456_symbols.h"
@@ -175,17 +176,17 @@
 #define LINE16    450
 
 
-//on shared SPI buss we want to change clock for OSD chip and restore for other devices
-#ifdef MAX7456_SPI_CLK
-    #define ENABLE_MAX7456        {spiSetDivisor(MAX7456_SPI_INSTANCE, MAX7456_SPI_CLK);IOLo(max7456CsPin);}
-#else
-    #define ENABLE_MAX7456        IOLo(max7456CsPin)
+#ifndef MAX7456_SPI_CLK
+#define MAX7456_SPI_CLK       SPI_CLOCK_STANDARD
 #endif
 
+#define ENABLE_MAX7456        spiBusAcquire(&max7456BusDevice)
+
+//on shared SPI buss we want to restore the clock for devices that still set it themselves
 #ifdef MAX7456_RESTORE_CLK
-    #define DISABLE_MAX7456       {IOHi(max7456CsPin);spiSetDivisor(MAX7456_SPI_INSTANCE, MAX7456_RESTORE_CLK);}
+    #define DISABLE_MAX7456       {spiSetDivisor(MAX7456_SPI_INSTANCE, MAX7456_RESTORE_CLK);spiBusRelease(&max7456BusDevice);}
 #else
-    #define DISABLE_MAX7456       IOHi(max7456CsPin)
+    #define DISABLE_MAX7456       spiBusRelease(&max7456BusDevice)
 #endif
 
 uint16_t maxScreenSize = VIDEO_BUFFER_CHARS_PAL;
@@ -196,23 +197,65 @@ uint16_t maxScreenSize = VIDEO_BUFFER_CHARS_PAL;
 static uint8_t screenBuffer[VIDEO_BUFFER_CHARS_PAL+40]; //for faster writes we use memcpy so we need some space to don't overwrite buffer
 static uint8_t shadowBuffer[VIDEO_BUFFER_CHARS_PAL];
 
+// bit per character row, set when the row is written and cleared once it has been sent
+static uint16_t dirtyRows;
+
 //max chars to update in one idle
 #define MAX_CHARS2UPDATE    100
 #ifdef MAX7456_DMA_CHANNEL_TX
-volatile bool dmaTransactionInProgress = false;
+// spiBuff goes out in segments so that a gyro sharing the bus waits for at most one of them,
+// they break between register writes
+#define MAX7456_DMA_SEGMENT_LEN     32
+
+static spiBusTransaction_t max7456Transaction;
 #endif
 
 static uint8_t spiBuff[MAX_CHARS2UPDATE*6];
 
+// a single character costs DMAH, DMAL and DMDI writes (6 bytes), a run in auto-increment mode
+// costs DMM, DMAH, DMAL and the 0xFF escape (8 bytes) on top of 2 bytes per character
+#define MAX7456_SINGLE_CHAR_BYTES   6
+#define MAX7456_AUTO_INC_MIN_RUN    3
+#define MAX7456_ROW_MAX_BYTES       (LINE * MAX7456_SINGLE_CHAR_BYTES)
+#define MAX7456_ALL_ROWS            ((1 << VIDEO_LINES_PAL) - 1)
+
 static uint8_t  videoSignalCfg;
 static uint8_t  videoSignalReg  = OSD_ENABLE; // OSD_ENABLE required to trigger first ReInit
 
 static uint8_t  hosRegValue; // HOS (Horizontal offset register) value
 static uint8_t  vosRegValue; // VOS (Vertical offset register) value
 
-static bool  max7456Lock        = false;
+static volatile bool max7456Lock = false;
 static bool fontIsLoading       = false;
+
+// two MSP_OSD_CHAR_WRITE requests of MAX7456_NVM_CHARS_PER_REQUEST characters each
+#define MAX7456_NVM_QUEUE_CHARS     6
+
+typedef struct max7456NvmChar_s {
+    uint8_t address;
+    uint8_t data[NVM_RAM_SIZE];
+} max7456NvmChar_t;
+
+static max7456NvmChar_t nvmQueue[MAX7456_NVM_QUEUE_CHARS];
+static uint8_t nvmQueueHead;
+static uint8_t nvmQueueCount;
+static bool nvmWriting;         // the NVM is being programmed, and is busy for 12ms
 static IO_t max7456CsPin        = IO_NONE;
+static spiBusDevice_t max7456BusDevice;
+
+// With the VSYNC output wired up the queued characters are sent from the VSYNC interrupt, so the display memory
+// is only written during vertical blanking, once per field. F7 EXTI lines only trigger on the rising edge, which
+// is the end of the VSYNC pulse and still inside the blanking interval.
+#if defined(MAX7456_VSYNC_PIN) && defined(MAX7456_DMA_CHANNEL_TX) && !defined(UNIT_TEST)
+#define USE_MAX7456_VSYNC
+// fall back to sending from the task when there are no VSYNC pulses, two PAL fields
+#define MAX7456_VSYNC_TIMEOUT_MS    40
+
+static IO_t max7456VsyncPin;
+static extiCallbackRec_t max7456VsyncCallbackRec;
+static volatile uint16_t vsyncPendingLen = 0;
+static uint32_t vsyncPendingSinceMs;
+#endif
 
 
 static uint8_t max7456Send(uint8_t add, uint8_t data)
@@ -222,15 +265,13 @@ static uint8_t max7456Send(uint8_t add, uint8_t data)
 }
 
 #ifdef MAX7456_DMA_CHANNEL_TX
-static void max7456SendDma(void* tx_buffer, void* rx_buffer, uint16_t buffer_size)
+static void max7456StartDmaSegment(spiBusTransaction_t *transaction, const uint8_t *tx_buffer, uint16_t buffer_size)
 {
     DMA_InitTypeDef DMA_InitStructure;
 #ifdef MAX7456_DMA_CHANNEL_RX
     static uint16_t dummy[] = {0xffff};
-#else
-    UNUSED(rx_buffer);
 #endif
-    while (dmaTransactionInProgress); // Wait for prev DMA transaction
+    UNUSED(transaction);
 
     DMA_DeInit(MAX7456_DMA_CHANNEL_TX);
 #ifdef MAX7456_DMA_CHANNEL_RX
@@ -250,13 +291,13 @@ static void max7456SendDma(void* tx_buffer, void* rx_buffer, uint16_t buffer_siz
 #ifdef MAX7456_DMA_CHANNEL_RX
     // Rx Channel
 #ifdef STM32F4
-    DMA_InitStructure.DMA_Memory0BaseAddr = rx_buffer ? (uint32_t)rx_buffer : (uint32_t)(dummy);
+    DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)(dummy);
     DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
 #else
-    DMA_InitStructure.DMA_MemoryBaseAddr = rx_buffer ? (uint32_t)rx_buffer : (uint32_t)(dummy);
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)(dummy);
     DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
 #endif
-    DMA_InitStructure.DMA_MemoryInc = rx_buffer ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Disable;
 
     DMA_Init(MAX7456_DMA_CHANNEL_RX, &DMA_InitStructure);
     DMA_Cmd(MAX7456_DMA_CHANNEL_RX, ENABLE);
@@ -281,10 +322,7 @@ static void max7456SendDma(void* tx_buffer, void* rx_buffer, uint16_t buffer_siz
     DMA_ITConfig(MAX7456_DMA_CHANNEL_TX, DMA_IT_TC, ENABLE);
 #endif
 
-    // Enable SPI TX/RX request
-    ENABLE_MAX7456;
-    dmaTransactionInProgress = true;
-
+    // Enable SPI TX/RX request, the bus arbiter has already asserted the chip select
     SPI_I2S_DMACmd(MAX7456_SPI_INSTANCE,
 #ifdef MAX7456_DMA_CHANNEL_RX
             SPI_I2S_DMAReq_Rx |
@@ -292,6 +330,15 @@ static void max7456SendDma(void* tx_buffer, void* rx_buffer, uint16_t buffer_siz
             SPI_I2S_DMAReq_Tx, ENABLE);
 }
 
+static void max7456SendDma(uint8_t *tx_buffer, uint16_t buffer_size)
+{
+    while (max7456Transaction.busy); // Wait for prev DMA transaction
+
+    max7456Transaction.data = tx_buffer;
+    max7456Transaction.len = buffer_size;
+    spiBusSubmit(&max7456Transaction);
+}
+
 void max7456_dma_irq_handler(dmaChannelDescriptor_t* descriptor)
 {
     if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
@@ -318,8 +365,11 @@ void max7456_dma_irq_handler(dmaChannelDescriptor_t* descriptor)
 #endif
                 SPI_I2S_DMAReq_Tx, DISABLE);
 
-        DISABLE_MAX7456;
-        dmaTransactionInProgress = false;
+#ifdef MAX7456_RESTORE_CLK
+        spiSetDivisor(MAX7456_SPI_INSTANCE, MAX7456_RESTORE_CLK);
+#endif
+        // raises the chip select and starts whatever is queued next, possibly the rest of spiBuff
+        spiBusSegmentComplete(&max7456Transaction);
     }
 
     if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_HTIF)) {
@@ -332,6 +382,33 @@ void max7456_dma_irq_handler(dmaChannelDescriptor_t* descriptor)
 
 #endif
 
+#ifdef USE_MAX7456_VSYNC
+static void max7456VsyncHandler(extiCallbackRec_t *cb)
+{
+    UNUSED(cb);
+    // the task owns the bus while it holds the lock, the characters then go out on the next field
+    if (vsyncPendingLen && !max7456Lock && !max7456Transaction.busy) {
+        max7456SendDma(spiBuff, vsyncPendingLen);
+        vsyncPendingLen = 0;
+    }
+}
+
+static void max7456VsyncInit(void)
+{
+    max7456VsyncPin = IOGetByTag(IO_TAG(MAX7456_VSYNC_PIN));
+    IOInit(max7456VsyncPin, OWNER_OSD, 0);
+    IOConfigGPIO(max7456VsyncPin, IOCFG_IPU);
+
+    EXTIHandlerInit(&max7456VsyncCallbackRec, max7456VsyncHandler);
+#if defined(STM32F7)
+    EXTIConfig(max7456VsyncPin, &max7456VsyncCallbackRec, NVIC_PRIO_MAX7456_VSYNC_EXTI, IOCFG_IPU);
+#else
+    EXTIConfig(max7456VsyncPin, &max7456VsyncCallbackRec, NVIC_PRIO_MAX7456_VSYNC_EXTI, EXTI_Trigger_Falling);
+#endif
+    EXTIEnable(max7456VsyncPin, true);
+}
+#endif
+
 uint8_t max7456GetRowsCount(void)
 {
     return (videoSignalReg & VIDEO_MODE_PAL) ? VIDEO_LINES_PAL : VIDEO_LINES_NTSC;
@@ -406,6 +483,7 @@ void max7456ReInit(void)
 
     //clear shadow to force redraw all screen in non-dma mode
     memset(shadowBuffer, 0, maxScreenSize);
+    dirtyRows = MAX7456_ALL_ROWS;
     if (firstInit)
     {
         max7456RefreshAll();
@@ -422,8 +500,7 @@ void max7456Init(const vcdProfile_t *pVcdProfile)
 #endif
     IOInit(max7456CsPin, OWNER_OSD_CS, 0);
     IOConfigGPIO(max7456CsPin, SPI_IO_CS_CFG);
-
-    spiSetDivisor(MAX7456_SPI_INSTANCE, SPI_CLOCK_STANDARD);
+    spiBusDeviceInit(&max7456BusDevice, MAX7456_SPI_INSTANCE, max7456CsPin, MAX7456_SPI_CLK, SPI_BUS_PRIORITY_LOW);
     // force soft reset on Max7456
     ENABLE_MAX7456;
     max7456Send(VM0_REG, MAX7456_RESET);
@@ -435,7 +512,13 @@ void max7456Init(const vcdProfile_t *pVcdProfile)
     vosRegValue = 16 - pVcdProfile->v_offset;
 
 #ifdef MAX7456_DMA_CHANNEL_TX
+    max7456Transaction.device = &max7456BusDevice;
+    max7456Transaction.startSegment = max7456StartDmaSegment;
+    max7456Transaction.segmentLen = MAX7456_DMA_SEGMENT_LEN;
     dmaSetHandler(MAX7456_DMA_IRQ_HANDLER_ID, max7456_dma_irq_handler, NVIC_PRIO_MAX7456_DMA, 0);
+#endif
+#ifdef USE_MAX7456_VSYNC
+    max7456VsyncInit();
 #endif
     //real init will be made letter when driver idle detect
 }
@@ -447,15 +530,19 @@ void max7456ClearScreen(void)
     uint32_t *p = (uint32_t*)&screenBuffer[0];
     for (x = 0; x < VIDEO_BUFFER_CHARS_PAL/4; x++)
         p[x] = 0x20202020;
+    dirtyRows = MAX7456_ALL_ROWS;
 }
 
 uint8_t* max7456GetScreenBuffer(void) {
+    // the caller may write anywhere
+    dirtyRows = MAX7456_ALL_ROWS;
     return screenBuffer;
 }
 
 void max7456WriteChar(uint8_t x, uint8_t y, uint8_t c)
 {
     screenBuffer[y*30+x] = c;
+    dirtyRows |= 1 << y;
 }
 
 void max7456Write(uint8_t x, uint8_t y, const char *buff)
@@ -464,12 +551,65 @@ void max7456Write(uint8_t x, uint8_t y, const char *buff)
     for (i = 0; *(buff+i); i++)
         if (x+i < 30) //do not write over screen
             screenBuffer[y*30+x+i] = *(buff+i);
+    dirtyRows |= 1 << y;
+}
+
+/*
+ * Queue the changed characters of one row. Runs of changed characters are written in auto-increment mode,
+ * which needs the address only once and then 2 bytes per character instead of 6. 0xFF ends auto-increment
+ * mode, so it is always written on its own.
+ */
+static int max7456QueueRow(uint8_t *buff, int row, bool *autoIncrementUsed)
+{
+    int len = 0;
+    const int rowStart = row * LINE;
+
+    for (int x = 0; x < LINE; ) {
+        const int pos = rowStart + x;
+        if (screenBuffer[pos] == shadowBuffer[pos]) {
+            x++;
+            continue;
+        }
+
+        int run = 0;
+        while (x + run < LINE && screenBuffer[pos + run] != shadowBuffer[pos + run] && screenBuffer[pos + run] != 0xFF) {
+            run++;
+        }
+
+        if (run >= MAX7456_AUTO_INC_MIN_RUN) {
+            *autoIncrementUsed = true;
+            buff[len++] = MAX7456ADD_DMM;
+            buff[len++] = 1;
+            buff[len++] = MAX7456ADD_DMAH;
+            buff[len++] = pos >> 8;
+            buff[len++] = MAX7456ADD_DMAL;
+            buff[len++] = pos & 0xff;
+            for (int i = 0; i < run; i++) {
+                buff[len++] = MAX7456ADD_DMDI;
+                buff[len++] = screenBuffer[pos + i];
+                shadowBuffer[pos + i] = screenBuffer[pos + i];
+            }
+            buff[len++] = MAX7456ADD_DMDI;
+            buff[len++] = 0xFF;
+            x += run;
+        } else {
+            buff[len++] = MAX7456ADD_DMAH;
+            buff[len++] = pos >> 8;
+            buff[len++] = MAX7456ADD_DMAL;
+            buff[len++] = pos & 0xff;
+            buff[len++] = MAX7456ADD_DMDI;
+            buff[len++] = screenBuffer[pos];
+            shadowBuffer[pos] = screenBuffer[pos];
+            x++;
+        }
+    }
+    return len;
 }
 
 #ifdef MAX7456_DMA_CHANNEL_TX
 bool max7456DmaInProgres(void)
 {
-    return dmaTransactionInProgress;
+    return max7456Transaction.busy;
 }
 #endif
 
@@ -480,10 +620,34 @@ void max7456DrawScreen(void)
     uint8_t stallCheck;
     uint8_t videoSense;
     static uint32_t videoDetectTimeMs = 0;
-    static uint16_t pos = 0;
-    int k = 0, buff_len=0;
+    int buff_len = 0;
 
-    if (!max7456Lock && !fontIsLoading) {
+    if (fontIsLoading) {
+        // the display is disabled until reboot, the OSD task only drives the font upload
+        max7456NvmUpdate();
+        return;
+    }
+
+#ifdef USE_MAX7456_VSYNC
+    if (vsyncPendingLen) {
+        // spiBuff is still waiting for the next field
+        if (millis() - vsyncPendingSinceMs < MAX7456_VSYNC_TIMEOUT_MS || max7456Lock) {
+            return;
+        }
+        max7456Lock = true;
+        if (vsyncPendingLen) {
+            max7456SendDma(spiBuff, vsyncPendingLen);
+            vsyncPendingLen = 0;
+        }
+        max7456Lock = false;
+        return;
+    }
+    if (max7456Transaction.busy) {
+        return;
+    }
+#endif
+
+    if (!max7456Lock) {
 
         // Detect MAX7456 fail, or initialize it at startup when it is ready
 
@@ -529,31 +693,30 @@ void max7456DrawScreen(void)
 
         //------------   end of (re)init-------------------------------------
 
-        for (k=0; k< MAX_CHARS2UPDATE; k++) {
-            if (screenBuffer[pos] != shadowBuffer[pos]) {
-                spiBuff[buff_len++] = MAX7456ADD_DMAH;
-                spiBuff[buff_len++] = pos >> 8;
-                spiBuff[buff_len++] = MAX7456ADD_DMAL;
-                spiBuff[buff_len++] = pos & 0xff;
-                spiBuff[buff_len++] = MAX7456ADD_DMDI;
-                spiBuff[buff_len++] = screenBuffer[pos];
-                shadowBuffer[pos] = screenBuffer[pos];
-                k++;
-            }
-
-            if (++pos >= maxScreenSize) {
-                pos = 0;
-                break;
-            }
+        // only rows written since they were last sent are compared, as many as fit into spiBuff
+        const uint16_t screenRows = (1 << (maxScreenSize / LINE)) - 1;
+        bool autoIncrementUsed = false;
+        dirtyRows &= screenRows;
+        while (dirtyRows && buff_len + MAX7456_ROW_MAX_BYTES + 2 <= (int)sizeof(spiBuff)) {
+            const int row = __builtin_ctz(dirtyRows);
+            buff_len += max7456QueueRow(&spiBuff[buff_len], row, &autoIncrementUsed);
+            dirtyRows &= ~(1 << row);
+        }
+        if (autoIncrementUsed) {
+            spiBuff[buff_len++] = MAX7456ADD_DMM;
+            spiBuff[buff_len++] = 0;
         }
 
         if (buff_len) {
-            #ifdef MAX7456_DMA_CHANNEL_TX
+            #if defined(USE_MAX7456_VSYNC)
+            vsyncPendingSinceMs = millis();
+            vsyncPendingLen = buff_len;
+            #elif defined(MAX7456_DMA_CHANNEL_TX)
             if (buff_len > 0)
-                max7456SendDma(spiBuff, NULL, buff_len);
+                max7456SendDma(spiBuff, buff_len);
             #else
             ENABLE_MAX7456;
-            for (k=0; k < buff_len; k++)
+            for (int k = 0; k < buff_len; k++)
                 spiTransferByte(MAX7456_SPI_INSTANCE, spiBuff[k]);
             DISABLE_MAX7456;
             #endif // MAX7456_DMA_CHANNEL_TX
@@ -566,11 +729,15 @@ void max7456DrawScreen(void)
 void max7456RefreshAll(void)
 {
     if (!max7456Lock) {
-#ifdef MAX7456_DMA_CHANNEL_TX
-    while (dmaTransactionInProgress);
-#endif
         uint16_t xx;
         max7456Lock = true;
+#ifdef MAX7456_DMA_CHANNEL_TX
+    while (max7456Transaction.busy);
+#endif
+#ifdef USE_MAX7456_VSYNC
+        // the whole screen is written below, anything still queued would be older
+        vsyncPendingLen = 0;
+#endif
         ENABLE_MAX7456;
         max7456Send(MAX7456ADD_DMAH, 0);
         max7456Send(MAX7456ADD_DMAL, 0);
@@ -585,30 +752,85 @@ void max7456RefreshAll(void)
         max7456Send(MAX7456ADD_DMDI, 0xFF);
         max7456Send(MAX7456ADD_DMM, 0);
         DISABLE_MAX7456;
+        dirtyRows = 0;
         max7456Lock = false;
     }
 }
 
-void max7456WriteNvm(uint8_t char_address, const uint8_t *font_data)
+/*
+ * Characters are queued for the NVM and written from max7456NvmUpdate(), which is called from the OSD and MSP tasks.
+ * A character goes into the shadow RAM in a single transfer, and the 12ms it then takes to program is polled for
+ * on the next calls rather than waited out.
+ */
+bool max7456WriteNvm(uint8_t char_address, const uint8_t *font_data)
 {
-    uint8_t x;
+    if (nvmQueueCount >= MAX7456_NVM_QUEUE_CHARS) {
+        return false;
+    }
+    max7456NvmChar_t *nvmChar = &nvmQueue[(nvmQueueHead + nvmQueueCount) % MAX7456_NVM_QUEUE_CHARS];
+    nvmChar->address = char_address;
+    memcpy(nvmChar->data, font_data, NVM_RAM_SIZE);
+    nvmQueueCount++;
+    return true;
+}
 
+int max7456NvmQueueSpace(void)
+{
+    return MAX7456_NVM_QUEUE_CHARS - nvmQueueCount;
+}
+
+void max7456NvmUpdate(void)
+{
 #ifdef MAX7456_DMA_CHANNEL_TX
-    while (dmaTransactionInProgress);
+    if (max7456Lock || max7456Transaction.busy) {
+#else
+    if (max7456Lock) {
 #endif
-    while (max7456Lock);
+        return;
+    }
     max7456Lock = true;
 
-    ENABLE_MAX7456;
-    // disable display
-    fontIsLoading = true;
-    max7456Send(VM0_REG, 0);
+    if (nvmWriting) {
+        ENABLE_MAX7456;
+        // bit 5 in the status register returns to 0 once the shadow RAM is in the NVM
+        nvmWriting = (max7456Send(MAX7456ADD_STAT, 0x00) & STAT_NVR_BUSY) != 0x00;
+        DISABLE_MAX7456;
+    }
 
-    max7456Send(MAX7456ADD_CMAH, char_address); // set start address high
+    if (!nvmWriting && nvmQueueCount) {
+        const max7456NvmChar_t *nvmChar = &nvmQueue[nvmQueueHead];
+        int len = 0;
 
-    for(x = 0; x < 54; x++) {
-        max7456Send(MAX7456ADD_CMAL, x); //set start address low
-        max7456Send(MAX7456ADD_CMDI, font_data[x]);
+        // the display stays disabled from the first character on
+        fontIsLoading = true;
+#ifdef USE_MAX7456_VSYNC
+        vsyncPendingLen = 0;
+#endif
+        spiBuff[len++] = VM0_REG;
+        spiBuff[len++] = 0;
+        spiBuff[len++] = MAX7456ADD_CMAH; // set start address high
+        spiBuff[len++] = nvmChar->address;
+        for (int x = 0; x < NVM_RAM_SIZE; x++) {
+            spiBuff[len++] = MAX7456ADD_CMAL; // set start address low
+            spiBuff[len++] = x;
+            spiBuff[len++] = MAX7456ADD_CMDI;
+            spiBuff[len++] = nvmChar->data[x];
+        }
+        // transfer 54 bytes from shadow ram to NVM
+        spiBuff[len++] = MAX7456ADD_CMM;
+        spiBuff[len++] = WRITE_NVR;
+
+        nvmQueueHead = (nvmQueueHead + 1) % MAX7456_NVM_QUEUE_CHARS;
+        nvmQueueCount--;
+        nvmWriting = true;
+
+#ifdef MAX7456_DMA_CHANNEL_TX
+        max7456SendDma(spiBuff, len);
+#else
+        ENABLE_MAX7456;
+        spiTransfer(MAX7456_SPI_INSTANCE, NULL, spiBuff, len);
+        DISABLE_MAX7456;
+#endif
 #ifdef LED0_TOGGLE
         LED0_TOGGLE;
 #else
@@ -616,14 +838,6 @@ void max7456WriteNvm(uint8_t char_address, const uint8_t *font_data)
 #endif
     }
 
-    // transfer 54 bytes from shadow ram to NVM
-    max7456Send(MAX7456ADD_CMM, WRITE_NVR);
-
-    // wait until bit 5 in the status register returns to 0 (12ms)
-    while ((max7456Send(MAX7456ADD_STAT, 0x00) & STAT_NVR_BUSY) != 0x00);
-
-    DISABLE_MAX7456;
-
     max7456Lock = false;
 }
 
@@ -32,12 +32,17 @@
 #define VIDEO_LINES_NTSC          13
 #define VIDEO_LINES_PAL           16
 
+// characters a single MSP_OSD_CHAR_WRITE request may carry, each an address byte and the character data
+#define MAX7456_NVM_CHARS_PER_REQUEST 3
+
 extern uint16_t maxScreenSize;
 
 struct vcdProfile_s;
 void    max7456Init(const struct vcdProfile_s *vcdProfile);
 void    max7456DrawScreen(void);
-void    max7456WriteNvm(uint8_t char_address, const uint8_t *font_data);
+bool    max7456WriteNvm(uint8_t char_address, const uint8_t *font_data);
+int     max7456NvmQueueSpace(void);
+void    max7456NvmUpdate(void);
 uint8_t max7456GetRowsCount(void);
 void    max7456Write(uint8_t x, uint8_t y, const char *buff);
 void    max7456WriteChar(uint8_t x, uint8_t y, uint8_t c);
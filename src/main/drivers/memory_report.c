@@ -0,0 +1,80 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#include "drivers/memory_report.h"
+#include "drivers/stack_check.h"
+
+extern char _sdata; // declared in .LD file
+extern char _edata;
+extern char _sbss;
+extern char _ebss;
+
+typedef struct memoryReportDmaBuffer_s {
+    const volatile void *buffer;
+    uint32_t size;
+    resourceOwner_e owner;
+} memoryReportDmaBuffer_t;
+
+static memoryReportDmaBuffer_t dmaBuffers[MEMORY_REPORT_DMA_BUFFER_COUNT];
+static uint8_t dmaBufferCount;
+
+// called by drivers as they set up DMA on a buffer, a buffer that is set up again is only counted once
+void memoryReportDmaBuffer(resourceOwner_e owner, const volatile void *buffer, uint32_t size)
+{
+    for (int i = 0; i < dmaBufferCount; i++) {
+        if (dmaBuffers[i].buffer == buffer) {
+            dmaBuffers[i].owner = owner;
+            dmaBuffers[i].size = size;
+            return;
+        }
+    }
+    if (dmaBufferCount < MEMORY_REPORT_DMA_BUFFER_COUNT) {
+        dmaBuffers[dmaBufferCount].buffer = buffer;
+        dmaBuffers[dmaBufferCount].size = size;
+        dmaBuffers[dmaBufferCount].owner = owner;
+        dmaBufferCount++;
+    }
+}
+
+uint32_t memoryReportDmaBufferSize(resourceOwner_e owner)
+{
+    uint32_t size = 0;
+    for (int i = 0; i < dmaBufferCount; i++) {
+        if (dmaBuffers[i].owner == owner) {
+            size += dmaBuffers[i].size;
+        }
+    }
+    return size;
+}
+
+void memoryReportGet(memoryReport_t *report)
+{
+    report->dataSize = &_edata - &_sdata;
+    report->bssSize = &_ebss - &_sbss;
+    report->stackSize = stackTotalSize();
+    report->stackHighWater = stackHighWaterMark();
+
+    report->dmaBufferSize = 0;
+    for (int i = 0; i < dmaBufferCount; i++) {
+        report->dmaBufferSize += dmaBuffers[i].size;
+    }
+}
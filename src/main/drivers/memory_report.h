@@ -0,0 +1,38 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "drivers/resource.h"
+
+/*
+ * RAM usage summary for sizing buffers. The static RAM of each source file comes from the linker map, see
+ * `make ram_report`.
+ */
+typedef struct memoryReport_s {
+    uint32_t dataSize;          // initialised statics
+    uint32_t bssSize;           // zeroed statics
+    uint32_t stackSize;
+    uint32_t stackHighWater;    // deepest stack use since boot
+    uint32_t dmaBufferSize;     // statics that are read or written by DMA, part of the above
+} memoryReport_t;
+
+#define MEMORY_REPORT_DMA_BUFFER_COUNT 16
+
+void memoryReportDmaBuffer(resourceOwner_e owner, const volatile void *buffer, uint32_t size);
+uint32_t memoryReportDmaBufferSize(resourceOwner_e owner);
+void memoryReportGet(memoryReport_t *report);
@@ -5,11 +5,19 @@
 // can't use 0
 #define NVIC_PRIO_MAX                      NVIC_BUILD_PRIORITY(0, 1)
 #define NVIC_PRIO_TIMER                    NVIC_BUILD_PRIORITY(1, 1)
-#define NVIC_PRIO_BARO_EXTI                NVIC_BUILD_PRIORITY(0x0f, 0x0f)
-#define NVIC_PRIO_SONAR_EXTI               NVIC_BUILD_PRIORITY(2, 0)  // maybe increate slightly
+
+// EXTI users by class. The gyro data ready pre-empts everything but the I2C, lines sharing an IRQ
+// are dispatched highest class first and the gyro class is timestamped at the interrupt entry
+#define NVIC_PRIO_EXTI_GYRO                NVIC_BUILD_PRIORITY(0, 2)
+#define NVIC_PRIO_EXTI_TIMING              NVIC_BUILD_PRIORITY(2, 0)  // edges whose time is measured or synced to
+#define NVIC_PRIO_EXTI_SENSOR              NVIC_BUILD_PRIORITY(0x0f, 0x0f)  // devices polled for the result once flagged
+
+#define NVIC_PRIO_BARO_EXTI                NVIC_PRIO_EXTI_SENSOR
+#define NVIC_PRIO_SONAR_EXTI               NVIC_PRIO_EXTI_TIMING
 #define NVIC_PRIO_TRANSPONDER_DMA          NVIC_BUILD_PRIORITY(3, 0)
-#define NVIC_PRIO_MPU_INT_EXTI             NVIC_BUILD_PRIORITY(0x0f, 0x0f)
-#define NVIC_PRIO_MAG_INT_EXTI             NVIC_BUILD_PRIORITY(0x0f, 0x0f)
+#define NVIC_PRIO_MPU_INT_EXTI             NVIC_PRIO_EXTI_GYRO
+#define NVIC_PRIO_MAG_INT_EXTI             NVIC_PRIO_EXTI_SENSOR
+#define NVIC_PRIO_RX_SPI_INT_EXTI          NVIC_PRIO_EXTI_SENSOR
 #define NVIC_PRIO_WS2811_DMA               NVIC_BUILD_PRIORITY(1, 2)  // TODO - is there some reason to use high priority? (or to use DMA IRQ at all?)
 #define NVIC_PRIO_SERIALUART1_TXDMA        NVIC_BUILD_PRIORITY(1, 1)
 #define NVIC_PRIO_SERIALUART1_RXDMA        NVIC_BUILD_PRIORITY(1, 1)
@@ -44,6 +52,9 @@
 #define NVIC_PRIO_MAG_DATA_READY           NVIC_BUILD_PRIORITY(0x0f, 0x0f)
 #define NVIC_PRIO_CALLBACK                 NVIC_BUILD_PRIORITY(0x0f, 0x0f)
 #define NVIC_PRIO_MAX7456_DMA              NVIC_BUILD_PRIORITY(3, 0)
+#define NVIC_PRIO_MAX7456_VSYNC_EXTI       NVIC_PRIO_EXTI_TIMING
+#define NVIC_PRIO_MPU_DMA                  NVIC_BUILD_PRIORITY(1, 0)
+#define NVIC_PRIO_PID_LOOP                 NVIC_BUILD_PRIORITY(2, 1)  // below the serial and DMA interrupts, above everything run by the scheduler
 
 #ifdef USE_HAL_DRIVER
 // utility macros to join/split priority
@@ -21,9 +21,16 @@
 
 #include "platform.h"
 
+#include "build/build_config.h"
+
+#include "common/time.h"
+
+#include "fc/runtime_config.h"
+
 #include "io.h"
 #include "timer.h"
 #include "pwm_output.h"
+#include "system.h"
 
 #define MULTISHOT_5US_PW    (MULTISHOT_TIMER_MHZ * 5)
 #define MULTISHOT_20US_MULT (MULTISHOT_TIMER_MHZ * 20 / 1000.0f)
@@ -37,6 +44,13 @@ static pwmOutputPort_t servos[MAX_SUPPORTED_SERVOS];
 #endif
 
 bool pwmMotorsEnabled = false;
+#ifdef USE_DSHOT_DMAR
+bool useBurstDshot = false;
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+bool useDshotTelemetry = false;
+#endif
+volatile uint32_t pwmMotorUpdateStartedAt;
 
 static void pwmOCConfig(TIM_TypeDef *tim, uint8_t channel, uint16_t value, uint8_t output)
 {
@@ -163,8 +177,11 @@ bool pwmAreMotorsEnabled(void)
     return pwmMotorsEnabled;
 }
 
-static void pwmCompleteOneshotMotorUpdate(uint8_t motorCount)
+static void pwmStartOneshotPulses(uint8_t motorCount)
 {
+#ifdef USE_LOOP_LATENCY
+    pwmMotorUpdateStartedAt = micros();
+#endif
     for (int index = 0; index < motorCount; index++) {
         bool overflowed = false;
         // If we have not already overflowed this timer
@@ -183,6 +200,44 @@ static void pwmCompleteOneshotMotorUpdate(uint8_t motorCount)
     }
 }
 
+static void pwmCompleteOneshotMotorUpdate(uint8_t motorCount)
+{
+    pwmStartOneshotPulses(motorCount);
+}
+
+/*
+ * Gyro synced output: the mixer only leaves its values in the preload registers and the pulses
+ * of all motors start together in the next gyro data ready interrupt, a fixed time after the
+ * sample, wherever the scheduler ran the mixer. A frame the mixer finishes late waits for the
+ * following sample rather than going out at an arbitrary time.
+ */
+static volatile bool syncedFramePending;
+static uint8_t syncedMotorCount;
+
+static void pwmCompleteSyncedMotorUpdate(uint8_t motorCount)
+{
+    syncedMotorCount = motorCount;
+    syncedFramePending = true;
+}
+
+// called from the gyro data ready interrupt
+void pwmSyncedMotorOutput(void)
+{
+    if (syncedFramePending) {
+        syncedFramePending = false;
+        pwmStartOneshotPulses(syncedMotorCount);
+    }
+}
+
+bool pwmEnableSyncedMotorOutput(void)
+{
+    if (pwmCompleteWritePtr != pwmCompleteOneshotMotorUpdate) {
+        return false;
+    }
+    pwmCompleteWritePtr = pwmCompleteSyncedMotorUpdate;
+    return true;
+}
+
 void pwmCompleteMotorUpdate(uint8_t motorCount)
 {
     if (pwmCompleteWritePtr) {
@@ -190,11 +245,137 @@ void pwmCompleteMotorUpdate(uint8_t motorCount)
     }
 }
 
+#ifdef USE_DSHOT
+/*
+ * DSHOT command queue.
+ *
+ * Commands are queued from anywhere and sent by the motor update, in place of the stop value,
+ * only once every motor was stopped in the previous update. Each is sent as many times as the
+ * ESC needs, one frame every DSHOT_COMMAND_INTERVAL_US, throttle frames fill the gaps, so a
+ * command never holds up the loop. The queue has a single reader and a single writer.
+ */
+#define DSHOT_COMMAND_INTERVAL_US   1000
+#define DSHOT_BEACON_GAP_US         100000  // the ESC is busy beeping
+
+typedef struct dshotCommandEntry_s {
+    uint8_t motorIndex;
+    uint8_t command;
+} dshotCommandEntry_t;
+
+static dshotCommandEntry_t dshotCommands[DSHOT_COMMAND_QUEUE_SIZE];
+static volatile uint8_t dshotCommandHead;
+static volatile uint8_t dshotCommandTail;
+static uint8_t dshotCommandRepeatsLeft;
+static timeUs_t dshotCommandNextAt;
+static dshotCommandEntry_t dshotCommandFrame;   // command to send in this update
+static bool dshotCommandInFrame;
+static bool allMotorsStopped;
+static bool dshotCommandsEnabled;
+
+bool dshotCommandQueue(uint8_t motorIndex, uint8_t command)
+{
+    const uint8_t next = (dshotCommandTail + 1) % DSHOT_COMMAND_QUEUE_SIZE;
+    if (!dshotCommandsEnabled || command > DSHOT_CMD_MAX || next == dshotCommandHead) {
+        return false;
+    }
+    dshotCommands[dshotCommandTail].motorIndex = motorIndex;
+    dshotCommands[dshotCommandTail].command = command;
+    dshotCommandTail = next;
+    return true;
+}
+
+void dshotCommandGetStatus(dshotCommandStatus_t *status)
+{
+    const uint8_t head = dshotCommandHead;
+    status->queued = (dshotCommandTail + DSHOT_COMMAND_QUEUE_SIZE - head) % DSHOT_COMMAND_QUEUE_SIZE;
+    status->motorIndex = dshotCommands[head].motorIndex;
+    status->command = dshotCommands[head].command;
+    status->repeatsLeft = status->queued ? dshotCommandRepeatsLeft : 0;
+}
+
+static uint8_t dshotCommandRepeatCount(uint8_t command)
+{
+    switch (command) {
+    case DSHOT_CMD_SPIN_DIRECTION_1:
+    case DSHOT_CMD_SPIN_DIRECTION_2:
+    case DSHOT_CMD_3D_MODE_OFF:
+    case DSHOT_CMD_3D_MODE_ON:
+    case DSHOT_CMD_SETTINGS_REQUEST:
+    case DSHOT_CMD_SAVE_SETTINGS:
+    case DSHOT_CMD_SPIN_DIRECTION_NORMAL:
+    case DSHOT_CMD_SPIN_DIRECTION_REVERSED:
+        return 6;   // settings are only taken after this many frames in a row
+    default:
+        return 1;
+    }
+}
+
+// picks the command, if any, that the next update sends
+static void dshotCommandSchedule(void)
+{
+    dshotCommandInFrame = false;
+
+    // motor stop alone is not enough, an armed craft with MOTOR_STOP may be in the air at zero throttle
+    const bool canSend = allMotorsStopped && !ARMING_FLAG(ARMED);
+    allMotorsStopped = true;
+    if (!canSend || dshotCommandHead == dshotCommandTail) {
+        return;
+    }
+    const timeUs_t now = micros();
+    if (cmpTimeUs(now, dshotCommandNextAt) < 0) {
+        return;
+    }
+
+    const dshotCommandEntry_t *entry = &dshotCommands[dshotCommandHead];
+    if (!dshotCommandRepeatsLeft) {
+        dshotCommandRepeatsLeft = dshotCommandRepeatCount(entry->command);
+    }
+    dshotCommandFrame = *entry;
+    dshotCommandInFrame = true;
+
+    dshotCommandRepeatsLeft--;
+    if (dshotCommandRepeatsLeft) {
+        dshotCommandNextAt = now + DSHOT_COMMAND_INTERVAL_US;
+    } else {
+        const bool isBeacon = entry->command >= DSHOT_CMD_BEACON1 && entry->command <= DSHOT_CMD_BEACON5;
+        dshotCommandNextAt = now + (isBeacon ? DSHOT_BEACON_GAP_US : DSHOT_COMMAND_INTERVAL_US);
+        dshotCommandHead = (dshotCommandHead + 1) % DSHOT_COMMAND_QUEUE_SIZE;
+    }
+}
+
+static void pwmWriteDshot(uint8_t index, uint16_t value)
+{
+    if (value != DSHOT_CMD_MOTOR_STOP) {
+        allMotorsStopped = false;
+    } else if (dshotCommandInFrame && (dshotCommandFrame.motorIndex == DSHOT_ALL_MOTORS || dshotCommandFrame.motorIndex == index)) {
+        value = dshotCommandFrame.command;
+        getMotorDmaOutput(index)->requestTelemetry = true;  // the ESC only takes commands with the telemetry bit set
+    }
+    pwmWriteDigital(index, value);
+}
+
+static void pwmCompleteDshotMotorUpdate(uint8_t motorCount)
+{
+    pwmCompleteDigitalMotorUpdate(motorCount);
+    dshotCommandSchedule();
+}
+#endif
+
 void motorInit(const motorConfig_t *motorConfig, uint16_t idlePulse, uint8_t motorCount)
 {
     uint32_t timerMhzCounter = 0;
     bool useUnsyncedPwm = motorConfig->useUnsyncedPwm;
     bool isDigital = false;
+#ifdef USE_DSHOT_DMAR
+    useBurstDshot = motorConfig->useBurstDshot;
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+    useDshotTelemetry = motorConfig->useDshotTelemetry;
+#ifdef USE_DSHOT_DMAR
+    // the reply is captured on each motor's own stream
+    useBurstDshot = useBurstDshot && !useDshotTelemetry;
+#endif
+#endif
 
     switch (motorConfig->motorPwmProtocol) {
     default:
@@ -226,8 +407,9 @@ void motorInit(const motorConfig_t *motorConfig, uint16_t idlePulse, uint8_t mot
     case PWM_TYPE_DSHOT600:
     case PWM_TYPE_DSHOT300:
     case PWM_TYPE_DSHOT150:
-        pwmWritePtr = pwmWriteDigital;
-        pwmCompleteWritePtr = pwmCompleteDigitalMotorUpdate;
+        pwmWritePtr = pwmWriteDshot;
+        pwmCompleteWritePtr = pwmCompleteDshotMotorUpdate;
+        dshotCommandsEnabled = true;
         isDigital = true;
         break;
 #endif
@@ -20,6 +20,7 @@
 #include "io/motors.h"
 #include "io/servos.h"
 #include "drivers/timer.h"
+#include "drivers/dshot_telemetry.h"
 
 typedef enum {
     PWM_TYPE_STANDARD = 0,
@@ -54,17 +55,77 @@ typedef enum {
 
 #define MOTOR_DMA_BUFFER_SIZE 18 /* resolution + frame reset (2us) */
 
+#define MAX_DMA_BURST_CHANNELS 4
+
+#define DSHOT_PACKET_NONE 0xffff    // packets are 12 bits, so this never matches one
+
+// DSHOT values below DSHOT_MIN_THROTTLE are commands to the ESC
+typedef enum {
+    DSHOT_CMD_MOTOR_STOP = 0,
+    DSHOT_CMD_BEACON1,
+    DSHOT_CMD_BEACON2,
+    DSHOT_CMD_BEACON3,
+    DSHOT_CMD_BEACON4,
+    DSHOT_CMD_BEACON5,
+    DSHOT_CMD_ESC_INFO,
+    DSHOT_CMD_SPIN_DIRECTION_1,
+    DSHOT_CMD_SPIN_DIRECTION_2,
+    DSHOT_CMD_3D_MODE_OFF,
+    DSHOT_CMD_3D_MODE_ON,
+    DSHOT_CMD_SETTINGS_REQUEST,
+    DSHOT_CMD_SAVE_SETTINGS,
+    DSHOT_CMD_SPIN_DIRECTION_NORMAL = 20,
+    DSHOT_CMD_SPIN_DIRECTION_REVERSED = 21,
+    DSHOT_CMD_MAX = 47
+} dshotCommands_e;
+
+#define DSHOT_ALL_MOTORS 255
+#define DSHOT_COMMAND_QUEUE_SIZE 8
+
+typedef struct dshotCommandStatus_s {
+    uint8_t queued;                         // commands waiting, including the one being sent
+    uint8_t motorIndex;                     // of the command being sent, DSHOT_ALL_MOTORS for all
+    uint8_t command;
+    uint8_t repeatsLeft;                    // frames still to send, 0 when no command has started
+} dshotCommandStatus_t;
+
 typedef struct {
     TIM_TypeDef *timer;
     uint16_t timerDmaSources;
+#ifdef USE_DSHOT_DMAR
+    // with a burst stream the update DMA request writes the CCRs of all motors on the timer at once
+    DMA_Stream_TypeDef *dmaBurstStream;
+    uint32_t dmaBurstChannel;
+    uint8_t dmaBurstBaseChannel;            // channel index of the first CCR in the burst
+    uint8_t dmaBurstLength;                 // number of CCRs in the burst
+    uint32_t dmaBurstBuffer[MOTOR_DMA_BUFFER_SIZE * MAX_DMA_BURST_CHANNELS];    // interleaved by channel
+#if defined(STM32F7)
+    DMA_HandleTypeDef hdma_burst;
+#endif
+#endif
 } motorDmaTimer_t;
 
 typedef struct {
     ioTag_t ioTag;
     const timerHardware_t *timerHardware;
-    uint16_t value;
+    uint16_t encodedPacket;                 // value and telemetry bit of the frame in dmaBuffer, DSHOT_PACKET_NONE before the first
     uint16_t timerDmaSource;
     volatile bool requestTelemetry;
+#if defined(STM32F4) || defined(STM32F7)
+    DMA_Stream_TypeDef *dmaStream;          // the channel's stream, or the alternative it was given, NULL without either
+    uint32_t dmaChannel;
+#endif
+#ifdef USE_DSHOT_DMAR
+    motorDmaTimer_t *burstTimer;            // NULL when the motor has its own channel stream
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+    bool hasTelemetry;                      // frames are sent inverted and the reply is captured on the same pin
+    volatile bool isInput;                  // channel is capturing the reply
+    uint16_t telemetryValue;                // last eRPM / 100
+    uint32_t telemetryReceived;
+    uint32_t telemetryInvalid;
+    uint32_t dmaInputBuffer[DSHOT_TELEMETRY_INPUT_LEN];
+#endif
 #if defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
     uint32_t dmaBuffer[MOTOR_DMA_BUFFER_SIZE];
 #else
@@ -79,6 +140,14 @@ typedef struct {
 motorDmaOutput_t *getMotorDmaOutput(uint8_t index);
 
 extern bool pwmMotorsEnabled;
+#ifdef USE_DSHOT_DMAR
+extern bool useBurstDshot;
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+extern bool useDshotTelemetry;
+uint16_t getDshotTelemetry(uint8_t index);
+#endif
+extern volatile uint32_t pwmMotorUpdateStartedAt;  // micros() when the last motor update was started, only kept with USE_LOOP_LATENCY
 
 struct timerHardware_s;
 typedef void(*pwmWriteFuncPtr)(uint8_t index, uint16_t value);  // function pointer used to write motors
@@ -101,8 +170,15 @@ void pwmServoConfig(const struct timerHardware_s *timerHardware, uint8_t servoIn
 void pwmWriteDigital(uint8_t index, uint16_t value);
 void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, motorPwmProtocolTypes_e pwmProtocolType);
 void pwmCompleteDigitalMotorUpdate(uint8_t motorCount);
+void dshotEncoderInit(uint32_t bit0Compare, uint32_t bit1Compare);
+void dshotEncodeFrame(motorDmaOutput_t *motor, uint32_t *buffer, int stride, uint16_t value, bool invertChecksum);
+bool dshotCommandQueue(uint8_t motorIndex, uint8_t command);
+void dshotCommandGetStatus(dshotCommandStatus_t *status);
 #endif
 
+bool pwmEnableSyncedMotorOutput(void);
+void pwmSyncedMotorOutput(void);
+
 void pwmWriteMotor(uint8_t index, uint16_t value);
 void pwmShutdownPulsesForAllMotors(uint8_t motorCount);
 void pwmCompleteMotorUpdate(uint8_t motorCount);
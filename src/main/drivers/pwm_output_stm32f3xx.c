@@ -20,6 +20,7 @@
 
 #include "platform.h"
 
+#include "build/build_config.h"
 #include "build/debug.h"
 
 #include "io.h"
@@ -27,6 +28,7 @@
 #include "pwm_output.h"
 #include "nvic.h"
 #include "dma.h"
+#include "memory_report.h"
 #include "system.h"
 #include "rcc.h"
 
@@ -62,7 +64,7 @@ uint8_t getTimerIndex(TIM_TypeDef *timer)
     return dmaMotorTimerCount-1;
 }
 
-void pwmWriteDigital(uint8_t index, uint16_t value)
+FAST_CODE void pwmWriteDigital(uint8_t index, uint16_t value)
 {
 
     if (!pwmMotorsEnabled) {
@@ -75,24 +77,7 @@ void pwmWriteDigital(uint8_t index, uint16_t value)
         return;
     }
 
-    uint16_t packet = (value << 1) | (motor->requestTelemetry ? 1 : 0);
-    motor->requestTelemetry = false;    // reset telemetry request to make sure it's triggered only once in a row
-
-    // compute checksum
-    int csum = 0;
-    int csum_data = packet;
-    for (int i = 0; i < 3; i++) {
-        csum ^=  csum_data;   // xor data by nibbles
-        csum_data >>= 4;
-    }
-    csum &= 0xf;
-    // append checksum
-    packet = (packet << 4) | csum;
-    // generate pulses for whole packet
-    for (int i = 0; i < 16; i++) {
-        motor->dmaBuffer[i] = (packet & 0x8000) ? MOTOR_BIT_1 : MOTOR_BIT_0;  // MSB first
-        packet <<= 1;
-    }
+    dshotEncodeFrame(motor, motor->dmaBuffer, 1, value, false);
 
     DMA_SetCurrDataCounter(motor->timerHardware->dmaChannel, MOTOR_DMA_BUFFER_SIZE);
     DMA_Cmd(motor->timerHardware->dmaChannel, ENABLE);
@@ -106,6 +91,9 @@ void pwmCompleteDigitalMotorUpdate(uint8_t motorCount)
         return;
     }
 
+#ifdef USE_LOOP_LATENCY
+    pwmMotorUpdateStartedAt = micros();
+#endif
     for (int i = 0; i < dmaMotorTimerCount; i++) {
         TIM_SetCounter(dmaMotorTimers[i].timer, 0);
         TIM_DMACmd(dmaMotorTimers[i].timer, dmaMotorTimers[i].timerDmaSources, ENABLE);
@@ -129,6 +117,8 @@ void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t
 
     motorDmaOutput_t * const motor = &dmaMotors[motorIndex];
     motor->timerHardware = timerHardware;
+    motor->encodedPacket = DSHOT_PACKET_NONE;
+    dshotEncoderInit(MOTOR_BIT_0, MOTOR_BIT_1);
 
     TIM_TypeDef *timer = timerHardware->tim;
     const IO_t motorIO = IOGetByTag(timerHardware->tag);
@@ -201,6 +191,7 @@ void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t
     }
 
     dmaInit(timerHardware->dmaIrqHandler, OWNER_MOTOR, RESOURCE_INDEX(motorIndex));
+    memoryReportDmaBuffer(OWNER_MOTOR, motor->dmaBuffer, sizeof(motor->dmaBuffer));
     dmaSetHandler(timerHardware->dmaIrqHandler, motor_DMA_IRQHandler, NVIC_BUILD_PRIORITY(1, 2), motorIndex);
 
     DMA_Cmd(channel, DISABLE);
@@ -17,15 +17,21 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <math.h>
+#include <string.h>
 
 #include "platform.h"
 
+#include "build/build_config.h"
+
+#include "common/maths.h"
+
 #include "io.h"
 #include "timer.h"
 #include "timer_stm32f4xx.h"
 #include "pwm_output.h"
 #include "nvic.h"
 #include "dma.h"
+#include "memory_report.h"
 #include "system.h"
 #include "rcc.h"
 
@@ -61,7 +67,140 @@ uint8_t getTimerIndex(TIM_TypeDef *timer)
     return dmaMotorTimerCount-1;
 }
 
-void pwmWriteDigital(uint8_t index, uint16_t value)
+#ifdef USE_DSHOT_DMAR
+static const timerDef_t *getTimerDefinition(TIM_TypeDef *timer)
+{
+    for (int i = 0; i < HARDWARE_TIMER_DEFINITION_COUNT; i++) {
+        if (timerDefinitions[i].TIMx == timer) {
+            return &timerDefinitions[i];
+        }
+    }
+    return NULL;
+}
+#endif
+
+static void pwmDigitalMotorOutputConfig(const motorDmaOutput_t *motor)
+{
+    const timerHardware_t *timerHardware = motor->timerHardware;
+    bool inverted = timerHardware->output & TIMER_OUTPUT_INVERTED;
+#ifdef USE_DSHOT_TELEMETRY
+    if (motor->hasTelemetry) {
+        inverted = !inverted;
+    }
+#endif
+
+    TIM_OCInitTypeDef TIM_OCInitStructure;
+    TIM_OCStructInit(&TIM_OCInitStructure);
+    TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
+    if (timerHardware->output & TIMER_OUTPUT_N_CHANNEL) {
+        TIM_OCInitStructure.TIM_OutputNState = TIM_OutputNState_Enable;
+        TIM_OCInitStructure.TIM_OCNIdleState = TIM_OCNIdleState_Reset;
+        TIM_OCInitStructure.TIM_OCNPolarity = inverted ? TIM_OCNPolarity_High : TIM_OCNPolarity_Low;
+    } else {
+        TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
+        TIM_OCInitStructure.TIM_OCIdleState = TIM_OCIdleState_Set;
+        TIM_OCInitStructure.TIM_OCPolarity = inverted ? TIM_OCPolarity_Low : TIM_OCPolarity_High;
+    }
+    TIM_OCInitStructure.TIM_Pulse = 0;
+
+    timerOCInit(timerHardware->tim, timerHardware->channel, &TIM_OCInitStructure);
+    timerOCPreloadConfig(timerHardware->tim, timerHardware->channel, TIM_OCPreload_Enable);
+}
+
+// Sets the motor's stream to write the frame to the CCR, or to read the reply captures from it
+static void pwmDigitalMotorDmaConfig(motorDmaOutput_t *motor, bool input)
+{
+    DMA_Stream_TypeDef *stream = motor->dmaStream;
+
+    DMA_Cmd(stream, DISABLE);
+    DMA_DeInit(stream);
+
+    DMA_InitTypeDef DMA_InitStructure;
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_Channel = motor->dmaChannel;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)timerChCCR(motor->timerHardware);
+#ifdef USE_DSHOT_TELEMETRY
+    if (input) {
+        DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)motor->dmaInputBuffer;
+        DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+        DMA_InitStructure.DMA_BufferSize = DSHOT_TELEMETRY_INPUT_LEN;
+    } else
+#else
+    UNUSED(input);
+#endif
+    {
+        DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)motor->dmaBuffer;
+        DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+        DMA_InitStructure.DMA_BufferSize = MOTOR_DMA_BUFFER_SIZE;
+    }
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Enable;
+    DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_1QuarterFull;
+    DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+    DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+
+    DMA_Init(stream, &DMA_InitStructure);
+
+    DMA_ITConfig(stream, DMA_IT_TC, ENABLE);
+    DMA_ClearITPendingBit(stream, dmaFlag_IT_TCIF(stream));
+}
+
+#ifdef USE_DSHOT_TELEMETRY
+// Turns the channel round between sending a frame and capturing both edges of the reply
+static void pwmDshotSetDirection(motorDmaOutput_t *motor, bool input)
+{
+    const timerHardware_t *timerHardware = motor->timerHardware;
+
+    if (input) {
+        // let the counter run freely so the captures can be compared, the frame period is restored before the next frame
+        TIM_SetAutoreload(timerHardware->tim, 0xffff);
+
+        TIM_ICInitTypeDef TIM_ICInitStructure;
+        TIM_ICStructInit(&TIM_ICInitStructure);
+        TIM_ICInitStructure.TIM_Channel = timerHardware->channel;
+        TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_BothEdge;
+        TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+        TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+        TIM_ICInitStructure.TIM_ICFilter = 2;
+        TIM_ICInit(timerHardware->tim, &TIM_ICInitStructure);
+    } else {
+        pwmDigitalMotorOutputConfig(motor);
+    }
+    pwmDigitalMotorDmaConfig(motor, input);
+    motor->isInput = input;
+}
+
+static void pwmDshotReadTelemetry(motorDmaOutput_t *motor)
+{
+    DMA_Stream_TypeDef *stream = motor->dmaStream;
+
+    DMA_Cmd(stream, DISABLE);
+    TIM_DMACmd(motor->timerHardware->tim, motor->timerDmaSource, DISABLE);
+
+    const int edgeCount = DSHOT_TELEMETRY_INPUT_LEN - DMA_GetCurrDataCounter(stream);
+    const uint16_t value = dshotDecodeTelemetryPacket(motor->dmaInputBuffer, edgeCount);
+    if (value == DSHOT_TELEMETRY_INVALID) {
+        motor->telemetryInvalid++;
+    } else {
+        motor->telemetryValue = value;
+        motor->telemetryReceived++;
+    }
+
+    pwmDshotSetDirection(motor, false);
+}
+
+uint16_t getDshotTelemetry(uint8_t index)
+{
+    return dmaMotors[index].telemetryValue;
+}
+#endif
+
+FAST_CODE void pwmWriteDigital(uint8_t index, uint16_t value)
 {
     if (!pwmMotorsEnabled) {
         return;
@@ -69,31 +208,40 @@ void pwmWriteDigital(uint8_t index, uint16_t value)
 
     motorDmaOutput_t * const motor = &dmaMotors[index];
 
-    if (!motor->timerHardware->dmaStream) {
+    uint32_t *dmaBuffer = motor->dmaBuffer;
+    int dmaBufferStride = 1;
+#ifdef USE_DSHOT_DMAR
+    motorDmaTimer_t * const burstTimer = motor->burstTimer;
+    if (burstTimer) {
+        dmaBuffer = &burstTimer->dmaBurstBuffer[(motor->timerHardware->channel >> 2) - burstTimer->dmaBurstBaseChannel];
+        dmaBufferStride = burstTimer->dmaBurstLength;
+    } else
+#endif
+    if (!motor->dmaStream) {
         return;
     }
 
-    uint16_t packet = (value << 1) | (motor->requestTelemetry ? 1 : 0);
-    motor->requestTelemetry = false;    // reset telemetry request to make sure it's triggered only once in a row
-
-    // compute checksum
-    int csum = 0;
-    int csum_data = packet;
-    for (int i = 0; i < 3; i++) {
-        csum ^=  csum_data;   // xor data by nibbles
-        csum_data >>= 4;
-    }
-    csum &= 0xf;
-    // append checksum
-    packet = (packet << 4) | csum;
-    // generate pulses for whole packet
-    for (int i = 0; i < 16; i++) {
-        motor->dmaBuffer[i] = (packet & 0x8000) ? MOTOR_BIT_1 : MOTOR_BIT_0;  // MSB first
-        packet <<= 1;
+#ifdef USE_DSHOT_TELEMETRY
+    if (motor->isInput) {
+        pwmDshotReadTelemetry(motor);
     }
+#endif
 
-    DMA_SetCurrDataCounter(motor->timerHardware->dmaStream, MOTOR_DMA_BUFFER_SIZE);
-    DMA_Cmd(motor->timerHardware->dmaStream, ENABLE);
+#ifdef USE_DSHOT_TELEMETRY
+    // an inverted checksum asks the ESC for the eRPM reply
+    dshotEncodeFrame(motor, dmaBuffer, dmaBufferStride, value, motor->hasTelemetry);
+#else
+    dshotEncodeFrame(motor, dmaBuffer, dmaBufferStride, value, false);
+#endif
+
+#ifdef USE_DSHOT_DMAR
+    if (burstTimer) {
+        // the burst for all the timer's motors is started by pwmCompleteDigitalMotorUpdate()
+        return;
+    }
+#endif
+    DMA_SetCurrDataCounter(motor->dmaStream, MOTOR_DMA_BUFFER_SIZE);
+    DMA_Cmd(motor->dmaStream, ENABLE);
 }
 
 void pwmCompleteDigitalMotorUpdate(uint8_t motorCount)
@@ -104,8 +252,26 @@ void pwmCompleteDigitalMotorUpdate(uint8_t motorCount)
         return;
     }
 
+#ifdef USE_LOOP_LATENCY
+    pwmMotorUpdateStartedAt = micros();
+#endif
     for (int i = 0; i < dmaMotorTimerCount; i++) {
-        TIM_SetCounter(dmaMotorTimers[i].timer, 0);
+#ifdef USE_DSHOT_DMAR
+        if (dmaMotorTimers[i].dmaBurstStream) {
+            DMA_SetCurrDataCounter(dmaMotorTimers[i].dmaBurstStream, MOTOR_DMA_BUFFER_SIZE * dmaMotorTimers[i].dmaBurstLength);
+            DMA_Cmd(dmaMotorTimers[i].dmaBurstStream, ENABLE);
+        }
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+        if (useDshotTelemetry) {
+            // load the frame period back, the counter ran freely while capturing
+            TIM_SetAutoreload(dmaMotorTimers[i].timer, MOTOR_BITLENGTH);
+            TIM_GenerateEvent(dmaMotorTimers[i].timer, TIM_EventSource_Update);
+        } else
+#endif
+        {
+            TIM_SetCounter(dmaMotorTimers[i].timer, 0);
+        }
         TIM_DMACmd(dmaMotorTimers[i].timer, dmaMotorTimers[i].timerDmaSources, ENABLE);
     }
 }
@@ -117,16 +283,107 @@ static void motor_DMA_IRQHandler(dmaChannelDescriptor_t *descriptor)
         DMA_Cmd(descriptor->stream, DISABLE);
         TIM_DMACmd(motor->timerHardware->tim, motor->timerDmaSource, DISABLE);
         DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+#ifdef USE_DSHOT_TELEMETRY
+        if (motor->hasTelemetry && !motor->isInput) {
+            // frame sent, capture the reply, it is decoded before the next frame
+            pwmDshotSetDirection(motor, true);
+            DMA_Cmd(descriptor->stream, ENABLE);
+            TIM_DMACmd(motor->timerHardware->tim, motor->timerDmaSource, ENABLE);
+        }
+#endif
+    }
+}
+
+#ifdef USE_DSHOT_DMAR
+static void motor_DMA_Burst_IRQHandler(dmaChannelDescriptor_t *descriptor)
+{
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
+        motorDmaTimer_t * const dmaMotorTimer = &dmaMotorTimers[descriptor->userParam];
+        DMA_Cmd(descriptor->stream, DISABLE);
+        TIM_DMACmd(dmaMotorTimer->timer, TIM_DMA_Update, DISABLE);
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
     }
 }
 
-void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, motorPwmProtocolTypes_e pwmProtocolType)
+/*
+ * Adds the motor to its timer's burst, which covers the CCRs from the lowest to the highest
+ * motor channel on the timer. Returns false if the timer has no free update DMA stream.
+ */
+static bool pwmDigitalMotorBurstConfig(motorDmaOutput_t *motor, uint8_t timerIndex, uint8_t motorIndex)
 {
-    TIM_OCInitTypeDef TIM_OCInitStructure;
+    motorDmaTimer_t * const dmaMotorTimer = &dmaMotorTimers[timerIndex];
+    TIM_TypeDef *timer = dmaMotorTimer->timer;
+
+    const timerDef_t *timerDefinition = getTimerDefinition(timer);
+    if (!timerDefinition || !timerDefinition->dmaBurstStream) {
+        return false;
+    }
+
+    const uint8_t channelIndex = motor->timerHardware->channel >> 2;
+    if (!dmaMotorTimer->dmaBurstStream) {
+        // the channel streams are the fallback, so a taken update stream is not a conflict
+        dmaStreamOption_t option = { .peripheral = timer, .request = DMA_REQUEST_TIM_UP, .stream = timerDefinition->dmaBurstStream, .channel = timerDefinition->dmaBurstChannel };
+        if (!dmaFindRequest(&option, OWNER_MOTOR, RESOURCE_INDEX(motorIndex))) {
+            return false;
+        }
+        dmaAllocate(dmaGetIdentifier(option.stream), OWNER_MOTOR, RESOURCE_INDEX(motorIndex));
+        dmaMotorTimer->dmaBurstStream = option.stream;
+        dmaMotorTimer->dmaBurstChannel = option.channel;
+        dmaMotorTimer->dmaBurstBaseChannel = channelIndex;
+        dmaMotorTimer->dmaBurstLength = 1;
+        dmaMotorTimer->timerDmaSources = TIM_DMA_Update;
+    } else {
+        const uint8_t lastChannel = MAX(channelIndex, dmaMotorTimer->dmaBurstBaseChannel + dmaMotorTimer->dmaBurstLength - 1);
+        dmaMotorTimer->dmaBurstBaseChannel = MIN(channelIndex, dmaMotorTimer->dmaBurstBaseChannel);
+        dmaMotorTimer->dmaBurstLength = lastChannel - dmaMotorTimer->dmaBurstBaseChannel + 1;
+    }
+    motor->burstTimer = dmaMotorTimer;
+
+    // the burst is reconfigured as each motor joins, the buffer is laid out by the new range
+    memset(dmaMotorTimer->dmaBurstBuffer, 0, sizeof(dmaMotorTimer->dmaBurstBuffer));
+    TIM_DMAConfig(timer, TIM_DMABase_CCR1 + dmaMotorTimer->dmaBurstBaseChannel, (dmaMotorTimer->dmaBurstLength - 1) << 8);
+
+    DMA_Stream_TypeDef *stream = dmaMotorTimer->dmaBurstStream;
+    const dmaIdentifier_e dmaIdentifier = dmaGetIdentifier(stream);
+    memoryReportDmaBuffer(OWNER_MOTOR, dmaMotorTimer->dmaBurstBuffer, sizeof(dmaMotorTimer->dmaBurstBuffer));
+    dmaSetHandler(dmaIdentifier, motor_DMA_Burst_IRQHandler, NVIC_BUILD_PRIORITY(1, 2), timerIndex);
+
+    DMA_Cmd(stream, DISABLE);
+    DMA_DeInit(stream);
+
     DMA_InitTypeDef DMA_InitStructure;
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_Channel = dmaMotorTimer->dmaBurstChannel;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&timer->DMAR;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)dmaMotorTimer->dmaBurstBuffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    DMA_InitStructure.DMA_BufferSize = MOTOR_DMA_BUFFER_SIZE * dmaMotorTimer->dmaBurstLength;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Enable;
+    DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_1QuarterFull;
+    DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+    DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+
+    DMA_Init(stream, &DMA_InitStructure);
+
+    DMA_ITConfig(stream, DMA_IT_TC, ENABLE);
+    DMA_ClearITPendingBit(stream, dmaFlag_IT_TCIF(stream));
+
+    return true;
+}
+#endif
 
+void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, motorPwmProtocolTypes_e pwmProtocolType)
+{
     motorDmaOutput_t * const motor = &dmaMotors[motorIndex];
     motor->timerHardware = timerHardware;
+    motor->encodedPacket = DSHOT_PACKET_NONE;
+    dshotEncoderInit(MOTOR_BIT_0, MOTOR_BIT_1);
 
     TIM_TypeDef *timer = timerHardware->tim;
     const IO_t motorIO = IOGetByTag(timerHardware->tag);
@@ -165,23 +422,13 @@ void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t
         TIM_TimeBaseInit(timer, &TIM_TimeBaseStructure);
     }
 
-    TIM_OCStructInit(&TIM_OCInitStructure);
-    TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
-    if (timerHardware->output & TIMER_OUTPUT_N_CHANNEL) {
-        TIM_OCInitStructure.TIM_OutputNState = TIM_OutputNState_Enable;
-        TIM_OCInitStructure.TIM_OCNIdleState = TIM_OCNIdleState_Reset;
-        TIM_OCInitStructure.TIM_OCNPolarity = (timerHardware->output & TIMER_OUTPUT_INVERTED) ? TIM_OCNPolarity_High : TIM_OCNPolarity_Low;
-    } else {
-        TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
-        TIM_OCInitStructure.TIM_OCIdleState = TIM_OCIdleState_Set;
-        TIM_OCInitStructure.TIM_OCPolarity =  (timerHardware->output & TIMER_OUTPUT_INVERTED) ? TIM_OCPolarity_Low : TIM_OCPolarity_High;
-    }
-    TIM_OCInitStructure.TIM_Pulse = 0;
-
-    timerOCInit(timer, timerHardware->channel, &TIM_OCInitStructure);
-    timerOCPreloadConfig(timer, timerHardware->channel, TIM_OCPreload_Enable);
-    motor->timerDmaSource = timerDmaSource(timerHardware->channel);
-    dmaMotorTimers[timerIndex].timerDmaSources |= motor->timerDmaSource;
+#ifdef USE_DSHOT_TELEMETRY
+    // bidirectional DSHOT idles high, the ESC replies on the same wire after each frame
+    motor->hasTelemetry = useDshotTelemetry && timerHardware->dmaStream && !(timerHardware->output & TIMER_OUTPUT_N_CHANNEL);
+    motor->isInput = false;
+    motor->telemetryValue = 0;
+#endif
+    pwmDigitalMotorOutputConfig(motor);
 
     TIM_CCxCmd(timer, motor->timerHardware->channel, TIM_CCx_Enable);
 
@@ -191,40 +438,31 @@ void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t
         TIM_Cmd(timer, ENABLE);
     }
 
-    DMA_Stream_TypeDef *stream = timerHardware->dmaStream;
+#ifdef USE_DSHOT_DMAR
+    if (useBurstDshot && pwmDigitalMotorBurstConfig(motor, timerIndex, motorIndex)) {
+        return;
+    }
+#endif
+    motor->timerDmaSource = timerDmaSource(timerHardware->channel);
+    dmaMotorTimers[timerIndex].timerDmaSources |= motor->timerDmaSource;
 
-    if (stream == NULL) {
+    if (timerHardware->dmaStream == NULL) {
         /* trying to use a non valid stream */
         return;
     }
 
-    dmaInit(timerHardware->dmaIrqHandler, OWNER_MOTOR, RESOURCE_INDEX(motorIndex));
-    dmaSetHandler(timerHardware->dmaIrqHandler, motor_DMA_IRQHandler, NVIC_BUILD_PRIORITY(1, 2), motorIndex);
-
-    DMA_Cmd(stream, DISABLE);
-    DMA_DeInit(stream);
-
-    DMA_StructInit(&DMA_InitStructure);
-    DMA_InitStructure.DMA_Channel = timerHardware->dmaChannel;
-    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)timerChCCR(timerHardware);
-    DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)motor->dmaBuffer;
-    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
-    DMA_InitStructure.DMA_BufferSize = MOTOR_DMA_BUFFER_SIZE;
-    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
-    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
-    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
-    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
-    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
-    DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
-    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Enable;
-    DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_1QuarterFull;
-    DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
-    DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+    dmaStreamOption_t option = { .peripheral = timer, .request = DMA_REQUEST_TIM_CH1 + (timerHardware->channel >> 2), .stream = timerHardware->dmaStream, .channel = timerHardware->dmaChannel };
+    if (!dmaAllocateRequest(&option, OWNER_MOTOR, RESOURCE_INDEX(motorIndex))) {
+        /* every stream serving the channel is taken */
+        return;
+    }
+    motor->dmaStream = option.stream;
+    motor->dmaChannel = option.channel;
 
-    DMA_Init(stream, &DMA_InitStructure);
+    memoryReportDmaBuffer(OWNER_MOTOR, motor->dmaBuffer, sizeof(motor->dmaBuffer));
+    dmaSetHandler(dmaGetIdentifier(motor->dmaStream), motor_DMA_IRQHandler, NVIC_BUILD_PRIORITY(1, 2), motorIndex);
 
-    DMA_ITConfig(stream, DMA_IT_TC, ENABLE);
-    DMA_ClearITPendingBit(stream, dmaFlag_IT_TCIF(timerHardware->dmaStream));
+    pwmDigitalMotorDmaConfig(motor, false);
 }
 
 #endif
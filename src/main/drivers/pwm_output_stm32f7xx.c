@@ -17,14 +17,20 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <math.h>
+#include <string.h>
 
 #include "platform.h"
 
+#include "build/build_config.h"
+
+#include "common/maths.h"
+
 #include "io.h"
 #include "timer.h"
 #include "pwm_output.h"
 #include "nvic.h"
 #include "dma.h"
+#include "memory_report.h"
 #include "system.h"
 #include "rcc.h"
 
@@ -41,8 +47,8 @@
 #define MOTOR_BITLENGTH 19
 
 static uint8_t dmaMotorTimerCount = 0;
-static motorDmaTimer_t dmaMotorTimers[MAX_DMA_TIMERS];
-static motorDmaOutput_t dmaMotors[MAX_SUPPORTED_MOTORS];
+static DMA_RAM motorDmaTimer_t dmaMotorTimers[MAX_DMA_TIMERS];
+static DMA_RAM motorDmaOutput_t dmaMotors[MAX_SUPPORTED_MOTORS];
 
 motorDmaOutput_t *getMotorDmaOutput(uint8_t index)
 {
@@ -60,7 +66,19 @@ uint8_t getTimerIndex(TIM_TypeDef *timer)
     return dmaMotorTimerCount-1;
 }
 
-void pwmWriteDigital(uint8_t index, uint16_t value)
+#ifdef USE_DSHOT_DMAR
+static const timerDef_t *getTimerDefinition(TIM_TypeDef *timer)
+{
+    for (int i = 0; i < HARDWARE_TIMER_DEFINITION_COUNT; i++) {
+        if (timerDefinitions[i].TIMx == timer) {
+            return &timerDefinitions[i];
+        }
+    }
+    return NULL;
+}
+#endif
+
+FAST_CODE void pwmWriteDigital(uint8_t index, uint16_t value)
 {
 
     if (!pwmMotorsEnabled) {
@@ -69,28 +87,36 @@ void pwmWriteDigital(uint8_t index, uint16_t value)
 
     motorDmaOutput_t * const motor = &dmaMotors[index];
 
-    if (!motor->timerHardware->dmaStream) {
-        return;
+    uint32_t *dmaBuffer = motor->dmaBuffer;
+    int dmaBufferStride = 1;
+#ifdef USE_DSHOT_DMAR
+    motorDmaTimer_t * const burstTimer = motor->burstTimer;
+    if (burstTimer) {
+        dmaBuffer = &burstTimer->dmaBurstBuffer[(motor->timerHardware->channel >> 2) - burstTimer->dmaBurstBaseChannel];
+        dmaBufferStride = burstTimer->dmaBurstLength;
+    } else
+#endif
+    {
+#ifdef USE_LOOP_LATENCY
+        // the HAL starts each motor's DMA as soon as its packet is written
+        if (index == 0) {
+            pwmMotorUpdateStartedAt = micros();
+        }
+#endif
+
+        if (!motor->dmaStream) {
+            return;
+        }
     }
 
-    uint16_t packet = (value << 1) | (motor->requestTelemetry ? 1 : 0);
-    motor->requestTelemetry = false;    // reset telemetry request to make sure it's triggered only once in a row
+    dshotEncodeFrame(motor, dmaBuffer, dmaBufferStride, value, false);
 
-    // compute checksum
-    int csum = 0;
-    int csum_data = packet;
-    for (int i = 0; i < 3; i++) {
-        csum ^=  csum_data;   // xor data by nibbles
-        csum_data >>= 4;
-    }
-    csum &= 0xf;
-    // append checksum
-    packet = (packet << 4) | csum;
-    // generate pulses for whole packet
-    for (int i = 0; i < 16; i++) {
-        motor->dmaBuffer[i] = (packet & 0x8000) ? MOTOR_BIT_1 : MOTOR_BIT_0;  // MSB first
-        packet <<= 1;
+#ifdef USE_DSHOT_DMAR
+    if (burstTimer) {
+        // the burst for all the timer's motors is started by pwmCompleteDigitalMotorUpdate()
+        return;
     }
+#endif
 
     if(HAL_TIM_PWM_Start_DMA(&motor->TimHandle, motor->timerHardware->channel, motor->dmaBuffer, MOTOR_DMA_BUFFER_SIZE) != HAL_OK)
     {
@@ -107,10 +133,23 @@ void pwmCompleteDigitalMotorUpdate(uint8_t motorCount)
         return;
     }
 
+#ifdef USE_DSHOT_DMAR
     for (uint8_t i = 0; i < dmaMotorTimerCount; i++) {
-        //TIM_SetCounter(dmaMotorTimers[i].timer, 0);
-        //TIM_DMACmd(dmaMotorTimers[i].timer, dmaMotorTimers[i].timerDmaSources, ENABLE);
+        motorDmaTimer_t * const dmaMotorTimer = &dmaMotorTimers[i];
+        if (!dmaMotorTimer->dmaBurstStream) {
+            continue;
+        }
+#ifdef USE_LOOP_LATENCY
+        pwmMotorUpdateStartedAt = micros();
+#endif
+        const uint32_t burstSize = MOTOR_DMA_BUFFER_SIZE * dmaMotorTimer->dmaBurstLength;
+        if (HAL_DMA_Start_IT(&dmaMotorTimer->hdma_burst, (uint32_t)dmaMotorTimer->dmaBurstBuffer, (uint32_t)&dmaMotorTimer->timer->DMAR, burstSize) != HAL_OK) {
+            continue;
+        }
+        dmaMotorTimer->timer->CNT = 0;
+        dmaMotorTimer->timer->DIER |= TIM_DMA_UPDATE;
     }
+#endif
 }
 
 
@@ -120,6 +159,86 @@ static void motor_DMA_IRQHandler(dmaChannelDescriptor_t* descriptor)
     HAL_DMA_IRQHandler(motor->TimHandle.hdma[motor->timerDmaSource]);
 }
 
+#ifdef USE_DSHOT_DMAR
+static void motor_DMA_Burst_IRQHandler(dmaChannelDescriptor_t* descriptor)
+{
+    HAL_DMA_IRQHandler(&dmaMotorTimers[descriptor->userParam].hdma_burst);
+}
+
+static void motorDmaBurstComplete(DMA_HandleTypeDef *hdma)
+{
+    motorDmaTimer_t * const dmaMotorTimer = hdma->Parent;
+    dmaMotorTimer->timer->DIER &= ~TIM_DMA_UPDATE;
+}
+
+/*
+ * Adds the motor to its timer's burst, which covers the CCRs from the lowest to the highest
+ * motor channel on the timer. Returns false if the timer has no free update DMA stream.
+ */
+static bool pwmDigitalMotorBurstConfig(motorDmaOutput_t *motor, uint8_t timerIndex, uint8_t motorIndex)
+{
+    motorDmaTimer_t * const dmaMotorTimer = &dmaMotorTimers[timerIndex];
+    TIM_TypeDef *timer = dmaMotorTimer->timer;
+
+    const timerDef_t *timerDefinition = getTimerDefinition(timer);
+    if (!timerDefinition || !timerDefinition->dmaBurstStream) {
+        return false;
+    }
+
+    const uint8_t channelIndex = motor->timerHardware->channel >> 2;
+    if (!dmaMotorTimer->dmaBurstStream) {
+        // the channel streams are the fallback, so a taken update stream is not a conflict
+        dmaStreamOption_t option = { .peripheral = timer, .request = DMA_REQUEST_TIM_UP, .stream = timerDefinition->dmaBurstStream, .channel = timerDefinition->dmaBurstChannel };
+        if (!dmaFindRequest(&option, OWNER_MOTOR, RESOURCE_INDEX(motorIndex))) {
+            return false;
+        }
+        dmaAllocate(dmaGetIdentifier(option.stream), OWNER_MOTOR, RESOURCE_INDEX(motorIndex));
+        dmaMotorTimer->dmaBurstStream = option.stream;
+        dmaMotorTimer->dmaBurstChannel = option.channel;
+        dmaMotorTimer->dmaBurstBaseChannel = channelIndex;
+        dmaMotorTimer->dmaBurstLength = 1;
+    } else {
+        const uint8_t lastChannel = MAX(channelIndex, dmaMotorTimer->dmaBurstBaseChannel + dmaMotorTimer->dmaBurstLength - 1);
+        dmaMotorTimer->dmaBurstBaseChannel = MIN(channelIndex, dmaMotorTimer->dmaBurstBaseChannel);
+        dmaMotorTimer->dmaBurstLength = lastChannel - dmaMotorTimer->dmaBurstBaseChannel + 1;
+    }
+    motor->burstTimer = dmaMotorTimer;
+
+    // the burst is reconfigured as each motor joins, the buffer is laid out by the new range
+    memset(dmaMotorTimer->dmaBurstBuffer, 0, sizeof(dmaMotorTimer->dmaBurstBuffer));
+    timer->DCR = (TIM_DMABASE_CCR1 + dmaMotorTimer->dmaBurstBaseChannel) | ((dmaMotorTimer->dmaBurstLength - 1) << 8);
+
+    DMA_Stream_TypeDef *stream = dmaMotorTimer->dmaBurstStream;
+    const dmaIdentifier_e dmaIdentifier = dmaGetIdentifier(stream);
+    memoryReportDmaBuffer(OWNER_MOTOR, dmaMotorTimer->dmaBurstBuffer, sizeof(dmaMotorTimer->dmaBurstBuffer));
+    dmaSetHandler(dmaIdentifier, motor_DMA_Burst_IRQHandler, NVIC_BUILD_PRIORITY(1, 2), timerIndex);
+
+    DMA_HandleTypeDef *hdma = &dmaMotorTimer->hdma_burst;
+    HAL_DMA_DeInit(hdma);
+    hdma->Instance = stream;
+    hdma->Init.Channel = dmaMotorTimer->dmaBurstChannel;
+    hdma->Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority = DMA_PRIORITY_HIGH;
+    hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    hdma->Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+    hdma->Init.MemBurst = DMA_MBURST_SINGLE;
+    hdma->Init.PeriphBurst = DMA_PBURST_SINGLE;
+    if (HAL_DMA_Init(hdma) != HAL_OK) {
+        motor->burstTimer = NULL;
+        return false;
+    }
+    hdma->Parent = dmaMotorTimer;
+    hdma->XferCpltCallback = motorDmaBurstComplete;
+
+    return true;
+}
+#endif
+
 /*static void motor_DMA_IRQHandler(dmaChannelDescriptor_t *descriptor)
 {
     if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
@@ -130,10 +249,31 @@ static void motor_DMA_IRQHandler(dmaChannelDescriptor_t* descriptor)
     }
 }*/
 
+static void pwmDigitalMotorOutputConfig(motorDmaOutput_t *motor)
+{
+    TIM_OC_InitTypeDef TIM_OCInitStructure;
+
+    /* PWM1 Mode configuration: Channel1 */
+    TIM_OCInitStructure.OCMode = TIM_OCMODE_PWM1;
+    TIM_OCInitStructure.OCPolarity = TIM_OCPOLARITY_HIGH;
+    TIM_OCInitStructure.OCIdleState = TIM_OCIDLESTATE_RESET;
+    TIM_OCInitStructure.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+    TIM_OCInitStructure.OCFastMode = TIM_OCFAST_DISABLE;
+    TIM_OCInitStructure.Pulse = 0;
+
+    if(HAL_TIM_PWM_ConfigChannel(&motor->TimHandle, &TIM_OCInitStructure, motor->timerHardware->channel) != HAL_OK)
+    {
+        /* Configuration Error */
+        return;
+    }
+}
+
 void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, motorPwmProtocolTypes_e pwmProtocolType)
 {
     motorDmaOutput_t * const motor = &dmaMotors[motorIndex];
     motor->timerHardware = timerHardware;
+    motor->encodedPacket = DSHOT_PACKET_NONE;
+    dshotEncoderInit(MOTOR_BIT_0, MOTOR_BIT_1);
 
     TIM_TypeDef *timer = timerHardware->tim;
     const IO_t motorIO = IOGetByTag(timerHardware->tag);
@@ -197,8 +337,37 @@ void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t
 
     dmaMotorTimers[timerIndex].timerDmaSources |= motor->timerDmaSource;
 
+#ifdef USE_DSHOT_DMAR
+    if (useBurstDshot && pwmDigitalMotorBurstConfig(motor, timerIndex, motorIndex)) {
+        pwmDigitalMotorOutputConfig(motor);
+        // HAL_TIM_PWM_Start_DMA() is not used for bursts, start the channel and the timer here
+        TIM_CCxChannelCmd(timer, timerHardware->channel, TIM_CCx_ENABLE);
+        if (IS_TIM_BREAK_INSTANCE(timer)) {
+            timer->BDTR |= TIM_BDTR_MOE;
+        }
+        timer->CR1 |= TIM_CR1_CEN;
+        return;
+    }
+#endif
+
+    /* Set hdma_tim instance */
+    if(timerHardware->dmaStream == NULL)
+    {
+        /* Initialization Error */
+        return;
+    }
+
+    dmaStreamOption_t option = { .peripheral = timer, .request = DMA_REQUEST_TIM_CH1 + (timerHardware->channel >> 2), .stream = timerHardware->dmaStream, .channel = timerHardware->dmaChannel };
+    if (!dmaAllocateRequest(&option, OWNER_MOTOR, RESOURCE_INDEX(motorIndex))) {
+        /* every stream serving the channel is taken */
+        return;
+    }
+    motor->dmaStream = option.stream;
+    motor->dmaChannel = option.channel;
+    motor->hdma_tim.Instance = motor->dmaStream;
+
     /* Set the parameters to be configured */
-    motor->hdma_tim.Init.Channel  = timerHardware->dmaChannel;
+    motor->hdma_tim.Init.Channel  = motor->dmaChannel;
     motor->hdma_tim.Init.Direction = DMA_MEMORY_TO_PERIPH;
     motor->hdma_tim.Init.PeriphInc = DMA_PINC_DISABLE;
     motor->hdma_tim.Init.MemInc = DMA_MINC_ENABLE;
@@ -211,19 +380,11 @@ void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t
     motor->hdma_tim.Init.MemBurst = DMA_MBURST_SINGLE;
     motor->hdma_tim.Init.PeriphBurst = DMA_PBURST_SINGLE;
 
-    /* Set hdma_tim instance */
-    if(timerHardware->dmaStream == NULL)
-    {
-        /* Initialization Error */
-        return;
-    }
-    motor->hdma_tim.Instance = timerHardware->dmaStream;
-
     /* Link hdma_tim to hdma[x] (channelx) */
     __HAL_LINKDMA(&motor->TimHandle, hdma[motor->timerDmaSource], motor->hdma_tim);
 
-    dmaInit(timerHardware->dmaIrqHandler, OWNER_MOTOR, RESOURCE_INDEX(motorIndex));
-    dmaSetHandler(timerHardware->dmaIrqHandler, motor_DMA_IRQHandler, NVIC_BUILD_PRIORITY(1, 2), motorIndex);
+    memoryReportDmaBuffer(OWNER_MOTOR, motor->dmaBuffer, sizeof(motor->dmaBuffer));
+    dmaSetHandler(dmaGetIdentifier(motor->dmaStream), motor_DMA_IRQHandler, NVIC_BUILD_PRIORITY(1, 2), motorIndex);
 
     /* Initialize TIMx DMA handle */
     if(HAL_DMA_Init(motor->TimHandle.hdma[motor->timerDmaSource]) != HAL_OK)
@@ -232,21 +393,7 @@ void pwmDigitalMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t
         return;
     }
 
-    TIM_OC_InitTypeDef TIM_OCInitStructure;
-
-    /* PWM1 Mode configuration: Channel1 */
-    TIM_OCInitStructure.OCMode = TIM_OCMODE_PWM1;
-    TIM_OCInitStructure.OCPolarity = TIM_OCPOLARITY_HIGH;
-    TIM_OCInitStructure.OCIdleState = TIM_OCIDLESTATE_RESET;
-    TIM_OCInitStructure.OCNIdleState = TIM_OCNIDLESTATE_RESET;
-    TIM_OCInitStructure.OCFastMode = TIM_OCFAST_DISABLE;
-    TIM_OCInitStructure.Pulse = 0;
-
-    if(HAL_TIM_PWM_ConfigChannel(&motor->TimHandle, &TIM_OCInitStructure, motor->timerHardware->channel) != HAL_OK)
-    {
-        /* Configuration Error */
-        return;
-    }
+    pwmDigitalMotorOutputConfig(motor);
 }
 
 #endif
@@ -60,5 +60,10 @@ const char * const ownerNames[OWNER_TOTAL_COUNT] = {
     "LED_STRIP",
     "TRANSPONDER",
     "VTX",
+    "MPU_DMA",
+    "SDCARD",
+    "RX_SPI_EXTI",
+    "SERIAL_CTS",
+    "FLASH",
 };
 
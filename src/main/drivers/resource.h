@@ -60,6 +60,11 @@ typedef enum {
     OWNER_LED_STRIP,
     OWNER_TRANSPONDER,
     OWNER_VTX,
+    OWNER_MPU_DMA,
+    OWNER_SDCARD,
+    OWNER_RX_SPI_EXTI,
+    OWNER_SERIAL_CTS,
+    OWNER_FLASH,
     OWNER_TOTAL_COUNT
 } resourceOwner_e;
 
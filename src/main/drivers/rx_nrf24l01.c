@@ -29,8 +29,10 @@
 #include "build/build_config.h"
 
 #include "bus_spi.h"
+#include "exti.h"
 #include "io.h"
 #include "io_impl.h"
+#include "nvic.h"
 #include "rx_spi.h"
 #include "rx_nrf24l01.h"
 #include "system.h"
@@ -38,6 +40,11 @@
 #define NRF24_CE_HI()   {IOHi(DEFIO_IO(RX_CE_PIN));}
 #define NRF24_CE_LO()   {IOLo(DEFIO_IO(RX_CE_PIN));}
 
+// F7 EXTI lines only trigger on the rising edge, the nRF24L01 IRQ is active low
+#if defined(RX_IRQ_PIN) && !defined(STM32F7) && !defined(UNIT_TEST)
+#define USE_NRF24_IRQ
+#endif
+
 // Instruction Mnemonics
 // nRF24L01:  Table 16. Command set for the nRF24L01 SPI. Product Specification, p46
 // nRF24L01+: Table 20. Command set for the nRF24L01+ SPI. Product Specification, p51
@@ -54,6 +61,20 @@
 #define REUSE_TX_PL   0xE3
 #define NOP           0xFF
 
+#ifdef USE_NRF24_IRQ
+static IO_t irqIO;
+static extiCallbackRec_t nrf24ExtiCallbackRec;
+static nrf24IrqCallbackFn *irqCallback;
+
+static void NRF24L01_ExtiHandler(extiCallbackRec_t *cb)
+{
+    UNUSED(cb);
+    if (irqCallback) {
+        irqCallback(micros());
+    }
+}
+#endif
+
 static void NRF24L01_InitGpio(void)
 {
     // CE as OUTPUT
@@ -61,6 +82,45 @@ static void NRF24L01_InitGpio(void)
     IOInit(DEFIO_IO(RX_CE_PIN), OWNER_RX_SPI_CS, rxSPIDevice + 1);
     IOConfigGPIO(DEFIO_IO(RX_CE_PIN), SPI_IO_CS_CFG);
     NRF24_CE_LO();
+
+#ifdef USE_NRF24_IRQ
+    // IRQ is open drain and pulled low while RX_DR is set
+    irqIO = IOGetByTag(IO_TAG(RX_IRQ_PIN));
+    IOInit(irqIO, OWNER_RX_SPI_EXTI, 0);
+    IOConfigGPIO(irqIO, IOCFG_IPU);
+
+    EXTIHandlerInit(&nrf24ExtiCallbackRec, NRF24L01_ExtiHandler);
+    EXTIConfig(irqIO, &nrf24ExtiCallbackRec, NVIC_PRIO_RX_SPI_INT_EXTI, EXTI_Trigger_Falling);
+    EXTIEnable(irqIO, true);
+#endif
+}
+
+/*
+ * Set the function called from the IRQ pin interrupt when a packet has been received.
+ * Returns false if the target has no IRQ pin, in which case the radio has to be polled.
+ */
+bool NRF24L01_SetIrqCallback(nrf24IrqCallbackFn *fn)
+{
+#ifdef USE_NRF24_IRQ
+    irqCallback = fn;
+    return true;
+#else
+    UNUSED(fn);
+    return false;
+#endif
+}
+
+/*
+ * Returns false if the IRQ pin shows no packet has been received, without any SPI traffic.
+ * Without an IRQ pin this always returns true and the status registers have to be read.
+ */
+bool NRF24L01_IrqPending(void)
+{
+#ifdef USE_NRF24_IRQ
+    return !IORead(irqIO);
+#else
+    return true;
+#endif
 }
 
 uint8_t NRF24L01_WriteReg(uint8_t reg, uint8_t data)
@@ -133,6 +193,10 @@ static uint8_t standbyConfig;
 void NRF24L01_Initialize(uint8_t baseConfig)
 {
     standbyConfig = BV(NRF24L01_00_CONFIG_PWR_UP) | baseConfig;
+#ifdef USE_NRF24_IRQ
+    // only a received packet drives the IRQ pin, TX status is polled by the protocols
+    standbyConfig |= BV(NRF24L01_00_CONFIG_MASK_TX_DS) | BV(NRF24L01_00_CONFIG_MASK_MAX_RT);
+#endif
     NRF24L01_InitGpio();
     // nRF24L01+ needs 100 milliseconds settling time from PowerOnReset to PowerDown mode
     static const uint32_t settlingTimeUs = 100000;
@@ -211,11 +275,27 @@ void NRF24L01_SetChannel(uint8_t channel)
 
 bool NRF24L01_ReadPayloadIfAvailable(uint8_t *data, uint8_t length)
 {
+#ifdef USE_NRF24_IRQ
+    if (!NRF24L01_IrqPending()) {
+        return false;
+    }
+    // clear RX_DR before emptying the FIFO, so a packet arriving meanwhile raises the IRQ again
+    NRF24L01_WriteReg(NRF24L01_07_STATUS, BV(NRF24L01_07_STATUS_RX_DR));
+    if (NRF24L01_ReadReg(NRF24L01_17_FIFO_STATUS) & BV(NRF24L01_17_FIFO_STATUS_RX_EMPTY)) {
+        return false;
+    }
+    // the IRQ is not raised again for packets already queued, so keep only the newest
+    do {
+        NRF24L01_ReadPayload(data, length);
+    } while (!(NRF24L01_ReadReg(NRF24L01_17_FIFO_STATUS) & BV(NRF24L01_17_FIFO_STATUS_RX_EMPTY)));
+    return true;
+#else
     if (NRF24L01_ReadReg(NRF24L01_17_FIFO_STATUS) & BV(NRF24L01_17_FIFO_STATUS_RX_EMPTY)) {
         return false;
     }
     NRF24L01_ReadPayload(data, length);
     return true;
+#endif
 }
 
 #ifndef UNIT_TEST
@@ -23,6 +23,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "common/time.h"
+
 #include "rx_spi.h"
 
 #define NRF24L01_MAX_PAYLOAD_SIZE 32
@@ -199,3 +201,7 @@ void NRF24L01_ClearAllInterrupts(void);
 void NRF24L01_SetChannel(uint8_t channel);
 bool NRF24L01_ReadPayloadIfAvailable(uint8_t *data, uint8_t length);
 
+typedef void nrf24IrqCallbackFn(timeUs_t irqTimeUs);
+bool NRF24L01_SetIrqCallback(nrf24IrqCallbackFn *fn);
+bool NRF24L01_IrqPending(void);
+
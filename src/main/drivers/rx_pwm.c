@@ -36,6 +36,11 @@
 #include "pwm_output.h"
 #include "rx_pwm.h"
 
+#ifdef USE_RX_PWM_DMA
+#include "dma.h"
+#include "memory_report.h"
+#endif
+
 #define DEBUG_PPM_ISR
 
 #define PPM_CAPTURE_COUNT 12
@@ -58,6 +63,19 @@ typedef enum {
     INPUT_MODE_PWM
 } pwmInputMode_t;
 
+#ifdef USE_RX_PWM_DMA
+// Ring of edge timestamps written by the channel's capture DMA request, decoded by the RX task
+#define INPUT_DMA_BUFFER_SIZE 32
+
+typedef struct inputDma_s {
+    DMA_Stream_TypeDef *stream;             // NULL when the port decodes in the capture interrupt
+    uint8_t readIndex;
+    uint16_t lastCapture;
+    uint32_t lastPulseAt;                   // ms, for the PWM timeout
+    uint16_t captures[INPUT_DMA_BUFFER_SIZE];
+} inputDma_t;
+#endif
+
 typedef struct {
     pwmInputMode_t mode;
     uint8_t channel; // only used for pwm, ignored by ppm
@@ -72,6 +90,9 @@ typedef struct {
     const timerHardware_t *timerHardware;
     timerCCHandlerRec_t edgeCb;
     timerOvrHandlerRec_t overflowCb;
+#ifdef USE_RX_PWM_DMA
+    inputDma_t dma;
+#endif
 } pwmInputPort_t;
 
 static pwmInputPort_t pwmInputPorts[PWM_INPUT_PORT_COUNT];
@@ -110,8 +131,16 @@ ppmDevice_t ppmDev;
 #define PPM_IN_MIN_NUM_CHANNELS     4
 #define PPM_IN_MAX_NUM_CHANNELS     PWM_PORTS_OR_PPM_CAPTURE_COUNT
 
+#ifdef USE_RX_PWM_DMA
+static void ppmProcessCaptures(void);
+static void pwmProcessCaptures(void);
+#endif
+
 bool isPPMDataBeingReceived(void)
 {
+#ifdef USE_RX_PWM_DMA
+    ppmProcessCaptures();
+#endif
     return (ppmFrameCount != lastPPMFrameCount);
 }
 
@@ -172,45 +201,11 @@ static void ppmOverflowCallback(timerOvrHandlerRec_t* cbRec, captureCompare_t ca
     }
 }
 
-static void ppmEdgeCallback(timerCCHandlerRec_t* cbRec, captureCompare_t capture)
+// Takes the pulse that ended with the latest edge, of ppmDev.deltaTime, into the frame
+static void ppmDecodePulse(void)
 {
-    UNUSED(cbRec);
-    ppmISREvent(SOURCE_EDGE, capture);
-
     int32_t i;
 
-    uint32_t previousTime = ppmDev.currentTime;
-    uint32_t previousCapture = ppmDev.currentCapture;
-
-    /* Grab the new count */
-    uint32_t currentTime = capture;
-
-    /* Convert to 32-bit timer result */
-    currentTime += ppmDev.largeCounter;
-
-    if (capture < previousCapture) {
-        if (ppmDev.overflowed) {
-            currentTime += PPM_TIMER_PERIOD;
-        }
-    }
-
-    // Divide value if Oneshot, Multishot or brushed motors are active and the timer is shared
-    currentTime = currentTime / ppmCountDivisor;
-
-    /* Capture computation */
-    if (currentTime > previousTime) {
-        ppmDev.deltaTime    = currentTime - (previousTime + (ppmDev.overflowed ? (PPM_TIMER_PERIOD / ppmCountDivisor) : 0));
-    } else {
-        ppmDev.deltaTime    = (PPM_TIMER_PERIOD / ppmCountDivisor) + currentTime - previousTime;
-    }
-
-    ppmDev.overflowed = false;
-
-
-    /* Store the current measurement */
-    ppmDev.currentTime = currentTime;
-    ppmDev.currentCapture = capture;
-
     /* Sync pulse detection */
     if (ppmDev.deltaTime > PPM_IN_MIN_SYNC_PULSE_US) {
         if (ppmDev.pulseIndex == ppmDev.numChannelsPrevFrame
@@ -262,10 +257,53 @@ static void ppmEdgeCallback(timerCCHandlerRec_t* cbRec, captureCompare_t capture
     }
 }
 
+static void ppmEdgeCallback(timerCCHandlerRec_t* cbRec, captureCompare_t capture)
+{
+    UNUSED(cbRec);
+    ppmISREvent(SOURCE_EDGE, capture);
+
+    uint32_t previousTime = ppmDev.currentTime;
+    uint32_t previousCapture = ppmDev.currentCapture;
+
+    /* Grab the new count */
+    uint32_t currentTime = capture;
+
+    /* Convert to 32-bit timer result */
+    currentTime += ppmDev.largeCounter;
+
+    if (capture < previousCapture) {
+        if (ppmDev.overflowed) {
+            currentTime += PPM_TIMER_PERIOD;
+        }
+    }
+
+    // Divide value if Oneshot, Multishot or brushed motors are active and the timer is shared
+    currentTime = currentTime / ppmCountDivisor;
+
+    /* Capture computation */
+    if (currentTime > previousTime) {
+        ppmDev.deltaTime    = currentTime - (previousTime + (ppmDev.overflowed ? (PPM_TIMER_PERIOD / ppmCountDivisor) : 0));
+    } else {
+        ppmDev.deltaTime    = (PPM_TIMER_PERIOD / ppmCountDivisor) + currentTime - previousTime;
+    }
+
+    ppmDev.overflowed = false;
+
+
+    /* Store the current measurement */
+    ppmDev.currentTime = currentTime;
+    ppmDev.currentCapture = capture;
+
+    ppmDecodePulse();
+}
+
 #define MAX_MISSED_PWM_EVENTS 10
 
 bool isPWMDataBeingReceived(void)
 {
+#ifdef USE_RX_PWM_DMA
+    pwmProcessCaptures();
+#endif
     int channel;
     for (channel = 0; channel < PWM_PORTS_OR_PPM_CAPTURE_COUNT; channel++) {
         if (captures[channel] != PPM_RCVR_TIMEOUT) {
@@ -317,6 +355,114 @@ static void pwmEdgeCallback(timerCCHandlerRec_t *cbRec, captureCompare_t capture
     }
 }
 
+#ifdef USE_RX_PWM_DMA
+// servo pulse lengths, both edges are captured and the interval in this range is the pulse, the other the gap
+#define PWM_IN_MIN_PULSE_US         750
+#define PWM_IN_MAX_PULSE_US         2250
+// as long as the capture interrupt path takes to count its missed events
+#define PWM_IN_DMA_TIMEOUT_MS       (MAX_MISSED_PWM_EVENTS * PWM_TIMER_PERIOD / 1000)
+
+/*
+ * Has the channel's capture DMA request write the edge timestamps to the port's ring, in place of
+ * the capture interrupt. Returns false, for the interrupt to be used, if there is no free stream.
+ */
+static bool pwmInputDmaConfig(pwmInputPort_t *port, resourceOwner_e owner, uint8_t resourceIndex)
+{
+    const timerHardware_t *timerHardware = port->timerHardware;
+
+    if (!timerHardware->dmaStream) {
+        return false;
+    }
+    dmaStreamOption_t option = { .peripheral = timerHardware->tim, .request = DMA_REQUEST_TIM_CH1 + (timerHardware->channel >> 2), .stream = timerHardware->dmaStream, .channel = timerHardware->dmaChannel };
+    if (!dmaAllocateRequest(&option, owner, resourceIndex)) {
+        return false;
+    }
+    memoryReportDmaBuffer(owner, port->dma.captures, sizeof(port->dma.captures));
+
+    DMA_Stream_TypeDef *stream = option.stream;
+    DMA_Cmd(stream, DISABLE);
+    DMA_DeInit(stream);
+
+    DMA_InitTypeDef DMA_InitStructure;
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_Channel = option.channel;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)timerChCCR(timerHardware);
+    DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)port->dma.captures;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+    DMA_InitStructure.DMA_BufferSize = INPUT_DMA_BUFFER_SIZE;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    // the timers run a 16 bit period, the low half of the 32 bit CCRs of TIM2 and TIM5 is enough
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_Init(stream, &DMA_InitStructure);
+
+    port->dma.stream = stream;
+    port->dma.readIndex = 0;
+    DMA_Cmd(stream, ENABLE);
+    TIM_DMACmd(timerHardware->tim, timerDmaSource(timerHardware->channel), ENABLE);
+
+    return true;
+}
+
+// Returns the next timestamp the DMA has written to the ring, false once it is caught up
+static bool pwmInputDmaNextCapture(inputDma_t *dma, uint16_t *capture)
+{
+    const uint8_t writeIndex = (INPUT_DMA_BUFFER_SIZE - DMA_GetCurrDataCounter(dma->stream)) % INPUT_DMA_BUFFER_SIZE;
+
+    if (dma->readIndex == writeIndex) {
+        return false;
+    }
+    *capture = dma->captures[dma->readIndex];
+    dma->readIndex = (dma->readIndex + 1) % INPUT_DMA_BUFFER_SIZE;
+    return true;
+}
+
+static void ppmProcessCaptures(void)
+{
+    pwmInputPort_t *port = &pwmInputPorts[0];
+    if (port->mode != INPUT_MODE_PPM || !port->dma.stream) {
+        return;
+    }
+
+    uint16_t capture;
+    while (pwmInputDmaNextCapture(&port->dma, &capture)) {
+        // the timer is not shared when the DMA is used, so it wraps at 16 bits and so does the difference
+        ppmDev.deltaTime = (uint16_t)(capture - port->dma.lastCapture);
+        port->dma.lastCapture = capture;
+        ppmDecodePulse();
+    }
+}
+
+static void pwmProcessCaptures(void)
+{
+    const uint32_t now = millis();
+
+    for (int channel = 0; channel < PWM_INPUT_PORT_COUNT; channel++) {
+        pwmInputPort_t *port = &pwmInputPorts[channel];
+        if (port->mode != INPUT_MODE_PWM || !port->dma.stream) {
+            continue;
+        }
+
+        uint16_t capture;
+        while (pwmInputDmaNextCapture(&port->dma, &capture)) {
+            const uint16_t interval = capture - port->dma.lastCapture;
+            port->dma.lastCapture = capture;
+            if (interval >= PWM_IN_MIN_PULSE_US && interval <= PWM_IN_MAX_PULSE_US) {
+                port->capture = interval;
+                captures[port->channel] = interval;
+                port->dma.lastPulseAt = now;
+            }
+        }
+        if (captures[port->channel] != PPM_RCVR_TIMEOUT && now - port->dma.lastPulseAt > PWM_IN_DMA_TIMEOUT_MS) {
+            captures[port->channel] = PPM_RCVR_TIMEOUT;
+        }
+    }
+}
+#endif
+
 #ifdef USE_HAL_DRIVER
 
 void pwmICConfig(TIM_TypeDef *tim, uint8_t channel, uint16_t polarity)
@@ -388,6 +534,15 @@ void pwmRxInit(const pwmConfig_t *pwmConfig)
         IOConfigGPIO(io, IOCFG_AF_PP);
 #endif
 
+#ifdef USE_RX_PWM_DMA
+        // the RX task decodes the edges from the DMA ring, no interrupt is taken per edge
+        if (pwmInputDmaConfig(port, OWNER_PWMINPUT, RESOURCE_INDEX(channel))) {
+            pwmICConfig(timer->tim, timer->channel, TIM_ICPolarity_BothEdge);
+            timerConfigure(timer, (uint16_t)PWM_TIMER_PERIOD, PWM_TIMER_MHZ);
+            continue;
+        }
+#endif
+
 #if defined(USE_HAL_DRIVER)
     pwmICConfig(timer->tim, timer->channel, TIM_ICPOLARITY_RISING);
 #else
@@ -404,6 +559,19 @@ void pwmRxInit(const pwmConfig_t *pwmConfig)
 #define UNUSED_PPM_TIMER_REFERENCE 0
 #define FIRST_PWM_PORT 0
 
+#ifdef USE_RX_PWM_DMA
+static bool ppmTimerSharedWithMotors(TIM_TypeDef *timer)
+{
+    pwmOutputPort_t *motors = pwmGetMotors();
+    for (int motorIndex = 0; motorIndex < MAX_SUPPORTED_MOTORS; motorIndex++) {
+        if (motors[motorIndex].enabled && motors[motorIndex].tim == timer) {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
 void ppmAvoidPWMTimerClash(TIM_TypeDef *pwmTimer, uint8_t pwmProtocol)
 {
     pwmOutputPort_t *motors = pwmGetMotors();
@@ -464,6 +632,13 @@ void ppmRxInit(const ppmConfig_t *ppmConfig, uint8_t pwmProtocol)
 
     timerConfigure(timer, (uint16_t)PPM_TIMER_PERIOD, PWM_TIMER_MHZ);
 
+#ifdef USE_RX_PWM_DMA
+    // the edges are decoded from the DMA ring by the RX task, which needs the timer's full 16 bit period
+    if (!ppmTimerSharedWithMotors(timer->tim) && pwmInputDmaConfig(port, OWNER_PPMINPUT, 0)) {
+        return;
+    }
+#endif
+
     timerChCCHandlerInit(&port->edgeCb, ppmEdgeCallback);
     timerChOvrHandlerInit(&port->overflowCb, ppmOverflowCallback);
     timerChConfigCallbacks(timer, &port->edgeCb, &port->overflowCb);
@@ -20,7 +20,7 @@
 
 #include "platform.h"
 
-#ifdef USE_SDCARD
+#if defined(USE_SDCARD) && !defined(USE_SDCARD_SDIO)
 
 #include "nvic.h"
 #include "io.h"
@@ -31,7 +31,7 @@
 #include "sdcard.h"
 #include "sdcard_standard.h"
 
-#ifdef AFATFS_USE_INTROSPECTIVE_LOGGING
+#if defined(AFATFS_USE_INTROSPECTIVE_LOGGING) || defined(USE_SDCARD_PROFILER)
     #define SDCARD_PROFILING
 #endif
 
@@ -44,6 +44,7 @@
 #define SDCARD_IF_COND_CHECK_PATTERN 0xAB
 
 #define SDCARD_TIMEOUT_INIT_MILLIS      200
+#define SDCARD_POWER_UP_MILLIS          1000
 #define SDCARD_MAX_CONSECUTIVE_FAILURES 8
 
 /* Break up 512-byte SD card sectors into chunks of this size when writing without DMA to reduce the peak overhead
@@ -57,6 +58,7 @@
 typedef enum {
     // In these states we run at the initialization 400kHz clockspeed:
     SDCARD_STATE_NOT_PRESENT = 0,
+    SDCARD_STATE_POWER_UP,
     SDCARD_STATE_RESET,
     SDCARD_STATE_CARD_INIT_IN_PROGRESS,
     SDCARD_STATE_INITIALIZATION_RECEIVE_CID,
@@ -565,9 +567,14 @@ void sdcard_init(bool useDMA)
     // Max frequency is initially 400kHz
     spiSetDivisor(SDCARD_SPI_INSTANCE, SDCARD_SPI_INITIALIZATION_CLOCK_DIVIDER);
 
-    // SDCard wants 1ms minimum delay after power is applied to it
-    delay(1000);
+    // SDCard wants 1ms minimum delay after power is applied to it, sdcard_poll() waits it out rather than the boot
+    sdcard.operationStartTime = millis();
+    sdcard.state = SDCARD_STATE_POWER_UP;
+    sdcard.failureCount = 0;
+}
 
+static void sdcard_powerUp(void)
+{
     // Transmit at least 74 dummy clock cycles with CS high so the SD card can start up
     SET_CS_HIGH;
 
@@ -585,7 +592,6 @@ void sdcard_init(bool useDMA)
 
     sdcard.operationStartTime = millis();
     sdcard.state = SDCARD_STATE_RESET;
-    sdcard.failureCount = 0;
 }
 
 static bool sdcard_setBlockLength(uint32_t blockLen)
@@ -654,6 +660,13 @@ bool sdcard_poll(void)
 
     doMore:
     switch (sdcard.state) {
+        case SDCARD_STATE_POWER_UP:
+            if (millis() - sdcard.operationStartTime >= SDCARD_POWER_UP_MILLIS) {
+                sdcard_powerUp();
+                goto doMore;
+            }
+        break;
+
         case SDCARD_STATE_RESET:
             sdcard_select();
 
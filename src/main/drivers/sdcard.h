@@ -22,6 +22,7 @@
 
 typedef struct sdcardConfig_s {
     uint8_t useDma;
+    uint8_t benchmark;      // Measure the card's write latency once at boot
 } sdcardConfig_t;
 
 typedef struct sdcardMetadata_s {
@@ -0,0 +1,1020 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SD card driver for the 4-bit SDIO (F4) / SDMMC (F7) peripheral. This provides the same interface as the SPI driver
+ * in sdcard.c, targets pick one or the other by defining USE_SDCARD_SDIO.
+ *
+ * Data blocks are moved between the peripheral and a private block buffer by DMA with the SDIO as the flow controller,
+ * so the caller's buffers don't need any particular alignment (or, on the F7, any cache maintenance).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_SDCARD_SDIO
+
+#include "common/utils.h"
+
+#include "io.h"
+#include "rcc.h"
+
+#include "system.h"
+
+#include "sdcard.h"
+#include "sdcard_standard.h"
+
+#if defined(AFATFS_USE_INTROSPECTIVE_LOGGING) || defined(USE_SDCARD_PROFILER)
+    #define SDCARD_PROFILING
+#endif
+
+#if defined(STM32F7)
+#define SDCARD_SDIO                     SDMMC1
+#define SDIO_BIT(name)                  SDMMC_ ## name
+#define SDCARD_SDIO_AF                  GPIO_AF12_SDMMC1
+#define SDCARD_SDIO_IO_CFG              IO_CONFIG(GPIO_MODE_AF_PP, GPIO_SPEED_FREQ_VERY_HIGH, GPIO_PULLUP)
+#define SDCARD_SDIO_CK_CFG              IO_CONFIG(GPIO_MODE_AF_PP, GPIO_SPEED_FREQ_VERY_HIGH, GPIO_NOPULL)
+// The SDMMC has no start bit error flag
+#define SDCARD_SDIO_STA_STBITERR        0
+#else
+#define SDCARD_SDIO                     SDIO
+#define SDIO_BIT(name)                  SDIO_ ## name
+#define SDCARD_SDIO_AF                  GPIO_AF_SDIO
+#define SDCARD_SDIO_IO_CFG              IO_CONFIG(GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_PP, GPIO_PuPd_UP)
+#define SDCARD_SDIO_CK_CFG              IO_CONFIG(GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_PP, GPIO_PuPd_NOPULL)
+#define SDCARD_SDIO_STA_STBITERR        SDIO_STA_STBITERR
+#endif
+
+// The SDIO has its own DMA request mapping, by default DMA2 stream 3 channel 4 (the alternative is stream 6 channel 4)
+#ifndef SDCARD_SDIO_DMA_STREAM
+#define SDCARD_SDIO_DMA_STREAM          DMA2_Stream3
+#define SDCARD_SDIO_DMA_CHANNEL         DMA_SxCR_CHSEL_2
+#define SDCARD_SDIO_DMA_ISR             (DMA2->LISR)
+#define SDCARD_SDIO_DMA_IFCR            (DMA2->LIFCR)
+#define SDCARD_SDIO_DMA_ERROR_FLAGS     (DMA_LISR_TEIF3 | DMA_LISR_DMEIF3)
+#define SDCARD_SDIO_DMA_CLEAR_FLAGS     (DMA_LIFCR_CFEIF3 | DMA_LIFCR_CDMEIF3 | DMA_LIFCR_CTEIF3 | DMA_LIFCR_CHTIF3 | DMA_LIFCR_CTCIF3)
+#endif
+
+// SDIO_CK = SDIOCLK (48MHz) / (CLKDIV + 2)
+#define SDCARD_SDIO_INITIALIZATION_CLOCK_DIVIDER 118 // 400kHz
+#define SDCARD_SDIO_FULL_SPEED_CLOCK_DIVIDER     0   // 24MHz, the fastest that Default Speed cards allow
+
+// Data timeout in SDIO_CK cycles at full speed, the longer of the write and read timeouts
+#define SDCARD_SDIO_DATA_TIMEOUT        (24000 * SDCARD_TIMEOUT_WRITE_MSEC)
+
+// Polls of the status register to wait for a command to complete. The peripheral times out by itself after 64 clocks.
+#define SDCARD_SDIO_COMMAND_TIMEOUT     100000
+
+#define SDCARD_SDIO_COMMAND_FLAGS       (SDIO_BIT(STA_CCRCFAIL) | SDIO_BIT(STA_CTIMEOUT) | SDIO_BIT(STA_CMDREND) | SDIO_BIT(STA_CMDSENT))
+#define SDCARD_SDIO_DATA_ERROR_FLAGS    (SDIO_BIT(STA_DCRCFAIL) | SDIO_BIT(STA_DTIMEOUT) | SDIO_BIT(STA_TXUNDERR) | SDIO_BIT(STA_RXOVERR) | SDCARD_SDIO_STA_STBITERR)
+#define SDCARD_SDIO_DATA_FLAGS          (SDCARD_SDIO_DATA_ERROR_FLAGS | SDIO_BIT(STA_DATAEND) | SDIO_BIT(STA_DBCKEND))
+
+// ACMD41 argument: we accept 2.7-3.6V and support high capacity cards
+#define SDCARD_SDIO_OCR_VOLTAGE_WINDOW  0x00FF8000
+#define SDCARD_SDIO_OCR_HIGH_CAPACITY   (1 << 30)
+#define SDCARD_SDIO_OCR_POWER_UP_DONE   (1U << 31)
+
+#define SDCARD_SDIO_IF_COND_CHECK_PATTERN 0xAA
+
+#define SDCARD_SDIO_ACMD6_BUS_WIDTH_4   2
+
+// Card status (R1 response) fields
+#define SDCARD_SDIO_STATUS_ERROR_BITS   0xFDF90008
+#define SDCARD_SDIO_STATUS_READY_FOR_DATA (1 << 8)
+#define SDCARD_SDIO_STATUS_STATE(status) (((status) >> 9) & 0x0F)
+#define SDCARD_SDIO_CARD_STATE_TRAN     4
+
+#define SDCARD_TIMEOUT_INIT_MILLIS      1000 // The card may take a full second to power up in response to ACMD41
+#define SDCARD_MAX_CONSECUTIVE_FAILURES 8
+
+#define STATIC_ASSERT(condition, name ) \
+    typedef char assert_failed_ ## name [(condition) ? 1 : -1 ]
+
+typedef enum {
+    // In these states we run at the initialization 400kHz clockspeed on a 1-bit bus:
+    SDCARD_STATE_NOT_PRESENT = 0,
+    SDCARD_STATE_RESET,
+    SDCARD_STATE_CARD_INIT_IN_PROGRESS,
+
+    // In these states we run at full clock speed on the 4-bit bus
+    SDCARD_STATE_READY,
+    SDCARD_STATE_READING,
+    SDCARD_STATE_SENDING_WRITE,
+    SDCARD_STATE_WAITING_FOR_WRITE,
+    SDCARD_STATE_WRITING_MULTIPLE_BLOCKS,
+    SDCARD_STATE_STOPPING_MULTIPLE_BLOCK_WRITE
+} sdcardState_e;
+
+typedef enum {
+    SDCARD_SDIO_RESPONSE_NONE,
+    SDCARD_SDIO_RESPONSE_SHORT,
+    SDCARD_SDIO_RESPONSE_SHORT_NO_CRC, // R3 (OCR) responses don't carry a valid CRC
+    SDCARD_SDIO_RESPONSE_LONG
+} sdcardSdioResponse_e;
+
+typedef struct sdcard_t {
+    struct {
+        uint8_t *buffer;
+        uint32_t blockIndex;
+
+        sdcard_operationCompleteCallback_c callback;
+        uint32_t callbackData;
+
+#ifdef SDCARD_PROFILING
+        uint32_t profileStartTime;
+#endif
+    } pendingOperation;
+
+    uint32_t operationStartTime;
+
+    uint8_t failureCount;
+
+    uint8_t version;
+    bool highCapacity;
+    uint16_t rca;
+
+    uint32_t multiWriteNextBlock;
+    uint32_t multiWriteBlocksRemain;
+
+    sdcardState_e state;
+
+    sdcardMetadata_t metadata;
+    sdcardCSD_t csd;
+
+#ifdef SDCARD_PROFILING
+    sdcard_profilerCallback_c profiler;
+#endif
+} sdcard_t;
+
+static sdcard_t sdcard;
+
+// Word aligned for the DMA, and cache line aligned so the F7 cache maintenance doesn't touch any neighbours
+static uint8_t sdcardBlockBuffer[SDCARD_BLOCK_SIZE] __attribute__((aligned(32)));
+
+STATIC_ASSERT(sizeof(sdcardCSD_t) == 16, sdcard_csd_bitfields_didnt_pack_properly);
+
+static const ioTag_t sdcardSdioDataPins[] = { IO_TAG(PC8), IO_TAG(PC9), IO_TAG(PC10), IO_TAG(PC11), IO_TAG(PD2) /* CMD */ };
+static const ioTag_t sdcardSdioClockPin = IO_TAG(PC12);
+
+#ifdef SDCARD_DETECT_PIN
+static IO_t sdCardDetectPin = IO_NONE;
+#endif
+
+void sdcardInsertionDetectDeinit(void)
+{
+#ifdef SDCARD_DETECT_PIN
+    sdCardDetectPin = IOGetByTag(IO_TAG(SDCARD_DETECT_PIN));
+    IOInit(sdCardDetectPin, OWNER_FREE, 0);
+    IOConfigGPIO(sdCardDetectPin, IOCFG_IN_FLOATING);
+#endif
+}
+
+void sdcardInsertionDetectInit(void)
+{
+#ifdef SDCARD_DETECT_PIN
+    sdCardDetectPin = IOGetByTag(IO_TAG(SDCARD_DETECT_PIN));
+    IOInit(sdCardDetectPin, OWNER_SDCARD_DETECT, 0);
+    IOConfigGPIO(sdCardDetectPin, IOCFG_IPU);
+#endif
+}
+
+/**
+ * Detect if a SD card is physically present in the memory slot.
+ */
+bool sdcard_isInserted(void)
+{
+    bool result = true;
+
+#ifdef SDCARD_DETECT_PIN
+
+    result = IORead(sdCardDetectPin) != 0;
+
+#ifdef SDCARD_DETECT_INVERTED
+    result = !result;
+#endif
+
+#endif
+
+    return result;
+}
+
+/**
+ * Returns true if the card has already been, or is currently, initializing and hasn't encountered enough errors to
+ * trip our error threshold and be disabled (i.e. our card is in and working!)
+ */
+bool sdcard_isFunctional(void)
+{
+    return sdcard.state != SDCARD_STATE_NOT_PRESENT;
+}
+
+static void sdcard_setBusClock(uint32_t divider, bool wideBus)
+{
+    SDCARD_SDIO->CLKCR = SDIO_BIT(CLKCR_CLKEN) | divider | (wideBus ? SDIO_BIT(CLKCR_WIDBUS_0) : 0);
+}
+
+/**
+ * Abandon any data transfer in progress on the SDIO and its DMA stream.
+ */
+static void sdcard_stopDataTransfer(void)
+{
+    SDCARD_SDIO->DCTRL = 0;
+
+    SDCARD_SDIO_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+    while (SDCARD_SDIO_DMA_STREAM->CR & DMA_SxCR_EN) {
+    }
+
+    SDCARD_SDIO_DMA_IFCR = SDCARD_SDIO_DMA_CLEAR_FLAGS;
+    SDCARD_SDIO->ICR = SDCARD_SDIO_DATA_FLAGS;
+}
+
+/**
+ * Handle a failure of an SD card operation by resetting the card back to its initialization phase.
+ *
+ * Increments the failure counter, and when the failure threshold is reached, disables the card until
+ * the next call to sdcard_init().
+ */
+static void sdcard_reset(void)
+{
+    sdcard_stopDataTransfer();
+
+    if (!sdcard_isInserted()) {
+        sdcard.state = SDCARD_STATE_NOT_PRESENT;
+        return;
+    }
+
+    if (sdcard.state >= SDCARD_STATE_READY) {
+        sdcard_setBusClock(SDCARD_SDIO_INITIALIZATION_CLOCK_DIVIDER, false);
+    }
+
+    sdcard.failureCount++;
+    if (sdcard.failureCount >= SDCARD_MAX_CONSECUTIVE_FAILURES) {
+        sdcard.state = SDCARD_STATE_NOT_PRESENT;
+    } else {
+        sdcard.operationStartTime = millis();
+        sdcard.state = SDCARD_STATE_RESET;
+    }
+}
+
+/**
+ * Send a command to the card and wait for the command path state machine to finish with it (a few microseconds at
+ * full speed, the data transfer that might follow runs in the background).
+ *
+ * Returns true if the card responded (when a response was expected) with an intact response to this command.
+ */
+static bool sdcard_sendCommand(uint8_t commandCode, uint32_t commandArgument, sdcardSdioResponse_e responseType)
+{
+    uint32_t command = commandCode | SDIO_BIT(CMD_CPSMEN);
+    uint32_t completionFlags;
+
+    switch (responseType) {
+        case SDCARD_SDIO_RESPONSE_NONE:
+            completionFlags = SDIO_BIT(STA_CMDSENT);
+        break;
+        case SDCARD_SDIO_RESPONSE_LONG:
+            command |= SDIO_BIT(CMD_WAITRESP_0) | SDIO_BIT(CMD_WAITRESP_1);
+            completionFlags = SDIO_BIT(STA_CMDREND) | SDIO_BIT(STA_CCRCFAIL) | SDIO_BIT(STA_CTIMEOUT);
+        break;
+        default:
+            command |= SDIO_BIT(CMD_WAITRESP_0);
+            completionFlags = SDIO_BIT(STA_CMDREND) | SDIO_BIT(STA_CCRCFAIL) | SDIO_BIT(STA_CTIMEOUT);
+    }
+
+    SDCARD_SDIO->ICR = SDCARD_SDIO_COMMAND_FLAGS;
+    SDCARD_SDIO->ARG = commandArgument;
+    SDCARD_SDIO->CMD = command;
+
+    uint32_t status;
+    int time = SDCARD_SDIO_COMMAND_TIMEOUT;
+
+    while (((status = SDCARD_SDIO->STA) & completionFlags) == 0) {
+        if (time-- == 0) {
+            return false;
+        }
+    }
+
+    SDCARD_SDIO->ICR = SDCARD_SDIO_COMMAND_FLAGS;
+
+    switch (responseType) {
+        case SDCARD_SDIO_RESPONSE_NONE:
+            return true;
+        case SDCARD_SDIO_RESPONSE_SHORT_NO_CRC:
+            return (status & SDIO_BIT(STA_CTIMEOUT)) == 0;
+        case SDCARD_SDIO_RESPONSE_LONG:
+            return (status & SDIO_BIT(STA_CMDREND)) != 0;
+        default:
+            return (status & SDIO_BIT(STA_CMDREND)) != 0 && SDCARD_SDIO->RESPCMD == commandCode;
+    }
+}
+
+/**
+ * Send a command that is answered with an R1 card status, returns true if the card reported no errors.
+ */
+static bool sdcard_sendCommandR1(uint8_t commandCode, uint32_t commandArgument)
+{
+    return sdcard_sendCommand(commandCode, commandArgument, SDCARD_SDIO_RESPONSE_SHORT)
+        && (SDCARD_SDIO->RESP1 & SDCARD_SDIO_STATUS_ERROR_BITS) == 0;
+}
+
+static bool sdcard_sendAppCommand(uint8_t commandCode, uint32_t commandArgument, sdcardSdioResponse_e responseType)
+{
+    return sdcard_sendCommandR1(SDCARD_COMMAND_APP_CMD, sdcard.rca << 16)
+        && sdcard_sendCommand(commandCode, commandArgument, responseType);
+}
+
+/**
+ * Copy the 128-bit response of the last command (CID or CSD, MSB first) into the given 16-byte buffer. The response
+ * carries bits 127-1 of the register (it has no trailer bit).
+ */
+static void sdcard_readLongResponse(uint8_t *buffer)
+{
+    const uint32_t response[4] = {SDCARD_SDIO->RESP1, SDCARD_SDIO->RESP2, SDCARD_SDIO->RESP3, SDCARD_SDIO->RESP4};
+
+    for (int i = 0; i < 4; i++) {
+        buffer[i * 4 + 0] = response[i] >> 24;
+        buffer[i * 4 + 1] = response[i] >> 16;
+        buffer[i * 4 + 2] = response[i] >> 8;
+        buffer[i * 4 + 3] = response[i];
+    }
+}
+
+/**
+ * Sends an IF_COND message to the card to check its version and validate its voltage requirements. Sets the global
+ * sdCardVersion with the detected version (0, 1, or 2) and returns true if the card is compatible.
+ */
+static bool sdcard_validateInterfaceCondition(void)
+{
+    sdcard.version = 0;
+
+    if (sdcard_sendCommand(SDCARD_COMMAND_SEND_IF_COND, (SDCARD_VOLTAGE_ACCEPTED_2_7_to_3_6 << 8) | SDCARD_SDIO_IF_COND_CHECK_PATTERN, SDCARD_SDIO_RESPONSE_SHORT)) {
+        // Check that it echoed back our check pattern properly
+        if ((SDCARD_SDIO->RESP1 & 0xFF) == SDCARD_SDIO_IF_COND_CHECK_PATTERN) {
+            sdcard.version = 2;
+        }
+    } else {
+        // V1 cards don't answer this command
+        sdcard.version = 1;
+    }
+
+    return sdcard.version > 0;
+}
+
+static bool sdcard_fetchCID(void)
+{
+    uint8_t cid[16];
+
+    if (!sdcard_sendCommand(SDCARD_COMMAND_ALL_SEND_CID, 0, SDCARD_SDIO_RESPONSE_LONG)) {
+        return false;
+    }
+
+    sdcard_readLongResponse(cid);
+
+    sdcard.metadata.manufacturerID = cid[0];
+    sdcard.metadata.oemID = (cid[1] << 8) | cid[2];
+    sdcard.metadata.productName[0] = cid[3];
+    sdcard.metadata.productName[1] = cid[4];
+    sdcard.metadata.productName[2] = cid[5];
+    sdcard.metadata.productName[3] = cid[6];
+    sdcard.metadata.productName[4] = cid[7];
+    sdcard.metadata.productRevisionMajor = cid[8] >> 4;
+    sdcard.metadata.productRevisionMinor = cid[8] & 0x0F;
+    sdcard.metadata.productSerial = (cid[9] << 24) | (cid[10] << 16) | (cid[11] << 8) | cid[12];
+    sdcard.metadata.productionYear = (((cid[13] & 0x0F) << 4) | (cid[14] >> 4)) + 2000;
+    sdcard.metadata.productionMonth = cid[14] & 0x0F;
+
+    return true;
+}
+
+static bool sdcard_fetchCSD(void)
+{
+    uint32_t readBlockLen, blockCount, blockCountMult;
+    uint64_t capacityBytes;
+
+    if (!sdcard_sendCommand(SDCARD_COMMAND_SEND_CSD, sdcard.rca << 16, SDCARD_SDIO_RESPONSE_LONG)) {
+        return false;
+    }
+
+    sdcard_readLongResponse(sdcard.csd.data);
+
+    switch (SDCARD_GET_CSD_FIELD(sdcard.csd, 1, CSD_STRUCTURE_VER)) {
+        case SDCARD_CSD_STRUCTURE_VERSION_1:
+            // Block size in bytes (doesn't have to be 512)
+            readBlockLen = 1 << SDCARD_GET_CSD_FIELD(sdcard.csd, 1, READ_BLOCK_LEN);
+            blockCountMult = 1 << (SDCARD_GET_CSD_FIELD(sdcard.csd, 1, CSIZE_MULT) + 2);
+            blockCount = (SDCARD_GET_CSD_FIELD(sdcard.csd, 1, CSIZE) + 1) * blockCountMult;
+
+            // We could do this in 32 bits but it makes the 2GB case awkward
+            capacityBytes = (uint64_t) blockCount * readBlockLen;
+
+            // Re-express that capacity (max 2GB) in our standard 512-byte block size
+            sdcard.metadata.numBlocks = capacityBytes / SDCARD_BLOCK_SIZE;
+        break;
+        case SDCARD_CSD_STRUCTURE_VERSION_2:
+            sdcard.metadata.numBlocks = (SDCARD_GET_CSD_FIELD(sdcard.csd, 2, CSIZE) + 1) * 1024;
+        break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Run the card identification and bus setup that follows the card's power-up: read its CID, have it publish an
+ * address, read the CSD, select it, then widen the bus to 4 bits and raise the clock.
+ */
+static bool sdcard_identifyCard(void)
+{
+    if (!sdcard_fetchCID()) {
+        return false;
+    }
+
+    if (!sdcard_sendCommand(SDCARD_COMMAND_SEND_RELATIVE_ADDR, 0, SDCARD_SDIO_RESPONSE_SHORT)) {
+        return false;
+    }
+    sdcard.rca = SDCARD_SDIO->RESP1 >> 16;
+
+    if (!sdcard_fetchCSD() || !sdcard_sendCommandR1(SDCARD_COMMAND_SELECT_CARD, sdcard.rca << 16)) {
+        return false;
+    }
+
+    if (!sdcard_sendAppCommand(SDCARD_ACOMMAND_SET_BUS_WIDTH, SDCARD_SDIO_ACMD6_BUS_WIDTH_4, SDCARD_SDIO_RESPONSE_SHORT)) {
+        return false;
+    }
+
+    /* The spec is a little iffy on what the default block size is for Standard Size cards (it can be changed on
+     * standard size cards) so let's just set it to 512 explicitly so we don't have a problem.
+     */
+    if (!sdcard.highCapacity && !sdcard_sendCommandR1(SDCARD_COMMAND_SET_BLOCKLEN, SDCARD_BLOCK_SIZE)) {
+        return false;
+    }
+
+    sdcard_setBusClock(SDCARD_SDIO_FULL_SPEED_CLOCK_DIVIDER, true);
+
+    return true;
+}
+
+/**
+ * Check if the SD Card has completed its startup sequence. Must be called with sdcard.state == SDCARD_STATE_CARD_INIT_IN_PROGRESS.
+ *
+ * Returns true if the card has finished its init process.
+ */
+static bool sdcard_checkInitDone(void)
+{
+    uint32_t argument = SDCARD_SDIO_OCR_VOLTAGE_WINDOW | (sdcard.version == 2 ? SDCARD_SDIO_OCR_HIGH_CAPACITY : 0);
+
+    if (!sdcard_sendAppCommand(SDCARD_ACOMMAND_SEND_OP_COND, argument, SDCARD_SDIO_RESPONSE_SHORT_NO_CRC)) {
+        return false;
+    }
+
+    uint32_t ocr = SDCARD_SDIO->RESP1;
+
+    if ((ocr & SDCARD_SDIO_OCR_POWER_UP_DONE) == 0) {
+        return false;
+    }
+
+    // Version 1 cards are always low-capacity
+    sdcard.highCapacity = sdcard.version == 2 && (ocr & SDCARD_SDIO_OCR_HIGH_CAPACITY) != 0;
+
+    return true;
+}
+
+/**
+ * Start moving one block between sdcardBlockBuffer and the card. Reads must be started before their command is sent
+ * and writes after it.
+ */
+static void sdcard_startDataTransfer(bool toCard)
+{
+    DMA_Stream_TypeDef *stream = SDCARD_SDIO_DMA_STREAM;
+
+    sdcard_stopDataTransfer();
+
+#if defined(STM32F7)
+    if (toCard) {
+        SCB_CleanDCache_by_Addr((uint32_t *) sdcardBlockBuffer, SDCARD_BLOCK_SIZE);
+    }
+#endif
+
+    stream->PAR = (uint32_t) &SDCARD_SDIO->FIFO;
+    stream->M0AR = (uint32_t) sdcardBlockBuffer;
+    stream->NDTR = 0; // The SDIO is the flow controller so this is ignored
+    stream->FCR = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH;
+    stream->CR = SDCARD_SDIO_DMA_CHANNEL | DMA_SxCR_MBURST_0 | DMA_SxCR_PBURST_0 | DMA_SxCR_PL
+        | DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1 | DMA_SxCR_MINC | DMA_SxCR_PFCTRL | (toCard ? DMA_SxCR_DIR_0 : 0);
+    stream->CR |= DMA_SxCR_EN;
+
+    SDCARD_SDIO->DTIMER = SDCARD_SDIO_DATA_TIMEOUT;
+    SDCARD_SDIO->DLEN = SDCARD_BLOCK_SIZE;
+    // 2^9 = 512 byte blocks
+    SDCARD_SDIO->DCTRL = SDIO_BIT(DCTRL_DBLOCKSIZE_0) | SDIO_BIT(DCTRL_DBLOCKSIZE_3) | SDIO_BIT(DCTRL_DMAEN)
+        | (toCard ? 0 : SDIO_BIT(DCTRL_DTDIR)) | SDIO_BIT(DCTRL_DTEN);
+}
+
+typedef enum {
+    SDCARD_TRANSFER_IN_PROGRESS,
+    SDCARD_TRANSFER_SUCCESS,
+    SDCARD_TRANSFER_ERROR
+} sdcardTransferStatus_e;
+
+static sdcardTransferStatus_e sdcard_checkDataTransfer(void)
+{
+    uint32_t status = SDCARD_SDIO->STA;
+
+    if ((status & SDCARD_SDIO_DATA_ERROR_FLAGS) || (SDCARD_SDIO_DMA_ISR & SDCARD_SDIO_DMA_ERROR_FLAGS)) {
+        return SDCARD_TRANSFER_ERROR;
+    }
+
+    // For reads, the DMA might still be emptying its FIFO into memory after the SDIO is done
+    if ((status & SDIO_BIT(STA_DATAEND)) == 0 || (SDCARD_SDIO_DMA_STREAM->CR & DMA_SxCR_EN)) {
+        return SDCARD_TRANSFER_IN_PROGRESS;
+    }
+
+    SDCARD_SDIO->ICR = SDCARD_SDIO_DATA_FLAGS;
+
+    return SDCARD_TRANSFER_SUCCESS;
+}
+
+/**
+ * Ask the card whether it has finished programming the last block it received.
+ *
+ * Returns:
+ *     SDCARD_OPERATION_SUCCESS     - The card is back in the transfer state and ready for the next command
+ *     SDCARD_OPERATION_IN_PROGRESS - The card is still busy
+ *     SDCARD_OPERATION_FAILURE     - The card didn't answer or reported an error
+ */
+static sdcardOperationStatus_e sdcard_checkProgrammingDone(void)
+{
+    if (!sdcard_sendCommand(SDCARD_COMMAND_SEND_STATUS, sdcard.rca << 16, SDCARD_SDIO_RESPONSE_SHORT)) {
+        return SDCARD_OPERATION_FAILURE;
+    }
+
+    uint32_t status = SDCARD_SDIO->RESP1;
+
+    if (status & SDCARD_SDIO_STATUS_ERROR_BITS) {
+        return SDCARD_OPERATION_FAILURE;
+    }
+
+    if (SDCARD_SDIO_STATUS_STATE(status) == SDCARD_SDIO_CARD_STATE_TRAN && (status & SDCARD_SDIO_STATUS_READY_FOR_DATA)) {
+        return SDCARD_OPERATION_SUCCESS;
+    }
+
+    return SDCARD_OPERATION_IN_PROGRESS;
+}
+
+/**
+ * Begin the initialization process for the SD card. This must be called first before any other sdcard_ routine.
+ */
+void sdcard_init(bool useDMA)
+{
+    // Transfers always use DMA
+    (void) useDMA;
+
+    for (unsigned i = 0; i < ARRAYLEN(sdcardSdioDataPins); i++) {
+        IO_t io = IOGetByTag(sdcardSdioDataPins[i]);
+        IOInit(io, OWNER_SDCARD, i);
+        IOConfigGPIOAF(io, SDCARD_SDIO_IO_CFG, SDCARD_SDIO_AF);
+    }
+
+    IO_t clockIO = IOGetByTag(sdcardSdioClockPin);
+    IOInit(clockIO, OWNER_SDCARD, ARRAYLEN(sdcardSdioDataPins));
+    IOConfigGPIOAF(clockIO, SDCARD_SDIO_CK_CFG, SDCARD_SDIO_AF);
+
+#if defined(STM32F7)
+    RCC_ClockCmd(RCC_APB2(SDMMC1), ENABLE);
+#else
+    RCC_ClockCmd(RCC_APB2(SDIO), ENABLE);
+#endif
+    RCC_ClockCmd(RCC_AHB1(DMA2), ENABLE);
+
+    sdcard_stopDataTransfer();
+
+    // Max frequency is initially 400kHz
+    sdcard_setBusClock(SDCARD_SDIO_INITIALIZATION_CLOCK_DIVIDER, false);
+
+    // SDCard wants 1ms minimum delay after power is applied to it
+    delay(1000);
+
+    // Running the clock gives the card the 74 cycles it needs to start up before the first command
+    SDCARD_SDIO->POWER = SDIO_BIT(POWER_PWRCTRL);
+    delay(2);
+
+    sdcard.rca = 0;
+    sdcard.operationStartTime = millis();
+    sdcard.state = SDCARD_STATE_RESET;
+    sdcard.failureCount = 0;
+}
+
+/*
+ * Returns true if the card is ready to accept read/write commands.
+ */
+static bool sdcard_isReady()
+{
+    return sdcard.state == SDCARD_STATE_READY || sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS;
+}
+
+/**
+ * Send the stop-transmission command to complete a multi-block write.
+ *
+ * Returns:
+ *     SDCARD_OPERATION_IN_PROGRESS - We're now waiting for that stop to complete, the card will enter
+ *                                    the SDCARD_STATE_STOPPING_MULTIPLE_BLOCK_WRITE state.
+ *     SDCARD_OPERATION_SUCCESS     - The multi-block write finished immediately, the card will enter
+ *                                    the SDCARD_READY state.
+ *
+ */
+static sdcardOperationStatus_e sdcard_endWriteBlocks()
+{
+    sdcard.multiWriteBlocksRemain = 0;
+
+    // A card that doesn't answer will be caught by the status polling that follows
+    sdcard_sendCommand(SDCARD_COMMAND_STOP_TRANSMISSION, 0, SDCARD_SDIO_RESPONSE_SHORT);
+
+    if (sdcard_checkProgrammingDone() == SDCARD_OPERATION_SUCCESS) {
+        sdcard.state = SDCARD_STATE_READY;
+        return SDCARD_OPERATION_SUCCESS;
+    } else {
+        sdcard.state = SDCARD_STATE_STOPPING_MULTIPLE_BLOCK_WRITE;
+        sdcard.operationStartTime = millis();
+
+        return SDCARD_OPERATION_IN_PROGRESS;
+    }
+}
+
+/**
+ * Call periodically for the SD card to perform in-progress transfers.
+ *
+ * Returns true if the card is ready to accept commands.
+ */
+bool sdcard_poll(void)
+{
+    sdcardOperationStatus_e programmingStatus;
+
+    doMore:
+    switch (sdcard.state) {
+        case SDCARD_STATE_RESET:
+            sdcard.rca = 0;
+
+            if (sdcard_sendCommand(SDCARD_COMMAND_GO_IDLE_STATE, 0, SDCARD_SDIO_RESPONSE_NONE)) {
+                // Check card voltage and version
+                if (sdcard_validateInterfaceCondition()) {
+                    sdcard.state = SDCARD_STATE_CARD_INIT_IN_PROGRESS;
+                    goto doMore;
+                } else {
+                    // Bad reply/voltage, we ought to refrain from accessing the card.
+                    sdcard.state = SDCARD_STATE_NOT_PRESENT;
+                }
+            }
+        break;
+
+        case SDCARD_STATE_CARD_INIT_IN_PROGRESS:
+            if (sdcard_checkInitDone()) {
+                if (sdcard_identifyCard()) {
+                    sdcard.multiWriteBlocksRemain = 0;
+
+                    sdcard.state = SDCARD_STATE_READY;
+                } else {
+                    sdcard_reset();
+                }
+                goto doMore;
+            }
+        break;
+        case SDCARD_STATE_SENDING_WRITE:
+            switch (sdcard_checkDataTransfer()) {
+                case SDCARD_TRANSFER_SUCCESS:
+                    if (sdcard.multiWriteBlocksRemain > 1) {
+                        // The card can take the next block of the chain as soon as it's ready for data again
+                        sdcard.multiWriteBlocksRemain--;
+                        sdcard.multiWriteNextBlock++;
+                        sdcard.state = SDCARD_STATE_WRITING_MULTIPLE_BLOCKS;
+                        sdcard.failureCount = 0;
+                    } else if (sdcard.multiWriteBlocksRemain == 1) {
+                        // This function changes the sd card state for us whether immediately succesful or delayed:
+                        sdcard_endWriteBlocks();
+                    } else {
+                        // The SD card is now busy committing that write to the card
+                        sdcard.state = SDCARD_STATE_WAITING_FOR_WRITE;
+                        sdcard.operationStartTime = millis();
+                    }
+
+#ifdef SDCARD_PROFILING
+                    if (sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS && sdcard.profiler) {
+                        sdcard.profiler(SDCARD_BLOCK_OPERATION_WRITE, sdcard.pendingOperation.blockIndex, micros() - sdcard.pendingOperation.profileStartTime);
+                    }
+#endif
+
+                    // The buffer has been transmitted so we can go ahead and tell the caller their operation is complete
+                    if (sdcard.pendingOperation.callback) {
+                        sdcard.pendingOperation.callback(SDCARD_BLOCK_OPERATION_WRITE, sdcard.pendingOperation.blockIndex, sdcard.pendingOperation.buffer, sdcard.pendingOperation.callbackData);
+                    }
+                break;
+                case SDCARD_TRANSFER_IN_PROGRESS:
+                    if (millis() <= sdcard.operationStartTime + SDCARD_TIMEOUT_WRITE_MSEC) {
+                        break; // Timeout not reached yet so keep waiting
+                    }
+                    // Timeout has expired, so fall through to convert to a fatal error
+
+                case SDCARD_TRANSFER_ERROR:
+                    /* Our write was rejected! This could be due to a bad address but we hope not to attempt that, so assume
+                     * the card is broken and needs reset.
+                     */
+                    sdcard_reset();
+
+                    // Announce write failure:
+                    if (sdcard.pendingOperation.callback) {
+                        sdcard.pendingOperation.callback(SDCARD_BLOCK_OPERATION_WRITE, sdcard.pendingOperation.blockIndex, NULL, sdcard.pendingOperation.callbackData);
+                    }
+
+                    goto doMore;
+            }
+        break;
+        case SDCARD_STATE_WAITING_FOR_WRITE:
+        case SDCARD_STATE_STOPPING_MULTIPLE_BLOCK_WRITE:
+            programmingStatus = sdcard_checkProgrammingDone();
+
+            if (programmingStatus == SDCARD_OPERATION_SUCCESS) {
+                sdcard.failureCount = 0; // Assume the card is good if it can complete a write
+
+                sdcard.state = SDCARD_STATE_READY;
+
+#ifdef SDCARD_PROFILING
+                if (sdcard.profiler) {
+                    sdcard.profiler(SDCARD_BLOCK_OPERATION_WRITE, sdcard.pendingOperation.blockIndex, micros() - sdcard.pendingOperation.profileStartTime);
+                }
+#endif
+            } else if (programmingStatus == SDCARD_OPERATION_FAILURE || millis() > sdcard.operationStartTime + SDCARD_TIMEOUT_WRITE_MSEC) {
+                /*
+                 * The caller has already been told that their write has completed, so they will have discarded
+                 * their buffer and have no hope of retrying the operation. But this should be very rare and it allows
+                 * them to reuse their buffer milliseconds faster than they otherwise would.
+                 */
+                sdcard_reset();
+                goto doMore;
+            }
+        break;
+        case SDCARD_STATE_READING:
+            switch (sdcard_checkDataTransfer()) {
+                case SDCARD_TRANSFER_SUCCESS:
+#if defined(STM32F7)
+                    SCB_InvalidateDCache_by_Addr((uint32_t *) sdcardBlockBuffer, SDCARD_BLOCK_SIZE);
+#endif
+                    memcpy(sdcard.pendingOperation.buffer, sdcardBlockBuffer, SDCARD_BLOCK_SIZE);
+
+                    sdcard.state = SDCARD_STATE_READY;
+                    sdcard.failureCount = 0; // Assume the card is good if it can complete a read
+
+#ifdef SDCARD_PROFILING
+                    if (sdcard.profiler) {
+                        sdcard.profiler(SDCARD_BLOCK_OPERATION_READ, sdcard.pendingOperation.blockIndex, micros() - sdcard.pendingOperation.profileStartTime);
+                    }
+#endif
+
+                    if (sdcard.pendingOperation.callback) {
+                        sdcard.pendingOperation.callback(
+                            SDCARD_BLOCK_OPERATION_READ,
+                            sdcard.pendingOperation.blockIndex,
+                            sdcard.pendingOperation.buffer,
+                            sdcard.pendingOperation.callbackData
+                        );
+                    }
+                break;
+                case SDCARD_TRANSFER_IN_PROGRESS:
+                    if (millis() <= sdcard.operationStartTime + SDCARD_TIMEOUT_READ_MSEC) {
+                        break; // Timeout not reached yet so keep waiting
+                    }
+                    // Timeout has expired, so fall through to convert to a fatal error
+
+                case SDCARD_TRANSFER_ERROR:
+                    sdcard_reset();
+
+                    if (sdcard.pendingOperation.callback) {
+                        sdcard.pendingOperation.callback(
+                            SDCARD_BLOCK_OPERATION_READ,
+                            sdcard.pendingOperation.blockIndex,
+                            NULL,
+                            sdcard.pendingOperation.callbackData
+                        );
+                    }
+
+                    goto doMore;
+            }
+        break;
+        case SDCARD_STATE_NOT_PRESENT:
+        default:
+            ;
+    }
+
+    // Is the card's initialization taking too long?
+    if (sdcard.state >= SDCARD_STATE_RESET && sdcard.state < SDCARD_STATE_READY
+            && millis() - sdcard.operationStartTime > SDCARD_TIMEOUT_INIT_MILLIS) {
+        sdcard_reset();
+    }
+
+    return sdcard_isReady();
+}
+
+/**
+ * Write the 512-byte block from the given buffer into the block with the given index.
+ *
+ * If the write does not complete immediately, your callback will be called later. If the write was successful, the
+ * buffer pointer will be the same buffer you originally passed in, otherwise the buffer will be set to NULL.
+ *
+ * Returns:
+ *     SDCARD_OPERATION_IN_PROGRESS - Your buffer is currently being transmitted to the card and your callback will be
+ *                                    called later to report the completion. The buffer pointer must remain valid until
+ *                                    that time.
+ *     SDCARD_OPERATION_BUSY        - The card is already busy and cannot accept your write
+ *     SDCARD_OPERATION_FAILURE     - Your write was rejected by the card, card will be reset
+ */
+sdcardOperationStatus_e sdcard_writeBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    uint32_t status;
+
+#ifdef SDCARD_PROFILING
+    sdcard.pendingOperation.profileStartTime = micros();
+#endif
+
+    doMore:
+    switch (sdcard.state) {
+        case SDCARD_STATE_WRITING_MULTIPLE_BLOCKS:
+            // Do we need to cancel the previous multi-block write?
+            if (blockIndex != sdcard.multiWriteNextBlock) {
+                if (sdcard_endWriteBlocks() == SDCARD_OPERATION_SUCCESS) {
+                    // Now we've entered the ready state, we can try again
+                    goto doMore;
+                } else {
+                    return SDCARD_OPERATION_BUSY;
+                }
+            }
+
+            // We're continuing a multi-block write, once the card has finished programming the previous block
+            if (!sdcard_sendCommand(SDCARD_COMMAND_SEND_STATUS, sdcard.rca << 16, SDCARD_SDIO_RESPONSE_SHORT)) {
+                sdcard_reset();
+
+                return SDCARD_OPERATION_FAILURE;
+            }
+
+            status = SDCARD_SDIO->RESP1;
+
+            if ((status & SDCARD_SDIO_STATUS_READY_FOR_DATA) == 0) {
+                return SDCARD_OPERATION_BUSY;
+            }
+        break;
+        case SDCARD_STATE_READY:
+            // We're not continuing a multi-block write so we need to send a single-block write command
+            // Standard size cards use byte addressing, high capacity cards use block addressing
+            if (!sdcard_sendCommandR1(SDCARD_COMMAND_WRITE_BLOCK, sdcard.highCapacity ? blockIndex : blockIndex * SDCARD_BLOCK_SIZE)) {
+                sdcard_reset();
+
+                return SDCARD_OPERATION_FAILURE;
+            }
+        break;
+        default:
+            return SDCARD_OPERATION_BUSY;
+    }
+
+    memcpy(sdcardBlockBuffer, buffer, SDCARD_BLOCK_SIZE);
+
+    sdcard_startDataTransfer(true);
+
+    sdcard.pendingOperation.buffer = buffer;
+    sdcard.pendingOperation.blockIndex = blockIndex;
+    sdcard.pendingOperation.callback = callback;
+    sdcard.pendingOperation.callbackData = callbackData;
+    sdcard.operationStartTime = millis();
+    sdcard.state = SDCARD_STATE_SENDING_WRITE;
+
+    return SDCARD_OPERATION_IN_PROGRESS;
+}
+
+/**
+ * Begin writing a series of consecutive blocks beginning at the given block index. This will allow (but not require)
+ * the SD card to pre-erase the number of blocks you specifiy, which can allow the writes to complete faster.
+ *
+ * Afterwards, just call sdcard_writeBlock() as normal to write those blocks consecutively.
+ *
+ * It's okay to abort the multi-block write at any time by writing to a non-consecutive address, or by performing a read.
+ *
+ * Returns:
+ *     SDCARD_OPERATION_SUCCESS     - Multi-block write has been queued
+ *     SDCARD_OPERATION_BUSY        - The card is already busy and cannot accept your write
+ *     SDCARD_OPERATION_FAILURE     - A fatal error occured, card will be reset
+ */
+sdcardOperationStatus_e sdcard_beginWriteBlocks(uint32_t blockIndex, uint32_t blockCount)
+{
+    if (sdcard.state != SDCARD_STATE_READY) {
+        if (sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS) {
+            if (blockIndex == sdcard.multiWriteNextBlock) {
+                // Assume that the caller wants to continue the multi-block write they already have in progress!
+                return SDCARD_OPERATION_SUCCESS;
+            } else if (sdcard_endWriteBlocks() != SDCARD_OPERATION_SUCCESS) {
+                return SDCARD_OPERATION_BUSY;
+            } // Else we've completed the previous multi-block write and can fall through to start the new one
+        } else {
+            return SDCARD_OPERATION_BUSY;
+        }
+    }
+
+    if (
+        sdcard_sendAppCommand(SDCARD_ACOMMAND_SET_WR_BLOCK_ERASE_COUNT, blockCount, SDCARD_SDIO_RESPONSE_SHORT)
+        && sdcard_sendCommandR1(SDCARD_COMMAND_WRITE_MULTIPLE_BLOCK, sdcard.highCapacity ? blockIndex : blockIndex * SDCARD_BLOCK_SIZE)
+    ) {
+        sdcard.state = SDCARD_STATE_WRITING_MULTIPLE_BLOCKS;
+        sdcard.multiWriteBlocksRemain = blockCount;
+        sdcard.multiWriteNextBlock = blockIndex;
+
+        return SDCARD_OPERATION_SUCCESS;
+    } else {
+        sdcard_reset();
+
+        return SDCARD_OPERATION_FAILURE;
+    }
+}
+
+/**
+ * Read the 512-byte block with the given index into the given 512-byte buffer.
+ *
+ * When the read completes, your callback will be called. If the read was successful, the buffer pointer will be the
+ * same buffer you originally passed in, otherwise the buffer will be set to NULL.
+ *
+ * You must keep the pointer to the buffer valid until the operation completes!
+ *
+ * Returns:
+ *     true - The operation was successfully queued for later completion, your callback will be called later
+ *     false - The operation could not be started due to the card being busy (try again later).
+ */
+bool sdcard_readBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (sdcard.state != SDCARD_STATE_READY) {
+        if (sdcard.state == SDCARD_STATE_WRITING_MULTIPLE_BLOCKS) {
+            if (sdcard_endWriteBlocks() != SDCARD_OPERATION_SUCCESS) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+#ifdef SDCARD_PROFILING
+    sdcard.pendingOperation.profileStartTime = micros();
+#endif
+
+    sdcard_startDataTransfer(false);
+
+    // Standard size cards use byte addressing, high capacity cards use block addressing
+    if (sdcard_sendCommandR1(SDCARD_COMMAND_READ_SINGLE_BLOCK, sdcard.highCapacity ? blockIndex : blockIndex * SDCARD_BLOCK_SIZE)) {
+        sdcard.pendingOperation.buffer = buffer;
+        sdcard.pendingOperation.blockIndex = blockIndex;
+        sdcard.pendingOperation.callback = callback;
+        sdcard.pendingOperation.callbackData = callbackData;
+
+        sdcard.state = SDCARD_STATE_READING;
+
+        sdcard.operationStartTime = millis();
+
+        return true;
+    } else {
+        sdcard_stopDataTransfer();
+
+        return false;
+    }
+}
+
+/**
+ * Returns true if the SD card has successfully completed its startup procedures.
+ */
+bool sdcard_isInitialized(void)
+{
+    return sdcard.state >= SDCARD_STATE_READY;
+}
+
+const sdcardMetadata_t* sdcard_getMetadata(void)
+{
+    return &sdcard.metadata;
+}
+
+#ifdef SDCARD_PROFILING
+
+void sdcard_setProfilerCallback(sdcard_profilerCallback_c callback)
+{
+    sdcard.profiler = callback;
+}
+
+#endif
+
+#endif
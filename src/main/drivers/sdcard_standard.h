@@ -217,6 +217,9 @@ typedef struct sdcardCSD_t {
 
 #define SDCARD_COMMAND_GO_IDLE_STATE             0
 #define SDCARD_COMMAND_SEND_OP_COND              1
+#define SDCARD_COMMAND_ALL_SEND_CID              2
+#define SDCARD_COMMAND_SEND_RELATIVE_ADDR        3
+#define SDCARD_COMMAND_SELECT_CARD               7
 #define SDCARD_COMMAND_SEND_IF_COND              8
 #define SDCARD_COMMAND_SEND_CSD                  9
 #define SDCARD_COMMAND_SEND_CID                  10
@@ -230,6 +233,7 @@ typedef struct sdcardCSD_t {
 #define SDCARD_COMMAND_APP_CMD                   55
 #define SDCARD_COMMAND_READ_OCR                  58
 
+#define SDCARD_ACOMMAND_SET_BUS_WIDTH            6
 #define SDCARD_ACOMMAND_SEND_OP_COND             41
 #define SDCARD_ACOMMAND_SET_WR_BLOCK_ERASE_COUNT 23
 
@@ -102,3 +102,44 @@ void serialEndWrite(serialPort_t *instance)
     if (instance->vTable->endWrite)
         instance->vTable->endWrite(instance);
 }
+
+/*
+ * Views the waiting RX bytes in place in the port's ring, so a frame can be decoded without copying it out first.
+ * Nothing leaves the ring until serialRxConsume(), a partial frame can be left there for the next call. Returns false
+ * for ports without a ring, such as USB VCP.
+ */
+bool serialRxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    if (!instance->vTable->rxView) {
+        return false;
+    }
+    instance->vTable->rxView(instance, view);
+    return true;
+}
+
+void serialRxConsume(serialPort_t *instance, uint32_t count)
+{
+    if (instance->vTable->rxConsume) {
+        instance->vTable->rxConsume(instance, count);
+    } else {
+        while (count--) {
+            serialRead(instance);
+        }
+    }
+}
+
+// Views the free TX space in place, to encode a frame straight into the ring. Returns false for ports without a ring.
+bool serialTxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    if (!instance->vTable->txView) {
+        return false;
+    }
+    instance->vTable->txView(instance, view);
+    return true;
+}
+
+// queues count bytes written through serialTxView() and starts sending them
+void serialTxCommit(serialPort_t *instance, uint32_t count)
+{
+    instance->vTable->txCommit(instance, count);
+}
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "common/streambuf.h"
+
 typedef enum portMode_t {
     MODE_RX = 1 << 0,
     MODE_TX = 1 << 1,
@@ -41,7 +43,12 @@ typedef enum portOptions_t {
      * to actual data bytes.
      */
     SERIAL_BIDIR_OD      = 0 << 4,
-    SERIAL_BIDIR_PP      = 1 << 4
+    SERIAL_BIDIR_PP      = 1 << 4,
+    /*
+     * Transmit only while the CTS input is held low by the other end. Ignored by ports that have no CTS pin, see
+     * UARTx_CTS_PIN.
+     */
+    SERIAL_FLOW_CTS      = 1 << 5
 } portOptions_t;
 
 typedef void (*serialReceiveCallbackPtr)(uint16_t data);   // used by serial drivers to return frames to app
@@ -87,6 +94,12 @@ struct serialPortVTable {
     // Optional functions used to buffer large writes.
     void (*beginWrite)(serialPort_t *instance);
     void (*endWrite)(serialPort_t *instance);
+
+    // Optional in place access to the RX and TX rings.
+    void (*rxView)(const serialPort_t *instance, sbufRing_t *view);
+    void (*rxConsume)(serialPort_t *instance, uint32_t count);
+    void (*txView)(const serialPort_t *instance, sbufRing_t *view);
+    void (*txCommit)(serialPort_t *instance, uint32_t count);
 };
 
 void serialWrite(serialPort_t *instance, uint8_t ch);
@@ -104,3 +117,8 @@ uint32_t serialGetBaudRate(serialPort_t *instance);
 void serialWriteBufShim(void *instance, const uint8_t *data, int count);
 void serialBeginWrite(serialPort_t *instance);
 void serialEndWrite(serialPort_t *instance);
+
+bool serialRxView(const serialPort_t *instance, sbufRing_t *view);
+void serialRxConsume(serialPort_t *instance, uint32_t count);
+bool serialTxView(const serialPort_t *instance, sbufRing_t *view);
+void serialTxCommit(serialPort_t *instance, uint32_t count);
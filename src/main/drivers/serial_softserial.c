@@ -70,6 +70,7 @@ typedef struct softSerial_s {
     uint16_t         receiveErrors;
 
     uint8_t          softSerialPortIndex;
+    volatile uint8_t isBitTimerEnabled;
 
     timerCCHandlerRec_t timerCb;
     timerCCHandlerRec_t edgeCb;
@@ -164,6 +165,30 @@ static void serialTimerRxConfig(const timerHardware_t *timerHardwarePtr, uint8_t
     timerChConfigCallbacks(timerHardwarePtr, &softSerialPorts[reference].edgeCb, NULL);
 }
 
+/*
+ * The bit timer only needs to tick while a byte is being shifted in or out.
+ * Leaving it running on an idle port costs one interrupt per bit period, so
+ * it is stopped from the timer callback once both directions are idle and
+ * restarted by a write or by the edge of a start bit.
+ * While bytes are being received it still ticks once per bit: RX and TX share
+ * the timer, whose period is one bit, so an edge capture alone can't tell how
+ * many bits have passed since the start bit.
+ */
+static void bitTimerStart(softSerial_t *softSerial)
+{
+    if (!softSerial->isBitTimerEnabled) {
+        softSerial->isBitTimerEnabled = true;
+        timerChClearCCFlag(softSerial->txTimerHardware);
+        timerChITConfig(softSerial->txTimerHardware, ENABLE);
+    }
+}
+
+static void bitTimerStop(softSerial_t *softSerial)
+{
+    softSerial->isBitTimerEnabled = false;
+    timerChITConfig(softSerial->txTimerHardware, DISABLE);
+}
+
 static void resetBuffers(softSerial_t *softSerial)
 {
     softSerial->port.rxBufferSize = SOFTSERIAL_BUFFER_SIZE;
@@ -225,6 +250,9 @@ serialPort_t *openSoftSerial(softSerialPortIndex_e portIndex, serialReceiveCallb
     serialTimerTxConfig(softSerial->txTimerHardware, portIndex, baud);
     serialTimerRxConfig(softSerial->rxTimerHardware, portIndex, options);
 
+    // nothing to shift yet, wait for a write or a start bit
+    bitTimerStop(softSerial);
+
     return &softSerial->port;
 }
 
@@ -354,6 +382,10 @@ void onSerialTimer(timerCCHandlerRec_t *cbRec, captureCompare_t capture)
 
     processTxState(softSerial);
     processRxState(softSerial);
+
+    if (!softSerial->isTransmittingData && softSerial->isSearchingForStartBit && isSoftSerialTransmitBufferEmpty((serialPort_t *)softSerial)) {
+        bitTimerStop(softSerial);
+    }
 }
 
 void onSerialRxPinChange(timerCCHandlerRec_t *cbRec, captureCompare_t capture)
@@ -375,6 +407,7 @@ void onSerialRxPinChange(timerCCHandlerRec_t *cbRec, captureCompare_t capture)
         if (softSerial->isTransmittingData) {
             softSerial->transmissionErrors++;
         }
+        bitTimerStart(softSerial);
 
         serialICConfig(softSerial->rxTimerHardware->tim, softSerial->rxTimerHardware->channel, inverted ? TIM_ICPolarity_Falling : TIM_ICPolarity_Rising);
         softSerial->rxEdge = LEADING;
@@ -450,6 +483,10 @@ void softSerialWriteByte(serialPort_t *s, uint8_t ch)
 
     s->txBuffer[s->txBufferHead] = ch;
     s->txBufferHead = (s->txBufferHead + 1) % s->txBufferSize;
+
+    ATOMIC_BLOCK(NVIC_PRIO_TIMER) {
+        bitTimerStart((softSerial_t *)s);
+    }
 }
 
 void softSerialSetBaudRate(serialPort_t *s, uint32_t baudRate)
@@ -468,6 +505,30 @@ bool isSoftSerialTransmitBufferEmpty(const serialPort_t *instance)
     return instance->txBufferHead == instance->txBufferTail;
 }
 
+static void softSerialRxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    sbufRingInit(view, (uint8_t *)instance->rxBuffer, instance->rxBufferSize, instance->rxBufferTail, softSerialRxBytesWaiting(instance));
+}
+
+static void softSerialRxConsume(serialPort_t *instance, uint32_t count)
+{
+    instance->rxBufferTail = (instance->rxBufferTail + count) % instance->rxBufferSize;
+}
+
+static void softSerialTxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    sbufRingInit(view, (uint8_t *)instance->txBuffer, instance->txBufferSize, instance->txBufferHead, softSerialTxBytesFree(instance));
+}
+
+static void softSerialTxCommit(serialPort_t *instance, uint32_t count)
+{
+    instance->txBufferHead = (instance->txBufferHead + count) % instance->txBufferSize;
+
+    ATOMIC_BLOCK(NVIC_PRIO_TIMER) {
+        bitTimerStart((softSerial_t *)instance);
+    }
+}
+
 const struct serialPortVTable softSerialVTable[] = {
     {
         .serialWrite = softSerialWriteByte,
@@ -479,7 +540,11 @@ const struct serialPortVTable softSerialVTable[] = {
         .setMode = softSerialSetMode,
         .writeBuf = NULL,
         .beginWrite = NULL,
-        .endWrite = NULL
+        .endWrite = NULL,
+        .rxView = softSerialRxView,
+        .rxConsume = softSerialRxConsume,
+        .txView = softSerialTxView,
+        .txCommit = softSerialTxCommit,
     }
 };
 
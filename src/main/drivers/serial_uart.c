@@ -22,14 +22,17 @@
 */
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "platform.h"
 
 #include "build/build_config.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 #include "gpio.h"
 #include "inverter.h"
+#include "memory_report.h"
 
 #include "serial.h"
 #include "serial_uart.h"
@@ -81,7 +84,7 @@ static void uartReconfigure(uartPort_t *uartPort)
     USART_InitStructure.USART_StopBits = (uartPort->port.options & SERIAL_STOPBITS_2) ? USART_StopBits_2 : USART_StopBits_1;
     USART_InitStructure.USART_Parity   = (uartPort->port.options & SERIAL_PARITY_EVEN) ? USART_Parity_Even : USART_Parity_No;
 
-    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+    USART_InitStructure.USART_HardwareFlowControl = uartPort->txFlowControl ? USART_HardwareFlowControl_CTS : USART_HardwareFlowControl_None;
     USART_InitStructure.USART_Mode = 0;
     if (uartPort->port.mode & MODE_RX)
         USART_InitStructure.USART_Mode |= USART_Mode_Rx;
@@ -134,12 +137,16 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr rxCallbac
     } else {
         return (serialPort_t *)s;
     }
+    if (!s) {
+        // No buffers left for the port
+        return NULL;
+    }
     s->txDMAEmpty = true;
 
     // common serial initialisation code should move to serialPort::init()
     s->port.rxBufferHead = s->port.rxBufferTail = 0;
     s->port.txBufferHead = s->port.txBufferTail = 0;
-    // callback works for IRQ-based RX ONLY
+    // With RX DMA the callback is run from the idle line and DMA transfer interrupts (F4 only)
     s->port.rxCallback = rxCallback;
     s->port.mode = mode;
     s->port.baudRate = baudRate;
@@ -175,6 +182,7 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr rxCallbac
             DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
 #endif
             DMA_InitStructure.DMA_BufferSize = s->port.rxBufferSize;
+            memoryReportDmaBuffer(OWNER_SERIAL_RX, s->port.rxBuffer, s->port.rxBufferSize);
 
 #ifdef STM32F4
             DMA_InitStructure.DMA_Channel = s->rxDMAChannel;
@@ -183,6 +191,13 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr rxCallbac
             DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)s->port.rxBuffer;
             DMA_DeInit(s->rxDMAStream);
             DMA_Init(s->rxDMAStream, &DMA_InitStructure);
+            if (rxCallback) {
+                // Hand received bytes over whenever the line goes idle after a frame, and as the ring wraps
+                DMA_ITConfig(s->rxDMAStream, DMA_IT_HT | DMA_IT_TC, ENABLE);
+                USART_ITConfig(s->USARTx, USART_IT_IDLE, ENABLE);
+            } else {
+                USART_ITConfig(s->USARTx, USART_IT_IDLE, DISABLE);
+            }
             DMA_Cmd(s->rxDMAStream, ENABLE);
             USART_DMACmd(s->USARTx, USART_DMAReq_Rx, ENABLE);
             s->rxDMAPos = DMA_GetCurrDataCounter(s->rxDMAStream);
@@ -229,6 +244,7 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr rxCallbac
             DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
 #endif
             DMA_InitStructure.DMA_BufferSize = s->port.txBufferSize;
+            memoryReportDmaBuffer(OWNER_SERIAL_TX, s->port.txBuffer, s->port.txBufferSize);
 
 #ifdef STM32F4
             DMA_InitStructure.DMA_Channel = s->txDMAChannel;
@@ -302,6 +318,29 @@ void uartStartTxDMA(uartPort_t *s)
 #endif
 }
 
+#ifdef STM32F4
+/*
+ * Pass everything the RX DMA has stored since the last call to the port's receive callback. Called from interrupts
+ * once per received frame (idle line) or half buffer, rather than once per byte as in IRQ-based RX.
+ */
+void uartRxDMADispatch(uartPort_t *s)
+{
+    // the callback may have been detached, e.g. by serial passthrough, in
+    // which case the bytes stay in the ring for uartRead()
+    if (!s->port.rxCallback) {
+        return;
+    }
+
+    const uint32_t rxDMAHead = s->rxDMAStream->NDTR;
+
+    while (s->rxDMAPos != rxDMAHead) {
+        s->port.rxCallback(s->port.rxBuffer[s->port.rxBufferSize - s->rxDMAPos]);
+        if (--s->rxDMAPos == 0)
+            s->rxDMAPos = s->port.rxBufferSize;
+    }
+}
+#endif
+
 uint32_t uartTotalRxBytesWaiting(const serialPort_t *instance)
 {
     const uartPort_t *s = (const uartPort_t*)instance;
@@ -407,6 +446,22 @@ uint8_t uartRead(serialPort_t *instance)
     return ch;
 }
 
+// Get newly queued bytes moving, unless a transfer is already under way
+static void uartStartTx(uartPort_t *s)
+{
+#ifdef STM32F4
+    if (s->txDMAStream) {
+        if (!(s->txDMAStream->CR & 1))
+#else
+    if (s->txDMAChannel) {
+        if (!(s->txDMAChannel->CCR & 1))
+#endif
+            uartStartTxDMA(s);
+    } else {
+        USART_ITConfig(s->USARTx, USART_IT_TXE, ENABLE);
+    }
+}
+
 void uartWrite(serialPort_t *instance, uint8_t ch)
 {
     uartPort_t *s = (uartPort_t *)instance;
@@ -417,19 +472,84 @@ void uartWrite(serialPort_t *instance, uint8_t ch)
         s->port.txBufferHead++;
     }
 
+    uartStartTx(s);
+}
+
+/*
+ * Copy a whole buffer into the TX ring with memcpy and start transmission once, instead of a ring update and DMA
+ * check per byte. Like the byte-wise fallback in serialWriteBuf(), this waits for room if the ring fills up.
+ */
+void uartWriteBuf(serialPort_t *instance, const void *data, int count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+    const uint8_t *p = data;
+
+    while (count > 0) {
+        uint32_t space;
+
+        while ((space = uartTotalTxBytesFree(instance)) == 0) {
+        };
+
+        const uint32_t len = MIN(space, (uint32_t)count);
+        const uint32_t firstChunk = MIN(len, s->port.txBufferSize - s->port.txBufferHead);
+
+        memcpy((uint8_t *)&s->port.txBuffer[s->port.txBufferHead], p, firstChunk);
+        memcpy((uint8_t *)s->port.txBuffer, p + firstChunk, len - firstChunk);
+        s->port.txBufferHead = (s->port.txBufferHead + len) % s->port.txBufferSize;
+
+        p += len;
+        count -= len;
+
+        uartStartTx(s);
+    }
+}
+
+// the oldest waiting byte is at the DMA read position, or the ring tail when bytes are received by interrupt
+static void uartRxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    const uartPort_t *s = (const uartPort_t *)instance;
+    uint32_t start;
+
 #ifdef STM32F4
-    if (s->txDMAStream) {
-        if (!(s->txDMAStream->CR & 1))
+    if (s->rxDMAStream) {
 #else
-    if (s->txDMAChannel) {
-        if (!(s->txDMAChannel->CCR & 1))
+    if (s->rxDMAChannel) {
 #endif
-            uartStartTxDMA(s);
+        start = s->port.rxBufferSize - s->rxDMAPos;
     } else {
-        USART_ITConfig(s->USARTx, USART_IT_TXE, ENABLE);
+        start = s->port.rxBufferTail;
+    }
+    sbufRingInit(view, (uint8_t *)s->port.rxBuffer, s->port.rxBufferSize, start, uartTotalRxBytesWaiting(instance));
+}
+
+static void uartRxConsume(serialPort_t *instance, uint32_t count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+
+#ifdef STM32F4
+    if (s->rxDMAStream) {
+#else
+    if (s->rxDMAChannel) {
+#endif
+        const uint32_t next = (s->port.rxBufferSize - s->rxDMAPos + count) % s->port.rxBufferSize;
+        s->rxDMAPos = s->port.rxBufferSize - next;
+    } else {
+        s->port.rxBufferTail = (s->port.rxBufferTail + count) % s->port.rxBufferSize;
     }
 }
 
+static void uartTxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    sbufRingInit(view, (uint8_t *)instance->txBuffer, instance->txBufferSize, instance->txBufferHead, uartTotalTxBytesFree(instance));
+}
+
+static void uartTxCommit(serialPort_t *instance, uint32_t count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+    s->port.txBufferHead = (s->port.txBufferHead + count) % s->port.txBufferSize;
+    uartStartTx(s);
+}
+
 const struct serialPortVTable uartVTable[] = {
     {
         .serialWrite = uartWrite,
@@ -439,8 +559,12 @@ const struct serialPortVTable uartVTable[] = {
         .serialSetBaudRate = uartSetBaudRate,
         .isSerialTransmitBufferEmpty = isUartTransmitBufferEmpty,
         .setMode = uartSetMode,
-        .writeBuf = NULL,
+        .writeBuf = uartWriteBuf,
         .beginWrite = NULL,
         .endWrite = NULL,
+        .rxView = uartRxView,
+        .rxConsume = uartRxConsume,
+        .txView = uartTxView,
+        .txCommit = uartTxCommit,
     }
 };
@@ -17,28 +17,18 @@
 
 #pragma once
 
-// Since serial ports can be used for any function these buffer sizes should be equal
-// The two largest things that need to be sent are: 1, MSP responses, 2, UBLOX SVINFO packet.
-
-// Size must be a power of two due to various optimizations which use 'and' instead of 'mod'
-// Various serial routines return the buffer occupied size as uint8_t which would need to be extended in order to
-// increase size further.
-#define UART1_RX_BUFFER_SIZE    256
-#define UART1_TX_BUFFER_SIZE    256
-#define UART2_RX_BUFFER_SIZE    256
-#define UART2_TX_BUFFER_SIZE    256
-#define UART3_RX_BUFFER_SIZE    256
-#define UART3_TX_BUFFER_SIZE    256
-#define UART4_RX_BUFFER_SIZE    256
-#define UART4_TX_BUFFER_SIZE    256
-#define UART5_RX_BUFFER_SIZE    256
-#define UART5_TX_BUFFER_SIZE    256
-#define UART6_RX_BUFFER_SIZE    256
-#define UART6_TX_BUFFER_SIZE    256
-#define UART7_RX_BUFFER_SIZE    256
-#define UART7_TX_BUFFER_SIZE    256
-#define UART8_RX_BUFFER_SIZE    256
-#define UART8_TX_BUFFER_SIZE    256
+/*
+ * UART buffers come from a single static pool. serialInit() sizes them for the functions that are assigned to each
+ * port, see uartAllocateBuffers(). The pool is as big as a pair of buffers of this size for every UART. Sizes are
+ * kept to powers of two.
+ */
+#ifndef UART_DEFAULT_BUFFER_SIZE
+#if defined(STM32F4)
+#define UART_DEFAULT_BUFFER_SIZE 512
+#else
+#define UART_DEFAULT_BUFFER_SIZE 256
+#endif
+#endif
 
 typedef struct {
     serialPort_t port;
@@ -61,6 +51,7 @@ typedef struct {
 
     uint32_t rxDMAPos;
     bool txDMAEmpty;
+    bool txFlowControl;     // SERIAL_FLOW_CTS was asked for and the UART has a CTS pin
 
     uint32_t txDMAPeripheralBaseAddr;
     uint32_t rxDMAPeripheralBaseAddr;
@@ -72,10 +63,14 @@ typedef struct {
     USART_TypeDef *USARTx;
 } uartPort_t;
 
+bool uartAllocateBuffers(int uartIndex, uint16_t rxSize, uint16_t txSize);
+uint32_t uartBufferPoolFree(void);
+
 serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr rxCallback, uint32_t baudRate, portMode_t mode, portOptions_t options);
 
 // serialPort API
 void uartWrite(serialPort_t *instance, uint8_t ch);
+void uartWriteBuf(serialPort_t *instance, const void *data, int count);
 uint32_t uartTotalRxBytesWaiting(const serialPort_t *instance);
 uint32_t uartTotalTxBytesFree(const serialPort_t *instance);
 uint8_t uartRead(serialPort_t *instance);
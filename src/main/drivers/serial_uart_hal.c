@@ -23,16 +23,19 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "platform.h"
 
 #include "build/build_config.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 #include "io.h"
 #include "nvic.h"
 #include "inverter.h"
 #include "dma.h"
+#include "memory_report.h"
 
 #include "serial.h"
 #include "serial_uart.h"
@@ -76,7 +79,7 @@ static void uartReconfigure(uartPort_t *uartPort)
     uartPort->Handle.Init.WordLength = UART_WORDLENGTH_8B;
     uartPort->Handle.Init.StopBits = (uartPort->port.options & SERIAL_STOPBITS_2) ? USART_STOPBITS_2 : USART_STOPBITS_1;
     uartPort->Handle.Init.Parity = (uartPort->port.options & SERIAL_PARITY_EVEN) ? USART_PARITY_EVEN : USART_PARITY_NONE;
-    uartPort->Handle.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    uartPort->Handle.Init.HwFlowCtl = uartPort->txFlowControl ? UART_HWCONTROL_CTS : UART_HWCONTROL_NONE;
     uartPort->Handle.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
     uartPort->Handle.Init.Mode = 0;
 
@@ -123,6 +126,7 @@ static void uartReconfigure(uartPort_t *uartPort)
             __HAL_LINKDMA(&uartPort->Handle, hdmarx, uartPort->rxDMAHandle);
 
             HAL_UART_Receive_DMA(&uartPort->Handle, (uint8_t*)uartPort->port.rxBuffer, uartPort->port.rxBufferSize);
+            memoryReportDmaBuffer(OWNER_SERIAL_RX, uartPort->port.rxBuffer, uartPort->port.rxBufferSize);
 
             uartPort->rxDMAPos = __HAL_DMA_GET_COUNTER(&uartPort->rxDMAHandle);
 
@@ -169,6 +173,7 @@ static void uartReconfigure(uartPort_t *uartPort)
             __HAL_LINKDMA(&uartPort->Handle, hdmatx, uartPort->txDMAHandle);
 
             __HAL_DMA_SET_COUNTER(&uartPort->txDMAHandle, 0);
+            memoryReportDmaBuffer(OWNER_SERIAL_TX, uartPort->port.txBuffer, uartPort->port.txBufferSize);
         } else {
             __HAL_UART_ENABLE_IT(&uartPort->Handle, UART_IT_TXE);
         }
@@ -216,7 +221,10 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback,
     } else {
         return (serialPort_t *)s;
     }
-
+    if (!s) {
+        // No buffers left for the port
+        return NULL;
+    }
 
     s->txDMAEmpty = true;
 
@@ -266,7 +274,6 @@ void uartStartTxDMA(uartPort_t *s)
         s->port.txBufferTail = 0;
     }
     s->txDMAEmpty = false;
-    HAL_CLEANCACHE((uint8_t *)&s->port.txBuffer[fromwhere],size);
     HAL_UART_Transmit_DMA(&s->Handle, (uint8_t *)&s->port.txBuffer[fromwhere], size);
 }
 
@@ -359,6 +366,17 @@ uint8_t uartRead(serialPort_t *instance)
     return ch;
 }
 
+// Get newly queued bytes moving, unless a transfer is already under way
+static void uartStartTx(uartPort_t *s)
+{
+    if (s->txDMAStream) {
+        if (!(s->txDMAStream->CR & 1))
+            uartStartTxDMA(s);
+    } else {
+        __HAL_UART_ENABLE_IT(&s->Handle, UART_IT_TXE);
+    }
+}
+
 void uartWrite(serialPort_t *instance, uint8_t ch)
 {
     uartPort_t *s = (uartPort_t *)instance;
@@ -369,14 +387,76 @@ void uartWrite(serialPort_t *instance, uint8_t ch)
         s->port.txBufferHead++;
     }
 
-    if (s->txDMAStream) {
-        if (!(s->txDMAStream->CR & 1))
-            uartStartTxDMA(s);
+    uartStartTx(s);
+}
+
+/*
+ * Copy a whole buffer into the TX ring with memcpy and start transmission once, instead of a ring update and DMA
+ * check per byte. Like the byte-wise fallback in serialWriteBuf(), this waits for room if the ring fills up.
+ */
+void uartWriteBuf(serialPort_t *instance, const void *data, int count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+    const uint8_t *p = data;
+
+    while (count > 0) {
+        uint32_t space;
+
+        while ((space = uartTotalTxBytesFree(instance)) == 0) {
+        };
+
+        const uint32_t len = MIN(space, (uint32_t)count);
+        const uint32_t firstChunk = MIN(len, s->port.txBufferSize - s->port.txBufferHead);
+
+        memcpy((uint8_t *)&s->port.txBuffer[s->port.txBufferHead], p, firstChunk);
+        memcpy((uint8_t *)s->port.txBuffer, p + firstChunk, len - firstChunk);
+        s->port.txBufferHead = (s->port.txBufferHead + len) % s->port.txBufferSize;
+
+        p += len;
+        count -= len;
+
+        uartStartTx(s);
+    }
+}
+
+// the oldest waiting byte is at the DMA read position, or the ring tail when bytes are received by interrupt
+static void uartRxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    const uartPort_t *s = (const uartPort_t *)instance;
+    uint32_t start;
+
+    if (s->rxDMAStream) {
+        start = s->port.rxBufferSize - s->rxDMAPos;
     } else {
-        __HAL_UART_ENABLE_IT(&s->Handle, UART_IT_TXE);
+        start = s->port.rxBufferTail;
+    }
+    sbufRingInit(view, (uint8_t *)s->port.rxBuffer, s->port.rxBufferSize, start, uartTotalRxBytesWaiting(instance));
+}
+
+static void uartRxConsume(serialPort_t *instance, uint32_t count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+
+    if (s->rxDMAStream) {
+        const uint32_t next = (s->port.rxBufferSize - s->rxDMAPos + count) % s->port.rxBufferSize;
+        s->rxDMAPos = s->port.rxBufferSize - next;
+    } else {
+        s->port.rxBufferTail = (s->port.rxBufferTail + count) % s->port.rxBufferSize;
     }
 }
 
+static void uartTxView(const serialPort_t *instance, sbufRing_t *view)
+{
+    sbufRingInit(view, (uint8_t *)instance->txBuffer, instance->txBufferSize, instance->txBufferHead, uartTotalTxBytesFree(instance));
+}
+
+static void uartTxCommit(serialPort_t *instance, uint32_t count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+    s->port.txBufferHead = (s->port.txBufferHead + count) % s->port.txBufferSize;
+    uartStartTx(s);
+}
+
 const struct serialPortVTable uartVTable[] = {
     {
         .serialWrite = uartWrite,
@@ -386,8 +466,12 @@ const struct serialPortVTable uartVTable[] = {
         .serialSetBaudRate = uartSetBaudRate,
         .isSerialTransmitBufferEmpty = isUartTransmitBufferEmpty,
         .setMode = uartSetMode,
-        .writeBuf = NULL,
+        .writeBuf = uartWriteBuf,
         .beginWrite = NULL,
         .endWrite = NULL,
+        .rxView = uartRxView,
+        .rxConsume = uartRxConsume,
+        .txView = uartTxView,
+        .txCommit = uartTxCommit,
     }
 };
@@ -22,6 +22,10 @@
 extern const struct serialPortVTable uartVTable[];
 
 void uartStartTxDMA(uartPort_t *s);
+bool uartAssignBuffers(serialPort_t *port, int uartIndex);
+#ifdef STM32F4
+void uartRxDMADispatch(uartPort_t *s);
+#endif
 
 uartPort_t *serialUART1(uint32_t baudRate, portMode_t mode, portOptions_t options);
 uartPort_t *serialUART2(uint32_t baudRate, portMode_t mode, portOptions_t options);
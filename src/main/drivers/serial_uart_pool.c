@@ -0,0 +1,148 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#include "build/build_config.h"
+
+#include "serial.h"
+#include "serial_uart.h"
+#include "serial_uart_impl.h"
+
+#define UART_MAX_COUNT 8
+
+// Allocations are rounded up to this, which keeps every buffer on its own cache line on F7
+#define UART_BUFFER_ALIGNMENT 32
+
+typedef struct uartBuffers_s {
+    volatile uint8_t *rxBuffer;
+    volatile uint8_t *txBuffer;
+    uint16_t rxBufferSize;
+    uint16_t txBufferSize;
+} uartBuffers_t;
+
+// As much RAM as a default sized pair of buffers for every UART the target has
+#define UART_BUFFER_POOL_SIZE (2 * UART_DEFAULT_BUFFER_SIZE * (0 \
+    + UART_POOL_COUNT_1 + UART_POOL_COUNT_2 + UART_POOL_COUNT_3 + UART_POOL_COUNT_4 \
+    + UART_POOL_COUNT_5 + UART_POOL_COUNT_6 + UART_POOL_COUNT_7 + UART_POOL_COUNT_8))
+
+#ifdef USE_UART1
+#define UART_POOL_COUNT_1 1
+#else
+#define UART_POOL_COUNT_1 0
+#endif
+#ifdef USE_UART2
+#define UART_POOL_COUNT_2 1
+#else
+#define UART_POOL_COUNT_2 0
+#endif
+#ifdef USE_UART3
+#define UART_POOL_COUNT_3 1
+#else
+#define UART_POOL_COUNT_3 0
+#endif
+#ifdef USE_UART4
+#define UART_POOL_COUNT_4 1
+#else
+#define UART_POOL_COUNT_4 0
+#endif
+#ifdef USE_UART5
+#define UART_POOL_COUNT_5 1
+#else
+#define UART_POOL_COUNT_5 0
+#endif
+#ifdef USE_UART6
+#define UART_POOL_COUNT_6 1
+#else
+#define UART_POOL_COUNT_6 0
+#endif
+#ifdef USE_UART7
+#define UART_POOL_COUNT_7 1
+#else
+#define UART_POOL_COUNT_7 0
+#endif
+#ifdef USE_UART8
+#define UART_POOL_COUNT_8 1
+#else
+#define UART_POOL_COUNT_8 0
+#endif
+
+static DMA_RAM volatile uint8_t uartBufferPool[UART_BUFFER_POOL_SIZE] __attribute__((aligned(UART_BUFFER_ALIGNMENT)));
+static uint32_t uartBufferPoolUsed;
+
+static uartBuffers_t uartBuffers[UART_MAX_COUNT];
+
+static uint32_t uartBufferAlign(uint32_t size)
+{
+    return (size + UART_BUFFER_ALIGNMENT - 1) & ~(UART_BUFFER_ALIGNMENT - 1);
+}
+
+uint32_t uartBufferPoolFree(void)
+{
+    return UART_BUFFER_POOL_SIZE - uartBufferPoolUsed;
+}
+
+/*
+ * Give the UART at `uartIndex` (0 for UART1) RX and TX buffers of the given sizes from the pool. This must happen
+ * before the port is first opened, and can only be done once per port. Returns false if the pool can't fit them.
+ */
+bool uartAllocateBuffers(int uartIndex, uint16_t rxSize, uint16_t txSize)
+{
+    if (uartIndex < 0 || uartIndex >= UART_MAX_COUNT || uartBuffers[uartIndex].rxBuffer
+            || uartBufferAlign(rxSize) + uartBufferAlign(txSize) > uartBufferPoolFree()) {
+        return false;
+    }
+
+    uartBuffers_t *buffers = &uartBuffers[uartIndex];
+
+    buffers->rxBuffer = &uartBufferPool[uartBufferPoolUsed];
+    buffers->rxBufferSize = rxSize;
+    uartBufferPoolUsed += uartBufferAlign(rxSize);
+
+    buffers->txBuffer = &uartBufferPool[uartBufferPoolUsed];
+    buffers->txBufferSize = txSize;
+    uartBufferPoolUsed += uartBufferAlign(txSize);
+
+    return true;
+}
+
+/*
+ * Point the port at the buffers allocated to its UART. A port that serialInit() didn't plan for gets default sized
+ * buffers if the pool still has room for them. Returns false if the port has no buffers.
+ */
+bool uartAssignBuffers(serialPort_t *port, int uartIndex)
+{
+    if (uartIndex < 0 || uartIndex >= UART_MAX_COUNT) {
+        return false;
+    }
+
+    const uartBuffers_t *buffers = &uartBuffers[uartIndex];
+
+    if (!buffers->rxBuffer && !uartAllocateBuffers(uartIndex, UART_DEFAULT_BUFFER_SIZE, UART_DEFAULT_BUFFER_SIZE)) {
+        return false;
+    }
+
+    port->rxBuffer = buffers->rxBuffer;
+    port->txBuffer = buffers->txBuffer;
+    port->rxBufferSize = buffers->rxBufferSize;
+    port->txBufferSize = buffers->txBufferSize;
+
+    return true;
+}
@@ -30,9 +30,6 @@
 #include "serial_uart.h"
 #include "serial_uart_impl.h"
 
-#define UART_RX_BUFFER_SIZE 512
-#define UART_TX_BUFFER_SIZE 512
-
 typedef enum UARTDevice {
     UARTDEV_1 = 0,
     UARTDEV_2 = 1,
@@ -50,13 +47,11 @@ typedef struct uartDevice_s {
     DMA_Stream_TypeDef *rxDMAStream;
     ioTag_t rx;
     ioTag_t tx;
-    volatile uint8_t rxBuffer[UART_RX_BUFFER_SIZE];
-    volatile uint8_t txBuffer[UART_TX_BUFFER_SIZE];
+    ioTag_t cts;
     uint32_t rcc_ahb1;
     rccPeriphTag_t rcc_apb2;
     rccPeriphTag_t rcc_apb1;
     uint8_t af;
-    uint8_t txIrq;
     uint8_t rxIrq;
     uint32_t txPriority;
     uint32_t rxPriority;
@@ -74,12 +69,14 @@ static uartDevice_t uart1 =
     .dev = USART1,
     .rx = IO_TAG(UART1_RX_PIN),
     .tx = IO_TAG(UART1_TX_PIN),
+#ifdef UART1_CTS_PIN
+    .cts = IO_TAG(UART1_CTS_PIN),
+#endif
     .af = GPIO_AF_USART1,
 #ifdef UART1_AHB1_PERIPHERALS
     .rcc_ahb1 = UART1_AHB1_PERIPHERALS,
 #endif
     .rcc_apb2 = RCC_APB2(USART1),
-    .txIrq = DMA2_ST7_HANDLER,
     .rxIrq = USART1_IRQn,
     .txPriority = NVIC_PRIO_SERIALUART1_TXDMA,
     .rxPriority = NVIC_PRIO_SERIALUART1
@@ -97,12 +94,14 @@ static uartDevice_t uart2 =
     .dev = USART2,
     .rx = IO_TAG(UART2_RX_PIN),
     .tx = IO_TAG(UART2_TX_PIN),
+#ifdef UART2_CTS_PIN
+    .cts = IO_TAG(UART2_CTS_PIN),
+#endif
     .af = GPIO_AF_USART2,
 #ifdef UART2_AHB1_PERIPHERALS
     .rcc_ahb1 = UART2_AHB1_PERIPHERALS,
 #endif
     .rcc_apb1 = RCC_APB1(USART2),
-    .txIrq = DMA1_ST6_HANDLER,
     .rxIrq = USART2_IRQn,
     .txPriority = NVIC_PRIO_SERIALUART2_TXDMA,
     .rxPriority = NVIC_PRIO_SERIALUART2
@@ -120,12 +119,14 @@ static uartDevice_t uart3 =
     .dev = USART3,
     .rx = IO_TAG(UART3_RX_PIN),
     .tx = IO_TAG(UART3_TX_PIN),
+#ifdef UART3_CTS_PIN
+    .cts = IO_TAG(UART3_CTS_PIN),
+#endif
     .af = GPIO_AF_USART3,
 #ifdef UART3_AHB1_PERIPHERALS
     .rcc_ahb1 = UART3_AHB1_PERIPHERALS,
 #endif
     .rcc_apb1 = RCC_APB1(USART3),
-    .txIrq = DMA1_ST3_HANDLER,
     .rxIrq = USART3_IRQn,
     .txPriority = NVIC_PRIO_SERIALUART3_TXDMA,
     .rxPriority = NVIC_PRIO_SERIALUART3
@@ -148,7 +149,6 @@ static uartDevice_t uart4 =
     .rcc_ahb1 = UART4_AHB1_PERIPHERALS,
 #endif
     .rcc_apb1 = RCC_APB1(UART4),
-    .txIrq = DMA1_ST4_HANDLER,
     .rxIrq = UART4_IRQn,
     .txPriority = NVIC_PRIO_SERIALUART4_TXDMA,
     .rxPriority = NVIC_PRIO_SERIALUART4
@@ -171,7 +171,6 @@ static uartDevice_t uart5 =
     .rcc_ahb1 = UART5_AHB1_PERIPHERALS,
 #endif
     .rcc_apb1 = RCC_APB1(UART5),
-    .txIrq = DMA1_ST7_HANDLER,
     .rxIrq = UART5_IRQn,
     .txPriority = NVIC_PRIO_SERIALUART5_TXDMA,
     .rxPriority = NVIC_PRIO_SERIALUART5
@@ -189,12 +188,14 @@ static uartDevice_t uart6 =
     .dev = USART6,
     .rx = IO_TAG(UART6_RX_PIN),
     .tx = IO_TAG(UART6_TX_PIN),
+#ifdef UART6_CTS_PIN
+    .cts = IO_TAG(UART6_CTS_PIN),
+#endif
     .af = GPIO_AF_USART6,
 #ifdef UART6_AHB1_PERIPHERALS
     .rcc_ahb1 = UART6_AHB1_PERIPHERALS,
 #endif
     .rcc_apb2 = RCC_APB2(USART6),
-    .txIrq = DMA2_ST6_HANDLER,
     .rxIrq = USART6_IRQn,
     .txPriority = NVIC_PRIO_SERIALUART6_TXDMA,
     .rxPriority = NVIC_PRIO_SERIALUART6
@@ -236,6 +237,12 @@ static uartDevice_t* uartHardwareMap[] = {
 
 void uartIrqHandler(uartPort_t *s)
 {
+    if (s->rxDMAStream && (USART_GetITStatus(s->USARTx, USART_IT_IDLE) == SET)) {
+        // The status register was just read, reading the data register completes the sequence that clears IDLE
+        (void)s->USARTx->DR;
+        uartRxDMADispatch(s);
+    }
+
     if (!s->rxDMAStream && (USART_GetITStatus(s->USARTx, USART_IT_RXNE) == SET)) {
         if (s->port.rxCallback) {
             s->port.rxCallback(s->USARTx->DR);
@@ -293,6 +300,20 @@ void dmaIRQHandler(dmaChannelDescriptor_t* descriptor)
     }
 }
 
+static void dmaRxIRQHandler(dmaChannelDescriptor_t* descriptor)
+{
+    uartPort_t *s = &(((uartDevice_t*)(descriptor->userParam))->port);
+
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_HTIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_HTIF);
+    }
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+    }
+    // A stream without gaps never goes idle, so the ring is also drained at each half
+    uartRxDMADispatch(s);
+}
+
 uartPort_t *serialUART(UARTDevice device, uint32_t baudRate, portMode_t mode, portOptions_t options)
 {
     uartPort_t *s;
@@ -306,21 +327,25 @@ uartPort_t *serialUART(UARTDevice device, uint32_t baudRate, portMode_t mode, po
 
     s->port.baudRate = baudRate;
 
-    s->port.rxBuffer = uart->rxBuffer;
-    s->port.txBuffer = uart->txBuffer;
-    s->port.rxBufferSize = sizeof(uart->rxBuffer);
-    s->port.txBufferSize = sizeof(uart->txBuffer);
+    if (!uartAssignBuffers(&s->port, device)) {
+        return NULL;
+    }
 
     s->USARTx = uart->dev;
+    // the port falls back to interrupts in either direction that finds no free stream
     if (uart->rxDMAStream) {
-        s->rxDMAChannel = uart->DMAChannel;
-        s->rxDMAStream = uart->rxDMAStream;
-        dmaInit(dmaGetIdentifier(uart->rxDMAStream), OWNER_SERIAL_RX, RESOURCE_INDEX(device));
+        dmaStreamOption_t option = { .peripheral = uart->dev, .request = DMA_REQUEST_RX, .stream = uart->rxDMAStream, .channel = uart->DMAChannel };
+        if (dmaAllocateRequest(&option, OWNER_SERIAL_RX, RESOURCE_INDEX(device))) {
+            s->rxDMAChannel = option.channel;
+            s->rxDMAStream = option.stream;
+        }
     }
     if (uart->txDMAStream) {
-        s->txDMAChannel = uart->DMAChannel;
-        s->txDMAStream = uart->txDMAStream;
-        dmaInit(dmaGetIdentifier(uart->txDMAStream), OWNER_SERIAL_TX, RESOURCE_INDEX(device));
+        dmaStreamOption_t option = { .peripheral = uart->dev, .request = DMA_REQUEST_TX, .stream = uart->txDMAStream, .channel = uart->DMAChannel };
+        if (dmaAllocateRequest(&option, OWNER_SERIAL_TX, RESOURCE_INDEX(device))) {
+            s->txDMAChannel = option.channel;
+            s->txDMAStream = option.stream;
+        }
     }
 
     s->txDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
@@ -357,17 +382,31 @@ uartPort_t *serialUART(UARTDevice device, uint32_t baudRate, portMode_t mode, po
         }
     }
 
+    // The other end holds CTS high while it can't take any more, the UART pauses transmission until it goes low
+    s->txFlowControl = (options & SERIAL_FLOW_CTS) && (mode & MODE_TX) && uart->cts;
+    if (s->txFlowControl) {
+        IO_t cts = IOGetByTag(uart->cts);
+        IOInit(cts, OWNER_SERIAL_CTS, RESOURCE_INDEX(device));
+        IOConfigGPIOAF(cts, IOCFG_AF_PP_UP, uart->af);
+    }
+
     // DMA TX Interrupt
-    dmaSetHandler(uart->txIrq, dmaIRQHandler, uart->txPriority, (uint32_t)uart);
-
-    if (!(s->rxDMAChannel)) {
-        NVIC_InitStructure.NVIC_IRQChannel = uart->rxIrq;
-        NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_PRIORITY_BASE(uart->rxPriority);
-        NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(uart->rxPriority);
-        NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-        NVIC_Init(&NVIC_InitStructure);
+    if (s->txDMAStream) {
+        dmaSetHandler(dmaGetIdentifier(s->txDMAStream), dmaIRQHandler, uart->txPriority, (uint32_t)uart);
     }
 
+    if (s->rxDMAStream) {
+        // Only enabled by uartOpen() for ports with a receive callback
+        dmaSetHandler(dmaGetIdentifier(s->rxDMAStream), dmaRxIRQHandler, uart->rxPriority, (uint32_t)uart);
+    }
+
+    // The USART interrupt is also needed with RX DMA, for the idle line
+    NVIC_InitStructure.NVIC_IRQChannel = uart->rxIrq;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_PRIORITY_BASE(uart->rxPriority);
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(uart->rxPriority);
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
     return s;
 }
 
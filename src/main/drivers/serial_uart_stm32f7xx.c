@@ -32,9 +32,6 @@
 
 static void handleUsartTxDma(uartPort_t *s);
 
-#define UART_RX_BUFFER_SIZE UART1_RX_BUFFER_SIZE
-#define UART_TX_BUFFER_SIZE UART1_TX_BUFFER_SIZE
-
 typedef enum UARTDevice {
     UARTDEV_1 = 0,
     UARTDEV_2 = 1,
@@ -54,8 +51,7 @@ typedef struct uartDevice_s {
     DMA_Stream_TypeDef *rxDMAStream;
     ioTag_t rx;
     ioTag_t tx;
-    volatile uint8_t rxBuffer[UART_RX_BUFFER_SIZE];
-    volatile uint8_t txBuffer[UART_TX_BUFFER_SIZE];
+    ioTag_t cts;
     uint32_t rcc_ahb1;
     rccPeriphTag_t rcc_apb2;
     rccPeriphTag_t rcc_apb1;
@@ -78,6 +74,9 @@ static uartDevice_t uart1 =
     .dev = USART1,
     .rx = IO_TAG(UART1_RX_PIN),
     .tx = IO_TAG(UART1_TX_PIN),
+#ifdef UART1_CTS_PIN
+    .cts = IO_TAG(UART1_CTS_PIN),
+#endif
     .af = GPIO_AF7_USART1,
 #ifdef UART1_AHB1_PERIPHERALS
     .rcc_ahb1 = UART1_AHB1_PERIPHERALS,
@@ -101,6 +100,9 @@ static uartDevice_t uart2 =
     .dev = USART2,
     .rx = IO_TAG(UART2_RX_PIN),
     .tx = IO_TAG(UART2_TX_PIN),
+#ifdef UART2_CTS_PIN
+    .cts = IO_TAG(UART2_CTS_PIN),
+#endif
     .af = GPIO_AF7_USART2,
 #ifdef UART2_AHB1_PERIPHERALS
     .rcc_ahb1 = UART2_AHB1_PERIPHERALS,
@@ -124,6 +126,9 @@ static uartDevice_t uart3 =
     .dev = USART3,
     .rx = IO_TAG(UART3_RX_PIN),
     .tx = IO_TAG(UART3_TX_PIN),
+#ifdef UART3_CTS_PIN
+    .cts = IO_TAG(UART3_CTS_PIN),
+#endif
     .af = GPIO_AF7_USART3,
 #ifdef UART3_AHB1_PERIPHERALS
     .rcc_ahb1 = UART3_AHB1_PERIPHERALS,
@@ -147,6 +152,9 @@ static uartDevice_t uart4 =
     .dev = UART4,
     .rx = IO_TAG(UART4_RX_PIN),
     .tx = IO_TAG(UART4_TX_PIN),
+#ifdef UART4_CTS_PIN
+    .cts = IO_TAG(UART4_CTS_PIN),
+#endif
     .af = GPIO_AF8_UART4,
 #ifdef UART4_AHB1_PERIPHERALS
     .rcc_ahb1 = UART4_AHB1_PERIPHERALS,
@@ -170,6 +178,9 @@ static uartDevice_t uart5 =
     .dev = UART5,
     .rx = IO_TAG(UART5_RX_PIN),
     .tx = IO_TAG(UART5_TX_PIN),
+#ifdef UART5_CTS_PIN
+    .cts = IO_TAG(UART5_CTS_PIN),
+#endif
     .af = GPIO_AF8_UART5,
 #ifdef UART5_AHB1_PERIPHERALS
     .rcc_ahb1 = UART5_AHB1_PERIPHERALS,
@@ -193,6 +204,9 @@ static uartDevice_t uart6 =
     .dev = USART6,
     .rx = IO_TAG(UART6_RX_PIN),
     .tx = IO_TAG(UART6_TX_PIN),
+#ifdef UART6_CTS_PIN
+    .cts = IO_TAG(UART6_CTS_PIN),
+#endif
     .af = GPIO_AF8_USART6,
 #ifdef UART6_AHB1_PERIPHERALS
     .rcc_ahb1 = UART6_AHB1_PERIPHERALS,
@@ -216,6 +230,9 @@ static uartDevice_t uart7 =
     .dev = UART7,
     .rx = IO_TAG(UART7_RX_PIN),
     .tx = IO_TAG(UART7_TX_PIN),
+#ifdef UART7_CTS_PIN
+    .cts = IO_TAG(UART7_CTS_PIN),
+#endif
     .af = GPIO_AF8_UART7,
 #ifdef UART7_AHB1_PERIPHERALS
     .rcc_ahb1 = UART7_AHB1_PERIPHERALS,
@@ -238,6 +255,9 @@ static uartDevice_t uart8 =
     .dev = UART8,
     .rx = IO_TAG(UART8_RX_PIN),
     .tx = IO_TAG(UART8_TX_PIN),
+#ifdef UART8_CTS_PIN
+    .cts = IO_TAG(UART8_CTS_PIN),
+#endif
     .af = GPIO_AF8_UART8,
 #ifdef UART8_AHB1_PERIPHERALS
     .rcc_ahb1 = UART8_AHB1_PERIPHERALS,
@@ -384,10 +404,9 @@ uartPort_t *serialUART(UARTDevice device, uint32_t baudRate, portMode_t mode, po
 
     s->port.baudRate = baudRate;
 
-    s->port.rxBuffer = uart->rxBuffer;
-    s->port.txBuffer = uart->txBuffer;
-    s->port.rxBufferSize = sizeof(uart->rxBuffer);
-    s->port.txBufferSize = sizeof(uart->txBuffer);
+    if (!uartAssignBuffers(&s->port, device)) {
+        return NULL;
+    }
 
     s->USARTx = uart->dev;
     if (uart->rxDMAStream) {
@@ -421,6 +440,14 @@ uartPort_t *serialUART(UARTDevice device, uint32_t baudRate, portMode_t mode, po
         }
     }
 
+    // The other end holds CTS high while it can't take any more, the UART pauses transmission until it goes low
+    s->txFlowControl = (options & SERIAL_FLOW_CTS) && (mode & MODE_TX) && uart->cts;
+    if (s->txFlowControl) {
+        IO_t cts = IOGetByTag(uart->cts);
+        IOInit(cts, OWNER_SERIAL_CTS, RESOURCE_INDEX(device));
+        IOConfigGPIOAF(cts, IOCFG_AF_PP, uart->af);
+    }
+
     // DMA TX Interrupt
     dmaInit(uart->txIrq, OWNER_SERIAL_TX, RESOURCE_INDEX(device));
     dmaSetHandler(uart->txIrq, dmaIRQHandler, uart->txPriority, (uint32_t)uart);
@@ -26,6 +26,7 @@
 #include "nvic.h"
 #include "io.h"
 #include "exti.h"
+#include "timer.h"
 #include "sonar_hcsr04.h"
 
 /* HC-SR04 consists of ultrasonic transmitter, receiver, and control circuits.
@@ -35,6 +36,9 @@
  *
  * *** Warning: HC-SR04 operates at +5V ***
  *
+ * When the echo pin has a timer channel nothing else uses, both edges of the pulse are latched by a pair of
+ * input capture channels and the width is taken from the capture registers, so interrupt latency doesn't
+ * show in the reading. Otherwise the edges are timed with micros() in an EXTI handler.
  */
 
 #if defined(SONAR)
@@ -46,6 +50,35 @@ extiCallbackRec_t hcsr04_extiCallbackRec;
 static IO_t echoIO;
 static IO_t triggerIO;
 
+#define HCSR04_TIMER_MHZ    1                   // capture counts are the pulse width in microseconds
+#define HCSR04_TIMER_PERIOD 0x10000             // free running, wraps well after the 38ms no-echo pulse
+
+static const timerHardware_t *echoTimer;
+static timerCCHandlerRec_t hcsr04_fallingEdgeCb;
+
+// the rising edge was latched in the low channel of the pair when the falling edge reaches the high one
+static void hcsr04_fallingEdgeHandler(timerCCHandlerRec_t *cb, captureCompare_t capture)
+{
+    UNUSED(cb);
+    const captureCompare_t rise = *timerChCCRLo(echoTimer);
+    measurement = (captureCompare_t)(capture - rise);
+}
+
+// the timer is given a 1MHz time base and both channels of the pair, so no other pin on it may be in use
+static bool hcsr04_isTimerFree(const timerHardware_t *timer)
+{
+    for (int i = 0; i < USABLE_TIMER_CHANNEL_COUNT; i++) {
+        if (timerHardware[i].tim != timer->tim || timerHardware[i].tag == timer->tag) {
+            continue;
+        }
+        const resourceOwner_e owner = IOGetOwner(IOGetByTag(timerHardware[i].tag));
+        if (owner != OWNER_FREE && owner != OWNER_SONAR_TRIGGER) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void hcsr04_extiHandler(extiCallbackRec_t* cb)
 {
     static uint32_t timing_start;
@@ -88,6 +121,25 @@ void hcsr04_init(const sonarConfig_t *sonarConfig, sonarRange_t *sonarRange)
 
     // echo pin
     echoIO = IOGetByTag(sonarConfig->echoTag);
+
+    const timerHardware_t *timer = timerGetByTag(sonarConfig->echoTag, TIM_USE_ANY);
+    if (timer && hcsr04_isTimerFree(timer)) {
+        echoTimer = timer;
+        IOInit(echoIO, OWNER_SONAR_ECHO, 0);
+#ifdef STM32F1
+        IOConfigGPIO(echoIO, IOCFG_IN_FLOATING);
+#else
+        IOConfigGPIOAF(echoIO, IOCFG_AF_PP, timer->alternateFunction);
+#endif
+        timerConfigure(timer, (uint16_t)HCSR04_TIMER_PERIOD, HCSR04_TIMER_MHZ);
+        timerChConfigICDual(timer, true, 0);
+        timerChCCHandlerInit(&hcsr04_fallingEdgeCb, hcsr04_fallingEdgeHandler);
+        timerChConfigCallbacksDual(timer, NULL, &hcsr04_fallingEdgeCb, NULL);
+
+        lastMeasurementAt = millis() - 60; // force 1st measurement in hcsr04_get_distance()
+        return;
+    }
+
     IOInit(echoIO, OWNER_SONAR_ECHO, 0);
     IOConfigGPIO(echoIO, IOCFG_IN_FLOATING);
 
@@ -54,32 +54,59 @@ extern char _Min_Stack_Size; // declared in .LD file
  *
  */
 
-#ifdef STACK_CHECK
-
-static uint32_t usedStackSize;
+// left free below the caller's frame when painting, covers this function's own frame
+#define STACK_PAINT_MARGIN 64
 
-void taskStackCheck(timeUs_t currentTimeUs)
+/*
+ * Paints the unused part of the stack so the high-water mark can be found later. Only the F4 startup code
+ * paints it, so this is called early in init() on all targets.
+ */
+void stackPaint(void)
 {
-    UNUSED(currentTimeUs);
+    char * const stackHighMem = &_estack;
+    char * const stackLowMem = stackHighMem - (uint32_t)&_Min_Stack_Size;
+    char * const stackCurrent = (char *)&stackLowMem - STACK_PAINT_MARGIN;
+
+    for (volatile uint8_t *p = (uint8_t *)stackLowMem; p < (uint8_t *)stackCurrent; ++p) {
+        *p = STACK_FILL_CHAR;
+    }
+}
 
+// deepest stack use since the stack was painted
+uint32_t stackHighWaterMark(void)
+{
     char * const stackHighMem = &_estack;
-    const uint32_t stackSize = (uint32_t)&_Min_Stack_Size;
-    char * const stackLowMem = stackHighMem - stackSize;
+    char * const stackLowMem = stackHighMem - (uint32_t)&_Min_Stack_Size;
     const char * const stackCurrent = (char *)&stackLowMem;
 
-    char *p;
-    for (p = stackLowMem; p < stackCurrent; ++p) {
+    const uint8_t *p;
+    for (p = (uint8_t *)stackLowMem; p < (const uint8_t *)stackCurrent; ++p) {
         if (*p != STACK_FILL_CHAR) {
             break;
         }
     }
 
-    usedStackSize = (uint32_t)stackHighMem - (uint32_t)p;
+    return (uint32_t)stackHighMem - (uint32_t)p;
+}
+
+#ifdef STACK_CHECK
+
+static uint32_t usedStackSize;
+
+void taskStackCheck(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    char * const stackHighMem = &_estack;
+    char * const stackLowMem = stackHighMem - (uint32_t)&_Min_Stack_Size;
+    const char * const stackCurrent = (char *)&stackLowMem;
+
+    usedStackSize = stackHighWaterMark();
 
     DEBUG_SET(DEBUG_STACK, 0, (uint32_t)stackHighMem & 0xffff);
     DEBUG_SET(DEBUG_STACK, 1, (uint32_t)stackLowMem & 0xffff);
     DEBUG_SET(DEBUG_STACK, 2, (uint32_t)stackCurrent & 0xffff);
-    DEBUG_SET(DEBUG_STACK, 3, (uint32_t)p & 0xffff);
+    DEBUG_SET(DEBUG_STACK, 3, ((uint32_t)stackHighMem - usedStackSize) & 0xffff);
 }
 
 uint32_t stackUsedSize(void)
@@ -19,6 +19,8 @@
 
 #include "common/time.h"
 
+void stackPaint(void);
+uint32_t stackHighWaterMark(void);
 void taskStackCheck(timeUs_t currentTimeUs);
 uint32_t stackUsedSize(void);
 uint32_t stackTotalSize(void);
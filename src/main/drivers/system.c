@@ -17,6 +17,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "platform.h"
 
@@ -35,6 +36,26 @@ static volatile uint32_t sysTickUptime = 0;
 // cached value of RCC->CSR
 uint32_t cachedRccCsrValue;
 
+// declared in the .LD file
+extern uint8_t _sfastcode, _efastcode, _sifastcode;
+extern uint8_t _sfastram_data, _efastram_data, _sifastram_data;
+extern uint8_t _sfastram_bss, _efastram_bss;
+extern uint8_t _sdmaram_bss, _edmaram_bss;
+
+/*
+ * Copies the hot code and the initialised fast RAM statics out of flash and zeroes the fast RAM and DMA bss. The
+ * startup code only sets up .data and .bss, so this must run before anything in those sections is used.
+ */
+void initialiseMemorySections(void)
+{
+    if (&_sfastcode != &_sifastcode) {
+        memcpy(&_sfastcode, &_sifastcode, &_efastcode - &_sfastcode);
+    }
+    memcpy(&_sfastram_data, &_sifastram_data, &_efastram_data - &_sfastram_data);
+    memset(&_sfastram_bss, 0, &_efastram_bss - &_sfastram_bss);
+    memset(&_sdmaram_bss, 0, &_edmaram_bss - &_sdmaram_bss);
+}
+
 void cycleCounterInit(void)
 {
 #if defined(USE_HAL_DRIVER)
@@ -44,11 +65,47 @@ void cycleCounterInit(void)
     RCC_GetClocksFreq(&clocks);
     usTicks = clocks.SYSCLK_Frequency / 1000000;
 #endif
+
+#if defined(USE_PROFILER) || defined(USE_SCHEDULER_TRACE)
+    // start the DWT cycle counter used by the profiler and the scheduler trace
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#ifdef STM32F7
+    DWT->LAR = 0xC5ACCE55;
+#endif
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
 }
 
 // SysTick
 
 static volatile int sysTickPending = 0;
+static sysTickCallbackFunc * volatile sysTickCallback;
+
+// runs fn from every 1kHz tick until replaced, for output that must be paced more steadily than a task can
+void systemSetTickCallback(sysTickCallbackFunc *fn)
+{
+    sysTickCallback = fn;
+}
+
+#ifdef USE_POST_MORTEM
+static volatile uint32_t watchdogKickedAt;
+static uint32_t watchdogTimeoutMs;
+static sysTickCallbackFunc *watchdogExpiredCallback;
+
+// a watchdog in software, fn is called from every tick once the scheduler has not kicked it for timeoutMs
+void systemWatchdogInit(uint32_t timeoutMs, sysTickCallbackFunc *fn)
+{
+    watchdogKickedAt = sysTickUptime;
+    watchdogTimeoutMs = timeoutMs;
+    watchdogExpiredCallback = fn;
+}
+
+void systemWatchdogKick(void)
+{
+    watchdogKickedAt = sysTickUptime;
+}
+#endif
 
 void SysTick_Handler(void)
 {
@@ -61,8 +118,42 @@ void SysTick_Handler(void)
     // used by the HAL for some timekeeping and timeouts, should always be 1ms
     HAL_IncTick();
 #endif
+
+    sysTickCallbackFunc *fn = sysTickCallback;
+    if (fn) {
+        fn();
+    }
+#ifdef USE_POST_MORTEM
+    if (watchdogExpiredCallback && sysTickUptime - watchdogKickedAt >= watchdogTimeoutMs) {
+        watchdogExpiredCallback();
+    }
+#endif
 }
 
+#ifdef USE_PID_LOOP_INTERRUPT
+// Software interrupt, raised from a higher priority ISR to run work that is too long to do there
+
+static softIrqHandlerFunc *softIrqHandler;
+
+void PendSV_Handler(void)
+{
+    if (softIrqHandler) {
+        softIrqHandler();
+    }
+}
+
+void systemSoftIrqInit(softIrqHandlerFunc *fn, uint8_t priority)
+{
+    softIrqHandler = fn;
+    NVIC_SetPriority(PendSV_IRQn, priority >> (8 - __NVIC_PRIO_BITS));
+}
+
+void systemSoftIrqRaise(void)
+{
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+#endif
+
 // Return system uptime in microseconds (rollover in 70minutes)
 
 uint32_t microsISR(void)
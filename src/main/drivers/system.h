@@ -18,6 +18,7 @@
 #pragma once
 
 void systemInit(void);
+void initialiseMemorySections(void);
 void delayMicroseconds(uint32_t us);
 void delay(uint32_t ms);
 
@@ -41,6 +42,10 @@ void failureMode(failureMode_e mode);
 // bootloader/IAP
 void systemReset(void);
 void systemResetToBootloader(void);
+#ifdef USE_USB_MSC
+void systemResetToMsc(void);
+bool systemCheckMscRequest(void);
+#endif
 bool isMPUSoftReset(void);
 void cycleCounterInit(void);
 void checkForBootLoaderRequest(void);
@@ -51,6 +56,20 @@ void enableGPIOPowerUsageAndNoiseReductions(void);
 extern uint32_t hse_value;
 extern uint32_t cachedRccCsrValue;
 
+typedef void sysTickCallbackFunc(void);
+
+void systemSetTickCallback(sysTickCallbackFunc *fn);
+
+#ifdef USE_POST_MORTEM
+void systemWatchdogInit(uint32_t timeoutMs, sysTickCallbackFunc *fn);
+void systemWatchdogKick(void);
+#endif
+
+typedef void softIrqHandlerFunc(void);
+
+void systemSoftIrqInit(softIrqHandlerFunc *fn, uint8_t priority);
+void systemSoftIrqRaise(void);
+
 typedef void extiCallbackHandlerFunc(void);
 
 void registerExtiCallbackHandler(IRQn_Type irqn, extiCallbackHandlerFunc *fn);void unregisterExtiCallbackHandler(IRQn_Type irqn, extiCallbackHandlerFunc *fn);
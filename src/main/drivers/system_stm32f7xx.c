@@ -53,6 +53,35 @@ void systemResetToBootloader(void)
     NVIC_SystemReset();
 }
 
+#ifdef USE_USB_MSC
+#define MSC_REQUEST_MAGIC 0xDDDD1010
+
+void systemResetToMsc(void)
+{
+    if (mpuReset) {
+        mpuReset();
+    }
+
+    (*(__IO uint32_t *) (BKPSRAM_BASE + 8)) = MSC_REQUEST_MAGIC;   // flag that will be readable after reboot
+
+    __disable_irq();
+    NVIC_SystemReset();
+}
+
+/**
+ * Returns true once after systemResetToMsc(), backup SRAM access is enabled by checkForBootLoaderRequest().
+ */
+bool systemCheckMscRequest(void)
+{
+    if ((*(__IO uint32_t *) (BKPSRAM_BASE + 8)) != MSC_REQUEST_MAGIC) {
+        return false;
+    }
+
+    (*(__IO uint32_t *) (BKPSRAM_BASE + 8)) = 0; // Reset our trigger
+    return true;
+}
+#endif
+
 void enableGPIOPowerUsageAndNoiseReductions(void)
 {
 
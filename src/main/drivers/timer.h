@@ -45,7 +45,7 @@ typedef uint16_t timCCR_t;
 typedef uint16_t timCCER_t;
 typedef uint16_t timSR_t;
 typedef uint16_t timCNT_t;
-#elif defined(UNIT_TEST)
+#elif defined(UNIT_TEST) || defined(SIMULATOR_BUILD)
 typedef uint32_t timCCR_t;
 typedef uint32_t timCCER_t;
 typedef uint32_t timSR_t;
@@ -77,13 +77,16 @@ typedef struct timerCCHandlerRec_s {
 
 typedef struct timerOvrHandlerRec_s {
     timerOvrHandlerCallback* fn;
-    struct timerOvrHandlerRec_s* next;
 } timerOvrHandlerRec_t;
 
 typedef struct timerDef_s {
     TIM_TypeDef *TIMx;
     rccPeriphTag_t rcc;
     uint8_t inputIrq;
+#if defined(STM32F4) || defined(STM32F7)
+    DMA_Stream_TypeDef *dmaBurstStream;     // stream serving the update DMA request, used for DMAR bursts to the CCRs
+    uint32_t dmaBurstChannel;
+#endif
 } timerDef_t;
 
 typedef struct timerHardware_s {
@@ -55,7 +55,8 @@
 typedef struct timerConfig_s {
     timerCCHandlerRec_t *edgeCallback[CC_CHANNELS_PER_TIMER];
     timerOvrHandlerRec_t *overflowCallback[CC_CHANNELS_PER_TIMER];
-    timerOvrHandlerRec_t *overflowCallbackActive; // null-terminated linkded list of active overflow callbacks
+    timerOvrHandlerRec_t *overflowCallbackActive[CC_CHANNELS_PER_TIMER]; // the non NULL overflowCallback entries, packed
+    uint8_t overflowCallbackActiveCount;
     uint32_t forcedOverflowTimerValue;
 } timerConfig_t;
 timerConfig_t timerConfig[USED_TIMER_COUNT+1];
@@ -347,7 +348,6 @@ void timerChCCHandlerInit(timerCCHandlerRec_t *self, timerCCHandlerCallback *fn)
 void timerChOvrHandlerInit(timerOvrHandlerRec_t *self, timerOvrHandlerCallback *fn)
 {
     self->fn = fn;
-    self->next = NULL;
 }
 
 // update overflow callback list
@@ -358,17 +358,16 @@ static void timerChConfig_UpdateOverflow(timerConfig_t *cfg, TIM_TypeDef *tim) {
         return;
     }
 
-    timerOvrHandlerRec_t **chain = &cfg->overflowCallbackActive;
     ATOMIC_BLOCK(NVIC_PRIO_TIMER) {
+        uint8_t count = 0;
         for(int i = 0; i < CC_CHANNELS_PER_TIMER; i++)
             if(cfg->overflowCallback[i]) {
-                *chain = cfg->overflowCallback[i];
-                chain = &cfg->overflowCallback[i]->next;
+                cfg->overflowCallbackActive[count++] = cfg->overflowCallback[i];
             }
-        *chain = NULL;
+        cfg->overflowCallbackActiveCount = count;
     }
     // enable or disable IRQ
-    if(cfg->overflowCallbackActive)
+    if(cfg->overflowCallbackActiveCount)
         __HAL_TIM_ENABLE_IT(&timerHandle[timerIndex].Handle, TIM_IT_UPDATE);
     else
         __HAL_TIM_DISABLE_IT(&timerHandle[timerIndex].Handle, TIM_IT_UPDATE);
@@ -603,77 +602,39 @@ void timerChConfigOC(const timerHardware_t* timHw, bool outEnable, bool stateHig
     }
 }
 
+// Dispatches each pending event straight to its channel's callback, the update event is bit 0
+// of SR and DIER and CC1..CC4 are bits 1..4, the DMA enables above them in DIER are ignored
 static void timCCxHandler(TIM_TypeDef *tim, timerConfig_t *timerConfig)
 {
-    uint16_t capture;
-    unsigned tim_status;
-    tim_status = tim->SR & tim->DIER;
-#if 1
+    unsigned tim_status = tim->SR & tim->DIER;
+
     while(tim_status) {
         // flags will be cleared by reading CCR in dual capture, make sure we call handler correctly
         // currrent order is highest bit first. Code should not rely on specific order (it will introduce race conditions anyway)
-        unsigned bit = __builtin_clz(tim_status);
-        unsigned mask = ~(0x80000000 >> bit);
+        const unsigned bit = 31 - __builtin_clz(tim_status);
+        const unsigned mask = ~(1U << bit);
         tim->SR = mask;
         tim_status &= mask;
-        switch(bit) {
-            case __builtin_clz(TIM_IT_UPDATE): {
-
-                if(timerConfig->forcedOverflowTimerValue != 0){
-                    capture = timerConfig->forcedOverflowTimerValue - 1;
-                    timerConfig->forcedOverflowTimerValue = 0;
-                } else {
-                    capture = tim->ARR;
-                }
-
-                timerOvrHandlerRec_t *cb = timerConfig->overflowCallbackActive;
-                while(cb) {
-                    cb->fn(cb, capture);
-                    cb = cb->next;
-                }
-                break;
+
+        if (bit == 0) {
+            uint16_t capture;
+            if(timerConfig->forcedOverflowTimerValue != 0){
+                capture = timerConfig->forcedOverflowTimerValue - 1;
+                timerConfig->forcedOverflowTimerValue = 0;
+            } else {
+                capture = tim->ARR;
             }
-            case __builtin_clz(TIM_IT_CC1):
-                timerConfig->edgeCallback[0]->fn(timerConfig->edgeCallback[0], tim->CCR1);
-                break;
-            case __builtin_clz(TIM_IT_CC2):
-                timerConfig->edgeCallback[1]->fn(timerConfig->edgeCallback[1], tim->CCR2);
-                break;
-            case __builtin_clz(TIM_IT_CC3):
-                timerConfig->edgeCallback[2]->fn(timerConfig->edgeCallback[2], tim->CCR3);
-                break;
-            case __builtin_clz(TIM_IT_CC4):
-                timerConfig->edgeCallback[3]->fn(timerConfig->edgeCallback[3], tim->CCR4);
-                break;
-        }
-    }
-#else
-    if (tim_status & (int)TIM_IT_Update) {
-        tim->SR = ~TIM_IT_Update;
-        capture = tim->ARR;
-        timerOvrHandlerRec_t *cb = timerConfig->overflowCallbackActive;
-        while(cb) {
-            cb->fn(cb, capture);
-            cb = cb->next;
+
+            for (int i = 0; i < timerConfig->overflowCallbackActiveCount; i++) {
+                timerOvrHandlerRec_t *cb = timerConfig->overflowCallbackActive[i];
+                cb->fn(cb, capture);
+            }
+        } else if (bit <= CC_CHANNELS_PER_TIMER) {
+            // the CCRs are a word apart
+            timerCCHandlerRec_t *cb = timerConfig->edgeCallback[bit - 1];
+            cb->fn(cb, *(volatile timCCR_t *)((volatile char *)&tim->CCR1 + ((bit - 1) << 2)));
         }
     }
-    if (tim_status & (int)TIM_IT_CC1) {
-        tim->SR = ~TIM_IT_CC1;
-        timerConfig->edgeCallback[0]->fn(timerConfig->edgeCallback[0], tim->CCR1);
-    }
-    if (tim_status & (int)TIM_IT_CC2) {
-        tim->SR = ~TIM_IT_CC2;
-        timerConfig->edgeCallback[1]->fn(timerConfig->edgeCallback[1], tim->CCR2);
-    }
-    if (tim_status & (int)TIM_IT_CC3) {
-        tim->SR = ~TIM_IT_CC3;
-        timerConfig->edgeCallback[2]->fn(timerConfig->edgeCallback[2], tim->CCR3);
-    }
-    if (tim_status & (int)TIM_IT_CC4) {
-        tim->SR = ~TIM_IT_CC4;
-        timerConfig->edgeCallback[3]->fn(timerConfig->edgeCallback[3], tim->CCR4);
-    }
-#endif
 }
 
 // handler for shared interrupts when both timers need to check status bits
@@ -22,6 +22,7 @@
 #include <platform.h>
 
 #include "dma.h"
+#include "memory_report.h"
 #include "nvic.h"
 #include "io.h"
 #include "timer.h"
@@ -39,9 +40,14 @@ uint8_t transponderIrDMABuffer[TRANSPONDER_DMA_BUFFER_SIZE];
 
 volatile uint8_t transponderIrDataTransferInProgress = 0;
 
+static uint8_t encodedTransponderData[TRANSPONDER_DATA_LENGTH];
+static bool transponderDataEncoded = false;
+
 void transponderIrInit(void)
 {
     memset(&transponderIrDMABuffer, 0, TRANSPONDER_DMA_BUFFER_SIZE);
+    memoryReportDmaBuffer(OWNER_TRANSPONDER, transponderIrDMABuffer, sizeof(transponderIrDMABuffer));
+    transponderDataEncoded = false;
 
     ioTag_t ioTag = IO_TAG_NONE;
     for (int i = 0; i < USABLE_TIMER_CHANNEL_COUNT; i++) {
@@ -59,14 +65,20 @@ bool isTransponderIrReady(void)
     return !transponderIrDataTransferInProgress;
 }
 
-static uint16_t dmaBufferOffset;
-
+// the buffer is only rebuilt when the code changes, every transmission after that just restarts the DMA
 void updateTransponderDMABuffer(const uint8_t* transponderData)
 {
+    uint16_t dmaBufferOffset = 0;
     uint8_t byteIndex;
     uint8_t bitIndex;
     uint8_t toggleIndex;
 
+    if (transponderDataEncoded && memcmp(encodedTransponderData, transponderData, TRANSPONDER_DATA_LENGTH) == 0) {
+        return;
+    }
+    memcpy(encodedTransponderData, transponderData, TRANSPONDER_DATA_LENGTH);
+    transponderDataEncoded = true;
+
     for (byteIndex = 0; byteIndex < TRANSPONDER_DATA_LENGTH; byteIndex++) {
 
         uint8_t byteToSend = *transponderData;
@@ -118,8 +130,6 @@ void transponderIrTransmit(void)
 {
     transponderIrWaitForTransmitComplete();
 
-    dmaBufferOffset = 0;
-
     transponderIrDataTransferInProgress = 1;
     transponderIrDMAEnable();
 }
@@ -52,6 +52,24 @@ uint16_t current_vtx_channel;
 static IO_t rtc6705DataPin = IO_NONE;
 static IO_t rtc6705LePin = IO_NONE;
 static IO_t rtc6705ClkPin = IO_NONE;
+static bool rtc6705Initialised = false;
+
+/*
+ * Register writes are queued and clocked out a bit at a time by rtc6705_soft_spi_process(), so a channel or power
+ * change never stalls the caller. A frame is 4 address bits, the write bit and 20 data bits, sent LSB first.
+ */
+#define RTC6705_FRAME_BITS      25
+#define RTC6705_ADDRESS_MASK    0x0F
+#define RTC6705_WRITE_BIT       (1 << 4)
+#define RTC6705_DATA_SHIFT      5
+#define RTC6705_QUEUE_SIZE      4   // channel (2 registers) + power + slack
+
+static uint32_t rtc6705Queue[RTC6705_QUEUE_SIZE];
+static uint8_t rtc6705QueueHead;
+static uint8_t rtc6705QueueTail;
+
+static uint32_t rtc6705Frame;
+static uint8_t rtc6705FrameBitsLeft;    // 0 while no frame is being clocked out
 
 void rtc6705_soft_spi_init(void)
 {
@@ -67,46 +85,74 @@ void rtc6705_soft_spi_init(void)
 
     IOInit(rtc6705ClkPin, OWNER_SPI_SCK, RESOURCE_SOFT_OFFSET);
     IOConfigGPIO(rtc6705ClkPin, IOCFG_OUT_PP);
+
+    RTC6705_SPILE_ON;
+    RTC6705_SPICLK_OFF;
+    rtc6705Initialised = true;
 }
 
+// a write to a register that is still waiting in the queue replaces it, only the latest value is sent
 static void rtc6705_write_register(uint8_t addr, uint32_t data)
 {
-    uint8_t i;
-
-    RTC6705_SPILE_OFF;
-    delay(1);
-    // send address
-    for (i=0; i<4; i++) {
-        if ((addr >> i) & 1)
-            RTC6705_SPIDATA_ON;
-        else
-            RTC6705_SPIDATA_OFF;
-
-        RTC6705_SPICLK_ON;
-        delay(1);
-        RTC6705_SPICLK_OFF;
-        delay(1);
+    const uint32_t frame = (addr & RTC6705_ADDRESS_MASK) | RTC6705_WRITE_BIT | (data << RTC6705_DATA_SHIFT);
+
+    if (!rtc6705Initialised) {
+        return;
+    }
+
+    for (uint8_t i = rtc6705QueueTail; i != rtc6705QueueHead; i = (i + 1) % RTC6705_QUEUE_SIZE) {
+        if ((rtc6705Queue[i] & RTC6705_ADDRESS_MASK) == (addr & RTC6705_ADDRESS_MASK)) {
+            rtc6705Queue[i] = frame;
+            return;
+        }
     }
-    // Write bit
 
-    RTC6705_SPIDATA_ON;
+    const uint8_t next = (rtc6705QueueHead + 1) % RTC6705_QUEUE_SIZE;
+    if (next == rtc6705QueueTail) {
+        return;
+    }
+    rtc6705Queue[rtc6705QueueHead] = frame;
+    rtc6705QueueHead = next;
+}
+
+bool rtc6705_soft_spi_busy(void)
+{
+    return rtc6705FrameBitsLeft || rtc6705QueueHead != rtc6705QueueTail;
+}
+
+/*
+ * Clocks out the next bit of the pending register writes, the whole bit takes about 2us. Returns true while there
+ * is more to send, the caller decides how many bits it can afford per call.
+ */
+bool rtc6705_soft_spi_process(void)
+{
+    if (!rtc6705FrameBitsLeft) {
+        if (rtc6705QueueHead == rtc6705QueueTail) {
+            return false;
+        }
+        rtc6705Frame = rtc6705Queue[rtc6705QueueTail];
+        rtc6705QueueTail = (rtc6705QueueTail + 1) % RTC6705_QUEUE_SIZE;
+        rtc6705FrameBitsLeft = RTC6705_FRAME_BITS;
+        RTC6705_SPILE_OFF;
+    }
+
+    if (rtc6705Frame & 1) {
+        RTC6705_SPIDATA_ON;
+    } else {
+        RTC6705_SPIDATA_OFF;
+    }
+    delayMicroseconds(1);
     RTC6705_SPICLK_ON;
-    delay(1);
+    delayMicroseconds(1);
     RTC6705_SPICLK_OFF;
-    delay(1);
-    for (i=0; i<20; i++) {
-        if ((data >> i) & 1)
-            RTC6705_SPIDATA_ON;
-        else
-            RTC6705_SPIDATA_OFF;
-        RTC6705_SPICLK_ON;
-        delay(1);
-        RTC6705_SPICLK_OFF;
-        delay(1);
+
+    rtc6705Frame >>= 1;
+    if (--rtc6705FrameBitsLeft == 0) {
+        RTC6705_SPILE_ON;
     }
-    RTC6705_SPILE_ON;
-}
 
+    return rtc6705_soft_spi_busy();
+}
 
 void rtc6705_soft_spi_set_channel(uint16_t channel_freq)
 {
@@ -35,4 +35,6 @@ extern uint16_t current_vtx_channel;
 void rtc6705_soft_spi_init(void);
 void rtc6705_soft_spi_set_channel(uint16_t channel_freq);
 void rtc6705_soft_spi_set_rf_power(uint8_t reduce_power);
+bool rtc6705_soft_spi_busy(void);
+bool rtc6705_soft_spi_process(void);
 
@@ -76,6 +76,8 @@
 #include "rx/rx.h"
 #include "rx/rx_spi.h"
 
+#include "scheduler/scheduler.h"
+
 #include "telemetry/telemetry.h"
 
 #include "flight/mixer.h"
@@ -170,8 +172,11 @@ static void resetPidProfile(pidProfile_t *pidProfile)
     pidProfile->yaw_lpf_hz = 0;
     pidProfile->rollPitchItermIgnoreRate = 200;
     pidProfile->yawItermIgnoreRate = 55;
+    pidProfile->itermRelax = ITERM_RELAX_OFF;
+    pidProfile->itermRelaxCutoff = 15;
     pidProfile->dterm_filter_type = FILTER_BIQUAD;
     pidProfile->dterm_lpf_hz = 100;    // filtering ON by default
+    pidProfile->dterm_lpf_max_hz = 0;
     pidProfile->dterm_notch_hz = 260;
     pidProfile->dterm_notch_cutoff = 160;
     pidProfile->vbatPidCompensation = 0;
@@ -179,6 +184,8 @@ static void resetPidProfile(pidProfile_t *pidProfile)
     pidProfile->levelAngleLimit = 70.0f;    // 70 degrees
     pidProfile->setpointRelaxRatio = 30;
     pidProfile->dtermSetpointWeight = 200;
+    pidProfile->feedForwardWeight = 0;
+    pidProfile->feedForwardLpfHz = 40;
     pidProfile->yawRateAccelLimit = 20.0f;
     pidProfile->rateAccelLimit = 0.0f;
     pidProfile->itermThrottleThreshold = 350;
@@ -280,6 +287,8 @@ void resetMotorConfig(motorConfig_t *motorConfig)
     motorConfig->maxthrottle = 2000;
     motorConfig->mincommand = 1000;
     motorConfig->digitalIdleOffsetPercent = 3.0f;
+    motorConfig->motorPoleCount = 14;
+    motorConfig->thrustLinearization = 0;
 
     int motorIndex = 0;
     for (int i = 0; i < USABLE_TIMER_CHANNEL_COUNT && motorIndex < MAX_SUPPORTED_MOTORS; i++) {
@@ -310,6 +319,7 @@ void resetsdcardConfig(sdcardConfig_t *sdcardConfig)
 #else
     sdcardConfig->useDma = false;
 #endif
+    sdcardConfig->benchmark = false;
 }
 #endif
 
@@ -617,12 +627,31 @@ void createDefaultConfig(master_t *config)
     config->gyroConfig.gyro_soft_notch_cutoff_1 = 300;
     config->gyroConfig.gyro_soft_notch_hz_2 = 200;
     config->gyroConfig.gyro_soft_notch_cutoff_2 = 100;
+    config->gyroConfig.gyro_use_dma = 1;
+    config->gyroConfig.gyro_use_fifo = 0;
+    config->gyroConfig.gyro_phase_lock = 0;
+    config->gyroConfig.gyro_soft_notch_dynamic = 0;
+    config->gyroConfig.gyro_rpm_notch_harmonics = 0;
+    config->gyroConfig.gyro_rpm_notch_min_hz = 100;
+    config->gyroConfig.gyro_rpm_notch_q = 500;
+    config->pidConfig.pid_in_interrupt = 0;
+    config->pidConfig.loop_rate_auto = 0;
+    config->pidConfig.loop_rate_headroom = 30;
+
+    config->taskSheddingConfig.overloadPercent = 100;
+    config->taskSheddingConfig.recoverPercent = 60;
+    config->taskSheddingConfig.task[TASK_SHED_LEDSTRIP] = (taskShedConfig_t){ .minRateHz = 10, .priority = 4 };
+    config->taskSheddingConfig.task[TASK_SHED_DASHBOARD] = (taskShedConfig_t){ .minRateHz = 2, .priority = 3 };
+    config->taskSheddingConfig.task[TASK_SHED_TELEMETRY] = (taskShedConfig_t){ .minRateHz = 100, .priority = 2 };
+    config->taskSheddingConfig.task[TASK_SHED_OSD] = (taskShedConfig_t){ .minRateHz = 15, .priority = 1 };
 
     config->debug_mode = DEBUG_MODE;
+    config->idle_sleep = 0;
 
     resetAccelerometerTrims(&config->accelerometerConfig.accZero);
 
     config->gyroConfig.gyro_align = ALIGN_DEFAULT;
+    config->gyroConfig.gyro_2_align = ALIGN_DEFAULT;
     config->accelerometerConfig.acc_align = ALIGN_DEFAULT;
     config->compassConfig.mag_align = ALIGN_DEFAULT;
 
@@ -632,6 +661,10 @@ void createDefaultConfig(master_t *config)
     config->accelerometerConfig.acc_hardware = ACC_DEFAULT;     // default/autodetect
     config->rcControlsConfig.yaw_control_direction = 1;
     config->gyroConfig.gyroMovementCalibrationThreshold = 32;
+    config->gyroConfig.gyro_cal_stored_bias = 1;
+    config->gyroConfig.gyro_to_use = GYRO_CONFIG_USE_GYRO_BOTH;
+    config->gyroConfig.gyro_fusion = GYRO_FUSION_HEALTH;
+    config->gyroConfig.gyro_overflow_response = GYRO_OVERFLOW_RESPONSE_ITERM;
 
     // xxx_hardware: 0:default/autodetect, 1: disable
     config->compassConfig.mag_hardware = 1;
@@ -671,6 +704,7 @@ void createDefaultConfig(master_t *config)
 #else
     config->rxConfig.serialrx_provider = 0;
 #endif
+    config->rxConfig.serialrx_provider2 = SERIALRX_NONE;
     config->rxConfig.rx_spi_protocol = RX_SPI_DEFAULT_PROTOCOL;
     config->rxConfig.sbus_inversion = 1;
     config->rxConfig.spektrum_sat_bind = 0;
@@ -694,6 +728,7 @@ void createDefaultConfig(master_t *config)
     config->rxConfig.rcInterpolationInterval = 19;
     config->rxConfig.fpvCamAngleDegrees = 0;
     config->rxConfig.max_aux_channel = MAX_AUX_CHANNELS;
+    config->rxConfig.rx_loss_frames = 10;
     config->rxConfig.airModeActivateThreshold = 1350;
 
     resetAllRxChannelRangeConfigurations(config->rxConfig.channelRanges);
@@ -728,6 +763,7 @@ void createDefaultConfig(master_t *config)
     config->gpsConfig.sbasMode = SBAS_AUTO;
     config->gpsConfig.autoConfig = GPS_AUTOCONFIG_ON;
     config->gpsConfig.autoBaud = GPS_AUTOBAUD_OFF;
+    config->gpsConfig.ubloxNavRate = GPS_UBLOX_NAV_RATE_5HZ;
 #endif
 
     resetSerialConfig(&config->serialConfig);
@@ -819,6 +855,13 @@ void createDefaultConfig(master_t *config)
     config->blackboxConfig.rate_num = 1;
     config->blackboxConfig.rate_denom = 1;
     config->blackboxConfig.on_motor_test = 0; // default off
+    config->blackboxConfig.fields_disabled_mask = 0; // log every field group
+    config->blackboxConfig.fast_stream = 0;
+    config->blackboxConfig.compression = 0;
+    config->blackboxConfig.flash_ring = 0;
+    config->blackboxConfig.capture = 0;
+    config->blackboxConfig.capture_crash_rate = 1900;    // close to the 2000deg/s of gyro range, a hit that saturates it
+    config->blackboxConfig.serial_flow_control = 0;
 #endif // BLACKBOX
 
 #ifdef SERIALRX_UART
@@ -860,6 +903,54 @@ static void resetConf(void)
 void activateControlRateConfig(void)
 {
     generateThrottleCurve(currentControlRateProfile, &masterConfig.motorConfig);
+#ifdef USE_RC_RATE_TABLE
+    generateRateCurves(currentControlRateProfile);
+#endif
+}
+
+// after a switch from the previous rate profile, only the curves built from settings that differ are generated again
+static void activateControlRateConfigChanges(const controlRateConfig_t *previous)
+{
+    if (previous->thrMid8 != currentControlRateProfile->thrMid8 || previous->thrExpo8 != currentControlRateProfile->thrExpo8) {
+        generateThrottleCurve(currentControlRateProfile, &masterConfig.motorConfig);
+    }
+#ifdef USE_RC_RATE_TABLE
+    if (previous->rcRate8 != currentControlRateProfile->rcRate8 || previous->rcYawRate8 != currentControlRateProfile->rcYawRate8
+        || previous->rcExpo8 != currentControlRateProfile->rcExpo8 || previous->rcYawExpo8 != currentControlRateProfile->rcYawExpo8
+        || memcmp(previous->rates, currentControlRateProfile->rates, sizeof(previous->rates))) {
+        generateRateCurves(currentControlRateProfile);
+    }
+#endif
+}
+
+static bool pidProfileFiltersDiffer(const pidProfile_t *a, const pidProfile_t *b)
+{
+    return a->dterm_filter_type != b->dterm_filter_type || a->dterm_lpf_hz != b->dterm_lpf_hz || a->dterm_lpf_max_hz != b->dterm_lpf_max_hz
+        || a->yaw_lpf_hz != b->yaw_lpf_hz || a->dterm_notch_hz != b->dterm_notch_hz || a->dterm_notch_cutoff != b->dterm_notch_cutoff
+        || a->feedForwardLpfHz != b->feedForwardLpfHz;
+}
+
+/*
+ * Points the subsystems that use the PID profile at the current one after a switch from previous. The gains are
+ * cheap to work out again, the PID filters are only initialised again, losing their state, when their settings
+ * differ, so a switch in flight between profiles that only differ in gains leaves the loop undisturbed.
+ */
+static void activateProfileChanges(const profile_t *previous)
+{
+    pidProfile_t *pidProfile = &currentProfile->pidProfile;
+
+    pidInitConfig(pidProfile);
+    if (pidProfileFiltersDiffer(&previous->pidProfile, pidProfile)) {
+        pidInitFilters(pidProfile);
+    }
+    activateControlRateConfigChanges(&previous->controlRateProfile[previous->activeRateProfile]);
+
+    useRcControlsConfig(modeActivationProfile()->modeActivationConditions, &masterConfig.motorConfig, pidProfile);
+#ifdef GPS
+    gpsUsePIDs(pidProfile);
+#endif
+    imuConfigure(&masterConfig.imuConfig, pidProfile, throttleCorrectionConfig()->throttle_correction_angle);
+    configureAltitudeHold(pidProfile, &masterConfig.barometerConfig, &masterConfig.rcControlsConfig, &masterConfig.motorConfig);
 }
 
 void activateConfig(void)
@@ -885,6 +976,7 @@ void activateConfig(void)
 
     useFailsafeConfig(&masterConfig.failsafeConfig);
     setAccelerationTrims(&accelerometerConfig()->accZero);
+    setGyroBiasTable(gyroConfig()->gyroBias);
     setAccelerationFilter(accelerometerConfig()->acc_lpf_hz);
 
     mixerUseConfigs(
@@ -1061,11 +1153,38 @@ void resetEEPROM(void)
     writeEEPROM();
 }
 
+static bool saveConfigNotifyPending;
+
+// queues a background save, TASK_CONFIG_SAVE only runs while one is in progress
+void writeConfigDeferred(void)
+{
+    writeEEPROMDeferred();
+    setTaskEnabled(TASK_CONFIG_SAVE, true);
+}
+
+// the save is queued, processDeferredConfigSave() loads the config and beeps once it is written
 void saveConfigAndNotify(void)
 {
-    writeEEPROM();
-    readEEPROM();
-    beeperConfirmationBeeps(1);
+    writeConfigDeferred();
+    saveConfigNotifyPending = true;
+}
+
+void processDeferredConfigSave(void)
+{
+    // erasing the config area stalls the core, once the log fills up that waits until disarmed
+    const eepromWriteStatus_e status = processDeferredEEPROMWrite(!ARMING_FLAG(ARMED));
+
+    if (status == EEPROM_WRITE_COMPLETE && saveConfigNotifyPending) {
+        saveConfigNotifyPending = false;
+        readEEPROM();
+        beeperConfirmationBeeps(1);
+    } else if (status == EEPROM_WRITE_FAILED) {
+        saveConfigNotifyPending = false;
+    }
+
+    if (status != EEPROM_WRITE_PENDING && status != EEPROM_WRITE_WAITING_FOR_ERASE) {
+        setTaskEnabled(TASK_CONFIG_SAVE, false);
+    }
 }
 
 void changeProfile(uint8_t profileIndex)
@@ -1073,9 +1192,16 @@ void changeProfile(uint8_t profileIndex)
     if (profileIndex >= MAX_PROFILE_COUNT) {
         profileIndex = MAX_PROFILE_COUNT - 1;
     }
+    if (profileIndex == getCurrentProfile()) {
+        beeperConfirmationBeeps(profileIndex + 1);
+        return;
+    }
+    const profile_t *previous = currentProfile;
     masterConfig.current_profile_index = profileIndex;
-    writeEEPROM();
-    readEEPROM();
+    setProfile(profileIndex);
+    activateProfileChanges(previous);
+    // the selection is kept over a reboot, the save happens in the background
+    writeConfigDeferred();
     beeperConfirmationBeeps(profileIndex + 1);
 }
 
@@ -1084,8 +1210,9 @@ void changeControlRateProfile(uint8_t profileIndex)
     if (profileIndex >= MAX_RATEPROFILES) {
         profileIndex = MAX_RATEPROFILES - 1;
     }
+    const controlRateConfig_t *previous = currentControlRateProfile;
     setControlRateProfile(profileIndex);
-    activateControlRateConfig();
+    activateControlRateConfigChanges(previous);
 }
 
 void beeperOffSet(uint32_t mask)
@@ -72,7 +72,9 @@ void copyCurrentProfileToProfileSlot(uint8_t profileSlotIndex);
 void resetEEPROM(void);
 void ensureEEPROMContainsValidData(void);
 
+void writeConfigDeferred(void);
 void saveConfigAndNotify(void);
+void processDeferredConfigSave(void);
 void validateAndFixConfig(void);
 void validateAndFixGyroConfig(void);
 void activateConfig(void);
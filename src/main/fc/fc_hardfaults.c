@@ -25,6 +25,8 @@
 
 #include "fc/fc_init.h"
 
+#include "fc/post_mortem.h"
+
 #include "flight/mixer.h"
 
 #ifdef DEBUG_HARDFAULTS
@@ -87,9 +89,30 @@ void hard_fault_handler_c(unsigned long *hardfault_args)
   __asm("BKPT #0\n") ; // Break into the debugger
 }
 
+#else
+#ifdef USE_POST_MORTEM
+void hardFaultHandler(const uint32_t *faultFrame);
+
+// passes the registers stacked by the fault, from whichever stack they went to, to hardFaultHandler()
+__attribute__((naked)) void HardFault_Handler(void)
+{
+    __asm volatile (
+        "tst lr, #4\n"
+        "ite eq\n"
+        "mrseq r0, msp\n"
+        "mrsne r0, psp\n"
+        "b hardFaultHandler\n"
+    );
+}
+
+void hardFaultHandler(const uint32_t *faultFrame)
 #else
 void HardFault_Handler(void)
+#endif
 {
+#ifdef USE_POST_MORTEM
+    postMortemCapture(POST_MORTEM_HARD_FAULT, faultFrame);
+#endif
     LED2_ON;
 
     // fall out of the sky
@@ -108,6 +131,10 @@ void HardFault_Handler(void)
     LED1_OFF;
     LED0_OFF;
 
+#ifdef USE_POST_MORTEM
+    // the record only survives a reset, power cycling would lose it
+    systemReset();
+#endif
     while (1) {
 #ifdef LED2
         delay(50);
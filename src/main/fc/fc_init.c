@@ -35,6 +35,7 @@
 #include "drivers/sensor.h"
 #include "drivers/system.h"
 #include "drivers/dma.h"
+#include "drivers/stack_check.h"
 #include "drivers/io.h"
 #include "drivers/light_led.h"
 #include "drivers/sound_beeper.h"
@@ -67,9 +68,13 @@
 #include "fc/fc_init.h"
 #include "fc/fc_msp.h"
 #include "fc/fc_tasks.h"
+#include "fc/loop_rate.h"
+#include "fc/post_mortem.h"
 #include "fc/rc_controls.h"
 #include "fc/runtime_config.h"
 
+#include "msc/usb_msc.h"
+
 #include "msp/msp_serial.h"
 
 #include "rx/rx.h"
@@ -86,6 +91,7 @@
 #include "io/ledstrip.h"
 #include "io/dashboard.h"
 #include "io/asyncfatfs/asyncfatfs.h"
+#include "io/sdcard_profiler.h"
 #include "io/serial_cli.h"
 #include "io/transponder_ir.h"
 #include "io/osd.h"
@@ -140,7 +146,10 @@ extern uint8_t motorControlEnable;
 serialPort_t *loopbackPort;
 #endif
 
+#define SENSOR_POWER_UP_MS 100
+
 uint8_t systemState = SYSTEM_STATE_INITIALISING;
+bootTimes_t bootTimes;
 
 void processLoopback(void)
 {
@@ -155,8 +164,38 @@ void processLoopback(void)
 #endif
 }
 
+#ifdef USE_USB_MSC
+// Bring up just the log storage and hand it to the host as a USB drive, doesn't return
+static void mscBoot(void)
+{
+#ifdef USE_SDCARD
+    if (feature(FEATURE_SDCARD)) {
+        sdcardInsertionDetectInit();
+        sdcard_init(sdcardConfig()->useDma);
+
+        mscStart(MSC_STORAGE_SDCARD);
+    }
+#endif
+
+#ifdef USE_FLASHFS
+#if defined(USE_FLASH_M25P16)
+    m25p16_init(flashConfig());
+#endif
+    flashfsInit();
+
+    mscStart(MSC_STORAGE_FLASHFS);
+#endif
+}
+#endif
+
 void init(void)
 {
+    initialiseMemorySections();
+    stackPaint();
+#ifdef USE_POST_MORTEM
+    postMortemInit();
+#endif
+
 #ifdef USE_HAL_DRIVER
     HAL_Init();
 #endif
@@ -185,7 +224,9 @@ void init(void)
 
     //i2cSetOverclock(masterConfig.i2c_overclock);
 
+#ifdef USE_DEBUG_MODES
     debugMode = masterConfig.debug_mode;
+#endif
 
     // Latch active features to be used for feature() in the remainder of init().
     latchActiveFeatures();
@@ -251,8 +292,6 @@ void init(void)
     }
 #endif
 
-    delay(100);
-
     timerInit();  // timer must be initialized before any channel is allocated
 
 #if defined(AVOID_UART1_FOR_PWM_PPM)
@@ -339,6 +378,13 @@ void init(void)
     #endif
 #endif
 
+#ifdef USE_USB_MSC
+    // Has to happen before MSP opens the USB port as a VCP
+    if (systemCheckMscRequest()) {
+        mscBoot();
+    }
+#endif
+
 #ifdef USE_HARDWARE_REVISION_DETECTION
     updateHardwareRevision();
 #endif
@@ -405,6 +451,9 @@ void init(void)
 #else
     const void *sonarConfig = NULL;
 #endif
+    // the sensors get this long after power on to start up, the init above counts towards it
+    while (millis() < SENSOR_POWER_UP_MS);
+
     if (!sensorsAutodetect(gyroConfig(), accelerometerConfig(), compassConfig(), barometerConfig(), sonarConfig)) {
         // if gyro was not detected due to whatever reason, we give up now.
         failureMode(FAILURE_MISSING_ACC);
@@ -412,26 +461,21 @@ void init(void)
 
     systemState |= SYSTEM_STATE_SENSORS_READY;
 
-    LED1_ON;
     LED0_OFF;
+    LED1_OFF;
     LED2_OFF;
 
-    for (int i = 0; i < 10; i++) {
-        LED1_TOGGLE;
-        LED0_TOGGLE;
-        delay(25);
-        if (!(getBeeperOffMask() & (1 << (BEEPER_SYSTEM_INIT - 1)))) BEEP_ON;
-        delay(25);
-        BEEP_OFF;
+    // needs the gyro data ready interrupt, so only once the gyro is running
+    if (motorConfig()->useSyncedOutput && gyro.dev.exti.fn && pwmEnableSyncedMotorOutput()) {
+        gyro.dev.sampleCallback = pwmSyncedMotorOutput;
     }
-    LED0_OFF;
-    LED1_OFF;
 
     // gyro.targetLooptime set in sensorsAutodetect(), so we are ready to call pidSetTargetLooptime()
     pidSetTargetLooptime((gyro.targetLooptime + LOOPTIME_SUSPEND_TIME) * pidConfig()->pid_process_denom); // Initialize pid looptime
     pidInitFilters(&currentProfile->pidProfile);
     pidInitConfig(&currentProfile->pidProfile);
 
+    trigLutInit();
     imuInit();
 
     mspFcInit();
@@ -508,6 +552,9 @@ void init(void)
         sdcardInsertionDetectInit();
         sdcard_init(sdcardConfig()->useDma);
         afatfs_init();
+#ifdef USE_SDCARD_PROFILER
+        sdcardProfilerInit(sdcardConfig()->benchmark);
+#endif
     }
 #endif
 
@@ -568,6 +615,15 @@ void init(void)
     motorControlEnable = true;
 
     fcTasksInit();
+#ifdef USE_LOOP_RATE_AUTO
+    if (pidConfig()->loop_rate_auto) {
+        loopRateAutoStart(micros());
+    }
+#endif
     systemState |= SYSTEM_STATE_READY;
+    bootTimes.initComplete = millis();
+
+    // the beeper task plays it, flashing the warning LED along
+    beeper(BEEPER_SYSTEM_INIT);
 }
 
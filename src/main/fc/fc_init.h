@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "common/time.h"
+
 typedef enum {
     SYSTEM_STATE_INITIALISING   = 0,
     SYSTEM_STATE_CONFIG_LOADED  = (1 << 0),
@@ -28,5 +30,13 @@ typedef enum {
 
 extern uint8_t systemState;
 
+// milliseconds since power on, reported by the CLI status command
+typedef struct bootTimes_s {
+    timeMs_t initComplete;      // the scheduler takes over
+    timeMs_t readyToArm;        // the sensors have calibrated, 0 until then
+} bootTimes_t;
+
+extern bootTimes_t bootTimes;
+
 void init(void);
 void processLoopback(void);
@@ -20,9 +20,12 @@
 
 #include "platform.h"
 
+#include "build/atomic.h"
 #include "build/debug.h"
+#include "build/profile.h"
 
 #include "blackbox/blackbox.h"
+#include "blackbox/blackbox_capture.h"
 
 #include "common/maths.h"
 #include "common/axis.h"
@@ -30,8 +33,10 @@
 #include "common/filter.h"
 
 #include "drivers/light_led.h"
+#include "drivers/nvic.h"
 #include "drivers/system.h"
 #include "drivers/gyro_sync.h"
+#include "drivers/pwm_output.h"
 
 #include "sensors/sensors.h"
 #include "sensors/boardalignment.h"
@@ -40,6 +45,8 @@
 #include "sensors/battery.h"
 
 #include "fc/config.h"
+#include "fc/fc_init.h"
+#include "fc/loop_latency.h"
 #include "fc/rc_controls.h"
 #include "fc/rc_curves.h"
 #include "fc/runtime_config.h"
@@ -52,19 +59,20 @@
 #include "io/serial.h"
 #include "io/serial_cli.h"
 #include "io/statusindicator.h"
-#include "io/transponder_ir.h"
-#include "io/asyncfatfs/asyncfatfs.h"
 
 #include "rx/rx.h"
 
 #include "scheduler/scheduler.h"
+#include "scheduler/scheduler_trace.h"
 
 #include "flight/mixer.h"
 #include "flight/servos.h"
 #include "flight/pid.h"
 #include "flight/failsafe.h"
 #include "flight/altitudehold.h"
+#include "flight/imu.h"
 
+#include "config/config_eeprom.h"
 #include "config/config_profile.h"
 #include "config/config_master.h"
 #include "config/feature.h"
@@ -97,7 +105,7 @@ static float throttlePIDAttenuation;
 uint16_t filteredCycleTime;
 bool isRXDataNew;
 static bool armingCalibrationWasInitialised;
-static float setpointRate[3], rcDeflection[3], rcDeflectionAbs[3];
+static float setpointRate[3], setpointRateDerivative[3], rcDeflection[3], rcDeflectionAbs[3];
 
 float getThrottlePIDAttenuation(void) {
     return throttlePIDAttenuation;
@@ -107,6 +115,10 @@ float getSetpointRate(int axis) {
     return setpointRate[axis];
 }
 
+float getSetpointRateDerivative(int axis) {
+    return setpointRateDerivative[axis];
+}
+
 float getRcDeflection(int axis) {
     return rcDeflection[axis];
 }
@@ -136,40 +148,39 @@ bool isCalibrating()
     return (!isAccelerationCalibrationComplete() && sensors(SENSOR_ACC)) || (!isGyroCalibrationComplete());
 }
 
-#define RC_RATE_INCREMENTAL 14.54f
+static float rcCommandToAngleRate(int axis, int16_t rc) {
+#ifdef USE_RC_RATE_TABLE
+    const float angleRate = rcLookupRate(axis, rc);
+#else
+    const float angleRate = rcCalculateRate(currentControlRateProfile, axis, rc / 500.0f);
+#endif
+    return constrainf(angleRate, -1998.0f, 1998.0f); // Rate limit protection (deg/sec)
+}
 
 void calculateSetpointRate(int axis, int16_t rc) {
-    float angleRate, rcRate, rcSuperfactor, rcCommandf;
-    uint8_t rcExpo;
-
-    if (axis != YAW) {
-        rcExpo = currentControlRateProfile->rcExpo8;
-        rcRate = currentControlRateProfile->rcRate8 / 100.0f;
-    } else {
-        rcExpo = currentControlRateProfile->rcYawExpo8;
-        rcRate = currentControlRateProfile->rcYawRate8 / 100.0f;
-    }
+    const float rcCommandf = rc / 500.0f;
 
-    if (rcRate > 2.0f) rcRate = rcRate + (RC_RATE_INCREMENTAL * (rcRate - 2.0f));
-    rcCommandf = rc / 500.0f;
     rcDeflection[axis] = rcCommandf;
     rcDeflectionAbs[axis] = ABS(rcCommandf);
 
-    if (rcExpo) {
-        float expof = rcExpo / 100.0f;
-        rcCommandf = rcCommandf * power3(rcDeflection[axis]) * expof + rcCommandf * (1-expof);
-    }
-
-    angleRate = 200.0f * rcRate * rcCommandf;
+    setpointRate[axis] = rcCommandToAngleRate(axis, rc);
 
-    if (currentControlRateProfile->rates[axis]) {
-        rcSuperfactor = 1.0f / (constrainf(1.0f - (ABS(rcCommandf) * (currentControlRateProfile->rates[axis] / 100.0f)), 0.01f, 1.00f));
-        angleRate *= rcSuperfactor;
-    }
+    DEBUG_SET(DEBUG_ANGLERATE, axis, setpointRate[axis]);
+}
 
-    DEBUG_SET(DEBUG_ANGLERATE, axis, angleRate);
+/*
+ * Slope of the setpoint between the two latest RX frames in deg/s/s, timed by the measured frame interval. The
+ * interpolated setpoint follows this slope between frames, so the feed forward sees a steady value through the
+ * frame rather than a spike on each PID cycle the setpoint happens to move.
+ */
+static void updateSetpointRateDerivative(uint16_t frameIntervalUs) {
+    static float frameSetpointRate[3];
 
-    setpointRate[axis] = constrainf(angleRate, -1998.0f, 1998.0f); // Rate limit protection (deg/sec)
+    for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+        const float angleRate = rcCommandToAngleRate(axis, rcCommand[axis]);
+        setpointRateDerivative[axis] = (angleRate - frameSetpointRate[axis]) * 1000000.0f / frameIntervalUs;
+        frameSetpointRate[axis] = angleRate;
+    }
 }
 
 void scaleRcCommandToFpvCamAngle(void) {
@@ -210,6 +221,39 @@ void scaleRcCommandToFpvCamAngle(void) {
         pidResetErrorGyroState();
 }
 
+/*
+ * Predictive RC smoothing. Rather than stepping from the previous frame towards the newest one, which
+ * trails the stick by a frame, the roll, pitch and yaw commands are carried forward from the newest frame
+ * along the smoothed rate of change of the recent frames, for at most one frame interval.
+ * Throttle is held at the newest frame, an overshoot there is felt more than the lag.
+ */
+static void extrapolateRcCommand(bool isNewFrame, int16_t cyclesPerFrame)
+{
+    static int16_t latestCommand[3];
+    static int16_t frameStep[3];
+    static int16_t cycle;
+
+    if (cyclesPerFrame == 0) {
+        // no frame received yet, so the frame period is unknown, pass the raw command through
+        return;
+    }
+
+    if (isNewFrame) {
+        for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+            // average with the previous step so a single noisy frame does not throw the prediction
+            frameStep[axis] = (frameStep[axis] + rcCommand[axis] - latestCommand[axis]) / 2;
+            latestCommand[axis] = rcCommand[axis];
+        }
+        cycle = 0;
+    } else if (cycle < cyclesPerFrame) {
+        cycle++;
+    }
+
+    for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+        rcCommand[axis] = constrain(latestCommand[axis] + frameStep[axis] * cycle / cyclesPerFrame, -500, 500);
+    }
+}
+
 void processRcCommand(void)
 {
     static int16_t lastCommand[4] = { 0, 0, 0, 0 };
@@ -220,8 +264,11 @@ void processRcCommand(void)
     bool readyToCalculateRate = false;
 
     if (isRXDataNew) {
-        currentRxRefreshRate = constrain(getTaskDeltaTime(TASK_RX),1000,20000);
+        // prefer the interval measured between frame ends by the RX driver, it is free of scheduler jitter
+        const timeDelta_t frameDelta = rxGetFrameDelta();
+        currentRxRefreshRate = constrain(frameDelta ? frameDelta : (timeDelta_t)getTaskDeltaTime(TASK_RX), 1000, 20000);
         checkForThrottleErrorResetState(currentRxRefreshRate);
+        updateSetpointRateDerivative(currentRxRefreshRate);
     }
 
     if (rxConfig()->rcInterpolation || flightModeFlags) {
@@ -233,6 +280,9 @@ void processRcCommand(void)
             case(RC_SMOOTHING_MANUAL):
                 rxRefreshRate = 1000 * rxConfig()->rcInterpolationInterval;
                 break;
+            case(RC_SMOOTHING_PREDICTIVE):
+                rxRefreshRate = currentRxRefreshRate; // extrapolating past the next frame would overshoot
+                break;
             case(RC_SMOOTHING_OFF):
             case(RC_SMOOTHING_DEFAULT):
             default:
@@ -246,7 +296,12 @@ void processRcCommand(void)
                 for (int axis = 0; axis < 2; axis++) debug[axis] = rcCommand[axis];
                 debug[3] = rxRefreshRate;
             }
+        }
 
+        if (rxConfig()->rcInterpolation == RC_SMOOTHING_PREDICTIVE) {
+            extrapolateRcCommand(isRXDataNew, rcInterpolationFactor);
+            factor = 0;
+        } else if (isRXDataNew) {
             for (int channel=0; channel < 4; channel++) {
                 deltaRC[channel] = rcCommand[channel] -  (lastCommand[channel] - deltaRC[channel] * factor / rcInterpolationFactor);
                 lastCommand[channel] = rcCommand[channel];
@@ -337,8 +392,8 @@ void updateRcCommands(void)
 
     if (FLIGHT_MODE(HEADFREE_MODE)) {
         const float radDiff = degreesToRadians(DECIDEGREES_TO_DEGREES(attitude.values.yaw) - headFreeModeHold);
-        const float cosDiff = cos_approx(radDiff);
-        const float sinDiff = sin_approx(radDiff);
+        const float cosDiff = cos_lut(radDiff);
+        const float sinDiff = sin_lut(radDiff);
         const int16_t rcCommand_PITCH = rcCommand[PITCH] * cosDiff + rcCommand[ROLL] * sinDiff;
         rcCommand[ROLL] = rcCommand[ROLL] * cosDiff - rcCommand[PITCH] * sinDiff;
         rcCommand[PITCH] = rcCommand_PITCH;
@@ -362,6 +417,9 @@ void updateLEDs(void)
             warningLedFlash();
             DISABLE_ARMING_FLAG(OK_TO_ARM);
         } else {
+            if (!bootTimes.readyToArm) {
+                bootTimes.readyToArm = millis();
+            }
             if (ARMING_FLAG(OK_TO_ARM)) {
                 warningLedDisable();
             } else {
@@ -513,6 +571,11 @@ void processRx(timeUs_t currentTimeUs)
 
     updateRSSI(currentTimeUs);
 
+    // the gyro calibration can finish in the gyro interrupt, a changed bias table is saved from here
+    if (!ARMING_FLAG(ARMED) && gyroBiasTableNeedsSave()) {
+        writeConfigDeferred();
+    }
+
     if (feature(FEATURE_FAILSAFE)) {
 
         if (currentTimeUs > FAILSAFE_POWER_ON_DELAY_US && !failsafeIsMonitoring()) {
@@ -689,28 +752,30 @@ void processRx(timeUs_t currentTimeUs)
 #endif
 }
 
-void subTaskPidController(void)
+void subTaskPidController(timeUs_t currentTimeUs)
 {
     uint32_t startTime;
     if (debugMode == DEBUG_PIDLOOP || debugMode == DEBUG_SCHEDULER) {startTime = micros();}
     // PID - note this is function pointer set by setPIDController()
+    PROFILE_BEGIN(PROFILE_PID_CONTROLLER);
     pidController(
         &currentProfile->pidProfile,
         &accelerometerConfig()->accelerometerTrims
     );
+    PROFILE_END(PROFILE_PID_CONTROLLER);
+    imuUpdateGyroAttitude(currentTimeUs);
     if (debugMode == DEBUG_PIDLOOP || debugMode == DEBUG_SCHEDULER) {debug[1] = micros() - startTime;}
+#ifdef USE_LOOP_LATENCY
+    loopLatencyPidComplete(gyro.dev.dataReadyAt);
+#endif
 }
 
-void subTaskMainSubprocesses(void)
+/*
+ * The flight modes and corrections that adjust rcCommand, run by TASK_RC_COMMAND for each RX update once
+ * updateRcCommands() has set rcCommand from rcData.
+ */
+void updateRcCommandModifiers(void)
 {
-
-    const uint32_t startTime = micros();
-
-    // Read out gyro temperature. can use it for something somewhere. maybe get MCU temperature instead? lots of fun possibilities.
-    if (gyro.dev.temperature) {
-        gyro.dev.temperature(&gyro.dev, &telemTemperature1);
-    }
-
 #ifdef MAG
         if (sensors(SENSOR_MAG)) {
             updateMagHold();
@@ -722,8 +787,6 @@ void subTaskMainSubprocesses(void)
 #endif
 
 #if defined(BARO) || defined(SONAR)
-        // updateRcCommands sets rcCommand, which is needed by updateAltHoldState and updateSonarAltHoldState
-        updateRcCommands();
         if (sensors(SENSOR_BARO) || sensors(SENSOR_SONAR)) {
             if (FLIGHT_MODE(BARO_MODE) || FLIGHT_MODE(SONAR_MODE)) {
                 applyAltHold(&masterConfig.airplaneConfig);
@@ -752,8 +815,6 @@ void subTaskMainSubprocesses(void)
         rcCommand[THROTTLE] += calculateThrottleAngleCorrection(throttleCorrectionConfig()->throttle_correction_value);
     }
 
-    processRcCommand();
-
 #ifdef GPS
     if (sensors(SENSOR_GPS)) {
         if ((FLIGHT_MODE(GPS_HOME_MODE) || FLIGHT_MODE(GPS_HOLD_MODE)) && STATE(GPS_FIX_HOME)) {
@@ -761,27 +822,39 @@ void subTaskMainSubprocesses(void)
         }
     }
 #endif
+}
 
-#ifdef USE_SDCARD
-    afatfs_poll();
-#endif
+// Read out gyro temperature for telemetry, once a second keeps the register read off the bus in the loop.
+// It stays on the gyro task, right behind a completed gyro read, rather than in a task of its own that may land on one.
+static void updateGyroTemperature(void)
+{
+    static uint32_t gyroTemperatureReadAt;
+    if (gyro.dev.temperature && (int32_t)(millis() - gyroTemperatureReadAt) >= 0) {
+        gyroTemperatureReadAt = millis() + 1000;
+        gyro.dev.temperature(&gyro.dev, &telemTemperature1);
+    }
+}
 
 #ifdef BLACKBOX
-    if (!cliMode && feature(FEATURE_BLACKBOX)) {
-        handleBlackbox(startTime);
-    }
+bool blackboxUpdatePending;     // a PID update has been made that TASK_BLACKBOX has not logged yet
 #endif
 
-#ifdef TRANSPONDER
-    transponderUpdate(startTime);
+// The per cycle work that follows a PID update, the rest runs in tasks of its own
+static void subTaskPidUpdateFollowUp(void)
+{
+    // interpolate the setpoints for the next PID update
+    processRcCommand();
+
+#ifdef BLACKBOX
+    blackboxUpdatePending = true;
+    schedulerSignalTask(TASK_BLACKBOX);
 #endif
-    DEBUG_SET(DEBUG_PIDLOOP, 2, micros() - startTime);
 }
 
 void subTaskMotorUpdate(void)
 {
-    const uint32_t startTime = micros();
     if (debugMode == DEBUG_CYCLETIME) {
+        const uint32_t startTime = micros();
         static uint32_t previousMotorUpdateTime;
         const uint32_t currentDeltaTime = startTime - previousMotorUpdateTime;
         debug[2] = currentDeltaTime;
@@ -789,21 +862,29 @@ void subTaskMotorUpdate(void)
         previousMotorUpdateTime = startTime;
     }
 
+    PROFILE_BEGIN(PROFILE_MIX_TABLE);
     mixTable(&currentProfile->pidProfile);
-
-#ifdef USE_SERVOS
-    // motor outputs are used as sources for servo mixing, so motors must be calculated using mixTable() before servos.
-    if (isMixerUsingServos()) {
-        servoTable();
-        filterServos();
-        writeServos();
-    }
-#endif
+    PROFILE_END(PROFILE_MIX_TABLE);
 
     if (motorControlEnable) {
+        PROFILE_BEGIN(PROFILE_WRITE_MOTORS);
         writeMotors();
+        PROFILE_END(PROFILE_WRITE_MOTORS);
+#ifdef USE_LOOP_LATENCY
+        loopLatencyMotorOutput(pwmMotorUpdateStartedAt);
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+        if (useDshotTelemetry) {
+            for (int i = 0; i < 4; i++) {
+                DEBUG_SET(DEBUG_DSHOT_RPM, i, getDshotTelemetry(i));
+            }
+        }
+#endif
     }
-    DEBUG_SET(DEBUG_PIDLOOP, 3, micros() - startTime);
+
+#ifdef USE_BLACKBOX_CAPTURE
+    blackboxCaptureSample();
+#endif
 }
 
 uint8_t setPidUpdateCountDown(void)
@@ -815,42 +896,150 @@ uint8_t setPidUpdateCountDown(void)
     }
 }
 
-// Function for loop trigger
-void taskMainPidLoop(timeUs_t currentTimeUs)
+// DEBUG_LOOP_JITTER:
+// 0 - time between gyro loop iterations
+// 1 - deviation of that from the target looptime
+// 2 - largest deviation seen while armed
+// 3 - time spent in gyro -> PID -> motors
+static void updateLoopJitter(timeUs_t currentTimeUs)
 {
-    UNUSED(currentTimeUs);
+    static timeUs_t previousTimeUs;
+    static int16_t maxDeviation;
+
+    if (debugMode != DEBUG_LOOP_JITTER) {
+        return;
+    }
+    if (previousTimeUs) {
+        const timeDelta_t period = cmpTimeUs(currentTimeUs, previousTimeUs);
+        const int16_t deviation = constrain(period - (timeDelta_t)gyro.targetLooptime, INT16_MIN, INT16_MAX);
+        if (ARMING_FLAG(ARMED)) {
+            maxDeviation = MAX(maxDeviation, ABS(deviation));
+        }
+        debug[0] = constrain(period, 0, INT16_MAX);
+        debug[1] = deviation;
+        debug[2] = maxDeviation;
+    }
+    previousTimeUs = currentTimeUs;
+}
+
+#ifdef USE_PID_LOOP_INTERRUPT
+static bool pidLoopInInterrupt = false;
+static volatile uint8_t pidLoopInterruptUpdates;    // incremented for each PID update made by the interrupt
 
-    static bool runTaskMainSubprocesses;
+// Raised by the gyro DMA completion, runs at NVIC_PRIO_PID_LOOP so no scheduler task can delay it
+static void pidLoopInterruptHandler(void)
+{
+    static timeUs_t previousTimeUs;
     static uint8_t pidUpdateCountdown;
 
-    cycleTime = getTaskDeltaTime(TASK_SELF);
+    SCHEDULER_TRACE(SCHEDULER_TRACE_ISR_ENTER, SCHEDULER_TRACE_ISR_PID_LOOP);
+    const timeUs_t currentTimeUs = micros();
+    cycleTime = cmpTimeUs(currentTimeUs, previousTimeUs);
+    previousTimeUs = currentTimeUs;
 
     if (debugMode == DEBUG_CYCLETIME) {
         debug[0] = cycleTime;
         debug[1] = averageSystemLoadPercent;
     }
+    updateLoopJitter(currentTimeUs);
+
+#ifdef USE_LOOP_LATENCY
+    loopLatencyGyroRead(gyro.dev.dataReadyAt);
+#endif
+    PROFILE_BEGIN(PROFILE_GYRO_UPDATE);
+    gyroUpdate();
+    PROFILE_END(PROFILE_GYRO_UPDATE);
 
-    if (runTaskMainSubprocesses) {
-        subTaskMainSubprocesses();
-        runTaskMainSubprocesses = false;
+    if (pidUpdateCountdown) {
+        pidUpdateCountdown--;
+    } else {
+        pidUpdateCountdown = setPidUpdateCountDown();
+        subTaskPidController(currentTimeUs);
+        subTaskMotorUpdate();
+        pidLoopInterruptUpdates++;
     }
+    DEBUG_SET(DEBUG_LOOP_JITTER, 3, micros() - currentTimeUs);
+    SCHEDULER_TRACE(SCHEDULER_TRACE_ISR_EXIT, SCHEDULER_TRACE_ISR_PID_LOOP);
+}
+
+bool pidLoopInterruptInit(void)
+{
+    if (!pidConfig()->pid_in_interrupt || !gyro.dev.dmaEnabled) {
+        return false;
+    }
+    systemSoftIrqInit(pidLoopInterruptHandler, NVIC_PRIO_PID_LOOP);
+    pidLoopInInterrupt = true;
+    gyro.dev.dataReadyCallback = systemSoftIrqRaise;
+    return true;
+}
+#endif
+
+// Function for loop trigger
+// Runs gyro -> PID -> motors back to back, then the setpoint interpolation for the next update, so nothing sits
+// between the gyro sample and the motor output that it produces. The RC command modifiers, blackbox and storage
+// run as tasks of their own, TASK_RC_COMMAND, TASK_BLACKBOX and TASK_SDCARD.
+void taskMainPidLoop(timeUs_t currentTimeUs)
+{
+    static uint8_t pidUpdateCountdown;
+
+#ifdef USE_PID_LOOP_INTERRUPT
+    if (pidLoopInInterrupt) {
+        // gyro, PID and motors run from the interrupt, follow up on any PID updates it made since the last call
+        static uint8_t pidUpdatesSeen;
+        const uint8_t pidUpdates = pidLoopInterruptUpdates;
+        if (pidUpdates != pidUpdatesSeen) {
+            pidUpdatesSeen = pidUpdates;
+            // the interrupt reads rcCommand and the setpoints, hold it off until all of them are updated
+            ATOMIC_BLOCK(NVIC_PRIO_PID_LOOP) {
+                subTaskPidUpdateFollowUp();
+            }
+        }
+        updateGyroTemperature();
+        return;
+    }
+#endif
+
+    cycleTime = getTaskDeltaTime(TASK_SELF);
+
+    if (debugMode == DEBUG_CYCLETIME) {
+        debug[0] = cycleTime;
+        debug[1] = averageSystemLoadPercent;
+    }
+    updateLoopJitter(currentTimeUs);
 
     // DEBUG_PIDLOOP, timings for:
     // 0 - gyroUpdate()
     // 1 - pidController()
-    // 2 - subTaskMainSubprocesses()
-    // 3 - subTaskMotorUpdate()
+    // 2 - processRcCommand()
     uint32_t startTime;
     if (debugMode == DEBUG_PIDLOOP || debugMode == DEBUG_SCHEDULER) {startTime = micros();}
+#ifdef USE_LOOP_LATENCY
+    const timeUs_t gyroSampleAtUs = gyro.dev.dataReadyAt;
+    loopLatencyGyroRead(gyroSampleAtUs);
+    if (gyroConfig()->gyro_phase_lock) {
+        loopLatencyPhaseLock(gyroSampleAtUs, gyro.targetLooptime, gyroConfig()->gyro_phase_lock);
+    }
+#endif
+    PROFILE_BEGIN(PROFILE_GYRO_UPDATE);
     gyroUpdate();
+    PROFILE_END(PROFILE_GYRO_UPDATE);
     if (debugMode == DEBUG_PIDLOOP || debugMode == DEBUG_SCHEDULER) {debug[0] = micros() - startTime;}
 
+    bool pidUpdated = false;
     if (pidUpdateCountdown) {
         pidUpdateCountdown--;
     } else {
         pidUpdateCountdown = setPidUpdateCountDown();
-        subTaskPidController();
+        pidUpdated = true;
+        subTaskPidController(currentTimeUs);
         subTaskMotorUpdate();
-        runTaskMainSubprocesses = true;
+        DEBUG_SET(DEBUG_LOOP_JITTER, 3, micros() - currentTimeUs);
+        if (debugMode == DEBUG_PIDLOOP) {startTime = micros();}
+
+        // end of the critical section, setpoints for the next PID update follow
+        subTaskPidUpdateFollowUp();
     }
+    updateGyroTemperature();
+
+    if (debugMode == DEBUG_PIDLOOP && pidUpdated) {debug[2] = micros() - startTime;}
 }
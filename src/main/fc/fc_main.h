@@ -21,6 +21,7 @@
 
 extern int16_t magHold;
 extern bool isRXDataNew;
+extern bool blackboxUpdatePending;
 
 union rollAndPitchTrims_u;
 void applyAndSaveAccelerometerTrimsDelta(union rollAndPitchTrims_u *rollAndPitchTrimsDelta);
@@ -32,9 +33,12 @@ void mwArm(void);
 void processRx(timeUs_t currentTimeUs);
 void updateLEDs(void);
 void updateRcCommands(void);
+void updateRcCommandModifiers(void);
 
 void taskMainPidLoop(timeUs_t currentTimeUs);
+bool pidLoopInterruptInit(void);
 float getThrottlePIDAttenuation(void);
 float getSetpointRate(int axis);
+float getSetpointRateDerivative(int axis);
 float getRcDeflection(int axis);
 float getRcDeflectionAbs(int axis);
@@ -24,9 +24,11 @@
 #include "platform.h"
 
 #include "blackbox/blackbox.h"
+#include "blackbox/blackbox_compress.h"
 
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/profile.h"
 #include "build/version.h"
 
 #include "common/axis.h"
@@ -40,6 +42,7 @@
 #include "drivers/serial.h"
 #include "drivers/bus_i2c.h"
 #include "drivers/io.h"
+#include "drivers/memory_report.h"
 #include "drivers/flash.h"
 #include "drivers/sdcard.h"
 #include "drivers/vcd.h"
@@ -51,7 +54,11 @@
 #include "fc/config.h"
 #include "fc/fc_main.h"
 #include "fc/fc_msp.h"
+#include "fc/fc_tasks.h"
+#include "fc/loop_latency.h"
+#include "fc/post_mortem.h"
 #include "fc/rc_controls.h"
+#include "fc/rc_curves.h"
 #include "fc/runtime_config.h"
 
 #include "io/beeper.h"
@@ -64,6 +71,7 @@
 #include "io/flashfs.h"
 #include "io/transponder_ir.h"
 #include "io/asyncfatfs/asyncfatfs.h"
+#include "io/sdcard_profiler.h"
 #include "io/serial_4way.h"
 
 #include "msp/msp.h"
@@ -74,6 +82,7 @@
 #include "rx/msp.h"
 
 #include "scheduler/scheduler.h"
+#include "scheduler/scheduler_trace.h"
 
 #include "sensors/boardalignment.h"
 #include "sensors/sensors.h"
@@ -148,6 +157,7 @@ static const box_t boxes[CHECKBOX_ITEM_COUNT + 1] = {
     { BOXAIRMODE, "AIR MODE;", 28 },
     { BOX3DDISABLESWITCH, "DISABLE 3D SWITCH;", 29},
     { BOXFPVANGLEMIX, "FPV ANGLE MIX;", 30},
+    { BOXCAPTURE, "CRASH CAPTURE;", 31},
     { CHECKBOX_ITEM_COUNT, NULL, 0xFF }
 };
 
@@ -195,7 +205,7 @@ static void mspEscPassthroughFn(serialPort_t *serialPort)
 }
 #endif
 
-static void mspFc4waySerialCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+static mspResult_e mspFc4waySerialCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
 {
     const unsigned int dataSize = sbufBytesRemaining(src);
     if (dataSize == 0) {
@@ -238,6 +248,7 @@ static void mspFc4waySerialCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr
     default:
         sbufWriteU8(dst, 0);
     }
+    return MSP_RESULT_ACK;
 }
 #endif
 
@@ -379,6 +390,12 @@ void initActiveBoxIds(void)
     }
 #endif
 
+#ifdef USE_BLACKBOX_CAPTURE
+    if (feature(FEATURE_BLACKBOX) && blackboxConfig()->capture) {
+        activeBoxIds[activeBoxIdCount++] = BOXCAPTURE;
+    }
+#endif
+
     activeBoxIds[activeBoxIdCount++] = BOXFPVANGLEMIX;
 
     if (feature(FEATURE_3D)) {
@@ -442,7 +459,8 @@ static uint32_t packFlightModeFlags(void)
         IS_ENABLED(IS_RC_MODE_ACTIVE(BOXBLACKBOX)) << BOXBLACKBOX |
         IS_ENABLED(FLIGHT_MODE(FAILSAFE_MODE)) << BOXFAILSAFE |
         IS_ENABLED(IS_RC_MODE_ACTIVE(BOXAIRMODE)) << BOXAIRMODE |
-        IS_ENABLED(IS_RC_MODE_ACTIVE(BOXFPVANGLEMIX)) << BOXFPVANGLEMIX;
+        IS_ENABLED(IS_RC_MODE_ACTIVE(BOXFPVANGLEMIX)) << BOXFPVANGLEMIX |
+        IS_ENABLED(IS_RC_MODE_ACTIVE(BOXCAPTURE)) << BOXCAPTURE;
 
     uint32_t ret = 0;
     for (int i = 0; i < activeBoxIdCount; i++) {
@@ -495,12 +513,15 @@ static void serializeSDCardSummaryReply(sbuf_t *dst)
     // Write free space and total space in kilobytes
     sbufWriteU32(dst, afatfs_getContiguousFreeSpace() / 1024);
     sbufWriteU32(dst, sdcard_getMetadata()->numBlocks / 2); // Block size is half a kilobyte
+    // Filesystem init progress in percent, reaches 100 once logging can start
+    sbufWriteU8(dst, afatfs_getInitProgress());
 #else
     sbufWriteU8(dst, 0);
     sbufWriteU8(dst, 0);
     sbufWriteU8(dst, 0);
     sbufWriteU32(dst, 0);
     sbufWriteU32(dst, 0);
+    sbufWriteU8(dst, 0);
 #endif
 }
 
@@ -514,21 +535,35 @@ static void serializeDataflashSummaryReply(sbuf_t *dst)
     sbufWriteU32(dst, geometry->sectors);
     sbufWriteU32(dst, geometry->totalSize);
     sbufWriteU32(dst, flashfsGetOffset()); // Effectively the current number of bytes stored on the volume
+    sbufWriteU16(dst, MSP_PORT_DATAFLASH_BUFFER_SIZE); // Largest read a single MSP_DATAFLASH_READ will return
+    sbufWriteU8(dst, DATAFLASH_COMPRESSION_SUPPORTED_MASK);
+    sbufWriteU32(dst, flashfsGetEraseRemaining()); // Bytes the background erase has still to get through
 #else
     sbufWriteU8(dst, 0); // FlashFS is neither ready nor supported
     sbufWriteU32(dst, 0);
     sbufWriteU32(dst, 0);
     sbufWriteU32(dst, 0);
+    sbufWriteU16(dst, 0);
+    sbufWriteU8(dst, 0);
+    sbufWriteU32(dst, 0);
 #endif
 }
 
 #ifdef USE_FLASHFS
-static void serializeDataflashReadReply(sbuf_t *dst, uint32_t address, const uint16_t size, bool useLegacyFormat)
+static void serializeDataflashReadReply(sbuf_t *dst, uint32_t address, const uint16_t size, bool useLegacyFormat, bool allowCompression)
 {
     BUILD_BUG_ON(MSP_PORT_DATAFLASH_INFO_SIZE < 16);
 
     uint16_t readLen = size;
-    const int bytesRemainingInBuf = sbufBytesRemaining(dst) - MSP_PORT_DATAFLASH_INFO_SIZE;
+    int bytesRemainingInBuf = sbufBytesRemaining(dst) - MSP_PORT_DATAFLASH_INFO_SIZE;
+#ifdef USE_BLACKBOX_COMPRESSION
+    if (!useLegacyFormat && allowCompression) {
+        // Leave room for the worst case, every block stored as it is
+        bytesRemainingInBuf -= BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE * (bytesRemainingInBuf / BLACKBOX_COMPRESS_BLOCK_SIZE + 1);
+    }
+#else
+    UNUSED(allowCompression);
+#endif
     if (readLen > bytesRemainingInBuf) {
         readLen = bytesRemainingInBuf;
     }
@@ -537,11 +572,34 @@ static void serializeDataflashReadReply(sbuf_t *dst, uint32_t address, const uin
         // truncate the request
         readLen = flashfsGetSize() - address;
     }
+    // Reads of more than a page end on a page boundary, so a stream of maximum sized reads stays page aligned
+    const uint16_t pageSize = flashfsGetGeometry()->pageSize;
+    if (!useLegacyFormat && readLen > pageSize) {
+        readLen -= (address + readLen) % pageSize;
+    }
     sbufWriteU32(dst, address);
+
+#ifdef USE_BLACKBOX_COMPRESSION
+    if (!useLegacyFormat && allowCompression) {
+        static uint8_t chunk[BLACKBOX_COMPRESS_BLOCK_SIZE];
+
+        sbufWriteU16(dst, readLen); // the number of bytes of flash the blocks decode to
+        sbufWriteU8(dst, DATAFLASH_COMPRESSION_BLACKBOX_BLOCKS);
+
+        for (uint32_t blockAddress = address; blockAddress < address + readLen; blockAddress += BLACKBOX_COMPRESS_BLOCK_SIZE) {
+            const int blockLen = MIN(BLACKBOX_COMPRESS_BLOCK_SIZE, address + readLen - blockAddress);
+            const int bytesRead = flashfsReadAbs(blockAddress, chunk, blockLen);
+
+            sbufAdvance(dst, blackboxCompressBlock(chunk, bytesRead, sbufPtr(dst)));
+        }
+        return;
+    }
+#endif
+
     if (!useLegacyFormat) {
         // new format supports variable read lengths
         sbufWriteU16(dst, readLen);
-        sbufWriteU8(dst, 0); // placeholder for compression format
+        sbufWriteU8(dst, DATAFLASH_COMPRESSION_NONE);
     }
 
     // bytesRead will equal readLen
@@ -626,6 +684,7 @@ static bool mspFcProcessOutCommand(uint8_t cmdMSP, sbuf_t *dst, mspPostProcessFn
         sbufWriteU16(dst, constrain(averageSystemLoadPercent, 0, 100));
         sbufWriteU8(dst, MAX_PROFILE_COUNT);
         sbufWriteU8(dst, getCurrentControlRateProfile());
+        sbufWriteU16(dst, cpuUtilisationPercent);
         break;
 
     case MSP_NAME:
@@ -877,6 +936,7 @@ static bool mspFcProcessOutCommand(uint8_t cmdMSP, sbuf_t *dst, mspPostProcessFn
         break;
 
     case MSP_GPSSVINFO:
+        gpsRequestSvInfo();
         sbufWriteU8(dst, GPS_numCh);
            for (int i = 0; i < GPS_numCh; i++) {
                sbufWriteU8(dst, GPS_svinfo_chn[i]);
@@ -891,7 +951,8 @@ static bool mspFcProcessOutCommand(uint8_t cmdMSP, sbuf_t *dst, mspPostProcessFn
         // output some useful QA statistics
         // debug[x] = ((hse_value / 1000000) * 1000) + (SystemCoreClock / 1000000);         // XX0YY [crystal clock : core clock]
 
-        for (int i = 0; i < DEBUG16_VALUE_COUNT; i++) {
+        // the payload keeps the first 4 values, the rest are only logged to blackbox
+        for (int i = 0; i < 4; i++) {
             sbufWriteU16(dst, debug[i]);      // 4 variables are here for general monitoring purpose
         }
         break;
@@ -908,6 +969,147 @@ static bool mspFcProcessOutCommand(uint8_t cmdMSP, sbuf_t *dst, mspPostProcessFn
         sbufWriteU32(dst, U_ID_2);
         break;
 
+    case MSP_MEMORY_REPORT:
+        {
+            memoryReport_t memory;
+            memoryReportGet(&memory);
+            sbufWriteU32(dst, memory.dataSize);
+            sbufWriteU32(dst, memory.bssSize);
+            sbufWriteU32(dst, memory.stackSize);
+            sbufWriteU32(dst, memory.stackHighWater);
+            sbufWriteU32(dst, memory.dmaBufferSize);
+            // DMA buffers by resource owner, only the owners that have any
+            uint8_t owners = 0;
+            for (int owner = 0; owner < OWNER_TOTAL_COUNT; owner++) {
+                owners += memoryReportDmaBufferSize(owner) ? 1 : 0;
+            }
+            sbufWriteU8(dst, owners);
+            for (int owner = 0; owner < OWNER_TOTAL_COUNT; owner++) {
+                const uint32_t dmaBufferSize = memoryReportDmaBufferSize(owner);
+                if (dmaBufferSize) {
+                    sbufWriteU8(dst, owner);
+                    sbufWriteU32(dst, dmaBufferSize);
+                }
+            }
+        }
+        break;
+
+#ifdef USE_POST_MORTEM
+    case MSP_POST_MORTEM:
+        {
+            // just the reason when there is no record, the trace events are those that fit
+            const postMortem_t *postMortem = postMortemGet();
+            sbufWriteU8(dst, postMortem ? postMortem->reason : POST_MORTEM_NONE);
+            if (!postMortem) {
+                break;
+            }
+            sbufWriteU8(dst, postMortem->taskId);
+            sbufWriteU32(dst, postMortem->uptimeMs);
+            sbufWriteU16(dst, postMortem->systemLoadPercent);
+            sbufWriteU8(dst, postMortem->armed);
+            for (unsigned i = 0; i < ARRAYLEN(postMortem->registers); i++) {
+                sbufWriteU32(dst, postMortem->registers[i]);
+            }
+            sbufWriteU32(dst, postMortem->cfsr);
+            sbufWriteU32(dst, postMortem->hfsr);
+            sbufWriteU32(dst, postMortem->mmfar);
+            sbufWriteU32(dst, postMortem->bfar);
+            sbufWriteU32(dst, postMortem->sp);
+            sbufWriteU8(dst, POST_MORTEM_STACK_WORDS);
+            for (int i = 0; i < POST_MORTEM_STACK_WORDS; i++) {
+                sbufWriteU32(dst, postMortem->stack[i]);
+            }
+            sbufWriteU8(dst, TASK_COUNT);
+            for (int i = 0; i < TASK_COUNT; i++) {
+                sbufWriteU16(dst, postMortem->tasks[i].averageUs);
+                sbufWriteU16(dst, postMortem->tasks[i].maxUs);
+            }
+#ifdef USE_SCHEDULER_TRACE
+            sbufWriteU32(dst, postMortem->traceCyclesPerUs);
+            const int traceCount = constrain((sbufBytesRemaining(dst) - 1) / 6, 0, postMortem->traceCount);
+            sbufWriteU8(dst, traceCount);
+            // the newest events are kept when they don't all fit
+            for (int i = postMortem->traceCount - traceCount; i < postMortem->traceCount; i++) {
+                sbufWriteU32(dst, postMortem->trace[i].cycles);
+                sbufWriteU8(dst, postMortem->trace[i].type);
+                sbufWriteU8(dst, postMortem->trace[i].id);
+            }
+#else
+            sbufWriteU32(dst, 0);
+            sbufWriteU8(dst, 0);
+#endif
+        }
+        break;
+#endif
+
+#ifdef USE_LOOP_LATENCY
+    case MSP_LOOP_LATENCY:
+        sbufWriteU8(dst, LOOP_LATENCY_COUNT);
+        sbufWriteU8(dst, TASK_HISTOGRAM_BUCKET_COUNT);
+        for (int i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+            sbufWriteU16(dst, getTaskHistogramBucketLimit(i));
+        }
+        for (int stage = 0; stage < LOOP_LATENCY_COUNT; stage++) {
+            const loopLatencyStats_t *stats = getLoopLatencyStats(stage);
+            sbufWriteU16(dst, stats->min);
+            sbufWriteU16(dst, getLoopLatencyAverage(stage));
+            sbufWriteU16(dst, stats->max);
+            sbufWriteU32(dst, stats->count);
+            for (int i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+                sbufWriteU16(dst, stats->histogram[i]);
+            }
+        }
+        break;
+#endif
+
+#ifdef USE_PROFILER
+    case MSP_CYCLE_PROFILE:
+        sbufWriteU8(dst, PROFILE_COUNT);
+        sbufWriteU16(dst, profileGetCyclesPerMicrosecond());
+        for (int probe = 0; probe < PROFILE_COUNT; probe++) {
+            const profileStats_t *stats = profileGetStats(probe);
+            sbufWriteU32(dst, stats->count);
+            sbufWriteU32(dst, stats->minCycles);
+            sbufWriteU32(dst, profileGetAverageCycles(probe));
+            sbufWriteU32(dst, stats->maxCycles);
+        }
+        break;
+#endif
+
+#ifdef USE_SDCARD_PROFILER
+    case MSP_SDCARD_PROFILE:
+        sbufWriteU8(dst, SDCARD_PROFILER_BUCKET_COUNT);
+        for (int i = 0; i < SDCARD_PROFILER_BUCKET_COUNT; i++) {
+            sbufWriteU32(dst, sdcardProfilerGetBucketLimitUs(i));
+        }
+        for (int operation = SDCARD_BLOCK_OPERATION_READ; operation <= SDCARD_BLOCK_OPERATION_WRITE; operation++) {
+            const sdcardLatencyStats_t *stats = sdcardProfilerGetStats(operation);
+            sbufWriteU32(dst, stats->count);
+            sbufWriteU32(dst, stats->maxUs);
+            sbufWriteU32(dst, stats->stalls);
+            for (int i = 0; i < SDCARD_PROFILER_BUCKET_COUNT; i++) {
+                sbufWriteU32(dst, stats->histogram[i]);
+            }
+        }
+        sbufWriteU8(dst, sdcardBenchmarkGetState());
+        sbufWriteU32(dst, sdcardBenchmarkGetRateKBps());
+        break;
+#endif
+
+#ifdef USE_DSHOT
+    case MSP_DSHOT_COMMAND_STATUS:
+        {
+            dshotCommandStatus_t status;
+            dshotCommandGetStatus(&status);
+            sbufWriteU8(dst, DSHOT_COMMAND_QUEUE_SIZE - 1);
+            sbufWriteU8(dst, status.queued);
+            sbufWriteU8(dst, status.motorIndex);
+            sbufWriteU8(dst, status.command);
+            sbufWriteU8(dst, status.repeatsLeft);
+        }
+        break;
+#endif
+
     case MSP_FEATURE:
         sbufWriteU32(dst, featureMask());
         break;
@@ -1187,8 +1389,9 @@ static bool mspFcProcessOutCommand(uint8_t cmdMSP, sbuf_t *dst, mspPostProcessFn
 }
 
 #ifdef GPS
-static void mspFcWpCommand(sbuf_t *dst, sbuf_t *src)
+static mspResult_e mspFcWpCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
 {
+    UNUSED(mspPostProcessFn);
     uint8_t wp_no;
     int32_t lat = 0, lon = 0;
     wp_no = sbufReadU8(src);    // get the wp number
@@ -1206,28 +1409,188 @@ static void mspFcWpCommand(sbuf_t *dst, sbuf_t *src)
     sbufWriteU16(dst, 0);                 // heading  will come here (deg)
     sbufWriteU16(dst, 0);                 // time to stay (ms) will come here
     sbufWriteU8(dst, 0);                  // nav flag will come here
+    return MSP_RESULT_ACK;
+}
+#endif
+
+#ifndef SKIP_TASK_STATISTICS
+static mspResult_e mspFcTaskLatencyCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(mspPostProcessFn);
+    const uint8_t taskId = sbufReadU8(src);
+    sbufWriteU8(dst, taskId);
+    if (taskId >= TASK_COUNT) {
+        return MSP_RESULT_ACK;
+    }
+    cfTaskInfo_t taskInfo;
+    getTaskInfo(taskId, &taskInfo);
+    sbufWriteU8(dst, taskInfo.isEnabled);
+    sbufWriteU32(dst, taskInfo.desiredPeriod);
+    sbufWriteU32(dst, taskInfo.deadlineMissCount);
+    sbufWriteU8(dst, TASK_HISTOGRAM_BUCKET_COUNT);
+    for (int i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+        sbufWriteU16(dst, getTaskHistogramBucketLimit(i));
+    }
+    for (int i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+        sbufWriteU16(dst, taskInfo.executionTimeHistogram[i]);
+    }
+    for (int i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+        sbufWriteU16(dst, taskInfo.latenessHistogram[i]);
+    }
+    return MSP_RESULT_ACK;
+}
+#endif
+
+#ifdef USE_SCHEDULER_TRACE
+#define MSP_SCHEDULER_TRACE_MAX_EVENTS 32   // events per reply, 6 bytes each
+
+static mspResult_e mspFcSchedulerTraceCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(mspPostProcessFn);
+    const int firstEvent = sbufReadU16(src);
+    const int eventCount = schedulerTraceGetEventCount();
+    const int replyEvents = constrain(eventCount - firstEvent, 0, MSP_SCHEDULER_TRACE_MAX_EVENTS);
+
+    sbufWriteU8(dst, schedulerTraceGetState());
+    sbufWriteU16(dst, schedulerTraceGetCyclesPerMicrosecond());
+    sbufWriteU16(dst, eventCount);
+    sbufWriteU16(dst, firstEvent);
+    sbufWriteU8(dst, replyEvents);
+    for (int i = 0; i < replyEvents; i++) {
+        const schedulerTraceEvent_t *event = schedulerTraceGetEvent(firstEvent + i);
+        sbufWriteU32(dst, event->cycles);
+        sbufWriteU8(dst, event->type);
+        sbufWriteU8(dst, event->id);
+    }
+    return MSP_RESULT_ACK;
 }
 #endif
 
 #ifdef USE_FLASHFS
-static void mspFcDataFlashReadCommand(sbuf_t *dst, sbuf_t *src)
+static mspResult_e mspFcDataFlashReadCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
 {
+    UNUSED(mspPostProcessFn);
     const unsigned int dataSize = sbufBytesRemaining(src);
     const uint32_t readAddress = sbufReadU32(src);
     uint16_t readLength;
     bool useLegacyFormat;
+    bool allowCompression = false;
     if (dataSize >= sizeof(uint32_t) + sizeof(uint16_t)) {
         readLength = sbufReadU16(src);
         useLegacyFormat = false;
+        if (dataSize >= sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t)) {
+            allowCompression = sbufReadU8(src);
+        }
     } else {
         readLength = 128;
         useLegacyFormat = true;
     }
 
-    serializeDataflashReadReply(dst, readAddress, readLength, useLegacyFormat);
+    serializeDataflashReadReply(dst, readAddress, readLength, useLegacyFormat, allowCompression);
+    return MSP_RESULT_ACK;
+}
+
+// The logs in the dataflash index from the one numbered in the request onwards, as many as fit in the reply
+static mspResult_e mspFcDataFlashLogIndexCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(mspPostProcessFn);
+    const int firstLog = sbufBytesRemaining(src) >= (int)sizeof(uint16_t) ? sbufReadU16(src) : 0;
+    const int logCount = flashfsGetLogCount();
+
+    sbufWriteU16(dst, logCount);
+    sbufWriteU16(dst, firstLog);
+    flashfsLogEntry_t entry;
+    for (int i = firstLog; i < logCount && sbufBytesRemaining(dst) >= 3 * (int)sizeof(uint32_t) && flashfsGetLog(i, &entry); i++) {
+        sbufWriteU32(dst, entry.start);
+        sbufWriteU32(dst, entry.length);
+        sbufWriteU32(dst, entry.timeMs);
+    }
+    return MSP_RESULT_ACK;
 }
 #endif
 
+#if defined(OSD) && defined(USE_MAX7456)
+#define MSP_OSD_CHAR_SIZE (1 + 54) // the address and the character data
+
+/*
+ * MSP_OSD_CHAR_WRITE carries up to MAX7456_NVM_CHARS_PER_REQUEST characters. They are only queued for the NVM, the
+ * port holds the request while the queue has no room for all of them, so the host is paced by the replies.
+ */
+static mspResult_e mspFcOsdCharWriteCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(dst);
+    UNUSED(mspPostProcessFn);
+    const int charCount = sbufBytesRemaining(src) / MSP_OSD_CHAR_SIZE;
+    if (charCount == 0 || charCount > MAX7456_NVM_CHARS_PER_REQUEST) {
+        return MSP_RESULT_ERROR;
+    }
+
+    // !!TODO - replace this with a device independent implementation
+    max7456NvmUpdate();
+    if (max7456NvmQueueSpace() < charCount) {
+        return MSP_RESULT_BUSY;
+    }
+    for (int i = 0; i < charCount; i++) {
+        const uint8_t addr = sbufReadU8(src);
+        max7456WriteNvm(addr, sbufPtr(src));
+        sbufAdvance(src, MSP_OSD_CHAR_SIZE - 1);
+    }
+    // the first of them goes into the shadow RAM right away
+    max7456NvmUpdate();
+    return MSP_RESULT_ACK;
+}
+#endif
+
+/*
+ * The whole configuration can be cloned as raw blocks of master_t. Every block carries the config version and size,
+ * and blocks are only written to a board with the same layout. The host sends MSP_EEPROM_WRITE after the last one.
+ */
+#define MSP_CONFIG_BLOCK_MAX_SIZE 128
+
+static mspResult_e mspFcConfigBlockCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(mspPostProcessFn);
+    const unsigned int dataSize = sbufBytesRemaining(src);
+    if (dataSize < sizeof(uint16_t)) {
+        return MSP_RESULT_ERROR;
+    }
+    const uint16_t offset = sbufReadU16(src);
+    uint8_t length = MSP_CONFIG_BLOCK_MAX_SIZE;
+    if (dataSize >= sizeof(uint16_t) + sizeof(uint8_t)) {
+        length = MIN(sbufReadU8(src), MSP_CONFIG_BLOCK_MAX_SIZE);
+    }
+    if (offset >= sizeof(master_t)) {
+        length = 0;
+    } else {
+        length = MIN(length, sizeof(master_t) - offset);
+    }
+
+    sbufWriteU8(dst, EEPROM_CONF_VERSION);
+    sbufWriteU16(dst, sizeof(master_t));
+    sbufWriteU16(dst, offset);
+    sbufWriteU8(dst, length);
+    sbufWriteData(dst, (const uint8_t *)&masterConfig + offset, length);
+    return MSP_RESULT_ACK;
+}
+
+static mspResult_e mspFcSetConfigBlockCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(mspPostProcessFn);
+    UNUSED(dst);
+    if (ARMING_FLAG(ARMED) || sbufBytesRemaining(src) < 5) {
+        return MSP_RESULT_ERROR;
+    }
+    const uint8_t version = sbufReadU8(src);
+    const uint16_t size = sbufReadU16(src);
+    const uint16_t offset = sbufReadU16(src);
+    const int length = sbufBytesRemaining(src);
+    if (version != EEPROM_CONF_VERSION || size != sizeof(master_t) || offset + length > (int)sizeof(master_t)) {
+        return MSP_RESULT_ERROR;
+    }
+    sbufReadData(src, (uint8_t *)&masterConfig + offset, length);
+    return MSP_RESULT_ACK;
+}
+
 static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
 {
     uint32_t i;
@@ -1278,6 +1641,16 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
         }
 #endif
         break;
+#ifdef USE_SCHEDULER_TRACE
+    case MSP_SET_SCHEDULER_TRACE:
+        if (sbufReadU8(src)) {
+            schedulerTraceTrigger();
+        } else {
+            schedulerTraceArm();
+        }
+        break;
+#endif
+
     case MSP_SET_ACC_TRIM:
         accelerometerConfig()->accelerometerTrims.values.pitch = sbufReadU16(src);
         accelerometerConfig()->accelerometerTrims.values.roll  = sbufReadU16(src);
@@ -1336,6 +1709,7 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
                 adjRange->range.endStep = sbufReadU8(src);
                 adjRange->adjustmentFunction = sbufReadU8(src);
                 adjRange->auxSwitchChannelIndex = sbufReadU8(src);
+                rcControlsRangesChanged();
             } else {
                 return MSP_RESULT_ERROR;
             }
@@ -1363,6 +1737,9 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
             if (dataSize >= 12) {
                 currentControlRateProfile->rcYawRate8 = sbufReadU8(src);
             }
+#ifdef USE_RC_RATE_TABLE
+            generateRateCurves(currentControlRateProfile);
+#endif
         } else {
             return MSP_RESULT_ERROR;
         }
@@ -1423,6 +1800,7 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
             servoProfile()->servoConf[i].angleAtMax = sbufReadU8(src);
             servoProfile()->servoConf[i].forwardFromChannel = sbufReadU8(src);
             servoProfile()->servoConf[i].reversedSources = sbufReadU32(src);
+            servoCompileRules();
         }
 #endif
         break;
@@ -1478,6 +1856,9 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
         motorConfig()->motorPwmProtocol = constrain(sbufReadU8(src), 0, PWM_TYPE_BRUSHED);
 #endif
         motorConfig()->motorPwmRate = sbufReadU16(src);
+        // the new loop rates take effect straight away while disarmed, otherwise after a save and reboot
+        validateAndFixGyroConfig();
+        fcTasksUpdateLoopRate();
         break;
 
     case MSP_SET_FILTER_CONFIG:
@@ -1596,26 +1977,12 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
             }
         }
         break;
+#ifndef USE_MAX7456
     case MSP_OSD_CHAR_WRITE:
-#ifdef USE_MAX7456
-        {
-            uint8_t font_data[64];
-            const uint8_t addr = sbufReadU8(src);
-            for (int i = 0; i < 54; i++) {
-                font_data[i] = sbufReadU8(src);
-            }
-            // !!TODO - replace this with a device independent implementation
-            max7456WriteNvm(addr, font_data);
-        }
-#else
-        // just discard the data
-        sbufReadU8(src);
-        for (int i = 0; i < 54; i++) {
-            sbufReadU8(src);
-        }
-#endif
+        // just discard the data, the MAX7456 takes it in mspFcOsdCharWriteCommand()
         break;
 #endif
+#endif
 
 #ifdef USE_RTC6705
     case MSP_SET_VTX_CONFIG:
@@ -1858,6 +2225,53 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
 /*
  * Returns MSP_RESULT_ACK, MSP_RESULT_ERROR or MSP_RESULT_NO_REPLY
  */
+/*
+ * Commands that read a request payload have their own handler, kept in this table sorted by command so a lookup
+ * is a binary search. Subsystems can add theirs with mspFcRegisterCommand() without touching the switches above.
+ */
+#define MSP_MAX_COMMAND_HANDLERS 16
+
+typedef struct mspCommand_s {
+    uint8_t cmd;
+    mspCommandFnPtr fn;
+} mspCommand_t;
+
+static mspCommand_t mspCommands[MSP_MAX_COMMAND_HANDLERS];
+static uint8_t mspCommandCount = 0;
+
+static const mspCommand_t *mspFcFindCommand(uint8_t cmd)
+{
+    int low = 0;
+    int high = mspCommandCount - 1;
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+        if (mspCommands[mid].cmd == cmd) {
+            return &mspCommands[mid];
+        } else if (mspCommands[mid].cmd < cmd) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+bool mspFcRegisterCommand(uint8_t cmd, mspCommandFnPtr fn)
+{
+    if (mspCommandCount >= MSP_MAX_COMMAND_HANDLERS || mspFcFindCommand(cmd)) {
+        return false;
+    }
+    int i = mspCommandCount;
+    while (i > 0 && mspCommands[i - 1].cmd > cmd) {
+        mspCommands[i] = mspCommands[i - 1];
+        i--;
+    }
+    mspCommands[i].cmd = cmd;
+    mspCommands[i].fn = fn;
+    mspCommandCount++;
+    return true;
+}
+
 mspResult_e mspFcProcessCommand(mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn)
 {
     int ret = MSP_RESULT_ACK;
@@ -1867,23 +2281,17 @@ mspResult_e mspFcProcessCommand(mspPacket_t *cmd, mspPacket_t *reply, mspPostPro
     // initialize reply by default
     reply->cmd = cmd->cmd;
 
-    if (mspFcProcessOutCommand(cmdMSP, dst, mspPostProcessFn)) {
-        ret = MSP_RESULT_ACK;
-#ifdef USE_SERIAL_4WAY_BLHELI_INTERFACE
-    } else if (cmdMSP == MSP_SET_4WAY_IF) {
-        mspFc4waySerialCommand(dst, src, mspPostProcessFn);
-        ret = MSP_RESULT_ACK;
-#endif
-#ifdef GPS
-    } else if (cmdMSP == MSP_WP) {
-        mspFcWpCommand(dst, src);
-        ret = MSP_RESULT_ACK;
-#endif
-#ifdef USE_FLASHFS
-    } else if (cmdMSP == MSP_DATAFLASH_READ) {
-        mspFcDataFlashReadCommand(dst, src);
+    if (cmd->cmd < 0 || cmd->cmd > UINT8_MAX) {
+        // MSPv2 frames carry 16 bit commands, none above the v1 range are implemented yet
+        reply->result = MSP_RESULT_ERROR;
+        return MSP_RESULT_ERROR;
+    }
+
+    const mspCommand_t *command = mspFcFindCommand(cmdMSP);
+    if (command) {
+        ret = command->fn(dst, src, mspPostProcessFn);
+    } else if (mspFcProcessOutCommand(cmdMSP, dst, mspPostProcessFn)) {
         ret = MSP_RESULT_ACK;
-#endif
     } else {
         ret = mspFcProcessInCommand(cmdMSP, src);
     }
@@ -1897,4 +2305,26 @@ mspResult_e mspFcProcessCommand(mspPacket_t *cmd, mspPacket_t *reply, mspPostPro
 void mspFcInit(void)
 {
     initActiveBoxIds();
+
+#ifdef USE_SERIAL_4WAY_BLHELI_INTERFACE
+    mspFcRegisterCommand(MSP_SET_4WAY_IF, mspFc4waySerialCommand);
+#endif
+#ifdef GPS
+    mspFcRegisterCommand(MSP_WP, mspFcWpCommand);
+#endif
+#ifndef SKIP_TASK_STATISTICS
+    mspFcRegisterCommand(MSP_TASK_LATENCY, mspFcTaskLatencyCommand);
+#endif
+#ifdef USE_SCHEDULER_TRACE
+    mspFcRegisterCommand(MSP_SCHEDULER_TRACE, mspFcSchedulerTraceCommand);
+#endif
+#ifdef USE_FLASHFS
+    mspFcRegisterCommand(MSP_DATAFLASH_READ, mspFcDataFlashReadCommand);
+    mspFcRegisterCommand(MSP_DATAFLASH_LOG_INDEX, mspFcDataFlashLogIndexCommand);
+#endif
+#if defined(OSD) && defined(USE_MAX7456)
+    mspFcRegisterCommand(MSP_OSD_CHAR_WRITE, mspFcOsdCharWriteCommand);
+#endif
+    mspFcRegisterCommand(MSP_CONFIG_BLOCK, mspFcConfigBlockCommand);
+    mspFcRegisterCommand(MSP_SET_CONFIG_BLOCK, mspFcSetConfigBlockCommand);
 }
@@ -20,4 +20,5 @@
 #include "msp/msp.h"
 
 void mspFcInit(void);
+bool mspFcRegisterCommand(uint8_t cmd, mspCommandFnPtr fn);
 mspResult_e mspFcProcessCommand(mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn);
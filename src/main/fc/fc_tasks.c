@@ -21,6 +21,12 @@
 
 #include <platform.h>
 
+#include "blackbox/blackbox.h"
+#include "blackbox/blackbox_io.h"
+
+#include "build/atomic.h"
+#include "build/profile.h"
+
 #include "cms/cms.h"
 
 #include "common/axis.h"
@@ -30,26 +36,34 @@
 #include "drivers/sensor.h"
 #include "drivers/accgyro.h"
 #include "drivers/compass.h"
+#include "drivers/nvic.h"
 #include "drivers/serial.h"
 #include "drivers/stack_check.h"
+#include "drivers/vtx_soft_spi_rtc6705.h"
 
 #include "fc/config.h"
 #include "fc/fc_msp.h"
 #include "fc/fc_tasks.h"
 #include "fc/fc_main.h"
+#include "fc/loop_rate.h"
 #include "fc/rc_controls.h"
 #include "fc/runtime_config.h"
 
 #include "flight/pid.h"
 #include "flight/altitudehold.h"
+#include "flight/servos.h"
 
+#include "io/asyncfatfs/asyncfatfs.h"
 #include "io/beeper.h"
 #include "io/dashboard.h"
+#include "io/flashfs.h"
 #include "io/gps.h"
 #include "io/ledstrip.h"
 #include "io/osd.h"
+#include "io/sdcard_profiler.h"
 #include "io/serial.h"
 #include "io/serial_cli.h"
+#include "io/servos.h"
 #include "io/transponder_ir.h"
 #include "io/vtx_smartaudio.h"
 
@@ -106,6 +120,14 @@ static void taskHandleSerial(timeUs_t currentTimeUs)
     }
 #endif
     mspSerialProcess(ARMING_FLAG(ARMED) ? MSP_SKIP_NON_MSP_DATA : MSP_EVALUATE_NON_MSP_DATA, mspFcProcessCommand);
+
+    // MSP streams are sent from here, so the task keeps up with the fastest one
+    static uint32_t streamPeriodUs;
+    const uint32_t newStreamPeriodUs = mspSerialStreamPeriodUs();
+    if (newStreamPeriodUs != streamPeriodUs) {
+        streamPeriodUs = newStreamPeriodUs;
+        rescheduleTask(TASK_SELF, streamPeriodUs ? MIN(streamPeriodUs, TASK_PERIOD_HZ(100)) : TASK_PERIOD_HZ(100));
+    }
 }
 
 static void taskUpdateBattery(timeUs_t currentTimeUs)
@@ -131,28 +153,64 @@ static void taskUpdateBattery(timeUs_t currentTimeUs)
     }
 }
 
+// a save requested by saveConfigAndNotify() is written a flash word at a time, so it can't stall the PID loop
+static void taskConfigSave(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    processDeferredConfigSave();
+}
+
+static bool rcCommandUpdatePending;
+
 static void taskUpdateRxMain(timeUs_t currentTimeUs)
 {
+    PROFILE_BEGIN(PROFILE_RX);
     processRx(currentTimeUs);
-    isRXDataNew = true;
+    PROFILE_END(PROFILE_RX);
 
-#if !defined(BARO) && !defined(SONAR)
-    // updateRcCommands sets rcCommand, which is needed by updateAltHoldState and updateSonarAltHoldState
-    updateRcCommands();
-#endif
     updateLEDs();
 
+    rcCommandUpdatePending = true;
+    schedulerSignalTask(TASK_RC_COMMAND);
+}
+
+static bool taskUpdateRcCommandCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs)
+{
+    UNUSED(currentTimeUs);
+    UNUSED(currentDeltaTimeUs);
+
+    return rcCommandUpdatePending;
+}
+
+// turns each RX update into rcCommand, with the flight modes and corrections applied, before the PID loop interpolates to it
+static void taskUpdateRcCommand(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    rcCommandUpdatePending = false;
+
+    // the PID loop can run from an interrupt, keep it from reading a half updated rcCommand
+    ATOMIC_BLOCK(NVIC_PRIO_PID_LOOP) {
+        // updateRcCommands sets rcCommand, which is needed by updateAltHoldState and updateSonarAltHoldState
+        updateRcCommands();
+
 #ifdef BARO
-    if (sensors(SENSOR_BARO)) {
-        updateAltHoldState();
-    }
+        if (sensors(SENSOR_BARO)) {
+            updateAltHoldState();
+        }
 #endif
 
 #ifdef SONAR
-    if (sensors(SENSOR_SONAR)) {
-        updateSonarAltHoldState();
-    }
+        if (sensors(SENSOR_SONAR)) {
+            updateSonarAltHoldState();
+        }
 #endif
+
+        updateRcCommandModifiers();
+
+        isRXDataNew = true;
+    }
 }
 
 #ifdef MAG
@@ -204,24 +262,291 @@ static void taskTelemetry(timeUs_t currentTimeUs)
 }
 #endif
 
-#ifdef VTX_CONTROL
+#if defined(VTX_CONTROL) || defined(USE_RTC6705)
+#ifdef USE_RTC6705
+#define RTC6705_BIT_BUDGET_US 5     // one bit takes about 2us
+
+static bool taskVtxControlCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs)
+{
+    UNUSED(currentTimeUs);
+    UNUSED(currentDeltaTimeUs);
+
+    return rtc6705_soft_spi_busy();
+}
+#endif
+
 // Everything that listens to VTX devices
 void taskVtxControl(uint32_t currentTime)
 {
+#ifdef USE_RTC6705
+    // register writes are clocked out in the gaps between the realtime tasks, the rest waits for the next pass
+    while (schedulerGetRemainingBudgetUs() >= RTC6705_BIT_BUDGET_US && rtc6705_soft_spi_process());
+#endif
+
     if (ARMING_FLAG(ARMED))
         return;
 
 #ifdef VTX_SMARTAUDIO
-    smartAudioProcess(currentTime);
+    smartAudioProcess(currentTime / 1000);
+#else
+    UNUSED(currentTime);
 #endif
 }
 #endif
 
+/*
+ * Load shedding: while the average system load stays above overloadPercent the least important
+ * of the tasks below has its rate halved, one step at a time, until it reaches its minimum rate
+ * and the next one is slowed. Once the load has fallen below recoverPercent the tasks are sped
+ * back up in the reverse order. Each step is recorded in the blackbox log.
+ */
+#define TASK_SHED_OVERLOAD_SAMPLES 5        // consecutive TASK_SYSTEM samples before each shedding step
+#define TASK_SHED_RECOVER_SAMPLES 10        // consecutive TASK_SYSTEM samples before each restoring step
+
+static const cfTaskId_e sheddableTaskIds[TASK_SHED_COUNT] = {
+#ifdef LED_STRIP
+    [TASK_SHED_LEDSTRIP] = TASK_LEDSTRIP,
+#else
+    [TASK_SHED_LEDSTRIP] = TASK_NONE,
+#endif
+#ifdef USE_DASHBOARD
+    [TASK_SHED_DASHBOARD] = TASK_DASHBOARD,
+#else
+    [TASK_SHED_DASHBOARD] = TASK_NONE,
+#endif
+#ifdef TELEMETRY
+    [TASK_SHED_TELEMETRY] = TASK_TELEMETRY,
+#else
+    [TASK_SHED_TELEMETRY] = TASK_NONE,
+#endif
+#ifdef OSD
+    [TASK_SHED_OSD] = TASK_OSD,
+#else
+    [TASK_SHED_OSD] = TASK_NONE,
+#endif
+};
+
+static uint32_t shedTaskNormalPeriod[TASK_SHED_COUNT];  // period before shedding started, 0 while at the normal rate
+static uint8_t overloadedSamples;
+static uint8_t recoveredSamples;
+
+static void setShedTaskPeriod(taskShedSlot_e slot, uint32_t newPeriod)
+{
+    const cfTaskId_e taskId = sheddableTaskIds[slot];
+
+    rescheduleTask(taskId, newPeriod);
+
+#ifdef BLACKBOX
+    if (feature(FEATURE_BLACKBOX)) {
+        flightLogEvent_taskRateChange_t eventData;
+        eventData.taskId = taskId;
+        eventData.newPeriod = cfTasks[taskId].desiredPeriod;
+        eventData.systemLoadPercent = averageSystemLoadPercent;
+        blackboxLogEvent(FLIGHT_LOG_EVENT_TASK_RATE_CHANGE, (flightLogEventData_t *)&eventData);
+    }
+#endif
+}
+
+static void shedNextTask(void)
+{
+    int shedSlot = -1;
+    for (int slot = 0; slot < TASK_SHED_COUNT; slot++) {
+        const taskShedConfig_t *shedConfig = &taskSheddingConfig()->task[slot];
+        const cfTaskId_e taskId = sheddableTaskIds[slot];
+        if (taskId == TASK_NONE || shedConfig->priority == 0) {
+            continue;
+        }
+        cfTaskInfo_t taskInfo;
+        getTaskInfo(taskId, &taskInfo);
+        if (!taskInfo.isEnabled || taskInfo.desiredPeriod >= TASK_PERIOD_HZ(shedConfig->minRateHz)) {
+            continue;
+        }
+        if (shedSlot < 0 || shedConfig->priority > taskSheddingConfig()->task[shedSlot].priority) {
+            shedSlot = slot;
+        }
+    }
+    if (shedSlot < 0) {
+        return;
+    }
+
+    const uint32_t currentPeriod = cfTasks[sheddableTaskIds[shedSlot]].desiredPeriod;
+    if (shedTaskNormalPeriod[shedSlot] == 0) {
+        shedTaskNormalPeriod[shedSlot] = currentPeriod;
+    }
+    setShedTaskPeriod(shedSlot, MIN(currentPeriod * 2, (uint32_t)TASK_PERIOD_HZ(taskSheddingConfig()->task[shedSlot].minRateHz)));
+}
+
+static void restoreNextTask(void)
+{
+    int restoreSlot = -1;
+    for (int slot = 0; slot < TASK_SHED_COUNT; slot++) {
+        if (shedTaskNormalPeriod[slot] == 0) {
+            continue;
+        }
+        if (restoreSlot < 0 || taskSheddingConfig()->task[slot].priority < taskSheddingConfig()->task[restoreSlot].priority) {
+            restoreSlot = slot;
+        }
+    }
+    if (restoreSlot < 0) {
+        return;
+    }
+
+    const uint32_t newPeriod = MAX(cfTasks[sheddableTaskIds[restoreSlot]].desiredPeriod / 2, shedTaskNormalPeriod[restoreSlot]);
+    if (newPeriod == shedTaskNormalPeriod[restoreSlot]) {
+        shedTaskNormalPeriod[restoreSlot] = 0;
+    }
+    setShedTaskPeriod(restoreSlot, newPeriod);
+}
+
+static void updateTaskShedding(void)
+{
+    const taskSheddingConfig_t *config = taskSheddingConfig();
+
+    if (config->overloadPercent && averageSystemLoadPercent >= config->overloadPercent) {
+        recoveredSamples = 0;
+        if (++overloadedSamples >= TASK_SHED_OVERLOAD_SAMPLES) {
+            overloadedSamples = 0;
+            shedNextTask();
+        }
+    } else if (!config->overloadPercent || averageSystemLoadPercent < config->recoverPercent) {
+        overloadedSamples = 0;
+        if (++recoveredSamples >= TASK_SHED_RECOVER_SAMPLES) {
+            recoveredSamples = 0;
+            restoreNextTask();
+        }
+    } else {
+        overloadedSamples = 0;
+        recoveredSamples = 0;
+    }
+}
+
+static void taskSystemUpdate(timeUs_t currentTimeUs)
+{
+    taskSystem(currentTimeUs);
+    updateTaskShedding();
+#ifdef USE_LOOP_RATE_AUTO
+    loopRateAutoUpdate(currentTimeUs);
+#endif
+}
+
+#ifdef USE_SERVOS
+// servos only take 50-500Hz, so they are mixed, filtered and written here instead of on every PID cycle
+static void taskUpdateServos(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    // motor outputs are used as sources for servo mixing, this picks up the latest mixTable() result
+    servoTable();
+    filterServos();
+    writeServos();
+}
+#endif
+
+#ifdef BLACKBOX
+static bool taskBlackboxCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs)
+{
+    UNUSED(currentTimeUs);
+    UNUSED(currentDeltaTimeUs);
+
+    return blackboxUpdatePending;
+}
+
+// logs the latest PID update, the PID loop signals the task after each one
+static void taskBlackbox(timeUs_t currentTimeUs)
+{
+    blackboxUpdatePending = false;
+
+    if (!cliMode && feature(FEATURE_BLACKBOX)) {
+        handleBlackbox(currentTimeUs);
+    }
+}
+#endif
+
+#ifdef USE_SDCARD
+static void taskSdcard(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    afatfs_poll();
+
+#ifdef USE_SDCARD_PROFILER
+    sdcardProfilerUpdate();
+#endif
+}
+#endif
+
+#ifdef USE_BLACKBOX_COMPRESSION
+// compressing a block takes far longer than logging a frame, so it is kept out of the PID loop
+static void taskBlackboxCompress(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    blackboxCompressPending();
+}
+#endif
+
+#ifdef USE_FLASHFS
+// programs each buffered page once it is full, so flash logging never waits for the chip in the PID loop, and erases
+// sectors in the background
+static void taskFlashfs(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    flashfsUpdate();
+}
+#endif
+
+static bool pidLoopInInterrupt;
+
+// the periods of the tasks paced by the gyro and PID loop rates
+static void configureLoopRateTasks(void)
+{
+    if (pidLoopInInterrupt) {
+        // only the processes that follow each PID update are left to the task
+        rescheduleTask(TASK_GYROPID, gyro.targetLooptime * pidConfig()->pid_process_denom);
+    } else {
+        rescheduleTask(TASK_GYROPID, gyro.targetLooptime);
+    }
+#ifdef USE_SERVOS
+    if (isMixerUsingServos()) {
+        const uint32_t servoUpdateInterval = MAX(TASK_PERIOD_HZ(servoConfig()->servoPwmRate), targetPidLooptime);
+        rescheduleTask(TASK_SERVOS, servoUpdateInterval);
+        servoInitFilters(servoUpdateInterval);
+        servoSetUpdateInterval(servoUpdateInterval, targetPidLooptime);
+    }
+#endif
+}
+
+/*
+ * Applies gyro_sync_denom and pid_process_denom without a reboot, only while disarmed. The gyro sample
+ * rate, the gyro and PID filters and the loop task periods change together, with the PID loop interrupt
+ * held off, so no loop runs on a mix of the old and new rates.
+ */
+bool fcTasksUpdateLoopRate(void)
+{
+    if (ARMING_FLAG(ARMED)) {
+        return false;
+    }
+    ATOMIC_BLOCK(NVIC_PRIO_PID_LOOP) {
+        gyroUpdateSampleRate();
+        pidSetTargetLooptime((gyro.targetLooptime + LOOPTIME_SUSPEND_TIME) * pidConfig()->pid_process_denom);
+        pidInitFilters(&currentProfile->pidProfile);
+        pidInitConfig(&currentProfile->pidProfile);
+        configureLoopRateTasks();
+    }
+    return true;
+}
+
 void fcTasksInit(void)
 {
     schedulerInit();
-    rescheduleTask(TASK_GYROPID, gyro.targetLooptime);
+#ifdef USE_PID_LOOP_INTERRUPT
+    pidLoopInInterrupt = pidLoopInterruptInit();
+#endif
+    configureLoopRateTasks();
     setTaskEnabled(TASK_GYROPID, true);
+    // the gyro data ready interrupt wakes the scheduler in time for the next PID loop
+    schedulerSetIdleSleep(masterConfig.idle_sleep && gyro.dev.mpuIntExtiConfig);
 
     if (sensors(SENSOR_ACC)) {
         setTaskEnabled(TASK_ACCEL, true);
@@ -231,10 +556,18 @@ void fcTasksInit(void)
     setTaskEnabled(TASK_ATTITUDE, sensors(SENSOR_ACC));
     setTaskEnabled(TASK_SERIAL, true);
     setTaskEnabled(TASK_BATTERY, feature(FEATURE_VBAT) || feature(FEATURE_CURRENT_METER));
+    // runs once to pick up a save queued during init, then only while writeConfigDeferred() has one in progress
+    setTaskEnabled(TASK_CONFIG_SAVE, true);
     setTaskEnabled(TASK_RX, true);
+    // serial and MSP receivers signal TASK_RX when a frame is complete, the others are polled
+    setTaskSignalDriven(TASK_RX, feature(FEATURE_RX_SERIAL) || feature(FEATURE_RX_MSP));
+    setTaskEnabled(TASK_RC_COMMAND, true);
+    setTaskSignalDriven(TASK_RC_COMMAND, true);
 
 #ifdef BEEPER
     setTaskEnabled(TASK_BEEPER, true);
+    // beeper() signals the task, after that it runs at the edges of the sequence
+    setTaskSignalDriven(TASK_BEEPER, true);
 #endif
 #ifdef GPS
     setTaskEnabled(TASK_GPS, feature(FEATURE_GPS));
@@ -300,12 +633,31 @@ void fcTasksInit(void)
     setTaskEnabled(TASK_VTXCTRL, true);
 #endif
 #endif
+#ifdef USE_RTC6705
+    setTaskEnabled(TASK_VTXCTRL, feature(FEATURE_VTX));
+#endif
+#ifdef USE_SERVOS
+    setTaskEnabled(TASK_SERVOS, isMixerUsingServos());
+#endif
+#ifdef USE_BLACKBOX_COMPRESSION
+    setTaskEnabled(TASK_BLACKBOX_COMPRESS, blackboxConfig()->compression);
+#endif
+#ifdef USE_FLASHFS
+    setTaskEnabled(TASK_FLASHFS, flashfsGetSize() > 0);
+#endif
+#ifdef BLACKBOX
+    setTaskEnabled(TASK_BLACKBOX, feature(FEATURE_BLACKBOX));
+    setTaskSignalDriven(TASK_BLACKBOX, true);
+#endif
+#ifdef USE_SDCARD
+    setTaskEnabled(TASK_SDCARD, feature(FEATURE_SDCARD));
+#endif
 }
 
 cfTask_t cfTasks[TASK_COUNT] = {
     [TASK_SYSTEM] = {
         .taskName = "SYSTEM",
-        .taskFunc = taskSystem,
+        .taskFunc = taskSystemUpdate,
         .desiredPeriod = TASK_PERIOD_HZ(10),        // 10Hz, every 100 ms
         .staticPriority = TASK_PRIORITY_HIGH,
     },
@@ -325,6 +677,13 @@ cfTask_t cfTasks[TASK_COUNT] = {
         .staticPriority = TASK_PRIORITY_MEDIUM,
     },
 
+    [TASK_CONFIG_SAVE] = {
+        .taskName = "CONFIG_SAVE",
+        .taskFunc = taskConfigSave,
+        .desiredPeriod = TASK_PERIOD_HZ(500),
+        .staticPriority = TASK_PRIORITY_LOW,
+    },
+
     [TASK_ATTITUDE] = {
         .taskName = "ATTITUDE",
         .taskFunc = imuUpdateAttitude,
@@ -340,6 +699,14 @@ cfTask_t cfTasks[TASK_COUNT] = {
         .staticPriority = TASK_PRIORITY_HIGH,
     },
 
+    [TASK_RC_COMMAND] = {
+        .taskName = "RC_COMMAND",
+        .checkFunc = taskUpdateRcCommandCheck,
+        .taskFunc = taskUpdateRcCommand,
+        .desiredPeriod = TASK_PERIOD_HZ(50),        // signalled by TASK_RX after each update
+        .staticPriority = TASK_PRIORITY_HIGH,
+    },
+
     [TASK_SERIAL] = {
         .taskName = "SERIAL",
         .taskFunc = taskHandleSerial,
@@ -357,8 +724,9 @@ cfTask_t cfTasks[TASK_COUNT] = {
 #ifdef BEEPER
     [TASK_BEEPER] = {
         .taskName = "BEEPER",
+        .checkFunc = beeperUpdateCheck,
         .taskFunc = beeperUpdate,
-        .desiredPeriod = TASK_PERIOD_HZ(100),       // 100 Hz
+        .desiredPeriod = TASK_PERIOD_HZ(100),       // rescheduled to the next edge of the sequence by beeperUpdate()
         .staticPriority = TASK_PRIORITY_LOW,
     },
 #endif
@@ -403,7 +771,7 @@ cfTask_t cfTasks[TASK_COUNT] = {
     [TASK_ALTITUDE] = {
         .taskName = "ALTITUDE",
         .taskFunc = taskCalculateAltitude,
-        .desiredPeriod = TASK_PERIOD_HZ(40),
+        .desiredPeriod = TASK_PERIOD_HZ(ALTITUDE_UPDATE_HZ),
         .staticPriority = TASK_PRIORITY_LOW,
     },
 #endif
@@ -464,7 +832,7 @@ cfTask_t cfTasks[TASK_COUNT] = {
     [TASK_ESC_SENSOR] = {
         .taskName = "ESC_SENSOR",
         .taskFunc = escSensorProcess,
-        .desiredPeriod = TASK_PERIOD_HZ(100),       // 100 Hz every 10ms
+        .desiredPeriod = TASK_PERIOD_HZ(1000),      // 1000 Hz, the next frame is requested as soon as one arrives
         .staticPriority = TASK_PRIORITY_LOW,
     },
 #endif
@@ -487,12 +855,61 @@ cfTask_t cfTasks[TASK_COUNT] = {
     },
 #endif
 
-#ifdef VTX_CONTROL
+#if defined(VTX_CONTROL) || defined(USE_RTC6705)
     [TASK_VTXCTRL] = {
         .taskName = "VTXCTRL",
+#ifdef USE_RTC6705
+        .checkFunc = taskVtxControlCheck,
+#endif
         .taskFunc = taskVtxControl,
         .desiredPeriod = TASK_PERIOD_HZ(5),          // 5Hz @200msec
         .staticPriority = TASK_PRIORITY_IDLE,
     },
 #endif
+
+#ifdef USE_SERVOS
+    [TASK_SERVOS] = {
+        .taskName = "SERVOS",
+        .taskFunc = taskUpdateServos,
+        .desiredPeriod = TASK_PERIOD_HZ(50),        // rescheduled to the servo PWM rate in fcTasksInit()
+        .staticPriority = TASK_PRIORITY_HIGH,
+    },
+#endif
+
+#ifdef USE_BLACKBOX_COMPRESSION
+    [TASK_BLACKBOX_COMPRESS] = {
+        .taskName = "BBCOMPRESS",
+        .taskFunc = taskBlackboxCompress,
+        .desiredPeriod = TASK_PERIOD_HZ(500),       // a 2KB block fills in about 8ms at 8kHz logging
+        .staticPriority = TASK_PRIORITY_LOW,
+    },
+#endif
+
+#ifdef USE_FLASHFS
+    [TASK_FLASHFS] = {
+        .taskName = "FLASHFS",
+        .taskFunc = taskFlashfs,
+        .desiredPeriod = TASK_PERIOD_HZ(2000),      // a page takes about 0.8ms to program
+        .staticPriority = TASK_PRIORITY_MEDIUM,
+    },
+#endif
+
+#ifdef BLACKBOX
+    [TASK_BLACKBOX] = {
+        .taskName = "BLACKBOX",
+        .checkFunc = taskBlackboxCheck,
+        .taskFunc = taskBlackbox,
+        .desiredPeriod = TASK_PERIOD_HZ(100),       // signalled by the PID loop after each update
+        .staticPriority = TASK_PRIORITY_HIGH,
+    },
+#endif
+
+#ifdef USE_SDCARD
+    [TASK_SDCARD] = {
+        .taskName = "SDCARD",
+        .taskFunc = taskSdcard,
+        .desiredPeriod = TASK_PERIOD_HZ(2000),      // each poll moves a block transfer on by a step
+        .staticPriority = TASK_PRIORITY_MEDIUM,
+    },
+#endif
 };
@@ -19,4 +19,25 @@
 
 #define LOOPTIME_SUSPEND_TIME 3  // Prevent too long busy wait times
 
+// Tasks that may be slowed down while the system is overloaded
+typedef enum {
+    TASK_SHED_LEDSTRIP = 0,
+    TASK_SHED_DASHBOARD,
+    TASK_SHED_TELEMETRY,
+    TASK_SHED_OSD,
+    TASK_SHED_COUNT
+} taskShedSlot_e;
+
+typedef struct taskShedConfig_s {
+    uint16_t minRateHz;                     // the task is never slowed below this rate
+    uint8_t priority;                       // higher values are shed first, 0 = never shed
+} taskShedConfig_t;
+
+typedef struct taskSheddingConfig_s {
+    uint8_t overloadPercent;                // average system load at which tasks are slowed, 0 = disabled
+    uint8_t recoverPercent;                 // average system load below which slowed tasks are restored
+    taskShedConfig_t task[TASK_SHED_COUNT];
+} taskSheddingConfig_t;
+
 void fcTasksInit(void);
+bool fcTasksUpdateLoopRate(void);
@@ -0,0 +1,170 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_LOOP_LATENCY
+
+#include "build/debug.h"
+
+#include "common/maths.h"
+
+#include "drivers/system.h"
+
+#include "fc/loop_latency.h"
+
+// DEBUG_LOOP_LATENCY, latency of the latest loop in microseconds:
+// 0 - gyro data ready to pidController() completion
+// 1 - gyro data ready to motor output
+// 2 - pidController() completion to motor output
+// 3 - gyro data ready to the start of the gyro read
+
+// DEBUG_GYRO_PHASE, with gyro_phase_lock set:
+// 0 - gyro data ready to the start of the gyro read, the phase the loop is held at
+// 1 - gyro data ready to motor output
+// 2 - measured gyro sample period in 1/10us
+// 3 - phase error, the read phase less gyro_phase_lock
+
+// sum and count are halved when count reaches this, so the average follows recent settings
+#define LOOP_LATENCY_AVERAGE_COUNT (1 << 16)
+
+static loopLatencyStats_t loopLatencyStats[LOOP_LATENCY_COUNT];
+static timeUs_t lastGyroSampleAtUs;
+static timeUs_t lastPidCompleteAtUs;
+static timeUs_t lastGyroReadSampleAtUs;
+static timeUs_t phaseLockSampleAtUs;
+static uint32_t phaseLockPeriodUs16;    // the gyro sample period in 1/16us, the sensor's clock is not the MCU's
+
+static void loopLatencyAdd(loopLatencyStage_e stage, timeUs_t latencyUs)
+{
+    loopLatencyStats_t *stats = &loopLatencyStats[stage];
+
+    if (stats->count == 0 || latencyUs < stats->min) {
+        stats->min = latencyUs;
+    }
+    stats->max = MAX(stats->max, latencyUs);
+    stats->sum += latencyUs;
+    if (++stats->count >= LOOP_LATENCY_AVERAGE_COUNT) {
+        stats->sum /= 2;
+        stats->count /= 2;
+    }
+    taskHistogramAdd(stats->histogram, latencyUs);
+}
+
+/*
+ * Called as the loop starts reading the gyro, loops run without a new data ready are not counted
+ */
+void loopLatencyGyroRead(timeUs_t gyroSampleAtUs)
+{
+    if (!gyroSampleAtUs || gyroSampleAtUs == lastGyroReadSampleAtUs) {
+        return;
+    }
+    lastGyroReadSampleAtUs = gyroSampleAtUs;
+    const timeUs_t latencyUs = micros() - gyroSampleAtUs;
+    loopLatencyAdd(LOOP_LATENCY_GYRO_TO_READ, latencyUs);
+    DEBUG_SET(DEBUG_LOOP_LATENCY, 3, latencyUs);
+}
+
+/*
+ * Called once pidController() has run on the sample that set gyroSampleAtUs
+ */
+void loopLatencyPidComplete(timeUs_t gyroSampleAtUs)
+{
+    lastPidCompleteAtUs = micros();
+    // zero when the gyro has no data ready interrupt
+    lastGyroSampleAtUs = gyroSampleAtUs;
+    if (lastGyroSampleAtUs) {
+        const timeUs_t latencyUs = lastPidCompleteAtUs - lastGyroSampleAtUs;
+        loopLatencyAdd(LOOP_LATENCY_GYRO_TO_PID, latencyUs);
+        DEBUG_SET(DEBUG_LOOP_LATENCY, 0, latencyUs);
+    }
+}
+
+/*
+ * Called after the motors have been written, with the time the output driver started the update
+ */
+void loopLatencyMotorOutput(timeUs_t motorOutputAtUs)
+{
+    // protocols without a completion step leave the timestamp of an earlier update
+    if (!lastGyroSampleAtUs || cmpTimeUs(motorOutputAtUs, lastPidCompleteAtUs) < 0) {
+        return;
+    }
+    const timeUs_t latencyUs = motorOutputAtUs - lastGyroSampleAtUs;
+    loopLatencyAdd(LOOP_LATENCY_GYRO_TO_MOTOR, latencyUs);
+    DEBUG_SET(DEBUG_LOOP_LATENCY, 1, latencyUs);
+    DEBUG_SET(DEBUG_GYRO_PHASE, 1, latencyUs);
+    DEBUG_SET(DEBUG_LOOP_LATENCY, 2, motorOutputAtUs - lastPidCompleteAtUs);
+    lastGyroSampleAtUs = 0;
+}
+
+/*
+ * Called by the PID loop task as it starts reading the gyro. The task is free running against the gyro, so the age
+ * of the sample it reads, and with it the delay to the motors, wanders over a whole loop period. Instead the next
+ * run is put offsetUs after the next data ready interrupt, worked out from this one and the measured sample period.
+ * The motor output follows the PID loop directly, so the gyro to motor delay is held as well.
+ */
+void loopLatencyPhaseLock(timeUs_t gyroSampleAtUs, uint32_t gyroLooptimeUs, timeUs_t offsetUs)
+{
+    // no new sample since the last run, the task keeps to its period until there is one
+    if (!gyroSampleAtUs || gyroSampleAtUs == phaseLockSampleAtUs) {
+        return;
+    }
+
+    const timeUs_t phaseUs = micros() - gyroSampleAtUs;
+    if (!phaseLockPeriodUs16) {
+        phaseLockPeriodUs16 = gyroLooptimeUs * 16;
+    } else if (phaseLockSampleAtUs) {
+        const timeUs_t sampleDeltaUs = gyroSampleAtUs - phaseLockSampleAtUs;
+        const uint32_t samples = (sampleDeltaUs + gyroLooptimeUs / 2) / gyroLooptimeUs;
+        if (samples >= 1 && samples <= 8) {
+            const int32_t periodUs16 = sampleDeltaUs * 16 / samples;
+            // anything further out than 1/8 of the period is a missed interrupt rather than the sensor's clock
+            if (ABS(periodUs16 - (int32_t)gyroLooptimeUs * 16) < (int32_t)gyroLooptimeUs * 2) {
+                phaseLockPeriodUs16 += (periodUs16 - (int32_t)phaseLockPeriodUs16) / 16;
+            }
+        }
+    }
+    phaseLockSampleAtUs = gyroSampleAtUs;
+
+    rescheduleTaskAt(TASK_GYROPID, gyroSampleAtUs + (phaseLockPeriodUs16 + 8) / 16 + offsetUs);
+
+    DEBUG_SET(DEBUG_GYRO_PHASE, 0, phaseUs);
+    DEBUG_SET(DEBUG_GYRO_PHASE, 2, phaseLockPeriodUs16 * 10 / 16);
+    DEBUG_SET(DEBUG_GYRO_PHASE, 3, (int32_t)phaseUs - (int32_t)offsetUs);
+}
+
+const loopLatencyStats_t *getLoopLatencyStats(loopLatencyStage_e stage)
+{
+    return &loopLatencyStats[stage];
+}
+
+timeUs_t getLoopLatencyAverage(loopLatencyStage_e stage)
+{
+    const loopLatencyStats_t *stats = &loopLatencyStats[stage];
+    return stats->count ? stats->sum / stats->count : 0;
+}
+
+void loopLatencyReset(void)
+{
+    memset(loopLatencyStats, 0, sizeof(loopLatencyStats));
+}
+
+#endif
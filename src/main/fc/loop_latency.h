@@ -0,0 +1,45 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/time.h"
+
+#include "scheduler/scheduler.h"
+
+typedef enum {
+    LOOP_LATENCY_GYRO_TO_PID = 0,           // gyro data ready interrupt to pidController() completion
+    LOOP_LATENCY_GYRO_TO_MOTOR,             // gyro data ready interrupt to the start of the motor output
+    LOOP_LATENCY_GYRO_TO_READ,              // gyro data ready interrupt to the loop starting the gyro read
+    LOOP_LATENCY_COUNT
+} loopLatencyStage_e;
+
+typedef struct loopLatencyStats_s {
+    timeUs_t min;
+    timeUs_t max;
+    uint32_t sum;
+    uint32_t count;
+    uint16_t histogram[TASK_HISTOGRAM_BUCKET_COUNT];    // same buckets as the task histograms
+} loopLatencyStats_t;
+
+void loopLatencyGyroRead(timeUs_t gyroSampleAtUs);
+void loopLatencyPidComplete(timeUs_t gyroSampleAtUs);
+void loopLatencyMotorOutput(timeUs_t motorOutputAtUs);
+void loopLatencyPhaseLock(timeUs_t gyroSampleAtUs, uint32_t gyroLooptimeUs, timeUs_t offsetUs);
+const loopLatencyStats_t *getLoopLatencyStats(loopLatencyStage_e stage);
+timeUs_t getLoopLatencyAverage(loopLatencyStage_e stage);
+void loopLatencyReset(void);
@@ -0,0 +1,171 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "platform.h"
+
+#ifdef USE_LOOP_RATE_AUTO
+
+#include "build/profile.h"
+
+#include "common/maths.h"
+
+#include "drivers/accgyro.h"
+
+#include "fc/fc_tasks.h"
+#include "fc/loop_rate.h"
+#include "fc/runtime_config.h"
+
+#include "scheduler/scheduler.h"
+
+#include "sensors/gyro.h"
+
+#include "config/config_master.h"
+
+#define LOOP_RATE_AUTO_SETTLE_US        (1000 * 1000)   // after gyro calibration, before the measurement starts
+#define LOOP_RATE_AUTO_MEASURE_US       (2000 * 1000)
+#define LOOP_RATE_AUTO_DENOM_MAX        8               // the limit of gyro_sync_denom and pid_process_denom
+
+static loopRateAutoState_e loopRateAutoState = LOOP_RATE_AUTO_IDLE;
+static timeUs_t stateStartedAt;
+static loopRateAutoResult_t loopRateAutoResult;
+
+static float probeAverageUs(profileProbe_e probe)
+{
+    return (float)profileGetAverageCycles(probe) / profileGetCyclesPerMicrosecond();
+}
+
+// share of the CPU taken by the tasks, which run at the same rates whatever the loop rate, the PID loop itself is timed by the probes
+static float otherTasksLoad(void)
+{
+    float load = 0.0f;
+    for (int taskId = 0; taskId < TASK_COUNT; taskId++) {
+        if (taskId == TASK_GYROPID) {
+            continue;
+        }
+        cfTaskInfo_t taskInfo;
+        getTaskInfo(taskId, &taskInfo);
+        if (taskInfo.isEnabled && taskInfo.latestDeltaTime) {
+            load += (float)taskInfo.averageExecutionTime / taskInfo.latestDeltaTime;
+        }
+    }
+    return load;
+}
+
+/*
+ * Picks the fastest PID loop, and then the fastest gyro sampling to run it from, that keeps the estimated
+ * CPU load within 100% less loop_rate_headroom. When no rate fits, the one with the lowest load is taken.
+ */
+static void loopRateAutoSelect(void)
+{
+    const float gyroUs = probeAverageUs(PROFILE_GYRO_UPDATE);
+    const float pidUs = probeAverageUs(PROFILE_PID_CONTROLLER) + probeAverageUs(PROFILE_MIX_TABLE) + probeAverageUs(PROFILE_WRITE_MOTORS);
+    const float otherLoad = otherTasksLoad();
+    const float loadLimit = (100 - pidConfig()->loop_rate_headroom) / 100.0f;
+
+    // the sensor only samples at 8kHz with the 256Hz or no hardware LPF, see gyroSetSampleRate()
+    const bool fastSampling = gyro.dev.lpf == GYRO_LPF_256HZ || gyro.dev.lpf == GYRO_LPF_NONE;
+    const uint32_t samplePeriodUs = fastSampling ? 125 : 1000;
+    const int gyroDenomMax = fastSampling ? LOOP_RATE_AUTO_DENOM_MAX : 1;
+
+    bool found = false;
+    bool bestFits = false;
+    uint32_t bestPidPeriodUs = 0;
+    float bestLoad = 0.0f;
+    // smaller gyro denominators come first, so of two equal PID rates the faster sampling is kept
+    for (int gyroDenom = 1; gyroDenom <= gyroDenomMax; gyroDenom++) {
+        const uint32_t gyroPeriodUs = samplePeriodUs * gyroDenom;
+        // reading the FIFO filters every sample the sensor takes, whatever the rate the FIFO is drained at
+        const float gyroLoad = gyro.dev.fifoEnabled ? gyroUs / gyro.targetLooptime : gyroUs / gyroPeriodUs;
+        for (int pidDenom = 1; pidDenom <= LOOP_RATE_AUTO_DENOM_MAX; pidDenom++) {
+            const uint32_t pidPeriodUs = gyroPeriodUs * pidDenom;
+            const float load = gyroLoad + pidUs / pidPeriodUs + otherLoad;
+            const bool fits = load <= loadLimit;
+            bool better;
+            if (!found) {
+                better = true;
+            } else if (fits) {
+                better = !bestFits || pidPeriodUs < bestPidPeriodUs;
+            } else {
+                better = !bestFits && load < bestLoad;
+            }
+            if (better) {
+                found = true;
+                bestFits = fits;
+                bestPidPeriodUs = pidPeriodUs;
+                bestLoad = load;
+                loopRateAutoResult.gyroSyncDenom = gyroDenom;
+                loopRateAutoResult.pidProcessDenom = pidDenom;
+            }
+        }
+    }
+
+    loopRateAutoResult.loadPercent = constrain(lrintf(bestLoad * 100), 0, UINT8_MAX);
+    loopRateAutoResult.gyroUs100 = constrain(lrintf(gyroUs * 100), 0, UINT16_MAX);
+    loopRateAutoResult.pidUs100 = constrain(lrintf(pidUs * 100), 0, UINT16_MAX);
+    loopRateAutoResult.otherLoadPercent = constrain(lrintf(otherLoad * 100), 0, UINT8_MAX);
+}
+
+// measures the PID path at the rate currently running, and applies the rate selected from it, only while disarmed
+void loopRateAutoStart(timeUs_t currentTimeUs)
+{
+    loopRateAutoState = LOOP_RATE_AUTO_SETTLING;
+    stateStartedAt = currentTimeUs;
+}
+
+void loopRateAutoUpdate(timeUs_t currentTimeUs)
+{
+    if (loopRateAutoState != LOOP_RATE_AUTO_SETTLING && loopRateAutoState != LOOP_RATE_AUTO_MEASURING) {
+        return;
+    }
+    if (ARMING_FLAG(ARMED)) {
+        loopRateAutoState = LOOP_RATE_AUTO_ABORTED;
+        return;
+    }
+
+    if (loopRateAutoState == LOOP_RATE_AUTO_SETTLING) {
+        if (!isGyroCalibrationComplete()) {
+            stateStartedAt = currentTimeUs;
+        } else if (cmpTimeUs(currentTimeUs, stateStartedAt) >= LOOP_RATE_AUTO_SETTLE_US) {
+            profileReset();
+            stateStartedAt = currentTimeUs;
+            loopRateAutoState = LOOP_RATE_AUTO_MEASURING;
+        }
+    } else if (cmpTimeUs(currentTimeUs, stateStartedAt) >= LOOP_RATE_AUTO_MEASURE_US) {
+        loopRateAutoSelect();
+        // the choice is saved along with the rest of the configuration, if it is saved
+        gyroConfig()->gyro_sync_denom = loopRateAutoResult.gyroSyncDenom;
+        pidConfig()->pid_process_denom = loopRateAutoResult.pidProcessDenom;
+        fcTasksUpdateLoopRate();
+        loopRateAutoState = LOOP_RATE_AUTO_DONE;
+    }
+}
+
+loopRateAutoState_e loopRateAutoGetState(void)
+{
+    return loopRateAutoState;
+}
+
+const loopRateAutoResult_t *loopRateAutoGetResult(void)
+{
+    return &loopRateAutoResult;
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/time.h"
+
+typedef enum {
+    LOOP_RATE_AUTO_IDLE = 0,                // never run since boot
+    LOOP_RATE_AUTO_SETTLING,                // waiting for the loop to run at the configured rate before measuring
+    LOOP_RATE_AUTO_MEASURING,               // the cycle profiler is collecting the PID path times
+    LOOP_RATE_AUTO_DONE,                    // the selected rate is applied
+    LOOP_RATE_AUTO_ABORTED                  // armed before the measurement completed, the configured rate is kept
+} loopRateAutoState_e;
+
+typedef struct loopRateAutoResult_s {
+    uint8_t gyroSyncDenom;
+    uint8_t pidProcessDenom;
+    uint8_t loadPercent;                    // CPU load estimated for the selected rate
+    uint16_t gyroUs100;                     // average gyroUpdate() time, in 0.01us
+    uint16_t pidUs100;                      // average PID, mixer and motor output time, in 0.01us
+    uint8_t otherLoadPercent;               // CPU load of the tasks that don't follow the loop rate
+} loopRateAutoResult_t;
+
+void loopRateAutoStart(timeUs_t currentTimeUs);
+void loopRateAutoUpdate(timeUs_t currentTimeUs);
+loopRateAutoState_e loopRateAutoGetState(void);
+const loopRateAutoResult_t *loopRateAutoGetResult(void);
@@ -0,0 +1,141 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_POST_MORTEM
+
+#include "build/build_config.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/system.h"
+
+#include "fc/post_mortem.h"
+#include "fc/runtime_config.h"
+
+#include "scheduler/scheduler.h"
+#include "scheduler/scheduler_trace.h"
+
+#define POST_MORTEM_MAGIC 0x4d54504d // "MPTM"
+
+extern char _sstackram; // declared in .LD file
+extern char _estack;
+
+/*
+ * Kept in RAM that the startup code leaves alone, so the record of a fault or lockup can be read after the reset
+ * that follows it. A power cycle loses it.
+ */
+static postMortem_t postMortem PERSISTENT;
+
+static uint16_t postMortemChecksum(void)
+{
+    return crc16_ccitt_buf(0, &postMortem, offsetof(postMortem_t, checksum));
+}
+
+// the watchdog callback, only a lockup while armed is recorded, configuration saves and the like block while disarmed
+static void postMortemLockupCheck(void)
+{
+    if (!ARMING_FLAG(ARMED)) {
+        return;
+    }
+    postMortemCapture(POST_MORTEM_LOCKUP, NULL);
+    systemReset();
+}
+
+// anything other than a record of this build's layout is garbage from power up, and is cleared
+void postMortemInit(void)
+{
+    if (postMortem.magic != POST_MORTEM_MAGIC || postMortem.size != sizeof(postMortem) || postMortem.checksum != postMortemChecksum()) {
+        postMortemClear();
+    }
+    systemWatchdogInit(POST_MORTEM_LOCKUP_MS, postMortemLockupCheck);
+}
+
+static bool postMortemIsStackAddress(const uint32_t *address, int words)
+{
+    return (const char *)address >= &_sstackram && (const char *)(address + words) <= &_estack && ((uint32_t)address & 3) == 0;
+}
+
+/*
+ * Called from the hard fault handler with the registers it stacked, or from the SysTick interrupt with none. Only
+ * reads memory, so it can't fault again unless the scheduler state itself is what was corrupted.
+ */
+void postMortemCapture(postMortemReason_e reason, const uint32_t *faultFrame)
+{
+    memset(&postMortem, 0, sizeof(postMortem));
+    postMortem.magic = POST_MORTEM_MAGIC;
+    postMortem.size = sizeof(postMortem);
+    postMortem.reason = reason;
+    postMortem.taskId = schedulerGetCurrentTaskId();
+    postMortem.uptimeMs = millis();
+    postMortem.systemLoadPercent = averageSystemLoadPercent;
+    postMortem.armed = ARMING_FLAG(ARMED) ? 1 : 0;
+
+    postMortem.cfsr = SCB->CFSR;
+    postMortem.hfsr = SCB->HFSR;
+    postMortem.mmfar = SCB->MMFAR;
+    postMortem.bfar = SCB->BFAR;
+
+    if (faultFrame) {
+        const int frameWords = ARRAYLEN(postMortem.registers);
+        postMortem.sp = (uint32_t)(faultFrame + frameWords);
+        if (postMortemIsStackAddress(faultFrame, frameWords)) {
+            memcpy(postMortem.registers, faultFrame, sizeof(postMortem.registers));
+        }
+        // the stack pointer is kept even when it is off the stack, an overflow shows as such
+        for (int i = 0; i < POST_MORTEM_STACK_WORDS && postMortemIsStackAddress(faultFrame + frameWords + i, 1); i++) {
+            postMortem.stack[i] = faultFrame[frameWords + i];
+        }
+    }
+
+    for (int taskId = 0; taskId < TASK_COUNT; taskId++) {
+        cfTaskInfo_t taskInfo;
+        getTaskInfo(taskId, &taskInfo);
+        postMortem.tasks[taskId].averageUs = MIN(taskInfo.averageExecutionTime, UINT16_MAX);
+        postMortem.tasks[taskId].maxUs = MIN(taskInfo.maxExecutionTime, UINT16_MAX);
+    }
+
+#ifdef USE_SCHEDULER_TRACE
+    postMortem.traceCyclesPerUs = schedulerTraceGetCyclesPerMicrosecond();
+    const int eventCount = schedulerTraceGetEventCount();
+    const int first = MAX(eventCount - POST_MORTEM_TRACE_EVENTS, 0);
+    for (int i = first; i < eventCount; i++) {
+        postMortem.trace[postMortem.traceCount++] = *schedulerTraceGetEvent(i);
+    }
+#endif
+
+    postMortem.checksum = postMortemChecksum();
+}
+
+const postMortem_t *postMortemGet(void)
+{
+    return postMortem.reason != POST_MORTEM_NONE ? &postMortem : NULL;
+}
+
+void postMortemClear(void)
+{
+    memset(&postMortem, 0, sizeof(postMortem));
+}
+
+#endif
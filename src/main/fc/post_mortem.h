@@ -0,0 +1,65 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "scheduler/scheduler.h"
+#include "scheduler/scheduler_trace.h"
+
+typedef enum {
+    POST_MORTEM_NONE = 0,
+    POST_MORTEM_HARD_FAULT,                 // the registers and stack are those stacked by the fault
+    POST_MORTEM_LOCKUP                      // the scheduler stopped running for POST_MORTEM_LOCKUP_MS while armed
+} postMortemReason_e;
+
+#define POST_MORTEM_LOCKUP_MS       500
+#define POST_MORTEM_STACK_WORDS     16
+#define POST_MORTEM_TRACE_EVENTS    32
+
+typedef struct postMortemTask_s {
+    uint16_t averageUs;
+    uint16_t maxUs;
+} postMortemTask_t;
+
+typedef struct postMortem_s {
+    uint32_t magic;
+    uint16_t size;                          // a record left by a build with another layout is ignored
+    uint8_t reason;                         // postMortemReason_e
+    uint8_t taskId;                         // the task running or the last one to run, TASK_NONE if there was none
+    uint32_t uptimeMs;
+    uint16_t systemLoadPercent;
+    uint8_t armed;
+    uint32_t registers[8];                  // r0-r3, r12, lr, pc and xpsr as stacked by the fault
+    uint32_t cfsr;
+    uint32_t hfsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+    uint32_t sp;                            // above the stacked registers
+    uint32_t stack[POST_MORTEM_STACK_WORDS];
+    postMortemTask_t tasks[TASK_COUNT];
+#ifdef USE_SCHEDULER_TRACE
+    uint32_t traceCyclesPerUs;
+    uint8_t traceCount;
+    schedulerTraceEvent_t trace[POST_MORTEM_TRACE_EVENTS]; // the last events, oldest first
+#endif
+    uint16_t checksum;
+} postMortem_t;
+
+void postMortemInit(void);
+void postMortemCapture(postMortemReason_e reason, const uint32_t *faultFrame);
+const postMortem_t *postMortemGet(void);
+void postMortemClear(void);
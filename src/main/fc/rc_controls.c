@@ -343,12 +343,95 @@ bool isRangeActive(uint8_t auxChannelIndex, channelRange_t *range) {
             channelValue < 900 + (range->endStep * 25));
 }
 
-void updateActivatedModes(modeActivationCondition_t *modeActivationConditions)
+/*
+ * A range is active while the step of its channel is in [startStep, endStep), so the ranges on a channel can only
+ * change state when the step crosses one of their ends. The map holds the ends of the ranges on each aux channel and
+ * the step each channel was at, so the ranges are only evaluated again when a channel crosses one.
+ */
+typedef struct rangeChannelMap_s {
+    uint64_t boundaries[MAX_AUX_CHANNEL_COUNT];     // bit n set when a range on the channel starts or ends at step n
+    uint8_t steps[MAX_AUX_CHANNEL_COUNT];
+    bool valid;
+} rangeChannelMap_t;
+
+static rangeChannelMap_t modeRangeMap;
+static rangeChannelMap_t adjustmentRangeMap;
+
+static void rangeChannelMapReset(rangeChannelMap_t *map)
 {
-    rcModeActivationMask = 0;
+    memset(map->boundaries, 0, sizeof(map->boundaries));
+    map->valid = true;
+}
+
+static void rangeChannelMapAdd(rangeChannelMap_t *map, uint8_t auxChannelIndex, const channelRange_t *range)
+{
+    if (auxChannelIndex >= MAX_AUX_CHANNEL_COUNT || !IS_RANGE_USABLE(range)) {
+        return;
+    }
+    map->boundaries[auxChannelIndex] |= ((uint64_t)1 << range->startStep) | ((uint64_t)1 << range->endStep);
+}
 
+static uint8_t rangeChannelStep(uint8_t auxChannelIndex)
+{
+    // the same step isRangeActive() compares against
+    return (constrain(rcData[auxChannelIndex + NON_AUX_CHANNEL_COUNT], CHANNEL_RANGE_MIN, CHANNEL_RANGE_MAX - 1) - CHANNEL_RANGE_MIN) / 25;
+}
+
+// takes the steps of the channels, returns true if any of them crossed the end of a range since the last call
+static bool rangeChannelMapUpdate(rangeChannelMap_t *map)
+{
+    bool crossed = false;
+
+    for (int i = 0; i < MAX_AUX_CHANNEL_COUNT; i++) {
+        if (!map->boundaries[i]) {
+            continue;
+        }
+        const uint8_t step = rangeChannelStep(i);
+        const uint8_t previousStep = map->steps[i];
+        if (step == previousStep) {
+            continue;
+        }
+        map->steps[i] = step;
+
+        // the ends between the two steps, a range ending at the lower step was already left there
+        const uint8_t low = MIN(step, previousStep);
+        const uint8_t high = MAX(step, previousStep);
+        const uint64_t between = ((uint64_t)1 << (high + 1)) - ((uint64_t)1 << (low + 1));
+        if (map->boundaries[i] & between) {
+            crossed = true;
+        }
+    }
+
+    return crossed;
+}
+
+// the range maps are rebuilt on their next use, call when the mode or adjustment ranges are changed
+void rcControlsRangesChanged(void)
+{
+    modeRangeMap.valid = false;
+    adjustmentRangeMap.valid = false;
+}
+
+void updateActivatedModes(modeActivationCondition_t *modeActivationConditions)
+{
     uint8_t index;
 
+    if (modeRangeMap.valid) {
+        if (!rangeChannelMapUpdate(&modeRangeMap)) {
+            return;
+        }
+    } else {
+        rangeChannelMapReset(&modeRangeMap);
+        for (index = 0; index < MAX_MODE_ACTIVATION_CONDITION_COUNT; index++) {
+            rangeChannelMapAdd(&modeRangeMap, modeActivationConditions[index].auxChannelIndex, &modeActivationConditions[index].range);
+        }
+        for (index = 0; index < MAX_AUX_CHANNEL_COUNT; index++) {
+            modeRangeMap.steps[index] = rangeChannelStep(index);
+        }
+    }
+
+    rcModeActivationMask = 0;
+
     for (index = 0; index < MAX_MODE_ACTIVATION_CONDITION_COUNT; index++) {
         modeActivationCondition_t *modeActivationCondition = &modeActivationConditions[index];
 
@@ -622,6 +705,22 @@ static void applyStepAdjustment(controlRateConfig_t *controlRateConfig, uint8_t
         default:
             break;
     };
+
+#ifdef USE_RC_RATE_TABLE
+    switch(adjustmentFunction) {
+        case ADJUSTMENT_RC_RATE:
+        case ADJUSTMENT_RC_EXPO:
+        case ADJUSTMENT_PITCH_ROLL_RATE:
+        case ADJUSTMENT_PITCH_RATE:
+        case ADJUSTMENT_ROLL_RATE:
+        case ADJUSTMENT_YAW_RATE:
+        case ADJUSTMENT_RC_RATE_YAW:
+            generateRateCurves(controlRateConfig);
+            break;
+        default:
+            break;
+    }
+#endif
 }
 
 static void applySelectAdjustment(uint8_t adjustmentFunction, uint8_t position)
@@ -710,6 +809,21 @@ void updateAdjustmentStates(adjustmentRange_t *adjustmentRanges)
 {
     uint8_t index;
 
+    // the states are only ever configured by an active range, and configuring them again changes nothing
+    if (adjustmentRangeMap.valid) {
+        if (!rangeChannelMapUpdate(&adjustmentRangeMap)) {
+            return;
+        }
+    } else {
+        rangeChannelMapReset(&adjustmentRangeMap);
+        for (index = 0; index < MAX_ADJUSTMENT_RANGE_COUNT; index++) {
+            rangeChannelMapAdd(&adjustmentRangeMap, adjustmentRanges[index].auxChannelIndex, &adjustmentRanges[index].range);
+        }
+        for (index = 0; index < MAX_AUX_CHANNEL_COUNT; index++) {
+            adjustmentRangeMap.steps[index] = rangeChannelStep(index);
+        }
+    }
+
     for (index = 0; index < MAX_ADJUSTMENT_RANGE_COUNT; index++) {
         adjustmentRange_t *adjustmentRange = &adjustmentRanges[index];
 
@@ -732,10 +846,13 @@ void useRcControlsConfig(modeActivationCondition_t *modeActivationConditions, mo
     pidProfile = pidProfileToUse;
 
     isUsingSticksToArm = !isModeActivationConditionPresent(modeActivationConditions, BOXARM);
+
+    rcControlsRangesChanged();
 }
 
 void resetAdjustmentStates(void)
 {
     memset(adjustmentStates, 0, sizeof(adjustmentStates));
+    adjustmentRangeMap.valid = false;
 }
 
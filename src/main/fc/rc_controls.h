@@ -51,6 +51,7 @@ typedef enum {
     BOXAIRMODE,
     BOX3DDISABLESWITCH,
     BOXFPVANGLEMIX,
+    BOXCAPTURE,
     CHECKBOX_ITEM_COUNT
 } boxId_e;
 
@@ -90,7 +91,8 @@ typedef enum {
     RC_SMOOTHING_OFF = 0,
     RC_SMOOTHING_DEFAULT,
     RC_SMOOTHING_AUTO,
-    RC_SMOOTHING_MANUAL
+    RC_SMOOTHING_MANUAL,
+    RC_SMOOTHING_PREDICTIVE
 } rcSmoothing_t;
 
 #define ROL_LO (1 << (2 * ROLL))
@@ -184,6 +186,7 @@ void processRcStickPositions(struct rxConfig_s *rxConfig, throttleStatus_e throt
 
 bool isRangeActive(uint8_t auxChannelIndex, channelRange_t *range);
 void updateActivatedModes(modeActivationCondition_t *modeActivationConditions);
+void rcControlsRangesChanged(void);
 
 
 typedef enum {
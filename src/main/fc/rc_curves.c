@@ -17,9 +17,12 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <math.h>
 
 #include "platform.h"
 
+#include "common/maths.h"
+
 #include "config/feature.h"
 
 #include "io/motors.h"
@@ -31,6 +34,8 @@
 #include "rx/rx.h"
 
 
+#define RC_RATE_INCREMENTAL 14.54f
+
 #define THROTTLE_LOOKUP_LENGTH 12
 static int16_t lookupThrottleRC[THROTTLE_LOOKUP_LENGTH];    // lookup table for expo & mid THROTTLE
 
@@ -58,3 +63,56 @@ int16_t rcLookupThrottle(int32_t tmp)
     return lookupThrottleRC[tmp2] + (tmp - tmp2 * 100) * (lookupThrottleRC[tmp2 + 1] - lookupThrottleRC[tmp2]) / 100;
 }
 
+
+float rcCalculateRate(const controlRateConfig_t *controlRateConfig, int axis, float rcCommandf)
+{
+    float angleRate, rcRate, rcSuperfactor;
+    uint8_t rcExpo;
+
+    if (axis != YAW) {
+        rcExpo = controlRateConfig->rcExpo8;
+        rcRate = controlRateConfig->rcRate8 / 100.0f;
+    } else {
+        rcExpo = controlRateConfig->rcYawExpo8;
+        rcRate = controlRateConfig->rcYawRate8 / 100.0f;
+    }
+
+    if (rcRate > 2.0f) rcRate = rcRate + (RC_RATE_INCREMENTAL * (rcRate - 2.0f));
+
+    if (rcExpo) {
+        float expof = rcExpo / 100.0f;
+        rcCommandf = rcCommandf * power3(rcCommandf) * expof + rcCommandf * (1-expof);
+    }
+
+    angleRate = 200.0f * rcRate * rcCommandf;
+
+    if (controlRateConfig->rates[axis]) {
+        rcSuperfactor = 1.0f / (constrainf(1.0f - (ABS(rcCommandf) * (controlRateConfig->rates[axis] / 100.0f)), 0.01f, 1.00f));
+        angleRate *= rcSuperfactor;
+    }
+
+    return angleRate;
+}
+
+#ifdef USE_RC_RATE_TABLE
+// One entry per rcCommand step in 0.1 deg/s. The super rate term blows up towards full stick, so
+// interpolating a coarser table is off by hundreds of deg/s there; an exact table is only 6KB.
+static int16_t lookupRateRC[3][RC_RATE_LOOKUP_LENGTH];
+
+void generateRateCurves(const controlRateConfig_t *controlRateConfig)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        for (int i = 0; i < RC_RATE_LOOKUP_LENGTH; i++) {
+            const float angleRate = rcCalculateRate(controlRateConfig, axis, (i - RC_RATE_LOOKUP_RANGE) / 500.0f);
+            lookupRateRC[axis][i] = lrintf(constrainf(angleRate, -1998.0f, 1998.0f) * 10.0f);
+        }
+    }
+}
+
+float rcLookupRate(int axis, int16_t rc)
+{
+    // [-500;500] -> expo & super rate -> [-1998;1998] deg/s
+    const int index = constrain(rc, -RC_RATE_LOOKUP_RANGE, RC_RATE_LOOKUP_RANGE) + RC_RATE_LOOKUP_RANGE;
+    return lookupRateRC[axis][index] / 10.0f;
+}
+#endif
@@ -23,3 +23,12 @@ void generateThrottleCurve(struct controlRateConfig_s *controlRateConfig, struct
 
 int16_t rcLookupThrottle(int32_t tmp);
 
+#define RC_RATE_LOOKUP_RANGE 500
+#define RC_RATE_LOOKUP_LENGTH (2 * RC_RATE_LOOKUP_RANGE + 1)
+
+float rcCalculateRate(const struct controlRateConfig_s *controlRateConfig, int axis, float rcCommandf);
+#ifdef USE_RC_RATE_TABLE
+void generateRateCurves(const struct controlRateConfig_s *controlRateConfig);
+float rcLookupRate(int axis, int16_t rc);
+#endif
+
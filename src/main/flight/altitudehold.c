@@ -27,6 +27,7 @@
 
 #include "common/maths.h"
 #include "common/axis.h"
+#include "common/utils.h"
 
 #include "sensors/barometer.h"
 #include "sensors/sonar.h"
@@ -36,6 +37,7 @@
 #include "fc/rc_controls.h"
 #include "io/motors.h"
 
+#include "flight/altitudehold.h"
 #include "flight/pid.h"
 #include "flight/imu.h"
 
@@ -73,8 +75,18 @@ void configureAltitudeHold(
 static int16_t initialThrottleHold;
 static int32_t EstAlt;                // in cm
 
-// 40hz update rate (20hz LPF on acc)
-#define BARO_UPDATE_FREQUENCY_40HZ (1000 * 25)
+// the period baro_cf_alt and baro_cf_vel were tuned at, when the estimator ran at 40Hz
+#define ALTITUDE_CF_REFERENCE_PERIOD_US (1000 * 25)
+#define ALTITUDE_CF_REFERENCE_HZ 40
+
+// the estimate is held in cm and cm/s with 8 fractional bits
+#define ALTITUDE_FRACTION_BITS 8
+// the velocity gained per acc count and us, with 24 more fractional bits
+#define ALTITUDE_ACC_SCALE_BITS 24
+// 2^32 / 1e6, multiplying a time in us by this and shifting down 32 bits gives seconds
+#define ALTITUDE_US_TO_SECONDS_Q32 4295
+#define ALTITUDE_GAIN_BITS 16
+#define ALTITUDE_SONAR_PERIOD_US (1000 * 70)
 
 #define DEGREES_80_IN_DECIDEGREES 800
 
@@ -168,7 +180,7 @@ bool isThrustFacingDownwards(attitudeEulerAngles_t *attitude)
     return ABS(attitude->values.roll) < DEGREES_80_IN_DECIDEGREES && ABS(attitude->values.pitch) < DEGREES_80_IN_DECIDEGREES;
 }
 
-int32_t calculateAltHoldThrottleAdjustment(int32_t vel_tmp, float accZ_tmp, float accZ_old)
+int32_t calculateAltHoldThrottleAdjustment(int32_t vel_tmp, int32_t accZ_tmp, int32_t accZ_old)
 {
     int32_t result = 0;
     int32_t error;
@@ -193,8 +205,8 @@ int32_t calculateAltHoldThrottleAdjustment(int32_t vel_tmp, float accZ_tmp, floa
     error = setVel - vel_tmp;
     result = constrain((pidProfile->P8[PIDVEL] * error / 32), -300, +300);
 
-    // I
-    errorVelocityI += (pidProfile->I8[PIDVEL] * error);
+    // I, scaled so it winds up as fast as it did at the reference rate
+    errorVelocityI += (pidProfile->I8[PIDVEL] * error * ALTITUDE_CF_REFERENCE_HZ / ALTITUDE_UPDATE_HZ);
     errorVelocityI = constrain(errorVelocityI, -(8192 * 200), (8192 * 200));
     result += errorVelocityI / 8192;     // I in range +/-200
 
@@ -204,85 +216,200 @@ int32_t calculateAltHoldThrottleAdjustment(int32_t vel_tmp, float accZ_tmp, floa
     return result;
 }
 
-void calculateEstimatedAltitude(timeUs_t currentTimeUs)
+typedef struct altitudeSource_s {
+    int32_t lastAltitude;               // cm
+    bool hasLastAltitude;
+    uint32_t sampleCount;
+    int32_t rate;                       // measurements per second, ALTITUDE_GAIN_BITS fractional bits
+    int32_t altitudeGain;               // per measurement, ALTITUDE_GAIN_BITS fractional bits
+    int32_t velocityGain;
+} altitudeSource_t;
+
+typedef struct altitudeEstimator_s {
+    int64_t altitude;                   // cm, ALTITUDE_FRACTION_BITS fractional bits
+    int32_t velocity;                   // cm/s, ALTITUDE_FRACTION_BITS fractional bits
+    int32_t accVelocityScale;           // cm/s per acc count and us, ALTITUDE_FRACTION_BITS + ALTITUDE_ACC_SCALE_BITS fractional bits
+    bool initialised;
+#ifdef BARO
+    altitudeSource_t baro;
+#endif
+#ifdef SONAR
+    altitudeSource_t sonar;
+    int32_t baroOffset;                 // cm, baro altitude above the sonar altitude
+    int32_t sonarAltitude;
+#endif
+} altitudeEstimator_t;
+
+static altitudeEstimator_t estimator;
+
+/*
+ * The complementary filters used to be applied once per 25ms, a measurement arriving every periodUs is
+ * given the gain that pulls the estimate as far in the same time.
+ */
+static void altitudeSourceInit(altitudeSource_t *source, uint32_t periodUs)
 {
-    static timeUs_t previousTimeUs;
-    uint32_t dTime;
-    int32_t baroVel;
-    float dt;
-    float vel_acc;
-    int32_t vel_tmp;
-    float accZ_tmp;
-    static float accZ_old = 0.0f;
-    static float vel = 0.0f;
-    static float accAlt = 0.0f;
-    static int32_t lastBaroAlt;
+    const float periods = (float)periodUs / ALTITUDE_CF_REFERENCE_PERIOD_US;
 
+    source->altitudeGain = lrintf((1.0f - powf(barometerConfig->baro_cf_alt, periods)) * (1 << ALTITUDE_GAIN_BITS));
+    source->velocityGain = lrintf((1.0f - powf(barometerConfig->baro_cf_vel, periods)) * (1 << ALTITUDE_GAIN_BITS));
+    source->rate = lrintf(1e6f / periodUs * (1 << ALTITUDE_GAIN_BITS));
+    source->hasLastAltitude = false;
+}
+
+static void altitudeEstimatorInit(void)
+{
+    estimator.altitude = 0;
+    estimator.velocity = 0;
+    estimator.accVelocityScale = lrintf(accVelScale * (float)(1 << ALTITUDE_FRACTION_BITS) * (float)(1 << ALTITUDE_ACC_SCALE_BITS));
+#ifdef BARO
+    // no readings ever arrive without a baro, its delays are left at 0
+    altitudeSourceInit(&estimator.baro, MAX(baro.dev.ut_delay + baro.dev.up_delay, 1));
+    estimator.baro.sampleCount = baroGetSampleCount();
+#endif
 #ifdef SONAR
-    int32_t sonarAlt = SONAR_OUT_OF_RANGE;
-    static int32_t baroAlt_offset = 0;
-    float sonarTransition;
+    altitudeSourceInit(&estimator.sonar, ALTITUDE_SONAR_PERIOD_US);
+    estimator.sonar.sampleCount = sonarGetSampleCount();
+    estimator.sonarAltitude = SONAR_OUT_OF_RANGE;
+    estimator.baroOffset = 0;
 #endif
+    estimator.initialised = true;
+}
 
-    dTime = currentTimeUs - previousTimeUs;
-    if (dTime < BARO_UPDATE_FREQUENCY_40HZ)
-        return;
+// integrates the acceleration accumulated by the IMU since the last step, returns the average acceleration in acc counts
+static int32_t altitudePredict(void)
+{
+    if (!accSumCount) {
+        return 0;
+    }
 
-    previousTimeUs = currentTimeUs;
+    const int32_t accZ = accSum[2] / accSumCount;
+    const int32_t velocityChange = ((int64_t)accZ * accTimeSum * estimator.accVelocityScale) >> ALTITUDE_ACC_SCALE_BITS;
 
-#ifdef BARO
-    if (!isBaroCalibrationComplete()) {
-        performBaroCalibrationCycle();
-        vel = 0;
-        accAlt = 0;
+    // x = v * t + a/2 * t^2
+    estimator.altitude += ((int64_t)(estimator.velocity + velocityChange / 2) * accTimeSum * ALTITUDE_US_TO_SECONDS_Q32) >> 32;
+    estimator.velocity += velocityChange;
+
+    imuResetAccelerationSum();
+
+    return accZ;
+}
+
+// corrects the estimate with a measurement arriving samples periods of the source after the last one
+static void altitudeCorrect(altitudeSource_t *source, int32_t measuredAltitude, uint32_t samples)
+{
+    const int64_t altitudeError = ((int64_t)measuredAltitude << ALTITUDE_FRACTION_BITS) - estimator.altitude;
+    estimator.altitude += (altitudeError * source->altitudeGain) >> ALTITUDE_GAIN_BITS;
+
+    if (source->hasLastAltitude) {
+        int32_t measuredVelocity = (((int64_t)(measuredAltitude - source->lastAltitude) * source->rate) >> ALTITUDE_GAIN_BITS) / (int32_t)samples;
+        measuredVelocity = constrain(measuredVelocity, -1500, 1500);    // constrain baro velocity +/- 1500cm/s
+        measuredVelocity = applyDeadband(measuredVelocity, 10);         // to reduce noise near zero
+
+        // keep the integrated velocity close to the measured one, correcting the drift of the accelerometer without any delay
+        const int32_t velocityError = (measuredVelocity << ALTITUDE_FRACTION_BITS) - estimator.velocity;
+        estimator.velocity += ((int64_t)velocityError * source->velocityGain) >> ALTITUDE_GAIN_BITS;
     }
 
-    baro.BaroAlt = baroCalculateAltitude();
-#else
-    baro.BaroAlt = 0;
-#endif
+    source->lastAltitude = measuredAltitude;
+    source->hasLastAltitude = true;
+}
 
 #ifdef SONAR
-    sonarAlt = sonarRead();
-    sonarAlt = sonarCalculateAltitude(sonarAlt, getCosTiltAngle());
+// blends the baro into the sonar as the sonar nears the end of its range
+static int32_t altitudeSonarBlend(int32_t baroAltitude)
+{
+    const int32_t sonarAlt = estimator.sonarAltitude;
 
-    if (sonarAlt > 0 && sonarAlt < sonarCfAltCm) {
-        // just use the SONAR
-        baroAlt_offset = baro.BaroAlt - sonarAlt;
-        baro.BaroAlt = sonarAlt;
-    } else {
-        baro.BaroAlt -= baroAlt_offset;
-        if (sonarAlt > 0  && sonarAlt <= sonarMaxAltWithTiltCm) {
-            // SONAR in range, so use complementary filter
-            sonarTransition = (float)(sonarMaxAltWithTiltCm - sonarAlt) / (sonarMaxAltWithTiltCm - sonarCfAltCm);
-            baro.BaroAlt = sonarAlt * sonarTransition + baro.BaroAlt * (1.0f - sonarTransition);
+    return (sonarAlt * (sonarMaxAltWithTiltCm - sonarAlt) + (baroAltitude - estimator.baroOffset) * (sonarAlt - sonarCfAltCm))
+        / (sonarMaxAltWithTiltCm - sonarCfAltCm);
+}
+
+static bool altitudeSonarInRange(void)
+{
+    return estimator.sonarAltitude > 0 && estimator.sonarAltitude <= sonarMaxAltWithTiltCm;
+}
+
+static bool altitudeSonarOnly(void)
+{
+    return estimator.sonarAltitude > 0 && estimator.sonarAltitude < sonarCfAltCm;
+}
+#endif
+
+/*
+ * Runs the predictive step from the accumulated acceleration every call, and corrects the estimate with the
+ * baro and sonar as their measurements arrive, with gains precomputed for the rate each arrives at.
+ */
+void calculateEstimatedAltitude(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    static int32_t accZ_old = 0;
+
+    if (!estimator.initialised) {
+        altitudeEstimatorInit();
+    }
+
+    const int32_t accZ_tmp = altitudePredict();
+
+#ifdef BARO
+    const uint32_t baroSamples = baroGetSampleCount() - estimator.baro.sampleCount;
+    if (baroSamples) {
+        estimator.baro.sampleCount += baroSamples;
+
+        if (!isBaroCalibrationComplete()) {
+            performBaroCalibrationCycle();
+            estimator.altitude = 0;
+            estimator.velocity = 0;
+        }
+
+        baro.BaroAlt = baroCalculateAltitude();
+
+#ifdef SONAR
+        if (altitudeSonarOnly()) {
+            // the sonar has the best range, the baro is only tracked to fade in smoothly above it
+            estimator.baroOffset = baro.BaroAlt - estimator.sonarAltitude;
+            estimator.baro.hasLastAltitude = false;
+        } else if (altitudeSonarInRange()) {
+            altitudeCorrect(&estimator.baro, altitudeSonarBlend(baro.BaroAlt), baroSamples);
+        } else {
+            altitudeCorrect(&estimator.baro, baro.BaroAlt - estimator.baroOffset, baroSamples);
         }
+#else
+        altitudeCorrect(&estimator.baro, baro.BaroAlt, baroSamples);
+#endif
     }
 #endif
 
-    dt = accTimeSum * 1e-6f; // delta acc reading time in seconds
+#ifdef SONAR
+    const uint32_t sonarSamples = sonarGetSampleCount() - estimator.sonar.sampleCount;
+    if (sonarSamples) {
+        estimator.sonar.sampleCount += sonarSamples;
 
-    // Integrator - velocity, cm/sec
-    if (accSumCount) {
-        accZ_tmp = (float)accSum[2] / (float)accSumCount;
-    } else {
-        accZ_tmp = 0;
-    }
-    vel_acc = accZ_tmp * accVelScale * (float)accTimeSum;
+        estimator.sonarAltitude = sonarCalculateAltitude(sonarRead(), getCosTiltAngle());
 
-    // Integrator - Altitude in cm
-    accAlt += (vel_acc * 0.5f) * dt + vel * dt;                                                                 // integrate velocity to get distance (x= a/2 * t^2)
-    accAlt = accAlt * barometerConfig->baro_cf_alt + (float)baro.BaroAlt * (1.0f - barometerConfig->baro_cf_alt);    // complementary filter for altitude estimation (baro & acc)
-    vel += vel_acc;
+        if (altitudeSonarOnly()) {
+#ifdef BARO
+            estimator.baroOffset = baro.BaroAlt - estimator.sonarAltitude;
+#endif
+            altitudeCorrect(&estimator.sonar, estimator.sonarAltitude, sonarSamples);
+        } else if (altitudeSonarInRange()) {
+#ifdef BARO
+            altitudeCorrect(&estimator.sonar, altitudeSonarBlend(baro.BaroAlt), sonarSamples);
+#else
+            altitudeCorrect(&estimator.sonar, altitudeSonarBlend(0), sonarSamples);
+#endif
+        } else {
+            estimator.sonar.hasLastAltitude = false;
+        }
+    }
+#endif
 
 #ifdef DEBUG_ALT_HOLD
-    debug[1] = accSum[2] / accSumCount; // acceleration
-    debug[2] = vel;                     // velocity
-    debug[3] = accAlt;                  // height
+    debug[1] = accZ_tmp;                                                // acceleration
+    debug[2] = estimator.velocity >> ALTITUDE_FRACTION_BITS;            // velocity
+    debug[3] = estimator.altitude >> ALTITUDE_FRACTION_BITS;            // height
 #endif
 
-    imuResetAccelerationSum();
-
 #ifdef BARO
     if (!isBaroCalibrationComplete()) {
         return;
@@ -290,26 +417,17 @@ void calculateEstimatedAltitude(timeUs_t currentTimeUs)
 #endif
 
 #ifdef SONAR
-    if (sonarAlt > 0 && sonarAlt < sonarCfAltCm) {
+    if (altitudeSonarOnly()) {
         // the sonar has the best range
-        EstAlt = baro.BaroAlt;
+        EstAlt = estimator.sonarAltitude;
     } else {
-        EstAlt = accAlt;
+        EstAlt = estimator.altitude >> ALTITUDE_FRACTION_BITS;
     }
 #else
-    EstAlt = accAlt;
+    EstAlt = estimator.altitude >> ALTITUDE_FRACTION_BITS;
 #endif
 
-    baroVel = (baro.BaroAlt - lastBaroAlt) * 1000000.0f / dTime;
-    lastBaroAlt = baro.BaroAlt;
-
-    baroVel = constrain(baroVel, -1500, 1500);  // constrain baro velocity +/- 1500cm/s
-    baroVel = applyDeadband(baroVel, 10);       // to reduce noise near zero
-
-    // apply Complimentary Filter to keep the calculated velocity based on baro velocity (i.e. near real velocity).
-    // By using CF it's possible to correct the drift of integrated accZ (velocity) without loosing the phase, i.e without delay
-    vel = vel * barometerConfig->baro_cf_vel + baroVel * (1.0f - barometerConfig->baro_cf_vel);
-    vel_tmp = lrintf(vel);
+    const int32_t vel_tmp = estimator.velocity >> ALTITUDE_FRACTION_BITS;
 
     // set vario
     vario = applyDeadband(vel_tmp, 5);
@@ -17,6 +17,9 @@
 
 #pragma once
 
+// the rate of the predictive step of the altitude estimator, the baro and sonar correct it as their readings arrive
+#define ALTITUDE_UPDATE_HZ 100
+
 extern int32_t AltHold;
 extern int32_t vario;
 
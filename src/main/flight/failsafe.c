@@ -22,6 +22,8 @@
 
 #include "build/debug.h"
 
+#include "blackbox/blackbox_capture.h"
+
 #include "common/axis.h"
 
 #include "drivers/system.h"
@@ -148,10 +150,16 @@ void failsafeOnRxResume(void)
     failsafeState.rxLinkState = FAILSAFE_RXLINK_UP;                     // do so while rx link is up
 }
 
+// the fixed periods are scaled to the frame rate of the receiver once it is known
+static uint32_t failsafeRxDataPeriod(uint32_t fixedPeriod)
+{
+    return rxLossFramesToUs(fixedPeriod * 1000) / 1000;
+}
+
 void failsafeOnValidDataReceived(void)
 {
     failsafeState.validRxDataReceivedAt = millis();
-    if ((failsafeState.validRxDataReceivedAt - failsafeState.validRxDataFailedAt) > PERIOD_RXDATA_RECOVERY) {
+    if ((failsafeState.validRxDataReceivedAt - failsafeState.validRxDataFailedAt) > failsafeRxDataPeriod(PERIOD_RXDATA_RECOVERY)) {
         failsafeState.rxLinkState = FAILSAFE_RXLINK_UP;
     }
 }
@@ -159,6 +167,7 @@ void failsafeOnValidDataReceived(void)
 void failsafeOnValidDataFailed(void)
 {
     failsafeState.validRxDataFailedAt = millis();
+    failsafeState.rxDataFailurePeriod = failsafeRxDataPeriod(PERIOD_RXDATA_FAILURE) + failsafeConfig->failsafe_delay * MILLIS_PER_TENTH_SECOND;
     if ((failsafeState.validRxDataFailedAt - failsafeState.validRxDataReceivedAt) > failsafeState.rxDataFailurePeriod) {
         failsafeState.rxLinkState = FAILSAFE_RXLINK_DOWN;
     }
@@ -262,6 +271,11 @@ void failsafeUpdateState(void)
 
             case FAILSAFE_LANDED:
                 ENABLE_ARMING_FLAG(PREVENT_ARMING); // To prevent accidently rearming by an intermittent rx link
+#ifdef USE_BLACKBOX_CAPTURE
+                if (armed) {
+                    blackboxCaptureTrigger(BLACKBOX_CAPTURE_TRIGGER_FAILSAFE);
+                }
+#endif
                 mwDisarm();
                 failsafeState.receivingRxDataPeriod = millis() + failsafeState.receivingRxDataPeriodPreset; // set required period of valid rxData
                 failsafeState.phase = FAILSAFE_RX_LOSS_MONITORING;
@@ -21,15 +21,18 @@
 #include <stdint.h>
 #include <math.h>
 
-#include "common/maths.h"
-
 #include "platform.h"
 
+#include "common/maths.h"
+
+#include "build/atomic.h"
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/profile.h"
 
 #include "common/axis.h"
 
+#include "drivers/nvic.h"
 #include "drivers/system.h"
 
 #include "sensors/sensors.h"
@@ -198,11 +201,48 @@ void imuCalculateAcceleration(uint32_t deltaT)
     accSumCount++;
 }
 
-static float invSqrt(float x)
+// a single vsqrt and reciprocal with -ffast-math on the FPU targets
+static inline float invSqrt(float x)
 {
     return 1.0f / sqrtf(x);
 }
 
+// rotates the quaternion by the body rates (rad/s) over dt, first order, without normalising
+static void imuIntegrateQuaternion(float gx, float gy, float gz, float dt)
+{
+    gx *= (0.5f * dt);
+    gy *= (0.5f * dt);
+    gz *= (0.5f * dt);
+
+    const float qa = q0;
+    const float qb = q1;
+    const float qc = q2;
+    q0 += (-qb * gx - qc * gy - q3 * gz);
+    q1 += (qa * gx + qc * gz - q3 * gy);
+    q2 += (qa * gy - qb * gz + q3 * gx);
+    q3 += (qa * gz + qb * gy - qc * gx);
+}
+
+/*
+ * Propagates the attitude with the gyro at PID rate, so fast manoeuvres are integrated sample by sample
+ * instead of with one rate over the whole attitude period. The accelerometer and magnetometer correction,
+ * the normalisation and the rotation matrix stay in the attitude task.
+ */
+void imuUpdateGyroAttitude(timeUs_t currentTimeUs)
+{
+    static timeUs_t previousGyroAttitudeTimeUs;
+
+    // the measured time since the last PID update, so late or skipped updates don't leave attitude behind
+    const timeDelta_t deltaT = cmpTimeUs(currentTimeUs, previousGyroAttitudeTimeUs);
+    const bool firstUpdate = previousGyroAttitudeTimeUs == 0;
+    previousGyroAttitudeTimeUs = currentTimeUs;
+
+    if (sensors(SENSOR_ACC) && !firstUpdate && deltaT > 0) {
+        imuIntegrateQuaternion(DEGREES_TO_RADIANS(gyro.gyroADCf[X]), DEGREES_TO_RADIANS(gyro.gyroADCf[Y]), DEGREES_TO_RADIANS(gyro.gyroADCf[Z]),
+                               deltaT * 1e-6f);
+    }
+}
+
 static bool imuUseFastGains(void)
 {
     return !ARMING_FLAG(ARMED) && millis() < 20000;
@@ -227,17 +267,16 @@ static void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
     float recipNorm;
     float hx, hy, bx;
     float ex = 0, ey = 0, ez = 0;
-    float qa, qb, qc;
 
-    // Calculate general spin rate (rad/s)
-    float spin_rate = sqrtf(sq(gx) + sq(gy) + sq(gz));
+    // Calculate general spin rate (rad/s), squared to save the square root
+    const float spinRateSq = sq(gx) + sq(gy) + sq(gz);
 
     // Use raw heading error (from GPS or whatever else)
     if (useYaw) {
         while (yawError >  M_PIf) yawError -= (2.0f * M_PIf);
         while (yawError < -M_PIf) yawError += (2.0f * M_PIf);
 
-        ez += sin_approx(yawError / 2.0f);
+        ez += sin_lut(yawError / 2.0f);
     }
 
     // Use measured magnetic field vector
@@ -285,7 +324,7 @@ static void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
     // Compute and apply integral feedback if enabled
     if(imuRuntimeConfig.dcm_ki > 0.0f) {
         // Stop integrating if spinning beyond the certain limit
-        if (spin_rate < DEGREES_TO_RADIANS(SPIN_RATE_LIMIT)) {
+        if (spinRateSq < sq(DEGREES_TO_RADIANS(SPIN_RATE_LIMIT))) {
             float dcmKiGain = imuRuntimeConfig.dcm_ki;
             integralFBx += dcmKiGain * ex * dt;    // integral error scaled by Ki
             integralFBy += dcmKiGain * ey * dt;
@@ -301,30 +340,18 @@ static void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
     // Calculate kP gain. If we are acquiring initial attitude (not armed and within 20 sec from powerup) scale the kP to converge faster
     float dcmKpGain = imuRuntimeConfig.dcm_kp * imuGetPGainScaleFactor();
 
-    // Apply proportional and integral feedback
-    gx += dcmKpGain * ex + integralFBx;
-    gy += dcmKpGain * ey + integralFBy;
-    gz += dcmKpGain * ez + integralFBz;
-
-    // Integrate rate of change of quaternion
-    gx *= (0.5f * dt);
-    gy *= (0.5f * dt);
-    gz *= (0.5f * dt);
-
-    qa = q0;
-    qb = q1;
-    qc = q2;
-    q0 += (-qb * gx - qc * gy - q3 * gz);
-    q1 += (qa * gx + qc * gz - q3 * gy);
-    q2 += (qa * gy - qb * gz + q3 * gx);
-    q3 += (qa * gz + qb * gy - qc * gx);
-
-    // Normalise quaternion
-    recipNorm = invSqrt(sq(q0) + sq(q1) + sq(q2) + sq(q3));
-    q0 *= recipNorm;
-    q1 *= recipNorm;
-    q2 *= recipNorm;
-    q3 *= recipNorm;
+    // Apply proportional and integral feedback, the gyro itself has been integrated at PID rate
+    // the PID loop can run from an interrupt, keep it from integrating into a half updated quaternion
+    ATOMIC_BLOCK(NVIC_PRIO_PID_LOOP) {
+        imuIntegrateQuaternion(dcmKpGain * ex + integralFBx, dcmKpGain * ey + integralFBy, dcmKpGain * ez + integralFBz, dt);
+
+        // Normalise quaternion
+        recipNorm = invSqrt(sq(q0) + sq(q1) + sq(q2) + sq(q3));
+        q0 *= recipNorm;
+        q1 *= recipNorm;
+        q2 *= recipNorm;
+        q3 *= recipNorm;
+    }
 
     // Pre-compute rotation matrix from quaternion
     imuComputeRotationMatrix();
@@ -333,9 +360,9 @@ static void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
 STATIC_UNIT_TESTED void imuUpdateEulerAngles(void)
 {
     /* Compute pitch/roll angles */
-    attitude.values.roll = lrintf(atan2f(rMat[2][1], rMat[2][2]) * (1800.0f / M_PIf));
-    attitude.values.pitch = lrintf(((0.5f * M_PIf) - acosf(-rMat[2][0])) * (1800.0f / M_PIf));
-    attitude.values.yaw = lrintf((-atan2f(rMat[1][0], rMat[0][0]) * (1800.0f / M_PIf) + magneticDeclination));
+    attitude.values.roll = lrintf(atan2_lut(rMat[2][1], rMat[2][2]) * (1800.0f / M_PIf));
+    attitude.values.pitch = lrintf(((0.5f * M_PIf) - acos_approx(-rMat[2][0])) * (1800.0f / M_PIf));
+    attitude.values.yaw = lrintf((-atan2_lut(rMat[1][0], rMat[0][0]) * (1800.0f / M_PIf) + magneticDeclination));
 
     if (attitude.values.yaw < 0)
         attitude.values.yaw += 3600;
@@ -408,7 +435,9 @@ static void imuCalculateEstimatedAttitude(timeUs_t currentTimeUs)
 void imuUpdateAttitude(timeUs_t currentTimeUs)
 {
     if (sensors(SENSOR_ACC) && acc.isAccelUpdatedAtLeastOnce) {
+        PROFILE_BEGIN(PROFILE_ATTITUDE);
         imuCalculateEstimatedAttitude(currentTimeUs);
+        PROFILE_END(PROFILE_ATTITUDE);
     } else {
         acc.accSmooth[X] = 0;
         acc.accSmooth[Y] = 0;
@@ -431,8 +460,8 @@ int16_t calculateThrottleAngleCorrection(uint8_t throttle_correction_value)
     if (rMat[2][2] <= 0.015f) {
         return 0;
     }
-    int angle = lrintf(acosf(rMat[2][2]) * throttleAngleScale);
+    int angle = lrintf(acos_approx(rMat[2][2]) * throttleAngleScale);
     if (angle > 900)
         angle = 900;
-    return lrintf(throttle_correction_value * sin_approx(angle / (900.0f * M_PIf / 2.0f)));
+    return lrintf(throttle_correction_value * sin_lut(angle / (900.0f * M_PIf / 2.0f)));
 }
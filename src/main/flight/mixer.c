@@ -69,6 +69,19 @@ rxConfig_t *rxConfig;
 mixerMode_e currentMixerMode;
 static motorMixer_t currentMixer[MAX_SUPPORTED_MOTORS];
 
+// currentMixer laid out by axis for the mixing kernels, set by mixerConfigureOutput()
+typedef struct mixerMatrix_s {
+    float roll[MAX_SUPPORTED_MOTORS];
+    float pitch[MAX_SUPPORTED_MOTORS];
+    float yaw[MAX_SUPPORTED_MOTORS];
+    float throttle[MAX_SUPPORTED_MOTORS];
+} mixerMatrix_t;
+
+static FAST_RAM_ZERO_INIT mixerMatrix_t mixerMatrix;
+
+typedef float (*mixerKernelFnPtr)(float *motorMix, float roll, float pitch, float yaw);
+static mixerKernelFnPtr mixerKernel;
+
 
 static const motorMixer_t mixerQuadX[] = {
     { 1.0f, -1.0f,  1.0f, -1.0f },          // REAR_R
@@ -236,6 +249,13 @@ const mixer_t mixers[] = {
 
 static motorMixer_t *customMixers;
 
+#define THRUST_CURVE_SHIFT      10                          // thrust and command as fractions of 1 << 10
+#define THRUST_CURVE_STEP_SHIFT 6                           // 64 wide interpolation segments
+#define THRUST_CURVE_POINTS     ((1 << (THRUST_CURVE_SHIFT - THRUST_CURVE_STEP_SHIFT)) + 1)
+
+static int16_t thrustCurve[THRUST_CURVE_POINTS];
+static bool thrustCurveEnabled;
+
 static uint16_t disarmMotorOutput, deadbandMotor3dHigh, deadbandMotor3dLow;
 uint16_t motorOutputHigh, motorOutputLow;
 static float rcCommandThrottleRange, rcCommandThrottleRange3dLow, rcCommandThrottleRange3dHigh;
@@ -295,6 +315,117 @@ void mixerUseConfigs(
     rxConfig = rxConfigToUse;
 }
 
+/*
+ * Mixes the axis demands into motorMix, scaled down to a range of at most 1, and returns the
+ * range before scaling. Inlined with a constant motor count the loops unroll and min, max and
+ * the scale become conditional selects, so a mix costs the same every time.
+ */
+static inline __attribute__((always_inline)) float mixerApplyMatrix(const int count, float *motorMix, float roll, float pitch, float yaw)
+{
+    float motorMixMax = 0, motorMixMin = 0;
+    for (int i = 0; i < count; i++) {
+        const float mix = roll * mixerMatrix.roll[i] + pitch * mixerMatrix.pitch[i] + yaw * mixerMatrix.yaw[i];
+        motorMix[i] = mix;
+        motorMixMax = MAX(motorMixMax, mix);
+        motorMixMin = MIN(motorMixMin, mix);
+    }
+
+    const float motorMixRange = motorMixMax - motorMixMin;
+    const float scale = 1.0f / MAX(motorMixRange, 1.0f);
+    for (int i = 0; i < count; i++) {
+        motorMix[i] *= scale;
+    }
+    return motorMixRange;
+}
+
+// quad, hex and octo layouts
+static FAST_CODE_ITCM float mixerKernel4(float *motorMix, float roll, float pitch, float yaw)
+{
+    return mixerApplyMatrix(4, motorMix, roll, pitch, yaw);
+}
+
+#ifndef USE_QUAD_MIXER_ONLY
+static FAST_CODE_ITCM float mixerKernel6(float *motorMix, float roll, float pitch, float yaw)
+{
+    return mixerApplyMatrix(6, motorMix, roll, pitch, yaw);
+}
+
+static FAST_CODE_ITCM float mixerKernel8(float *motorMix, float roll, float pitch, float yaw)
+{
+    return mixerApplyMatrix(8, motorMix, roll, pitch, yaw);
+}
+
+static FAST_CODE_ITCM float mixerKernelAny(float *motorMix, float roll, float pitch, float yaw)
+{
+    return mixerApplyMatrix(motorCount, motorMix, roll, pitch, yaw);
+}
+#endif
+
+static void mixerResolveMatrix(void)
+{
+    for (int i = 0; i < MAX_SUPPORTED_MOTORS; i++) {
+        const bool used = i < motorCount;
+        mixerMatrix.roll[i] = used ? currentMixer[i].roll : 0.0f;
+        mixerMatrix.pitch[i] = used ? currentMixer[i].pitch : 0.0f;
+        mixerMatrix.yaw[i] = used ? currentMixer[i].yaw : 0.0f;
+        mixerMatrix.throttle[i] = used ? currentMixer[i].throttle : 0.0f;
+    }
+
+#ifdef USE_QUAD_MIXER_ONLY
+    mixerKernel = mixerKernel4;
+#else
+    switch (motorCount) {
+    case 4:
+        mixerKernel = mixerKernel4;
+        break;
+    case 6:
+        mixerKernel = mixerKernel6;
+        break;
+    case 8:
+        mixerKernel = mixerKernel8;
+        break;
+    default:
+        mixerKernel = mixerKernelAny;
+        break;
+    }
+#endif
+}
+
+/*
+ * Props make thrust grow roughly with the square of the command, modelled here as
+ * thrust = (1 - k) * command + k * command^2. The inverse is sampled into a table once so the
+ * mixer only pays for an integer interpolation per motor.
+ */
+static void mixerGenerateThrustCurve(void)
+{
+    const float k = motorConfig->thrustLinearization / 100.0f;
+    thrustCurveEnabled = motorConfig->thrustLinearization != 0;
+
+    for (int i = 0; i < THRUST_CURVE_POINTS; i++) {
+        const float thrust = (float)(i << THRUST_CURVE_STEP_SHIFT) / (1 << THRUST_CURVE_SHIFT);
+        float command = thrust;
+        if (thrustCurveEnabled) {
+            const float b = (1.0f - k) / (2.0f * k);
+            command = sqrtf(thrust / k + b * b) - b;
+        }
+        thrustCurve[i] = lrintf(command * (1 << THRUST_CURVE_SHIFT));
+    }
+}
+
+// Thrust outside 0..1 is left alone, the output limits below deal with it as before
+static float mixerLinearizeThrust(float thrust)
+{
+    const int32_t tmp = lrintf(thrust * (1 << THRUST_CURVE_SHIFT));
+    if (tmp <= 0 || tmp >= (1 << THRUST_CURVE_SHIFT)) {
+        return thrust;
+    }
+
+    const int32_t index = tmp >> THRUST_CURVE_STEP_SHIFT;
+    const int32_t fraction = tmp & ((1 << THRUST_CURVE_STEP_SHIFT) - 1);
+    const int32_t command = thrustCurve[index] + ((fraction * (thrustCurve[index + 1] - thrustCurve[index])) >> THRUST_CURVE_STEP_SHIFT);
+    return command * (1.0f / (1 << THRUST_CURVE_SHIFT));
+}
+
 void mixerInit(mixerMode_e mixerMode, motorMixer_t *initialCustomMixers)
 {
     currentMixerMode = mixerMode;
@@ -342,6 +473,8 @@ void mixerConfigureOutput(void)
         }
     }
 
+    mixerResolveMatrix();
+    mixerGenerateThrustCurve();
     mixerResetDisarmedMotors();
 }
 
@@ -370,6 +503,8 @@ void mixerConfigureOutput(void)
         currentMixer[i] = mixerQuadX[i];
     }
 
+    mixerResolveMatrix();
+    mixerGenerateThrustCurve();
     mixerResetDisarmedMotors();
 }
 #endif
@@ -416,7 +551,7 @@ void stopPwmAllMotors(void)
     delayMicroseconds(1500);
 }
 
-void mixTable(pidProfile_t *pidProfile)
+FAST_CODE_ITCM void mixTable(pidProfile_t *pidProfile)
 {
     // Scale roll/pitch/yaw uniformly to fit within throttle range
     // Initial mixer concept by bdoiron74 reused and optimized for Air Mode
@@ -473,32 +608,15 @@ void mixTable(pidProfile_t *pidProfile)
     // Calculate voltage compensation
     const float vbatCompensationFactor = (batteryConfig && pidProfile->vbatPidCompensation)  ? calculateVbatPidCompensation() : 1.0f;
 
-    // Find roll/pitch/yaw desired output
+    // Find roll/pitch/yaw desired output, voltage compensation only ever raises it
+    const float axisGain = MAX(vbatCompensationFactor, 1.0f);
     float motorMix[MAX_SUPPORTED_MOTORS];
-    float motorMixMax = 0, motorMixMin = 0;
-    for (int i = 0; i < motorCount; i++) {
-        motorMix[i] =
-            scaledAxisPIDf[PITCH] * currentMixer[i].pitch +
-            scaledAxisPIDf[ROLL]  * currentMixer[i].roll +
-            scaledAxisPIDf[YAW]   * currentMixer[i].yaw * (-mixerConfig->yaw_motor_direction);
-
-        if (vbatCompensationFactor > 1.0f) {
-            motorMix[i] *= vbatCompensationFactor;  // Add voltage compensation
-        }
-
-        if (motorMix[i] > motorMixMax) {
-            motorMixMax = motorMix[i];
-        } else if (motorMix[i] < motorMixMin) {
-            motorMixMin = motorMix[i];
-        }
-    }
-
-    const float motorMixRange = motorMixMax - motorMixMin;
+    const float motorMixRange = mixerKernel(motorMix,
+        scaledAxisPIDf[ROLL] * axisGain,
+        scaledAxisPIDf[PITCH] * axisGain,
+        scaledAxisPIDf[YAW] * axisGain * (-mixerConfig->yaw_motor_direction));
 
     if (motorMixRange > 1.0f) {
-        for (int i = 0; i < motorCount; i++) {
-            motorMix[i] /= motorMixRange;
-        }
         // Get the maximum correction by setting offset to center
         throttle = 0.5f;
     } else {
@@ -510,7 +628,11 @@ void mixTable(pidProfile_t *pidProfile)
     // roll/pitch/yaw. This could move throttle down, but also up for those low throttle flips.
     uint32_t i = 0;
     for (i = 0; i < motorCount; i++) {
-        motor[i] = motorOutputMin + lrintf(motorOutputRange * (motorMix[i] + (throttle * currentMixer[i].throttle)));
+        float thrust = motorMix[i] + (throttle * mixerMatrix.throttle[i]);
+        if (thrustCurveEnabled) {
+            thrust = mixerLinearizeThrust(thrust);
+        }
+        motor[i] = motorOutputMin + lrintf(motorOutputRange * thrust);
 
         // Dshot works exactly opposite in lower 3D section.
         if (mixerInversion) {
@@ -105,9 +105,8 @@ void navigationInit(gpsProfile_t *initialGpsProfile, pidProfile_t *pidProfile)
 #define GPS_LOW_SPEED_D_FILTER     1    // below .5m/s speed ignore D term for POSHOLD_RATE, theoretically this also removed D term induced noise
 
 static bool check_missed_wp(void);
-static void GPS_distance_cm_bearing(int32_t * lat1, int32_t * lon1, int32_t * lat2, int32_t * lon2, uint32_t * dist, int32_t * bearing);
-//static void GPS_distance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, uint16_t* dist, int16_t* bearing);
-static void GPS_calc_longitude_scaling(int32_t lat);
+static void GPS_distance_cm_bearing(int32_t dLat, int32_t dLon, uint32_t * dist, int32_t * bearing);
+static int32_t GPS_calc_longitude_scaling(int32_t lat);
 static void GPS_calc_velocity(void);
 static void GPS_calc_location_error(int32_t * target_lat, int32_t * target_lng, int32_t * gps_lat, int32_t * gps_lng);
 static void GPS_calc_poshold(void);
@@ -191,9 +190,19 @@ static void reset_PID(PID *pid)
 #define NAV_SLOW_NAV               true
 #define NAV_BANK_MAX               3000 // 30deg max banking when navigating (just for security and testing)
 
-static float dTnav;             // Delta Time in milliseconds for navigation computations, updated with every good GPS read
+#define GPS_LON_SCALE_SHIFT        15
+
+static float dTnav;             // Delta Time in seconds for navigation computations, updated with every good GPS read
+static uint32_t dTnavMs;        // the same in milliseconds, for the integer velocity
 static int16_t actual_speed[2] = { 0, 0 };
-static float GPS_scaleLonDown = 1.0f;  // this is used to offset the shrinking longitude as we go towards the poles
+// these are used to offset the shrinking longitude as we go towards the poles, cos(lat) in Q15
+static int32_t GPS_scaleLonDown = 1 << GPS_LON_SCALE_SHIFT;    // at the waypoint
+static int32_t GPS_scaleLonHome = 1 << GPS_LON_SCALE_SHIFT;    // at home
+
+static int32_t GPS_scale_lon(int32_t dLon, int32_t scale)
+{
+    return ((int64_t)dLon * scale) >> GPS_LON_SCALE_SHIFT;
+}
 
 // The difference between the desired rate of travel and the actual rate of travel
 // updated after GPS read - 5-10hz
@@ -251,7 +260,7 @@ void GPS_calculateDistanceAndDirectionToHome(void)
     if (STATE(GPS_FIX_HOME)) {      // If we don't have home set, do not display anything
         uint32_t dist;
         int32_t dir;
-        GPS_distance_cm_bearing(&GPS_coord[LAT], &GPS_coord[LON], &GPS_home[LAT], &GPS_home[LON], &dist, &dir);
+        GPS_distance_cm_bearing(GPS_home[LAT] - GPS_coord[LAT], GPS_scale_lon(GPS_home[LON] - GPS_coord[LON], GPS_scaleLonHome), &dist, &dir);
         GPS_distanceToHome = dist / 100;
         GPS_directionToHome = dir / 100;
     } else {
@@ -303,10 +312,11 @@ void onGpsNewData(void)
     // Calculate time delta for navigation loop, range 0-1.0f, in seconds
     //
     // Time for calculating x,y speed and navigation pids
-    dTnav = (float)(millis() - nav_loopTimer) / 1000.0f;
+    dTnavMs = millis() - nav_loopTimer;
     nav_loopTimer = millis();
     // prevent runup from bad GPS
-    dTnav = MIN(dTnav, 1.0f);
+    dTnavMs = MIN(dTnavMs, 1000);
+    dTnav = dTnavMs / 1000.0f;
 
     GPS_calculateDistanceAndDirectionToHome();
 
@@ -317,8 +327,8 @@ void onGpsNewData(void)
         // we are navigating
 
         // gps nav calculations, these are common for nav and poshold
-        GPS_distance_cm_bearing(&GPS_coord[LAT], &GPS_coord[LON], &GPS_WP[LAT], &GPS_WP[LON], &wp_distance, &target_bearing);
         GPS_calc_location_error(&GPS_WP[LAT], &GPS_WP[LON], &GPS_coord[LAT], &GPS_coord[LON]);
+        GPS_distance_cm_bearing(error[LAT], error[LON], &wp_distance, &target_bearing);
 
         switch (nav_mode) {
         case NAV_MODE_POSHOLD:
@@ -359,7 +369,8 @@ void GPS_reset_home_position(void)
     if (STATE(GPS_FIX) && GPS_numSat >= 5) {
         GPS_home[LAT] = GPS_coord[LAT];
         GPS_home[LON] = GPS_coord[LON];
-        GPS_calc_longitude_scaling(GPS_coord[LAT]); // need an initial value for distance and bearing calc
+        GPS_scaleLonHome = GPS_calc_longitude_scaling(GPS_coord[LAT]);
+        GPS_scaleLonDown = GPS_scaleLonHome;    // need an initial value for distance and bearing calc
         nav_takeoff_bearing = DECIDEGREES_TO_DEGREES(attitude.values.yaw);              // save takeoff heading
         // Set ground altitude
         ENABLE_STATE(GPS_FIX_HOME);
@@ -411,10 +422,10 @@ void gpsUsePIDs(pidProfile_t *pidProfile)
 // this is used to offset the shrinking longitude as we go towards the poles
 // It's ok to calculate this once per waypoint setting, since it changes a little within the reach of a multicopter
 //
-static void GPS_calc_longitude_scaling(int32_t lat)
+static int32_t GPS_calc_longitude_scaling(int32_t lat)
 {
     float rads = (ABS((float)lat) / 10000000.0f) * 0.0174532925f;
-    GPS_scaleLonDown = cos_approx(rads);
+    return lrintf(cos_approx(rads) * (1 << GPS_LON_SCALE_SHIFT));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -425,11 +436,11 @@ void GPS_set_next_wp(int32_t *lat, int32_t *lon)
     GPS_WP[LAT] = *lat;
     GPS_WP[LON] = *lon;
 
-    GPS_calc_longitude_scaling(*lat);
-    GPS_distance_cm_bearing(&GPS_coord[LAT], &GPS_coord[LON], &GPS_WP[LAT], &GPS_WP[LON], &wp_distance, &target_bearing);
+    GPS_scaleLonDown = GPS_calc_longitude_scaling(*lat);
+    GPS_calc_location_error(&GPS_WP[LAT], &GPS_WP[LON], &GPS_coord[LAT], &GPS_coord[LON]);
+    GPS_distance_cm_bearing(error[LAT], error[LON], &wp_distance, &target_bearing);
 
     nav_bearing = target_bearing;
-    GPS_calc_location_error(&GPS_WP[LAT], &GPS_WP[LON], &GPS_coord[LAT], &GPS_coord[LON]);
     original_target_bearing = target_bearing;
     waypoint_speed_gov = gpsProfile->nav_speed_min;
 }
@@ -445,34 +456,22 @@ static bool check_missed_wp(void)
     return (ABS(temp) > 10000); // we passed the waypoint by 100 degrees
 }
 
-#define DISTANCE_BETWEEN_TWO_LONGITUDE_POINTS_AT_EQUATOR_IN_HUNDREDS_OF_KILOMETERS 1.113195f
-#define TAN_89_99_DEGREES 5729.57795f
+// 1.113195 cm per 1/10 000 000 degree of latitude, in Q16
+#define DISTANCE_BETWEEN_TWO_LONGITUDE_POINTS_AT_EQUATOR_IN_HUNDREDS_OF_KILOMETERS_Q16 72954
 
 ////////////////////////////////////////////////////////////////////////////////////
-// Get distance between two points in cm
-// Get bearing from pos1 to pos2, returns an 1deg = 100 precision
-static void GPS_distance_cm_bearing(int32_t *currentLat1, int32_t *currentLon1, int32_t *destinationLat2, int32_t *destinationLon2, uint32_t *dist, int32_t *bearing)
+// Get distance in cm of a vector north (dLat) and east (dLon, already scaled for the longitude) of us
+// Get bearing of the vector, returns an 1deg = 100 precision
+static void GPS_distance_cm_bearing(int32_t dLat, int32_t dLon, uint32_t *dist, int32_t *bearing)
 {
-    float dLat = *destinationLat2 - *currentLat1; // difference of latitude in 1/10 000 000 degrees
-    float dLon = (float)(*destinationLon2 - *currentLon1) * GPS_scaleLonDown;
-    *dist = sqrtf(sq(dLat) + sq(dLon)) * DISTANCE_BETWEEN_TWO_LONGITUDE_POINTS_AT_EQUATOR_IN_HUNDREDS_OF_KILOMETERS;
+    const uint32_t len = sqrt_int64((int64_t)dLat * dLat + (int64_t)dLon * dLon);
+    *dist = ((uint64_t)len * DISTANCE_BETWEEN_TWO_LONGITUDE_POINTS_AT_EQUATOR_IN_HUNDREDS_OF_KILOMETERS_Q16) >> 16;
 
-    *bearing = 9000.0f + atan2_approx(-dLat, dLon) * TAN_89_99_DEGREES;      // Convert the output radians to 100xdeg
+    *bearing = atan2_approx_int(dLon, dLat);    // clockwise from north
     if (*bearing < 0)
         *bearing += 36000;
 }
 
-////////////////////////////////////////////////////////////////////////////////////
-// keep old calculation function for compatibility (could be removed later) distance in meters, bearing in degree
-//
-//static void GPS_distance(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, uint16_t* dist, int16_t* bearing) {
-//  uint32_t d1;
-//  int32_t  d2;
-//  GPS_distance_cm_bearing(&lat1,&lon1,&lat2,&lon2,&d1,&d2);
-//  *dist = d1 / 100;          //convert to meters
-//  *bearing = d2 /  100;      //convert to degrees
-//}
-
 ////////////////////////////////////////////////////////////////////////////////////
 // Calculate our current speed vector from gps position data
 //
@@ -484,10 +483,9 @@ static void GPS_calc_velocity(void)
     // y_GPS_speed positive = Up
     // x_GPS_speed positive = Right
 
-    if (init) {
-        float tmp = 1.0f / dTnav;
-        actual_speed[GPS_X] = (float)(GPS_coord[LON] - last_coord[LON]) * GPS_scaleLonDown * tmp;
-        actual_speed[GPS_Y] = (float)(GPS_coord[LAT] - last_coord[LAT]) * tmp;
+    if (init && dTnavMs) {
+        actual_speed[GPS_X] = GPS_scale_lon(GPS_coord[LON] - last_coord[LON], GPS_scaleLonDown) * 1000 / (int32_t)dTnavMs;
+        actual_speed[GPS_Y] = (GPS_coord[LAT] - last_coord[LAT]) * 1000 / (int32_t)dTnavMs;
 
         actual_speed[GPS_X] = (actual_speed[GPS_X] + speed_old[GPS_X]) / 2;
         actual_speed[GPS_Y] = (actual_speed[GPS_Y] + speed_old[GPS_Y]) / 2;
@@ -512,7 +510,7 @@ static void GPS_calc_velocity(void)
 //
 static void GPS_calc_location_error(int32_t *target_lat, int32_t *target_lng, int32_t *gps_lat, int32_t *gps_lng)
 {
-    error[LON] = (float)(*target_lng - *gps_lng) * GPS_scaleLonDown;   // X Error
+    error[LON] = GPS_scale_lon(*target_lng - *gps_lng, GPS_scaleLonDown);   // X Error
     error[LAT] = *target_lat - *gps_lat;        // Y Error
 }
 
@@ -645,8 +643,8 @@ static int32_t wrap_36000(int32_t angle)
 
 void updateGpsStateForHomeAndHoldMode(void)
 {
-    float sin_yaw_y = sin_approx(DECIDEGREES_TO_DEGREES(attitude.values.yaw) * 0.0174532925f);
-    float cos_yaw_x = cos_approx(DECIDEGREES_TO_DEGREES(attitude.values.yaw) * 0.0174532925f);
+    float sin_yaw_y = sin_lut(DECIDEGREES_TO_DEGREES(attitude.values.yaw) * 0.0174532925f);
+    float cos_yaw_x = cos_lut(DECIDEGREES_TO_DEGREES(attitude.values.yaw) * 0.0174532925f);
     if (gpsProfile->nav_slew_rate) {
         nav_rated[LON] += constrain(wrap_18000(nav[LON] - nav_rated[LON]), -gpsProfile->nav_slew_rate, gpsProfile->nav_slew_rate); // TODO check this on uint8
         nav_rated[LAT] += constrain(wrap_18000(nav[LAT] - nav_rated[LAT]), -gpsProfile->nav_slew_rate, gpsProfile->nav_slew_rate);
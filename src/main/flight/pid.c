@@ -17,10 +17,12 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <math.h>
 
 #include <platform.h>
 
+#include "build/atomic.h"
 #include "build/build_config.h"
 #include "build/debug.h"
 
@@ -28,6 +30,8 @@
 #include "common/maths.h"
 #include "common/filter.h"
 
+#include "drivers/nvic.h"
+
 #include "fc/fc_main.h"
 #include "fc/rc_controls.h"
 #include "fc/runtime_config.h"
@@ -36,6 +40,8 @@
 #include "flight/imu.h"
 #include "flight/navigation.h"
 
+#include "rx/rx.h"
+
 #include "sensors/gyro.h"
 #include "sensors/acceleration.h"
 
@@ -48,7 +54,19 @@ float axisPIDf[3];
 int32_t axisPID_P[3], axisPID_I[3], axisPID_D[3];
 #endif
 
-static float previousGyroIf[3];
+/*
+ * Controller state, one array per quantity so roll and pitch share one loop body. Yaw has no D term and no
+ * level mode, and runs its own shorter path.
+ */
+typedef struct pidState_s {
+    float iterm[3];
+    float itermRelaxSetpoint[3];    // PT1 of the setpoint, I relax holds I while the setpoint is away from it
+    float limitedSetpoint[3];       // acceleration limiter output of the previous cycle
+    float setpoint[2];              // setpoint of the previous cycle, for the D term setpoint relax
+    float rateError[2];             // D term input of the previous cycle, c * setpoint - gyro
+} pidState_t;
+
+static FAST_RAM_ZERO_INIT pidState_t pidState;
 
 static float dT;
 
@@ -61,7 +79,7 @@ void pidSetTargetLooptime(uint32_t pidLooptime)
 void pidResetErrorGyroState(void)
 {
     for (int axis = 0; axis < 3; axis++) {
-        previousGyroIf[axis] = 0.0f;
+        pidState.iterm[axis] = 0.0f;
     }
 }
 
@@ -70,66 +88,153 @@ void pidStabilisationState(pidStabilisationState_e pidControllerState)
     pidStabilisationEnabled = (pidControllerState == PID_STABILISATION_ON) ? true : false;
 }
 
-const angle_index_t rcAliasToAngleIndexMap[] = { AI_ROLL, AI_PITCH };
-
-static filterApplyFnPtr dtermNotchFilterApplyFn;
-static void *dtermFilterNotch[2];
-static filterApplyFnPtr dtermLpfApplyFn;
-static void *dtermFilterLpf[2];
 static filterApplyFnPtr ptermYawFilterApplyFn;
 static void *ptermYawFilter;
 
-void pidInitFilters(const pidProfile_t *pidProfile)
+static filterApplyFnPtr feedForwardFilterApplyFn;
+static FAST_RAM_ZERO_INIT pt1Filter_t feedForwardFilter[2];
+
+// Dterm LPF coefficients precomputed across the throttle range, from dterm_lpf_hz at zero to dterm_lpf_max_hz at full throttle
+#define DTERM_LPF_THROTTLE_STEPS 8
+static FAST_RAM_ZERO_INIT biquadFilter_t dtermLpfThrottleBiquad[DTERM_LPF_THROTTLE_STEPS + 1];
+static FAST_RAM_ZERO_INIT float dtermLpfThrottlePt1K[DTERM_LPF_THROTTLE_STEPS + 1];
+static biquadFilter3_t *dtermLpfThrottleBiquadFilter;
+static pt1Filter3_t *dtermLpfThrottlePt1Filter;
+
+static void pidInitDtermLpfThrottleTable(const pidProfile_t *pidProfile, biquadFilter3_t *biquadFilter, pt1Filter3_t *pt1Filter)
+{
+    dtermLpfThrottleBiquadFilter = NULL;
+    dtermLpfThrottlePt1Filter = NULL;
+
+    if (!pidProfile->dterm_lpf_hz || !pidProfile->dterm_lpf_max_hz) {
+        return;
+    }
+
+    for (int i = 0; i <= DTERM_LPF_THROTTLE_STEPS; i++) {
+        const float cutoffHz = pidProfile->dterm_lpf_hz + (float)(pidProfile->dterm_lpf_max_hz - pidProfile->dterm_lpf_hz) * i / DTERM_LPF_THROTTLE_STEPS;
+        if (biquadFilter) {
+            biquadFilterInitLPF(&dtermLpfThrottleBiquad[i], cutoffHz, targetPidLooptime);
+        } else {
+            const float RC = 1.0f / (2.0f * M_PIf * cutoffHz);
+            dtermLpfThrottlePt1K[i] = dT / (RC + dT);
+        }
+    }
+    dtermLpfThrottleBiquadFilter = biquadFilter;
+    dtermLpfThrottlePt1Filter = pt1Filter;
+}
+
+// Interpolates between the two nearest table entries, blending stable biquad coefficients always gives a stable filter
+static void pidUpdateDtermLpfThrottle(void)
 {
-    static biquadFilter_t biquadFilterNotch[2];
-    static pt1Filter_t pt1Filter[2];
-    static biquadFilter_t biquadFilter[2];
-    static firFilterDenoise_t denoisingFilter[2];
-    static pt1Filter_t pt1FilterYaw;
+    const float throttle = constrainf((float)(rcCommand[THROTTLE] - PWM_RANGE_MIN) / (PWM_RANGE_MAX - PWM_RANGE_MIN), 0.0f, 1.0f);
+    const float position = throttle * DTERM_LPF_THROTTLE_STEPS;
+    const int i = MIN((int)position, DTERM_LPF_THROTTLE_STEPS - 1);
+    const float fraction = position - i;
+
+    if (dtermLpfThrottleBiquadFilter) {
+        const biquadFilter_t *low = &dtermLpfThrottleBiquad[i];
+        const biquadFilter_t *high = &dtermLpfThrottleBiquad[i + 1];
+        dtermLpfThrottleBiquadFilter->b0 = low->b0 + fraction * (high->b0 - low->b0);
+        dtermLpfThrottleBiquadFilter->b1 = low->b1 + fraction * (high->b1 - low->b1);
+        dtermLpfThrottleBiquadFilter->b2 = low->b2 + fraction * (high->b2 - low->b2);
+        dtermLpfThrottleBiquadFilter->a1 = low->a1 + fraction * (high->a1 - low->a1);
+        dtermLpfThrottleBiquadFilter->a2 = low->a2 + fraction * (high->a2 - low->a2);
+    } else if (dtermLpfThrottlePt1Filter) {
+        dtermLpfThrottlePt1Filter->k = dtermLpfThrottlePt1K[i] + fraction * (dtermLpfThrottlePt1K[i + 1] - dtermLpfThrottlePt1K[i]);
+    }
+}
+
+#ifdef USE_FIXED_FILTER_CHAIN
+// Dterm filter topology fixed at build time, biquad notch followed by biquad LPF, both called directly
+static FAST_RAM_ZERO_INIT biquadFilter3_t dtermFilterNotch;
+static FAST_RAM_ZERO_INIT biquadFilter3_t dtermFilterLpf;
 
-    BUILD_BUG_ON(FD_YAW != 2); // only setting up Dterm filters on roll and pitch axes, so ensure yaw axis is 2
+#define dtermNotchFilterApply(data) biquadFilter3Apply(&dtermFilterNotch, (data))
+#define dtermLpfApply(data) biquadFilter3Apply(&dtermFilterLpf, (data))
 
+static void pidInitDtermFilters(const pidProfile_t *pidProfile)
+{
+    // dterm_filter_type is ignored, a stage set to 0Hz passes samples through unchanged
     if (pidProfile->dterm_notch_hz == 0) {
-        dtermNotchFilterApplyFn = nullFilterApply;
+        biquadFilter3InitPassThrough(&dtermFilterNotch);
     } else {
-        dtermNotchFilterApplyFn = (filterApplyFnPtr)biquadFilterApply;
         const float notchQ = filterGetNotchQ(pidProfile->dterm_notch_hz, pidProfile->dterm_notch_cutoff);
-        for (int axis = FD_ROLL; axis <= FD_PITCH; axis++) {
-            dtermFilterNotch[axis] = &biquadFilterNotch[axis];
-            biquadFilterInit(dtermFilterNotch[axis], pidProfile->dterm_notch_hz, targetPidLooptime, notchQ, FILTER_NOTCH);
-        }
+        biquadFilter3Init(&dtermFilterNotch, pidProfile->dterm_notch_hz, targetPidLooptime, notchQ, FILTER_NOTCH);
+    }
+
+    if (pidProfile->dterm_lpf_hz == 0) {
+        biquadFilter3InitPassThrough(&dtermFilterLpf);
+    } else {
+        biquadFilter3InitLPF(&dtermFilterLpf, pidProfile->dterm_lpf_hz, targetPidLooptime);
+    }
+    pidInitDtermLpfThrottleTable(pidProfile, &dtermFilterLpf, NULL);
+}
+#else
+static filter3ApplyFnPtr dtermNotchFilterApplyFn;
+static void *dtermFilterNotch;
+static filter3ApplyFnPtr dtermLpfApplyFn;
+static void *dtermFilterLpf;
+
+#define dtermNotchFilterApply(data) dtermNotchFilterApplyFn(dtermFilterNotch, (data))
+#define dtermLpfApply(data) dtermLpfApplyFn(dtermFilterLpf, (data))
+
+static void pidInitDtermFilters(const pidProfile_t *pidProfile)
+{
+    static FAST_RAM_ZERO_INIT biquadFilter3_t biquadFilterNotch;
+    static FAST_RAM_ZERO_INIT pt1Filter3_t pt1Filter;
+    static FAST_RAM_ZERO_INIT biquadFilter3_t biquadFilter;
+    static firFilterDenoise_t denoisingFilter[FILTER3_AXIS_COUNT];
+
+    pidInitDtermLpfThrottleTable(pidProfile, NULL, NULL);
+
+    if (pidProfile->dterm_notch_hz == 0) {
+        dtermNotchFilterApplyFn = nullFilter3Apply;
+    } else {
+        dtermNotchFilterApplyFn = (filter3ApplyFnPtr)biquadFilter3Apply;
+        const float notchQ = filterGetNotchQ(pidProfile->dterm_notch_hz, pidProfile->dterm_notch_cutoff);
+        dtermFilterNotch = &biquadFilterNotch;
+        biquadFilter3Init(&biquadFilterNotch, pidProfile->dterm_notch_hz, targetPidLooptime, notchQ, FILTER_NOTCH);
     }
 
     if (pidProfile->dterm_lpf_hz == 0) {
-        dtermLpfApplyFn = nullFilterApply;
+        dtermLpfApplyFn = nullFilter3Apply;
     } else {
         switch (pidProfile->dterm_filter_type) {
         default:
-            dtermLpfApplyFn = nullFilterApply;
+            dtermLpfApplyFn = nullFilter3Apply;
             break;
         case FILTER_PT1:
-            dtermLpfApplyFn = (filterApplyFnPtr)pt1FilterApply;
-            for (int axis = FD_ROLL; axis <= FD_PITCH; axis++) {
-                dtermFilterLpf[axis] = &pt1Filter[axis];
-                pt1FilterInit(dtermFilterLpf[axis], pidProfile->dterm_lpf_hz, dT);
-            }
+            dtermLpfApplyFn = (filter3ApplyFnPtr)pt1Filter3Apply;
+            dtermFilterLpf = &pt1Filter;
+            pt1Filter3Init(&pt1Filter, pidProfile->dterm_lpf_hz, dT);
+            pidInitDtermLpfThrottleTable(pidProfile, NULL, &pt1Filter);
             break;
         case FILTER_BIQUAD:
-            dtermLpfApplyFn = (filterApplyFnPtr)biquadFilterApply;
-            for (int axis = FD_ROLL; axis <= FD_PITCH; axis++) {
-                dtermFilterLpf[axis] = &biquadFilter[axis];
-                biquadFilterInitLPF(dtermFilterLpf[axis], pidProfile->dterm_lpf_hz, targetPidLooptime);
-            }
+            dtermLpfApplyFn = (filter3ApplyFnPtr)biquadFilter3Apply;
+            dtermFilterLpf = &biquadFilter;
+            biquadFilter3InitLPF(&biquadFilter, pidProfile->dterm_lpf_hz, targetPidLooptime);
+            pidInitDtermLpfThrottleTable(pidProfile, &biquadFilter, NULL);
             break;
         case FILTER_FIR:
-            dtermLpfApplyFn = (filterApplyFnPtr)firFilterDenoiseUpdate;
-            for (int axis = FD_ROLL; axis <= FD_PITCH; axis++) {
-                dtermFilterLpf[axis] = &denoisingFilter[axis];
-                firFilterDenoiseInit(dtermFilterLpf[axis], pidProfile->dterm_lpf_hz, targetPidLooptime);
+            dtermLpfApplyFn = (filter3ApplyFnPtr)firFilterDenoise3Apply;
+            dtermFilterLpf = denoisingFilter;
+            for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+                firFilterDenoiseInit(&denoisingFilter[axis], pidProfile->dterm_lpf_hz, targetPidLooptime);
             }
             break;
         }
     }
+}
+#endif
+
+void pidInitFilters(const pidProfile_t *pidProfile)
+{
+    static FAST_RAM_ZERO_INIT pt1Filter_t pt1FilterYaw;
+
+    // Dterm filters run on all three axes together, yaw is always fed 0 so its output stays 0
+    BUILD_BUG_ON(FD_YAW != 2);
+
+    pidInitDtermFilters(pidProfile);
 
     if (pidProfile->yaw_lpf_hz == 0) {
         ptermYawFilterApplyFn = nullFilterApply;
@@ -138,26 +243,46 @@ void pidInitFilters(const pidProfile_t *pidProfile)
         ptermYawFilter = &pt1FilterYaw;
         pt1FilterInit(ptermYawFilter, pidProfile->yaw_lpf_hz, dT);
     }
+
+    if (pidProfile->feedForwardLpfHz == 0) {
+        feedForwardFilterApplyFn = nullFilterApply;
+    } else {
+        feedForwardFilterApplyFn = (filterApplyFnPtr)pt1FilterApply;
+        for (int axis = FD_ROLL; axis <= FD_PITCH; axis++) {
+            pt1FilterInit(&feedForwardFilter[axis], pidProfile->feedForwardLpfHz, dT);
+        }
+    }
 }
 
-static float Kp[3], Ki[3], Kd[3], c[3], levelGain, horizonGain, horizonTransition, maxVelocity[3], relaxFactor[3];
+// dT is folded into the I and D gains, the feed forward works on a derivative that is already per second
+static FAST_RAM_ZERO_INIT float Kp[3], Ki[3], Kd[3], Kff[3], c[3], levelGain, horizonGain, horizonTransition, maxVelocity[3], relaxFactor[3];
+static FAST_RAM_ZERO_INIT float itermIgnoreRateInverse[3];
+static FAST_RAM_ZERO_INIT float itermRelaxK;    // PT1 gain, one cutoff for all axes
 
 void pidInitConfig(const pidProfile_t *pidProfile) {
-    for(int axis = FD_ROLL; axis <= FD_YAW; axis++) {
-        Kp[axis] = PTERM_SCALE * pidProfile->P8[axis];
-        Ki[axis] = ITERM_SCALE * pidProfile->I8[axis];
-        Kd[axis] = DTERM_SCALE * pidProfile->D8[axis];
-        c[axis] = pidProfile->dtermSetpointWeight / 100.0f;
-        relaxFactor[axis] = 1.0f - (pidProfile->setpointRelaxRatio / 100.0f);
+    // the PID loop can run from an interrupt, keep it from running on a mix of the old and new gains
+    ATOMIC_BLOCK(NVIC_PRIO_PID_LOOP) {
+        for(int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+            Kp[axis] = PTERM_SCALE * pidProfile->P8[axis];
+            Ki[axis] = ITERM_SCALE * pidProfile->I8[axis] * dT;
+            Kd[axis] = DTERM_SCALE * pidProfile->D8[axis] / dT;
+            Kff[axis] = DTERM_SCALE * pidProfile->D8[axis] * pidProfile->feedForwardWeight / 100.0f;
+            c[axis] = pidProfile->dtermSetpointWeight / 100.0f;
+            relaxFactor[axis] = 1.0f - (pidProfile->setpointRelaxRatio / 100.0f);
+        }
+        itermIgnoreRateInverse[FD_ROLL] = itermIgnoreRateInverse[FD_PITCH] = 1.0f / pidProfile->rollPitchItermIgnoreRate;
+        itermIgnoreRateInverse[FD_YAW] = 1.0f / pidProfile->yawItermIgnoreRate;
+        const float itermRelaxRC = 1.0f / (2.0f * M_PIf * MAX(pidProfile->itermRelaxCutoff, 1));
+        itermRelaxK = dT / (itermRelaxRC + dT);
+        levelGain = pidProfile->P8[PIDLEVEL] / 10.0f;
+        horizonGain = pidProfile->I8[PIDLEVEL] / 10.0f;
+        horizonTransition = 100.0f / pidProfile->D8[PIDLEVEL];
+        maxVelocity[FD_ROLL] = maxVelocity[FD_PITCH] = pidProfile->rateAccelLimit * 1000 * dT;
+        maxVelocity[FD_YAW] = pidProfile->yawRateAccelLimit * 1000 * dT;
     }
-    levelGain = pidProfile->P8[PIDLEVEL] / 10.0f;
-    horizonGain = pidProfile->I8[PIDLEVEL] / 10.0f;
-    horizonTransition = 100.0f / pidProfile->D8[PIDLEVEL];
-    maxVelocity[FD_ROLL] = maxVelocity[FD_PITCH] = pidProfile->rateAccelLimit * 1000 * dT;
-    maxVelocity[FD_YAW] = pidProfile->yawRateAccelLimit * 1000 * dT;
 }
 
-float calcHorizonLevelStrength(void) {
+static float calcHorizonLevelStrength(void) {
     float horizonLevelStrength = 0.0f;
     if (horizonTransition > 0.0f) {
         const float mostDeflectedPos = MAX(getRcDeflectionAbs(FD_ROLL), getRcDeflectionAbs(FD_PITCH));
@@ -167,122 +292,172 @@ float calcHorizonLevelStrength(void) {
     return horizonLevelStrength;
 }
 
-float pidLevel(int axis, const pidProfile_t *pidProfile, const rollAndPitchTrims_t *angleTrim, float currentPidSetpoint) {
+static float pidLevelErrorAngle(int axis, const pidProfile_t *pidProfile, const rollAndPitchTrims_t *angleTrim) {
     // calculate error angle and limit the angle to the max inclination
     float errorAngle = pidProfile->levelSensitivity * getRcDeflection(axis);
 #ifdef GPS
     errorAngle += GPS_angle[axis];
 #endif
     errorAngle = constrainf(errorAngle, -pidProfile->levelAngleLimit, pidProfile->levelAngleLimit);
-    errorAngle = (errorAngle - ((attitude.raw[axis] + angleTrim->raw[axis]) / 10.0f));
-    if(FLIGHT_MODE(ANGLE_MODE)) {
-        // ANGLE mode - control is angle based, so control loop is needed
-        currentPidSetpoint = errorAngle * levelGain;
-    } else {
-        // HORIZON mode - direct sticks control is applied to rate PID
-        // mix up angle error to desired AngleRate to add a little auto-level feel
-        const float horizonLevelStrength = calcHorizonLevelStrength();
-        currentPidSetpoint = currentPidSetpoint + (errorAngle * horizonGain * horizonLevelStrength);
-    }
-    return currentPidSetpoint;
+    return errorAngle - ((attitude.raw[axis] + angleTrim->raw[axis]) / 10.0f);
 }
 
-float accelerationLimit(int axis, float currentPidSetpoint) {
-    static float previousSetpoint[3];
-    const float currentVelocity = currentPidSetpoint- previousSetpoint[axis];
+static float accelerationLimit(int axis, float currentPidSetpoint) {
+    const float currentVelocity = currentPidSetpoint - pidState.limitedSetpoint[axis];
 
     if(ABS(currentVelocity) > maxVelocity[axis])
-        currentPidSetpoint = (currentVelocity > 0) ? previousSetpoint[axis] + maxVelocity[axis] : previousSetpoint[axis] - maxVelocity[axis];
+        currentPidSetpoint = (currentVelocity > 0) ? pidState.limitedSetpoint[axis] + maxVelocity[axis] : pidState.limitedSetpoint[axis] - maxVelocity[axis];
 
-    previousSetpoint[axis] = currentPidSetpoint;
+    pidState.limitedSetpoint[axis] = currentPidSetpoint;
     return currentPidSetpoint;
 }
 
+// a setpoint this far from its low pass, in deg/s, holds I completely
+#define ITERM_RELAX_SETPOINT_THRESHOLD 30.0f
+
+static inline float pidApplyIterm(int axis, float currentPidSetpoint, float errorRate, bool itermActive, bool itermRelax)
+{
+    float ITerm = pidState.iterm[axis];
+
+    // Reduce strong Iterm accumulation during higher stick inputs
+    float setpointRateScaler = constrainf(1.0f - ABS(currentPidSetpoint) * itermIgnoreRateInverse[axis], 0.0f, 1.0f);
+    if (itermRelax) {
+        // the error during a fast stick move is the craft catching up, integrating it gives bounce back at the stop
+        pidState.itermRelaxSetpoint[axis] += itermRelaxK * (currentPidSetpoint - pidState.itermRelaxSetpoint[axis]);
+        const float setpointHpf = ABS(currentPidSetpoint - pidState.itermRelaxSetpoint[axis]);
+        setpointRateScaler *= MAX(1.0f - setpointHpf * (1.0f / ITERM_RELAX_SETPOINT_THRESHOLD), 0.0f);
+    }
+    // the error isn't real while the gyro is saturated, so the integrator is held
+    if (itermActive) {
+        ITerm += Ki[axis] * errorRate * setpointRateScaler;
+    }
+    // limit maximum integrator value to prevent WindUp
+    ITerm = constrainf(ITerm, -250.0f, 250.0f);
+    pidState.iterm[axis] = ITerm;
+    return ITerm;
+}
+
 // Betaflight pid controller, which will be maintained in the future with additional features specialised for current (mini) multirotor usage.
 // Based on 2DOF reference design (matlab)
-void pidController(const pidProfile_t *pidProfile, const rollAndPitchTrims_t *angleTrim)
+FAST_CODE void pidController(const pidProfile_t *pidProfile, const rollAndPitchTrims_t *angleTrim)
 {
-    static float previousRateError[2];
-    static float previousSetpoint[3];
+    float DTerm[3] = { 0.0f, 0.0f, 0.0f };  // unfiltered, yaw D not yet supported
+    float FFTerm[3] = { 0.0f, 0.0f, 0.0f };
 
     // ----------PID controller----------
     const float tpaFactor = getThrottlePIDAttenuation();
 
-    for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+    // the mode dependent choices are made once per cycle rather than per axis
+    const bool itermActive = !(gyro.overflowResponse & GYRO_OVERFLOW_RESPONSE_ITERM);
+    const bool setpointRelax = pidProfile->setpointRelaxRatio < 100;
+    const bool itermRelax = pidProfile->itermRelax != ITERM_RELAX_OFF;
+    const bool itermRelaxYaw = pidProfile->itermRelax == ITERM_RELAX_RPY;
+
+    // ANGLE mode - control is angle based, the angle error replaces the stick setpoint
+    // HORIZON mode - direct sticks control is applied to rate PID, mixed with the angle error for a little auto-level feel
+    const bool levelMode = FLIGHT_MODE(ANGLE_MODE) || FLIGHT_MODE(HORIZON_MODE);
+    float stickSetpointWeight = 1.0f;
+    float levelErrorGain = 0.0f;
+    if (FLIGHT_MODE(ANGLE_MODE)) {
+        stickSetpointWeight = 0.0f;
+        levelErrorGain = levelGain;
+    } else if (FLIGHT_MODE(HORIZON_MODE)) {
+        levelErrorGain = horizonGain * calcHorizonLevelStrength();
+    }
+
+    // --------low-level gyro-based PID based on 2DOF PID controller. ----------
+    //  ---------- 2-DOF PID controller with optional filter on derivative term. b = 1 and only c can be tuned (amount derivative on measurement or error).  ----------
+
+    for (int axis = FD_ROLL; axis <= FD_PITCH; axis++) {
         float currentPidSetpoint = getSetpointRate(axis);
 
-        if(maxVelocity[axis])
+        if (maxVelocity[axis]) {
             currentPidSetpoint = accelerationLimit(axis, currentPidSetpoint);
-
-        // Yaw control is GYRO based, direct sticks control is applied to rate PID
-        if ((FLIGHT_MODE(ANGLE_MODE) || FLIGHT_MODE(HORIZON_MODE)) && axis != YAW) {
-            currentPidSetpoint = pidLevel(axis, pidProfile, angleTrim, currentPidSetpoint);
+        }
+        if (levelMode) {
+            currentPidSetpoint = currentPidSetpoint * stickSetpointWeight + pidLevelErrorAngle(axis, pidProfile, angleTrim) * levelErrorGain;
         }
 
         const float gyroRate = gyro.gyroADCf[axis]; // Process variable from gyro output in deg/sec
 
-        // --------low-level gyro-based PID based on 2DOF PID controller. ----------
-        //  ---------- 2-DOF PID controller with optional filter on derivative term. b = 1 and only c can be tuned (amount derivative on measurement or error).  ----------
-
         // -----calculate error rate
         const float errorRate = currentPidSetpoint - gyroRate;       // r - y
 
-        // -----calculate P component and add Dynamic Part based on stick input
-        float PTerm = Kp[axis] * errorRate * tpaFactor;
-        if (axis == FD_YAW) {
-            PTerm = ptermYawFilterApplyFn(ptermYawFilter, PTerm);
-        }
+        // -----calculate P component
+        const float PTerm = Kp[axis] * errorRate * tpaFactor;
 
         // -----calculate I component
-        // Reduce strong Iterm accumulation during higher stick inputs
-        const float accumulationThreshold = (axis == FD_YAW) ? pidProfile->yawItermIgnoreRate : pidProfile->rollPitchItermIgnoreRate;
-        const float setpointRateScaler = constrainf(1.0f - (ABS(currentPidSetpoint) / accumulationThreshold), 0.0f, 1.0f);
-
-        float ITerm = previousGyroIf[axis];
-        ITerm += Ki[axis] * errorRate * dT * setpointRateScaler;
-        // limit maximum integrator value to prevent WindUp
-        ITerm = constrainf(ITerm, -250.0f, 250.0f);
-        previousGyroIf[axis] = ITerm;
-
-        // -----calculate D component (Yaw D not yet supported)
-        float DTerm = 0.0;
-        if (axis != FD_YAW) {
-            float dynC = c[axis];
-            if (pidProfile->setpointRelaxRatio < 100) {
-                const float rcDeflection = getRcDeflectionAbs(axis);
-                dynC = c[axis];
-                if (currentPidSetpoint > 0) {
-                    if ((currentPidSetpoint - previousSetpoint[axis]) < previousSetpoint[axis])
-                        dynC = dynC * sq(rcDeflection) * relaxFactor[axis] + dynC * (1-relaxFactor[axis]);
-                } else if (currentPidSetpoint < 0) {
-                    if ((currentPidSetpoint - previousSetpoint[axis]) > previousSetpoint[axis])
-                        dynC = dynC * sq(rcDeflection) * relaxFactor[axis] + dynC * (1-relaxFactor[axis]);
-                }
+        const float ITerm = pidApplyIterm(axis, currentPidSetpoint, errorRate, itermActive, itermRelax);
+
+        // -----calculate D component, filtered and added once all axes are done
+        const float previousSetpoint = pidState.setpoint[axis];
+        float dynC = c[axis];
+        if (setpointRelax) {
+            const float rcDeflection = getRcDeflectionAbs(axis);
+            if (currentPidSetpoint > 0) {
+                if ((currentPidSetpoint - previousSetpoint) < previousSetpoint)
+                    dynC = dynC * sq(rcDeflection) * relaxFactor[axis] + dynC * (1-relaxFactor[axis]);
+            } else if (currentPidSetpoint < 0) {
+                if ((currentPidSetpoint - previousSetpoint) > previousSetpoint)
+                    dynC = dynC * sq(rcDeflection) * relaxFactor[axis] + dynC * (1-relaxFactor[axis]);
             }
-            const float rD = dynC * currentPidSetpoint - gyroRate;    // cr - y
-            // Divide rate change by dT to get differential (ie dr/dt)
-            const float delta = (rD - previousRateError[axis]) / dT;
-            previousRateError[axis] = rD;
+        }
+        const float rD = dynC * currentPidSetpoint - gyroRate;    // cr - y
+        // Kd includes the division by dT that turns the rate change into a differential (ie dr/dt)
+        DTerm[axis] = Kd[axis] * (rD - pidState.rateError[axis]) * tpaFactor;
+        pidState.rateError[axis] = rD;
+        DEBUG_SET(DEBUG_DTERM_FILTER, axis, DTerm[axis]);
+
+        // -----calculate feed forward from the stick setpoint slope between RX frames, smoothed on its own rather
+        // than by the D filters, the level mode angle error is left to P and D
+        const float setpointDerivative = feedForwardFilterApplyFn(&feedForwardFilter[axis], getSetpointRateDerivative(axis));
+        FFTerm[axis] = Kff[axis] * setpointDerivative * stickSetpointWeight * tpaFactor;
+        pidState.setpoint[axis] = currentPidSetpoint;
+
+        // -----calculate P and I part of the PID output
+        axisPIDf[axis] = PTerm + ITerm;
 
-            DTerm = Kd[axis] * delta * tpaFactor;
-            DEBUG_SET(DEBUG_DTERM_FILTER, axis, DTerm);
+#ifdef BLACKBOX
+        axisPID_P[axis] = PTerm;
+        axisPID_I[axis] = ITerm;
+#endif
+    }
 
-            // apply filters
-            DTerm = dtermNotchFilterApplyFn(dtermFilterNotch[axis], DTerm);
-            DTerm = dtermLpfApplyFn(dtermFilterLpf[axis], DTerm);
+    // Yaw control is GYRO based, direct sticks control is applied to rate PID. Yaw D not yet supported.
+    {
+        float currentPidSetpoint = getSetpointRate(FD_YAW);
 
+        if (maxVelocity[FD_YAW]) {
+            currentPidSetpoint = accelerationLimit(FD_YAW, currentPidSetpoint);
         }
-        previousSetpoint[axis] = currentPidSetpoint;
 
+        const float errorRate = currentPidSetpoint - gyro.gyroADCf[FD_YAW];
+        const float PTerm = ptermYawFilterApplyFn(ptermYawFilter, Kp[FD_YAW] * errorRate * tpaFactor);
+        const float ITerm = pidApplyIterm(FD_YAW, currentPidSetpoint, errorRate, itermActive, itermRelaxYaw);
+
+        axisPIDf[FD_YAW] = PTerm + ITerm;
+
+#ifdef BLACKBOX
+        axisPID_P[FD_YAW] = PTerm;
+        axisPID_I[FD_YAW] = ITerm;
+#endif
+    }
+
+    // apply filters, all axes in one pass
+    if (dtermLpfThrottleBiquadFilter || dtermLpfThrottlePt1Filter) {
+        pidUpdateDtermLpfThrottle();
+    }
+    dtermNotchFilterApply(DTerm);
+    dtermLpfApply(DTerm);
+
+    for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
         // -----calculate total PID output
-        axisPIDf[axis] = PTerm + ITerm + DTerm;
+        axisPIDf[axis] += DTerm[axis] + FFTerm[axis];
         // Disable PID control at zero throttle
         if (!pidStabilisationEnabled) axisPIDf[axis] = 0;
 
 #ifdef BLACKBOX
-        axisPID_P[axis] = PTerm;
-        axisPID_I[axis] = ITerm;
-        axisPID_D[axis] = DTerm;
+        axisPID_D[axis] = DTerm[axis];
 #endif
     }
 }
@@ -55,6 +55,12 @@ typedef enum {
     PID_STABILISATION_ON
 } pidStabilisationState_e;
 
+typedef enum {
+    ITERM_RELAX_OFF = 0,
+    ITERM_RELAX_RP,
+    ITERM_RELAX_RPY
+} itermRelax_e;
+
 typedef struct pidProfile_s {
     uint8_t P8[PID_ITEM_COUNT];
     uint8_t I8[PID_ITEM_COUNT];
@@ -62,11 +68,14 @@ typedef struct pidProfile_s {
 
     uint8_t dterm_filter_type;              // Filter selection for dterm
     uint16_t dterm_lpf_hz;                  // Delta Filter in hz
+    uint16_t dterm_lpf_max_hz;              // Delta Filter in hz at full throttle, 0 keeps dterm_lpf_hz at all throttle positions
     uint16_t yaw_lpf_hz;                    // Additional yaw filter when yaw axis too noisy
     uint16_t dterm_notch_hz;                // Biquad dterm notch hz
     uint16_t dterm_notch_cutoff;            // Biquad dterm notch low cutoff
     uint16_t rollPitchItermIgnoreRate;      // Experimental threshold for resetting iterm for pitch and roll on certain rates
     uint16_t yawItermIgnoreRate;            // Experimental threshold for resetting iterm for yaw on certain rates
+    uint8_t itermRelax;                     // Axes on which I stops accumulating while the setpoint moves fast, itermRelax_e
+    uint8_t itermRelaxCutoff;               // Hz, PT1 of the setpoint that the setpoint is compared against for I relax
     uint16_t yaw_p_limit;
     float pidSumLimit;
     uint8_t dterm_average_count;            // Configurable delta count for dterm
@@ -78,6 +87,8 @@ typedef struct pidProfile_s {
     uint16_t itermThrottleThreshold;        // max allowed throttle delta before errorGyroReset in ms
     uint8_t setpointRelaxRatio;             // Setpoint weight relaxation effect
     uint8_t dtermSetpointWeight;            // Setpoint weight for Dterm (0= measurement, 1= full error, 1 > agressive derivative)
+    uint8_t feedForwardWeight;              // Setpoint derivative between RX frames added to the PID sum, in percent of D
+    uint8_t feedForwardLpfHz;               // PT1 smoothing of the feed forward setpoint derivative, 0 for none
     float yawRateAccelLimit;                // yaw accel limiter for deg/sec/ms
     float rateAccelLimit;                   // accel limiter roll/pitch deg/sec/ms
     float levelSensitivity;
@@ -85,6 +96,9 @@ typedef struct pidProfile_s {
 
 typedef struct pidConfig_s {
     uint8_t pid_process_denom;              // Processing denominator for PID controller vs gyro sampling rate
+    uint8_t pid_in_interrupt;               // Run gyro, PID and motor updates from the gyro interrupt rather than the scheduler, where supported
+    uint8_t loop_rate_auto;                 // Select gyro_sync_denom and pid_process_denom from the PID path times measured after boot
+    uint8_t loop_rate_headroom;             // CPU load percentage loop_rate_auto leaves free
 } pidConfig_t;
 
 union rollAndPitchTrims_u;
@@ -27,6 +27,7 @@
 #include "build/build_config.h"
 
 #include "common/filter.h"
+#include "common/maths.h"
 
 #include "drivers/pwm_output.h"
 #include "drivers/system.h"
@@ -142,11 +143,89 @@ const mixerRules_t servoMixers[] = {
 
 static servoMixer_t *customServoMixers;
 
+/*
+ * The rules in use, compiled into arrays grouped by target servo, so a servo's rules are summed in one pass and
+ * its rate and middle applied once. The direction of the source is folded into the rate and range, the range is
+ * in output units and the speed is the most the output may move per servo update.
+ */
+typedef struct servoRuleTable_s {
+    uint8_t count;
+    uint8_t firstRule[MAX_SUPPORTED_SERVOS + 1];    // the rules of servo n are [firstRule[n], firstRule[n + 1])
+    uint8_t inputSource[MAX_SERVO_RULES];
+    int16_t rate[MAX_SERVO_RULES];
+    int16_t min[MAX_SERVO_RULES];
+    int16_t max[MAX_SERVO_RULES];
+    int16_t delta[MAX_SERVO_RULES];                 // 0 for no rate limit
+    uint32_t boxMask[MAX_SERVO_RULES];              // 0 for rules that are always active
+    int16_t output[MAX_SERVO_RULES];                // the rate limited input of each rule
+} servoRuleTable_t;
+
+static servoRuleTable_t servoRules;
+
+// servo updates per PID loop, the speed of a rule was a step per PID loop before servos ran at their own rate
+static uint32_t servoUpdateIntervalUs = 1;
+static uint32_t servoLoopIntervalUs = 1;
+
+// the servos share one set of coefficients, each keeps only its state
+static biquadFilter_t servoFilterCoefficients;
+static float servoFilterState1[MAX_SUPPORTED_SERVOS];
+static float servoFilterState2[MAX_SUPPORTED_SERVOS];
+
+/*
+ * Compiles the rules in currentServoMixer into servoRules, call when the rules or the servo configurations change.
+ */
+void servoCompileRules(void)
+{
+    servoRuleTable_t *table = &servoRules;
+
+    table->count = 0;
+    if (!servoConf) {
+        memset(table->firstRule, 0, sizeof(table->firstRule));
+        return;
+    }
+
+    for (int target = 0; target < MAX_SUPPORTED_SERVOS; target++) {
+        table->firstRule[target] = table->count;
+
+        const int16_t servoWidth = servoConf[target].max - servoConf[target].min;
+
+        for (int i = 0; i < servoRuleCount; i++) {
+            const servoMixer_t *rule = &currentServoMixer[i];
+            if (rule->targetChannel != target) {
+                continue;
+            }
+            const uint8_t index = table->count++;
+
+            table->inputSource[index] = rule->inputSource;
+
+            const int16_t min = rule->min * servoWidth / 100 - servoWidth / 2;
+            const int16_t max = rule->max * servoWidth / 100 - servoWidth / 2;
+            if (servoDirection(target, rule->inputSource) < 0) {
+                // -constrain(x, min, max) is constrain(-x, -max, -min)
+                table->rate[index] = -rule->rate;
+                table->min[index] = -max;
+                table->max[index] = -min;
+            } else {
+                table->rate[index] = rule->rate;
+                table->min[index] = min;
+                table->max[index] = max;
+            }
+
+            table->delta[index] = MIN((uint32_t)rule->speed * servoUpdateIntervalUs / servoLoopIntervalUs, INT16_MAX);
+            table->boxMask[index] = rule->box ? (1 << (BOXSERVO1 + rule->box - 1)) : 0;
+            table->output[index] = 0;
+        }
+    }
+    table->firstRule[MAX_SUPPORTED_SERVOS] = table->count;
+}
+
 void servoUseConfigs(servoMixerConfig_t *servoMixerConfigToUse, servoParam_t *servoParamsToUse, struct gimbalConfig_s *gimbalConfigToUse)
 {
     servoMixerConfig = servoMixerConfigToUse;
     servoConf = servoParamsToUse;
     gimbalConfig = gimbalConfigToUse;
+
+    servoCompileRules();
 }
 
 int16_t determineServoMiddleOrForwardFromChannel(servoIndex_e servoIndex)
@@ -201,6 +280,8 @@ void loadCustomServoMixer(void)
         currentServoMixer[i] = customServoMixers[i];
         servoRuleCount++;
     }
+
+    servoCompileRules();
 }
 
 void servoConfigureOutput(void)
@@ -230,6 +311,8 @@ void servoConfigureOutput(void)
             loadCustomServoMixer();
         }
     }
+
+    servoCompileRules();
 }
 
 
@@ -331,7 +414,6 @@ void writeServos(void)
 STATIC_UNIT_TESTED void servoMixer(void)
 {
     int16_t input[INPUT_SOURCE_COUNT]; // Range [-500:+500]
-    static int16_t currentOutput[MAX_SERVO_RULES];
     uint8_t i;
 
     if (FLIGHT_MODE(PASSTHRU_MODE)) {
@@ -371,37 +453,35 @@ STATIC_UNIT_TESTED void servoMixer(void)
     input[INPUT_RC_AUX3]     = rcData[AUX3]     - rxConfig->midrc;
     input[INPUT_RC_AUX4]     = rcData[AUX4]     - rxConfig->midrc;
 
-    for (i = 0; i < MAX_SUPPORTED_SERVOS; i++)
-        servo[i] = 0;
-
-    // mix servos according to rules
-    for (i = 0; i < servoRuleCount; i++) {
-        // consider rule if no box assigned or box is active
-        if (currentServoMixer[i].box == 0 || IS_RC_MODE_ACTIVE(BOXSERVO1 + currentServoMixer[i].box - 1)) {
-            uint8_t target = currentServoMixer[i].targetChannel;
-            uint8_t from = currentServoMixer[i].inputSource;
-            uint16_t servo_width = servoConf[target].max - servoConf[target].min;
-            int16_t min = currentServoMixer[i].min * servo_width / 100 - servo_width / 2;
-            int16_t max = currentServoMixer[i].max * servo_width / 100 - servo_width / 2;
-
-            if (currentServoMixer[i].speed == 0)
-                currentOutput[i] = input[from];
-            else {
-                if (currentOutput[i] < input[from])
-                    currentOutput[i] = constrain(currentOutput[i] + currentServoMixer[i].speed, currentOutput[i], input[from]);
-                else if (currentOutput[i] > input[from])
-                    currentOutput[i] = constrain(currentOutput[i] - currentServoMixer[i].speed, input[from], currentOutput[i]);
+    const servoRuleTable_t *table = &servoRules;
+
+    for (int target = 0; target < MAX_SUPPORTED_SERVOS; target++) {
+        int32_t sum = 0;
+
+        // mix servos according to rules
+        for (i = table->firstRule[target]; i < table->firstRule[target + 1]; i++) {
+            // consider rule if no box assigned or box is active
+            if (table->boxMask[i] && !(rcModeActivationMask & table->boxMask[i])) {
+                servoRules.output[i] = 0;
+                continue;
+            }
+            const int16_t in = input[table->inputSource[i]];
+            int16_t out = servoRules.output[i];
+
+            if (table->delta[i] == 0) {
+                out = in;
+            } else if (out < in) {
+                out = MIN(out + table->delta[i], in);
+            } else if (out > in) {
+                out = MAX(out - table->delta[i], in);
             }
+            servoRules.output[i] = out;
 
-            servo[target] += servoDirection(target, from) * constrain(((int32_t)currentOutput[i] * currentServoMixer[i].rate) / 100, min, max);
-        } else {
-            currentOutput[i] = 0;
+            sum += constrain(((int32_t)out * table->rate[i]) / 100, table->min[i], table->max[i]);
         }
-    }
 
-    for (i = 0; i < MAX_SUPPORTED_SERVOS; i++) {
-        servo[i] = ((int32_t)servoConf[i].rate * servo[i]) / 100L;
-        servo[i] += determineServoMiddleOrForwardFromChannel(i);
+        servo[target] = ((int32_t)servoConf[target].rate * sum) / 100L;
+        servo[target] += determineServoMiddleOrForwardFromChannel(target);
     }
 }
 
@@ -461,24 +541,42 @@ bool isMixerUsingServos(void)
     return useServo;
 }
 
-void filterServos(void)
+void servoInitFilters(uint32_t updateIntervalUs)
 {
-    static int16_t servoIdx;
-    static bool servoFilterIsSet;
-    static biquadFilter_t servoFilter[MAX_SUPPORTED_SERVOS];
+    // the filter runs at the servo update rate, keep the cutoff below its Nyquist frequency
+    const uint16_t maxCutoffHz = 1000000 / updateIntervalUs / 2 - 1;
+    const uint16_t cutoffHz = MIN(servoMixerConfig->servo_lowpass_freq, maxCutoffHz);
 
+    biquadFilterInitLPF(&servoFilterCoefficients, cutoffHz, updateIntervalUs);
+    memset(servoFilterState1, 0, sizeof(servoFilterState1));
+    memset(servoFilterState2, 0, sizeof(servoFilterState2));
+}
+
+// the speeds of the rules are converted to steps per update of the servos, which run every updateIntervalUs
+void servoSetUpdateInterval(uint32_t updateIntervalUs, uint32_t loopIntervalUs)
+{
+    servoUpdateIntervalUs = updateIntervalUs;
+    servoLoopIntervalUs = MAX(loopIntervalUs, 1);
+
+    servoCompileRules();
+}
+
+void filterServos(void)
+{
 #if defined(MIXER_DEBUG)
     uint32_t startTime = micros();
 #endif
 
     if (servoMixerConfig->servo_lowpass_enable) {
-        for (servoIdx = 0; servoIdx < MAX_SUPPORTED_SERVOS; servoIdx++) {
-            if (!servoFilterIsSet) {
-                biquadFilterInitLPF(&servoFilter[servoIdx], servoMixerConfig->servo_lowpass_freq, targetPidLooptime);
-                servoFilterIsSet = true;
-            }
-
-            servo[servoIdx] = lrintf(biquadFilterApply(&servoFilter[servoIdx], (float)servo[servoIdx]));
+        const biquadFilter_t *filter = &servoFilterCoefficients;
+
+        for (int servoIdx = 0; servoIdx < MAX_SUPPORTED_SERVOS; servoIdx++) {
+            // biquadFilterApply() on the state of this servo
+            const float input = servo[servoIdx];
+            const float result = filter->b0 * input + servoFilterState1[servoIdx];
+            servoFilterState1[servoIdx] = filter->b1 * input - filter->a1 * result + servoFilterState2[servoIdx];
+            servoFilterState2[servoIdx] = filter->b2 * input - filter->a2 * result;
+            servo[servoIdx] = lrintf(result);
             // Sanity check
             servo[servoIdx] = constrain(servo[servoIdx], servoConf[servoIdx].min, servoConf[servoIdx].max);
         }
@@ -106,7 +106,7 @@ typedef struct servoParam_s {
 
 typedef struct servoMixerConfig_s{
     uint8_t tri_unarmed_servo;              // send tail servo correction pulses even when unarmed
-    uint16_t servo_lowpass_freq;             // lowpass servo filter frequency selection; 1/1000ths of loop freq
+    uint16_t servo_lowpass_freq;             // lowpass servo filter cutoff in Hz, limited to below half the servo update rate
     int8_t servo_lowpass_enable;            // enable/disable lowpass filter
 } servoMixerConfig_t;
 
@@ -119,6 +119,8 @@ extern int16_t servo[MAX_SUPPORTED_SERVOS];
 void servoTable(void);
 bool isMixerUsingServos(void);
 void writeServos(void);
+void servoInitFilters(uint32_t updateIntervalUs);
+void servoSetUpdateInterval(uint32_t updateIntervalUs, uint32_t loopIntervalUs);
 void filterServos(void);
 
 void servoMixerInit(servoMixer_t *customServoMixers);
@@ -127,5 +129,6 @@ void servoUseConfigs(servoMixerConfig_t *servoConfigToUse, servoParam_t *servoPa
 void servoMixerLoadMix(int index, servoMixer_t *customServoMixers);
 void loadCustomServoMixer(void);
 void servoConfigureOutput(void);
+void servoCompileRules(void);
 int servoDirection(int servoIndex, int fromChannel);
 
@@ -29,13 +29,20 @@
 #include "fat_standard.h"
 #include "drivers/sdcard.h"
 
+#ifdef USE_SDCARD_PROFILER
+#include "io/sdcard_profiler.h"
+#endif
+
 #ifdef AFATFS_DEBUG
     #define ONLY_EXPOSE_FOR_TESTING
 #else
     #define ONLY_EXPOSE_FOR_TESTING static
 #endif
 
+// Targets with RAM to spare raise this for a deeper write-behind cache
+#ifndef AFATFS_NUM_CACHE_SECTORS
 #define AFATFS_NUM_CACHE_SECTORS 8
+#endif
 
 // FAT filesystems are allowed to differ from these parameters, but we choose not to support those weird filesystems:
 #define AFATFS_SECTOR_SIZE  512
@@ -69,6 +76,8 @@
 #define AFATFS_FILE_MODE_CREATE           16
 // The file's directory entry should be locked in cache so we can read it with no latency:
 #define AFATFS_FILE_MODE_RETAIN_DIRECTORY 32
+// The caller knows the file doesn't exist yet, so it is created without searching the directory for it:
+#define AFATFS_FILE_MODE_NEW              64
 
 // Open the cache sector for read access (it will be read from disk)
 #define AFATFS_CACHE_READ         1
@@ -80,6 +89,8 @@
 #define AFATFS_CACHE_DISCARDABLE  8
 // Increase the retain counter of the cache sector to prevent it from being discarded when in the in-sync state
 #define AFATFS_CACHE_RETAIN       16
+// The sector holds directory entries, so keep it in the cache in preference to file data
+#define AFATFS_CACHE_METADATA     32
 
 // Turn the largest free block on the disk into one contiguous file for efficient fragment-free allocation
 #define AFATFS_USE_FREEFILE
@@ -191,6 +202,13 @@ typedef struct afatfsCacheBlockDescriptor_t {
      * is overridden by the locked and retainCount flags.
      */
     unsigned discardable:1;
+
+    /*
+     * The sector belongs to a FAT or a directory. When the cache has to evict an in-sync sector it prefers to evict
+     * file data, since the metadata is likely to be needed again soon (e.g. to extend the FAT chain of the file being
+     * written).
+     */
+    unsigned metadata:1;
 } afatfsCacheBlockDescriptor_t;
 
 typedef enum {
@@ -443,6 +461,8 @@ typedef struct afatfs_t {
 
     int cacheDirtyEntries; // The number of cache entries in the AFATFS_CACHE_STATE_DIRTY state
     bool cacheFlushInProgress;
+    uint32_t cacheFlushNextSector;   // The sector that would continue the card's current multi-block write...
+    uint32_t cacheFlushRunRemaining; // ...and the number of sectors that write still expects
 
     afatfsFile_t openFiles[AFATFS_MAX_OPEN_FILES];
 
@@ -461,6 +481,17 @@ typedef struct afatfs_t {
     // The current working directory:
     afatfsFile_t currentDirectory;
 
+    /*
+     * The byte offset of the end of the entries in a directory, where a new file's entry can go straight away without
+     * searching the directory for a free one. Entries are only ever added at the end or in place of deleted ones, so
+     * it stays right until an entry is allocated in that directory, which moves it on.
+     */
+    struct {
+        bool valid;
+        uint32_t directoryCluster;
+        uint32_t offset;
+    } directoryEnd;
+
     uint32_t partitionStartSector; // The physical sector that the first partition on the device begins at
 
     uint32_t fatStartSector; // The first sector of the first FAT
@@ -615,6 +646,7 @@ static void afatfs_cacheSectorInit(afatfsCacheBlockDescriptor_t *descriptor, uin
     descriptor->locked = locked;
     descriptor->retainCount = 0;
     descriptor->discardable = 0;
+    descriptor->metadata = sectorIndex < afatfs.clusterStartSector; // The FATs and any FAT16 root directory
 }
 
 /**
@@ -674,16 +706,76 @@ static void afatfs_sdcardWriteComplete(sdcardBlockOperation_e operation, uint32_
     }
 }
 
+static afatfsCacheBlockDescriptor_t* afatfs_findCacheSector(uint32_t sectorIndex);
+
+/**
+ * Returns true if the cache holds the given sector in the dirty state and it's free to be flushed.
+ */
+static bool afatfs_cacheSectorIsFlushable(uint32_t sectorIndex)
+{
+    afatfsCacheBlockDescriptor_t *descriptor = afatfs_findCacheSector(sectorIndex);
+
+    return descriptor && descriptor->state == AFATFS_CACHE_STATE_DIRTY && !descriptor->locked;
+}
+
+#ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
+/**
+ * Count the flushable sectors in the cache that lie consecutively on disk starting from the given sector.
+ */
+static uint32_t afatfs_cacheDirtyRunLength(uint32_t sectorIndex)
+{
+    uint32_t runLength = 0;
+
+    while (runLength < AFATFS_NUM_CACHE_SECTORS && afatfs_cacheSectorIsFlushable(sectorIndex + runLength)) {
+        runLength++;
+    }
+
+    return runLength;
+}
+#endif
+
+/**
+ * Keep track of the multi-block write on the card after a sector was sent. `runLength` is the length of the write that
+ * was begun with this sector, if any.
+ */
+static void afatfs_cacheFlushAdvanceRun(uint32_t sectorIndex, uint32_t runLength)
+{
+    if (runLength > 0) {
+        afatfs.cacheFlushRunRemaining = runLength;
+    } else if (sectorIndex != afatfs.cacheFlushNextSector) {
+        afatfs.cacheFlushRunRemaining = 0;
+    }
+
+    if (afatfs.cacheFlushRunRemaining > 0) {
+        afatfs.cacheFlushRunRemaining--;
+    }
+
+    afatfs.cacheFlushNextSector = sectorIndex + 1;
+}
+
 /**
  * Attempt to flush the dirty cache entry with the given index to the SDcard.
  */
 static void afatfs_cacheFlushSector(int cacheIndex)
 {
     afatfsCacheBlockDescriptor_t *cacheDescriptor = &afatfs.cacheDescriptor[cacheIndex];
+    const bool continuesRun = afatfs.cacheFlushRunRemaining > 0 && cacheDescriptor->sectorIndex == afatfs.cacheFlushNextSector;
+    uint32_t runLength = 0;
 
 #ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
     if (cacheDescriptor->consecutiveEraseBlockCount) {
-        sdcard_beginWriteBlocks(cacheDescriptor->sectorIndex, cacheDescriptor->consecutiveEraseBlockCount);
+        runLength = cacheDescriptor->consecutiveEraseBlockCount;
+    } else if (!continuesRun) {
+        // Sectors that were dirtied separately but sit next to each other on disk can still go out as one write
+        runLength = afatfs_cacheDirtyRunLength(cacheDescriptor->sectorIndex);
+
+        if (runLength < AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT) {
+            runLength = 0;
+        }
+    }
+
+    if (runLength) {
+        sdcard_beginWriteBlocks(cacheDescriptor->sectorIndex, runLength);
     }
 #endif
 
@@ -693,18 +785,25 @@ static void afatfs_cacheFlushSector(int cacheIndex)
             afatfs.cacheDirtyEntries--;
             cacheDescriptor->state = AFATFS_CACHE_STATE_WRITING;
             afatfs.cacheFlushInProgress = true;
+            afatfs_cacheFlushAdvanceRun(cacheDescriptor->sectorIndex, runLength);
             break;
 
         case SDCARD_OPERATION_SUCCESS:
             // Buffer is already transmitted
             afatfs.cacheDirtyEntries--;
             cacheDescriptor->state = AFATFS_CACHE_STATE_IN_SYNC;
+            afatfs_cacheFlushAdvanceRun(cacheDescriptor->sectorIndex, runLength);
             break;
 
         case SDCARD_OPERATION_BUSY:
         case SDCARD_OPERATION_FAILURE:
         default:
-            ;
+            /* The card may be ending its run of writes to make room for this sector, so let this one go next rather
+             * than have the run restarted ahead of it
+             */
+            if (!continuesRun) {
+                afatfs.cacheFlushRunRemaining = 0;
+            }
     }
 }
 
@@ -730,7 +829,8 @@ static afatfsCacheBlockDescriptor_t* afatfs_findCacheSector(uint32_t sectorIndex
  * - The requested sector that already exists in the cache
  * - The index of an empty sector
  * - The index of a synced discardable sector
- * - The index of the oldest synced sector
+ * - The index of the oldest synced sector of file data
+ * - The index of the oldest synced FAT or directory sector
  *
  * Otherwise it returns -1 to signal failure (cache is full!)
  */
@@ -742,6 +842,9 @@ static int afatfs_allocateCacheSector(uint32_t sectorIndex)
     uint32_t oldestSyncedSectorLastUse = 0xFFFFFFFF;
     int oldestSyncedSectorIndex = -1;
 
+    uint32_t oldestSyncedMetadataLastUse = 0xFFFFFFFF;
+    int oldestSyncedMetadataIndex = -1;
+
     if (
         !afatfs_assert(
             afatfs.numClusters == 0 // We're unable to check sector bounds during startup since we haven't read volume label yet
@@ -776,6 +879,11 @@ static int afatfs_allocateCacheSector(uint32_t sectorIndex)
                 if (!afatfs.cacheDescriptor[i].locked && afatfs.cacheDescriptor[i].retainCount == 0) {
                     if (afatfs.cacheDescriptor[i].discardable) {
                         discardableIndex = i;
+                    } else if (afatfs.cacheDescriptor[i].metadata) {
+                        if (afatfs.cacheDescriptor[i].accessTimestamp < oldestSyncedMetadataLastUse) {
+                            oldestSyncedMetadataLastUse = afatfs.cacheDescriptor[i].accessTimestamp;
+                            oldestSyncedMetadataIndex = i;
+                        }
                     } else if (afatfs.cacheDescriptor[i].accessTimestamp < oldestSyncedSectorLastUse) {
                         // This is older than last block we decided to evict, so evict this one in preference
                         oldestSyncedSectorLastUse = afatfs.cacheDescriptor[i].accessTimestamp;
@@ -794,6 +902,8 @@ static int afatfs_allocateCacheSector(uint32_t sectorIndex)
         allocateIndex = discardableIndex;
     } else if (oldestSyncedSectorIndex > -1) {
         allocateIndex = oldestSyncedSectorIndex;
+    } else if (oldestSyncedMetadataIndex > -1) {
+        allocateIndex = oldestSyncedMetadataIndex;
     } else {
         allocateIndex = -1;
     }
@@ -811,7 +921,16 @@ static int afatfs_allocateCacheSector(uint32_t sectorIndex)
 bool afatfs_flush()
 {
     if (afatfs.cacheDirtyEntries > 0) {
-        // Flush the oldest flushable sector
+        /* Carry on from the sector the card last wrote if that one is ready too, so a multi-block write isn't broken
+         * up by an older sector that lives elsewhere on the disk
+         */
+        if (afatfs.cacheFlushRunRemaining > 0 && afatfs_cacheSectorIsFlushable(afatfs.cacheFlushNextSector)) {
+            afatfs_cacheFlushSector(afatfs_findCacheSector(afatfs.cacheFlushNextSector) - afatfs.cacheDescriptor);
+
+            return false;
+        }
+
+        // Otherwise flush the oldest flushable sector
         uint32_t earliestSectorTime = 0xFFFFFFFF;
         int earliestSectorIndex = -1;
 
@@ -909,6 +1028,10 @@ static afatfsOperationStatus_e afatfs_cacheSector(uint32_t physicalSectorIndex,
         return AFATFS_OPERATION_IN_PROGRESS;
     }
 
+    if ((sectorFlags & AFATFS_CACHE_METADATA) != 0) {
+        afatfs.cacheDescriptor[cacheSectorIndex].metadata = 1;
+    }
+
     switch (afatfs.cacheDescriptor[cacheSectorIndex].state) {
         case AFATFS_CACHE_STATE_READING:
             return AFATFS_OPERATION_IN_PROGRESS;
@@ -1436,7 +1559,7 @@ static afatfsOperationStatus_e afatfs_saveDirectoryEntry(afatfsFilePtr_t file, a
         return AFATFS_OPERATION_SUCCESS; // Root directories don't have a directory entry
     }
 
-    result = afatfs_cacheSector(file->directoryEntryPos.sectorNumberPhysical, &sector, AFATFS_CACHE_READ | AFATFS_CACHE_WRITE, 0);
+    result = afatfs_cacheSector(file->directoryEntryPos.sectorNumberPhysical, &sector, AFATFS_CACHE_READ | AFATFS_CACHE_WRITE | AFATFS_CACHE_METADATA, 0);
 
 #ifdef AFATFS_DEBUG_VERBOSE
     fprintf(stderr, "Saving directory entry to sector %u...\n", file->directoryEntryPos.sectorNumberPhysical);
@@ -1812,10 +1935,16 @@ static uint8_t* afatfs_fileRetainCursorSectorForRead(afatfsFilePtr_t file)
 
         afatfs_assert(physicalSector > 0); // We never read the root sector using files
 
+        uint8_t cacheFlags = AFATFS_CACHE_READ | AFATFS_CACHE_RETAIN;
+
+        if (file->type != AFATFS_FILE_TYPE_NORMAL) {
+            cacheFlags |= AFATFS_CACHE_METADATA;
+        }
+
         afatfsOperationStatus_e status = afatfs_cacheSector(
             physicalSector,
             &result,
-            AFATFS_CACHE_READ | AFATFS_CACHE_RETAIN,
+            cacheFlags,
             0
         );
 
@@ -1876,6 +2005,10 @@ static uint8_t* afatfs_fileLockCursorSectorForWrite(afatfsFilePtr_t file)
             cacheFlags |= AFATFS_CACHE_READ;
         }
 
+        if (file->type != AFATFS_FILE_TYPE_NORMAL) {
+            cacheFlags |= AFATFS_CACHE_METADATA;
+        }
+
         // In contiguous append mode, we'll pre-erase the whole supercluster
         if ((file->mode & (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_CONTIGUOUS)) == (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_CONTIGUOUS)) {
             uint32_t cursorOffsetInSupercluster = file->cursorOffset & (afatfs_superClusterSize() - 1);
@@ -2129,6 +2262,13 @@ bool afatfs_ftell(afatfsFilePtr_t file, uint32_t *position)
     }
 }
 
+static void afatfs_setDirectoryEnd(afatfsFilePtr_t directory, uint32_t offset)
+{
+    afatfs.directoryEnd.valid = true;
+    afatfs.directoryEnd.directoryCluster = directory->firstCluster;
+    afatfs.directoryEnd.offset = offset;
+}
+
 /**
  * Attempt to advance the directory pointer `finder` to the next entry in the directory.
  *
@@ -2159,6 +2299,10 @@ afatfsOperationStatus_e afatfs_findNext(afatfsFilePtr_t directory, afatfsFinder_
 
         finder->sectorNumberPhysical = afatfs_fileGetCursorPhysicalSector(directory);
 
+        if (fat_isDirectoryEntryTerminator(*dirEntry)) {
+            afatfs_setDirectoryEnd(directory, directory->cursorOffset + finder->entryIndex * sizeof(fatDirectoryEntry_t));
+        }
+
         return AFATFS_OPERATION_SUCCESS;
     } else {
         if (afatfs_isEndOfAllocatedFile(directory)) {
@@ -2189,6 +2333,31 @@ void afatfs_findFirst(afatfsFilePtr_t directory, afatfsFinder_t *finder)
     finder->entryIndex = -1;
 }
 
+/**
+ * Initialise the finder for afatfs_allocateDirectoryEntry() to start from the end of the entries in the directory if
+ * that is known, or else from its first entry.
+ */
+static void afatfs_findDirectoryEnd(afatfsFilePtr_t directory, afatfsFinder_t *finder)
+{
+    if (!afatfs.directoryEnd.valid || afatfs.directoryEnd.directoryCluster != directory->firstCluster) {
+        afatfs_findFirst(directory, finder);
+        return;
+    }
+
+    const uint32_t offset = afatfs.directoryEnd.offset;
+
+    // Seek from the start, the size of a directory is always zero so afatfs_fseek() can't be used to go past it
+    afatfs_fileUnlockCacheSector(directory);
+
+    directory->cursorPreviousCluster = 0;
+    directory->cursorCluster = directory->firstCluster;
+    directory->cursorOffset = 0;
+
+    afatfs_fseekInternal(directory, offset - offset % AFATFS_SECTOR_SIZE, NULL);
+
+    finder->entryIndex = (offset % AFATFS_SECTOR_SIZE) / sizeof(fatDirectoryEntry_t) - 1;
+}
+
 static afatfsOperationStatus_e afatfs_extendSubdirectoryContinue(afatfsFile_t *directory)
 {
     afatfsExtendSubdirectory_t *opState = &directory->operation.state.extendSubdirectory;
@@ -2342,6 +2511,11 @@ static afatfsOperationStatus_e afatfs_allocateDirectoryEntry(afatfsFilePtr_t dir
             if (fat_isDirectoryEntryEmpty(*dirEntry) || fat_isDirectoryEntryTerminator(*dirEntry)) {
                 afatfs_cacheSectorMarkDirty(afatfs_getCacheDescriptorForBuffer((uint8_t*) *dirEntry));
 
+                if (fat_isDirectoryEntryTerminator(*dirEntry)) {
+                    // The entries now end one further on
+                    afatfs_setDirectoryEnd(directory, directory->cursorOffset + (finder->entryIndex + 1) * sizeof(fatDirectoryEntry_t));
+                }
+
                 afatfs_findLast(directory);
                 return AFATFS_OPERATION_SUCCESS;
             }
@@ -2548,6 +2722,13 @@ static void afatfs_createFileContinue(afatfsFile_t *file)
 
     switch (opState->phase) {
         case AFATFS_CREATEFILE_PHASE_INITIAL:
+            if ((file->mode & AFATFS_FILE_MODE_NEW) != 0) {
+                // No need to look for the file, its entry can go at the end of the directory
+                afatfs_findDirectoryEnd(&afatfs.currentDirectory, &file->directoryEntryPos);
+                opState->phase = AFATFS_CREATEFILE_PHASE_CREATE_NEW_FILE;
+                goto doMore;
+            }
+
             afatfs_findFirst(&afatfs.currentDirectory, &file->directoryEntryPos);
             opState->phase = AFATFS_CREATEFILE_PHASE_FIND_FILE;
             goto doMore;
@@ -2629,7 +2810,7 @@ static void afatfs_createFileContinue(afatfsFile_t *file)
                 status = afatfs_cacheSector(
                     file->directoryEntryPos.sectorNumberPhysical,
                     &directorySector,
-                    AFATFS_CACHE_READ | AFATFS_CACHE_RETAIN,
+                    AFATFS_CACHE_READ | AFATFS_CACHE_RETAIN | AFATFS_CACHE_METADATA,
                     0
                 );
 
@@ -2952,6 +3133,9 @@ bool afatfs_chdir(afatfsFilePtr_t directory)
  * ws   If the file is already non-empty or freefile support is not compiled in then it will fall back to non-contiguous
  *      operation.
  *
+ * an, wn, asn, wsn - Create a file that the caller knows doesn't exist yet. The directory isn't searched for it, so
+ *      the open takes the same time however many files the directory holds.
+ *
  * All other mode strings are illegal. In particular, don't add "b" to the end of the mode string.
  *
  * Returns false if the the open failed really early (out of file handles).
@@ -2988,6 +3172,10 @@ bool afatfs_fopen(const char *filename, const char *mode, afatfsFileCallback_t c
         break;
     }
 
+    if ((fileMode & AFATFS_FILE_MODE_CREATE) != 0 && strchr(mode + 1, 'n')) {
+        fileMode |= AFATFS_FILE_MODE_NEW;
+    }
+
     file = afatfs_allocateFileHandle();
 
     if (file) {
@@ -3035,59 +3223,98 @@ void afatfs_fputc(afatfsFilePtr_t file, uint8_t c)
  */
 uint32_t afatfs_fwrite(afatfsFilePtr_t file, const uint8_t *buffer, uint32_t len)
 {
-    if ((file->mode & (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_WRITE)) == 0) {
-        return 0;
-    }
-
-    if (afatfs_fileIsBusy(file)) {
-        // There might be a seek pending
-        return 0;
-    }
-
-    uint32_t cursorOffsetInSector = file->cursorOffset % AFATFS_SECTOR_SIZE;
     uint32_t writtenBytes = 0;
 
     while (len > 0) {
-        uint32_t bytesToWriteThisSector = MIN(AFATFS_SECTOR_SIZE - cursorOffsetInSector, len);
         uint8_t *sectorBuffer;
+        uint32_t bytesToWriteThisSector = MIN(afatfs_fwriteReserve(file, &sectorBuffer), len);
 
-        sectorBuffer = afatfs_fileLockCursorSectorForWrite(file);
-        if (!sectorBuffer) {
-            // Cache is currently busy
+        if (bytesToWriteThisSector == 0) {
+            // Cache is currently busy, or there's a seek pending
             break;
         }
 
-        memcpy(sectorBuffer + cursorOffsetInSector, buffer, bytesToWriteThisSector);
+        memcpy(sectorBuffer, buffer, bytesToWriteThisSector);
 
         writtenBytes += bytesToWriteThisSector;
 
-        /*
-         * If the seek doesn't complete immediately then we'll break and wait for that seek to complete by waiting for
-         * the file to be non-busy on entry again.
-         *
-         * A seek operation should always be able to queue on the file since we have checked that the file wasn't busy
-         * on entry (fseek will never return AFATFS_OPERATION_FAILURE).
-         *
-         * If the seek has to queue, when the seek completes, it'll update the fileSize for us to contain the cursor.
-         */
-        if (afatfs_fseekInternal(file, bytesToWriteThisSector, NULL) == AFATFS_OPERATION_IN_PROGRESS) {
+        if (!afatfs_fwriteCommit(file, bytesToWriteThisSector)) {
             break;
         }
 
-#ifdef AFATFS_USE_FREEFILE
-        if ((file->mode & AFATFS_FILE_MODE_CONTIGUOUS) != 0) {
-            afatfs_assert(file->cursorCluster < afatfs.freeFile.firstCluster);
-        }
-#endif
-
         len -= bytesToWriteThisSector;
         buffer += bytesToWriteThisSector;
-        cursorOffsetInSector = 0;
     }
 
     return writtenBytes;
 }
 
+/**
+ * Get a pointer straight into the cache sector at the file's cursor, so the caller can produce its data in place
+ * instead of having afatfs_fwrite() copy it in. Any number of bytes up to the returned count can be written there,
+ * and they only become part of the file when they're passed to afatfs_fwriteCommit(), which must happen before any
+ * other operation on the file.
+ *
+ * Returns the number of bytes available at *buffer (up to the end of the sector), or 0 if the file isn't open for
+ * writing or the filesystem is busy (try again later).
+ */
+uint32_t afatfs_fwriteReserve(afatfsFilePtr_t file, uint8_t **buffer)
+{
+    if ((file->mode & (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_WRITE)) == 0) {
+        return 0;
+    }
+
+    if (afatfs_fileIsBusy(file)) {
+        // There might be a seek pending
+        return 0;
+    }
+
+    // The sector stays locked in the cache, so it won't be flushed underneath the caller
+    uint8_t *sectorBuffer = afatfs_fileLockCursorSectorForWrite(file);
+
+    if (!sectorBuffer) {
+        return 0;
+    }
+
+    uint32_t cursorOffsetInSector = file->cursorOffset % AFATFS_SECTOR_SIZE;
+
+    *buffer = sectorBuffer + cursorOffsetInSector;
+
+    return AFATFS_SECTOR_SIZE - cursorOffsetInSector;
+}
+
+/**
+ * Add `len` bytes that were written to the buffer returned by afatfs_fwriteReserve() to the file, by advancing the
+ * cursor over them.
+ *
+ * Returns true if the file can accept more data straight away, or false if the cursor had to wait on a FAT update to
+ * move into the next cluster (the file is busy until that completes, the data is still committed).
+ */
+bool afatfs_fwriteCommit(afatfsFilePtr_t file, uint32_t len)
+{
+    if (len == 0) {
+        return true;
+    }
+
+    /*
+     * A seek operation should always be able to queue on the file since it wasn't busy when the space was reserved
+     * (fseek will never return AFATFS_OPERATION_FAILURE).
+     *
+     * If the seek has to queue, when the seek completes, it'll update the fileSize for us to contain the cursor.
+     */
+    if (afatfs_fseekInternal(file, len, NULL) == AFATFS_OPERATION_IN_PROGRESS) {
+        return false;
+    }
+
+#ifdef AFATFS_USE_FREEFILE
+    if ((file->mode & AFATFS_FILE_MODE_CONTIGUOUS) != 0) {
+        afatfs_assert(file->cursorCluster < afatfs.freeFile.firstCluster);
+    }
+#endif
+
+    return true;
+}
+
 /**
  * Attempt to read `len` bytes from `file` into the `buffer`.
  *
@@ -3313,6 +3540,14 @@ static afatfsOperationStatus_e afatfs_findLargestContiguousFreeBlockContinue()
                             // Start a new search for a new hole
                             opState->candidateStart = roundUpTo(opState->candidateEnd + 1, fatEntriesPerSector);
                             opState->phase = AFATFS_FREE_SPACE_SEARCH_PHASE_FIND_HOLE;
+
+                            /* No hole in what's left of the volume could beat the best one, so don't read the rest of
+                             * the FAT. On a large, mostly empty card this ends the search after the first hole.
+                             */
+                            if (opState->candidateStart >= afatfs.numClusters + FAT_SMALLEST_LEGAL_CLUSTER_NUMBER
+                                || afatfs.numClusters + FAT_SMALLEST_LEGAL_CLUSTER_NUMBER - opState->candidateStart <= opState->bestGapLength) {
+                                return AFATFS_OPERATION_SUCCESS;
+                            }
                         }
                     break;
 
@@ -3516,6 +3751,10 @@ void afatfs_poll()
 
 void afatfs_sdcardProfilerCallback(sdcardBlockOperation_e operation, uint32_t blockIndex, uint32_t duration)
 {
+#ifdef USE_SDCARD_PROFILER
+    sdcardProfilerRecord(operation, blockIndex, duration);
+#endif
+
     // Make sure the log file has actually been opened before we try to log to it:
     if (afatfs.introSpecLog.type == AFATFS_FILE_TYPE_NONE) {
         return;
@@ -3561,6 +3800,34 @@ afatfsFilesystemState_e afatfs_getFilesystemState()
     return afatfs.filesystemState;
 }
 
+/**
+ * Get the progress of the filesystem initialization as a percentage. Searching the FAT for the freefile's space takes
+ * most of the time on large cards, so its position through the FAT is what's reported.
+ */
+uint8_t afatfs_getInitProgress()
+{
+    if (afatfs.filesystemState == AFATFS_FILESYSTEM_STATE_READY) {
+        return 100;
+    }
+    if (afatfs.filesystemState != AFATFS_FILESYSTEM_STATE_INITIALIZATION || afatfs.numClusters == 0) {
+        return 0;
+    }
+
+#ifdef AFATFS_USE_FREEFILE
+    if (afatfs.initPhase < AFATFS_INITIALIZATION_FREEFILE_FAT_SEARCH) {
+        return 0;
+    }
+    if (afatfs.initPhase == AFATFS_INITIALIZATION_FREEFILE_FAT_SEARCH) {
+        const afatfsFreeSpaceSearch_t *opState = &afatfs.initState.freeSpaceSearch;
+        const uint32_t searched = MAX(opState->candidateStart, opState->candidateEnd) - FAT_SMALLEST_LEGAL_CLUSTER_NUMBER;
+
+        return MIN((uint64_t) searched * 100 / afatfs.numClusters, 99);
+    }
+#endif
+
+    return 99;
+}
+
 afatfsError_e afatfs_getLastError()
 {
     return afatfs.lastError;
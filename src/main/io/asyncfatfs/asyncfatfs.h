@@ -68,6 +68,8 @@ bool afatfs_funlink(afatfsFilePtr_t file, afatfsCallback_t callback);
 bool afatfs_feof(afatfsFilePtr_t file);
 void afatfs_fputc(afatfsFilePtr_t file, uint8_t c);
 uint32_t afatfs_fwrite(afatfsFilePtr_t file, const uint8_t *buffer, uint32_t len);
+uint32_t afatfs_fwriteReserve(afatfsFilePtr_t file, uint8_t **buffer);
+bool afatfs_fwriteCommit(afatfsFilePtr_t file, uint32_t len);
 uint32_t afatfs_fread(afatfsFilePtr_t file, uint8_t *buffer, uint32_t len);
 afatfsOperationStatus_e afatfs_fseek(afatfsFilePtr_t file, int32_t offset, afatfsSeek_e whence);
 bool afatfs_ftell(afatfsFilePtr_t file, uint32_t *position);
@@ -87,6 +89,7 @@ void afatfs_poll();
 uint32_t afatfs_getFreeBufferSpace();
 uint32_t afatfs_getContiguousFreeSpace();
 bool afatfs_isFull();
+uint8_t afatfs_getInitProgress();
 
 afatfsFilesystemState_e afatfs_getFilesystemState();
 afatfsError_e afatfs_getLastError();
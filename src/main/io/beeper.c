@@ -42,6 +42,8 @@
 
 #include "io/beeper.h"
 
+#include "scheduler/scheduler.h"
+
 #if FLASH_SIZE > 64
 #define BEEPER_NAMES
 #endif
@@ -118,6 +120,11 @@ static const uint8_t beep_gyroCalibrated[] = {
     20, 10, 20, 10, 20, 10, BEEPER_COMMAND_STOP
 };
 
+// 10 fast beeps once init is done, played while the gyro calibrates instead of holding up the boot
+static const uint8_t beep_systemInit[] = {
+    3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, BEEPER_COMMAND_STOP
+};
+
 // array used for variable # of beeps (reporting GPS sat count, etc)
 static uint8_t beep_multiBeeps[MAX_MULTI_BEEPS + 2];
 
@@ -132,6 +139,8 @@ static uint8_t beeperIsOn = 0;
 static uint16_t beeperPos = 0;
 // Time when beeper routine must act next time
 static uint32_t beeperNextToggleTime = 0;
+// How often the task looks at the beeper switch while no sequence is playing
+#define BEEPER_IDLE_CHECK_PERIOD_US (100 * 1000)
 // Time of last arming beep in microseconds (for blackbox)
 static uint32_t armingBeepTimeMicros = 0;
 
@@ -169,7 +178,7 @@ typedef struct beeperTableEntry_s {
     { BEEPER_ENTRY(BEEPER_MULTI_BEEPS,           13, beep_multiBeeps,      "MULTI_BEEPS") }, // FIXME having this listed makes no sense since the beep array will not be initialised.
     { BEEPER_ENTRY(BEEPER_DISARM_REPEAT,         14, beep_disarmRepeatBeep, "DISARM_REPEAT") },
     { BEEPER_ENTRY(BEEPER_ARMED,                 15, beep_armedBeep,       "ARMED") },
-    { BEEPER_ENTRY(BEEPER_SYSTEM_INIT,           16, NULL,                 "SYSTEM_INIT") },
+    { BEEPER_ENTRY(BEEPER_SYSTEM_INIT,           16, beep_systemInit,      "SYSTEM_INIT") },
     { BEEPER_ENTRY(BEEPER_USB,                   17, NULL,                 "ON_USB") },
 
     { BEEPER_ENTRY(BEEPER_ALL,                   18, NULL,                 "ALL") },
@@ -218,6 +227,9 @@ void beeper(beeperMode_e mode)
 
     beeperPos = 0;
     beeperNextToggleTime = 0;
+
+    // the task only wakes up at the edges of the sequence, starting with this one
+    schedulerSignalTask(TASK_BEEPER);
 }
 
 void beeperSilence(void)
@@ -277,8 +289,22 @@ void beeperGpsStatus(void)
 #endif
 
 /*
- * Beeper handler function to be called periodically in loop. Updates beeper
- * state via time schedule.
+ * The beeper task is signal driven, this is called when it is signalled by beeper() or its period, the time to
+ * the next edge of the sequence, has passed.
+ */
+bool beeperUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs)
+{
+    UNUSED(currentDeltaTimeUs);
+
+    if (IS_RC_MODE_ACTIVE(BOXBEEPERON)) {
+        return true;
+    }
+    return currentBeeperEntry != NULL && beeperNextToggleTime <= currentTimeUs;
+}
+
+/*
+ * Beeper handler function, run by the beeper task at each edge of the sequence. Updates beeper
+ * state via time schedule and schedules itself for the next edge.
  */
 void beeperUpdate(timeUs_t currentTimeUs)
 {
@@ -297,10 +323,12 @@ void beeperUpdate(timeUs_t currentTimeUs)
 
     // Beeper routine doesn't need to update if there aren't any sounds ongoing
     if (currentBeeperEntry == NULL) {
+        rescheduleTask(TASK_SELF, BEEPER_IDLE_CHECK_PERIOD_US);
         return;
     }
 
     if (beeperNextToggleTime > currentTimeUs) {
+        rescheduleTask(TASK_SELF, beeperNextToggleTime - currentTimeUs);
         return;
     }
 
@@ -329,6 +357,13 @@ void beeperUpdate(timeUs_t currentTimeUs)
     }
 
     beeperProcessCommand(currentTimeUs);
+
+    if (currentBeeperEntry == NULL) {
+        rescheduleTask(TASK_SELF, BEEPER_IDLE_CHECK_PERIOD_US);
+    } else {
+        // a repeat goes back to the start of the sequence straight away
+        rescheduleTask(TASK_SELF, beeperNextToggleTime > currentTimeUs ? beeperNextToggleTime - currentTimeUs : 0);
+    }
 }
 
 /*
@@ -401,6 +436,7 @@ void beeper(beeperMode_e mode) {UNUSED(mode);}
 void beeperSilence(void) {}
 void beeperConfirmationBeeps(uint8_t beepCount) {UNUSED(beepCount);}
 void beeperUpdate(timeUs_t currentTimeUs) {UNUSED(currentTimeUs);}
+bool beeperUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs) {UNUSED(currentTimeUs); UNUSED(currentDeltaTimeUs); return false;}
 uint32_t getArmingBeepTimeMicros(void) {return 0;}
 beeperMode_e beeperModeForTableIndex(int idx) {UNUSED(idx); return BEEPER_SILENCE;}
 const char *beeperNameForTableIndex(int idx) {UNUSED(idx); return NULL;}
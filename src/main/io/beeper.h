@@ -49,6 +49,7 @@ typedef enum {
 
 void beeper(beeperMode_e mode);
 void beeperSilence(void);
+bool beeperUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs);
 void beeperUpdate(timeUs_t currentTimeUs);
 void beeperConfirmationBeeps(uint8_t beepCount);
 uint32_t getArmingBeepTimeMicros(void);
@@ -81,8 +81,12 @@ controlRateConfig_t *getControlRateConfig(uint8_t profileIndex);
 #define DISPLAY_UPDATE_FREQUENCY (MICROSECONDS_IN_A_SECOND / 5)
 #define PAGE_CYCLE_FREQUENCY (MICROSECONDS_IN_A_SECOND * 5)
 
+// The status lines are left to the next call if the page used up the scheduler budget
+#define DASHBOARD_STATUS_BUDGET_US 100
+
 static uint32_t nextDisplayUpdateAt = 0;
 static bool dashboardPresent = false;
+static bool statusUpdatePending = false;
 
 static rxConfig_t *rxConfig;
 static displayPort_t *displayPort;
@@ -372,6 +376,7 @@ void showGpsPage() {
 
     static uint8_t gpsTicker = 0;
     static uint32_t lastGPSSvInfoReceivedCount = 0;
+    gpsRequestSvInfo();
     if (GPS_svInfoReceivedCount != lastGPSSvInfoReceivedCount) {
         lastGPSSvInfoReceivedCount = GPS_svInfoReceivedCount;
         gpsTicker++;
@@ -586,16 +591,36 @@ void showDebugPage(void)
 }
 #endif
 
+static void updateStatus(void)
+{
+    updateFailsafeStatus();
+    updateRxStatus();
+    updateTicker();
+}
+
 void dashboardUpdate(timeUs_t currentTimeUs)
 {
     static uint8_t previousArmedState = 0;
 
+    // the pages drawn on earlier calls go out one per call, without waiting for the transfer
+    if (dashboardPresent) {
+        i2c_OLED_flush();
+    }
+
 #ifdef CMS
     if (displayIsGrabbed(displayPort)) {
         return;
     }
 #endif
 
+    if (statusUpdatePending) {
+        statusUpdatePending = false;
+        if (!ARMING_FLAG(ARMED)) {
+            updateStatus();
+        }
+        return;
+    }
+
     const bool updateNow = (int32_t)(currentTimeUs - nextDisplayUpdateAt) >= 0L;
     if (!updateNow) {
         return;
@@ -688,11 +713,12 @@ void dashboardUpdate(timeUs_t currentTimeUs)
 #endif
     }
     if (!armedState) {
-        updateFailsafeStatus();
-        updateRxStatus();
-        updateTicker();
+        if (schedulerGetRemainingBudgetUs() < DASHBOARD_STATUS_BUDGET_US) {
+            statusUpdatePending = true;
+        } else {
+            updateStatus();
+        }
     }
-
 }
 
 void dashboardSetPage(pageId_e pageId)
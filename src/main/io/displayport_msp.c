@@ -26,6 +26,8 @@
 
 #include "common/utils.h"
 
+#include "config/config_master.h"
+
 #include "drivers/display.h"
 #include "drivers/system.h"
 
@@ -36,16 +38,112 @@
 
 static displayPort_t mspDisplayPort;
 
+/*
+ * Batch mode coalesces writes into a single MSP_DISPLAYPORT_WRITE_BATCH packet, sent by drawScreen() when the
+ * port has room for it. The payload is a list of row segments:
+ *     row, col, length, length characters
+ * or, with MSP_DP_BATCH_RUN set in length, a single character repeated (length & ~MSP_DP_BATCH_RUN) times.
+ */
+#define MSP_DISPLAYPORT_WRITE_BATCH 5
+#define MSP_DP_BATCH_RUN            0x80
+#define MSP_DP_BATCH_MAX_SEGMENT    (MSP_DP_BATCH_RUN - 1)
+#define MSP_DP_BATCH_MIN_RUN        8       // shorter runs cost less as part of a literal segment
+#define MSP_DP_BATCH_SIZE           128
+#define MSP_FRAME_OVERHEAD          6       // header and checksum
+
+static uint8_t batchBuf[MSP_DP_BATCH_SIZE];
+static int batchLen = 0;
+static int batchLastSegment = -1;           // offset of the last literal segment, which a following write may extend
+
 static int output(displayPort_t *displayPort, uint8_t cmd, const uint8_t *buf, int len)
 {
     UNUSED(displayPort);
     return mspSerialPush(cmd, buf, len);
 }
 
+static void batchReset(void)
+{
+    batchBuf[0] = MSP_DISPLAYPORT_WRITE_BATCH;
+    batchLen = 1;
+    batchLastSegment = -1;
+}
+
+static int batchFlush(displayPort_t *displayPort)
+{
+    int ret = 0;
+    if (batchLen > 1) {
+        ret = output(displayPort, MSP_DISPLAYPORT, batchBuf, batchLen);
+    }
+    batchReset();
+    return ret;
+}
+
+static void batchAppendRun(displayPort_t *displayPort, uint8_t col, uint8_t row, uint8_t c, int count)
+{
+    if (batchLen + 4 > MSP_DP_BATCH_SIZE) {
+        batchFlush(displayPort);
+    }
+    batchBuf[batchLen++] = row;
+    batchBuf[batchLen++] = col;
+    batchBuf[batchLen++] = MSP_DP_BATCH_RUN | count;
+    batchBuf[batchLen++] = c;
+    batchLastSegment = -1;
+}
+
+static void batchAppendLiteral(displayPort_t *displayPort, uint8_t col, uint8_t row, const char *s, int len)
+{
+    while (len > 0) {
+        // extend the previous segment if this carries straight on from it
+        if (batchLastSegment >= 0) {
+            const uint8_t *seg = &batchBuf[batchLastSegment];
+            if (seg[0] == row && seg[1] + seg[2] == col && seg[2] < MSP_DP_BATCH_MAX_SEGMENT && batchLen < MSP_DP_BATCH_SIZE) {
+                batchBuf[batchLen++] = *s++;
+                batchBuf[batchLastSegment + 2]++;
+                col++;
+                len--;
+                continue;
+            }
+        }
+        if (batchLen + 4 > MSP_DP_BATCH_SIZE) {
+            batchFlush(displayPort);
+        }
+        batchLastSegment = batchLen;
+        batchBuf[batchLen++] = row;
+        batchBuf[batchLen++] = col;
+        batchBuf[batchLen++] = 0;
+    }
+}
+
+static int batchWrite(displayPort_t *displayPort, uint8_t col, uint8_t row, const char *string, int len)
+{
+    const int startLen = batchLen;
+    int literalStart = 0;
+
+    for (int i = 0; i < len; ) {
+        int run = 1;
+        while (i + run < len && string[i + run] == string[i] && run < MSP_DP_BATCH_MAX_SEGMENT) {
+            run++;
+        }
+        if (run >= MSP_DP_BATCH_MIN_RUN) {
+            batchAppendLiteral(displayPort, col + literalStart, row, &string[literalStart], i - literalStart);
+            batchAppendRun(displayPort, col + i, row, string[i], run);
+            literalStart = i + run;
+        }
+        i += run;
+    }
+    batchAppendLiteral(displayPort, col + literalStart, row, &string[literalStart], len - literalStart);
+
+    // an estimate of what the write will cost on the wire, callers use it to keep within txBytesFree()
+    return batchLen > startLen ? batchLen - startLen : 0;
+}
+
 static int heartbeat(displayPort_t *displayPort)
 {
     const uint8_t subcmd[] = { 0 };
 
+    // keep the order of the writes still waiting in the batch
+    batchFlush(displayPort);
+
     // ensure display is not released by MW OSD software
     return output(displayPort, MSP_DISPLAYPORT, subcmd, sizeof(subcmd));
 }
@@ -59,6 +157,8 @@ static int release(displayPort_t *displayPort)
 {
     const uint8_t subcmd[] = { 1 };
 
+    batchFlush(displayPort);
+
     return output(displayPort, MSP_DISPLAYPORT, subcmd, sizeof(subcmd));
 }
 
@@ -66,12 +166,17 @@ static int clearScreen(displayPort_t *displayPort)
 {
     const uint8_t subcmd[] = { 2 };
 
+    // whatever was still waiting would be cleared anyway
+    batchReset();
     return output(displayPort, MSP_DISPLAYPORT, subcmd, sizeof(subcmd));
 }
 
 static int drawScreen(displayPort_t *displayPort)
 {
-    UNUSED(displayPort);
+    // never block, the batch is sent on a later call when the port has drained
+    if (batchLen > 1 && mspSerialTxBytesFree() >= (uint32_t)(batchLen + MSP_FRAME_OVERHEAD)) {
+        return batchFlush(displayPort);
+    }
     return 0;
 }
 
@@ -90,6 +195,10 @@ static int write(displayPort_t *displayPort, uint8_t col, uint8_t row, const cha
         len = MSP_OSD_MAX_STRING_LENGTH;
     }
 
+    if (masterConfig.displayport_msp_batch) {
+        return batchWrite(displayPort, col, row, string, len);
+    }
+
     buf[0] = 3;
     buf[1] = row;
     buf[2] = col;
@@ -144,6 +253,7 @@ displayPort_t *displayPortMspInit(void)
 {
     displayInit(&mspDisplayPort, &mspDisplayPortVTable);
     resync(&mspDisplayPort);
+    batchReset();
     return &mspDisplayPort;
 }
 #endif // USE_MSP_DISPLAYPORT
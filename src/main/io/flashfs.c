@@ -27,12 +27,19 @@
  *
  * In future, we can add support for multiple different flash chips by adding a flash device driver vtable
  * and make calls through that, at the moment flashfs just calls m25p16_* routines explicitly.
+ *
+ * The last sector of the device can be kept out of the volume as an index of the logs on it, see flashfsLogBegin().
  */
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 
+#include "platform.h"
+
+#include "common/maths.h"
+
 #include "drivers/flash.h"
 #include "drivers/flash_m25p16.h"
 
@@ -40,45 +47,178 @@
 
 static uint8_t flashWriteBuffer[FLASHFS_WRITE_BUFFER_SIZE];
 
-/* The position of our head and tail in the circular flash write buffer.
+/* The circular flash write buffer is indexed by flash address modulo its size, so every flash page maps onto one
+ * contiguous run of the buffer which can be handed to the flash driver (and its DMA) in a single piece.
  *
- * The head is the index that a byte would be inserted into on writing, while the tail is the index of the
+ * The head is the address that the next byte written would be stored at, while the tail is the address of the
  * oldest byte that has yet to be written to flash.
  *
- * When the circular buffer is empty, head == tail
+ * When the circular buffer is empty, headAddress == tailAddress
  */
-static uint8_t bufferHead = 0, bufferTail = 0;
-
-// The position of the buffer's tail in the overall flash address space:
+static uint32_t headAddress = 0;
 static uint32_t tailAddress = 0;
 
+// The number of bytes at the tail that have been handed to the flash driver but may still be read from the buffer
+static uint32_t bytesInFlight = 0;
+
+#define FLASHFS_BUFFER_INDEX(address) ((address) & (FLASHFS_WRITE_BUFFER_SIZE - 1))
+
 static void flashfsClearBuffer()
 {
-    bufferTail = bufferHead = 0;
+    headAddress = tailAddress;
+    bytesInFlight = 0;
 }
 
 static bool flashfsBufferIsEmpty()
 {
-    return bufferTail == bufferHead;
+    return tailAddress == headAddress;
 }
 
 static void flashfsSetTailAddress(uint32_t address)
 {
-    tailAddress = address;
+    tailAddress = headAddress = address;
+    bytesInFlight = 0;
+}
+
+/* Sectors [eraseNextSector...eraseEndSector) are still to be erased in the background by flashfsUpdate(). The erase
+ * stays pending until the last sector's erase has finished, so eraseEndSector is zero when there is nothing to do.
+ * The range [eraseQueuedStartSector...eraseQueuedEndSector) follows it, the log index is erased ahead of the volume.
+ */
+static uint32_t eraseNextSector = 0;
+static uint32_t eraseEndSector = 0;
+static uint32_t eraseQueuedStartSector = 0;
+static uint32_t eraseQueuedEndSector = 0;
+
+// In ring mode the log wraps to the start of the device when it reaches the end, erasing the oldest sectors ahead of it
+static bool ringMode = false;
+
+// True when the log has wrapped around, so that the whole device holds log data
+static bool wrapped = false;
+
+/* The log index holds a record for each log, appended when the log begins and completed when it ends. Records are
+ * programmed in place, the end is left erased until it is known, so the index sector is only erased with the volume.
+ * The newest record is kept in RAM as well, and is programmed from flashfsUpdate() once the flash is free.
+ */
+#define FLASHFS_LOG_RECORD_MAGIC    0x474f4c46 // "FLOG"
+#define FLASHFS_LOG_OPEN            0xFFFFFFFF
+
+typedef struct flashfsLogRecord_s {
+    uint32_t magic;
+    uint32_t start;
+    uint32_t timeMs;
+    uint32_t end;           // FLASHFS_LOG_OPEN until the log has ended
+} flashfsLogRecord_t;
+
+enum {
+    LOG_INDEX_PROGRAM_RECORD = 1 << 0,
+    LOG_INDEX_PROGRAM_END = 1 << 1
+};
+
+static bool logIndexEnabled = false;
+static uint16_t logIndexCount = 0;
+static bool logIndexOpen = false;           // the newest record's log hasn't ended yet
+static uint8_t logIndexProgramPending = 0;
+static flashfsLogRecord_t logIndexRecord;
+
+static bool flashfsErasePending(void)
+{
+    return eraseEndSector > 0;
+}
+
+static bool flashfsSectorEraseIsPending(uint32_t sector)
+{
+    return sector >= eraseNextSector && sector < eraseEndSector;
+}
+
+/**
+ * Queue the sectors [startSector...endSector) to be erased in the background. Only one range can be queued at a
+ * time, returns false if another erase is still pending.
+ */
+static bool flashfsQueueErase(uint32_t startSector, uint32_t endSector)
+{
+    if (flashfsErasePending()) {
+        return false;
+    }
+
+    if (startSector < endSector) {
+        eraseNextSector = startSector;
+        eraseEndSector = endSector;
+    }
+
+    return true;
+}
+
+/**
+ * If the flash is ready, start erasing the next queued sector. This never waits for the flash.
+ */
+static void flashfsEraseNext(void)
+{
+    if (!flashfsErasePending() || !m25p16_isReady()) {
+        return;
+    }
+
+    if (eraseNextSector < eraseEndSector) {
+        m25p16_eraseSector(eraseNextSector * m25p16_getGeometry()->sectorSize);
+        eraseNextSector++;
+    } else {
+        // The erase of the final sector has finished, carry on with the range queued behind it if there is one
+        eraseNextSector = eraseQueuedStartSector;
+        eraseEndSector = eraseQueuedEndSector;
+        eraseQueuedStartSector = eraseQueuedEndSector = 0;
+    }
+}
+
+static uint32_t flashfsLogIndexSector(void)
+{
+    return m25p16_getGeometry()->sectors - 1;
+}
+
+// The sectors of the volume, the log index sector is left out
+static uint32_t flashfsVolumeSectors(void)
+{
+    return m25p16_getGeometry()->sectors - (logIndexEnabled ? 1 : 0);
 }
 
+/**
+ * Erase the volume in the background a sector at a time, which only has to cover the sectors that hold data. Writes
+ * may start straight away, they are programmed as soon as the erase has passed their sector.
+ */
 void flashfsEraseCompletely()
 {
-    m25p16_eraseCompletely();
+    const flashGeometry_t *geometry = m25p16_getGeometry();
 
-    flashfsClearBuffer();
+    if (geometry->sectorSize <= 0)
+        return;
+
+    const uint32_t used = flashfsGetOffset();
+
+    // Drop any erase in progress, the new one starts again from the first sector
+    eraseNextSector = eraseEndSector = 0;
+    eraseQueuedStartSector = eraseQueuedEndSector = 0;
+    wrapped = false;
 
     flashfsSetTailAddress(0);
+
+    if (logIndexEnabled) {
+        logIndexCount = 0;
+        logIndexOpen = false;
+        logIndexProgramPending = 0;
+
+        // The index goes first, so a log started straight after the erase only waits one sector erase for its record
+        flashfsQueueErase(flashfsLogIndexSector(), flashfsLogIndexSector() + 1);
+        eraseQueuedStartSector = 0;
+        eraseQueuedEndSector = (used + geometry->sectorSize - 1) / geometry->sectorSize;
+        return;
+    }
+
+    flashfsEraseRange(0, used);
 }
 
 /**
  * Start and end must lie on sector boundaries, or they will be rounded out to sector boundaries such that
  * all the bytes in the range [start...end) are erased.
+ *
+ * The erase runs in the background, flashfsIsReady() returns false until it has completed.
  */
 void flashfsEraseRange(uint32_t start, uint32_t end)
 {
@@ -98,30 +238,46 @@ void flashfsEraseRange(uint32_t start, uint32_t end)
         endSector++;
     }
 
-    for (int i = startSector; i < endSector; i++) {
-        m25p16_eraseSector(i * geometry->sectorSize);
+    // Wait for an earlier erase to finish rather than lose this one
+    while (!flashfsQueueErase(startSector, endSector)) {
+        flashfsEraseNext();
     }
 }
 
+/**
+ * Get the number of bytes the background erase still has to start erasing.
+ */
+uint32_t flashfsGetEraseRemaining(void)
+{
+    return (eraseEndSector - eraseNextSector + eraseQueuedEndSector - eraseQueuedStartSector) * m25p16_getGeometry()->sectorSize;
+}
+
 /**
  * Return true if the flash is not currently occupied with an operation.
  */
 bool flashfsIsReady()
 {
-    return m25p16_isReady();
+    return !flashfsErasePending() && m25p16_isReady();
+}
+
+/**
+ * Choose whether the log wraps around to overwrite the oldest data once the device is full.
+ */
+void flashfsSetRingMode(bool enabled)
+{
+    ringMode = enabled;
 }
 
 uint32_t flashfsGetSize()
 {
-    return m25p16_getGeometry()->totalSize;
+    const flashGeometry_t *geometry = m25p16_getGeometry();
+
+    return geometry->totalSize - (logIndexEnabled ? geometry->sectorSize : 0);
 }
 
 static uint32_t flashfsTransmitBufferUsed()
 {
-    if (bufferHead >= bufferTail)
-        return bufferHead - bufferTail;
-
-    return FLASHFS_WRITE_BUFFER_SIZE - bufferTail + bufferHead;
+    return headAddress - tailAddress;
 }
 
 /**
@@ -129,7 +285,7 @@ static uint32_t flashfsTransmitBufferUsed()
  */
 uint32_t flashfsGetWriteBufferSize()
 {
-    return FLASHFS_WRITE_BUFFER_USABLE;
+    return FLASHFS_WRITE_BUFFER_SIZE;
 }
 
 /**
@@ -146,202 +302,426 @@ const flashGeometry_t* flashfsGetGeometry()
 }
 
 /**
- * Write the given buffers to flash sequentially at the current tail address, advancing the tail address after
- * each write.
- *
- * In synchronous mode, waits for the flash to become ready before writing so that every byte requested can be written.
- *
- * In asynchronous mode, if the flash is busy, then the write is aborted and the routine returns immediately.
- * In this case the returned number of bytes written will be less than the total amount requested.
+ * Returns true if the start of the sector reads as erased. Like flashfsIdentifyStartOfFreeSpace() this relies on
+ * log data never containing a run of 16 bytes of all 1 bits.
+ */
+static bool flashfsSectorIsErased(uint32_t sector)
+{
+    enum {
+        ERASED_TEST_SIZE_INTS = 4,
+        ERASED_TEST_SIZE_BYTES = ERASED_TEST_SIZE_INTS * sizeof(uint32_t)
+    };
+
+    union {
+        uint8_t bytes[ERASED_TEST_SIZE_BYTES];
+        uint32_t ints[ERASED_TEST_SIZE_INTS];
+    } testBuffer;
+
+    if (m25p16_readBytes(sector * m25p16_getGeometry()->sectorSize, testBuffer.bytes, ERASED_TEST_SIZE_BYTES) < ERASED_TEST_SIZE_BYTES) {
+        // Flash timed out, so report the sector as written which is the safe answer
+        return false;
+    }
+
+    for (int i = 0; i < ERASED_TEST_SIZE_INTS; i++) {
+        if (testBuffer.ints[i] != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Check that the sector holding `address` can be programmed. In ring mode, a sector that is entered is erased first
+ * if it still holds an old lap of the log, and the one after it is queued for erase so that it's ready in time.
  *
- * Modifies the supplied buffer pointers and sizes to reflect how many bytes remain in each of them.
+ * Returns false if programming has to wait for an erase.
+ */
+static bool flashfsPrepareSector(uint32_t address)
+{
+    const flashGeometry_t *geometry = m25p16_getGeometry();
+    const uint32_t sector = address / geometry->sectorSize;
+
+    if (flashfsSectorEraseIsPending(sector)) {
+        return false;
+    }
+
+    if (!ringMode || address % geometry->sectorSize != 0) {
+        return true;
+    }
+
+    // Reading the flash would wait for any operation in progress
+    if (!m25p16_isReady()) {
+        return false;
+    }
+
+    if (!flashfsSectorIsErased(sector)) {
+        flashfsQueueErase(sector, sector + 1);
+        return false;
+    }
+
+    const uint32_t nextSector = (sector + 1) % flashfsVolumeSectors();
+
+    if (!flashfsSectorIsErased(nextSector)) {
+        flashfsQueueErase(nextSector, nextSector + 1);
+    }
+
+    return true;
+}
+
+/**
+ * Retire the bytes of a page program once the flash driver has finished reading them from our buffer.
+ */
+static void flashfsRetireProgram()
+{
+    if (bytesInFlight > 0 && m25p16_isTransferComplete()) {
+        tailAddress += bytesInFlight;
+        bytesInFlight = 0;
+    }
+}
+
+/**
+ * If the flash is ready, start programming the buffered bytes up to the next page boundary. This never waits for
+ * the flash.
  *
- * bufferCount: the number of buffers provided
- * buffers: an array of pointers to the beginning of buffers
- * bufferSizes: an array of the sizes of those buffers
- * sync: true if we should wait for the device to be idle before writes, otherwise if the device is busy the
- *       write will be aborted and this routine will return immediately.
+ * Unless `partialPages` is set, a page is only programmed once the buffer holds all of it, so a stream of small
+ * writes costs one program operation per page rather than one per flush.
  *
- * Returns the number of bytes written
+ * Returns true if all data in the buffer has been written to the device.
  */
-static uint32_t flashfsWriteBuffers(uint8_t const **buffers, uint32_t *bufferSizes, int bufferCount, bool sync)
+static bool flashfsProgramNext(bool partialPages)
 {
-    uint32_t bytesTotal = 0;
+    flashfsRetireProgram();
 
-    int i;
+    if (bytesInFlight > 0) {
+        return false;
+    }
 
-    for (i = 0; i < bufferCount; i++) {
-        bytesTotal += bufferSizes[i];
+    if (flashfsBufferIsEmpty()) {
+        return true;
     }
 
-    if (!sync && !m25p16_isReady()) {
-        return 0;
+    // In ring mode the end of the device carries straight on at its start
+    if (ringMode && tailAddress >= flashfsGetSize()) {
+        // The buffer size divides the device size, so the bytes keep their place in the buffer
+        headAddress -= flashfsGetSize();
+        tailAddress -= flashfsGetSize();
+        wrapped = true;
     }
 
-    uint32_t bytesTotalRemaining = bytesTotal;
+    // Are we at EOF already? May as well throw away any buffered data
+    if (flashfsIsEOF()) {
+        flashfsClearBuffer();
 
-    while (bytesTotalRemaining > 0) {
-        uint32_t bytesTotalThisIteration;
-        uint32_t bytesRemainThisIteration;
+        return true;
+    }
 
-        /*
-         * Each page needs to be saved in a separate program operation, so
-         * if we would cross a page boundary, only write up to the boundary in this iteration:
-         */
-        if (tailAddress % M25P16_PAGESIZE + bytesTotalRemaining > M25P16_PAGESIZE) {
-            bytesTotalThisIteration = M25P16_PAGESIZE - tailAddress % M25P16_PAGESIZE;
-        } else {
-            bytesTotalThisIteration = bytesTotalRemaining;
-        }
+    if (!flashfsPrepareSector(tailAddress)) {
+        return false;
+    }
 
-        // Are we at EOF already? Abort.
-        if (flashfsIsEOF()) {
-            // May as well throw away any buffered data
-            flashfsClearBuffer();
+    const uint32_t pageRemaining = M25P16_PAGESIZE - tailAddress % M25P16_PAGESIZE;
+    const uint32_t bytesBuffered = flashfsTransmitBufferUsed();
 
-            break;
-        }
+    if (bytesBuffered < pageRemaining && !partialPages) {
+        return false;
+    }
 
-        m25p16_pageProgramBegin(tailAddress);
+    // The run up to a page boundary never wraps around the end of the buffer
+    const uint32_t length = bytesBuffered < pageRemaining ? bytesBuffered : pageRemaining;
 
-        bytesRemainThisIteration = bytesTotalThisIteration;
+    if (!m25p16_pageProgramStart(tailAddress, flashWriteBuffer + FLASHFS_BUFFER_INDEX(tailAddress), length)) {
+        return false;
+    }
 
-        for (i = 0; i < bufferCount; i++) {
-            if (bufferSizes[i] > 0) {
-                // Is buffer larger than our write limit? Write our limit out of it
-                if (bufferSizes[i] >= bytesRemainThisIteration) {
-                    m25p16_pageProgramContinue(buffers[i], bytesRemainThisIteration);
+    bytesInFlight = length;
 
-                    buffers[i] += bytesRemainThisIteration;
-                    bufferSizes[i] -= bytesRemainThisIteration;
+    // Without DMA the program has already been sent, so its space can be reused straight away
+    flashfsRetireProgram();
 
-                    bytesRemainThisIteration = 0;
-                    break;
-                } else {
-                    // We'll still have more to write after finishing this buffer off
-                    m25p16_pageProgramContinue(buffers[i], bufferSizes[i]);
+    return flashfsBufferIsEmpty();
+}
 
-                    bytesRemainThisIteration -= bufferSizes[i];
+/**
+ * Get the current offset of the file pointer within the volume.
+ */
+uint32_t flashfsGetOffset()
+{
+    // Once the log has wrapped around, all of the device holds data
+    if (wrapped || headAddress > flashfsGetSize()) {
+        return flashfsGetSize();
+    }
 
-                    buffers[i] += bufferSizes[i];
-                    bufferSizes[i] = 0;
-                }
-            }
+    // Dirty data in the buffer contributes to the offset
+    return headAddress;
+}
+
+static uint32_t flashfsLogIndexCapacity(void)
+{
+    return m25p16_getGeometry()->sectorSize / sizeof(flashfsLogRecord_t);
+}
+
+static uint32_t flashfsLogRecordAddress(uint32_t index)
+{
+    return flashfsLogIndexSector() * m25p16_getGeometry()->sectorSize + index * sizeof(flashfsLogRecord_t);
+}
+
+static bool flashfsReadLogRecord(uint32_t index, flashfsLogRecord_t *record)
+{
+    return m25p16_readBytes(flashfsLogRecordAddress(index), (uint8_t *)record, sizeof(*record)) == sizeof(*record);
+}
+
+/**
+ * If the flash is free, start programming the part of the newest index record that hasn't reached it yet. This never
+ * waits for the flash.
+ */
+static void flashfsLogIndexProgramNext(void)
+{
+    flashfsRetireProgram();
+
+    if (!logIndexProgramPending || bytesInFlight > 0 || !m25p16_isReady()
+        || flashfsSectorEraseIsPending(flashfsLogIndexSector())) {
+        return;
+    }
+
+    const uint32_t address = flashfsLogRecordAddress(logIndexCount - 1);
+
+    // The record is static so that a DMA program can still be reading it after we return
+    if (logIndexProgramPending & LOG_INDEX_PROGRAM_RECORD) {
+        if (m25p16_pageProgramStart(address, (const uint8_t *)&logIndexRecord, sizeof(logIndexRecord))) {
+            logIndexProgramPending &= ~LOG_INDEX_PROGRAM_RECORD;
         }
+    } else if (m25p16_pageProgramStart(address + offsetof(flashfsLogRecord_t, end), (const uint8_t *)&logIndexRecord.end, sizeof(logIndexRecord.end))) {
+        logIndexProgramPending &= ~LOG_INDEX_PROGRAM_END;
+    }
+}
 
-        m25p16_pageProgramFinish();
+/**
+ * Append a record for a log that starts at the file pointer. No record is kept for the log if the index is full, or
+ * if the last one hasn't been programmed yet.
+ */
+void flashfsLogBegin(uint32_t timeMs)
+{
+    if (!logIndexEnabled) {
+        return;
+    }
 
-        bytesTotalRemaining -= bytesTotalThisIteration;
+    // Close a log that was never ended, so its record doesn't stay open behind the new one
+    flashfsLogEnd();
 
-        // Advance the cursor in the file system to match the bytes we wrote
-        flashfsSetTailAddress(tailAddress + bytesTotalThisIteration);
+    if (logIndexProgramPending || logIndexCount >= flashfsLogIndexCapacity()) {
+        return;
+    }
 
-        /*
-         * We'll have to wait for that write to complete before we can issue the next one, so if
-         * the user requested asynchronous writes, break now.
-         */
-        if (!sync)
-            break;
+    logIndexRecord.magic = FLASHFS_LOG_RECORD_MAGIC;
+    logIndexRecord.start = headAddress % flashfsGetSize();
+    logIndexRecord.timeMs = timeMs;
+    logIndexRecord.end = FLASHFS_LOG_OPEN;
+
+    logIndexCount++;
+    logIndexOpen = true;
+    logIndexProgramPending = LOG_INDEX_PROGRAM_RECORD;
+
+    flashfsLogIndexProgramNext();
+}
+
+/**
+ * Complete the record of the log in progress with the end of the data written so far. Does nothing if there is none.
+ */
+void flashfsLogEnd(void)
+{
+    if (!logIndexOpen) {
+        return;
     }
 
-    return bytesTotal - bytesTotalRemaining;
+    // Once the device is full, the data that has been dropped doesn't count
+    logIndexRecord.end = ringMode ? headAddress % flashfsGetSize() : MIN(headAddress, flashfsGetSize());
+    logIndexOpen = false;
+
+    // The end goes with the rest of the record if that hasn't been programmed yet
+    if (!(logIndexProgramPending & LOG_INDEX_PROGRAM_RECORD)) {
+        logIndexProgramPending |= LOG_INDEX_PROGRAM_END;
+    }
+
+    flashfsLogIndexProgramNext();
 }
 
-/*
- * Since the buffered data might wrap around the end of the circular buffer, we can have two segments of data to write,
- * an initial portion and a possible wrapped portion.
- *
- * This routine will fill the details of those buffers into the provided arrays, which must be at least 2 elements long.
+/**
+ * Find the records in the index sector. The records are appended in order, so the first erased slot is found with a
+ * binary search. The index is only used if the sector holds nothing else: a sector written by firmware which didn't
+ * keep an index is left in the volume until it has been erased.
  */
-static void flashfsGetDirtyDataBuffers(uint8_t const *buffers[], uint32_t bufferSizes[])
+static void flashfsLogIndexInit(void)
 {
-    buffers[0] = flashWriteBuffer + bufferTail;
-    buffers[1] = flashWriteBuffer + 0;
+    flashfsLogRecord_t record;
 
-    if (bufferHead >= bufferTail) {
-        bufferSizes[0] = bufferHead - bufferTail;
-        bufferSizes[1] = 0;
-    } else {
-        bufferSizes[0] = FLASHFS_WRITE_BUFFER_SIZE - bufferTail;
-        bufferSizes[1] = bufferHead;
+    logIndexEnabled = false;
+    logIndexCount = 0;
+    logIndexOpen = false;
+    logIndexProgramPending = 0;
+
+    if (m25p16_getGeometry()->sectors < 2 || !flashfsReadLogRecord(0, &record)) {
+        return;
+    }
+
+    if (record.magic != FLASHFS_LOG_RECORD_MAGIC) {
+        logIndexEnabled = flashfsSectorIsErased(flashfsLogIndexSector());
+        return;
+    }
+
+    uint32_t left = 1; // The first slot that may be erased
+    uint32_t right = flashfsLogIndexCapacity();
+
+    while (left < right) {
+        const uint32_t mid = (left + right) / 2;
+
+        if (!flashfsReadLogRecord(mid, &record)) {
+            return;
+        }
+
+        if (record.magic == 0xFFFFFFFF) {
+            right = mid;
+        } else {
+            left = mid + 1;
+        }
     }
+
+    if (!flashfsReadLogRecord(left - 1, &record) || record.magic != FLASHFS_LOG_RECORD_MAGIC) {
+        return;
+    }
+
+    logIndexEnabled = true;
+    logIndexCount = left;
+    logIndexRecord = record;
+    logIndexOpen = record.end == FLASHFS_LOG_OPEN;
 }
 
 /**
- * Get the current offset of the file pointer within the volume.
+ * Get the start of the free space from the end of the newest log, which saves scanning the device for it. Returns
+ * false if the index can't tell, or if the flash doesn't read as erased there.
  */
-uint32_t flashfsGetOffset()
+static bool flashfsLogIndexFreeSpace(uint32_t *freeSpace)
 {
-    uint8_t const * buffers[2];
-    uint32_t bufferSizes[2];
+    enum {
+        FREE_TEST_SIZE_INTS = 4,
+        FREE_TEST_SIZE_BYTES = FREE_TEST_SIZE_INTS * sizeof(uint32_t)
+    };
 
-    // Dirty data in the buffers contributes to the offset
+    union {
+        uint8_t bytes[FREE_TEST_SIZE_BYTES];
+        uint32_t ints[FREE_TEST_SIZE_INTS];
+    } testBuffer;
 
-    flashfsGetDirtyDataBuffers(buffers, bufferSizes);
+    if (!logIndexEnabled || logIndexCount == 0 || logIndexOpen || logIndexRecord.end > flashfsGetSize()) {
+        return false;
+    }
+
+    if (logIndexRecord.end < flashfsGetSize()) {
+        if (m25p16_readBytes(logIndexRecord.end, testBuffer.bytes, FREE_TEST_SIZE_BYTES) < FREE_TEST_SIZE_BYTES) {
+            return false;
+        }
+
+        for (int i = 0; i < FREE_TEST_SIZE_INTS; i++) {
+            if (testBuffer.ints[i] != 0xFFFFFFFF) {
+                return false;
+            }
+        }
+    }
+
+    *freeSpace = logIndexRecord.end;
 
-    return tailAddress + bufferSizes[0] + bufferSizes[1];
+    return true;
+}
+
+int flashfsGetLogCount(void)
+{
+    return logIndexCount;
 }
 
 /**
- * Called after bytes have been written from the buffer to advance the position of the tail by the given amount.
+ * Read the index entry of the log numbered `index`, oldest first. The length of a log in progress is reported as 0.
  */
-static void flashfsAdvanceTailInBuffer(uint32_t delta)
+bool flashfsGetLog(int index, flashfsLogEntry_t *entry)
 {
-    bufferTail += delta;
+    flashfsLogRecord_t record;
 
-    // Wrap tail around the end of the buffer
-    if (bufferTail >= FLASHFS_WRITE_BUFFER_SIZE) {
-        bufferTail -= FLASHFS_WRITE_BUFFER_SIZE;
+    if (index < 0 || index >= logIndexCount) {
+        return false;
     }
 
-    if (flashfsBufferIsEmpty()) {
-        flashfsClearBuffer(); // Bring buffer pointers back to the start to be tidier
+    if (index == logIndexCount - 1) {
+        // The newest record might not have reached the flash yet
+        record = logIndexRecord;
+        if (logIndexOpen) {
+            record.end = record.start;
+        }
+    } else if (!flashfsReadLogRecord(index, &record)) {
+        return false;
     }
+
+    entry->start = record.start;
+    entry->length = (record.end + flashfsGetSize() - record.start) % flashfsGetSize();
+    entry->timeMs = record.timeMs;
+
+    return true;
 }
 
 /**
- * If the flash is ready to accept writes, flush the buffer to it.
+ * If the flash is ready to accept writes, start writing the next part of the buffer to it, including a final
+ * partially filled page.
  *
  * Returns true if all data in the buffer has been flushed to the device, or false if
  * there is still data to be written (call flush again later).
  */
 bool flashfsFlushAsync()
 {
-    if (flashfsBufferIsEmpty()) {
-        return true; // Nothing to flush
-    }
-
-    uint8_t const * buffers[2];
-    uint32_t bufferSizes[2];
-    uint32_t bytesWritten;
+    return flashfsProgramNext(true);
+}
 
-    flashfsGetDirtyDataBuffers(buffers, bufferSizes);
-    bytesWritten = flashfsWriteBuffers(buffers, bufferSizes, 2, false);
-    flashfsAdvanceTailInBuffer(bytesWritten);
+/**
+ * Program the next buffered page if it is complete and the flash is ready. Call this regularly while streaming
+ * asynchronous writes, it never waits for the flash.
+ *
+ * Returns true if all data in the buffer has been flushed to the device.
+ */
+bool flashfsFlushPages(void)
+{
+    return flashfsProgramNext(false);
+}
 
-    return flashfsBufferIsEmpty();
+/**
+ * Do the background work of the filesystem: program the next full page and move any background erase along. Never
+ * waits for the flash.
+ */
+void flashfsUpdate(void)
+{
+    // The index is only written when a log begins or ends, so it goes ahead of the log data
+    flashfsLogIndexProgramNext();
+    flashfsFlushPages();
+    flashfsEraseNext();
 }
 
 /**
- * Wait for the flash to become ready and begin flushing any buffered data to flash.
+ * Wait for the flash to become ready and write all buffered data to it.
  *
  * The flash will still be busy some time after this sync completes, but space will
  * be freed up to accept more writes in the write buffer.
  */
 void flashfsFlushSync()
 {
-    if (flashfsBufferIsEmpty()) {
-        return; // Nothing to flush
-    }
-
-    uint8_t const * buffers[2];
-    uint32_t bufferSizes[2];
-
-    flashfsGetDirtyDataBuffers(buffers, bufferSizes);
-    flashfsWriteBuffers(buffers, bufferSizes, 2, true);
+    while (!flashfsProgramNext(true)) {
+        // The data may be waiting for its sector to be erased
+        flashfsEraseNext();
+
+        // A sector erase keeps the flash busy far longer than a page program
+        if (!m25p16_waitForReady(flashfsErasePending() ? FLASHFS_ERASE_TIMEOUT_MILLIS : FLASHFS_SYNC_TIMEOUT_MILLIS)) {
+            // The flash has stopped responding, so the data can't be written anyway
+            flashfsRetireProgram();
+            flashfsClearBuffer();
 
-    // We've written our entire buffer now:
-    flashfsClearBuffer();
+            return;
+        }
+    }
 }
 
 void flashfsSeekAbs(uint32_t offset)
@@ -363,98 +743,67 @@ void flashfsSeekRel(int32_t offset)
  */
 void flashfsWriteByte(uint8_t byte)
 {
-    flashWriteBuffer[bufferHead++] = byte;
-
-    if (bufferHead >= FLASHFS_WRITE_BUFFER_SIZE) {
-        bufferHead = 0;
+    if (flashfsGetWriteBufferFreeSpace() == 0) {
+        return;
     }
 
-    if (flashfsTransmitBufferUsed() >= FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN) {
-        flashfsFlushAsync();
-    }
+    flashWriteBuffer[FLASHFS_BUFFER_INDEX(headAddress)] = byte;
+    headAddress++;
 }
 
 /**
- * Write the given buffer to the flash either synchronously or asynchronously depending on the 'sync' parameter.
- *
- * If writing asynchronously, data will be silently discarded if the buffer overflows.
- * If writing synchronously, the routine will block waiting for the flash to become ready so will never drop data.
+ * Copy as much of the given data into the buffer as will fit, returns the number of bytes taken.
  */
-void flashfsWrite(const uint8_t *data, unsigned int len, bool sync)
+static unsigned int flashfsBufferData(const uint8_t *data, unsigned int len)
 {
-    uint8_t const * buffers[3];
-    uint32_t bufferSizes[3];
+    const unsigned int freeSpace = flashfsGetWriteBufferFreeSpace();
 
-    // There could be two dirty buffers to write out already:
-    flashfsGetDirtyDataBuffers(buffers, bufferSizes);
-
-    // Plus the buffer the user supplied:
-    buffers[2] = data;
-    bufferSizes[2] = len;
+    if (len > freeSpace) {
+        len = freeSpace;
+    }
 
-    /*
-     * Would writing this data to our buffer cause our buffer to reach the flush threshold? If so try to write through
-     * to the flash now
-     */
-    if (bufferSizes[0] + bufferSizes[1] + bufferSizes[2] >= FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN) {
-        uint32_t bytesWritten;
+    // First write the portion before we wrap around the end of the circular buffer
+    const unsigned int headIndex = FLASHFS_BUFFER_INDEX(headAddress);
+    const unsigned int bufferBytesBeforeWrap = FLASHFS_WRITE_BUFFER_SIZE - headIndex;
+    const unsigned int firstPortion = len < bufferBytesBeforeWrap ? len : bufferBytesBeforeWrap;
 
-        // Attempt to write all three buffers through to the flash asynchronously
-        bytesWritten = flashfsWriteBuffers(buffers, bufferSizes, 3, false);
+    memcpy(flashWriteBuffer + headIndex, data, firstPortion);
 
-        if (bufferSizes[0] == 0 && bufferSizes[1] == 0) {
-            // We wrote all the data that was previously buffered
-            flashfsClearBuffer();
+    // Then the remainder at the start of the buffer (if any)
+    memcpy(flashWriteBuffer, data + firstPortion, len - firstPortion);
 
-            if (bufferSizes[2] == 0) {
-                // And we wrote all the data the user supplied! Job done!
-                return;
-            }
-        } else {
-            // We only wrote a portion of the old data, so advance the tail to remove the bytes we did write from the buffer
-            flashfsAdvanceTailInBuffer(bytesWritten);
-        }
+    headAddress += len;
 
-        // Is the remainder of the data to be written too big to fit in the buffers?
-        if (bufferSizes[0] + bufferSizes[1] + bufferSizes[2] > FLASHFS_WRITE_BUFFER_USABLE) {
-            if (sync) {
-                // Write it through synchronously
-                flashfsWriteBuffers(buffers, bufferSizes, 3, true);
-                flashfsClearBuffer();
-            } else {
-                /*
-                 * Silently drop the data the user asked to write (i.e. no-op) since we can't buffer it and they
-                 * requested async.
-                 */
-            }
+    return len;
+}
 
-            return;
+/**
+ * Write the given buffer to the flash either synchronously or asynchronously depending on the 'sync' parameter.
+ *
+ * Asynchronous writes only fill the buffer, the pages are programmed later by flashfsFlushPages(). Data will be
+ * silently discarded if it doesn't fit in the buffer.
+ *
+ * If writing synchronously, the routine will block waiting for the flash to become ready so will never drop data.
+ */
+void flashfsWrite(const uint8_t *data, unsigned int len, bool sync)
+{
+    if (!sync) {
+        if (len <= flashfsGetWriteBufferFreeSpace()) {
+            flashfsBufferData(data, len);
         }
 
-        // Fall through and add the remainder of the incoming data to our buffer
-        data = buffers[2];
-        len = bufferSizes[2];
+        return;
     }
 
-    // Buffer up the data the user supplied instead of writing it right away
+    while (len > 0) {
+        const unsigned int written = flashfsBufferData(data, len);
 
-    // First write the portion before we wrap around the end of the circular buffer
-    unsigned int bufferBytesBeforeWrap = FLASHFS_WRITE_BUFFER_SIZE - bufferHead;
-
-    unsigned int firstPortion = len < bufferBytesBeforeWrap ? len : bufferBytesBeforeWrap;
-
-    memcpy(flashWriteBuffer + bufferHead, data, firstPortion);
-
-    bufferHead += firstPortion;
-
-    data += firstPortion;
-    len -= firstPortion;
+        data += written;
+        len -= written;
 
-    // If we wrap the head around, write the remainder to the start of the buffer (if any)
-    if (bufferHead == FLASHFS_WRITE_BUFFER_SIZE) {
-        memcpy(flashWriteBuffer + 0, data, len);
-
-        bufferHead = len;
+        if (len > 0) {
+            flashfsFlushSync();
+        }
     }
 }
 
@@ -481,6 +830,23 @@ int flashfsReadAbs(uint32_t address, uint8_t *buffer, unsigned int len)
     return bytesRead;
 }
 
+/**
+ * Find the first sector from `start` onwards whose start reads as `erased`, or the sector count if there is none.
+ */
+static uint32_t flashfsFindSector(uint32_t start, bool erased)
+{
+    const uint32_t sectors = flashfsVolumeSectors();
+    uint32_t sector;
+
+    for (sector = start; sector < sectors; sector++) {
+        if (flashfsSectorIsErased(sector) == erased) {
+            break;
+        }
+    }
+
+    return sector;
+}
+
 /**
  * Find the offset of the start of the free space on the device (or the size of the device if it is full).
  */
@@ -493,6 +859,10 @@ int flashfsIdentifyStartOfFreeSpace()
      * To do better we might write a volume header instead, which would mark how much free space remains. But keeping
      * a header up to date while logging would incur more writes to the flash, which would consume precious write
      * bandwidth and block more often.
+     *
+     * A ring mode log that has wrapped around is followed by the erased sector ahead of it and then by the oldest
+     * data, so the free space isn't always at the end of the device. The starts of the sectors are scanned for the
+     * first one that is erased, then the free space must begin in the sector before it.
      */
 
     enum {
@@ -511,8 +881,11 @@ int flashfsIdentifyStartOfFreeSpace()
         uint32_t ints[FREE_BLOCK_TEST_SIZE_INTS];
     } testBuffer;
 
-    int left = 0; // Smallest block index in the search region
-    int right = flashfsGetSize() / FREE_BLOCK_SIZE; // One past the largest block index in the search region
+    const uint32_t sectorSize = m25p16_getGeometry()->sectorSize;
+    const uint32_t freeSector = flashfsFindSector(0, true);
+
+    int left = freeSector > 0 ? (freeSector - 1) * sectorSize / FREE_BLOCK_SIZE : 0; // Smallest block index in the search region
+    int right = freeSector * sectorSize / FREE_BLOCK_SIZE; // One past the largest block index in the search region
     int mid;
     int result = right;
     int i;
@@ -554,7 +927,12 @@ int flashfsIdentifyStartOfFreeSpace()
  * Returns true if the file pointer is at the end of the device.
  */
 bool flashfsIsEOF() {
-    return tailAddress >= flashfsGetSize();
+    if (ringMode) {
+        return false;
+    }
+
+    // A log that wrapped around leaves no free space behind it
+    return wrapped || tailAddress >= flashfsGetSize();
 }
 
 /**
@@ -564,7 +942,23 @@ void flashfsInit()
 {
     // If we have a flash chip present at all
     if (flashfsGetSize() > 0) {
+        flashfsLogIndexInit();
+
+        // The end of the last log in the index is where the free space starts, unless that log never ended
+        uint32_t freeSpace;
+        if (!flashfsLogIndexFreeSpace(&freeSpace)) {
+            freeSpace = flashfsIdentifyStartOfFreeSpace();
+        }
+
+        // Data beyond the erased sector after the free space is the oldest part of a log that wrapped around
+        wrapped = flashfsFindSector(freeSpace / m25p16_getGeometry()->sectorSize + 1, false) < flashfsVolumeSectors();
+
         // Start the file pointer off at the beginning of free space so caller can start writing immediately
-        flashfsSeekAbs(flashfsIdentifyStartOfFreeSpace());
+        flashfsSeekAbs(freeSpace);
+
+        // A log cut short by a power loss is closed where its data stops
+        if (logIndexOpen) {
+            flashfsLogEnd();
+        }
     }
 }
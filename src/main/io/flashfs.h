@@ -17,14 +17,20 @@
 
 #pragma once
 
-#define FLASHFS_WRITE_BUFFER_SIZE 128
-#define FLASHFS_WRITE_BUFFER_USABLE (FLASHFS_WRITE_BUFFER_SIZE - 1)
+// Whole flash pages are queued in the write buffer, so its size must be a power of two multiple of the page size
+#ifndef FLASHFS_WRITE_BUFFER_SIZE
+#define FLASHFS_WRITE_BUFFER_SIZE (2 * M25P16_PAGESIZE)
+#endif
 
-// Automatically trigger a flush when this much data is in the buffer
-#define FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN 64
+// Give up on a synchronous flush if the flash stays busy for this long
+#define FLASHFS_SYNC_TIMEOUT_MILLIS 10
+// ...or this long while it is erasing a sector
+#define FLASHFS_ERASE_TIMEOUT_MILLIS 5000
 
 void flashfsEraseCompletely();
 void flashfsEraseRange(uint32_t start, uint32_t end);
+uint32_t flashfsGetEraseRemaining(void);
+void flashfsSetRingMode(bool enabled);
 
 uint32_t flashfsGetSize();
 uint32_t flashfsGetOffset();
@@ -43,9 +49,22 @@ void flashfsWrite(const uint8_t *data, unsigned int len, bool sync);
 int flashfsReadAbs(uint32_t offset, uint8_t *data, unsigned int len);
 
 bool flashfsFlushAsync();
+bool flashfsFlushPages(void);
 void flashfsFlushSync();
+void flashfsUpdate(void);
 
 void flashfsInit();
 
+typedef struct flashfsLogEntry_s {
+    uint32_t start;         // offset of the log in the volume
+    uint32_t length;        // bytes, the log carries on round the end of the volume in ring mode
+    uint32_t timeMs;        // time since boot that the log began
+} flashfsLogEntry_t;
+
+void flashfsLogBegin(uint32_t timeMs);
+void flashfsLogEnd(void);
+int flashfsGetLogCount(void);
+bool flashfsGetLog(int index, flashfsLogEntry_t *entry);
+
 bool flashfsIsReady();
 bool flashfsIsEOF();
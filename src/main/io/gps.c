@@ -17,6 +17,7 @@
 
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <ctype.h>
 #include <string.h>
@@ -61,6 +62,7 @@
 #define LOG_UBLOX_SVINFO 'I'
 #define LOG_UBLOX_POSLLH 'P'
 #define LOG_UBLOX_VELNED 'V'
+#define LOG_UBLOX_PVT    'F'
 
 #define GPS_SV_MAXSATS   16
 
@@ -94,6 +96,8 @@ static gpsConfig_t *gpsConfig;
 // How many entries in gpsInitData array below
 #define GPS_INIT_ENTRIES (GPS_BAUDRATE_MAX + 1)
 #define GPS_BAUDRATE_CHANGE_DELAY (200)
+// satellite info is only decoded, and on a u-blox only sent, for this long after a consumer last asked for it
+#define GPS_SV_INFO_REQUEST_TIMEOUT (5000)
 
 static serialConfig_t *serialConfig;
 static serialPort_t *gpsPort;
@@ -107,6 +111,8 @@ typedef struct gpsInitData_s {
 
 // NMEA will cycle through these until valid data is received
 static const gpsInitData_t gpsInitData[] = {
+    { GPS_BAUDRATE_460800,  BAUD_460800, "$PUBX,41,1,0003,0001,460800,0*13\r\n", "" },
+    { GPS_BAUDRATE_230400,  BAUD_230400, "$PUBX,41,1,0003,0001,230400,0*1C\r\n", "" },
     { GPS_BAUDRATE_115200,  BAUD_115200, "$PUBX,41,1,0003,0001,115200,0*1E\r\n", "$PMTK251,115200*1F\r\n" },
     { GPS_BAUDRATE_57600,    BAUD_57600, "$PUBX,41,1,0003,0001,57600,0*2D\r\n", "$PMTK251,57600*2C\r\n" },
     { GPS_BAUDRATE_38400,    BAUD_38400, "$PUBX,41,1,0003,0001,38400,0*26\r\n", "$PMTK251,38400*27\r\n" },
@@ -117,7 +123,7 @@ static const gpsInitData_t gpsInitData[] = {
 
 #define GPS_INIT_DATA_ENTRY_COUNT (sizeof(gpsInitData) / sizeof(gpsInitData[0]))
 
-#define DEFAULT_BAUD_RATE_INDEX 0
+#define DEFAULT_BAUD_RATE_INDEX GPS_BAUDRATE_115200
 
 static const uint8_t ubloxInit[] = {
 
@@ -133,16 +139,44 @@ static const uint8_t ubloxInit[] = {
     0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0xF0, 0x00, 0x00, 0xFA, 0x0F,           // GGA: Global positioning system fix data
     0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0xF0, 0x02, 0x00, 0xFC, 0x13,           // GSA: GNSS DOP and Active Satellites
     0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0xF0, 0x04, 0x00, 0xFE, 0x17,           // RMC: Recommended Minimum data
+};
 
-    // Enable UBLOX messages
+// Enable UBLOX messages, the ones of the other message set are turned off in case the receiver kept them
+static const uint8_t ubloxNavLegacy[] = {
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x07, 0x00, 0x12, 0x50,           // disable PVT
     0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x02, 0x01, 0x0E, 0x47,           // set POSLLH MSG rate
     0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x03, 0x01, 0x0F, 0x49,           // set STATUS MSG rate
     0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x06, 0x01, 0x12, 0x4F,           // set SOL MSG rate
-    //0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x30, 0x01, 0x3C, 0xA3,           // set SVINFO MSG rate (every cycle - high bandwidth)
-    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x30, 0x05, 0x40, 0xA7,           // set SVINFO MSG rate (evey 5 cycles - low bandwidth)
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x30, 0x00, 0x3B, 0xA2,           // disable SVINFO, see gpsUpdateSvInfoMessage()
     0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x12, 0x01, 0x1E, 0x67,           // set VELNED MSG rate
+};
 
-    0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0xC8, 0x00, 0x01, 0x00, 0x01, 0x00, 0xDE, 0x6A,             // set rate to 5Hz (measurement period: 200ms, navigation rate: 1 cycle)
+// NAV-PVT carries position, velocity, fix and satellite count in one 100 byte frame, against some 200 for the set above
+static const uint8_t ubloxNavPvt[] = {
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x02, 0x00, 0x0D, 0x46,           // disable POSLLH
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x03, 0x00, 0x0E, 0x48,           // disable STATUS
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x06, 0x00, 0x11, 0x4E,           // disable SOL
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x30, 0x00, 0x3B, 0xA2,           // disable SVINFO
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x12, 0x00, 0x1D, 0x66,           // disable VELNED
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x07, 0x01, 0x13, 0x51,           // set PVT MSG rate
+};
+
+// NAV-SVINFO is only turned on while something reads the satellite info, it is the largest message by far
+#define UBLOX_SVINFO_MESSAGE_LENGTH 11
+static const uint8_t ubloxSvInfoEnable[UBLOX_SVINFO_MESSAGE_LENGTH] = {
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x30, 0x05, 0x40, 0xA7            // set SVINFO MSG rate (every 5 cycles - low bandwidth)
+};
+static const uint8_t ubloxSvInfoDisable[UBLOX_SVINFO_MESSAGE_LENGTH] = {
+    0xB5, 0x62, 0x06, 0x01, 0x03, 0x00, 0x01, 0x30, 0x00, 0x3B, 0xA2            // disable SVINFO
+};
+
+#define UBLOX_RATE_MESSAGE_LENGTH 14
+// Note: these must be defined in the same order as gpsUbloxNavRate_e since no lookup table is used.
+static const uint8_t ubloxRate[][UBLOX_RATE_MESSAGE_LENGTH] = {
+    { 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0xC8, 0x00, 0x01, 0x00, 0x01, 0x00, 0xDE, 0x6A },    // 5Hz (measurement period: 200ms, navigation rate: 1 cycle)
+    { 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x64, 0x00, 0x01, 0x00, 0x01, 0x00, 0x7A, 0x12 },    // 10Hz (100ms)
+    { 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x37, 0x00, 0x01, 0x00, 0x01, 0x00, 0x4D, 0x04 },    // 18Hz (55ms)
+    { 0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0x28, 0x00, 0x01, 0x00, 0x01, 0x00, 0x3E, 0xAA },    // 25Hz (40ms)
 };
 
 // UBlox 6 Protocol documentation - GPS.G6-SW-10018-F
@@ -180,6 +214,10 @@ typedef enum {
 
 gpsData_t gpsData;
 
+static uint32_t svInfoRequestedAt;
+static bool svInfoRequested;
+static bool svInfoEnabled;              // NAV-SVINFO has been turned on in the receiver
+
 
 static void shiftPacketLog(void)
 {
@@ -200,6 +238,33 @@ static void gpsSetState(gpsState_e state)
     gpsData.state_position = 0;
     gpsData.state_ts = millis();
     gpsData.messageState = GPS_MESSAGE_STATE_IDLE;
+    // configuring the receiver turns NAV-SVINFO off again
+    svInfoEnabled = false;
+}
+
+void gpsRequestSvInfo(void)
+{
+    svInfoRequestedAt = millis();
+    svInfoRequested = true;
+}
+
+// drops the satellite info once nobody reads it, and on a u-blox turns NAV-SVINFO on and off to follow the requests,
+// a receiver that isn't configured by us is left alone
+static void gpsUpdateSvInfoMessage(void)
+{
+    if (svInfoRequested && millis() - svInfoRequestedAt > GPS_SV_INFO_REQUEST_TIMEOUT) {
+        svInfoRequested = false;
+        GPS_numCh = 0;
+    }
+
+    if (gpsConfig->provider != GPS_UBLOX || gpsConfig->autoConfig == GPS_AUTOCONFIG_OFF) {
+        return;
+    }
+    if (svInfoRequested == svInfoEnabled || serialTxBytesFree(gpsPort) < UBLOX_SVINFO_MESSAGE_LENGTH) {
+        return;
+    }
+    serialWriteBuf(gpsPort, svInfoRequested ? ubloxSvInfoEnable : ubloxSvInfoDisable, UBLOX_SVINFO_MESSAGE_LENGTH);
+    svInfoEnabled = svInfoRequested;
 }
 
 void gpsInit(serialConfig_t *initialSerialConfig, gpsConfig_t *initialGpsConfig)
@@ -365,6 +430,30 @@ void gpsInitUblox(void)
                 }
             }
 
+            if (gpsData.messageState == GPS_MESSAGE_STATE_NAV) {
+                const bool pvt = gpsConfig->ubloxNavRate != GPS_UBLOX_NAV_RATE_5HZ;
+                const uint8_t *messages = pvt ? ubloxNavPvt : ubloxNavLegacy;
+                const uint32_t length = pvt ? sizeof(ubloxNavPvt) : sizeof(ubloxNavLegacy);
+
+                if (gpsData.state_position < length) {
+                    serialWrite(gpsPort, messages[gpsData.state_position]);
+                    gpsData.state_position++;
+                } else {
+                    gpsData.state_position = 0;
+                    gpsData.messageState++;
+                }
+            }
+
+            if (gpsData.messageState == GPS_MESSAGE_STATE_RATE) {
+                if (gpsData.state_position < UBLOX_RATE_MESSAGE_LENGTH) {
+                    serialWrite(gpsPort, ubloxRate[gpsConfig->ubloxNavRate][gpsData.state_position]);
+                    gpsData.state_position++;
+                } else {
+                    gpsData.state_position = 0;
+                    gpsData.messageState++;
+                }
+            }
+
             if (gpsData.messageState == GPS_MESSAGE_STATE_SBAS) {
                 if (gpsData.state_position < UBLOX_SBAS_MESSAGE_LENGTH) {
                     serialWrite(gpsPort, ubloxSbas[gpsConfig->sbasMode].message[gpsData.state_position]);
@@ -442,7 +531,9 @@ void gpsUpdate(timeUs_t currentTimeUs)
                 // remove GPS from capability
                 sensorsClear(SENSOR_GPS);
                 gpsSetState(GPS_LOST_COMMUNICATION);
+                break;
             }
+            gpsUpdateSvInfoMessage();
             break;
     }
     if (sensors(SENSOR_GPS)) {
@@ -653,6 +744,9 @@ static bool gpsNewFrameNMEA(char c)
                     }
                     break;
                 case FRAME_GSV:
+                    // an NMEA receiver always sends these, they are only decoded while someone reads them
+                    if (!svInfoRequested)
+                        break;
                     switch(param) {
                       /*case 1:
                             // Total number of messages of this type in this cycle
@@ -808,6 +902,39 @@ typedef struct {
     uint32_t heading_accuracy;
 } ubx_nav_velned;
 
+// the u-blox 7 layout, u-blox 8 appends heading of vehicle and magnetic declination
+typedef struct {
+    uint32_t time;              // GPS msToW
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;
+    uint32_t time_accuracy;
+    int32_t time_nsec;
+    uint8_t fix_type;
+    uint8_t fix_status;
+    uint8_t fix_status2;
+    uint8_t satellites;
+    int32_t longitude;
+    int32_t latitude;
+    int32_t altitude_ellipsoid;
+    int32_t altitude_msl;
+    uint32_t horizontal_accuracy;
+    uint32_t vertical_accuracy;
+    int32_t ned_north;          // mm/s
+    int32_t ned_east;
+    int32_t ned_down;
+    int32_t speed_2d;           // mm/s
+    int32_t heading_2d;         // deg * 100000
+    uint32_t speed_accuracy;
+    uint32_t heading_accuracy;
+    uint16_t position_DOP;
+    uint8_t reserved[6];
+} ubx_nav_pvt;
+
 typedef struct {
     uint8_t chn;                // Channel number, 255 for SVx not assigned to channel
     uint8_t svid;               // Satellite ID
@@ -838,6 +965,7 @@ enum {
     MSG_POSLLH = 0x2,
     MSG_STATUS = 0x3,
     MSG_SOL = 0x6,
+    MSG_PVT = 0x7,
     MSG_VELNED = 0x12,
     MSG_SVINFO = 0x30,
     MSG_CFG_PRT = 0x00,
@@ -902,11 +1030,12 @@ static union {
     ubx_nav_status status;
     ubx_nav_solution solution;
     ubx_nav_velned velned;
+    ubx_nav_pvt pvt;
     ubx_nav_svinfo svinfo;
     uint8_t bytes[UBLOX_PAYLOAD_SIZE];
 } _buffer;
 
-void _update_checksum(uint8_t *data, uint8_t len, uint8_t *ck_a, uint8_t *ck_b)
+static void _update_checksum(const uint8_t *data, uint16_t len, uint8_t *ck_a, uint8_t *ck_b)
 {
     while (len--) {
         *ck_a += *data;
@@ -922,8 +1051,11 @@ static bool UBLOX_parse_gps(void)
 
     *gpsPacketLogChar = LOG_IGNORED;
 
+    // the payload is read in place, a message shorter than its struct (e.g. from another protocol version) is ignored
     switch (_msg_id) {
     case MSG_POSLLH:
+        if (_payload_length < sizeof(ubx_nav_posllh))
+            return false;
         *gpsPacketLogChar = LOG_UBLOX_POSLLH;
         //i2c_dataset.time                = _buffer.posllh.time;
         GPS_coord[LON] = _buffer.posllh.longitude;
@@ -937,12 +1069,16 @@ static bool UBLOX_parse_gps(void)
         _new_position = true;
         break;
     case MSG_STATUS:
+        if (_payload_length < sizeof(ubx_nav_status))
+            return false;
         *gpsPacketLogChar = LOG_UBLOX_STATUS;
         next_fix = (_buffer.status.fix_status & NAV_STATUS_FIX_VALID) && (_buffer.status.fix_type == FIX_3D);
         if (!next_fix)
             DISABLE_STATE(GPS_FIX);
         break;
     case MSG_SOL:
+        if (_payload_length < sizeof(ubx_nav_solution))
+            return false;
         *gpsPacketLogChar = LOG_UBLOX_SOL;
         next_fix = (_buffer.solution.fix_status & NAV_STATUS_FIX_VALID) && (_buffer.solution.fix_type == FIX_3D);
         if (!next_fix)
@@ -951,17 +1087,46 @@ static bool UBLOX_parse_gps(void)
         GPS_hdop = _buffer.solution.position_DOP;
         break;
     case MSG_VELNED:
+        if (_payload_length < sizeof(ubx_nav_velned))
+            return false;
         *gpsPacketLogChar = LOG_UBLOX_VELNED;
         // speed_3d                        = _buffer.velned.speed_3d;  // cm/s
         GPS_speed = _buffer.velned.speed_2d;    // cm/s
         GPS_ground_course = (uint16_t) (_buffer.velned.heading_2d / 10000);     // Heading 2D deg * 100000 rescaled to deg * 10
         _new_speed = true;
         break;
+    case MSG_PVT:
+        if (_payload_length < sizeof(ubx_nav_pvt))
+            return false;
+        *gpsPacketLogChar = LOG_UBLOX_PVT;
+        // a whole solution in one message, so it is complete on its own
+        next_fix = (_buffer.pvt.fix_status & NAV_STATUS_FIX_VALID) && (_buffer.pvt.fix_type == FIX_3D);
+        if (next_fix) {
+            ENABLE_STATE(GPS_FIX);
+        } else {
+            DISABLE_STATE(GPS_FIX);
+        }
+        GPS_coord[LON] = _buffer.pvt.longitude;
+        GPS_coord[LAT] = _buffer.pvt.latitude;
+        GPS_altitude = _buffer.pvt.altitude_msl / 10 / 100;  //alt in m
+        GPS_numSat = _buffer.pvt.satellites;
+        GPS_hdop = _buffer.pvt.position_DOP;
+        GPS_speed = _buffer.pvt.speed_2d / 10;    // cm/s
+        GPS_ground_course = (uint16_t) (_buffer.pvt.heading_2d / 10000);     // Heading 2D deg * 100000 rescaled to deg * 10
+        _new_position = true;
+        _new_speed = true;
+        break;
     case MSG_SVINFO:
+        // the receiver may still send a few after it has been told to stop
+        if (!svInfoRequested || _payload_length < offsetof(ubx_nav_svinfo, channel))
+            return false;
         *gpsPacketLogChar = LOG_UBLOX_SVINFO;
         GPS_numCh = _buffer.svinfo.numCh;
         if (GPS_numCh > 16)
             GPS_numCh = 16;
+        // only the channels that came with the message
+        if (GPS_numCh > (_payload_length - offsetof(ubx_nav_svinfo, channel)) / sizeof(ubx_nav_svinfo_channel))
+            GPS_numCh = (_payload_length - offsetof(ubx_nav_svinfo, channel)) / sizeof(ubx_nav_svinfo_channel);
         for (i = 0; i < GPS_numCh; i++){
             GPS_svinfo_chn[i]= _buffer.svinfo.channel[i].chn;
             GPS_svinfo_svid[i]= _buffer.svinfo.channel[i].svid;
@@ -1029,8 +1194,10 @@ static bool gpsNewFrameUBLOX(uint8_t data)
             }
             break;
         case 6:
-            _ck_b += (_ck_a += data);       // checksum byte
-            if (_payload_counter < UBLOX_PAYLOAD_SIZE) {
+            // a payload that fits is only stored, its checksum is taken over the buffer in one go once it is in
+            if (_skip_packet) {
+                _ck_b += (_ck_a += data);       // checksum byte
+            } else {
                 _buffer.bytes[_payload_counter] = data;
             }
             if (++_payload_counter >= _payload_length) {
@@ -1039,6 +1206,9 @@ static bool gpsNewFrameUBLOX(uint8_t data)
             break;
         case 7:
             _step++;
+            if (!_skip_packet) {
+                _update_checksum(_buffer.bytes, _payload_length, &_ck_a, &_ck_b);
+            }
             if (_ck_a != data) {
                 _skip_packet = true;          // bad checksum
                 gpsData.errors++;
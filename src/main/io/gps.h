@@ -42,7 +42,9 @@ typedef enum {
 #define SBAS_MODE_MAX SBAS_GAGAN
 
 typedef enum {
-    GPS_BAUDRATE_115200 = 0,
+    GPS_BAUDRATE_460800 = 0,
+    GPS_BAUDRATE_230400,
+    GPS_BAUDRATE_115200,
     GPS_BAUDRATE_57600,
     GPS_BAUDRATE_38400,
     GPS_BAUDRATE_19200,
@@ -61,11 +63,21 @@ typedef enum {
 
 #define GPS_BAUDRATE_MAX GPS_BAUDRATE_9600
 
+typedef enum {
+    GPS_UBLOX_NAV_RATE_5HZ = 0,     // POSLLH, STATUS, SOL, VELNED and SVINFO, any u-blox 6 or later
+    GPS_UBLOX_NAV_RATE_10HZ,        // NAV-PVT only from here on, u-blox 7 or later
+    GPS_UBLOX_NAV_RATE_18HZ,
+    GPS_UBLOX_NAV_RATE_25HZ         // u-blox 8 in GPS only mode
+} gpsUbloxNavRate_e;
+
+#define GPS_UBLOX_NAV_RATE_MAX GPS_UBLOX_NAV_RATE_25HZ
+
 typedef struct gpsConfig_s {
     gpsProvider_e provider;
     sbasMode_e sbasMode;
     gpsAutoConfig_e autoConfig;
     gpsAutoBaud_e autoBaud;
+    gpsUbloxNavRate_e ubloxNavRate;
 } gpsConfig_t;
 
 typedef struct gpsCoordinateDDDMMmmmm_s {
@@ -77,6 +89,8 @@ typedef struct gpsCoordinateDDDMMmmmm_s {
 typedef enum {
     GPS_MESSAGE_STATE_IDLE = 0,
     GPS_MESSAGE_STATE_INIT,
+    GPS_MESSAGE_STATE_NAV,
+    GPS_MESSAGE_STATE_RATE,
     GPS_MESSAGE_STATE_SBAS,
 	GPS_MESSAGE_STATE_ENTRY_COUNT
 } gpsMessageState_e;
@@ -123,4 +137,6 @@ void gpsUpdate(timeUs_t currentTimeUs);
 bool gpsNewFrame(uint8_t c);
 struct serialPort_s;
 void gpsEnablePassthrough(struct serialPort_s *gpsPassthroughPort);
+// the GPS_svinfo arrays are only kept up to date for a few seconds after this, their readers call it each time
+void gpsRequestSvInfo(void);
 
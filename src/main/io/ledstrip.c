@@ -147,6 +147,22 @@ STATIC_UNIT_TESTED uint8_t lowestXValueForEast;
 
 STATIC_UNIT_TESTED ledCounts_t ledCounts;
 
+// LEDs each timed layer touches, one bit per LED, worked out by reevaluateLedConfig() so updates skip the flag tests
+typedef enum {
+    LED_SET_WARNING,
+    LED_SET_BATTERY,
+    LED_SET_RSSI,
+    LED_SET_GPS,
+    LED_SET_INDICATOR,
+    LED_SET_THRUST_RING,
+    LED_SET_LARSON,
+    LED_SET_BLINK,
+    LED_SET_LANDING_FLASH,
+    LED_SET_COUNT
+} ledSetId_e;
+
+static uint32_t ledSets[LED_SET_COUNT];
+
 static const modeColorIndexes_t defaultModeColors[] = {
     //                          NORTH             EAST               SOUTH            WEST             UP          DOWN
     [LED_MODE_ORIENTATION] = {{ COLOR_WHITE,      COLOR_DARK_VIOLET, COLOR_RED,       COLOR_DEEP_PINK, COLOR_BLUE, COLOR_ORANGE }},
@@ -221,9 +237,50 @@ STATIC_UNIT_TESTED void updateLedCount(void)
     ledCounts.larson = countScanner;
 }
 
+static void updateLedSets(void)
+{
+    BUILD_BUG_ON(LED_MAX_STRIP_LENGTH > sizeof(ledSets[0]) * 8);
+
+    memset(ledSets, 0, sizeof(ledSets));
+
+    for (int ledIndex = 0; ledIndex < ledCounts.count; ledIndex++) {
+        const ledConfig_t *ledConfig = &currentLedStripConfig->ledConfigs[ledIndex];
+        const uint32_t bit = 1U << ledIndex;
+
+        switch (ledGetFunction(ledConfig)) {
+        case LED_FUNCTION_BATTERY:
+            ledSets[LED_SET_BATTERY] |= bit;
+            break;
+        case LED_FUNCTION_RSSI:
+            ledSets[LED_SET_RSSI] |= bit;
+            break;
+        case LED_FUNCTION_GPS:
+            ledSets[LED_SET_GPS] |= bit;
+            break;
+        case LED_FUNCTION_THRUST_RING:
+            ledSets[LED_SET_THRUST_RING] |= bit;
+            break;
+        default:
+            break;
+        }
+
+        if (ledGetOverlayBit(ledConfig, LED_OVERLAY_WARNING))
+            ledSets[LED_SET_WARNING] |= bit;
+        if (ledGetOverlayBit(ledConfig, LED_OVERLAY_INDICATOR))
+            ledSets[LED_SET_INDICATOR] |= bit;
+        if (ledGetOverlayBit(ledConfig, LED_OVERLAY_LARSON_SCANNER))
+            ledSets[LED_SET_LARSON] |= bit;
+        if (ledGetOverlayBit(ledConfig, LED_OVERLAY_BLINK))
+            ledSets[LED_SET_BLINK] |= bit;
+        if (ledGetOverlayBit(ledConfig, LED_OVERLAY_LANDING_FLASH))
+            ledSets[LED_SET_LANDING_FLASH] |= bit;
+    }
+}
+
 void reevaluateLedConfig(void)
 {
     updateLedCount();
+    updateLedSets();
     determineLedStripDimensions();
     determineOrientationLimits();
     updateLedRingCounts();
@@ -323,8 +380,6 @@ bool parseLedStripConfig(int ledIndex, const char *config)
 
     *ledConfig = DEFINE_LED(x, y, color, direction_flags, baseFunction, overlay_flags, 0);
 
-    reevaluateLedConfig();
-
     return true;
 }
 
@@ -503,12 +558,10 @@ static void applyLedFixedLayers()
     }
 }
 
-static void applyLedHsv(uint32_t mask, const hsvColor_t *color)
+static void applyLedHsv(uint32_t leds, const hsvColor_t *color)
 {
-    for (int ledIndex = 0; ledIndex < ledCounts.count; ledIndex++) {
-        const ledConfig_t *ledConfig = &currentLedStripConfig->ledConfigs[ledIndex];
-        if ((*ledConfig & mask) == mask)
-            setLedHsv(ledIndex, color);
+    for (; leds; leds &= leds - 1) {
+        setLedHsv(__builtin_ctz(leds), color);
     }
 }
 
@@ -560,7 +613,7 @@ static void applyLedWarningLayer(bool updateNow, timeUs_t *timer)
             }
         }
         if (warningColor)
-            applyLedHsv(LED_MOV_OVERLAY(LED_FLAG_OVERLAY(LED_OVERLAY_WARNING)), warningColor);
+            applyLedHsv(ledSets[LED_SET_WARNING], warningColor);
     }
 }
 
@@ -595,7 +648,7 @@ static void applyLedBatteryLayer(bool updateNow, timeUs_t *timer)
 
     if (!flash) {
        hsvColor_t *bgc = getSC(LED_SCOLOR_BACKGROUND);
-       applyLedHsv(LED_MOV_FUNCTION(LED_FUNCTION_BATTERY), bgc);
+       applyLedHsv(ledSets[LED_SET_BATTERY], bgc);
     }
 }
 
@@ -624,7 +677,7 @@ static void applyLedRssiLayer(bool updateNow, timeUs_t *timer)
 
     if (!flash) {
         hsvColor_t *bgc = getSC(LED_SCOLOR_BACKGROUND);
-        applyLedHsv(LED_MOV_FUNCTION(LED_FUNCTION_RSSI), bgc);
+        applyLedHsv(ledSets[LED_SET_RSSI], bgc);
     }
 }
 
@@ -662,7 +715,7 @@ static void applyLedGpsLayer(bool updateNow, timeUs_t *timer)
         }
     }
 
-    applyLedHsv(LED_MOV_FUNCTION(LED_FUNCTION_GPS), gpsColor);
+    applyLedHsv(ledSets[LED_SET_GPS], gpsColor);
 }
 
 #endif
@@ -703,12 +756,10 @@ static void applyLedIndicatorLayer(bool updateNow, timeUs_t *timer)
         quadrants |= QUADRANT_SOUTH_EAST | QUADRANT_SOUTH_WEST;
     }
 
-    for (int ledIndex = 0; ledIndex < ledCounts.count; ledIndex++) {
-        const ledConfig_t *ledConfig = &currentLedStripConfig->ledConfigs[ledIndex];
-        if (ledGetOverlayBit(ledConfig, LED_OVERLAY_INDICATOR)) {
-            if (getLedQuadrant(ledIndex) & quadrants)
-                setLedHsv(ledIndex, flashColor);
-        }
+    for (uint32_t leds = ledSets[LED_SET_INDICATOR]; leds; leds &= leds - 1) {
+        const int ledIndex = __builtin_ctz(leds);
+        if (getLedQuadrant(ledIndex) & quadrants)
+            setLedHsv(ledIndex, flashColor);
     }
 }
 
@@ -743,24 +794,23 @@ static void applyLedThrustRingLayer(bool updateNow, timeUs_t *timer)
         *timer += HZ_TO_US(5 + (45 * scaledThrottle) / 100);  // 5 - 50Hz update rate
     }
 
-    for (int ledIndex = 0; ledIndex < ledCounts.count; ledIndex++) {
+    for (uint32_t leds = ledSets[LED_SET_THRUST_RING]; leds; leds &= leds - 1) {
+        const int ledIndex = __builtin_ctz(leds);
         const ledConfig_t *ledConfig = &currentLedStripConfig->ledConfigs[ledIndex];
-        if (ledGetFunction(ledConfig) == LED_FUNCTION_THRUST_RING) {
-
-            bool applyColor;
-            if (ARMING_FLAG(ARMED)) {
-                applyColor = (ledRingIndex + rotationPhase) % ledCounts.ringSeqLen < ROTATION_SEQUENCE_LED_WIDTH;
-            } else {
-                applyColor = !(ledRingIndex % 2); // alternating pattern
-            }
 
-            if (applyColor) {
-                const hsvColor_t *ringColor = &currentLedStripConfig->colors[ledGetColor(ledConfig)];
-                setLedHsv(ledIndex, ringColor);
-            }
+        bool applyColor;
+        if (ARMING_FLAG(ARMED)) {
+            applyColor = (ledRingIndex + rotationPhase) % ledCounts.ringSeqLen < ROTATION_SEQUENCE_LED_WIDTH;
+        } else {
+            applyColor = !(ledRingIndex % 2); // alternating pattern
+        }
 
-            ledRingIndex++;
+        if (applyColor) {
+            const hsvColor_t *ringColor = &currentLedStripConfig->colors[ledGetColor(ledConfig)];
+            setLedHsv(ledIndex, ringColor);
         }
+
+        ledRingIndex++;
     }
 }
 
@@ -812,17 +862,13 @@ static void applyLarsonScannerLayer(bool updateNow, timeUs_t *timer)
     }
 
     int scannerLedIndex = 0;
-    for (unsigned i = 0; i < ledCounts.count; i++) {
-
-        const ledConfig_t *ledConfig = &ledConfigs[i];
-
-        if (ledGetOverlayBit(ledConfig, LED_OVERLAY_LARSON_SCANNER)) {
-            hsvColor_t ledColor;
-            getLedHsv(i, &ledColor);
-            ledColor.v = brightnessForLarsonIndex(&larsonParameters, scannerLedIndex);
-            setLedHsv(i, &ledColor);
-            scannerLedIndex++;
-        }
+    for (uint32_t leds = ledSets[LED_SET_LARSON]; leds; leds &= leds - 1) {
+        const int ledIndex = __builtin_ctz(leds);
+        hsvColor_t ledColor;
+        getLedHsv(ledIndex, &ledColor);
+        ledColor.v = brightnessForLarsonIndex(&larsonParameters, scannerLedIndex);
+        setLedHsv(ledIndex, &ledColor);
+        scannerLedIndex++;
     }
 }
 
@@ -842,14 +888,11 @@ static void applyLedBlinkLayer(bool updateNow, timeUs_t *timer)
 
     bool ledOn = (blinkMask & 1);  // b_b_____...
     if (!ledOn) {
-        for (int i = 0; i < ledCounts.count; ++i) {
-            const ledConfig_t *ledConfig = &ledConfigs[i];
-
-            if (ledGetOverlayBit(ledConfig, LED_OVERLAY_BLINK) ||
-                    (ledGetOverlayBit(ledConfig, LED_OVERLAY_LANDING_FLASH) && scaledThrottle < 50)) {
-                setLedHsv(i, getSC(LED_SCOLOR_BLINKBACKGROUND));
-            }
+        uint32_t leds = ledSets[LED_SET_BLINK];
+        if (scaledThrottle < 50) {
+            leds |= ledSets[LED_SET_LANDING_FLASH];
         }
+        applyLedHsv(leds, getSC(LED_SCOLOR_BLINKBACKGROUND));
     }
 }
 
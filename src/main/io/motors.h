@@ -27,6 +27,11 @@ typedef struct motorConfig_s {
     uint16_t motorPwmRate;                  // The update rate of motor outputs (50-498Hz)
     uint8_t  motorPwmProtocol;              // Pwm Protocol
     uint8_t  useUnsyncedPwm;
+    uint8_t  useBurstDshot;                 // drive all DSHOT motors on a timer from one DMA stream
+    uint8_t  useDshotTelemetry;             // bidirectional DSHOT, ESCs reply with eRPM after each frame
+    uint8_t  motorPoleCount;                // magnets on the motor bell, turns eRPM into RPM
+    uint8_t  useSyncedOutput;               // start OneShot and MultiShot pulses in the gyro data ready interrupt
+    uint8_t  thrustLinearization;           // percent of the thrust curve that is quadratic in the command, 0 disables the compensation
     float    digitalIdleOffsetPercent;
     ioTag_t  ioTags[MAX_SUPPORTED_MOTORS];
 } motorConfig_t;
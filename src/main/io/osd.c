@@ -32,6 +32,7 @@
 #ifdef OSD
 
 #include "build/debug.h"
+#include "build/profile.h"
 #include "build/version.h"
 
 #include "common/printf.h"
@@ -39,6 +40,7 @@
 
 #include "drivers/max7456_symbols.h"
 #include "drivers/display.h"
+#include "drivers/sdcard.h"
 #include "drivers/system.h"
 #ifdef USE_RTC6705
 #include "drivers/vtx_soft_spi_rtc6705.h"
@@ -48,6 +50,7 @@
 #include "cms/cms_types.h"
 #include "cms/cms_menu_osd.h"
 
+#include "io/asyncfatfs/asyncfatfs.h"
 #include "io/flashfs.h"
 #include "io/osd.h"
 
@@ -55,6 +58,7 @@
 
 
 #include "fc/config.h"
+#include "fc/loop_rate.h"
 #include "fc/rc_controls.h"
 #include "fc/runtime_config.h"
 
@@ -62,6 +66,11 @@
 #include "config/config_master.h"
 #include "config/feature.h"
 
+#include "scheduler/scheduler.h"
+
+#include "sensors/esc_sensor.h"
+#include "sensors/gyro.h"
+
 #ifdef USE_HARDWARE_REVISION_DETECTION
 #include "hardware_revision.h"
 #endif
@@ -104,6 +113,26 @@ static uint8_t armState;
 
 static displayPort_t *osdDisplayPort;
 
+// What each element last put on the screen, so it is only formatted again when its value changes
+typedef struct osdElementCache_s {
+    int32_t value;
+    uint8_t x;
+    uint8_t y;
+    uint8_t length;     // characters written at x, y, blanked when the element is hidden or gets shorter
+} osdElementCache_t;
+
+static osdElementCache_t osdElementCache[OSD_ITEM_COUNT];
+static uint32_t osdElementValidMask = 0;
+static uint16_t osdElementPos[OSD_ITEM_COUNT];
+static uint16_t osdElementScreenSize = 0;
+static bool osdElementRedrawAll = true;
+static timeUs_t osdElementDueUs[OSD_ITEM_COUNT];
+static timeUs_t osdElementPassTimeUs;
+
+#define AH_BAR_COUNT 9
+static uint8_t osdHorizonBarX;
+static uint8_t osdHorizonBarY[AH_BAR_COUNT];     // row of the bar in each column, 0xFF if there is none
+static uint8_t osdHorizonBarSymbol[AH_BAR_COUNT];
 
 #define AH_MAX_PITCH 200 // Specify maximum AHI pitch value displayed. Default 200 = 20.0 degrees
 #define AH_MAX_ROLL 400  // Specify maximum AHI roll value displayed. Default 400 = 40.0 degrees
@@ -137,10 +166,223 @@ static int32_t osdGetAltitude(int32_t alt)
     }
 }
 
-static void osdDrawSingleElement(uint8_t item)
+#ifdef USE_SDCARD
+typedef enum {
+    OSD_SDCARD_NOT_PRESENT = 0,
+    OSD_SDCARD_ERROR,
+    OSD_SDCARD_CARD_INIT,
+    OSD_SDCARD_MOUNTING,
+    OSD_SDCARD_FULL,
+    OSD_SDCARD_READY
+} osdSdcardState_e;
+
+static osdSdcardState_e osdSdcardState(void)
+{
+    if (!sdcard_isInserted()) {
+        return OSD_SDCARD_NOT_PRESENT;
+    }
+    if (!sdcard_isFunctional()) {
+        return OSD_SDCARD_ERROR;
+    }
+    switch (afatfs_getFilesystemState()) {
+    case AFATFS_FILESYSTEM_STATE_READY:
+        return afatfs_isFull() ? OSD_SDCARD_FULL : OSD_SDCARD_READY;
+    case AFATFS_FILESYSTEM_STATE_INITIALIZATION:
+        return sdcard_isInitialized() ? OSD_SDCARD_MOUNTING : OSD_SDCARD_CARD_INIT;
+    default:
+        return OSD_SDCARD_ERROR;
+    }
+}
+#endif
+
+/*
+ * Returns a value that changes whenever the text of the element would, the element is only drawn again when it does.
+ */
+static int32_t osdGetElementValue(uint8_t item)
 {
-    if (!VISIBLE(osdProfile()->item_pos[item]) || BLINK(osdProfile()->item_pos[item]))
+    switch (item) {
+    case OSD_RSSI_VALUE:
+        return rssi * 100 / 1024;
+
+    case OSD_MAIN_BATT_VOLTAGE:
+        return vbat;
+
+    case OSD_CURRENT_DRAW:
+        return amperage;
+
+    case OSD_MAH_DRAWN:
+        return mAhDrawn;
+
+#ifdef GPS
+    case OSD_GPS_SATS:
+        return GPS_numSat;
+
+    case OSD_GPS_SPEED:
+        return GPS_speed * 36 / 1000;
+#endif
+
+    case OSD_ALTITUDE:
+    {
+        // shown to 0.1 with the sign separate, so -0.0 differs from 0.0
+        const int32_t alt = osdGetAltitude(baro.BaroAlt);
+        return (alt / 10) * 2 + (alt < 0);
+    }
+
+    case OSD_ONTIME:
+        return micros() / 1000000;
+
+    case OSD_FLYTIME:
+        return flyTime;
+
+    case OSD_FLYMODE:
+        return (FLIGHT_MODE(FAILSAFE_MODE | ANGLE_MODE | HORIZON_MODE) << 1) | isAirmodeActive();
+
+    case OSD_CRAFT_NAME:
+    {
+        int32_t hash = 0;
+        for (int i = 0; i < MAX_NAME_LENGTH && masterConfig.name[i]; i++) {
+            hash = hash * 31 + masterConfig.name[i];
+        }
+        return hash;
+    }
+
+    case OSD_THROTTLE_POS:
+        return (constrain(rcData[THROTTLE], PWM_RANGE_MIN, PWM_RANGE_MAX) - PWM_RANGE_MIN) * 100 / (PWM_RANGE_MAX - PWM_RANGE_MIN);
+
+#ifdef USE_RTC6705
+    case OSD_VTX_CHANNEL:
+        return current_vtx_channel;
+#endif
+
+    case OSD_ARTIFICIAL_HORIZON:
+        return (constrain(attitude.values.pitch, -AH_MAX_PITCH, AH_MAX_PITCH) / 8) * 1024 + constrain(attitude.values.roll, -AH_MAX_ROLL, AH_MAX_ROLL);
+
+    case OSD_ROLL_PIDS:
+    case OSD_PITCH_PIDS:
+    case OSD_YAW_PIDS:
+    {
+        const pidProfile_t *pidProfile = &currentProfile->pidProfile;
+        const int axis = item == OSD_ROLL_PIDS ? PIDROLL : (item == OSD_PITCH_PIDS ? PIDPITCH : PIDYAW);
+        return pidProfile->P8[axis] | (pidProfile->I8[axis] << 8) | (pidProfile->D8[axis] << 16);
+    }
+
+    case OSD_POWER:
+        return amperage * vbat / 1000;
+
+#ifdef USE_ESC_SENSOR
+    case OSD_ESC_TMP:
+        return getEscSensorData(ESC_SENSOR_COMBINED).temperature;
+
+    case OSD_ESC_RPM:
+        return getEscSensorData(ESC_SENSOR_COMBINED).rpm;
+#endif
+
+#ifdef USE_SDCARD
+    case OSD_SDCARD:
+        return (osdSdcardState() << 8) | afatfs_getInitProgress();
+#endif
+
+    case OSD_LOOP_RATE:
+#ifdef USE_LOOP_RATE_AUTO
+        if (loopRateAutoGetState() == LOOP_RATE_AUTO_SETTLING || loopRateAutoGetState() == LOOP_RATE_AUTO_MEASURING) {
+            return -1;
+        }
+#endif
+        return gyro.targetLooptime | (pidConfig()->pid_process_denom << 16);
+
+    default:
+        // crosshairs and sidebars never change
+        return 0;
+    }
+}
+
+static void osdWriteElementText(uint8_t item, uint8_t x, uint8_t y, char *buff)
+{
+    osdElementCache_t *cache = &osdElementCache[item];
+    int length = strlen(buff);
+
+    // blank what a longer previous value left behind
+    if (x == cache->x && y == cache->y) {
+        while (length < cache->length) {
+            buff[length++] = ' ';
+        }
+        buff[length] = 0;
+    }
+    displayWrite(osdDisplayPort, x, y, buff);
+
+    cache->x = x;
+    cache->y = y;
+    cache->length = strlen(buff);
+}
+
+/*
+ * The horizon bars share their window with other elements, the crosshairs and whatever else is placed there.
+ * An element with a character in a cell a bar is written to or blanked is drawn again on top.
+ */
+static void osdWriteHorizonBarChar(int column, uint8_t row, uint8_t c)
+{
+    const uint8_t x = osdHorizonBarX + column;
+    displayWriteChar(osdDisplayPort, x, row, c);
+
+    for (int i = 0; i < OSD_ITEM_COUNT; i++) {
+        const osdElementCache_t *cache = &osdElementCache[i];
+        if (cache->length && cache->y == row && x >= cache->x && x < cache->x + cache->length) {
+            osdElementValidMask &= ~(1 << i);
+        }
+    }
+}
+
+static void osdClearHorizonBars(void)
+{
+    for (int i = 0; i < AH_BAR_COUNT; i++) {
+        if (osdHorizonBarY[i] != 0xFF) {
+            osdWriteHorizonBarChar(i, osdHorizonBarY[i], ' ');
+            osdHorizonBarY[i] = 0xFF;
+        }
+    }
+}
+
+static void osdUpdateHorizonBar(int column, uint8_t row, uint8_t symbol)
+{
+    if (osdHorizonBarY[column] == row && osdHorizonBarSymbol[column] == symbol) {
         return;
+    }
+
+    if (osdHorizonBarY[column] != 0xFF && osdHorizonBarY[column] != row) {
+        osdWriteHorizonBarChar(column, osdHorizonBarY[column], ' ');
+    }
+    if (row != 0xFF) {
+        osdWriteHorizonBarChar(column, row, symbol);
+    }
+
+    osdHorizonBarY[column] = row;
+    osdHorizonBarSymbol[column] = symbol;
+}
+
+/*
+ * Removes an element from the screen. The sidebars are static and only go away with a full redraw.
+ */
+static void osdClearElement(uint8_t item)
+{
+    osdElementValidMask &= ~(1 << item);
+
+    if (item == OSD_ARTIFICIAL_HORIZON) {
+        osdClearHorizonBars();
+        return;
+    }
+
+    osdElementCache_t *cache = &osdElementCache[item];
+    if (cache->length) {
+        char buff[32];
+        memset(buff, ' ', cache->length);
+        buff[cache->length] = 0;
+        displayWrite(osdDisplayPort, cache->x, cache->y, buff);
+        cache->length = 0;
+    }
+}
+
+static void osdDrawSingleElement(uint8_t item)
+{
 
     uint8_t elemPosX = OSD_X(osdProfile()->item_pos[item]);
     uint8_t elemPosY = OSD_Y(osdProfile()->item_pos[item]);
@@ -230,8 +472,8 @@ static void osdDrawSingleElement(uint8_t item)
             else if (FLIGHT_MODE(HORIZON_MODE))
                 p = "HOR";
 
-            displayWrite(osdDisplayPort, elemPosX, elemPosY, p);
-            return;
+            strcpy(buff, p);
+            break;
         }
 
         case OSD_CRAFT_NAME:
@@ -301,17 +543,19 @@ static void osdDrawSingleElement(uint8_t item)
             // Convert pitchAngle to y compensation value
             pitchAngle = (pitchAngle / 8) - 41; // 41 = 4 * 9 + 5
 
+            // only the columns whose bar moved or changed symbol are written
+            osdHorizonBarX = elemPosX - 4;
             for (int8_t x = -4; x <= 4; x++) {
                 int y = (rollAngle * x) / 64;
                 y -= pitchAngle;
                 // y += 41; // == 4 * 9 + 5
                 if (y >= 0 && y <= 81) {
-                    displayWriteChar(osdDisplayPort, elemPosX + x, elemPosY + (y / 9), (SYM_AH_BAR9_0 + (y % 9)));
+                    osdUpdateHorizonBar(x + 4, elemPosY + (y / 9), (SYM_AH_BAR9_0 + (y % 9)));
+                } else {
+                    osdUpdateHorizonBar(x + 4, 0xFF, 0);
                 }
             }
 
-            osdDrawSingleElement(OSD_HORIZON_SIDEBARS);
-
             return;
         }
 
@@ -366,61 +610,207 @@ static void osdDrawSingleElement(uint8_t item)
             break;
         }
 
+#ifdef USE_ESC_SENSOR
+        case OSD_ESC_TMP:
+        {
+            const escSensorData_t escData = getEscSensorData(ESC_SENSOR_COMBINED);
+            sprintf(buff, "%dC", escData.temperature);
+            break;
+        }
+
+        case OSD_ESC_RPM:
+        {
+            // the ESCs report eRPM / 100, the average over all motors is shown as mechanical RPM
+            const escSensorData_t escData = getEscSensorData(ESC_SENSOR_COMBINED);
+            sprintf(buff, "%dR", escData.rpm * 200 / motorConfig()->motorPoleCount);
+            break;
+        }
+#endif
+
+#ifdef USE_SDCARD
+        case OSD_SDCARD:
+        {
+            static const char * const sdcardStateText[] = { "NO SD", "SD ERR", "SD INIT", NULL, "SD FULL", "SD OK" };
+            const osdSdcardState_e state = osdSdcardState();
+
+            // the freefile search through the FAT takes a while on large cards, so its progress is shown
+            if (state == OSD_SDCARD_MOUNTING) {
+                sprintf(buff, "SD %d%%", afatfs_getInitProgress());
+            } else {
+                strcpy(buff, sdcardStateText[state]);
+            }
+            break;
+        }
+#endif
+
+        case OSD_LOOP_RATE:
+        {
+#ifdef USE_LOOP_RATE_AUTO
+            if (loopRateAutoGetState() == LOOP_RATE_AUTO_SETTLING || loopRateAutoGetState() == LOOP_RATE_AUTO_MEASURING) {
+                strcpy(buff, "LOOP AUTO");
+                break;
+            }
+#endif
+            // gyro / PID rate in kHz to one decimal
+            const int gyroKhz10 = 10000 / gyro.targetLooptime;
+            const int pidKhz10 = 10000 / (gyro.targetLooptime * pidConfig()->pid_process_denom);
+            sprintf(buff, "%d.%d/%d.%dK", gyroKhz10 / 10, gyroKhz10 % 10, pidKhz10 / 10, pidKhz10 % 10);
+            break;
+        }
+
         default:
             return;
     }
 
-    displayWrite(osdDisplayPort, elemPosX, elemPosY, buff);
+    osdWriteElementText(item, elemPosX, elemPosY, buff);
 }
 
-void osdDrawElements(void)
-{
-    displayClearScreen(osdDisplayPort);
-
-#if 0
-    if (currentElement)
-        osdDrawElementPositioningHelp();
-#else
-    if (false)
-        ;
+// Elements in drawing order, the buffer is filled over several calls when the scheduler budget runs short
+static const uint8_t osdElementDrawOrder[] = {
+    OSD_ARTIFICIAL_HORIZON,
+    OSD_HORIZON_SIDEBARS,
+    OSD_CROSSHAIRS,
+    OSD_MAIN_BATT_VOLTAGE,
+    OSD_RSSI_VALUE,
+    OSD_FLYTIME,
+    OSD_ONTIME,
+    OSD_FLYMODE,
+    OSD_THROTTLE_POS,
+    OSD_VTX_CHANNEL,
+    OSD_CURRENT_DRAW,
+    OSD_MAH_DRAWN,
+    OSD_CRAFT_NAME,
+    OSD_ALTITUDE,
+    OSD_ROLL_PIDS,
+    OSD_PITCH_PIDS,
+    OSD_YAW_PIDS,
+    OSD_POWER,
+#ifdef USE_ESC_SENSOR
+    OSD_ESC_TMP,
+    OSD_ESC_RPM,
 #endif
+#ifdef USE_SDCARD
+    OSD_SDCARD,
+#endif
+    OSD_LOOP_RATE,
+#ifdef GPS
+    OSD_GPS_SATS,
+    OSD_GPS_SPEED,
+#endif
+};
+
+// Time an element may take to draw, there must be at least this much scheduler budget left to start the next one
+#define OSD_ELEMENT_BUDGET_US 30
+
+static uint8_t osdDrawElementIndex = 0;
+static bool osdDrawElementsInProgress = false;
+
+static bool osdElementIsDrawn(uint8_t item)
+{
+    switch (item) {
+    case OSD_ARTIFICIAL_HORIZON:
+    case OSD_HORIZON_SIDEBARS:
+    case OSD_CROSSHAIRS:
 #ifdef CMS
-    else if (sensors(SENSOR_ACC) || displayIsGrabbed(osdDisplayPort))
+        return sensors(SENSOR_ACC) || displayIsGrabbed(osdDisplayPort);
 #else
-    else if (sensors(SENSOR_ACC))
+        return sensors(SENSOR_ACC);
 #endif
-    {
-        osdDrawSingleElement(OSD_ARTIFICIAL_HORIZON);
-        osdDrawSingleElement(OSD_CROSSHAIRS);
-    }
-
-    osdDrawSingleElement(OSD_MAIN_BATT_VOLTAGE);
-    osdDrawSingleElement(OSD_RSSI_VALUE);
-    osdDrawSingleElement(OSD_FLYTIME);
-    osdDrawSingleElement(OSD_ONTIME);
-    osdDrawSingleElement(OSD_FLYMODE);
-    osdDrawSingleElement(OSD_THROTTLE_POS);
-    osdDrawSingleElement(OSD_VTX_CHANNEL);
-    osdDrawSingleElement(OSD_CURRENT_DRAW);
-    osdDrawSingleElement(OSD_MAH_DRAWN);
-    osdDrawSingleElement(OSD_CRAFT_NAME);
-    osdDrawSingleElement(OSD_ALTITUDE);
-    osdDrawSingleElement(OSD_ROLL_PIDS);
-    osdDrawSingleElement(OSD_PITCH_PIDS);
-    osdDrawSingleElement(OSD_YAW_PIDS);
-    osdDrawSingleElement(OSD_POWER);
-
 #ifdef GPS
+    case OSD_GPS_SATS:
+    case OSD_GPS_SPEED:
 #ifdef CMS
-    if (sensors(SENSOR_GPS) || displayIsGrabbed(osdDisplayPort))
+        return sensors(SENSOR_GPS) || displayIsGrabbed(osdDisplayPort);
 #else
-    if (sensors(SENSOR_GPS))
+        return sensors(SENSOR_GPS);
 #endif
-    {
-        osdDrawSingleElement(OSD_GPS_SATS);
-        osdDrawSingleElement(OSD_GPS_SPEED);
+#endif
+#ifdef USE_ESC_SENSOR
+    case OSD_ESC_TMP:
+    case OSD_ESC_RPM:
+        return isEscSensorActive();
+#endif
+    default:
+        return true;
     }
-#endif // GPS
+}
+
+static void osdInvalidateElements(void)
+{
+    osdElementRedrawAll = true;
+}
+
+/*
+ * Moving or hiding an element in the config, or a change of video standard, redraws the whole screen.
+ */
+static bool osdElementLayoutChanged(void)
+{
+    bool changed = osdElementScreenSize != displayScreenSize(osdDisplayPort);
+    osdElementScreenSize = displayScreenSize(osdDisplayPort);
+
+    for (int i = 0; i < OSD_ITEM_COUNT; i++) {
+        const uint16_t pos = BLINK_OFF(osdProfile()->item_pos[i]);
+        if (osdElementPos[i] != pos) {
+            osdElementPos[i] = pos;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static void osdUpdateElement(uint8_t item)
+{
+    const uint16_t pos = osdProfile()->item_pos[item];
+    if (!osdElementIsDrawn(item) || !VISIBLE(pos) || BLINK(pos)) {
+        osdClearElement(item);
+        return;
+    }
+
+    // an element on screen is only looked at again once its interval has passed
+    if ((osdElementValidMask & (1 << item)) && cmpTimeUs(osdElementPassTimeUs, osdElementDueUs[item]) < 0) {
+        return;
+    }
+    osdElementDueUs[item] = osdElementPassTimeUs + osdProfile()->item_interval[item] * 1000;
+
+    const int32_t value = osdGetElementValue(item);
+    if ((osdElementValidMask & (1 << item)) && osdElementCache[item].value == value) {
+        return;
+    }
+    osdElementCache[item].value = value;
+    osdElementValidMask |= 1 << item;
+    osdDrawSingleElement(item);
+}
+
+/*
+ * Draws the elements whose value changed into the screen buffer, checking at least one per call.
+ * Returns true once all elements are checked, false if it yielded to the scheduler with elements still to check.
+ */
+static bool osdDrawElements(timeUs_t currentTimeUs)
+{
+    if (!osdDrawElementsInProgress) {
+        osdElementPassTimeUs = currentTimeUs;
+        if (osdElementLayoutChanged() || osdElementRedrawAll) {
+            displayClearScreen(osdDisplayPort);
+            osdElementValidMask = 0;
+            for (int i = 0; i < OSD_ITEM_COUNT; i++) {
+                osdElementCache[i].length = 0;
+            }
+            memset(osdHorizonBarY, 0xFF, sizeof(osdHorizonBarY));
+            osdElementRedrawAll = false;
+        }
+        osdDrawElementIndex = 0;
+        osdDrawElementsInProgress = true;
+    }
+
+    do {
+        osdUpdateElement(osdElementDrawOrder[osdDrawElementIndex++]);
+        if (osdDrawElementIndex >= ARRAYLEN(osdElementDrawOrder)) {
+            osdDrawElementsInProgress = false;
+            return true;
+        }
+    } while (schedulerGetRemainingBudgetUs() >= OSD_ELEMENT_BUDGET_US);
+
+    return false;
 }
 
 void osdResetConfig(osd_profile_t *osdProfile)
@@ -444,6 +834,36 @@ void osdResetConfig(osd_profile_t *osdProfile)
     osdProfile->item_pos[OSD_PITCH_PIDS] = OSD_POS(2, 11) | VISIBLE_FLAG;
     osdProfile->item_pos[OSD_YAW_PIDS] = OSD_POS(2, 12) | VISIBLE_FLAG;
     osdProfile->item_pos[OSD_POWER] = OSD_POS(15, 1);
+    osdProfile->item_pos[OSD_ESC_TMP] = OSD_POS(18, 2);
+    osdProfile->item_pos[OSD_ESC_RPM] = OSD_POS(19, 3);
+    osdProfile->item_pos[OSD_SDCARD] = OSD_POS(22, 4);
+    osdProfile->item_pos[OSD_LOOP_RATE] = OSD_POS(1, 4);
+
+    // the horizon follows the video, slow counters only need to be looked at a few times a second
+    osdProfile->item_interval[OSD_RSSI_VALUE] = 100;
+    osdProfile->item_interval[OSD_MAIN_BATT_VOLTAGE] = 200;
+    osdProfile->item_interval[OSD_ARTIFICIAL_HORIZON] = 0;
+    osdProfile->item_interval[OSD_HORIZON_SIDEBARS] = 0;
+    osdProfile->item_interval[OSD_CROSSHAIRS] = 0;
+    osdProfile->item_interval[OSD_ONTIME] = 200;
+    osdProfile->item_interval[OSD_FLYTIME] = 200;
+    osdProfile->item_interval[OSD_FLYMODE] = 100;
+    osdProfile->item_interval[OSD_CRAFT_NAME] = 1000;
+    osdProfile->item_interval[OSD_THROTTLE_POS] = 100;
+    osdProfile->item_interval[OSD_VTX_CHANNEL] = 1000;
+    osdProfile->item_interval[OSD_CURRENT_DRAW] = 200;
+    osdProfile->item_interval[OSD_MAH_DRAWN] = 500;
+    osdProfile->item_interval[OSD_GPS_SPEED] = 200;
+    osdProfile->item_interval[OSD_GPS_SATS] = 500;
+    osdProfile->item_interval[OSD_ALTITUDE] = 200;
+    osdProfile->item_interval[OSD_ROLL_PIDS] = 500;
+    osdProfile->item_interval[OSD_PITCH_PIDS] = 500;
+    osdProfile->item_interval[OSD_YAW_PIDS] = 500;
+    osdProfile->item_interval[OSD_POWER] = 200;
+    osdProfile->item_interval[OSD_ESC_TMP] = 500;
+    osdProfile->item_interval[OSD_ESC_RPM] = 200;
+    osdProfile->item_interval[OSD_SDCARD] = 500;
+    osdProfile->item_interval[OSD_LOOP_RATE] = 500;
 
     osdProfile->rssi_alarm = 20;
     osdProfile->cap_alarm = 2200;
@@ -650,8 +1070,10 @@ static void osdRefresh(timeUs_t currentTimeUs)
         if (IS_HI(THROTTLE) || IS_HI(PITCH)) // hide statistics
             refreshTimeout = 1;
         refreshTimeout--;
-        if (!refreshTimeout)
+        if (!refreshTimeout) {
             displayClearScreen(osdDisplayPort);
+            osdInvalidateElements();
+        }
         return;
     }
 
@@ -660,8 +1082,9 @@ static void osdRefresh(timeUs_t currentTimeUs)
 #ifdef CMS
     if (!displayIsGrabbed(osdDisplayPort)) {
         osdUpdateAlarms();
-        osdDrawElements();
-        displayHeartbeat(osdDisplayPort); // heartbeat to stop Minim OSD going back into native mode
+        if (osdDrawElements(currentTimeUs)) {
+            displayHeartbeat(osdDisplayPort); // heartbeat to stop Minim OSD going back into native mode
+        }
 #ifdef OSD_CALLS_CMS
     } else {
         cmsUpdate(currentTimeUs);
@@ -689,10 +1112,30 @@ void osdUpdate(timeUs_t currentTimeUs)
 #else
 #define DRAW_FREQ_DENOM 10 // MWOSD @ 115200 baud
 #endif
-    if (counter++ % DRAW_FREQ_DENOM == 0) {
+#ifdef CMS
+    if (displayIsGrabbed(osdDisplayPort)) {
+        osdDrawElementsInProgress = false;
+        osdInvalidateElements();
+    }
+#endif
+    if (osdDrawElementsInProgress) {
+        // carry on filling the buffer, it is not sent to the display until complete
+        if (osdDrawElements(currentTimeUs)) {
+            displayHeartbeat(osdDisplayPort);
+        }
+    } else if (counter++ % DRAW_FREQ_DENOM == 0) {
+        PROFILE_BEGIN(PROFILE_OSD);
         osdRefresh(currentTimeUs);
+        PROFILE_END(PROFILE_OSD);
     } else { // rest of time redraw screen 10 chars per idle so it doesn't lock the main idle
-        displayDrawScreen(osdDisplayPort);
+        // elements with an interval shorter than the refresh are brought up to date in between,
+        // unless the screen is showing something else or is about to be cleared
+        if (!refreshTimeout && !osdElementRedrawAll) {
+            osdDrawElements(currentTimeUs);
+        }
+        if (!osdDrawElementsInProgress) {
+            displayDrawScreen(osdDisplayPort);
+        }
     }
 
 #ifdef CMS
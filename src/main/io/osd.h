@@ -46,6 +46,10 @@ typedef enum {
     OSD_PITCH_PIDS,
     OSD_YAW_PIDS,
     OSD_POWER,
+    OSD_ESC_TMP,
+    OSD_ESC_RPM,
+    OSD_SDCARD,
+    OSD_LOOP_RATE,
     OSD_ITEM_COUNT // MUST BE LAST
 } osd_items_e;
 
@@ -56,6 +60,7 @@ typedef enum {
 
 typedef struct osd_profile_s {
     uint16_t item_pos[OSD_ITEM_COUNT];
+    uint16_t item_interval[OSD_ITEM_COUNT];     // ms between updates of an element, 0 updates it at the OSD task rate
 
     // Alarms
     uint8_t rssi_alarm;
@@ -0,0 +1,219 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Collects block read and write latencies from the SD card driver, so cards whose slow writes would make the blackbox
+ * drop frames can be spotted before they fly. The write latency runs from the call to sdcard_writeBlock() until the
+ * card has finished programming the block.
+ *
+ * The optional boot benchmark writes SDCARD_BENCHMARK_SIZE bytes through the filesystem the same way the blackbox
+ * does, so the statistics afterwards describe just that run, then deletes the file again.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/sdcard.h"
+#include "drivers/system.h"
+
+#include "io/asyncfatfs/asyncfatfs.h"
+
+#include "sdcard_profiler.h"
+
+static sdcardLatencyStats_t readStats;
+static sdcardLatencyStats_t writeStats;
+
+static struct {
+    sdcardBenchmarkState_e state;
+    afatfsFilePtr_t file;
+    uint32_t bytesWritten;
+    uint32_t startTime;
+    uint32_t durationMs;
+    bool opening;
+    bool deleting;
+} benchmark;
+
+// Filler for the benchmark file, the content doesn't matter to the card
+static const uint8_t benchmarkPattern[128];
+
+void sdcardProfilerReset(void)
+{
+    memset(&readStats, 0, sizeof(readStats));
+    memset(&writeStats, 0, sizeof(writeStats));
+}
+
+uint32_t sdcardProfilerGetBucketLimitUs(int bucket)
+{
+    return SDCARD_PROFILER_BUCKET_0_US << MIN(bucket, SDCARD_PROFILER_BUCKET_COUNT - 2);
+}
+
+void sdcardProfilerRecord(sdcardBlockOperation_e operation, uint32_t blockIndex, uint32_t durationUs)
+{
+    UNUSED(blockIndex);
+
+    sdcardLatencyStats_t *stats;
+
+    switch (operation) {
+        case SDCARD_BLOCK_OPERATION_READ:
+            stats = &readStats;
+        break;
+        case SDCARD_BLOCK_OPERATION_WRITE:
+            stats = &writeStats;
+        break;
+        default:
+            return;
+    }
+
+    int bucket = 0;
+    if (durationUs >= SDCARD_PROFILER_BUCKET_0_US) {
+        bucket = MIN(31 - __builtin_clz(durationUs / SDCARD_PROFILER_BUCKET_0_US) + 1, SDCARD_PROFILER_BUCKET_COUNT - 1);
+    }
+
+    stats->count++;
+    stats->histogram[bucket]++;
+    stats->maxUs = MAX(stats->maxUs, durationUs);
+    if (durationUs >= SDCARD_PROFILER_STALL_US) {
+        stats->stalls++;
+    }
+}
+
+const sdcardLatencyStats_t *sdcardProfilerGetStats(sdcardBlockOperation_e operation)
+{
+    return operation == SDCARD_BLOCK_OPERATION_READ ? &readStats : &writeStats;
+}
+
+static void sdcardBenchmarkFileCreated(afatfsFilePtr_t file)
+{
+    benchmark.opening = false;
+
+    if (file) {
+        benchmark.file = file;
+        benchmark.bytesWritten = 0;
+        benchmark.startTime = millis();
+        benchmark.state = SDCARD_BENCHMARK_RUNNING;
+
+        // Only count the benchmark's own writes
+        sdcardProfilerReset();
+    } else {
+        benchmark.state = SDCARD_BENCHMARK_FAILED;
+    }
+}
+
+static void sdcardBenchmarkFileDeleted(void)
+{
+    benchmark.deleting = false;
+    benchmark.state = SDCARD_BENCHMARK_DONE;
+}
+
+/**
+ * Start collecting latencies from the card driver, and if runBenchmark is set, queue a benchmark to run as soon as
+ * the filesystem is ready. Call after sdcard_init() and afatfs_init().
+ */
+void sdcardProfilerInit(bool runBenchmark)
+{
+    sdcardProfilerReset();
+
+#ifndef AFATFS_USE_INTROSPECTIVE_LOGGING
+    // The introspective log owns the driver's callback and passes the samples on to us
+    sdcard_setProfilerCallback(sdcardProfilerRecord);
+#endif
+
+    memset(&benchmark, 0, sizeof(benchmark));
+    benchmark.state = runBenchmark ? SDCARD_BENCHMARK_WAITING : SDCARD_BENCHMARK_OFF;
+}
+
+/**
+ * Drive the boot benchmark, call after afatfs_poll().
+ */
+void sdcardProfilerUpdate(void)
+{
+    switch (benchmark.state) {
+        case SDCARD_BENCHMARK_WAITING:
+            if (benchmark.opening) {
+                break;
+            }
+
+            switch (afatfs_getFilesystemState()) {
+                case AFATFS_FILESYSTEM_STATE_READY:
+                    // Contiguous append, like a blackbox log
+                    benchmark.opening = afatfs_fopen(SDCARD_BENCHMARK_FILENAME, "as", sdcardBenchmarkFileCreated);
+                break;
+                case AFATFS_FILESYSTEM_STATE_FATAL:
+                    benchmark.state = SDCARD_BENCHMARK_FAILED;
+                break;
+                default:
+                    ;
+            }
+        break;
+        case SDCARD_BENCHMARK_RUNNING:
+            if (benchmark.deleting) {
+                break;
+            }
+
+            // Fill up whatever room the write-behind cache has
+            while (benchmark.bytesWritten < SDCARD_BENCHMARK_SIZE) {
+                uint32_t written = afatfs_fwrite(benchmark.file, benchmarkPattern, sizeof(benchmarkPattern));
+
+                benchmark.bytesWritten += written;
+
+                if (written < sizeof(benchmarkPattern)) {
+                    break;
+                }
+            }
+
+            if (benchmark.bytesWritten >= SDCARD_BENCHMARK_SIZE && afatfs_flush()) {
+                if (benchmark.durationMs == 0) {
+                    benchmark.durationMs = MAX(millis() - benchmark.startTime, 1);
+                }
+
+                if (afatfs_funlink(benchmark.file, sdcardBenchmarkFileDeleted)) {
+                    benchmark.file = NULL;
+                    benchmark.deleting = true;
+                }
+            } else if (afatfs_isFull()) {
+                afatfs_funlink(benchmark.file, NULL);
+                benchmark.file = NULL;
+                benchmark.state = SDCARD_BENCHMARK_FAILED;
+            }
+        break;
+        default:
+            ;
+    }
+}
+
+sdcardBenchmarkState_e sdcardBenchmarkGetState(void)
+{
+    return benchmark.state;
+}
+
+/**
+ * Returns the write rate the benchmark achieved in kilobytes per second, or zero if it hasn't finished.
+ */
+uint32_t sdcardBenchmarkGetRateKBps(void)
+{
+    if (benchmark.state != SDCARD_BENCHMARK_DONE) {
+        return 0;
+    }
+
+    return (uint64_t) benchmark.bytesWritten * 1000 / 1024 / benchmark.durationMs;
+}
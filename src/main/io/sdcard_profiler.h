@@ -0,0 +1,56 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "drivers/sdcard.h"
+
+#define SDCARD_PROFILER_BUCKET_COUNT 12
+#define SDCARD_PROFILER_BUCKET_0_US  250    // Each bucket is twice as wide as the last, the final one is open-ended
+#define SDCARD_PROFILER_STALL_US     100000 // Long enough to fill the blackbox write-behind cache at high logging rates
+
+#define SDCARD_BENCHMARK_FILENAME    "SDBENCH.TMP"
+#define SDCARD_BENCHMARK_SIZE        (1024 * 1024)
+
+typedef struct sdcardLatencyStats_s {
+    uint32_t count;
+    uint32_t maxUs;
+    uint32_t stalls; // Operations that took longer than SDCARD_PROFILER_STALL_US
+    uint32_t histogram[SDCARD_PROFILER_BUCKET_COUNT];
+} sdcardLatencyStats_t;
+
+typedef enum {
+    SDCARD_BENCHMARK_OFF = 0,
+    SDCARD_BENCHMARK_WAITING,   // For the filesystem to come up
+    SDCARD_BENCHMARK_RUNNING,
+    SDCARD_BENCHMARK_DONE,
+    SDCARD_BENCHMARK_FAILED
+} sdcardBenchmarkState_e;
+
+void sdcardProfilerInit(bool runBenchmark);
+void sdcardProfilerReset(void);
+void sdcardProfilerRecord(sdcardBlockOperation_e operation, uint32_t blockIndex, uint32_t durationUs);
+void sdcardProfilerUpdate(void);
+
+const sdcardLatencyStats_t *sdcardProfilerGetStats(sdcardBlockOperation_e operation);
+uint32_t sdcardProfilerGetBucketLimitUs(int bucket);
+
+sdcardBenchmarkState_e sdcardBenchmarkGetState(void);
+uint32_t sdcardBenchmarkGetRateKBps(void);
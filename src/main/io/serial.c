@@ -23,6 +23,7 @@
 
 #include "build/build_config.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 
 #include "drivers/system.h"
@@ -391,6 +392,87 @@ void closeSerialPort(serialPort_t *serialPort)
     serialPortUsage->serialPort = NULL;
 }
 
+#if defined(USE_UART1) || defined(USE_UART2) || defined(USE_UART3) || defined(USE_UART4) || defined(USE_UART5) || defined(USE_UART6)
+typedef struct serialFunctionBufferSize_s {
+    serialPortFunction_e function;
+    uint16_t rxSize;
+    uint16_t txSize;
+} serialFunctionBufferSize_t;
+
+// What each function needs to get through its largest frames, a port gets the largest of its functions' sizes
+static const serialFunctionBufferSize_t serialFunctionBufferSizes[] = {
+    { FUNCTION_MSP,                 256, 256 },
+    { FUNCTION_GPS,                 256, 128 },
+    { FUNCTION_TELEMETRY_FRSKY,     32,  64  },
+    { FUNCTION_TELEMETRY_HOTT,      64,  64  },
+    { FUNCTION_TELEMETRY_LTM,       32,  128 },
+    { FUNCTION_TELEMETRY_SMARTPORT, 64,  64  },
+    { FUNCTION_RX_SERIAL,           128, 64  },
+    { FUNCTION_BLACKBOX,            32,  256 },
+    { FUNCTION_TELEMETRY_MAVLINK,   64,  256 },
+    { FUNCTION_ESC_SENSOR,          64,  32  },
+    { FUNCTION_VTX_CONTROL,         64,  64  },
+};
+
+// Enough for a port with no function of its own to be used for serial passthrough
+#define SERIAL_UART_MIN_BUFFER_SIZE 64
+
+/*
+ * Share the UART buffer pool out according to what each port is configured for. Whatever is left over goes to the
+ * transmit buffer of the blackbox port, the one function that can produce data faster than the port sends it.
+ */
+static void serialAllocateUartBuffers(void)
+{
+    uint16_t rxSizes[SERIAL_PORT_COUNT];
+    uint16_t txSizes[SERIAL_PORT_COUNT];
+    int blackboxIndex = -1;
+    uint32_t planned = 0;
+
+    for (int index = 0; index < SERIAL_PORT_COUNT; index++) {
+        const serialPortIdentifier_e identifier = serialPortUsageList[index].identifier;
+
+        rxSizes[index] = 0;
+        txSizes[index] = 0;
+
+        if (identifier < SERIAL_PORT_USART1 || identifier > SERIAL_PORT_USART8) {
+            continue;
+        }
+
+        const serialPortConfig_t *portConfig = serialFindPortConfiguration(identifier);
+        const uint16_t functionMask = portConfig ? portConfig->functionMask : FUNCTION_NONE;
+
+        rxSizes[index] = SERIAL_UART_MIN_BUFFER_SIZE;
+        txSizes[index] = SERIAL_UART_MIN_BUFFER_SIZE;
+
+        for (unsigned i = 0; i < ARRAYLEN(serialFunctionBufferSizes); i++) {
+            if (functionMask & serialFunctionBufferSizes[i].function) {
+                rxSizes[index] = MAX(rxSizes[index], serialFunctionBufferSizes[i].rxSize);
+                txSizes[index] = MAX(txSizes[index], serialFunctionBufferSizes[i].txSize);
+            }
+        }
+
+        if (functionMask & FUNCTION_BLACKBOX) {
+            blackboxIndex = index;
+        }
+
+        planned += rxSizes[index] + txSizes[index];
+    }
+
+    if (blackboxIndex >= 0) {
+        while (planned + txSizes[blackboxIndex] <= uartBufferPoolFree()) {
+            planned += txSizes[blackboxIndex];
+            txSizes[blackboxIndex] *= 2;
+        }
+    }
+
+    for (int index = 0; index < SERIAL_PORT_COUNT; index++) {
+        if (rxSizes[index]) {
+            uartAllocateBuffers(serialPortUsageList[index].identifier - SERIAL_PORT_USART1, rxSizes[index], txSizes[index]);
+        }
+    }
+}
+#endif
+
 void serialInit(serialConfig_t *initialSerialConfig, bool softserialEnabled, serialPortIdentifier_e serialPortToDisable)
 {
     uint8_t index;
@@ -423,6 +505,10 @@ void serialInit(serialConfig_t *initialSerialConfig, bool softserialEnabled, ser
             }
         }
     }
+
+#if defined(USE_UART1) || defined(USE_UART2) || defined(USE_UART3) || defined(USE_UART4) || defined(USE_UART5) || defined(USE_UART6)
+    serialAllocateUartBuffers();
+#endif
 }
 
 void serialRemovePort(serialPortIdentifier_e identifier)
@@ -480,6 +566,40 @@ static void nopConsumer(uint8_t data)
     UNUSED(data);
 }
 
+#define SERIAL_PASSTHROUGH_CHUNK_SIZE 64
+
+/*
+ Move whatever `from` has received to `to` in one chunk, limited by the space
+ free in `to`. The write never blocks, so a slow side cannot stall the other
+ direction long enough for its RX ring to overflow, and each chunk is handed to
+ the driver with one serialWriteBuf() call so UART ports keep their TX DMA busy.
+ */
+static void serialPassthroughChunk(serialPort_t *from, serialPort_t *to, serialConsumer *consumer)
+{
+    uint8_t buf[SERIAL_PASSTHROUGH_CHUNK_SIZE];
+
+    uint32_t count = MIN(serialRxBytesWaiting(from), sizeof(buf));
+    const bool canWrite = to->mode & MODE_TX;
+    if (canWrite) {
+        count = MIN(count, serialTxBytesFree(to));
+    }
+    if (count == 0) {
+        return;
+    }
+
+    LED0_ON;
+    for (uint32_t i = 0; i < count; i++) {
+        buf[i] = serialRead(from);
+    }
+    if (canWrite) {
+        serialWriteBuf(to, buf, count);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        consumer(buf[i]);
+    }
+    LED0_OFF;
+}
+
 /*
  A high-level serial passthrough implementation. Used by cli to start an
  arbitrary serial passthrough "proxy". Optional callbacks can be given to allow
@@ -500,27 +620,15 @@ void serialPassthrough(serialPort_t *left, serialPort_t *right, serialConsumer
     LED1_OFF;
 
     // Either port might be open in a mode other than MODE_RXTX. We rely on
-    // serialRxBytesWaiting() to do the right thing for a TX only port. No
-    // special handling is necessary OR performed.
+    // serialRxBytesWaiting() to do the right thing for a TX only port, and
+    // serialPassthroughChunk() drops data headed for an RX only port.
     while(1) {
         // TODO: maintain a timestamp of last data received. Use this to
         // implement a guard interval and check for `+++` as an escape sequence
         // to return to CLI command mode.
         // https://en.wikipedia.org/wiki/Escape_sequence#Modem_control
-        if (serialRxBytesWaiting(left)) {
-            LED0_ON;
-            uint8_t c = serialRead(left);
-            serialWrite(right, c);
-            leftC(c);
-            LED0_OFF;
-         }
-         if (serialRxBytesWaiting(right)) {
-             LED0_ON;
-             uint8_t c = serialRead(right);
-             serialWrite(left, c);
-             rightC(c);
-             LED0_OFF;
-         }
-     }
- }
+        serialPassthroughChunk(left, right, leftC);
+        serialPassthroughChunk(right, left, rightC);
+    }
+}
  #endif
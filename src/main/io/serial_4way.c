@@ -85,7 +85,7 @@
 #define SERIAL_4WAY_VERSION_HI (uint8_t) (SERIAL_4WAY_VERSION / 100)
 #define SERIAL_4WAY_VERSION_LO (uint8_t) (SERIAL_4WAY_VERSION % 100)
 
-static uint8_t escCount;
+uint8_t escCount;
 
 escHardware_t escHardware[MAX_SUPPORTED_MOTORS];
 
@@ -109,24 +109,43 @@ inline bool isEscLo(uint8_t selEsc)
     return (IORead(escHardware[selEsc].io) == Bit_RESET);
 }
 
+// the output side drives every ESC pin together when broadcasting
+static inline uint8_t escFirst(uint8_t selEsc)
+{
+    return (selEsc == ESC4WAY_BROADCAST) ? 0 : selEsc;
+}
+
+static inline uint8_t escEnd(uint8_t selEsc)
+{
+    return (selEsc == ESC4WAY_BROADCAST) ? escCount : selEsc + 1;
+}
+
 inline void setEscHi(uint8_t selEsc)
 {
-    IOHi(escHardware[selEsc].io);
+    for (uint8_t i = escFirst(selEsc); i < escEnd(selEsc); i++) {
+        IOHi(escHardware[i].io);
+    }
 }
 
 inline void setEscLo(uint8_t selEsc)
 {
-    IOLo(escHardware[selEsc].io);
+    for (uint8_t i = escFirst(selEsc); i < escEnd(selEsc); i++) {
+        IOLo(escHardware[i].io);
+    }
 }
 
 inline void setEscInput(uint8_t selEsc)
 {
-    IOConfigGPIO(escHardware[selEsc].io, IOCFG_IPU);
+    for (uint8_t i = escFirst(selEsc); i < escEnd(selEsc); i++) {
+        IOConfigGPIO(escHardware[i].io, IOCFG_IPU);
+    }
 }
 
 inline void setEscOutput(uint8_t selEsc)
 {
-    IOConfigGPIO(escHardware[selEsc].io, IOCFG_OUT_PP);
+    for (uint8_t i = escFirst(selEsc); i < escEnd(selEsc); i++) {
+        IOConfigGPIO(escHardware[i].io, IOCFG_OUT_PP);
+    }
 }
 
 uint8_t esc4wayInit(void)
@@ -363,6 +382,27 @@ static uint8_t Connect(uint8_32_u *pDeviceInfo)
     return 0;
 }
 
+#ifdef USE_SERIAL_4WAY_BLHELI_BOOTLOADER
+// Connects the ESCs one by one, they all have to run the same BLHeli bootloader on the same MCU to be broadcast to
+static uint8_t ConnectAll(uint8_32_u *pDeviceInfo)
+{
+    uint16_t signature = 0;
+
+    for (uint8_t esc = 0; esc < escCount; esc++) {
+        selected_esc = esc;
+        if (!Connect(pDeviceInfo) || CurrentInterfaceMode == imSK) {
+            return 0;
+        }
+        if (esc > 0 && pDeviceInfo->words[0] != signature) {
+            return 0;
+        }
+        signature = pDeviceInfo->words[0];
+    }
+    selected_esc = ESC4WAY_BROADCAST;
+    return (escCount > 0);
+}
+#endif
+
 static serialPort_t *port;
 
 static uint8_t ReadByte(void)
@@ -541,7 +581,7 @@ void esc4wayProcess(serialPort_t *mspPort)
 
                 case cmd_DeviceReset:
                 {
-                    if (ParamBuf[0] < escCount) {
+                    if (ParamBuf[0] < escCount || ParamBuf[0] == ESC4WAY_BROADCAST) {
                         // Channel may change here
                         selected_esc = ParamBuf[0];
                     }
@@ -572,6 +612,19 @@ void esc4wayProcess(serialPort_t *mspPort)
                 case cmd_DeviceInitFlash:
                 {
                     SET_DISCONNECTED;
+#ifdef USE_SERIAL_4WAY_BLHELI_BOOTLOADER
+                    if (ParamBuf[0] == ESC4WAY_BROADCAST) {
+                        O_PARAM_LEN = DeviceInfoSize; //4
+                        O_PARAM = (uint8_t *)&DeviceInfo;
+                        if (ConnectAll(&DeviceInfo)) {
+                            DeviceInfo.bytes[INTF_MODE_IDX] = CurrentInterfaceMode;
+                        } else {
+                            SET_DISCONNECTED;
+                            ACK_OUT = ACK_D_GENERAL_ERROR;
+                        }
+                        break;
+                    }
+#endif
                     if (ParamBuf[0] < escCount) {
                         //Channel may change here
                         //ESC_LO or ESC_HI; Halt state for prev channel
@@ -633,6 +686,11 @@ void esc4wayProcess(serialPort_t *mspPort)
                 case cmd_DeviceRead:
                 {
                     ioMem.D_NUM_BYTES = ParamBuf[0];
+                    if (selected_esc == ESC4WAY_BROADCAST) {
+                        // the reply only has room for one ESC's memory
+                        ACK_OUT = ACK_I_INVALID_CHANNEL;
+                        break;
+                    }
                     /*
                     wtf.D_FLASH_ADDR_H=Adress_H;
                     wtf.D_FLASH_ADDR_L=Adress_L;
@@ -675,6 +733,11 @@ void esc4wayProcess(serialPort_t *mspPort)
                 case cmd_DeviceReadEEprom:
                 {
                     ioMem.D_NUM_BYTES = ParamBuf[0];
+                    if (selected_esc == ESC4WAY_BROADCAST) {
+                        // the reply only has room for one ESC's memory
+                        ACK_OUT = ACK_I_INVALID_CHANNEL;
+                        break;
+                    }
                     /*
                     wtf.D_FLASH_ADDR_H = Adress_H;
                     wtf.D_FLASH_ADDR_L = Adress_L;
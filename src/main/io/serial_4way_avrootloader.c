@@ -31,6 +31,8 @@
 #include "drivers/serial.h"
 #include "drivers/timer.h"
 
+#include "flight/mixer.h"
+
 #include "io/serial.h"
 #include "io/serial_4way.h"
 #include "io/serial_4way_impl.h"
@@ -65,6 +67,7 @@
 #define brERRORCOMMAND      0xC1
 #define brERRORCRC          0xC2
 #define brNONE              0xFF
+#define brMISMATCH          0x00    // broadcast only, the ESCs did not all answer the same
 
 
 #define START_BIT_TIMEOUT_MS 2
@@ -229,8 +232,81 @@ uint8_t BL_ConnectEx(uint8_32_u *pDeviceInfo)
     return (1);
 }
 
+/*
+ * Receives the ACK of every ESC at once when broadcasting. Each pin has its own receiver, started by its own start
+ * bit and sampled on the same schedule as suart_getc_(), all served from one polling loop on micros().
+ */
+typedef struct suartReceiver_s {
+    uint32_t btime;         // next sample, 0 while waiting for the start bit
+    uint16_t bitmask;
+    uint8_t bit;
+    uint8_t ack;
+} suartReceiver_t;
+
+static uint8_t BL_GetACKAll(uint32_t Timeout)
+{
+    suartReceiver_t rx[MAX_SUPPORTED_MOTORS];
+    uint8_t pending = escCount;
+
+    memset(rx, 0, sizeof(rx));
+    for (uint8_t esc = 0; esc < escCount; esc++) {
+        rx[esc].ack = brNONE;
+    }
+
+    const uint32_t wait_time = millis() + (Timeout + 1) * START_BIT_TIMEOUT_MS;
+    while (pending) {
+        bool receiving = false;
+        for (uint8_t esc = 0; esc < escCount; esc++) {
+            suartReceiver_t *r = &rx[esc];
+            if (r->ack != brNONE) {
+                continue;
+            }
+            if (!r->btime) {
+                if (isEscLo(esc)) {
+                    r->btime = micros() + START_BIT_TIME;
+                    r->bitmask = 0;
+                    r->bit = 0;
+                }
+                continue;
+            }
+            receiving = true;
+            if (micros() < r->btime) {
+                continue;
+            }
+            if (isEscHi(esc)) {
+                r->bitmask |= (1 << r->bit);
+            }
+            r->btime += BIT_TIME;
+            if (++r->bit == 10) {
+                // a framing error waits for the next start bit, as suart_getc_() would be called again
+                if (!(r->bitmask & 1) && (r->bitmask & (1 << 9))) {
+                    r->ack = r->bitmask >> 1;
+                    pending--;
+                }
+                r->btime = 0;
+            }
+        }
+        // a byte being received is finished after the timeout, but a line stuck low can't hold the loop any longer
+        const uint32_t now = millis();
+        if (now >= wait_time && (!receiving || now >= wait_time + START_BIT_TIMEOUT_MS)) {
+            break;
+        }
+    }
+
+    for (uint8_t esc = 1; esc < escCount; esc++) {
+        if (rx[esc].ack != rx[0].ack) {
+            return brMISMATCH;
+        }
+    }
+    return rx[0].ack;
+}
+
 static uint8_t BL_GetACK(uint32_t Timeout)
 {
+    if (selected_esc == ESC4WAY_BROADCAST) {
+        return BL_GetACKAll(Timeout);
+    }
+
     uint8_t LastACK = brNONE;
     while (!(suart_getc_(&LastACK)) && (Timeout)) {
         Timeout--;
@@ -273,13 +349,18 @@ static uint8_t BL_SendCMDSetBuffer(ioMem_t *pMem)
         sCMD[2] = 1;
     }
     BL_SendBuf(sCMD, 4);
-    if (BL_GetACK(2) != brNONE) return 0;
+    // the bootloader only answers a buffer setup it rejects, and does so straight away, so one start bit timeout
+    // is enough to tell. Every block flashed used to sit out two.
+    if (BL_GetACK(1) != brNONE) return 0;
     BL_SendBuf(pMem->D_PTR_I, pMem->D_NUM_BYTES);
     return (BL_GetACK(40) == brSUCCESS);
 }
 
 static uint8_t BL_ReadA(uint8_t cmd, ioMem_t *pMem)
 {
+    if (selected_esc == ESC4WAY_BROADCAST) {
+        return 0;
+    }
     if (BL_SendCMDSetAddress(pMem)) {
         uint8_t sCMD[] = {cmd, pMem->D_NUM_BYTES};
         BL_SendBuf(sCMD, 2);
@@ -23,7 +23,11 @@ typedef struct {
     IO_t io;
 } escHardware_t;
 
+// cmd_DeviceInitFlash channel that connects every ESC and sends them identical writes at once, reads are refused
+#define ESC4WAY_BROADCAST 0xFF
+
 extern uint8_t selected_esc;
+extern uint8_t escCount;
 
 bool isEscHi(uint8_t selEsc);
 bool isEscLo(uint8_t selEsc);
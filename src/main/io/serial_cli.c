@@ -33,6 +33,7 @@ uint8_t cliMode = 0;
 
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/profile.h"
 #include "build/version.h"
 
 #include "cms/cms.h"
@@ -56,6 +57,8 @@ uint8_t cliMode = 0;
 #include "drivers/flash.h"
 #include "drivers/io.h"
 #include "drivers/io_impl.h"
+#include "drivers/memory_report.h"
+#include "drivers/pwm_output.h"
 #include "drivers/rx_pwm.h"
 #include "drivers/sdcard.h"
 #include "drivers/sensor.h"
@@ -67,6 +70,10 @@ uint8_t cliMode = 0;
 #include "drivers/vcd.h"
 
 #include "fc/config.h"
+#include "fc/fc_init.h"
+#include "fc/loop_latency.h"
+#include "fc/loop_rate.h"
+#include "fc/post_mortem.h"
 #include "fc/rc_controls.h"
 #include "fc/runtime_config.h"
 
@@ -84,6 +91,7 @@ uint8_t cliMode = 0;
 #include "io/ledstrip.h"
 #include "io/motors.h"
 #include "io/osd.h"
+#include "io/sdcard_profiler.h"
 #include "io/serial.h"
 #include "io/serial_cli.h"
 #include "io/servos.h"
@@ -114,6 +122,12 @@ static uint8_t cliWriteBuffer[sizeof(*cliWriter) + 128];
 static char cliBuffer[48];
 static uint32_t bufferIndex = 0;
 
+// Between 'batch start' and 'batch end' lines aren't echoed and nothing is confirmed, only errors are printed,
+// each with its line number. The changes are saved, or discarded after any error, by 'batch end'.
+static bool cliBatchMode = false;
+static uint16_t cliBatchLines;
+static uint16_t cliBatchErrors;
+
 typedef enum {
     DUMP_MASTER = (1 << 0),
     DUMP_PROFILE = (1 << 1),
@@ -238,6 +252,10 @@ static const char * const lookupTableGPSProvider[] = {
 static const char * const lookupTableGPSSBASMode[] = {
     "AUTO", "EGNOS", "WAAS", "MSAS", "GAGAN"
 };
+
+static const char * const lookupTableGPSUbloxNavRate[] = {
+    "5HZ", "10HZ", "18HZ", "25HZ"
+};
 #endif
 
 static const char * const lookupTableCurrentSensor[] = {
@@ -261,6 +279,7 @@ static const char * const lookupTableBlackboxDevice[] = {
 #endif
 
 #ifdef SERIAL_RX
+// the last entry, NONE, is only offered for serialrx_provider2
 static const char * const lookupTableSerialRX[] = {
     "SPEK1024",
     "SPEK2048",
@@ -271,7 +290,8 @@ static const char * const lookupTableSerialRX[] = {
     "XB-B-RJ01",
     "IBUS",
     "JETIEXBUS",
-    "CRSF"
+    "CRSF",
+    "NONE"
 };
 #endif
 
@@ -316,7 +336,14 @@ static const char * const lookupTableDebug[DEBUG_COUNT] = {
     "ANGLERATE",
     "ESC_SENSOR",
     "SCHEDULER",
-    "STACK"
+    "STACK",
+    "FFT",
+    "LOOP_JITTER",
+    "LOOP_LATENCY",
+    "DSHOT_RPM",
+    "RPM_FILTER",
+    "DUAL_GYRO",
+    "GYRO_PHASE"
 };
 
 #ifdef OSD
@@ -339,7 +366,7 @@ static const char * const lookupTablePwmProtocol[] = {
 };
 
 static const char * const lookupTableRcInterpolation[] = {
-    "OFF", "PRESET", "AUTO", "MANUAL"
+    "OFF", "PRESET", "AUTO", "MANUAL", "PREDICTIVE"
 };
 
 static const char * const lookupTableLowpassType[] = {
@@ -350,6 +377,24 @@ static const char * const lookupTableFailsafe[] = {
     "AUTO-LAND", "DROP"
 };
 
+static const char * const lookupTableGyroOverflow[] = {
+    "OFF", "ITERM", "CLAMP", "ITERM_CLAMP"
+};
+
+#ifdef USE_DUAL_GYRO
+static const char * const lookupTableGyroToUse[] = {
+    "FIRST", "SECOND", "BOTH"
+};
+
+static const char * const lookupTableGyroFusion[] = {
+    "AVERAGE", "HEALTH"
+};
+#endif
+
+static const char * const lookupTableItermRelax[] = {
+    "OFF", "RP", "RPY"
+};
+
 typedef struct lookupTableEntry_s {
     const char * const *values;
     const uint8_t valueCount;
@@ -362,6 +407,7 @@ typedef enum {
 #ifdef GPS
     TABLE_GPS_PROVIDER,
     TABLE_GPS_SBAS_MODE,
+    TABLE_GPS_UBLOX_NAV_RATE,
 #endif
 #ifdef BLACKBOX
     TABLE_BLACKBOX_DEVICE,
@@ -373,6 +419,7 @@ typedef enum {
 #endif
 #ifdef SERIAL_RX
     TABLE_SERIAL_RX,
+    TABLE_SERIAL_RX_SECONDARY,
 #endif
 #ifdef USE_RX_SPI
     TABLE_RX_SPI,
@@ -391,9 +438,15 @@ typedef enum {
     TABLE_RC_INTERPOLATION,
     TABLE_LOWPASS_TYPE,
     TABLE_FAILSAFE,
+    TABLE_GYRO_OVERFLOW,
+    TABLE_ITERM_RELAX,
 #ifdef OSD
     TABLE_OSD,
 #endif
+#ifdef USE_DUAL_GYRO
+    TABLE_GYRO_TO_USE,
+    TABLE_GYRO_FUSION,
+#endif
 } lookupTableIndex_e;
 
 static const lookupTableEntry_t lookupTables[] = {
@@ -403,6 +456,7 @@ static const lookupTableEntry_t lookupTables[] = {
 #ifdef GPS
     { lookupTableGPSProvider, sizeof(lookupTableGPSProvider) / sizeof(char *) },
     { lookupTableGPSSBASMode, sizeof(lookupTableGPSSBASMode) / sizeof(char *) },
+    { lookupTableGPSUbloxNavRate, sizeof(lookupTableGPSUbloxNavRate) / sizeof(char *) },
 #endif
 #ifdef BLACKBOX
     { lookupTableBlackboxDevice, sizeof(lookupTableBlackboxDevice) / sizeof(char *) },
@@ -413,6 +467,7 @@ static const lookupTableEntry_t lookupTables[] = {
     { lookupTableGimbalMode, sizeof(lookupTableGimbalMode) / sizeof(char *) },
 #endif
 #ifdef SERIAL_RX
+    { lookupTableSerialRX, sizeof(lookupTableSerialRX) / sizeof(char *) - 1 },
     { lookupTableSerialRX, sizeof(lookupTableSerialRX) / sizeof(char *) },
 #endif
 #ifdef USE_RX_SPI
@@ -432,9 +487,15 @@ static const lookupTableEntry_t lookupTables[] = {
     { lookupTableRcInterpolation, sizeof(lookupTableRcInterpolation) / sizeof(char *) },
     { lookupTableLowpassType, sizeof(lookupTableLowpassType) / sizeof(char *) },
     { lookupTableFailsafe, sizeof(lookupTableFailsafe) / sizeof(char *) },
+    { lookupTableGyroOverflow, sizeof(lookupTableGyroOverflow) / sizeof(char *) },
+    { lookupTableItermRelax, sizeof(lookupTableItermRelax) / sizeof(char *) },
 #ifdef OSD
     { lookupTableOsdType, sizeof(lookupTableOsdType) / sizeof(char *) },
 #endif
+#ifdef USE_DUAL_GYRO
+    { lookupTableGyroToUse, sizeof(lookupTableGyroToUse) / sizeof(char *) },
+    { lookupTableGyroFusion, sizeof(lookupTableGyroFusion) / sizeof(char *) },
+#endif
 };
 
 #define VALUE_TYPE_OFFSET 0
@@ -499,6 +560,7 @@ const clivalue_t valueTable[] = {
     { "roll_yaw_cam_mix_degrees",   VAR_UINT8  | MASTER_VALUE,  &rxConfig()->fpvCamAngleDegrees, .config.minmax = { 0,  50 } },
     { "max_aux_channels",           VAR_UINT8  | MASTER_VALUE,  &rxConfig()->max_aux_channel, .config.minmax = { 0,  13 } },
     { "debug_mode",                 VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &masterConfig.debug_mode, .config.lookup = { TABLE_DEBUG } },
+    { "idle_sleep",                 VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &masterConfig.idle_sleep, .config.lookup = { TABLE_OFF_ON } },
 
     { "min_throttle",               VAR_UINT16 | MASTER_VALUE,  &motorConfig()->minthrottle, .config.minmax = { PWM_RANGE_ZERO,  PWM_RANGE_MAX } },
     { "max_throttle",               VAR_UINT16 | MASTER_VALUE,  &motorConfig()->maxthrottle, .config.minmax = { PWM_RANGE_ZERO,  PWM_RANGE_MAX } },
@@ -513,7 +575,14 @@ const clivalue_t valueTable[] = {
 
     { "use_unsynced_pwm",           VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &motorConfig()->useUnsyncedPwm, .config.lookup = { TABLE_OFF_ON } },
     { "motor_pwm_protocol",         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &motorConfig()->motorPwmProtocol, .config.lookup = { TABLE_MOTOR_PWM_PROTOCOL } },
+    { "motor_sync_to_gyro",         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &motorConfig()->useSyncedOutput, .config.lookup = { TABLE_OFF_ON } },
     { "motor_pwm_rate",             VAR_UINT16 | MASTER_VALUE,  &motorConfig()->motorPwmRate, .config.minmax = { 200, 32000 } },
+#ifdef USE_DSHOT_DMAR
+    { "dshot_burst",                VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &motorConfig()->useBurstDshot, .config.lookup = { TABLE_OFF_ON } },
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+    { "dshot_bidir",                VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &motorConfig()->useDshotTelemetry, .config.lookup = { TABLE_OFF_ON } },
+#endif
 
     { "disarm_kill_switch",         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &armingConfig()->disarm_kill_switch, .config.lookup = { TABLE_OFF_ON } },
     { "gyro_cal_on_first_arm",      VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &armingConfig()->gyro_cal_on_first_arm, .config.lookup = { TABLE_OFF_ON } },
@@ -529,6 +598,7 @@ const clivalue_t valueTable[] = {
     { "gps_sbas_mode",              VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gpsConfig()->sbasMode, .config.lookup = { TABLE_GPS_SBAS_MODE } },
     { "gps_auto_config",            VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gpsConfig()->autoConfig, .config.lookup = { TABLE_OFF_ON } },
     { "gps_auto_baud",              VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gpsConfig()->autoBaud, .config.lookup = { TABLE_OFF_ON } },
+    { "gps_ublox_nav_rate",         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gpsConfig()->ubloxNavRate, .config.lookup = { TABLE_GPS_UBLOX_NAV_RATE } },
 
     { "gps_pos_p",                  VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.P8[PIDPOS], .config.minmax = { 0,  200 } },
     { "gps_pos_i",                  VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.I8[PIDPOS], .config.minmax = { 0,  200 } },
@@ -553,6 +623,7 @@ const clivalue_t valueTable[] = {
 
 #ifdef SERIAL_RX
     { "serialrx_provider",          VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &rxConfig()->serialrx_provider, .config.lookup = { TABLE_SERIAL_RX } },
+    { "serialrx_provider2",         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &rxConfig()->serialrx_provider2, .config.lookup = { TABLE_SERIAL_RX_SECONDARY } },
 #endif
 
     { "sbus_inversion",             VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &rxConfig()->sbus_inversion, .config.lookup = { TABLE_OFF_ON } },
@@ -592,6 +663,9 @@ const clivalue_t valueTable[] = {
     { "use_consumption_alerts",     VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &batteryConfig()->useConsumptionAlerts, .config.lookup = { TABLE_OFF_ON } },
     { "consumption_warning_percentage", VAR_UINT8  | MASTER_VALUE, &batteryConfig()->consumptionWarningPercentage, .config.minmax = { 0, 100 } },
     { "align_gyro",                 VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_align, .config.lookup = { TABLE_ALIGNMENT } },
+#ifdef USE_DUAL_GYRO
+    { "align_gyro_2",               VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_2_align, .config.lookup = { TABLE_ALIGNMENT } },
+#endif
     { "align_acc",                  VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &accelerometerConfig()->acc_align, .config.lookup = { TABLE_ALIGNMENT } },
     { "align_mag",                  VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &compassConfig()->mag_align, .config.lookup = { TABLE_ALIGNMENT } },
 
@@ -607,7 +681,32 @@ const clivalue_t valueTable[] = {
     { "gyro_notch1_cutoff",         VAR_UINT16 | MASTER_VALUE,  &gyroConfig()->gyro_soft_notch_cutoff_1, .config.minmax = { 1,  1000 } },
     { "gyro_notch2_hz",             VAR_UINT16 | MASTER_VALUE,  &gyroConfig()->gyro_soft_notch_hz_2, .config.minmax = { 0,  1000 } },
     { "gyro_notch2_cutoff",         VAR_UINT16 | MASTER_VALUE,  &gyroConfig()->gyro_soft_notch_cutoff_2, .config.minmax = { 1, 1000 } },
+#ifdef USE_GYRO_DMA
+    { "gyro_dma",                   VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_use_dma, .config.lookup = { TABLE_OFF_ON } },
+#endif
+#ifdef USE_GYRO_DATA_ANALYSE
+    { "gyro_notch_dynamic",         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_soft_notch_dynamic, .config.lookup = { TABLE_OFF_ON } },
+#endif
+#ifdef USE_RPM_FILTER
+    { "gyro_rpm_notch_harmonics",   VAR_UINT8  | MASTER_VALUE,  &gyroConfig()->gyro_rpm_notch_harmonics, .config.minmax = { 0,  3 } },
+    { "gyro_rpm_notch_min_hz",      VAR_UINT8  | MASTER_VALUE,  &gyroConfig()->gyro_rpm_notch_min_hz, .config.minmax = { 50,  200 } },
+    { "gyro_rpm_notch_q",           VAR_UINT16 | MASTER_VALUE,  &gyroConfig()->gyro_rpm_notch_q, .config.minmax = { 100,  3000 } },
+    { "motor_poles",                VAR_UINT8  | MASTER_VALUE,  &motorConfig()->motorPoleCount, .config.minmax = { 4,  64 } },
+    { "thrust_linear",              VAR_UINT8  | MASTER_VALUE,  &motorConfig()->thrustLinearization, .config.minmax = { 0,  100 } },
+#endif
+#ifdef USE_DUAL_GYRO
+    { "gyro_to_use",                VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_to_use, .config.lookup = { TABLE_GYRO_TO_USE } },
+    { "gyro_fusion",                VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_fusion, .config.lookup = { TABLE_GYRO_FUSION } },
+#endif
+#ifdef USE_LOOP_LATENCY
+    { "gyro_phase_lock",            VAR_UINT8  | MASTER_VALUE,  &gyroConfig()->gyro_phase_lock, .config.minmax = { 0,  100 } },
+#endif
+#ifdef USE_GYRO_FIFO
+    { "gyro_fifo",                  VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_use_fifo, .config.lookup = { TABLE_OFF_ON } },
+#endif
     { "moron_threshold",            VAR_UINT8  | MASTER_VALUE,  &gyroConfig()->gyroMovementCalibrationThreshold, .config.minmax = { 0,  128 } },
+    { "gyro_cal_stored_bias",       VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_cal_stored_bias, .config.lookup = { TABLE_OFF_ON } },
+    { "gyro_overflow_response",     VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &gyroConfig()->gyro_overflow_response, .config.lookup = { TABLE_GYRO_OVERFLOW } },
     { "imu_dcm_kp",                 VAR_UINT16 | MASTER_VALUE,  &imuConfig()->dcm_kp, .config.minmax = { 0,  50000 } },
     { "imu_dcm_ki",                 VAR_UINT16 | MASTER_VALUE,  &imuConfig()->dcm_ki, .config.minmax = { 0,  50000 } },
 
@@ -655,6 +754,7 @@ const clivalue_t valueTable[] = {
 
     { "rx_min_usec",                VAR_UINT16 | MASTER_VALUE,  &rxConfig()->rx_min_usec, .config.minmax = { PWM_PULSE_MIN,  PWM_PULSE_MAX } },
     { "rx_max_usec",                VAR_UINT16 | MASTER_VALUE,  &rxConfig()->rx_max_usec, .config.minmax = { PWM_PULSE_MIN,  PWM_PULSE_MAX } },
+    { "rx_loss_frames",             VAR_UINT8  | MASTER_VALUE,  &rxConfig()->rx_loss_frames, .config.minmax = { 0,  100 } },
 
     { "acc_hardware",               VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &accelerometerConfig()->acc_hardware, .config.lookup = { TABLE_ACC_HARDWARE } },
     { "acc_lpf_hz",                 VAR_UINT16 | MASTER_VALUE, &accelerometerConfig()->acc_lpf_hz, .config.minmax = { 0,  400 } },
@@ -678,6 +778,7 @@ const clivalue_t valueTable[] = {
 #endif
     { "dterm_lowpass_type",         VAR_UINT8  | PROFILE_VALUE | MODE_LOOKUP, &masterConfig.profile[0].pidProfile.dterm_filter_type, .config.lookup = { TABLE_LOWPASS_TYPE } },
     { "dterm_lowpass",              VAR_INT16  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.dterm_lpf_hz, .config.minmax = {0, 500 } },
+    { "dterm_lowpass_max",          VAR_UINT16 | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.dterm_lpf_max_hz, .config.minmax = {0, 500 } },
     { "dterm_notch_hz",             VAR_UINT16 | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.dterm_notch_hz, .config.minmax = { 0,  500 } },
     { "dterm_notch_cutoff",         VAR_UINT16 | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.dterm_notch_cutoff, .config.minmax = { 1,  500 } },
     { "vbat_pid_compensation",      VAR_UINT8  | PROFILE_VALUE | MODE_LOOKUP, &masterConfig.profile[0].pidProfile.vbatPidCompensation, .config.lookup = { TABLE_OFF_ON } },
@@ -685,13 +786,35 @@ const clivalue_t valueTable[] = {
     { "anti_gravity_threshold",     VAR_UINT16 | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.itermThrottleThreshold, .config.minmax = {20, 1000 } },
     { "setpoint_relax_ratio",       VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.setpointRelaxRatio, .config.minmax = {0, 100 } },
     { "dterm_setpoint_weight",      VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.dtermSetpointWeight, .config.minmax = {0, 255 } },
+    { "feedforward_weight",         VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.feedForwardWeight, .config.minmax = {0, 255 } },
+    { "feedforward_lpf_hz",         VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.feedForwardLpfHz, .config.minmax = {0, 255 } },
     { "yaw_accel_limit",            VAR_FLOAT  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.yawRateAccelLimit, .config.minmax = {0.1f, 50.0f } },
     { "accel_limit",                VAR_FLOAT  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.rateAccelLimit, .config.minmax = {0.1f, 50.0f } },
 
     { "accum_threshold",            VAR_UINT16 | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.rollPitchItermIgnoreRate, .config.minmax = {15, 1000 } },
     { "yaw_accum_threshold",        VAR_UINT16 | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.yawItermIgnoreRate, .config.minmax = {15, 1000 } },
+    { "iterm_relax",                VAR_UINT8  | PROFILE_VALUE | MODE_LOOKUP, &masterConfig.profile[0].pidProfile.itermRelax, .config.lookup = { TABLE_ITERM_RELAX } },
+    { "iterm_relax_cutoff",         VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.itermRelaxCutoff, .config.minmax = { 1, 100 } },
     { "yaw_lowpass",                VAR_UINT16 | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.yaw_lpf_hz, .config.minmax = {0, 500 } },
     { "pid_process_denom",          VAR_UINT8  | MASTER_VALUE,  &pidConfig()->pid_process_denom, .config.minmax = { 1,  8 } },
+#ifdef USE_PID_LOOP_INTERRUPT
+    { "pid_in_interrupt",           VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &pidConfig()->pid_in_interrupt, .config.lookup = { TABLE_OFF_ON } },
+#ifdef USE_LOOP_RATE_AUTO
+    { "loop_rate_auto",             VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &pidConfig()->loop_rate_auto, .config.lookup = { TABLE_OFF_ON } },
+    { "loop_rate_headroom",         VAR_UINT8  | MASTER_VALUE,  &pidConfig()->loop_rate_headroom, .config.minmax = { 5,  90 } },
+#endif
+#endif
+
+    { "shed_overload_pct",          VAR_UINT8  | MASTER_VALUE,  &taskSheddingConfig()->overloadPercent, .config.minmax = { 0, 250 } },
+    { "shed_recover_pct",           VAR_UINT8  | MASTER_VALUE,  &taskSheddingConfig()->recoverPercent, .config.minmax = { 0, 250 } },
+    { "shed_ledstrip_min_hz",       VAR_UINT16 | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_LEDSTRIP].minRateHz, .config.minmax = { 1, 1000 } },
+    { "shed_ledstrip_priority",     VAR_UINT8  | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_LEDSTRIP].priority, .config.minmax = { 0, TASK_SHED_COUNT } },
+    { "shed_dashboard_min_hz",      VAR_UINT16 | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_DASHBOARD].minRateHz, .config.minmax = { 1, 1000 } },
+    { "shed_dashboard_priority",    VAR_UINT8  | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_DASHBOARD].priority, .config.minmax = { 0, TASK_SHED_COUNT } },
+    { "shed_telemetry_min_hz",      VAR_UINT16 | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_TELEMETRY].minRateHz, .config.minmax = { 1, 1000 } },
+    { "shed_telemetry_priority",    VAR_UINT8  | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_TELEMETRY].priority, .config.minmax = { 0, TASK_SHED_COUNT } },
+    { "shed_osd_min_hz",            VAR_UINT16 | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_OSD].minRateHz, .config.minmax = { 1, 1000 } },
+    { "shed_osd_priority",          VAR_UINT8  | MASTER_VALUE,  &taskSheddingConfig()->task[TASK_SHED_OSD].priority, .config.minmax = { 0, TASK_SHED_COUNT } },
 
     { "p_pitch",                    VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.P8[PITCH], .config.minmax = { 0,  200 } },
     { "i_pitch",                    VAR_UINT8  | PROFILE_VALUE, &masterConfig.profile[0].pidProfile.I8[PITCH], .config.minmax = { 0,  200 } },
@@ -723,6 +846,19 @@ const clivalue_t valueTable[] = {
     { "blackbox_rate_denom",        VAR_UINT8  | MASTER_VALUE,  &blackboxConfig()->rate_denom, .config.minmax = { 1,  32 } },
     { "blackbox_device",            VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &blackboxConfig()->device, .config.lookup = { TABLE_BLACKBOX_DEVICE } },
     { "blackbox_on_motor_test",     VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &blackboxConfig()->on_motor_test, .config.lookup = { TABLE_OFF_ON } },
+    { "blackbox_disabled_fields",   VAR_UINT16 | MASTER_VALUE,  &blackboxConfig()->fields_disabled_mask, .config.minmax = { 0,  BLACKBOX_FIELD_GROUP_ALL_MASK } },
+    { "blackbox_fast_stream",       VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &blackboxConfig()->fast_stream, .config.lookup = { TABLE_OFF_ON } },
+    { "blackbox_serial_flow_control", VAR_UINT8 | MASTER_VALUE | MODE_LOOKUP, &blackboxConfig()->serial_flow_control, .config.lookup = { TABLE_OFF_ON } },
+#ifdef USE_BLACKBOX_COMPRESSION
+    { "blackbox_compression",       VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &blackboxConfig()->compression, .config.lookup = { TABLE_OFF_ON } },
+#endif
+#ifdef USE_FLASHFS
+    { "blackbox_flash_ring",        VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &blackboxConfig()->flash_ring, .config.lookup = { TABLE_OFF_ON } },
+#endif
+#ifdef USE_BLACKBOX_CAPTURE
+    { "blackbox_capture",           VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP,  &blackboxConfig()->capture, .config.lookup = { TABLE_OFF_ON } },
+    { "blackbox_capture_crash_rate", VAR_UINT16 | MASTER_VALUE,  &blackboxConfig()->capture_crash_rate, .config.minmax = { 0,  2000 } },
+#endif
 #endif
 
 #ifdef VTX
@@ -746,6 +882,9 @@ const clivalue_t valueTable[] = {
 #endif
 #ifdef USE_SDCARD
     { "sdcard_dma",                 VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &sdcardConfig()->useDma, .config.lookup = { TABLE_OFF_ON } },
+#ifdef USE_SDCARD_PROFILER
+    { "sdcard_benchmark",           VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &sdcardConfig()->benchmark, .config.lookup = { TABLE_OFF_ON } },
+#endif
 #endif
 #ifdef OSD
     { "osd_units",                  VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, &osdProfile()->units, .config.lookup = { TABLE_UNIT } },
@@ -774,22 +913,108 @@ const clivalue_t valueTable[] = {
     { "osd_pid_pitch_pos",          VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_pos[OSD_PITCH_PIDS], .config.minmax = { 0, UINT16_MAX } },
     { "osd_pid_yaw_pos",            VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_pos[OSD_YAW_PIDS], .config.minmax = { 0, UINT16_MAX } },
     { "osd_power_pos",              VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_pos[OSD_POWER], .config.minmax = { 0, UINT16_MAX } },
+    { "osd_esc_tmp_pos",            VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_pos[OSD_ESC_TMP], .config.minmax = { 0, UINT16_MAX } },
+    { "osd_esc_rpm_pos",            VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_pos[OSD_ESC_RPM], .config.minmax = { 0, UINT16_MAX } },
+    { "osd_sdcard_pos",             VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_pos[OSD_SDCARD], .config.minmax = { 0, UINT16_MAX } },
+    { "osd_loop_rate_pos",          VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_pos[OSD_LOOP_RATE], .config.minmax = { 0, UINT16_MAX } },
+    { "osd_main_voltage_interval",  VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_MAIN_BATT_VOLTAGE], .config.minmax = { 0, 10000 } },
+    { "osd_rssi_interval",          VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_RSSI_VALUE], .config.minmax = { 0, 10000 } },
+    { "osd_flytimer_interval",      VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_FLYTIME], .config.minmax = { 0, 10000 } },
+    { "osd_ontime_interval",        VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_ONTIME], .config.minmax = { 0, 10000 } },
+    { "osd_flymode_interval",       VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_FLYMODE], .config.minmax = { 0, 10000 } },
+    { "osd_throttle_interval",      VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_THROTTLE_POS], .config.minmax = { 0, 10000 } },
+    { "osd_vtx_channel_interval",   VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_VTX_CHANNEL], .config.minmax = { 0, 10000 } },
+    { "osd_crosshairs_interval",    VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_CROSSHAIRS], .config.minmax = { 0, 10000 } },
+    { "osd_horizon_interval",       VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_ARTIFICIAL_HORIZON], .config.minmax = { 0, 10000 } },
+    { "osd_current_draw_interval",  VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_CURRENT_DRAW], .config.minmax = { 0, 10000 } },
+    { "osd_mah_drawn_interval",     VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_MAH_DRAWN], .config.minmax = { 0, 10000 } },
+    { "osd_craft_name_interval",    VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_CRAFT_NAME], .config.minmax = { 0, 10000 } },
+    { "osd_gps_speed_interval",     VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_GPS_SPEED], .config.minmax = { 0, 10000 } },
+    { "osd_gps_sats_interval",      VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_GPS_SATS], .config.minmax = { 0, 10000 } },
+    { "osd_altitude_interval",      VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_ALTITUDE], .config.minmax = { 0, 10000 } },
+    { "osd_pid_roll_interval",      VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_ROLL_PIDS], .config.minmax = { 0, 10000 } },
+    { "osd_pid_pitch_interval",     VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_PITCH_PIDS], .config.minmax = { 0, 10000 } },
+    { "osd_pid_yaw_interval",       VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_YAW_PIDS], .config.minmax = { 0, 10000 } },
+    { "osd_power_interval",         VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_POWER], .config.minmax = { 0, 10000 } },
+    { "osd_esc_tmp_interval",       VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_ESC_TMP], .config.minmax = { 0, 10000 } },
+    { "osd_esc_rpm_interval",       VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_ESC_RPM], .config.minmax = { 0, 10000 } },
+    { "osd_sdcard_interval",        VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_SDCARD], .config.minmax = { 0, 10000 } },
+    { "osd_loop_rate_interval",     VAR_UINT16  | MASTER_VALUE, &osdProfile()->item_interval[OSD_LOOP_RATE], .config.minmax = { 0, 10000 } },
 #endif
 #ifdef USE_MAX7456
     { "vcd_video_system",           VAR_UINT8   | MASTER_VALUE, &vcdProfile()->video_system, .config.minmax = { 0, 2 } },
     { "vcd_h_offset",               VAR_INT8    | MASTER_VALUE, &vcdProfile()->h_offset, .config.minmax = { -32, 31 } },
     { "vcd_v_offset",               VAR_INT8    | MASTER_VALUE, &vcdProfile()->v_offset, .config.minmax = { -15, 16 } },
 #endif
+#ifdef USE_MSP_DISPLAYPORT
+    { "displayport_msp_batch",      VAR_UINT8   | MASTER_VALUE | MODE_LOOKUP, &masterConfig.displayport_msp_batch, .config.lookup = { TABLE_OFF_ON } },
+#endif
 };
 
 #define VALUE_COUNT (sizeof(valueTable) / sizeof(clivalue_t))
 
+// valueTable stays in dump order, set looks names up in this index sorted a..z
+static uint16_t valueTableSorted[VALUE_COUNT];
+static bool valueTableSortedValid = false;
+
+static void cliSortValueTable(void)
+{
+    if (valueTableSortedValid) {
+        return;
+    }
+    for (uint32_t i = 0; i < VALUE_COUNT; i++) {
+        const uint16_t index = i;
+        uint32_t j = i;
+        while (j > 0 && strcasecmp(valueTable[valueTableSorted[j - 1]].name, valueTable[index].name) > 0) {
+            valueTableSorted[j] = valueTableSorted[j - 1];
+            j--;
+        }
+        valueTableSorted[j] = index;
+    }
+    valueTableSortedValid = true;
+}
+
+static const clivalue_t *cliFindValue(const char *name, uint8_t length)
+{
+    cliSortValueTable();
+
+    uint32_t low = 0;
+    uint32_t high = VALUE_COUNT;
+    while (low < high) {
+        const uint32_t mid = (low + high) / 2;
+        const clivalue_t *value = &valueTable[valueTableSorted[mid]];
+        int cmp = strncasecmp(name, value->name, length);
+        if (cmp == 0 && value->name[length] != '\0') {
+            // name is a prefix of the entry, so sorts before it
+            cmp = -1;
+        }
+        if (cmp == 0) {
+            return value;
+        } else if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+// set while a dump is printed, output then only goes to the port a full buffer at a time instead of every line
+static bool cliOutputBatched = false;
+
+static void cliFlush(void)
+{
+    if (!cliOutputBatched) {
+        bufWriterFlush(cliWriter);
+    }
+}
+
 static void cliPrint(const char *str)
 {
     while (*str) {
         bufWriterAppend(cliWriter, *str++);
     }
-    bufWriterFlush(cliWriter);
+    cliFlush();
 }
 
 #ifdef CLI_MINIMAL_VERBOSITY
@@ -803,9 +1028,9 @@ static void cliPrintHashLine(const char *str)
 }
 #endif
 
-static void cliPutp(void *p, char ch)
+static void cliWriteFormatted(void *p, const char *data, int len)
 {
-    bufWriterAppend(p, ch);
+    bufWriterAppendBuf(p, (const uint8_t *)data, len);
 }
 
 static bool cliDumpPrintf(uint8_t dumpMask, bool equalsDefault, const char *format, ...)
@@ -813,9 +1038,9 @@ static bool cliDumpPrintf(uint8_t dumpMask, bool equalsDefault, const char *form
     if (!((dumpMask & DO_DIFF) && equalsDefault)) {
         va_list va;
         va_start(va, format);
-        tfp_format(cliWriter, cliPutp, format, va);
+        tfp_format_buffered(cliWriter, cliWriteFormatted, format, va);
         va_end(va);
-        bufWriterFlush(cliWriter);
+        cliFlush();
         return true;
     } else {
         return false;
@@ -834,9 +1059,9 @@ static bool cliDefaultPrintf(uint8_t dumpMask, bool equalsDefault, const char *f
 
         va_list va;
         va_start(va, format);
-        tfp_format(cliWriter, cliPutp, format, va);
+        tfp_format_buffered(cliWriter, cliWriteFormatted, format, va);
         va_end(va);
-        bufWriterFlush(cliWriter);
+        cliFlush();
         return true;
     } else {
         return false;
@@ -847,9 +1072,9 @@ static void cliPrintf(const char *format, ...)
 {
     va_list va;
     va_start(va, format);
-    tfp_format(cliWriter, cliPutp, format, va);
+    tfp_format_buffered(cliWriter, cliWriteFormatted, format, va);
     va_end(va);
-    bufWriterFlush(cliWriter);
+    cliFlush();
 }
 
 static void printValuePointer(const clivalue_t *var, void *valuePointer, uint32_t full)
@@ -900,30 +1125,34 @@ static void printValuePointer(const clivalue_t *var, void *valuePointer, uint32_
     }
 }
 
-void *getValuePointer(const clivalue_t *value)
+// dumps print every profile through this, so the profile in use never has to be switched
+static void *getProfileValuePointer(const clivalue_t *value, uint8_t profileIndex, uint8_t rateProfileIndex)
 {
     void *ptr = value->ptr;
 
     if ((value->type & VALUE_SECTION_MASK) == PROFILE_VALUE) {
-        ptr = ((uint8_t *)ptr) + (sizeof(profile_t) * masterConfig.current_profile_index);
+        ptr = ((uint8_t *)ptr) + (sizeof(profile_t) * profileIndex);
     }
 
     if ((value->type & VALUE_SECTION_MASK) == PROFILE_RATE_VALUE) {
-        ptr = ((uint8_t *)ptr) + (sizeof(profile_t) * masterConfig.current_profile_index) + (sizeof(controlRateConfig_t) * getCurrentControlRateProfile());
+        ptr = ((uint8_t *)ptr) + (sizeof(profile_t) * profileIndex) + (sizeof(controlRateConfig_t) * rateProfileIndex);
     }
 
     return ptr;
 }
 
-static void *getDefaultPointer(void *valuePointer, const master_t *defaultConfig)
+void *getValuePointer(const clivalue_t *value)
 {
-    return ((uint8_t *)valuePointer) - (uint32_t)&masterConfig + (uint32_t)defaultConfig;
+    return getProfileValuePointer(value, masterConfig.current_profile_index, getCurrentControlRateProfile());
 }
 
-static bool valueEqualsDefault(const clivalue_t *value, const master_t *defaultConfig)
+static void *getDefaultPointer(void *valuePointer, const master_t *defaultConfig)
 {
-    void *ptr = getValuePointer(value);
+    return ((uint8_t *)valuePointer) - (uintptr_t)&masterConfig + (uintptr_t)defaultConfig;
+}
 
+static bool valueEqualsDefault(const clivalue_t *value, void *ptr, const master_t *defaultConfig)
+{
     void *ptrDefault = getDefaultPointer(ptr, defaultConfig);
 
     bool result = false;
@@ -962,16 +1191,7 @@ static void cliPrintVar(const clivalue_t *var, uint32_t full)
     printValuePointer(var, ptr, full);
 }
 
-static void cliPrintVarDefault(const clivalue_t *var, uint32_t full, const master_t *defaultConfig)
-{
-    void *ptr = getValuePointer(var);
-
-    void *defaultPtr = getDefaultPointer(ptr, defaultConfig);
-
-    printValuePointer(var, defaultPtr, full);
-}
-
-static void dumpValues(uint16_t valueSection, uint8_t dumpMask, const master_t *defaultConfig)
+static void dumpValues(uint16_t valueSection, uint8_t dumpMask, const master_t *defaultConfig, uint8_t profileIndex, uint8_t rateProfileIndex)
 {
     const clivalue_t *value;
     for (uint32_t i = 0; i < VALUE_COUNT; i++) {
@@ -981,13 +1201,16 @@ static void dumpValues(uint16_t valueSection, uint8_t dumpMask, const master_t *
             continue;
         }
 
+        void *ptr = getProfileValuePointer(value, profileIndex, rateProfileIndex);
+        const bool equalsDefault = valueEqualsDefault(value, ptr, defaultConfig);
+
         const char *format = "set %s = ";
-        if (cliDefaultPrintf(dumpMask, valueEqualsDefault(value, defaultConfig), format, valueTable[i].name)) {
-            cliPrintVarDefault(value, 0, defaultConfig);
+        if (cliDefaultPrintf(dumpMask, equalsDefault, format, valueTable[i].name)) {
+            printValuePointer(value, getDefaultPointer(ptr, defaultConfig), 0);
             cliPrint("\r\n");
         }
-        if (cliDumpPrintf(dumpMask, valueEqualsDefault(value, defaultConfig), format, valueTable[i].name)) {
-            cliPrintVar(value, 0);
+        if (cliDumpPrintf(dumpMask, equalsDefault, format, valueTable[i].name)) {
+            printValuePointer(value, ptr, 0);
             cliPrint("\r\n");
         }
     }
@@ -1065,13 +1288,29 @@ static void cliPrompt(void)
     cliPrint("\r\n# ");
 }
 
+// counts an error in batch mode, and names the line as it wasn't echoed
+static void cliBatchNoteError(void)
+{
+    if (cliBatchMode) {
+        cliBatchErrors++;
+        cliPrintf("line %d: ", cliBatchLines);
+    }
+}
+
+static void cliPrintError(const char *str)
+{
+    cliBatchNoteError();
+    cliPrint(str);
+}
+
 static void cliShowParseError(void)
 {
-    cliPrint("Parse error\r\n");
+    cliPrintError("Parse error\r\n");
 }
 
 static void cliShowArgumentRangeError(char *name, int min, int max)
 {
+    cliBatchNoteError();
     cliPrintf("%s must be between %d and %d\r\n", name, min, max);
 }
 
@@ -1237,6 +1476,37 @@ static void cliRxFail(char *cmdline)
     }
 }
 
+#ifdef SERIAL_RX
+static void cliRxLink(char *cmdline)
+{
+    UNUSED(cmdline);
+
+    const rxFrameStats_t *frameStats = rxGetFrameStats();
+    cliPrintf("Frame interval %dus, %u frames missed\r\n", frameStats->intervalUs, frameStats->missedFrameCount);
+
+    if (!rxIsDualLink()) {
+        cliPrint("Single receiver, set serialrx_provider2 for a second link\r\n");
+        return;
+    }
+    const timeUs_t currentTimeUs = micros();
+    cliPrint("Link   Frames     Used Failsafe Lag(us) Age(ms) Int(us) Missed\r\n");
+    for (int link = 0; link < RX_LINK_COUNT; link++) {
+        const rxLinkStats_t *stats = rxGetLinkStats(link);
+        cliPrintf("%c%3d %8u %8u %8u %7d %7u %7d %6u\r\n",
+            link == rxGetActiveLink() ? '*' : ' ',
+            link + 1,
+            stats->frameCount,
+            stats->usedFrameCount,
+            stats->failsafeFrameCount,
+            stats->lagUs,
+            (currentTimeUs - stats->lastFrameAt) / 1000,
+            stats->frameStats.intervalUs,
+            stats->frameStats.missedFrameCount
+        );
+    }
+}
+#endif
+
 static void printAux(uint8_t dumpMask, const modeActivationProfile_t *modeActivationProfile, const modeActivationProfile_t *defaultModeActivationProfile)
 {
     const char *format = "aux %u %u %u %u %u\r\n";
@@ -1302,6 +1572,7 @@ static void cliAux(char *cmdline)
             if (validArgumentCount != 4) {
                 memset(mac, 0, sizeof(modeActivationCondition_t));
             }
+            rcControlsRangesChanged();
         } else {
             cliShowArgumentRangeError("index", 0, MAX_MODE_ACTIVATION_CONDITION_COUNT - 1);
         }
@@ -1397,7 +1668,7 @@ static void cliSerial(char *cmdline)
                 portConfig.msp_baudrateIndex = baudRateIndex;
                 break;
             case 1:
-                if (baudRateIndex < BAUD_9600 || baudRateIndex > BAUD_115200) {
+                if (baudRateIndex < BAUD_9600 || baudRateIndex > BAUD_460800) {
                     continue;
                 }
                 portConfig.gps_baudrateIndex = baudRateIndex;
@@ -1595,6 +1866,7 @@ static void cliAdjustmentRange(char *cmdline)
                 memset(ar, 0, sizeof(adjustmentRange_t));
                 cliShowParseError();
             }
+            rcControlsRangesChanged();
         } else {
             cliShowArgumentRangeError("index", 0, MAX_ADJUSTMENT_RANGE_COUNT - 1);
         }
@@ -1662,7 +1934,7 @@ static void cliMotorMix(char *cmdline)
             len = strlen(ptr);
             for (uint32_t i = 0; ; i++) {
                 if (mixerNames[i] == NULL) {
-                    cliPrint("Invalid name\r\n");
+                    cliPrintError("Invalid name\r\n");
                     break;
                 }
                 if (strncasecmp(ptr, mixerNames[i], len) == 0) {
@@ -1809,6 +2081,9 @@ static void cliLed(char *cmdline)
             ptr = nextArg(cmdline);
             if (!parseLedStripConfig(i, ptr)) {
                 cliShowParseError();
+            } else if (!cliBatchMode) {
+                // the strip is set up again from the whole batch when it is saved
+                reevaluateLedConfig();
             }
         } else {
             cliShowArgumentRangeError("index", 0, LED_MAX_STRIP_LENGTH - 1);
@@ -2036,6 +2311,7 @@ static void cliServo(char *cmdline)
         servo->angleAtMax = arguments[5];
         servo->rate = arguments[6];
         servo->forwardFromChannel = arguments[7];
+        servoCompileRules();
     }
 }
 #endif
@@ -2127,13 +2403,14 @@ static void cliServoMix(char *cmdline)
         for (uint32_t i = 0; i < MAX_SUPPORTED_SERVOS; i++) {
             servoProfile()->servoConf[i].reversedSources = 0;
         }
+        servoCompileRules();
     } else if (strncasecmp(cmdline, "load", 4) == 0) {
         ptr = nextArg(cmdline);
         if (ptr) {
             len = strlen(ptr);
             for (uint32_t i = 0; ; i++) {
                 if (mixerNames[i] == NULL) {
-                    cliPrintf("Invalid name\r\n");
+                    cliPrintError("Invalid name\r\n");
                     break;
                 }
                 if (strncasecmp(ptr, mixerNames[i], len) == 0) {
@@ -2182,6 +2459,7 @@ static void cliServoMix(char *cmdline)
                 servoProfile()->servoConf[args[SERVO]].reversedSources |= 1 << args[INPUT];
             else
                 servoProfile()->servoConf[args[SERVO]].reversedSources &= ~(1 << args[INPUT]);
+            servoCompileRules();
         } else
             cliShowParseError();
 
@@ -2234,6 +2512,39 @@ static void cliWriteBytes(const uint8_t *buffer, int count)
     }
 }
 
+#ifdef USE_SDCARD_PROFILER
+static void cliSdProfile(void)
+{
+    const sdcardLatencyStats_t *writes = sdcardProfilerGetStats(SDCARD_BLOCK_OPERATION_WRITE);
+    const sdcardLatencyStats_t *reads = sdcardProfilerGetStats(SDCARD_BLOCK_OPERATION_READ);
+
+    cliPrintf("Writes: %u, max %uus, %u over %ums\r\n", writes->count, writes->maxUs, writes->stalls, SDCARD_PROFILER_STALL_US / 1000);
+    cliPrint("Write latency:");
+    for (int i = 0; i < SDCARD_PROFILER_BUCKET_COUNT; i++) {
+        cliPrintf(" %s%uus:%u", i == SDCARD_PROFILER_BUCKET_COUNT - 1 ? ">=" : "<", sdcardProfilerGetBucketLimitUs(i), writes->histogram[i]);
+    }
+    cliPrintf("\r\nReads: %u, max %uus\r\n", reads->count, reads->maxUs);
+
+    cliPrint("Benchmark: ");
+    switch (sdcardBenchmarkGetState()) {
+        case SDCARD_BENCHMARK_OFF:
+            cliPrint("Off");
+        break;
+        case SDCARD_BENCHMARK_WAITING:
+        case SDCARD_BENCHMARK_RUNNING:
+            cliPrint("Running");
+        break;
+        case SDCARD_BENCHMARK_DONE:
+            cliPrintf("%ukB/s", sdcardBenchmarkGetRateKBps());
+        break;
+        case SDCARD_BENCHMARK_FAILED:
+            cliPrint("Failed");
+        break;
+    }
+    cliPrint("\r\n");
+}
+#endif
+
 static void cliSdInfo(char *cmdline) {
     UNUSED(cmdline);
 
@@ -2290,6 +2601,10 @@ static void cliSdInfo(char *cmdline) {
         break;
     }
     cliPrint("\r\n");
+
+#ifdef USE_SDCARD_PROFILER
+    cliSdProfile();
+#endif
 }
 
 #endif
@@ -2331,6 +2646,7 @@ static void cliFlashErase(char *cmdline)
 
         bufWriterFlush(cliWriter);
 #endif
+        flashfsUpdate();
         delay(100);
     }
 
@@ -2553,7 +2869,7 @@ static void cliFeature(char *cmdline)
 
         for (uint32_t i = 0; ; i++) {
             if (featureNames[i] == NULL) {
-                cliPrint("Invalid name\r\n");
+                cliPrintError("Invalid name\r\n");
                 break;
             }
 
@@ -2562,24 +2878,24 @@ static void cliFeature(char *cmdline)
                 mask = 1 << i;
 #ifndef GPS
                 if (mask & FEATURE_GPS) {
-                    cliPrint("unavailable\r\n");
+                    cliPrintError("unavailable\r\n");
                     break;
                 }
 #endif
 #ifndef SONAR
                 if (mask & FEATURE_SONAR) {
-                    cliPrint("unavailable\r\n");
+                    cliPrintError("unavailable\r\n");
                     break;
                 }
 #endif
                 if (remove) {
                     featureClear(mask);
-                    cliPrint("Disabled");
                 } else {
                     featureSet(mask);
-                    cliPrint("Enabled");
                 }
-                cliPrintf(" %s\r\n", featureNames[i]);
+                if (!cliBatchMode) {
+                    cliPrintf("%s %s\r\n", remove ? "Disabled" : "Enabled", featureNames[i]);
+                }
                 break;
             }
         }
@@ -2634,7 +2950,7 @@ static void cliBeeper(char *cmdline)
 
         for (uint32_t i = 0; ; i++) {
             if (i == beeperCount) {
-                cliPrint("Invalid name\r\n");
+                cliPrintError("Invalid name\r\n");
                 break;
             }
             if (strncasecmp(cmdline, beeperNameForTableIndex(i), len) == 0) {
@@ -2648,7 +2964,6 @@ static void cliBeeper(char *cmdline)
                             mask = 1 << i;
                             beeperOffSet(mask);
                         }
-                    cliPrint("Disabled");
                 }
                 else { // beeper on
                     if (i == BEEPER_ALL-1)
@@ -2660,9 +2975,10 @@ static void cliBeeper(char *cmdline)
                             mask = 1 << i;
                             beeperOffClear(mask);
                         }
-                    cliPrint("Enabled");
                 }
-            cliPrintf(" %s\r\n", beeperNameForTableIndex(i));
+            if (!cliBatchMode) {
+                cliPrintf("%s %s\r\n", remove ? "Disabled" : "Enabled", beeperNameForTableIndex(i));
+            }
             break;
             }
         }
@@ -2754,6 +3070,20 @@ static void cliDfu(char *cmdLine)
     cliRebootEx(true);
 }
 
+#ifdef USE_USB_MSC
+static void cliMsc(char *cmdline)
+{
+    UNUSED(cmdline);
+#ifndef CLI_MINIMAL_VERBOSITY
+    cliPrint("\r\nRestarting as a USB drive, unplug to leave");
+#endif
+    bufWriterFlush(cliWriter);
+    waitForSerialPortToFinishTransmitting(cliPort);
+    stopPwmAllMotors();
+    systemResetToMsc();
+}
+#endif
+
 static void cliExit(char *cmdline)
 {
     UNUSED(cmdline);
@@ -2869,7 +3199,7 @@ static void cliMixer(char *cmdline)
 
     for (uint32_t i = 0; ; i++) {
         if (mixerNames[i] == NULL) {
-            cliPrint("Invalid name\r\n");
+            cliPrintError("Invalid name\r\n");
             return;
         }
         if (strncasecmp(cmdline, mixerNames[i], len) == 0) {
@@ -2972,6 +3302,11 @@ static void cliProfile(char *cmdline)
         i = atoi(cmdline);
         if (i >= 0 && i < MAX_PROFILE_COUNT) {
             masterConfig.current_profile_index = i;
+            if (cliBatchMode) {
+                // the settings that follow go to this profile, the switch itself is saved with the batch
+                setProfile(i);
+                return;
+            }
             writeEEPROM();
             readEEPROM();
             cliProfile("");
@@ -2990,36 +3325,35 @@ static void cliRateProfile(char *cmdline)
         i = atoi(cmdline);
         if (i >= 0 && i < MAX_RATEPROFILES) {
             changeControlRateProfile(i);
-            cliRateProfile("");
+            if (!cliBatchMode) {
+                cliRateProfile("");
+            }
         }
     }
 }
 
+// the profiles are read in place, dumping one no longer selects it and writes the config to flash
 static void cliDumpProfile(uint8_t profileIndex, uint8_t dumpMask, const master_t *defaultConfig)
 {
     if (profileIndex >= MAX_PROFILE_COUNT) {
         // Faulty values
         return;
     }
-    changeProfile(profileIndex);
     cliPrintHashLine("profile");
-    cliProfile("");
-    cliPrint("\r\n");
-    dumpValues(PROFILE_VALUE, dumpMask, defaultConfig);
-    cliRateProfile("");
+    cliPrintf("profile %d\r\n\r\n", profileIndex);
+    dumpValues(PROFILE_VALUE, dumpMask, defaultConfig, profileIndex, 0);
+    cliPrintf("rateprofile %d\r\n", masterConfig.profile[profileIndex].activeRateProfile);
 }
 
-static void cliDumpRateProfile(uint8_t rateProfileIndex, uint8_t dumpMask, const master_t *defaultConfig)
+static void cliDumpRateProfile(uint8_t profileIndex, uint8_t rateProfileIndex, uint8_t dumpMask, const master_t *defaultConfig)
 {
     if (rateProfileIndex >= MAX_RATEPROFILES) {
         // Faulty values
         return;
     }
-    changeControlRateProfile(rateProfileIndex);
     cliPrintHashLine("rateprofile");
-    cliRateProfile("");
-    cliPrint("\r\n");
-    dumpValues(PROFILE_RATE_VALUE, dumpMask, defaultConfig);
+    cliPrintf("rateprofile %d\r\n\r\n", rateProfileIndex);
+    dumpValues(PROFILE_RATE_VALUE, dumpMask, defaultConfig, profileIndex, rateProfileIndex);
 }
 
 static void cliSave(char *cmdline)
@@ -3031,6 +3365,32 @@ static void cliSave(char *cmdline)
     cliReboot();
 }
 
+static void cliBatch(char *cmdline)
+{
+    if (strncasecmp(cmdline, "start", 5) == 0) {
+        cliBatchMode = true;
+        cliBatchLines = 0;
+        cliBatchErrors = 0;
+    } else if (!cliBatchMode) {
+        cliPrint("No batch started\r\n");
+    } else if (strncasecmp(cmdline, "end", 3) == 0) {
+        cliBatchMode = false;
+        if (cliBatchErrors) {
+            cliPrintf("%d of %d lines failed, nothing saved\r\n", cliBatchErrors, cliBatchLines - 1);
+            readEEPROM();
+            return;
+        }
+        validateAndFixConfig();
+        cliSave(cmdline);
+    } else if (strncasecmp(cmdline, "abort", 5) == 0) {
+        cliBatchMode = false;
+        cliPrint("Batch discarded\r\n");
+        readEEPROM();
+    } else {
+        cliShowParseError();
+    }
+}
+
 static void cliDefaults(char *cmdline)
 {
     UNUSED(cmdline);
@@ -3063,7 +3423,7 @@ static void cliGet(char *cmdline)
         return;
     }
 
-    cliPrint("Invalid name\r\n");
+    cliPrintError("Invalid name\r\n");
 }
 
 static void cliSet(char *cmdline)
@@ -3097,61 +3457,60 @@ static void cliSet(char *cmdline)
             eqptr++;
         }
 
-        for (uint32_t i = 0; i < VALUE_COUNT; i++) {
-            val = &valueTable[i];
-            // ensure exact match when setting to prevent setting variables with shorter names
-            if (strncasecmp(cmdline, valueTable[i].name, strlen(valueTable[i].name)) == 0 && variableNameLength == strlen(valueTable[i].name)) {
-
-                bool changeValue = false;
-                int_float_value_t tmp = { 0 };
-                switch (valueTable[i].type & VALUE_MODE_MASK) {
-                    case MODE_DIRECT: {
-                            int32_t value = 0;
-                            float valuef = 0;
+        // ensure exact match when setting to prevent setting variables with shorter names
+        val = cliFindValue(cmdline, variableNameLength);
+        if (val) {
+            bool changeValue = false;
+            int_float_value_t tmp = { 0 };
+            switch (val->type & VALUE_MODE_MASK) {
+                case MODE_DIRECT: {
+                        int32_t value = 0;
+                        float valuef = 0;
 
-                            value = atoi(eqptr);
-                            valuef = fastA2F(eqptr);
+                        value = atoi(eqptr);
+                        valuef = fastA2F(eqptr);
 
-                            if (valuef >= valueTable[i].config.minmax.min && valuef <= valueTable[i].config.minmax.max) { // note: compare float value
+                        if (valuef >= val->config.minmax.min && valuef <= val->config.minmax.max) { // note: compare float value
 
-                                if ((valueTable[i].type & VALUE_TYPE_MASK) == VAR_FLOAT)
-                                    tmp.float_value = valuef;
-                                else
-                                    tmp.int_value = value;
+                            if ((val->type & VALUE_TYPE_MASK) == VAR_FLOAT)
+                                tmp.float_value = valuef;
+                            else
+                                tmp.int_value = value;
 
-                                changeValue = true;
-                            }
+                            changeValue = true;
                         }
-                        break;
-                    case MODE_LOOKUP: {
-                            const lookupTableEntry_t *tableEntry = &lookupTables[valueTable[i].config.lookup.tableIndex];
-                            bool matched = false;
-                            for (uint32_t tableValueIndex = 0; tableValueIndex < tableEntry->valueCount && !matched; tableValueIndex++) {
-                                matched = strcasecmp(tableEntry->values[tableValueIndex], eqptr) == 0;
-
-                                if (matched) {
-                                    tmp.int_value = tableValueIndex;
-                                    changeValue = true;
-                                }
+                    }
+                    break;
+                case MODE_LOOKUP: {
+                        const lookupTableEntry_t *tableEntry = &lookupTables[val->config.lookup.tableIndex];
+                        bool matched = false;
+                        for (uint32_t tableValueIndex = 0; tableValueIndex < tableEntry->valueCount && !matched; tableValueIndex++) {
+                            matched = strcasecmp(tableEntry->values[tableValueIndex], eqptr) == 0;
+
+                            if (matched) {
+                                tmp.int_value = tableValueIndex;
+                                changeValue = true;
                             }
                         }
-                        break;
-                }
+                    }
+                    break;
+            }
 
-                if (changeValue) {
-                    cliSetVar(val, tmp);
+            if (changeValue) {
+                cliSetVar(val, tmp);
 
-                    cliPrintf("%s set to ", valueTable[i].name);
+                if (!cliBatchMode) {
+                    cliPrintf("%s set to ", val->name);
                     cliPrintVar(val, 0);
-                } else {
-                    cliPrint("Invalid value\r\n");
-                    cliPrintVarRange(val);
                 }
-
-                return;
+            } else {
+                cliPrintError("Invalid value\r\n");
+                cliPrintVarRange(val);
             }
+
+            return;
         }
-        cliPrint("Invalid name\r\n");
+        cliPrintError("Invalid name\r\n");
     } else {
         // no equals, check for matching variables.
         cliGet(cmdline);
@@ -3162,12 +3521,13 @@ static void cliStatus(char *cmdline)
 {
     UNUSED(cmdline);
 
-    cliPrintf("System Uptime: %d seconds, Voltage: %d * 0.1V (%dS battery - %s), CPU:%d%%\r\n",
+    cliPrintf("System Uptime: %d seconds, Voltage: %d * 0.1V (%dS battery - %s), CPU:%d%%, CPU busy:%d%%\r\n",
         millis() / 1000,
         vbat,
         batteryCellCount,
         getBatteryStateString(),
-        constrain(averageSystemLoadPercent, 0, 100)
+        constrain(averageSystemLoadPercent, 0, 100),
+        cpuUtilisationPercent
     );
 
     cliPrintf("CPU Clock=%dMHz", (SystemCoreClock / 1000000));
@@ -3192,6 +3552,11 @@ static void cliStatus(char *cmdline)
             if (mask == SENSOR_ACC && acc.dev.revisionCode) {
                 cliPrintf(".%c", acc.dev.revisionCode);
             }
+#ifdef USE_DUAL_GYRO
+            if (mask == SENSOR_GYRO && gyroSecondaryHardware() != GYRO_NONE) {
+                cliPrintf(", GYRO2=%s", sensorHardwareNames[i][gyroSecondaryHardware()]);
+            }
+#endif
         }
     }
 #endif
@@ -3208,17 +3573,70 @@ static void cliStatus(char *cmdline)
 #endif
     cliPrintf("Stack size: %d, Stack address: 0x%x\r\n", stackTotalSize(), stackHighMem());
 
+    memoryReport_t memory;
+    memoryReportGet(&memory);
+    cliPrintf("RAM data: %d, bss: %d, stack high water: %d, DMA buffers: %d", memory.dataSize, memory.bssSize, memory.stackHighWater, memory.dmaBufferSize);
+    for (int owner = 0; owner < OWNER_TOTAL_COUNT; owner++) {
+        const uint32_t dmaBufferSize = memoryReportDmaBufferSize(owner);
+        if (dmaBufferSize) {
+            cliPrintf(", %s=%d", ownerNames[owner], dmaBufferSize);
+        }
+    }
+    cliPrint("\r\n");
+
     cliPrintf("Cycle Time: %d, I2C Errors: %d, config size: %d\r\n", cycleTime, i2cErrorCounter, sizeof(master_t));
 
+    cliPrintf("Boot time: %dms to start, ", bootTimes.initComplete);
+    if (bootTimes.readyToArm) {
+        cliPrintf("%dms to ready to arm\r\n", bootTimes.readyToArm);
+    } else {
+        cliPrint("not ready to arm\r\n");
+    }
+
+    const eepromWriteStatus_e saveStatus = deferredEEPROMWriteStatus();
+    if (saveStatus == EEPROM_WRITE_PENDING || saveStatus == EEPROM_WRITE_WAITING_FOR_ERASE) {
+        cliPrint(saveStatus == EEPROM_WRITE_PENDING ? "Config save in progress\r\n" : "Config save waiting for disarm\r\n");
+    } else if (saveStatus == EEPROM_WRITE_FAILED) {
+        cliPrint("Config save FAILED\r\n");
+    }
+
 #ifdef USE_SDCARD
     cliSdInfo(NULL);
 #endif
 }
 
 #ifndef SKIP_TASK_STATISTICS
+static void cliTasksLatency(void)
+{
+#ifndef CLI_MINIMAL_VERBOSITY
+    cliPrintf("Task (us, p50/p99)   period   exec    exec   late    late   misses\r\n");
+#endif
+    for (cfTaskId_e taskId = 0; taskId < TASK_COUNT; taskId++) {
+        cfTaskInfo_t taskInfo;
+        getTaskInfo(taskId, &taskInfo);
+        if (taskInfo.isEnabled) {
+            cliPrintf("%02d - (%13s) %6d %6d %7d %6d %7d %8d\r\n", taskId, taskInfo.taskName, taskInfo.desiredPeriod,
+                getTaskHistogramPercentile(taskInfo.executionTimeHistogram, 50), getTaskHistogramPercentile(taskInfo.executionTimeHistogram, 99),
+                getTaskHistogramPercentile(taskInfo.latenessHistogram, 50), getTaskHistogramPercentile(taskInfo.latenessHistogram, 99),
+                taskInfo.deadlineMissCount);
+        }
+    }
+#ifndef CLI_MINIMAL_VERBOSITY
+    cliPrintf("Percentiles are bucket limits:");
+    for (int bucket = 0; bucket < TASK_HISTOGRAM_BUCKET_COUNT - 1; bucket++) {
+        cliPrintf(" %d", getTaskHistogramBucketLimit(bucket));
+    }
+    cliPrintf("+\r\n");
+#endif
+}
+
 static void cliTasks(char *cmdline)
 {
-    UNUSED(cmdline);
+    if (strncasecmp(cmdline, "latency", 7) == 0) {
+        cliTasksLatency();
+        return;
+    }
+
     int maxLoadSum = 0;
     int averageLoadSum = 0;
 
@@ -3265,6 +3683,210 @@ static void cliTasks(char *cmdline)
 }
 #endif
 
+#ifdef USE_LOOP_LATENCY
+static void cliLoopLatency(char *cmdline)
+{
+    static const char * const stageNames[LOOP_LATENCY_COUNT] = { "GYRO-PID", "GYRO-MOTOR", "GYRO-READ" };
+
+    if (strncasecmp(cmdline, "reset", 5) == 0) {
+        loopLatencyReset();
+        return;
+    }
+
+#ifndef CLI_MINIMAL_VERBOSITY
+    cliPrintf("Stage (us)    min    avg    max    p50    p99    samples\r\n");
+#endif
+    for (int stage = 0; stage < LOOP_LATENCY_COUNT; stage++) {
+        const loopLatencyStats_t *stats = getLoopLatencyStats(stage);
+        cliPrintf("%10s %6d %6d %6d %6d %6d %10d\r\n", stageNames[stage], stats->min, getLoopLatencyAverage(stage), stats->max,
+            getTaskHistogramPercentile(stats->histogram, 50), getTaskHistogramPercentile(stats->histogram, 99), stats->count);
+    }
+}
+#endif
+
+#ifdef USE_LOOP_RATE_AUTO
+static void cliLoopRate(char *cmdline)
+{
+    static const char * const stateNames[] = { "IDLE", "SETTLING", "MEASURING", "DONE", "ABORTED" };
+
+    if (strncasecmp(cmdline, "auto", 4) == 0) {
+        if (ARMING_FLAG(ARMED)) {
+            cliPrint("Disarm first\r\n");
+            return;
+        }
+        loopRateAutoStart(micros());
+    }
+
+    const loopRateAutoState_e state = loopRateAutoGetState();
+    cliPrintf("Gyro %dHz, PID %dHz, auto %s\r\n", 1000000 / gyro.targetLooptime,
+        1000000 / (gyro.targetLooptime * pidConfig()->pid_process_denom), stateNames[state]);
+    if (state == LOOP_RATE_AUTO_DONE) {
+        const loopRateAutoResult_t *result = loopRateAutoGetResult();
+        cliPrintf("gyro_sync_denom %d pid_process_denom %d, load %d%% (other tasks %d%%), gyro %d.%02dus, PID %d.%02dus\r\n",
+            result->gyroSyncDenom, result->pidProcessDenom, result->loadPercent, result->otherLoadPercent,
+            result->gyroUs100 / 100, result->gyroUs100 % 100, result->pidUs100 / 100, result->pidUs100 % 100);
+    }
+}
+#endif
+
+#ifdef USE_POST_MORTEM
+static void cliPostMortem(char *cmdline)
+{
+    static const char * const reasonNames[] = { "NONE", "HARD FAULT", "LOCKUP" };
+    static const char * const registerNames[] = { "r0", "r1", "r2", "r3", "r12", "lr", "pc", "xpsr" };
+
+    if (strncasecmp(cmdline, "clear", 5) == 0) {
+        postMortemClear();
+        return;
+    }
+
+    const postMortem_t *postMortem = postMortemGet();
+    if (!postMortem) {
+        cliPrint("No post mortem since the last power up\r\n");
+        return;
+    }
+    cliPrintf("%s at %dms, %s, task %s, load %d%%\r\n", reasonNames[postMortem->reason], postMortem->uptimeMs,
+        postMortem->armed ? "armed" : "disarmed", postMortem->taskId < TASK_COUNT ? cfTasks[postMortem->taskId].taskName : "NONE",
+        postMortem->systemLoadPercent);
+    if (postMortem->reason == POST_MORTEM_HARD_FAULT) {
+        for (unsigned i = 0; i < ARRAYLEN(registerNames); i++) {
+            cliPrintf("%s 0x%08x%s", registerNames[i], postMortem->registers[i], (i % 4 == 3) ? "\r\n" : " ");
+        }
+        cliPrintf("cfsr 0x%08x hfsr 0x%08x mmfar 0x%08x bfar 0x%08x\r\n", postMortem->cfsr, postMortem->hfsr, postMortem->mmfar, postMortem->bfar);
+        cliPrintf("stack at 0x%08x:", postMortem->sp);
+        for (int i = 0; i < POST_MORTEM_STACK_WORDS; i++) {
+            cliPrintf(" %08x", postMortem->stack[i]);
+        }
+        cliPrint("\r\n");
+    }
+#ifndef CLI_MINIMAL_VERBOSITY
+    cliPrint("            Task avg(us)  max(us)\r\n");
+#endif
+    for (int taskId = 0; taskId < TASK_COUNT; taskId++) {
+        if (postMortem->tasks[taskId].maxUs) {
+            cliPrintf("%16s %7d %8d\r\n", cfTasks[taskId].taskName, postMortem->tasks[taskId].averageUs, postMortem->tasks[taskId].maxUs);
+        }
+    }
+#ifdef USE_SCHEDULER_TRACE
+    // the last scheduler events, in us before the newest
+    const uint32_t cyclesPerUs = MAX(postMortem->traceCyclesPerUs, 1);
+    for (int i = 0; i < postMortem->traceCount; i++) {
+        const schedulerTraceEvent_t *event = &postMortem->trace[i];
+        const uint32_t beforeUs = (postMortem->trace[postMortem->traceCount - 1].cycles - event->cycles) / cyclesPerUs;
+        const char *what = (event->type == SCHEDULER_TRACE_TASK_START || event->type == SCHEDULER_TRACE_ISR_ENTER) ? "start" : "end";
+        if (event->type <= SCHEDULER_TRACE_TASK_END && event->id < TASK_COUNT) {
+            cliPrintf("-%dus %s %s\r\n", beforeUs, what, cfTasks[event->id].taskName);
+        } else {
+            cliPrintf("-%dus %s ISR %d\r\n", beforeUs, what, event->id);
+        }
+    }
+#endif
+}
+#endif
+
+#ifdef USE_PROFILER
+static void cliCycleProfile(char *cmdline)
+{
+    if (strncasecmp(cmdline, "reset", 5) == 0) {
+        profileReset();
+        return;
+    }
+
+    const uint32_t cyclesPerUs = profileGetCyclesPerMicrosecond();
+#ifndef CLI_MINIMAL_VERBOSITY
+    cliPrintf("Probe (cycles)      min      avg      max  avg (us)      calls\r\n");
+#endif
+    for (int probe = 0; probe < PROFILE_COUNT; probe++) {
+        const profileStats_t *stats = profileGetStats(probe);
+        const uint32_t averageCycles = profileGetAverageCycles(probe);
+        const uint32_t averageUs100 = averageCycles * 100 / cyclesPerUs;
+        cliPrintf("%14s %8d %8d %8d %6d.%02d %10d\r\n", profileGetName(probe), stats->minCycles, averageCycles, stats->maxCycles,
+            averageUs100 / 100, averageUs100 % 100, stats->count);
+    }
+}
+#endif
+
+#ifdef USE_DSHOT
+static void cliDshotCommand(char *cmdline)
+{
+    if (!isEmpty(cmdline)) {
+        const bool allMotors = strncasecmp(cmdline, "all", 3) == 0;
+        const int motorIndex = allMotors ? DSHOT_ALL_MOTORS : atoi(cmdline);
+        char *ptr = nextArg(cmdline);
+        if (!ptr || (!allMotors && motorIndex >= getMotorCount())) {
+            cliShowParseError();
+            return;
+        }
+        if (!dshotCommandQueue(motorIndex, atoi(ptr))) {
+            cliPrint("Command not queued, DSHOT is off, the queue is full or the command is invalid\r\n");
+            return;
+        }
+    }
+
+    dshotCommandStatus_t status;
+    dshotCommandGetStatus(&status);
+    cliPrintf("Queued: %d\r\n", status.queued);
+    if (status.queued) {
+        if (status.motorIndex == DSHOT_ALL_MOTORS) {
+            cliPrintf("Next: command %d to all motors", status.command);
+        } else {
+            cliPrintf("Next: command %d to motor %d", status.command, status.motorIndex);
+        }
+        cliPrintf(", %d frames left\r\n", status.repeatsLeft);
+    }
+}
+#endif
+
+#ifdef USE_DSHOT_TELEMETRY
+static void cliDshotTelemetryInfo(char *cmdline)
+{
+    UNUSED(cmdline);
+
+    if (!useDshotTelemetry) {
+        cliPrint("DSHOT telemetry is disabled, set dshot_bidir = ON\r\n");
+        return;
+    }
+
+#ifndef CLI_MINIMAL_VERBOSITY
+    cliPrintf("Motor      eRPM   received    invalid\r\n");
+#endif
+    for (int i = 0; i < getMotorCount(); i++) {
+        const motorDmaOutput_t *motor = getMotorDmaOutput(i);
+        if (!motor->hasTelemetry) {
+            cliPrintf("%5d  no telemetry\r\n", i);
+            continue;
+        }
+        cliPrintf("%5d %9d %10d %10d\r\n", i, motor->telemetryValue * 100, motor->telemetryReceived, motor->telemetryInvalid);
+    }
+}
+#endif
+
+#ifdef USE_VCP
+static void cliVcpBench(char *cmdline)
+{
+    const uint32_t length = (isEmpty(cmdline) ? 256 : atoi(cmdline)) * 1024;
+    uint8_t line[64];
+
+    // Printable lines of exactly one full speed USB packet each
+    for (unsigned i = 0; i < sizeof(line) - 2; i++) {
+        line[i] = 'a' + i % 26;
+    }
+    line[sizeof(line) - 2] = '\r';
+    line[sizeof(line) - 1] = '\n';
+
+    bufWriterFlush(cliWriter);
+
+    const uint32_t startUs = micros();
+    for (uint32_t sent = 0; sent < length; sent += sizeof(line)) {
+        serialWriteBuf(cliPort, line, sizeof(line));
+    }
+    waitForSerialPortToFinishTransmitting(cliPort);
+    const uint32_t elapsedUs = MAX(micros() - startUs, 1);
+
+    cliPrintf("%u bytes in %u ms, %u bytes/s\r\n", length, elapsedUs / 1000, (uint32_t)((uint64_t)length * 1000000 / elapsedUs));
+}
+#endif
+
 static void cliVersion(char *cmdline)
 {
     UNUSED(cmdline);
@@ -3317,7 +3939,7 @@ static void printResource(uint8_t dumpMask, const master_t *defaultConfig)
         if (resourceTable[i].maxIndex > 0) {
             for (int index = 0; index < resourceTable[i].maxIndex; index++) {
                 ioTag_t ioTag = *(resourceTable[i].ptr + index);
-                ioTag_t ioTagDefault = *(resourceTable[i].ptr + index - (uint32_t)&masterConfig + (uint32_t)defaultConfig);
+                ioTag_t ioTagDefault = *(resourceTable[i].ptr + index - (uintptr_t)&masterConfig + (uintptr_t)defaultConfig);
 
                 bool equalsDefault = ioTag == ioTagDefault;
                 const char *format = "resource %s %d %c%02d\r\n";
@@ -3337,7 +3959,7 @@ static void printResource(uint8_t dumpMask, const master_t *defaultConfig)
             }
         } else {
             ioTag_t ioTag = *resourceTable[i].ptr;
-            ioTag_t ioTagDefault = *(resourceTable[i].ptr - (uint32_t)&masterConfig + (uint32_t)defaultConfig);
+            ioTag_t ioTagDefault = *(resourceTable[i].ptr - (uintptr_t)&masterConfig + (uintptr_t)defaultConfig);
 
             bool equalsDefault = ioTag == ioTagDefault;
             const char *format = "resource %s %c%02d\r\n";
@@ -3428,6 +4050,21 @@ static void cliResource(char *cmdline)
             }
         }
 
+        // claims refused because the stream was held, and no alternative stream was free
+        if (dmaGetConflictCount() > 0) {
+            cliPrintf("\r\nDMA conflicts:\r\n");
+            for (int i = 0; i < dmaGetConflictCount(); i++) {
+                const dmaConflict_t *conflict = dmaGetConflict(i);
+
+                cliPrintf(DMA_OUTPUT_STRING, conflict->identifier / DMA_MOD_VALUE + 1, (conflict->identifier % DMA_MOD_VALUE) + DMA_MOD_OFFSET);
+                if (conflict->resourceIndex > 0) {
+                    cliPrintf(" %s %d refused, held by %s\r\n", ownerNames[conflict->owner], conflict->resourceIndex, ownerNames[dmaGetOwner(conflict->identifier)]);
+                } else {
+                    cliPrintf(" %s refused, held by %s\r\n", ownerNames[conflict->owner], ownerNames[dmaGetOwner(conflict->identifier)]);
+                }
+            }
+        }
+
 #ifndef CLI_MINIMAL_VERBOSITY
         cliPrintf("\r\nUse: 'resource' to see how to change resources.\r\n");
 #endif
@@ -3443,7 +4080,7 @@ static void cliResource(char *cmdline)
     pch = strtok_r(cmdline, " ", &saveptr);
     for (resourceIndex = 0; ; resourceIndex++) {
         if (resourceIndex >= ARRAYLEN(resourceTable)) {
-            cliPrint("Invalid resource\r\n");
+            cliPrintError("Invalid resource\r\n");
             return;
         }
 
@@ -3528,6 +4165,7 @@ static void printConfig(char *cmdline, bool doDiff)
     }
 
     createDefaultConfig(&defaultConfig);
+    cliOutputBatched = true;
 
     if (checkCommand(options, "showdefaults")) {
         dumpMask = dumpMask | SHOW_DEFAULTS;   // add default values as comments for changed values
@@ -3614,26 +4252,22 @@ static void printConfig(char *cmdline, bool doDiff)
         printRxFail(dumpMask, rxConfig(), &defaultConfig.rxConfig);
 
         cliPrintHashLine("master");
-        dumpValues(MASTER_VALUE, dumpMask, &defaultConfig);
+        dumpValues(MASTER_VALUE, dumpMask, &defaultConfig, 0, 0);
 
         if (dumpMask & DUMP_ALL) {
-            uint8_t activeProfile = masterConfig.current_profile_index;
             for (uint32_t profileCount=0; profileCount<MAX_PROFILE_COUNT;profileCount++) {
                 cliDumpProfile(profileCount, dumpMask, &defaultConfig);
 
-                uint8_t currentRateIndex = currentProfile->activeRateProfile;
                 for (uint32_t rateCount = 0; rateCount<MAX_RATEPROFILES; rateCount++) {
-                    cliDumpRateProfile(rateCount, dumpMask, &defaultConfig);
+                    cliDumpRateProfile(profileCount, rateCount, dumpMask, &defaultConfig);
                 }
 
-                changeControlRateProfile(currentRateIndex);
 #ifndef CLI_MINIMAL_VERBOSITY
                 cliPrintHashLine("restore original rateprofile selection");
-                cliRateProfile("");
+                cliPrintf("rateprofile %d\r\n", masterConfig.profile[profileCount].activeRateProfile);
 #endif
             }
 
-            changeProfile(activeProfile);
 #ifndef CLI_MINIMAL_VERBOSITY
             cliPrintHashLine("restore original profile selection");
             cliProfile("");
@@ -3642,7 +4276,7 @@ static void printConfig(char *cmdline, bool doDiff)
 #endif
         } else {
             cliDumpProfile(masterConfig.current_profile_index, dumpMask, &defaultConfig);
-            cliDumpRateProfile(currentProfile->activeRateProfile, dumpMask, &defaultConfig);
+            cliDumpRateProfile(masterConfig.current_profile_index, currentProfile->activeRateProfile, dumpMask, &defaultConfig);
         }
     }
 
@@ -3651,8 +4285,11 @@ static void printConfig(char *cmdline, bool doDiff)
     }
 
     if (dumpMask & DUMP_RATES) {
-        cliDumpRateProfile(currentProfile->activeRateProfile, dumpMask, &defaultConfig);
+        cliDumpRateProfile(masterConfig.current_profile_index, currentProfile->activeRateProfile, dumpMask, &defaultConfig);
     }
+
+    cliOutputBatched = false;
+    bufWriterFlush(cliWriter);
 }
 
 static void cliDump(char *cmdline)
@@ -3696,14 +4333,24 @@ static void cliHelp(char *cmdline);
 const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("adjrange", "configure adjustment ranges", NULL, cliAdjustmentRange),
     CLI_COMMAND_DEF("aux", "configure modes", NULL, cliAux),
+    CLI_COMMAND_DEF("batch", "apply a pasted batch of commands at once", "start|end|abort", cliBatch),
 #ifdef LED_STRIP
     CLI_COMMAND_DEF("color", "configure colors", NULL, cliColor),
     CLI_COMMAND_DEF("mode_color", "configure mode and special colors", NULL, cliModeColor),
+#endif
+#ifdef USE_PROFILER
+    CLI_COMMAND_DEF("cycleprofile", "show flight loop cycle counts", "[reset]", cliCycleProfile),
 #endif
     CLI_COMMAND_DEF("defaults", "reset to defaults and reboot", NULL, cliDefaults),
     CLI_COMMAND_DEF("dfu", "DFU mode on reboot", NULL, cliDfu),
     CLI_COMMAND_DEF("diff", "list configuration changes from default",
         "[master|profile|rates|all] {showdefaults}", cliDiff),
+#ifdef USE_DSHOT
+    CLI_COMMAND_DEF("dshot_command", "queue a DSHOT command or show the queue", "[<motor>|all <command>]", cliDshotCommand),
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+    CLI_COMMAND_DEF("dshot_telemetry_info", "show DSHOT eRPM telemetry", NULL, cliDshotTelemetryInfo),
+#endif
     CLI_COMMAND_DEF("dump", "dump configuration",
         "[master|profile|rates|all] {showdefaults}", cliDump),
     CLI_COMMAND_DEF("exit", NULL, NULL, cliExit),
@@ -3729,6 +4376,12 @@ const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("help", NULL, NULL, cliHelp),
 #ifdef LED_STRIP
     CLI_COMMAND_DEF("led", "configure leds", NULL, cliLed),
+#endif
+#ifdef USE_LOOP_LATENCY
+    CLI_COMMAND_DEF("looplatency", "show gyro to motor output latency", "[reset]", cliLoopLatency),
+#endif
+#ifdef USE_LOOP_RATE_AUTO
+    CLI_COMMAND_DEF("looprate", "show the loop rates, or measure and select them", "[auto]", cliLoopRate),
 #endif
     CLI_COMMAND_DEF("map", "configure rc channel order",
         "[<map>]", cliMap),
@@ -3740,6 +4393,12 @@ const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("mmix", "custom motor mixer", NULL, cliMotorMix),
     CLI_COMMAND_DEF("motor",  "get/set motor",
        "<index> [<value>]", cliMotor),
+#ifdef USE_USB_MSC
+    CLI_COMMAND_DEF("msc", "log storage as a USB drive on reboot", NULL, cliMsc),
+#endif
+#ifdef USE_POST_MORTEM
+    CLI_COMMAND_DEF("postmortem", "show the record of the last fault or lockup", "[clear]", cliPostMortem),
+#endif
 #if (FLASH_SIZE > 128)
     CLI_COMMAND_DEF("play_sound", NULL,
         "[<index>]\r\n", cliPlaySound),
@@ -3752,6 +4411,9 @@ const clicmd_t cmdTable[] = {
 #endif
     CLI_COMMAND_DEF("rxrange", "configure rx channel ranges", NULL, cliRxRange),
     CLI_COMMAND_DEF("rxfail", "show/set rx failsafe settings", NULL, cliRxFail),
+#ifdef SERIAL_RX
+    CLI_COMMAND_DEF("rxlink", "show dual receiver link statistics", NULL, cliRxLink),
+#endif
     CLI_COMMAND_DEF("save", "save and reboot", NULL, cliSave),
     CLI_COMMAND_DEF("serial", "configure serial ports", NULL, cliSerial),
 #ifndef SKIP_SERIAL_PASSTHROUGH
@@ -3776,7 +4438,10 @@ const clicmd_t cmdTable[] = {
 #endif
     CLI_COMMAND_DEF("status", "show status", NULL, cliStatus),
 #ifndef SKIP_TASK_STATISTICS
-    CLI_COMMAND_DEF("tasks", "show task stats", NULL, cliTasks),
+    CLI_COMMAND_DEF("tasks", "show task stats", "[latency]", cliTasks),
+#endif
+#ifdef USE_VCP
+    CLI_COMMAND_DEF("vcp_bench", "measure CLI port transmit throughput", "[<kbytes>]", cliVcpBench),
 #endif
     CLI_COMMAND_DEF("version", "show version", NULL, cliVersion),
 #ifdef BEEPER
@@ -3864,7 +4529,9 @@ void cliProcess(void)
             cliPrompt();
         } else if (bufferIndex && (c == '\n' || c == '\r')) {
             // enter pressed
-            cliPrint("\r\n");
+            if (!cliBatchMode) {
+                cliPrint("\r\n");
+            }
 
             // Strip comment starting with # from line
             char *p = cliBuffer;
@@ -3881,6 +4548,7 @@ void cliProcess(void)
             // Process non-empty lines
             if (bufferIndex > 0) {
                 cliBuffer[bufferIndex] = 0; // null terminate
+                cliBatchLines++;
 
                 const clicmd_t *cmd;
                 char *options;
@@ -3891,8 +4559,12 @@ void cliProcess(void)
                 }
                 if(cmd < cmdTable + CMD_COUNT)
                     cmd->func(options);
-                else
-                    cliPrint("Unknown command, try 'help'");
+                else {
+                    cliPrintError("Unknown command, try 'help'");
+                    if (cliBatchMode) {
+                        cliPrint("\r\n");
+                    }
+                }
                 bufferIndex = 0;
             }
 
@@ -3902,7 +4574,9 @@ void cliProcess(void)
             if (!cliMode)
                 return;
 
-            cliPrompt();
+            if (!cliBatchMode) {
+                cliPrompt();
+            }
         } else if (c == 127) {
             // backspace
             if (bufferIndex) {
@@ -3913,7 +4587,9 @@ void cliProcess(void)
             if (!bufferIndex && c == ' ')
                 continue; // Ignore leading spaces
             cliBuffer[bufferIndex++] = c;
-            cliWrite(c);
+            if (!cliBatchMode) {
+                cliWrite(c);
+            }
         }
     }
 }
@@ -36,6 +36,10 @@
 static bool transponderInitialised = false;
 static bool transponderRepeat = false;
 
+// a new code is held here until the transmission in progress has finished, rather than waiting for it
+static uint8_t pendingTransponderData[TRANSPONDER_DATA_LENGTH];
+static bool transponderDataPending = false;
+
 // timers
 static timeUs_t nextUpdateAtUs = 0;
 
@@ -46,7 +50,16 @@ void transponderUpdate(timeUs_t currentTimeUs)
 {
     static uint32_t jitterIndex = 0;
 
-    if (!(transponderInitialised && transponderRepeat && isTransponderIrReady())) {
+    if (!(transponderInitialised && isTransponderIrReady())) {
+        return;
+    }
+
+    if (transponderDataPending) {
+        transponderIrUpdateData(pendingTransponderData);
+        transponderDataPending = false;
+    }
+
+    if (!transponderRepeat) {
         return;
     }
 
@@ -102,7 +115,8 @@ void transponderStartRepeating(void)
 
 void transponderUpdateData(uint8_t* transponderData)
 {
-    transponderIrUpdateData(transponderData);
+    memcpy(pendingTransponderData, transponderData, TRANSPONDER_DATA_LENGTH);
+    transponderDataPending = true;
 }
 
 void transponderTransmitOnce(void) {
@@ -118,6 +118,7 @@ typedef struct smartAudioStat_s {
     uint16_t crc;
     uint16_t ooopresp;
     uint16_t badcode;
+    uint16_t timeout;   // commands given up after SMARTAUDIO_CMD_RETRIES unanswered resends
 } smartAudioStat_t;
 
 static smartAudioStat_t saStat = {
@@ -128,6 +129,7 @@ static smartAudioStat_t saStat = {
     .crc = 0,
     .ooopresp = 0,
     .badcode = 0,
+    .timeout = 0,
 };
 
 // The band/chan to frequency table
@@ -257,6 +259,7 @@ static int sa_adjdir = 1; // -1=going down, 1=going up
 static int sa_baudstep = 50;
 
 #define SMARTAUDIO_CMD_TIMEOUT    120
+#define SMARTAUDIO_CMD_RETRIES    3
 
 static void saAutobaud(void)
 {
@@ -302,6 +305,7 @@ static uint32_t sa_lastTransmission = 0;
 static uint8_t sa_outstanding = SA_CMD_NONE; // Outstanding command
 static uint8_t sa_osbuf[32]; // Outstanding comamnd frame for retransmission
 static int sa_oslen;         // And associate length
+static uint8_t sa_osretries; // Resends of the outstanding command so far
 
 #ifdef CMS
 void saCmsUpdate(void);
@@ -467,10 +471,14 @@ static void saReceiveFramer(uint8_t c)
     }
 }
 
-static void saSendFrame(uint8_t *buf, int len)
+// Only queues the frame for the UART or soft serial to send, returns false without sending while there is no room
+static bool saSendFrame(uint8_t *buf, int len)
 {
     int i;
 
+    if (serialTxBytesFree(smartAudioSerialPort) < (uint32_t)len + 2)
+        return false;
+
     serialWrite(smartAudioSerialPort, 0x00); // Generate 1st start bit
 
     for (i = 0 ; i < len ; i++)
@@ -480,6 +488,8 @@ static void saSendFrame(uint8_t *buf, int len)
 
     sa_lastTransmission = millis();
     saStat.pktsent++;
+
+    return true;
 }
 
 /*
@@ -502,22 +512,31 @@ static void saSendFrame(uint8_t *buf, int len)
 
 // Retransmission
 
+// Gives up on the outstanding command once it has been resent SMARTAUDIO_CMD_RETRIES times without a response
 static void saResendCmd(void)
 {
-    saSendFrame(sa_osbuf, sa_oslen);
+    if (sa_osretries >= SMARTAUDIO_CMD_RETRIES) {
+        dprintf(("resendCmd: giving up on 0x%x\r\n", sa_outstanding));
+        sa_outstanding = SA_CMD_NONE;
+        saStat.timeout++;
+        return;
+    }
+
+    if (saSendFrame(sa_osbuf, sa_oslen))
+        sa_osretries++;
 }
 
-static void saSendCmd(uint8_t *buf, int len)
+static bool saSendCmd(uint8_t *buf, int len)
 {
-    int i;
-
-    for (i = 0 ; i < len ; i++)
-        sa_osbuf[i] = buf[i];
+    if (!saSendFrame(buf, len))
+        return false;
 
+    memcpy(sa_osbuf, buf, len);
     sa_oslen = len;
+    sa_osretries = 0;
     sa_outstanding = (buf[2] >> 1);
 
-    saSendFrame(sa_osbuf, sa_oslen);
+    return true;
 }
 
 // Command queue management
@@ -568,8 +587,9 @@ static void saSendQueue(void)
     if (saQueueEmpty())
          return;
 
-    saSendCmd(sa_queue[sa_qtail].buf, sa_queue[sa_qtail].len);
-    sa_qtail = (sa_qtail + 1) % SA_QSIZE;
+    // left at the head of the queue until there is room to send it
+    if (saSendCmd(sa_queue[sa_qtail].buf, sa_queue[sa_qtail].len))
+        sa_qtail = (sa_qtail + 1) % SA_QSIZE;
 }
 
 // Individual commands
@@ -981,6 +1001,7 @@ static OSD_Entry saCmsMenuStatsEntries[] = {
     { "BADLEN",   OME_UINT16, NULL, &(OSD_UINT16_t){ &saStat.badlen, 0, 0, 0 },   DYNAMIC },
     { "CRCERR",   OME_UINT16, NULL, &(OSD_UINT16_t){ &saStat.crc, 0, 0, 0 },      DYNAMIC },
     { "OOOERR",   OME_UINT16, NULL, &(OSD_UINT16_t){ &saStat.ooopresp, 0, 0, 0 }, DYNAMIC },
+    { "TIMEOUT",  OME_UINT16, NULL, &(OSD_UINT16_t){ &saStat.timeout, 0, 0, 0 },  DYNAMIC },
     { "BACK",     OME_Back,   NULL, NULL, 0 },
     { NULL,       OME_END,    NULL, NULL, 0 }
 };
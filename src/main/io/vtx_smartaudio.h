@@ -2,7 +2,7 @@
 // For generic API use, but here for now
 
 bool smartAudioInit();
-void smartAudioProcess(uint32_t);
+void smartAudioProcess(uint32_t now); // now in milliseconds
 
 #if 0
 #ifdef CMS
@@ -24,6 +24,10 @@
 
 #include "scheduler/scheduler.h"
 
+#ifdef SIMULATOR_BUILD
+#include "target/SITL/sitl.h"
+#endif
+
 
 void main_step(void)
 {
@@ -32,8 +36,16 @@ void main_step(void)
 }
 
 #ifndef NOMAIN
+#ifdef SIMULATOR_BUILD
+int main(int argc, char *argv[])
+{
+    if (!sitlParseArgs(argc, argv)) {
+        return 1;
+    }
+#else
 int main(void)
 {
+#endif
     init();
     while (true) {
         main_step();
@@ -0,0 +1,198 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "io/flashfs.h"
+
+#include "msc/flashfs_fat.h"
+
+// FAT16 is only recognised by its cluster count
+#define FAT16_MIN_CLUSTERS          4096
+#define FAT16_MAX_CLUSTERS          65524
+
+#define FAT_RESERVED_SECTORS        1
+#define FAT_COPIES                  2
+#define FAT_ROOT_ENTRIES            (FLASHFS_FAT_SECTOR_SIZE / FAT_DIR_ENTRY_SIZE) // one sector of root directory
+#define FAT_ROOT_SECTORS            1
+#define FAT_DIR_ENTRY_SIZE          32
+#define FAT_ENTRIES_PER_SECTOR      (FLASHFS_FAT_SECTOR_SIZE / sizeof(uint16_t))
+#define FAT_FIRST_CLUSTER           2
+
+#define FAT_ATTRIBUTE_READ_ONLY     0x01
+#define FAT_ATTRIBUTE_VOLUME_ID     0x08
+
+// 2017-01-01 00:00, there is no clock to stamp the log file with
+#define FAT_DATE                    (((2017 - 1980) << 9) | (1 << 5) | 1)
+#define FAT_TIME                    0
+
+#define FLASHFS_FAT_VOLUME_LABEL    "BLACKBOX   "
+#define FLASHFS_FAT_FILE_NAME       "BTFL_ALLBBL"
+
+static struct {
+    uint32_t logSize;           // bytes of flash holding logs, the length of the file
+    uint32_t fileClusters;
+    uint32_t clusterCount;
+    uint32_t fatSectors;
+    uint32_t rootSector;
+    uint32_t firstDataSector;
+    uint32_t sectorCount;
+    uint8_t sectorsPerCluster;
+} volume;
+
+static void putU16(uint8_t *dst, uint16_t value)
+{
+    dst[0] = value & 0xFF;
+    dst[1] = value >> 8;
+}
+
+static void putU32(uint8_t *dst, uint32_t value)
+{
+    putU16(dst, value & 0xFFFF);
+    putU16(dst + 2, value >> 16);
+}
+
+/**
+ * Lay out the volume for what is currently stored in flash. Call again after the flash contents change.
+ */
+void flashfsFatInit(void)
+{
+    memset(&volume, 0, sizeof(volume));
+
+    volume.logSize = flashfsGetOffset();
+
+    // Grow the clusters until the file is addressable by a FAT16
+    uint32_t clusterSize;
+    volume.sectorsPerCluster = 1;
+    for (;;) {
+        clusterSize = volume.sectorsPerCluster * FLASHFS_FAT_SECTOR_SIZE;
+        volume.fileClusters = (volume.logSize + clusterSize - 1) / clusterSize;
+        if (volume.fileClusters < FAT16_MAX_CLUSTERS || volume.sectorsPerCluster == 128) {
+            break;
+        }
+        volume.sectorsPerCluster *= 2;
+    }
+
+    // Pad small volumes with free clusters so that they still count as FAT16
+    volume.clusterCount = volume.fileClusters < FAT16_MIN_CLUSTERS ? FAT16_MIN_CLUSTERS : volume.fileClusters;
+
+    volume.fatSectors = ((volume.clusterCount + FAT_FIRST_CLUSTER) * sizeof(uint16_t) + FLASHFS_FAT_SECTOR_SIZE - 1) / FLASHFS_FAT_SECTOR_SIZE;
+    volume.rootSector = FAT_RESERVED_SECTORS + FAT_COPIES * volume.fatSectors;
+    volume.firstDataSector = volume.rootSector + FAT_ROOT_SECTORS;
+    volume.sectorCount = volume.firstDataSector + volume.clusterCount * volume.sectorsPerCluster;
+}
+
+uint32_t flashfsFatGetSectorCount(void)
+{
+    return volume.sectorCount;
+}
+
+static void flashfsFatBootSector(uint8_t *buffer)
+{
+    static const uint8_t jump[] = { 0xEB, 0x3C, 0x90 };
+
+    memcpy(buffer, jump, sizeof(jump));
+    memcpy(buffer + 3, "MSDOS5.0", 8);
+    putU16(buffer + 11, FLASHFS_FAT_SECTOR_SIZE);
+    buffer[13] = volume.sectorsPerCluster;
+    putU16(buffer + 14, FAT_RESERVED_SECTORS);
+    buffer[16] = FAT_COPIES;
+    putU16(buffer + 17, FAT_ROOT_ENTRIES);
+    if (volume.sectorCount < 0x10000) {
+        putU16(buffer + 19, volume.sectorCount);
+    } else {
+        putU32(buffer + 32, volume.sectorCount);
+    }
+    buffer[21] = 0xF8; // fixed disk
+    putU16(buffer + 22, volume.fatSectors);
+    putU16(buffer + 24, 63); // sectors per track
+    putU16(buffer + 26, 255); // heads
+    buffer[36] = 0x80; // drive number
+    buffer[38] = 0x29; // extended boot signature, the next three fields are present
+    putU32(buffer + 39, volume.logSize); // volume serial, changes when the logs do
+    memcpy(buffer + 43, FLASHFS_FAT_VOLUME_LABEL, 11);
+    memcpy(buffer + 54, "FAT16   ", 8);
+    buffer[510] = 0x55;
+    buffer[511] = 0xAA;
+}
+
+static void flashfsFatTableSector(uint32_t fatSector, uint8_t *buffer)
+{
+    const uint32_t lastFileCluster = FAT_FIRST_CLUSTER + volume.fileClusters - 1;
+
+    for (unsigned i = 0; i < FAT_ENTRIES_PER_SECTOR; i++) {
+        const uint32_t cluster = fatSector * FAT_ENTRIES_PER_SECTOR + i;
+        uint16_t entry;
+
+        if (cluster == 0) {
+            entry = 0xFFF8; // media descriptor
+        } else if (cluster == 1 || cluster == lastFileCluster) {
+            entry = 0xFFFF; // end of chain
+        } else if (cluster < lastFileCluster) {
+            entry = cluster + 1; // the file is one contiguous run of clusters
+        } else {
+            entry = 0; // free
+        }
+        putU16(buffer + i * sizeof(uint16_t), entry);
+    }
+}
+
+static void flashfsFatDirEntry(uint8_t *entry, const char *name, uint8_t attributes, uint16_t firstCluster, uint32_t size)
+{
+    memcpy(entry, name, 11);
+    entry[11] = attributes;
+    putU16(entry + 22, FAT_TIME);
+    putU16(entry + 24, FAT_DATE);
+    putU16(entry + 26, firstCluster);
+    putU32(entry + 28, size);
+}
+
+static void flashfsFatRootSector(uint8_t *buffer)
+{
+    flashfsFatDirEntry(buffer, FLASHFS_FAT_VOLUME_LABEL, FAT_ATTRIBUTE_VOLUME_ID, 0, 0);
+
+    if (volume.logSize > 0) {
+        flashfsFatDirEntry(buffer + FAT_DIR_ENTRY_SIZE, FLASHFS_FAT_FILE_NAME, FAT_ATTRIBUTE_READ_ONLY, FAT_FIRST_CLUSTER, volume.logSize);
+    }
+}
+
+/**
+ * Fill `buffer` with FLASHFS_FAT_SECTOR_SIZE bytes of the given sector of the volume.
+ */
+void flashfsFatReadSector(uint32_t sector, uint8_t *buffer)
+{
+    memset(buffer, 0, FLASHFS_FAT_SECTOR_SIZE);
+
+    if (sector == 0) {
+        flashfsFatBootSector(buffer);
+    } else if (sector < volume.rootSector) {
+        flashfsFatTableSector((sector - FAT_RESERVED_SECTORS) % volume.fatSectors, buffer);
+    } else if (sector < volume.firstDataSector) {
+        flashfsFatRootSector(buffer);
+    } else {
+        // File data maps straight onto the flash, the file starts at the first data cluster
+        const uint32_t address = (sector - volume.firstDataSector) * FLASHFS_FAT_SECTOR_SIZE;
+
+        if (address < volume.logSize) {
+            const uint32_t remaining = volume.logSize - address;
+
+            flashfsReadAbs(address, buffer, remaining < FLASHFS_FAT_SECTOR_SIZE ? remaining : FLASHFS_FAT_SECTOR_SIZE);
+        }
+    }
+}
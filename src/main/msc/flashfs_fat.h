@@ -0,0 +1,31 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * A read-only FAT16 volume synthesized on the fly from the flashfs contents, so a host can mount the dataflash over
+ * USB mass storage. The volume holds a single file with everything logged so far, blackbox decoders split it into
+ * the individual logs.
+ */
+#define FLASHFS_FAT_SECTOR_SIZE 512
+
+void flashfsFatInit(void);
+uint32_t flashfsFatGetSectorCount(void);
+void flashfsFatReadSector(uint32_t sector, uint8_t *buffer);
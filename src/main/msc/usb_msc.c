@@ -0,0 +1,93 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * USB mass storage boot mode. Requested with systemResetToMsc(), the board then comes up as a USB drive exposing the
+ * log storage instead of running the flight controller, until the cable is unplugged.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#ifdef USE_USB_MSC
+
+#include "drivers/io.h"
+#include "drivers/light_led.h"
+#include "drivers/system.h"
+
+#include "usbd_core.h"
+#include "usbd_desc.h"
+#include "usbd_msc.h"
+#include "vcp_hal/usbd_cdc_interface.h"
+
+#include "msc/usb_msc.h"
+#include "msc/usbd_storage.h"
+
+#define MSC_POLL_INTERVAL_MS    250
+#define MSC_DISCONNECT_POLLS    8
+
+extern USBD_HandleTypeDef USBD_Device;
+
+/**
+ * Bring USB up as a mass storage device for the given storage. Never returns.
+ */
+void mscStart(mscStorage_e storage)
+{
+    IOInit(IOGetByTag(IO_TAG(PA11)), OWNER_USB, 0);
+    IOInit(IOGetByTag(IO_TAG(PA12)), OWNER_USB, 0);
+
+    USBD_Init(&USBD_Device, &MSC_Desc, 0);
+
+    USBD_RegisterClass(&USBD_Device, USBD_MSC_CLASS);
+
+    switch (storage) {
+#ifdef USE_SDCARD
+    case MSC_STORAGE_SDCARD:
+        USBD_MSC_RegisterStorage(&USBD_Device, &USBD_MSC_SDCARD_fops);
+        break;
+#endif
+#ifdef USE_FLASHFS
+    case MSC_STORAGE_FLASHFS:
+        USBD_MSC_RegisterStorage(&USBD_Device, &USBD_MSC_FLASHFS_fops);
+        break;
+#endif
+    default:
+        systemReset();
+    }
+
+    USBD_Start(&USBD_Device);
+
+    // Transfers are served from the USB interrupt, we just show we're alive and watch for the cable going away
+    bool connected = false;
+    int disconnectedPolls = 0;
+    while (true) {
+        LED0_TOGGLE;
+        delay(MSC_POLL_INTERVAL_MS);
+
+        if (usbIsConnected()) {
+            connected = true;
+            disconnectedPolls = 0;
+        } else if (connected && ++disconnectedPolls >= MSC_DISCONNECT_POLLS) {
+            // Not just a bus reset from the host, the cable is gone
+            systemReset();
+        }
+    }
+}
+
+#endif
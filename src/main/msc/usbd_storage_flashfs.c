@@ -0,0 +1,119 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * USB mass storage access to the dataflash, as the read-only FAT volume built by flashfs_fat.c.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#if defined(USE_USB_MSC) && defined(USE_FLASHFS)
+
+#include "common/utils.h"
+
+#include "io/flashfs.h"
+
+#include "msc/flashfs_fat.h"
+#include "msc/usbd_storage.h"
+
+#define STORAGE_LUN_NBR 1
+
+static const int8_t STORAGE_Inquirydata[] = { // 36 bytes
+    0x00, 0x80, 0x02, 0x02,
+    (STANDARD_INQUIRY_DATA_LEN - 5),
+    0x00, 0x00, 0x00,
+    'B', 'T', 'F', 'L', ' ', ' ', ' ', ' ', // Manufacturer: 8 bytes
+    'D', 'a', 't', 'a', 'f', 'l', 'a', 's', // Product: 16 bytes
+    'h', ' ', ' ', ' ', ' ', ' ', ' ', ' ',
+    '0', '.', '0', '1',                     // Version: 4 bytes
+};
+
+static int8_t STORAGE_Init(uint8_t lun)
+{
+    UNUSED(lun);
+
+    flashfsFatInit();
+
+    return 0;
+}
+
+static int8_t STORAGE_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
+{
+    UNUSED(lun);
+
+    *block_num = flashfsFatGetSectorCount();
+    *block_size = FLASHFS_FAT_SECTOR_SIZE;
+
+    return 0;
+}
+
+static int8_t STORAGE_IsReady(uint8_t lun)
+{
+    UNUSED(lun);
+
+    return flashfsGetSize() > 0 ? 0 : -1;
+}
+
+static int8_t STORAGE_IsWriteProtected(uint8_t lun)
+{
+    UNUSED(lun);
+
+    return 1;
+}
+
+static int8_t STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+    UNUSED(lun);
+
+    for (int i = 0; i < blk_len; i++) {
+        flashfsFatReadSector(blk_addr + i, buf + i * FLASHFS_FAT_SECTOR_SIZE);
+    }
+
+    return 0;
+}
+
+static int8_t STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+    UNUSED(lun);
+    UNUSED(buf);
+    UNUSED(blk_addr);
+    UNUSED(blk_len);
+
+    // The volume only exists as a view of the logs
+    return -1;
+}
+
+static int8_t STORAGE_GetMaxLun(void)
+{
+    return STORAGE_LUN_NBR - 1;
+}
+
+USBD_StorageTypeDef USBD_MSC_FLASHFS_fops = {
+    STORAGE_Init,
+    STORAGE_GetCapacity,
+    STORAGE_IsReady,
+    STORAGE_IsWriteProtected,
+    STORAGE_Read,
+    STORAGE_Write,
+    STORAGE_GetMaxLun,
+    (int8_t *)STORAGE_Inquirydata,
+};
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * USB mass storage access to the SD card, block for block. The host owns the card's filesystem while this is in use,
+ * so asyncfatfs must not be running.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#if defined(USE_USB_MSC) && defined(USE_SDCARD)
+
+#include "common/utils.h"
+
+#include "drivers/sdcard.h"
+
+#include "msc/usbd_storage.h"
+
+#define STORAGE_LUN_NBR 1
+#define SDCARD_BLOCK_SIZE 512
+
+typedef enum {
+    SDCARD_MSC_PENDING,
+    SDCARD_MSC_SUCCESS,
+    SDCARD_MSC_FAILURE
+} sdcardMscResult_e;
+
+static volatile sdcardMscResult_e operationResult;
+
+static const int8_t STORAGE_Inquirydata[] = { // 36 bytes
+    0x00, 0x80, 0x02, 0x02,
+    (STANDARD_INQUIRY_DATA_LEN - 5),
+    0x00, 0x00, 0x00,
+    'B', 'T', 'F', 'L', ' ', ' ', ' ', ' ', // Manufacturer: 8 bytes
+    'S', 'D', ' ', 'c', 'a', 'r', 'd', ' ', // Product: 16 bytes
+    ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ',
+    '0', '.', '0', '1',                     // Version: 4 bytes
+};
+
+static void sdcardMscOperationComplete(sdcardBlockOperation_e operation, uint32_t blockIndex, uint8_t *buffer, uint32_t callbackData)
+{
+    UNUSED(operation);
+    UNUSED(blockIndex);
+    UNUSED(callbackData);
+
+    operationResult = buffer ? SDCARD_MSC_SUCCESS : SDCARD_MSC_FAILURE;
+}
+
+// The card driver is asynchronous while the mass storage class expects each transfer to be done on return
+static bool sdcardMscWaitForResult(void)
+{
+    while (operationResult == SDCARD_MSC_PENDING) {
+        sdcard_poll();
+    }
+
+    return operationResult == SDCARD_MSC_SUCCESS;
+}
+
+static int8_t STORAGE_Init(uint8_t lun)
+{
+    UNUSED(lun);
+
+    // Let the card finish initialising, it is started before USB comes up
+    while (sdcard_isInserted() && sdcard_isFunctional() && !sdcard_isInitialized()) {
+        sdcard_poll();
+    }
+
+    return 0;
+}
+
+static int8_t STORAGE_GetCapacity(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
+{
+    UNUSED(lun);
+
+    *block_num = sdcard_getMetadata()->numBlocks;
+    *block_size = SDCARD_BLOCK_SIZE;
+
+    return 0;
+}
+
+static int8_t STORAGE_IsReady(uint8_t lun)
+{
+    UNUSED(lun);
+
+    return sdcard_isInserted() && sdcard_isInitialized() ? 0 : -1;
+}
+
+static int8_t STORAGE_IsWriteProtected(uint8_t lun)
+{
+    UNUSED(lun);
+
+    return 0;
+}
+
+static int8_t STORAGE_Read(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+    UNUSED(lun);
+
+    for (int i = 0; i < blk_len; i++) {
+        operationResult = SDCARD_MSC_PENDING;
+
+        while (!sdcard_readBlock(blk_addr + i, buf + i * SDCARD_BLOCK_SIZE, sdcardMscOperationComplete, 0)) {
+            if (!sdcard_isFunctional()) {
+                return -1;
+            }
+            sdcard_poll();
+        }
+
+        if (!sdcardMscWaitForResult()) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int8_t STORAGE_Write(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+    UNUSED(lun);
+
+    for (int i = 0; i < blk_len; i++) {
+        sdcardOperationStatus_e status;
+
+        operationResult = SDCARD_MSC_PENDING;
+
+        while ((status = sdcard_writeBlock(blk_addr + i, buf + i * SDCARD_BLOCK_SIZE, sdcardMscOperationComplete, 0)) == SDCARD_OPERATION_BUSY) {
+            if (!sdcard_isFunctional()) {
+                return -1;
+            }
+            sdcard_poll();
+        }
+
+        if (status == SDCARD_OPERATION_FAILURE) {
+            return -1;
+        }
+
+        if (status == SDCARD_OPERATION_IN_PROGRESS && !sdcardMscWaitForResult()) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int8_t STORAGE_GetMaxLun(void)
+{
+    return STORAGE_LUN_NBR - 1;
+}
+
+USBD_StorageTypeDef USBD_MSC_SDCARD_fops = {
+    STORAGE_Init,
+    STORAGE_GetCapacity,
+    STORAGE_IsReady,
+    STORAGE_IsWriteProtected,
+    STORAGE_Read,
+    STORAGE_Write,
+    STORAGE_GetMaxLun,
+    (int8_t *)STORAGE_Inquirydata,
+};
+
+#endif
@@ -23,7 +23,8 @@
 typedef enum {
     MSP_RESULT_ACK = 1,
     MSP_RESULT_ERROR = -1,
-    MSP_RESULT_NO_REPLY = 0
+    MSP_RESULT_NO_REPLY = 0,
+    MSP_RESULT_BUSY = 2         // nothing was done, the port holds the request and runs it again on its next call
 } mspResult_e;
 
 typedef struct mspPacket_s {
@@ -35,3 +36,5 @@ typedef struct mspPacket_s {
 struct serialPort_s;
 typedef void (*mspPostProcessFnPtr)(struct serialPort_s *port); // msp post process function, used for gracefully handling reboots, etc.
 typedef mspResult_e (*mspProcessCommandFnPtr)(mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn);
+// handler of a single command, reads the request from src and writes the reply to dst
+typedef mspResult_e (*mspCommandFnPtr)(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn);
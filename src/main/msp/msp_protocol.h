@@ -59,7 +59,7 @@
 #define MSP_PROTOCOL_VERSION                0
 
 #define API_VERSION_MAJOR                   1 // increment when major changes are made
-#define API_VERSION_MINOR                   23 // increment when any change is made, reset to zero when major changes are released after changing API_VERSION_MAJOR
+#define API_VERSION_MINOR                   27 // increment when any change is made, reset to zero when major changes are released after changing API_VERSION_MAJOR
 
 #define API_VERSION_LENGTH                  2
 
@@ -171,6 +171,15 @@
 #define MSP_DATAFLASH_READ              71 //out message - get content of dataflash chip
 #define MSP_DATAFLASH_ERASE             72 //in message - erase dataflash chip
 
+// Compression methods for MSP_DATAFLASH_READ replies, the summary reports a mask of (1 << method) for those supported
+#define DATAFLASH_COMPRESSION_NONE              0
+#define DATAFLASH_COMPRESSION_BLACKBOX_BLOCKS   1 // blocks as laid out in blackbox/blackbox_compress.h
+#ifdef USE_BLACKBOX_COMPRESSION
+#define DATAFLASH_COMPRESSION_SUPPORTED_MASK    ((1 << DATAFLASH_COMPRESSION_NONE) | (1 << DATAFLASH_COMPRESSION_BLACKBOX_BLOCKS))
+#else
+#define DATAFLASH_COMPRESSION_SUPPORTED_MASK    (1 << DATAFLASH_COMPRESSION_NONE)
+#endif
+
 #define MSP_LOOP_TIME                   73 //out message         Returns FC cycle time i.e looptime parameter
 #define MSP_SET_LOOP_TIME               74 //in message          Sets FC cycle time i.e looptime parameter
 
@@ -290,6 +299,19 @@
 #define MSP_UID                  160    //out message         Unique device ID
 #define MSP_GPSSVINFO            164    //out message         get Signal Strength (only U-Blox)
 #define MSP_GPSSTATISTICS        166    //out message         get GPS debugging data
+#define MSP_TASK_LATENCY         167    //out message         execution time and start lateness histograms of one task, task id in the request
+#define MSP_SCHEDULER_TRACE      168    //out message         scheduler trace events, index of the first event in the request
+#define MSP_LOOP_LATENCY         169    //out message         gyro to PID and gyro to motor output latency statistics
+#define MSP_CYCLE_PROFILE        170    //out message         flight loop cycle counts from the profiler probes
+#define MSP_DSHOT_COMMAND_STATUS 171    //out message         DSHOT command queue state
+#define MSP_SDCARD_PROFILE       172    //out message         SD card block latency statistics and boot benchmark result
+#define MSP_CONFIG_BLOCK         173    //out message         raw bytes of the stored configuration, offset and length in the request
+#define MSP_MEMORY_REPORT        174    //out message         static RAM, stack high-water mark and DMA buffer sizes
+#define MSP_DATAFLASH_LOG_INDEX  175    //out message         start, length and time of the logs on the dataflash, first log in the request
+#define MSP_POST_MORTEM          176    //out message         registers, stack, task times and scheduler trace saved by the last fault or lockup
+#define MSP_SET_STREAM           236    //in message          push a reply at a fixed rate on this port, command (16 bit) and rate in Hz (16 bit)
+#define MSP_SET_CONFIG_BLOCK     237    //in message          write raw bytes of the configuration, saved by MSP_EEPROM_WRITE
+#define MSP_SET_SCHEDULER_TRACE  238    //in message          re-arm (0) or trigger (1) the scheduler trace
 #define MSP_ACC_TRIM             240    //out message         get acc angle trim values
 #define MSP_SET_ACC_TRIM         239    //in message          set acc angle trim values
 #define MSP_SERVO_MIX_RULES      241    //out message         Returns servo mixer configuration
@@ -21,12 +21,16 @@
 
 #include "platform.h"
 
+#include "common/maths.h"
 #include "common/streambuf.h"
 #include "common/utils.h"
 
+#include "drivers/system.h"
+
 #include "io/serial.h"
 
 #include "msp/msp.h"
+#include "msp/msp_protocol.h"
 #include "msp/msp_serial.h"
 
 static mspPort_t mspPorts[MAX_MSP_PORT_COUNT];
@@ -71,6 +75,14 @@ void mspSerialReleasePortIfAllocated(serialPort_t *serialPort)
     }
 }
 
+static uint8_t mspSerialChecksumBuf(uint8_t checksum, const uint8_t *data, int len)
+{
+    while (len-- > 0) {
+        checksum ^= *data++;
+    }
+    return checksum;
+}
+
 static bool mspSerialProcessReceivedData(mspPort_t *mspPort, uint8_t c)
 {
     if (mspPort->c_state == MSP_IDLE) {
@@ -80,7 +92,58 @@ static bool mspSerialProcessReceivedData(mspPort_t *mspPort, uint8_t c)
             return false;
         }
     } else if (mspPort->c_state == MSP_HEADER_START) {
-        mspPort->c_state = (c == 'M') ? MSP_HEADER_M : MSP_IDLE;
+        if (c == 'M') {
+            mspPort->c_state = MSP_HEADER_M;
+        } else if (c == 'X') {
+            mspPort->c_state = MSP_HEADER_X;
+        } else {
+            mspPort->c_state = MSP_IDLE;
+        }
+    } else if (mspPort->c_state == MSP_HEADER_X) {
+        if (c == '<') {
+            mspPort->offset = 0;
+            mspPort->checksum = 0;
+            mspPort->c_state = MSP_HEADER_V2_NATIVE;
+        } else {
+            mspPort->c_state = MSP_IDLE;
+        }
+    } else if (mspPort->c_state == MSP_HEADER_V2_NATIVE) {
+        mspPort->checksum = crc8_dvb_s2(mspPort->checksum, c);
+        switch (mspPort->offset++) {
+        case 0: // flags, none defined
+            break;
+        case 1:
+            mspPort->cmdMSP = c;
+            break;
+        case 2:
+            mspPort->cmdMSP |= c << 8;
+            break;
+        case 3:
+            mspPort->dataSize = c;
+            break;
+        default:
+            mspPort->dataSize |= c << 8;
+            mspPort->offset = 0;
+            if (mspPort->dataSize > MSP_PORT_INBUF_SIZE) {
+                mspPort->c_state = MSP_IDLE;
+            } else {
+                mspPort->c_state = mspPort->dataSize ? MSP_PAYLOAD_V2_NATIVE : MSP_CHECKSUM_V2_NATIVE;
+            }
+            break;
+        }
+    } else if (mspPort->c_state == MSP_PAYLOAD_V2_NATIVE) {
+        mspPort->checksum = crc8_dvb_s2(mspPort->checksum, c);
+        mspPort->inBuf[mspPort->offset++] = c;
+        if (mspPort->offset >= mspPort->dataSize) {
+            mspPort->c_state = MSP_CHECKSUM_V2_NATIVE;
+        }
+    } else if (mspPort->c_state == MSP_CHECKSUM_V2_NATIVE) {
+        if (mspPort->checksum == c) {
+            mspPort->mspVersion = MSP_V2_NATIVE;
+            mspPort->c_state = MSP_COMMAND_RECEIVED;
+        } else {
+            mspPort->c_state = MSP_IDLE;
+        }
     } else if (mspPort->c_state == MSP_HEADER_M) {
         mspPort->c_state = (c == '<') ? MSP_HEADER_ARROW : MSP_IDLE;
     } else if (mspPort->c_state == MSP_HEADER_ARROW) {
@@ -102,6 +165,7 @@ static bool mspSerialProcessReceivedData(mspPort_t *mspPort, uint8_t c)
         mspPort->inBuf[mspPort->offset++] = c;
     } else if (mspPort->c_state == MSP_HEADER_CMD && mspPort->offset >= mspPort->dataSize) {
         if (mspPort->checksum == c) {
+            mspPort->mspVersion = MSP_V1;
             mspPort->c_state = MSP_COMMAND_RECEIVED;
         } else {
             mspPort->c_state = MSP_IDLE;
@@ -110,51 +174,190 @@ static bool mspSerialProcessReceivedData(mspPort_t *mspPort, uint8_t c)
     return true;
 }
 
-static uint8_t mspSerialChecksumBuf(uint8_t checksum, const uint8_t *data, int len)
+static bool mspSerialInPayload(const mspPort_t *mspPort)
 {
-    while (len-- > 0) {
-        checksum ^= *data++;
+    return mspPort->c_state == MSP_PAYLOAD_V2_NATIVE || (mspPort->c_state == MSP_HEADER_CMD && mspPort->offset < mspPort->dataSize);
+}
+
+// takes the rest of the payload, or as much of it as has arrived, from the port's RX ring in one go
+static void mspSerialReadPayload(mspPort_t *mspPort, sbufRing_t *src)
+{
+    uint8_t *payload = &mspPort->inBuf[mspPort->offset];
+    const int len = MIN(mspPort->dataSize - mspPort->offset, sbufRingBytesRemaining(src));
+
+    sbufRingReadData(src, payload, len);
+    mspPort->offset += len;
+    if (mspPort->c_state == MSP_PAYLOAD_V2_NATIVE) {
+        mspPort->checksum = crc8_dvb_s2_buf(mspPort->checksum, payload, len);
+        if (mspPort->offset >= mspPort->dataSize) {
+            mspPort->c_state = MSP_CHECKSUM_V2_NATIVE;
+        }
+    } else {
+        mspPort->checksum = mspSerialChecksumBuf(mspPort->checksum, payload, len);
     }
-    return checksum;
 }
 
 #define JUMBO_FRAME_SIZE_LIMIT 255
+#define CHECKSUM_STARTPOS 3  // checksum starts from the mspLen field in v1 and the flags field in v2
 
-static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet)
+// fills in the frame header for a payload of len bytes, returns the header length
+static int mspSerialEncodeHeader(const mspPort_t *msp, const mspPacket_t *packet, int len, uint8_t *hdr)
 {
-    serialBeginWrite(msp->port);
-    const int len = sbufBytesRemaining(&packet->buf);
-    const int mspLen = len < JUMBO_FRAME_SIZE_LIMIT ? len : JUMBO_FRAME_SIZE_LIMIT;
-    uint8_t hdr[8] = {'$', 'M', packet->result == MSP_RESULT_ERROR ? '!' : '>', mspLen, packet->cmd};
-    int hdrLen = 5;
-#define CHECKSUM_STARTPOS 3  // checksum starts from mspLen field
+    hdr[0] = '$';
+    hdr[2] = packet->result == MSP_RESULT_ERROR ? '!' : '>';
+    if (msp->mspVersion == MSP_V2_NATIVE) {
+        hdr[1] = 'X';
+        hdr[3] = 0;
+        hdr[4] = packet->cmd & 0xff;
+        hdr[5] = (packet->cmd >> 8) & 0xff;
+        hdr[6] = len & 0xff;
+        hdr[7] = (len >> 8) & 0xff;
+        return 3 + MSP_V2_NATIVE_HEADER_SIZE;
+    }
+
+    hdr[1] = 'M';
+    hdr[3] = len < JUMBO_FRAME_SIZE_LIMIT ? len : JUMBO_FRAME_SIZE_LIMIT;
+    hdr[4] = packet->cmd;
     if (len >= JUMBO_FRAME_SIZE_LIMIT) {
-        hdrLen += 2;
         hdr[5] = len & 0xff;
         hdr[6] = (len >> 8) & 0xff;
+        return 7;
+    }
+    return 5;
+}
+
+static uint8_t mspSerialChecksum(const mspPort_t *msp, uint8_t checksum, const uint8_t *data, int len)
+{
+    if (msp->mspVersion == MSP_V2_NATIVE) {
+        return crc8_dvb_s2_buf(checksum, data, len);
     }
+    return mspSerialChecksumBuf(checksum, data, len);
+}
+
+// writes a frame straight to the port, waiting for TX space if need be
+static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet)
+{
+    const int len = sbufBytesRemaining(&packet->buf);
+    uint8_t hdr[MSP_MAX_HEADER_SIZE];
+    const int hdrLen = mspSerialEncodeHeader(msp, packet, len, hdr);
+    uint8_t checksum = mspSerialChecksum(msp, 0, hdr + CHECKSUM_STARTPOS, hdrLen - CHECKSUM_STARTPOS);
+
+    serialBeginWrite(msp->port);
     serialWriteBuf(msp->port, hdr, hdrLen);
-    uint8_t checksum = mspSerialChecksumBuf(0, hdr + CHECKSUM_STARTPOS, hdrLen - CHECKSUM_STARTPOS);
     if (len > 0) {
         serialWriteBuf(msp->port, sbufPtr(&packet->buf), len);
-        checksum = mspSerialChecksumBuf(checksum, sbufPtr(&packet->buf), len);
+        checksum = mspSerialChecksum(msp, checksum, sbufPtr(&packet->buf), len);
     }
     serialWriteBuf(msp->port, &checksum, 1);
     serialEndWrite(msp->port);
-    return sizeof(hdr) + len + 1; // header, data, and checksum
+    return hdrLen + len + 1; // header, data, and checksum
 }
 
-static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn)
+/*
+ * Frames a reply built in the port's outBuf in place, the header goes into the space reserved in front of the payload
+ * and the checksum behind it. The frame is then sent by mspSerialSendPending().
+ */
+static void mspSerialQueueReply(mspPort_t *msp, mspPacket_t *packet)
+{
+    const int len = sbufBytesRemaining(&packet->buf);
+    uint8_t *payload = sbufPtr(&packet->buf);
+    uint8_t hdr[MSP_MAX_HEADER_SIZE];
+    const int hdrLen = mspSerialEncodeHeader(msp, packet, len, hdr);
+
+    uint8_t *frame = payload - hdrLen;
+    memcpy(frame, hdr, hdrLen);
+    payload[len] = mspSerialChecksum(msp, 0, frame + CHECKSUM_STARTPOS, hdrLen - CHECKSUM_STARTPOS + len);
+
+    msp->txPtr = frame;
+    msp->txPending = hdrLen + len + 1;
+}
+
+// sends what the port has room for, up to budget bytes, and returns true once the whole reply is out
+static bool mspSerialSendPending(mspPort_t *msp, uint32_t budget)
+{
+    serialBeginWrite(msp->port);
+    while (msp->txPending && budget) {
+        const uint32_t len = MIN(MIN(msp->txPending, serialTxBytesFree(msp->port)), budget);
+        if (len == 0) {
+            break;
+        }
+        serialWriteBuf(msp->port, msp->txPtr, len);
+        msp->txPtr += len;
+        msp->txPending -= len;
+        budget -= len;
+    }
+    serialEndWrite(msp->port);
+    return msp->txPending == 0;
+}
+
+static void mspSerialFlushPending(mspPort_t *msp)
+{
+    while (!mspSerialSendPending(msp, UINT32_MAX));
+}
+
+/*
+ * MSP_SET_STREAM is answered here rather than by the FC, the streams belong to the port. The request holds the
+ * command to stream and its rate in Hz, a rate of 0 stops that command and an empty request stops them all.
+ */
+static mspResult_e mspSerialSetStream(mspPort_t *msp, sbuf_t *src)
 {
-    static uint8_t outBuf[MSP_PORT_OUTBUF_SIZE];
+    if (sbufBytesRemaining(src) == 0) {
+        memset(msp->streams, 0, sizeof(msp->streams));
+        return MSP_RESULT_ACK;
+    }
+    if (sbufBytesRemaining(src) < 4) {
+        return MSP_RESULT_ERROR;
+    }
+    const uint16_t cmd = sbufReadU16(src);
+    const uint16_t rateHz = MIN(sbufReadU16(src), MSP_STREAM_MAX_RATE_HZ);
+
+    mspStream_t *slot = NULL;
+    for (int i = 0; i < MSP_STREAM_COUNT; i++) {
+        mspStream_t *stream = &msp->streams[i];
+        if (stream->periodUs && stream->cmd == cmd) {
+            slot = stream;
+            break;
+        }
+        if (!stream->periodUs && !slot) {
+            slot = stream;
+        }
+    }
+    if (!slot) {
+        return rateHz ? MSP_RESULT_ERROR : MSP_RESULT_ACK;
+    }
+    slot->cmd = cmd;
+    slot->periodUs = rateHz ? 1000000 / rateHz : 0;
+    slot->dueAt = micros();
+    return MSP_RESULT_ACK;
+}
 
+// runs a command and queues its reply in the port's outBuf
+static mspResult_e mspSerialRunCommand(mspPort_t *msp, mspPacket_t *command, mspProcessCommandFnPtr mspProcessCommandFn, mspPostProcessFnPtr *mspPostProcessFn)
+{
     mspPacket_t reply = {
-        .buf = { .ptr = outBuf, .end = ARRAYEND(outBuf), },
+        .buf = { .ptr = msp->outBuf + MSP_MAX_HEADER_SIZE, .end = msp->outBuf + MSP_MAX_HEADER_SIZE + MSP_PORT_OUTBUF_SIZE, },
         .cmd = -1,
         .result = 0,
     };
     uint8_t *outBufHead = reply.buf.ptr;
 
+    mspResult_e status;
+    if (command->cmd == MSP_SET_STREAM) {
+        reply.cmd = command->cmd;
+        reply.result = status = mspSerialSetStream(msp, &command->buf);
+    } else {
+        status = mspProcessCommandFn(command, &reply, mspPostProcessFn);
+    }
+
+    if (status != MSP_RESULT_NO_REPLY && status != MSP_RESULT_BUSY) {
+        sbufSwitchToReader(&reply.buf, outBufHead); // change streambuf direction
+        mspSerialQueueReply(msp, &reply);
+    }
+    return status;
+}
+
+static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn)
+{
     mspPacket_t command = {
         .buf = { .ptr = msp->inBuf, .end = msp->inBuf + msp->dataSize, },
         .cmd = msp->cmdMSP,
@@ -162,21 +365,58 @@ static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspPr
     };
 
     mspPostProcessFnPtr mspPostProcessFn = NULL;
-    const mspResult_e status = mspProcessCommandFn(&command, &reply, &mspPostProcessFn);
-
-    if (status != MSP_RESULT_NO_REPLY) {
-        sbufSwitchToReader(&reply.buf, outBufHead); // change streambuf direction
-        mspSerialEncode(msp, &reply);
+    if (mspSerialRunCommand(msp, &command, mspProcessCommandFn, &mspPostProcessFn) == MSP_RESULT_BUSY) {
+        // the request stays in inBuf, and nothing more is read from the port until it has been run
+        return NULL;
     }
 
     msp->c_state = MSP_IDLE;
     return mspPostProcessFn;
 }
 
+/*
+ * Sends the replies of the streams that are due, each as if requested without a payload. A reply that won't fit the
+ * TX buffer and the budget of this call is dropped rather than queued, so the stream stays current and never delays
+ * the replies to requests. A stream that falls behind skips the periods it missed.
+ */
+static void mspSerialProcessStreams(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn, uint32_t txBudget)
+{
+    const timeUs_t currentTimeUs = micros();
+
+    for (int i = 0; i < MSP_STREAM_COUNT && !msp->txPending; i++) {
+        mspStream_t *stream = &msp->streams[i];
+        if (!stream->periodUs || cmpTimeUs(currentTimeUs, stream->dueAt) < 0) {
+            continue;
+        }
+        stream->dueAt += stream->periodUs;
+        if (cmpTimeUs(currentTimeUs, stream->dueAt) >= 0) {
+            stream->dueAt = currentTimeUs + stream->periodUs;
+        }
+
+        mspPacket_t command = {
+            .buf = { .ptr = msp->inBuf, .end = msp->inBuf, },
+            .cmd = stream->cmd,
+            .result = 0,
+        };
+        // commands that take over the port, like a reboot, are not run from a stream
+        mspPostProcessFnPtr mspPostProcessFn = NULL;
+        mspSerialRunCommand(msp, &command, mspProcessCommandFn, &mspPostProcessFn);
+
+        const uint16_t frameLength = msp->txPending;
+        if (frameLength > MIN(txBudget, serialTxBytesFree(msp->port))) {
+            msp->txPending = 0;
+            continue;
+        }
+        mspSerialSendPending(msp, frameLength);
+        txBudget -= frameLength;
+    }
+}
+
 /*
  * Process MSP commands from serial ports configured as MSP ports.
  *
- * Called periodically by the scheduler.
+ * Called periodically by the scheduler. Every port has its own reply buffer and a byte budget per call, a long reply
+ * is sent over several calls as TX space frees up, so one port can't hold up the others or the task.
  */
 void mspSerialProcess(mspEvaluateNonMspData_e evaluateNonMspData, mspProcessCommandFnPtr mspProcessCommandFn)
 {
@@ -185,22 +425,64 @@ void mspSerialProcess(mspEvaluateNonMspData_e evaluateNonMspData, mspProcessComm
         if (!mspPort->port) {
             continue;
         }
+        const bool isVcp = mspPort->port->identifier == SERIAL_PORT_USB_VCP;
+        // USB replies drain fast enough to work through a few pipelined requests (e.g. dataflash reads) per call
+        const int maxCommands = isVcp ? MSP_SERIAL_VCP_COMMANDS_PER_CALL : 1;
+        uint32_t txBudget = isVcp ? MSP_SERIAL_VCP_COMMANDS_PER_CALL * sizeof(mspPort->outBuf) : MSP_SERIAL_TX_BYTES_PER_CALL;
+
+        if (mspPort->txPending) {
+            const uint16_t pending = mspPort->txPending;
+            if (!mspSerialSendPending(mspPort, txBudget)) {
+                continue;
+            }
+            txBudget -= MIN(pending, txBudget);
+        }
+
         mspPostProcessFnPtr mspPostProcessFn = NULL;
-        while (serialRxBytesWaiting(mspPort->port)) {
+        int commandCount = 0;
+        // bytes are read in place from the RX ring where the port has one, and taken off it once the loop is done
+        sbufRing_t rx;
+        const bool rxView = serialRxView(mspPort->port, &rx);
+        // a request held over from a call the FC was busy for is run again before anything else is read
+        while (mspPort->c_state == MSP_COMMAND_RECEIVED || (rxView ? sbufRingBytesRemaining(&rx) : (int)serialRxBytesWaiting(mspPort->port))) {
+            if (rxView && mspSerialInPayload(mspPort)) {
+                mspSerialReadPayload(mspPort, &rx);
+                continue;
+            }
 
-            const uint8_t c = serialRead(mspPort->port);
-            const bool consumed = mspSerialProcessReceivedData(mspPort, c);
+            if (mspPort->c_state != MSP_COMMAND_RECEIVED) {
+                const uint8_t c = rxView ? sbufRingReadU8(&rx) : serialRead(mspPort->port);
+                const bool consumed = mspSerialProcessReceivedData(mspPort, c);
 
-            if (!consumed && evaluateNonMspData == MSP_EVALUATE_NON_MSP_DATA) {
-                serialEvaluateNonMspData(mspPort->port, c);
+                if (!consumed && evaluateNonMspData == MSP_EVALUATE_NON_MSP_DATA) {
+                    serialEvaluateNonMspData(mspPort->port, c);
+                }
             }
 
             if (mspPort->c_state == MSP_COMMAND_RECEIVED) {
                 mspPostProcessFn = mspSerialProcessReceivedCommand(mspPort, mspProcessCommandFn);
-                break; // process one command at a time so as not to block.
+                if (mspPostProcessFn || mspPort->c_state == MSP_COMMAND_RECEIVED) {
+                    break;
+                }
+                const uint16_t pending = mspPort->txPending;
+                if (!mspSerialSendPending(mspPort, txBudget)) {
+                    break; // the rest of the reply goes out on the next calls
+                }
+                txBudget -= MIN(pending, txBudget);
+                if (++commandCount >= maxCommands) {
+                    break; // process a bounded number of commands at a time so as not to block.
+                }
             }
         }
+        if (rxView) {
+            serialRxConsume(mspPort->port, sbufRingBytesUsed(&rx));
+        }
+        if (!mspPostProcessFn) {
+            mspSerialProcessStreams(mspPort, mspProcessCommandFn, txBudget);
+        }
         if (mspPostProcessFn) {
+            // reboots and passthrough take over the port, so the reply has to be out first
+            mspSerialFlushPending(mspPort);
             waitForSerialPortToFinishTransmitting(mspPort->port);
             mspPostProcessFn(mspPort->port);
         }
@@ -215,15 +497,8 @@ void mspSerialInit(void)
 
 int mspSerialPush(uint8_t cmd, const uint8_t *data, int datalen)
 {
-    static uint8_t pushBuf[30];
     int ret = 0;
 
-    mspPacket_t push = {
-        .buf = { .ptr = pushBuf, .end = ARRAYEND(pushBuf), },
-        .cmd = cmd,
-        .result = 0,
-    };
-
     for (int portIndex = 0; portIndex < MAX_MSP_PORT_COUNT; portIndex++) {
         mspPort_t * const mspPort = &mspPorts[portIndex];
         if (!mspPort->port) {
@@ -235,15 +510,41 @@ int mspSerialPush(uint8_t cmd, const uint8_t *data, int datalen)
             continue;
         }
 
-        sbufWriteData(&push.buf, data, datalen);
+        // a push must not land in the middle of a reply still being sent
+        mspSerialFlushPending(mspPort);
 
-        sbufSwitchToReader(&push.buf, pushBuf);
+        // encoded straight from the caller's buffer, so pushes are not limited to a fixed size
+        mspPacket_t push = {
+            .buf = { .ptr = (uint8_t *)data, .end = (uint8_t *)data + datalen, },
+            .cmd = cmd,
+            .result = 0,
+        };
 
         ret = mspSerialEncode(mspPort, &push);
     }
     return ret; // return the number of bytes written
 }
 
+// period of the fastest stream on any port, 0 when nothing is streamed
+uint32_t mspSerialStreamPeriodUs(void)
+{
+    uint32_t periodUs = 0;
+
+    for (int portIndex = 0; portIndex < MAX_MSP_PORT_COUNT; portIndex++) {
+        const mspPort_t *mspPort = &mspPorts[portIndex];
+        if (!mspPort->port) {
+            continue;
+        }
+        for (int i = 0; i < MSP_STREAM_COUNT; i++) {
+            const uint32_t streamPeriodUs = mspPort->streams[i].periodUs;
+            if (streamPeriodUs && (!periodUs || streamPeriodUs < periodUs)) {
+                periodUs = streamPeriodUs;
+            }
+        }
+    }
+    return periodUs;
+}
+
 uint32_t mspSerialTxBytesFree()
 {
     uint32_t ret = UINT32_MAX;
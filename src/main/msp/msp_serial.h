@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "common/time.h"
+
 #include "msp/msp.h"
 
 // Each MSP port requires state and a receive buffer, revisit this default if someone needs more than 3 MSP ports.
@@ -29,18 +31,40 @@ typedef enum {
     MSP_HEADER_ARROW,
     MSP_HEADER_SIZE,
     MSP_HEADER_CMD,
+    MSP_HEADER_X,
+    MSP_HEADER_V2_NATIVE,
+    MSP_PAYLOAD_V2_NATIVE,
+    MSP_CHECKSUM_V2_NATIVE,
     MSP_COMMAND_RECEIVED
 } mspState_e;
 
+// frame format of the last request received on a port, replies and pushes use the same
+typedef enum {
+    MSP_V1 = 0,         // $M, 8 bit command and size, XOR checksum
+    MSP_V2_NATIVE       // $X, 16 bit command and size, CRC8 DVB-S2
+} mspVersion_e;
+
+#define MSP_V2_NATIVE_HEADER_SIZE 5     // flags, command and size
+#define MSP_MAX_HEADER_SIZE 8           // $X> and the v2 header, or $M> with a jumbo frame size
+#define MSP_CHECKSUM_SIZE 1
+
 typedef enum {
     MSP_EVALUATE_NON_MSP_DATA,
     MSP_SKIP_NON_MSP_DATA
 } mspEvaluateNonMspData_e;
 
 #define MSP_PORT_INBUF_SIZE 192
+
+// Commands handled per mspSerialProcess() call on USB VCP, so a host can keep several reads in flight
+#define MSP_SERIAL_VCP_COMMANDS_PER_CALL 4
+// Reply bytes a UART port may queue per mspSerialProcess() call, the rest of a long reply goes out on later calls
+#define MSP_SERIAL_TX_BYTES_PER_CALL 256
 #ifdef USE_FLASHFS
-#ifdef STM32F1
-#define MSP_PORT_DATAFLASH_BUFFER_SIZE 1024
+// every port has its own reply buffer, so the smaller parts get shorter dataflash reads
+#if defined(STM32F1)
+#define MSP_PORT_DATAFLASH_BUFFER_SIZE 512
+#elif defined(STM32F3)
+#define MSP_PORT_DATAFLASH_BUFFER_SIZE 2048
 #else
 #define MSP_PORT_DATAFLASH_BUFFER_SIZE 4096
 #endif
@@ -50,15 +74,30 @@ typedef enum {
 #define MSP_PORT_OUTBUF_SIZE 256
 #endif
 
+// Replies a port pushes at a fixed rate once subscribed with MSP_SET_STREAM, without a request for each
+#define MSP_STREAM_COUNT 4
+#define MSP_STREAM_MAX_RATE_HZ 1000
+
+typedef struct mspStream_s {
+    uint16_t cmd;
+    uint32_t periodUs;      // 0 when the slot is free
+    timeUs_t dueAt;
+} mspStream_t;
+
 struct serialPort_s;
 typedef struct mspPort_s {
     struct serialPort_s *port; // null when port unused.
-    uint8_t offset;
-    uint8_t dataSize;
+    uint16_t offset;
+    uint16_t dataSize;
     uint8_t checksum;
-    uint8_t cmdMSP;
+    uint16_t cmdMSP;
     mspState_e c_state;
+    mspVersion_e mspVersion;
     uint8_t inBuf[MSP_PORT_INBUF_SIZE];
+    const uint8_t *txPtr;   // next byte of the reply frame to send
+    uint16_t txPending;     // bytes of the reply frame not sent yet, no new request is read until they are
+    uint8_t outBuf[MSP_MAX_HEADER_SIZE + MSP_PORT_OUTBUF_SIZE + MSP_CHECKSUM_SIZE];
+    mspStream_t streams[MSP_STREAM_COUNT];
 } mspPort_t;
 
 
@@ -68,3 +107,4 @@ void mspSerialAllocatePorts(void);
 void mspSerialReleasePortIfAllocated(struct serialPort_s *serialPort);
 int mspSerialPush(uint8_t cmd, const uint8_t *data, int datalen);
 uint32_t mspSerialTxBytesFree(void);
+uint32_t mspSerialStreamPeriodUs(void);
@@ -71,6 +71,13 @@
 #define STM32F1
 #endif // STM32F10X
 
+#ifdef SIMULATOR_BUILD
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+// the host has no device headers, target.h declares the few types the shared headers need
+#endif
+
 #include "target/common.h"
 #include "target.h"
 #include "target/common_post.h"
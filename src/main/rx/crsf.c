@@ -27,6 +27,7 @@
 #include "build/build_config.h"
 #include "build/debug.h"
 
+#include "common/encoding.h"
 #include "common/maths.h"
 #include "common/utils.h"
 
@@ -39,19 +40,35 @@
 #include "rx/rx.h"
 #include "rx/crsf.h"
 
+#include "telemetry/crsf.h"
+
 #define CRSF_TIME_NEEDED_PER_FRAME_US   1000
-#define CRSF_TIME_BETWEEN_FRAMES_US     4000 // a frame is sent by the transmitter every 4 milliseconds
+#define CRSF_TIME_BETWEEN_FRAMES_US     4000 // default frame interval until one has been measured
+#define CRSF_TIME_GUARD_US              150
+#define CRSF_FRAME_INTERVAL_MAX_US      50000
+#define CRSF_BAUDRATE_FALLBACK_US       1000000 // return to CRSF_BAUDRATE after this long without a frame
 
 #define CRSF_DIGITAL_CHANNEL_MIN 172
 #define CRSF_DIGITAL_CHANNEL_MAX 1811
 
+#define CRSF_RC_SCALE_Q16 40945
+
 STATIC_UNIT_TESTED bool crsfFrameDone = false;
 STATIC_UNIT_TESTED crsfFrame_t crsfFrame;
 
 STATIC_UNIT_TESTED uint32_t crsfChannelData[CRSF_MAX_CHANNEL];
 
 static serialPort_t *serialPort;
+static rxRuntimeConfig_t *crsfRxRuntimeConfig;
 static uint32_t crsfFrameStartAt = 0;
+static uint32_t crsfRcFrameStartAt = 0;
+static volatile uint32_t crsfFrameIntervalUs = CRSF_TIME_BETWEEN_FRAMES_US;
+static uint32_t crsfTimeNeededPerFrameUs = CRSF_TIME_NEEDED_PER_FRAME_US;
+static uint32_t crsfBaudRate = CRSF_BAUDRATE;
+static uint32_t crsfPendingBaudRate = 0;
+static uint32_t crsfBaudRateSwitchAt = 0;
+
+static const uint32_t crsfSupportedBaudRates[] = { CRSF_BAUDRATE, 921600, 1870000 };
 static uint8_t telemetryBuf[CRSF_FRAME_SIZE_MAX];
 static uint8_t telemetryBufLen = 0;
 
@@ -61,8 +78,11 @@ static uint8_t telemetryBufLen = 0;
  *
  * CRSF protocol uses a single wire half duplex uart connection.
  * The master sends one frame every 4ms and the slave replies between two frames from the master.
+ * Newer links send frames faster, so the frame interval is measured rather than assumed, and the
+ * receiver may propose a higher baud rate with a CRSF_COMMAND_SUBCMD_GENERAL_CRSF_SPEED_PROPOSAL
+ * command, which is accepted if it is one of crsfSupportedBaudRates.
  *
- * 420000 baud
+ * 420000 baud by default
  * not inverted
  * 8 Bit
  * 1 Stop bit
@@ -71,7 +91,8 @@ static uint8_t telemetryBufLen = 0;
  * Assume a max payload of 32 bytes (needs confirming with TBS), so max frame size of 36 bytes
  * A 36 byte frame can be transmitted in 771 microseconds.
  *
- * CRSF_TIME_NEEDED_PER_FRAME_US is set conservatively at 1000 microseconds
+ * CRSF_TIME_NEEDED_PER_FRAME_US is set conservatively at 1000 microseconds, at other baud rates
+ * the time needed is calculated from the maximum frame size plus CRSF_TIME_GUARD_US
  *
  * Every frame has the structure:
  * <Device address> <Frame length> < Type> <Payload> < CRC>
@@ -83,28 +104,12 @@ static uint8_t telemetryBufLen = 0;
  *
  */
 
-struct crsfPayloadRcChannelsPacked_s {
-    // 176 bits of data (11 bits per channel * 16 channels) = 22 bytes.
-    unsigned int chan0 : 11;
-    unsigned int chan1 : 11;
-    unsigned int chan2 : 11;
-    unsigned int chan3 : 11;
-    unsigned int chan4 : 11;
-    unsigned int chan5 : 11;
-    unsigned int chan6 : 11;
-    unsigned int chan7 : 11;
-    unsigned int chan8 : 11;
-    unsigned int chan9 : 11;
-    unsigned int chan10 : 11;
-    unsigned int chan11 : 11;
-    unsigned int chan12 : 11;
-    unsigned int chan13 : 11;
-    unsigned int chan14 : 11;
-    unsigned int chan15 : 11;
-} __attribute__ ((__packed__));
-
-typedef struct crsfPayloadRcChannelsPacked_s crsfPayloadRcChannelsPacked_t;
-
+// the frame length covers the type, payload and CRC, which have to fit in the frame buffer
+static bool crsfFrameLengthValid(void)
+{
+    return crsfFrame.frame.frameLength >= CRSF_FRAME_LENGTH_TYPE_CRC
+        && crsfFrame.frame.frameLength <= CRSF_FRAME_SIZE_MAX - CRSF_FRAME_LENGTH_ADDRESS - CRSF_FRAME_LENGTH_FRAMELENGTH;
+}
 
 // Receive ISR callback, called back from serial port
 STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c)
@@ -116,7 +121,7 @@ STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c)
     debug[2] = now - crsfFrameStartAt;
 #endif
 
-    if (now > crsfFrameStartAt + CRSF_TIME_NEEDED_PER_FRAME_US) {
+    if (now > crsfFrameStartAt + crsfTimeNeededPerFrameUs) {
         // We've received a character after max time needed to complete a frame,
         // so this must be the start of a new frame.
         crsfFramePosition = 0;
@@ -129,24 +134,125 @@ STATIC_UNIT_TESTED void crsfDataReceive(uint16_t c)
     // full frame length includes the length of the address and framelength fields
     const int fullFrameLength = crsfFramePosition < 3 ? 5 : crsfFrame.frame.frameLength + CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH;
 
-    if (crsfFramePosition < fullFrameLength) {
+    if (crsfFramePosition < fullFrameLength && crsfFramePosition < (int)sizeof(crsfFrame.bytes)) {
         crsfFrame.bytes[crsfFramePosition++] = (uint8_t)c;
+        if (crsfFramePosition == CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH && !crsfFrameLengthValid()) {
+            // a corrupt frame length, wait for the next frame
+            crsfFramePosition = 0;
+            return;
+        }
         crsfFrameDone = crsfFramePosition < fullFrameLength ? false : true;
+        if (crsfFrameDone) {
+            if (crsfFrame.frame.type == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
+                const uint32_t frameInterval = crsfFrameStartAt - crsfRcFrameStartAt;
+                crsfRcFrameStartAt = crsfFrameStartAt;
+                if (frameInterval < CRSF_FRAME_INTERVAL_MAX_US) {
+                    crsfFrameIntervalUs = frameInterval;
+                }
+            }
+            rxFrameComplete(now);
+        }
     }
 }
 
 STATIC_UNIT_TESTED uint8_t crsfFrameCRC(void)
 {
-    // CRC includes type and payload
-    uint8_t crc = crc8_dvb_s2(0, crsfFrame.frame.type);
-    for (int ii = 0; ii < crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC; ++ii) {
-        crc = crc8_dvb_s2(crc, crsfFrame.frame.payload[ii]);
+    // CRC includes type and payload, a frame length too short for a payload only leaves the type
+    const int payloadLength = constrain(crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC, 0, CRSF_PAYLOAD_SIZE_MAX);
+    return crc8_dvb_s2_buf(0, &crsfFrame.frame.type, CRSF_FRAME_LENGTH_TYPE + payloadLength);
+}
+
+// time taken to transmit len bytes at the current baud rate, 10 bits per byte
+static uint32_t crsfTransmitTimeUs(int len)
+{
+    return len * 10 * 1000000 / crsfBaudRate;
+}
+
+static void crsfSetBaudRate(uint32_t baudRate)
+{
+    if (serialPort && baudRate != crsfBaudRate) {
+        serialSetBaudRate(serialPort, baudRate);
+    }
+    crsfBaudRate = baudRate;
+    crsfTimeNeededPerFrameUs = crsfTransmitTimeUs(CRSF_FRAME_SIZE_MAX) + CRSF_TIME_GUARD_US;
+}
+
+static bool crsfIsSupportedBaudRate(uint32_t baudRate)
+{
+    for (unsigned ii = 0; ii < ARRAYLEN(crsfSupportedBaudRates); ++ii) {
+        if (crsfSupportedBaudRates[ii] == baudRate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Speed proposal, sent by the receiver as an extended frame:
+ * <Device address> <Frame length> <Type 0x32> <Destination> <Origin> <0x0A> <0x70> <Port id> <Baud rate (uint32_t)> <Command CRC> <CRC>
+ * The reply has the same layout with <0x71> <Port id> <Accepted (uint8_t)>, the command CRC uses polynomial 0xBA.
+ * The proposal arrives in the gap before the next frame, so the reply is written straight away and the
+ * baud rate is switched once it has gone out.
+ */
+static void crsfProcessCommand(void)
+{
+    const uint8_t *payload = crsfFrame.frame.payload;
+    if (!serialPort || crsfFrame.frame.frameLength < CRSF_FRAME_LENGTH_TYPE_CRC + 10) {
+        return;
+    }
+    if (payload[2] != CRSF_COMMAND_SUBCMD_GENERAL || payload[3] != CRSF_COMMAND_SUBCMD_GENERAL_CRSF_SPEED_PROPOSAL) {
+        return;
+    }
+    const uint8_t portId = payload[4];
+    const uint32_t baudRate = ((uint32_t)payload[5] << 24) | (payload[6] << 16) | (payload[7] << 8) | payload[8];
+    const bool accepted = crsfIsSupportedBaudRate(baudRate);
+
+    uint8_t reply[] = {
+        CRSF_ADDRESS_BROADCAST,
+        9, // type, 7 byte payload and crc
+        CRSF_FRAMETYPE_COMMAND,
+        payload[1], // reply to the origin of the proposal
+        CRSF_ADDRESS_COLIBRI_RACE_FC,
+        CRSF_COMMAND_SUBCMD_GENERAL,
+        CRSF_COMMAND_SUBCMD_GENERAL_CRSF_SPEED_RESPONSE,
+        portId,
+        accepted,
+        0, // command crc
+        0  // crc
+    };
+    uint8_t commandCrc = 0;
+    for (unsigned ii = 2; ii < sizeof(reply) - 2; ++ii) {
+        commandCrc = crc8_poly_0xba(commandCrc, reply[ii]);
+    }
+    reply[sizeof(reply) - 2] = commandCrc;
+    reply[sizeof(reply) - 1] = crc8_dvb_s2_buf(0, &reply[2], sizeof(reply) - 3);
+
+    serialWriteBuf(serialPort, reply, sizeof(reply));
+    if (accepted && baudRate != crsfBaudRate) {
+        crsfPendingBaudRate = baudRate;
+        crsfBaudRateSwitchAt = micros() + crsfTransmitTimeUs(sizeof(reply)) + CRSF_TIME_GUARD_US;
+    }
+}
+
+static void crsfUpdateBaudRate(void)
+{
+    const uint32_t now = micros();
+    if (crsfPendingBaudRate) {
+        if (cmpTimeUs(now, crsfBaudRateSwitchAt) >= 0 && isSerialTransmitBufferEmpty(serialPort)) {
+            crsfSetBaudRate(crsfPendingBaudRate);
+            crsfPendingBaudRate = 0;
+            crsfFrameStartAt = now; // give the receiver time to follow before falling back
+        }
+    } else if (crsfBaudRate != CRSF_BAUDRATE && now - crsfFrameStartAt > CRSF_BAUDRATE_FALLBACK_US) {
+        // lost the link at the negotiated rate, the receiver will be looking for us at the default rate
+        crsfSetBaudRate(CRSF_BAUDRATE);
     }
-    return crc;
 }
 
 STATIC_UNIT_TESTED uint8_t crsfFrameStatus(void)
 {
+    crsfUpdateBaudRate();
+
     if (crsfFrameDone) {
         crsfFrameDone = false;
         if (crsfFrame.frame.type == CRSF_FRAMETYPE_RC_CHANNELS_PACKED) {
@@ -157,24 +263,26 @@ STATIC_UNIT_TESTED uint8_t crsfFrameStatus(void)
             }
             crsfFrame.frame.frameLength = CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE + CRSF_FRAME_LENGTH_TYPE_CRC;
             // unpack the RC channels
-            const crsfPayloadRcChannelsPacked_t* rcChannels = (crsfPayloadRcChannelsPacked_t*)&crsfFrame.frame.payload;
-            crsfChannelData[0] = rcChannels->chan0;
-            crsfChannelData[1] = rcChannels->chan1;
-            crsfChannelData[2] = rcChannels->chan2;
-            crsfChannelData[3] = rcChannels->chan3;
-            crsfChannelData[4] = rcChannels->chan4;
-            crsfChannelData[5] = rcChannels->chan5;
-            crsfChannelData[6] = rcChannels->chan6;
-            crsfChannelData[7] = rcChannels->chan7;
-            crsfChannelData[8] = rcChannels->chan8;
-            crsfChannelData[9] = rcChannels->chan9;
-            crsfChannelData[10] = rcChannels->chan10;
-            crsfChannelData[11] = rcChannels->chan11;
-            crsfChannelData[12] = rcChannels->chan12;
-            crsfChannelData[13] = rcChannels->chan13;
-            crsfChannelData[14] = rcChannels->chan14;
-            crsfChannelData[15] = rcChannels->chan15;
+            unpack11BitValues(crsfChannelData, crsfFrame.frame.payload, CRSF_MAX_CHANNEL);
+            if (crsfRxRuntimeConfig) {
+                crsfRxRuntimeConfig->rxRefreshRate = crsfFrameIntervalUs;
+            }
             return RX_FRAME_COMPLETE;
+        } else if (!crsfFrameLengthValid()) {
+            // the frames below are variable length, with the CRC at the end of the payload
+            return RX_FRAME_PENDING;
+        } else if (crsfFrame.frame.type == CRSF_FRAMETYPE_COMMAND) {
+            const uint8_t crc = crsfFrameCRC();
+            if (crc == crsfFrame.frame.payload[crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC]) {
+                crsfProcessCommand();
+            }
+#ifdef TELEMETRY_CRSF
+        } else if (crsfFrame.frame.type == CRSF_FRAMETYPE_MSP_REQ || crsfFrame.frame.type == CRSF_FRAMETYPE_MSP_WRITE) {
+            const uint8_t crc = crsfFrameCRC();
+            if (crc == crsfFrame.frame.payload[crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC]) {
+                crsfScheduleMspRequest(crsfFrame.frame.payload, crsfFrame.frame.frameLength - CRSF_FRAME_LENGTH_TYPE_CRC);
+            }
+#endif
         }
     }
     return RX_FRAME_PENDING;
@@ -190,8 +298,9 @@ STATIC_UNIT_TESTED uint16_t crsfReadRawRC(const rxRuntimeConfig_t *rxRuntimeConf
      * max 1811 -> 2012us
      * scale factor = (2012-988) / (1811-172) = 0.62477120195241
      * offset = 988 - 172 * 0.62477120195241 = 880.53935326418548
+     * the scale factor is applied in 16.16 fixed point, 0.62477120195241 * 65536 = 40945
      */
-    return (0.62477120195241f * crsfChannelData[chan]) + 881;
+    return ((crsfChannelData[chan] * CRSF_RC_SCALE_Q16) >> 16) + 881;
 }
 
 void crsfRxWriteTelemetryData(const void *data, int len)
@@ -201,6 +310,30 @@ void crsfRxWriteTelemetryData(const void *data, int len)
     telemetryBufLen = len;
 }
 
+/*
+ * Size of the largest telemetry frame that can be sent in the current reply slot, 0 while a frame is still queued
+ * or the slot is taken by a baud rate change. A half-duplex link only has room between the end of an RX frame and
+ * the start of the next one.
+ */
+int crsfRxTelemetrySpace(void)
+{
+    if (telemetryBufLen > 0 || crsfPendingBaudRate) {
+        return 0;
+    }
+    if (CRSF_PORT_OPTIONS & SERIAL_BIDIR) {
+        const uint32_t timeSinceStartOfFrame = micros() - crsfFrameStartAt;
+        if (timeSinceStartOfFrame < crsfTimeNeededPerFrameUs ||
+            timeSinceStartOfFrame + CRSF_TIME_GUARD_US >= crsfFrameIntervalUs) {
+            return 0;
+        }
+        const uint32_t slotUs = crsfFrameIntervalUs - timeSinceStartOfFrame - CRSF_TIME_GUARD_US;
+        if (slotUs < crsfTransmitTimeUs(CRSF_FRAME_SIZE_MAX)) {
+            return slotUs * (crsfBaudRate / 10) / 1000000;
+        }
+    }
+    return CRSF_FRAME_SIZE_MAX;
+}
+
 void crsfRxSendTelemetryData(void)
 {
     // if there is telemetry data to write
@@ -209,11 +342,15 @@ void crsfRxSendTelemetryData(void)
         // and that there is time to send the telemetry frame before the next RX frame arrives
         if (CRSF_PORT_OPTIONS & SERIAL_BIDIR) {
             const uint32_t timeSinceStartOfFrame = micros() - crsfFrameStartAt;
-            if ((timeSinceStartOfFrame < CRSF_TIME_NEEDED_PER_FRAME_US) || 
-                (timeSinceStartOfFrame > CRSF_TIME_BETWEEN_FRAMES_US - CRSF_TIME_NEEDED_PER_FRAME_US)) {
+            if ((timeSinceStartOfFrame < crsfTimeNeededPerFrameUs) ||
+                (timeSinceStartOfFrame + crsfTransmitTimeUs(telemetryBufLen) + CRSF_TIME_GUARD_US > crsfFrameIntervalUs)) {
                 return;
             }
         }
+        if (crsfPendingBaudRate) {
+            // the speed response is still going out, the receiver is about to change rate
+            return;
+        }
         serialWriteBuf(serialPort, telemetryBuf, telemetryBufLen);
         telemetryBufLen = 0; // reset telemetry buffer
     }
@@ -226,17 +363,19 @@ bool crsfRxInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     }
 
     rxRuntimeConfig->channelCount = CRSF_MAX_CHANNEL;
-    rxRuntimeConfig->rxRefreshRate = 11000; //!!TODO this needs checking
+    rxRuntimeConfig->rxRefreshRate = CRSF_TIME_BETWEEN_FRAMES_US; // replaced by the measured frame interval
+    crsfRxRuntimeConfig = rxRuntimeConfig;
 
     rxRuntimeConfig->rcReadRawFn = crsfReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = crsfFrameStatus;
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
     if (!portConfig) {
         return false;
     }
 
     serialPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, crsfDataReceive, CRSF_BAUDRATE, CRSF_PORT_MODE, CRSF_PORT_OPTIONS);
+    crsfSetBaudRate(CRSF_BAUDRATE);
 
     return serialPort != NULL;
 }
@@ -29,9 +29,19 @@ typedef enum {
     CRSF_FRAMETYPE_LINK_STATISTICS = 0x14,
     CRSF_FRAMETYPE_RC_CHANNELS_PACKED = 0x16,
     CRSF_FRAMETYPE_ATTITUDE = 0x1E,
-    CRSF_FRAMETYPE_FLIGHT_MODE = 0x21
+    CRSF_FRAMETYPE_FLIGHT_MODE = 0x21,
+    CRSF_FRAMETYPE_COMMAND = 0x32,
+    CRSF_FRAMETYPE_MSP_REQ = 0x7A,  // MSP request chunk
+    CRSF_FRAMETYPE_MSP_RESP = 0x7B, // MSP reply chunk
+    CRSF_FRAMETYPE_MSP_WRITE = 0x7C // MSP request chunk that expects no reply
 } crsfFrameTypes_e;
 
+enum {
+    CRSF_COMMAND_SUBCMD_GENERAL = 0x0A,
+    CRSF_COMMAND_SUBCMD_GENERAL_CRSF_SPEED_PROPOSAL = 0x70, // proposed new baud rate, sent by the receiver
+    CRSF_COMMAND_SUBCMD_GENERAL_CRSF_SPEED_RESPONSE = 0x71  // our reply, accepted or not
+};
+
 enum {
     CRSF_FRAME_GPS_PAYLOAD_SIZE = 15,
     CRSF_FRAME_BATTERY_SENSOR_PAYLOAD_SIZE = 8,
@@ -42,7 +52,8 @@ enum {
     CRSF_FRAME_LENGTH_FRAMELENGTH = 1, // length of FRAMELENGTH field
     CRSF_FRAME_LENGTH_TYPE = 1, // length of TYPE field
     CRSF_FRAME_LENGTH_CRC = 1, // length of CRC field
-    CRSF_FRAME_LENGTH_TYPE_CRC = 2 // length of TYPE and CRC fields combined
+    CRSF_FRAME_LENGTH_TYPE_CRC = 2, // length of TYPE and CRC fields combined
+    CRSF_FRAME_LENGTH_EXT_HEADER = 2 // length of the destination and origin fields of extended header frames
 };
 
 enum {
@@ -75,6 +86,7 @@ typedef union crsfFrame_u {
 } crsfFrame_t;
 
 
+int crsfRxTelemetrySpace(void);
 void crsfRxWriteTelemetryData(const void *data, int len);
 void crsfRxSendTelemetryData(void);
 
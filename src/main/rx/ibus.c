@@ -43,101 +43,50 @@
 
 #include "rx/rx.h"
 #include "rx/ibus.h"
+#include "rx/rx_frame.h"
 
 #define IBUS_MAX_CHANNEL 14
-#define IBUS_BUFFSIZE 32
-#define IBUS_MODEL_IA6B 0
-#define IBUS_MODEL_IA6 1
 #define IBUS_FRAME_GAP 500
 
 #define IBUS_BAUDRATE 115200
 
-static uint8_t ibusModel;
-static uint8_t ibusSyncByte = 0;
-static uint8_t ibusFrameSize;
-static uint8_t ibusChannelOffset;
-static uint16_t ibusChecksum;
+#define IBUS_SYNC_IA6B 0x20
+#define IBUS_SYNC_IA6 0x55
 
-static bool ibusFrameDone = false;
 static uint32_t ibusChannelData[IBUS_MAX_CHANNEL];
 
-static uint8_t ibus[IBUS_BUFFSIZE] = { 0, };
-
-// Receive ISR callback
-static void ibusDataReceive(uint16_t c)
-{
-    uint32_t ibusTime;
-    static uint32_t ibusTimeLast;
-    static uint8_t ibusFramePosition;
-
-    ibusTime = micros();
-
-    if ((ibusTime - ibusTimeLast) > IBUS_FRAME_GAP)
-        ibusFramePosition = 0;
-
-    ibusTimeLast = ibusTime;
-
-    if (ibusFramePosition == 0) {
-        if (ibusSyncByte == 0) {
-            // detect the frame type based on the STX byte.
-            if (c == 0x55) {
-                ibusModel = IBUS_MODEL_IA6;
-                ibusSyncByte = 0x55;
-                ibusFrameSize = 31;
-                ibusChecksum = 0x0000;
-                ibusChannelOffset = 1;
-            } else if (c == 0x20) {
-                ibusModel = IBUS_MODEL_IA6B;
-                ibusSyncByte = 0x20;
-                ibusFrameSize = 32;
-                ibusChannelOffset = 2;
-                ibusChecksum = 0xFFFF;
-            } else
-                return;
-        } else if (ibusSyncByte != c) {
-            return;
-        }
-    }
-
-    ibus[ibusFramePosition] = (uint8_t)c;
-
-    if (ibusFramePosition == ibusFrameSize - 1) {
-        ibusFrameDone = true;
-    } else {
-        ibusFramePosition++;
-    }
-}
+static const rxFrameProtocol_t ibusProtocol = {
+    .sync = {
+        // the IA6B checksum is that of the frame bytes, the IA6 one that of the channel values, see ibusFrameStatus()
+        { .byte = IBUS_SYNC_IA6B, .length = 32, .checksum = RX_FRAME_CHECKSUM_SUM16_INVERTED },
+        { .byte = IBUS_SYNC_IA6, .length = 31, .checksum = RX_FRAME_CHECKSUM_NONE },
+    },
+    .syncCount = 2,
+    .byteGapUs = IBUS_FRAME_GAP,
+};
 
 static uint8_t ibusFrameStatus(void)
 {
-    uint8_t i, offset;
-    uint8_t frameStatus = RX_FRAME_PENDING;
-    uint16_t chksum, rxsum;
-
-    if (!ibusFrameDone) {
-        return frameStatus;
+    uint8_t frameLength;
+    const uint8_t *ibus = rxFrameGetReceived(&frameLength);
+    if (!ibus) {
+        return RX_FRAME_PENDING;
     }
 
-    ibusFrameDone = false;
-
-    chksum = ibusChecksum;
-    rxsum = ibus[ibusFrameSize - 2] + (ibus[ibusFrameSize - 1] << 8);
-    if (ibusModel == IBUS_MODEL_IA6) {
-        for (i = 0, offset = ibusChannelOffset; i < IBUS_MAX_CHANNEL; i++, offset += 2)
+    const uint8_t channelOffset = ibus[0] == IBUS_SYNC_IA6 ? 1 : 2;
+    if (ibus[0] == IBUS_SYNC_IA6) {
+        uint16_t chksum = 0;
+        for (int i = 0, offset = channelOffset; i < IBUS_MAX_CHANNEL; i++, offset += 2)
             chksum += ibus[offset] + (ibus[offset + 1] << 8);
-    } else {
-        for (i = 0; i < 30; i++)
-            chksum -= ibus[i];
-    }
-
-    if (chksum == rxsum) {
-        for (i = 0, offset = ibusChannelOffset; i < IBUS_MAX_CHANNEL; i++, offset += 2) {
-            ibusChannelData[i] = ibus[offset] + (ibus[offset + 1] << 8);
+        if (chksum != ibus[frameLength - 2] + (ibus[frameLength - 1] << 8)) {
+            return RX_FRAME_PENDING;
         }
-        frameStatus = RX_FRAME_COMPLETE;
     }
 
-    return frameStatus;
+    for (int i = 0, offset = channelOffset; i < IBUS_MAX_CHANNEL; i++, offset += 2) {
+        ibusChannelData[i] = ibus[offset] + (ibus[offset + 1] << 8);
+    }
+    return RX_FRAME_COMPLETE;
 }
 
 static uint16_t ibusReadRawRC(const rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
@@ -156,7 +105,7 @@ bool ibusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     rxRuntimeConfig->rcReadRawFn = ibusReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = ibusFrameStatus;
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
     if (!portConfig) {
         return false;
     }
@@ -167,7 +116,8 @@ bool ibusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     bool portShared = false;
 #endif
 
-    serialPort_t *ibusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, ibusDataReceive, IBUS_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
+    rxFrameInit(&ibusProtocol);
+    serialPort_t *ibusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, rxFrameDataReceive, IBUS_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
 
 #ifdef TELEMETRY
     if (portShared) {
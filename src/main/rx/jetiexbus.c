@@ -41,14 +41,15 @@
 
 #ifdef SERIAL_RX
 
+#include "build/atomic.h"
 #include "build/build_config.h"
 #include "build/debug.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 
 #include "drivers/system.h"
 #include "drivers/serial.h"
-#include "drivers/serial_uart.h"
 
 #include "io/serial.h"
 
@@ -203,7 +204,7 @@ static uint8_t jetiExBusFramePosition;
 static uint8_t jetiExBusFrameLength;
 
 static uint8_t jetiExBusFrameState = EXBUS_STATE_ZERO;
-static uint8_t jetiExBusRequestState = EXBUS_STATE_ZERO;
+static volatile uint8_t jetiExBusRequestState = EXBUS_STATE_ZERO;
 
 // Use max values for ram areas
 static uint8_t jetiExBusChannelFrame[EXBUS_MAX_CHANNEL_FRAME_SIZE];
@@ -214,50 +215,34 @@ static uint16_t jetiExBusChannelData[JETIEXBUS_CHANNEL_COUNT];
 #ifdef TELEMETRY
 
 static uint8_t jetiExBusTelemetryFrame[40];
-static uint8_t jetiExBusTransceiveState = EXBUS_TRANS_RX;
-static void sendJetiExBusTelemetry(uint8_t packetID);
-
-uint8_t calcCRC8(uint8_t *pt, uint8_t msgLen);
+static volatile uint8_t jetiExBusTransceiveState = EXBUS_TRANS_RX;
+static volatile bool jetiExBusTelemetryReady = false;     // jetiExBusTelemetryFrame holds the next reply
+static uint32_t jetiExBusReplyDelay = 0;
+static void sendJetiExBusTelemetry(void);
 
 #endif //TELEMETRY
 
 uint16_t calcCRC16(uint8_t *pt, uint8_t msgLen);
 
 
+// CRC-16/CCITT in its reflected form (polynomial 0x8408), looked up one nibble at a time
+static const uint16_t jetiExBusCrc16Table[16] = {
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xa50a, 0xb58b, 0xc60c, 0xd68d, 0xe70e, 0xf78f
+};
+
 // Jeti Ex Bus CRC calculations for a frame
 uint16_t calcCRC16(uint8_t *pt, uint8_t msgLen)
 {
     uint16_t crc16_data = 0;
-    uint8_t data=0;
 
     for (uint8_t mlen = 0; mlen < msgLen; mlen++){
-        data = pt[mlen] ^ ((uint8_t)(crc16_data) & (uint8_t)(0xFF));
-        data ^= data << 4;
-        crc16_data = ((((uint16_t)data << 8) | ((crc16_data & 0xFF00) >> 8))
-                      ^ (uint8_t)(data >> 4)
-                      ^ ((uint16_t)data << 3));
+        crc16_data = (crc16_data >> 4) ^ jetiExBusCrc16Table[(crc16_data ^ pt[mlen]) & 0x0f];
+        crc16_data = (crc16_data >> 4) ^ jetiExBusCrc16Table[(crc16_data ^ (pt[mlen] >> 4)) & 0x0f];
     }
     return(crc16_data);
 }
 
-#ifdef TELEMETRY
-
-
-// Jeti Ex Telemetry CRC calculations for a frame
-uint8_t calcCRC8(uint8_t *pt, uint8_t msgLen)
-{
-    uint8_t crc=0;
-
-    for (uint8_t mlen = 0; mlen < msgLen; mlen++) {
-        crc  ^= pt[mlen];
-        crc = crc ^ (crc << 1) ^ (crc << 2) ^ (0x0e090700 >> ((crc >> 3) & 0x18));
-    }
-    return(crc);
-}
-
-#endif //TELEMETRY
-
-
 void jetiExBusDecodeChannelFrame(uint8_t *exBusFrame)
 {
     uint16_t value;
@@ -362,11 +347,16 @@ static void jetiExBusDataReceive(uint16_t c)
 
     // Done?
     if (jetiExBusFrameLength == jetiExBusFramePosition) {
-        if (jetiExBusFrameState == EXBUS_STATE_IN_PROGRESS)
+        if (jetiExBusFrameState == EXBUS_STATE_IN_PROGRESS) {
             jetiExBusFrameState = EXBUS_STATE_RECEIVED;
+            rxFrameComplete(now);
+        }
         if (jetiExBusRequestState == EXBUS_STATE_IN_PROGRESS) {
             jetiExBusRequestState = EXBUS_STATE_RECEIVED;
-            jetiTimeStampRequest = micros();
+            jetiTimeStampRequest = now;
+#ifdef TELEMETRY
+            sendJetiExBusTelemetry();
+#endif
         }
 
         jetiExBusFrameReset();
@@ -441,7 +431,7 @@ void createExTelemetrieTextMessage(uint8_t *exMessage, uint8_t messageID, const
     memcpy(&exMessage[EXTEL_HEADER_DATA + 1], sensor->label, labelLength);
     memcpy(&exMessage[EXTEL_HEADER_DATA + 1 + labelLength], sensor->unit, unitLength);
 
-    exMessage[exMessage[EXTEL_HEADER_TYPE_LEN] + EXTEL_CRC_LEN] = calcCRC8(&exMessage[EXTEL_HEADER_TYPE_LEN], exMessage[EXTEL_HEADER_TYPE_LEN]);
+    exMessage[exMessage[EXTEL_HEADER_TYPE_LEN] + EXTEL_CRC_LEN] = crc8_poly_0x07_buf(0, &exMessage[EXTEL_HEADER_TYPE_LEN], exMessage[EXTEL_HEADER_TYPE_LEN]);
 }
 
 
@@ -482,7 +472,7 @@ uint8_t createExTelemetrieValueMessage(uint8_t *exMessage, uint8_t itemStart)
 
     messageSize = (EXTEL_HEADER_LEN + (p-&exMessage[EXTEL_HEADER_ID]));
     exMessage[EXTEL_HEADER_TYPE_LEN] = EXTEL_DATA_MSG | messageSize;
-    exMessage[messageSize + EXTEL_CRC_LEN] = calcCRC8(&exMessage[EXTEL_HEADER_TYPE_LEN], messageSize);
+    exMessage[messageSize + EXTEL_CRC_LEN] = crc8_poly_0x07_buf(0, &exMessage[EXTEL_HEADER_TYPE_LEN], messageSize);
 
     return item;        // return the next item
 }
@@ -508,42 +498,41 @@ void checkJetiExBusTelemetryState(void)
 }
 
 
-void handleJetiExBusTelemetry(void)
+static void prepareJetiExBusTelemetry(void)
 {
-    static uint16_t framesLost = 0; // only for debug
-    uint32_t timeDiff;
-    // Check if we shall reset frame position due to time
+    static uint8_t sensorDescriptionCounter = 0;
+    static uint8_t sensorValueCounter = 1;
+    static uint8_t requestLoop = 0;
+    uint8_t *jetiExTelemetryFrame = &jetiExBusTelemetryFrame[EXBUS_HEADER_DATA];
 
-    if (jetiExBusRequestState == EXBUS_STATE_RECEIVED) {
+    if (requestLoop == 100){              //every nth request send the name of a value
+        if (sensorDescriptionCounter == JETI_EX_SENSOR_COUNT )
+            sensorDescriptionCounter = 0;
 
-        // to prevent timing issues from request to answer - max. 4ms
-        timeDiff = micros() - jetiTimeStampRequest;
+        createExTelemetrieTextMessage(jetiExTelemetryFrame, sensorDescriptionCounter, &jetiExSensors[sensorDescriptionCounter]);
 
-        if(timeDiff > 3000) {   // include reserved time
-            jetiExBusRequestState = EXBUS_STATE_ZERO;
-            framesLost++;
-            return;
-        }
+        requestLoop = 0;
+        sensorDescriptionCounter++;
+    } else {
+        sensorValueCounter = createExTelemetrieValueMessage(jetiExTelemetryFrame, sensorValueCounter);
+    }
+    requestLoop++;
+}
 
-        if((jetiExBusRequestFrame[EXBUS_HEADER_DATA_ID] == EXBUS_EX_REQUEST) && (calcCRC16(jetiExBusRequestFrame, jetiExBusRequestFrame[EXBUS_HEADER_MSG_LEN]) == 0)) {
-            jetiExSensors[EX_VOLTAGE].value = vbat;
-            jetiExSensors[EX_CURRENT].value = amperage;
-            jetiExSensors[EX_ALTITUDE].value = baro.BaroAlt;
-            jetiExSensors[EX_CAPACITY].value = mAhDrawn;
-            jetiExSensors[EX_FRAMES_LOST].value = framesLost;
-            jetiExSensors[EX_TIME_DIFF].value = timeDiff;
-
-            // switch to TX mode
-            if (uartTotalRxBytesWaiting(jetiExBusPort) == 0) {
-                serialSetMode(jetiExBusPort, MODE_TX);
-                jetiExBusTransceiveState = EXBUS_TRANS_TX;
-                sendJetiExBusTelemetry(jetiExBusRequestFrame[EXBUS_HEADER_PACKET_ID]);
-                jetiExBusRequestState = EXBUS_STATE_PROCESSED;
-            }
-        } else {
-            jetiExBusRequestState = EXBUS_STATE_ZERO;
-            return;
-        }
+
+/*
+ * The reply to the next request is built here, in the telemetry task, ahead of the request. The receive
+ * interrupt then sends it as soon as the request is complete, so the reply makes its slot regardless of
+ * when the scheduler gets round to this task.
+ */
+void handleJetiExBusTelemetry(void)
+{
+    static uint16_t framesLost = 0; // only for debug
+
+    if (jetiExBusRequestState == EXBUS_STATE_RECEIVED) {
+        // the request came in before a reply was ready
+        jetiExBusRequestState = EXBUS_STATE_ZERO;
+        framesLost++;
     }
 
     // check the state if transmit is ready
@@ -554,35 +543,47 @@ void handleJetiExBusTelemetry(void)
             jetiExBusRequestState = EXBUS_STATE_ZERO;
         }
     }
+
+    if (!jetiExBusTelemetryReady && jetiExBusTransceiveState == EXBUS_TRANS_RX) {
+        jetiExSensors[EX_VOLTAGE].value = vbat;
+        jetiExSensors[EX_CURRENT].value = amperage;
+        jetiExSensors[EX_ALTITUDE].value = baro.BaroAlt;
+        jetiExSensors[EX_CAPACITY].value = mAhDrawn;
+        jetiExSensors[EX_FRAMES_LOST].value = framesLost;
+        jetiExSensors[EX_TIME_DIFF].value = jetiExBusReplyDelay;
+
+        {
+            // the frame must be written out before the receive interrupt can see the flag
+            ATOMIC_BARRIER(jetiExBusTelemetryFrame);
+            prepareJetiExBusTelemetry();
+        }
+        jetiExBusTelemetryReady = true;
+    }
 }
 
 
-void sendJetiExBusTelemetry(uint8_t packetID)
+// Called from the receive interrupt with a complete request frame
+static void sendJetiExBusTelemetry(void)
 {
-    static uint8_t sensorDescriptionCounter = 0;
-    static uint8_t sensorValueCounter = 1;
-    static uint8_t requestLoop = 0;
-    uint8_t *jetiExTelemetryFrame = &jetiExBusTelemetryFrame[EXBUS_HEADER_DATA];
-
-    if (requestLoop == 100){              //every nth request send the name of a value
-        if (sensorDescriptionCounter == JETI_EX_SENSOR_COUNT )
-            sensorDescriptionCounter = 0;
+    if ((jetiExBusRequestFrame[EXBUS_HEADER_DATA_ID] != EXBUS_EX_REQUEST) || (calcCRC16(jetiExBusRequestFrame, jetiExBusRequestFrame[EXBUS_HEADER_MSG_LEN]) != 0)) {
+        jetiExBusRequestState = EXBUS_STATE_ZERO;
+        return;
+    }
+    if (!jetiExBusTelemetryReady || jetiExBusTransceiveState != EXBUS_TRANS_RX) {
+        return;
+    }
+    ATOMIC_BARRIER(jetiExBusTelemetryFrame);
 
-        createExTelemetrieTextMessage(jetiExTelemetryFrame, sensorDescriptionCounter, &jetiExSensors[sensorDescriptionCounter]);
-        createExBusMessage(jetiExBusTelemetryFrame, jetiExTelemetryFrame, packetID);
+    // only the ex bus header and its CRC depend on the request
+    createExBusMessage(jetiExBusTelemetryFrame, &jetiExBusTelemetryFrame[EXBUS_HEADER_DATA], jetiExBusRequestFrame[EXBUS_HEADER_PACKET_ID]);
 
-        requestLoop = 0;
-        sensorDescriptionCounter++;
-    } else {
-        sensorValueCounter = createExTelemetrieValueMessage(jetiExTelemetryFrame, sensorValueCounter);
-        createExBusMessage(jetiExBusTelemetryFrame, jetiExTelemetryFrame, packetID);
-    }
+    serialSetMode(jetiExBusPort, MODE_TX);
+    serialWriteBuf(jetiExBusPort, jetiExBusTelemetryFrame, jetiExBusTelemetryFrame[EXBUS_HEADER_MSG_LEN]);
+    jetiExBusReplyDelay = micros() - jetiTimeStampRequest;
 
-    for (uint8_t iCount = 0; iCount < jetiExBusTelemetryFrame[EXBUS_HEADER_MSG_LEN]; iCount++) {
-        serialWrite(jetiExBusPort, jetiExBusTelemetryFrame[iCount]);
-    }
+    jetiExBusTelemetryReady = false;
     jetiExBusTransceiveState = EXBUS_TRANS_IS_TX_COMPLETED;
-    requestLoop++;
+    jetiExBusRequestState = EXBUS_STATE_PROCESSED;
 }
 #endif // TELEMETRY
 
@@ -598,7 +599,7 @@ bool jetiExBusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfi
 
     jetiExBusFrameReset();
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
 
     if (!portConfig) {
         return false;
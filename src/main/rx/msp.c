@@ -24,6 +24,8 @@
 
 #include "common/utils.h"
 
+#include "drivers/system.h"
+
 #include "rx/rx.h"
 #include "rx/msp.h"
 
@@ -51,6 +53,7 @@ void rxMspFrameReceive(uint16_t *frame, int channelCount)
     }
 
     rxMspFrameDone = true;
+    rxFrameComplete(micros());
 }
 
 static uint8_t rxMspFrameStatus(void)
@@ -56,6 +56,8 @@
 #include "rx/crsf.h"
 #include "rx/rx_spi.h"
 
+#include "scheduler/scheduler.h"
+
 
 //#define DEBUG_RX_SIGNAL_LOSS
 
@@ -76,11 +78,18 @@ static uint32_t needRxSignalMaxDelayUs;
 static uint32_t suspendRxSignalUntil = 0;
 static uint8_t  skipRxSamples = 0;
 
+static volatile timeUs_t rxFrameTimeUs;     // end of the most recent serial RX frame, set by the driver
+static timeUs_t rxLastFrameTimeUs;
+static timeDelta_t rxFrameDeltaUs;         // measured interval between the last two frames, 0 if unknown
+static timeUs_t rxFrameSeenAt;             // when the RX task picked up the last complete frame
+static rxFrameStats_t rxFrameStats;
+
 int16_t rcRaw[MAX_SUPPORTED_RC_CHANNEL_COUNT];     // interval [1000;2000]
 int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];     // interval [1000;2000]
 uint32_t rcInvalidPulsPeriod[MAX_SUPPORTED_RC_CHANNEL_COUNT];
 
 #define MAX_INVALID_PULS_TIME    300
+#define RX_HOLD_LOSS_FRAMES_RATIO 3                 // with frame based timeouts channels are held for three loss periods
 #define PPM_AND_PWM_SAMPLE_COUNT 3
 
 #define DELAY_50_HZ (1000000 / 50)
@@ -88,6 +97,8 @@ uint32_t rcInvalidPulsPeriod[MAX_SUPPORTED_RC_CHANNEL_COUNT];
 #define DELAY_5_HZ (1000000 / 5)
 #define SKIP_RC_ON_SUSPEND_PERIOD 1500000           // 1.5 second period in usec (call frequency independent)
 #define SKIP_RC_SAMPLES_ON_RESUME  2                // flush 2 samples to drop wrong measurements (timing independent)
+#define RX_LOSS_TIMEOUT_MIN_US  10000               // floor for the frame based timeouts, covers scheduler jitter on fast links
+#define RX_LOSS_TIMEOUT_MAX_US  (1000000 / 2)
 
 rxRuntimeConfig_t rxRuntimeConfig;
 static const rxConfig_t *rxConfig;
@@ -106,6 +117,33 @@ static uint8_t nullFrameStatus(void)
     return RX_FRAME_PENDING;
 }
 
+/*
+ * Tracks the frame rate of a link from the time between its frames. Gaps of more than one and a half
+ * intervals are counted as missed frames, and are clipped so they only nudge the estimate.
+ */
+static void rxUpdateFrameStats(rxFrameStats_t *stats, timeDelta_t frameDeltaUs)
+{
+    if (frameDeltaUs <= 0 || frameDeltaUs >= RX_LOSS_TIMEOUT_MAX_US) {
+        return;
+    }
+    if (!stats->intervalUs) {
+        stats->intervalUs = frameDeltaUs;
+        return;
+    }
+    if (frameDeltaUs > stats->intervalUs * 3 / 2) {
+        stats->missedFrameCount += (frameDeltaUs + stats->intervalUs / 2) / stats->intervalUs - 1;
+    }
+    stats->intervalUs += (MIN(frameDeltaUs, stats->intervalUs * 2) - stats->intervalUs) / 8;
+}
+
+static uint32_t rxFrameStatsToUs(const rxFrameStats_t *stats, uint32_t frameCount, uint32_t defaultUs)
+{
+    if (!frameCount || !stats->intervalUs) {
+        return defaultUs;
+    }
+    return constrain(frameCount * stats->intervalUs, RX_LOSS_TIMEOUT_MIN_US, RX_LOSS_TIMEOUT_MAX_US);
+}
+
 void useRxConfig(const rxConfig_t *rxConfigToUse)
 {
     rxConfig = rxConfigToUse;
@@ -149,10 +187,45 @@ void resetAllRxChannelRangeConfigurations(rxChannelRangeConfiguration_t *rxChann
 }
 
 #ifdef SERIAL_RX
-bool serialRxInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
+static uint8_t rxLinkBeingInitialised;
+static bool rxDualLink;
+static rxRuntimeConfig_t rxLinkRuntimeConfig[RX_LINK_COUNT];
+static rxLinkStats_t rxLinkStats[RX_LINK_COUNT];
+static uint8_t rxActiveLink;
+static timeUs_t rxLinkFrameUsedAt;
+
+/*
+ * Serial RX drivers call this from their init function to find their port. The first receiver uses the
+ * first port with FUNCTION_RX_SERIAL and the second receiver, if any, the next one.
+ */
+const serialPortConfig_t *serialRxFindPortConfig(void)
+{
+    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    for (int ii = 0; ii < rxLinkBeingInitialised && portConfig; ii++) {
+        portConfig = findNextSerialPortConfig(FUNCTION_RX_SERIAL);
+    }
+    return portConfig;
+}
+
+bool rxIsDualLink(void)
+{
+    return rxDualLink;
+}
+
+uint8_t rxGetActiveLink(void)
+{
+    return rxActiveLink;
+}
+
+const rxLinkStats_t *rxGetLinkStats(int link)
+{
+    return &rxLinkStats[link];
+}
+
+static bool serialRxInitProvider(uint8_t provider, const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
 {
     bool enabled = false;
-    switch (rxConfig->serialrx_provider) {
+    switch (provider) {
 #ifdef USE_SERIALRX_SPEKTRUM
     case SERIALRX_SPEKTRUM1024:
     case SERIALRX_SPEKTRUM2048:
@@ -201,6 +274,94 @@ bool serialRxInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig
     }
     return enabled;
 }
+
+/*
+ * With two receivers both drivers run side by side. Within each frame interval the first valid frame,
+ * from either link, drives rcData and any frame from the other link until the interval has nearly
+ * passed is dropped, so the faster link wins without the two links alternating frame by frame.
+ * A failsafe frame from one link is only passed on once the other link has gone quiet too.
+ */
+static uint8_t rxDualLinkFrameStatus(void)
+{
+    const timeUs_t currentTimeUs = micros();
+    const timeDelta_t holdoffUs = MIN(rxLinkRuntimeConfig[0].rxRefreshRate, rxLinkRuntimeConfig[1].rxRefreshRate) * 3 / 4;
+    uint8_t frameStatus = RX_FRAME_PENDING;
+
+    for (int link = 0; link < RX_LINK_COUNT; link++) {
+        const uint8_t linkStatus = rxLinkRuntimeConfig[link].rcFrameStatusFn();
+        if (!(linkStatus & RX_FRAME_COMPLETE)) {
+            continue;
+        }
+        rxLinkStats_t *stats = &rxLinkStats[link];
+        const timeDelta_t sinceUsed = cmpTimeUs(currentTimeUs, rxLinkFrameUsedAt);
+
+        if (linkStatus & RX_FRAME_FAILSAFE) {
+            stats->failsafeFrameCount++;
+            const rxLinkStats_t *other = &rxLinkStats[link ^ 1];
+            const timeDelta_t otherTimeoutUs = rxFrameStatsToUs(&other->frameStats, rxConfig->rx_loss_frames, needRxSignalMaxDelayUs);
+            if (other->frameCount && cmpTimeUs(currentTimeUs, other->lastFrameAt) < otherTimeoutUs) {
+                continue;
+            }
+        } else {
+            if (stats->frameCount) {
+                rxUpdateFrameStats(&stats->frameStats, cmpTimeUs(currentTimeUs, stats->lastFrameAt));
+            }
+            stats->frameCount++;
+            stats->lastFrameAt = currentTimeUs;
+            if (frameStatus != RX_FRAME_PENDING || (rxLinkFrameUsedAt && sinceUsed < holdoffUs)) {
+                // another frame already drove this interval
+                stats->lagUs += (sinceUsed - stats->lagUs) / 8;
+                continue;
+            }
+        }
+        rxActiveLink = link;
+        rxLinkFrameUsedAt = currentTimeUs;
+        stats->usedFrameCount++;
+        frameStatus = linkStatus;
+    }
+    return frameStatus;
+}
+
+static uint16_t rxDualLinkReadRawRC(const rxRuntimeConfig_t *rxRuntimeConfig, uint8_t channel)
+{
+    UNUSED(rxRuntimeConfig);
+    const rxRuntimeConfig_t *linkRuntimeConfig = &rxLinkRuntimeConfig[rxActiveLink];
+    return linkRuntimeConfig->rcReadRawFn(linkRuntimeConfig, channel);
+}
+
+bool serialRxInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
+{
+    rxLinkBeingInitialised = 0;
+    rxDualLink = false;
+    if (rxConfig->serialrx_provider2 == SERIALRX_NONE || rxConfig->serialrx_provider2 == rxConfig->serialrx_provider) {
+        // a driver keeps its state in file statics, so it cannot serve two links
+        return serialRxInitProvider(rxConfig->serialrx_provider, rxConfig, rxRuntimeConfig);
+    }
+
+    bool enabled[RX_LINK_COUNT];
+    for (int link = 0; link < RX_LINK_COUNT; link++) {
+        rxLinkBeingInitialised = link;
+        rxLinkRuntimeConfig[link] = *rxRuntimeConfig;
+        enabled[link] = serialRxInitProvider(link ? rxConfig->serialrx_provider2 : rxConfig->serialrx_provider, rxConfig, &rxLinkRuntimeConfig[link]);
+    }
+    rxLinkBeingInitialised = 0;
+
+    if (enabled[0] && enabled[1]) {
+        rxDualLink = true;
+        rxRuntimeConfig->channelCount = MIN(rxLinkRuntimeConfig[0].channelCount, rxLinkRuntimeConfig[1].channelCount);
+        rxRuntimeConfig->rxRefreshRate = MIN(rxLinkRuntimeConfig[0].rxRefreshRate, rxLinkRuntimeConfig[1].rxRefreshRate);
+        rxRuntimeConfig->rcReadRawFn = rxDualLinkReadRawRC;
+        rxRuntimeConfig->rcFrameStatusFn = rxDualLinkFrameStatus;
+        return true;
+    }
+    for (int link = 0; link < RX_LINK_COUNT; link++) {
+        if (enabled[link]) {
+            *rxRuntimeConfig = rxLinkRuntimeConfig[link];
+            return true;
+        }
+    }
+    return false;
+}
 #endif
 
 void rxInit(const rxConfig_t *rxConfig, const modeActivationCondition_t *modeActivationConditions)
@@ -307,6 +468,51 @@ void resumeRxSignal(void)
     failsafeOnRxResume();
 }
 
+/*
+ * Called by serial RX drivers, usually from the UART interrupt, once the last byte of a frame
+ * has arrived. The time is taken there rather than when the RX task gets round to the frame,
+ * so the frame interval seen by the RC interpolation does not pick up scheduler jitter.
+ */
+void rxFrameComplete(timeUs_t frameTimeUs)
+{
+    rxFrameTimeUs = frameTimeUs;
+    schedulerSignalTask(TASK_RX);
+}
+
+timeDelta_t rxGetFrameDelta(void)
+{
+    return rxFrameDeltaUs;
+}
+
+const rxFrameStats_t *rxGetFrameStats(void)
+{
+    return &rxFrameStats;
+}
+
+/*
+ * Returns the time taken by rx_loss_frames frames at the measured frame rate of the receiver, so signal
+ * loss is detected within a few frames on fast links without tripping on slow ones. defaultUs is
+ * returned until the frame rate is known, for receivers that are not data driven, or when rx_loss_frames is 0.
+ */
+uint32_t rxLossFramesToUs(uint32_t defaultUs)
+{
+    return rxFrameStatsToUs(&rxFrameStats, rxConfig->rx_loss_frames, defaultUs);
+}
+
+static void rxUpdateFrameDelta(void)
+{
+    const timeUs_t frameTimeUs = rxFrameTimeUs;
+    if (frameTimeUs == rxLastFrameTimeUs) {
+        // driver does not timestamp its frames
+        rxFrameDeltaUs = 0;
+        return;
+    }
+    const timeDelta_t delta = cmpTimeUs(frameTimeUs, rxLastFrameTimeUs);
+    // the first frame, or the first after a signal loss, has nothing sensible to compare with
+    rxFrameDeltaUs = (rxLastFrameTimeUs && delta < (timeDelta_t)needRxSignalMaxDelayUs) ? delta : 0;
+    rxLastFrameTimeUs = frameTimeUs;
+}
+
 bool rxUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTime)
 {
     UNUSED(currentDeltaTime);
@@ -338,10 +544,16 @@ bool rxUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTime)
         rxDataReceived = false;
         const uint8_t frameStatus = rxRuntimeConfig.rcFrameStatusFn();
         if (frameStatus & RX_FRAME_COMPLETE) {
+            rxUpdateFrameDelta();
+            // driver timestamps are exact, otherwise go by when the RX task picked the frame up
+            if (rxFrameSeenAt) {
+                rxUpdateFrameStats(&rxFrameStats, rxFrameDeltaUs ? rxFrameDeltaUs : cmpTimeUs(currentTimeUs, rxFrameSeenAt));
+            }
+            rxFrameSeenAt = currentTimeUs;
             rxDataReceived = true;
             rxIsInFailsafeMode = (frameStatus & RX_FRAME_FAILSAFE) != 0;
             rxSignalReceived = !rxIsInFailsafeMode;
-            needRxSignalBefore = currentTimeUs + needRxSignalMaxDelayUs;
+            needRxSignalBefore = currentTimeUs + rxLossFramesToUs(needRxSignalMaxDelayUs);
         }
     }
     return rxDataReceived || (currentTimeUs >= rxUpdateAt); // data driven or 50Hz
@@ -454,6 +666,7 @@ static void detectAndApplySignalLossBehaviour(timeUs_t currentTimeUs)
     bool useValueFromRx = true;
     const bool rxIsDataDriven = isRxDataDriven();
     const uint32_t currentMilliTime = currentTimeUs / 1000;
+    const uint32_t invalidPulsPeriod = rxFrameStatsToUs(&rxFrameStats, RX_HOLD_LOSS_FRAMES_RATIO * rxConfig->rx_loss_frames, MAX_INVALID_PULS_TIME * 1000) / 1000;
 
     if (!rxIsDataDriven) {
         rxSignalReceived = rxSignalReceivedNotDataDriven;
@@ -480,13 +693,13 @@ static void detectAndApplySignalLossBehaviour(timeUs_t currentTimeUs)
 
         if (!validPulse) {
             if (currentMilliTime < rcInvalidPulsPeriod[channel]) {
-                sample = rcData[channel];           // hold channel for MAX_INVALID_PULS_TIME
+                sample = rcData[channel];           // hold channel for invalidPulsPeriod
             } else {
                 sample = getRxfailValue(channel);   // after that apply rxfail value
                 rxUpdateFlightChannelStatus(channel, validPulse);
             }
         } else {
-            rcInvalidPulsPeriod[channel] = currentMilliTime + MAX_INVALID_PULS_TIME;
+            rcInvalidPulsPeriod[channel] = currentMilliTime + invalidPulsPeriod;
         }
 
         if (rxIsDataDriven) {
@@ -566,8 +779,7 @@ static void updateRSSIADC(timeUs_t currentTimeUs)
 #ifndef USE_ADC
     UNUSED(currentTimeUs);
 #else
-    static uint8_t adcRssiSamples[RSSI_ADC_SAMPLE_COUNT];
-    static uint8_t adcRssiSampleIndex = 0;
+    static slidingWindow_t adcRssiWindow = { .size = RSSI_ADC_SAMPLE_COUNT };
     static uint32_t rssiUpdateAt = 0;
 
     if ((int32_t)(currentTimeUs - rssiUpdateAt) < 0) {
@@ -575,21 +787,12 @@ static void updateRSSIADC(timeUs_t currentTimeUs)
     }
     rssiUpdateAt = currentTimeUs + DELAY_50_HZ;
 
-    int16_t adcRssiMean = 0;
     uint16_t adcRssiSample = adcGetChannel(ADC_RSSI);
     uint8_t rssiPercentage = adcRssiSample / rxConfig->rssi_scale;
 
-    adcRssiSampleIndex = (adcRssiSampleIndex + 1) % RSSI_ADC_SAMPLE_COUNT;
-
-    adcRssiSamples[adcRssiSampleIndex] = rssiPercentage;
-
-    uint8_t sampleIndex;
-
-    for (sampleIndex = 0; sampleIndex < RSSI_ADC_SAMPLE_COUNT; sampleIndex++) {
-        adcRssiMean += adcRssiSamples[sampleIndex];
-    }
-
-    adcRssiMean = adcRssiMean / RSSI_ADC_SAMPLE_COUNT;
+    // the running sum makes the mean O(1), and it is taken over the samples so far until the window has filled
+    slidingWindowPush(&adcRssiWindow, rssiPercentage);
+    const int32_t adcRssiMean = slidingWindowMean(&adcRssiWindow);
 
     rssi = (uint16_t)((constrain(adcRssiMean, 0, 100) / 100.0f) * 1023.0f);
 #endif
@@ -55,9 +55,26 @@ typedef enum {
     SERIALRX_XBUS_MODE_B_RJ01 = 6,
     SERIALRX_IBUS = 7,
     SERIALRX_JETIEXBUS = 8,
-    SERIALRX_CRSF = 9
+    SERIALRX_CRSF = 9,
+    SERIALRX_NONE = 10                      // no second receiver, see serialrx_provider2
 } SerialRXType;
 
+#define RX_LINK_COUNT 2
+
+typedef struct rxFrameStats_s {
+    timeDelta_t intervalUs;                 // smoothed interval between frames, 0 until measured
+    uint32_t missedFrameCount;              // frames estimated lost from gaps in the frame timing
+} rxFrameStats_t;
+
+typedef struct rxLinkStats_s {
+    uint32_t frameCount;                    // valid frames received on this link
+    uint32_t usedFrameCount;                // frames that arrived first in their interval and drove rcData
+    uint32_t failsafeFrameCount;            // frames with the receiver failsafe flag set
+    timeUs_t lastFrameAt;
+    timeDelta_t lagUs;                      // smoothed time by which frames that were not used trailed the used frame
+    rxFrameStats_t frameStats;
+} rxLinkStats_t;
+
 #define MAX_SUPPORTED_RC_PPM_CHANNEL_COUNT          12
 #define MAX_SUPPORTED_RC_PARALLEL_PWM_CHANNEL_COUNT  8
 #define MAX_SUPPORTED_RC_CHANNEL_COUNT              18
@@ -112,6 +129,7 @@ typedef struct rxChannelRangeConfiguration_s {
 typedef struct rxConfig_s {
     uint8_t rcmap[MAX_MAPPABLE_RX_INPUTS];  // mapping of radio channels to internal RPYTA+ order
     uint8_t serialrx_provider;              // type of UART-based receiver (0 = spek 10, 1 = spek 11, 2 = sbus). Must be enabled by FEATURE_RX_SERIAL first.
+    uint8_t serialrx_provider2;             // optional second receiver on the next FUNCTION_RX_SERIAL port, SERIALRX_NONE if unused
     uint8_t sbus_inversion;                 // default sbus (Futaba, FrSKY) is inverted. Support for uninverted OpenLRS (and modified FrSKY) receivers.
     uint8_t rx_spi_protocol;               // type of nrf24 protocol (0 = v202 250kbps). Must be enabled by FEATURE_RX_NRF24 first.
     uint32_t rx_spi_id;
@@ -129,6 +147,7 @@ typedef struct rxConfig_s {
     uint8_t fpvCamAngleDegrees;             // Camera angle to be scaled into rc commands
     uint8_t max_aux_channel;
     uint16_t airModeActivateThreshold;      // Throttle setpoint where airmode gets activated
+    uint8_t rx_loss_frames;                 // missed frames before the signal is lost, scales the failsafe timings. 0 uses fixed timeouts
 
     uint16_t rx_min_usec;
     uint16_t rx_max_usec;
@@ -156,6 +175,10 @@ struct modeActivationCondition_s;
 void rxInit(const rxConfig_t *rxConfig, const struct modeActivationCondition_s *modeActivationConditions);
 void useRxConfig(const rxConfig_t *rxConfigToUse);
 bool rxUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs);
+void rxFrameComplete(timeUs_t frameTimeUs);
+timeDelta_t rxGetFrameDelta(void);
+const rxFrameStats_t *rxGetFrameStats(void);
+uint32_t rxLossFramesToUs(uint32_t defaultUs);
 bool rxIsReceivingSignal(void);
 bool rxAreFlightChannelsValid(void);
 void calculateRxChannelsAndUpdateFailsafe(timeUs_t currentTimeUs);
@@ -169,3 +192,9 @@ void suspendRxSignal(void);
 void resumeRxSignal(void);
 
 uint16_t rxGetRefreshRate(void);
+
+struct serialPortConfig_s;
+const struct serialPortConfig_s *serialRxFindPortConfig(void);
+bool rxIsDualLink(void);
+uint8_t rxGetActiveLink(void);
+const rxLinkStats_t *rxGetLinkStats(int link);
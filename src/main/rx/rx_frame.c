@@ -0,0 +1,160 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Frame receiver shared by the serial RX protocols that are plain byte streams of framed channel data. The receive
+ * callback only finds the frame boundaries, from the protocol's sync bytes, length field and the gaps between frames.
+ * The checksum and the channels are decoded by the RX task, straight from the buffer the frame was received into.
+ * Ports with RX DMA hand their bytes over from the idle line interrupt, once per frame.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "platform.h"
+
+#ifdef SERIAL_RX
+
+#include "common/maths.h"
+
+#include "drivers/system.h"
+
+#include "rx/rx.h"
+#include "rx/rx_frame.h"
+
+static const rxFrameProtocol_t *rxFrameProtocol;
+
+// a frame is received into one buffer while the last one is decoded from the other
+static uint8_t rxFrameBuffer[2][RX_FRAME_MAX_LENGTH];
+static uint8_t rxFrameBufferLength[2];
+static rxFrameChecksum_e rxFrameBufferChecksum[2];
+static uint8_t rxFrameWriteIndex;
+static volatile uint8_t rxFrameReady;       // 1 + the index of the buffer with a frame the RX task has yet to pick up
+
+static uint8_t rxFramePosition;
+static uint8_t rxFrameLength;               // of the frame being received, 0 until its length field has arrived
+static uint8_t rxFrameMaxLength;
+static rxFrameChecksum_e rxFrameChecksum;
+static timeUs_t rxFrameStartAt;
+static timeUs_t rxFrameLastByteAt;
+
+void rxFrameInit(const rxFrameProtocol_t *protocol)
+{
+    rxFrameProtocol = protocol;
+    rxFramePosition = 0;
+    rxFrameReady = 0;
+}
+
+static const rxFrameSync_t *rxFrameFindSync(uint8_t c)
+{
+    for (int i = 0; i < rxFrameProtocol->syncCount; i++) {
+        if (rxFrameProtocol->sync[i].byte == c) {
+            return &rxFrameProtocol->sync[i];
+        }
+    }
+    return NULL;
+}
+
+// Receive ISR callback
+void rxFrameDataReceive(uint16_t c)
+{
+    const rxFrameProtocol_t *protocol = rxFrameProtocol;
+    const timeUs_t now = micros();
+
+    if (rxFramePosition > 0) {
+        const bool gap = protocol->byteGapUs && cmpTimeUs(now, rxFrameLastByteAt) > (timeDelta_t)protocol->byteGapUs;
+        const bool late = protocol->frameTimeUs && cmpTimeUs(now, rxFrameStartAt) > (timeDelta_t)protocol->frameTimeUs;
+        if (gap || late) {
+            rxFramePosition = 0;
+        }
+    }
+    rxFrameLastByteAt = now;
+
+    if (rxFramePosition == 0) {
+        const rxFrameSync_t *sync = rxFrameFindSync(c);
+        if (!sync) {
+            return;
+        }
+        rxFrameStartAt = now;
+        // with a length field, the length of the sync byte is the longest frame allowed
+        rxFrameMaxLength = MIN(sync->length, RX_FRAME_MAX_LENGTH);
+        rxFrameLength = protocol->lengthOffset ? 0 : rxFrameMaxLength;
+        rxFrameChecksum = sync->checksum;
+    }
+
+    rxFrameBuffer[rxFrameWriteIndex][rxFramePosition++] = (uint8_t)c;
+
+    if (protocol->lengthOffset && rxFramePosition == protocol->lengthOffset + 1) {
+        const uint32_t length = (uint8_t)c * protocol->lengthScale + protocol->lengthBase;
+        if (length <= rxFramePosition || length > rxFrameMaxLength) {
+            rxFramePosition = 0;
+            return;
+        }
+        rxFrameLength = length;
+    }
+
+    if (rxFramePosition == rxFrameLength) {
+        rxFrameBufferLength[rxFrameWriteIndex] = rxFrameLength;
+        rxFrameBufferChecksum[rxFrameWriteIndex] = rxFrameChecksum;
+        rxFrameReady = rxFrameWriteIndex + 1;
+        // the buffer of the frame before is taken over, the RX task has had a whole frame time to decode it
+        rxFrameWriteIndex ^= 1;
+        rxFramePosition = 0;
+        rxFrameComplete(now);
+    }
+}
+
+static bool rxFrameChecksumValid(const uint8_t *frame, uint8_t length, rxFrameChecksum_e checksum)
+{
+    switch (checksum) {
+    case RX_FRAME_CHECKSUM_CRC16_CCITT:
+        return crc16_ccitt_buf(0, frame, length - 2) == ((frame[length - 2] << 8) | frame[length - 1]);
+    case RX_FRAME_CHECKSUM_SUM16_INVERTED: {
+        uint16_t sum = 0xFFFF;
+        for (int i = 0; i < length - 2; i++) {
+            sum -= frame[i];
+        }
+        return sum == (frame[length - 2] | (frame[length - 1] << 8));
+    }
+    case RX_FRAME_CHECKSUM_NONE:
+    default:
+        return true;
+    }
+}
+
+/*
+ * The frame received since the last call, or NULL if there is none or its checksum is wrong. Its buffer is only
+ * received into again once the frame after the next one starts arriving.
+ */
+const uint8_t *rxFrameGetReceived(uint8_t *frameLength)
+{
+    const uint8_t ready = rxFrameReady;
+    if (!ready) {
+        return NULL;
+    }
+    rxFrameReady = 0;
+
+    const uint8_t *frame = rxFrameBuffer[ready - 1];
+    const uint8_t length = rxFrameBufferLength[ready - 1];
+    if (!rxFrameChecksumValid(frame, length, rxFrameBufferChecksum[ready - 1])) {
+        return NULL;
+    }
+    *frameLength = length;
+    return frame;
+}
+#endif
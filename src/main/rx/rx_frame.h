@@ -0,0 +1,54 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/time.h"
+
+#define RX_FRAME_MAX_LENGTH     40  // the longest frame of the protocols below, SUMD with 16 channels
+#define RX_FRAME_SYNC_COUNT     2
+
+typedef enum {
+    RX_FRAME_CHECKSUM_NONE = 0,
+    RX_FRAME_CHECKSUM_CRC16_CCITT,      // CRC16 CCITT of the frame, then the CRC big endian in the last two bytes
+    RX_FRAME_CHECKSUM_SUM16_INVERTED    // 0xFFFF less the sum of the frame bytes, little endian in the last two bytes
+} rxFrameChecksum_e;
+
+// a frame starts with one of these bytes, which also sets its length when the protocol has no length field
+typedef struct rxFrameSync_s {
+    uint8_t byte;
+    uint8_t length;
+    rxFrameChecksum_e checksum;
+} rxFrameSync_t;
+
+/*
+ * How a serial RX protocol frames its data. With lengthOffset set the frame length is worked out from the
+ * byte at that offset, as lengthByte * lengthScale + lengthBase.
+ */
+typedef struct rxFrameProtocol_s {
+    rxFrameSync_t sync[RX_FRAME_SYNC_COUNT];
+    uint8_t syncCount;
+    uint8_t lengthOffset;               // 0 for the fixed length of the sync byte
+    uint8_t lengthScale;
+    uint8_t lengthBase;
+    timeUs_t byteGapUs;                 // a pause between bytes longer than this starts over with a new frame, 0 for none
+    timeUs_t frameTimeUs;               // a frame is dropped when it takes longer than this from its first byte, 0 for no limit
+} rxFrameProtocol_t;
+
+void rxFrameInit(const rxFrameProtocol_t *protocol);
+void rxFrameDataReceive(uint16_t c);
+const uint8_t *rxFrameGetReceived(uint8_t *frameLength);
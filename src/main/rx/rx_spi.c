@@ -140,6 +140,10 @@ bool rxSpiInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     rxSpiNewPacketAvailable = false;
     rxRuntimeConfig->rxRefreshRate = 20000;
 
+    // with the radio IRQ wired up the RX task runs as soon as a packet arrives,
+    // and polling only costs a pin read until then
+    NRF24L01_SetIrqCallback(rxFrameComplete);
+
     rxRuntimeConfig->rcReadRawFn = rxSpiReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = rxSpiFrameStatus;
 
@@ -23,6 +23,7 @@
 
 #ifdef SERIAL_RX
 
+#include "common/encoding.h"
 #include "common/utils.h"
 
 #include "drivers/system.h"
@@ -34,6 +35,7 @@
 #endif
 #include "rx/rx.h"
 #include "rx/sbus.h"
+#include "rx/rx_frame.h"
 
 /*
  * Observations
@@ -63,6 +65,8 @@ static uint16_t sbusStateFlags = 0;
 
 #define SBUS_MAX_CHANNEL 18
 #define SBUS_FRAME_SIZE 25
+#define SBUS_CHANNEL_DATA_COUNT 16
+#define SBUS_CHANNEL_DATA_LENGTH 22
 
 #define SBUS_FRAME_BEGIN_BYTE 0x0F
 
@@ -75,8 +79,6 @@ static uint16_t sbusStateFlags = 0;
 #define SBUS_DIGITAL_CHANNEL_MIN 173
 #define SBUS_DIGITAL_CHANNEL_MAX 1812
 
-static bool sbusFrameDone = false;
-
 static uint32_t sbusChannelData[SBUS_MAX_CHANNEL];
 
 #define SBUS_FLAG_CHANNEL_17        (1 << 0)
@@ -87,22 +89,7 @@ static uint32_t sbusChannelData[SBUS_MAX_CHANNEL];
 struct sbusFrame_s {
     uint8_t syncByte;
     // 176 bits of data (11 bits per channel * 16 channels) = 22 bytes.
-    unsigned int chan0 : 11;
-    unsigned int chan1 : 11;
-    unsigned int chan2 : 11;
-    unsigned int chan3 : 11;
-    unsigned int chan4 : 11;
-    unsigned int chan5 : 11;
-    unsigned int chan6 : 11;
-    unsigned int chan7 : 11;
-    unsigned int chan8 : 11;
-    unsigned int chan9 : 11;
-    unsigned int chan10 : 11;
-    unsigned int chan11 : 11;
-    unsigned int chan12 : 11;
-    unsigned int chan13 : 11;
-    unsigned int chan14 : 11;
-    unsigned int chan15 : 11;
+    uint8_t channels[SBUS_CHANNEL_DATA_LENGTH];
     uint8_t flags;
     /**
      * The endByte is 0x00 on FrSky and some futaba RX's, on Some SBUS2 RX's the value indicates the telemetry byte that is sent after every 4th sbus frame.
@@ -119,89 +106,48 @@ typedef union {
     struct sbusFrame_s frame;
 } sbusFrame_t;
 
-static sbusFrame_t sbusFrame;
-
-// Receive ISR callback
-static void sbusDataReceive(uint16_t c)
-{
-    static uint8_t sbusFramePosition = 0;
-    static uint32_t sbusFrameStartAt = 0;
-    uint32_t now = micros();
-
-    int32_t sbusFrameTime = now - sbusFrameStartAt;
-
-    if (sbusFrameTime > (long)(SBUS_TIME_NEEDED_PER_FRAME + 500)) {
-        sbusFramePosition = 0;
-    }
-
-    if (sbusFramePosition == 0) {
-        if (c != SBUS_FRAME_BEGIN_BYTE) {
-            return;
-        }
-        sbusFrameStartAt = now;
-    }
-
-    if (sbusFramePosition < SBUS_FRAME_SIZE) {
-        sbusFrame.bytes[sbusFramePosition++] = (uint8_t)c;
-        if (sbusFramePosition < SBUS_FRAME_SIZE) {
-            sbusFrameDone = false;
-        } else {
-            sbusFrameDone = true;
-#ifdef DEBUG_SBUS_PACKETS
-        debug[2] = sbusFrameTime;
-#endif
-        }
-    }
-}
+static const rxFrameProtocol_t sbusProtocol = {
+    .sync = {
+        { .byte = SBUS_FRAME_BEGIN_BYTE, .length = SBUS_FRAME_SIZE, .checksum = RX_FRAME_CHECKSUM_NONE },
+    },
+    .syncCount = 1,
+    .frameTimeUs = SBUS_TIME_NEEDED_PER_FRAME + 500,
+};
 
 static uint8_t sbusFrameStatus(void)
 {
-    if (!sbusFrameDone) {
+    uint8_t frameLength;
+    const sbusFrame_t *frame = (const sbusFrame_t *)rxFrameGetReceived(&frameLength);
+    if (!frame) {
         return RX_FRAME_PENDING;
     }
-    sbusFrameDone = false;
 
 #ifdef DEBUG_SBUS_PACKETS
     sbusStateFlags = 0;
-    debug[1] = sbusFrame.frame.flags;
+    debug[1] = frame->frame.flags;
 #endif
 
-    sbusChannelData[0] = sbusFrame.frame.chan0;
-    sbusChannelData[1] = sbusFrame.frame.chan1;
-    sbusChannelData[2] = sbusFrame.frame.chan2;
-    sbusChannelData[3] = sbusFrame.frame.chan3;
-    sbusChannelData[4] = sbusFrame.frame.chan4;
-    sbusChannelData[5] = sbusFrame.frame.chan5;
-    sbusChannelData[6] = sbusFrame.frame.chan6;
-    sbusChannelData[7] = sbusFrame.frame.chan7;
-    sbusChannelData[8] = sbusFrame.frame.chan8;
-    sbusChannelData[9] = sbusFrame.frame.chan9;
-    sbusChannelData[10] = sbusFrame.frame.chan10;
-    sbusChannelData[11] = sbusFrame.frame.chan11;
-    sbusChannelData[12] = sbusFrame.frame.chan12;
-    sbusChannelData[13] = sbusFrame.frame.chan13;
-    sbusChannelData[14] = sbusFrame.frame.chan14;
-    sbusChannelData[15] = sbusFrame.frame.chan15;
-
-    if (sbusFrame.frame.flags & SBUS_FLAG_CHANNEL_17) {
+    unpack11BitValues(sbusChannelData, frame->frame.channels, SBUS_CHANNEL_DATA_COUNT);
+
+    if (frame->frame.flags & SBUS_FLAG_CHANNEL_17) {
         sbusChannelData[16] = SBUS_DIGITAL_CHANNEL_MAX;
     } else {
         sbusChannelData[16] = SBUS_DIGITAL_CHANNEL_MIN;
     }
 
-    if (sbusFrame.frame.flags & SBUS_FLAG_CHANNEL_18) {
+    if (frame->frame.flags & SBUS_FLAG_CHANNEL_18) {
         sbusChannelData[17] = SBUS_DIGITAL_CHANNEL_MAX;
     } else {
         sbusChannelData[17] = SBUS_DIGITAL_CHANNEL_MIN;
     }
 
-    if (sbusFrame.frame.flags & SBUS_FLAG_SIGNAL_LOSS) {
+    if (frame->frame.flags & SBUS_FLAG_SIGNAL_LOSS) {
 #ifdef DEBUG_SBUS_PACKETS
         sbusStateFlags |= SBUS_STATE_SIGNALLOSS;
         debug[0] = sbusStateFlags;
 #endif
     }
-    if (sbusFrame.frame.flags & SBUS_FLAG_FAILSAFE_ACTIVE) {
+    if (frame->frame.flags & SBUS_FLAG_FAILSAFE_ACTIVE) {
         // internal failsafe enabled and rx failsafe flag set
 #ifdef DEBUG_SBUS_PACKETS
         sbusStateFlags |= SBUS_STATE_FAILSAFE;
@@ -237,7 +183,7 @@ bool sbusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     rxRuntimeConfig->rcReadRawFn = sbusReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = sbusFrameStatus;
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
     if (!portConfig) {
         return false;
     }
@@ -249,7 +195,8 @@ bool sbusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
 #endif
 
     portOptions_t options = (rxConfig->sbus_inversion) ? (SBUS_PORT_OPTIONS | SERIAL_INVERTED) : SBUS_PORT_OPTIONS;
-    serialPort_t *sBusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, sbusDataReceive, SBUS_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, options);
+    rxFrameInit(&sbusProtocol);
+    serialPort_t *sBusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, rxFrameDataReceive, SBUS_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, options);
 
 #ifdef TELEMETRY
     if (portShared) {
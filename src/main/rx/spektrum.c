@@ -53,6 +53,8 @@
 #define SPEKTRUM_NEEDED_FRAME_INTERVAL  5000
 
 #define SPEKTRUM_BAUDRATE               115200
+#define SPEKTRUM_BYTE_TIME_US           (10 * 1000000 / SPEKTRUM_BAUDRATE + 1)
+#define SPEKTRUM_TELEMETRY_GUARD_US     500     // turnaround before the next frame on the half duplex line
 
 #define SPEKTRUM_MAX_FADE_PER_SEC       40
 #define SPEKTRUM_FADE_REPORTS_PER_SEC   2
@@ -70,6 +72,7 @@ static uint16_t spek_fade_last_sec_count = 0; // Stores the fade count at the la
 static uint8_t rssi_channel; // Stores the RX RSSI channel.
 
 static volatile uint8_t spekFrame[SPEK_FRAME_SIZE];
+static volatile timeUs_t spekFrameTimeUs;
 
 static rxRuntimeConfig_t *rxRuntimeConfigPtr;
 static serialPort_t *serialPort;
@@ -107,6 +110,8 @@ static void spektrumDataReceive(uint16_t c)
             rcFrameComplete = false;
         } else {
             rcFrameComplete = true;
+            spekFrameTimeUs = spekTime;
+            rxFrameComplete(spekTime);
         }
     }
 }
@@ -153,8 +158,14 @@ static uint8_t spektrumFrameStatus(void)
         }
     }
 
+    // Only reply while the whole telemetry frame fits into the gap before the next RC frame. When the RX task
+    // ran too late the reply is kept for the next gap rather than colliding with the receiver.
     if (telemetryBufLen) {
-        srxlRxSendTelemetryData();
+        const timeDelta_t sinceFrameUs = cmpTimeUs(micros(), spekFrameTimeUs);
+        const timeDelta_t telemetryTimeUs = telemetryBufLen * SPEKTRUM_BYTE_TIME_US + SPEKTRUM_TELEMETRY_GUARD_US;
+        if (sinceFrameUs + telemetryTimeUs < rxRuntimeConfigPtr->rxRefreshRate) {
+            srxlRxSendTelemetryData();
+        }
     }
     return RX_FRAME_COMPLETE;
 }
@@ -278,7 +289,7 @@ bool spektrumInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig
     rxRuntimeConfig->rcReadRawFn = spektrumReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = spektrumFrameStatus;
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
     if (!portConfig) {
         return false;
     }
@@ -35,6 +35,7 @@
 
 #include "rx/rx.h"
 #include "rx/sumd.h"
+#include "rx/rx_frame.h"
 
 // driver for SUMD receiver using UART2
 
@@ -46,63 +47,19 @@
 
 #define SUMD_BAUDRATE 115200
 
-static bool sumdFrameDone = false;
 static uint16_t sumdChannels[SUMD_MAX_CHANNEL];
-static uint16_t crc;
 
-#define CRC_POLYNOME 0x1021
-
-// CRC calculation, adds a 8 bit unsigned to 16 bit crc
-static void CRC16(uint8_t value)
-{
-    uint8_t i;
-
-    crc = crc ^ (int16_t)value << 8;
-    for (i = 0; i < 8; i++) {
-    if (crc & 0x8000)
-        crc = (crc << 1) ^ CRC_POLYNOME;
-    else
-        crc = (crc << 1);
-    }
-}
-
-static uint8_t sumd[SUMD_BUFFSIZE] = { 0, };
-static uint8_t sumdChannelCount;
-
-// Receive ISR callback
-static void sumdDataReceive(uint16_t c)
-{
-    uint32_t sumdTime;
-    static uint32_t sumdTimeLast;
-    static uint8_t sumdIndex;
-
-    sumdTime = micros();
-    if ((sumdTime - sumdTimeLast) > 4000)
-        sumdIndex = 0;
-    sumdTimeLast = sumdTime;
-
-    if (sumdIndex == 0) {
-        if (c != SUMD_SYNCBYTE)
-            return;
-        else
-        {
-            sumdFrameDone = false; // lazy main loop didnt fetch the stuff
-            crc = 0;
-        }
-    }
-    if (sumdIndex == 2)
-        sumdChannelCount = (uint8_t)c;
-    if (sumdIndex < SUMD_BUFFSIZE)
-        sumd[sumdIndex] = (uint8_t)c;
-    sumdIndex++;
-    if (sumdIndex < sumdChannelCount * 2 + 4)
-        CRC16((uint8_t)c);
-    else
-        if (sumdIndex == sumdChannelCount * 2 + 5) {
-            sumdIndex = 0;
-            sumdFrameDone = true;
-        }
-}
+// sync, status, channel count, 2 bytes per channel and the CRC
+static const rxFrameProtocol_t sumdProtocol = {
+    .sync = {
+        { .byte = SUMD_SYNCBYTE, .length = SUMD_BUFFSIZE, .checksum = RX_FRAME_CHECKSUM_CRC16_CCITT },
+    },
+    .syncCount = 1,
+    .lengthOffset = 2,
+    .lengthScale = 2,
+    .lengthBase = 5,
+    .byteGapUs = 4000,
+};
 
 #define SUMD_OFFSET_CHANNEL_1_HIGH 3
 #define SUMD_OFFSET_CHANNEL_1_LOW 4
@@ -118,17 +75,12 @@ static uint8_t sumdFrameStatus(void)
 
     uint8_t frameStatus = RX_FRAME_PENDING;
 
-    if (!sumdFrameDone) {
+    uint8_t frameLength;
+    const uint8_t *sumd = rxFrameGetReceived(&frameLength);
+    if (!sumd) {
         return frameStatus;
     }
 
-    sumdFrameDone = false;
-
-    // verify CRC
-    if (crc != ((sumd[SUMD_BYTES_PER_CHANNEL * sumdChannelCount + SUMD_OFFSET_CHANNEL_1_HIGH] << 8) |
-            (sumd[SUMD_BYTES_PER_CHANNEL * sumdChannelCount + SUMD_OFFSET_CHANNEL_1_LOW])))
-        return frameStatus;
-
     switch (sumd[1]) {
         case SUMD_FRAME_STATE_FAILSAFE:
             frameStatus = RX_FRAME_COMPLETE | RX_FRAME_FAILSAFE;
@@ -140,9 +92,7 @@ static uint8_t sumdFrameStatus(void)
             return frameStatus;
     }
 
-    if (sumdChannelCount > SUMD_MAX_CHANNEL)
-        sumdChannelCount = SUMD_MAX_CHANNEL;
-
+    const uint8_t sumdChannelCount = sumd[2];
     for (channelIndex = 0; channelIndex < sumdChannelCount; channelIndex++) {
         sumdChannels[channelIndex] = (
             (sumd[SUMD_BYTES_PER_CHANNEL * channelIndex + SUMD_OFFSET_CHANNEL_1_HIGH] << 8) |
@@ -168,7 +118,7 @@ bool sumdInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     rxRuntimeConfig->rcReadRawFn = sumdReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = sumdFrameStatus;
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
     if (!portConfig) {
         return false;
     }
@@ -179,7 +129,8 @@ bool sumdInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     bool portShared = false;
 #endif
 
-    serialPort_t *sumdPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, sumdDataReceive, SUMD_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
+    rxFrameInit(&sumdProtocol);
+    serialPort_t *sumdPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, rxFrameDataReceive, SUMD_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
 
 #ifdef TELEMETRY
     if (portShared) {
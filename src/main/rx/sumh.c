@@ -41,6 +41,7 @@
 
 #include "rx/rx.h"
 #include "rx/sumh.h"
+#include "rx/rx_frame.h"
 
 // driver for SUMH receiver using UART2
 
@@ -49,48 +50,32 @@
 #define SUMH_MAX_CHANNEL_COUNT 8
 #define SUMH_FRAME_SIZE 21
 
-static bool sumhFrameDone = false;
+#define SUMH_SYNCBYTE 0xA8
 
-static uint8_t sumhFrame[SUMH_FRAME_SIZE];
 static uint32_t sumhChannels[SUMH_MAX_CHANNEL_COUNT];
 
 static serialPort_t *sumhPort;
 
-
-// Receive ISR callback
-static void sumhDataReceive(uint16_t c)
-{
-    uint32_t sumhTime;
-    static uint32_t sumhTimeLast, sumhTimeInterval;
-    static uint8_t sumhFramePosition;
-
-    sumhTime = micros();
-    sumhTimeInterval = sumhTime - sumhTimeLast;
-    sumhTimeLast = sumhTime;
-    if (sumhTimeInterval > 5000) {
-        sumhFramePosition = 0;
-    }
-
-    sumhFrame[sumhFramePosition] = (uint8_t) c;
-    if (sumhFramePosition == SUMH_FRAME_SIZE - 1) {
-        // FIXME at this point the value of 'c' is unused and un tested, what should it be, is it important?
-        sumhFrameDone = true;
-    } else {
-        sumhFramePosition++;
-    }
-}
+static const rxFrameProtocol_t sumhProtocol = {
+    .sync = {
+        { .byte = SUMH_SYNCBYTE, .length = SUMH_FRAME_SIZE, .checksum = RX_FRAME_CHECKSUM_NONE },
+    },
+    .syncCount = 1,
+    .byteGapUs = 5000,
+};
 
 static uint8_t sumhFrameStatus(void)
 {
     uint8_t channelIndex;
 
-    if (!sumhFrameDone) {
+    uint8_t frameLength;
+    const uint8_t *sumhFrame = rxFrameGetReceived(&frameLength);
+    if (!sumhFrame) {
         return RX_FRAME_PENDING;
     }
 
-    sumhFrameDone = false;
-
-    if (!((sumhFrame[0] == 0xA8) && (sumhFrame[SUMH_FRAME_SIZE - 2] == 0))) {
+    // FIXME the last byte is unused and untested, what should it be, is it important?
+    if (sumhFrame[SUMH_FRAME_SIZE - 2] != 0) {
         return RX_FRAME_PENDING;
     }
 
@@ -122,7 +107,7 @@ bool sumhInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     rxRuntimeConfig->rcReadRawFn = sumhReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = sumhFrameStatus;
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
     if (!portConfig) {
         return false;
     }
@@ -133,7 +118,8 @@ bool sumhInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     bool portShared = false;
 #endif
 
-    sumhPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, sumhDataReceive, SUMH_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
+    rxFrameInit(&sumhProtocol);
+    sumhPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, rxFrameDataReceive, SUMH_BAUDRATE, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
 
 #ifdef TELEMETRY
     if (portShared) {
@@ -23,6 +23,8 @@
 
 #ifdef SERIAL_RX
 
+#include "common/maths.h"
+
 #include "drivers/system.h"
 
 #include "io/serial.h"
@@ -33,6 +35,7 @@
 
 #include "rx/rx.h"
 #include "rx/xbus.h"
+#include "rx/rx_frame.h"
 
 //
 // Serial driver for JR's XBus (MODE B) receiver
@@ -50,8 +53,6 @@
 #define XBUS_RJ01_MESSAGE_LENGTH 30
 #define XBUS_RJ01_OFFSET_BYTES 3
 
-#define XBUS_CRC_AND_VALUE 0x8000
-#define XBUS_CRC_POLY 0x1021
 
 #define XBUS_BAUDRATE 115200
 #define XBUS_RJ01_BAUDRATE 250000
@@ -76,34 +77,27 @@
 // Use formula: 800 + value * 1400 / 4096 (i.e. a shift by 12)
 #define XBUS_CONVERT_TO_USEC(V) (800 + ((V * 1400) >> 12))
 
-static bool xBusFrameReceived = false;
-static bool xBusDataIncoming = false;
-static uint8_t xBusFramePosition;
-static uint8_t xBusFrameLength;
 static uint8_t xBusChannelCount;
-static uint8_t xBusProvider;
-
 
-// Use max values for ram areas
-static volatile uint8_t xBusFrame[XBUS_FRAME_SIZE_A2];  //siz 35 for 16 channels in xbus_Mode_B
 static uint16_t xBusChannelData[XBUS_RJ01_CHANNEL_COUNT];
 
-// The xbus mode B CRC calculations
-static uint16_t xBusCRC16(uint16_t crc, uint8_t value)
-{
-    uint8_t i;
-
-    crc = crc ^ (int16_t)value << 8;
-
-    for (i = 0; i < 8; i++) {
-        if (crc & XBUS_CRC_AND_VALUE) {
-            crc = crc << 1 ^ XBUS_CRC_POLY;
-        } else {
-            crc = crc << 1;
-        }
-    }
-    return crc;
-}
+static const rxFrameProtocol_t xBusModeBProtocol = {
+    .sync = {
+        { .byte = XBUS_START_OF_FRAME_BYTE_A1, .length = XBUS_FRAME_SIZE_A1, .checksum = RX_FRAME_CHECKSUM_CRC16_CCITT },
+        { .byte = XBUS_START_OF_FRAME_BYTE_A2, .length = XBUS_FRAME_SIZE_A2, .checksum = RX_FRAME_CHECKSUM_CRC16_CCITT },
+    },
+    .syncCount = 2,
+    .byteGapUs = XBUS_MAX_FRAME_TIME,
+};
+
+// the MODE B frame inside an RJ01 frame has a CRC of its own, so both are checked by xBusUnpackRJ01Frame()
+static const rxFrameProtocol_t xBusRj01Protocol = {
+    .sync = {
+        { .byte = XBUS_START_OF_FRAME_BYTE_A1, .length = XBUS_RJ01_FRAME_SIZE, .checksum = RX_FRAME_CHECKSUM_NONE },
+    },
+    .syncCount = 1,
+    .byteGapUs = XBUS_MAX_FRAME_TIME,
+};
 
 // Full RJ01 message CRC calculations
 uint8_t xBusRj01CRC8(uint8_t inData, uint8_t seed)
@@ -129,42 +123,25 @@ uint8_t xBusRj01CRC8(uint8_t inData, uint8_t seed)
 }
 
 
-static void xBusUnpackModeBFrame(uint8_t offsetBytes)
+// Unpack the data of a MODE B frame with a valid CRC, only 12 channel unpack also when receive 16 channel
+static void xBusUnpackModeBFrame(const uint8_t *xBusFrame)
 {
-    // Calculate the CRC of the incoming frame
-    uint16_t crc = 0;
-    uint16_t inCrc = 0;
-    uint8_t i = 0;
+    uint8_t i;
     uint16_t value;
     uint8_t frameAddr;
 
-    // Calculate on all bytes except the final two CRC bytes
-    for (i = 0; i < xBusFrameLength - 2; i++) {
-        inCrc = xBusCRC16(inCrc, xBusFrame[i+offsetBytes]);
-    }
+    for (i = 0; i < xBusChannelCount; i++) {
 
-    // Get the received CRC
-    crc = ((uint16_t)xBusFrame[offsetBytes + xBusFrameLength - 2]) << 8;
-    crc = crc + ((uint16_t)xBusFrame[offsetBytes + xBusFrameLength - 1]);
-
-    if (crc == inCrc) {
-        // Unpack the data, we have a valid frame, only 12 channel unpack also when receive 16 channel
-        for (i = 0; i < xBusChannelCount; i++) {
-
-            frameAddr = offsetBytes + 1 + i * 2;
-            value = ((uint16_t)xBusFrame[frameAddr]) << 8;
-            value = value + ((uint16_t)xBusFrame[frameAddr + 1]);
-
-            // Convert to internal format
-            xBusChannelData[i] = XBUS_CONVERT_TO_USEC(value);
-        }
+        frameAddr = 1 + i * 2;
+        value = ((uint16_t)xBusFrame[frameAddr]) << 8;
+        value = value + ((uint16_t)xBusFrame[frameAddr + 1]);
 
-        xBusFrameReceived = true;
+        // Convert to internal format
+        xBusChannelData[i] = XBUS_CONVERT_TO_USEC(value);
     }
-
 }
 
-static void xBusUnpackRJ01Frame(void)
+static bool xBusUnpackRJ01Frame(const uint8_t *xBusFrame)
 {
     // Calculate the CRC of the incoming frame
     uint8_t outerCrc = 0;
@@ -191,80 +168,48 @@ static void xBusUnpackRJ01Frame(void)
     if (xBusFrame[1] != XBUS_RJ01_MESSAGE_LENGTH)
     {
         // Unknown package as length is not ok
-        return;
+        return false;
     }
 
     //
     // CRC calculation & check for full message
     //
-    for (i = 0; i < xBusFrameLength - 1; i++) {
+    for (i = 0; i < XBUS_RJ01_FRAME_SIZE - 1; i++) {
         outerCrc = xBusRj01CRC8(outerCrc, xBusFrame[i]);
     }
 
-    if (outerCrc != xBusFrame[xBusFrameLength - 1])
+    if (outerCrc != xBusFrame[XBUS_RJ01_FRAME_SIZE - 1])
     {
         // CRC does not match, skip this frame
-        return;
-    }
-
-    // Now unpack the "embedded MODE B frame"
-    xBusUnpackModeBFrame(XBUS_RJ01_OFFSET_BYTES);
-}
-
-// Receive ISR callback
-static void xBusDataReceive(uint16_t c)
-{
-    uint32_t now;
-    static uint32_t xBusTimeLast, xBusTimeInterval;
-
-    // Check if we shall reset frame position due to time
-    now = micros();
-    xBusTimeInterval = now - xBusTimeLast;
-    xBusTimeLast = now;
-    if (xBusTimeInterval > XBUS_MAX_FRAME_TIME) {
-        xBusFramePosition = 0;
-        xBusDataIncoming = false;
-    }
-
-    // Check if we shall start a frame?
-    if (xBusFramePosition == 0) {
-        if (c == XBUS_START_OF_FRAME_BYTE_A1) {
-            xBusDataIncoming = true;
-            xBusFrameLength = XBUS_FRAME_SIZE_A1;   //decrease framesize (when receiver change, otherwise board must reboot)
-        } else if (c == XBUS_START_OF_FRAME_BYTE_A2) {//16channel packet
-            xBusDataIncoming = true;
-            xBusFrameLength = XBUS_FRAME_SIZE_A2;   //increase framesize
-        }
-    }
-
-    // Only do this if we are receiving to a frame
-    if (xBusDataIncoming == true) {
-        // Store in frame copy
-        xBusFrame[xBusFramePosition] = (uint8_t)c;
-        xBusFramePosition++;
+        return false;
     }
 
-    // Done?
-    if (xBusFramePosition == xBusFrameLength) {
-        switch (xBusProvider) {
-        case SERIALRX_XBUS_MODE_B:
-            xBusUnpackModeBFrame(0);
-        case SERIALRX_XBUS_MODE_B_RJ01:
-            xBusUnpackRJ01Frame();
-        }
-        xBusDataIncoming = false;
-        xBusFramePosition = 0;
+    // Now check and unpack the "embedded MODE B frame"
+    const uint8_t *modeBFrame = xBusFrame + XBUS_RJ01_OFFSET_BYTES;
+    const uint16_t crc = ((uint16_t)modeBFrame[XBUS_FRAME_SIZE_A1 - 2] << 8) + modeBFrame[XBUS_FRAME_SIZE_A1 - 1];
+    if (crc16_ccitt_buf(0, modeBFrame, XBUS_FRAME_SIZE_A1 - 2) != crc) {
+        return false;
     }
+    xBusUnpackModeBFrame(modeBFrame);
+    return true;
 }
 
 // Indicate time to read a frame from the data...
 static uint8_t xBusFrameStatus(void)
 {
-    if (!xBusFrameReceived) {
+    uint8_t frameLength;
+    const uint8_t *xBusFrame = rxFrameGetReceived(&frameLength);
+    if (!xBusFrame) {
         return RX_FRAME_PENDING;
     }
 
-    xBusFrameReceived = false;
+    if (frameLength == XBUS_RJ01_FRAME_SIZE) {
+        if (!xBusUnpackRJ01Frame(xBusFrame)) {
+            return RX_FRAME_PENDING;
+        }
+    } else {
+        xBusUnpackModeBFrame(xBusFrame);
+    }
 
     return RX_FRAME_COMPLETE;
 }
@@ -290,23 +235,15 @@ bool xBusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     switch (rxConfig->serialrx_provider) {
     case SERIALRX_XBUS_MODE_B:
         rxRuntimeConfig->channelCount = XBUS_CHANNEL_COUNT;
-        xBusFrameReceived = false;
-        xBusDataIncoming = false;
-        xBusFramePosition = 0;
         baudRate = XBUS_BAUDRATE;
-        xBusFrameLength = XBUS_FRAME_SIZE_A1;
         xBusChannelCount = XBUS_CHANNEL_COUNT;
-        xBusProvider = SERIALRX_XBUS_MODE_B;
+        rxFrameInit(&xBusModeBProtocol);
         break;
     case SERIALRX_XBUS_MODE_B_RJ01:
         rxRuntimeConfig->channelCount = XBUS_RJ01_CHANNEL_COUNT;
-        xBusFrameReceived = false;
-        xBusDataIncoming = false;
-        xBusFramePosition = 0;
         baudRate = XBUS_RJ01_BAUDRATE;
-        xBusFrameLength = XBUS_RJ01_FRAME_SIZE;
         xBusChannelCount = XBUS_RJ01_CHANNEL_COUNT;
-        xBusProvider = SERIALRX_XBUS_MODE_B_RJ01;
+        rxFrameInit(&xBusRj01Protocol);
         break;
     default:
         return false;
@@ -318,7 +255,7 @@ bool xBusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     rxRuntimeConfig->rcReadRawFn = xBusReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = xBusFrameStatus;
 
-    const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    const serialPortConfig_t *portConfig = serialRxFindPortConfig();
     if (!portConfig) {
         return false;
     }
@@ -329,7 +266,7 @@ bool xBusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
     bool portShared = false;
 #endif
 
-    serialPort_t *xBusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, xBusDataReceive, baudRate, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
+    serialPort_t *xBusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, rxFrameDataReceive, baudRate, portShared ? MODE_RXTX : MODE_RX, SERIAL_NOT_INVERTED);
 
 #ifdef TELEMETRY
     if (portShared) {
@@ -26,13 +26,17 @@
 #include "build/debug.h"
 
 #include "scheduler/scheduler.h"
+#include "scheduler/scheduler_trace.h"
 
 #include "common/maths.h"
 #include "common/time.h"
 #include "common/utils.h"
 
+#include "drivers/nvic.h"
 #include "drivers/system.h"
 
+#include "build/atomic.h"
+
 // DEBUG_SCHEDULER, timings for:
 // 0 - gyroUpdate()
 // 1 - pidController()
@@ -40,12 +44,24 @@
 // 3 - time spent executing check function
 
 static cfTask_t *currentTask = NULL;
+// the running task should return by this time, so the next realtime task starts on time
+static timeUs_t currentTaskBudgetEndsAt;
 
 static uint32_t totalWaitingTasks;
 static uint32_t totalWaitingTasksSamples;
 
 uint16_t averageSystemLoadPercent = 0;
 
+// share of time not spent in scheduler passes that found nothing to run
+uint16_t cpuUtilisationPercent = 0;
+static timeUs_t idleStartedAt;
+static timeUs_t idleTimeUs;
+static timeUs_t lastUtilisationSampleAt;
+static bool idleSleepEnabled;
+
+// Bit n is set when cfTasks[n] has been signalled and its checkFunc has not yet been called
+static volatile uint32_t signalledTaskBitmap;
+
 
 static int taskQueuePos = 0;
 static int taskQueueSize = 0;
@@ -53,11 +69,80 @@ static int taskQueueSize = 0;
 
 static cfTask_t* taskQueueArray[TASK_COUNT + 1]; // extra item for NULL pointer at end of queue
 
+#ifdef USE_SCHEDULER_READY_BITMAP
+/*
+ * Instead of checking every task on each pass, tasks wait in dueQueue ordered by the time their
+ * period next elapses, and are moved to readyTaskBitmap once it has. Bit n of the bitmaps is the
+ * task at taskQueueArray[n], so the lowest set bit is the highest static priority.
+ * Only ready tasks and tasks with a checkFunc are evaluated in a pass.
+ * TASK_COUNT must not exceed 32.
+ */
+static uint32_t readyTaskBitmap;        // tasks whose desiredPeriod has elapsed since they last ran
+static uint32_t eventTaskBitmap;        // tasks with a checkFunc, these are polled on every pass
+static uint32_t realtimeTaskBitmap;
+static uint8_t taskQueuePosition[TASK_COUNT];
+static cfTask_t *dueQueue[TASK_COUNT];
+static int dueQueueSize = 0;
+
+static timeUs_t taskNextExecuteAt(const cfTask_t *task)
+{
+    return task->lastExecutedAt + task->desiredPeriod;
+}
+
+static void dueQueueInsert(cfTask_t *task)
+{
+    const timeUs_t nextExecuteAt = taskNextExecuteAt(task);
+    // search from the back, a task that has just run is usually due last
+    int ii = dueQueueSize;
+    while (ii > 0 && cmpTimeUs(taskNextExecuteAt(dueQueue[ii - 1]), nextExecuteAt) > 0) {
+        dueQueue[ii] = dueQueue[ii - 1];
+        --ii;
+    }
+    dueQueue[ii] = task;
+    ++dueQueueSize;
+}
+
+static bool dueQueueRemove(cfTask_t *task)
+{
+    for (int ii = 0; ii < dueQueueSize; ++ii) {
+        if (dueQueue[ii] == task) {
+            memmove(&dueQueue[ii], &dueQueue[ii+1], sizeof(task) * (dueQueueSize - ii - 1));
+            --dueQueueSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Task positions in taskQueueArray change whenever a task is added or removed, so start over
+static void readyBitmapRebuild(void)
+{
+    readyTaskBitmap = 0;
+    eventTaskBitmap = 0;
+    realtimeTaskBitmap = 0;
+    dueQueueSize = 0;
+    for (int ii = 0; ii < taskQueueSize; ++ii) {
+        cfTask_t *task = taskQueueArray[ii];
+        taskQueuePosition[task - cfTasks] = ii;
+        if (task->checkFunc) {
+            eventTaskBitmap |= BIT(ii);
+        }
+        if (task->staticPriority >= TASK_PRIORITY_REALTIME) {
+            realtimeTaskBitmap |= BIT(ii);
+        }
+        dueQueueInsert(task);
+    }
+}
+#endif
+
 void queueClear(void)
 {
     memset(taskQueueArray, 0, sizeof(taskQueueArray));
     taskQueuePos = 0;
     taskQueueSize = 0;
+#ifdef USE_SCHEDULER_READY_BITMAP
+    readyBitmapRebuild();
+#endif
 }
 
 bool queueContains(cfTask_t *task)
@@ -80,6 +165,9 @@ bool queueAdd(cfTask_t *task)
             memmove(&taskQueueArray[ii+1], &taskQueueArray[ii], sizeof(task) * (taskQueueSize - ii));
             taskQueueArray[ii] = task;
             ++taskQueueSize;
+#ifdef USE_SCHEDULER_READY_BITMAP
+            readyBitmapRebuild();
+#endif
             return true;
         }
     }
@@ -92,6 +180,9 @@ bool queueRemove(cfTask_t *task)
         if (taskQueueArray[ii] == task) {
             memmove(&taskQueueArray[ii], &taskQueueArray[ii+1], sizeof(task) * (taskQueueSize - ii));
             --taskQueueSize;
+#ifdef USE_SCHEDULER_READY_BITMAP
+            readyBitmapRebuild();
+#endif
             return true;
         }
     }
@@ -117,14 +208,20 @@ cfTask_t *queueNext(void)
 
 void taskSystem(timeUs_t currentTimeUs)
 {
-    UNUSED(currentTimeUs);
-
     // Calculate system load
     if (totalWaitingTasksSamples > 0) {
         averageSystemLoadPercent = 100 * totalWaitingTasks / totalWaitingTasksSamples;
         totalWaitingTasksSamples = 0;
         totalWaitingTasks = 0;
     }
+
+    // Calculate CPU utilisation
+    const timeDelta_t sampleTimeUs = cmpTimeUs(currentTimeUs, lastUtilisationSampleAt);
+    if (lastUtilisationSampleAt && sampleTimeUs > 0) {
+        cpuUtilisationPercent = 100 - MIN(100, (uint64_t)100 * idleTimeUs / sampleTimeUs);
+    }
+    lastUtilisationSampleAt = currentTimeUs;
+    idleTimeUs = 0;
 }
 
 #ifndef SKIP_TASK_STATISTICS
@@ -151,6 +248,56 @@ void getTaskInfo(cfTaskId_e taskId, cfTaskInfo_t * taskInfo)
     taskInfo->totalExecutionTime = cfTasks[taskId].totalExecutionTime;
     taskInfo->averageExecutionTime = cfTasks[taskId].movingSumExecutionTime / MOVING_SUM_COUNT;
     taskInfo->latestDeltaTime = cfTasks[taskId].taskLatestDeltaTime;
+    taskInfo->executionTimeHistogram = cfTasks[taskId].executionTimeHistogram;
+    taskInfo->latenessHistogram = cfTasks[taskId].latenessHistogram;
+    taskInfo->deadlineMissCount = cfTasks[taskId].deadlineMissCount;
+}
+
+void taskHistogramAdd(uint16_t *histogram, timeUs_t timeUs)
+{
+    // bucket n holds times from (TASK_HISTOGRAM_BUCKET_0_US << (n - 1)) up to (TASK_HISTOGRAM_BUCKET_0_US << n)
+    int bucket = 0;
+    if (timeUs >= TASK_HISTOGRAM_BUCKET_0_US) {
+        bucket = MIN(31 - __builtin_clz(timeUs / TASK_HISTOGRAM_BUCKET_0_US) + 1, TASK_HISTOGRAM_BUCKET_COUNT - 1);
+    }
+    if (histogram[bucket] == UINT16_MAX) {
+        for (int ii = 0; ii < TASK_HISTOGRAM_BUCKET_COUNT; ++ii) {
+            histogram[ii] /= 2;
+        }
+    }
+    histogram[bucket]++;
+}
+
+/*
+ * Upper limit of a histogram bucket in us, the last bucket has no upper limit and returns its lower limit
+ */
+timeUs_t getTaskHistogramBucketLimit(int bucket)
+{
+    return TASK_HISTOGRAM_BUCKET_0_US << MIN(bucket, TASK_HISTOGRAM_BUCKET_COUNT - 2);
+}
+
+/*
+ * Returns the upper limit of the bucket that holds the given percentile of the samples, 0 if there are none
+ */
+timeUs_t getTaskHistogramPercentile(const uint16_t *histogram, int percentile)
+{
+    uint32_t sampleCount = 0;
+    for (int ii = 0; ii < TASK_HISTOGRAM_BUCKET_COUNT; ++ii) {
+        sampleCount += histogram[ii];
+    }
+    if (sampleCount == 0) {
+        return 0;
+    }
+    // samples at or below the percentile, rounded up
+    const uint32_t percentileCount = (sampleCount * percentile + 99) / 100;
+    uint32_t count = 0;
+    for (int ii = 0; ii < TASK_HISTOGRAM_BUCKET_COUNT; ++ii) {
+        count += histogram[ii];
+        if (count >= percentileCount) {
+            return getTaskHistogramBucketLimit(ii);
+        }
+    }
+    return getTaskHistogramBucketLimit(TASK_HISTOGRAM_BUCKET_COUNT - 1);
 }
 #endif
 
@@ -159,6 +306,28 @@ void rescheduleTask(cfTaskId_e taskId, uint32_t newPeriodMicros)
     if (taskId == TASK_SELF || taskId < TASK_COUNT) {
         cfTask_t *task = taskId == TASK_SELF ? currentTask : &cfTasks[taskId];
         task->desiredPeriod = MAX(SCHEDULER_DELAY_LIMIT, newPeriodMicros);  // Limit delay to 100us (10 kHz) to prevent scheduler clogging
+#ifdef USE_SCHEDULER_READY_BITMAP
+        // a task that is already ready keeps its place, as its age is worked out afresh on each pass
+        if (dueQueueRemove(task)) {
+            dueQueueInsert(task);
+        }
+#endif
+    }
+}
+
+/*
+ * Moves the next run of a time driven task, the runs after it follow on at its period from there
+ */
+void rescheduleTaskAt(cfTaskId_e taskId, timeUs_t nextExecuteAtUs)
+{
+    if (taskId == TASK_SELF || taskId < TASK_COUNT) {
+        cfTask_t *task = taskId == TASK_SELF ? currentTask : &cfTasks[taskId];
+        task->lastExecutedAt = nextExecuteAtUs - task->desiredPeriod;
+#ifdef USE_SCHEDULER_READY_BITMAP
+        if (dueQueueRemove(task)) {
+            dueQueueInsert(task);
+        }
+#endif
     }
 }
 
@@ -174,6 +343,64 @@ void setTaskEnabled(cfTaskId_e taskId, bool enabled)
     }
 }
 
+void setTaskSignalDriven(cfTaskId_e taskId, bool signalDriven)
+{
+    if (taskId < TASK_COUNT) {
+        cfTasks[taskId].signalDriven = signalDriven;
+    }
+}
+
+/*
+ * Marks a signal driven task as having something to do, so its checkFunc is called on the next pass.
+ * Safe to call from interrupt handlers.
+ */
+void schedulerSignalTask(cfTaskId_e taskId)
+{
+    if (taskId < TASK_COUNT) {
+        ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+            signalledTaskBitmap |= BIT(taskId);
+        }
+    }
+}
+
+static bool taskTakeSignal(const cfTask_t *task)
+{
+    const uint32_t taskBit = BIT(task - cfTasks);
+    bool signalled = false;
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        signalled = (signalledTaskBitmap & taskBit) != 0;
+        signalledTaskBitmap &= ~taskBit;
+    }
+    return signalled;
+}
+
+/*
+ * Time the running task has left before the next realtime task is due, negative if it is already late.
+ * Long running tasks should check this and yield when it runs out, carrying on from where they left off next time.
+ */
+timeDelta_t schedulerGetRemainingBudgetUs(void)
+{
+    return cmpTimeUs(currentTaskBudgetEndsAt, micros());
+}
+
+static void taskBudgetStart(const cfTask_t *selectedTask, timeUs_t currentTimeUs)
+{
+    // without any other realtime task, the budget is the task's own period
+    currentTaskBudgetEndsAt = currentTimeUs + selectedTask->desiredPeriod;
+    for (const cfTask_t *task = queueFirst(); task != NULL && task->staticPriority >= TASK_PRIORITY_REALTIME; task = queueNext()) {
+        const timeUs_t nextExecuteAt = task->lastExecutedAt + task->desiredPeriod;
+        if (task != selectedTask && cmpTimeUs(nextExecuteAt, currentTaskBudgetEndsAt) < 0) {
+            currentTaskBudgetEndsAt = nextExecuteAt;
+        }
+    }
+}
+
+// the task running or the last one to run, TASK_NONE after a pass that found nothing to run
+cfTaskId_e schedulerGetCurrentTaskId(void)
+{
+    return currentTask ? (cfTaskId_e)(currentTask - cfTasks) : TASK_NONE;
+}
+
 uint32_t getTaskDeltaTime(cfTaskId_e taskId)
 {
     if (taskId == TASK_SELF) {
@@ -189,13 +416,96 @@ void schedulerInit(void)
 {
     queueClear();
     queueAdd(&cfTasks[TASK_SYSTEM]);
+#ifdef USE_SCHEDULER_TRACE
+    schedulerTraceInit();
+#endif
+}
+
+/*
+ * Updates the dynamic priority of a task, returns true if it is waiting to be run
+ */
+static bool taskUpdateDynamicPriority(cfTask_t *task, timeUs_t currentTimeUs)
+{
+    // Task has checkFunc - event driven
+    if (task->checkFunc != NULL) {
+        const timeUs_t currentTimeBeforeCheckFuncCall = micros();
+        // Increase priority for event driven tasks
+        if (task->dynamicPriority > 0) {
+            task->taskAgeCycles = 1 + ((currentTimeUs - task->lastSignaledAt) / task->desiredPeriod);
+            task->dynamicPriority = 1 + task->staticPriority * task->taskAgeCycles;
+            return true;
+        } else if (task->signalDriven && !taskTakeSignal(task) && (currentTimeUs - task->lastExecutedAt) < task->desiredPeriod) {
+            // nothing has happened since the task last ran, and it is not yet due for its periodic check
+            task->taskAgeCycles = 0;
+        } else if (task->checkFunc(currentTimeBeforeCheckFuncCall, currentTimeBeforeCheckFuncCall - task->lastExecutedAt)) {
+#if defined(SCHEDULER_DEBUG) || !defined(SKIP_TASK_STATISTICS)
+            const uint32_t checkFuncExecutionTime = micros() - currentTimeBeforeCheckFuncCall;
+#endif
+#if defined(SCHEDULER_DEBUG)
+            DEBUG_SET(DEBUG_SCHEDULER, 3, checkFuncExecutionTime);
+#endif
+#ifndef SKIP_TASK_STATISTICS
+            checkFuncMovingSumExecutionTime += checkFuncExecutionTime - checkFuncMovingSumExecutionTime / MOVING_SUM_COUNT;
+            checkFuncTotalExecutionTime += checkFuncExecutionTime;   // time consumed by scheduler + task
+            checkFuncMaxExecutionTime = MAX(checkFuncMaxExecutionTime, checkFuncExecutionTime);
+#endif
+            task->lastSignaledAt = currentTimeBeforeCheckFuncCall;
+            task->taskAgeCycles = 1;
+            task->dynamicPriority = 1 + task->staticPriority;
+            return true;
+        } else {
+            task->taskAgeCycles = 0;
+        }
+    } else {
+        // Task is time-driven, dynamicPriority is last execution age (measured in desiredPeriods)
+        // Task age is calculated from last execution
+        task->taskAgeCycles = ((currentTimeUs - task->lastExecutedAt) / task->desiredPeriod);
+        if (task->taskAgeCycles > 0) {
+            task->dynamicPriority = 1 + task->staticPriority * task->taskAgeCycles;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * With idle sleep enabled the scheduler waits for the next interrupt instead of making another pass
+ * when nothing is due. This is only safe when an interrupt is guaranteed to arrive before the
+ * realtime task is next due, such as the gyro data ready interrupt.
+ */
+void schedulerSetIdleSleep(bool enabled)
+{
+    idleSleepEnabled = enabled;
 }
 
 void scheduler(void)
 {
     // Cache currentTime
     const timeUs_t currentTimeUs = micros();
+#ifdef USE_POST_MORTEM
+    systemWatchdogKick();
+#endif
 
+    if (idleStartedAt) {
+        idleTimeUs += currentTimeUs - idleStartedAt;
+        idleStartedAt = 0;
+    }
+
+#ifdef USE_SCHEDULER_READY_BITMAP
+    // Move tasks whose period has elapsed to the ready bitmap
+    int dueCount = 0;
+    while (dueCount < dueQueueSize && cmpTimeUs(currentTimeUs, taskNextExecuteAt(dueQueue[dueCount])) >= 0) {
+        readyTaskBitmap |= BIT(taskQueuePosition[dueQueue[dueCount] - cfTasks]);
+        ++dueCount;
+    }
+    if (dueCount > 0) {
+        dueQueueSize -= dueCount;
+        memmove(&dueQueue[0], &dueQueue[dueCount], sizeof(dueQueue[0]) * dueQueueSize);
+    }
+
+    // Check for realtime tasks
+    const bool outsideRealtimeGuardInterval = !(readyTaskBitmap & realtimeTaskBitmap);
+#else
     // Check for realtime tasks
     timeUs_t timeToNextRealtimeTask = TIMEUS_MAX;
     for (const cfTask_t *task = queueFirst(); task != NULL && task->staticPriority >= TASK_PRIORITY_REALTIME; task = queueNext()) {
@@ -208,6 +518,7 @@ void scheduler(void)
         }
     }
     const bool outsideRealtimeGuardInterval = (timeToNextRealtimeTask > 0);
+#endif
 
     // The task to be invoked
     cfTask_t *selectedTask = NULL;
@@ -215,42 +526,15 @@ void scheduler(void)
 
     // Update task dynamic priorities
     uint16_t waitingTasks = 0;
+#ifdef USE_SCHEDULER_READY_BITMAP
+    // tasks that are not yet due have a dynamicPriority of zero, so there is nothing to evaluate for them
+    for (uint32_t pending = readyTaskBitmap | eventTaskBitmap; pending; pending &= pending - 1) {
+        cfTask_t *task = taskQueueArray[__builtin_ctz(pending)];
+#else
     for (cfTask_t *task = queueFirst(); task != NULL; task = queueNext()) {
-        // Task has checkFunc - event driven
-        if (task->checkFunc != NULL) {
-            const timeUs_t currentTimeBeforeCheckFuncCall = micros();
-            // Increase priority for event driven tasks
-            if (task->dynamicPriority > 0) {
-                task->taskAgeCycles = 1 + ((currentTimeUs - task->lastSignaledAt) / task->desiredPeriod);
-                task->dynamicPriority = 1 + task->staticPriority * task->taskAgeCycles;
-                waitingTasks++;
-            } else if (task->checkFunc(currentTimeBeforeCheckFuncCall, currentTimeBeforeCheckFuncCall - task->lastExecutedAt)) {
-#if defined(SCHEDULER_DEBUG) || !defined(SKIP_TASK_STATISTICS)
-                const uint32_t checkFuncExecutionTime = micros() - currentTimeBeforeCheckFuncCall;
-#endif
-#if defined(SCHEDULER_DEBUG)
-                DEBUG_SET(DEBUG_SCHEDULER, 3, checkFuncExecutionTime);
 #endif
-#ifndef SKIP_TASK_STATISTICS
-                checkFuncMovingSumExecutionTime += checkFuncExecutionTime - checkFuncMovingSumExecutionTime / MOVING_SUM_COUNT;
-                checkFuncTotalExecutionTime += checkFuncExecutionTime;   // time consumed by scheduler + task
-                checkFuncMaxExecutionTime = MAX(checkFuncMaxExecutionTime, checkFuncExecutionTime);
-#endif
-                task->lastSignaledAt = currentTimeBeforeCheckFuncCall;
-                task->taskAgeCycles = 1;
-                task->dynamicPriority = 1 + task->staticPriority;
-                waitingTasks++;
-            } else {
-                task->taskAgeCycles = 0;
-            }
-        } else {
-            // Task is time-driven, dynamicPriority is last execution age (measured in desiredPeriods)
-            // Task age is calculated from last execution
-            task->taskAgeCycles = ((currentTimeUs - task->lastExecutedAt) / task->desiredPeriod);
-            if (task->taskAgeCycles > 0) {
-                task->dynamicPriority = 1 + task->staticPriority * task->taskAgeCycles;
-                waitingTasks++;
-            }
+        if (taskUpdateDynamicPriority(task, currentTimeUs)) {
+            waitingTasks++;
         }
 
         if (task->dynamicPriority > selectedTaskDynamicPriority) {
@@ -272,24 +556,63 @@ void scheduler(void)
 
     if (selectedTask != NULL) {
         // Found a task that should be run
+#ifndef SKIP_TASK_STATISTICS
+        if (selectedTask->lastExecutedAt != 0) {
+            const timeUs_t readyAt = selectedTask->checkFunc ? selectedTask->lastSignaledAt : selectedTask->lastExecutedAt + selectedTask->desiredPeriod;
+            const timeDelta_t lateness = MAX(cmpTimeUs(currentTimeUs, readyAt), 0);
+            taskHistogramAdd(selectedTask->latenessHistogram, lateness);
+            if ((timeUs_t)lateness >= selectedTask->desiredPeriod) {
+                selectedTask->deadlineMissCount++;
+#ifdef USE_SCHEDULER_TRACE
+                if (selectedTask->staticPriority == TASK_PRIORITY_REALTIME) {
+                    schedulerTraceTrigger();
+                }
+#endif
+            }
+        }
+#endif
         selectedTask->taskLatestDeltaTime = currentTimeUs - selectedTask->lastExecutedAt;
         selectedTask->lastExecutedAt = currentTimeUs;
         selectedTask->dynamicPriority = 0;
+#ifdef USE_SCHEDULER_READY_BITMAP
+        const uint32_t selectedTaskBit = BIT(taskQueuePosition[selectedTask - cfTasks]);
+        if (readyTaskBitmap & selectedTaskBit) {
+            readyTaskBitmap &= ~selectedTaskBit;
+        } else {
+            // event driven task run before its period elapsed
+            dueQueueRemove(selectedTask);
+        }
+        dueQueueInsert(selectedTask);
+#endif
+
+        taskBudgetStart(selectedTask, currentTimeUs);
 
         // Execute task
         const timeUs_t currentTimeBeforeTaskCall = micros();
+        SCHEDULER_TRACE(SCHEDULER_TRACE_TASK_START, selectedTask - cfTasks);
         selectedTask->taskFunc(currentTimeBeforeTaskCall);
+        SCHEDULER_TRACE(SCHEDULER_TRACE_TASK_END, selectedTask - cfTasks);
 
 #ifndef SKIP_TASK_STATISTICS
         const timeUs_t taskExecutionTime = micros() - currentTimeBeforeTaskCall;
         selectedTask->movingSumExecutionTime += taskExecutionTime - selectedTask->movingSumExecutionTime / MOVING_SUM_COUNT;
         selectedTask->totalExecutionTime += taskExecutionTime;   // time consumed by scheduler + task
         selectedTask->maxExecutionTime = MAX(selectedTask->maxExecutionTime, taskExecutionTime);
+        taskHistogramAdd(selectedTask->executionTimeHistogram, taskExecutionTime);
 #endif
 #if defined(SCHEDULER_DEBUG)
         DEBUG_SET(DEBUG_SCHEDULER, 2, micros() - currentTimeUs - taskExecutionTime); // time spent in scheduler
+#endif
     } else {
+#if defined(SCHEDULER_DEBUG)
         DEBUG_SET(DEBUG_SCHEDULER, 2, micros() - currentTimeUs);
+#endif
+        // the whole pass counts as idle, up until the next pass starts
+        idleStartedAt = currentTimeUs ? currentTimeUs : 1;
+#ifndef UNIT_TEST
+        if (idleSleepEnabled && outsideRealtimeGuardInterval) {
+            __WFI();
+        }
 #endif
     }
 }
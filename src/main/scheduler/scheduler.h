@@ -28,6 +28,11 @@ typedef enum {
     TASK_PRIORITY_MAX = 255
 } cfTaskPriority_e;
 
+// Task time histograms, bucket 0 counts times below 8us and bucket n times below (8us << n), the last bucket is open ended.
+// All buckets are halved when one fills up, so the counts are relative but the percentiles hold.
+#define TASK_HISTOGRAM_BUCKET_COUNT 8
+#define TASK_HISTOGRAM_BUCKET_0_US  8
+
 typedef struct {
     timeUs_t     maxExecutionTime;
     timeUs_t     totalExecutionTime;
@@ -44,6 +49,9 @@ typedef struct {
     timeUs_t     totalExecutionTime;
     timeUs_t     averageExecutionTime;
     timeUs_t     latestDeltaTime;
+    const uint16_t *executionTimeHistogram;
+    const uint16_t *latenessHistogram;
+    uint32_t     deadlineMissCount;
 } cfTaskInfo_t;
 
 typedef enum {
@@ -53,8 +61,10 @@ typedef enum {
     TASK_ACCEL,
     TASK_ATTITUDE,
     TASK_RX,
+    TASK_RC_COMMAND,
     TASK_SERIAL,
     TASK_BATTERY,
+    TASK_CONFIG_SAVE,
 #ifdef BEEPER
     TASK_BEEPER,
 #endif
@@ -100,9 +110,24 @@ typedef enum {
 #ifdef CMS
     TASK_CMS,
 #endif
-#ifdef VTX_CONTROL
+#if defined(VTX_CONTROL) || defined(USE_RTC6705)
     TASK_VTXCTRL,
 #endif
+#ifdef USE_SERVOS
+    TASK_SERVOS,
+#endif
+#ifdef USE_BLACKBOX_COMPRESSION
+    TASK_BLACKBOX_COMPRESS,
+#endif
+#ifdef USE_FLASHFS
+    TASK_FLASHFS,
+#endif
+#ifdef BLACKBOX
+    TASK_BLACKBOX,
+#endif
+#ifdef USE_SDCARD
+    TASK_SDCARD,
+#endif
 
     /* Count of real tasks */
     TASK_COUNT,
@@ -120,6 +145,7 @@ typedef struct {
     void (*taskFunc)(timeUs_t currentTimeUs);
     uint32_t desiredPeriod;         // target period of execution
     const uint8_t staticPriority;   // dynamicPriority grows in steps of this size, shouldn't be zero
+    bool signalDriven;              // checkFunc is only called once the task is signalled or desiredPeriod has elapsed
 
     /* Scheduling */
     uint16_t dynamicPriority;       // measurement of how old task was last executed, used to avoid task starvation
@@ -133,17 +159,30 @@ typedef struct {
     timeUs_t movingSumExecutionTime;  // moving sum over 32 samples
     timeUs_t maxExecutionTime;
     timeUs_t totalExecutionTime;    // total time consumed by task since boot
+    uint16_t executionTimeHistogram[TASK_HISTOGRAM_BUCKET_COUNT];
+    uint16_t latenessHistogram[TASK_HISTOGRAM_BUCKET_COUNT];   // start time after the period elapsed, or after the task was signalled
+    uint32_t deadlineMissCount;     // times the task started a whole desiredPeriod or more late
 #endif
 } cfTask_t;
 
 extern cfTask_t cfTasks[TASK_COUNT];
 extern uint16_t averageSystemLoadPercent;
+extern uint16_t cpuUtilisationPercent;
 
 void getCheckFuncInfo(cfCheckFuncInfo_t *checkFuncInfo);
 void getTaskInfo(cfTaskId_e taskId, cfTaskInfo_t *taskInfo);
+void taskHistogramAdd(uint16_t *histogram, timeUs_t timeUs);
+timeUs_t getTaskHistogramBucketLimit(int bucket);
+timeUs_t getTaskHistogramPercentile(const uint16_t *histogram, int percentile);
 void rescheduleTask(cfTaskId_e taskId, uint32_t newPeriodMicros);
+void rescheduleTaskAt(cfTaskId_e taskId, timeUs_t nextExecuteAtUs);
 void setTaskEnabled(cfTaskId_e taskId, bool newEnabledState);
+void setTaskSignalDriven(cfTaskId_e taskId, bool signalDriven);
+void schedulerSignalTask(cfTaskId_e taskId);
+timeDelta_t schedulerGetRemainingBudgetUs(void);
+void schedulerSetIdleSleep(bool enabled);
 uint32_t getTaskDeltaTime(cfTaskId_e taskId);
+cfTaskId_e schedulerGetCurrentTaskId(void);
 
 void schedulerInit(void);
 void scheduler(void);
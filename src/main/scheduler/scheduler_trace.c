@@ -0,0 +1,89 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#ifdef USE_SCHEDULER_TRACE
+
+#include "build/atomic.h"
+
+#include "drivers/nvic.h"
+
+#include "scheduler/scheduler_trace.h"
+
+schedulerTraceEvent_t schedulerTraceBuffer[SCHEDULER_TRACE_SIZE];
+uint32_t schedulerTraceHead;
+volatile uint32_t schedulerTraceRemaining;
+
+void schedulerTraceInit(void)
+{
+    // the cycle counter used for the timestamps is started by cycleCounterInit()
+    schedulerTraceArm();
+}
+
+void schedulerTraceArm(void)
+{
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        schedulerTraceHead = 0;
+        schedulerTraceRemaining = SCHEDULER_TRACE_FREE_RUNNING;
+    }
+}
+
+/*
+ * Keeps recording for half a buffer, then stops so the buffer holds the events
+ * either side of the trigger. Further triggers are ignored until re-armed.
+ */
+void schedulerTraceTrigger(void)
+{
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        if (schedulerTraceRemaining == SCHEDULER_TRACE_FREE_RUNNING) {
+            schedulerTraceRemaining = SCHEDULER_TRACE_SIZE / 2;
+        }
+    }
+}
+
+schedulerTraceState_e schedulerTraceGetState(void)
+{
+    if (schedulerTraceRemaining == SCHEDULER_TRACE_FREE_RUNNING) {
+        return SCHEDULER_TRACE_RUNNING;
+    }
+    return schedulerTraceRemaining ? SCHEDULER_TRACE_TRIGGERED : SCHEDULER_TRACE_FROZEN;
+}
+
+uint32_t schedulerTraceGetCyclesPerMicrosecond(void)
+{
+    return SystemCoreClock / 1000000;
+}
+
+int schedulerTraceGetEventCount(void)
+{
+    return schedulerTraceHead < SCHEDULER_TRACE_SIZE ? (int)schedulerTraceHead : SCHEDULER_TRACE_SIZE;
+}
+
+/*
+ * Index 0 is the oldest event still in the buffer
+ */
+const schedulerTraceEvent_t *schedulerTraceGetEvent(int index)
+{
+    const uint32_t oldest = schedulerTraceHead - schedulerTraceGetEventCount();
+    return &schedulerTraceBuffer[(oldest + index) & (SCHEDULER_TRACE_SIZE - 1)];
+}
+
+#endif
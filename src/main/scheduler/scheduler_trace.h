@@ -0,0 +1,88 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+typedef enum {
+    SCHEDULER_TRACE_TASK_START = 0,         // id is the cfTaskId_e
+    SCHEDULER_TRACE_TASK_END,
+    SCHEDULER_TRACE_ISR_ENTER,              // id is the schedulerTraceIsr_e
+    SCHEDULER_TRACE_ISR_EXIT
+} schedulerTraceEventType_e;
+
+typedef enum {
+    SCHEDULER_TRACE_ISR_GYRO_EXTI = 0,
+    SCHEDULER_TRACE_ISR_GYRO_DMA,
+    SCHEDULER_TRACE_ISR_PID_LOOP
+} schedulerTraceIsr_e;
+
+typedef enum {
+    SCHEDULER_TRACE_RUNNING = 0,            // recording, the oldest events are overwritten
+    SCHEDULER_TRACE_TRIGGERED,              // recording the second half of the buffer after a trigger
+    SCHEDULER_TRACE_FROZEN                  // buffer holds the events around the trigger
+} schedulerTraceState_e;
+
+typedef struct schedulerTraceEvent_s {
+    uint32_t cycles;                        // DWT cycle counter
+    uint8_t type;
+    uint8_t id;
+} schedulerTraceEvent_t;
+
+#ifdef USE_SCHEDULER_TRACE
+
+#ifndef SCHEDULER_TRACE_SIZE
+#define SCHEDULER_TRACE_SIZE 1024           // must be a power of two
+#endif
+
+#define SCHEDULER_TRACE_FREE_RUNNING UINT32_MAX
+
+extern schedulerTraceEvent_t schedulerTraceBuffer[SCHEDULER_TRACE_SIZE];
+extern uint32_t schedulerTraceHead;
+extern volatile uint32_t schedulerTraceRemaining;
+
+// Kept inline so an event costs a load, a couple of stores and the interrupt mask
+static inline void schedulerTraceRecord(uint8_t type, uint8_t id)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (schedulerTraceRemaining) {
+        if (schedulerTraceRemaining != SCHEDULER_TRACE_FREE_RUNNING) {
+            schedulerTraceRemaining--;
+        }
+        schedulerTraceEvent_t *event = &schedulerTraceBuffer[schedulerTraceHead++ & (SCHEDULER_TRACE_SIZE - 1)];
+        event->cycles = DWT->CYCCNT;
+        event->type = type;
+        event->id = id;
+    }
+    __set_PRIMASK(primask);
+}
+
+#define SCHEDULER_TRACE(type, id) schedulerTraceRecord((type), (id))
+
+void schedulerTraceInit(void);
+void schedulerTraceArm(void);
+void schedulerTraceTrigger(void);
+schedulerTraceState_e schedulerTraceGetState(void);
+uint32_t schedulerTraceGetCyclesPerMicrosecond(void);
+int schedulerTraceGetEventCount(void);
+const schedulerTraceEvent_t *schedulerTraceGetEvent(int index);
+
+#else
+
+#define SCHEDULER_TRACE(type, id) do {} while (0)
+
+#endif
@@ -76,6 +76,7 @@ static flightDynamicsTrims_t *accelerationTrims;
 
 static uint16_t accLpfCutHz = 0;
 static biquadFilter_t accFilter[XYZ_AXIS_COUNT];
+static sensorAlignment_t accAlignment;
 
 bool accDetect(accDev_t *dev, accelerationSensor_e accHardwareToUse)
 {
@@ -237,6 +238,10 @@ bool accInit(const accelerometerConfig_t *accelerometerConfig, uint32_t gyroSamp
     if (!accDetect(&acc.dev, accelerometerConfig->acc_hardware)) {
         return false;
     }
+    if (accelerometerConfig->acc_align != ALIGN_DEFAULT) {
+        acc.dev.accAlign = accelerometerConfig->acc_align;
+    }
+    sensorAlignmentInit(&accAlignment, acc.dev.accAlign, 1.0f);
     acc.dev.acc_1G = 256; // set default
     acc.dev.init(&acc.dev); // driver initialisation
     // set the acc sampling interval according to the gyro sampling interval
@@ -399,7 +404,7 @@ void accUpdate(rollAndPitchTrims_t *rollAndPitchTrims)
         }
     }
 
-    alignSensors(acc.accSmooth, acc.dev.accAlign);
+    sensorAlignmentApplyInt(&accAlignment, acc.accSmooth);
 
     if (!isAccelerationCalibrationComplete()) {
         performAcclerationCalibration(rollAndPitchTrims);
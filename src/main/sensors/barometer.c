@@ -135,27 +135,18 @@ void baroSetCalibrationCycles(uint16_t calibrationCyclesRequired)
 }
 
 static bool baroReady = false;
+static uint32_t baroSampleCount = 0;
 
 #define PRESSURE_SAMPLES_MEDIAN 3
 
+static slidingWindow_t barometerMedianWindow = { .size = PRESSURE_SAMPLES_MEDIAN };
+
 static int32_t applyBarometerMedianFilter(int32_t newPressureReading)
 {
-    static int32_t barometerFilterSamples[PRESSURE_SAMPLES_MEDIAN];
-    static int currentFilterSampleIndex = 0;
-    static bool medianFilterReady = false;
-    int nextSampleIndex;
-
-    nextSampleIndex = (currentFilterSampleIndex + 1);
-    if (nextSampleIndex == PRESSURE_SAMPLES_MEDIAN) {
-        nextSampleIndex = 0;
-        medianFilterReady = true;
-    }
-
-    barometerFilterSamples[currentFilterSampleIndex] = newPressureReading;
-    currentFilterSampleIndex = nextSampleIndex;
+    slidingWindowPush(&barometerMedianWindow, newPressureReading);
 
-    if (medianFilterReady)
-        return quickMedianFilter3(barometerFilterSamples);
+    if (slidingWindowIsFull(&barometerMedianWindow))
+        return slidingWindowMedian(&barometerMedianWindow);
     else
         return newPressureReading;
 }
@@ -196,6 +187,14 @@ bool isBaroReady(void) {
     return baroReady;
 }
 
+/*
+ * The number of pressure readings taken so far, a change tells the altitude estimator a new reading has arrived.
+ */
+uint32_t baroGetSampleCount(void)
+{
+    return baroSampleCount;
+}
+
 uint32_t baroUpdate(void)
 {
     static barometerState_e state = BAROMETER_NEEDS_SAMPLES;
@@ -214,6 +213,7 @@ uint32_t baroUpdate(void)
             baro.dev.start_ut();
             baro.dev.calculate(&baroPressure, &baroTemperature);
             baroPressureSum = recalculateBarometerTotal(barometerConfig->baro_sample_count, baroPressureSum, baroPressure);
+            baroSampleCount++;
             state = BAROMETER_NEEDS_SAMPLES;
             return baro.dev.ut_delay;
         break;
@@ -51,5 +51,6 @@ bool isBaroCalibrationComplete(void);
 void baroSetCalibrationCycles(uint16_t calibrationCyclesRequired);
 uint32_t baroUpdate(void);
 bool isBaroReady(void);
+uint32_t baroGetSampleCount(void);
 int32_t baroCalculateAltitude(void);
 void performBaroCalibrationCycle(void);
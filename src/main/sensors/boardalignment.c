@@ -22,6 +22,7 @@
 
 #include "common/maths.h"
 #include "common/axis.h"
+#include "common/utils.h"
 
 #include "drivers/sensor.h"
 
@@ -51,67 +52,69 @@ void initBoardAlignment(const boardAlignment_t *boardAlignment)
     buildRotationMatrix(&rotationAngles, boardRotation);
 }
 
-static void alignBoard(int32_t *vec)
+// rows give the sensor axes summed into each body axis, indexed by the sensor_align_e value
+static const int8_t sensorRotations[CW270_DEG_FLIP + 1][3][3] = {
+    [ALIGN_DEFAULT]  = { {  1,  0,  0 }, {  0,  1,  0 }, {  0,  0,  1 } },
+    [CW0_DEG]        = { {  1,  0,  0 }, {  0,  1,  0 }, {  0,  0,  1 } },
+    [CW90_DEG]       = { {  0,  1,  0 }, { -1,  0,  0 }, {  0,  0,  1 } },
+    [CW180_DEG]      = { { -1,  0,  0 }, {  0, -1,  0 }, {  0,  0,  1 } },
+    [CW270_DEG]      = { {  0, -1,  0 }, {  1,  0,  0 }, {  0,  0,  1 } },
+    [CW0_DEG_FLIP]   = { { -1,  0,  0 }, {  0,  1,  0 }, {  0,  0, -1 } },
+    [CW90_DEG_FLIP]  = { {  0,  1,  0 }, {  1,  0,  0 }, {  0,  0, -1 } },
+    [CW180_DEG_FLIP] = { {  1,  0,  0 }, {  0, -1,  0 }, {  0,  0, -1 } },
+    [CW270_DEG_FLIP] = { {  0, -1,  0 }, { -1,  0,  0 }, {  0,  0, -1 } },
+};
+
+/*
+ * Folds the sensor orientation, the board alignment and a scale factor into one matrix, so a sample is taken
+ * from sensor counts to the body frame with nine multiplies. Must be called after initBoardAlignment().
+ */
+void sensorAlignmentInit(sensorAlignment_t *alignment, uint8_t rotation, float scale)
 {
-    int32_t x = vec[X];
-    int32_t y = vec[Y];
-    int32_t z = vec[Z];
+    const int8_t (*sensorRotation)[3] = sensorRotations[rotation < ARRAYLEN(sensorRotations) ? rotation : CW0_DEG];
 
-    vec[X] = lrintf(boardRotation[0][X] * x + boardRotation[1][X] * y + boardRotation[2][X] * z);
-    vec[Y] = lrintf(boardRotation[0][Y] * x + boardRotation[1][Y] * y + boardRotation[2][Y] * z);
-    vec[Z] = lrintf(boardRotation[0][Z] * x + boardRotation[1][Z] * y + boardRotation[2][Z] * z);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            float sum = 0.0f;
+            if (standardBoardAlignment) {
+                sum = sensorRotation[i][j];
+            } else {
+                // the board rotation is applied transposed, as a body to earth rotation
+                for (int k = 0; k < 3; k++) {
+                    sum += boardRotation[k][i] * sensorRotation[k][j];
+                }
+            }
+            alignment->m[i][j] = sum * scale;
+        }
+    }
 }
 
-void alignSensors(int32_t *dest, uint8_t rotation)
+void sensorAlignmentApply(const sensorAlignment_t *alignment, const int32_t *src, float *dest)
 {
-    const int32_t x = dest[X];
-    const int32_t y = dest[Y];
-    const int32_t z = dest[Z];
-
-    switch (rotation) {
-    default:
-    case CW0_DEG:
-        dest[X] = x;
-        dest[Y] = y;
-        dest[Z] = z;
-        break;
-    case CW90_DEG:
-        dest[X] = y;
-        dest[Y] = -x;
-        dest[Z] = z;
-        break;
-    case CW180_DEG:
-        dest[X] = -x;
-        dest[Y] = -y;
-        dest[Z] = z;
-        break;
-    case CW270_DEG:
-        dest[X] = -y;
-        dest[Y] = x;
-        dest[Z] = z;
-        break;
-    case CW0_DEG_FLIP:
-        dest[X] = -x;
-        dest[Y] = y;
-        dest[Z] = -z;
-        break;
-    case CW90_DEG_FLIP:
-        dest[X] = y;
-        dest[Y] = x;
-        dest[Z] = -z;
-        break;
-    case CW180_DEG_FLIP:
-        dest[X] = x;
-        dest[Y] = -y;
-        dest[Z] = -z;
-        break;
-    case CW270_DEG_FLIP:
-        dest[X] = -y;
-        dest[Y] = -x;
-        dest[Z] = -z;
-        break;
-    }
+    const float x = src[X];
+    const float y = src[Y];
+    const float z = src[Z];
+
+    dest[X] = alignment->m[X][X] * x + alignment->m[X][Y] * y + alignment->m[X][Z] * z;
+    dest[Y] = alignment->m[Y][X] * x + alignment->m[Y][Y] * y + alignment->m[Y][Z] * z;
+    dest[Z] = alignment->m[Z][X] * x + alignment->m[Z][Y] * y + alignment->m[Z][Z] * z;
+}
+
+// rounds the aligned sample back to counts in place, for the sensors that stay in integers
+void sensorAlignmentApplyInt(const sensorAlignment_t *alignment, int32_t *vec)
+{
+    float aligned[XYZ_AXIS_COUNT];
+    sensorAlignmentApply(alignment, vec, aligned);
 
-    if (!standardBoardAlignment)
-        alignBoard(dest);
+    vec[X] = lrintf(aligned[X]);
+    vec[Y] = lrintf(aligned[Y]);
+    vec[Z] = lrintf(aligned[Z]);
+}
+
+// one-off alignment of a sample, the sensor read paths keep an initialised sensorAlignment_t instead
+void alignSensors(int32_t *dest, uint8_t rotation)
+{
+    sensorAlignment_t alignment;
+    sensorAlignmentInit(&alignment, rotation, 1.0f);
+    sensorAlignmentApplyInt(&alignment, dest);
 }
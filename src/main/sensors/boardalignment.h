@@ -23,5 +23,14 @@ typedef struct boardAlignment_s {
     int32_t yawDegrees;
 } boardAlignment_t;
 
+// sensor orientation, board alignment and scale combined, body = m * sensor
+typedef struct sensorAlignment_s {
+    float m[3][3];
+} sensorAlignment_t;
+
+void sensorAlignmentInit(sensorAlignment_t *alignment, uint8_t rotation, float scale);
+void sensorAlignmentApply(const sensorAlignment_t *alignment, const int32_t *src, float *dest);
+void sensorAlignmentApplyInt(const sensorAlignment_t *alignment, int32_t *vec);
+
 void alignSensors(int32_t *dest, uint8_t rotation);
 void initBoardAlignment(const boardAlignment_t *boardAlignment);
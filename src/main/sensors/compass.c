@@ -47,6 +47,7 @@ mag_t mag;                   // mag access functions
 
 static int16_t magADCRaw[XYZ_AXIS_COUNT];
 static uint8_t magInit = 0;
+static sensorAlignment_t magAlignment;
 
 bool compassDetect(magDev_t *dev, magSensor_e magHardwareToUse)
 {
@@ -150,6 +151,10 @@ void compassInit(const compassConfig_t *compassConfig)
     const int16_t deg = compassConfig->mag_declination / 100;
     const int16_t min = compassConfig->mag_declination % 100;
     mag.magneticDeclination = (deg + ((float)min * (1.0f / 60.0f))) * 10; // heading is in 0.1deg units
+    if (compassConfig->mag_align != ALIGN_DEFAULT) {
+        mag.dev.magAlign = compassConfig->mag_align;
+    }
+    sensorAlignmentInit(&magAlignment, mag.dev.magAlign, 1.0f);
     LED1_ON;
     mag.dev.init();
     LED1_OFF;
@@ -166,7 +171,7 @@ void compassUpdate(uint32_t currentTime, flightDynamicsTrims_t *magZero)
     for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
         mag.magADC[axis] = magADCRaw[axis];
     }
-    alignSensors(mag.magADC, mag.dev.magAlign);
+    sensorAlignmentApplyInt(&magAlignment, mag.magADC);
 
     if (STATE(CALIBRATE_MAG)) {
         tCal = currentTime;
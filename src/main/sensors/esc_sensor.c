@@ -25,6 +25,7 @@
 #include "config/feature.h"
 #include "config/config_master.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 
 #include "drivers/system.h"
@@ -79,7 +80,8 @@ enum {
 
 typedef enum {
     ESC_SENSOR_FRAME_PENDING = 1 << 0,     // 1
-    ESC_SENSOR_FRAME_COMPLETE = 1 << 1     // 2
+    ESC_SENSOR_FRAME_COMPLETE = 1 << 1,    // 2
+    ESC_SENSOR_FRAME_FAILED = 1 << 2       // 4
 } escTlmFrameState_t;
 
 typedef enum {
@@ -90,27 +92,34 @@ typedef enum {
 
 #define ESC_SENSOR_BAUDRATE 115200
 #define ESC_SENSOR_BUFFSIZE 10
+#define ESC_SENSOR_MAX_PORTS 4
 #define ESC_BOOTTIME 5000               // 5 seconds
 #define ESC_REQUEST_TIMEOUT 100         // 100 ms (data transfer takes only 900us)
+#define ESC_RESPONSE_TIMEOUT 10000      // 10 seconds without a valid frame closes the port
 
-static bool tlmFrameDone = false;
-static uint8_t tlm[ESC_SENSOR_BUFFSIZE] = { 0, };
-static uint8_t tlmFramePosition = 0;
-static serialPort_t *escSensorPort = NULL;
+/*
+ * Every ESC telemetry port polls its own share of the motors, port n serves motors n, n + ports, n + 2 * ports...
+ * so the ports run in parallel and each motor is refreshed ports times as often as with a single wire.
+ * Bytes are left in the UART receive buffer, DMA backed on targets that have it, and drained by the task.
+ */
+typedef struct escSensorPort_s {
+    serialPort_t *port;
+    escSensorTriggerState_t triggerState;
+    uint8_t motor;                      // motor currently polled on this port
+    uint8_t frame[ESC_SENSOR_BUFFSIZE];
+    uint8_t framePosition;
+    uint8_t timeoutRetryCount;
+    timeMs_t triggerTimestamp;
+    timeMs_t lastResponseTimestamp;
+} escSensorPort_t;
+
+static escSensorPort_t escSensorPorts[ESC_SENSOR_MAX_PORTS];
+static uint8_t escSensorPortCount = 0;
 static escSensorData_t escSensorData[MAX_SUPPORTED_MOTORS];
-static uint32_t escTriggerTimestamp = -1;
-static uint32_t escLastResponseTimestamp;
-static uint8_t timeoutRetryCount = 0;
 static uint8_t totalRetryCount = 0;
 
-static uint8_t escSensorMotor = 0;      // motor index
 static bool escSensorEnabled = false;
-static escSensorTriggerState_t escSensorTriggerState = ESC_SENSOR_TRIGGER_WAIT;
-
-static void escSensorDataReceive(uint16_t c);
-static uint8_t update_crc8(uint8_t crc, uint8_t crc_seed);
-static uint8_t get_crc8(uint8_t *Buf, uint8_t BufLen);
-static void selectNextMotor(void);
+static bool escSensorStarted = false;
 
 bool isEscSensorActive(void)
 {
@@ -159,177 +168,171 @@ escSensorData_t getEscSensorData(uint8_t motorNumber)
 
 static void resetEscSensorData(void)
 {
-    for (int i; i < MAX_SUPPORTED_MOTORS; i = i + 1) {
+    for (int i = 0; i < MAX_SUPPORTED_MOTORS; i = i + 1) {
         escSensorData[i].stale = true;
     }
 }
 
 bool escSensorInit(void)
 {
-    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_ESC_SENSOR);
-    if (!portConfig) {
-        return false;
-    }
-
     portOptions_t options = (SERIAL_NOT_INVERTED);
 
-    // Initialize serial port
-    escSensorPort = openSerialPort(portConfig->identifier, FUNCTION_ESC_SENSOR, escSensorDataReceive, ESC_SENSOR_BAUDRATE, MODE_RX, options);
-
-    if (escSensorPort) {
-        escSensorEnabled = true;
+    escSensorPortCount = 0;
+    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_ESC_SENSOR);
+    while (portConfig && escSensorPortCount < ESC_SENSOR_MAX_PORTS) {
+        // No receive callback, frames are read from the port buffer by escSensorProcess()
+        serialPort_t *port = openSerialPort(portConfig->identifier, FUNCTION_ESC_SENSOR, NULL, ESC_SENSOR_BAUDRATE, MODE_RX, options);
+        if (port) {
+            escSensorPort_t *escPort = &escSensorPorts[escSensorPortCount++];
+            escPort->port = port;
+            escPort->motor = escSensorPortCount - 1;
+            escPort->triggerState = ESC_SENSOR_TRIGGER_WAIT;
+        }
+        portConfig = findNextSerialPortConfig(FUNCTION_ESC_SENSOR);
     }
 
+    escSensorEnabled = escSensorPortCount > 0;
+
     resetEscSensorData();
 
-    return escSensorPort != NULL;
+    return escSensorEnabled;
 }
 
-static void freeEscSensorPort(void)
+static void freeEscSensorPort(escSensorPort_t *escPort)
 {
-    closeSerialPort(escSensorPort);
-    escSensorPort = NULL;
+    closeSerialPort(escPort->port);
+    escPort->port = NULL;
+
+    for (int i = escPort - escSensorPorts; i < MAX_SUPPORTED_MOTORS; i += escSensorPortCount) {
+        escSensorData[i].stale = true;
+    }
+
     escSensorEnabled = false;
+    for (int i = 0; i < escSensorPortCount; i++) {
+        escSensorEnabled |= escSensorPorts[i].port != NULL;
+    }
 }
 
-// Receive ISR callback
-static void escSensorDataReceive(uint16_t c)
+static void discardStaleBytes(escSensorPort_t *escPort)
 {
-    // KISS ESC sends some data during startup, ignore this for now (maybe future use)
+    // KISS ESC sends some data during startup, and a late frame may still be arriving, drop both
     // startup data could be firmware version and serialnumber
-
-    if (escSensorTriggerState == ESC_SENSOR_TRIGGER_WAIT) return;
-
-    tlm[tlmFramePosition] = (uint8_t)c;
-
-    if (tlmFramePosition == ESC_SENSOR_BUFFSIZE - 1) {
-        tlmFrameDone = true;
-        tlmFramePosition = 0;
-    } else {
-        tlmFramePosition++;
+    while (serialRxBytesWaiting(escPort->port)) {
+        serialRead(escPort->port);
     }
+    escPort->framePosition = 0;
 }
 
-static uint8_t escSensorFrameStatus(void)
+static uint8_t escSensorFrameStatus(escSensorPort_t *escPort)
 {
-    uint8_t frameStatus = ESC_SENSOR_FRAME_PENDING;
-    uint16_t chksum, tlmsum;
-
-    if (!tlmFrameDone) {
-        return frameStatus;
+    while (escPort->framePosition < ESC_SENSOR_BUFFSIZE && serialRxBytesWaiting(escPort->port)) {
+        escPort->frame[escPort->framePosition++] = serialRead(escPort->port);
     }
 
-    tlmFrameDone = false;
-
-    // Get CRC8 checksum
-    chksum = get_crc8(tlm, ESC_SENSOR_BUFFSIZE - 1);
-    tlmsum = tlm[ESC_SENSOR_BUFFSIZE - 1];     // last byte contains CRC value
+    if (escPort->framePosition < ESC_SENSOR_BUFFSIZE) {
+        return ESC_SENSOR_FRAME_PENDING;
+    }
 
-    if (chksum == tlmsum) {
-        escSensorData[escSensorMotor].stale = false;
-        escSensorData[escSensorMotor].temperature = tlm[0];
-        escSensorData[escSensorMotor].voltage = tlm[1] << 8 | tlm[2];
-        escSensorData[escSensorMotor].current = tlm[3] << 8 | tlm[4];
-        escSensorData[escSensorMotor].consumption = tlm[5] << 8 | tlm[6];
-        escSensorData[escSensorMotor].rpm = tlm[7] << 8 | tlm[8];
+    const uint8_t *tlm = escPort->frame;
 
-        frameStatus = ESC_SENSOR_FRAME_COMPLETE;
+    // last byte contains CRC value
+    if (crc8_poly_0x07_buf(0, tlm, ESC_SENSOR_BUFFSIZE - 1) != tlm[ESC_SENSOR_BUFFSIZE - 1]) {
+        return ESC_SENSOR_FRAME_FAILED;
     }
 
-    return frameStatus;
+    escSensorData_t *data = &escSensorData[escPort->motor];
+    data->stale = false;
+    data->temperature = tlm[0];
+    data->voltage = tlm[1] << 8 | tlm[2];
+    data->current = tlm[3] << 8 | tlm[4];
+    data->consumption = tlm[5] << 8 | tlm[6];
+    data->rpm = tlm[7] << 8 | tlm[8];
+
+    return ESC_SENSOR_FRAME_COMPLETE;
 }
 
-void escSensorProcess(timeUs_t currentTimeUs)
+static void selectNextMotor(escSensorPort_t *escPort, timeMs_t currentTimeMs)
 {
-    const timeMs_t currentTimeMs = currentTimeUs / 1000;
-
-    if (!escSensorEnabled) {
-        return;
-    }
-
-    // Wait period of time before requesting telemetry (let the system boot first)
-    if (currentTimeMs < ESC_BOOTTIME) {
-        return;
+    escPort->motor += escSensorPortCount;
+    if (escPort->motor >= getMotorCount()) {
+        escPort->motor = escPort - escSensorPorts;
     }
-    else if (escSensorTriggerState == ESC_SENSOR_TRIGGER_WAIT) {
-        // Ready for starting requesting telemetry
-        escSensorTriggerState = ESC_SENSOR_TRIGGER_READY;
-        escSensorMotor = 0;
-        escTriggerTimestamp = currentTimeMs;
-        escLastResponseTimestamp = escTriggerTimestamp;
-    }
-    else if (escSensorTriggerState == ESC_SENSOR_TRIGGER_READY) {
-        DEBUG_SET(DEBUG_ESC_SENSOR, DEBUG_ESC_MOTOR_INDEX, escSensorMotor + 1);
-
-        motorDmaOutput_t * const motor = getMotorDmaOutput(escSensorMotor);
-        motor->requestTelemetry = true;
-        escSensorTriggerState = ESC_SENSOR_TRIGGER_PENDING;
-    }
-    else if (escSensorTriggerState == ESC_SENSOR_TRIGGER_PENDING) {
+    escPort->timeoutRetryCount = 0;
+    escPort->triggerTimestamp = currentTimeMs;
+}
 
-        if (escTriggerTimestamp + ESC_REQUEST_TIMEOUT < currentTimeMs) {
-            // ESC did not repond in time, retry
-            timeoutRetryCount++;
-            escTriggerTimestamp = currentTimeMs;
-            escSensorTriggerState = ESC_SENSOR_TRIGGER_READY;
+static void escSensorPortProcess(escSensorPort_t *escPort, timeMs_t currentTimeMs)
+{
+    if (escPort->triggerState == ESC_SENSOR_TRIGGER_PENDING) {
+        // Get received frame status
+        const uint8_t state = escSensorFrameStatus(escPort);
 
-            if (timeoutRetryCount == 4) {
+        if (state == ESC_SENSOR_FRAME_COMPLETE) {
+            selectNextMotor(escPort, currentTimeMs);
+            escPort->triggerState = ESC_SENSOR_TRIGGER_READY;
+            escPort->lastResponseTimestamp = currentTimeMs;
+        } else if (state == ESC_SENSOR_FRAME_FAILED || escPort->triggerTimestamp + ESC_REQUEST_TIMEOUT < currentTimeMs) {
+            // ESC did not repond in time or the frame was corrupt, retry
+            escPort->timeoutRetryCount++;
+            escPort->triggerTimestamp = currentTimeMs;
+            escPort->triggerState = ESC_SENSOR_TRIGGER_READY;
+
+            if (escPort->timeoutRetryCount == 4) {
                 // Not responding after 3 times, skip motor
-                escSensorData[escSensorMotor].stale = true;
-                selectNextMotor();
+                escSensorData[escPort->motor].stale = true;
+                selectNextMotor(escPort, currentTimeMs);
             }
 
             DEBUG_SET(DEBUG_ESC_SENSOR, DEBUG_ESC_NUM_TIMEOUTS, ++totalRetryCount);
         }
+    }
 
-        // Get received frame status
-        uint8_t state = escSensorFrameStatus();
+    // Request the next frame straight away, the ESC answers within about a millisecond
+    if (escPort->triggerState == ESC_SENSOR_TRIGGER_READY && escPort->motor < getMotorCount()) {
+        DEBUG_SET(DEBUG_ESC_SENSOR, DEBUG_ESC_MOTOR_INDEX, escPort->motor + 1);
 
-        if (state == ESC_SENSOR_FRAME_COMPLETE) {
-            selectNextMotor();
-            escSensorTriggerState = ESC_SENSOR_TRIGGER_READY;
-            escLastResponseTimestamp = currentTimeMs;
-        }
+        discardStaleBytes(escPort);
+        motorDmaOutput_t * const motor = getMotorDmaOutput(escPort->motor);
+        motor->requestTelemetry = true;
+        escPort->triggerState = ESC_SENSOR_TRIGGER_PENDING;
     }
 
-    if (escLastResponseTimestamp + 10000 < currentTimeMs) {
+    if (escPort->lastResponseTimestamp + ESC_RESPONSE_TIMEOUT < currentTimeMs) {
         // ESCs did not respond for 10 seconds
         // Disable ESC telemetry and reset voltage and current to let the use know something is wrong
-        freeEscSensorPort();
-
-        resetEscSensorData();
+        freeEscSensorPort(escPort);
     }
 }
 
-static void selectNextMotor(void)
+void escSensorProcess(timeUs_t currentTimeUs)
 {
-    escSensorMotor++;
-    if (escSensorMotor == getMotorCount()) {
-        escSensorMotor = 0;
-    }
-    timeoutRetryCount = 0;
-    escTriggerTimestamp = millis();
-}
-
-//-- CRC
+    const timeMs_t currentTimeMs = currentTimeUs / 1000;
 
-static uint8_t update_crc8(uint8_t crc, uint8_t crc_seed)
-{
-    uint8_t crc_u = crc;
-    crc_u ^= crc_seed;
+    if (!escSensorEnabled) {
+        return;
+    }
 
-    for (int i=0; i<8; i++) {
-        crc_u = ( crc_u & 0x80 ) ? 0x7 ^ ( crc_u << 1 ) : ( crc_u << 1 );
+    // Wait period of time before requesting telemetry (let the system boot first)
+    if (currentTimeMs < ESC_BOOTTIME) {
+        return;
     }
 
-    return (crc_u);
-}
+    if (!escSensorStarted) {
+        // Ready for starting requesting telemetry
+        for (int i = 0; i < escSensorPortCount; i++) {
+            escSensorPort_t *escPort = &escSensorPorts[i];
+            escPort->triggerState = ESC_SENSOR_TRIGGER_READY;
+            escPort->triggerTimestamp = currentTimeMs;
+            escPort->lastResponseTimestamp = currentTimeMs;
+        }
+        escSensorStarted = true;
+    }
 
-static uint8_t get_crc8(uint8_t *Buf, uint8_t BufLen)
-{
-    uint8_t crc = 0;
-    for(int i=0; i<BufLen; i++) crc = update_crc8(Buf[i], crc);
-    return (crc);
+    for (int i = 0; i < escSensorPortCount; i++) {
+        if (escSensorPorts[i].port) {
+            escSensorPortProcess(&escSensorPorts[i], currentTimeMs);
+        }
+    }
 }
 
 #endif
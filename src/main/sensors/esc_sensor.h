@@ -29,6 +29,7 @@ typedef struct {
 } escSensorData_t;
 
 bool escSensorInit(void);
+bool isEscSensorActive(void);
 void escSensorProcess(timeUs_t currentTime);
 
 #define ESC_SENSOR_COMBINED 255
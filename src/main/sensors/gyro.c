@@ -22,6 +22,7 @@
 
 #include "platform.h"
 
+#include "build/build_config.h"
 #include "build/debug.h"
 
 #include "common/axis.h"
@@ -57,6 +58,8 @@
 #include "sensors/sensors.h"
 #include "sensors/boardalignment.h"
 #include "sensors/gyro.h"
+#include "sensors/gyroanalyse.h"
+#include "sensors/rpm_filter.h"
 
 #ifdef USE_HARDWARE_REVISION_DETECTION
 #include "hardware_revision.h"
@@ -66,16 +69,70 @@ gyro_t gyro;                      // gyro access functions
 
 static int32_t gyroADC[XYZ_AXIS_COUNT];
 
-static int32_t gyroZero[XYZ_AXIS_COUNT] = { 0, 0, 0 };
+static int32_t gyroZero[XYZ_AXIS_COUNT] = { 0, 0, 0 };     // in the sensor frame
+static sensorAlignment_t gyroAlignment;
 static const gyroConfig_t *gyroConfig;
 static uint16_t calibratingG = 0;
+static gyroBias_t *gyroBiasTable;
+static gyroBias_t *gyroCalibrationBias;        // slot for the temperature at the start of calibration, NULL if none
+static volatile bool gyroBiasTableChanged;
+
+#define GYRO_CALIBRATION_MIN_US         100000  // calibration is not checked for completion before this
+#define GYRO_CALIBRATION_CHECK_CYCLES   32
+#define GYRO_CALIBRATION_SETTLED_COUNTS 0.25f   // standard error of the mean that counts as settled
+#define GYRO_BIAS_MATCH_COUNTS          1       // a mean this close to the stored bias confirms it
+
+#define GYRO_OVERFLOW_LIMIT             32000   // counts, about 98% of the 16 bit range
+#define GYRO_WRAP_STEP                  0x8000  // a step of half the range in one sample can only be a wrapped reading
+#define GYRO_OVERFLOW_HOLD_US           50000   // the response stays in effect this long after the last saturated sample
+
+static FAST_RAM_ZERO_INIT int32_t gyroADCRawPrevious[XYZ_AXIS_COUNT];
+static FAST_RAM_ZERO_INIT uint16_t gyroOverflowHoldCycles;
+
+#ifdef USE_DUAL_GYRO
+#define GYRO_NOISE_SMOOTHING            0.01f   // per sample, the noise estimate follows about the last 100 samples
+
+// the second IMU of a dual gyro board, read along with gyro.dev and fused with it ahead of the filters
+static gyroDev_t gyroDev2;
+static gyroSensor_e gyro2Hardware = GYRO_NONE;     // GYRO_NONE unless found and in use
+static sensorAlignment_t gyroAlignment2;
+static int32_t gyroADC2[XYZ_AXIS_COUNT];
+static int32_t gyroZero2[XYZ_AXIS_COUNT];
+static FAST_RAM_ZERO_INIT float gyroRatePrevious[2][XYZ_AXIS_COUNT];
+static FAST_RAM_ZERO_INIT float gyroNoise[2][XYZ_AXIS_COUNT];      // smoothed size of the sample to sample change, deg/s
+static FAST_RAM_ZERO_INIT uint32_t gyro2MissedSamples;
+static FAST_RAM_ZERO_INIT bool gyro2Sampled;                    // the second gyro had a new sample for this loop
+#endif
 
-static filterApplyFnPtr softLpfFilterApplyFn;
-static void *softLpfFilter[3];
-static filterApplyFnPtr notchFilter1ApplyFn;
-static void *notchFilter1[3];
-static filterApplyFnPtr notchFilter2ApplyFn;
-static void *notchFilter2[3];
+#ifdef USE_FIXED_FILTER_CHAIN
+// filter topology fixed at build time, biquad soft LPF followed by two notches, all called directly
+static FAST_RAM_ZERO_INIT biquadFilter3_t softLpfFilter;
+static FAST_RAM_ZERO_INIT biquadFilter3_t notchFilter1;
+static FAST_RAM_ZERO_INIT biquadFilter3_t notchFilter2;
+
+#define softLpfFilterApply(data) biquadFilter3Apply(&softLpfFilter, (data))
+#define notchFilter1Apply(data) biquadFilter3Apply(&notchFilter1, (data))
+#define notchFilter2Apply(data) biquadFilter3Apply(&notchFilter2, (data))
+
+#ifdef USE_FIXED_POINT_GYRO_FILTERS
+// fixed point copies of the filters above, these are the ones gyroUpdate runs
+#define GYRO_FIXED_POINT_FRACTION_BITS 8
+static FAST_RAM_ZERO_INIT biquadFilter3Int_t softLpfFilterInt;
+static FAST_RAM_ZERO_INIT biquadFilter3Int_t notchFilter1Int;
+static FAST_RAM_ZERO_INIT biquadFilter3Int_t notchFilter2Int;
+#endif
+#else
+static filter3ApplyFnPtr softLpfFilterApplyFn;
+static void *softLpfFilter;
+static filter3ApplyFnPtr notchFilter1ApplyFn;
+static void *notchFilter1;
+static filter3ApplyFnPtr notchFilter2ApplyFn;
+static void *notchFilter2;
+
+#define softLpfFilterApply(data) softLpfFilterApplyFn(softLpfFilter, (data))
+#define notchFilter1Apply(data) notchFilter1ApplyFn(notchFilter1, (data))
+#define notchFilter2Apply(data) notchFilter2ApplyFn(notchFilter2, (data))
+#endif
 
 static const extiConfig_t *selectMPUIntExtiConfig(void)
 {
@@ -226,6 +283,103 @@ case GYRO_MPU9250:
     return true;
 }
 
+#ifdef USE_DUAL_GYRO
+// the SPI driver mpuDetectSecondary() found, with the alignment the target gives that driver
+static gyroSensor_e gyroDetectSecondary(gyroDev_t *dev)
+{
+    dev->gyroAlign = ALIGN_DEFAULT;
+
+    switch (dev->mpuDetectionResult.sensor) {
+#ifdef USE_GYRO_SPI_MPU6000
+    case MPU_60x0_SPI:
+        if (mpu6000SpiGyroDetect(dev)) {
+#ifdef GYRO_MPU6000_ALIGN
+            dev->gyroAlign = GYRO_MPU6000_ALIGN;
+#endif
+            return GYRO_MPU6000;
+        }
+        break;
+#endif
+#ifdef USE_GYRO_SPI_MPU6500
+    case MPU_65xx_SPI:
+        if (mpu6500SpiGyroDetect(dev)) {
+#ifdef GYRO_MPU6500_ALIGN
+            dev->gyroAlign = GYRO_MPU6500_ALIGN;
+#endif
+            return GYRO_MPU6500;
+        }
+        break;
+#endif
+#ifdef USE_GYRO_SPI_MPU9250
+    case MPU_9250_SPI:
+        if (mpu9250SpiGyroDetect(dev)) {
+#ifdef GYRO_MPU9250_ALIGN
+            dev->gyroAlign = GYRO_MPU9250_ALIGN;
+#endif
+            return GYRO_MPU9250;
+        }
+        break;
+#endif
+#ifdef USE_GYRO_SPI_ICM20689
+    case ICM_20689_SPI:
+        if (icm20689SpiGyroDetect(dev)) {
+#ifdef GYRO_ICM20689_ALIGN
+            dev->gyroAlign = GYRO_ICM20689_ALIGN;
+#endif
+            return GYRO_ICM20689;
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+    return GYRO_NONE;
+}
+
+/*
+ * The second gyro runs at the rate and with the DMA setting of the first, and only its latest sample is
+ * read, the FIFO of the first is not used with it either.
+ */
+static void gyroInitSecondary(void)
+{
+    memset(&gyroDev2, 0, sizeof(gyroDev2));
+    gyro2Hardware = GYRO_NONE;
+    if (gyroConfig->gyro_to_use == GYRO_CONFIG_USE_GYRO_1) {
+        return;
+    }
+
+#ifdef GYRO_2_EXTI_PIN
+    static const extiConfig_t gyro2IntExtiConfig = { .tag = IO_TAG(GYRO_2_EXTI_PIN) };
+    gyroDev2.mpuIntExtiConfig = &gyro2IntExtiConfig;
+#endif
+    mpuDetectSecondary(&gyroDev2);
+    const gyroSensor_e hardware = gyroDetectSecondary(&gyroDev2);
+    if (hardware == GYRO_NONE) {
+        return;
+    }
+    if (gyroConfig->gyro_2_align != ALIGN_DEFAULT) {
+        gyroDev2.gyroAlign = gyroConfig->gyro_2_align;
+    }
+    sensorAlignmentInit(&gyroAlignment2, gyroDev2.gyroAlign, gyroDev2.scale);
+    gyroDev2.lpf = gyro.dev.lpf;
+    gyroDev2.useDma = gyro.dev.useDma;
+    gyroDev2.init(&gyroDev2);
+
+    memset(gyroZero2, 0, sizeof(gyroZero2));
+    gyro2Hardware = hardware;
+}
+#endif
+
+// GYRO_NONE unless a second gyro was found and gyro_to_use reads it
+gyroSensor_e gyroSecondaryHardware(void)
+{
+#ifdef USE_DUAL_GYRO
+    return gyro2Hardware;
+#else
+    return GYRO_NONE;
+#endif
+}
+
 bool gyroInit(const gyroConfig_t *gyroConfigToUse)
 {
     gyroConfig = gyroConfigToUse;
@@ -239,79 +393,157 @@ bool gyroInit(const gyroConfig_t *gyroConfigToUse)
     if (!gyroDetect(&gyro.dev)) {
         return false;
     }
+    if (gyroConfig->gyro_align != ALIGN_DEFAULT) {
+        gyro.dev.gyroAlign = gyroConfig->gyro_align;
+    }
+#ifdef USE_FIXED_POINT_GYRO_FILTERS
+    sensorAlignmentInit(&gyroAlignment, gyro.dev.gyroAlign, 1 << GYRO_FIXED_POINT_FRACTION_BITS);
+#else
+    sensorAlignmentInit(&gyroAlignment, gyro.dev.gyroAlign, gyro.dev.scale);
+#endif
     gyro.targetLooptime = gyroSetSampleRate(gyroConfig->gyro_lpf, gyroConfig->gyro_sync_denom);    // Set gyro sample rate before initialisation
     gyro.dev.lpf = gyroConfig->gyro_lpf;
+    gyro.dev.useDma = gyroConfig->gyro_use_dma;
+    gyro.dev.useFifo = gyroConfig->gyro_use_fifo;
+#ifdef USE_DUAL_GYRO
+    // the filters run once on the fused sample, there is no FIFO history of the second gyro to run them on
+    if (gyroConfig->gyro_to_use != GYRO_CONFIG_USE_GYRO_1) {
+        gyro.dev.useFifo = false;
+    }
+#endif
     gyro.dev.init(&gyro.dev);
+    // with the FIFO enabled the sensor samples at its full rate and every sample is filtered
+    gyro.sampleLooptime = gyro.dev.fifoEnabled ? gyro.targetLooptime / (gyroMPU6xxxGetDividerDrops() + 1) : gyro.targetLooptime;
+#ifdef USE_DUAL_GYRO
+    gyroInitSecondary();
+#endif
     gyroInitFilters();
     return true;
 }
 
+/*
+ * Applies gyro_sync_denom to the running sensor and the filters that run at its rate. The gyro_lpf the
+ * sensor was started with is kept, changing it needs the sensor to be initialised again.
+ */
+void gyroUpdateSampleRate(void)
+{
+    gyro.targetLooptime = gyroSetSampleRate(gyro.dev.lpf, gyroConfig->gyro_sync_denom);
+#if defined(USE_GYRO_MPU6050) || defined(USE_GYRO_MPU3050) || defined(USE_GYRO_MPU6500) || defined(USE_GYRO_SPI_MPU6500) || defined(USE_GYRO_SPI_MPU6000) || defined(USE_ACC_MPU6050) || defined(USE_GYRO_SPI_MPU9250) || defined(USE_GYRO_SPI_ICM20689)
+    mpuGyroSetSampleRateDivider(&gyro.dev);
+#ifdef USE_DUAL_GYRO
+    if (gyro2Hardware != GYRO_NONE) {
+        mpuGyroSetSampleRateDivider(&gyroDev2);
+    }
+#endif
+#endif
+    gyro.sampleLooptime = gyro.dev.fifoEnabled ? gyro.targetLooptime / (gyroMPU6xxxGetDividerDrops() + 1) : gyro.targetLooptime;
+    gyroInitFilters();
+}
+
+#ifdef USE_FIXED_FILTER_CHAIN
+void gyroInitFilters(void)
+{
+    // gyro_soft_lpf_type is ignored, a stage set to 0Hz passes samples through unchanged
+    if (gyroConfig->gyro_soft_lpf_hz) {
+        biquadFilter3InitLPF(&softLpfFilter, gyroConfig->gyro_soft_lpf_hz, gyro.sampleLooptime);
+    } else {
+        biquadFilter3InitPassThrough(&softLpfFilter);
+    }
+
+    if (gyroConfig->gyro_soft_notch_hz_1) {
+        const float gyroSoftNotchQ1 = filterGetNotchQ(gyroConfig->gyro_soft_notch_hz_1, gyroConfig->gyro_soft_notch_cutoff_1);
+        biquadFilter3Init(&notchFilter1, gyroConfig->gyro_soft_notch_hz_1, gyro.sampleLooptime, gyroSoftNotchQ1, FILTER_NOTCH);
+    } else {
+        biquadFilter3InitPassThrough(&notchFilter1);
+    }
+    if (gyroConfig->gyro_soft_notch_hz_2) {
+        const float gyroSoftNotchQ2 = filterGetNotchQ(gyroConfig->gyro_soft_notch_hz_2, gyroConfig->gyro_soft_notch_cutoff_2);
+        biquadFilter3Init(&notchFilter2, gyroConfig->gyro_soft_notch_hz_2, gyro.sampleLooptime, gyroSoftNotchQ2, FILTER_NOTCH);
+    } else {
+        biquadFilter3InitPassThrough(&notchFilter2);
+    }
+
+#ifdef USE_FIXED_POINT_GYRO_FILTERS
+    biquadFilter3IntInit(&softLpfFilterInt, &softLpfFilter);
+    biquadFilter3IntInit(&notchFilter1Int, &notchFilter1);
+    biquadFilter3IntInit(&notchFilter2Int, &notchFilter2);
+#endif
+
+#ifdef USE_GYRO_DATA_ANALYSE
+    gyroDataAnalyseInit(gyroConfig, &notchFilter1, &notchFilter2);
+#endif
+#ifdef USE_RPM_FILTER
+    rpmFilterInit(gyroConfig, gyro.sampleLooptime);
+#endif
+}
+#else
 void gyroInitFilters(void)
 {
-    static biquadFilter_t gyroFilterLPF[XYZ_AXIS_COUNT];
-    static pt1Filter_t gyroFilterPt1[XYZ_AXIS_COUNT];
+    static FAST_RAM_ZERO_INIT biquadFilter3_t gyroFilterLPF;
+    static FAST_RAM_ZERO_INIT pt1Filter3_t gyroFilterPt1;
     static firFilterDenoise_t gyroDenoiseState[XYZ_AXIS_COUNT];
-    static biquadFilter_t gyroFilterNotch_1[XYZ_AXIS_COUNT];
-    static biquadFilter_t gyroFilterNotch_2[XYZ_AXIS_COUNT];
+    static FAST_RAM_ZERO_INIT biquadFilter3_t gyroFilterNotch_1;
+    static FAST_RAM_ZERO_INIT biquadFilter3_t gyroFilterNotch_2;
 
-    softLpfFilterApplyFn = nullFilterApply;
-    notchFilter1ApplyFn = nullFilterApply;
-    notchFilter2ApplyFn = nullFilterApply;
+    softLpfFilterApplyFn = nullFilter3Apply;
+    notchFilter1ApplyFn = nullFilter3Apply;
+    notchFilter2ApplyFn = nullFilter3Apply;
 
     if (gyroConfig->gyro_soft_lpf_hz) {  // Initialisation needs to happen once samplingrate is known
         if (gyroConfig->gyro_soft_lpf_type == FILTER_BIQUAD) {
-            softLpfFilterApplyFn = (filterApplyFnPtr)biquadFilterApply;
-            for (int axis = 0; axis < 3; axis++) {
-                softLpfFilter[axis] = &gyroFilterLPF[axis];
-                biquadFilterInitLPF(softLpfFilter[axis], gyroConfig->gyro_soft_lpf_hz, gyro.targetLooptime);
-            }
+            softLpfFilterApplyFn = (filter3ApplyFnPtr)biquadFilter3Apply;
+            softLpfFilter = &gyroFilterLPF;
+            biquadFilter3InitLPF(&gyroFilterLPF, gyroConfig->gyro_soft_lpf_hz, gyro.sampleLooptime);
         } else if (gyroConfig->gyro_soft_lpf_type == FILTER_PT1) {
-            softLpfFilterApplyFn = (filterApplyFnPtr)pt1FilterApply;
-            const float gyroDt = (float) gyro.targetLooptime * 0.000001f;
-            for (int axis = 0; axis < 3; axis++) {
-                softLpfFilter[axis] = &gyroFilterPt1[axis];
-                pt1FilterInit(softLpfFilter[axis], gyroConfig->gyro_soft_lpf_hz, gyroDt);
-            }
+            softLpfFilterApplyFn = (filter3ApplyFnPtr)pt1Filter3Apply;
+            softLpfFilter = &gyroFilterPt1;
+            const float gyroDt = (float) gyro.sampleLooptime * 0.000001f;
+            pt1Filter3Init(&gyroFilterPt1, gyroConfig->gyro_soft_lpf_hz, gyroDt);
         } else {
-            softLpfFilterApplyFn = (filterApplyFnPtr)firFilterDenoiseUpdate;
+            softLpfFilterApplyFn = (filter3ApplyFnPtr)firFilterDenoise3Apply;
+            softLpfFilter = gyroDenoiseState;
             for (int axis = 0; axis < 3; axis++) {
-                softLpfFilter[axis] = &gyroDenoiseState[axis];
-                firFilterDenoiseInit(softLpfFilter[axis], gyroConfig->gyro_soft_lpf_hz, gyro.targetLooptime);
+                firFilterDenoiseInit(&gyroDenoiseState[axis], gyroConfig->gyro_soft_lpf_hz, gyro.sampleLooptime);
             }
         }
     }
 
     if (gyroConfig->gyro_soft_notch_hz_1) {
-        notchFilter1ApplyFn = (filterApplyFnPtr)biquadFilterApply;
+        notchFilter1ApplyFn = (filter3ApplyFnPtr)biquadFilter3Apply;
+        notchFilter1 = &gyroFilterNotch_1;
         const float gyroSoftNotchQ1 = filterGetNotchQ(gyroConfig->gyro_soft_notch_hz_1, gyroConfig->gyro_soft_notch_cutoff_1);
-        for (int axis = 0; axis < 3; axis++) {
-            notchFilter1[axis] = &gyroFilterNotch_1[axis];
-            biquadFilterInit(notchFilter1[axis], gyroConfig->gyro_soft_notch_hz_1, gyro.targetLooptime, gyroSoftNotchQ1, FILTER_NOTCH);
-        }
+        biquadFilter3Init(&gyroFilterNotch_1, gyroConfig->gyro_soft_notch_hz_1, gyro.sampleLooptime, gyroSoftNotchQ1, FILTER_NOTCH);
     }
     if (gyroConfig->gyro_soft_notch_hz_2) {
-        notchFilter2ApplyFn = (filterApplyFnPtr)biquadFilterApply;
+        notchFilter2ApplyFn = (filter3ApplyFnPtr)biquadFilter3Apply;
+        notchFilter2 = &gyroFilterNotch_2;
         const float gyroSoftNotchQ2 = filterGetNotchQ(gyroConfig->gyro_soft_notch_hz_2, gyroConfig->gyro_soft_notch_cutoff_2);
-        for (int axis = 0; axis < 3; axis++) {
-            notchFilter2[axis] = &gyroFilterNotch_2[axis];
-            biquadFilterInit(notchFilter2[axis], gyroConfig->gyro_soft_notch_hz_2, gyro.targetLooptime, gyroSoftNotchQ2, FILTER_NOTCH);
-        }
+        biquadFilter3Init(&gyroFilterNotch_2, gyroConfig->gyro_soft_notch_hz_2, gyro.sampleLooptime, gyroSoftNotchQ2, FILTER_NOTCH);
     }
+
+#ifdef USE_GYRO_DATA_ANALYSE
+    gyroDataAnalyseInit(gyroConfig, &gyroFilterNotch_1, &gyroFilterNotch_2);
+#endif
+#ifdef USE_RPM_FILTER
+    rpmFilterInit(gyroConfig, gyro.sampleLooptime);
+#endif
 }
+#endif
 
 bool isGyroCalibrationComplete(void)
 {
     return calibratingG == 0;
 }
 
-static bool isOnFinalGyroCalibrationCycle(void)
+// longest calibration, it finishes with the mean even if that has not settled
+static uint16_t gyroCalculateCalibratingCycles(void)
 {
-    return calibratingG == 1;
+    return (CALIBRATING_GYRO_CYCLES / gyro.targetLooptime) * CALIBRATING_GYRO_CYCLES;
 }
 
-static uint16_t gyroCalculateCalibratingCycles(void)
+static uint16_t gyroCalculateMinCalibratingCycles(void)
 {
-    return (CALIBRATING_GYRO_CYCLES / gyro.targetLooptime) * CALIBRATING_GYRO_CYCLES;
+    return GYRO_CALIBRATION_MIN_US / gyro.targetLooptime;
 }
 
 static bool isOnFirstGyroCalibrationCycle(void)
@@ -319,85 +551,398 @@ static bool isOnFirstGyroCalibrationCycle(void)
     return calibratingG == gyroCalculateCalibratingCycles();
 }
 
+static gyroBias_t *gyroCalibrationBiasSlot(void)
+{
+    if (!gyroBiasTable || !gyroConfig->gyro_cal_stored_bias || !gyro.dev.temperature) {
+        return NULL;
+    }
+
+    int16_t temperature = INT16_MIN;
+    if (!gyro.dev.temperature(&gyro.dev, &temperature) || temperature < GYRO_BIAS_TEMPERATURE_MIN) {
+        return NULL;
+    }
+    const int slot = (temperature - GYRO_BIAS_TEMPERATURE_MIN) / GYRO_BIAS_TEMPERATURE_STEP;
+    return slot < GYRO_BIAS_TEMPERATURE_SLOTS ? &gyroBiasTable[slot] : NULL;
+}
+
+// the temperature is read here, from task context, the calibration itself may run in the gyro interrupt
 void gyroSetCalibrationCycles(void)
 {
+    gyroCalibrationBias = gyroCalibrationBiasSlot();
     calibratingG = gyroCalculateCalibratingCycles();
 }
 
+void setGyroBiasTable(gyroBias_t *gyroBiasTableToUse)
+{
+    gyroBiasTable = gyroBiasTableToUse;
+}
+
+// true once after each change to the bias table, the caller saves the config while disarmed
+bool gyroBiasTableNeedsSave(void)
+{
+    const bool needsSave = gyroBiasTableChanged;
+    gyroBiasTableChanged = false;
+    return needsSave;
+}
+
+static void gyroCalibrationComplete(void)
+{
+    calibratingG = 0;
+    beeper(BEEPER_GYRO_CALIBRATED);
+}
+
+/*
+ * Welford running mean and variance per axis. From the minimum length on the estimate is checked every
+ * GYRO_CALIBRATION_CHECK_CYCLES samples, and calibration finishes as soon as the mean has settled, or agrees
+ * with the bias stored for the temperature. Motion restarts it, unless a stored bias can be used instead.
+ */
 static void performGyroCalibration(uint8_t gyroMovementCalibrationThreshold)
 {
-    static int32_t g[3];
     static stdev_t var[3];
+#ifdef USE_DUAL_GYRO
+    static stdev_t var2[3];
+    const bool calibrateGyro2 = gyro2Hardware != GYRO_NONE;
+#endif
 
-    for (int axis = 0; axis < 3; axis++) {
-
-        // Reset g[axis] at start of calibration
-        if (isOnFirstGyroCalibrationCycle()) {
-            g[axis] = 0;
+    if (isOnFirstGyroCalibrationCycle()) {
+        for (int axis = 0; axis < 3; axis++) {
             devClear(&var[axis]);
+#ifdef USE_DUAL_GYRO
+            devClear(&var2[axis]);
+#endif
         }
+    }
 
-        // Sum up CALIBRATING_GYRO_CYCLES readings
-        g[axis] += gyroADC[axis];
+    for (int axis = 0; axis < 3; axis++) {
         devPush(&var[axis], gyroADC[axis]);
 
         // Reset global variables to prevent other code from using un-calibrated data
         gyroADC[axis] = 0;
         gyroZero[axis] = 0;
+#ifdef USE_DUAL_GYRO
+        if (calibrateGyro2 && gyro2Sampled) {
+            devPush(&var2[axis], gyroADC2[axis]);
+        }
+        gyroADC2[axis] = 0;
+        gyroZero2[axis] = 0;
+#endif
+    }
+    calibratingG--;
+
+    const uint16_t samples = var[X].m_n;
+    if (calibratingG && (samples < gyroCalculateMinCalibratingCycles() || samples % GYRO_CALIBRATION_CHECK_CYCLES)) {
+        return;
+    }
+
+    const gyroBias_t *storedBias = (gyroCalibrationBias && gyroCalibrationBias->valid) ? gyroCalibrationBias : NULL;
+    bool moving = false;
+    bool settled = true;
+    bool matchesStored = storedBias != NULL;
+    for (int axis = 0; axis < 3; axis++) {
+        const float variance = devVariance(&var[axis]);
+        if (gyroMovementCalibrationThreshold && variance > sq((float)gyroMovementCalibrationThreshold)) {
+            moving = true;
+        }
+        // standard error of the mean against the settled limit, without the square root
+        if (variance > samples * sq(GYRO_CALIBRATION_SETTLED_COUNTS)) {
+            settled = false;
+        }
+        if (storedBias && ABS(var[axis].m_newM - storedBias->zero[axis]) > GYRO_BIAS_MATCH_COUNTS) {
+            matchesStored = false;
+        }
+    }
+#ifdef USE_DUAL_GYRO
+    if (calibrateGyro2) {
+        for (int axis = 0; axis < 3; axis++) {
+            const float variance = devVariance(&var2[axis]);
+            if (gyroMovementCalibrationThreshold && variance > sq((float)gyroMovementCalibrationThreshold)) {
+                moving = true;
+            }
+            if (variance > var2[axis].m_n * sq(GYRO_CALIBRATION_SETTLED_COUNTS)) {
+                settled = false;
+            }
+        }
+        // the stored bias is of the first gyro alone, it can neither confirm nor stand in for the calibration of both
+        storedBias = NULL;
+        matchesStored = false;
+    }
+#endif
 
-        if (isOnFinalGyroCalibrationCycle()) {
-            float dev = devStandardDeviation(&var[axis]);
+    if (moving) {
+        if (storedBias) {
+            for (int axis = 0; axis < 3; axis++) {
+                gyroZero[axis] = storedBias->zero[axis];
+            }
+            gyroCalibrationComplete();
+        } else {
             // check deviation and startover in case the model was moved
-            if (gyroMovementCalibrationThreshold && dev > gyroMovementCalibrationThreshold) {
-                gyroSetCalibrationCycles();
-                return;
+            calibratingG = gyroCalculateCalibratingCycles();
+        }
+        return;
+    }
+
+    if (!settled && !matchesStored && calibratingG) {
+        return;
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        gyroZero[axis] = lrintf(var[axis].m_newM);
+#ifdef USE_DUAL_GYRO
+        gyroZero2[axis] = lrintf(var2[axis].m_newM);
+#endif
+    }
+
+    // the stored bias is only rewritten when it has drifted, to keep flash writes rare
+    if (gyroCalibrationBias) {
+        bool changed = !gyroCalibrationBias->valid;
+        for (int axis = 0; axis < 3; axis++) {
+            if (ABS(gyroZero[axis] - gyroCalibrationBias->zero[axis]) > GYRO_BIAS_MATCH_COUNTS) {
+                changed = true;
+            }
+        }
+        if (changed) {
+            for (int axis = 0; axis < 3; axis++) {
+                gyroCalibrationBias->zero[axis] = gyroZero[axis];
             }
-            gyroZero[axis] = (g[axis] + (gyroCalculateCalibratingCycles() / 2)) / gyroCalculateCalibratingCycles();
+            gyroCalibrationBias->valid = true;
+            gyroBiasTableChanged = true;
         }
     }
+    gyroCalibrationComplete();
+}
+
+#ifdef USE_GYRO_FIFO
+// Run the FIFO samples preceding the latest one through the filter chain, only the filter state is kept
+static void gyroFilterFifoSamples(void)
+{
+    for (int i = 0; i < gyro.dev.fifoSampleCount - 1; i++) {
+        int32_t sample[XYZ_AXIS_COUNT];
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sample[axis] = gyro.dev.gyroADCFifo[i][axis] - gyroZero[axis];
+        }
 
-    if (isOnFinalGyroCalibrationCycle()) {
-        beeper(BEEPER_GYRO_CALIBRATED);
+        float gyroADCf[XYZ_AXIS_COUNT];
+        sensorAlignmentApply(&gyroAlignment, sample, gyroADCf);
+        softLpfFilterApply(gyroADCf);
+#ifdef USE_RPM_FILTER
+        rpmFilterApply(gyroADCf);
+#endif
+        notchFilter1Apply(gyroADCf);
+        notchFilter2Apply(gyroADCf);
     }
-    calibratingG--;
+}
+#endif
+
+#ifdef USE_FIXED_POINT_GYRO_FILTERS
+// Runs the filter chain on the zeroed sensor counts in fixed point, leaving the result in gyro.gyroADCf
+static void gyroFilterFixedPoint(void)
+{
+    // the alignment matrix carries the fraction bits rather than the scale to degrees per second
+    float aligned[XYZ_AXIS_COUNT];
+    sensorAlignmentApply(&gyroAlignment, gyroADC, aligned);
+
+    const float scale = gyro.dev.scale / (1 << GYRO_FIXED_POINT_FRACTION_BITS);
+    int32_t filtered[XYZ_AXIS_COUNT];
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        filtered[axis] = lrintf(aligned[axis]);
+        DEBUG_SET(DEBUG_GYRO, axis, lrintf(aligned[axis] * scale));
+    }
+
+    biquadFilter3IntApply(&softLpfFilterInt, filtered);
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        DEBUG_SET(DEBUG_NOTCH, axis, lrintf(filtered[axis] * scale));
+    }
+
+    biquadFilter3IntApply(&notchFilter1Int, filtered);
+    biquadFilter3IntApply(&notchFilter2Int, filtered);
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        gyro.gyroADCf[axis] = filtered[axis] * scale;
+    }
+}
+#endif
+
+// saturation at either end of the range, or a step only a wrapped value can make, without branching per axis
+static uint32_t gyroOverflowAxes(void)
+{
+    uint32_t axes = 0;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        const int32_t raw = gyro.dev.gyroADCRaw[axis];
+        const int32_t step = raw - gyroADCRawPrevious[axis];
+        axes |= (uint32_t)((ABS(raw) >= GYRO_OVERFLOW_LIMIT) | (ABS(step) >= GYRO_WRAP_STEP)) << axis;
+        gyroADCRawPrevious[axis] = raw;
+    }
+    return axes;
+}
+
+static void gyroUpdateOverflow(void)
+{
+    if (gyroOverflowAxes()) {
+        gyro.overflowCount++;
+        gyroOverflowHoldCycles = GYRO_OVERFLOW_HOLD_US / gyro.targetLooptime;
+        gyro.overflowResponse = gyroConfig->gyro_overflow_response;
+    } else if (gyroOverflowHoldCycles && --gyroOverflowHoldCycles == 0) {
+        gyro.overflowResponse = GYRO_OVERFLOW_RESPONSE_NONE;
+    }
+}
+
+#ifdef USE_DUAL_GYRO
+static bool gyroSaturated(const gyroDev_t *dev)
+{
+    return ABS(dev->gyroADCRaw[X]) >= GYRO_OVERFLOW_LIMIT || ABS(dev->gyroADCRaw[Y]) >= GYRO_OVERFLOW_LIMIT || ABS(dev->gyroADCRaw[Z]) >= GYRO_OVERFLOW_LIMIT;
+}
 
+static void gyroUpdateNoise(float *noise, float *previous, const float *rate)
+{
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        noise[axis] += GYRO_NOISE_SMOOTHING * (fabsf(rate[axis] - previous[axis]) - noise[axis]);
+        previous[axis] = rate[axis];
+    }
 }
 
-void gyroUpdate(void)
+/*
+ * Combines the body frame rates of the second gyro with those of the first in gyro.gyroADCf. Motion shows
+ * on both gyros alike, so the one with more sample to sample change per axis is the noisier, and with
+ * gyro_fusion HEALTH each gyro is weighted by the inverse of its noise power. A saturated gyro, or a second
+ * gyro with no new sample for this loop, leaves the other one to be used alone.
+ */
+static void gyroFuseSecondary(void)
+{
+    float rate2[XYZ_AXIS_COUNT];
+    sensorAlignmentApply(&gyroAlignment2, gyroADC2, rate2);
+
+    if (!gyro2Sampled) {
+        gyro2MissedSamples++;
+    }
+    DEBUG_SET(DEBUG_DUAL_GYRO, 0, lrintf(gyro.gyroADCf[FD_ROLL]));
+    DEBUG_SET(DEBUG_DUAL_GYRO, 1, lrintf(rate2[FD_ROLL]));
+    DEBUG_SET(DEBUG_DUAL_GYRO, 3, gyro2MissedSamples);
+
+    if (gyroConfig->gyro_to_use == GYRO_CONFIG_USE_GYRO_2) {
+        // held over a missed sample
+        memcpy(gyro.gyroADCf, rate2, sizeof(rate2));
+        return;
+    }
+
+    const bool health = gyroConfig->gyro_fusion == GYRO_FUSION_HEALTH;
+    if (health) {
+        gyroUpdateNoise(gyroNoise[0], gyroRatePrevious[0], gyro.gyroADCf);
+        if (gyro2Sampled) {
+            gyroUpdateNoise(gyroNoise[1], gyroRatePrevious[1], rate2);
+        }
+    }
+
+    if (!gyro2Sampled || gyroSaturated(&gyroDev2)) {
+        DEBUG_SET(DEBUG_DUAL_GYRO, 2, 100);
+        return;
+    }
+    if (gyroSaturated(&gyro.dev)) {
+        memcpy(gyro.gyroADCf, rate2, sizeof(rate2));
+        DEBUG_SET(DEBUG_DUAL_GYRO, 2, 0);
+        return;
+    }
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        float weight1 = 0.5f;
+        if (health) {
+            const float power1 = sq(gyroNoise[0][axis]);
+            const float power2 = sq(gyroNoise[1][axis]);
+            if (power1 + power2 > 0.0f) {
+                weight1 = power2 / (power1 + power2);
+            }
+        }
+        gyro.gyroADCf[axis] = weight1 * gyro.gyroADCf[axis] + (1.0f - weight1) * rate2[axis];
+        if (axis == FD_ROLL) {
+            DEBUG_SET(DEBUG_DUAL_GYRO, 2, lrintf(weight1 * 100));
+        }
+    }
+}
+#endif
+
+FAST_CODE_ITCM void gyroUpdate(void)
 {
     // range: +/- 8192; +/- 2000 deg/sec
     if (!gyro.dev.read(&gyro.dev)) {
         return;
     }
     gyro.dev.dataReady = false;
+
+#ifdef USE_RPM_FILTER
+    rpmFilterUpdate();
+#endif
+#ifdef USE_GYRO_FIFO
+    gyroFilterFifoSamples();
+#endif
+
+    gyroUpdateOverflow();
+
     gyroADC[X] = gyro.dev.gyroADCRaw[X];
     gyroADC[Y] = gyro.dev.gyroADCRaw[Y];
     gyroADC[Z] = gyro.dev.gyroADCRaw[Z];
 
-    alignSensors(gyroADC, gyro.dev.gyroAlign);
+#ifdef USE_DUAL_GYRO
+    // by DMA the second gyro's burst ran alongside the first, and a missed sample leaves the previous one
+    if (gyro2Hardware != GYRO_NONE) {
+        gyro2Sampled = gyroDev2.read(&gyroDev2);
+        gyroADC2[X] = gyroDev2.gyroADCRaw[X];
+        gyroADC2[Y] = gyroDev2.gyroADCRaw[Y];
+        gyroADC2[Z] = gyroDev2.gyroADCRaw[Z];
+    }
+#endif
 
-    const bool calibrationComplete = isGyroCalibrationComplete();
-    if (!calibrationComplete) {
+    // calibrated in the sensor frame, the alignment is applied with the scale
+    if (!isGyroCalibrationComplete()) {
         performGyroCalibration(gyroConfig->gyroMovementCalibrationThreshold);
     }
 
     for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
         gyroADC[axis] -= gyroZero[axis];
-        // scale gyro output to degrees per second
-        gyro.gyroADCf[axis] = (float)gyroADC[axis] * gyro.dev.scale;
+#ifdef USE_DUAL_GYRO
+        gyroADC2[axis] -= gyroZero2[axis];
+#endif
+    }
+
+#ifdef USE_FIXED_POINT_GYRO_FILTERS
+    gyroFilterFixedPoint();
+#else
+    // sensor counts to body frame degrees per second
+    sensorAlignmentApply(&gyroAlignment, gyroADC, gyro.gyroADCf);
+#ifdef USE_DUAL_GYRO
+    if (gyro2Hardware != GYRO_NONE) {
+        gyroFuseSecondary();
+    }
+#endif
 
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
         DEBUG_SET(DEBUG_GYRO, axis, lrintf(gyro.gyroADCf[axis]));
+    }
 
-        gyro.gyroADCf[axis] = softLpfFilterApplyFn(softLpfFilter[axis], gyro.gyroADCf[axis]);
+    // all three axes are filtered together by each stage
+    softLpfFilterApply(gyro.gyroADCf);
 
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
         DEBUG_SET(DEBUG_NOTCH, axis, lrintf(gyro.gyroADCf[axis]));
+    }
 
-        gyro.gyroADCf[axis] = notchFilter1ApplyFn(notchFilter1[axis], gyro.gyroADCf[axis]);
+#ifdef USE_GYRO_DATA_ANALYSE
+    if (gyroConfig->gyro_soft_notch_dynamic) {
+        gyroDataAnalyse(gyro.gyroADCf);
+    }
+#endif
 
-        gyro.gyroADCf[axis] = notchFilter2ApplyFn(notchFilter2[axis], gyro.gyroADCf[axis]);
+#ifdef USE_RPM_FILTER
+    rpmFilterApply(gyro.gyroADCf);
+#endif
+    notchFilter1Apply(gyro.gyroADCf);
+    notchFilter2Apply(gyro.gyroADCf);
+#endif
 
-        if (!calibrationComplete) {
-            gyroADC[axis] = lrintf(gyro.gyroADCf[axis] / gyro.dev.scale);
+    // the filters ring past the sensor range on the step into saturation
+    if (gyro.overflowResponse & GYRO_OVERFLOW_RESPONSE_CLAMP) {
+        const float limit = GYRO_OVERFLOW_LIMIT * gyro.dev.scale;
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            gyro.gyroADCf[axis] = constrainf(gyro.gyroADCf[axis], -limit, limit);
         }
     }
 }
@@ -34,10 +34,43 @@ typedef enum {
     GYRO_FAKE
 } gyroSensor_e;
 
+// what is done while a gyro axis reads at the end of its range, combined as flags
+typedef enum {
+    GYRO_OVERFLOW_RESPONSE_NONE  = 0,       // counted only
+    GYRO_OVERFLOW_RESPONSE_ITERM = 1 << 0,  // the PID integrators are held
+    GYRO_OVERFLOW_RESPONSE_CLAMP = 1 << 1   // the filtered rates are kept within the sensor range
+} gyroOverflowResponse_e;
+
+// the sensors a dual gyro board reads, the first is the one the loop is synchronised to
+typedef enum {
+    GYRO_CONFIG_USE_GYRO_1 = 0,
+    GYRO_CONFIG_USE_GYRO_2,
+    GYRO_CONFIG_USE_GYRO_BOTH
+} gyroToUse_e;
+
+// how the rates of both gyros are combined, from the sensor samples taken for the same loop
+typedef enum {
+    GYRO_FUSION_AVERAGE = 0,
+    GYRO_FUSION_HEALTH                      // per axis, weighted by the inverse of the noise each gyro shows
+} gyroFusion_e;
+
+#define GYRO_BIAS_TEMPERATURE_SLOTS     8
+#define GYRO_BIAS_TEMPERATURE_MIN       10      // degrees C, lower edge of the first slot
+#define GYRO_BIAS_TEMPERATURE_STEP      5       // degrees C covered by each slot
+
+// zero rate offset in sensor frame counts, measured at a die temperature within the slot it is stored in
+typedef struct gyroBias_s {
+    int16_t zero[XYZ_AXIS_COUNT];
+    uint8_t valid;
+} gyroBias_t;
+
 typedef struct gyro_s {
     gyroDev_t dev;
     uint32_t targetLooptime;
+    uint32_t sampleLooptime;                    // sensor sample period seen by the filters, shorter than targetLooptime when reading the FIFO
     float gyroADCf[XYZ_AXIS_COUNT];
+    uint8_t overflowResponse;                   // gyroOverflowResponse_e flags in effect, held for a while after the last saturated sample
+    uint32_t overflowCount;                     // samples with a saturated or wrapped axis since boot
 } gyro_t;
 
 extern gyro_t gyro;
@@ -53,10 +86,27 @@ typedef struct gyroConfig_s {
     uint16_t gyro_soft_notch_cutoff_1;
     uint16_t gyro_soft_notch_hz_2;
     uint16_t gyro_soft_notch_cutoff_2;
+    uint8_t  gyro_use_dma;                     // read the gyro by DMA burst from the data ready interrupt, where the target supports it
+    uint8_t  gyro_use_fifo;                    // drain and filter every sample in the gyro FIFO, where the sensor supports it
+    uint8_t  gyro_phase_lock;                  // run the PID loop this many us after each gyro data ready interrupt, 0 leaves it free running
+    uint8_t  gyro_soft_notch_dynamic;          // track the strongest gyro noise peaks with notch 1 and 2
+    uint8_t  gyro_rpm_notch_harmonics;         // notches per motor following its eRPM, 0 turns the RPM filter off
+    uint8_t  gyro_rpm_notch_min_hz;            // lowest centre frequency of the RPM notches
+    uint16_t gyro_rpm_notch_q;                 // Q of the RPM notches * 100
+    uint8_t  gyro_overflow_response;           // gyroOverflowResponse_e flags applied while an axis is saturated
+    uint8_t  gyro_cal_stored_bias;             // keep the calibrated bias per temperature and fall back on it when the model is moved
+    uint8_t  gyro_to_use;                      // gyroToUse_e, on dual gyro boards
+    uint8_t  gyro_fusion;                      // gyroFusion_e, when both gyros are used
+    sensor_align_e gyro_2_align;               // alignment of the second gyro
+    gyroBias_t gyroBias[GYRO_BIAS_TEMPERATURE_SLOTS];
 } gyroConfig_t;
 
 void gyroSetCalibrationCycles(void);
+void setGyroBiasTable(gyroBias_t *gyroBiasTableToUse);
+bool gyroBiasTableNeedsSave(void);
 bool gyroInit(const gyroConfig_t *gyroConfigToUse);
 void gyroInitFilters(void);
+void gyroUpdateSampleRate(void);
 void gyroUpdate(void);
 bool isGyroCalibrationComplete(void);
+gyroSensor_e gyroSecondaryHardware(void);
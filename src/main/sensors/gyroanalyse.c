@@ -0,0 +1,288 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Dynamic notch tuning from a gyro spectrum.
+ *
+ * Gyro samples are decimated to roughly FFT_SAMPLING_RATE_HZ and kept in a sliding window per axis.
+ * The FFT of one axis at a time is computed in small steps, one step per gyro cycle, so the work
+ * added to any single cycle is bounded by one radix-2 stage (FFT_WINDOW_SIZE / 2 butterflies).
+ * The two strongest peaks found in the spectrum pull the centre frequencies of notch 1 and 2 towards them.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "platform.h"
+
+#ifdef USE_GYRO_DATA_ANALYSE
+
+#include "build/debug.h"
+
+#include "common/axis.h"
+#include "common/filter.h"
+#include "common/maths.h"
+
+#include "sensors/gyro.h"
+#include "sensors/gyroanalyse.h"
+
+#define FFT_WINDOW_SIZE         64
+#define FFT_STAGE_COUNT         6       // log2(FFT_WINDOW_SIZE)
+#define FFT_BIN_COUNT           (FFT_WINDOW_SIZE / 2)
+#define FFT_SAMPLING_RATE_HZ    2000    // analysis rate after decimation, halved spectrum covers up to 1kHz
+#define FFT_MIN_FREQ_HZ         80      // ignore frame and prop wash frequencies
+#define FFT_PEAK_THRESHOLD      4.0f    // a peak must be this many times the noise floor power to retune a notch
+#define DYN_NOTCH_SMOOTHING     0.3f    // fraction of the distance to the new peak moved per analysis
+
+typedef enum {
+    STEP_WINDOW = 0,
+    STEP_FFT_FIRST_STAGE,
+    STEP_FFT_LAST_STAGE = STEP_FFT_FIRST_STAGE + FFT_STAGE_COUNT - 1,
+    STEP_FIND_PEAKS,
+    STEP_UPDATE_NOTCH_1,
+    STEP_UPDATE_NOTCH_2,
+    STEP_COUNT
+} gyroAnalyseStep_e;
+
+static biquadFilter3_t *dynNotch[2];
+static float dynNotchQ[2];
+static float dynNotchCenterHz[2];
+static float dynNotchPeakHz[2];
+static float dynNotchMaxHz;
+
+static uint8_t decimation;
+static uint8_t decimationCount;
+static float decimationSum[XYZ_AXIS_COUNT];
+
+static float sampleWindow[XYZ_AXIS_COUNT][FFT_WINDOW_SIZE];
+static uint8_t sampleIndex;
+static bool sampleWindowFull;
+
+static float hanning[FFT_WINDOW_SIZE];
+static float twiddleCos[FFT_BIN_COUNT];
+static float twiddleSin[FFT_BIN_COUNT];
+static uint8_t bitReversed[FFT_WINDOW_SIZE];
+
+static float fftRe[FFT_WINDOW_SIZE];
+static float fftIm[FFT_WINDOW_SIZE];
+static float fftBinWidthHz;
+static uint8_t fftAxis;
+static uint8_t fftStep;
+
+static uint8_t reverseBits(uint8_t value)
+{
+    uint8_t result = 0;
+    for (int i = 0; i < FFT_STAGE_COUNT; i++) {
+        result = (result << 1) | (value & 1);
+        value >>= 1;
+    }
+    return result;
+}
+
+void gyroDataAnalyseInit(const gyroConfig_t *gyroConfig, biquadFilter3_t *notchFilter1, biquadFilter3_t *notchFilter2)
+{
+    const float loopRateHz = 1000000.0f / gyro.targetLooptime;
+    decimation = MAX(1, lrintf(loopRateHz / FFT_SAMPLING_RATE_HZ));
+    const float fftSamplingRateHz = loopRateHz / decimation;
+    fftBinWidthHz = fftSamplingRateHz / FFT_WINDOW_SIZE;
+    dynNotchMaxHz = fftSamplingRateHz / 2 - fftBinWidthHz;
+
+    for (int i = 0; i < FFT_WINDOW_SIZE; i++) {
+        hanning[i] = 0.5f - 0.5f * cosf(2 * M_PIf * i / (FFT_WINDOW_SIZE - 1));
+        bitReversed[i] = reverseBits(i);
+    }
+    for (int i = 0; i < FFT_BIN_COUNT; i++) {
+        twiddleCos[i] = cosf(2 * M_PIf * i / FFT_WINDOW_SIZE);
+        twiddleSin[i] = -sinf(2 * M_PIf * i / FFT_WINDOW_SIZE);
+    }
+
+    dynNotch[0] = gyroConfig->gyro_soft_notch_hz_1 ? notchFilter1 : NULL;
+    dynNotch[1] = gyroConfig->gyro_soft_notch_hz_2 ? notchFilter2 : NULL;
+    dynNotchCenterHz[0] = dynNotchPeakHz[0] = gyroConfig->gyro_soft_notch_hz_1;
+    dynNotchCenterHz[1] = dynNotchPeakHz[1] = gyroConfig->gyro_soft_notch_hz_2;
+    if (dynNotch[0]) {
+        dynNotchQ[0] = filterGetNotchQ(gyroConfig->gyro_soft_notch_hz_1, gyroConfig->gyro_soft_notch_cutoff_1);
+    }
+    if (dynNotch[1]) {
+        dynNotchQ[1] = filterGetNotchQ(gyroConfig->gyro_soft_notch_hz_2, gyroConfig->gyro_soft_notch_cutoff_2);
+    }
+
+    decimationCount = 0;
+    memset(decimationSum, 0, sizeof(decimationSum));
+    sampleIndex = 0;
+    sampleWindowFull = false;
+    fftAxis = 0;
+    fftStep = STEP_WINDOW;
+}
+
+static void gyroDataAnalyseWindow(void)
+{
+    // oldest sample first, windowed and stored in bit reversed order for the in place FFT
+    for (int i = 0; i < FFT_WINDOW_SIZE; i++) {
+        const uint8_t sample = (sampleIndex + i) % FFT_WINDOW_SIZE;
+        fftRe[bitReversed[i]] = sampleWindow[fftAxis][sample] * hanning[i];
+        fftIm[bitReversed[i]] = 0.0f;
+    }
+}
+
+static void gyroDataAnalyseFftStage(uint8_t stage)
+{
+    const int span = 1 << (stage + 1);
+    const int half = span / 2;
+    const int twiddleStride = FFT_WINDOW_SIZE / span;
+
+    for (int start = 0; start < FFT_WINDOW_SIZE; start += span) {
+        for (int j = 0; j < half; j++) {
+            const float wRe = twiddleCos[j * twiddleStride];
+            const float wIm = twiddleSin[j * twiddleStride];
+            const int top = start + j;
+            const int bottom = top + half;
+            const float tRe = wRe * fftRe[bottom] - wIm * fftIm[bottom];
+            const float tIm = wRe * fftIm[bottom] + wIm * fftRe[bottom];
+            fftRe[bottom] = fftRe[top] - tRe;
+            fftIm[bottom] = fftIm[top] - tIm;
+            fftRe[top] += tRe;
+            fftIm[top] += tIm;
+        }
+    }
+}
+
+static void gyroDataAnalyseFindPeaks(void)
+{
+    const int minBin = MAX(1, lrintf(FFT_MIN_FREQ_HZ / fftBinWidthHz));
+    float power[FFT_BIN_COUNT];
+    float powerSum = 0.0f;
+
+    for (int bin = minBin; bin < FFT_BIN_COUNT; bin++) {
+        power[bin] = sq(fftRe[bin]) + sq(fftIm[bin]);
+        powerSum += power[bin];
+    }
+
+    // the two strongest bins, at least two bins apart
+    int peakBin[2] = { 0, 0 };
+    for (int bin = minBin; bin < FFT_BIN_COUNT; bin++) {
+        if (!peakBin[0] || power[bin] > power[peakBin[0]]) {
+            peakBin[0] = bin;
+        }
+    }
+    for (int bin = minBin; bin < FFT_BIN_COUNT; bin++) {
+        if (ABS(bin - peakBin[0]) > 2 && (!peakBin[1] || power[bin] > power[peakBin[1]])) {
+            peakBin[1] = bin;
+        }
+    }
+
+    // noise floor from the bins outside the strongest peak
+    int noiseBinCount = FFT_BIN_COUNT - minBin;
+    for (int bin = MAX(minBin, peakBin[0] - 1); bin <= MIN(FFT_BIN_COUNT - 1, peakBin[0] + 1); bin++) {
+        powerSum -= power[bin];
+        noiseBinCount--;
+    }
+    const float threshold = FFT_PEAK_THRESHOLD * powerSum / MAX(1, noiseBinCount);
+
+    for (int i = 0; i < 2; i++) {
+        const int bin = peakBin[i];
+        if (!bin || power[bin] < threshold) {
+            continue;
+        }
+        // power weighted centre of the peak and its neighbours
+        float weightedBin = bin * power[bin];
+        float weight = power[bin];
+        if (bin > minBin) {
+            weightedBin += (bin - 1) * power[bin - 1];
+            weight += power[bin - 1];
+        }
+        if (bin < FFT_BIN_COUNT - 1) {
+            weightedBin += (bin + 1) * power[bin + 1];
+            weight += power[bin + 1];
+        }
+        dynNotchPeakHz[i] = constrainf(weightedBin / weight * fftBinWidthHz, FFT_MIN_FREQ_HZ, dynNotchMaxHz);
+    }
+
+    // the strongest peak goes to the notch already closest to it
+    if (ABS(dynNotchPeakHz[0] - dynNotchCenterHz[1]) + ABS(dynNotchPeakHz[1] - dynNotchCenterHz[0]) <
+        ABS(dynNotchPeakHz[0] - dynNotchCenterHz[0]) + ABS(dynNotchPeakHz[1] - dynNotchCenterHz[1])) {
+        const float swap = dynNotchPeakHz[0];
+        dynNotchPeakHz[0] = dynNotchPeakHz[1];
+        dynNotchPeakHz[1] = swap;
+    }
+
+    DEBUG_SET(DEBUG_FFT, 2, lrintf(peakBin[0] * fftBinWidthHz));
+    DEBUG_SET(DEBUG_FFT, 3, fftAxis);
+}
+
+static void gyroDataAnalyseUpdateNotch(uint8_t notch)
+{
+    if (!dynNotch[notch]) {
+        return;
+    }
+    dynNotchCenterHz[notch] += DYN_NOTCH_SMOOTHING * (dynNotchPeakHz[notch] - dynNotchCenterHz[notch]);
+    biquadFilter3Update(dynNotch[notch], dynNotchCenterHz[notch], gyro.sampleLooptime, dynNotchQ[notch], FILTER_NOTCH);
+
+    DEBUG_SET(DEBUG_FFT, notch, lrintf(dynNotchCenterHz[notch]));
+}
+
+/*
+ * Called once per gyro cycle with the soft LPF filtered gyro data, i.e. what the notches see.
+ */
+void gyroDataAnalyse(const float *gyroADCf)
+{
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        decimationSum[axis] += gyroADCf[axis];
+    }
+    if (++decimationCount == decimation) {
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sampleWindow[axis][sampleIndex] = decimationSum[axis] / decimation;
+            decimationSum[axis] = 0.0f;
+        }
+        decimationCount = 0;
+        if (++sampleIndex == FFT_WINDOW_SIZE) {
+            sampleIndex = 0;
+            sampleWindowFull = true;
+        }
+    }
+
+    if (!sampleWindowFull) {
+        return;
+    }
+
+    switch (fftStep) {
+    case STEP_WINDOW:
+        gyroDataAnalyseWindow();
+        break;
+    case STEP_FIND_PEAKS:
+        gyroDataAnalyseFindPeaks();
+        break;
+    case STEP_UPDATE_NOTCH_1:
+        gyroDataAnalyseUpdateNotch(0);
+        break;
+    case STEP_UPDATE_NOTCH_2:
+        gyroDataAnalyseUpdateNotch(1);
+        break;
+    default:
+        gyroDataAnalyseFftStage(fftStep - STEP_FFT_FIRST_STAGE);
+        break;
+    }
+
+    if (++fftStep == STEP_COUNT) {
+        fftStep = STEP_WINDOW;
+        fftAxis = (fftAxis + 1) % XYZ_AXIS_COUNT;
+    }
+}
+
+#endif
@@ -88,15 +88,5 @@ bool sensorsAutodetect(const gyroConfig_t *gyroConfig,
     UNUSED(sonarConfig);
 #endif
 
-    if (gyroConfig->gyro_align != ALIGN_DEFAULT) {
-        gyro.dev.gyroAlign = gyroConfig->gyro_align;
-    }
-    if (accelerometerConfig->acc_align != ALIGN_DEFAULT) {
-        acc.dev.accAlign = accelerometerConfig->acc_align;
-    }
-    if (compassConfig->mag_align != ALIGN_DEFAULT) {
-        mag.dev.magAlign = compassConfig->mag_align;
-    }
-
     return true;
 }
@@ -0,0 +1,126 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Gyro notches following the motors.
+ *
+ * Each motor's eRPM, from bidirectional DSHOT or the ESC sensor, gives its rotation frequency,
+ * and a notch is kept on it and on each of the next harmonics, up to 4 motors x 3 harmonics.
+ * All notches are retuned every gyro cycle and run in one notchFilterBank_t, so the coefficients
+ * of a stage are computed once for the three axes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "platform.h"
+
+#ifdef USE_RPM_FILTER
+
+#include "build/debug.h"
+
+#include "common/filter.h"
+#include "common/maths.h"
+
+#include "config/config_master.h"
+#include "config/feature.h"
+
+#include "drivers/pwm_output.h"
+
+#include "flight/mixer.h"
+
+#include "sensors/esc_sensor.h"
+#include "sensors/gyro.h"
+#include "sensors/rpm_filter.h"
+
+#define RPM_FILTER_RPM_LPF_HZ   150     // smooths the eRPM steps of the telemetry
+
+static notchFilterBank_t rpmNotches;
+static pt1Filter_t motorFrequencyLpf[RPM_FILTER_MAX_MOTORS];
+static float motorFrequencyHz[RPM_FILTER_MAX_MOTORS];
+static uint8_t motorCount;
+static uint8_t harmonicCount;
+static float erpmToHz;
+static float notchQ;
+static float minHz;
+static float maxHz;
+static uint32_t looptime;
+
+void rpmFilterInit(const gyroConfig_t *gyroConfig, uint32_t sampleLooptime)
+{
+    harmonicCount = MIN(gyroConfig->gyro_rpm_notch_harmonics, RPM_FILTER_MAX_HARMONICS);
+    motorCount = MIN(getMotorCount(), RPM_FILTER_MAX_MOTORS);
+    if (!harmonicCount || !motorCount) {
+        rpmNotches.stageCount = 0;
+        return;
+    }
+
+    looptime = sampleLooptime;
+    notchQ = gyroConfig->gyro_rpm_notch_q / 100.0f;
+    minHz = gyroConfig->gyro_rpm_notch_min_hz;
+    maxHz = 0.45f * 1000000.0f / sampleLooptime;
+    // telemetry is eRPM / 100, the rotor turns once per pole pair
+    erpmToHz = 100.0f / 60.0f / MAX(motorConfig()->motorPoleCount / 2, 1);
+
+    const float dT = sampleLooptime * 0.000001f;
+    for (int motor = 0; motor < motorCount; motor++) {
+        pt1FilterInit(&motorFrequencyLpf[motor], RPM_FILTER_RPM_LPF_HZ, dT);
+        motorFrequencyHz[motor] = 0;
+    }
+
+    notchFilterBankInit(&rpmNotches, motorCount * harmonicCount, minHz, looptime, notchQ);
+}
+
+static uint16_t getMotorErpm100(uint8_t motor)
+{
+#ifdef USE_DSHOT_TELEMETRY
+    if (useDshotTelemetry) {
+        return getDshotTelemetry(motor);
+    }
+#endif
+#ifdef USE_ESC_SENSOR
+    if (feature(FEATURE_ESC_SENSOR)) {
+        return getEscSensorData(motor).rpm;
+    }
+#endif
+    return 0;
+}
+
+void rpmFilterUpdate(void)
+{
+    if (!rpmNotches.stageCount) {
+        return;
+    }
+
+    for (int motor = 0; motor < motorCount; motor++) {
+        motorFrequencyHz[motor] = pt1FilterApply(&motorFrequencyLpf[motor], getMotorErpm100(motor) * erpmToHz);
+        DEBUG_SET(DEBUG_RPM_FILTER, motor, lrintf(motorFrequencyHz[motor]));
+
+        // a stopped or slow motor parks its notches at the bottom of the range
+        for (int harmonic = 0; harmonic < harmonicCount; harmonic++) {
+            const float frequency = constrainf(motorFrequencyHz[motor] * (harmonic + 1), minHz, maxHz);
+            notchFilterBankUpdate(&rpmNotches, harmonic * motorCount + motor, frequency, looptime, notchQ);
+        }
+    }
+}
+
+void rpmFilterApply(float *data)
+{
+    notchFilterBankApply(&rpmNotches, data);
+}
+#endif
@@ -46,6 +46,7 @@ STATIC_UNIT_TESTED int16_t sonarMaxTiltDeciDegrees;
 float sonarMaxTiltCos;
 
 static int32_t calculatedAltitude;
+static uint32_t sonarSampleCount;
 
 void sonarInit(const sonarConfig_t *sonarConfig)
 {
@@ -64,26 +65,16 @@ void sonarInit(const sonarConfig_t *sonarConfig)
 
 #define DISTANCE_SAMPLES_MEDIAN 5
 
+static slidingWindow_t sonarMedianWindow = { .size = DISTANCE_SAMPLES_MEDIAN };
+
 static int32_t applySonarMedianFilter(int32_t newSonarReading)
 {
-    static int32_t sonarFilterSamples[DISTANCE_SAMPLES_MEDIAN];
-    static int currentFilterSampleIndex = 0;
-    static bool medianFilterReady = false;
-    int nextSampleIndex;
-
     if (newSonarReading > SONAR_OUT_OF_RANGE) // only accept samples that are in range
     {
-        nextSampleIndex = (currentFilterSampleIndex + 1);
-        if (nextSampleIndex == DISTANCE_SAMPLES_MEDIAN) {
-            nextSampleIndex = 0;
-            medianFilterReady = true;
-        }
-
-        sonarFilterSamples[currentFilterSampleIndex] = newSonarReading;
-        currentFilterSampleIndex = nextSampleIndex;
+        slidingWindowPush(&sonarMedianWindow, newSonarReading);
     }
-    if (medianFilterReady)
-        return quickMedianFilter5(sonarFilterSamples);
+    if (slidingWindowIsFull(&sonarMedianWindow))
+        return slidingWindowMedian(&sonarMedianWindow);
     else
         return newSonarReading;
 }
@@ -92,6 +83,16 @@ void sonarUpdate(timeUs_t currentTimeUs)
 {
     UNUSED(currentTimeUs);
     hcsr04_start_reading();
+    // the pulses are far enough apart for the echo of the previous one to have come back
+    sonarSampleCount++;
+}
+
+/**
+ * Get the number of sonar pulses sent so far, a change tells the altitude estimator a new distance has been measured.
+ */
+uint32_t sonarGetSampleCount(void)
+{
+    return sonarSampleCount;
 }
 
 /**
@@ -32,5 +32,6 @@ extern int16_t sonarMaxAltWithTiltCm;
 void sonarInit(const sonarConfig_t *sonarConfig);
 void sonarUpdate(timeUs_t currentTimeUs);
 int32_t sonarRead(void);
+uint32_t sonarGetSampleCount(void);
 int32_t sonarCalculateAltitude(int32_t sonarDistance, float cosTiltAngle);
 int32_t sonarGetLatestAltitude(void);
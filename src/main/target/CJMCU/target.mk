@@ -6,6 +6,7 @@ TARGET_SRC = \
             drivers/accgyro_mpu6050.c \
             drivers/compass_hmc5883l.c \
             blackbox/blackbox.c \
+            blackbox/blackbox_encoding.c \
             blackbox/blackbox_io.c \
             telemetry/telemetry.c \
             telemetry/ltm.c
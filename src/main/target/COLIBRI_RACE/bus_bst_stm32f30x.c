@@ -12,6 +12,8 @@
 
 #include "build/build_config.h"
 
+#include "common/maths.h"
+
 #include "drivers/nvic.h"
 #include "bus_bst.h"
 
@@ -97,7 +99,6 @@ void I2C_EV_IRQHandler()
         readData[bufferPointer] = data;
         if(bufferPointer > 1) {
             if(readData[1]+1 == bufferPointer) {
-                crc8Cal(0);
                 bstProcessInCommand();
             } else {
                 crc8Cal(data);
@@ -121,7 +122,6 @@ void I2C_EV_IRQHandler()
                 }
                 if(writeData[0] == currentWriteBufferPointer) {
                     receiverAddress = false;
-                    crc8Cal(0);
                     I2C_SendData(BSTx, (uint8_t) CRC8);
                        I2C_ITConfig(BSTx, I2C_IT_TXI, DISABLE);
                 } else {
@@ -312,9 +312,30 @@ uint16_t bstGetErrorCounter(void)
 
 /*************************************************************************************************/
 
+/*
+ * Frames for the master side are queued with their CRC, so the task can compose them while another frame is still
+ * on the bus. bstMasterWriteLoop() moves the next one into dataBuffer once the bus is free.
+ */
+#define BST_MASTER_WRITE_QUEUE_SIZE 3
+
+static uint8_t masterWriteQueue[BST_MASTER_WRITE_QUEUE_SIZE][DATA_BUFFER_SIZE];
+static uint8_t masterWriteQueueHead = 0;
+static uint8_t masterWriteQueueTail = 0;
+
+static bool bstMasterWriteQueueEmpty(void)
+{
+    return masterWriteQueueHead == masterWriteQueueTail;
+}
+
+bool bstMasterWriteQueueFull(void)
+{
+    return (masterWriteQueueHead + 1) % BST_MASTER_WRITE_QUEUE_SIZE == masterWriteQueueTail;
+}
+
+// a frame is being sent or waiting to be
 bool bstWriteBusy(void)
 {
-    if(bstWriteDataLen)
+    if(bstWriteDataLen || !bstMasterWriteQueueEmpty())
         return true;
     else
         return false;
@@ -322,30 +343,39 @@ bool bstWriteBusy(void)
 
 bool bstMasterWrite(uint8_t* data)
 {
-    if(bstWriteDataLen==0) {
-        CRC8 = 0;
-        dataBufferPointer = 0;
-        dataBuffer[0] = *data;
-        dataBuffer[1] = *(data+1);
-        bstWriteDataLen = dataBuffer[1] + 2;
-        for(uint8_t i=2; i<bstWriteDataLen; i++) {
-            if(i==(bstWriteDataLen-1)) {
-                crc8Cal(0);
-                dataBuffer[i] = CRC8;
-            } else {
-                dataBuffer[i] = *(data+i);
-                crc8Cal((uint8_t)dataBuffer[i]);
-            }
+    const uint8_t len = *(data+1) + 2;
+
+    if(bstMasterWriteQueueFull() || len > DATA_BUFFER_SIZE) {
+        return false;
+    }
+
+    uint8_t *frame = masterWriteQueue[masterWriteQueueHead];
+    CRC8 = 0;
+    frame[0] = *data;
+    frame[1] = *(data+1);
+    for(uint8_t i=2; i<len; i++) {
+        if(i==(len-1)) {
+            frame[i] = CRC8;
+        } else {
+            frame[i] = *(data+i);
+            crc8Cal((uint8_t)frame[i]);
         }
-        return true;
     }
-    return false;
+    masterWriteQueueHead = (masterWriteQueueHead + 1) % BST_MASTER_WRITE_QUEUE_SIZE;
+    return true;
 }
 
 void bstMasterWriteLoop(void)
 {
     static uint32_t bstMasterWriteTimeout = 0;
     uint32_t currentTime = micros();
+    if(bstWriteDataLen==0 && !bstMasterWriteQueueEmpty()) {
+        const uint8_t *frame = masterWriteQueue[masterWriteQueueTail];
+        memcpy(dataBuffer, frame, frame[1] + 2);
+        dataBufferPointer = 0;
+        bstWriteDataLen = frame[1] + 2;
+        masterWriteQueueTail = (masterWriteQueueTail + 1) % BST_MASTER_WRITE_QUEUE_SIZE;
+    }
     if(bstWriteDataLen && dataBufferPointer==0) {
         bool scl_set = false;
         if(BSTx == I2C1)
@@ -358,39 +388,20 @@ void bstMasterWriteLoop(void)
             dataBufferPointer = 1;
             bstMasterWriteTimeout = micros();
         }
-    } else if(currentTime>bstMasterWriteTimeout+BST_SHORT_TIMEOUT) {
+    } else if(bstWriteDataLen && currentTime>bstMasterWriteTimeout+BST_SHORT_TIMEOUT) {
+        // only a frame stuck on the bus times out, an idle bus used to be reset on every pass
         bstTimeoutUserCallback();
     }
 }
 
 /*************************************************************************************************/
+#if BST_CRC_POLYNOM != 0xD5
+#error "BST frames use the DVB-S2 CRC, polynomial 0xD5"
+#endif
+
+// CRC8 always holds the CRC of the bytes added since it was cleared, there is no flush with a zero byte
 void crc8Cal(uint8_t data_in)
 {
-    /* Polynom = x^8+x^7+x^6+x^4+x^2+1 = x^8+x^7+x^6+x^4+x^2+X^0 */
-    uint8_t Polynom = BST_CRC_POLYNOM;
-    bool MSB_Flag;
-
-    /* Step through each bit of the BYTE (8-bits) */
-    for (uint8_t i = 0; i < 8; i++) {
-        /* Clear the Flag */
-        MSB_Flag = false;
-
-        /* MSB_Set = 80; */
-        if (CRC8 & 0x80) {
-            MSB_Flag = true;
-        }
-
-        CRC8 <<= 1;
-
-        /* MSB_Set = 80; */
-        if (data_in & 0x80) {
-            CRC8++;
-        }
-        data_in <<= 1;
-
-        if (MSB_Flag == true) {
-            CRC8 ^= Polynom;
-        }
-    }
+    CRC8 = crc8_dvb_s2(CRC8, data_in);
 }
 #endif
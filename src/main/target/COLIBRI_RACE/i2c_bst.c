@@ -819,6 +819,7 @@ static bool bstSlaveProcessFeedbackCommand(uint8_t bstRequest)
             bstWrite8(0);                  // nav flag will come here
             break;
         case BST_GPSSVINFO:
+            gpsRequestSvInfo();
             bstWrite8(GPS_numCh);
             for (i = 0; i < GPS_numCh; i++){
                 bstWrite8(GPS_svinfo_chn[i]);
@@ -832,7 +833,7 @@ static bool bstSlaveProcessFeedbackCommand(uint8_t bstRequest)
             // output some useful QA statistics
             // debug[x] = ((hse_value / 1000000) * 1000) + (SystemCoreClock / 1000000);         // XX0YY [crystal clock : core clock]
 
-            for (i = 0; i < DEBUG16_VALUE_COUNT; i++)
+            for (i = 0; i < 4; i++)
                 bstWrite16(debug[i]);      // 4 variables are here for general monitoring purpose
             break;
 
@@ -1169,6 +1170,7 @@ static bool bstSlaveProcessWriteCommand(uint8_t bstWriteCommand)
                servoProfile()->servoConf[i].angleAtMax = bstRead8();
                servoProfile()->servoConf[i].forwardFromChannel = bstRead8();
                servoProfile()->servoConf[i].reversedSources = bstRead32();
+               servoCompileRules();
            }
 #endif
            break;
@@ -1516,11 +1518,12 @@ static uint8_t sendCounter = 0;
 void taskBstMasterProcess(timeUs_t currentTimeUs)
 {
     if(coreProReady) {
-        if(currentTimeUs >= next02hzUpdateAt_1 && !bstWriteBusy()) {
+        // the periodic frames are queued behind the one on the bus, GPS frames only fill an idle bus
+        if(currentTimeUs >= next02hzUpdateAt_1 && !bstMasterWriteQueueFull()) {
             writeFCModeToBST();
             next02hzUpdateAt_1 = currentTimeUs + UPDATE_AT_02HZ;
         }
-        if(currentTimeUs >= next20hzUpdateAt_1 && !bstWriteBusy()) {
+        if(currentTimeUs >= next20hzUpdateAt_1 && !bstMasterWriteQueueFull()) {
             if(sendCounter == 0)
                 writeRCChannelToBST();
             else if(sendCounter == 1)
@@ -60,6 +60,15 @@
 #define MPU_INT_EXTI            PC4
 #define USE_MPU_DATA_READY_SIGNAL
 
+// SPI1 burst reads of the gyro, started from the data ready interrupt
+#define USE_GYRO_DMA
+#define GYRO_DMA_CHANNEL_TX     DMA2_Stream3
+#define GYRO_DMA_CHANNEL_RX     DMA2_Stream0
+#define GYRO_DMA_CHANNEL        DMA_Channel_3
+#define GYRO_DMA_IRQ_HANDLER_ID DMA2_ST0_HANDLER
+// and run gyro -> PID -> motors from the DMA completion instead of the scheduler
+#define USE_PID_LOOP_INTERRUPT
+
 #define MAG
 #define USE_MAG_HMC5883
 #define MAG_HMC5883_ALIGN       CW90_DEG
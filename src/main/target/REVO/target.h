@@ -125,6 +125,12 @@
 #define M25P16_CS_PIN           PB3
 #define M25P16_SPI_INSTANCE     SPI3
 
+// The flash has SPI3 to itself, so page programs can be sent by DMA while the loop carries on
+#define M25P16_DMA_CHANNEL_TX               DMA1_Stream5
+#define M25P16_DMA_CHANNEL_TX_COMPLETE_FLAG DMA_FLAG_TCIF5
+#define M25P16_DMA_CLK                      RCC_AHB1Periph_DMA1
+#define M25P16_DMA_CHANNEL                  DMA_Channel_0
+
 #define USE_FLASHFS
 #define USE_FLASH_M25P16
 
@@ -0,0 +1,199 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The blackbox flash of the SITL target, in place of the M25P16 driver that flashfs calls. The contents are
+ * kept in memory and written through to a file, so a log survives the run and can be decoded like one read
+ * from a board. Programs and erases keep the chip busy for the typical M25P16 times, on whichever clock
+ * the simulation runs, so the blackbox sees the same back pressure as on a board.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/flash.h"
+#include "drivers/flash_m25p16.h"
+#include "drivers/system.h"
+
+#include "target/SITL/sitl.h"
+
+#define FLASH_FILE_PAGE_PROGRAM_US      640
+#define FLASH_FILE_SECTOR_ERASE_US      600000
+#define FLASH_FILE_BULK_ERASE_US        13000000
+
+const char *sitlFlashPath = "flash.bin";
+
+static flashGeometry_t geometry = {.pageSize = M25P16_PAGESIZE};
+
+static uint8_t *flashData;
+static int flashFd = -1;
+static uint32_t busyUntilUs;
+static bool busy;
+static uint32_t programAddress;
+
+static void flashFileWriteThrough(uint32_t address, uint32_t length)
+{
+    if (pwrite(flashFd, flashData + address, length, address) != (ssize_t)length) {
+        perror(sitlFlashPath);
+    }
+}
+
+static void flashFileSetBusy(uint32_t durationUs)
+{
+    busyUntilUs = micros() + durationUs;
+    busy = true;
+}
+
+bool m25p16_init(flashConfig_t *flashConfig)
+{
+    UNUSED(flashConfig);
+
+    geometry.sectors = SITL_FLASH_SECTOR_COUNT;
+    geometry.sectorSize = SITL_FLASH_SECTOR_SIZE;
+    geometry.pagesPerSector = geometry.sectorSize / geometry.pageSize;
+    geometry.totalSize = geometry.sectorSize * geometry.sectors;
+
+    flashData = malloc(geometry.totalSize);
+    flashFd = open(sitlFlashPath, O_RDWR | O_CREAT, 0644);
+    if (!flashData || flashFd < 0) {
+        perror(sitlFlashPath);
+        geometry.sectors = 0;
+        geometry.totalSize = 0;
+        return false;
+    }
+
+    // a new or short file reads as erased flash
+    memset(flashData, 0xFF, geometry.totalSize);
+    const ssize_t length = read(flashFd, flashData, geometry.totalSize);
+    if (length < (ssize_t)geometry.totalSize) {
+        const uint32_t start = length > 0 ? length : 0;
+        flashFileWriteThrough(start, geometry.totalSize - start);
+    }
+    return true;
+}
+
+bool m25p16_isReady(void)
+{
+    if (busy && (int32_t)(micros() - busyUntilUs) >= 0) {
+        busy = false;
+    }
+    return !busy;
+}
+
+bool m25p16_waitForReady(uint32_t timeoutMillis)
+{
+    const uint32_t time = millis();
+    while (!m25p16_isReady()) {
+        if (millis() - time > timeoutMillis) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void m25p16_eraseSector(uint32_t address)
+{
+    m25p16_waitForReady(FLASH_FILE_SECTOR_ERASE_US / 1000);
+
+    const uint32_t start = address - address % geometry.sectorSize;
+    if (start < geometry.totalSize) {
+        memset(flashData + start, 0xFF, geometry.sectorSize);
+        flashFileWriteThrough(start, geometry.sectorSize);
+    }
+    flashFileSetBusy(FLASH_FILE_SECTOR_ERASE_US);
+}
+
+void m25p16_eraseCompletely(void)
+{
+    m25p16_waitForReady(FLASH_FILE_BULK_ERASE_US / 1000);
+
+    memset(flashData, 0xFF, geometry.totalSize);
+    flashFileWriteThrough(0, geometry.totalSize);
+    flashFileSetBusy(FLASH_FILE_BULK_ERASE_US);
+}
+
+void m25p16_pageProgramBegin(uint32_t address)
+{
+    m25p16_waitForReady(FLASH_FILE_SECTOR_ERASE_US / 1000);
+    programAddress = address;
+}
+
+// like the chip, programming can only clear bits
+void m25p16_pageProgramContinue(const uint8_t *data, int length)
+{
+    if (programAddress >= geometry.totalSize) {
+        return;
+    }
+    const uint32_t count = MIN((uint32_t)length, geometry.totalSize - programAddress);
+    for (uint32_t i = 0; i < count; i++) {
+        flashData[programAddress + i] &= data[i];
+    }
+    flashFileWriteThrough(programAddress, count);
+    programAddress += count;
+}
+
+void m25p16_pageProgramFinish(void)
+{
+    flashFileSetBusy(FLASH_FILE_PAGE_PROGRAM_US);
+}
+
+void m25p16_pageProgram(uint32_t address, const uint8_t *data, int length)
+{
+    m25p16_pageProgramBegin(address);
+    m25p16_pageProgramContinue(data, length);
+    m25p16_pageProgramFinish();
+}
+
+bool m25p16_pageProgramStart(uint32_t address, const uint8_t *data, int length)
+{
+    if (!m25p16_isReady()) {
+        return false;
+    }
+    m25p16_pageProgram(address, data, length);
+    return true;
+}
+
+bool m25p16_isTransferComplete(void)
+{
+    return true;
+}
+
+int m25p16_readBytes(uint32_t address, uint8_t *buffer, int length)
+{
+    if (!m25p16_waitForReady(FLASH_FILE_SECTOR_ERASE_US / 1000) || address >= geometry.totalSize) {
+        return 0;
+    }
+    const uint32_t count = MIN((uint32_t)length, geometry.totalSize - address);
+    memcpy(buffer, flashData + address, count);
+    return count;
+}
+
+const flashGeometry_t *m25p16_getGeometry(void)
+{
+    return &geometry;
+}
@@ -0,0 +1,327 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The SITL UARTs. Each one listens on a TCP port on the loopback interface and takes one client at a time,
+ * UART1 on the base port and the others on the ports after it. The sockets are non-blocking and are polled
+ * when the firmware reads a port, and every SITL_TCP_POLL_INTERVAL_US from the clock, which stands in for
+ * the receive interrupt of the ports that use a receive callback.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/serial.h"
+#include "drivers/serial_uart.h"
+#include "drivers/serial_uart_impl.h"
+
+#include "io/serial.h"
+
+#include "target/SITL/sitl.h"
+
+typedef struct tcpPort_s {
+    serialPort_t port;
+    int listenFd;
+    int clientFd;
+} tcpPort_t;
+
+static tcpPort_t tcpPorts[SERIAL_PORT_COUNT];
+static bool tcpPolling;
+
+static const struct serialPortVTable tcpVTable;
+
+static uint32_t tcpRxBytesWaiting(const serialPort_t *instance)
+{
+    if (instance->rxBufferHead >= instance->rxBufferTail) {
+        return instance->rxBufferHead - instance->rxBufferTail;
+    }
+    return instance->rxBufferSize + instance->rxBufferHead - instance->rxBufferTail;
+}
+
+static uint32_t tcpTxBytesWaiting(const serialPort_t *instance)
+{
+    if (instance->txBufferHead >= instance->txBufferTail) {
+        return instance->txBufferHead - instance->txBufferTail;
+    }
+    return instance->txBufferSize + instance->txBufferHead - instance->txBufferTail;
+}
+
+static void tcpDisconnect(tcpPort_t *s)
+{
+    close(s->clientFd);
+    s->clientFd = -1;
+    s->port.txBufferTail = s->port.txBufferHead;
+}
+
+static void tcpAccept(tcpPort_t *s)
+{
+    const int fd = accept(s->listenFd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    s->clientFd = fd;
+    printf("sitl: UART%d connected\n", s->port.identifier - SERIAL_PORT_USART1 + 1);
+}
+
+// sends what the TX ring holds, as far as the socket takes it
+static void tcpFlush(tcpPort_t *s)
+{
+    serialPort_t *port = &s->port;
+
+    if (s->clientFd < 0) {
+        port->txBufferTail = port->txBufferHead;
+        return;
+    }
+    while (port->txBufferTail != port->txBufferHead) {
+        const uint32_t end = port->txBufferHead > port->txBufferTail ? port->txBufferHead : port->txBufferSize;
+        const ssize_t sent = send(s->clientFd, (const uint8_t *)port->txBuffer + port->txBufferTail, end - port->txBufferTail, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                tcpDisconnect(s);
+            }
+            return;
+        }
+        port->txBufferTail = (port->txBufferTail + sent) % port->txBufferSize;
+    }
+}
+
+// takes what arrived on the socket, into the RX ring or through the receive callback
+static void tcpReceive(tcpPort_t *s)
+{
+    serialPort_t *port = &s->port;
+
+    if (s->clientFd < 0) {
+        tcpAccept(s);
+        if (s->clientFd < 0) {
+            return;
+        }
+    }
+
+    uint8_t data[256];
+    uint32_t room = sizeof(data);
+    if (!port->rxCallback) {
+        room = MIN(room, port->rxBufferSize - 1 - tcpRxBytesWaiting(port));
+        if (!room) {
+            return;
+        }
+    }
+
+    const ssize_t received = recv(s->clientFd, data, room, 0);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        printf("sitl: UART%d disconnected\n", port->identifier - SERIAL_PORT_USART1 + 1);
+        tcpDisconnect(s);
+        return;
+    }
+
+    for (ssize_t i = 0; i < received; i++) {
+        if (port->rxCallback) {
+            port->rxCallback(data[i]);
+        } else {
+            port->rxBuffer[port->rxBufferHead] = data[i];
+            port->rxBufferHead = (port->rxBufferHead + 1) % port->rxBufferSize;
+        }
+    }
+}
+
+static void tcpPoll(tcpPort_t *s)
+{
+    if (s->listenFd < 0) {
+        return;
+    }
+    tcpReceive(s);
+    tcpFlush(s);
+}
+
+void sitlTcpPoll(void)
+{
+    // a receive callback that reads the time would otherwise poll from inside the poll
+    if (tcpPolling) {
+        return;
+    }
+    tcpPolling = true;
+    for (int i = 0; i < SERIAL_PORT_COUNT; i++) {
+        if (tcpPorts[i].port.vTable) {
+            tcpPoll(&tcpPorts[i]);
+        }
+    }
+    tcpPolling = false;
+}
+
+void sitlTcpClose(void)
+{
+    for (int i = 0; i < SERIAL_PORT_COUNT; i++) {
+        tcpPort_t *s = &tcpPorts[i];
+        if (s->port.vTable) {
+            tcpFlush(s);
+            if (s->clientFd >= 0) {
+                close(s->clientFd);
+            }
+            close(s->listenFd);
+        }
+    }
+}
+
+static int tcpListen(uint16_t port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 1) < 0) {
+        perror("sitl: listen");
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr rxCallback, uint32_t baudRate, portMode_t mode, portOptions_t options)
+{
+    const int uartIndex = (uintptr_t)USARTx - 1;
+    if (uartIndex < 0 || uartIndex >= SERIAL_PORT_COUNT) {
+        return NULL;
+    }
+
+    tcpPort_t *s = &tcpPorts[uartIndex];
+    if (!s->port.vTable) {
+        s->port.identifier = SERIAL_PORT_USART1 + uartIndex;
+        if (!uartAssignBuffers(&s->port, uartIndex)) {
+            return NULL;
+        }
+        s->clientFd = -1;
+        s->listenFd = tcpListen(sitlTcpBasePort() + uartIndex);
+        if (s->listenFd < 0) {
+            return NULL;
+        }
+        s->port.vTable = &tcpVTable;
+    }
+
+    s->port.rxCallback = rxCallback;
+    s->port.baudRate = baudRate;
+    s->port.mode = mode;
+    s->port.options = options;
+    s->port.rxBufferHead = s->port.rxBufferTail = 0;
+    s->port.txBufferHead = s->port.txBufferTail = 0;
+
+    return &s->port;
+}
+
+static void tcpWrite(serialPort_t *instance, uint8_t ch)
+{
+    tcpPort_t *s = (tcpPort_t *)instance;
+
+    // the host is fast enough to drop a client that can't keep up rather than wait for it
+    if (tcpTxBytesWaiting(instance) + 1 >= instance->txBufferSize) {
+        tcpFlush(s);
+        if (tcpTxBytesWaiting(instance) + 1 >= instance->txBufferSize) {
+            return;
+        }
+    }
+    instance->txBuffer[instance->txBufferHead] = ch;
+    instance->txBufferHead = (instance->txBufferHead + 1) % instance->txBufferSize;
+}
+
+static void tcpWriteBuf(serialPort_t *instance, const void *data, int count)
+{
+    const uint8_t *p = data;
+    while (count--) {
+        tcpWrite(instance, *p++);
+    }
+    tcpFlush((tcpPort_t *)instance);
+}
+
+static uint32_t tcpTotalRxWaiting(const serialPort_t *instance)
+{
+    tcpPort_t *s = &tcpPorts[instance->identifier - SERIAL_PORT_USART1];
+    if (!tcpPolling) {
+        tcpReceive(s);
+    }
+    return tcpRxBytesWaiting(instance);
+}
+
+static uint32_t tcpTotalTxFree(const serialPort_t *instance)
+{
+    return instance->txBufferSize - 1 - tcpTxBytesWaiting(instance);
+}
+
+static uint8_t tcpRead(serialPort_t *instance)
+{
+    const uint8_t ch = instance->rxBuffer[instance->rxBufferTail];
+    instance->rxBufferTail = (instance->rxBufferTail + 1) % instance->rxBufferSize;
+    return ch;
+}
+
+static void tcpSetBaudRate(serialPort_t *instance, uint32_t baudRate)
+{
+    instance->baudRate = baudRate;
+}
+
+static bool tcpIsTransmitBufferEmpty(const serialPort_t *instance)
+{
+    tcpFlush(&tcpPorts[instance->identifier - SERIAL_PORT_USART1]);
+    return instance->txBufferHead == instance->txBufferTail;
+}
+
+static void tcpSetMode(serialPort_t *instance, portMode_t mode)
+{
+    instance->mode = mode;
+}
+
+static void tcpEndWrite(serialPort_t *instance)
+{
+    tcpFlush((tcpPort_t *)instance);
+}
+
+static const struct serialPortVTable tcpVTable = {
+    .serialWrite = tcpWrite,
+    .serialTotalRxWaiting = tcpTotalRxWaiting,
+    .serialTotalTxFree = tcpTotalTxFree,
+    .serialRead = tcpRead,
+    .serialSetBaudRate = tcpSetBaudRate,
+    .isSerialTransmitBufferEmpty = tcpIsTransmitBufferEmpty,
+    .setMode = tcpSetMode,
+    .writeBuf = tcpWriteBuf,
+    .beginWrite = NULL,
+    .endWrite = tcpEndWrite,
+};
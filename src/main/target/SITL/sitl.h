@@ -0,0 +1,32 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define SITL_TCP_BASE_PORT          5761
+#define SITL_TCP_POLL_INTERVAL_US   100
+
+extern const char *sitlFlashPath;
+
+bool sitlParseArgs(int argc, char *argv[]);
+
+uint16_t sitlTcpBasePort(void);
+void sitlTcpPoll(void);
+void sitlTcpClose(void);
+
+uint16_t sitlMotorValue(uint8_t index);
+uint16_t sitlServoValue(uint8_t index);
@@ -0,0 +1,683 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The simulated system for the SITL target: time, reset, the config flash and the peripherals that have
+ * nothing to simulate. The firmware runs on a single host thread, the TCP serial ports and the replay
+ * are polled from the firmware's own calls.
+ *
+ * There are two clocks. By default time is read from the host's monotonic clock, which is what the
+ * scheduler load and jitter figures are measured against. In deterministic mode, which a replay always
+ * runs in, time only moves when the firmware looks at it or waits: every call to micros() or millis()
+ * costs SITL_TIME_CALL_COST_US, and a delay advances the clock by its length. The same build, config and
+ * replay then always give the same run, down to the blackbox log. The task execution times and system load
+ * in the summary of a deterministic run count the looks at the time each task made, not the work it did,
+ * so they only compare runs of the same code; use the host clock to measure load.
+ *
+ * A replay file holds one sensor sample per line, as whitespace separated integers in raw sensor units:
+ *   timeUs gyroX gyroY gyroZ accX accY accZ [pressurePa temperature [magX magY magZ]]
+ * Lines starting with '#' are skipped. Each sample is handed to the fake sensor drivers once the
+ * simulated time reaches it, and the run ends after the last one unless --duration says otherwise.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+#include "common/utils.h"
+
+#include "drivers/accgyro_fake.h"
+#include "drivers/adc.h"
+#include "drivers/barometer_fake.h"
+#include "drivers/bus_i2c.h"
+#include "drivers/compass_fake.h"
+#include "drivers/dma.h"
+#include "drivers/pwm_output.h"
+#include "drivers/rx_pwm.h"
+#include "drivers/stack_check.h"
+#include "drivers/system.h"
+#include "drivers/timer.h"
+
+#include "io/flashfs.h"
+
+#include "scheduler/scheduler.h"
+
+#include "target/SITL/sitl.h"
+
+#define SITL_TIME_CALL_COST_US      1       // deterministic clock advance for every look at the time
+#define SITL_IDLE_SLEEP_US          10
+#define SITL_REST_ACC_1G            256     // the fake accelerometer keeps the default scale
+#define SITL_CONFIG_FLASH_SIZE      (FLASH_PAGE_SIZE * 2)
+
+typedef struct sitlReplaySample_s {
+    uint64_t timeUs;
+    int32_t values[12];
+    int count;
+} sitlReplaySample_t;
+
+typedef struct sitlState_s {
+    bool deterministic;
+    uint64_t durationUs;            // 0 runs until stopped
+    const char *replayPath;
+    const char *eepromPath;
+    uint16_t tcpBasePort;
+    char **argv;
+
+    uint64_t simulatedTimeUs;
+    struct timespec startTime;
+
+    FILE *replay;
+    sitlReplaySample_t nextSample;
+    bool replayPending;
+    bool stopping;
+
+    uint64_t lastPollUs;
+    uint64_t lastTickMs;
+    bool inTimeEvents;
+} sitlState_t;
+
+static sitlState_t sitl = {
+    .eepromPath = "eeprom.bin",
+    .tcpBasePort = SITL_TCP_BASE_PORT,
+};
+
+uint32_t SystemCoreClock = 1000000000;
+uint32_t hse_value = 0;
+uint32_t cachedRccCsrValue = 0;
+
+uint8_t sitlGpioPorts[4 * 0x400] __attribute__((aligned(4)));
+uint8_t sitlConfigFlash[SITL_CONFIG_FLASH_SIZE] __attribute__((aligned(4)));
+
+static sysTickCallbackFunc *sysTickCallback;
+
+static void sitlUsage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --deterministic       run on simulated time\n"
+        "  --replay FILE         feed the sensors from FILE, implies --deterministic\n"
+        "  --duration SECONDS    stop after this long and print the scheduler summary\n"
+        "  --eeprom FILE         config storage, default %s\n"
+        "  --flash FILE          blackbox flash, default %s\n"
+        "  --port PORT           TCP port of UART1, the others follow, default %d\n",
+        name, sitl.eepromPath, sitlFlashPath, SITL_TCP_BASE_PORT);
+}
+
+bool sitlParseArgs(int argc, char *argv[])
+{
+    sitl.argv = argv;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--deterministic")) {
+            sitl.deterministic = true;
+            continue;
+        }
+        if (!value) {
+            sitlUsage(argv[0]);
+            return false;
+        }
+        if (!strcmp(arg, "--replay")) {
+            sitl.replayPath = value;
+            sitl.deterministic = true;
+        } else if (!strcmp(arg, "--duration")) {
+            sitl.durationUs = (uint64_t)(strtod(value, NULL) * (double)1000000);
+        } else if (!strcmp(arg, "--eeprom")) {
+            sitl.eepromPath = value;
+        } else if (!strcmp(arg, "--flash")) {
+            sitlFlashPath = value;
+        } else if (!strcmp(arg, "--port")) {
+            sitl.tcpBasePort = atoi(value);
+        } else {
+            sitlUsage(argv[0]);
+            return false;
+        }
+        i++;
+    }
+
+    if (sitl.replayPath) {
+        sitl.replay = fopen(sitl.replayPath, "r");
+        if (!sitl.replay) {
+            perror(sitl.replayPath);
+            return false;
+        }
+    }
+    return true;
+}
+
+uint16_t sitlTcpBasePort(void)
+{
+    return sitl.tcpBasePort;
+}
+
+static uint64_t sitlHostTimeUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - sitl.startTime.tv_sec) * 1000000 + (now.tv_nsec - sitl.startTime.tv_nsec) / 1000;
+}
+
+static bool sitlReadReplaySample(sitlReplaySample_t *sample)
+{
+    char line[256];
+
+    while (fgets(line, sizeof(line), sitl.replay)) {
+        if (line[0] == '#') {
+            continue;
+        }
+        unsigned long long timeUs;
+        int32_t *v = sample->values;
+        const int count = sscanf(line, "%llu %d %d %d %d %d %d %d %d %d %d %d %d", &timeUs,
+            &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11]);
+        if (count >= 7) {
+            sample->timeUs = timeUs;
+            sample->count = count - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sitlApplyReplaySample(const sitlReplaySample_t *sample)
+{
+    const int32_t *v = sample->values;
+
+    fakeGyroSet(v[0], v[1], v[2]);
+    fakeAccSet(v[3], v[4], v[5]);
+    if (sample->count >= 8) {
+        fakeBaroSet(v[6], v[7]);
+    }
+    if (sample->count >= 11) {
+        fakeMagSet(v[8], v[9], v[10]);
+    }
+}
+
+static void sitlPrintSummary(uint64_t timeUs)
+{
+    printf("sitl: %llu.%06llu s, system load %d.%02d\n", (unsigned long long)(timeUs / 1000000),
+        (unsigned long long)(timeUs % 1000000), averageSystemLoadPercent / 100, averageSystemLoadPercent % 100);
+    if (sitl.deterministic) {
+        printf("sitl: simulated time, exec and load count calls to the clock at %dus each, not work done\n", SITL_TIME_CALL_COST_US);
+    }
+    printf("sitl: task             period  exec50  exec99  late50  late99  misses\n");
+    for (cfTaskId_e taskId = 0; taskId < TASK_COUNT; taskId++) {
+        cfTaskInfo_t taskInfo;
+        getTaskInfo(taskId, &taskInfo);
+        if (taskInfo.isEnabled) {
+            printf("sitl: %-16s %7u %7u %7u %7u %7u %7u\n", taskInfo.taskName, (unsigned)taskInfo.desiredPeriod,
+                (unsigned)getTaskHistogramPercentile(taskInfo.executionTimeHistogram, 50),
+                (unsigned)getTaskHistogramPercentile(taskInfo.executionTimeHistogram, 99),
+                (unsigned)getTaskHistogramPercentile(taskInfo.latenessHistogram, 50),
+                (unsigned)getTaskHistogramPercentile(taskInfo.latenessHistogram, 99),
+                (unsigned)taskInfo.deadlineMissCount);
+        }
+    }
+#ifdef USE_FLASHFS
+    printf("sitl: blackbox %u bytes\n", (unsigned)flashfsGetOffset());
+#endif
+    fflush(stdout);
+}
+
+static void sitlStop(uint64_t timeUs)
+{
+    // the summary itself reads the time
+    sitl.stopping = true;
+#ifdef USE_FLASHFS
+    flashfsFlushSync();
+#endif
+    sitlPrintSummary(timeUs);
+    exit(0);
+}
+
+// the clock every time function reads, it also runs the replay and ends timed runs
+static uint64_t sitlTimeUs(void)
+{
+    uint64_t timeUs;
+
+    if (sitl.deterministic) {
+        sitl.simulatedTimeUs += SITL_TIME_CALL_COST_US;
+        timeUs = sitl.simulatedTimeUs;
+    } else {
+        timeUs = sitlHostTimeUs();
+    }
+
+    if (sitl.stopping) {
+        return timeUs;
+    }
+
+    while (sitl.replayPending && sitl.nextSample.timeUs <= timeUs) {
+        sitlApplyReplaySample(&sitl.nextSample);
+        sitl.replayPending = sitlReadReplaySample(&sitl.nextSample);
+        if (!sitl.replayPending && !sitl.durationUs) {
+            sitlStop(timeUs);
+        }
+    }
+
+    if (sitl.durationUs && timeUs >= sitl.durationUs) {
+        sitlStop(timeUs);
+    }
+
+    // the serial receive and the tick callback stand in for interrupts, so they must not nest
+    if (!sitl.inTimeEvents) {
+        sitl.inTimeEvents = true;
+        if (timeUs - sitl.lastPollUs >= SITL_TCP_POLL_INTERVAL_US) {
+            sitl.lastPollUs = timeUs;
+            sitlTcpPoll();
+        }
+        if (sysTickCallback && timeUs / 1000 != sitl.lastTickMs) {
+            sitl.lastTickMs = timeUs / 1000;
+            sysTickCallback();
+        }
+        sitl.inTimeEvents = false;
+    }
+
+    return timeUs;
+}
+
+void systemInit(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &sitl.startTime);
+
+    // at rest and level until the replay says otherwise
+    fakeAccSet(0, 0, SITL_REST_ACC_1G);
+    if (sitl.replay) {
+        sitl.replayPending = sitlReadReplaySample(&sitl.nextSample);
+    }
+
+    memset(sitlConfigFlash, 0xFF, sizeof(sitlConfigFlash));
+    const int fd = open(sitl.eepromPath, O_RDONLY);
+    if (fd >= 0) {
+        if (read(fd, sitlConfigFlash, sizeof(sitlConfigFlash)) < 0) {
+            perror(sitl.eepromPath);
+        }
+        close(fd);
+    }
+
+    printf("sitl: %s clock, UART1 on TCP port %d\n", sitl.deterministic ? "deterministic" : "host", sitl.tcpBasePort);
+}
+
+void initialiseMemorySections(void)
+{
+}
+
+uint32_t micros(void)
+{
+    return sitlTimeUs();
+}
+
+uint32_t microsISR(void)
+{
+    return micros();
+}
+
+uint32_t millis(void)
+{
+    return sitlTimeUs() / 1000;
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    if (sitl.deterministic) {
+        sitl.simulatedTimeUs += us;
+    } else {
+        const struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+void delay(uint32_t ms)
+{
+    delayMicroseconds(ms * 1000);
+}
+
+void __WFI(void)
+{
+    delayMicroseconds(SITL_IDLE_SLEEP_US);
+}
+
+void failureMode(failureMode_e mode)
+{
+    fprintf(stderr, "sitl: failure mode %d\n", mode);
+    exit(1);
+}
+
+// a reset starts the firmware again from the top, as it does after a CLI save
+void systemReset(void)
+{
+    printf("sitl: reset\n");
+    fflush(stdout);
+    sitlTcpClose();
+    execv("/proc/self/exe", sitl.argv);
+    perror("sitl: reset");
+    exit(1);
+}
+
+void systemResetToBootloader(void)
+{
+    printf("sitl: reset to bootloader\n");
+    exit(0);
+}
+
+bool isMPUSoftReset(void)
+{
+    return false;
+}
+
+void cycleCounterInit(void)
+{
+}
+
+void checkForBootLoaderRequest(void)
+{
+}
+
+void enableGPIOPowerUsageAndNoiseReductions(void)
+{
+}
+
+void systemSetTickCallback(sysTickCallbackFunc *fn)
+{
+    sysTickCallback = fn;
+}
+
+// the config area, kept in sitlConfigFlash and written back to the eeprom file when a save locks the flash
+void FLASH_Unlock(void)
+{
+}
+
+void FLASH_Lock(void)
+{
+    const int fd = open(sitl.eepromPath, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0 || write(fd, sitlConfigFlash, sizeof(sitlConfigFlash)) != (ssize_t)sizeof(sitlConfigFlash)) {
+        perror(sitl.eepromPath);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+FLASH_Status FLASH_ErasePage(uintptr_t Page_Address)
+{
+    const uintptr_t offset = Page_Address - (uintptr_t)sitlConfigFlash;
+    if (offset % FLASH_PAGE_SIZE || offset >= sizeof(sitlConfigFlash)) {
+        return FLASH_ERROR_PG;
+    }
+    memset(sitlConfigFlash + offset, 0xFF, FLASH_PAGE_SIZE);
+    return FLASH_COMPLETE;
+}
+
+// like the real flash, programming can only clear bits
+FLASH_Status FLASH_ProgramWord(uintptr_t addr, uint32_t Data)
+{
+    const uintptr_t offset = addr - (uintptr_t)sitlConfigFlash;
+    if (offset % 4 || offset >= sizeof(sitlConfigFlash)) {
+        return FLASH_ERROR_PG;
+    }
+    *(uint32_t *)(sitlConfigFlash + offset) &= Data;
+    return FLASH_COMPLETE;
+}
+
+// motor and servo outputs, kept for inspection
+static pwmOutputPort_t motors[MAX_SUPPORTED_MOTORS];
+static uint16_t motorValues[MAX_SUPPORTED_MOTORS];
+static uint16_t servoValues[MAX_SUPPORTED_SERVOS];
+static bool motorsEnabled;
+
+void motorInit(const motorConfig_t *motorConfig, uint16_t idlePulse, uint8_t motorCount)
+{
+    UNUSED(motorConfig);
+
+    for (int i = 0; i < motorCount && i < MAX_SUPPORTED_MOTORS; i++) {
+        motors[i].enabled = true;
+        motorValues[i] = idlePulse;
+    }
+    motorsEnabled = true;
+}
+
+void servoInit(const servoConfig_t *servoConfig)
+{
+    UNUSED(servoConfig);
+}
+
+void pwmWriteMotor(uint8_t index, uint16_t value)
+{
+    if (index < MAX_SUPPORTED_MOTORS) {
+        motorValues[index] = value;
+    }
+}
+
+void pwmShutdownPulsesForAllMotors(uint8_t motorCount)
+{
+    for (int i = 0; i < motorCount && i < MAX_SUPPORTED_MOTORS; i++) {
+        motorValues[i] = 0;
+    }
+}
+
+void pwmCompleteMotorUpdate(uint8_t motorCount)
+{
+    UNUSED(motorCount);
+}
+
+void pwmWriteServo(uint8_t index, uint16_t value)
+{
+    if (index < MAX_SUPPORTED_SERVOS) {
+        servoValues[index] = value;
+    }
+}
+
+pwmOutputPort_t *pwmGetMotors(void)
+{
+    return motors;
+}
+
+bool pwmIsSynced(void)
+{
+    return false;
+}
+
+bool pwmEnableSyncedMotorOutput(void)
+{
+    return false;
+}
+
+void pwmSyncedMotorOutput(void)
+{
+}
+
+void pwmDisableMotors(void)
+{
+    motorsEnabled = false;
+}
+
+void pwmEnableMotors(void)
+{
+    motorsEnabled = true;
+}
+
+bool pwmAreMotorsEnabled(void)
+{
+    return motorsEnabled;
+}
+
+uint16_t sitlMotorValue(uint8_t index)
+{
+    return index < MAX_SUPPORTED_MOTORS ? motorValues[index] : 0;
+}
+
+uint16_t sitlServoValue(uint8_t index)
+{
+    return index < MAX_SUPPORTED_SERVOS ? servoValues[index] : 0;
+}
+
+// there is no PWM or PPM input, the receiver is MSP or a serial protocol on a TCP port
+void ppmRxInit(const ppmConfig_t *ppmConfig, uint8_t pwmProtocol)
+{
+    UNUSED(ppmConfig);
+    UNUSED(pwmProtocol);
+}
+
+void pwmRxInit(const pwmConfig_t *pwmConfig)
+{
+    UNUSED(pwmConfig);
+}
+
+uint16_t pwmRead(uint8_t channel)
+{
+    UNUSED(channel);
+    return 0;
+}
+
+uint16_t ppmRead(uint8_t channel)
+{
+    UNUSED(channel);
+    return 0;
+}
+
+bool isPPMDataBeingReceived(void)
+{
+    return false;
+}
+
+void resetPPMDataReceivedState(void)
+{
+}
+
+bool isPWMDataBeingReceived(void)
+{
+    return false;
+}
+
+void timerInit(void)
+{
+}
+
+void timerStart(void)
+{
+}
+
+resourceOwner_e dmaGetOwner(dmaIdentifier_e identifier)
+{
+    UNUSED(identifier);
+    return OWNER_FREE;
+}
+
+uint8_t dmaGetResourceIndex(dmaIdentifier_e identifier)
+{
+    UNUSED(identifier);
+    return 0;
+}
+
+uint8_t dmaGetConflictCount(void)
+{
+    return 0;
+}
+
+const dmaConflict_t *dmaGetConflict(uint8_t index)
+{
+    UNUSED(index);
+    return NULL;
+}
+
+uint16_t adcGetChannel(uint8_t channel)
+{
+    UNUSED(channel);
+    return 0;
+}
+
+// nothing is on the I2C bus
+bool i2cWrite(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t data)
+{
+    UNUSED(device);
+    UNUSED(addr_);
+    UNUSED(reg);
+    UNUSED(data);
+    return false;
+}
+
+bool i2cWriteBuffer(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data)
+{
+    UNUSED(device);
+    UNUSED(addr_);
+    UNUSED(reg_);
+    UNUSED(len_);
+    UNUSED(data);
+    return false;
+}
+
+bool i2cWriteBufferAsync(I2CDevice device, uint8_t addr_, uint8_t reg_, uint8_t len_, uint8_t *data)
+{
+    return i2cWriteBuffer(device, addr_, reg_, len_, data);
+}
+
+bool i2cRead(I2CDevice device, uint8_t addr_, uint8_t reg, uint8_t len, uint8_t* buf)
+{
+    UNUSED(device);
+    UNUSED(addr_);
+    UNUSED(reg);
+    UNUSED(len);
+    UNUSED(buf);
+    return false;
+}
+
+bool i2cBusy(I2CDevice device, bool *error)
+{
+    UNUSED(device);
+    if (error) {
+        *error = false;
+    }
+    return false;
+}
+
+uint16_t i2cGetErrorCounter(void)
+{
+    return 0;
+}
+
+// the host's stack is not painted or measured
+void stackPaint(void)
+{
+}
+
+uint32_t stackHighWaterMark(void)
+{
+    return 0;
+}
+
+uint32_t stackUsedSize(void)
+{
+    return 0;
+}
+
+uint32_t stackTotalSize(void)
+{
+    return 0;
+}
+
+uint32_t stackHighMem(void)
+{
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Software in the loop: the whole firmware built for the host. Time is simulated and only moves when the
+ * scheduler waits, sensors are the fake drivers fed by the simulation or a replay file, serial ports are TCP
+ * sockets and the config and blackbox flash are backed by files. See target.c.
+ */
+
+#define TARGET_BOARD_IDENTIFIER "SITL"
+
+
+#define ACC
+#define USE_FAKE_ACC
+
+#define GYRO
+#define USE_FAKE_GYRO
+
+#define MAG
+#define USE_FAKE_MAG
+
+#define BARO
+#define USE_FAKE_BARO
+
+#define SENSORS_SET (SENSOR_ACC | SENSOR_MAG | SENSOR_BARO)
+
+#define USE_UART1
+#define USE_UART2
+#define USE_UART3
+#define USE_UART4
+#define USE_UART5
+#define USE_UART6
+#define USE_UART7
+#define USE_UART8
+
+#define SERIAL_PORT_COUNT 8
+
+// the config area is a file mapped array, see FLASH_ProgramWord() in target.c
+#define FLASH_PAGE_SIZE             (0x800)
+extern uint8_t sitlConfigFlash[];
+#define CONFIG_START_FLASH_ADDRESS  ((uintptr_t)sitlConfigFlash)
+
+#define USE_FLASHFS
+#define USE_FLASH_M25P16
+
+#define SITL_FLASH_SECTOR_SIZE      (64 * 1024)
+#define SITL_FLASH_SECTOR_COUNT     64          // 4MB of blackbox log
+
+#define DEFAULT_FEATURES        (FEATURE_BLACKBOX)
+#define DEFAULT_RX_FEATURE      FEATURE_RX_MSP
+
+#define TARGET_IO_PORTA 0xffff
+#define TARGET_IO_PORTB 0xffff
+#define TARGET_IO_PORTC 0xffff
+#define TARGET_IO_PORTD 0xffff
+
+#define USABLE_TIMER_CHANNEL_COUNT 0
+#define USED_TIMERS 0
+
+#define U_ID_0 0
+#define U_ID_1 1
+#define U_ID_2 2
+
+// stand-ins for the peripheral types the shared driver headers name, nothing on the host touches them
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+typedef enum { ERROR = 0, SUCCESS = !ERROR } ErrorStatus;
+
+typedef int IRQn_Type;
+
+extern uint32_t SystemCoreClock;
+
+// idles the simulation until the next scheduler pass, in place of wait for interrupt
+void __WFI(void);
+
+#define NVIC_PriorityGroup_2        ((uint32_t)0x500)
+
+typedef enum {
+    EXTI_Trigger_Rising = 0x08,
+    EXTI_Trigger_Falling = 0x0C,
+    EXTI_Trigger_Rising_Falling = 0x10
+} EXTITrigger_TypeDef;
+
+typedef enum {
+    FLASH_BUSY = 1,
+    FLASH_ERROR_PG,
+    FLASH_ERROR_WRP,
+    FLASH_COMPLETE,
+    FLASH_TIMEOUT
+} FLASH_Status;
+
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+FLASH_Status FLASH_ErasePage(uintptr_t Page_Address);
+FLASH_Status FLASH_ProgramWord(uintptr_t addr, uint32_t Data);
+
+typedef struct {
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint32_t BSRR;
+    volatile uint32_t BRR;
+} GPIO_TypeDef;
+
+// the pins are records in a block of simulated ports, laid out 0x400 apart like the real ones
+extern uint8_t sitlGpioPorts[];
+#define GPIOA_BASE ((uintptr_t)sitlGpioPorts)
+typedef struct { uint32_t unused; } TIM_TypeDef;
+typedef struct { uint32_t unused; } TIM_OCInitTypeDef;
+typedef struct { uint32_t unused; } DMA_TypeDef;
+typedef struct { uint32_t unused; } DMA_Channel_TypeDef;
+typedef struct { uint32_t unused; } SPI_TypeDef;
+typedef struct { uint32_t unused; } I2C_TypeDef;
+typedef struct { uint32_t unused; } USART_TypeDef;
+typedef struct { uint32_t unused; } ADC_TypeDef;
+
+// the UART instances only identify the TCP port uartOpen() listens on
+#define USART1  ((USART_TypeDef *)0x0001)
+#define USART2  ((USART_TypeDef *)0x0002)
+#define USART3  ((USART_TypeDef *)0x0003)
+#define UART4   ((USART_TypeDef *)0x0004)
+#define UART5   ((USART_TypeDef *)0x0005)
+#define USART6  ((USART_TypeDef *)0x0006)
+#define UART7   ((USART_TypeDef *)0x0007)
+#define UART8   ((USART_TypeDef *)0x0008)
@@ -0,0 +1,4 @@
+SITL_TARGETS += $(TARGET)
+
+TARGET_SRC = \
+            io/flashfs.c
@@ -26,12 +26,36 @@
 
 //#define SCHEDULER_DEBUG // define this to use scheduler debug[] values. Undefined by default for performance reasons
 #define DEBUG_MODE DEBUG_NONE // change this to change initial debug mode
+#define USE_DEBUG_MODES // the debug_mode setting and the debug[] instrumentation, OPTIONS="DISABLE_USE_DEBUG_MODES" builds without them
+#define FAST_MATH // polynomial sin, cos, atan2 and acos in place of libm, order 9
+//#define USE_FIXED_FILTER_CHAIN // define this in target.h to fix the gyro and Dterm filters to biquad LPF and notches, removing the runtime filter selection
+//#define USE_FIXED_POINT_GYRO_FILTERS // define this in target.h as well as USE_FIXED_FILTER_CHAIN to run the gyro filters in fixed point, for targets without FPU. The PID controller and mixer stay float
 
 #define I2C1_OVERCLOCK true
 #define I2C2_OVERCLOCK true
 
 #ifdef STM32F7
 #define STM_FAST_TARGET
+#define USE_GYRO_FIFO
+#define USE_GYRO_DATA_ANALYSE
+#define USE_SCHEDULER_READY_BITMAP
+#define USE_SCHEDULER_TRACE
+#define USE_POST_MORTEM
+#define USE_LOOP_LATENCY
+#define USE_PROFILER
+#define USE_LOOP_RATE_AUTO
+#define USE_DSHOT_DMAR
+#define USE_RPM_FILTER
+#define AFATFS_NUM_CACHE_SECTORS 64  // 32KB SD card write-behind cache, logs every 8kHz loop through 100ms card stalls
+#define USE_BLACKBOX_COMPRESSION
+#define USE_BLACKBOX_CAPTURE
+#define BLACKBOX_CAPTURE_SAMPLES 2048 // 56KB, 256ms of 8kHz PID updates around a crash capture trigger
+#define FLASHFS_WRITE_BUFFER_SIZE 1024 // 4 flash pages queued for programming
+#define USE_USB_MSC
+#define USE_SDCARD_PROFILER
+#define USE_RC_RATE_TABLE
+#define USE_TRIG_LUT
+#define USE_CRC8_TABLE
 #define I2C3_OVERCLOCK true
 #define I2C4_OVERCLOCK true
 #endif
@@ -42,12 +66,38 @@
 #ifdef STM32F4
 #define STM_FAST_TARGET
 #define USE_DSHOT
+#define USE_GYRO_FIFO
+#define USE_GYRO_DATA_ANALYSE
+#define USE_SCHEDULER_READY_BITMAP
+#define USE_SCHEDULER_TRACE
+#define USE_POST_MORTEM
+#define USE_LOOP_LATENCY
+#define USE_PROFILER
+#define USE_LOOP_RATE_AUTO
+#define USE_DSHOT_DMAR
+#define USE_DSHOT_TELEMETRY
+#define USE_RX_PWM_DMA
+#define USE_RPM_FILTER
+#define AFATFS_NUM_CACHE_SECTORS 32  // 16KB SD card write-behind cache, logs every 8kHz loop through 50ms card stalls
+#define USE_BLACKBOX_COMPRESSION
+#define USE_BLACKBOX_CAPTURE
+#define BLACKBOX_CAPTURE_SAMPLES 1024 // 28KB, 256ms of 4kHz PID updates around a crash capture trigger
+#define FLASHFS_WRITE_BUFFER_SIZE 1024 // 4 flash pages queued for programming
+#define USE_SDCARD_PROFILER
+#define USE_RC_RATE_TABLE
+#define USE_TRIG_LUT
+#define USE_CRC8_TABLE
 #define I2C3_OVERCLOCK true
 #define GPS
 #endif
 
 #ifdef STM32F3
 #define USE_DSHOT
+#define USE_PROFILER
+#define USE_POST_MORTEM
+#define USE_LOOP_RATE_AUTO
+#define USE_TRIG_LUT
+#define USE_CRC8_TABLE
 #endif
 
 #ifdef STM32F1
@@ -19,8 +19,138 @@
 
 #pragma once
 
+// Features left out of a build with OPTIONS="DISABLE_<feature> ...", along with what depends on them,
+// the feature_cost report builds a target once without each
+#ifdef DISABLE_OSD
+#undef OSD
+#endif
+
+#ifdef DISABLE_CMS
+#undef CMS
+#undef USE_DASHBOARD
+#undef USE_MSP_DISPLAYPORT
+#endif
+
+#ifdef DISABLE_BLACKBOX
+#undef BLACKBOX
+#undef USE_BLACKBOX_COMPRESSION
+#undef USE_BLACKBOX_CAPTURE
+#endif
+
+#ifdef DISABLE_USE_BLACKBOX_CAPTURE
+#undef USE_BLACKBOX_CAPTURE
+#endif
+
+#ifdef DISABLE_GPS
+#undef GPS
+#endif
+
+#ifdef DISABLE_MAG
+#undef MAG
+#endif
+
+#ifdef DISABLE_BARO
+#undef BARO
+#endif
+
+#ifdef DISABLE_SONAR
+#undef SONAR
+#endif
+
+#ifdef DISABLE_LED_STRIP
+#undef LED_STRIP
+#endif
+
+#ifdef DISABLE_TELEMETRY
+#undef TELEMETRY
+#undef TELEMETRY_CRSF
+#undef TELEMETRY_FRSKY
+#undef TELEMETRY_HOTT
+#undef TELEMETRY_IBUS
+#undef TELEMETRY_JETIEXBUS
+#undef TELEMETRY_LTM
+#undef TELEMETRY_MAVLINK
+#undef TELEMETRY_NRF24_LTM
+#undef TELEMETRY_SMARTPORT
+#undef TELEMETRY_SRXL
+#endif
+
+#ifdef DISABLE_USE_DSHOT
+#undef USE_DSHOT
+#undef USE_DSHOT_DMAR
+#undef USE_DSHOT_TELEMETRY
+#undef USE_ESC_SENSOR
+#undef USE_RPM_FILTER
+#endif
+
+#ifdef DISABLE_USE_SERVOS
+#undef USE_SERVOS
+#endif
+
+#ifdef DISABLE_USE_DEBUG_MODES
+#undef USE_DEBUG_MODES
+#endif
+
+#ifdef DISABLE_USE_POST_MORTEM
+#undef USE_POST_MORTEM
+#endif
+
 // Targets with built-in vtx do not need external vtx
 #if defined(VTX) || defined(USE_RTC6705)
 # undef VTX_CONTROL
 # undef VTX_SMARTAUDIO
 #endif
+
+// The fixed point gyro filters only implement the fixed biquad chain, and have no FIFO, dynamic notch or RPM filter support
+#if defined(USE_FIXED_POINT_GYRO_FILTERS)
+#if !defined(USE_FIXED_FILTER_CHAIN)
+#error "USE_FIXED_POINT_GYRO_FILTERS requires USE_FIXED_FILTER_CHAIN"
+#endif
+#undef USE_GYRO_FIFO
+#undef USE_GYRO_DATA_ANALYSE
+#undef USE_RPM_FILTER
+#endif
+
+// The second gyro is found among the SPI drivers, and is fused ahead of the floating point filters
+#if defined(USE_DUAL_GYRO) && (!defined(USE_SPI) || defined(USE_FIXED_POINT_GYRO_FILTERS))
+#undef USE_DUAL_GYRO
+#endif
+
+// DMA gyro reads are started from the data ready interrupt and use the StdPeriph DMA API
+#if defined(USE_GYRO_DMA) && (!defined(MPU_INT_EXTI) || defined(USE_HAL_DRIVER))
+#undef USE_GYRO_DMA
+#endif
+
+// DMA flash page programs use the StdPeriph DMA API
+#if defined(M25P16_DMA_CHANNEL_TX) && defined(USE_HAL_DRIVER)
+#undef M25P16_DMA_CHANNEL_TX
+#endif
+
+// Only the F4 and F7 have the SDIO peripheral
+#if defined(USE_SDCARD_SDIO) && !(defined(USE_SDCARD) && (defined(STM32F4) || defined(STM32F7)))
+#undef USE_SDCARD_SDIO
+#endif
+
+// the crash capture is written out through the blackbox device
+#if defined(USE_BLACKBOX_CAPTURE) && !defined(BLACKBOX)
+#undef USE_BLACKBOX_CAPTURE
+#endif
+
+#if defined(USE_SDCARD_PROFILER) && !defined(USE_SDCARD)
+#undef USE_SDCARD_PROFILER
+#endif
+
+// the automatic loop rate is selected from the cycle profiler times
+#if defined(USE_LOOP_RATE_AUTO) && !defined(USE_PROFILER)
+#undef USE_LOOP_RATE_AUTO
+#endif
+
+// USB mass storage needs the USB stack and some log storage to expose
+#if defined(USE_USB_MSC) && (!defined(USE_VCP) || !(defined(USE_SDCARD) || defined(USE_FLASHFS)))
+#undef USE_USB_MSC
+#endif
+
+// The interrupt level PID loop relies on DMA gyro reads, so the interrupt never touches the SPI bus itself
+#if defined(USE_PID_LOOP_INTERRUPT) && !defined(USE_GYRO_DMA)
+#undef USE_PID_LOOP_INTERRUPT
+#endif
@@ -37,6 +37,7 @@
 #include "config/parameter_group_ids.h"
 #endif
 
+#include "common/maths.h"
 #include "common/streambuf.h"
 #include "common/utils.h"
 
@@ -56,6 +57,8 @@
 #include "rx/crsf.h"
 
 #include "telemetry/telemetry.h"
+#include "telemetry/msp_telemetry.h"
+#include "telemetry/telemetry_values.h"
 #include "telemetry/crsf.h"
 
 #ifdef CLEANFLIGHT
@@ -65,15 +68,19 @@
 #include "fc/config.h"
 #endif
 
-#define CRSF_CYCLETIME_US                   100000 // 100ms, 10 Hz
+#define CRSF_FRAME_INTERVAL_MIN_US          20000 // 50 Hz, a ceiling for the receiver, the slots below it are scheduled
+
+#define CRSF_FRAME_MSP_PAYLOAD_SIZE         CRSF_PAYLOAD_SIZE_MAX
+#define CRSF_MSP_CHUNK_SIZE                 (CRSF_FRAME_MSP_PAYLOAD_SIZE - CRSF_FRAME_LENGTH_EXT_HEADER)
 
 static bool crsfTelemetryEnabled;
-static uint8_t crsfCrc;
+static uint8_t crsfMspRequest[CRSF_PAYLOAD_SIZE_MAX];
+static uint8_t crsfMspRequestSize = 0;     // a request chunk is waiting for the telemetry task
+static uint8_t crsfMspOrigin = CRSF_ADDRESS_RADIO_TRANSMITTER;
 static uint8_t crsfFrame[CRSF_FRAME_SIZE_MAX];
 
 static void crsfInitializeFrame(sbuf_t *dst)
 {
-    crsfCrc = 0;
     dst->ptr = crsfFrame;
     dst->end = ARRAYEND(crsfFrame);
 
@@ -83,7 +90,6 @@ static void crsfInitializeFrame(sbuf_t *dst)
 static void crsfSerialize8(sbuf_t *dst, uint8_t v)
 {
     sbufWriteU8(dst, v);
-    crsfCrc = crc8_dvb_s2(crsfCrc, v);
 }
 
 static void crsfSerialize16(sbuf_t *dst, uint16_t v)
@@ -104,14 +110,19 @@ static void crsfSerialize32(sbuf_t *dst, uint32_t v)
 
 static void crsfSerializeData(sbuf_t *dst, const uint8_t *data, int len)
 {
-    for (int ii = 0; ii< len; ++ii) {
-        crsfSerialize8(dst, data[ii]);
-    }
+    sbufWriteData(dst, data, len);
+}
+
+// the CRC covers the type and payload, not the device address and frame length
+static void crsfSerializeCrc(sbuf_t *dst)
+{
+    const uint8_t *start = crsfFrame + CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH;
+    sbufWriteU8(dst, crc8_dvb_s2_buf(0, start, sbufPtr(dst) - start));
 }
 
 static void crsfFinalize(sbuf_t *dst)
 {
-    sbufWriteU8(dst, crsfCrc);
+    crsfSerializeCrc(dst);
     sbufSwitchToReader(dst, crsfFrame);
     // write the telemetry frame to the receiver.
     crsfRxWriteTelemetryData(sbufPtr(dst), sbufBytesRemaining(dst));
@@ -119,7 +130,7 @@ static void crsfFinalize(sbuf_t *dst)
 
 static int crsfFinalizeBuf(sbuf_t *dst, uint8_t *frame)
 {
-    sbufWriteU8(dst, crsfCrc);
+    crsfSerializeCrc(dst);
     sbufSwitchToReader(dst, crsfFrame);
     const int frameSize = sbufBytesRemaining(dst);
     for (int ii = 0; sbufBytesRemaining(dst); ++ii) {
@@ -265,45 +276,142 @@ void crsfFrameFlightMode(sbuf_t *dst)
     *lengthPtr = sbufPtr(dst) - lengthPtr;
 }
 
-#define BV(x)  (1 << (x)) // bit value
+/*
+0x7B MSP reply chunk, extended header
+Payload:
+uint8_t     Destination ( origin of the request )
+uint8_t     Origin
+uint8_t[]   MSP telemetry chunk, see msp_telemetry.h
+*/
+static void crsfFrameMspResponse(sbuf_t *dst)
+{
+    uint8_t chunk[CRSF_MSP_CHUNK_SIZE];
+    mspTelemetryEncodeReply(chunk, sizeof(chunk));
+
+    sbufWriteU8(dst, CRSF_FRAME_MSP_PAYLOAD_SIZE + CRSF_FRAME_LENGTH_TYPE_CRC);
+    crsfSerialize8(dst, CRSF_FRAMETYPE_MSP_RESP);
+    crsfSerialize8(dst, crsfMspOrigin);
+    crsfSerialize8(dst, CRSF_ADDRESS_COLIBRI_RACE_FC);
+    crsfSerializeData(dst, chunk, sizeof(chunk));
+}
+
+#define CRSF_FRAME_FLIGHT_MODE_PAYLOAD_SIZE_MAX 5 // longest flight mode string and its terminator
+#define CRSF_FRAME_SIZE(payloadSize) (CRSF_FRAME_LENGTH_ADDRESS + CRSF_FRAME_LENGTH_FRAMELENGTH + CRSF_FRAME_LENGTH_TYPE_CRC + (payloadSize))
+
+#define CRSF_SCHEDULE_SUBSCRIPTION_COUNT_MAX 3
+
+/*
+ * A frame is due when any of its values has changed beyond its threshold since the frame was last sent, limited by
+ * the interval window shared by the values. Of the frames due, the one furthest past its minimum interval that fits
+ * in the reply slot goes next, so attitude goes out quickly when it moves and battery slowly.
+ */
+typedef struct crsfSchedule_s {
+    crsfFrameType_e frameType;
+    uint8_t frameSize;
+    uint8_t subscriptionCount;
+    telemetrySubscription_t subscriptions[CRSF_SCHEDULE_SUBSCRIPTION_COUNT_MAX];
+} crsfSchedule_t;
+
+static crsfSchedule_t crsfSchedule[] = {
+    { CRSF_FRAME_ATTITUDE, CRSF_FRAME_SIZE(CRSF_FRAME_ATTITUDE_PAYLOAD_SIZE), 3, {
+        { TELEMETRY_VALUE_ROLL,        50,  500, 10, 0, 0, false },
+        { TELEMETRY_VALUE_PITCH,       50,  500, 10, 0, 0, false },
+        { TELEMETRY_VALUE_HEADING,     50,  500, 10, 0, 0, false } } },
+    { CRSF_FRAME_FLIGHT_MODE, CRSF_FRAME_SIZE(CRSF_FRAME_FLIGHT_MODE_PAYLOAD_SIZE_MAX), 1, {
+        { TELEMETRY_VALUE_FLIGHT_MODE, 100, 1000, 1, 0, 0, false } } },
+    { CRSF_FRAME_BATTERY_SENSOR, CRSF_FRAME_SIZE(CRSF_FRAME_BATTERY_SENSOR_PAYLOAD_SIZE), 2, {
+        { TELEMETRY_VALUE_VBAT,        500, 2000, 1, 0, 0, false },
+        { TELEMETRY_VALUE_AMPERAGE,    500, 2000, 50, 0, 0, false } } },
+#ifdef GPS
+    // must be last, it is dropped from the schedule without the GPS feature
+    { CRSF_FRAME_GPS, CRSF_FRAME_SIZE(CRSF_FRAME_GPS_PAYLOAD_SIZE), 1, {
+        { TELEMETRY_VALUE_NONE,        200, 1000, 0, 0, 0, false } } },
+#endif
+};
 
-// schedule array to decide how often each type of frame is sent
-#define CRSF_SCHEDULE_COUNT_MAX     5
 static uint8_t crsfScheduleCount;
-static uint8_t crsfSchedule[CRSF_SCHEDULE_COUNT_MAX];
 
+static bool crsfScheduleDue(const crsfSchedule_t *entry, timeMs_t currentTimeMs)
+{
+    for (int i = 0; i < entry->subscriptionCount; i++) {
+        if (telemetrySubscriptionDue(&entry->subscriptions[i], currentTimeMs)) {
+            return true;
+        }
+    }
+    return false;
+}
 
-static void processCrsf(void)
+static timeMs_t crsfScheduleDeadline(const crsfSchedule_t *entry)
 {
-    static uint8_t crsfScheduleIndex = 0;
-    const uint8_t currentSchedule = crsfSchedule[crsfScheduleIndex];
+    const telemetrySubscription_t *subscription = &entry->subscriptions[0];
+    return subscription->sent ? subscription->lastSentMs + subscription->minIntervalMs : 0;
+}
 
+static void crsfScheduleSent(crsfSchedule_t *entry, timeMs_t currentTimeMs)
+{
+    for (int i = 0; i < entry->subscriptionCount; i++) {
+        telemetrySubscriptionSent(&entry->subscriptions[i], currentTimeMs);
+    }
+}
+
+static crsfSchedule_t *crsfScheduleNext(timeMs_t currentTimeMs, int space)
+{
+    crsfSchedule_t *next = NULL;
+
+    for (int i = 0; i < crsfScheduleCount; i++) {
+        crsfSchedule_t *entry = &crsfSchedule[i];
+        if (entry->frameSize > space || !crsfScheduleDue(entry, currentTimeMs)) {
+            continue;
+        }
+        if (!next || cmp32(crsfScheduleDeadline(entry), crsfScheduleDeadline(next)) < 0) {
+            next = entry;
+        }
+    }
+    return next;
+}
+
+static bool processCrsf(timeMs_t currentTimeMs, int space)
+{
     sbuf_t crsfPayloadBuf;
     sbuf_t *dst = &crsfPayloadBuf;
 
-    if (currentSchedule & BV(CRSF_FRAME_ATTITUDE)) {
+    // an MSP reply takes every slot it fits in until it is all out
+    if (mspTelemetryReplyPending() && space >= CRSF_FRAME_SIZE(CRSF_FRAME_MSP_PAYLOAD_SIZE)) {
         crsfInitializeFrame(dst);
-        crsfFrameAttitude(dst);
+        crsfFrameMspResponse(dst);
         crsfFinalize(dst);
+        return true;
     }
-    if (currentSchedule & BV(CRSF_FRAME_BATTERY_SENSOR)) {
-        crsfInitializeFrame(dst);
-        crsfFrameBatterySensor(dst);
-        crsfFinalize(dst);
+
+    crsfSchedule_t *entry = crsfScheduleNext(currentTimeMs, space);
+    if (!entry) {
+        return false;
     }
-    if (currentSchedule & BV(CRSF_FRAME_FLIGHT_MODE)) {
-        crsfInitializeFrame(dst);
+
+    crsfInitializeFrame(dst);
+    switch (entry->frameType) {
+    case CRSF_FRAME_ATTITUDE:
+        crsfFrameAttitude(dst);
+        break;
+    case CRSF_FRAME_BATTERY_SENSOR:
+        crsfFrameBatterySensor(dst);
+        break;
+    case CRSF_FRAME_FLIGHT_MODE:
         crsfFrameFlightMode(dst);
-        crsfFinalize(dst);
-    }
+        break;
 #ifdef GPS
-    if (currentSchedule & BV(CRSF_FRAME_GPS)) {
-        crsfInitializeFrame(dst);
+    case CRSF_FRAME_GPS:
         crsfFrameGps(dst);
-        crsfFinalize(dst);
-    }
+        break;
 #endif
-    crsfScheduleIndex = (crsfScheduleIndex + 1) % crsfScheduleCount;
+    default:
+        // not in the schedule on this build
+        break;
+    }
+    crsfFinalize(dst);
+
+    crsfScheduleSent(entry, currentTimeMs);
+    return true;
 }
 
 void initCrsfTelemetry(void)
@@ -311,16 +419,13 @@ void initCrsfTelemetry(void)
     // check if there is a serial port open for CRSF telemetry (ie opened by the CRSF RX)
     // and feature is enabled, if so, set CRSF telemetry enabled
     crsfTelemetryEnabled = crsfRxIsActive();
-    int index = 0;
-    crsfSchedule[index++] = BV(CRSF_FRAME_ATTITUDE);
-    crsfSchedule[index++] = BV(CRSF_FRAME_BATTERY_SENSOR);
-    crsfSchedule[index++] = BV(CRSF_FRAME_FLIGHT_MODE);
-    if (feature(FEATURE_GPS)) {
-        crsfSchedule[index++] = BV(CRSF_FRAME_GPS);
+    crsfScheduleCount = ARRAYLEN(crsfSchedule);
+#ifdef GPS
+    if (!feature(FEATURE_GPS)) {
+        crsfScheduleCount--;
     }
-    crsfScheduleCount = (uint8_t)index;
-
- }
+#endif
+}
 
 bool checkCrsfTelemetryState(void)
 {
@@ -332,7 +437,7 @@ bool checkCrsfTelemetryState(void)
  */
 void handleCrsfTelemetry(timeUs_t currentTimeUs)
 {
-    static uint32_t crsfLastCycleTime;
+    static timeUs_t crsfLastFrameTime;
 
     if (!crsfTelemetryEnabled) {
         return;
@@ -342,11 +447,33 @@ void handleCrsfTelemetry(timeUs_t currentTimeUs)
     // in between the RX frames.
     crsfRxSendTelemetryData();
 
-    // Actual telemetry data only needs to be sent at a low frequency, ie 10Hz
-    if (currentTimeUs >= crsfLastCycleTime + CRSF_CYCLETIME_US) {
-        crsfLastCycleTime = currentTimeUs;
-        processCrsf();
+    if (crsfMspRequestSize) {
+        crsfMspOrigin = crsfMspRequest[1];
+        mspTelemetryHandleRequest(crsfMspRequest + CRSF_FRAME_LENGTH_EXT_HEADER, crsfMspRequestSize - CRSF_FRAME_LENGTH_EXT_HEADER);
+        crsfMspRequestSize = 0;
+    }
+
+    // the frame rate ceiling is for telemetry values, an MSP reply goes out as fast as the slots allow
+    if (!mspTelemetryReplyPending() && cmpTimeUs(currentTimeUs, crsfLastFrameTime) < CRSF_FRAME_INTERVAL_MIN_US) {
+        return;
+    }
+
+    // fill the reply slot as soon as it is free, with a frame that fits in what is left of it
+    const int space = crsfRxTelemetrySpace();
+    if (space > 0 && processCrsf(currentTimeUs / 1000, space)) {
+        crsfLastFrameTime = currentTimeUs;
+        crsfRxSendTelemetryData();
+    }
+}
+
+// called by the CRSF receiver with the payload of MSP request frames, a chunk not handled yet is overwritten
+void crsfScheduleMspRequest(const uint8_t *payload, int payloadSize)
+{
+    if (payloadSize <= CRSF_FRAME_LENGTH_EXT_HEADER || payload[0] != CRSF_ADDRESS_COLIBRI_RACE_FC) {
+        return;
     }
+    crsfMspRequestSize = MIN(payloadSize, (int)sizeof(crsfMspRequest));
+    memcpy(crsfMspRequest, payload, crsfMspRequestSize);
 }
 
 int getCrsfFrame(uint8_t *frame, crsfFrameType_e frameType)
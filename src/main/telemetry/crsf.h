@@ -30,6 +30,7 @@ typedef enum {
 void initCrsfTelemetry(void);
 bool checkCrsfTelemetryState(void);
 void handleCrsfTelemetry(timeUs_t currentTimeUs);
+void crsfScheduleMspRequest(const uint8_t *payload, int payloadSize);
 
 int getCrsfFrame(uint8_t *frame, crsfFrameType_e frameType);
 
@@ -60,6 +60,7 @@
 #include "rx/rx.h"
 
 #include "telemetry/telemetry.h"
+#include "telemetry/telemetry_frame.h"
 #include "telemetry/frsky.h"
 
 #ifdef USE_ESC_SENSOR
@@ -132,28 +133,42 @@ extern int16_t telemTemperature1; // FIXME dependency on mw.c
 
 static uint32_t lastCycleTime = 0;
 static uint8_t cycleNum = 0;
+// hub frames are built up to the tail and written in one go
+#define FRSKY_FRAME_BUFFER_SIZE 160
+#define FRSKY_DATA_ITEM_SIZE_MAX 6 // header, id and two data bytes that may both need stuffing
+
+static uint8_t frskyFrameBuffer[FRSKY_FRAME_BUFFER_SIZE];
+static telemetryFrame_t frskyFrame;
+
 static void sendDataHead(uint8_t id)
 {
-    serialWrite(frskyPort, PROTOCOL_HEADER);
-    serialWrite(frskyPort, id);
+    // a full buffer goes out early, the hub protocol doesn't care where the writes split
+    if (telemetryFrameBytesFree(&frskyFrame) < FRSKY_DATA_ITEM_SIZE_MAX + 1) {
+        telemetryFrameFlush(&frskyFrame, frskyPort);
+    }
+    // items go straight into the TX ring while it has room for them and the tail
+    telemetryFrameBeginOnPort(&frskyFrame, frskyPort, FRSKY_DATA_ITEM_SIZE_MAX + 1);
+    telemetryFrameWriteRaw(&frskyFrame, PROTOCOL_HEADER);
+    telemetryFrameWriteRaw(&frskyFrame, id);
 }
 
 static void sendTelemetryTail(void)
 {
-    serialWrite(frskyPort, PROTOCOL_TAIL);
+    telemetryFrameWriteRaw(&frskyFrame, PROTOCOL_TAIL);
+    telemetryFrameFlush(&frskyFrame, frskyPort);
 }
 
 static void serializeFrsky(uint8_t data)
 {
     // take care of byte stuffing
     if (data == 0x5e) {
-        serialWrite(frskyPort, 0x5d);
-        serialWrite(frskyPort, 0x3e);
+        telemetryFrameWriteRaw(&frskyFrame, 0x5d);
+        telemetryFrameWriteRaw(&frskyFrame, 0x3e);
     } else if (data == 0x5d) {
-        serialWrite(frskyPort, 0x5d);
-        serialWrite(frskyPort, 0x3d);
+        telemetryFrameWriteRaw(&frskyFrame, 0x5d);
+        telemetryFrameWriteRaw(&frskyFrame, 0x3d);
     } else
-        serialWrite(frskyPort, data);
+        telemetryFrameWriteRaw(&frskyFrame, data);
 }
 
 static void serialize16(int16_t a)
@@ -462,6 +477,7 @@ void initFrSkyTelemetry(telemetryConfig_t *initialTelemetryConfig)
     telemetryConfig = initialTelemetryConfig;
     portConfig = findSerialPortConfig(FUNCTION_TELEMETRY_FRSKY);
     frskyPortSharing = determinePortSharing(portConfig, FUNCTION_TELEMETRY_FRSKY);
+    telemetryFrameInit(&frskyFrame, frskyFrameBuffer, sizeof(frskyFrameBuffer));
 }
 
 void freeFrSkyTelemetryPort(void)
@@ -64,6 +64,7 @@
 #include "build/debug.h"
 
 #include "common/axis.h"
+#include "common/maths.h"
 #include "common/time.h"
 
 #include "drivers/system.h"
@@ -87,7 +88,7 @@
 
 #define HOTT_MESSAGE_PREPARATION_FREQUENCY_5_HZ ((1000 * 1000) / 5)
 #define HOTT_RX_SCHEDULE 4000
-#define HOTT_TX_DELAY_US 3000
+#define HOTT_TX_DELAY_MS 3 // gap the receiver needs before the response and between its bytes
 #define MILLISECONDS_IN_A_SECOND 1000
 
 static uint32_t lastHoTTRequestCheckAt = 0;
@@ -97,10 +98,19 @@ static uint32_t lastHottAlarmSoundTime = 0;
 static bool hottIsSending = false;
 
 static uint8_t *hottMsg = NULL;
-static uint8_t hottMsgRemainingBytesToSendCount;
-static uint8_t hottMsgCrc;
+static uint8_t hottMsgLength;
 
-#define HOTT_CRC_SIZE (sizeof(hottMsgCrc))
+#define HOTT_CRC_SIZE 1
+
+/*
+ * The response, with its crc, is written out one byte per HOTT_TX_DELAY_MS from the SysTick interrupt, so the
+ * spacing doesn't depend on when the telemetry task runs. The task only switches the port between RX and TX.
+ */
+static uint8_t hottTxBuffer[MAX(sizeof(HOTT_GPS_MSG_t), sizeof(HOTT_EAM_MSG_t)) + HOTT_CRC_SIZE];
+static volatile uint8_t hottTxLength;
+static volatile uint8_t hottTxIndex;
+static volatile uint8_t hottTxTicks;
+static volatile bool hottTxDone;
 
 #define HOTT_BAUDRATE 19200
 #define HOTT_INITIAL_PORT_MODE MODE_RX
@@ -275,15 +285,25 @@ void hottPrepareEAMResponse(HOTT_EAM_MSG_t *hottEAMMessage)
     hottEAMUpdateBatteryDrawnCapacity(hottEAMMessage);
 }
 
-static void hottSerialWrite(uint8_t c)
+// called from the SysTick interrupt while a response is going out
+static void hottTxTick(void)
 {
-    static uint8_t serialWrites = 0;
-    serialWrites++;
-    serialWrite(hottPort, c);
+    if (++hottTxTicks < HOTT_TX_DELAY_MS) {
+        return;
+    }
+    hottTxTicks = 0;
+
+    serialWrite(hottPort, hottTxBuffer[hottTxIndex++]);
+
+    if (hottTxIndex >= hottTxLength) {
+        systemSetTickCallback(NULL);
+        hottTxDone = true;
+    }
 }
 
 void freeHoTTTelemetryPort(void)
 {
+    systemSetTickCallback(NULL);
     closeSerialPort(hottPort);
     hottPort = NULL;
     hottTelemetryEnabled = false;
@@ -320,7 +340,7 @@ static void hottSendResponse(uint8_t *buffer, int length)
     }
 
     hottMsg = buffer;
-    hottMsgRemainingBytesToSendCount = length + HOTT_CRC_SIZE;
+    hottMsgLength = length;
 }
 
 static inline void hottSendGPSResponse(void)
@@ -443,30 +463,35 @@ static void hottSendTelemetryData(void) {
             workAroundForHottTelemetryOnUsart(hottPort, MODE_TX);
         else
             serialSetMode(hottPort, MODE_TX);
-        hottMsgCrc = 0;
-        return;
-    }
 
-    if (hottMsgRemainingBytesToSendCount == 0) {
-        hottMsg = NULL;
-        hottIsSending = false;
-        // FIXME temorary workaround for HoTT not working on Hardware serial ports due to hardware/softserial serial port initialisation differences
-        if ((portConfig->identifier == SERIAL_PORT_USART1) || (portConfig->identifier == SERIAL_PORT_USART2) || (portConfig->identifier == SERIAL_PORT_USART3))
-            workAroundForHottTelemetryOnUsart(hottPort, MODE_RX);
-        else
-            serialSetMode(hottPort, MODE_RX);
-        flushHottRxBuffer();
+        uint8_t crc = 0;
+        for (int i = 0; i < hottMsgLength; i++) {
+            hottTxBuffer[i] = hottMsg[i];
+            crc += hottMsg[i];
+        }
+        hottTxBuffer[hottMsgLength] = crc;
+
+        hottTxLength = hottMsgLength + HOTT_CRC_SIZE;
+        hottTxIndex = 0;
+        hottTxTicks = 0;
+        hottTxDone = false;
+        systemSetTickCallback(hottTxTick);
         return;
     }
 
-    --hottMsgRemainingBytesToSendCount;
-    if(hottMsgRemainingBytesToSendCount == 0) {
-        hottSerialWrite(hottMsgCrc++);
+    // the last byte is queued, wait for it to leave the port before turning the line around
+    if (!hottTxDone || !isSerialTransmitBufferEmpty(hottPort)) {
         return;
     }
 
-    hottMsgCrc += *hottMsg;
-    hottSerialWrite(*hottMsg++);
+    hottMsg = NULL;
+    hottIsSending = false;
+    // FIXME temorary workaround for HoTT not working on Hardware serial ports due to hardware/softserial serial port initialisation differences
+    if ((portConfig->identifier == SERIAL_PORT_USART1) || (portConfig->identifier == SERIAL_PORT_USART2) || (portConfig->identifier == SERIAL_PORT_USART3))
+        workAroundForHottTelemetryOnUsart(hottPort, MODE_RX);
+    else
+        serialSetMode(hottPort, MODE_RX);
+    flushHottRxBuffer();
 }
 
 static inline bool shouldPrepareHoTTMessages(uint32_t currentMicros)
@@ -498,8 +523,6 @@ void checkHoTTTelemetryState(void)
 
 void handleHoTTTelemetry(timeUs_t currentTimeUs)
 {
-    static timeUs_t serialTimer;
-
     if (!hottTelemetryEnabled) {
         return;
     }
@@ -516,13 +539,7 @@ void handleHoTTTelemetry(timeUs_t currentTimeUs)
     if (!hottMsg)
         return;
 
-    if (hottIsSending) {
-        if(currentTimeUs - serialTimer < HOTT_TX_DELAY_US) {
-            return;
-        }
-    }
     hottSendTelemetryData();
-    serialTimer = currentTimeUs;
 }
 
 #endif
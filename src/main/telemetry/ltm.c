@@ -72,6 +72,7 @@
 #include "flight/navigation.h"
 
 #include "telemetry/telemetry.h"
+#include "telemetry/telemetry_frame.h"
 #include "telemetry/ltm.h"
 
 
@@ -83,39 +84,40 @@ static serialPortConfig_t *portConfig;
 static telemetryConfig_t *telemetryConfig;
 static bool ltmEnabled;
 static portSharing_e ltmPortSharing;
-static uint8_t ltm_crc;
+
+#define LTM_FRAME_SIZE_MAX 32 // header, the largest payload and the checksum, with room to spare
+
+static uint8_t ltmFrameBuffer[LTM_FRAME_SIZE_MAX];
+static telemetryFrame_t ltmFrame;
 
 static void ltm_initialise_packet(uint8_t ltm_id)
 {
-    ltm_crc = 0;
-    serialWrite(ltmPort, '$');
-    serialWrite(ltmPort, 'T');
-    serialWrite(ltmPort, ltm_id);
+    telemetryFrameInit(&ltmFrame, ltmFrameBuffer, sizeof(ltmFrameBuffer));
+    telemetryFrameBeginOnPort(&ltmFrame, ltmPort, LTM_FRAME_SIZE_MAX);
+    telemetryFrameWriteRaw(&ltmFrame, '$');
+    telemetryFrameWriteRaw(&ltmFrame, 'T');
+    telemetryFrameWriteRaw(&ltmFrame, ltm_id);
 }
 
 static void ltm_serialise_8(uint8_t v)
 {
-    serialWrite(ltmPort, v);
-    ltm_crc ^= v;
+    telemetryFrameWriteU8(&ltmFrame, v);
 }
 
 static void ltm_serialise_16(uint16_t v)
 {
-    ltm_serialise_8((uint8_t)v);
-    ltm_serialise_8((v >> 8));
+    telemetryFrameWriteU16(&ltmFrame, v);
 }
 
 static void ltm_serialise_32(uint32_t v)
 {
-    ltm_serialise_8((uint8_t)v);
-    ltm_serialise_8((v >> 8));
-    ltm_serialise_8((v >> 16));
-    ltm_serialise_8((v >> 24));
+    telemetryFrameWriteU32(&ltmFrame, v);
 }
 
 static void ltm_finalise(void)
 {
-    serialWrite(ltmPort, ltm_crc);
+    telemetryFrameWriteRaw(&ltmFrame, ltmFrame.checksum);
+    telemetryFrameFlush(&ltmFrame, ltmPort);
 }
 
 /*
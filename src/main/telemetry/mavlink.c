@@ -31,6 +31,7 @@
 #include "common/maths.h"
 #include "common/axis.h"
 #include "common/color.h"
+#include "common/utils.h"
 
 #include "drivers/system.h"
 #include "drivers/sensor.h"
@@ -74,12 +75,16 @@
 // until this is resolved in mavlink library - ignore -Wpedantic for mavlink code
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
+#define MAVLINK_COMM_NUM_BUFFERS 1 // only the telemetry port is parsed
 #include "common/mavlink.h"
 #pragma GCC diagnostic pop
 
-#define TELEMETRY_MAVLINK_INITIAL_PORT_MODE MODE_TX
+#define TELEMETRY_MAVLINK_INITIAL_PORT_MODE MODE_RXTX
 #define TELEMETRY_MAVLINK_MAXRATE 50
 #define TELEMETRY_MAVLINK_DELAY ((1000 * 1000) / TELEMETRY_MAVLINK_MAXRATE)
+#define TELEMETRY_MAVLINK_BURST_TICKS 5 // unused bandwidth is saved for this many ticks, or one full packet on slow links
+
+#define MAVLINK_FRAME_LEN(payloadLen) ((payloadLen) + MAVLINK_NUM_NON_PAYLOAD_BYTES)
 
 extern uint16_t rssi; // FIXME dependency on mw.c
 
@@ -89,8 +94,8 @@ static serialPortConfig_t *portConfig;
 static bool mavlinkTelemetryEnabled =  false;
 static portSharing_e mavlinkPortSharing;
 
-/* MAVLink datastream rates in Hz */
-static const uint8_t mavRates[] = {
+/* MAVLink datastream rates in Hz, changed by the ground station with REQUEST_DATA_STREAM */
+static uint8_t mavRates[] = {
     [MAV_DATA_STREAM_EXTENDED_STATUS] = 2, //2Hz
     [MAV_DATA_STREAM_RC_CHANNELS] = 5, //5Hz
     [MAV_DATA_STREAM_POSITION] = 2, //2Hz
@@ -100,11 +105,23 @@ static const uint8_t mavRates[] = {
 
 #define MAXSTREAMS (sizeof(mavRates) / sizeof(mavRates[0]))
 
+/* bytes sent per stream trigger, a stream is held back until the link has room for all of it */
+static const uint8_t mavStreamLength[] = {
+    [MAV_DATA_STREAM_EXTENDED_STATUS] = MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_SYS_STATUS_LEN),
+    [MAV_DATA_STREAM_RC_CHANNELS] = MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_RC_CHANNELS_RAW_LEN),
+    [MAV_DATA_STREAM_POSITION] = MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_GPS_RAW_INT_LEN) + MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_GLOBAL_POSITION_INT_LEN) + MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_GPS_GLOBAL_ORIGIN_LEN),
+    [MAV_DATA_STREAM_EXTRA1] = MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_ATTITUDE_LEN),
+    [MAV_DATA_STREAM_EXTRA2] = MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_VFR_HUD_LEN) + MAVLINK_FRAME_LEN(MAVLINK_MSG_ID_HEARTBEAT_LEN)
+};
+
 static uint8_t mavTicks[MAXSTREAMS];
 static mavlink_message_t mavMsg;
 static uint8_t mavBuffer[MAVLINK_MAX_PACKET_LEN];
 static uint32_t lastMavlinkMessage = 0;
 
+static int32_t mavlinkTxBudget = 0;         // bytes the link can still carry
+static int32_t mavlinkTxBytesPerTick = 0;
+
 static int mavlinkStreamTrigger(enum MAV_DATA_STREAM streamNum)
 {
     uint8_t rate = (uint8_t) mavRates[streamNum];
@@ -113,6 +130,11 @@ static int mavlinkStreamTrigger(enum MAV_DATA_STREAM streamNum)
     }
 
     if (mavTicks[streamNum] == 0) {
+        // a stream the link has no room for stays due, and is tried again on the next tick
+        if (mavlinkTxBudget < mavStreamLength[streamNum] || serialTxBytesFree(mavlinkPort) < mavStreamLength[streamNum]) {
+            return 0;
+        }
+
         // we're triggering now, setup the next trigger point
         if (rate > TELEMETRY_MAVLINK_MAXRATE) {
             rate = TELEMETRY_MAVLINK_MAXRATE;
@@ -130,8 +152,35 @@ static int mavlinkStreamTrigger(enum MAV_DATA_STREAM streamNum)
 
 static void mavlinkSerialWrite(uint8_t * buf, uint16_t length)
 {
-    for (int i = 0; i < length; i++)
-        serialWrite(mavlinkPort, buf[i]);
+    serialWriteBuf(mavlinkPort, buf, length);
+    mavlinkTxBudget -= length;
+}
+
+static void mavlinkHandleRequestDataStream(const mavlink_message_t *msg)
+{
+    mavlink_request_data_stream_t request;
+    mavlink_msg_request_data_stream_decode(msg, &request);
+
+    const uint8_t rate = request.start_stop ? MIN(request.req_message_rate, TELEMETRY_MAVLINK_MAXRATE) : 0;
+
+    for (unsigned streamNum = 0; streamNum < MAXSTREAMS; streamNum++) {
+        if (mavStreamLength[streamNum] && (request.req_stream_id == MAV_DATA_STREAM_ALL || request.req_stream_id == streamNum)) {
+            mavRates[streamNum] = rate;
+            mavTicks[streamNum] = 0;
+        }
+    }
+}
+
+static void mavlinkReceive(void)
+{
+    static mavlink_message_t msg;
+    static mavlink_status_t status;
+
+    while (serialRxBytesWaiting(mavlinkPort) > 0) {
+        if (mavlink_parse_char(MAVLINK_COMM_0, serialRead(mavlinkPort), &msg, &status) && msg.msgid == MAVLINK_MSG_ID_REQUEST_DATA_STREAM) {
+            mavlinkHandleRequestDataStream(&msg);
+        }
+    }
 }
 
 void freeMAVLinkTelemetryPort(void)
@@ -165,6 +214,10 @@ void configureMAVLinkTelemetryPort(void)
         return;
     }
 
+    // 10 bits per byte on the wire
+    mavlinkTxBytesPerTick = baudRates[baudRateIndex] / 10 / TELEMETRY_MAVLINK_MAXRATE;
+    mavlinkTxBudget = 0;
+
     mavlinkTelemetryEnabled = true;
 }
 
@@ -173,6 +226,8 @@ void checkMAVLinkTelemetryState(void)
     if (portConfig && telemetryCheckRxPortShared(portConfig)) {
         if (!mavlinkTelemetryEnabled && telemetrySharedPort != NULL) {
             mavlinkPort = telemetrySharedPort;
+            mavlinkTxBytesPerTick = telemetrySharedPort->baudRate / 10 / TELEMETRY_MAVLINK_MAXRATE;
+            mavlinkTxBudget = 0;
             mavlinkTelemetryEnabled = true;
         }
     } else {
@@ -514,30 +569,38 @@ void mavlinkSendHUDAndHeartbeat(void)
     mavlinkSerialWrite(mavBuffer, msgLength);
 }
 
-void processMAVLinkTelemetry(void)
-{
-    // is executed @ TELEMETRY_MAVLINK_MAXRATE rate
-    if (mavlinkStreamTrigger(MAV_DATA_STREAM_EXTENDED_STATUS)) {
-        mavlinkSendSystemStatus();
-    }
-
-    if (mavlinkStreamTrigger(MAV_DATA_STREAM_RC_CHANNELS)) {
-        mavlinkSendRCChannelsAndRSSI();
-    }
+typedef struct mavlinkStream_s {
+    enum MAV_DATA_STREAM streamNum;
+    void (*send)(void);
+} mavlinkStream_t;
 
+static const mavlinkStream_t mavStreams[] = {
+    { MAV_DATA_STREAM_EXTENDED_STATUS, mavlinkSendSystemStatus },
+    { MAV_DATA_STREAM_RC_CHANNELS, mavlinkSendRCChannelsAndRSSI },
 #ifdef GPS
-    if (mavlinkStreamTrigger(MAV_DATA_STREAM_POSITION)) {
-        mavlinkSendPosition();
-    }
+    { MAV_DATA_STREAM_POSITION, mavlinkSendPosition },
 #endif
+    { MAV_DATA_STREAM_EXTRA1, mavlinkSendAttitude },
+    { MAV_DATA_STREAM_EXTRA2, mavlinkSendHUDAndHeartbeat },
+};
 
-    if (mavlinkStreamTrigger(MAV_DATA_STREAM_EXTRA1)) {
-        mavlinkSendAttitude();
-    }
+void processMAVLinkTelemetry(void)
+{
+    // the first stream checked rotates, so a slow link shares its bandwidth between the streams
+    static uint8_t firstStream = 0;
+
+    // is executed @ TELEMETRY_MAVLINK_MAXRATE rate
+    const int32_t maxBudget = MAX(mavlinkTxBytesPerTick * TELEMETRY_MAVLINK_BURST_TICKS, MAVLINK_MAX_PACKET_LEN);
+    mavlinkTxBudget = MIN(mavlinkTxBudget + mavlinkTxBytesPerTick, maxBudget);
 
-    if (mavlinkStreamTrigger(MAV_DATA_STREAM_EXTRA2)) {
-        mavlinkSendHUDAndHeartbeat();
+    for (unsigned i = 0; i < ARRAYLEN(mavStreams); i++) {
+        const mavlinkStream_t *stream = &mavStreams[(firstStream + i) % ARRAYLEN(mavStreams)];
+        if (mavlinkStreamTrigger(stream->streamNum)) {
+            stream->send();
+        }
     }
+
+    firstStream = (firstStream + 1) % ARRAYLEN(mavStreams);
 }
 
 void handleMAVLinkTelemetry(void)
@@ -550,6 +613,11 @@ void handleMAVLinkTelemetry(void)
         return;
     }
 
+    // a port shared with serial RX only transmits
+    if (mavlinkPort != telemetrySharedPort) {
+        mavlinkReceive();
+    }
+
     uint32_t now = micros();
     if ((now - lastMavlinkMessage) >= TELEMETRY_MAVLINK_DELAY) {
         processMAVLinkTelemetry();
@@ -0,0 +1,252 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#ifdef TELEMETRY
+
+#include "common/streambuf.h"
+#include "common/utils.h"
+
+#include "fc/fc_msp.h"
+
+#include "msp/msp.h"
+
+#include "telemetry/msp_telemetry.h"
+
+#define MSP_TELEMETRY_VER_SHIFT     5
+#define MSP_TELEMETRY_VER_MASK      (0x7 << MSP_TELEMETRY_VER_SHIFT)
+
+#define MSP_TELEMETRY_ERROR_FLAG    (1 << 5)
+#define MSP_TELEMETRY_START_FLAG    (1 << 4)
+#define MSP_TELEMETRY_SEQ_MASK      0x0F
+
+#define MSP_TELEMETRY_RX_BUF_SIZE   64
+#define MSP_TELEMETRY_TX_BUF_SIZE   256
+
+#define MSP_TELEMETRY_RES_ERROR     (-10)
+
+enum {
+    MSP_TELEMETRY_VER_MISMATCH = 0,
+    MSP_TELEMETRY_CRC_ERROR = 1,
+    MSP_TELEMETRY_ERROR = 2
+};
+
+static uint8_t mspTelemetryRequestBuffer[MSP_TELEMETRY_RX_BUF_SIZE];
+static mspPacket_t mspTelemetryRequest;
+static bool mspTelemetryRequestStarted = false;
+static uint8_t mspTelemetryRequestSeq;
+static uint8_t mspTelemetryRequestChecksum;
+
+static uint8_t mspTelemetryReplyBuffer[MSP_TELEMETRY_TX_BUF_SIZE];
+static mspPacket_t mspTelemetryReply;
+static bool mspTelemetryReplyActive = false;    // chunks are left to encode
+static uint8_t mspTelemetryReplySize;
+static uint8_t mspTelemetryReplyChecksum;
+static uint8_t mspTelemetryReplyFirstSeq = 0;   // sequence number of the start chunk
+static uint8_t mspTelemetryReplyChunks = 0;     // chunks encoded so far
+static uint8_t mspTelemetryReplyChunkSize;      // fixed for the whole reply, so a chunk can be found again
+
+static void mspTelemetryInitReply(int16_t cmd)
+{
+    mspTelemetryReply.buf.ptr = mspTelemetryReplyBuffer;
+    mspTelemetryReply.buf.end = ARRAYEND(mspTelemetryReplyBuffer);
+
+    mspTelemetryReply.cmd = cmd;
+    mspTelemetryReply.result = 0;
+}
+
+static void mspTelemetryStartReply(void)
+{
+    // change streambuf direction
+    sbufSwitchToReader(&mspTelemetryReply.buf, mspTelemetryReplyBuffer);
+
+    mspTelemetryReplySize = sbufBytesRemaining(&mspTelemetryReply.buf);
+    mspTelemetryReplyChecksum = mspTelemetryReplySize ^ mspTelemetryReply.cmd;
+    // the sequence carries on from the last reply
+    mspTelemetryReplyFirstSeq = (mspTelemetryReplyFirstSeq + mspTelemetryReplyChunks) & MSP_TELEMETRY_SEQ_MASK;
+    mspTelemetryReplyChunks = 0;
+    mspTelemetryReplyActive = true;
+}
+
+static void mspTelemetrySendErrorReply(uint8_t error, int16_t cmd)
+{
+    mspTelemetryInitReply(cmd);
+    sbufWriteU8(&mspTelemetryReply.buf, error);
+    mspTelemetryReply.result = MSP_TELEMETRY_RES_ERROR;
+    mspTelemetryStartReply();
+}
+
+static void mspTelemetryProcessRequest(mspPacket_t *request)
+{
+    mspTelemetryInitReply(0);
+
+    const mspResult_e status = mspFcProcessCommand(request, &mspTelemetryReply, NULL);
+    if (status == MSP_RESULT_BUSY) {
+        // there is nowhere to hold the request, the host sends it again on the error
+        mspTelemetryReply.result = MSP_RESULT_ERROR;
+    }
+    if (status == MSP_RESULT_ERROR || status == MSP_RESULT_BUSY) {
+        sbufWriteU8(&mspTelemetryReply.buf, MSP_TELEMETRY_ERROR);
+    }
+
+    mspTelemetryStartReply();
+}
+
+// the start chunk loses a byte to the size, every other chunk one to the header alone
+static int mspTelemetryReplyChunkOffset(uint8_t chunk)
+{
+    return chunk ? (mspTelemetryReplyChunkSize - 2) + (chunk - 1) * (mspTelemetryReplyChunkSize - 1) : 0;
+}
+
+static bool mspTelemetryRewindReply(uint8_t seq)
+{
+    const uint8_t chunk = (seq - mspTelemetryReplyFirstSeq) & MSP_TELEMETRY_SEQ_MASK;
+
+    if (chunk >= mspTelemetryReplyChunks || mspTelemetryReplyChunks - chunk > MSP_TELEMETRY_WINDOW) {
+        return false;
+    }
+
+    const int offset = mspTelemetryReplyChunkOffset(chunk);
+    mspTelemetryReplyChecksum = mspTelemetryReplySize ^ mspTelemetryReply.cmd;
+    for (int i = 0; i < offset; i++) {
+        mspTelemetryReplyChecksum ^= mspTelemetryReplyBuffer[i];
+    }
+    mspTelemetryReply.buf.ptr = mspTelemetryReplyBuffer + offset;
+    mspTelemetryReplyChunks = chunk;
+    mspTelemetryReplyActive = true;
+    return true;
+}
+
+bool mspTelemetryHandleRequest(const uint8_t *chunk, int chunkSize)
+{
+    const uint8_t *p = chunk;
+    const uint8_t *end = chunk + chunkSize;
+
+    const uint8_t head = *p++;
+    const uint8_t seq = head & MSP_TELEMETRY_SEQ_MASK;
+    const uint8_t version = (head & MSP_TELEMETRY_VER_MASK) >> MSP_TELEMETRY_VER_SHIFT;
+
+    if (version != MSP_TELEMETRY_VERSION) {
+        mspTelemetryRequestStarted = false;
+        mspTelemetrySendErrorReply(MSP_TELEMETRY_VER_MISMATCH, 0);
+        return true;
+    }
+
+    if (head & MSP_TELEMETRY_START_FLAG) {
+        const uint8_t size = *p++;
+        mspTelemetryRequest.cmd = *p++;
+        mspTelemetryRequest.result = 0;
+
+        if (size > MSP_TELEMETRY_RX_BUF_SIZE) {
+            mspTelemetryRequestStarted = false;
+            mspTelemetrySendErrorReply(MSP_TELEMETRY_ERROR, mspTelemetryRequest.cmd);
+            return true;
+        }
+
+        mspTelemetryRequest.buf.ptr = mspTelemetryRequestBuffer;
+        mspTelemetryRequest.buf.end = mspTelemetryRequestBuffer + size;
+
+        mspTelemetryRequestChecksum = size ^ mspTelemetryRequest.cmd;
+        mspTelemetryRequestStarted = true;
+    } else if (!mspTelemetryRequestStarted) {
+        // a continuation outside a request asks for the reply from this chunk on
+        return mspTelemetryRewindReply(seq);
+    } else if (((mspTelemetryRequestSeq + 1) & MSP_TELEMETRY_SEQ_MASK) != seq) {
+        // packet loss detected!
+        mspTelemetryRequestStarted = false;
+        return false;
+    }
+
+    // copy payload bytes
+    while ((p < end) && sbufBytesRemaining(&mspTelemetryRequest.buf)) {
+        mspTelemetryRequestChecksum ^= *p;
+        sbufWriteU8(&mspTelemetryRequest.buf, *p++);
+    }
+
+    // reached end of the chunk
+    if (p == end) {
+        mspTelemetryRequestSeq = seq;
+        return false;
+    }
+
+    mspTelemetryRequestStarted = false;
+
+    // last byte must be the checksum
+    if (mspTelemetryRequestChecksum != *p) {
+        mspTelemetrySendErrorReply(MSP_TELEMETRY_CRC_ERROR, mspTelemetryRequest.cmd);
+        return true;
+    }
+
+    sbufSwitchToReader(&mspTelemetryRequest.buf, mspTelemetryRequestBuffer);
+    mspTelemetryProcessRequest(&mspTelemetryRequest);
+    return true;
+}
+
+bool mspTelemetryReplyPending(void)
+{
+    return mspTelemetryReplyActive;
+}
+
+bool mspTelemetryEncodeReply(uint8_t *chunk, int chunkSize)
+{
+    uint8_t *p = chunk;
+    uint8_t *end = chunk + chunkSize;
+    sbuf_t *txBuf = &mspTelemetryReply.buf;
+
+    if (!mspTelemetryReplyActive) {
+        return false;
+    }
+
+    const uint8_t seq = (mspTelemetryReplyFirstSeq + mspTelemetryReplyChunks) & MSP_TELEMETRY_SEQ_MASK;
+    if (mspTelemetryReplyChunks == 0) {
+        uint8_t head = MSP_TELEMETRY_START_FLAG | seq;
+        if (mspTelemetryReply.result < 0) {
+            head |= MSP_TELEMETRY_ERROR_FLAG;
+        }
+        *p++ = head;
+        *p++ = mspTelemetryReplySize;
+        mspTelemetryReplyChunkSize = chunkSize;
+    } else {
+        *p++ = seq;
+    }
+    mspTelemetryReplyChunks++;
+
+    while ((p < end) && (sbufBytesRemaining(txBuf) > 0)) {
+        *p = sbufReadU8(txBuf);
+        mspTelemetryReplyChecksum ^= *p++;
+    }
+
+    // to be continued...
+    if (p == end) {
+        return true;
+    }
+
+    // nothing left in txBuf, append the MSP checksum and pad with zeros
+    *p++ = mspTelemetryReplyChecksum;
+    while (p < end) {
+        *p++ = 0;
+    }
+
+    mspTelemetryReplyActive = false;
+    return false;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * MSP carried over a telemetry link that moves a few bytes per frame. A request arrives in chunks and is run once
+ * complete, and the reply goes back in numbered chunks, one per free downlink slot until it is all out.
+ *
+ * Each chunk starts with a header byte: protocol version (3 bits, requests only), error flag (replies only),
+ * start flag and a 4 bit sequence number. The start chunk follows the header with the payload size, and for
+ * requests the command. The last chunk carries the xor checksum of size, command and payload.
+ *
+ * The last MSP_TELEMETRY_WINDOW reply chunks can be sent again. A client that sees a gap in the sequence sends
+ * a continuation chunk outside a request, whose sequence number is the first reply chunk it is missing, and the
+ * reply is resent from there. Anything older has left the window and the client has to repeat the request.
+ */
+
+#define MSP_TELEMETRY_VERSION       1
+#define MSP_TELEMETRY_WINDOW        8   // less than the 16 sequence numbers, so a chunk in the window is unambiguous
+
+// one request chunk with its header, returns true when the reply was started or rewound
+bool mspTelemetryHandleRequest(const uint8_t *chunk, int chunkSize);
+
+bool mspTelemetryReplyPending(void);
+// writes the next reply chunk padded to chunkSize, returns true while more chunks follow
+bool mspTelemetryEncodeReply(uint8_t *chunk, int chunkSize);
@@ -11,11 +11,14 @@
 
 #ifdef TELEMETRY
 
+#include "build/atomic.h"
+
 #include "common/axis.h"
 #include "common/color.h"
 #include "common/maths.h"
 #include "common/utils.h"
 
+#include "drivers/nvic.h"
 #include "drivers/system.h"
 #include "drivers/sensor.h"
 #include "drivers/accgyro.h"
@@ -24,7 +27,6 @@
 #include "fc/config.h"
 #include "fc/rc_controls.h"
 #include "fc/runtime_config.h"
-#include "fc/fc_msp.h"
 
 #include "io/beeper.h"
 #include "io/motors.h"
@@ -50,12 +52,13 @@
 #include "rx/msp.h"
 
 #include "telemetry/telemetry.h"
+#include "telemetry/msp_telemetry.h"
 #include "telemetry/smartport.h"
+#include "telemetry/telemetry_values.h"
 
 #include "config/config_profile.h"
 #include "config/feature.h"
 
-#include "msp/msp.h"
 
 extern profile_t *currentProfile;
 extern controlRateConfig_t *currentControlRateProfile;
@@ -115,37 +118,37 @@ enum
     FSSP_DATAID_A4         = 0x0910
 };
 
-const uint16_t frSkyDataIdTable[] = {
-    FSSP_DATAID_SPEED     ,
-    FSSP_DATAID_VFAS      ,
-    FSSP_DATAID_CURRENT   ,
-    //FSSP_DATAID_RPM       ,
-    FSSP_DATAID_ALTITUDE  ,
-    FSSP_DATAID_FUEL      ,
-    //FSSP_DATAID_ADC1      ,
-    //FSSP_DATAID_ADC2      ,
-    FSSP_DATAID_LATLONG   ,
-    FSSP_DATAID_LATLONG   , // twice
-    //FSSP_DATAID_CAP_USED  ,
-    FSSP_DATAID_VARIO     ,
-    //FSSP_DATAID_CELLS     ,
-    //FSSP_DATAID_CELLS_LAST,
-    FSSP_DATAID_HEADING   ,
-    FSSP_DATAID_ACCX      ,
-    FSSP_DATAID_ACCY      ,
-    FSSP_DATAID_ACCZ      ,
-    FSSP_DATAID_T1        ,
-    FSSP_DATAID_T2        ,
-    FSSP_DATAID_GPS_ALT   ,
-    FSSP_DATAID_A4        ,
-    0
+typedef struct smartPortSubscription_s {
+    uint16_t id;
+    telemetrySubscription_t subscription;
+} smartPortSubscription_t;
+
+// in priority order, the first value that is due and available takes the slot
+static smartPortSubscription_t smartPortSubscriptions[] = {
+    { FSSP_DATAID_VFAS,     { TELEMETRY_VALUE_VBAT,      200, 1000,  1, 0, 0, false } },
+    { FSSP_DATAID_A4,       { TELEMETRY_VALUE_VBAT,      200, 1000,  1, 0, 0, false } },
+    { FSSP_DATAID_CURRENT,  { TELEMETRY_VALUE_AMPERAGE,  200, 1000, 10, 0, 0, false } },
+    { FSSP_DATAID_FUEL,     { TELEMETRY_VALUE_MAH_DRAWN, 500, 2000,  1, 0, 0, false } },
+    { FSSP_DATAID_ALTITUDE, { TELEMETRY_VALUE_BARO_ALT,  200, 1000, 10, 0, 0, false } },
+    { FSSP_DATAID_VARIO,    { TELEMETRY_VALUE_VARIO,     100, 1000, 10, 0, 0, false } },
+    { FSSP_DATAID_HEADING,  { TELEMETRY_VALUE_HEADING,   200, 1000, 10, 0, 0, false } },
+    { FSSP_DATAID_ACCX,     { TELEMETRY_VALUE_ACC_X,     200, 1000,  5, 0, 0, false } },
+    { FSSP_DATAID_ACCY,     { TELEMETRY_VALUE_ACC_Y,     200, 1000,  5, 0, 0, false } },
+    { FSSP_DATAID_ACCZ,     { TELEMETRY_VALUE_ACC_Z,     200, 1000,  5, 0, 0, false } },
+    { FSSP_DATAID_T1,       { TELEMETRY_VALUE_NONE,      500, 1000,  0, 0, 0, false } },
+    { FSSP_DATAID_T2,       { TELEMETRY_VALUE_NONE,      500, 1000,  0, 0, 0, false } },
+#ifdef GPS
+    { FSSP_DATAID_SPEED,    { TELEMETRY_VALUE_NONE,      200, 1000,  0, 0, 0, false } },
+    { FSSP_DATAID_LATLONG,  { TELEMETRY_VALUE_NONE,      100, 1000,  0, 0, 0, false } }, // alternates latitude and longitude
+    { FSSP_DATAID_GPS_ALT,  { TELEMETRY_VALUE_NONE,      500, 1000,  0, 0, 0, false } },
+#endif
 };
 
 #define __USE_C99_MATH // for roundf()
 #define SMARTPORT_BAUD 57600
 #define SMARTPORT_UART_MODE MODE_RXTX
-#define SMARTPORT_SERVICE_TIMEOUT_MS 1 // max allowed time to find a value to send
 #define SMARTPORT_NOT_CONNECTED_TIMEOUT_MS 7000
+#define SMARTPORT_LATE_REPLY_MS 1 // a reply sent later than this may collide with the next sensor
 
 static serialPort_t *smartPortSerialPort = NULL; // The 'SmartPort'(tm) Port.
 static serialPortConfig_t *portConfig;
@@ -155,9 +158,8 @@ static bool smartPortTelemetryEnabled =  false;
 static portSharing_e smartPortPortSharing;
 
 char smartPortState = SPSTATE_UNINITIALIZED;
-static uint8_t smartPortHasRequest = 0;
-static uint8_t smartPortIdCnt = 0;
-static uint32_t smartPortLastRequestTime = 0;
+static volatile uint8_t smartPortHasRequest = 0;
+static volatile uint32_t smartPortLastRequestTime = 0;
 
 typedef struct smartPortFrame_s {
     uint8_t  sensorId;
@@ -168,38 +170,39 @@ typedef struct smartPortFrame_s {
 } __attribute__((packed)) smartPortFrame_t;
 
 #define SMARTPORT_FRAME_SIZE  sizeof(smartPortFrame_t)
-#define SMARTPORT_TX_BUF_SIZE 256
 
 #define SMARTPORT_PAYLOAD_OFFSET offsetof(smartPortFrame_t, valueId)
 #define SMARTPORT_PAYLOAD_SIZE   (SMARTPORT_FRAME_SIZE - SMARTPORT_PAYLOAD_OFFSET - 1)
 
 static smartPortFrame_t smartPortRxBuffer;
 static uint8_t smartPortRxBytes = 0;
-static bool smartPortFrameReceived = false;
-
-#define SMARTPORT_MSP_VERSION    1
-#define SMARTPORT_MSP_VER_SHIFT  5
-#define SMARTPORT_MSP_VER_MASK   (0x7 << SMARTPORT_MSP_VER_SHIFT)
-#define SMARTPORT_MSP_VERSION_S  (SMARTPORT_MSP_VERSION << SMARTPORT_MSP_VER_SHIFT)
+static volatile bool smartPortFrameReceived = false;
 
-#define SMARTPORT_MSP_ERROR_FLAG (1 << 5)
-#define SMARTPORT_MSP_START_FLAG (1 << 4)
-#define SMARTPORT_MSP_SEQ_MASK   0x0F
+static bool smartPortMspReplyStarted = false;   // a new reply replaces any frame encoded from the last one
 
-#define SMARTPORT_MSP_RX_BUF_SIZE 64
+// frame id, payload and crc, each of which may need an escape byte
+#define SMARTPORT_TX_FRAME_SIZE ((1 + SMARTPORT_PAYLOAD_SIZE + 1) * 2)
 
-static uint8_t smartPortMspTxBuffer[SMARTPORT_TX_BUF_SIZE];
-static mspPacket_t smartPortMspReply;
-static bool smartPortMspReplyPending = false;
+typedef struct smartPortTxFrame_s {
+    uint8_t data[SMARTPORT_TX_FRAME_SIZE];
+    uint8_t len;
+    smartPortSubscription_t *entry;     // the value carried, NULL for MSP replies
+} smartPortTxFrame_t;
 
-#define SMARTPORT_MSP_RES_ERROR (-10)
+/*
+ * The reply for the next poll is encoded ahead of time and sent from the receive interrupt the moment our sensor
+ * ID is polled, instead of waiting for the telemetry task. The task takes the frame back on every pass to refresh it.
+ */
+static smartPortTxFrame_t smartPortTxFrameBuffer;
+static smartPortTxFrame_t * volatile smartPortTxFrame = NULL;       // ready to send, owned by the interrupt
+static smartPortTxFrame_t * volatile smartPortTxFrameSent = NULL;   // sent by the interrupt, not yet accounted for
 
-enum {
-    SMARTPORT_MSP_VER_MISMATCH=0,
-    SMARTPORT_MSP_CRC_ERROR=1,
-    SMARTPORT_MSP_ERROR=2
-};
+static void smartPortSendTxFrame(smartPortTxFrame_t *frame)
+{
+    serialWriteBuf(smartPortSerialPort, frame->data, frame->len);
+}
 
+// called from the serial port's receive interrupt
 static void smartPortDataReceive(uint16_t c)
 {
     static bool skipUntilStart = true;
@@ -219,12 +222,22 @@ static void smartPortDataReceive(uint16_t c)
 
     uint8_t* rxBuffer = (uint8_t*)&smartPortRxBuffer;
     if (smartPortRxBytes == 0) {
-        if ((c == FSSP_SENSOR_ID1) && (serialRxBytesWaiting(smartPortSerialPort) == 0)) {
+        if (c == FSSP_SENSOR_ID1) {
 
             // our slot is starting...
             smartPortLastRequestTime = now;
-            smartPortHasRequest = 1;
-        } else if (c == FSSP_SENSOR_ID2) {
+            smartPortTxFrame_t *frame = smartPortTxFrame;
+            if (frame && serialTxBytesFree(smartPortSerialPort) >= frame->len) {
+                smartPortSendTxFrame(frame);
+                smartPortTxFrame = NULL;
+                smartPortTxFrameSent = frame;
+            } else {
+                // nothing prepared in time, leave the slot to the telemetry task
+                smartPortHasRequest = 1;
+            }
+            skipUntilStart = true;
+        } else if (c == FSSP_SENSOR_ID2 && !smartPortFrameReceived) {
+            // a frame the telemetry task is still to process is never overwritten, the sender retries
             rxBuffer[smartPortRxBytes++] = c;
             checksum = 0;
         }
@@ -259,15 +272,15 @@ static void smartPortDataReceive(uint16_t c)
     }
 }
 
-static void smartPortSendByte(uint8_t c, uint16_t *crcp)
+static void smartPortEncodeByte(smartPortTxFrame_t *frame, uint8_t c, uint16_t *crcp)
 {
     // smart port escape sequence
     if (c == FSSP_DLE || c == FSSP_START_STOP) {
-        serialWrite(smartPortSerialPort, FSSP_DLE);
-        serialWrite(smartPortSerialPort, c ^ FSSP_DLE_XOR);
+        frame->data[frame->len++] = FSSP_DLE;
+        frame->data[frame->len++] = c ^ FSSP_DLE_XOR;
     }
     else {
-        serialWrite(smartPortSerialPort, c);
+        frame->data[frame->len++] = c;
     }
 
     if (crcp == NULL)
@@ -280,17 +293,18 @@ static void smartPortSendByte(uint8_t c, uint16_t *crcp)
     *crcp = crc;
 }
 
-static void smartPortSendPackageEx(uint8_t frameId, uint8_t* data)
+static void smartPortEncodePackageEx(smartPortTxFrame_t *frame, uint8_t frameId, uint8_t* data)
 {
     uint16_t crc = 0;
-    smartPortSendByte(frameId, &crc);
+    frame->len = 0;
+    smartPortEncodeByte(frame, frameId, &crc);
     for(unsigned i = 0; i < SMARTPORT_PAYLOAD_SIZE; i++) {
-        smartPortSendByte(*data++, &crc);
+        smartPortEncodeByte(frame, *data++, &crc);
     }
-    smartPortSendByte(0xFF - (uint8_t)crc, NULL);
+    smartPortEncodeByte(frame, 0xFF - (uint8_t)crc, NULL);
 }
 
-static void smartPortSendPackage(uint16_t id, uint32_t val)
+static void smartPortEncodePackage(smartPortTxFrame_t *frame, uint16_t id, uint32_t val)
 {
     uint8_t payload[SMARTPORT_PAYLOAD_SIZE];
     uint8_t *dst = payload;
@@ -301,7 +315,7 @@ static void smartPortSendPackage(uint16_t id, uint32_t val)
     *dst++ = (val >> 16) & 0xFF;
     *dst++ = (val >> 24) & 0xFF;
 
-    smartPortSendPackageEx(FSSP_DATA_FRAME,payload);
+    smartPortEncodePackageEx(frame, FSSP_DATA_FRAME, payload);
 }
 
 void initSmartPortTelemetry(telemetryConfig_t *initialTelemetryConfig)
@@ -315,6 +329,8 @@ void freeSmartPortTelemetryPort(void)
 {
     closeSerialPort(smartPortSerialPort);
     smartPortSerialPort = NULL;
+    smartPortTxFrame = NULL;
+    smartPortTxFrameSent = NULL;
 
     smartPortState = SPSTATE_UNINITIALIZED;
     smartPortTelemetryEnabled = false;
@@ -336,7 +352,7 @@ void configureSmartPortTelemetryPort(void)
         portOptions |= SERIAL_INVERTED;
     }
     
-    smartPortSerialPort = openSerialPort(portConfig->identifier, FUNCTION_TELEMETRY_SMARTPORT, NULL, SMARTPORT_BAUD, SMARTPORT_UART_MODE, portOptions);
+    smartPortSerialPort = openSerialPort(portConfig->identifier, FUNCTION_TELEMETRY_SMARTPORT, smartPortDataReceive, SMARTPORT_BAUD, SMARTPORT_UART_MODE, portOptions);
 
     if (!smartPortSerialPort) {
         return;
@@ -371,200 +387,267 @@ void checkSmartPortTelemetryState(void)
         freeSmartPortTelemetryPort();
 }
 
-static void initSmartPortMspReply(int16_t cmd)
+static void smartPortEncodeMspReply(smartPortTxFrame_t *frame)
 {
-    smartPortMspReply.buf.ptr    = smartPortMspTxBuffer;
-    smartPortMspReply.buf.end    = ARRAYEND(smartPortMspTxBuffer);
+    uint8_t packet[SMARTPORT_PAYLOAD_SIZE];
 
-    smartPortMspReply.cmd    = cmd;
-    smartPortMspReply.result = 0;
+    mspTelemetryEncodeReply(packet, SMARTPORT_PAYLOAD_SIZE);
+    smartPortEncodePackageEx(frame, FSSP_MSPS_FRAME, packet);
 }
 
-static void processMspPacket(mspPacket_t* packet)
-{
-    initSmartPortMspReply(0);
-
-    if (mspFcProcessCommand(packet, &smartPortMspReply, NULL) == MSP_RESULT_ERROR) {
-        sbufWriteU8(&smartPortMspReply.buf, SMARTPORT_MSP_ERROR);
-    }
-
-    // change streambuf direction
-    sbufSwitchToReader(&smartPortMspReply.buf, smartPortMspTxBuffer);
-    smartPortMspReplyPending = true;
-}
+static uint8_t t1Cnt = 1;
+static uint8_t t2Cnt = 0;
+static bool smartPortLatLongOdd = false;
 
-/**
- * Request frame format:
- * - Header: 1 byte
- *   - Reserved: 2 bits (future use)
- *   - Error-flag: 1 bit
- *   - Start-flag: 1 bit
- *   - CSeq: 4 bits
- *
- * - MSP payload:
- *   - if Error-flag == 0:
- *     - size: 1 byte
- *     - payload
- *     - CRC (request type included)
- *   - if Error-flag == 1:
- *     - size: 1 byte (== 1)
- *     - error: 1 Byte
- *       - 0: Version mismatch (type=0)
- *       - 1: Sequence number error
- *       - 2: MSP error
- *     - CRC (request type included)
- */
-bool smartPortSendMspReply()
+// returns false if the value isn't available, leaving the slot to the next one due
+static bool smartPortEncodeValue(smartPortTxFrame_t *frame, uint16_t id)
 {
-    static uint8_t checksum = 0;
-    static uint8_t seq = 0;
-
-    uint8_t packet[SMARTPORT_PAYLOAD_SIZE];
-    uint8_t* p = packet;
-    uint8_t* end = p + SMARTPORT_PAYLOAD_SIZE;
-
-    sbuf_t* txBuf = &smartPortMspReply.buf;
+    int32_t tmpi;
+    uint32_t tmp2 = 0;
 
-    // detect first reply packet
-    if (txBuf->ptr == smartPortMspTxBuffer) {
-
-        // header
-        uint8_t head = SMARTPORT_MSP_START_FLAG | (seq++ & SMARTPORT_MSP_SEQ_MASK);
-        if (smartPortMspReply.result < 0) {
-            head |= SMARTPORT_MSP_ERROR_FLAG;
-        }
-        *p++ = head;
-
-        uint8_t size = sbufBytesRemaining(txBuf);
-        *p++ = size;
-
-        checksum = size ^ smartPortMspReply.cmd;
-    }
-    else {
-        // header
-        *p++ = (seq++ & SMARTPORT_MSP_SEQ_MASK);
-    }
-
-    while ((p < end) && (sbufBytesRemaining(txBuf) > 0)) {
-        *p = sbufReadU8(txBuf);
-        checksum ^= *p++; // MSP checksum
-    }
-
-    // to be continued...
-    if (p == end) {
-        smartPortSendPackageEx(FSSP_MSPS_FRAME,packet);
-        return true;
+    switch(id) {
+#ifdef GPS
+        case FSSP_DATAID_SPEED      :
+            if (sensors(SENSOR_GPS) && STATE(GPS_FIX)) {
+                //convert to knots: 1cm/s = 0.0194384449 knots
+                //Speed should be sent in knots/1000 (GPS speed is in cm/s)
+                uint32_t tmpui = GPS_speed * 1944 / 100;
+                smartPortEncodePackage(frame, id, tmpui);
+                return true;
+            }
+            break;
+#endif
+        case FSSP_DATAID_VFAS       :
+            if (feature(FEATURE_VBAT) && batteryCellCount > 0) {
+                uint16_t vfasVoltage;
+                if (telemetryConfig->frsky_vfas_cell_voltage) {
+                    vfasVoltage = vbat / batteryCellCount;
+                } else {
+                    vfasVoltage = vbat;
+                }
+                smartPortEncodePackage(frame, id, vfasVoltage * 10); // given in 0.1V, convert to volts
+                return true;
+            }
+            break;
+        case FSSP_DATAID_CURRENT    :
+            if (feature(FEATURE_CURRENT_METER) || feature(FEATURE_ESC_SENSOR)) {
+                smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_AMPERAGE) / 10); // given in 10mA steps, unknown requested unit
+                return true;
+            }
+            break;
+        //case FSSP_DATAID_RPM        :
+        case FSSP_DATAID_ALTITUDE   :
+            if (sensors(SENSOR_BARO)) {
+                smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_BARO_ALT)); // unknown given unit, requested 100 = 1 meter
+                return true;
+            }
+            break;
+        case FSSP_DATAID_FUEL       :
+            if (feature(FEATURE_CURRENT_METER) || feature(FEATURE_ESC_SENSOR)) {
+                smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_MAH_DRAWN)); // given in mAh, unknown requested unit
+                return true;
+            }
+            break;
+        //case FSSP_DATAID_ADC1       :
+        //case FSSP_DATAID_ADC2       :
+#ifdef GPS
+        case FSSP_DATAID_LATLONG    :
+            if (sensors(SENSOR_GPS) && STATE(GPS_FIX)) {
+                uint32_t tmpui = 0;
+                // the same ID is sent twice, one for longitude, one for latitude
+                // the MSB of the sent uint32_t helps FrSky keep track
+                // alternating between the two on each send lets us keep track
+                if (smartPortLatLongOdd) {
+                    tmpui = abs(GPS_coord[LON]);  // now we have unsigned value and one bit to spare
+                    tmpui = (tmpui + tmpui / 2) / 25 | 0x80000000;  // 6/100 = 1.5/25, division by power of 2 is fast
+                    if (GPS_coord[LON] < 0) tmpui |= 0x40000000;
+                }
+                else {
+                    tmpui = abs(GPS_coord[LAT]);  // now we have unsigned value and one bit to spare
+                    tmpui = (tmpui + tmpui / 2) / 25;  // 6/100 = 1.5/25, division by power of 2 is fast
+                    if (GPS_coord[LAT] < 0) tmpui |= 0x40000000;
+                }
+                smartPortEncodePackage(frame, id, tmpui);
+                return true;
+            }
+            break;
+#endif
+        //case FSSP_DATAID_CAP_USED   :
+        case FSSP_DATAID_VARIO      :
+            if (sensors(SENSOR_BARO)) {
+                smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_VARIO)); // unknown given unit but requested in 100 = 1m/s
+                return true;
+            }
+            break;
+        case FSSP_DATAID_HEADING    :
+            smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_HEADING) * 10); // given in 10*deg, requested in 10000 = 100 deg
+            return true;
+            break;
+        case FSSP_DATAID_ACCX       :
+            smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_ACC_X)); // Multiply by 100 to show as x.xx g on Taranis
+            return true;
+            break;
+        case FSSP_DATAID_ACCY       :
+            smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_ACC_Y));
+            return true;
+            break;
+        case FSSP_DATAID_ACCZ       :
+            smartPortEncodePackage(frame, id, telemetryValue(TELEMETRY_VALUE_ACC_Z));
+            return true;
+            break;
+        case FSSP_DATAID_T1         :
+            // we send all the flags as decimal digits for easy reading
+
+            // the t1Cnt simply allows the telemetry view to show at least some changes
+            tmpi = t1Cnt * 10000; // start off with at least one digit so the most significant 0 won't be cut off
+            // the Taranis seems to be able to fit 5 digits on the screen
+            // the Taranis seems to consider this number a signed 16 bit integer
+
+            if (ARMING_FLAG(OK_TO_ARM))
+                tmpi += 1;
+            if (ARMING_FLAG(PREVENT_ARMING))
+                tmpi += 2;
+            if (ARMING_FLAG(ARMED))
+                tmpi += 4;
+
+            if (FLIGHT_MODE(ANGLE_MODE))
+                tmpi += 10;
+            if (FLIGHT_MODE(HORIZON_MODE))
+                tmpi += 20;
+            if (FLIGHT_MODE(UNUSED_MODE))
+                tmpi += 40;
+            if (FLIGHT_MODE(PASSTHRU_MODE))
+                tmpi += 40;
+
+            if (FLIGHT_MODE(MAG_MODE))
+                tmpi += 100;
+            if (FLIGHT_MODE(BARO_MODE))
+                tmpi += 200;
+            if (FLIGHT_MODE(SONAR_MODE))
+                tmpi += 400;
+
+            if (FLIGHT_MODE(GPS_HOLD_MODE))
+                tmpi += 1000;
+            if (FLIGHT_MODE(GPS_HOME_MODE))
+                tmpi += 2000;
+            if (FLIGHT_MODE(HEADFREE_MODE))
+                tmpi += 4000;
+
+            smartPortEncodePackage(frame, id, (uint32_t)tmpi);
+            return true;
+            break;
+        case FSSP_DATAID_T2         :
+            if (sensors(SENSOR_GPS)) {
+#ifdef GPS
+                // provide GPS lock status
+                smartPortEncodePackage(frame, id, (STATE(GPS_FIX) ? 1000 : 0) + (STATE(GPS_FIX_HOME) ? 2000 : 0) + GPS_numSat);
+                return true;
+#endif
+            } else if (feature(FEATURE_GPS)) {
+                smartPortEncodePackage(frame, id, 0);
+                return true;
+            } else if (telemetryConfig->pidValuesAsTelemetry){
+                switch (t2Cnt) {
+                    case 0:
+                        tmp2 = currentProfile->pidProfile.P8[ROLL];
+                        tmp2 += (currentProfile->pidProfile.P8[PITCH]<<8);
+                        tmp2 += (currentProfile->pidProfile.P8[YAW]<<16);
+                    break;
+                    case 1:
+                        tmp2 = currentProfile->pidProfile.I8[ROLL];
+                        tmp2 += (currentProfile->pidProfile.I8[PITCH]<<8);
+                        tmp2 += (currentProfile->pidProfile.I8[YAW]<<16);
+                    break;
+                    case 2:
+                        tmp2 = currentProfile->pidProfile.D8[ROLL];
+                        tmp2 += (currentProfile->pidProfile.D8[PITCH]<<8);
+                        tmp2 += (currentProfile->pidProfile.D8[YAW]<<16);
+                    break;
+                    case 3:
+                        tmp2 = currentControlRateProfile->rates[FD_ROLL];
+                        tmp2 += (currentControlRateProfile->rates[FD_PITCH]<<8);
+                        tmp2 += (currentControlRateProfile->rates[FD_YAW]<<16);
+                    break;
+                }
+                tmp2 += t2Cnt<<24;
+                smartPortEncodePackage(frame, id, tmp2);
+                return true;
+            }
+            break;
+#ifdef GPS
+        case FSSP_DATAID_GPS_ALT    :
+            if (sensors(SENSOR_GPS) && STATE(GPS_FIX)) {
+                smartPortEncodePackage(frame, id, GPS_altitude * 100); // given in 0.1m , requested in 10 = 1m (should be in mm, probably a bug in opentx, tested on 2.0.1.7)
+                return true;
+            }
+            break;
+#endif
+        case FSSP_DATAID_A4         :
+            if (feature(FEATURE_VBAT) && batteryCellCount > 0) {
+                smartPortEncodePackage(frame, id, vbat * 10 / batteryCellCount ); // given in 0.1V, convert to volts
+                return true;
+            }
+            break;
+        default:
+            break;
     }
-
-    // nothing left in txBuf,
-    // append the MSP checksum
-    *p++ = checksum;
-
-    // pad with zeros
-    while (p < end)
-        *p++ = 0;
-
-    smartPortSendPackageEx(FSSP_MSPS_FRAME,packet);
     return false;
 }
 
-void smartPortSendErrorReply(uint8_t error, int16_t cmd)
+// advances the rotating values once the frame carrying them has gone out
+static void smartPortTxFrameDone(smartPortTxFrame_t *frame, timeMs_t currentTimeMs)
 {
-    initSmartPortMspReply(cmd);
-    sbufWriteU8(&smartPortMspReply.buf,error);
-    smartPortMspReply.result = SMARTPORT_MSP_RES_ERROR;
-
-    sbufSwitchToReader(&smartPortMspReply.buf, smartPortMspTxBuffer);
-    smartPortMspReplyPending = true;
-}
+    smartPortSubscription_t *entry = frame->entry;
 
-/**
- * Request frame format:
- * - Header: 1 byte
- *   - Version: 3 bits
- *   - Start-flag: 1 bit
- *   - CSeq: 4 bits
- *
- * - MSP payload:
- *   - Size: 1 Byte
- *   - Type: 1 Byte
- *   - payload...
- *   - CRC
- */
-void handleSmartPortMspFrame(smartPortFrame_t* sp_frame)
-{
-    static uint8_t mspBuffer[SMARTPORT_MSP_RX_BUF_SIZE];
-    static uint8_t mspStarted = 0;
-    static uint8_t lastSeq = 0;
-    static uint8_t checksum = 0;
-    static mspPacket_t cmd;
-
-    // re-assemble MSP frame & forward to MSP port when complete
-    uint8_t* p = ((uint8_t*)sp_frame) + SMARTPORT_PAYLOAD_OFFSET;
-    uint8_t* end = p + SMARTPORT_PAYLOAD_SIZE;
-
-    uint8_t head = *p++;
-    uint8_t seq = head & SMARTPORT_MSP_SEQ_MASK;
-    uint8_t version = (head & SMARTPORT_MSP_VER_MASK) >> SMARTPORT_MSP_VER_SHIFT;
-
-    if (version != SMARTPORT_MSP_VERSION) {
-        mspStarted = 0;
-        smartPortSendErrorReply(SMARTPORT_MSP_VER_MISMATCH,0);
+    if (!entry) {
         return;
     }
 
-    // check start-flag
-    if (head & SMARTPORT_MSP_START_FLAG) {
-
-        //TODO: if (p_size > SMARTPORT_MSP_RX_BUF_SIZE) error!
-        uint8_t p_size = *p++;
-        cmd.cmd = *p++;
-        cmd.result = 0;
-
-        cmd.buf.ptr = mspBuffer;
-        cmd.buf.end = mspBuffer + p_size;
-
-        checksum = p_size ^ cmd.cmd;
-        mspStarted = 1;
-    } else if (!mspStarted) {
-        // no start packet yet, throw this one away
-        return;
-    } else if (((lastSeq + 1) & SMARTPORT_MSP_SEQ_MASK) != seq) {
-        // packet loss detected!
-        mspStarted = 0;
-        return;
-    }
+    telemetrySubscriptionSent(&entry->subscription, currentTimeMs);
 
-    // copy payload bytes
-    while ((p < end) && sbufBytesRemaining(&cmd.buf)) {
-        checksum ^= *p;
-        sbufWriteU8(&cmd.buf,*p++);
+    switch (entry->id) {
+        case FSSP_DATAID_LATLONG    :
+            smartPortLatLongOdd = !smartPortLatLongOdd;
+            break;
+        case FSSP_DATAID_T1         :
+            t1Cnt++;
+            if (t1Cnt >= 4) {
+                t1Cnt = 1;
+            }
+            break;
+        case FSSP_DATAID_T2         :
+            t2Cnt++;
+            if (t2Cnt == 4) {
+                t2Cnt = 0;
+            }
+            break;
+        default:
+            break;
     }
+}
 
-    // reached end of smart port frame
-    if (p == end) {
-        lastSeq = seq;
-        return;
+static bool smartPortEncodeNextFrame(smartPortTxFrame_t *frame, timeMs_t currentTimeMs)
+{
+    if (mspTelemetryReplyPending()) {
+        smartPortMspReplyStarted = false;
+        frame->entry = NULL;
+        smartPortEncodeMspReply(frame);
+        return true;
     }
 
-    // last byte must be the checksum
-    if (checksum != *p) {
-        mspStarted = 0;
-        smartPortSendErrorReply(SMARTPORT_MSP_CRC_ERROR,cmd.cmd);
-        return;
+    // nothing is due if every value is unchanged and within its maximum interval, so the slot is left empty
+    for (unsigned i = 0; i < ARRAYLEN(smartPortSubscriptions); i++) {
+        smartPortSubscription_t *entry = &smartPortSubscriptions[i];
+        if (telemetrySubscriptionDue(&entry->subscription, currentTimeMs) && smartPortEncodeValue(frame, entry->id)) {
+            frame->entry = entry;
+            return true;
+        }
     }
-
-    // end of MSP packet reached
-    mspStarted = 0;
-    sbufSwitchToReader(&cmd.buf,mspBuffer);
-
-    processMspPacket(&cmd);
+    return false;
 }
 
 void handleSmartPortTelemetry(void)
 {
-    uint32_t smartPortLastServiceTime = millis();
-
     if (!smartPortTelemetryEnabled) {
         return;
     }
@@ -573,252 +656,64 @@ void handleSmartPortTelemetry(void)
         return;
     }
 
-    while (serialRxBytesWaiting(smartPortSerialPort) > 0) {
-        uint8_t c = serialRead(smartPortSerialPort);
-        smartPortDataReceive(c);
+    smartPortTxFrame_t *frame;
+    smartPortTxFrame_t *sent;
+    uint8_t hasRequest;
+    uint32_t lastRequestTime;
+
+    // take the prepared frame back from the receive interrupt
+    ATOMIC_BLOCK(NVIC_PRIO_MAX) {
+        frame = smartPortTxFrame;
+        smartPortTxFrame = NULL;
+        sent = smartPortTxFrameSent;
+        smartPortTxFrameSent = NULL;
+        hasRequest = smartPortHasRequest;
+        smartPortHasRequest = 0;
+        lastRequestTime = smartPortLastRequestTime;
     }
 
-    uint32_t now = millis();
+    const uint32_t now = millis();
+
+    if (sent) {
+        smartPortTxFrameDone(sent, now);
+    }
 
     // if timed out, reconfigure the UART back to normal so the GUI or CLI works
-    if ((now - smartPortLastRequestTime) > SMARTPORT_NOT_CONNECTED_TIMEOUT_MS) {
+    if (cmp32(now, lastRequestTime) > SMARTPORT_NOT_CONNECTED_TIMEOUT_MS) {
         smartPortState = SPSTATE_TIMEDOUT;
         return;
     }
 
     if(smartPortFrameReceived) {
-        smartPortFrameReceived = false;
         // do not check the physical ID here again
         // unless we start receiving other sensors' packets
         if(smartPortRxBuffer.frameId == FSSP_MSPC_FRAME) {
 
             // Pass only the payload: skip sensorId & frameId
-            handleSmartPortMspFrame(&smartPortRxBuffer);
+            if (mspTelemetryHandleRequest((uint8_t *)&smartPortRxBuffer + SMARTPORT_PAYLOAD_OFFSET, SMARTPORT_PAYLOAD_SIZE)) {
+                smartPortMspReplyStarted = true;
+            }
         }
+        smartPortFrameReceived = false;
     }
 
-    while (smartPortHasRequest) {
-        // Ensure we won't get stuck in the loop if there happens to be nothing available to send in a timely manner - dump the slot if we loop in there for too long.
-        if ((millis() - smartPortLastServiceTime) > SMARTPORT_SERVICE_TIMEOUT_MS) {
-            smartPortHasRequest = 0;
-            return;
-        }
-
-        if(smartPortMspReplyPending) {
-            smartPortMspReplyPending = smartPortSendMspReply();
-            smartPortHasRequest = 0;
-            return;
-        }
-
-        // we can send back any data we want, our table keeps track of the order and frequency of each data type we send
-        uint16_t id = frSkyDataIdTable[smartPortIdCnt];
-        if (id == 0) { // end of table reached, loop back
-            smartPortIdCnt = 0;
-            id = frSkyDataIdTable[smartPortIdCnt];
-        }
-        smartPortIdCnt++;
+    // an MSP reply frame has consumed its part of the reply, so it is kept until sent, values are refreshed
+    if (!frame || frame->entry || smartPortMspReplyStarted) {
+        frame = smartPortEncodeNextFrame(&smartPortTxFrameBuffer, now) ? &smartPortTxFrameBuffer : NULL;
+    }
 
-        int32_t tmpi;
-        uint32_t tmp2 = 0;
-        static uint8_t t1Cnt = 0;
-        static uint8_t t2Cnt = 0;
+    if (!frame) {
+        return;
+    }
 
-        switch(id) {
-#ifdef GPS
-            case FSSP_DATAID_SPEED      :
-                if (sensors(SENSOR_GPS) && STATE(GPS_FIX)) {
-                    //convert to knots: 1cm/s = 0.0194384449 knots
-                    //Speed should be sent in knots/1000 (GPS speed is in cm/s)
-                    uint32_t tmpui = GPS_speed * 1944 / 100;
-                    smartPortSendPackage(id, tmpui);
-                    smartPortHasRequest = 0;
-                }
-                break;
-#endif
-            case FSSP_DATAID_VFAS       :
-                if (feature(FEATURE_VBAT) && batteryCellCount > 0) {
-                    uint16_t vfasVoltage;
-                    if (telemetryConfig->frsky_vfas_cell_voltage) {
-                        vfasVoltage = vbat / batteryCellCount;
-                    } else {
-                        vfasVoltage = vbat;
-                    }
-                    smartPortSendPackage(id, vfasVoltage * 10); // given in 0.1V, convert to volts
-                    smartPortHasRequest = 0;
-                }
-                break;
-            case FSSP_DATAID_CURRENT    :
-                if (feature(FEATURE_CURRENT_METER) || feature(FEATURE_ESC_SENSOR)) {
-                    smartPortSendPackage(id, amperage / 10); // given in 10mA steps, unknown requested unit
-                    smartPortHasRequest = 0;
-                }
-                break;
-            //case FSSP_DATAID_RPM        :
-            case FSSP_DATAID_ALTITUDE   :
-                if (sensors(SENSOR_BARO)) {
-                    smartPortSendPackage(id, baro.BaroAlt); // unknown given unit, requested 100 = 1 meter
-                    smartPortHasRequest = 0;
-                }
-                break;
-            case FSSP_DATAID_FUEL       :
-                if (feature(FEATURE_CURRENT_METER) || feature(FEATURE_ESC_SENSOR)) {
-                    smartPortSendPackage(id, mAhDrawn); // given in mAh, unknown requested unit
-                    smartPortHasRequest = 0;
-                }
-                break;
-            //case FSSP_DATAID_ADC1       :
-            //case FSSP_DATAID_ADC2       :
-#ifdef GPS
-            case FSSP_DATAID_LATLONG    :
-                if (sensors(SENSOR_GPS) && STATE(GPS_FIX)) {
-                    uint32_t tmpui = 0;
-                    // the same ID is sent twice, one for longitude, one for latitude
-                    // the MSB of the sent uint32_t helps FrSky keep track
-                    // the even/odd bit of our counter helps us keep track
-                    if (smartPortIdCnt & 1) {
-                        tmpui = abs(GPS_coord[LON]);  // now we have unsigned value and one bit to spare
-                        tmpui = (tmpui + tmpui / 2) / 25 | 0x80000000;  // 6/100 = 1.5/25, division by power of 2 is fast
-                        if (GPS_coord[LON] < 0) tmpui |= 0x40000000;
-                    }
-                    else {
-                        tmpui = abs(GPS_coord[LAT]);  // now we have unsigned value and one bit to spare
-                        tmpui = (tmpui + tmpui / 2) / 25;  // 6/100 = 1.5/25, division by power of 2 is fast
-                        if (GPS_coord[LAT] < 0) tmpui |= 0x40000000;
-                    }
-                    smartPortSendPackage(id, tmpui);
-                    smartPortHasRequest = 0;
-                }
-                break;
-#endif
-            //case FSSP_DATAID_CAP_USED   :
-            case FSSP_DATAID_VARIO      :
-                if (sensors(SENSOR_BARO)) {
-                    smartPortSendPackage(id, vario); // unknown given unit but requested in 100 = 1m/s
-                    smartPortHasRequest = 0;
-                }
-                break;
-            case FSSP_DATAID_HEADING    :
-                smartPortSendPackage(id, attitude.values.yaw * 10); // given in 10*deg, requested in 10000 = 100 deg
-                smartPortHasRequest = 0;
-                break;
-            case FSSP_DATAID_ACCX       :
-                smartPortSendPackage(id, 100 * acc.accSmooth[X] / acc.dev.acc_1G); // Multiply by 100 to show as x.xx g on Taranis
-                smartPortHasRequest = 0;
-                break;
-            case FSSP_DATAID_ACCY       :
-                smartPortSendPackage(id, 100 * acc.accSmooth[Y] / acc.dev.acc_1G);
-                smartPortHasRequest = 0;
-                break;
-            case FSSP_DATAID_ACCZ       :
-                smartPortSendPackage(id, 100 * acc.accSmooth[Z] / acc.dev.acc_1G);
-                smartPortHasRequest = 0;
-                break;
-            case FSSP_DATAID_T1         :
-                // we send all the flags as decimal digits for easy reading
-
-                // the t1Cnt simply allows the telemetry view to show at least some changes
-                t1Cnt++;
-                if (t1Cnt >= 4) {
-                    t1Cnt = 1;
-                }
-                tmpi = t1Cnt * 10000; // start off with at least one digit so the most significant 0 won't be cut off
-                // the Taranis seems to be able to fit 5 digits on the screen
-                // the Taranis seems to consider this number a signed 16 bit integer
-
-                if (ARMING_FLAG(OK_TO_ARM))
-                    tmpi += 1;
-                if (ARMING_FLAG(PREVENT_ARMING))
-                    tmpi += 2;
-                if (ARMING_FLAG(ARMED))
-                    tmpi += 4;
-
-                if (FLIGHT_MODE(ANGLE_MODE))
-                    tmpi += 10;
-                if (FLIGHT_MODE(HORIZON_MODE))
-                    tmpi += 20;
-                if (FLIGHT_MODE(UNUSED_MODE))
-                    tmpi += 40;
-                if (FLIGHT_MODE(PASSTHRU_MODE))
-                    tmpi += 40;
-
-                if (FLIGHT_MODE(MAG_MODE))
-                    tmpi += 100;
-                if (FLIGHT_MODE(BARO_MODE))
-                    tmpi += 200;
-                if (FLIGHT_MODE(SONAR_MODE))
-                    tmpi += 400;
-
-                if (FLIGHT_MODE(GPS_HOLD_MODE))
-                    tmpi += 1000;
-                if (FLIGHT_MODE(GPS_HOME_MODE))
-                    tmpi += 2000;
-                if (FLIGHT_MODE(HEADFREE_MODE))
-                    tmpi += 4000;
-
-                smartPortSendPackage(id, (uint32_t)tmpi);
-                smartPortHasRequest = 0;
-                break;
-            case FSSP_DATAID_T2         :
-                if (sensors(SENSOR_GPS)) {
-#ifdef GPS
-                    // provide GPS lock status
-                    smartPortSendPackage(id, (STATE(GPS_FIX) ? 1000 : 0) + (STATE(GPS_FIX_HOME) ? 2000 : 0) + GPS_numSat);
-                    smartPortHasRequest = 0;
-#endif
-                } else if (feature(FEATURE_GPS)) {
-                    smartPortSendPackage(id, 0);
-                    smartPortHasRequest = 0;
-                } else if (telemetryConfig->pidValuesAsTelemetry){
-                    switch (t2Cnt) {
-                        case 0:
-                            tmp2 = currentProfile->pidProfile.P8[ROLL];
-                            tmp2 += (currentProfile->pidProfile.P8[PITCH]<<8);
-                            tmp2 += (currentProfile->pidProfile.P8[YAW]<<16);
-                        break;
-                        case 1:
-                            tmp2 = currentProfile->pidProfile.I8[ROLL];
-                            tmp2 += (currentProfile->pidProfile.I8[PITCH]<<8);
-                            tmp2 += (currentProfile->pidProfile.I8[YAW]<<16);
-                        break;
-                        case 2:
-                            tmp2 = currentProfile->pidProfile.D8[ROLL];
-                            tmp2 += (currentProfile->pidProfile.D8[PITCH]<<8);
-                            tmp2 += (currentProfile->pidProfile.D8[YAW]<<16);
-                        break;
-                        case 3:
-                            tmp2 = currentControlRateProfile->rates[FD_ROLL];
-                            tmp2 += (currentControlRateProfile->rates[FD_PITCH]<<8);
-                            tmp2 += (currentControlRateProfile->rates[FD_YAW]<<16);
-                        break;
-                    }
-                    tmp2 += t2Cnt<<24;
-                    t2Cnt++;
-                    if (t2Cnt == 4) {
-                        t2Cnt = 0;
-                    }
-                    smartPortSendPackage(id, tmp2);
-                    smartPortHasRequest = 0;
-                }
-                break;
-#ifdef GPS
-            case FSSP_DATAID_GPS_ALT    :
-                if (sensors(SENSOR_GPS) && STATE(GPS_FIX)) {
-                    smartPortSendPackage(id, GPS_altitude * 100); // given in 0.1m , requested in 10 = 1m (should be in mm, probably a bug in opentx, tested on 2.0.1.7)
-                    smartPortHasRequest = 0;
-                }
-                break;
-#endif
-            case FSSP_DATAID_A4         :
-                if (feature(FEATURE_VBAT) && batteryCellCount > 0) {
-                    smartPortSendPackage(id, vbat * 10 / batteryCellCount ); // given in 0.1V, convert to volts
-                    smartPortHasRequest = 0;
-                }
-                break;
-            default:
-                break;
-                // if nothing is sent, smartPortHasRequest isn't cleared, we already incremented the counter, just loop back to the start
-        }
+    // the interrupt found nothing prepared, reply late if the slot is still ours
+    if (hasRequest && cmp32(now, lastRequestTime) <= SMARTPORT_LATE_REPLY_MS) {
+        smartPortSendTxFrame(frame);
+        smartPortTxFrameDone(frame, now);
+        return;
     }
+
+    smartPortTxFrame = frame;
 }
 
 #endif
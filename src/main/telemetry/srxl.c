@@ -26,6 +26,7 @@
 #include "config/feature.h"
 #include "build/version.h"
 
+#include "common/maths.h"
 #include "common/streambuf.h"
 #include "common/utils.h"
 
@@ -61,26 +62,10 @@
 #define SRXL_FRAMETYPE_SID          0x00
 
 static bool srxlTelemetryEnabled;
-static uint16_t srxlCrc;
 static uint8_t srxlFrame[SRXL_FRAME_SIZE_MAX];
 
-#define SRXL_POLY 0x1021
-static uint16_t srxlCrc16(uint16_t crc, uint8_t data)
-{
-    crc = crc ^ data << 8;
-    for (int i = 0; i < 8; i++) {
-        if (crc & 0x8000) {
-            crc = crc << 1 ^ SRXL_POLY;
-        } else {
-            crc = crc << 1;
-        }
-    }
-    return crc;
-}
-
 static void srxlInitializeFrame(sbuf_t *dst)
 {
-    srxlCrc = 0;
     dst->ptr = srxlFrame;
     dst->end = ARRAYEND(srxlFrame);
 
@@ -92,7 +77,6 @@ static void srxlInitializeFrame(sbuf_t *dst)
 static void srxlSerialize8(sbuf_t *dst, uint8_t v)
 {
     sbufWriteU8(dst, v);
-    srxlCrc = srxlCrc16(srxlCrc, v);
 }
 
 static void srxlSerialize16(sbuf_t *dst, uint16_t v)
@@ -104,7 +88,9 @@ static void srxlSerialize16(sbuf_t *dst, uint16_t v)
 
 static void srxlFinalize(sbuf_t *dst)
 {
-    sbufWriteU16(dst, srxlCrc);
+    // SRXL uses CRC-16/CCITT with a zero seed over the packet, not the three header bytes
+    const uint8_t *packet = srxlFrame + 3;
+    sbufWriteU16(dst, crc16_ccitt_buf(0, packet, sbufPtr(dst) - packet));
     sbufSwitchToReader(dst, srxlFrame);
     // write the telemetry frame to the receiver.
     srxlRxWriteTelemetryData(sbufPtr(dst), sbufBytesRemaining(dst));
@@ -40,6 +40,7 @@
 #include "rx/rx.h"
 
 #include "telemetry/telemetry.h"
+#include "telemetry/telemetry_values.h"
 #include "telemetry/frsky.h"
 #include "telemetry/hott.h"
 #include "telemetry/smartport.h"
@@ -137,6 +138,8 @@ void telemetryCheckState(void)
 
 void telemetryProcess(uint32_t currentTime, rxConfig_t *rxConfig, uint16_t deadband3d_throttle)
 {
+    telemetryValuesUpdate();
+
 #ifdef TELEMETRY_FRSKY
     handleFrSkyTelemetry(rxConfig, deadband3d_throttle);
 #else
@@ -0,0 +1,113 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "platform.h"
+
+#ifdef TELEMETRY
+
+#include "common/streambuf.h"
+
+#include "drivers/serial.h"
+
+#include "telemetry/telemetry_frame.h"
+
+void telemetryFrameInit(telemetryFrame_t *frame, uint8_t *buffer, int size)
+{
+    frame->base = buffer;
+    frame->sbuf.ptr = buffer;
+    frame->sbuf.end = buffer + size;
+    frame->ringPort = NULL;
+    frame->checksum = 0;
+}
+
+/*
+ * Builds what follows straight in the port's TX ring, saving the copy out of the buffer, if nothing is pending in the
+ * buffer and the ring has room for len bytes. Otherwise the frame carries on in the buffer.
+ */
+void telemetryFrameBeginOnPort(telemetryFrame_t *frame, serialPort_t *port, int len)
+{
+    if (frame->ringPort || frame->sbuf.ptr != frame->base) {
+        return;
+    }
+    if (serialTxView(port, &frame->ring) && sbufRingBytesRemaining(&frame->ring) >= len) {
+        frame->ringPort = port;
+    }
+}
+
+void telemetryFrameResetChecksum(telemetryFrame_t *frame)
+{
+    frame->checksum = 0;
+}
+
+void telemetryFrameWriteRaw(telemetryFrame_t *frame, uint8_t val)
+{
+    if (frame->ringPort) {
+        sbufRingWriteU8(&frame->ring, val);
+    } else {
+        sbufWriteU8(&frame->sbuf, val);
+    }
+}
+
+void telemetryFrameWriteU8(telemetryFrame_t *frame, uint8_t val)
+{
+    telemetryFrameWriteRaw(frame, val);
+    frame->checksum ^= val;
+}
+
+void telemetryFrameWriteU16(telemetryFrame_t *frame, uint16_t val)
+{
+    telemetryFrameWriteU8(frame, val >> 0);
+    telemetryFrameWriteU8(frame, val >> 8);
+}
+
+void telemetryFrameWriteU32(telemetryFrame_t *frame, uint32_t val)
+{
+    telemetryFrameWriteU8(frame, val >> 0);
+    telemetryFrameWriteU8(frame, val >> 8);
+    telemetryFrameWriteU8(frame, val >> 16);
+    telemetryFrameWriteU8(frame, val >> 24);
+}
+
+int telemetryFrameBytesFree(telemetryFrame_t *frame)
+{
+    if (frame->ringPort) {
+        return sbufRingBytesRemaining(&frame->ring);
+    }
+    return sbufBytesRemaining(&frame->sbuf);
+}
+
+// writes everything built so far and rewinds the buffer
+void telemetryFrameFlush(telemetryFrame_t *frame, serialPort_t *port)
+{
+    if (frame->ringPort) {
+        serialTxCommit(frame->ringPort, sbufRingBytesUsed(&frame->ring));
+        frame->ringPort = NULL;
+        return;
+    }
+
+    const int len = frame->sbuf.ptr - frame->base;
+    if (len > 0) {
+        serialWriteBuf(port, frame->base, len);
+    }
+    frame->sbuf.ptr = frame->base;
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/streambuf.h"
+
+struct serialPort_s;
+
+/*
+ * Builds telemetry frames in a RAM buffer with a running xor checksum, so a frame reaches the serial port in a
+ * single serialWriteBuf() call instead of one driver call per byte. Where the port's TX ring has room the frame is
+ * built straight in the ring instead, see telemetryFrameBeginOnPort().
+ */
+typedef struct telemetryFrame_s {
+    sbuf_t sbuf;
+    uint8_t *base;
+    sbufRing_t ring;
+    struct serialPort_s *ringPort;  // set while the frame is built in this port's TX ring
+    uint8_t checksum;
+} telemetryFrame_t;
+
+void telemetryFrameInit(telemetryFrame_t *frame, uint8_t *buffer, int size);
+void telemetryFrameBeginOnPort(telemetryFrame_t *frame, struct serialPort_s *port, int len);
+void telemetryFrameResetChecksum(telemetryFrame_t *frame);
+
+// headers, stuffing and checksums themselves are written raw, outside the checksum
+void telemetryFrameWriteRaw(telemetryFrame_t *frame, uint8_t val);
+void telemetryFrameWriteU8(telemetryFrame_t *frame, uint8_t val);
+void telemetryFrameWriteU16(telemetryFrame_t *frame, uint16_t val);
+void telemetryFrameWriteU32(telemetryFrame_t *frame, uint32_t val);
+
+int telemetryFrameBytesFree(telemetryFrame_t *frame);
+void telemetryFrameFlush(telemetryFrame_t *frame, struct serialPort_s *port);
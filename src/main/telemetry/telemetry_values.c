@@ -0,0 +1,102 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "platform.h"
+
+#ifdef TELEMETRY
+
+#include "common/axis.h"
+#include "common/maths.h"
+#include "common/time.h"
+
+#include "drivers/sensor.h"
+#include "drivers/accgyro.h"
+
+#include "fc/runtime_config.h"
+
+#include "flight/altitudehold.h"
+#include "flight/imu.h"
+
+#include "rx/rx.h"
+
+#include "sensors/acceleration.h"
+#include "sensors/barometer.h"
+#include "sensors/battery.h"
+
+#include "telemetry/telemetry_values.h"
+
+static int32_t telemetryValues[TELEMETRY_VALUE_COUNT];
+
+void telemetryValuesUpdate(void)
+{
+    telemetryValues[TELEMETRY_VALUE_VBAT] = vbat;
+    telemetryValues[TELEMETRY_VALUE_AMPERAGE] = amperage;
+    telemetryValues[TELEMETRY_VALUE_MAH_DRAWN] = mAhDrawn;
+    telemetryValues[TELEMETRY_VALUE_RSSI] = rssi;
+    telemetryValues[TELEMETRY_VALUE_BARO_ALT] = baro.BaroAlt;
+    telemetryValues[TELEMETRY_VALUE_VARIO] = vario;
+    telemetryValues[TELEMETRY_VALUE_HEADING] = attitude.values.yaw;
+    telemetryValues[TELEMETRY_VALUE_ROLL] = attitude.values.roll;
+    telemetryValues[TELEMETRY_VALUE_PITCH] = attitude.values.pitch;
+    telemetryValues[TELEMETRY_VALUE_FLIGHT_MODE] = (flightModeFlags << 1) | (ARMING_FLAG(ARMED) ? 1 : 0);
+    if (acc.dev.acc_1G) {
+        telemetryValues[TELEMETRY_VALUE_ACC_X] = 100 * acc.accSmooth[X] / acc.dev.acc_1G;
+        telemetryValues[TELEMETRY_VALUE_ACC_Y] = 100 * acc.accSmooth[Y] / acc.dev.acc_1G;
+        telemetryValues[TELEMETRY_VALUE_ACC_Z] = 100 * acc.accSmooth[Z] / acc.dev.acc_1G;
+    }
+}
+
+int32_t telemetryValue(telemetryValueId_e id)
+{
+    if (id <= TELEMETRY_VALUE_NONE || id >= TELEMETRY_VALUE_COUNT) {
+        return 0;
+    }
+    return telemetryValues[id];
+}
+
+bool telemetrySubscriptionDue(const telemetrySubscription_t *subscription, timeMs_t currentTimeMs)
+{
+    if (!subscription->sent) {
+        return true;
+    }
+
+    const timeMs_t sinceSentMs = currentTimeMs - subscription->lastSentMs;
+    if (sinceSentMs >= subscription->maxIntervalMs) {
+        return true;
+    }
+    if (sinceSentMs < subscription->minIntervalMs) {
+        return false;
+    }
+    if (subscription->value == TELEMETRY_VALUE_NONE) {
+        return true;
+    }
+
+    return ABS(telemetryValue(subscription->value) - subscription->lastSentValue) >= subscription->threshold;
+}
+
+void telemetrySubscriptionSent(telemetrySubscription_t *subscription, timeMs_t currentTimeMs)
+{
+    subscription->lastSentValue = telemetryValue(subscription->value);
+    subscription->lastSentMs = currentTimeMs;
+    subscription->sent = true;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/time.h"
+
+/*
+ * Values shared by the telemetry backends, refreshed once per telemetry pass. A backend subscribes to the
+ * values it sends with a rate window and a change threshold, and only sends a value when it is due.
+ */
+typedef enum {
+    TELEMETRY_VALUE_NONE = -1,      // composite frames (flags, GPS), due at the minimum interval
+    TELEMETRY_VALUE_VBAT = 0,       // 0.1V
+    TELEMETRY_VALUE_AMPERAGE,       // 0.01A
+    TELEMETRY_VALUE_MAH_DRAWN,
+    TELEMETRY_VALUE_RSSI,           // 0-1023
+    TELEMETRY_VALUE_BARO_ALT,       // cm
+    TELEMETRY_VALUE_VARIO,          // cm/s
+    TELEMETRY_VALUE_HEADING,        // 0.1 degree
+    TELEMETRY_VALUE_ROLL,           // 0.1 degree
+    TELEMETRY_VALUE_PITCH,          // 0.1 degree
+    TELEMETRY_VALUE_FLIGHT_MODE,    // flight mode and armed flags, any change is at least 1
+    TELEMETRY_VALUE_ACC_X,          // 0.01G
+    TELEMETRY_VALUE_ACC_Y,
+    TELEMETRY_VALUE_ACC_Z,
+    TELEMETRY_VALUE_COUNT
+} telemetryValueId_e;
+
+typedef struct telemetrySubscription_s {
+    telemetryValueId_e value;
+    uint16_t minIntervalMs;     // never sent more often than this
+    uint16_t maxIntervalMs;     // always sent at least this often, so receivers don't flag the sensor as lost
+    int32_t threshold;          // change since the last send that makes the value due
+    int32_t lastSentValue;
+    timeMs_t lastSentMs;
+    bool sent;
+} telemetrySubscription_t;
+
+void telemetryValuesUpdate(void);
+int32_t telemetryValue(telemetryValueId_e id);
+
+bool telemetrySubscriptionDue(const telemetrySubscription_t *subscription, timeMs_t currentTimeMs);
+void telemetrySubscriptionSent(telemetrySubscription_t *subscription, timeMs_t currentTimeMs);
@@ -120,17 +120,6 @@ void DebugMon_Handler(void)
 {
 }
 
-/*******************************************************************************
- * Function Name  : PendSV_Handler
- * Description    : This function handles PendSVC exception.
- * Input          : None
- * Output         : None
- * Return         : None
- *******************************************************************************/
-void PendSV_Handler(void)
-{
-}
-
 
 /*******************************************************************************
  * Function Name  : USB_IRQHandler
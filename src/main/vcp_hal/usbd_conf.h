@@ -65,6 +65,7 @@
 #define USBD_SELF_POWERED                     1
 #define USBD_DEBUG_LEVEL                      0
 #define USE_USB_FS
+#define MSC_MEDIA_PACKET                      512
 
 /* Exported macro ------------------------------------------------------------*/
 /* Memory management macros */
@@ -64,6 +64,8 @@
 #define USBD_INTERFACE_HS_STRING      "VCP Interface"
 #define USBD_CONFIGURATION_FS_STRING  "VCP Config"
 #define USBD_INTERFACE_FS_STRING      "VCP Interface"
+#define USBD_MSC_PID                  0x5720
+#define USBD_MSC_PRODUCT_STRING       "STM32 Mass Storage"
 
 /* Private macro -------------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
@@ -74,6 +76,8 @@ uint8_t *USBD_VCP_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length
 uint8_t *USBD_VCP_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 uint8_t *USBD_VCP_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 uint8_t *USBD_VCP_InterfaceStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+uint8_t *USBD_MSC_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
+uint8_t *USBD_MSC_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length);
 #ifdef USB_SUPPORT_USER_STRING_DESC
 uint8_t *USBD_VCP_USRStringDesc (USBD_SpeedTypeDef speed, uint8_t idx, uint16_t *length);
 #endif /* USB_SUPPORT_USER_STRING_DESC */
@@ -89,6 +93,17 @@ USBD_DescriptorsTypeDef VCP_Desc = {
   USBD_VCP_InterfaceStrDescriptor,
 };
 
+/* Mass storage boot mode, the same device under the ST mass storage product ID */
+USBD_DescriptorsTypeDef MSC_Desc = {
+  USBD_MSC_DeviceDescriptor,
+  USBD_VCP_LangIDStrDescriptor,
+  USBD_VCP_ManufacturerStrDescriptor,
+  USBD_MSC_ProductStrDescriptor,
+  USBD_VCP_SerialStrDescriptor,
+  USBD_VCP_ConfigStrDescriptor,
+  USBD_VCP_InterfaceStrDescriptor,
+};
+
 /* USB Standard Device Descriptor */
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
   #pragma data_alignment=4
@@ -153,6 +168,37 @@ uint8_t *USBD_VCP_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
   return (uint8_t*)USBD_DeviceDesc;
 }
 
+/**
+  * @brief  Returns the device descriptor for mass storage mode.
+  * @param  speed: Current device speed
+  * @param  length: Pointer to data length variable
+  * @retval Pointer to descriptor buffer
+  */
+uint8_t *USBD_MSC_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+  static uint8_t mscDeviceDesc[USB_LEN_DEV_DESC];
+
+  (void)speed;
+  memcpy(mscDeviceDesc, USBD_DeviceDesc, sizeof(mscDeviceDesc));
+  mscDeviceDesc[10] = LOBYTE(USBD_MSC_PID);
+  mscDeviceDesc[11] = HIBYTE(USBD_MSC_PID);
+  *length = sizeof(mscDeviceDesc);
+  return mscDeviceDesc;
+}
+
+/**
+  * @brief  Returns the product string descriptor for mass storage mode.
+  * @param  speed: Current device speed
+  * @param  length: Pointer to data length variable
+  * @retval Pointer to descriptor buffer
+  */
+uint8_t *USBD_MSC_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+  (void)speed;
+  USBD_GetString((uint8_t *)USBD_MSC_PRODUCT_STRING, USBD_StrDesc, length);
+  return USBD_StrDesc;
+}
+
 /**
   * @brief  Returns the LangID string descriptor.
   * @param  speed: Current device speed
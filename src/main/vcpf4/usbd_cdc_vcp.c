@@ -24,6 +24,8 @@
 #endif /* USB_OTG_HS_INTERNAL_DMA_ENABLED */
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
 #include "usbd_cdc_vcp.h"
 #include "stm32f4xx_conf.h"
 #include "stdbool.h"
@@ -31,7 +33,6 @@
 
 LINE_CODING g_lc;
 
-extern __IO uint8_t USB_Tx_State;
 __IO uint32_t bDeviceState = UNCONNECTED; /* USB device status */
 
 /* These are external variables imported from CDC core to be used for IN transfer management. */
@@ -184,19 +185,25 @@ uint32_t CDC_Send_FreeBytes(void)
 static uint16_t VCP_DataTx(const uint8_t* Buf, uint32_t Len)
 {
     /*
-        make sure that any paragraph end frame is not in play
-        could just check for: USB_CDC_ZLP, but better to be safe
-        and wait for any existing transmission to complete.
+        The CDC core only ever reads up to APP_Rx_ptr_in, so data can be appended while a transfer (or its ZLP) is
+        still going out. Copy in as much as fits at a time, and only wait when the buffer is full.
     */
-    while (USB_Tx_State != 0);
-
-    for (uint32_t i = 0; i < Len; i++) {
-        APP_Rx_Buffer[APP_Rx_ptr_in] = Buf[i];
-        APP_Rx_ptr_in = (APP_Rx_ptr_in + 1) % APP_RX_DATA_SIZE;
+    while (Len > 0) {
+        uint32_t free;
 
-        while (CDC_Send_FreeBytes() == 0) {
+        while ((free = CDC_Send_FreeBytes()) == 0) {
             delay(1);
         }
+
+        const uint32_t len = Len < free ? Len : free;
+        const uint32_t firstChunk = len < APP_RX_DATA_SIZE - APP_Rx_ptr_in ? len : APP_RX_DATA_SIZE - APP_Rx_ptr_in;
+
+        memcpy(&APP_Rx_Buffer[APP_Rx_ptr_in], Buf, firstChunk);
+        memcpy(APP_Rx_Buffer, Buf + firstChunk, len - firstChunk);
+        APP_Rx_ptr_in = (APP_Rx_ptr_in + len) % APP_RX_DATA_SIZE;
+
+        Buf += len;
+        Len -= len;
     }
 
     return USBD_OK;
@@ -0,0 +1,785 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replays the raw gyro of a decoded blackbox log through the gyro filter chain and the PID controller,
+ * so filter settings can be compared offline for noise against latency.
+ *
+ * Usage: filter_replay [-r <field>] [-o <signals.csv>] [-s <spectrum.csv>] [-n <Hz>] <log.csv> [<setting>=<value> ...]
+ *
+ * The log is the CSV written by blackbox_decode. The raw gyro is read from <field>[0..2], debug by default,
+ * which holds the unfiltered gyro when the log was recorded with debug_mode = GYRO. The setpoint follows
+ * rcCommand[0..2] through the rate curve, and the filters run at the logged sample rate. Settings take the
+ * CLI names, defaults are those of fc/config.c.
+ *
+ * The summary gives per axis the noise above the -n frequency (100Hz by default) before and after the
+ * gyro filters and on the D term, and the delay of the filtered gyro below that frequency as measured on
+ * the log. It also gives the DC group delay of the filter chain from its step response, and the host ns
+ * and cycles that gyroUpdate() and pidController() take per sample. The signals and spectrum files use
+ * blackbox field names.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define REPLAY_HAS_CYCLE_COUNTER
+#endif
+
+#include "platform.h"
+
+#include "build/debug.h"
+
+#include "common/axis.h"
+#include "common/filter.h"
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/accgyro.h"
+#include "drivers/accgyro_fake.h"
+
+#include "fc/rc_controls.h"
+#include "fc/rc_curves.h"
+#include "fc/runtime_config.h"
+
+#include "flight/imu.h"
+#include "flight/navigation.h"
+#include "flight/pid.h"
+
+#include "io/beeper.h"
+
+#include "rx/rx.h"
+
+#include "sensors/acceleration.h"
+#include "sensors/gyro.h"
+#include "sensors/sensors.h"
+
+#define REPLAY_FFT_SIZE                 1024
+#define REPLAY_BIN_COUNT                (REPLAY_FFT_SIZE / 2 + 1)
+#define REPLAY_NOISE_MIN_HZ             100
+#define REPLAY_STEP_DEG_S               100
+#define REPLAY_STEP_RESPONSE_US         100000
+#define REPLAY_MAX_COLUMNS              256
+#define REPLAY_LINE_LENGTH              4096
+
+typedef enum {
+    SIGNAL_GYRO_RAW = 0,
+    SIGNAL_GYRO_FILTERED,
+    SIGNAL_DTERM,
+    SIGNAL_PID_SUM,
+    SIGNAL_COUNT
+} replaySignal_e;
+
+static const char * const signalNames[SIGNAL_COUNT] = {
+    [SIGNAL_GYRO_RAW] = "gyroRaw",
+    [SIGNAL_GYRO_FILTERED] = "gyroFiltered",
+    [SIGNAL_DTERM] = "axisD",
+    [SIGNAL_PID_SUM] = "axisPID",
+};
+
+typedef struct replayLog_s {
+    int length;
+    uint32_t looptimeUs;
+    uint32_t *timeUs;
+    int16_t (*gyro)[XYZ_AXIS_COUNT];
+    int16_t (*rc)[4];
+    bool hasRc;
+    float *signal[SIGNAL_COUNT][XYZ_AXIS_COUNT];
+} replayLog_t;
+
+typedef struct replayStats_s {
+    const char *name;
+    uint64_t ns;
+    uint64_t cycles;
+} replayStats_t;
+
+typedef enum {
+    VALUE_UINT8 = 0,
+    VALUE_UINT16,
+    VALUE_LOWPASS_TYPE
+} replayValueType_e;
+
+typedef struct replaySetting_s {
+    const char *name;
+    replayValueType_e type;
+    void *ptr;
+} replaySetting_t;
+
+static const char * const lowpassTypeNames[] = { "PT1", "BIQUAD", "FIR" };
+
+static replayLog_t replayLog;
+static replayStats_t gyroUpdateStats = { .name = "gyroUpdate" };
+static replayStats_t pidControllerStats = { .name = "pidController" };
+
+static timeUs_t simulatedTimeUs;
+static float setpointRate[3];
+static float setpointRateDerivative[3];
+
+static gyroConfig_t gyroConfigReplay = {
+    .gyro_sync_denom = 1,
+    .gyro_lpf = GYRO_LPF_256HZ,
+    .gyro_soft_lpf_type = FILTER_PT1,
+    .gyro_soft_lpf_hz = 90,
+    .gyro_soft_notch_hz_1 = 400,
+    .gyro_soft_notch_cutoff_1 = 300,
+    .gyro_soft_notch_hz_2 = 200,
+    .gyro_soft_notch_cutoff_2 = 100,
+};
+static controlRateConfig_t controlRateConfig = {
+    .rcRate8 = 100,
+    .rcYawRate8 = 100,
+    .thrMid8 = 50,
+    .dynThrPID = 10,
+    .tpa_breakpoint = 1650,
+    .rates = { 70, 70, 70 },
+};
+static pidProfile_t pidProfile;
+static rollAndPitchTrims_t accelerometerTrims;
+
+static const replaySetting_t replaySettings[] = {
+    { "gyro_lowpass_type",      VALUE_LOWPASS_TYPE, &gyroConfigReplay.gyro_soft_lpf_type },
+    { "gyro_lowpass",           VALUE_UINT8,        &gyroConfigReplay.gyro_soft_lpf_hz },
+    { "gyro_notch1_hz",         VALUE_UINT16,       &gyroConfigReplay.gyro_soft_notch_hz_1 },
+    { "gyro_notch1_cutoff",     VALUE_UINT16,       &gyroConfigReplay.gyro_soft_notch_cutoff_1 },
+    { "gyro_notch2_hz",         VALUE_UINT16,       &gyroConfigReplay.gyro_soft_notch_hz_2 },
+    { "gyro_notch2_cutoff",     VALUE_UINT16,       &gyroConfigReplay.gyro_soft_notch_cutoff_2 },
+    { "gyro_notch_dynamic",     VALUE_UINT8,        &gyroConfigReplay.gyro_soft_notch_dynamic },
+    { "dterm_lowpass_type",     VALUE_LOWPASS_TYPE, &pidProfile.dterm_filter_type },
+    { "dterm_lowpass",          VALUE_UINT16,       &pidProfile.dterm_lpf_hz },
+    { "dterm_lowpass_max",      VALUE_UINT16,       &pidProfile.dterm_lpf_max_hz },
+    { "dterm_notch_hz",         VALUE_UINT16,       &pidProfile.dterm_notch_hz },
+    { "dterm_notch_cutoff",     VALUE_UINT16,       &pidProfile.dterm_notch_cutoff },
+    { "dterm_setpoint_weight",  VALUE_UINT8,        &pidProfile.dtermSetpointWeight },
+    { "yaw_lowpass",            VALUE_UINT16,       &pidProfile.yaw_lpf_hz },
+    { "p_roll",                 VALUE_UINT8,        &pidProfile.P8[ROLL] },
+    { "i_roll",                 VALUE_UINT8,        &pidProfile.I8[ROLL] },
+    { "d_roll",                 VALUE_UINT8,        &pidProfile.D8[ROLL] },
+    { "p_pitch",                VALUE_UINT8,        &pidProfile.P8[PITCH] },
+    { "i_pitch",                VALUE_UINT8,        &pidProfile.I8[PITCH] },
+    { "d_pitch",                VALUE_UINT8,        &pidProfile.D8[PITCH] },
+    { "p_yaw",                  VALUE_UINT8,        &pidProfile.P8[YAW] },
+    { "i_yaw",                  VALUE_UINT8,        &pidProfile.I8[YAW] },
+    { "d_yaw",                  VALUE_UINT8,        &pidProfile.D8[YAW] },
+    { "rc_rate",                VALUE_UINT8,        &controlRateConfig.rcRate8 },
+    { "rc_rate_yaw",            VALUE_UINT8,        &controlRateConfig.rcYawRate8 },
+    { "rc_expo",                VALUE_UINT8,        &controlRateConfig.rcExpo8 },
+    { "rc_yaw_expo",            VALUE_UINT8,        &controlRateConfig.rcYawExpo8 },
+    { "roll_srate",             VALUE_UINT8,        &controlRateConfig.rates[FD_ROLL] },
+    { "pitch_srate",            VALUE_UINT8,        &controlRateConfig.rates[FD_PITCH] },
+    { "yaw_srate",              VALUE_UINT8,        &controlRateConfig.rates[FD_YAW] },
+};
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t nowCycles(void)
+{
+#ifdef REPLAY_HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#define REPLAY_CALL(stats, call) do { \
+        const uint64_t startNs = nowNs(); \
+        const uint64_t startCycles = nowCycles(); \
+        call; \
+        (stats)->cycles += nowCycles() - startCycles; \
+        (stats)->ns += nowNs() - startNs; \
+    } while (0)
+
+// Flight loop stubs
+
+int16_t debug[DEBUG16_VALUE_COUNT];
+uint8_t debugMode;
+uint8_t armingFlags;
+uint16_t flightModeFlags;
+int16_t rcCommand[4];
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+attitudeEulerAngles_t attitude;
+uint8_t detectedSensors[SENSOR_INDEX_COUNT];
+uint32_t rcModeActivationMask;
+int16_t GPS_angle[ANGLE_INDEX_COUNT];
+
+uint32_t micros(void) { return simulatedTimeUs; }
+void delay(uint32_t ms) { UNUSED(ms); }
+void delayMicroseconds(uint32_t us) { UNUSED(us); }
+
+void sensorsSet(uint32_t mask) { UNUSED(mask); }
+bool feature(uint32_t mask) { UNUSED(mask); return false; }
+void beeper(beeperMode_e mode) { UNUSED(mode); }
+bool isAirmodeActive(void) { return true; }
+float calculateVbatPidCompensation(void) { return 1.0f; }
+float getThrottlePIDAttenuation(void) { return 1.0f; }
+float getSetpointRate(int axis) { return setpointRate[axis]; }
+float getSetpointRateDerivative(int axis) { return setpointRateDerivative[axis]; }
+float getRcDeflection(int axis) { return rcCommand[axis] / 500.0f; }
+float getRcDeflectionAbs(int axis) { return ABS(rcCommand[axis]) / 500.0f; }
+
+// Settings
+
+static bool applySetting(const char *assignment)
+{
+    const char *equals = strchr(assignment, '=');
+    if (!equals) {
+        return false;
+    }
+    const size_t nameLength = equals - assignment;
+    const char *value = equals + 1;
+
+    for (unsigned i = 0; i < ARRAYLEN(replaySettings); i++) {
+        const replaySetting_t *setting = &replaySettings[i];
+        if (strlen(setting->name) != nameLength || strncasecmp(setting->name, assignment, nameLength)) {
+            continue;
+        }
+        switch (setting->type) {
+        case VALUE_UINT8:
+            *(uint8_t *)setting->ptr = atoi(value);
+            return true;
+        case VALUE_UINT16:
+            *(uint16_t *)setting->ptr = atoi(value);
+            return true;
+        case VALUE_LOWPASS_TYPE:
+            for (unsigned type = 0; type < ARRAYLEN(lowpassTypeNames); type++) {
+                if (!strcasecmp(lowpassTypeNames[type], value)) {
+                    *(uint8_t *)setting->ptr = type;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+static void resetPidProfile(void)
+{
+    const uint8_t p[3] = { 43, 58, 70 }, i[3] = { 40, 50, 45 }, d[3] = { 20, 22, 20 };
+    for (int axis = 0; axis < 3; axis++) {
+        pidProfile.P8[axis] = p[axis];
+        pidProfile.I8[axis] = i[axis];
+        pidProfile.D8[axis] = d[axis];
+    }
+    pidProfile.yaw_p_limit = YAW_P_LIMIT_MAX;
+    pidProfile.pidSumLimit = PIDSUM_LIMIT;
+    pidProfile.rollPitchItermIgnoreRate = 200;
+    pidProfile.yawItermIgnoreRate = 55;
+    pidProfile.itermRelaxCutoff = 15;
+    pidProfile.dterm_filter_type = FILTER_BIQUAD;
+    pidProfile.dterm_lpf_hz = 100;
+    pidProfile.dterm_notch_hz = 260;
+    pidProfile.dterm_notch_cutoff = 160;
+    pidProfile.pidAtMinThrottle = PID_STABILISATION_ON;
+    pidProfile.levelAngleLimit = 70.0f;
+    pidProfile.setpointRelaxRatio = 30;
+    pidProfile.dtermSetpointWeight = 200;
+    pidProfile.feedForwardLpfHz = 40;
+    pidProfile.yawRateAccelLimit = 20.0f;
+    pidProfile.itermThrottleThreshold = 350;
+    pidProfile.levelSensitivity = 100.0f;
+}
+
+// Log
+
+static int splitColumns(char *line, char *columns[])
+{
+    int count = 0;
+    char *column = line;
+    while (count < REPLAY_MAX_COLUMNS) {
+        while (*column == ' ' || *column == '"') {
+            column++;
+        }
+        columns[count++] = column;
+        char *end = strchr(column, ',');
+        char *last = end ? end : column + strlen(column);
+        while (last > column && (last[-1] == ' ' || last[-1] == '"' || last[-1] == '\n' || last[-1] == '\r')) {
+            last--;
+        }
+        *last = '\0';
+        if (!end) {
+            break;
+        }
+        column = end + 1;
+    }
+    return count;
+}
+
+static int findColumn(char *columns[], int count, const char *name)
+{
+    for (int i = 0; i < count; i++) {
+        if (!strcmp(columns[i], name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool findArrayColumns(char *columns[], int count, const char *name, int elements, int indexes[])
+{
+    for (int i = 0; i < elements; i++) {
+        char field[64];
+        snprintf(field, sizeof(field), "%s[%d]", name, i);
+        indexes[i] = findColumn(columns, count, field);
+        if (indexes[i] < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int compareUint32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// the median interval, so gaps where the logger dropped frames don't skew it
+static uint32_t logLooptime(const replayLog_t *log)
+{
+    const int count = MIN(log->length - 1, 10000);
+    uint32_t *intervals = malloc(count * sizeof(*intervals));
+    for (int i = 0; i < count; i++) {
+        intervals[i] = log->timeUs[i + 1] - log->timeUs[i];
+    }
+    qsort(intervals, count, sizeof(*intervals), compareUint32);
+    const uint32_t looptime = intervals[count / 2];
+    free(intervals);
+    return looptime;
+}
+
+static bool loadLog(replayLog_t *log, const char *fileName, const char *rawField)
+{
+    FILE *file = fopen(fileName, "r");
+    if (!file) {
+        fprintf(stderr, "cannot read log %s\n", fileName);
+        return false;
+    }
+
+    static char line[REPLAY_LINE_LENGTH];
+    char *columns[REPLAY_MAX_COLUMNS];
+    int timeColumn = -1, gyroColumns[XYZ_AXIS_COUNT], rcColumns[4];
+    int columnCount = 0;
+    while (fgets(line, sizeof(line), file)) {
+        columnCount = splitColumns(line, columns);
+        timeColumn = findColumn(columns, columnCount, "time (us)");
+        if (timeColumn >= 0) {
+            break;
+        }
+    }
+    if (timeColumn < 0 || !findArrayColumns(columns, columnCount, rawField, XYZ_AXIS_COUNT, gyroColumns)) {
+        fprintf(stderr, "%s has no time (us) and %s[0..2] columns\n", fileName, rawField);
+        fclose(file);
+        return false;
+    }
+    log->hasRc = findArrayColumns(columns, columnCount, "rcCommand", 4, rcColumns);
+
+    int capacity = 1 << 16;
+    log->timeUs = malloc(capacity * sizeof(*log->timeUs));
+    log->gyro = malloc(capacity * sizeof(*log->gyro));
+    log->rc = malloc(capacity * sizeof(*log->rc));
+    log->length = 0;
+    while (fgets(line, sizeof(line), file)) {
+        const int count = splitColumns(line, columns);
+        if (count < columnCount || !*columns[timeColumn]) {
+            continue;
+        }
+        if (log->length == capacity) {
+            capacity *= 2;
+            log->timeUs = realloc(log->timeUs, capacity * sizeof(*log->timeUs));
+            log->gyro = realloc(log->gyro, capacity * sizeof(*log->gyro));
+            log->rc = realloc(log->rc, capacity * sizeof(*log->rc));
+        }
+        log->timeUs[log->length] = strtoul(columns[timeColumn], NULL, 10);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            log->gyro[log->length][axis] = constrain(atoi(columns[gyroColumns[axis]]), INT16_MIN, INT16_MAX);
+        }
+        for (int i = 0; i < 4; i++) {
+            log->rc[log->length][i] = log->hasRc ? atoi(columns[rcColumns[i]]) : (i == THROTTLE ? 1500 : 0);
+        }
+        log->length++;
+    }
+    fclose(file);
+
+    if (log->length < REPLAY_FFT_SIZE) {
+        fprintf(stderr, "%s has %d samples, at least %d are needed\n", fileName, log->length, REPLAY_FFT_SIZE);
+        return false;
+    }
+    log->looptimeUs = logLooptime(log);
+    if (!log->looptimeUs) {
+        fprintf(stderr, "%s has no time between samples\n", fileName);
+        return false;
+    }
+    for (int signal = 0; signal < SIGNAL_COUNT; signal++) {
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            log->signal[signal][axis] = calloc(log->length, sizeof(float));
+        }
+    }
+    return true;
+}
+
+// Replay
+
+static void replayInit(uint32_t looptimeUs)
+{
+    gyroInit(&gyroConfigReplay);
+    // filter at the rate the samples were logged at, rather than the rate the fake gyro asks for
+    gyro.targetLooptime = looptimeUs;
+    gyro.sampleLooptime = looptimeUs;
+    gyroInitFilters();
+
+    pidSetTargetLooptime(looptimeUs);
+    pidInitFilters(&pidProfile);
+    pidInitConfig(&pidProfile);
+    pidStabilisationState(PID_STABILISATION_ON);
+    pidResetErrorGyroState();
+
+    ENABLE_ARMING_FLAG(ARMED);
+}
+
+// DC group delay of the gyro filter chain, the area between a step and the response to it
+static float filterChainDelayUs(uint32_t looptimeUs)
+{
+    replayInit(looptimeUs);
+
+    float lagSamples = 0.0f;
+    const int steps = REPLAY_STEP_RESPONSE_US / looptimeUs;
+    for (int i = 0; i < steps; i++) {
+        fakeGyroSet(REPLAY_STEP_DEG_S, 0, 0);
+        gyroUpdate();
+        lagSamples += 1.0f - gyro.gyroADCf[X] / REPLAY_STEP_DEG_S;
+    }
+    return lagSamples * looptimeUs;
+}
+
+static void replay(replayLog_t *log)
+{
+    replayInit(log->looptimeUs);
+
+    float frameSetpointRate[3] = { 0, 0, 0 };
+    int16_t frameRc[3] = { 0, 0, 0 };
+    uint32_t frameTimeUs = log->timeUs[0];
+
+    for (int i = 0; i < log->length; i++) {
+        simulatedTimeUs = log->timeUs[i];
+
+        // the setpoint derivative is the slope between changes of the logged RC command, as between RX frames
+        for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+            rcCommand[axis] = log->rc[i][axis];
+            setpointRate[axis] = constrainf(rcCalculateRate(&controlRateConfig, axis, rcCommand[axis] / 500.0f), -1998.0f, 1998.0f);
+        }
+        rcCommand[THROTTLE] = log->rc[i][THROTTLE];
+        if (memcmp(frameRc, rcCommand, sizeof(frameRc)) && simulatedTimeUs != frameTimeUs) {
+            for (int axis = FD_ROLL; axis <= FD_YAW; axis++) {
+                setpointRateDerivative[axis] = (setpointRate[axis] - frameSetpointRate[axis]) * 1e6f / (simulatedTimeUs - frameTimeUs);
+                frameSetpointRate[axis] = setpointRate[axis];
+            }
+            memcpy(frameRc, rcCommand, sizeof(frameRc));
+            frameTimeUs = simulatedTimeUs;
+        }
+
+        fakeGyroSet(log->gyro[i][X], log->gyro[i][Y], log->gyro[i][Z]);
+        REPLAY_CALL(&gyroUpdateStats, gyroUpdate());
+        REPLAY_CALL(&pidControllerStats, pidController(&pidProfile, &accelerometerTrims));
+
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            log->signal[SIGNAL_GYRO_RAW][axis][i] = log->gyro[i][axis];
+            log->signal[SIGNAL_GYRO_FILTERED][axis][i] = gyro.gyroADCf[axis];
+            log->signal[SIGNAL_DTERM][axis][i] = axisPID_D[axis];
+            log->signal[SIGNAL_PID_SUM][axis][i] = axisPIDf[axis];
+        }
+    }
+}
+
+// Analysis
+
+static void fft(float *re, float *im, int size)
+{
+    for (int i = 1, j = 0; i < size; i++) {
+        int bit = size >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            const float tr = re[i], ti = im[i];
+            re[i] = re[j]; im[i] = im[j];
+            re[j] = tr; im[j] = ti;
+        }
+    }
+    for (int length = 2; length <= size; length <<= 1) {
+        const float angle = -2 * M_PIf / length;
+        for (int i = 0; i < size; i += length) {
+            for (int k = 0; k < length / 2; k++) {
+                const float wr = cosf(angle * k), wi = sinf(angle * k);
+                const int a = i + k, b = i + k + length / 2;
+                const float xr = re[b] * wr - im[b] * wi;
+                const float xi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - xr; im[b] = im[a] - xi;
+                re[a] += xr; im[a] += xi;
+            }
+        }
+    }
+}
+
+// Welch cross spectrum of a against b with a Hann window and half overlapping segments, one sided and
+// scaled so the power of a signal against itself sums to its variance
+static void crossSpectrum(const float *a, const float *b, int length, float *crossRe, float *crossIm)
+{
+    static float aRe[REPLAY_FFT_SIZE], aIm[REPLAY_FFT_SIZE], bRe[REPLAY_FFT_SIZE], bIm[REPLAY_FFT_SIZE];
+    static float window[REPLAY_FFT_SIZE];
+    float windowPower = 0.0f;
+    for (int i = 0; i < REPLAY_FFT_SIZE; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2 * M_PIf * i / REPLAY_FFT_SIZE);
+        windowPower += window[i] * window[i];
+    }
+
+    memset(crossRe, 0, REPLAY_BIN_COUNT * sizeof(*crossRe));
+    memset(crossIm, 0, REPLAY_BIN_COUNT * sizeof(*crossIm));
+    int segments = 0;
+    for (int start = 0; start + REPLAY_FFT_SIZE <= length; start += REPLAY_FFT_SIZE / 2) {
+        float aMean = 0.0f, bMean = 0.0f;
+        for (int i = 0; i < REPLAY_FFT_SIZE; i++) {
+            aMean += a[start + i];
+            bMean += b[start + i];
+        }
+        aMean /= REPLAY_FFT_SIZE;
+        bMean /= REPLAY_FFT_SIZE;
+        for (int i = 0; i < REPLAY_FFT_SIZE; i++) {
+            aRe[i] = (a[start + i] - aMean) * window[i];
+            bRe[i] = (b[start + i] - bMean) * window[i];
+            aIm[i] = bIm[i] = 0.0f;
+        }
+        fft(aRe, aIm, REPLAY_FFT_SIZE);
+        fft(bRe, bIm, REPLAY_FFT_SIZE);
+        for (int bin = 0; bin < REPLAY_BIN_COUNT; bin++) {
+            const float scale = ((bin == 0 || bin == REPLAY_FFT_SIZE / 2) ? 1.0f : 2.0f) / (windowPower * REPLAY_FFT_SIZE);
+            crossRe[bin] += (aRe[bin] * bRe[bin] + aIm[bin] * bIm[bin]) * scale;
+            crossIm[bin] += (aRe[bin] * bIm[bin] - aIm[bin] * bRe[bin]) * scale;
+        }
+        segments++;
+    }
+    for (int bin = 0; bin < REPLAY_BIN_COUNT; bin++) {
+        crossRe[bin] /= segments;
+        crossIm[bin] /= segments;
+    }
+}
+
+static void powerSpectrum(const float *samples, int length, float *power)
+{
+    static float imaginary[REPLAY_BIN_COUNT];
+    crossSpectrum(samples, samples, length, power, imaginary);
+}
+
+static float bandRms(const float *power, float binHz, int minHz)
+{
+    float sum = 0.0f;
+    for (int bin = lrintf(ceilf(minHz / binHz)); bin < REPLAY_BIN_COUNT; bin++) {
+        sum += power[bin];
+    }
+    return sqrtf(sum);
+}
+
+/*
+ * Delay of the filtered signal below maxHz, the phase delay of each bin weighted by how much signal it carries.
+ * Both signals are differenced first, which leaves the phase between them as it is but stops the drift of the
+ * gyro over a segment from leaking into the lowest bins.
+ */
+static float measuredDelayUs(const float *reference, const float *delayed, int length, float binHz, int maxHz)
+{
+    float *referenceSlope = malloc((length - 1) * sizeof(float));
+    float *delayedSlope = malloc((length - 1) * sizeof(float));
+    for (int i = 0; i < length - 1; i++) {
+        referenceSlope[i] = reference[i + 1] - reference[i];
+        delayedSlope[i] = delayed[i + 1] - delayed[i];
+    }
+    static float crossRe[REPLAY_BIN_COUNT], crossIm[REPLAY_BIN_COUNT];
+    crossSpectrum(referenceSlope, delayedSlope, length - 1, crossRe, crossIm);
+    free(referenceSlope);
+    free(delayedSlope);
+
+    float delaySum = 0.0f, weightSum = 0.0f;
+    for (int bin = 1; bin < REPLAY_BIN_COUNT && bin * binHz < maxHz; bin++) {
+        const float weight = sqrtf(crossRe[bin] * crossRe[bin] + crossIm[bin] * crossIm[bin]);
+        const float phase = atan2f(crossIm[bin], crossRe[bin]);
+        delaySum += weight * -phase / (2 * M_PIf * bin * binHz);
+        weightSum += weight;
+    }
+    return weightSum > 0.0f ? delaySum / weightSum * 1e6f : 0.0f;
+}
+
+static bool writeSignals(const replayLog_t *log, const char *fileName)
+{
+    FILE *file = fopen(fileName, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "time (us)");
+    for (int signal = 0; signal < SIGNAL_COUNT; signal++) {
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            fprintf(file, ",%s[%d]", signalNames[signal], axis);
+        }
+    }
+    fprintf(file, "\n");
+    for (int i = 0; i < log->length; i++) {
+        fprintf(file, "%u", log->timeUs[i]);
+        for (int signal = 0; signal < SIGNAL_COUNT; signal++) {
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                fprintf(file, ",%.2f", log->signal[signal][axis][i]);
+            }
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return true;
+}
+
+static bool writeSpectrum(float power[SIGNAL_COUNT][XYZ_AXIS_COUNT][REPLAY_BIN_COUNT], float binHz, const char *fileName)
+{
+    FILE *file = fopen(fileName, "w");
+    if (!file) {
+        return false;
+    }
+    // RMS amplitude in each bin, in the units of the signal
+    fprintf(file, "frequency (Hz)");
+    for (int signal = 0; signal < SIGNAL_COUNT; signal++) {
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            fprintf(file, ",%s[%d]", signalNames[signal], axis);
+        }
+    }
+    fprintf(file, "\n");
+    for (int bin = 0; bin < REPLAY_BIN_COUNT; bin++) {
+        fprintf(file, "%.1f", bin * binHz);
+        for (int signal = 0; signal < SIGNAL_COUNT; signal++) {
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                fprintf(file, ",%.4f", sqrtf(power[signal][axis][bin]));
+            }
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-r <field>] [-o <signals.csv>] [-s <spectrum.csv>] [-n <Hz>] <log.csv> [<setting>=<value> ...]\n", name);
+    fprintf(stderr, "settings:");
+    for (unsigned i = 0; i < ARRAYLEN(replaySettings); i++) {
+        fprintf(stderr, " %s", replaySettings[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *rawField = "debug";
+    const char *signalsFileName = NULL;
+    const char *spectrumFileName = NULL;
+    int noiseMinHz = REPLAY_NOISE_MIN_HZ;
+
+    int option;
+    while ((option = getopt(argc, argv, "r:o:s:n:")) != -1) {
+        switch (option) {
+        case 'r':
+            rawField = optarg;
+            break;
+        case 'o':
+            signalsFileName = optarg;
+            break;
+        case 's':
+            spectrumFileName = optarg;
+            break;
+        case 'n':
+            noiseMinHz = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *logFileName = argv[optind++];
+
+    resetPidProfile();
+    for (; optind < argc; optind++) {
+        if (!applySetting(argv[optind])) {
+            fprintf(stderr, "unknown setting %s\n", argv[optind]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!loadLog(&replayLog, logFileName, rawField)) {
+        return 1;
+    }
+    const uint32_t looptimeUs = replayLog.looptimeUs;
+    const float chainDelayUs = filterChainDelayUs(looptimeUs);
+    replay(&replayLog);
+
+    static float power[SIGNAL_COUNT][XYZ_AXIS_COUNT][REPLAY_BIN_COUNT];
+    for (int signal = 0; signal < SIGNAL_COUNT; signal++) {
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            powerSpectrum(replayLog.signal[signal][axis], replayLog.length, power[signal][axis]);
+        }
+    }
+    const float binHz = 1e6f / looptimeUs / REPLAY_FFT_SIZE;
+
+    printf("%s: %d samples at %uus, raw gyro from %s[0..2]%s\n", logFileName, replayLog.length, looptimeUs, rawField,
+        replayLog.hasRc ? "" : ", no rcCommand so the setpoint is 0");
+    printf("gyro filter chain delay %.2fms\n", chainDelayUs / 1000.0f);
+    printf("axis   raw>%dHz  filtered  attenuation   dterm>%dHz  delay<%dHz\n", noiseMinHz, noiseMinHz, noiseMinHz);
+    static const char * const axisNames[XYZ_AXIS_COUNT] = { "roll", "pitch", "yaw" };
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        const float rawNoise = bandRms(power[SIGNAL_GYRO_RAW][axis], binHz, noiseMinHz);
+        const float filteredNoise = bandRms(power[SIGNAL_GYRO_FILTERED][axis], binHz, noiseMinHz);
+        const float attenuationDb = filteredNoise > 0.0f && rawNoise > 0.0f ? 20.0f * log10f(rawNoise / filteredNoise) : 0.0f;
+        const float delayUs = measuredDelayUs(replayLog.signal[SIGNAL_GYRO_RAW][axis], replayLog.signal[SIGNAL_GYRO_FILTERED][axis], replayLog.length, binHz, noiseMinHz);
+        printf("%-5s %10.2f %9.2f %10.1fdB %12.2f %6.2fms\n", axisNames[axis], rawNoise, filteredNoise, attenuationDb,
+            bandRms(power[SIGNAL_DTERM][axis], binHz, noiseMinHz), delayUs / 1000.0f);
+    }
+    const replayStats_t *stats[] = { &gyroUpdateStats, &pidControllerStats };
+    for (unsigned i = 0; i < ARRAYLEN(stats); i++) {
+        printf("%-14s %8.1f ns/sample %8.1f cycles/sample\n", stats[i]->name,
+            (double)stats[i]->ns / replayLog.length, (double)stats[i]->cycles / replayLog.length);
+    }
+
+    if (signalsFileName && !writeSignals(&replayLog, signalsFileName)) {
+        fprintf(stderr, "cannot write %s\n", signalsFileName);
+        return 1;
+    }
+    if (spectrumFileName && !writeSpectrum(power, binHz, spectrumFileName)) {
+        fprintf(stderr, "cannot write %s\n", spectrumFileName);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,440 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host benchmark of the flight loop.
+ *
+ * Runs scheduler() against a simulated micros() with a typical task set, where the
+ * gyro/PID task feeds gyroUpdate(), pidController() and mixTable() from a trace of
+ * gyro and RC samples, and reports the host time and cycles each function takes.
+ *
+ * Usage: flight_loop_benchmark [<trace.csv> [<loops>]]
+ *
+ * A trace has one gyro sample per line: gyro x,y,z in ADC counts (1 count = 1 deg/s)
+ * then roll,pitch,yaw,throttle RC values in microseconds. Lines starting with # are
+ * ignored. Without a trace a synthetic one is generated.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCHMARK_HAS_CYCLE_COUNTER
+#endif
+
+#include "platform.h"
+
+#include "build/debug.h"
+
+#include "common/axis.h"
+#include "common/filter.h"
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/accgyro.h"
+#include "drivers/accgyro_fake.h"
+#include "drivers/pwm_output.h"
+
+#include "fc/fc_main.h"
+#include "fc/rc_controls.h"
+#include "fc/runtime_config.h"
+
+#include "flight/failsafe.h"
+#include "flight/imu.h"
+#include "flight/mixer.h"
+#include "flight/navigation.h"
+#include "flight/pid.h"
+
+#include "io/beeper.h"
+#include "io/motors.h"
+
+#include "rx/rx.h"
+
+#include "scheduler/scheduler.h"
+
+#include "sensors/acceleration.h"
+#include "sensors/battery.h"
+#include "sensors/boardalignment.h"
+#include "sensors/gyro.h"
+#include "sensors/sensors.h"
+
+#include "config/feature.h"
+
+#define BENCHMARK_LOOPTIME_US 125          // 8kHz gyro and PID loop
+#define BENCHMARK_DEFAULT_LOOPS 80000      // 10 seconds of flight
+#define BENCHMARK_SYNTHETIC_SAMPLES 8000
+#define BENCHMARK_RC_RATE_DPS 670.0f       // setpoint at full stick deflection
+
+typedef struct benchmarkSample_s {
+    int16_t gyro[XYZ_AXIS_COUNT];
+    int16_t rc[4];                          // roll, pitch, yaw, throttle
+} benchmarkSample_t;
+
+typedef struct benchmarkStats_s {
+    const char *name;
+    uint64_t calls;
+    uint64_t ns;
+    uint64_t cycles;
+} benchmarkStats_t;
+
+typedef enum {
+    BENCHMARK_SCHEDULER = 0,
+    BENCHMARK_GYRO_UPDATE,
+    BENCHMARK_PID_CONTROLLER,
+    BENCHMARK_MIX_TABLE,
+    BENCHMARK_COUNT
+} benchmarkFunction_e;
+
+static benchmarkStats_t benchmarkStats[BENCHMARK_COUNT] = {
+    [BENCHMARK_SCHEDULER] = { .name = "scheduler" },
+    [BENCHMARK_GYRO_UPDATE] = { .name = "gyroUpdate" },
+    [BENCHMARK_PID_CONTROLLER] = { .name = "pidController" },
+    [BENCHMARK_MIX_TABLE] = { .name = "mixTable" },
+};
+
+static benchmarkSample_t *trace;
+static int traceLength;
+static int traceIndex;
+
+static timeUs_t simulatedTimeUs;
+static uint64_t taskNs;                     // host time spent in task functions during the current scheduler() call
+static uint64_t taskCycles;
+static int gyroPidLoops;
+
+static pidProfile_t pidProfile;
+static rollAndPitchTrims_t accelerometerTrims;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t nowCycles(void)
+{
+#ifdef BENCHMARK_HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#define BENCHMARK_CALL(function, call) do { \
+        const uint64_t startNs = nowNs(); \
+        const uint64_t startCycles = nowCycles(); \
+        call; \
+        benchmarkStats[function].cycles += nowCycles() - startCycles; \
+        benchmarkStats[function].ns += nowNs() - startNs; \
+        benchmarkStats[function].calls++; \
+    } while (0)
+
+// Flight loop stubs
+
+int16_t debug[DEBUG16_VALUE_COUNT];
+uint8_t debugMode;
+uint8_t armingFlags;
+uint16_t flightModeFlags;
+int16_t rcCommand[4];
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+attitudeEulerAngles_t attitude;
+uint8_t detectedSensors[SENSOR_INDEX_COUNT];
+int16_t GPS_angle[ANGLE_INDEX_COUNT];
+
+uint32_t micros(void) { return simulatedTimeUs; }
+void delay(uint32_t ms) { simulatedTimeUs += ms * 1000; }
+void delayMicroseconds(uint32_t us) { simulatedTimeUs += us; }
+
+void sensorsSet(uint32_t mask) { UNUSED(mask); }
+bool feature(uint32_t mask) { UNUSED(mask); return false; }
+void beeper(beeperMode_e mode) { UNUSED(mode); }
+bool failsafeIsActive(void) { return false; }
+bool isAirmodeActive(void) { return false; }
+float calculateVbatPidCompensation(void) { return 1.0f; }
+float getThrottlePIDAttenuation(void) { return 1.0f; }
+float getSetpointRate(int axis) { return rcCommand[axis] * BENCHMARK_RC_RATE_DPS / 500.0f; }
+float getSetpointRateDerivative(int axis) { UNUSED(axis); return 0.0f; }
+float getRcDeflection(int axis) { return rcCommand[axis] / 500.0f; }
+float getRcDeflectionAbs(int axis) { return ABS(rcCommand[axis]) / 500.0f; }
+
+bool pwmAreMotorsEnabled(void) { return true; }
+void pwmWriteMotor(uint8_t index, uint16_t value) { UNUSED(index); UNUSED(value); }
+void pwmCompleteMotorUpdate(uint8_t motorCount) { UNUSED(motorCount); }
+void pwmShutdownPulsesForAllMotors(uint8_t motorCount) { UNUSED(motorCount); }
+
+// Tasks, each advances the simulated clock by roughly what it takes on an F4
+
+static void benchmarkTaskGyroPid(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    const benchmarkSample_t *sample = &trace[traceIndex];
+    traceIndex = (traceIndex + 1) % traceLength;
+
+    fakeGyroSet(sample->gyro[X], sample->gyro[Y], sample->gyro[Z]);
+    for (int axis = ROLL; axis <= YAW; axis++) {
+        rcData[axis] = sample->rc[axis];
+        rcCommand[axis] = sample->rc[axis] - 1500;
+    }
+    rcData[THROTTLE] = sample->rc[THROTTLE];
+    rcCommand[THROTTLE] = sample->rc[THROTTLE];
+
+    BENCHMARK_CALL(BENCHMARK_GYRO_UPDATE, gyroUpdate());
+    BENCHMARK_CALL(BENCHMARK_PID_CONTROLLER, pidController(&pidProfile, &accelerometerTrims));
+    BENCHMARK_CALL(BENCHMARK_MIX_TABLE, mixTable(&pidProfile));
+
+    gyroPidLoops++;
+    simulatedTimeUs += 40;
+}
+
+static void benchmarkTaskAccel(timeUs_t currentTimeUs) { UNUSED(currentTimeUs); simulatedTimeUs += 15; }
+static void benchmarkTaskAttitude(timeUs_t currentTimeUs) { UNUSED(currentTimeUs); simulatedTimeUs += 20; }
+static void benchmarkTaskSerial(timeUs_t currentTimeUs) { UNUSED(currentTimeUs); simulatedTimeUs += 5; }
+static void benchmarkTaskBattery(timeUs_t currentTimeUs) { UNUSED(currentTimeUs); simulatedTimeUs += 10; }
+static void benchmarkTaskRx(timeUs_t currentTimeUs) { UNUSED(currentTimeUs); simulatedTimeUs += 25; }
+
+static bool benchmarkRxCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTimeUs)
+{
+    UNUSED(currentDeltaTimeUs);
+    // a frame every 9ms, as from a serial receiver
+    return (currentTimeUs % 9000) < BENCHMARK_LOOPTIME_US;
+}
+
+cfTask_t cfTasks[TASK_COUNT] = {
+    [TASK_SYSTEM] = {
+        .taskName = "SYSTEM",
+        .taskFunc = taskSystem,
+        .desiredPeriod = 1000000 / 10,
+        .staticPriority = TASK_PRIORITY_HIGH,
+    },
+    [TASK_GYROPID] = {
+        .taskName = "PID",
+        .taskFunc = benchmarkTaskGyroPid,
+        .desiredPeriod = BENCHMARK_LOOPTIME_US,
+        .staticPriority = TASK_PRIORITY_REALTIME,
+    },
+    [TASK_ACCEL] = {
+        .taskName = "ACCEL",
+        .taskFunc = benchmarkTaskAccel,
+        .desiredPeriod = 1000000 / 1000,
+        .staticPriority = TASK_PRIORITY_MEDIUM,
+    },
+    [TASK_ATTITUDE] = {
+        .taskName = "ATTITUDE",
+        .taskFunc = benchmarkTaskAttitude,
+        .desiredPeriod = 1000000 / 100,
+        .staticPriority = TASK_PRIORITY_MEDIUM,
+    },
+    [TASK_RX] = {
+        .taskName = "RX",
+        .checkFunc = benchmarkRxCheck,
+        .taskFunc = benchmarkTaskRx,
+        .desiredPeriod = 1000000 / 50,
+        .staticPriority = TASK_PRIORITY_HIGH,
+    },
+    [TASK_SERIAL] = {
+        .taskName = "SERIAL",
+        .taskFunc = benchmarkTaskSerial,
+        .desiredPeriod = 1000000 / 100,
+        .staticPriority = TASK_PRIORITY_LOW,
+    },
+    [TASK_BATTERY] = {
+        .taskName = "BATTERY",
+        .taskFunc = benchmarkTaskBattery,
+        .desiredPeriod = 1000000 / 50,
+        .staticPriority = TASK_PRIORITY_MEDIUM,
+    },
+};
+
+// Traces
+
+static int16_t synthNoise(void)
+{
+    static uint32_t seed = 12345;
+    seed = seed * 1103515245 + 12345;
+    return (int16_t)((seed >> 16) % 21) - 10;
+}
+
+static void generateSyntheticTrace(void)
+{
+    traceLength = BENCHMARK_SYNTHETIC_SAMPLES;
+    trace = calloc(traceLength, sizeof(*trace));
+    for (int i = 0; i < traceLength; i++) {
+        const float t = i * BENCHMARK_LOOPTIME_US * 1e-6f;
+        // stick movements, following on the gyro, plus motor noise around 230Hz
+        const float stick[3] = { sinf(2 * M_PIf * 0.7f * t), sinf(2 * M_PIf * 1.1f * t), 0.3f * sinf(2 * M_PIf * 0.4f * t) };
+        const float motorNoise = 30.0f * sinf(2 * M_PIf * 230.0f * t);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            trace[i].gyro[axis] = lrintf(stick[axis] * 300.0f + motorNoise) + synthNoise();
+            trace[i].rc[axis] = 1500 + lrintf(stick[axis] * 300.0f);
+        }
+        trace[i].rc[THROTTLE] = 1400 + lrintf(200.0f * sinf(2 * M_PIf * 0.5f * t));
+    }
+}
+
+static bool loadTrace(const char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    if (!file) {
+        return false;
+    }
+    int capacity = 1024;
+    trace = malloc(capacity * sizeof(*trace));
+    traceLength = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        int v[7];
+        if (line[0] == '#' || sscanf(line, "%d,%d,%d,%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]) != 7) {
+            continue;
+        }
+        if (traceLength == capacity) {
+            capacity *= 2;
+            trace = realloc(trace, capacity * sizeof(*trace));
+        }
+        for (int i = 0; i < 3; i++) {
+            trace[traceLength].gyro[i] = v[i];
+        }
+        for (int i = 0; i < 4; i++) {
+            trace[traceLength].rc[i] = v[3 + i];
+        }
+        traceLength++;
+    }
+    fclose(file);
+    return traceLength > 0;
+}
+
+// Flight loop setup, following the defaults in fc/config.c
+
+static void benchmarkInit(void)
+{
+    static gyroConfig_t gyroConfig = {
+        .gyro_sync_denom = 1,
+        .gyro_lpf = GYRO_LPF_256HZ,
+        .gyro_soft_lpf_type = FILTER_PT1,
+        .gyro_soft_lpf_hz = 90,
+        .gyro_soft_notch_hz_1 = 400,
+        .gyro_soft_notch_cutoff_1 = 300,
+        .gyro_soft_notch_hz_2 = 200,
+        .gyro_soft_notch_cutoff_2 = 100,
+    };
+    static motorConfig_t motorConfig = {
+        .minthrottle = 1070,
+        .maxthrottle = 2000,
+        .mincommand = 1000,
+        .motorPwmProtocol = PWM_TYPE_ONESHOT125,
+    };
+    static flight3DConfig_t flight3DConfig = {
+        .deadband3d_low = 1406,
+        .deadband3d_high = 1514,
+        .neutral3d = 1460,
+        .deadband3d_throttle = 50,
+    };
+    static mixerConfig_t mixerConfig = { .mixerMode = MIXER_QUADX, .yaw_motor_direction = 1 };
+    static airplaneConfig_t airplaneConfig = { .fixedwing_althold_dir = 1 };
+    static rxConfig_t rxConfig = { .mincheck = 1100, .maxcheck = 1900, .midrc = 1500 };
+
+    gyroInit(&gyroConfig);
+
+    const uint8_t p[3] = { 43, 58, 70 }, i[3] = { 40, 50, 45 }, d[3] = { 20, 22, 20 };
+    for (int axis = 0; axis < 3; axis++) {
+        pidProfile.P8[axis] = p[axis];
+        pidProfile.I8[axis] = i[axis];
+        pidProfile.D8[axis] = d[axis];
+    }
+    pidProfile.yaw_p_limit = YAW_P_LIMIT_MAX;
+    pidProfile.pidSumLimit = PIDSUM_LIMIT;
+    pidProfile.rollPitchItermIgnoreRate = 200;
+    pidProfile.yawItermIgnoreRate = 55;
+    pidProfile.dterm_filter_type = FILTER_BIQUAD;
+    pidProfile.dterm_lpf_hz = 100;
+    pidProfile.dterm_notch_hz = 260;
+    pidProfile.dterm_notch_cutoff = 160;
+    pidProfile.pidAtMinThrottle = PID_STABILISATION_ON;
+    pidProfile.levelAngleLimit = 70.0f;
+    pidProfile.setpointRelaxRatio = 30;
+    pidProfile.dtermSetpointWeight = 200;
+    pidProfile.yawRateAccelLimit = 10.0f;
+    pidProfile.rateAccelLimit = 0.0f;
+    pidProfile.itermThrottleThreshold = 350;
+    pidProfile.levelSensitivity = 100.0f;
+    pidSetTargetLooptime(BENCHMARK_LOOPTIME_US);
+    pidInitFilters(&pidProfile);
+    pidInitConfig(&pidProfile);
+    pidStabilisationState(PID_STABILISATION_ON);
+
+    mixerUseConfigs(&flight3DConfig, &motorConfig, &mixerConfig, &airplaneConfig, &rxConfig);
+    mixerInit(MIXER_QUADX, NULL);
+    mixerConfigureOutput();
+
+    ENABLE_ARMING_FLAG(ARMED);
+
+    schedulerInit();
+    for (cfTaskId_e taskId = 0; taskId < TASK_COUNT; taskId++) {
+        if (cfTasks[taskId].taskFunc) {
+            setTaskEnabled(taskId, true);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1) {
+        if (!loadTrace(argv[1])) {
+            fprintf(stderr, "cannot read trace %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        generateSyntheticTrace();
+    }
+    const int loops = argc > 2 ? atoi(argv[2]) : BENCHMARK_DEFAULT_LOOPS;
+
+    benchmarkInit();
+
+    while (gyroPidLoops < loops) {
+        const uint64_t taskNsBefore = benchmarkStats[BENCHMARK_GYRO_UPDATE].ns + benchmarkStats[BENCHMARK_PID_CONTROLLER].ns + benchmarkStats[BENCHMARK_MIX_TABLE].ns;
+        const uint64_t taskCyclesBefore = benchmarkStats[BENCHMARK_GYRO_UPDATE].cycles + benchmarkStats[BENCHMARK_PID_CONTROLLER].cycles + benchmarkStats[BENCHMARK_MIX_TABLE].cycles;
+        const timeUs_t timeBefore = simulatedTimeUs;
+
+        BENCHMARK_CALL(BENCHMARK_SCHEDULER, scheduler());
+
+        // leave the flight loop functions out of the scheduler figures
+        taskNs = benchmarkStats[BENCHMARK_GYRO_UPDATE].ns + benchmarkStats[BENCHMARK_PID_CONTROLLER].ns + benchmarkStats[BENCHMARK_MIX_TABLE].ns - taskNsBefore;
+        taskCycles = benchmarkStats[BENCHMARK_GYRO_UPDATE].cycles + benchmarkStats[BENCHMARK_PID_CONTROLLER].cycles + benchmarkStats[BENCHMARK_MIX_TABLE].cycles - taskCyclesBefore;
+        benchmarkStats[BENCHMARK_SCHEDULER].ns -= taskNs;
+        benchmarkStats[BENCHMARK_SCHEDULER].cycles -= taskCycles;
+
+        if (simulatedTimeUs == timeBefore) {
+            // nothing ran, a scheduler pass takes about a microsecond on target
+            simulatedTimeUs++;
+        }
+    }
+
+    printf("%d gyro/PID loops, %d trace samples\n", gyroPidLoops, traceLength);
+    printf("function            calls    ns/call  cycles/call\n");
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        const benchmarkStats_t *stats = &benchmarkStats[i];
+        printf("%-14s %10llu %10.1f %12.1f\n", stats->name, (unsigned long long)stats->calls,
+            stats->calls ? (double)stats->ns / stats->calls : 0.0, stats->calls ? (double)stats->cycles / stats->calls : 0.0);
+    }
+    return 0;
+}
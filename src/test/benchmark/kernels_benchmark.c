@@ -0,0 +1,502 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host microbenchmarks of the kernels in common/ and the blackbox encoders, a baseline for work on them.
+ *
+ * Usage: kernels_benchmark [<name> ...]
+ *
+ * Each kernel runs over a table of pseudo random inputs, in batches sized to take about
+ * BENCH_BATCH_NS, and the fastest of BENCH_REPEATS batches is reported in ns and cycles per call.
+ * CRCs are run over a BENCH_CRC_LENGTH byte buffer per call. Names given on the command line run
+ * only the kernels whose name contains one of them.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_CYCLE_COUNTER
+#endif
+
+#include "platform.h"
+
+#include "blackbox/blackbox_encoding.h"
+
+#include "common/color.h"
+#include "common/colorconversion.h"
+#include "common/encoding.h"
+#include "common/filter.h"
+#include "common/maths.h"
+#include "common/utils.h"
+
+#define BENCH_INPUT_COUNT       1024    // power of two, inputs are indexed with a mask
+#define BENCH_BATCH_NS          20000000
+#define BENCH_REPEATS           5
+#define BENCH_CRC_LENGTH        64
+#define BENCH_LOOPTIME_US       125
+
+typedef void benchFunc(int iterations);
+
+typedef struct bench_s {
+    const char *name;
+    benchFunc *func;
+} bench_t;
+
+static float inputFloat[BENCH_INPUT_COUNT];         // -1000 to 1000, as gyro deg/s
+static float inputUnit[BENCH_INPUT_COUNT];          // -1 to 1
+static float inputAngle[BENCH_INPUT_COUNT];         // -pi to pi
+static int32_t inputInt[BENCH_INPUT_COUNT];         // -32768 to 32767
+static int32_t inputSmall[BENCH_INPUT_COUNT];       // -64 to 63, as most blackbox deltas
+static hsvColor_t inputHsv[BENCH_INPUT_COUNT];
+static uint8_t inputBytes[BENCH_INPUT_COUNT + BENCH_CRC_LENGTH];
+
+// results are summed into here, so the compiler can't drop the calls
+static volatile float sinkFloat;
+static volatile uint32_t sinkInt;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t nowCycles(void)
+{
+#ifdef BENCH_HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint32_t benchRandom(void)
+{
+    static uint32_t seed = 12345;
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static void benchInitInputs(void)
+{
+    for (int i = 0; i < BENCH_INPUT_COUNT; i++) {
+        const float unit = (benchRandom() % 20001) / 10000.0f - 1.0f;
+        inputUnit[i] = unit;
+        inputFloat[i] = unit * 1000.0f;
+        inputAngle[i] = unit * M_PIf;
+        inputInt[i] = (int32_t)(benchRandom() % 65536) - 32768;
+        inputSmall[i] = (int32_t)(benchRandom() % 128) - 64;
+        inputHsv[i].h = benchRandom() % (HSV_HUE_MAX + 1);
+        inputHsv[i].s = benchRandom();
+        inputHsv[i].v = benchRandom();
+    }
+    for (unsigned i = 0; i < sizeof(inputBytes); i++) {
+        inputBytes[i] = benchRandom();
+    }
+}
+
+#define BENCH_INDEX(i) ((i) & (BENCH_INPUT_COUNT - 1))
+
+// Filters
+
+static void benchBiquadLpf(int iterations)
+{
+    biquadFilter_t filter;
+    biquadFilterInitLPF(&filter, 100, BENCH_LOOPTIME_US);
+    float sum = 0.0f;
+    for (int i = 0; i < iterations; i++) {
+        sum += biquadFilterApply(&filter, inputFloat[BENCH_INDEX(i)]);
+    }
+    sinkFloat = sum;
+}
+
+static void benchBiquadNotch(int iterations)
+{
+    biquadFilter_t filter;
+    biquadFilterInit(&filter, 260, BENCH_LOOPTIME_US, filterGetNotchQ(260, 160), FILTER_NOTCH);
+    float sum = 0.0f;
+    for (int i = 0; i < iterations; i++) {
+        sum += biquadFilterApply(&filter, inputFloat[BENCH_INDEX(i)]);
+    }
+    sinkFloat = sum;
+}
+
+static void benchBiquad3(int iterations)
+{
+    biquadFilter3_t filter;
+    biquadFilter3InitLPF(&filter, 100, BENCH_LOOPTIME_US);
+    float sum = 0.0f;
+    for (int i = 0; i < iterations; i++) {
+        float data[FILTER3_AXIS_COUNT] = { inputFloat[BENCH_INDEX(i)], inputFloat[BENCH_INDEX(i + 1)], inputFloat[BENCH_INDEX(i + 2)] };
+        biquadFilter3Apply(&filter, data);
+        sum += data[0];
+    }
+    sinkFloat = sum;
+}
+
+static void benchBiquad3Int(int iterations)
+{
+    biquadFilter3_t source;
+    biquadFilter3InitLPF(&source, 100, BENCH_LOOPTIME_US);
+    biquadFilter3Int_t filter;
+    biquadFilter3IntInit(&filter, &source);
+    int32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        int32_t data[FILTER3_AXIS_COUNT] = { inputInt[BENCH_INDEX(i)], inputInt[BENCH_INDEX(i + 1)], inputInt[BENCH_INDEX(i + 2)] };
+        biquadFilter3IntApply(&filter, data);
+        sum += data[0];
+    }
+    sinkInt = sum;
+}
+
+static void benchPt1(int iterations)
+{
+    pt1Filter_t filter;
+    pt1FilterInit(&filter, 90, BENCH_LOOPTIME_US * 1e-6f);
+    float sum = 0.0f;
+    for (int i = 0; i < iterations; i++) {
+        sum += pt1FilterApply(&filter, inputFloat[BENCH_INDEX(i)]);
+    }
+    sinkFloat = sum;
+}
+
+static void benchPt1Filter3(int iterations)
+{
+    pt1Filter3_t filter;
+    pt1Filter3Init(&filter, 90, BENCH_LOOPTIME_US * 1e-6f);
+    float sum = 0.0f;
+    for (int i = 0; i < iterations; i++) {
+        float data[FILTER3_AXIS_COUNT] = { inputFloat[BENCH_INDEX(i)], inputFloat[BENCH_INDEX(i + 1)], inputFloat[BENCH_INDEX(i + 2)] };
+        pt1Filter3Apply(&filter, data);
+        sum += data[0];
+    }
+    sinkFloat = sum;
+}
+
+static void benchFirDenoise(int iterations)
+{
+    firFilterDenoise_t filter;
+    firFilterDenoiseInit(&filter, 90, BENCH_LOOPTIME_US);
+    float sum = 0.0f;
+    for (int i = 0; i < iterations; i++) {
+        sum += firFilterDenoiseUpdate(&filter, inputFloat[BENCH_INDEX(i)]);
+    }
+    sinkFloat = sum;
+}
+
+static void benchNotchBank(int iterations)
+{
+    static notchFilterBank_t bank;
+    notchFilterBankInit(&bank, NOTCH_BANK_MAX_STAGES, 200, BENCH_LOOPTIME_US, 5.0f);
+    float sum = 0.0f;
+    for (int i = 0; i < iterations; i++) {
+        float data[FILTER3_AXIS_COUNT] = { inputFloat[BENCH_INDEX(i)], inputFloat[BENCH_INDEX(i + 1)], inputFloat[BENCH_INDEX(i + 2)] };
+        notchFilterBankApply(&bank, data);
+        sum += data[0];
+    }
+    sinkFloat = sum;
+}
+
+// Trigonometry
+
+#define BENCH_FLOAT_FUNC(name, call, input) \
+    static void name(int iterations) \
+    { \
+        float sum = 0.0f; \
+        for (int i = 0; i < iterations; i++) { \
+            const float x = input[BENCH_INDEX(i)]; \
+            sum += call; \
+        } \
+        sinkFloat = sum; \
+    }
+
+BENCH_FLOAT_FUNC(benchSinApprox, sin_approx(x), inputAngle)
+BENCH_FLOAT_FUNC(benchCosApprox, cos_approx(x), inputAngle)
+BENCH_FLOAT_FUNC(benchAtan2Approx, atan2_approx(x, inputUnit[BENCH_INDEX(i + 1)]), inputUnit)
+BENCH_FLOAT_FUNC(benchAcosApprox, acos_approx(x), inputUnit)
+BENCH_FLOAT_FUNC(benchSinLut, sin_lut(x), inputAngle)
+BENCH_FLOAT_FUNC(benchCosLut, cos_lut(x), inputAngle)
+BENCH_FLOAT_FUNC(benchAtan2Lut, atan2_lut(x, inputUnit[BENCH_INDEX(i + 1)]), inputUnit)
+BENCH_FLOAT_FUNC(benchSinf, sinf(x), inputAngle)
+BENCH_FLOAT_FUNC(benchAtan2f, atan2f(x, inputUnit[BENCH_INDEX(i + 1)]), inputUnit)
+
+static void benchAtan2ApproxInt(int iterations)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += atan2_approx_int(inputInt[BENCH_INDEX(i)], inputInt[BENCH_INDEX(i + 1)]);
+    }
+    sinkInt = sum;
+}
+
+// Medians, each call is given a fresh copy as the filters reorder their input
+
+#define BENCH_MEDIAN(name, func, type, input, count) \
+    static void name(int iterations) \
+    { \
+        type sum = 0; \
+        for (int i = 0; i < iterations; i++) { \
+            type v[count]; \
+            for (int j = 0; j < count; j++) { \
+                v[j] = input[BENCH_INDEX(i + j)]; \
+            } \
+            sum += func(v); \
+        } \
+        sinkFloat = sum; \
+    }
+
+BENCH_MEDIAN(benchMedian3, quickMedianFilter3, int32_t, inputInt, 3)
+BENCH_MEDIAN(benchMedian5, quickMedianFilter5, int32_t, inputInt, 5)
+BENCH_MEDIAN(benchMedian7, quickMedianFilter7, int32_t, inputInt, 7)
+BENCH_MEDIAN(benchMedian9, quickMedianFilter9, int32_t, inputInt, 9)
+BENCH_MEDIAN(benchMedian3f, quickMedianFilter3f, float, inputFloat, 3)
+BENCH_MEDIAN(benchMedian5f, quickMedianFilter5f, float, inputFloat, 5)
+BENCH_MEDIAN(benchMedian7f, quickMedianFilter7f, float, inputFloat, 7)
+BENCH_MEDIAN(benchMedian9f, quickMedianFilter9f, float, inputFloat, 9)
+
+// Encoders
+
+static void benchZigzag(int iterations)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += zigzagEncode(inputInt[BENCH_INDEX(i)]);
+    }
+    sinkInt = sum;
+}
+
+static void benchUnsignedVB(int iterations)
+{
+    uint8_t buffer[BLACKBOX_VB_MAX_BYTES];
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += blackboxEncodeUnsignedVB(buffer, (uint32_t)inputInt[BENCH_INDEX(i)] & 0xffff) - buffer;
+    }
+    sinkInt = sum + buffer[0];
+}
+
+static void benchSignedVB(int iterations)
+{
+    uint8_t buffer[BLACKBOX_VB_MAX_BYTES];
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += blackboxEncodeSignedVB(buffer, inputSmall[BENCH_INDEX(i)]) - buffer;
+    }
+    sinkInt = sum + buffer[0];
+}
+
+static void benchTag2_3S32(int iterations)
+{
+    uint8_t buffer[BLACKBOX_TAG2_3S32_MAX_BYTES];
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += blackboxEncodeTag2_3S32(buffer, &inputSmall[BENCH_INDEX(i) & ~3]) - buffer;
+    }
+    sinkInt = sum + buffer[0];
+}
+
+static void benchTag8_4S16(int iterations)
+{
+    uint8_t buffer[BLACKBOX_TAG8_4S16_MAX_BYTES];
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += blackboxEncodeTag8_4S16(buffer, &inputSmall[BENCH_INDEX(i) & ~3]) - buffer;
+    }
+    sinkInt = sum + buffer[0];
+}
+
+static void benchTag8_8SVB(int iterations)
+{
+    uint8_t buffer[BLACKBOX_TAG8_8SVB_MAX_BYTES];
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += blackboxEncodeTag8_8SVB(buffer, &inputSmall[BENCH_INDEX(i) & ~7], 8) - buffer;
+    }
+    sinkInt = sum + buffer[0];
+}
+
+static void benchHsvToRgb24(int iterations)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        const rgbColor24bpp_t *rgb = hsvToRgb24(&inputHsv[BENCH_INDEX(i)]);
+        sum += rgb->rgb.r + rgb->rgb.g + rgb->rgb.b;
+    }
+    sinkInt = sum;
+}
+
+// CRCs
+
+static void benchCrc16Ccitt(int iterations)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        const uint8_t *data = &inputBytes[BENCH_INDEX(i)];
+        uint16_t crc = 0;
+        for (int j = 0; j < BENCH_CRC_LENGTH; j++) {
+            crc = crc16_ccitt(crc, data[j]);
+        }
+        sum += crc;
+    }
+    sinkInt = sum;
+}
+
+static void benchCrc16CcittBuf(int iterations)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += crc16_ccitt_buf(0, &inputBytes[BENCH_INDEX(i)], BENCH_CRC_LENGTH);
+    }
+    sinkInt = sum;
+}
+
+static void benchCrc8DvbS2(int iterations)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        const uint8_t *data = &inputBytes[BENCH_INDEX(i)];
+        uint8_t crc = 0;
+        for (int j = 0; j < BENCH_CRC_LENGTH; j++) {
+            crc = crc8_dvb_s2(crc, data[j]);
+        }
+        sum += crc;
+    }
+    sinkInt = sum;
+}
+
+static void benchCrc8DvbS2Buf(int iterations)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += crc8_dvb_s2_buf(0, &inputBytes[BENCH_INDEX(i)], BENCH_CRC_LENGTH);
+    }
+    sinkInt = sum;
+}
+
+static void benchCrc8Poly07Buf(int iterations)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += crc8_poly_0x07_buf(0, &inputBytes[BENCH_INDEX(i)], BENCH_CRC_LENGTH);
+    }
+    sinkInt = sum;
+}
+
+static const bench_t benches[] = {
+    { "biquadFilterApply lpf",      benchBiquadLpf },
+    { "biquadFilterApply notch",    benchBiquadNotch },
+    { "biquadFilter3Apply",         benchBiquad3 },
+    { "biquadFilter3IntApply",      benchBiquad3Int },
+    { "pt1FilterApply",             benchPt1 },
+    { "pt1Filter3Apply",            benchPt1Filter3 },
+    { "firFilterDenoiseUpdate",     benchFirDenoise },
+    { "notchFilterBankApply",       benchNotchBank },
+    { "sin_approx",                 benchSinApprox },
+    { "cos_approx",                 benchCosApprox },
+    { "atan2_approx",               benchAtan2Approx },
+    { "acos_approx",                benchAcosApprox },
+    { "atan2_approx_int",           benchAtan2ApproxInt },
+    { "sin_lut",                    benchSinLut },
+    { "cos_lut",                    benchCosLut },
+    { "atan2_lut",                  benchAtan2Lut },
+    { "libc sinf",                  benchSinf },
+    { "libc atan2f",                benchAtan2f },
+    { "quickMedianFilter3",         benchMedian3 },
+    { "quickMedianFilter5",         benchMedian5 },
+    { "quickMedianFilter7",         benchMedian7 },
+    { "quickMedianFilter9",         benchMedian9 },
+    { "quickMedianFilter3f",        benchMedian3f },
+    { "quickMedianFilter5f",        benchMedian5f },
+    { "quickMedianFilter7f",        benchMedian7f },
+    { "quickMedianFilter9f",        benchMedian9f },
+    { "zigzagEncode",               benchZigzag },
+    { "blackboxEncodeUnsignedVB",   benchUnsignedVB },
+    { "blackboxEncodeSignedVB",     benchSignedVB },
+    { "blackboxEncodeTag2_3S32",    benchTag2_3S32 },
+    { "blackboxEncodeTag8_4S16",    benchTag8_4S16 },
+    { "blackboxEncodeTag8_8SVB",    benchTag8_8SVB },
+    { "hsvToRgb24",                 benchHsvToRgb24 },
+    { "crc16_ccitt",                benchCrc16Ccitt },
+    { "crc16_ccitt_buf",            benchCrc16CcittBuf },
+    { "crc8_dvb_s2",                benchCrc8DvbS2 },
+    { "crc8_dvb_s2_buf",            benchCrc8DvbS2Buf },
+    { "crc8_poly_0x07_buf",         benchCrc8Poly07Buf },
+};
+
+static bool benchSelected(const char *name, int argc, char *argv[])
+{
+    if (argc < 2) {
+        return true;
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strstr(name, argv[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void benchRun(const bench_t *bench)
+{
+    // grow the batch until it takes long enough to time
+    int iterations = 1000;
+    for (;;) {
+        const uint64_t startNs = nowNs();
+        bench->func(iterations);
+        const uint64_t elapsedNs = nowNs() - startNs;
+        if (elapsedNs >= BENCH_BATCH_NS / 4 || iterations >= (1 << 28)) {
+            iterations = elapsedNs ? (int)MIN((uint64_t)iterations * BENCH_BATCH_NS / elapsedNs, 1u << 30) : iterations;
+            break;
+        }
+        iterations *= 4;
+    }
+
+    double bestNs = 0.0, bestCycles = 0.0;
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        const uint64_t startNs = nowNs();
+        const uint64_t startCycles = nowCycles();
+        bench->func(iterations);
+        const double ns = (double)(nowNs() - startNs) / iterations;
+        const double cycles = (double)(nowCycles() - startCycles) / iterations;
+        if (repeat == 0 || ns < bestNs) {
+            bestNs = ns;
+            bestCycles = cycles;
+        }
+    }
+    printf("%-28s %10.2f %12.2f\n", bench->name, bestNs, bestCycles);
+}
+
+int main(int argc, char *argv[])
+{
+    benchInitInputs();
+    trigLutInit();
+
+    printf("%-28s %10s %12s\n", "kernel", "ns/call", "cycles/call");
+    for (unsigned i = 0; i < ARRAYLEN(benches); i++) {
+        if (benchSelected(benches[i].name, argc, argv)) {
+            benchRun(&benches[i]);
+        }
+    }
+    return 0;
+}
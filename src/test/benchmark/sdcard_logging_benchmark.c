@@ -0,0 +1,345 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host benchmark of blackbox logging to an SD card.
+ *
+ * Runs asyncfatfs against a simulated card at an 8kHz loop rate. Each loop a blackbox frame
+ * is encoded into a RAM ring the size of the one in blackbox_io.c, the ring is drained into
+ * afatfs_fwrite() and afatfs_poll() is called, the same order the flight loop runs them in.
+ * The card takes time for every command and block. It also stalls now and then the way real
+ * cards do when they reorganise their flash. Frames that don't fit in the ring are counted as
+ * dropped.
+ *
+ * Usage: sdcard_logging_benchmark [<seconds> [<stall ms> [<stall interval KB>]]]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/sdcard.h"
+
+#include "io/asyncfatfs/asyncfatfs.h"
+#include "io/asyncfatfs/fat_standard.h"
+
+#define BENCHMARK_LOOPTIME_US 125           // 8kHz gyro and PID loop, blackbox logging every iteration
+#define BENCHMARK_DEFAULT_SECONDS 60
+#define BENCHMARK_DEFAULT_STALL_MS 50
+#define BENCHMARK_DEFAULT_STALL_INTERVAL_KB 1024
+
+#define BENCHMARK_BLACKBOX_BUFFER_SIZE 4096 // BLACKBOX_BUFFER_SIZE on F4/F7
+#define BENCHMARK_I_FRAME_BYTES 110         // typical frame sizes of a quad log
+#define BENCHMARK_P_FRAME_BYTES 38
+#define BENCHMARK_I_INTERVAL 32
+
+// Simulated card, a FAT32 volume of 8 sector clusters that only keeps the blocks that were written
+#define CARD_BLOCK_SIZE 512
+#define CARD_PARTITION_START 2048
+#define CARD_SECTORS_PER_CLUSTER 8
+#define CARD_CLUSTERS 70000
+#define CARD_RESERVED_SECTORS 32
+#define CARD_FAT_SECTORS ((CARD_CLUSTERS + 2) * 4 / 512 + 1)
+#define CARD_VOLUME_SECTORS (CARD_RESERVED_SECTORS + 2 * CARD_FAT_SECTORS + CARD_CLUSTERS * CARD_SECTORS_PER_CLUSTER)
+#define CARD_BLOCKS (CARD_PARTITION_START + CARD_VOLUME_SECTORS)
+
+// Card timings for SPI at 21MHz with DMA, including the card programming each block
+#define CARD_READ_US 300
+#define CARD_SINGLE_WRITE_US 1200
+#define CARD_STREAM_START_US 400
+#define CARD_STREAM_WRITE_US 260
+#define CARD_STREAM_STOP_US 600
+
+static uint32_t simulatedTimeUs;
+
+static uint8_t *cardBlocks[CARD_BLOCKS];
+static const sdcardMetadata_t cardMetadata = { .numBlocks = CARD_BLOCKS };
+
+static struct {
+    bool busy;
+    uint32_t readyAtUs;
+    sdcardBlockOperation_e operation;
+    uint32_t blockIndex;
+    uint8_t *buffer;
+    sdcard_operationCompleteCallback_c callback;
+    uint32_t callbackData;
+
+    bool streaming;
+    uint32_t streamNextBlock;
+    uint32_t streamBlocksRemain;
+    uint32_t streamStartPendingUs;
+
+    uint32_t stallUs;
+    uint32_t stallIntervalBlocks;
+    uint32_t blocksWritten;
+    uint32_t streamsStarted;
+    uint32_t singleWrites;
+} card;
+
+static uint8_t *cardBlock(uint32_t blockIndex)
+{
+    if (!cardBlocks[blockIndex]) {
+        cardBlocks[blockIndex] = calloc(1, CARD_BLOCK_SIZE);
+    }
+    return cardBlocks[blockIndex];
+}
+
+static void cardStartOperation(sdcardBlockOperation_e operation, uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData, uint32_t durationUs)
+{
+    card.busy = true;
+    card.readyAtUs = simulatedTimeUs + durationUs;
+    card.operation = operation;
+    card.blockIndex = blockIndex;
+    card.buffer = buffer;
+    card.callback = callback;
+    card.callbackData = callbackData;
+}
+
+static sdcardOperationStatus_e cardEndStream(void)
+{
+    if (card.streaming) {
+        card.streaming = false;
+        cardStartOperation(SDCARD_BLOCK_OPERATION_ERASE, 0, NULL, NULL, 0, CARD_STREAM_STOP_US);
+        return SDCARD_OPERATION_BUSY;
+    }
+    return SDCARD_OPERATION_SUCCESS;
+}
+
+void sdcard_init(bool useDMA) { UNUSED(useDMA); }
+bool sdcard_isInserted(void) { return true; }
+bool sdcard_isInitialized(void) { return true; }
+bool sdcard_isFunctional(void) { return true; }
+const sdcardMetadata_t* sdcard_getMetadata(void) { return &cardMetadata; }
+void sdcard_setProfilerCallback(sdcard_profilerCallback_c callback) { UNUSED(callback); }
+
+bool sdcard_poll(void)
+{
+    if (card.busy && (int32_t)(simulatedTimeUs - card.readyAtUs) >= 0) {
+        card.busy = false;
+        if (card.operation == SDCARD_BLOCK_OPERATION_READ) {
+            memcpy(card.buffer, cardBlock(card.blockIndex), CARD_BLOCK_SIZE);
+        } else if (card.operation == SDCARD_BLOCK_OPERATION_WRITE) {
+            memcpy(cardBlock(card.blockIndex), card.buffer, CARD_BLOCK_SIZE);
+        }
+        if (card.callback) {
+            card.callback(card.operation, card.blockIndex, card.buffer, card.callbackData);
+        }
+    }
+    return !card.busy;
+}
+
+bool sdcard_readBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (card.busy || cardEndStream() != SDCARD_OPERATION_SUCCESS) {
+        return false;
+    }
+    cardStartOperation(SDCARD_BLOCK_OPERATION_READ, blockIndex, buffer, callback, callbackData, CARD_READ_US);
+    return true;
+}
+
+sdcardOperationStatus_e sdcard_beginWriteBlocks(uint32_t blockIndex, uint32_t blockCount)
+{
+    if (card.busy) {
+        return SDCARD_OPERATION_BUSY;
+    }
+    if (card.streaming) {
+        if (blockIndex == card.streamNextBlock) {
+            return SDCARD_OPERATION_SUCCESS;
+        }
+        return cardEndStream();
+    }
+    card.streaming = true;
+    card.streamNextBlock = blockIndex;
+    card.streamBlocksRemain = blockCount;
+    card.streamStartPendingUs = CARD_STREAM_START_US;
+    card.streamsStarted++;
+    return SDCARD_OPERATION_SUCCESS;
+}
+
+sdcardOperationStatus_e sdcard_writeBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (card.busy) {
+        return SDCARD_OPERATION_BUSY;
+    }
+
+    uint32_t durationUs;
+    if (card.streaming) {
+        if (blockIndex != card.streamNextBlock) {
+            return cardEndStream();
+        }
+        durationUs = card.streamStartPendingUs + CARD_STREAM_WRITE_US;
+        card.streamStartPendingUs = 0;
+        card.streamNextBlock++;
+        if (--card.streamBlocksRemain == 0) {
+            card.streaming = false;
+            durationUs += CARD_STREAM_STOP_US;
+        }
+    } else {
+        durationUs = CARD_SINGLE_WRITE_US;
+        card.singleWrites++;
+    }
+
+    if (card.stallIntervalBlocks && ++card.blocksWritten % card.stallIntervalBlocks == 0) {
+        durationUs += card.stallUs;
+    }
+
+    cardStartOperation(SDCARD_BLOCK_OPERATION_WRITE, blockIndex, buffer, callback, callbackData, durationUs);
+    return SDCARD_OPERATION_IN_PROGRESS;
+}
+
+static void put16(uint8_t *p, uint16_t value) { p[0] = value; p[1] = value >> 8; }
+static void put32(uint8_t *p, uint32_t value) { put16(p, value); put16(p + 2, value >> 16); }
+
+static void cardFormat(void)
+{
+    uint8_t *mbr = cardBlock(0);
+    mbrPartitionEntry_t partition = { .type = MBR_PARTITION_TYPE_FAT32_LBA, .lbaBegin = CARD_PARTITION_START, .numSectors = CARD_VOLUME_SECTORS };
+    memcpy(mbr + 446, &partition, sizeof(partition));
+    mbr[510] = 0x55;
+    mbr[511] = 0xAA;
+
+    fatVolumeID_t volume = {
+        .bytesPerSector = 512,
+        .sectorsPerCluster = CARD_SECTORS_PER_CLUSTER,
+        .reservedSectorCount = CARD_RESERVED_SECTORS,
+        .numFATs = 2,
+        .media = 0xF8,
+        .totalSectors32 = CARD_VOLUME_SECTORS,
+        .fatDescriptor.fat32 = { .FATSize32 = CARD_FAT_SECTORS, .rootCluster = 2, .bootSignature = 0x29 },
+    };
+    uint8_t *volumeSector = cardBlock(CARD_PARTITION_START);
+    memcpy(volumeSector, &volume, sizeof(volume));
+    volumeSector[510] = FAT_VOLUME_ID_SIGNATURE_1;
+    volumeSector[511] = FAT_VOLUME_ID_SIGNATURE_2;
+
+    // Clusters 0 and 1 are reserved, cluster 2 is the one cluster root directory
+    for (int fat = 0; fat < 2; fat++) {
+        uint8_t *fatSector = cardBlock(CARD_PARTITION_START + CARD_RESERVED_SECTORS + fat * CARD_FAT_SECTORS);
+        put32(fatSector + 0, 0x0FFFFFF8);
+        put32(fatSector + 4, 0x0FFFFFFF);
+        put32(fatSector + 8, 0x0FFFFFFF);
+    }
+}
+
+static void pollUntil(bool *done, uint32_t timeoutUs)
+{
+    const uint32_t startUs = simulatedTimeUs;
+    while (!*done && simulatedTimeUs - startUs < timeoutUs) {
+        afatfs_poll();
+        simulatedTimeUs += 10;
+    }
+}
+
+static afatfsFilePtr_t logFile;
+static bool logFileOpened;
+
+static void logFileCreated(afatfsFilePtr_t file)
+{
+    logFile = file;
+    logFileOpened = true;
+}
+
+static uint8_t blackboxBuffer[BENCHMARK_BLACKBOX_BUFFER_SIZE];
+static uint32_t blackboxBufferHead;
+static uint32_t blackboxBufferTail;
+
+static uint32_t blackboxBufferUsed(void)
+{
+    return (blackboxBufferHead - blackboxBufferTail) & (BENCHMARK_BLACKBOX_BUFFER_SIZE - 1);
+}
+
+int main(int argc, char *argv[])
+{
+    const int seconds = argc > 1 ? atoi(argv[1]) : BENCHMARK_DEFAULT_SECONDS;
+    card.stallUs = (argc > 2 ? atoi(argv[2]) : BENCHMARK_DEFAULT_STALL_MS) * 1000;
+    card.stallIntervalBlocks = (argc > 3 ? atoi(argv[3]) : BENCHMARK_DEFAULT_STALL_INTERVAL_KB) * 2;
+
+    cardFormat();
+
+    afatfs_init();
+    while (afatfs_getFilesystemState() == AFATFS_FILESYSTEM_STATE_INITIALIZATION && simulatedTimeUs < 60000000) {
+        afatfs_poll();
+        simulatedTimeUs += 10;
+    }
+    if (afatfs_getFilesystemState() != AFATFS_FILESYSTEM_STATE_READY) {
+        fprintf(stderr, "filesystem did not come up, error %d\n", afatfs_getLastError());
+        return 1;
+    }
+
+    afatfs_fopen("LOG00001.BFL", "as", logFileCreated);
+    pollUntil(&logFileOpened, 10000000);
+    if (!logFile) {
+        fprintf(stderr, "cannot create the log file\n");
+        return 1;
+    }
+
+    // Blocks written while formatting and opening don't count
+    card.blocksWritten = 0;
+    card.streamsStarted = 0;
+    card.singleWrites = 0;
+
+    const int loops = seconds * (1000000 / BENCHMARK_LOOPTIME_US);
+    uint64_t bytesLogged = 0;
+    uint32_t framesDropped = 0;
+    uint32_t maxBufferUsed = 0;
+    uint8_t frame[BENCHMARK_I_FRAME_BYTES];
+
+    for (int loop = 0; loop < loops; loop++) {
+        afatfs_poll();
+
+        const uint32_t frameBytes = loop % BENCHMARK_I_INTERVAL == 0 ? BENCHMARK_I_FRAME_BYTES : BENCHMARK_P_FRAME_BYTES;
+        if (blackboxBufferUsed() + frameBytes < BENCHMARK_BLACKBOX_BUFFER_SIZE) {
+            memset(frame, loop, frameBytes);
+            for (uint32_t i = 0; i < frameBytes; i++) {
+                blackboxBuffer[blackboxBufferHead] = frame[i];
+                blackboxBufferHead = (blackboxBufferHead + 1) & (BENCHMARK_BLACKBOX_BUFFER_SIZE - 1);
+            }
+            bytesLogged += frameBytes;
+        } else {
+            framesDropped++;
+        }
+
+        while (blackboxBufferTail != blackboxBufferHead) {
+            const uint32_t chunkEnd = blackboxBufferHead > blackboxBufferTail ? blackboxBufferHead : BENCHMARK_BLACKBOX_BUFFER_SIZE;
+            const uint32_t written = afatfs_fwrite(logFile, &blackboxBuffer[blackboxBufferTail], chunkEnd - blackboxBufferTail);
+            if (written == 0) {
+                break;
+            }
+            blackboxBufferTail = (blackboxBufferTail + written) & (BENCHMARK_BLACKBOX_BUFFER_SIZE - 1);
+        }
+        maxBufferUsed = MAX(maxBufferUsed, blackboxBufferUsed());
+
+        simulatedTimeUs += BENCHMARK_LOOPTIME_US;
+    }
+
+    printf("%d s at %d Hz, %d KB card cache, %d ms card stall every %d KB\n", seconds, 1000000 / BENCHMARK_LOOPTIME_US,
+        AFATFS_NUM_CACHE_SECTORS / 2, card.stallUs / 1000, card.stallIntervalBlocks / 2);
+    printf("logged %llu KB, dropped %u of %d frames (%.3f%%)\n", (unsigned long long)(bytesLogged / 1024), framesDropped, loops,
+        100.0 * framesDropped / loops);
+    printf("blocks written %u, multi-block writes started %u, single block writes %u\n", card.blocksWritten, card.streamsStarted,
+        card.singleWrites);
+    printf("peak blackbox buffer use %u of %d bytes\n", maxBufferUsed, BENCHMARK_BLACKBOX_BUFFER_SIZE);
+
+    return framesDropped ? 2 : 0;
+}
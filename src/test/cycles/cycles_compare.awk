@@ -0,0 +1,53 @@
+# Checks the counts printed by the cycle count tests against the baseline, and fails when
+# any grew more than tolerance percent, has no baseline, or no counts were printed at all.
+# A new function or family needs its baseline written with "make cycles_baseline".
+#
+#   awk -v tolerance=5 -f cycles/cycles_compare.awk cycles/cycles_baseline.txt <results> ...
+
+BEGIN {
+    if (tolerance == "") {
+        tolerance = 5
+    }
+}
+
+# the baseline, <family> <function> <count>
+FNR == NR {
+    if ($0 !~ /^#/ && NF == 3) {
+        baseline[$1 " " $2] = $3
+    }
+    next
+}
+
+# the results, cycles <family> <function> <count>
+$1 == "cycles" && NF == 4 {
+    key = $2 " " $3
+    counted++
+    if (!(key in baseline)) {
+        printf("%-4s %-18s %8d          NO BASELINE\n", $2, $3, $4)
+        missing++
+        next
+    }
+    change = baseline[key] ? 100.0 * ($4 - baseline[key]) / baseline[key] : 0
+    status = ""
+    if (change > tolerance) {
+        status = "  REGRESSED"
+        failed++
+    }
+    printf("%-4s %-18s %8d %8d %+6.1f%%%s\n", $2, $3, $4, baseline[key], change, status)
+}
+
+END {
+    if (!counted) {
+        print "no instruction counts in the results"
+        exit 1
+    }
+    if (missing) {
+        printf("%d count(s) have no baseline\n", missing)
+    }
+    if (failed) {
+        printf("%d count(s) grew more than %s%% past the baseline\n", failed, tolerance)
+    }
+    if (missing || failed) {
+        exit 1
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Startup of the cycle count tests on the QEMU mps2 machines. The C library is newlib's
+ * rdimon, so stdio and exit() go to the host through semihosting, and exit() ends QEMU
+ * with the exit code.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCB_CPACR (*(volatile uint32_t *)0xE000ED88)
+
+extern uint32_t _estack;
+extern uint32_t _sbss;
+extern uint32_t _ebss;
+
+extern void initialise_monitor_handles(void);
+extern int main(void);
+
+void Reset_Handler(void);
+
+static void Fault_Handler(void)
+{
+    // a fault in the code under test, fail the run rather than hang it
+    exit(3);
+}
+
+__attribute__((section(".isr_vector"), used))
+static void (* const vectors[16])(void) = {
+    (void (*)(void))&_estack,
+    Reset_Handler,
+    Fault_Handler,      // NMI
+    Fault_Handler,      // HardFault
+    Fault_Handler,      // MemManage
+    Fault_Handler,      // BusFault
+    Fault_Handler,      // UsageFault
+};
+
+void Reset_Handler(void)
+{
+#if defined(__ARM_FP)
+    // full access to the FPU for the hard float families, before anything touches it
+    SCB_CPACR |= (0xF << 20);
+    __asm volatile("dsb\n isb");
+#endif
+
+    memset(&_sbss, 0, (uint8_t *)&_ebss - (uint8_t *)&_sbss);
+
+    initialise_monitor_handles();
+
+    exit(main());
+}
@@ -0,0 +1,496 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Instruction counts of the flight loop functions on a Cortex-M core.
+ *
+ * Built with the compiler flags of one MCU family and run under QEMU with -icount, where the
+ * virtual clock, and so SysTick, advances with each instruction executed. gyroUpdate(),
+ * pidController(), mixTable(), the DSHOT frame encoder of pwmWriteDigital() and the running
+ * blackbox handleBlackbox() are fed the same synthetic gyro and RC trace on every run, and the
+ * mean instructions per call of each is printed as
+ *
+ *   cycles <family> <function> <count>
+ *
+ * for cycles_compare.awk to check against the baseline. QEMU doesn't model pipelines, wait
+ * states or caches, so the counts are instructions rather than cycles, but they are exact and
+ * repeatable, which a regression check needs and a board's cycle counter isn't.
+ *
+ * Built for the host it runs the same, with nanoseconds in place of the counts.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef __arm__
+#include <time.h>
+#endif
+
+#include "platform.h"
+
+#include "build/debug.h"
+#include "build/version.h"
+
+#include "blackbox/blackbox.h"
+#include "blackbox/blackbox_io.h"
+
+#include "common/axis.h"
+#include "common/filter.h"
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "config/config_master.h"
+#include "config/feature.h"
+
+#include "drivers/accgyro.h"
+#include "drivers/accgyro_fake.h"
+#include "drivers/pwm_output.h"
+#include "drivers/serial.h"
+
+#include "fc/fc_main.h"
+#include "fc/rc_controls.h"
+#include "fc/runtime_config.h"
+
+#include "flight/failsafe.h"
+#include "flight/imu.h"
+#include "flight/mixer.h"
+#include "flight/navigation.h"
+#include "flight/pid.h"
+#include "flight/servos.h"
+
+#include "io/beeper.h"
+#include "io/gps.h"
+#include "io/motors.h"
+#include "io/serial.h"
+
+#include "msp/msp_serial.h"
+
+#include "rx/rx.h"
+
+#include "sensors/acceleration.h"
+#include "sensors/barometer.h"
+#include "sensors/battery.h"
+#include "sensors/boardalignment.h"
+#include "sensors/compass.h"
+#include "sensors/gyro.h"
+#include "sensors/sensors.h"
+
+#ifndef CYCLES_FAMILY
+#define CYCLES_FAMILY "host"
+#endif
+
+#define CYCLES_LOOPTIME_US 125              // 8kHz gyro and PID loop
+#define CYCLES_SAMPLES 1000
+#define CYCLES_WARMUP_LOOPS 2000            // settles the filters and sends the blackbox header
+#define CYCLES_LOOPS 4000
+#define CYCLES_RC_RATE_DPS 670.0f           // setpoint at full stick deflection
+#define CYCLES_CALIBRATION_LOOPS 100000
+
+typedef struct cyclesSample_s {
+    int16_t gyro[XYZ_AXIS_COUNT];
+    int16_t rc[4];                          // roll, pitch, yaw, throttle
+} cyclesSample_t;
+
+typedef enum {
+    CYCLES_GYRO_UPDATE = 0,
+    CYCLES_PID_CONTROLLER,
+    CYCLES_MIX_TABLE,
+#ifdef USE_DSHOT
+    CYCLES_DSHOT_ENCODE_FRAME,
+#endif
+    CYCLES_HANDLE_BLACKBOX,
+    CYCLES_COUNT
+} cyclesFunction_e;
+
+static const char * const cyclesNames[CYCLES_COUNT] = {
+    [CYCLES_GYRO_UPDATE] = "gyroUpdate",
+    [CYCLES_PID_CONTROLLER] = "pidController",
+    [CYCLES_MIX_TABLE] = "mixTable",
+#ifdef USE_DSHOT
+    [CYCLES_DSHOT_ENCODE_FRAME] = "dshotEncodeFrame",
+#endif
+    [CYCLES_HANDLE_BLACKBOX] = "handleBlackbox",
+};
+
+static uint64_t cyclesTicks[CYCLES_COUNT];
+static bool cyclesMeasuring;
+
+static cyclesSample_t trace[CYCLES_SAMPLES];
+
+static timeUs_t simulatedTimeUs;
+
+static pidProfile_t pidProfile;
+static rollAndPitchTrims_t accelerometerTrims;
+
+#ifdef USE_DSHOT
+static motorDmaOutput_t dshotMotors[4];
+static uint32_t dshotBuffer[MOTOR_DMA_BUFFER_SIZE * 4];
+#endif
+
+#ifdef __arm__
+
+// SysTick, counting down the core clock, which QEMU's -icount ties to instructions
+#define SYST_CSR (*(volatile uint32_t *)0xE000E010)
+#define SYST_RVR (*(volatile uint32_t *)0xE000E014)
+#define SYST_CVR (*(volatile uint32_t *)0xE000E018)
+#define SCB_CPACR (*(volatile uint32_t *)0xE000ED88)
+
+#define SYST_CSR_ENABLE (1 << 0)
+#define SYST_CSR_CLKSOURCE (1 << 2)
+#define SYST_MASK 0x00FFFFFF
+
+static float instructionsPerTick;
+
+static uint32_t readTicks(void)
+{
+    // count up, so intervals are end - start like on the host
+    return SYST_MASK - SYST_CVR;
+}
+
+static uint32_t ticksBetween(uint32_t start, uint32_t end)
+{
+    return (end - start) & SYST_MASK;
+}
+
+static void __attribute__((noinline)) calibrationLoop(uint32_t loops)
+{
+    // two instructions an iteration
+    __asm volatile(
+        "1: subs %0, %0, #1 \n"
+        "   bne 1b \n"
+        : "+r" (loops) : : "cc");
+}
+
+static void cyclesTimerInit(void)
+{
+    SYST_RVR = SYST_MASK;
+    SYST_CVR = 0;
+    SYST_CSR = SYST_CSR_CLKSOURCE | SYST_CSR_ENABLE;
+
+    // the SysTick clock of the machine, relative to the instruction clock of -icount
+    const uint32_t start = readTicks();
+    calibrationLoop(CYCLES_CALIBRATION_LOOPS);
+    const uint32_t ticks = ticksBetween(start, readTicks());
+    instructionsPerTick = 2.0f * CYCLES_CALIBRATION_LOOPS / ticks;
+}
+
+static float ticksToCount(float ticks)
+{
+    return ticks * instructionsPerTick;
+}
+
+#else
+
+static uint32_t readTicks(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t ticksBetween(uint32_t start, uint32_t end)
+{
+    return end - start;
+}
+
+static void cyclesTimerInit(void)
+{
+}
+
+static float ticksToCount(float ticks)
+{
+    return ticks;
+}
+
+#endif
+
+#define CYCLES_CALL(function, call) do { \
+        const uint32_t start = readTicks(); \
+        call; \
+        const uint32_t ticks = ticksBetween(start, readTicks()); \
+        if (cyclesMeasuring) { \
+            cyclesTicks[function] += ticks; \
+        } \
+    } while (0)
+
+// Flight loop and blackbox stubs
+
+int16_t debug[DEBUG16_VALUE_COUNT];
+uint8_t debugMode;
+uint8_t armingFlags;
+uint8_t stateFlags;
+uint16_t flightModeFlags;
+int16_t rcCommand[4];
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+uint32_t rcModeActivationMask;
+attitudeEulerAngles_t attitude;
+uint8_t detectedSensors[SENSOR_INDEX_COUNT];
+int16_t GPS_angle[ANGLE_INDEX_COUNT];
+int32_t GPS_home[2];
+int32_t GPS_coord[2];
+uint8_t GPS_numSat;
+uint16_t GPS_altitude;
+uint16_t GPS_speed;
+uint16_t GPS_ground_course;
+int16_t servo[MAX_SUPPORTED_SERVOS];
+uint16_t rssi;
+uint16_t vbatLatest = 168;
+uint16_t amperageLatest;
+acc_t acc;
+mag_t mag;
+baro_t baro;
+
+master_t masterConfig;
+profile_t *currentProfile;
+
+const char * const targetName = "CYCLES";
+const char * const shortGitRevision = "0000000";
+const char * const buildDate = "Jan 01 2017";
+const char * const buildTime = "00:00:00";
+
+static serialPort_t blackboxSerialPort;
+static serialPortConfig_t blackboxSerialPortConfig = { .identifier = SERIAL_PORT_USART1, .functionMask = FUNCTION_BLACKBOX, .blackbox_baudrateIndex = BAUD_115200 };
+const uint32_t baudRates[] = {0, 9600, 19200, 38400, 57600, 115200, 230400, 250000, 400000, 460800, 500000, 921600, 1000000, 1500000, 2000000, 2470000};
+
+uint32_t micros(void) { return simulatedTimeUs; }
+uint32_t millis(void) { return simulatedTimeUs / 1000; }
+void delay(uint32_t ms) { simulatedTimeUs += ms * 1000; }
+void delayMicroseconds(uint32_t us) { simulatedTimeUs += us; }
+
+void sensorsSet(uint32_t mask) { UNUSED(mask); }
+bool sensors(uint32_t mask) { UNUSED(mask); return false; }
+bool feature(uint32_t mask) { return mask == FEATURE_BLACKBOX; }
+void beeper(beeperMode_e mode) { UNUSED(mode); }
+uint32_t getArmingBeepTimeMicros(void) { return 0; }
+bool failsafeIsActive(void) { return false; }
+failsafePhase_e failsafePhase(void) { return FAILSAFE_IDLE; }
+bool isAirmodeActive(void) { return false; }
+bool isModeActivationConditionPresent(modeActivationCondition_t *modeActivationConditions, boxId_e modeId) { UNUSED(modeActivationConditions); UNUSED(modeId); return false; }
+bool rxIsReceivingSignal(void) { return true; }
+bool rxAreFlightChannelsValid(void) { return true; }
+float calculateVbatPidCompensation(void) { return 1.0f; }
+float getThrottlePIDAttenuation(void) { return 1.0f; }
+float getSetpointRate(int axis) { return rcCommand[axis] * CYCLES_RC_RATE_DPS / 500.0f; }
+float getSetpointRateDerivative(int axis) { UNUSED(axis); return 0.0f; }
+float getRcDeflection(int axis) { return rcCommand[axis] / 500.0f; }
+float getRcDeflectionAbs(int axis) { return ABS(rcCommand[axis]) / 500.0f; }
+
+bool pwmAreMotorsEnabled(void) { return true; }
+void pwmWriteMotor(uint8_t index, uint16_t value) { UNUSED(index); UNUSED(value); }
+void pwmCompleteMotorUpdate(uint8_t motorCount) { UNUSED(motorCount); }
+void pwmShutdownPulsesForAllMotors(uint8_t motorCount) { UNUSED(motorCount); }
+
+// the blackbox writes to a serial port that takes everything at once
+serialPortConfig_t *findSerialPortConfig(serialPortFunction_e function) { UNUSED(function); return &blackboxSerialPortConfig; }
+serialPort_t *findSharedSerialPort(uint16_t functionMask, serialPortFunction_e sharedWithFunction) { UNUSED(functionMask); UNUSED(sharedWithFunction); return NULL; }
+portSharing_e determinePortSharing(serialPortConfig_t *portConfig, serialPortFunction_e function) { UNUSED(portConfig); UNUSED(function); return PORTSHARING_NOT_SHARED; }
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr callback, uint32_t baudrate, portMode_t mode, portOptions_t options)
+{
+    UNUSED(identifier); UNUSED(function); UNUSED(callback); UNUSED(mode); UNUSED(options);
+    blackboxSerialPort.baudRate = baudrate;
+    return &blackboxSerialPort;
+}
+void closeSerialPort(serialPort_t *serialPort) { UNUSED(serialPort); }
+void mspSerialAllocatePorts(void) {}
+uint32_t serialTxBytesFree(const serialPort_t *instance) { UNUSED(instance); return 1024; }
+void serialWrite(serialPort_t *instance, uint8_t ch) { UNUSED(instance); UNUSED(ch); }
+void serialWriteBuf(serialPort_t *instance, const uint8_t *data, int count) { UNUSED(instance); UNUSED(data); UNUSED(count); }
+bool isSerialTransmitBufferEmpty(const serialPort_t *instance) { UNUSED(instance); return true; }
+
+// Canned inputs, the same on every run and every family
+
+static int16_t synthNoise(void)
+{
+    static uint32_t seed = 12345;
+    seed = seed * 1103515245 + 12345;
+    return (int16_t)((seed >> 16) % 21) - 10;
+}
+
+static void generateTrace(void)
+{
+    for (int i = 0; i < CYCLES_SAMPLES; i++) {
+        const float t = i * CYCLES_LOOPTIME_US * 1e-6f;
+        // stick movements, following on the gyro, plus motor noise around 230Hz
+        const float stick[3] = { sin_approx(2 * M_PIf * 7.0f * t), sin_approx(2 * M_PIf * 11.0f * t), 0.3f * sin_approx(2 * M_PIf * 4.0f * t) };
+        const float motorNoise = 30.0f * sin_approx(2 * M_PIf * 230.0f * t);
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            trace[i].gyro[axis] = lrintf(stick[axis] * 300.0f + motorNoise) + synthNoise();
+            trace[i].rc[axis] = 1500 + lrintf(stick[axis] * 300.0f);
+        }
+        trace[i].rc[THROTTLE] = 1400 + lrintf(200.0f * sin_approx(2 * M_PIf * 5.0f * t));
+    }
+}
+
+// Setup, following the defaults in fc/config.c
+
+static void cyclesInit(void)
+{
+    static profile_t profile;
+    currentProfile = &profile;
+
+    gyroConfig_t *gyroConfig = &masterConfig.gyroConfig;
+    gyroConfig->gyro_sync_denom = 1;
+    gyroConfig->gyro_lpf = GYRO_LPF_256HZ;
+    gyroConfig->gyro_soft_lpf_type = FILTER_PT1;
+    gyroConfig->gyro_soft_lpf_hz = 90;
+    gyroConfig->gyro_soft_notch_hz_1 = 400;
+    gyroConfig->gyro_soft_notch_cutoff_1 = 300;
+    gyroConfig->gyro_soft_notch_hz_2 = 200;
+    gyroConfig->gyro_soft_notch_cutoff_2 = 100;
+
+    motorConfig_t *motorConfig = &masterConfig.motorConfig;
+    motorConfig->minthrottle = 1070;
+    motorConfig->maxthrottle = 2000;
+    motorConfig->mincommand = 1000;
+    motorConfig->motorPwmProtocol = PWM_TYPE_DSHOT600;
+
+    flight3DConfig_t *flight3DConfig = &masterConfig.flight3DConfig;
+    flight3DConfig->deadband3d_low = 1406;
+    flight3DConfig->deadband3d_high = 1514;
+    flight3DConfig->neutral3d = 1460;
+    flight3DConfig->deadband3d_throttle = 50;
+
+    masterConfig.mixerConfig.mixerMode = MIXER_QUADX;
+    masterConfig.mixerConfig.yaw_motor_direction = 1;
+    masterConfig.airplaneConfig.fixedwing_althold_dir = 1;
+    masterConfig.rxConfig.mincheck = 1100;
+    masterConfig.rxConfig.maxcheck = 1900;
+    masterConfig.rxConfig.midrc = 1500;
+
+    blackboxConfig_t *blackboxConfig = &masterConfig.blackboxConfig;
+    blackboxConfig->device = BLACKBOX_DEVICE_SERIAL;
+    blackboxConfig->rate_num = 1;
+    blackboxConfig->rate_denom = 1;
+
+    gyroInit(gyroConfig);
+
+    const uint8_t p[3] = { 43, 58, 70 }, i[3] = { 40, 50, 45 }, d[3] = { 20, 22, 20 };
+    for (int axis = 0; axis < 3; axis++) {
+        pidProfile.P8[axis] = p[axis];
+        pidProfile.I8[axis] = i[axis];
+        pidProfile.D8[axis] = d[axis];
+    }
+    pidProfile.yaw_p_limit = YAW_P_LIMIT_MAX;
+    pidProfile.pidSumLimit = PIDSUM_LIMIT;
+    pidProfile.rollPitchItermIgnoreRate = 200;
+    pidProfile.yawItermIgnoreRate = 55;
+    pidProfile.dterm_filter_type = FILTER_BIQUAD;
+    pidProfile.dterm_lpf_hz = 100;
+    pidProfile.dterm_notch_hz = 260;
+    pidProfile.dterm_notch_cutoff = 160;
+    pidProfile.pidAtMinThrottle = PID_STABILISATION_ON;
+    pidProfile.levelAngleLimit = 70.0f;
+    pidProfile.setpointRelaxRatio = 30;
+    pidProfile.dtermSetpointWeight = 200;
+    pidProfile.yawRateAccelLimit = 10.0f;
+    pidProfile.rateAccelLimit = 0.0f;
+    pidProfile.itermThrottleThreshold = 350;
+    pidProfile.levelSensitivity = 100.0f;
+    pidSetTargetLooptime(CYCLES_LOOPTIME_US);
+    pidInitFilters(&pidProfile);
+    pidInitConfig(&pidProfile);
+    pidStabilisationState(PID_STABILISATION_ON);
+
+    mixerUseConfigs(flight3DConfig, motorConfig, &masterConfig.mixerConfig, &masterConfig.airplaneConfig, &masterConfig.rxConfig);
+    mixerInit(MIXER_QUADX, NULL);
+    mixerConfigureOutput();
+
+#ifdef USE_DSHOT
+    // the F4 600kHz compare values, the encoder only copies them
+    dshotEncoderInit(26, 53);
+    for (int i = 0; i < 4; i++) {
+        dshotMotors[i].encodedPacket = DSHOT_PACKET_NONE;
+    }
+#endif
+
+    ENABLE_ARMING_FLAG(ARMED);
+
+    initBlackbox();
+    startBlackbox();
+}
+
+static void cyclesLoop(int index)
+{
+    const cyclesSample_t *sample = &trace[index % CYCLES_SAMPLES];
+
+    fakeGyroSet(sample->gyro[X], sample->gyro[Y], sample->gyro[Z]);
+    for (int axis = ROLL; axis <= YAW; axis++) {
+        rcData[axis] = sample->rc[axis];
+        rcCommand[axis] = sample->rc[axis] - 1500;
+    }
+    rcData[THROTTLE] = sample->rc[THROTTLE];
+    rcCommand[THROTTLE] = sample->rc[THROTTLE];
+
+    CYCLES_CALL(CYCLES_GYRO_UPDATE, gyroUpdate());
+    CYCLES_CALL(CYCLES_PID_CONTROLLER, pidController(&pidProfile, &accelerometerTrims));
+    CYCLES_CALL(CYCLES_MIX_TABLE, mixTable(&pidProfile));
+
+#ifdef USE_DSHOT
+    // what pwmWriteDigital() does for each motor besides starting the DMA, into one burst buffer
+    for (int i = 0; i < 4; i++) {
+        CYCLES_CALL(CYCLES_DSHOT_ENCODE_FRAME, dshotEncodeFrame(&dshotMotors[i], &dshotBuffer[i], 4, motor[i], false));
+    }
+#endif
+
+    CYCLES_CALL(CYCLES_HANDLE_BLACKBOX, handleBlackbox(simulatedTimeUs));
+
+    simulatedTimeUs += CYCLES_LOOPTIME_US;
+}
+
+int main(void)
+{
+    cyclesTimerInit();
+    generateTrace();
+    cyclesInit();
+
+    for (int i = 0; i < CYCLES_WARMUP_LOOPS; i++) {
+        cyclesLoop(i);
+    }
+    if (blackboxMayEditConfig()) {
+        // the log didn't start, the counts would be of the wrong state
+        printf("cycles: blackbox not running\n");
+        return 1;
+    }
+
+    // the cost of the measurement itself, taken off every call
+    uint64_t overheadTicks = 0;
+    for (int i = 0; i < CYCLES_LOOPS; i++) {
+        const uint32_t start = readTicks();
+        overheadTicks += ticksBetween(start, readTicks());
+    }
+    const float overhead = (float)overheadTicks / CYCLES_LOOPS;
+
+    cyclesMeasuring = true;
+    for (int i = 0; i < CYCLES_LOOPS; i++) {
+        cyclesLoop(CYCLES_WARMUP_LOOPS + i);
+    }
+
+    for (int i = 0; i < CYCLES_COUNT; i++) {
+#ifdef USE_DSHOT
+        const int calls = i == CYCLES_DSHOT_ENCODE_FRAME ? CYCLES_LOOPS * 4 : CYCLES_LOOPS;
+#else
+        const int calls = CYCLES_LOOPS;
+#endif
+        const float count = ticksToCount((float)cyclesTicks[i] / calls - overhead);
+        printf("cycles %s %s %ld\n", CYCLES_FAMILY, cyclesNames[i], lrintf(MAX(count, 0.0f)));
+    }
+    return 0;
+}
@@ -266,3 +266,48 @@ TEST(AlignSensorTest, ClockwiseTwoSeventyDegreesFlip)
     testCWFlip(CW270_DEG_FLIP, 270);
 }
 
+
+TEST(AlignSensorTest, ScaledAlignmentMatchesRotation)
+{
+    const float scale = 1.0f / 16.4f;
+
+    for (int rotation = CW0_DEG; rotation <= CW270_DEG_FLIP; rotation++) {
+        int32_t src[XYZ_AXIS_COUNT] = { rand() % 5000, rand() % 5000, rand() % 5000 };
+        int32_t test[XYZ_AXIS_COUNT] = { src[X], src[Y], src[Z] };
+        alignSensors(test, rotation);
+
+        sensorAlignment_t alignment;
+        sensorAlignmentInit(&alignment, rotation, scale);
+        float dest[XYZ_AXIS_COUNT];
+        sensorAlignmentApply(&alignment, src, dest);
+
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            EXPECT_FLOAT_EQ(test[axis] * scale, dest[axis]) << "rotation " << rotation << " axis " << axis;
+        }
+    }
+}
+
+// runs last, the board alignment can't be set back to standard
+TEST(AlignSensorTest, BoardAlignmentFoldedIntoSensorAlignment)
+{
+    const boardAlignment_t boardAlignment = { .rollDegrees = 0, .pitchDegrees = 0, .yawDegrees = 90 };
+    initBoardAlignment(&boardAlignment);
+
+    int32_t src[XYZ_AXIS_COUNT] = { 100, -200, 300 };
+
+    // sensor rotation first, then the board rotation on its own
+    int32_t matrix[3][3];
+    initZAxisRotation(matrix, 90);
+    int32_t test[XYZ_AXIS_COUNT];
+    rotateVector(matrix, src, test);
+    alignSensors(test, CW0_DEG);
+
+    sensorAlignment_t alignment;
+    sensorAlignmentInit(&alignment, CW90_DEG, 2.0f);
+    float dest[XYZ_AXIS_COUNT];
+    sensorAlignmentApply(&alignment, src, dest);
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        EXPECT_NEAR(test[axis] * 2.0f, dest[axis], 1e-3f) << "axis " << axis;
+    }
+}
@@ -0,0 +1,189 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+    #include "blackbox/blackbox_compress.h"
+    #include "blackbox/blackbox_encoding.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// Compress `data` in blocks, decode it again and return the compressed size
+static size_t roundTrip(const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> compressed;
+    uint8_t block[BLACKBOX_COMPRESSED_BLOCK_MAX_SIZE(BLACKBOX_COMPRESS_BLOCK_SIZE)];
+
+    for (size_t pos = 0; pos < data.size(); pos += BLACKBOX_COMPRESS_BLOCK_SIZE) {
+        const int len = std::min<size_t>(BLACKBOX_COMPRESS_BLOCK_SIZE, data.size() - pos);
+        const int blockSize = blackboxCompressBlock(&data[pos], len, block);
+
+        EXPECT_LE(blockSize, BLACKBOX_COMPRESSED_BLOCK_MAX_SIZE(len));
+        compressed.insert(compressed.end(), block, block + blockSize);
+    }
+
+    std::vector<uint8_t> decoded;
+    uint8_t out[BLACKBOX_COMPRESS_BLOCK_SIZE];
+
+    for (size_t pos = 0; pos < compressed.size();) {
+        int consumed = 0;
+        const int len = blackboxDecompressBlock(&compressed[pos], compressed.size() - pos, out, sizeof(out), &consumed);
+
+        EXPECT_GT(len, 0);
+        if (len <= 0) {
+            break;
+        }
+        decoded.insert(decoded.end(), out, out + len);
+        pos += consumed;
+    }
+
+    EXPECT_EQ(data, decoded);
+
+    return compressed.size();
+}
+
+TEST(BlackboxCompressTest, SingleByte)
+{
+    roundTrip(std::vector<uint8_t>(1, 0x42));
+}
+
+TEST(BlackboxCompressTest, SingleSymbolBlock)
+{
+    const std::vector<uint8_t> data(BLACKBOX_COMPRESS_BLOCK_SIZE, 0);
+
+    EXPECT_LT(roundTrip(data), data.size() / 4);
+}
+
+TEST(BlackboxCompressTest, RandomDataIsStored)
+{
+    std::vector<uint8_t> data(3 * BLACKBOX_COMPRESS_BLOCK_SIZE + 100);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = rand();
+    }
+
+    EXPECT_EQ(data.size() + 4 * BLACKBOX_COMPRESS_BLOCK_HEADER_SIZE, roundTrip(data));
+}
+
+TEST(BlackboxCompressTest, SkewedDataNeedsLengthLimit)
+{
+    // Fibonacci-like frequencies force a very deep tree before the lengths are limited
+    std::vector<uint8_t> data;
+    uint32_t a = 1, b = 1;
+    for (int symbol = 0; symbol < 24 && data.size() < BLACKBOX_COMPRESS_BLOCK_SIZE; symbol++) {
+        for (uint32_t i = 0; i < a && data.size() < BLACKBOX_COMPRESS_BLOCK_SIZE; i++) {
+            data.push_back(symbol);
+        }
+        const uint32_t next = a + b;
+        a = b;
+        b = next;
+    }
+
+    roundTrip(data);
+}
+
+TEST(BlackboxCompressTest, CorruptBlockIsRejected)
+{
+    uint8_t data[64];
+    for (unsigned i = 0; i < sizeof(data); i++) {
+        data[i] = i % 5;
+    }
+
+    uint8_t block[BLACKBOX_COMPRESSED_BLOCK_MAX_SIZE(sizeof(data))];
+    const int blockSize = blackboxCompressBlock(data, sizeof(data), block);
+
+    uint8_t out[sizeof(data)];
+    int consumed;
+
+    EXPECT_EQ(-1, blackboxDecompressBlock(block, blockSize - 1, out, sizeof(out), &consumed));
+    EXPECT_EQ(-1, blackboxDecompressBlock(block, blockSize, out, sizeof(out) - 1, &consumed));
+}
+
+/*
+ * A stream of P-frames shaped like the main frame, encoded with the real field encoders: slowly changing PID terms
+ * and RC, a noisy gyro with a few hundred Hz of motor vibration, and motors following the gyro.
+ */
+TEST(BlackboxCompressTest, FrameStreamRatio)
+{
+    std::vector<uint8_t> stream;
+    uint8_t buf[64];
+    double phase = 0;
+    int32_t previousGyro[3] = { 0, 0, 0 };
+
+    for (int frame = 0; frame < 8000; frame++) {
+        uint8_t *end = buf;
+        int32_t values[8];
+
+        *end++ = 'P';
+        end = blackboxEncodeSignedVB(end, rand() % 3 - 1);              // time, second order difference
+
+        for (int i = 0; i < 3; i++) {
+            values[i] = rand() % 41 - 20;
+        }
+        for (int i = 0; i < 3; i++) {
+            end = blackboxEncodeSignedVB(end, values[i]);               // axisP
+        }
+        for (int i = 0; i < 3; i++) {
+            values[i] = rand() % 5 - 2;
+        }
+        end = blackboxEncodeTag2_3S32(end, values);                     // axisI
+        for (int i = 0; i < 3; i++) {
+            end = blackboxEncodeSignedVB(end, rand() % 61 - 30);        // axisD
+        }
+        for (int i = 0; i < 4; i++) {
+            values[i] = rand() % 8 == 0 ? rand() % 7 - 3 : 0;
+        }
+        end = blackboxEncodeTag8_4S16(end, values);                     // rcCommand
+
+        values[0] = rand() % 50 == 0 ? 1 : 0;
+        values[1] = 0;
+        end = blackboxEncodeTag8_8SVB(end, values, 2);                  // vbat, rssi
+
+        phase += 0.3;
+        for (int i = 0; i < 3; i++) {
+            const int32_t gyro = lrint(40 * sin(phase + i) + rand() % 11 - 5);
+            end = blackboxEncodeSignedVB(end, gyro - previousGyro[i]);  // gyro against the previous average
+            previousGyro[i] = gyro;
+        }
+        for (int i = 0; i < 3; i++) {
+            end = blackboxEncodeSignedVB(end, rand() % 21 - 10);        // acc
+        }
+        for (int i = 0; i < 4; i++) {
+            end = blackboxEncodeSignedVB(end, 0);                       // debug
+        }
+        for (int i = 0; i < 4; i++) {
+            end = blackboxEncodeSignedVB(end, rand() % 31 - 15);        // motors
+        }
+
+        stream.insert(stream.end(), buf, end);
+    }
+
+    const size_t compressedSize = roundTrip(stream);
+
+    printf("blackbox frame stream: %u bytes compressed to %u (%.0f%%)\n",
+        (unsigned)stream.size(), (unsigned)compressedSize, 100.0 * compressedSize / stream.size());
+
+    EXPECT_LT(compressedSize, stream.size() * 3 / 4);
+}
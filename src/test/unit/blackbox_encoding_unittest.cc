@@ -0,0 +1,356 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+extern "C" {
+    #include "blackbox/blackbox_encoding.h"
+    #include "common/encoding.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+/*
+ * Reference copies of the original byte-at-a-time blackbox writers, the log format is defined by what these
+ * produce.
+ */
+static std::vector<uint8_t> refOut;
+
+static void refWrite(uint8_t value)
+{
+    refOut.push_back(value);
+}
+
+static void refWriteUnsignedVB(uint32_t value)
+{
+    while (value > 127) {
+        refWrite((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    refWrite(value);
+}
+
+static void refWriteSignedVB(int32_t value)
+{
+    refWriteUnsignedVB(zigzagEncode(value));
+}
+
+static void refWriteTag2_3S32(const int32_t *values)
+{
+    enum { BITS_2 = 0, BITS_4 = 1, BITS_6 = 2, BITS_32 = 3 };
+    enum { BYTES_1 = 0, BYTES_2 = 1, BYTES_3 = 2, BYTES_4 = 3 };
+
+    int x;
+    int selector = BITS_2, selector2;
+
+    for (x = 0; x < 3; x++) {
+        if (values[x] >= 32 || values[x] < -32) {
+            selector = BITS_32;
+            break;
+        }
+        if (values[x] >= 8 || values[x] < -8) {
+            if (selector < BITS_6) {
+                selector = BITS_6;
+            }
+        } else if (values[x] >= 2 || values[x] < -2) {
+            if (selector < BITS_4) {
+                selector = BITS_4;
+            }
+        }
+    }
+
+    switch (selector) {
+    case BITS_2:
+        refWrite((selector << 6) | ((values[0] & 0x03) << 4) | ((values[1] & 0x03) << 2) | (values[2] & 0x03));
+        break;
+    case BITS_4:
+        refWrite((selector << 6) | (values[0] & 0x0F));
+        refWrite((values[1] << 4) | (values[2] & 0x0F));
+        break;
+    case BITS_6:
+        refWrite((selector << 6) | (values[0] & 0x3F));
+        refWrite((uint8_t)values[1]);
+        refWrite((uint8_t)values[2]);
+        break;
+    case BITS_32:
+        selector2 = 0;
+        for (x = 2; x >= 0; x--) {
+            selector2 <<= 2;
+            if (values[x] < 128 && values[x] >= -128) {
+                selector2 |= BYTES_1;
+            } else if (values[x] < 32768 && values[x] >= -32768) {
+                selector2 |= BYTES_2;
+            } else if (values[x] < 8388608 && values[x] >= -8388608) {
+                selector2 |= BYTES_3;
+            } else {
+                selector2 |= BYTES_4;
+            }
+        }
+        refWrite((selector << 6) | selector2);
+        for (x = 0; x < 3; x++, selector2 >>= 2) {
+            const int bytes = (selector2 & 0x03) + 1;
+            for (int b = 0; b < bytes; b++) {
+                refWrite(values[x] >> (b * 8));
+            }
+        }
+        break;
+    }
+}
+
+static void refWriteTag8_4S16(const int32_t *values)
+{
+    enum { FIELD_ZERO = 0, FIELD_4BIT = 1, FIELD_8BIT = 2, FIELD_16BIT = 3 };
+
+    uint8_t selector = 0, buffer = 0;
+    int nibbleIndex = 0;
+    int x;
+
+    for (x = 3; x >= 0; x--) {
+        selector <<= 2;
+        if (values[x] == 0) {
+            selector |= FIELD_ZERO;
+        } else if (values[x] < 8 && values[x] >= -8) {
+            selector |= FIELD_4BIT;
+        } else if (values[x] < 128 && values[x] >= -128) {
+            selector |= FIELD_8BIT;
+        } else {
+            selector |= FIELD_16BIT;
+        }
+    }
+
+    refWrite(selector);
+
+    for (x = 0; x < 4; x++, selector >>= 2) {
+        switch (selector & 0x03) {
+        case FIELD_ZERO:
+            break;
+        case FIELD_4BIT:
+            if (nibbleIndex == 0) {
+                buffer = values[x] << 4;
+                nibbleIndex = 1;
+            } else {
+                refWrite(buffer | (values[x] & 0x0F));
+                nibbleIndex = 0;
+            }
+            break;
+        case FIELD_8BIT:
+            if (nibbleIndex == 0) {
+                refWrite(values[x]);
+            } else {
+                refWrite(buffer | ((values[x] >> 4) & 0x0F));
+                buffer = values[x] << 4;
+            }
+            break;
+        case FIELD_16BIT:
+            if (nibbleIndex == 0) {
+                refWrite(values[x] >> 8);
+                refWrite(values[x]);
+            } else {
+                refWrite(buffer | ((values[x] >> 12) & 0x0F));
+                refWrite(values[x] >> 4);
+                buffer = values[x] << 4;
+            }
+            break;
+        }
+    }
+    if (nibbleIndex == 1) {
+        refWrite(buffer);
+    }
+}
+
+static void refWriteTag8_8SVB(const int32_t *values, int valueCount)
+{
+    if (valueCount > 0) {
+        if (valueCount == 1) {
+            refWriteSignedVB(values[0]);
+        } else {
+            uint8_t header = 0;
+            for (int i = valueCount - 1; i >= 0; i--) {
+                header <<= 1;
+                if (values[i] != 0) {
+                    header |= 0x01;
+                }
+            }
+            refWrite(header);
+            for (int i = 0; i < valueCount; i++) {
+                if (values[i] != 0) {
+                    refWriteSignedVB(values[i]);
+                }
+            }
+        }
+    }
+}
+
+// Values spread over every field size the encoders distinguish, with the boundaries well represented
+static int32_t randomValue(int maxBits)
+{
+    static const int32_t edges[] = {
+        0, 1, -1, 2, -2, 7, -8, 8, -9, 31, -32, 32, -33, 127, -128, 128, -129,
+        32767, -32768, 32768, -32769, 8388607, -8388608, 8388608, -8388609, INT32_MAX, INT32_MIN
+    };
+
+    int32_t value;
+    if (rand() % 4 == 0) {
+        value = edges[rand() % (sizeof(edges) / sizeof(edges[0]))];
+    } else {
+        const int bits = rand() % 32;
+        value = ((int32_t)(((uint32_t)rand() << 16) ^ rand())) >> (31 - bits);
+    }
+
+    if (maxBits < 32) {
+        // Wrap into the field width the caller can actually produce
+        value = (int32_t)((uint32_t)value << (32 - maxBits)) >> (32 - maxBits);
+    }
+    return value;
+}
+
+static void expectSame(const uint8_t *buf, const uint8_t *end)
+{
+    ASSERT_EQ(refOut.size(), (size_t)(end - buf));
+    for (size_t i = 0; i < refOut.size(); i++) {
+        EXPECT_EQ(refOut[i], buf[i]) << "byte " << i;
+    }
+}
+
+TEST(BlackboxEncodingTest, UnsignedVB)
+{
+    uint8_t buf[BLACKBOX_VB_MAX_BYTES];
+
+    for (int i = 0; i < 10000; i++) {
+        const uint32_t value = (uint32_t)randomValue(32);
+
+        refOut.clear();
+        refWriteUnsignedVB(value);
+        expectSame(buf, blackboxEncodeUnsignedVB(buf, value));
+    }
+}
+
+TEST(BlackboxEncodingTest, SignedVB)
+{
+    uint8_t buf[BLACKBOX_VB_MAX_BYTES];
+
+    for (int i = 0; i < 10000; i++) {
+        const int32_t value = randomValue(32);
+
+        refOut.clear();
+        refWriteSignedVB(value);
+        expectSame(buf, blackboxEncodeSignedVB(buf, value));
+    }
+}
+
+TEST(BlackboxEncodingTest, Tag2_3S32)
+{
+    uint8_t buf[BLACKBOX_TAG2_3S32_MAX_BYTES];
+
+    for (int i = 0; i < 10000; i++) {
+        const int32_t values[3] = { randomValue(32), randomValue(32), randomValue(32) };
+
+        refOut.clear();
+        refWriteTag2_3S32(values);
+        expectSame(buf, blackboxEncodeTag2_3S32(buf, values));
+    }
+}
+
+TEST(BlackboxEncodingTest, Tag8_4S16)
+{
+    uint8_t buf[BLACKBOX_TAG8_4S16_MAX_BYTES];
+
+    for (int i = 0; i < 10000; i++) {
+        // Anything wider than 16 bits is truncated, the same way by both
+        const int32_t values[4] = { randomValue(32), randomValue(32), randomValue(32), randomValue(32) };
+
+        refOut.clear();
+        refWriteTag8_4S16(values);
+        expectSame(buf, blackboxEncodeTag8_4S16(buf, values));
+    }
+}
+
+TEST(BlackboxEncodingTest, Tag8_8SVB)
+{
+    uint8_t buf[BLACKBOX_TAG8_8SVB_MAX_BYTES];
+
+    for (int i = 0; i < 10000; i++) {
+        const int count = rand() % 9;
+        int32_t values[8];
+        for (int j = 0; j < 8; j++) {
+            values[j] = rand() % 2 ? 0 : randomValue(32);
+        }
+
+        refOut.clear();
+        refWriteTag8_8SVB(values, count);
+        expectSame(buf, blackboxEncodeTag8_8SVB(buf, values, count));
+    }
+}
+
+/*
+ * Not a pass/fail test, reports how long a typical P-frame's worth of fields takes with each implementation. The
+ * reference pays for a call and a store-with-check per byte, as blackboxWrite() did into the ring.
+ */
+TEST(BlackboxEncodingTest, Speed)
+{
+    static const int FRAMES = 4096;
+    static const int ITERATIONS = 50;
+
+    std::vector<int32_t> fields(FRAMES * 10);
+    for (size_t i = 0; i < fields.size(); i++) {
+        fields[i] = randomValue(8);
+    }
+
+    static uint8_t ring[4096];
+    uint32_t checksum = 0;
+
+    refOut.reserve(64);
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < ITERATIONS; it++) {
+        for (int f = 0; f < FRAMES; f++) {
+            const int32_t *frame = &fields[f * 10];
+            refOut.clear();
+            refWriteSignedVB(frame[0]);
+            refWriteTag2_3S32(&frame[1]);
+            refWriteTag8_4S16(&frame[4]);
+            refWriteTag8_8SVB(&frame[8], 2);
+            checksum += refOut.size();
+        }
+    }
+    const double refNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int it = 0; it < ITERATIONS; it++) {
+        for (int f = 0; f < FRAMES; f++) {
+            const int32_t *frame = &fields[f * 10];
+            uint8_t *dst = &ring[(f * 64) & (sizeof(ring) - 1)];
+            uint8_t *end = blackboxEncodeSignedVB(dst, frame[0]);
+            end = blackboxEncodeTag2_3S32(end, &frame[1]);
+            end = blackboxEncodeTag8_4S16(end, &frame[4]);
+            end = blackboxEncodeTag8_8SVB(end, &frame[8], 2);
+            checksum -= end - dst;
+        }
+    }
+    const double newNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    // Both produce the same number of bytes
+    EXPECT_EQ(0u, checksum);
+
+    printf("blackbox field encoding: reference %.1f ns/frame, word-at-a-time %.1f ns/frame\n",
+        refNs / (FRAMES * ITERATIONS), newNs / (FRAMES * ITERATIONS));
+}
@@ -19,6 +19,7 @@
 #include <stdbool.h>
 
 #include <limits.h>
+#include <string.h>
 
 #include <math.h>
 
@@ -145,3 +146,149 @@ TEST(FilterUnittest, TestFirFilterApply)
     expected = 7.0f * 26.0f + 6.0 * 27.0 + 5.0 * 28.0 + 4.0f * 29.0f;
     EXPECT_FLOAT_EQ(expected, firFilterApply(&filter));
 }
+
+TEST(FilterUnittest, TestBiquadFilter3MatchesBiquadFilter)
+{
+    biquadFilter_t single[FILTER3_AXIS_COUNT];
+    biquadFilter3_t filter3;
+
+    for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+        biquadFilterInit(&single[i], 200.0f, 125, 0.7f, FILTER_NOTCH);
+    }
+    biquadFilter3Init(&filter3, 200.0f, 125, 0.7f, FILTER_NOTCH);
+
+    for (int n = 0; n < 50; n++) {
+        float data[FILTER3_AXIS_COUNT] = { (float)n, -2.0f * n, (n % 7) * 10.0f };
+        float expected[FILTER3_AXIS_COUNT];
+        for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+            expected[i] = biquadFilterApply(&single[i], data[i]);
+        }
+        biquadFilter3Apply(&filter3, data);
+        for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+            EXPECT_FLOAT_EQ(expected[i], data[i]);
+        }
+    }
+}
+
+TEST(FilterUnittest, TestPt1Filter3MatchesPt1Filter)
+{
+    pt1Filter_t single;
+    pt1Filter3_t filter3;
+
+    memset(&single, 0, sizeof(single));
+    pt1FilterInit(&single, 100, 0.001f);
+    pt1Filter3Init(&filter3, 100, 0.001f);
+
+    for (int n = 0; n < 20; n++) {
+        const float input = (n % 5) * 3.0f;
+        float data[FILTER3_AXIS_COUNT] = { input, input, input };
+        const float expected = pt1FilterApply(&single, input);
+        pt1Filter3Apply(&filter3, data);
+        for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+            EXPECT_FLOAT_EQ(expected, data[i]);
+        }
+    }
+}
+
+TEST(FilterUnittest, TestBiquadFilterUpdate)
+{
+    biquadFilter_t reference;
+    biquadFilter_t filter;
+
+    biquadFilterInit(&filter, 100.0f, 125, 0.7f, FILTER_NOTCH);
+    biquadFilterApply(&filter, 10.0f);
+    const float d1 = filter.d1;
+    const float d2 = filter.d2;
+
+    const float freqs[] = { 20.0f, 80.0f, 150.0f, 333.0f, 600.0f, 1000.0f };
+    for (unsigned i = 0; i < sizeof(freqs) / sizeof(freqs[0]); i++) {
+        biquadFilterInit(&reference, freqs[i], 125, 0.7f, FILTER_NOTCH);
+        biquadFilterUpdate(&filter, freqs[i], 125, 0.7f, FILTER_NOTCH);
+
+        EXPECT_NEAR(reference.b0, filter.b0, 1e-4);
+        EXPECT_NEAR(reference.b1, filter.b1, 1e-4);
+        EXPECT_NEAR(reference.b2, filter.b2, 1e-4);
+        EXPECT_NEAR(reference.a1, filter.a1, 1e-4);
+        EXPECT_NEAR(reference.a2, filter.a2, 1e-4);
+
+        // state is untouched
+        EXPECT_FLOAT_EQ(d1, filter.d1);
+        EXPECT_FLOAT_EQ(d2, filter.d2);
+    }
+
+    biquadFilterInit(&reference, 250.0f, 1000, 1.0f / sqrtf(2.0f), FILTER_LPF);
+    biquadFilterUpdate(&filter, 250.0f, 1000, 1.0f / sqrtf(2.0f), FILTER_LPF);
+    EXPECT_NEAR(reference.b0, filter.b0, 1e-4);
+    EXPECT_NEAR(reference.a1, filter.a1, 1e-4);
+    EXPECT_NEAR(reference.a2, filter.a2, 1e-4);
+}
+
+TEST(FilterUnittest, TestBiquadFilter3IntMatchesFloat)
+{
+    biquadFilter3_t filter3;
+    biquadFilter3Int_t filterInt;
+
+    biquadFilter3Init(&filter3, 200.0f, 500, 1.5f, FILTER_NOTCH);
+    biquadFilter3IntInit(&filterInt, &filter3);
+
+    for (int n = 0; n < 200; n++) {
+        // sensor counts with 8 fractional bits, as used by the gyro
+        const int32_t counts[FILTER3_AXIS_COUNT] = { 1000 * (n % 9) - 4000, 16000 * ((n / 10) % 2), -300 };
+        float data[FILTER3_AXIS_COUNT];
+        int32_t dataInt[FILTER3_AXIS_COUNT];
+        for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+            data[i] = counts[i];
+            dataInt[i] = counts[i] * 256;
+        }
+        biquadFilter3Apply(&filter3, data);
+        biquadFilter3IntApply(&filterInt, dataInt);
+        for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+            EXPECT_NEAR(data[i], dataInt[i] / 256.0f, 0.5f);
+        }
+    }
+}
+
+TEST(FilterUnittest, TestNotchFilterBankMatchesBiquadFilter3)
+{
+    const float freqs[] = { 100.0f, 250.0f, 400.0f };
+    biquadFilter3_t reference[3];
+    notchFilterBank_t bank;
+
+    notchFilterBankInit(&bank, 3, 50.0f, 125, 5.0f);
+    EXPECT_EQ(3, bank.stageCount);
+    for (int stage = 0; stage < 3; stage++) {
+        biquadFilter3Init(&reference[stage], freqs[stage], 125, 5.0f, FILTER_NOTCH);
+        notchFilterBankUpdate(&bank, stage, freqs[stage], 125, 5.0f);
+    }
+
+    for (int n = 0; n < 100; n++) {
+        float expected[FILTER3_AXIS_COUNT] = { (float)(n % 11) * 20.0f, -3.0f * n, 500.0f };
+        float data[FILTER3_AXIS_COUNT] = { expected[0], expected[1], expected[2] };
+        for (int stage = 0; stage < 3; stage++) {
+            biquadFilter3Apply(&reference[stage], expected);
+        }
+        notchFilterBankApply(&bank, data);
+        for (int i = 0; i < FILTER3_AXIS_COUNT; i++) {
+            EXPECT_NEAR(expected[i], data[i], 0.05f);
+        }
+    }
+}
+
+TEST(FilterUnittest, TestNotchFilterBankRemovesCentreFrequency)
+{
+    notchFilterBank_t bank;
+    notchFilterBankInit(&bank, 1, 200.0f, 125, 3.0f);
+
+    float peak = 0;
+    for (int n = 0; n < 2000; n++) {
+        const float sample = 100.0f * sinf(2 * (float)M_PI * 200.0f * n * 0.000125f);
+        float data[FILTER3_AXIS_COUNT] = { sample, sample, 0 };
+        notchFilterBankApply(&bank, data);
+        if (n > 1000) {
+            peak = fmaxf(peak, fabsf(data[0]));
+        }
+        EXPECT_FLOAT_EQ(data[0], data[1]);
+        EXPECT_FLOAT_EQ(0, data[2]);
+    }
+    EXPECT_GT(1.0f, peak);
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+
+extern "C" {
+    #include "drivers/dshot_telemetry.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static const uint8_t gcrEncode[16] = {
+    0x19, 0x1b, 0x12, 0x13, 0x1d, 0x15, 0x16, 0x17,
+    0x1a, 0x09, 0x0a, 0x0b, 0x1e, 0x0d, 0x0e, 0x0f
+};
+
+// builds the 16 bit reply value, eee mmmmmmmmm cccc, with an optional bad checksum
+static uint16_t buildReply(uint16_t periodValue, bool badChecksum)
+{
+    uint16_t csum = periodValue ^ (periodValue >> 4) ^ (periodValue >> 8);
+    csum = ~csum & 0xf;
+    if (badChecksum) {
+        csum ^= 0x1;
+    }
+    return (periodValue << 4) | csum;
+}
+
+// encodes the reply as the capture timer would see it, returns the number of edges
+static int encodeEdges(uint16_t reply, uint32_t *edges, uint32_t startTicks)
+{
+    uint32_t gcr = 1;   // leading transition
+    for (int nibble = 3; nibble >= 0; nibble--) {
+        gcr = (gcr << 5) | gcrEncode[(reply >> (nibble * 4)) & 0xf];
+    }
+
+    int count = 0;
+    for (int bit = 20; bit >= 0; bit--) {
+        if (gcr & (1 << bit)) {
+            edges[count++] = (startTicks + (20 - bit) * DSHOT_TELEMETRY_TICKS_PER_BIT) & 0xffff;
+        }
+    }
+    return count;
+}
+
+TEST(DshotTelemetryTest, DecodesPeriod)
+{
+    // given
+    uint32_t edges[DSHOT_TELEMETRY_INPUT_LEN];
+    // 1000us period: m = 500, e = 1, 60000 eRPM
+    const int count = encodeEdges(buildReply((1 << 9) | 500, false), edges, 100);
+
+    // expect
+    EXPECT_EQ(600, dshotDecodeTelemetryPacket(edges, count));
+}
+
+TEST(DshotTelemetryTest, DecodesAcrossCounterWrap)
+{
+    // given
+    uint32_t edges[DSHOT_TELEMETRY_INPUT_LEN];
+    const int count = encodeEdges(buildReply(100, false), edges, 0xffff - 40);
+
+    // expect
+    EXPECT_EQ(6000, dshotDecodeTelemetryPacket(edges, count));
+}
+
+TEST(DshotTelemetryTest, ToleratesJitter)
+{
+    // given
+    uint32_t edges[DSHOT_TELEMETRY_INPUT_LEN];
+    const int count = encodeEdges(buildReply(300, false), edges, 0);
+    for (int i = 1; i < count; i += 2) {
+        edges[i] += 5;
+    }
+
+    // expect
+    EXPECT_EQ(2000, dshotDecodeTelemetryPacket(edges, count));
+}
+
+TEST(DshotTelemetryTest, StoppedMotor)
+{
+    // given
+    uint32_t edges[DSHOT_TELEMETRY_INPUT_LEN];
+    const int count = encodeEdges(buildReply(0x0fff, false), edges, 0);
+
+    // expect
+    EXPECT_EQ(0, dshotDecodeTelemetryPacket(edges, count));
+}
+
+TEST(DshotTelemetryTest, RejectsBadChecksum)
+{
+    // given
+    uint32_t edges[DSHOT_TELEMETRY_INPUT_LEN];
+    const int count = encodeEdges(buildReply(100, true), edges, 0);
+
+    // expect
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryPacket(edges, count));
+}
+
+TEST(DshotTelemetryTest, RejectsWrongLength)
+{
+    // given
+    uint32_t edges[DSHOT_TELEMETRY_INPUT_LEN];
+    const int count = encodeEdges(buildReply(100, false), edges, 0);
+    // stretch one bit so the reply runs past 21 bits
+    for (int i = 1; i < count; i++) {
+        edges[i] += 3 * DSHOT_TELEMETRY_TICKS_PER_BIT;
+    }
+
+    // expect
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryPacket(edges, count));
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryPacket(edges, 0));
+}
@@ -78,6 +78,24 @@ TEST(EncodingTest, FloatToIntEncodingTest)
     }
 }
 
+TEST(EncodingTest, Unpack11BitValuesTest)
+{
+    // given
+    // 0x7ff, 0x001, 0x400, 0x0ac packed little endian, 11 bits each
+    const uint8_t packed[] = { 0xff, 0x0f, 0x00, 0x00, 0x59, 0x01 };
+    uint32_t values[5] = { 0, 0, 0, 0, 0xdead };
+
+    // when
+    unpack11BitValues(values, packed, 4);
+
+    // then
+    EXPECT_EQ(0x7ff, values[0]);
+    EXPECT_EQ(0x001, values[1]);
+    EXPECT_EQ(0x400, values[2]);
+    EXPECT_EQ(0x0ac, values[3]);
+    EXPECT_EQ(0xdead, values[4]);
+}
+
 // STUBS
 
 extern "C" {
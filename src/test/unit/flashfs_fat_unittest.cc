@@ -0,0 +1,177 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "msc/flashfs_fat.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static uint32_t fakeLogSize;
+
+static uint16_t getU16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+// What a FAT driver would work out from the boot sector
+typedef struct {
+    uint32_t sectorsPerCluster;
+    uint32_t fatStart;
+    uint32_t fatSectors;
+    uint32_t rootStart;
+    uint32_t dataStart;
+    uint32_t clusters;
+} parsedVolume_t;
+
+static parsedVolume_t parseBootSector(void)
+{
+    uint8_t sector[FLASHFS_FAT_SECTOR_SIZE];
+    flashfsFatReadSector(0, sector);
+
+    EXPECT_EQ(0x55, sector[510]);
+    EXPECT_EQ(0xAA, sector[511]);
+    EXPECT_EQ(FLASHFS_FAT_SECTOR_SIZE, getU16(sector + 11));
+    EXPECT_EQ(0, memcmp(sector + 54, "FAT16   ", 8));
+
+    parsedVolume_t v;
+    v.sectorsPerCluster = sector[13];
+    v.fatStart = getU16(sector + 14);
+    v.fatSectors = getU16(sector + 22);
+    v.rootStart = v.fatStart + sector[16] * v.fatSectors;
+    v.dataStart = v.rootStart + (getU16(sector + 17) * 32 + FLASHFS_FAT_SECTOR_SIZE - 1) / FLASHFS_FAT_SECTOR_SIZE;
+
+    const uint32_t totalSectors = getU16(sector + 19) ? getU16(sector + 19) : getU32(sector + 32);
+    EXPECT_EQ(flashfsFatGetSectorCount(), totalSectors);
+    v.clusters = (totalSectors - v.dataStart) / v.sectorsPerCluster;
+
+    return v;
+}
+
+static uint16_t fatEntry(const parsedVolume_t &v, uint32_t cluster)
+{
+    uint8_t sector[FLASHFS_FAT_SECTOR_SIZE];
+    flashfsFatReadSector(v.fatStart + cluster / 256, sector);
+    return getU16(sector + (cluster % 256) * 2);
+}
+
+TEST(FlashfsFatTest, EmptyFlashIsValidEmptyVolume)
+{
+    fakeLogSize = 0;
+    flashfsFatInit();
+
+    parsedVolume_t v = parseBootSector();
+    EXPECT_GE(v.clusters, 4085u); // anything less would be taken for FAT12
+    EXPECT_EQ(0xFFF8, fatEntry(v, 0));
+    EXPECT_EQ(0, fatEntry(v, 2));
+
+    uint8_t root[FLASHFS_FAT_SECTOR_SIZE];
+    flashfsFatReadSector(v.rootStart, root);
+    EXPECT_EQ(0x08, root[11]); // just the volume label
+    EXPECT_EQ(0, root[32]);
+}
+
+TEST(FlashfsFatTest, LogFileCoversFlashContents)
+{
+    fakeLogSize = 100000;
+    flashfsFatInit();
+
+    parsedVolume_t v = parseBootSector();
+
+    uint8_t root[FLASHFS_FAT_SECTOR_SIZE];
+    flashfsFatReadSector(v.rootStart, root);
+    const uint8_t *file = root + 32;
+    EXPECT_EQ(0, memcmp(file, "BTFL_ALLBBL", 11));
+    EXPECT_EQ(2, getU16(file + 26));
+    EXPECT_EQ(fakeLogSize, getU32(file + 28));
+
+    // Follow the chain the way a host would
+    const uint32_t clusterSize = v.sectorsPerCluster * FLASHFS_FAT_SECTOR_SIZE;
+    uint32_t cluster = 2;
+    uint32_t count = 1;
+    while (fatEntry(v, cluster) != 0xFFFF) {
+        EXPECT_EQ(cluster + 1, fatEntry(v, cluster));
+        cluster = fatEntry(v, cluster);
+        count++;
+        ASSERT_LT(count, 100000u);
+    }
+    EXPECT_EQ((fakeLogSize + clusterSize - 1) / clusterSize, count);
+    EXPECT_EQ(0, fatEntry(v, cluster + 1));
+
+    // Both FAT copies agree
+    uint8_t fat1[FLASHFS_FAT_SECTOR_SIZE], fat2[FLASHFS_FAT_SECTOR_SIZE];
+    flashfsFatReadSector(v.fatStart, fat1);
+    flashfsFatReadSector(v.fatStart + v.fatSectors, fat2);
+    EXPECT_EQ(0, memcmp(fat1, fat2, sizeof(fat1)));
+}
+
+TEST(FlashfsFatTest, DataSectorsReadFlash)
+{
+    fakeLogSize = 1000;
+    flashfsFatInit();
+
+    parsedVolume_t v = parseBootSector();
+
+    uint8_t sector[FLASHFS_FAT_SECTOR_SIZE];
+    flashfsFatReadSector(v.dataStart + 1, sector);
+
+    // The fake flash holds the low byte of each address, the tail of the sector is past the end of the log
+    for (int i = 0; i < FLASHFS_FAT_SECTOR_SIZE; i++) {
+        const uint32_t address = FLASHFS_FAT_SECTOR_SIZE + i;
+        EXPECT_EQ(address < fakeLogSize ? (uint8_t)address : 0, sector[i]);
+    }
+}
+
+TEST(FlashfsFatTest, LargeFlashUsesBiggerClusters)
+{
+    fakeLogSize = 128 * 1024 * 1024;
+    flashfsFatInit();
+
+    parsedVolume_t v = parseBootSector();
+    EXPECT_GT(v.sectorsPerCluster, 1u);
+    EXPECT_LT(v.clusters, 65525u);
+    EXPECT_GE(v.clusters * v.sectorsPerCluster * FLASHFS_FAT_SECTOR_SIZE, fakeLogSize);
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t flashfsGetOffset(void)
+{
+    return fakeLogSize;
+}
+
+int flashfsReadAbs(uint32_t address, uint8_t *buffer, unsigned int len)
+{
+    EXPECT_LE(address + len, fakeLogSize);
+    for (unsigned i = 0; i < len; i++) {
+        buffer[i] = (uint8_t)(address + i);
+    }
+    return len;
+}
+
+}
@@ -0,0 +1,500 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "drivers/flash.h"
+    #include "drivers/flash_m25p16.h"
+    #include "io/flashfs.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define FAKE_FLASH_SIZE (64 * 1024)
+
+static uint8_t fakeFlash[FAKE_FLASH_SIZE];
+static flashGeometry_t fakeGeometry = {.sectors = 0, .pagesPerSector = 0, .pageSize = M25P16_PAGESIZE, .sectorSize = 0, .totalSize = 0};
+
+static int programCount;
+static int eraseCount;
+static bool flashBusy;
+
+// Emulate a DMA page program that stays in flight until the test completes it
+static bool dmaMode;
+static bool dmaPending;
+static uint32_t dmaAddress;
+static const uint8_t *dmaData;
+static int dmaLength;
+
+static void programFlash(uint32_t address, const uint8_t *data, int length)
+{
+    // A program must never cross a page boundary
+    EXPECT_EQ(address / M25P16_PAGESIZE, (address + length - 1) / M25P16_PAGESIZE);
+
+    for (int i = 0; i < length; i++) {
+        fakeFlash[address + i] &= data[i];
+    }
+    programCount++;
+}
+
+static void resetFlash(void)
+{
+    memset(fakeFlash, 0xFF, sizeof(fakeFlash));
+    fakeGeometry.sectors = 16;
+    fakeGeometry.pagesPerSector = 16;
+    fakeGeometry.sectorSize = fakeGeometry.pagesPerSector * fakeGeometry.pageSize;
+    fakeGeometry.totalSize = FAKE_FLASH_SIZE;
+
+    programCount = 0;
+    flashBusy = false;
+    dmaMode = false;
+    dmaPending = false;
+
+    // Throws away whatever the last test left in the write buffer
+    flashfsSetRingMode(false);
+    flashfsEraseCompletely();
+    while (!flashfsIsReady()) {
+        flashBusy = false;
+        flashfsUpdate();
+    }
+
+    eraseCount = 0;
+}
+
+static void completeDma(void)
+{
+    programFlash(dmaAddress, dmaData, dmaLength);
+    dmaPending = false;
+}
+
+static void fillPattern(uint8_t *buffer, int length, int seed)
+{
+    for (int i = 0; i < length; i++) {
+        buffer[i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+TEST(FlashfsTest, AsyncWritesOnlyProgramWholePages)
+{
+    resetFlash();
+
+    uint8_t data[100];
+    fillPattern(data, sizeof(data), 1);
+
+    // Two writes still leave the first page short of full
+    flashfsWrite(data, sizeof(data), false);
+    flashfsWrite(data, sizeof(data), false);
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_EQ(0, programCount);
+    EXPECT_EQ(200u, flashfsGetOffset());
+
+    // The third completes page 0, which is programmed in one go
+    flashfsWrite(data, sizeof(data), false);
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_EQ(1, programCount);
+    EXPECT_EQ(0, memcmp(fakeFlash, data, sizeof(data)));
+    EXPECT_EQ(0, memcmp(fakeFlash + 200, data, 56));
+    EXPECT_EQ(0xFF, fakeFlash[M25P16_PAGESIZE]);
+
+    // The partial page only goes out on a flush
+    flashfsFlushSync();
+    EXPECT_EQ(2, programCount);
+    EXPECT_EQ(0, memcmp(fakeFlash + M25P16_PAGESIZE, data + 56, 44));
+    EXPECT_EQ(300u, flashfsGetOffset());
+}
+
+TEST(FlashfsTest, UnalignedStartProgramsUpToPageBoundary)
+{
+    resetFlash();
+    flashfsSeekAbs(1000);
+
+    uint8_t data[300];
+    fillPattern(data, sizeof(data), 3);
+    flashfsWrite(data, sizeof(data), false);
+
+    // 24 bytes finish the page at 1024, then a whole page follows
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_EQ(2, programCount);
+
+    flashfsFlushSync();
+    EXPECT_EQ(3, programCount);
+    EXPECT_EQ(0, memcmp(fakeFlash + 1000, data, sizeof(data)));
+}
+
+TEST(FlashfsTest, BusyFlashKeepsData)
+{
+    resetFlash();
+
+    uint8_t data[M25P16_PAGESIZE];
+    fillPattern(data, sizeof(data), 5);
+    flashfsWrite(data, sizeof(data), false);
+
+    flashBusy = true;
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_EQ(0, programCount);
+
+    flashBusy = false;
+    EXPECT_TRUE(flashfsFlushPages());
+    EXPECT_EQ(0, memcmp(fakeFlash, data, sizeof(data)));
+}
+
+TEST(FlashfsTest, AsyncWriteThatDoesNotFitIsDropped)
+{
+    resetFlash();
+
+    uint8_t data[FLASHFS_WRITE_BUFFER_SIZE];
+    fillPattern(data, sizeof(data), 7);
+
+    flashfsWrite(data, sizeof(data) - 10, false);
+    EXPECT_EQ(10u, flashfsGetWriteBufferFreeSpace());
+
+    flashfsWrite(data, 11, false);
+    EXPECT_EQ(sizeof(data) - 10, flashfsGetOffset());
+
+    flashfsWrite(data, 10, false);
+    EXPECT_EQ(0u, flashfsGetWriteBufferFreeSpace());
+}
+
+TEST(FlashfsTest, DmaProgramHoldsBufferSpace)
+{
+    resetFlash();
+    dmaMode = true;
+
+    uint8_t data[M25P16_PAGESIZE + 10];
+    fillPattern(data, sizeof(data), 9);
+    flashfsWrite(data, sizeof(data), false);
+
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_TRUE(dmaPending);
+    EXPECT_EQ(0, programCount);
+
+    // The page being sent can't be reused until the transfer is done
+    EXPECT_EQ((uint32_t)FLASHFS_WRITE_BUFFER_SIZE - sizeof(data), flashfsGetWriteBufferFreeSpace());
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_FALSE(flashfsIsReady());
+
+    completeDma();
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_EQ((uint32_t)FLASHFS_WRITE_BUFFER_SIZE - 10, flashfsGetWriteBufferFreeSpace());
+    EXPECT_EQ(0, memcmp(fakeFlash, data, M25P16_PAGESIZE));
+}
+
+TEST(FlashfsTest, SyncWriteLargerThanBuffer)
+{
+    resetFlash();
+    flashfsSeekAbs(77);
+
+    static uint8_t data[FLASHFS_WRITE_BUFFER_SIZE * 3 + 5];
+    fillPattern(data, sizeof(data), 11);
+
+    flashfsWrite(data, sizeof(data), true);
+    flashfsFlushSync();
+
+    EXPECT_EQ(0, memcmp(fakeFlash + 77, data, sizeof(data)));
+    EXPECT_EQ(77 + sizeof(data), flashfsGetOffset());
+}
+
+TEST(FlashfsTest, WritesPastEndAreDiscarded)
+{
+    resetFlash();
+    flashfsSeekAbs(FAKE_FLASH_SIZE - 10);
+
+    uint8_t data[40];
+    fillPattern(data, sizeof(data), 13);
+    flashfsWrite(data, sizeof(data), true);
+    flashfsFlushSync();
+
+    EXPECT_EQ(0, memcmp(fakeFlash + FAKE_FLASH_SIZE - 10, data, 10));
+    EXPECT_TRUE(flashfsIsEOF());
+    EXPECT_EQ(flashfsGetWriteBufferSize(), flashfsGetWriteBufferFreeSpace());
+}
+
+TEST(FlashfsTest, BackgroundEraseOnlyCoversUsedSectors)
+{
+    resetFlash();
+
+    static uint8_t data[5000];
+    fillPattern(data, sizeof(data), 15);
+    flashfsWrite(data, sizeof(data), true);
+    flashfsFlushSync();
+
+    // Data that was never logged to lies beyond the used space
+    fakeFlash[5 * fakeGeometry.sectorSize] = 0x42;
+
+    flashfsEraseCompletely();
+    EXPECT_FALSE(flashfsIsReady());
+    EXPECT_EQ(0u, flashfsGetOffset());
+    EXPECT_EQ(2 * fakeGeometry.sectorSize, flashfsGetEraseRemaining());
+
+    // One sector is started per update, and only once the previous erase has finished
+    flashfsUpdate();
+    flashfsUpdate();
+    EXPECT_EQ(1, eraseCount);
+    EXPECT_EQ(fakeGeometry.sectorSize, flashfsGetEraseRemaining());
+
+    flashBusy = false;
+    flashfsUpdate();
+    EXPECT_EQ(2, eraseCount);
+    EXPECT_EQ(0u, flashfsGetEraseRemaining());
+    EXPECT_FALSE(flashfsIsReady());
+
+    flashBusy = false;
+    flashfsUpdate();
+    EXPECT_TRUE(flashfsIsReady());
+    EXPECT_EQ(2, eraseCount);
+    EXPECT_EQ(0xFF, fakeFlash[4999]);
+    EXPECT_EQ(0x42, fakeFlash[5 * fakeGeometry.sectorSize]);
+}
+
+TEST(FlashfsTest, WritesWaitForTheirSectorToBeErased)
+{
+    resetFlash();
+
+    uint8_t data[M25P16_PAGESIZE];
+    fillPattern(data, sizeof(data), 17);
+    flashfsWrite(data, sizeof(data), true);
+    flashfsFlushSync();
+
+    flashfsEraseCompletely();
+
+    // Logging can carry on right away, the page waits in the buffer until its sector has been erased
+    flashfsWrite(data, sizeof(data), false);
+    EXPECT_FALSE(flashfsFlushPages());
+    EXPECT_EQ(1, programCount);
+
+    flashfsUpdate();
+    EXPECT_EQ(1, eraseCount);
+    EXPECT_EQ(1, programCount);
+
+    flashBusy = false;
+    EXPECT_TRUE(flashfsFlushPages());
+    EXPECT_EQ(2, programCount);
+    EXPECT_EQ(0, memcmp(fakeFlash, data, sizeof(data)));
+}
+
+TEST(FlashfsTest, RingModeWrapsAndErasesAhead)
+{
+    resetFlash();
+
+    // An old lap of the log fills the start of the device
+    memset(fakeFlash, 0, 2 * fakeGeometry.sectorSize);
+
+    flashfsSetRingMode(true);
+    flashfsSeekAbs(FAKE_FLASH_SIZE - fakeGeometry.sectorSize);
+
+    // Entering the last sector queues an erase of the oldest one, which follows it
+    static uint8_t data[4096 + 100];
+    fillPattern(data, sizeof(data), 19);
+    flashfsWrite(data, fakeGeometry.sectorSize, true);
+    EXPECT_EQ(1, eraseCount);
+    EXPECT_EQ(0xFF, fakeFlash[0]);
+    EXPECT_FALSE(flashfsIsEOF());
+
+    // So the log carries on from the start of the device without waiting
+    flashfsWrite(data + fakeGeometry.sectorSize, 100, true);
+    flashfsFlushSync();
+    EXPECT_EQ(0, memcmp(fakeFlash + FAKE_FLASH_SIZE - fakeGeometry.sectorSize, data, fakeGeometry.sectorSize));
+    EXPECT_EQ(0, memcmp(fakeFlash, data + fakeGeometry.sectorSize, 100));
+    EXPECT_EQ((uint32_t)FAKE_FLASH_SIZE, flashfsGetOffset());
+
+    // And sector 1 is erased ahead of the log now that it has entered sector 0
+    flashfsUpdate();
+    EXPECT_EQ(2, eraseCount);
+    EXPECT_EQ(0xFF, fakeFlash[fakeGeometry.sectorSize]);
+}
+
+TEST(FlashfsTest, FreeSpaceIsFoundAfterLogWrapped)
+{
+    resetFlash();
+
+    // The current lap ends part way into sector 3, sector 4 was erased ahead of it and the oldest data follows
+    memset(fakeFlash, 0, 3 * fakeGeometry.sectorSize + 2048);
+    memset(fakeFlash + 5 * fakeGeometry.sectorSize, 0, FAKE_FLASH_SIZE - 5 * fakeGeometry.sectorSize);
+
+    EXPECT_EQ(3 * (int)fakeGeometry.sectorSize + 2048, flashfsIdentifyStartOfFreeSpace());
+
+    flashfsInit();
+    EXPECT_EQ((uint32_t)FAKE_FLASH_SIZE, flashfsGetOffset());
+
+    // Without ring mode a wrapped log leaves no room to write to
+    EXPECT_TRUE(flashfsIsEOF());
+    flashfsSetRingMode(true);
+    EXPECT_FALSE(flashfsIsEOF());
+}
+
+// The log index is kept once flashfsInit() has found the last sector erased, so these tests come last
+TEST(FlashfsTest, LogIndexRecordsLogsAndGivesFreeSpaceAtBoot)
+{
+    resetFlash();
+    flashfsInit();
+    EXPECT_EQ((uint32_t)FAKE_FLASH_SIZE - fakeGeometry.sectorSize, flashfsGetSize());
+    EXPECT_EQ(0, flashfsGetLogCount());
+
+    static uint8_t data[5000];
+    fillPattern(data, sizeof(data), 23);
+
+    flashfsLogBegin(1000);
+    flashfsWrite(data, sizeof(data), true);
+    flashfsLogEnd();
+    flashfsLogBegin(2000);
+    flashfsWrite(data, 100, true);
+    flashfsLogEnd();
+    flashfsFlushSync();
+    flashfsUpdate();
+
+    EXPECT_EQ(2, flashfsGetLogCount());
+    flashfsLogEntry_t entry;
+    EXPECT_TRUE(flashfsGetLog(0, &entry));
+    EXPECT_EQ(0u, entry.start);
+    EXPECT_EQ(5000u, entry.length);
+    EXPECT_EQ(1000u, entry.timeMs);
+    EXPECT_TRUE(flashfsGetLog(1, &entry));
+    EXPECT_EQ(5000u, entry.start);
+    EXPECT_EQ(100u, entry.length);
+    EXPECT_FALSE(flashfsGetLog(2, &entry));
+
+    // The index gives the exact end of the data, where the scan would only find the next free 2kB block
+    flashfsInit();
+    EXPECT_EQ(2, flashfsGetLogCount());
+    EXPECT_EQ(5100u, flashfsGetOffset());
+    EXPECT_TRUE(flashfsGetLog(1, &entry));
+    EXPECT_EQ(100u, entry.length);
+}
+
+TEST(FlashfsTest, LogIndexClosesLogCutShortAndIsErasedWithVolume)
+{
+    // Carries on from the logs of the last test
+    static uint8_t data[300];
+    fillPattern(data, sizeof(data), 29);
+
+    flashfsLogBegin(3000);
+    flashfsWrite(data, sizeof(data), true);
+    flashfsFlushSync();
+    flashfsUpdate();
+
+    flashfsLogEntry_t entry;
+    EXPECT_EQ(3, flashfsGetLogCount());
+    EXPECT_TRUE(flashfsGetLog(2, &entry));
+    EXPECT_EQ(0u, entry.length);
+
+    // Power is lost before the log ends, so it is closed at the free space found by the scan
+    flashfsInit();
+    flashfsUpdate();
+    EXPECT_EQ(6144u, flashfsGetOffset());
+    EXPECT_TRUE(flashfsGetLog(2, &entry));
+    EXPECT_EQ(5100u, entry.start);
+    EXPECT_EQ(6144u - 5100u, entry.length);
+
+    flashfsInit();
+    EXPECT_EQ(3, flashfsGetLogCount());
+    EXPECT_TRUE(flashfsGetLog(2, &entry));
+    EXPECT_EQ(6144u - 5100u, entry.length);
+
+    // The index sector is erased first, then the sectors of the volume that were used
+    flashfsEraseCompletely();
+    EXPECT_EQ(0, flashfsGetLogCount());
+    EXPECT_EQ(3 * fakeGeometry.sectorSize, flashfsGetEraseRemaining());
+    while (!flashfsIsReady()) {
+        flashBusy = false;
+        flashfsUpdate();
+    }
+    EXPECT_EQ(0xFF, fakeFlash[FAKE_FLASH_SIZE - fakeGeometry.sectorSize]);
+    EXPECT_EQ(0xFF, fakeFlash[0]);
+
+    flashfsInit();
+    EXPECT_EQ(0, flashfsGetLogCount());
+    EXPECT_EQ(0u, flashfsGetOffset());
+}
+
+// STUBS
+
+extern "C" {
+
+const flashGeometry_t* m25p16_getGeometry()
+{
+    return &fakeGeometry;
+}
+
+bool m25p16_isTransferComplete(void)
+{
+    return !dmaPending;
+}
+
+bool m25p16_isReady()
+{
+    return !flashBusy && !dmaPending;
+}
+
+bool m25p16_waitForReady(uint32_t timeoutMillis)
+{
+    UNUSED(timeoutMillis);
+
+    // Time passes while we wait
+    if (dmaPending) {
+        completeDma();
+    }
+    flashBusy = false;
+
+    return true;
+}
+
+bool m25p16_pageProgramStart(uint32_t address, const uint8_t *data, int length)
+{
+    if (!m25p16_isReady()) {
+        return false;
+    }
+
+    if (dmaMode) {
+        dmaPending = true;
+        dmaAddress = address;
+        dmaData = data;
+        dmaLength = length;
+    } else {
+        programFlash(address, data, length);
+    }
+
+    return true;
+}
+
+int m25p16_readBytes(uint32_t address, uint8_t *buffer, int length)
+{
+    memcpy(buffer, fakeFlash + address, length);
+
+    return length;
+}
+
+void m25p16_eraseCompletely()
+{
+    memset(fakeFlash, 0xFF, sizeof(fakeFlash));
+}
+
+void m25p16_eraseSector(uint32_t address)
+{
+    // The erase's completion takes the test clearing flashBusy
+    EXPECT_FALSE(flashBusy);
+
+    memset(fakeFlash + address, 0xFF, fakeGeometry.sectorSize);
+    eraseCount++;
+    flashBusy = true;
+}
+
+}
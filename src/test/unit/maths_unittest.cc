@@ -187,6 +187,75 @@ TEST(MathsUnittest, TestFastTrigonometryATan2)
     EXPECT_LE(error, 1e-6);
 }
 
+#ifdef USE_TRIG_LUT
+TEST(MathsUnittest, TestTableTrigonometrySinCos)
+{
+    trigLutInit();
+
+    double sinError = 0;
+    double cosError = 0;
+    for (float x = -10 * M_PI; x < 10 * M_PI; x += M_PI / 3000) {
+        sinError = MAX(sinError, fabs(sin_lut(x) - sin(x)));
+        cosError = MAX(cosError, fabs(cos_lut(x) - cos(x)));
+    }
+    printf("sin_lut maximum absolute error = %e\n", sinError);
+    printf("cos_lut maximum absolute error = %e\n", cosError);
+    EXPECT_LE(sinError, 2.5e-5);
+    EXPECT_LE(cosError, 2.5e-5);
+
+    // the quadrant boundaries, where the table is read backwards or negated
+    EXPECT_NEAR(1.0f, sin_lut(M_PI / 2), 1e-5);
+    EXPECT_NEAR(-1.0f, sin_lut(-M_PI / 2), 1e-5);
+    EXPECT_NEAR(0.0f, sin_lut(M_PI), 1e-6);
+    EXPECT_FLOAT_EQ(0.0f, sin_lut(100.0f));
+}
+
+TEST(MathsUnittest, TestTableTrigonometryATan2)
+{
+    trigLutInit();
+
+    double error = 0;
+    for (float x = -1.0f; x <= 1.0f; x += 0.01f) {
+        for (float y = -1.0f; y <= 1.0f; y += 0.001f) {
+            error = MAX(error, fabs(atan2_lut(y, x) - atan2(y, x)));
+        }
+    }
+    printf("atan2_lut maximum absolute error = %e rads (%e degree)\n", error, error / M_PI * 180.0f);
+    EXPECT_LE(error, 1e-5);
+    EXPECT_FLOAT_EQ(0.0f, atan2_lut(0.0f, 0.0f));
+}
+#endif
+
+TEST(MathsUnittest, TestIntegerATan2)
+{
+    EXPECT_EQ(0, atan2_approx_int(0, 0));
+    EXPECT_EQ(0, atan2_approx_int(0, 1000));
+    EXPECT_EQ(9000, atan2_approx_int(1000, 0));
+    EXPECT_EQ(18000, atan2_approx_int(0, -1000));
+    EXPECT_EQ(-9000, atan2_approx_int(-1000, 0));
+    EXPECT_EQ(4500, atan2_approx_int(INT32_MAX, INT32_MAX));
+
+    double error = 0;
+    for (int32_t x = -100000; x <= 100000; x += 997) {
+        for (int32_t y = -100000; y <= 100000; y += 991) {
+            const double libmResult = atan2(y, x) * 18000.0 / M_PI;
+            error = MAX(error, fabs(atan2_approx_int(y, x) - libmResult));
+        }
+    }
+    printf("atan2_approx_int maximum absolute error = %e centidegrees\n", error);
+    EXPECT_LE(error, 10);
+}
+
+TEST(MathsUnittest, TestIntegerSqrt)
+{
+    EXPECT_EQ(0, sqrt_int64(0));
+    EXPECT_EQ(1, sqrt_int64(3));
+    EXPECT_EQ(2, sqrt_int64(4));
+    EXPECT_EQ(99999, sqrt_int64(9999999999ULL));
+    EXPECT_EQ(100000, sqrt_int64(10000000000ULL));
+    EXPECT_EQ(UINT32_MAX, sqrt_int64(UINT64_MAX));
+}
+
 TEST(MathsUnittest, TestFastTrigonometryACos)
 {
     double error = 0;
@@ -199,3 +268,105 @@ TEST(MathsUnittest, TestFastTrigonometryACos)
     EXPECT_LE(error, 1e-4);
 }
 #endif
+
+TEST(MathsUnittest, TestCrc16Ccitt)
+{
+    const char *check = "123456789";
+    uint16_t crc = 0;
+    while (*check) {
+        crc = crc16_ccitt(crc, *check++);
+    }
+    // CRC-16/XMODEM check value
+    EXPECT_EQ(0x31c3, crc);
+
+    // the table must agree with the bitwise definition for every byte and crc state
+    for (int crc = 0; crc < 0x10000; crc += 0x0101) {
+        for (int a = 0; a < 256; a++) {
+            uint16_t expected = crc ^ (a << 8);
+            for (int ii = 0; ii < 8; ++ii) {
+                expected = (expected & 0x8000) ? (expected << 1) ^ 0x1021 : expected << 1;
+            }
+            EXPECT_EQ(expected, crc16_ccitt(crc, a));
+        }
+    }
+}
+
+TEST(MathsUnittest, TestCrc16CcittBuf)
+{
+    const char *check = "123456789";
+    EXPECT_EQ(0x31c3, crc16_ccitt_buf(0, check, 9));
+    // a buffer can be checked in pieces
+    EXPECT_EQ(0x31c3, crc16_ccitt_buf(crc16_ccitt_buf(0, check, 4), check + 4, 5));
+    EXPECT_EQ(0x1234, crc16_ccitt_buf(0x1234, check, 0));
+}
+
+static uint8_t crc8Bitwise(uint8_t crc, uint8_t a, uint8_t poly)
+{
+    crc ^= a;
+    for (int ii = 0; ii < 8; ++ii) {
+        crc = (crc & 0x80) ? (crc << 1) ^ poly : crc << 1;
+    }
+    return crc;
+}
+
+TEST(MathsUnittest, TestCrc8)
+{
+    const char *check = "123456789";
+    // CRC-8/DVB-S2 and CRC-8/SMBUS check values
+    EXPECT_EQ(0xbc, crc8_dvb_s2_buf(0, check, 9));
+    EXPECT_EQ(0xf4, crc8_poly_0x07_buf(0, check, 9));
+    EXPECT_EQ(0xbc, crc8_dvb_s2_buf(crc8_dvb_s2_buf(0, check, 4), check + 4, 5));
+
+    for (int crc = 0; crc < 256; crc++) {
+        for (int a = 0; a < 256; a++) {
+            EXPECT_EQ(crc8Bitwise(crc, a, 0xd5), crc8_dvb_s2(crc, a));
+            EXPECT_EQ(crc8Bitwise(crc, a, 0x07), crc8_poly_0x07(crc, a));
+        }
+    }
+}
+
+TEST(MathsUnittest, TestSlidingWindowMedian)
+{
+    slidingWindow_t window;
+    slidingWindowInit(&window, 5);
+
+    int32_t samples[5];
+    int32_t seed = 12345;
+    for (int ii = 0; ii < 200; ii++) {
+        seed = seed * 1103515245 + 12345;
+        const int32_t sample = (seed >> 16) % 1000 - 500;
+        samples[ii % 5] = sample;
+        slidingWindowPush(&window, sample);
+        if (ii >= 4) {
+            EXPECT_TRUE(slidingWindowIsFull(&window));
+            EXPECT_EQ(quickMedianFilter5(samples), slidingWindowMedian(&window));
+        } else {
+            EXPECT_FALSE(slidingWindowIsFull(&window));
+        }
+    }
+
+    // an even count takes the mean of the middle two
+    slidingWindowInit(&window, 4);
+    slidingWindowPush(&window, 10);
+    slidingWindowPush(&window, 40);
+    EXPECT_EQ(25, slidingWindowMedian(&window));
+}
+
+TEST(MathsUnittest, TestSlidingWindowMeanAndVariance)
+{
+    slidingWindow_t window;
+    slidingWindowInit(&window, 4);
+
+    EXPECT_EQ(0, slidingWindowMean(&window));
+    EXPECT_FLOAT_EQ(0.0f, slidingWindowVariance(&window));
+
+    const int32_t samples[] = { 100000, 100004, 100002, 100006, 100008, 100010 };
+    for (unsigned ii = 0; ii < sizeof(samples) / sizeof(samples[0]); ii++) {
+        slidingWindowPush(&window, samples[ii]);
+    }
+    // the window holds the last four, with a mean of 100006.5
+    EXPECT_EQ(100006, slidingWindowMean(&window));
+    EXPECT_EQ(100007, slidingWindowMedian(&window));
+    // deviations -4.5, -0.5, 1.5, 3.5
+    EXPECT_FLOAT_EQ(35.0f / 3.0f, slidingWindowVariance(&window));
+}
@@ -0,0 +1,171 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/streambuf.h"
+
+    #include "msp/msp.h"
+
+    #include "telemetry/msp_telemetry.h"
+
+    static int replySize = 0;
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define CHUNK_SIZE 6    // SmartPort payload
+
+#define HEAD_START  (1 << 4)
+#define HEAD_ERROR  (1 << 5)
+#define HEAD_SEQ    0x0F
+
+static void sendRequest(uint8_t cmd)
+{
+    const uint8_t chunk[CHUNK_SIZE] = { (MSP_TELEMETRY_VERSION << 5) | HEAD_START, 0, cmd, cmd, 0, 0 };
+    EXPECT_TRUE(mspTelemetryHandleRequest(chunk, CHUNK_SIZE));
+}
+
+static void sendRetransmit(uint8_t seq)
+{
+    const uint8_t chunk[CHUNK_SIZE] = { (uint8_t)((MSP_TELEMETRY_VERSION << 5) | seq), 0, 0, 0, 0, 0 };
+    mspTelemetryHandleRequest(chunk, CHUNK_SIZE);
+}
+
+TEST(MspTelemetryTest, SingleChunkReply)
+{
+    // given
+    replySize = 2;
+    sendRequest(100);
+    EXPECT_TRUE(mspTelemetryReplyPending());
+
+    // when
+    uint8_t chunk[CHUNK_SIZE];
+    EXPECT_FALSE(mspTelemetryEncodeReply(chunk, CHUNK_SIZE));
+
+    // then
+    EXPECT_TRUE(chunk[0] & HEAD_START);
+    EXPECT_FALSE(chunk[0] & HEAD_ERROR);
+    EXPECT_EQ(2, chunk[1]);
+    EXPECT_EQ(0, chunk[2]);
+    EXPECT_EQ(1, chunk[3]);
+    EXPECT_EQ(2 ^ 100 ^ 0 ^ 1, chunk[4]);
+    EXPECT_EQ(0, chunk[5]);
+    EXPECT_FALSE(mspTelemetryReplyPending());
+}
+
+TEST(MspTelemetryTest, ChecksumErrorReply)
+{
+    // given
+    const uint8_t request[CHUNK_SIZE] = { (MSP_TELEMETRY_VERSION << 5) | HEAD_START, 0, 100, 0x55, 0, 0 };
+    EXPECT_TRUE(mspTelemetryHandleRequest(request, CHUNK_SIZE));
+
+    // when
+    uint8_t chunk[CHUNK_SIZE];
+    EXPECT_FALSE(mspTelemetryEncodeReply(chunk, CHUNK_SIZE));
+
+    // then
+    EXPECT_TRUE(chunk[0] & HEAD_START);
+    EXPECT_TRUE(chunk[0] & HEAD_ERROR);
+    EXPECT_EQ(1, chunk[1]);
+}
+
+TEST(MspTelemetryTest, RetransmitFromMissingChunk)
+{
+    // given
+    replySize = 20;
+    sendRequest(101);
+
+    uint8_t chunks[6][CHUNK_SIZE];
+    int count = 0;
+    while (mspTelemetryEncodeReply(chunks[count++], CHUNK_SIZE));
+    EXPECT_EQ(5, count); // 4 payload bytes in the first chunk, 5 in the others, then the checksum
+    for (int i = 1; i < count; i++) {
+        EXPECT_EQ((chunks[0][0] + i) & HEAD_SEQ, chunks[i][0] & HEAD_SEQ);
+        EXPECT_FALSE(chunks[i][0] & HEAD_START);
+    }
+
+    // when
+    sendRetransmit(chunks[2][0] & HEAD_SEQ);
+
+    // then
+    EXPECT_TRUE(mspTelemetryReplyPending());
+    for (int i = 2; i < count; i++) {
+        uint8_t chunk[CHUNK_SIZE];
+        EXPECT_EQ(i < count - 1, mspTelemetryEncodeReply(chunk, CHUNK_SIZE));
+        EXPECT_EQ(0, memcmp(chunk, chunks[i], CHUNK_SIZE));
+    }
+    EXPECT_FALSE(mspTelemetryReplyPending());
+}
+
+TEST(MspTelemetryTest, RetransmitOutsideWindowIgnored)
+{
+    // given
+    replySize = 60;
+    sendRequest(102);
+
+    uint8_t first[CHUNK_SIZE];
+    uint8_t chunk[CHUNK_SIZE];
+    mspTelemetryEncodeReply(first, CHUNK_SIZE);
+    for (int i = 1; i <= MSP_TELEMETRY_WINDOW; i++) {
+        mspTelemetryEncodeReply(chunk, CHUNK_SIZE);
+    }
+
+    // when
+    sendRetransmit(first[0] & HEAD_SEQ);
+
+    // then
+    mspTelemetryEncodeReply(chunk, CHUNK_SIZE);
+    EXPECT_EQ((first[0] + MSP_TELEMETRY_WINDOW + 1) & HEAD_SEQ, chunk[0] & HEAD_SEQ);
+}
+
+TEST(MspTelemetryTest, SequenceCarriesOnAcrossReplies)
+{
+    // given
+    replySize = 2;
+    uint8_t chunk[CHUNK_SIZE];
+    sendRequest(103);
+    mspTelemetryEncodeReply(chunk, CHUNK_SIZE);
+    const uint8_t seq = chunk[0] & HEAD_SEQ;
+
+    // when
+    sendRequest(103);
+    mspTelemetryEncodeReply(chunk, CHUNK_SIZE);
+
+    // then
+    EXPECT_EQ((seq + 1) & HEAD_SEQ, chunk[0] & HEAD_SEQ);
+}
+
+// STUBS
+
+extern "C" {
+
+mspResult_e mspFcProcessCommand(mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *)
+{
+    reply->cmd = cmd->cmd;
+    for (int i = 0; i < replySize; i++) {
+        sbufWriteU8(&reply->buf, i);
+    }
+    return MSP_RESULT_ACK;
+}
+
+}
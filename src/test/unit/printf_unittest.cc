@@ -0,0 +1,118 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "common/printf.h"
+}
+
+#undef printf
+#undef sprintf
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+typedef struct chunkSink_s {
+    char text[256];
+    int length;
+    int calls;
+} chunkSink_t;
+
+static void chunkSinkWrite(void *arg, const char *data, int len)
+{
+    chunkSink_t *sink = (chunkSink_t *)arg;
+    memcpy(&sink->text[sink->length], data, len);
+    sink->length += len;
+    sink->calls++;
+}
+
+static int chunkSinkPrintf(chunkSink_t *sink, const char *fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    const int written = tfp_format_buffered(sink, chunkSinkWrite, fmt, va);
+    va_end(va);
+    return written;
+}
+
+TEST(PrintfTest, IntegerAndStringFormats)
+{
+    char buf[64];
+
+    EXPECT_EQ(18, tfp_sprintf(buf, "%d %u %x %X %c %s", -12, 34u, 0xabu, 0xcdu, 'z', "str"));
+    EXPECT_STREQ("-12 34 ab CD z str", buf);
+
+    tfp_sprintf(buf, "[%5d][%05u][%3s]", 42, 7u, "ab");
+    EXPECT_STREQ("[   42][00007][ ab]", buf);
+}
+
+TEST(PrintfTest, FloatFormat)
+{
+    char buf[64];
+
+    tfp_sprintf(buf, "%f", (double)1.5f);
+    EXPECT_STREQ("1.500000", buf);
+
+    tfp_sprintf(buf, "%.3f %.3f %.0f", (double)-2.25f, (double)0.0005f, (double)2.5f);
+    EXPECT_STREQ("-2.250 0.001 3", buf);
+
+    tfp_sprintf(buf, "%.2f %8.2f", (double)99.999f, (double)-3.14159f);
+    EXPECT_STREQ("100.00    -3.14", buf);
+
+    // precision is capped at 6 digits
+    tfp_sprintf(buf, "%.9f", (double)0.125f);
+    EXPECT_STREQ("0.125000", buf);
+
+    tfp_sprintf(buf, "%.1f %.1f", (double)1e10f, (double)-1e10f);
+    EXPECT_STREQ("ovf -ovf", buf);
+}
+
+TEST(PrintfTest, BufferedOutputIsChunked)
+{
+    chunkSink_t sink;
+    memset(&sink, 0, sizeof(sink));
+
+    // short output reaches the sink in one call
+    EXPECT_EQ(11, chunkSinkPrintf(&sink, "value %d\r\n", 123));
+    EXPECT_EQ(1, sink.calls);
+
+    char longString[101];
+    memset(longString, 'a', 100);
+    longString[100] = '\0';
+
+    memset(&sink, 0, sizeof(sink));
+    EXPECT_EQ(102, chunkSinkPrintf(&sink, "%s%c%c", longString, 'b', 'c'));
+    EXPECT_EQ(102, sink.length);
+    EXPECT_EQ(2, sink.calls);
+    EXPECT_EQ(0, memcmp(sink.text, longString, 100));
+    EXPECT_EQ('b', sink.text[100]);
+    EXPECT_EQ('c', sink.text[101]);
+
+    // %n counts characters still held in the chunk
+    int count = 0;
+    memset(&sink, 0, sizeof(sink));
+    chunkSinkPrintf(&sink, "abc%n", &count);
+    EXPECT_EQ(3, count);
+}
+
+// STUBS
+
+extern "C" {
+    void serialWrite(struct serialPort_s *, uint8_t) {}
+    bool isSerialTransmitBufferEmpty(const struct serialPort_s *) { return true; }
+}
@@ -34,6 +34,8 @@ extern "C" {
     #include "rx/rx.h"
     #include "rx/crsf.h"
 
+    #include "scheduler/scheduler.h"
+
     void crsfDataReceive(uint16_t c);
     uint8_t crsfFrameCRC(void);
     uint8_t crsfFrameStatus(void);
@@ -78,15 +80,6 @@ uint8_t crc8_buf(const uint8_t * ptr, uint8_t len)
     return crc;
 }
 
-uint8_t crc8_dvb_s2_buf(const uint8_t * ptr, uint8_t len)
-{
-    uint8_t crc = 0;
-    for (uint8_t i=0; i<len; i++) {
-        crc = crc8_dvb_s2(crc, *ptr++);
-    }
-    return crc;
-}
-
 TEST(CrossFireTest, CRC)
 {
     static const uint8_t buf1[] ="abcdefghijklmnopqrstuvwxyz";
@@ -103,7 +96,7 @@ TEST(CrossFireTest, CRC)
     EXPECT_EQ(crc1, crc2);
 
     crc1 = crc8_buf(buf1, 26);
-    crc2 = crc8_dvb_s2_buf(buf1, 26);
+    crc2 = crc8_dvb_s2_buf(0, buf1, 26);
     EXPECT_EQ(crc1, crc2);
 }
 
@@ -276,8 +269,12 @@ extern "C" {
 int16_t debug[DEBUG16_VALUE_COUNT];
 uint32_t micros(void) {return dummyTimeUs;}
 serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, uint32_t, portMode_t, portOptions_t) {return NULL;}
-serialPortConfig_t *findSerialPortConfig(serialPortFunction_e ) {return NULL;}
+const serialPortConfig_t *serialRxFindPortConfig(void) {return NULL;}
 void serialWriteBuf(serialPort_t *, const uint8_t *, int) {}
+void serialSetBaudRate(serialPort_t *, uint32_t) {}
+bool isSerialTransmitBufferEmpty(const serialPort_t *) {return true;}
 bool telemetryCheckRxPortShared(const serialPortConfig_t *) {return false;}
 serialPort_t *telemetrySharedPort = NULL;
+void rxFrameComplete(timeUs_t) {}
+void crsfScheduleMspRequest(const uint8_t *, int) {}
 }
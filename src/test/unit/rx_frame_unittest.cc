@@ -0,0 +1,211 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <string.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "common/maths.h"
+
+    #include "rx/rx.h"
+    #include "rx/rx_frame.h"
+
+    uint32_t dummyTimeUs;
+    int rxFrameCompleteCount;
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static const rxFrameProtocol_t fixedProtocol = {
+    .sync = {
+        { .byte = 0x0F, .length = 8, .checksum = RX_FRAME_CHECKSUM_NONE },
+        { .byte = 0x20, .length = 6, .checksum = RX_FRAME_CHECKSUM_SUM16_INVERTED },
+    },
+    .syncCount = 2,
+    .lengthOffset = 0,
+    .lengthScale = 0,
+    .lengthBase = 0,
+    .byteGapUs = 500,
+    .frameTimeUs = 0,
+};
+
+// a SUMD like frame, sync, status, channel count, two bytes per channel and a CRC
+static const rxFrameProtocol_t lengthFieldProtocol = {
+    .sync = {
+        { .byte = 0xA8, .length = 13, .checksum = RX_FRAME_CHECKSUM_CRC16_CCITT },
+    },
+    .syncCount = 1,
+    .lengthOffset = 2,
+    .lengthScale = 2,
+    .lengthBase = 5,
+    .byteGapUs = 0,
+    .frameTimeUs = 1000,
+};
+
+static void feed(const uint8_t *data, int length, uint32_t byteTimeUs)
+{
+    for (int i = 0; i < length; i++) {
+        dummyTimeUs += byteTimeUs;
+        rxFrameDataReceive(data[i]);
+    }
+}
+
+static void reset(const rxFrameProtocol_t *protocol)
+{
+    dummyTimeUs = 1000000;
+    rxFrameCompleteCount = 0;
+    rxFrameInit(protocol);
+}
+
+TEST(RxFrameTest, FixedLengthFrame)
+{
+    reset(&fixedProtocol);
+    const uint8_t data[] = { 0x55, 0x0F, 1, 2, 3, 4, 5, 6, 7 };
+
+    feed(data, 8, 100);
+    uint8_t length = 0;
+    EXPECT_EQ(NULL, rxFrameGetReceived(&length));
+
+    // the leading byte isn't a sync byte and is skipped
+    feed(data + 8, 1, 100);
+    EXPECT_EQ(1, rxFrameCompleteCount);
+    const uint8_t *frame = rxFrameGetReceived(&length);
+    ASSERT_NE((const uint8_t *)NULL, frame);
+    EXPECT_EQ(8, length);
+    EXPECT_EQ(0, memcmp(frame, data + 1, 8));
+
+    // picked up once only
+    EXPECT_EQ(NULL, rxFrameGetReceived(&length));
+}
+
+TEST(RxFrameTest, ByteGapStartsOver)
+{
+    reset(&fixedProtocol);
+    const uint8_t data[] = { 0x0F, 1, 2, 3, 0x0F, 1, 2, 3, 4, 5, 6, 7 };
+
+    feed(data, 4, 100);
+    // the rest of the frame was lost, the next byte after the gap starts a new one
+    dummyTimeUs += 1000;
+    feed(data + 4, 8, 100);
+    EXPECT_EQ(1, rxFrameCompleteCount);
+    uint8_t length = 0;
+    const uint8_t *frame = rxFrameGetReceived(&length);
+    ASSERT_NE((const uint8_t *)NULL, frame);
+    EXPECT_EQ(0, memcmp(frame, data + 4, 8));
+}
+
+TEST(RxFrameTest, Sum16Checksum)
+{
+    reset(&fixedProtocol);
+    uint8_t data[] = { 0x20, 0x10, 0x20, 0x30, 0, 0 };
+    const uint16_t sum = 0xFFFF - (0x20 + 0x10 + 0x20 + 0x30);
+    data[4] = sum & 0xFF;
+    data[5] = sum >> 8;
+
+    feed(data, sizeof(data), 100);
+    uint8_t length = 0;
+    EXPECT_NE((const uint8_t *)NULL, rxFrameGetReceived(&length));
+    EXPECT_EQ(6, length);
+
+    data[2] ^= 0x01;
+    feed(data, sizeof(data), 100);
+    EXPECT_EQ(2, rxFrameCompleteCount);
+    EXPECT_EQ(NULL, rxFrameGetReceived(&length));
+}
+
+TEST(RxFrameTest, LengthFieldAndCrc)
+{
+    reset(&lengthFieldProtocol);
+    // two channels, 9 bytes
+    uint8_t data[] = { 0xA8, 0x01, 0x02, 0x12, 0x34, 0x56, 0x78, 0, 0 };
+    const uint16_t crc = crc16_ccitt_buf(0, data, 7);
+    data[7] = crc >> 8;
+    data[8] = crc & 0xFF;
+
+    feed(data, sizeof(data), 50);
+    uint8_t length = 0;
+    const uint8_t *frame = rxFrameGetReceived(&length);
+    ASSERT_NE((const uint8_t *)NULL, frame);
+    EXPECT_EQ(9, length);
+    EXPECT_EQ(0x78, frame[6]);
+
+    data[5] ^= 0x80;
+    feed(data, sizeof(data), 50);
+    EXPECT_EQ(NULL, rxFrameGetReceived(&length));
+}
+
+TEST(RxFrameTest, LengthFieldTooLong)
+{
+    reset(&lengthFieldProtocol);
+    // 5 channels would be 15 bytes, longer than the 13 allowed, so the frame is dropped
+    const uint8_t data[] = { 0xA8, 0x01, 0x05, 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0, 0x12, 0x34, 0x56, 0x78 };
+
+    feed(data, sizeof(data), 50);
+    EXPECT_EQ(0, rxFrameCompleteCount);
+    uint8_t length = 0;
+    EXPECT_EQ(NULL, rxFrameGetReceived(&length));
+}
+
+TEST(RxFrameTest, FrameTimeLimit)
+{
+    reset(&lengthFieldProtocol);
+    uint8_t data[] = { 0xA8, 0x01, 0x02, 0x12, 0x34, 0x56, 0x78, 0, 0 };
+    const uint16_t crc = crc16_ccitt_buf(0, data, 7);
+    data[7] = crc >> 8;
+    data[8] = crc & 0xFF;
+
+    // 9 bytes 200us apart take longer than the 1000us allowed
+    feed(data, sizeof(data), 200);
+    EXPECT_EQ(0, rxFrameCompleteCount);
+
+    feed(data, sizeof(data), 50);
+    EXPECT_EQ(1, rxFrameCompleteCount);
+}
+
+TEST(RxFrameTest, FrameKeptWhileNextIsReceived)
+{
+    reset(&fixedProtocol);
+    const uint8_t first[] = { 0x0F, 1, 2, 3, 4, 5, 6, 7 };
+    const uint8_t second[] = { 0x0F, 8, 9, 10, 11, 12, 13, 14 };
+
+    feed(first, sizeof(first), 100);
+    uint8_t length = 0;
+    const uint8_t *frame = rxFrameGetReceived(&length);
+    ASSERT_NE((const uint8_t *)NULL, frame);
+
+    // the next frame goes to the other buffer
+    dummyTimeUs += 5000;
+    feed(second, sizeof(second), 100);
+    EXPECT_EQ(0, memcmp(frame, first, sizeof(first)));
+
+    const uint8_t *next = rxFrameGetReceived(&length);
+    ASSERT_NE((const uint8_t *)NULL, next);
+    EXPECT_NE(frame, next);
+    EXPECT_EQ(0, memcmp(next, second, sizeof(second)));
+}
+
+// STUBS
+
+extern "C" {
+uint32_t micros(void) {return dummyTimeUs;}
+void rxFrameComplete(timeUs_t) {rxFrameCompleteCount++;}
+}
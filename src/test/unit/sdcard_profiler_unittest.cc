@@ -0,0 +1,216 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "io/asyncfatfs/asyncfatfs.h"
+    #include "io/sdcard_profiler.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static uint32_t fakeMillis;
+static afatfsFilesystemState_e fakeFilesystemState;
+static int fakeFile;
+static afatfsFileCallback_t openCallback;
+static afatfsCallback_t unlinkCallback;
+static uint32_t fwriteRoom; // Bytes the fake write-behind cache will take before it needs a poll
+static uint32_t bytesWritten;
+static bool unlinked;
+
+static void resetFakes(void)
+{
+    fakeMillis = 1000;
+    fakeFilesystemState = AFATFS_FILESYSTEM_STATE_INITIALIZATION;
+    openCallback = NULL;
+    unlinkCallback = NULL;
+    fwriteRoom = 0;
+    bytesWritten = 0;
+    unlinked = false;
+}
+
+TEST(SdcardProfilerTest, BucketsLatencies)
+{
+    resetFakes();
+    sdcardProfilerInit(false);
+
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_WRITE, 0, 100);
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_WRITE, 1, 250);
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_WRITE, 2, 999);
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_WRITE, 3, 150000);
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_WRITE, 4, 2000000);
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_READ, 5, 400);
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_ERASE, 6, 400);
+
+    const sdcardLatencyStats_t *writes = sdcardProfilerGetStats(SDCARD_BLOCK_OPERATION_WRITE);
+    EXPECT_EQ(5, writes->count);
+    EXPECT_EQ(2000000, writes->maxUs);
+    EXPECT_EQ(2, writes->stalls);
+    EXPECT_EQ(1, writes->histogram[0]);
+    EXPECT_EQ(1, writes->histogram[1]);
+    EXPECT_EQ(1, writes->histogram[2]);
+    EXPECT_EQ(1, writes->histogram[10]);
+    EXPECT_EQ(1, writes->histogram[SDCARD_PROFILER_BUCKET_COUNT - 1]);
+
+    const sdcardLatencyStats_t *reads = sdcardProfilerGetStats(SDCARD_BLOCK_OPERATION_READ);
+    EXPECT_EQ(1, reads->count);
+    EXPECT_EQ(400, reads->maxUs);
+    EXPECT_EQ(0, reads->stalls);
+    EXPECT_EQ(1, reads->histogram[1]);
+
+    sdcardProfilerReset();
+    EXPECT_EQ(0, writes->count);
+    EXPECT_EQ(0, writes->histogram[0]);
+}
+
+TEST(SdcardProfilerTest, BucketLimits)
+{
+    EXPECT_EQ(250, sdcardProfilerGetBucketLimitUs(0));
+    EXPECT_EQ(500, sdcardProfilerGetBucketLimitUs(1));
+    EXPECT_EQ(256000, sdcardProfilerGetBucketLimitUs(SDCARD_PROFILER_BUCKET_COUNT - 2));
+    // The last bucket holds everything from the previous limit upwards
+    EXPECT_EQ(256000, sdcardProfilerGetBucketLimitUs(SDCARD_PROFILER_BUCKET_COUNT - 1));
+}
+
+TEST(SdcardProfilerTest, BenchmarkOffByDefault)
+{
+    resetFakes();
+    sdcardProfilerInit(false);
+
+    fakeFilesystemState = AFATFS_FILESYSTEM_STATE_READY;
+    sdcardProfilerUpdate();
+
+    EXPECT_EQ(SDCARD_BENCHMARK_OFF, sdcardBenchmarkGetState());
+    EXPECT_TRUE(openCallback == NULL);
+}
+
+TEST(SdcardProfilerTest, BenchmarkWritesAndDeletesFile)
+{
+    resetFakes();
+    sdcardProfilerInit(true);
+
+    // Waits for the filesystem
+    sdcardProfilerUpdate();
+    EXPECT_EQ(SDCARD_BENCHMARK_WAITING, sdcardBenchmarkGetState());
+    EXPECT_TRUE(openCallback == NULL);
+
+    fakeFilesystemState = AFATFS_FILESYSTEM_STATE_READY;
+    sdcardProfilerUpdate();
+    ASSERT_TRUE(openCallback != NULL);
+
+    // Writes from before the benchmark aren't counted
+    sdcardProfilerRecord(SDCARD_BLOCK_OPERATION_WRITE, 0, 100);
+    openCallback((afatfsFilePtr_t) &fakeFile);
+    EXPECT_EQ(SDCARD_BENCHMARK_RUNNING, sdcardBenchmarkGetState());
+    EXPECT_EQ(0, sdcardProfilerGetStats(SDCARD_BLOCK_OPERATION_WRITE)->count);
+    EXPECT_EQ(0, sdcardBenchmarkGetRateKBps());
+
+    // 64kB per poll, 10ms apart
+    while (bytesWritten < SDCARD_BENCHMARK_SIZE) {
+        EXPECT_FALSE(unlinked);
+        fwriteRoom = 64 * 1024;
+        fakeMillis += 10;
+        sdcardProfilerUpdate();
+    }
+    EXPECT_EQ(SDCARD_BENCHMARK_SIZE, bytesWritten);
+
+    // The poll that wrote the last byte found the cache flushed, so it deleted the file
+    EXPECT_TRUE(unlinked);
+    ASSERT_TRUE(unlinkCallback != NULL);
+    EXPECT_EQ(SDCARD_BENCHMARK_RUNNING, sdcardBenchmarkGetState());
+
+    // Further polls don't touch the file while the delete completes
+    unlinked = false;
+    sdcardProfilerUpdate();
+    EXPECT_FALSE(unlinked);
+
+    unlinkCallback();
+    EXPECT_EQ(SDCARD_BENCHMARK_DONE, sdcardBenchmarkGetState());
+    // 1MB in 160ms
+    EXPECT_EQ(1024 * 1000 / 160, sdcardBenchmarkGetRateKBps());
+}
+
+TEST(SdcardProfilerTest, BenchmarkFailsWithoutFilesystem)
+{
+    resetFakes();
+    sdcardProfilerInit(true);
+
+    fakeFilesystemState = AFATFS_FILESYSTEM_STATE_FATAL;
+    sdcardProfilerUpdate();
+
+    EXPECT_EQ(SDCARD_BENCHMARK_FAILED, sdcardBenchmarkGetState());
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t millis(void)
+{
+    return fakeMillis;
+}
+
+void sdcard_setProfilerCallback(sdcard_profilerCallback_c callback)
+{
+    UNUSED(callback);
+}
+
+afatfsFilesystemState_e afatfs_getFilesystemState()
+{
+    return fakeFilesystemState;
+}
+
+bool afatfs_fopen(const char *filename, const char *mode, afatfsFileCallback_t complete)
+{
+    EXPECT_STREQ(SDCARD_BENCHMARK_FILENAME, filename);
+    EXPECT_STREQ("as", mode);
+    openCallback = complete;
+    return true;
+}
+
+uint32_t afatfs_fwrite(afatfsFilePtr_t file, const uint8_t *buffer, uint32_t len)
+{
+    UNUSED(file);
+    UNUSED(buffer);
+
+    uint32_t written = len < fwriteRoom ? len : fwriteRoom;
+    fwriteRoom -= written;
+    bytesWritten += written;
+    return written;
+}
+
+bool afatfs_flush()
+{
+    return true;
+}
+
+bool afatfs_isFull()
+{
+    return false;
+}
+
+bool afatfs_funlink(afatfsFilePtr_t file, afatfsCallback_t callback)
+{
+    EXPECT_TRUE(file == (afatfsFilePtr_t) &fakeFile);
+    unlinkCallback = callback;
+    unlinked = true;
+    return true;
+}
+
+}
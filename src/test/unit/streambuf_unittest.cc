@@ -0,0 +1,108 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "common/streambuf.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+TEST(StreamBufferTest, RingReadWraps)
+{
+    uint8_t ring[8] = { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17 };
+    sbufRing_t src;
+
+    // six bytes from offset 5 wrap after three
+    sbufRingInit(&src, ring, sizeof(ring), 5, 6);
+    EXPECT_EQ(6, sbufRingBytesRemaining(&src));
+    EXPECT_EQ(3, sbufBytesRemaining(&src.seg));
+
+    EXPECT_EQ(0x15, sbufRingReadU8(&src));
+    EXPECT_EQ(0x1716, sbufRingReadU16(&src));
+    // the contiguous part has moved to the start of the ring
+    EXPECT_EQ(3, sbufBytesRemaining(&src.seg));
+    EXPECT_EQ(ring, sbufPtr(&src.seg));
+
+    uint8_t data[3];
+    sbufRingReadData(&src, data, sizeof(data));
+    EXPECT_EQ(0x10, data[0]);
+    EXPECT_EQ(0x12, data[2]);
+    EXPECT_EQ(0, sbufRingBytesRemaining(&src));
+    EXPECT_EQ(6, sbufRingBytesUsed(&src));
+}
+
+TEST(StreamBufferTest, RingReadDataAcrossWrap)
+{
+    uint8_t ring[8] = { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17 };
+    sbufRing_t src;
+
+    sbufRingInit(&src, ring, sizeof(ring), 6, 8);
+    EXPECT_EQ(0x11101716u, sbufRingReadU32(&src));
+
+    sbufRingAdvance(&src, 1);
+    uint8_t data[3];
+    sbufRingReadData(&src, data, sizeof(data));
+    EXPECT_EQ(0x13, data[0]);
+    EXPECT_EQ(0x15, data[2]);
+    EXPECT_EQ(0, sbufRingBytesRemaining(&src));
+
+    // reading past the end of the segment stops there
+    sbufRingReadData(&src, data, sizeof(data));
+    EXPECT_EQ(8, sbufRingBytesUsed(&src));
+}
+
+TEST(StreamBufferTest, RingWriteWraps)
+{
+    uint8_t ring[8];
+    memset(ring, 0, sizeof(ring));
+    sbufRing_t dst;
+
+    sbufRingInit(&dst, ring, sizeof(ring), 7, 7);
+    sbufRingWriteU16(&dst, 0x2221);
+    const uint8_t data[] = { 0x23, 0x24, 0x25 };
+    sbufRingWriteData(&dst, data, sizeof(data));
+    EXPECT_EQ(2, sbufRingBytesRemaining(&dst));
+    EXPECT_EQ(5, sbufRingBytesUsed(&dst));
+
+    EXPECT_EQ(0x21, ring[7]);
+    EXPECT_EQ(0x22, ring[0]);
+    EXPECT_EQ(0x25, ring[3]);
+    EXPECT_EQ(0x00, ring[4]);
+}
+
+TEST(StreamBufferTest, RingWithoutWrap)
+{
+    uint8_t ring[8];
+    sbufRing_t dst;
+
+    sbufRingInit(&dst, ring, sizeof(ring), 2, 6);
+    EXPECT_EQ(6, sbufBytesRemaining(&dst.seg));
+    sbufRingWriteU32(&dst, 0x04030201);
+    sbufRingWriteU8(&dst, 0x05);
+    sbufRingWriteU8(&dst, 0x06);
+    EXPECT_EQ(0, sbufRingBytesRemaining(&dst));
+    EXPECT_EQ(0x01, ring[2]);
+    EXPECT_EQ(0x06, ring[7]);
+
+    // an empty segment
+    sbufRingInit(&dst, ring, sizeof(ring), 0, 0);
+    EXPECT_EQ(0, sbufRingBytesRemaining(&dst));
+    EXPECT_EQ(0, sbufRingBytesUsed(&dst));
+}
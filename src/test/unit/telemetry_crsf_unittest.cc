@@ -41,9 +41,15 @@ extern "C" {
     #include "io/gps.h"
     #include "io/serial.h"
 
+    #include "msp/msp.h"
+
     #include "rx/crsf.h"
 
+    #include "scheduler/scheduler.h"
+
     #include "sensors/sensors.h"
+    #include "sensors/acceleration.h"
+    #include "sensors/barometer.h"
     #include "sensors/battery.h"
 
     #include "telemetry/telemetry.h"
@@ -286,6 +292,10 @@ uint16_t vbat;
 
 int32_t amperage;
 int32_t mAhDrawn;
+uint16_t rssi;
+int32_t vario;
+baro_t baro;
+acc_t acc;
 
 void beeperConfirmationBeeps(uint8_t beepCount) {UNUSED(beepCount);}
 
@@ -298,11 +308,13 @@ uint32_t serialTxBytesFree(const serialPort_t *) {return 0;}
 uint8_t serialRead(serialPort_t *) {return 0;}
 void serialWrite(serialPort_t *, uint8_t) {}
 void serialWriteBuf(serialPort_t *, const uint8_t *, int) {}
+void serialSetBaudRate(serialPort_t *, uint32_t) {}
+bool isSerialTransmitBufferEmpty(const serialPort_t *) {return true;}
 void serialSetMode(serialPort_t *, portMode_t ) {}
 serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, uint32_t, portMode_t, portOptions_t) {return NULL;}
 void closeSerialPort(serialPort_t *) {}
 
-serialPortConfig_t *findSerialPortConfig(serialPortFunction_e) {return NULL;}
+const serialPortConfig_t *serialRxFindPortConfig(void) {return NULL;}
 
 bool telemetryDetermineEnabledState(portSharing_e) {return true;}
 bool telemetryCheckRxPortShared(const serialPortConfig_t *) {return true;}
@@ -315,5 +327,9 @@ uint8_t calculateBatteryPercentage(void) {return 67;}
 batteryState_e getBatteryState(void) {return BATTERY_OK;}
 bool isAirmodeActive(void) {return airMode;}
 
+void rxFrameComplete(timeUs_t) {}
+
+mspResult_e mspFcProcessCommand(mspPacket_t *, mspPacket_t *, mspPostProcessFnPtr *) {return MSP_RESULT_NO_REPLY;}
+
 }
 
@@ -181,6 +181,11 @@ uint32_t millis(void) {
 
 uint32_t micros(void) { return 0; }
 
+void systemSetTickCallback(sysTickCallbackFunc *fn)
+{
+    UNUSED(fn);
+}
+
 uint32_t serialRxBytesWaiting(const serialPort_t *instance)
 {
     UNUSED(instance);
@@ -205,6 +210,12 @@ void serialWrite(serialPort_t *instance, uint8_t ch)
     UNUSED(ch);
 }
 
+bool isSerialTransmitBufferEmpty(const serialPort_t *instance)
+{
+    UNUSED(instance);
+    return true;
+}
+
 void serialSetMode(serialPort_t *instance, portMode_t mode)
 {
     UNUSED(instance);
@@ -0,0 +1,145 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/axis.h"
+    #include "common/time.h"
+
+    #include "flight/altitudehold.h"
+    #include "flight/imu.h"
+
+    #include "rx/rx.h"
+
+    #include "sensors/acceleration.h"
+    #include "sensors/barometer.h"
+    #include "sensors/battery.h"
+
+    #include "telemetry/telemetry_values.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+TEST(TelemetryValuesTest, DueOnFirstCheck)
+{
+    // given
+    telemetrySubscription_t subscription = { TELEMETRY_VALUE_VBAT, 200, 1000, 1, 0, 0, false };
+
+    // expect
+    EXPECT_TRUE(telemetrySubscriptionDue(&subscription, 0));
+}
+
+TEST(TelemetryValuesTest, DueOnlyOnThresholdChange)
+{
+    // given
+    telemetrySubscription_t subscription = { TELEMETRY_VALUE_VBAT, 200, 1000, 2, 0, 0, false };
+    vbat = 120;
+    telemetryValuesUpdate();
+    telemetrySubscriptionSent(&subscription, 100);
+
+    // when
+    vbat = 121;
+    telemetryValuesUpdate();
+
+    // then
+    EXPECT_FALSE(telemetrySubscriptionDue(&subscription, 400));
+
+    // when
+    vbat = 118;
+    telemetryValuesUpdate();
+
+    // then
+    EXPECT_TRUE(telemetrySubscriptionDue(&subscription, 400));
+}
+
+TEST(TelemetryValuesTest, ChangeHeldUntilMinInterval)
+{
+    // given
+    telemetrySubscription_t subscription = { TELEMETRY_VALUE_AMPERAGE, 200, 1000, 10, 0, 0, false };
+    amperage = 0;
+    telemetryValuesUpdate();
+    telemetrySubscriptionSent(&subscription, 1000);
+
+    // when
+    amperage = 500;
+    telemetryValuesUpdate();
+
+    // then
+    EXPECT_FALSE(telemetrySubscriptionDue(&subscription, 1100));
+    EXPECT_TRUE(telemetrySubscriptionDue(&subscription, 1200));
+}
+
+TEST(TelemetryValuesTest, UnchangedSentAtMaxInterval)
+{
+    // given
+    telemetrySubscription_t subscription = { TELEMETRY_VALUE_MAH_DRAWN, 200, 1000, 1, 0, 0, false };
+    mAhDrawn = 10;
+    telemetryValuesUpdate();
+    telemetrySubscriptionSent(&subscription, 0xfffffe00);
+
+    // expect, across the millisecond counter wrap
+    EXPECT_FALSE(telemetrySubscriptionDue(&subscription, 0x000001e0));
+    EXPECT_TRUE(telemetrySubscriptionDue(&subscription, 0x000001e8));
+}
+
+TEST(TelemetryValuesTest, CompositeDueAtMinInterval)
+{
+    // given
+    telemetrySubscription_t subscription = { TELEMETRY_VALUE_NONE, 500, 1000, 0, 0, 0, false };
+    telemetrySubscriptionSent(&subscription, 0);
+
+    // expect
+    EXPECT_FALSE(telemetrySubscriptionDue(&subscription, 499));
+    EXPECT_TRUE(telemetrySubscriptionDue(&subscription, 500));
+}
+
+TEST(TelemetryValuesTest, ScalesAcceleration)
+{
+    // given
+    acc.dev.acc_1G = 512;
+    acc.accSmooth[X] = 256;
+    acc.accSmooth[Y] = -512;
+    acc.accSmooth[Z] = 1024;
+
+    // when
+    telemetryValuesUpdate();
+
+    // then
+    EXPECT_EQ(50, telemetryValue(TELEMETRY_VALUE_ACC_X));
+    EXPECT_EQ(-100, telemetryValue(TELEMETRY_VALUE_ACC_Y));
+    EXPECT_EQ(200, telemetryValue(TELEMETRY_VALUE_ACC_Z));
+    EXPECT_EQ(0, telemetryValue(TELEMETRY_VALUE_NONE));
+}
+
+// STUBS
+
+extern "C" {
+    uint16_t vbat;
+    int32_t amperage;
+    int32_t mAhDrawn;
+    uint16_t rssi;
+    int32_t vario;
+    baro_t baro;
+    acc_t acc;
+    attitudeEulerAngles_t attitude;
+    uint16_t flightModeFlags;
+    uint8_t armingFlags;
+}
@@ -0,0 +1,115 @@
+# Prints the flash and RAM each feature costs a target, from the GNU ld map files of a full build and of one
+# build without each feature, named by the directory the map is in. The first map is the full build.
+#
+#   awk -f support/feature_cost.awk obj/main/feature_cost/NAZE/base/betaflight_NAZE.map \
+#       obj/main/feature_cost/NAZE/GPS/betaflight_NAZE.map ...
+#
+# With profile set to a file holding the output of the CLI cycleprofile command, taken on a board running
+# the full build, the time of the flight loop probe a feature runs under is added, per loop of looptime us.
+
+function hex(s,    i, v) {
+    s = tolower(s)
+    sub(/^0x/, "", s)
+    v = 0
+    for (i = 1; i <= length(s); i++) {
+        v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    }
+    return v
+}
+
+function isFlash(address) {
+    # the flash through the AXI and the F7 ITCM interface
+    return (address >= hex("0x08000000") && address < hex("0x09000000")) || (address >= hex("0x00200000") && address < hex("0x00300000"))
+}
+
+function isRam(address) {
+    # SRAM, the F3/F4 CCM and the F7 ITCM RAM
+    return (address >= hex("0x20000000") && address < hex("0x30000000")) || (address >= hex("0x10000000") && address < hex("0x10010000")) || address < hex("0x00004000")
+}
+
+function account(name, address, size, loadAddress) {
+    # debug info is linked at 0 as well, it takes no room on the chip
+    if (name ~ /^\.(debug|comment|ARM\.attributes|stab|note)/) {
+        return
+    }
+    address = hex(address)
+    size = hex(size)
+    if (isFlash(address) || (loadAddress != "" && isFlash(hex(loadAddress)))) {
+        flash[build] += size
+    }
+    if (isRam(address) && !isFlash(address)) {
+        ram[build] += size
+    }
+}
+
+BEGIN {
+    if (looptime == "") {
+        looptime = 125
+    }
+    # the probes of build/profile.h a feature runs under
+    probes["BLACKBOX"] = "BLACKBOX"
+    probes["OSD"] = "OSD"
+    probes["USE_DSHOT"] = "MOTORS"
+    if (profile != "") {
+        while ((getline line < profile) > 0) {
+            n = split(line, fields, " ")
+            # <probe> <min> <avg> <max> <avg us> <calls>
+            if (n == 6 && fields[6] ~ /^[0-9]+$/) {
+                probeUs[fields[1]] = fields[5]
+                probeCalls[fields[1]] = fields[6]
+            }
+        }
+        close(profile)
+    }
+}
+
+FNR == 1 {
+    build = FILENAME
+    sub(/\/[^\/]*$/, "", build)
+    sub(/^.*\//, "", build)
+    builds[buildCount++] = build
+    inMap = 0
+}
+
+/^Linker script and memory map/ { inMap = 1; next }
+!inMap { next }
+
+# output sections start in the first column, long names put the address and size on the next line
+/^\.[^ ]+/ {
+    pending = ""
+    if (NF >= 3 && $2 ~ /^0x/) {
+        account($1, $2, $3, $4 == "load" ? $6 : "")
+    } else if (NF == 1) {
+        pending = $1
+    }
+    next
+}
+pending != "" && /^ +0x/ && NF >= 2 {
+    account(pending, $1, $2, $3 == "load" ? $5 : "")
+}
+{ pending = "" }
+
+END {
+    base = builds[0]
+    printf "full build: %d bytes of flash, %d bytes of RAM\n\n", flash[base], ram[base]
+    if (profile != "") {
+        printf "%-20s %10s %10s %12s %8s\n", "feature", "flash", "RAM", "us per loop", "CPU %"
+    } else {
+        printf "%-20s %10s %10s\n", "feature", "flash", "RAM"
+    }
+    for (i = 1; i < buildCount; i++) {
+        feature = builds[i]
+        printf "%-20s %10d %10d", feature, flash[base] - flash[feature], ram[base] - ram[feature]
+        if (profile != "") {
+            probe = probes[feature]
+            if (probe != "" && probeCalls["GYRO"]) {
+                # probes that don't run every loop, like the OSD, are spread over the loops
+                us = probeUs[probe] * probeCalls[probe] / probeCalls["GYRO"]
+                printf " %12.2f %7.1f%%", us, 100 * us / looptime
+            } else {
+                printf " %12s %8s", "-", "-"
+            }
+        }
+        printf "\n"
+    }
+}
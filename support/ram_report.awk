@@ -0,0 +1,71 @@
+# Prints the static RAM (.data and .bss) taken by each object file, from a GNU ld map file, largest first.
+#
+#   awk -f support/ram_report.awk obj/main/cleanflight_NAZE.map
+
+function hex(s,    i, v) {
+    s = tolower(s)
+    sub(/^0x/, "", s)
+    v = 0
+    for (i = 1; i <= length(s); i++) {
+        v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    }
+    return v
+}
+
+function account(section, size, file,    name, n, parts) {
+    name = file
+    if (sub(/^.*\/obj\/main\/[^\/]+\//, "", name)) {
+        sub(/\.o$/, "", name)
+    } else {
+        # toolchain libraries, by archive
+        sub(/\(.*$/, "", name)
+        n = split(name, parts, "/")
+        name = parts[n]
+    }
+    if (!(name in total)) {
+        names[count++] = name
+    }
+    if (section ~ /^\.data/) {
+        data[name] += hex(size)
+    } else {
+        bss[name] += hex(size)
+    }
+    total[name] += hex(size)
+}
+
+/^Linker script and memory map/ { inMap = 1; next }
+!inMap { next }
+
+# input sections, long names put the address, size and file on the next line
+/^ (\.data|\.bss|COMMON)/ {
+    pending = ""
+    if (NF >= 4) {
+        account($1, $3, $4)
+    } else if (NF == 1) {
+        pending = $1
+    }
+    next
+}
+pending != "" && /^ +0x/ && NF >= 3 { account(pending, $2, $3) }
+{ pending = "" }
+
+END {
+    # largest first, there are only a few hundred objects
+    for (i = 0; i < count; i++) {
+        for (j = i + 1; j < count; j++) {
+            if (total[names[j]] > total[names[i]]) {
+                t = names[i]; names[i] = names[j]; names[j] = t
+            }
+        }
+    }
+    printf "%-40s %8s %8s %8s\n", "object", "data", "bss", "total"
+    for (i = 0; i < count; i++) {
+        name = names[i]
+        if (total[name]) {
+            printf "%-40s %8d %8d %8d\n", name, data[name], bss[name], total[name]
+            sumData += data[name]
+            sumBss += bss[name]
+        }
+    }
+    printf "%-40s %8d %8d %8d\n", "TOTAL", sumData, sumBss, sumData + sumBss
+}